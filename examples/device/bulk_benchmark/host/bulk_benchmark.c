@@ -0,0 +1,408 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Host side of the bulk_benchmark example, uses libusb-1.0.
+ *
+ * Runs sink (OUT), source (IN) and loopback throughput tests plus a loopback latency test (one transfer in flight)
+ * and prints MB/s and per-transfer latency percentiles. Latency of a transfer is the time from its submission to its
+ * completion, for loopback from the submission of the OUT transfer to the completion of its echo.
+ *
+ * Build: make (or cc -O2 bulk_benchmark.c $(pkg-config --cflags --libs libusb-1.0))
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <libusb.h>
+
+#include "../src/bench_protocol.h"
+
+#define XFER_TIMEOUT_MS   5000
+#define HOST_DEPTH_MAX    255
+
+typedef struct {
+  libusb_device_handle* handle;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  bench_status_t info; // device capability
+} bench_dev_t;
+
+typedef struct {
+  bench_dev_t* dev;
+  bench_config_t cfg;
+
+  uint32_t out_submitted;
+  uint32_t in_submitted;
+  uint32_t out_done;
+  uint32_t in_done;
+
+  uint64_t* t_submit; // per transfer, ns
+  uint64_t* t_done;
+  uint64_t bytes;
+  uint32_t mismatch;
+  bool failed;
+} bench_run_t;
+
+static uint8_t* pattern;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static const char* mode_str(uint8_t mode) {
+  switch (mode) {
+    case BENCH_MODE_SINK:     return "sink";
+    case BENCH_MODE_SOURCE:   return "source";
+    case BENCH_MODE_LOOPBACK: return "loopback";
+    default:                  return "idle";
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device
+//--------------------------------------------------------------------+
+
+static int get_status(bench_dev_t* dev, bench_status_t* status) {
+  int rc = libusb_control_transfer(dev->handle,
+                                   LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+                                   BENCH_REQ_STATUS, 0, 0, (unsigned char*) status, sizeof(bench_status_t),
+                                   XFER_TIMEOUT_MS);
+  return (rc == (int) sizeof(bench_status_t)) ? 0 : -1;
+}
+
+static int find_endpoints(bench_dev_t* dev) {
+  struct libusb_config_descriptor* config;
+  if (libusb_get_active_config_descriptor(libusb_get_device(dev->handle), &config)) return -1;
+
+  struct libusb_interface_descriptor const* itf = &config->interface[0].altsetting[0];
+  for (int i = 0; i < itf->bNumEndpoints; i++) {
+    struct libusb_endpoint_descriptor const* ep = &itf->endpoint[i];
+    if ((ep->bmAttributes & 0x03) != LIBUSB_TRANSFER_TYPE_BULK) continue;
+
+    if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+      dev->ep_in = ep->bEndpointAddress;
+    } else {
+      dev->ep_out = ep->bEndpointAddress;
+    }
+  }
+
+  libusb_free_config_descriptor(config);
+  return (dev->ep_in && dev->ep_out) ? 0 : -1;
+}
+
+static int open_device(bench_dev_t* dev, uint16_t vid, uint16_t pid) {
+  dev->handle = libusb_open_device_with_vid_pid(NULL, vid, pid);
+  if (!dev->handle) {
+    fprintf(stderr, "Device %04x:%04x not found\n", vid, pid);
+    return -1;
+  }
+
+  libusb_set_auto_detach_kernel_driver(dev->handle, 1);
+  if (libusb_claim_interface(dev->handle, 0) || find_endpoints(dev) || get_status(dev, &dev->info)) {
+    fprintf(stderr, "Failed to set up device\n");
+    return -1;
+  }
+
+  // a run left over by an interrupted tool, transfers in flight can only be discarded by a bus reset
+  if (dev->info.mode != BENCH_MODE_IDLE) {
+    printf("Device busy with a previous run, resetting it\n");
+    libusb_release_interface(dev->handle, 0);
+    libusb_reset_device(dev->handle);
+    libusb_close(dev->handle);
+    dev->handle = NULL;
+
+    for (int i = 0; i < 50 && !dev->handle; i++) {
+      struct timespec const ts = {0, 100 * 1000 * 1000};
+      nanosleep(&ts, NULL);
+      dev->handle = libusb_open_device_with_vid_pid(NULL, vid, pid);
+    }
+    if (!dev->handle) return -1;
+
+    libusb_set_auto_detach_kernel_driver(dev->handle, 1);
+    if (libusb_claim_interface(dev->handle, 0) || get_status(dev, &dev->info)) return -1;
+  }
+
+  return 0;
+}
+
+//--------------------------------------------------------------------+
+// Run
+//--------------------------------------------------------------------+
+
+static void LIBUSB_CALL xfer_complete_cb(struct libusb_transfer* xfer);
+
+static int submit(bench_run_t* run, struct libusb_transfer* xfer, bool is_in) {
+  uint32_t* submitted = is_in ? &run->in_submitted : &run->out_submitted;
+  uint32_t const seq = (*submitted)++;
+
+  // loopback latency starts when the data leaves the host
+  if (!is_in || run->cfg.mode != BENCH_MODE_LOOPBACK) run->t_submit[seq] = now_ns();
+
+  if (libusb_submit_transfer(xfer)) {
+    run->failed = true;
+    return -1;
+  }
+  return 0;
+}
+
+static void LIBUSB_CALL xfer_complete_cb(struct libusb_transfer* xfer) {
+  bench_run_t* run = (bench_run_t*) xfer->user_data;
+  bool const is_in = (xfer->endpoint & LIBUSB_ENDPOINT_IN) != 0;
+  uint64_t const t = now_ns();
+
+  if (run->failed) return; // cancelled after an earlier failure
+
+  if (xfer->status != LIBUSB_TRANSFER_COMPLETED || (uint32_t) xfer->actual_length != run->cfg.xfer_size) {
+    fprintf(stderr, "%s transfer failed: status %d, %d bytes\n", is_in ? "IN" : "OUT", xfer->status,
+            xfer->actual_length);
+    run->failed = true;
+    return;
+  }
+
+  // transfers on an endpoint complete in order
+  if (is_in) {
+    run->t_done[run->in_done++] = t;
+    run->bytes += (uint64_t) xfer->actual_length;
+    if (memcmp(xfer->buffer, pattern, run->cfg.xfer_size)) run->mismatch++;
+    if (run->in_submitted < run->cfg.xfer_count) submit(run, xfer, true);
+  } else {
+    if (run->cfg.mode == BENCH_MODE_SINK) {
+      run->t_done[run->out_done] = t;
+      run->bytes += (uint64_t) xfer->actual_length;
+    }
+    run->out_done++;
+    if (run->out_submitted < run->cfg.xfer_count) submit(run, xfer, false);
+  }
+}
+
+static bool run_complete(bench_run_t const* run) {
+  uint32_t const done = (run->cfg.mode == BENCH_MODE_SINK) ? run->out_done : run->in_done;
+  return done == run->cfg.xfer_count;
+}
+
+static int cmp_u64(void const* a, void const* b) {
+  uint64_t const x = *(uint64_t const*) a;
+  uint64_t const y = *(uint64_t const*) b;
+  return (x > y) - (x < y);
+}
+
+static void report(bench_run_t* run, char const* name, uint64_t elapsed_ns, bench_status_t const* status) {
+  uint32_t const n = run->cfg.xfer_count;
+
+  // t_done becomes latency
+  for (uint32_t i = 0; i < n; i++) run->t_done[i] -= run->t_submit[i];
+  qsort(run->t_done, n, sizeof(uint64_t), cmp_u64);
+
+  double const mbps = (double) run->bytes / ((double) elapsed_ns / 1e9) / 1e6;
+  #define LAT_US(pct)  ((double) run->t_done[((uint64_t) (n - 1) * (pct)) / 100] / 1e3)
+
+  printf("%-9s %7u %5u %7u %9.3f %9.1f %9.1f %9.1f %9.1f", name, run->cfg.xfer_size, run->cfg.queue_depth, n, mbps,
+         LAT_US(50), LAT_US(90), LAT_US(99), LAT_US(100));
+  #undef LAT_US
+
+  if (run->mismatch) printf("  %u data mismatch", run->mismatch);
+  if (status->errors) printf("  %u device errors", status->errors);
+  printf("  (device %u ms)\n", status->duration_ms);
+}
+
+static int bench_run(bench_dev_t* dev, char const* name, uint8_t mode, uint32_t xfer_size, uint8_t depth,
+                     uint32_t count) {
+  bench_run_t run = {
+    .dev = dev,
+    .cfg = { .mode = mode, .queue_depth = depth, .xfer_size = xfer_size, .xfer_count = count },
+  };
+  run.t_submit = calloc(count, sizeof(uint64_t));
+  run.t_done = calloc(count, sizeof(uint64_t));
+
+  bool const has_out = (mode != BENCH_MODE_SOURCE);
+  bool const has_in = (mode != BENCH_MODE_SINK);
+  uint32_t const nxfer = (depth < count) ? depth : count;
+
+  struct libusb_transfer* xfer_out[HOST_DEPTH_MAX] = { NULL };
+  struct libusb_transfer* xfer_in[HOST_DEPTH_MAX] = { NULL };
+  int ret = -1;
+
+  for (uint32_t i = 0; i < nxfer; i++) {
+    if (has_out) {
+      xfer_out[i] = libusb_alloc_transfer(0);
+      libusb_fill_bulk_transfer(xfer_out[i], dev->handle, dev->ep_out, pattern, (int) xfer_size, xfer_complete_cb,
+                                &run, XFER_TIMEOUT_MS);
+    }
+    if (has_in) {
+      xfer_in[i] = libusb_alloc_transfer(0);
+      libusb_fill_bulk_transfer(xfer_in[i], dev->handle, dev->ep_in, malloc(xfer_size), (int) xfer_size,
+                                xfer_complete_cb, &run, XFER_TIMEOUT_MS);
+    }
+  }
+
+  int rc = libusb_control_transfer(dev->handle,
+                                   LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
+                                   BENCH_REQ_START, 0, 0, (unsigned char*) &run.cfg, sizeof(bench_config_t),
+                                   XFER_TIMEOUT_MS);
+  if (rc != (int) sizeof(bench_config_t)) {
+    fprintf(stderr, "%s: device rejected the run\n", name);
+    goto cleanup;
+  }
+
+  uint64_t const t_start = now_ns();
+  for (uint32_t i = 0; i < nxfer; i++) {
+    if (has_in) submit(&run, xfer_in[i], true);
+    if (has_out) submit(&run, xfer_out[i], false);
+  }
+
+  while (!run.failed && !run_complete(&run)) {
+    libusb_handle_events(NULL);
+  }
+  uint64_t const elapsed = now_ns() - t_start;
+
+  if (run.failed) {
+    // cancel what is still in flight and wait for it
+    for (uint32_t i = 0; i < nxfer; i++) {
+      if (xfer_out[i]) libusb_cancel_transfer(xfer_out[i]);
+      if (xfer_in[i]) libusb_cancel_transfer(xfer_in[i]);
+    }
+    struct timeval tv = { 0, 100000 };
+    libusb_handle_events_timeout(NULL, &tv);
+    fprintf(stderr, "%s: run failed\n", name);
+    goto cleanup;
+  }
+
+  bench_status_t status;
+  if (get_status(dev, &status) || status.mode != BENCH_MODE_IDLE || status.xfer_done != count) {
+    fprintf(stderr, "%s: device did not complete the run\n", name);
+    goto cleanup;
+  }
+
+  report(&run, name, elapsed, &status);
+  ret = 0;
+
+cleanup:
+  for (uint32_t i = 0; i < nxfer; i++) {
+    if (xfer_out[i]) libusb_free_transfer(xfer_out[i]);
+    if (xfer_in[i]) {
+      free(xfer_in[i]->buffer);
+      libusb_free_transfer(xfer_in[i]);
+    }
+  }
+  free(run.t_submit);
+  free(run.t_done);
+  return ret;
+}
+
+//--------------------------------------------------------------------+
+// Main
+//--------------------------------------------------------------------+
+
+static void usage(char const* prog) {
+  printf("Usage: %s [options]\n"
+         "  -m MODE   sink, source, loopback, latency or all (default)\n"
+         "  -s SIZE   bytes per transfer (default: device maximum)\n"
+         "  -q DEPTH  transfers in flight per endpoint (default: device maximum)\n"
+         "  -n COUNT  transfers per run (default: 16 MB worth, 1000 for latency)\n"
+         "  -d VID:PID  (default %04x:%04x)\n", prog, BENCH_VID, BENCH_PID);
+}
+
+int main(int argc, char* argv[]) {
+  char const* mode = "all";
+  uint32_t xfer_size = 0;
+  uint32_t depth = 0;
+  uint32_t count = 0;
+  unsigned vid = BENCH_VID, pid = BENCH_PID;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "m:s:q:n:d:h")) != -1) {
+    switch (opt) {
+      case 'm': mode = optarg; break;
+      case 's': xfer_size = (uint32_t) strtoul(optarg, NULL, 0); break;
+      case 'q': depth = (uint32_t) strtoul(optarg, NULL, 0); break;
+      case 'n': count = (uint32_t) strtoul(optarg, NULL, 0); break;
+      case 'd':
+        if (sscanf(optarg, "%x:%x", &vid, &pid) != 2) { usage(argv[0]); return 1; }
+        break;
+      default: usage(argv[0]); return opt != 'h';
+    }
+  }
+
+  if (libusb_init(NULL)) return 1;
+
+  bench_dev_t dev = { 0 };
+  if (open_device(&dev, (uint16_t) vid, (uint16_t) pid)) return 1;
+
+  bench_status_t const* info = &dev.info;
+  if (!xfer_size) xfer_size = info->max_xfer_size;
+  if (!depth) depth = info->max_queue_depth;
+
+  if (xfer_size > info->max_xfer_size || depth < 1 || depth > info->max_queue_depth) {
+    fprintf(stderr, "Device supports up to %u bytes per transfer and %u transfers in flight\n",
+            info->max_xfer_size, info->max_queue_depth);
+    return 1;
+  }
+
+  uint32_t const tput_count = count ? count : (16u * 1024 * 1024 + xfer_size - 1) / xfer_size;
+  uint32_t const lat_count = count ? count : 1000;
+
+  pattern = malloc(xfer_size > info->ep_size ? xfer_size : info->ep_size);
+  for (uint32_t i = 0; i < xfer_size || i < info->ep_size; i++) pattern[i] = BENCH_PATTERN(i);
+
+  printf("Endpoint size %u, device buffers %u x %u bytes\n\n", info->ep_size, info->max_queue_depth,
+         info->max_xfer_size);
+  printf("%-9s %7s %5s %7s %9s %9s %9s %9s %9s\n", "mode", "size", "depth", "count", "MB/s", "p50 us", "p90 us",
+         "p99 us", "max us");
+
+  bool const all = !strcmp(mode, "all");
+  int rc = 0;
+  bool matched = false;
+
+  static uint8_t const tput_modes[] = { BENCH_MODE_SINK, BENCH_MODE_SOURCE, BENCH_MODE_LOOPBACK };
+  for (size_t i = 0; i < sizeof(tput_modes); i++) {
+    char const* name = mode_str(tput_modes[i]);
+    if (all || !strcmp(mode, name)) {
+      matched = true;
+      rc |= bench_run(&dev, name, tput_modes[i], xfer_size, (uint8_t) depth, tput_count);
+    }
+  }
+
+  // round trip of a single packet with nothing else in flight
+  if (all || !strcmp(mode, "latency")) {
+    matched = true;
+    rc |= bench_run(&dev, "latency", BENCH_MODE_LOOPBACK, info->ep_size, 1, lat_count);
+  }
+
+  if (!matched) usage(argv[0]);
+
+  free(pattern);
+  libusb_release_interface(dev.handle, 0);
+  libusb_close(dev.handle);
+  libusb_exit(NULL);
+
+  return (rc || !matched) ? 1 : 0;
+}
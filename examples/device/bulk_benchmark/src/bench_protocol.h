@@ -0,0 +1,75 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef BENCH_PROTOCOL_H_
+#define BENCH_PROTOCOL_H_
+
+#include <stdint.h>
+
+// Shared by the firmware and the host tool (host/bulk_benchmark.c), therefore must not depend on tinyusb.
+// All multi-byte fields are little endian.
+
+#define BENCH_VID   0xCafe
+#define BENCH_PID   0x4010
+
+// Vendor requests, bmRequestType: vendor, recipient device
+enum {
+  BENCH_REQ_START  = 1, // OUT, data stage is bench_config_t. Stalled while a run is in progress
+  BENCH_REQ_STATUS = 2, // IN , data stage is bench_status_t
+};
+
+enum {
+  BENCH_MODE_IDLE = 0,
+  BENCH_MODE_SINK,     // host -> device, data is discarded
+  BENCH_MODE_SOURCE,   // device -> host, buffers hold a fixed pattern
+  BENCH_MODE_LOOPBACK, // each OUT transfer is echoed back as an IN transfer of the same length
+};
+
+// A run is a fixed number of transfers so that both sides finish with no transfer left pending
+typedef struct {
+  uint8_t  mode;
+  uint8_t  queue_depth; // transfers kept in flight per endpoint, 1 to bench_status_t.max_queue_depth
+  uint16_t reserved;
+  uint32_t xfer_size;   // bytes per transfer, 1 to bench_status_t.max_xfer_size
+  uint32_t xfer_count;  // transfers in the run (per direction for loopback)
+} bench_config_t;
+
+typedef struct {
+  uint8_t  mode;            // mode of the current run, back to BENCH_MODE_IDLE once it completes
+  uint8_t  max_queue_depth;
+  uint16_t ep_size;
+  uint32_t max_xfer_size;
+  uint32_t xfer_done;       // transfers completed in the current/last run
+  uint32_t bytes_out;
+  uint32_t bytes_in;
+  uint32_t duration_ms;     // first transfer submitted to last one completed, device clock
+  uint32_t errors;          // transfers completed with a failure result
+  uint32_t reserved;
+} bench_status_t;
+
+// Pattern of source buffers and of host loopback data
+#define BENCH_PATTERN(i)   ((uint8_t) ((i) * 7 + 1))
+
+#endif /* BENCH_PROTOCOL_H_ */
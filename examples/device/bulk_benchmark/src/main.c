@@ -0,0 +1,326 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Bulk throughput benchmark with a vendor interface, driven by the host tool in the 'host' folder.
+ *
+ * Host configures a run with BENCH_REQ_START (see bench_protocol.h): mode (sink, source or loopback), transfer size,
+ * number of transfers and queue depth i.e how many transfers the device keeps submitted on each endpoint. Both sides
+ * perform exactly that number of transfers, after which the device goes back to idle and reports its own counters
+ * and duration with BENCH_REQ_STATUS.
+ *
+ * Transfers use vendor direct mode: buffers below are handed to the controller without any copy, and up to
+ * CFG_EXAMPLE_BENCH_QUEUE_DEPTH of them are queued per endpoint so that the endpoint never idles between transfers.
+ * What is measured is therefore the DCD and the stack, not the application.
+ *
+ * - On Linux/macOS, udev permission may need to be updated by
+ *   - copying '/examples/device/99-tinyusb.rules' file to /etc/udev/rules.d/ then
+ *   - run 'sudo udevadm control --reload-rules && sudo udevadm trigger'
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bsp/board_api.h"
+#include "tusb.h"
+#include "usb_descriptors.h"
+#include "bench_protocol.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+
+/* Blink pattern
+ * - 250 ms  : device not mounted
+ * - 1000 ms : device mounted
+ * - 2500 ms : device is suspended
+ * - always on : benchmark is running
+ */
+enum  {
+  BLINK_NOT_MOUNTED = 250,
+  BLINK_MOUNTED     = 1000,
+  BLINK_SUSPENDED   = 2500,
+
+  BLINK_ALWAYS_ON   = UINT32_MAX,
+  BLINK_ALWAYS_OFF  = 0
+};
+
+static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
+
+TU_VERIFY_STATIC(sizeof(bench_config_t) == 12, "bench_config_t size");
+TU_VERIFY_STATIC(sizeof(bench_status_t) == 32, "bench_status_t size");
+TU_VERIFY_STATIC(CFG_EXAMPLE_BENCH_QUEUE_DEPTH >= 1 && CFG_EXAMPLE_BENCH_QUEUE_DEPTH <= 255, "queue depth");
+
+#define BUF_COUNT   CFG_EXAMPLE_BENCH_QUEUE_DEPTH
+#define BUF_SIZE    CFG_EXAMPLE_BENCH_XFER_SIZE
+
+// Transfer buffers, controller may DMA directly into them
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t bench_buf[BUF_COUNT][BUF_SIZE];
+
+// Control transfer data stage
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN static bench_config_t bench_cfg_req;
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN static bench_status_t bench_status;
+
+static bench_config_t bench_cfg;
+
+// Transfers of the run, an endpoint completes them in submission order: the buffer of the n-th completed transfer
+// is therefore bench_buf[n % queue_depth]
+static struct {
+  uint32_t out_submitted;
+  uint32_t in_submitted;
+  uint32_t out_done;
+  uint32_t in_done;
+  uint32_t start_ms;
+} bench;
+
+//------------- prototypes -------------//
+void led_blinking_task(void);
+
+/*------------- MAIN -------------*/
+int main(void)
+{
+  board_init();
+
+  // init device stack on configured roothub port
+  tud_init(BOARD_TUD_RHPORT);
+
+  if (board_init_after_tusb) {
+    board_init_after_tusb();
+  }
+
+  while (1)
+  {
+    tud_task(); // tinyusb device task
+    led_blinking_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// Benchmark
+//--------------------------------------------------------------------+
+
+static void bench_stop(void)
+{
+  bench_status.mode = BENCH_MODE_IDLE;
+  blink_interval_ms = tud_mounted() ? BLINK_MOUNTED : BLINK_NOT_MOUNTED;
+}
+
+static void bench_finish(void)
+{
+  bench_status.duration_ms = board_millis() - bench.start_ms;
+  bench_stop();
+}
+
+static bool bench_submit_out(uint8_t idx)
+{
+  bench.out_submitted++;
+  return tud_vendor_xfer_out(bench_buf[idx], bench_cfg.xfer_size);
+}
+
+static bool bench_submit_in(uint8_t idx, uint32_t len)
+{
+  bench.in_submitted++;
+  return tud_vendor_xfer_in(bench_buf[idx], len);
+}
+
+// Validate the requested run and start it by filling the endpoint queue(s)
+static bool bench_start(void)
+{
+  bench_config_t const* cfg = &bench_cfg_req;
+
+  TU_VERIFY(cfg->mode == BENCH_MODE_SINK || cfg->mode == BENCH_MODE_SOURCE || cfg->mode == BENCH_MODE_LOOPBACK);
+  TU_VERIFY(cfg->queue_depth >= 1 && cfg->queue_depth <= BUF_COUNT);
+  TU_VERIFY(cfg->xfer_size >= 1 && cfg->xfer_size <= BUF_SIZE);
+  TU_VERIFY(cfg->xfer_count >= 1);
+
+  bench_cfg = *cfg;
+  tu_memclr(&bench, sizeof(bench));
+
+  bench_status.mode        = bench_cfg.mode;
+  bench_status.xfer_done   = 0;
+  bench_status.bytes_out   = 0;
+  bench_status.bytes_in    = 0;
+  bench_status.duration_ms = 0;
+  bench_status.errors      = 0;
+
+  blink_interval_ms = BLINK_ALWAYS_ON;
+  board_led_write(true);
+
+  if (bench_cfg.mode == BENCH_MODE_SOURCE) {
+    for (uint8_t i = 0; i < bench_cfg.queue_depth; i++) {
+      for (uint32_t j = 0; j < bench_cfg.xfer_size; j++) bench_buf[i][j] = BENCH_PATTERN(j);
+    }
+  }
+
+  bench.start_ms = board_millis();
+
+  uint32_t const count = tu_min32(bench_cfg.queue_depth, bench_cfg.xfer_count);
+  for (uint8_t i = 0; i < count; i++) {
+    if (bench_cfg.mode == BENCH_MODE_SOURCE) {
+      TU_ASSERT(bench_submit_in(i, bench_cfg.xfer_size));
+    } else {
+      TU_ASSERT(bench_submit_out(i));
+    }
+  }
+
+  return true;
+}
+
+void tud_vendor_xfer_cb(uint8_t itf, uint8_t dir, xfer_result_t result, uint32_t xferred_bytes)
+{
+  (void) itf;
+
+  if (bench_status.mode == BENCH_MODE_IDLE) return;
+
+  if (result != XFER_RESULT_SUCCESS) bench_status.errors++;
+
+  if (dir == TUSB_DIR_OUT) {
+    uint8_t const idx = (uint8_t) (bench.out_done % bench_cfg.queue_depth);
+    bench.out_done++;
+    bench_status.bytes_out += xferred_bytes;
+
+    if (bench_cfg.mode == BENCH_MODE_LOOPBACK) {
+      // echo back what was received, buffer is re-armed for OUT once the echo completes
+      bench_submit_in(idx, xferred_bytes);
+    } else {
+      bench_status.xfer_done = bench.out_done;
+      if (bench.out_submitted < bench_cfg.xfer_count) {
+        bench_submit_out(idx);
+      } else if (bench.out_done == bench_cfg.xfer_count) {
+        bench_finish();
+      }
+    }
+  } else {
+    uint8_t const idx = (uint8_t) (bench.in_done % bench_cfg.queue_depth);
+    bench.in_done++;
+    bench_status.bytes_in += xferred_bytes;
+    bench_status.xfer_done = bench.in_done;
+
+    if (bench_cfg.mode == BENCH_MODE_LOOPBACK) {
+      if (bench.out_submitted < bench_cfg.xfer_count) bench_submit_out(idx);
+    } else if (bench.in_submitted < bench_cfg.xfer_count) {
+      bench_submit_in(idx, bench_cfg.xfer_size);
+    }
+
+    if (bench.in_done == bench_cfg.xfer_count) bench_finish();
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when device is mounted
+void tud_mount_cb(void)
+{
+  blink_interval_ms = BLINK_MOUNTED;
+}
+
+// Invoked when device is unmounted
+void tud_umount_cb(void)
+{
+  // bus reset or detach discards transfers in flight
+  bench_stop();
+  blink_interval_ms = BLINK_NOT_MOUNTED;
+}
+
+// Invoked when usb bus is suspended
+// remote_wakeup_en : if host allow us  to perform remote wakeup
+// Within 7ms, device must draw an average of current less than 2.5 mA from bus
+void tud_suspend_cb(bool remote_wakeup_en)
+{
+  (void) remote_wakeup_en;
+  blink_interval_ms = BLINK_SUSPENDED;
+}
+
+// Invoked when usb bus is resumed
+void tud_resume_cb(void)
+{
+  blink_interval_ms = tud_mounted() ? BLINK_MOUNTED : BLINK_NOT_MOUNTED;
+}
+
+// Invoked when a control transfer occurred on an interface of this class
+// Driver response accordingly to the request and the transfer stage (setup/data/ack)
+// return false to stall control endpoint (e.g unsupported request)
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  if (request->bmRequestType_bit.type != TUSB_REQ_TYPE_VENDOR) return false;
+
+  switch (request->bRequest)
+  {
+    case BENCH_REQ_START:
+      if (stage == CONTROL_STAGE_SETUP) {
+        // one run at a time
+        TU_VERIFY(bench_status.mode == BENCH_MODE_IDLE && request->wLength == sizeof(bench_config_t));
+        return tud_control_xfer(rhport, request, &bench_cfg_req, sizeof(bench_config_t));
+      }
+
+      // configuration is received in data stage
+      if (stage == CONTROL_STAGE_DATA) return bench_start();
+      return true;
+
+    case BENCH_REQ_STATUS:
+      if (stage != CONTROL_STAGE_SETUP) return true;
+
+      bench_status.max_queue_depth = BUF_COUNT;
+      bench_status.ep_size         = CFG_TUD_VENDOR_EPSIZE;
+      bench_status.max_xfer_size   = BUF_SIZE;
+      return tud_control_xfer(rhport, request, &bench_status, tu_min16(request->wLength, (uint16_t) sizeof(bench_status_t)));
+
+    case VENDOR_REQUEST_MICROSOFT:
+      if (stage != CONTROL_STAGE_SETUP) return true;
+
+      if ( request->wIndex == 7 )
+      {
+        // Get Microsoft OS 2.0 compatible descriptor
+        uint16_t total_len;
+        memcpy(&total_len, desc_ms_os_20+8, 2);
+
+        return tud_control_xfer(rhport, request, (void*)(uintptr_t) desc_ms_os_20, total_len);
+      }
+      return false;
+
+    default: break;
+  }
+
+  // stall unknown request
+  return false;
+}
+
+//--------------------------------------------------------------------+
+// BLINKING TASK
+//--------------------------------------------------------------------+
+void led_blinking_task(void)
+{
+  static uint32_t start_ms = 0;
+  static bool led_state = false;
+
+  // Blink every interval ms
+  if ( board_millis() - start_ms < blink_interval_ms) return; // not enough time
+  start_ms += blink_interval_ms;
+
+  board_led_write(led_state);
+  led_state = 1 - led_state; // toggle
+}
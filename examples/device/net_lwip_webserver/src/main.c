@@ -99,12 +99,22 @@ static err_t linkoutput_fn(struct netif *netif, struct pbuf *p)
     if (!tud_ready())
       return ERR_USE;
 
+#if CFG_TUD_NCM
+    /* write the frame straight into the NTB being filled by the NCM driver */
+    uint8_t *dst = tud_network_xmit_reserve(p->tot_len);
+    if (dst)
+    {
+      tud_network_xmit_commit(pbuf_copy_partial(p, dst, p->tot_len, 0));
+      return ERR_OK;
+    }
+#else
     /* if the network driver can accept another packet, we make it happen */
     if (tud_network_can_xmit(p->tot_len))
     {
       tud_network_xmit(p, 0 /* unused for this example */);
       return ERR_OK;
     }
+#endif
 
     /* transfer execution to TinyUSB in the hopes that it will finish transmitting the prior packet */
     tud_task();
@@ -130,6 +130,10 @@ enum {
 
 #define USE_ISO_STREAMING (!CFG_TUD_VIDEO_STREAMING_BULK)
 
+// Number of ISO alternate settings, packet size of alt n is n/UVC_ISO_ALT_COUNT of the EP buffer.
+// Host picks the smallest one covering the negotiated dwMaxPayloadTransferSize.
+#define UVC_ISO_ALT_COUNT 3
+
 typedef struct TU_ATTR_PACKED {
   tusb_desc_interface_t itf;
   tusb_desc_video_control_header_1itf_t header;
@@ -156,10 +160,13 @@ typedef struct TU_ATTR_PACKED {
 
 #if USE_ISO_STREAMING
   // For ISO streaming, USB spec requires to alternate interface
-  tusb_desc_interface_t itf_alt;
-#endif
-
+  struct TU_ATTR_PACKED {
+    tusb_desc_interface_t itf;
+    tusb_desc_endpoint_t ep;
+  } iso_alt[UVC_ISO_ALT_COUNT];
+#else
   tusb_desc_endpoint_t ep;
+#endif
 } uvc_streaming_desc_t;
 
 typedef struct TU_ATTR_PACKED {
@@ -169,6 +176,28 @@ typedef struct TU_ATTR_PACKED {
   uvc_streaming_desc_t video_streaming;
 } uvc_cfg_desc_t;
 
+#define UVC_ISO_ALT_DESC(_alt) { \
+    .itf = { \
+        .bLength = sizeof(tusb_desc_interface_t), \
+        .bDescriptorType = TUSB_DESC_INTERFACE, \
+        .bInterfaceNumber = ITF_NUM_VIDEO_STREAMING, \
+        .bAlternateSetting = _alt, \
+        .bNumEndpoints = 1, \
+        .bInterfaceClass = TUSB_CLASS_VIDEO, \
+        .bInterfaceSubClass = VIDEO_SUBCLASS_STREAMING, \
+        .bInterfaceProtocol = VIDEO_ITF_PROTOCOL_15, \
+        .iInterface = STRID_UVC_STREAMING \
+    }, \
+    .ep = { \
+        .bLength = sizeof(tusb_desc_endpoint_t), \
+        .bDescriptorType = TUSB_DESC_ENDPOINT, \
+        .bEndpointAddress = EPNUM_VIDEO_IN, \
+        .bmAttributes = { .xfer = TUSB_XFER_ISOCHRONOUS, .sync = 1 /* asynchronous */ }, \
+        .wMaxPacketSize = (_alt) * CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE / UVC_ISO_ALT_COUNT, \
+        .bInterval = 1 \
+    } \
+  }
+
 const uvc_cfg_desc_t desc_fs_configuration = {
     .config = {
         .bLength = sizeof(tusb_desc_configuration_t),
@@ -334,32 +363,25 @@ const uvc_cfg_desc_t desc_fs_configuration = {
         },
 
 #if USE_ISO_STREAMING
-        .itf_alt = {
-            .bLength = sizeof(tusb_desc_interface_t),
-            .bDescriptorType = TUSB_DESC_INTERFACE,
-
-            .bInterfaceNumber = ITF_NUM_VIDEO_STREAMING,
-            .bAlternateSetting = 1,
-            .bNumEndpoints = 1,
-            .bInterfaceClass = TUSB_CLASS_VIDEO,
-            .bInterfaceSubClass = VIDEO_SUBCLASS_STREAMING,
-            .bInterfaceProtocol = VIDEO_ITF_PROTOCOL_15,
-            .iInterface = STRID_UVC_STREAMING
-        },
-#endif
-
+        .iso_alt = {
+            UVC_ISO_ALT_DESC(1),
+            UVC_ISO_ALT_DESC(2),
+            UVC_ISO_ALT_DESC(3)
+        }
+#else
         .ep = {
             .bLength = sizeof(tusb_desc_endpoint_t),
             .bDescriptorType = TUSB_DESC_ENDPOINT,
 
             .bEndpointAddress = EPNUM_VIDEO_IN,
             .bmAttributes = {
-                .xfer = CFG_TUD_VIDEO_STREAMING_BULK ? TUSB_XFER_BULK : TUSB_XFER_ISOCHRONOUS,
-                .sync = CFG_TUD_VIDEO_STREAMING_BULK ? 0 : 1 // asynchronous
+                .xfer = TUSB_XFER_BULK,
+                .sync = 0
             },
-            .wMaxPacketSize = CFG_TUD_VIDEO_STREAMING_BULK ? 64 : CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE,
+            .wMaxPacketSize = 64,
             .bInterval = 1
         }
+#endif
     }
 };
 
@@ -372,9 +394,9 @@ static uint8_t * get_hs_configuration_desc(void) {
   if (!init) {
     desc_hs_configuration = desc_fs_configuration;
     // change endpoint bulk size to 512 if bulk streaming
-    if (CFG_TUD_VIDEO_STREAMING_BULK) {
-      desc_hs_configuration.video_streaming.ep.wMaxPacketSize = 512;
-    }
+#if !USE_ISO_STREAMING
+    desc_hs_configuration.video_streaming.ep.wMaxPacketSize = 512;
+#endif
   }
   init = true;
 
@@ -105,6 +105,9 @@
 // video streaming endpoint buffer size
 #define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  256
 
+// both streams share one endpoint buffer, payloads are interleaved by frame interval
+#define CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED 1
+
 // use bulk endpoint for streaming interface
 #define CFG_TUD_VIDEO_STREAMING_BULK 1
 
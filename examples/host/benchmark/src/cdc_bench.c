@@ -0,0 +1,204 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb.h"
+#include "bsp/board_api.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+// Echo benchmark of the first mounted CDC interface, the device must send back everything it receives.
+// - latency: CFG_EXAMPLE_BENCH_CDC_ROUNDS round trips of a short message, one at a time
+// - throughput: CFG_EXAMPLE_BENCH_CDC_BYTES streamed while the echo is read back and verified
+
+#define CDC_LATENCY_LEN   16
+#define CDC_TIMEOUT_MS    2000
+
+// echoed data is checked against its offset in the stream
+#define CDC_PATTERN(i)    ((uint8_t) ((i) * 7 + 1))
+
+enum {
+  CDC_BENCH_IDLE = 0,
+  CDC_BENCH_PENDING, // mounted, waiting for its turn
+  CDC_BENCH_LATENCY,
+  CDC_BENCH_THROUGHPUT,
+};
+
+static struct {
+  uint8_t  idx;
+  uint8_t  state;
+  uint32_t round;       // latency round trips done
+  uint32_t sent;        // bytes written in current round trip or stream
+  uint32_t received;    // bytes echoed back
+  uint32_t mismatch;
+  uint32_t start_ms;    // start of current round trip or stream
+  uint32_t rx_ms;       // last time data was received, to detect a device that does not echo
+
+  uint32_t lat_min;
+  uint32_t lat_max;
+  uint32_t lat_total;
+} cdc_bench;
+
+//--------------------------------------------------------------------+
+// Benchmark
+//--------------------------------------------------------------------+
+
+static void cdc_bench_abort(char const* reason) {
+  printf("CDC benchmark aborted: %s\r\n", reason);
+  cdc_bench.state = CDC_BENCH_IDLE;
+}
+
+static uint32_t cdc_send(uint32_t total) {
+  uint8_t buf[64];
+  uint32_t count = tu_min32(total - cdc_bench.sent, sizeof(buf));
+  count = tu_min32(count, tuh_cdc_write_available(cdc_bench.idx));
+
+  for (uint32_t i = 0; i < count; i++) buf[i] = CDC_PATTERN(cdc_bench.sent + i);
+
+  count = tuh_cdc_write(cdc_bench.idx, buf, count);
+  tuh_cdc_write_flush(cdc_bench.idx);
+  cdc_bench.sent += count;
+
+  return count;
+}
+
+static void cdc_receive(void) {
+  uint8_t buf[64];
+  uint32_t const count = tuh_cdc_read(cdc_bench.idx, buf, sizeof(buf));
+
+  if (count) {
+    for (uint32_t i = 0; i < count; i++) {
+      if (buf[i] != CDC_PATTERN(cdc_bench.received + i)) cdc_bench.mismatch++;
+    }
+    cdc_bench.received += count;
+    cdc_bench.rx_ms = board_millis();
+  }
+}
+
+static void start_round(void) {
+  cdc_bench.sent = 0;
+  cdc_bench.received = 0;
+  cdc_bench.start_ms = cdc_bench.rx_ms = board_millis();
+}
+
+static void print_summary(uint32_t stream_ms) {
+  tuh_itf_info_t itf_info = {0};
+  tuh_cdc_itf_get_info(cdc_bench.idx, &itf_info);
+
+  // average in us from the ms total, individual round trips are only ms resolution
+  uint32_t const lat_avg_us = (uint32_t) ((uint64_t) cdc_bench.lat_total * 1000 / CFG_EXAMPLE_BENCH_CDC_ROUNDS);
+  uint32_t const stream_ms_min = tu_max32(1, stream_ms);
+
+  printf("\r\nCDC device %u interface %u echo\r\n", itf_info.daddr, itf_info.desc.bInterfaceNumber);
+  printf("  latency   : %u bytes x %u, min %" PRIu32 " ms, avg %" PRIu32 " us, max %" PRIu32 " ms\r\n",
+         CDC_LATENCY_LEN, CFG_EXAMPLE_BENCH_CDC_ROUNDS, cdc_bench.lat_min, lat_avg_us, cdc_bench.lat_max);
+  printf("  throughput: %u bytes in %" PRIu32 " ms, %" PRIu32 " KB/s each way", CFG_EXAMPLE_BENCH_CDC_BYTES,
+         stream_ms, (uint32_t) CFG_EXAMPLE_BENCH_CDC_BYTES / stream_ms_min);
+  if (cdc_bench.mismatch) printf(", %" PRIu32 " bytes mismatch", cdc_bench.mismatch);
+  printf("\r\n");
+}
+
+bool cdc_bench_busy(void) {
+  return cdc_bench.state > CDC_BENCH_PENDING;
+}
+
+void cdc_bench_task(void) {
+  switch (cdc_bench.state) {
+    case CDC_BENCH_PENDING:
+      printf("CDC benchmark on interface %u started\r\n", cdc_bench.idx);
+      tuh_cdc_read_clear(cdc_bench.idx);
+
+      cdc_bench.round = 0;
+      cdc_bench.mismatch = 0;
+      cdc_bench.lat_min = UINT32_MAX;
+      cdc_bench.lat_max = 0;
+      cdc_bench.lat_total = 0;
+      cdc_bench.state = CDC_BENCH_LATENCY;
+      start_round();
+      break;
+
+    case CDC_BENCH_LATENCY:
+      if (cdc_bench.sent < CDC_LATENCY_LEN) {
+        cdc_send(CDC_LATENCY_LEN);
+        if (cdc_bench.sent == CDC_LATENCY_LEN) cdc_bench.start_ms = board_millis();
+        break;
+      }
+
+      cdc_receive();
+      if (cdc_bench.received >= CDC_LATENCY_LEN) {
+        uint32_t const lat = board_millis() - cdc_bench.start_ms;
+        cdc_bench.lat_min = tu_min32(cdc_bench.lat_min, lat);
+        cdc_bench.lat_max = tu_max32(cdc_bench.lat_max, lat);
+        cdc_bench.lat_total += lat;
+
+        if (++cdc_bench.round == CFG_EXAMPLE_BENCH_CDC_ROUNDS) {
+          cdc_bench.state = CDC_BENCH_THROUGHPUT;
+        }
+        start_round();
+      }
+      break;
+
+    case CDC_BENCH_THROUGHPUT:
+      // keep the TX FIFO full while draining the echo
+      if (cdc_bench.sent < CFG_EXAMPLE_BENCH_CDC_BYTES) cdc_send(CFG_EXAMPLE_BENCH_CDC_BYTES);
+      cdc_receive();
+
+      if (cdc_bench.received >= CFG_EXAMPLE_BENCH_CDC_BYTES) {
+        print_summary(board_millis() - cdc_bench.start_ms);
+        cdc_bench.state = CDC_BENCH_IDLE;
+      }
+      break;
+
+    default: return;
+  }
+
+  if (cdc_bench_busy() && board_millis() - cdc_bench.rx_ms > CDC_TIMEOUT_MS) {
+    cdc_bench_abort("no echo from device");
+  }
+}
+
+//--------------------------------------------------------------------+
+// TinyUSB callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when a device with CDC interface is mounted
+// idx is index of cdc interface in the internal pool.
+void tuh_cdc_mount_cb(uint8_t idx) {
+  if (cdc_bench.state != CDC_BENCH_IDLE) {
+    printf("CDC interface %u ignored, benchmark already in progress\r\n", idx);
+    return;
+  }
+
+  cdc_bench.idx = idx;
+  cdc_bench.state = CDC_BENCH_PENDING;
+}
+
+// Invoked when a device with CDC interface is unmounted
+void tuh_cdc_umount_cb(uint8_t idx) {
+  if (idx == cdc_bench.idx && cdc_bench.state != CDC_BENCH_IDLE) {
+    cdc_bench_abort("device unmounted");
+  }
+}
@@ -0,0 +1,144 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Host stack benchmark, to compare host controller drivers and catch regressions on the host side.
+ *
+ * - Enumeration time of every device, from its attach event to tuh_mount_cb()
+ * - MSC: raw READ10/WRITE10 throughput for block counts 1, 2, 4 ... up to CFG_EXAMPLE_BENCH_MSC_BUFSIZE
+ * - CDC: echo round-trip latency and echo throughput, the device must send back everything it receives
+ *   e.g the device/cdc_msc example, which covers both MSC and CDC with a single device.
+ *
+ * Benchmarks run one at a time and print their results on the console once done.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bsp/board_api.h"
+#include "tusb.h"
+#include "host/hcd.h" // HCD_EVENT_* ids of tuh_event_hook_cb()
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTYPES
+//--------------------------------------------------------------------+
+void led_blinking_task(void);
+
+extern void msc_bench_task(void);
+extern bool msc_bench_busy(void);
+extern void cdc_bench_task(void);
+extern bool cdc_bench_busy(void);
+
+#if CFG_TUH_ENABLED && CFG_TUH_MAX3421
+// API to read/rite MAX3421's register. Implemented by TinyUSB
+extern uint8_t tuh_max3421_reg_read(uint8_t rhport, uint8_t reg, bool in_isr);
+extern bool tuh_max3421_reg_write(uint8_t rhport, uint8_t reg, uint8_t data, bool in_isr);
+#endif
+
+// Time the device being enumerated was attached. Deferred attach events are re-queued until the previous
+// enumeration completes, therefore only the first one seen while idle is taken.
+static volatile uint32_t attach_ms;
+static volatile bool attach_pending = false;
+
+/*------------- MAIN -------------*/
+int main(void) {
+  board_init();
+
+  printf("TinyUSB Host Benchmark Example\r\n");
+
+  // init host stack on configured roothub port
+  tuh_init(BOARD_TUH_RHPORT);
+
+  if (board_init_after_tusb) {
+    board_init_after_tusb();
+  }
+
+#if CFG_TUH_ENABLED && CFG_TUH_MAX3421
+  // FeatherWing MAX3421E use MAX3421E's GPIO0 for VBUS enable
+  enum { IOPINS1_ADDR  = 20u << 3, /* 0xA0 */ };
+  tuh_max3421_reg_write(BOARD_TUH_RHPORT, IOPINS1_ADDR, 0x01, false);
+#endif
+
+  while (1) {
+    // tinyusb host task
+    tuh_task();
+
+    led_blinking_task();
+
+    // one benchmark at a time, MSC first
+    if (!cdc_bench_busy()) msc_bench_task();
+    if (!msc_bench_busy()) cdc_bench_task();
+  }
+}
+
+//--------------------------------------------------------------------+
+// TinyUSB Callbacks
+//--------------------------------------------------------------------+
+
+// Invoked when an event is queued, may be in ISR
+void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr) {
+  (void) rhport;
+  (void) in_isr;
+
+  if (eventid == HCD_EVENT_DEVICE_ATTACH && !attach_pending) {
+    attach_ms = board_millis();
+    attach_pending = true;
+  } else if (eventid == HCD_EVENT_DEVICE_REMOVE) {
+    // device may be removed before its enumeration completes
+    attach_pending = false;
+  }
+}
+
+void tuh_mount_cb(uint8_t dev_addr) {
+  uint16_t vid, pid;
+  tuh_vid_pid_get(dev_addr, &vid, &pid);
+
+  uint32_t const enum_ms = board_millis() - attach_ms;
+  attach_pending = false;
+
+  // includes the attach debounce and port reset delays, see TUH_CFGID_ENUM_TIMING
+  printf("Device %u (%04x:%04x) enumerated in %" PRIu32 " ms\r\n", dev_addr, vid, pid, enum_ms);
+}
+
+void tuh_umount_cb(uint8_t dev_addr) {
+  printf("Device %u is unmounted\r\n", dev_addr);
+}
+
+//--------------------------------------------------------------------+
+// Blinking Task
+//--------------------------------------------------------------------+
+void led_blinking_task(void) {
+  const uint32_t interval_ms = 1000;
+  static uint32_t start_ms = 0;
+
+  static bool led_state = false;
+
+  // Blink every interval ms
+  if (board_millis() - start_ms < interval_ms) return; // not enough time
+  start_ms += interval_ms;
+
+  board_led_write(led_state);
+  led_state = 1 - led_state; // toggle
+}
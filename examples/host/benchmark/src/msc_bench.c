@@ -0,0 +1,230 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb.h"
+#include "bsp/board_api.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+// READ10/WRITE10 throughput of LUN 0 for 1, 2, 4 ... blocks per command. Each step transfers about
+// CFG_EXAMPLE_BENCH_MSC_BYTES: reads walk sequentially through the disk, writes rewrite the first blocks with the
+// content read from them just before, so that the disk is left unchanged.
+
+#define MSC_BENCH_STEP_MAX  16 // 1 to 32768 blocks, READ10/WRITE10 block count is 16-bit
+
+enum {
+  MSC_BENCH_IDLE = 0,
+  MSC_BENCH_PENDING, // mounted, waiting for its turn
+  MSC_BENCH_READ,
+  MSC_BENCH_WRITE_PREP,
+  MSC_BENCH_WRITE,
+};
+
+CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN static uint8_t msc_buf[CFG_EXAMPLE_BENCH_MSC_BUFSIZE];
+
+static struct {
+  uint8_t  daddr;
+  uint8_t  state;
+  uint8_t  step;
+  uint8_t  step_count;
+  uint16_t block_count;  // blocks per command of current step
+  uint32_t block_size;
+  uint32_t disk_blocks;
+  uint32_t lba;
+  uint32_t cmd_left;     // commands left in current step
+  uint32_t start_ms;
+
+  uint32_t read_kbps[MSC_BENCH_STEP_MAX];
+  uint32_t write_kbps[MSC_BENCH_STEP_MAX];
+} msc_bench;
+
+static bool msc_bench_next(void);
+
+//--------------------------------------------------------------------+
+// Benchmark
+//--------------------------------------------------------------------+
+
+static uint32_t cmd_per_step(void) {
+  uint32_t const cmd_bytes = msc_bench.block_count * msc_bench.block_size;
+  return tu_max32(1, CFG_EXAMPLE_BENCH_MSC_BYTES / cmd_bytes);
+}
+
+// bytes per ms is KB/s (1 KB = 1000 bytes)
+static uint32_t step_kbps(void) {
+  uint32_t const ms = tu_max32(1, board_millis() - msc_bench.start_ms);
+  uint64_t const bytes = (uint64_t) cmd_per_step() * msc_bench.block_count * msc_bench.block_size;
+  return (uint32_t) (bytes / ms);
+}
+
+static void print_summary(void) {
+  printf("\r\nMSC device %u: %" PRIu32 " blocks of %" PRIu32 " bytes\r\n", msc_bench.daddr, msc_bench.disk_blocks,
+         msc_bench.block_size);
+  printf("  blocks  read KB/s  write KB/s\r\n");
+  for (uint8_t i = 0; i < msc_bench.step_count; i++) {
+    printf("  %6u  %9" PRIu32, 1u << i, msc_bench.read_kbps[i]);
+    if (CFG_EXAMPLE_BENCH_MSC_WRITE) {
+      printf("  %10" PRIu32 "\r\n", msc_bench.write_kbps[i]);
+    } else {
+      printf("  %10s\r\n", "-");
+    }
+  }
+}
+
+static void msc_bench_abort(char const* reason) {
+  printf("MSC benchmark aborted: %s\r\n", reason);
+  msc_bench.state = MSC_BENCH_IDLE;
+}
+
+static bool msc_bench_complete_cb(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data) {
+  (void) dev_addr;
+
+  if (msc_bench.state == MSC_BENCH_IDLE) return true; // aborted
+
+  if (cb_data->csw->status != MSC_CSW_STATUS_PASSED) {
+    msc_bench_abort("command failed");
+    return false;
+  }
+
+  switch (msc_bench.state) {
+    case MSC_BENCH_READ:
+      msc_bench.lba += msc_bench.block_count;
+      if (--msc_bench.cmd_left == 0) {
+        msc_bench.read_kbps[msc_bench.step] = step_kbps();
+        msc_bench.state = CFG_EXAMPLE_BENCH_MSC_WRITE ? MSC_BENCH_WRITE_PREP : MSC_BENCH_READ;
+        if (!CFG_EXAMPLE_BENCH_MSC_WRITE) msc_bench.step++;
+      }
+      break;
+
+    case MSC_BENCH_WRITE_PREP:
+      // buffer holds the current content of the blocks to write
+      msc_bench.state = MSC_BENCH_WRITE;
+      break;
+
+    case MSC_BENCH_WRITE:
+      if (--msc_bench.cmd_left == 0) {
+        msc_bench.write_kbps[msc_bench.step] = step_kbps();
+        msc_bench.state = MSC_BENCH_READ;
+        msc_bench.step++;
+      }
+      break;
+
+    default: break;
+  }
+
+  // issue next command right away, so that the time between commands is only the stack's own
+  if (!msc_bench_next()) msc_bench_abort("failed to queue command");
+  return true;
+}
+
+// Set up the step if it has not started yet, then issue its next command
+static bool msc_bench_next(void) {
+  if (msc_bench.step == msc_bench.step_count) {
+    print_summary();
+    msc_bench.state = MSC_BENCH_IDLE;
+    return true;
+  }
+
+  msc_bench.block_count = (uint16_t) (1u << msc_bench.step);
+  uint8_t const daddr = msc_bench.daddr;
+
+  switch (msc_bench.state) {
+    case MSC_BENCH_READ:
+      if (msc_bench.cmd_left == 0) {
+        msc_bench.cmd_left = cmd_per_step();
+        msc_bench.start_ms = board_millis();
+      }
+      if (msc_bench.lba + msc_bench.block_count > msc_bench.disk_blocks) msc_bench.lba = 0;
+      return tuh_msc_read10(daddr, 0, msc_buf, msc_bench.lba, msc_bench.block_count, msc_bench_complete_cb, 0);
+
+    case MSC_BENCH_WRITE_PREP:
+      return tuh_msc_read10(daddr, 0, msc_buf, 0, msc_bench.block_count, msc_bench_complete_cb, 0);
+
+    case MSC_BENCH_WRITE:
+      if (msc_bench.cmd_left == 0) {
+        msc_bench.cmd_left = cmd_per_step();
+        msc_bench.start_ms = board_millis();
+      }
+      return tuh_msc_write10(daddr, 0, msc_buf, 0, msc_bench.block_count, msc_bench_complete_cb, 0);
+
+    default: return false;
+  }
+}
+
+bool msc_bench_busy(void) {
+  return msc_bench.state > MSC_BENCH_PENDING;
+}
+
+void msc_bench_task(void) {
+  if (msc_bench.state != MSC_BENCH_PENDING) return;
+
+  uint8_t const daddr = msc_bench.daddr;
+  if (!tuh_msc_ready(daddr)) return;
+
+  msc_bench.block_size = tuh_msc_get_block_size(daddr, 0);
+  msc_bench.disk_blocks = tuh_msc_get_block_count(daddr, 0);
+  if (msc_bench.block_size == 0 || msc_bench.disk_blocks == 0) {
+    msc_bench_abort("no medium");
+    return;
+  }
+
+  // block counts that fit in both the buffer and the disk
+  uint32_t const max_blocks = tu_min32(CFG_EXAMPLE_BENCH_MSC_BUFSIZE / msc_bench.block_size, msc_bench.disk_blocks);
+  msc_bench.step_count = 0;
+  while (msc_bench.step_count < MSC_BENCH_STEP_MAX && (1u << msc_bench.step_count) <= max_blocks) {
+    msc_bench.step_count++;
+  }
+  if (msc_bench.step_count == 0) {
+    msc_bench_abort("block size larger than buffer");
+    return;
+  }
+
+  printf("MSC benchmark on device %u started\r\n", daddr);
+  msc_bench.step = 0;
+  msc_bench.lba = 0;
+  msc_bench.cmd_left = 0;
+  msc_bench.state = MSC_BENCH_READ;
+  if (!msc_bench_next()) msc_bench_abort("failed to queue command");
+}
+
+//--------------------------------------------------------------------+
+// TinyUSB Callbacks
+//--------------------------------------------------------------------+
+void tuh_msc_mount_cb(uint8_t dev_addr) {
+  if (msc_bench.state != MSC_BENCH_IDLE) {
+    printf("MSC device %u ignored, benchmark already in progress\r\n", dev_addr);
+    return;
+  }
+
+  msc_bench.daddr = dev_addr;
+  msc_bench.state = MSC_BENCH_PENDING;
+}
+
+void tuh_msc_umount_cb(uint8_t dev_addr) {
+  if (dev_addr == msc_bench.daddr && msc_bench.state != MSC_BENCH_IDLE) {
+    msc_bench_abort("device unmounted");
+  }
+}
@@ -52,6 +52,32 @@ static CLI_UINT cli_buffer[BYTES_TO_CLI_UINTS(CLI_BUFFER_SIZE)];
 //------------- Elm Chan FatFS -------------//
 static FATFS fatfs[CFG_TUH_DEVICE_MAX]; // for simplicity only support 1 LUN per device
 static volatile bool _disk_busy[CFG_TUH_DEVICE_MAX];
+static volatile bool _disk_ok[CFG_TUH_DEVICE_MAX]; // status of last SCSI command
+
+//------------- Block layer -------------//
+// Each drive has a buffer that either holds sectors read ahead of FatFs or merges its adjacent sector writes, so that
+// small sector requests (e.g file copy with 512 bytes chunk) become fewer and larger READ10/WRITE10
+#ifndef DISK_BUF_SIZE
+#define DISK_BUF_SIZE   (8*1024)
+#endif
+
+// Max bytes of a single READ10/WRITE10
+#define DISK_MAX_XFER   (32*1024)
+
+enum {
+  DISK_BUF_EMPTY = 0,
+  DISK_BUF_READ,  // sectors read ahead
+  DISK_BUF_WRITE, // sectors not yet written to device
+};
+
+typedef struct {
+  uint8_t  state;
+  uint32_t lba;   // first sector in buffer
+  uint32_t count; // number of sectors in buffer
+  CFG_TUH_MEM_ALIGN uint8_t buf[DISK_BUF_SIZE];
+} disk_buf_t;
+
+static disk_buf_t _disk_buf[CFG_TUH_DEVICE_MAX];
 
 static scsi_inquiry_resp_t inquiry_resp;
 
@@ -144,6 +170,8 @@ void tuh_msc_mount_cb(uint8_t dev_addr)
 {
   printf("A MassStorage device is mounted\r\n");
 
+  _disk_buf[dev_addr-1].state = DISK_BUF_EMPTY;
+
   uint8_t const lun = 0;
   tuh_msc_inquiry(dev_addr, lun, &inquiry_resp, inquiry_complete_cb, 0);
 }
@@ -158,6 +186,9 @@ void tuh_msc_umount_cb(uint8_t dev_addr)
 
   f_unmount(drive_path);
 
+  // device is gone, pending writes if any are lost
+  _disk_buf[drive_num].state = DISK_BUF_EMPTY;
+
 //  if ( phy_disk == f_get_current_drive() )
 //  { // active drive is unplugged --> change to other drive
 //    for(uint8_t i=0; i<CFG_TUH_DEVICE_MAX; i++)
@@ -185,11 +216,58 @@ static void wait_for_disk_io(BYTE pdrv)
 
 static bool disk_io_complete(uint8_t dev_addr, tuh_msc_complete_data_t const * cb_data)
 {
-  (void) dev_addr; (void) cb_data;
+  _disk_ok[dev_addr-1] = (cb_data->csw->status == MSC_CSW_STATUS_PASSED);
   _disk_busy[dev_addr-1] = false;
   return true;
 }
 
+// blocking READ10/WRITE10, split into transfers of up to DISK_MAX_XFER
+static bool disk_transfer(BYTE pdrv, bool is_write, BYTE* buff, uint32_t sector, uint32_t count)
+{
+  uint8_t const dev_addr = pdrv + 1;
+  uint8_t const lun = 0;
+  uint32_t const block_size = tuh_msc_get_block_size(dev_addr, lun);
+  uint32_t const max_count = (block_size < DISK_MAX_XFER) ? (DISK_MAX_XFER / block_size) : 1;
+
+  while (count)
+  {
+    uint16_t const n = (uint16_t) ((count < max_count) ? count : max_count);
+
+    _disk_busy[pdrv] = true;
+    bool const queued = is_write ? tuh_msc_write10(dev_addr, lun, buff, sector, n, disk_io_complete, 0) :
+                                   tuh_msc_read10 (dev_addr, lun, buff, sector, n, disk_io_complete, 0);
+    if (!queued)
+    {
+      _disk_busy[pdrv] = false;
+      return false;
+    }
+
+    wait_for_disk_io(pdrv);
+    if (!_disk_ok[pdrv]) return false;
+
+    buff   += n * block_size;
+    sector += n;
+    count  -= n;
+  }
+
+  return true;
+}
+
+// write merged sectors to device
+static bool disk_flush(BYTE pdrv)
+{
+  disk_buf_t* db = &_disk_buf[pdrv];
+  if (db->state != DISK_BUF_WRITE) return true;
+
+  db->state = DISK_BUF_EMPTY;
+  return disk_transfer(pdrv, true, db->buf, db->lba, db->count);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool disk_buf_overlap(disk_buf_t const* db, uint32_t sector, uint32_t count)
+{
+  return (db->state != DISK_BUF_EMPTY) && (sector < db->lba + db->count) && (db->lba < sector + count);
+}
+
 DSTATUS disk_status (
 	BYTE pdrv		/* Physical drive nmuber to identify the drive */
 )
@@ -215,10 +293,47 @@ DRESULT disk_read (
 {
 	uint8_t const dev_addr = pdrv + 1;
 	uint8_t const lun = 0;
-
-	_disk_busy[pdrv] = true;
-	tuh_msc_read10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
+	uint32_t const block_size = tuh_msc_get_block_size(dev_addr, lun);
+	uint32_t const block_count = tuh_msc_get_block_count(dev_addr, lun);
+	disk_buf_t* db = &_disk_buf[pdrv];
+
+	if ( block_size == 0 ) return RES_NOTRDY;
+	if ( sector + count > block_count ) return RES_PARERR;
+	uint32_t const buf_sectors = DISK_BUF_SIZE / block_size;
+
+	// pending writes must reach device before reading them back
+	if ( db->state == DISK_BUF_WRITE && disk_buf_overlap(db, sector, count) )
+	{
+		if ( !disk_flush(pdrv) ) return RES_ERROR;
+	}
+
+	while ( count )
+	{
+		// served from read-ahead data
+		if ( db->state == DISK_BUF_READ && sector >= db->lba && sector < db->lba + db->count )
+		{
+			uint32_t const n = tu_min32(count, db->lba + db->count - sector);
+			memcpy(buff, db->buf + (sector - db->lba) * block_size, n * block_size);
+
+			buff   += n * block_size;
+			sector += n;
+			count  -= n;
+			continue;
+		}
+
+		// large request or buffer holds pending writes: read directly into FatFs buffer
+		if ( count >= buf_sectors || db->state == DISK_BUF_WRITE )
+		{
+			return disk_transfer(pdrv, false, buff, sector, count) ? RES_OK : RES_ERROR;
+		}
+
+		// read ahead a whole buffer starting from requested sector
+		db->state = DISK_BUF_EMPTY;
+		db->lba   = sector;
+		db->count = tu_min32(buf_sectors, block_count - sector);
+		if ( !disk_transfer(pdrv, false, db->buf, db->lba, db->count) ) return RES_ERROR;
+		db->state = DISK_BUF_READ;
+	}
 
 	return RES_OK;
 }
@@ -234,12 +349,37 @@ DRESULT disk_write (
 {
 	uint8_t const dev_addr = pdrv + 1;
 	uint8_t const lun = 0;
-
-	_disk_busy[pdrv] = true;
-	tuh_msc_write10(dev_addr, lun, buff, sector, (uint16_t) count, disk_io_complete, 0);
-	wait_for_disk_io(pdrv);
-
-	return RES_OK;
+	uint32_t const block_size = tuh_msc_get_block_size(dev_addr, lun);
+	disk_buf_t* db = &_disk_buf[pdrv];
+
+	if ( block_size == 0 ) return RES_NOTRDY;
+	uint32_t const buf_sectors = DISK_BUF_SIZE / block_size;
+
+	// read-ahead data is stale
+	if ( db->state == DISK_BUF_READ && disk_buf_overlap(db, sector, count) ) db->state = DISK_BUF_EMPTY;
+
+	// merge with pending writes if sectors are adjacent or overlapped
+	if ( db->state == DISK_BUF_WRITE && sector >= db->lba && sector <= db->lba + db->count &&
+	     sector + count - db->lba <= buf_sectors )
+	{
+		memcpy(db->buf + (sector - db->lba) * block_size, buff, count * block_size);
+		db->count = tu_max32(db->count, sector + count - db->lba);
+		return RES_OK;
+	}
+
+	if ( !disk_flush(pdrv) ) return RES_ERROR;
+
+	if ( count < buf_sectors )
+	{
+		// keep sectors in buffer, written later on next non-adjacent write, read of them or CTRL_SYNC
+		memcpy(db->buf, buff, count * block_size);
+		db->state = DISK_BUF_WRITE;
+		db->lba   = sector;
+		db->count = count;
+		return RES_OK;
+	}
+
+	return disk_transfer(pdrv, true, (BYTE*) (uintptr_t) buff, sector, count) ? RES_OK : RES_ERROR;
 }
 
 #endif
@@ -255,11 +395,11 @@ DRESULT disk_ioctl (
   switch ( cmd )
   {
     case CTRL_SYNC:
-      // nothing to do since we do blocking
-      return RES_OK;
+      // write merged sectors, others are done since we do blocking
+      return disk_flush(pdrv) ? RES_OK : RES_ERROR;
 
     case GET_SECTOR_COUNT:
-      *((DWORD*) buff) = (WORD) tuh_msc_get_block_count(dev_addr, lun);
+      *((DWORD*) buff) = (DWORD) tuh_msc_get_block_count(dev_addr, lun);
       return RES_OK;
 
     case GET_SECTOR_SIZE:
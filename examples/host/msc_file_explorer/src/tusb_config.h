@@ -112,6 +112,7 @@
 
 //------------- MSC -------------//
 #define CFG_TUH_MSC_MAXLUN    4 // typical for most card reader
+#define CFG_TUH_MSC_UAS       1 // use USB Attached SCSI if device supports it
 
 #ifdef __cplusplus
  }
@@ -82,7 +82,24 @@ void trace_etm_init(void) {
   #define trace_etm_init()
 #endif
 
+#ifdef CFG_TUSB_FAST_FUNC_SECTION
+// copy usb hot path from flash to ITCM, see .itcm_text in linker script
+static void itcm_init(void) {
+  extern uint32_t _siitcm, _sitcm, _eitcm;
+  uint32_t const* src = &_siitcm;
+  for (uint32_t* dst = &_sitcm; dst < &_eitcm;) {
+    *dst++ = *src++;
+  }
+  __DSB();
+  __ISB();
+}
+#else
+  #define itcm_init()
+#endif
+
 void board_init(void) {
+  itcm_init();
+
   // Implemented in board.h
   SystemClock_Config();
 
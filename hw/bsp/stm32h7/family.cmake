@@ -59,6 +59,11 @@ function(add_board_target BOARD_TARGET)
   #target_compile_options(${BOARD_TARGET} PUBLIC)
   #target_compile_definitions(${BOARD_TARGET} PUBLIC)
 
+  # Place usb interrupt hot path in ITCM, requires .itcm_text in linker script (linker/*.ld)
+  if (FAST_FUNC_ITCM AND NOT CMAKE_C_COMPILER_ID STREQUAL "IAR")
+    target_compile_definitions(${BOARD_TARGET} PUBLIC "CFG_TUSB_FAST_FUNC_SECTION=\".itcm_text\"")
+  endif ()
+
   update_board(${BOARD_TARGET})
 
   if (CMAKE_C_COMPILER_ID STREQUAL "GNU")
@@ -106,6 +111,7 @@ function(family_configure_example TARGET RTOS)
   family_add_tinyusb(${TARGET} OPT_MCU_STM32H7 ${RTOS})
   target_sources(${TARGET}-tinyusb PUBLIC
     ${TOP}/src/portable/synopsys/dwc2/dcd_dwc2.c
+    ${TOP}/src/portable/synopsys/dwc2/hcd_dwc2.c
     )
   target_link_libraries(${TARGET}-tinyusb PUBLIC board_${BOARD})
 
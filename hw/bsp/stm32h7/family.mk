@@ -27,6 +27,11 @@ else
   $(info "Using OTG_FS")
 endif
 
+# Place usb interrupt hot path in ITCM, requires .itcm_text in linker script (linker/*.ld)
+ifeq ($(FAST_FUNC_ITCM), 1)
+  CFLAGS_GCC += -DCFG_TUSB_FAST_FUNC_SECTION=\".itcm_text\"
+endif
+
 # GCC Flags
 CFLAGS_GCC += \
   -flto \
@@ -46,6 +51,7 @@ LDFLAGS_GCC += \
 
 SRC_C += \
 	src/portable/synopsys/dwc2/dcd_dwc2.c \
+	src/portable/synopsys/dwc2/hcd_dwc2.c \
 	$(ST_CMSIS)/Source/Templates/system_stm32$(ST_FAMILY)xx.c \
 	$(ST_HAL_DRIVER)/Src/stm32$(ST_FAMILY)xx_hal.c \
 	$(ST_HAL_DRIVER)/Src/stm32$(ST_FAMILY)xx_hal_cortex.c \
@@ -104,6 +104,7 @@ function(family_configure_example TARGET RTOS)
   family_add_tinyusb(${TARGET} OPT_MCU_STM32U5 ${RTOS})
   target_sources(${TARGET}-tinyusb PUBLIC
     ${TOP}/src/portable/synopsys/dwc2/dcd_dwc2.c
+    ${TOP}/src/portable/synopsys/dwc2/hcd_dwc2.c
     #${TOP}/src/portable/st/typec/typec_stm32.c
     )
   target_link_libraries(${TARGET}-tinyusb PUBLIC board_${BOARD})
@@ -253,9 +253,9 @@ void rndis_class_set_handler(uint8_t *data, int size)
         m->Status = RNDIS_STATUS_SUCCESS;
         m->DeviceFlags = RNDIS_DF_CONNECTIONLESS;
         m->Medium = RNDIS_MEDIUM_802_3;
-        m->MaxPacketsPerTransfer = 1;
-        m->MaxTransferSize = CFG_TUD_NET_MTU + sizeof(rndis_data_packet_t);
-        m->PacketAlignmentFactor = 0;
+        m->MaxPacketsPerTransfer = CFG_TUD_NET_RNDIS_MAX_PACKETS;
+        m->MaxTransferSize = TUD_NET_RNDIS_XFER_SIZE;
+        m->PacketAlignmentFactor = (CFG_TUD_NET_RNDIS_MAX_PACKETS > 1) ? 2 : 0; /* 4-byte aligned messages */
         m->AfListOffset = 0;
         m->AfListSize = 0;
         rndis_state = rndis_initialized;
@@ -0,0 +1,436 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "vfat.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+enum {
+  DIR_ENTRY_SIZE    = 32,
+  ROOT_DIR_SECTORS  = (CFG_VFAT_ROOT_ENTRIES * DIR_ENTRY_SIZE + VFAT_BLOCK_SIZE - 1) / VFAT_BLOCK_SIZE,
+  RESERVED_SECTORS  = 1, // boot sector
+  FAT_START         = RESERVED_SECTORS,
+  FAT12_CLUSTER_MAX = 4084,
+  FAT16_CLUSTER_MAX = 65524,
+};
+
+enum {
+  ATTR_READ_ONLY    = 0x01,
+  ATTR_VOLUME_LABEL = 0x08,
+  ATTR_ARCHIVE      = 0x20,
+};
+
+// Timestamp of all entries: 2026-01-01 00:00:00
+#define VFAT_DATE  (((2026 - 1980) << 9) | (1 << 5) | 1)
+#define VFAT_TIME  0
+
+// Volume is synthesized from the file table, only its layout is kept
+typedef struct {
+  vfat_volume_t const* vol;
+  uint32_t cluster_count;
+  uint32_t root_start;
+  uint32_t data_start;
+  uint16_t fat_sectors;
+  uint8_t  cluster_sectors;
+  bool     fat12;
+} vfat_layout_t;
+
+static vfat_layout_t _vfat;
+
+#if CFG_VFAT_WRITE_BUFFER
+// aligned so that a buffered UF2 block can be accessed as vfat_uf2_block_t
+static union {
+  uint32_t align;
+  uint8_t  buf[VFAT_BLOCK_SIZE];
+} _vfat_wbuf;
+#endif
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+static inline uint32_t min32(uint32_t x, uint32_t y) {
+  return (x < y) ? x : y;
+}
+
+static inline void put_u16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t) value;
+  p[1] = (uint8_t) (value >> 8);
+}
+
+static inline void put_u32(uint8_t* p, uint32_t value) {
+  put_u16(p, (uint16_t) value);
+  put_u16(p + 2, (uint16_t) (value >> 16));
+}
+
+static inline uint32_t get_u32(uint8_t const* p) {
+  return p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// copy a string padded with spaces
+static void copy_padded(uint8_t* dst, char const* src, uint8_t len) {
+  memset(dst, ' ', len);
+  for (uint8_t i = 0; i < len && src && src[i]; i++) {
+    dst[i] = (uint8_t) src[i];
+  }
+}
+
+static inline uint32_t cluster_bytes(void) {
+  return (uint32_t) _vfat.cluster_sectors * VFAT_BLOCK_SIZE;
+}
+
+static inline uint32_t file_clusters(vfat_file_t const* file) {
+  return (file->size + cluster_bytes() - 1) / cluster_bytes();
+}
+
+// Find file that occupies cluster, return its first cluster or 0 if cluster is free
+static vfat_file_t const* find_file(uint32_t cluster, uint32_t* first_cluster) {
+  uint32_t start = 2;
+  for (uint16_t i = 0; i < _vfat.vol->file_count; i++) {
+    vfat_file_t const* file = &_vfat.vol->files[i];
+    uint32_t const count = file_clusters(file);
+    if (cluster >= start && cluster < start + count) {
+      *first_cluster = start;
+      return file;
+    }
+    start += count;
+  }
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// Volume generation, each sector is produced in 32-byte chunks
+//--------------------------------------------------------------------+
+static void boot_chunk(uint8_t idx, uint8_t chunk[DIR_ENTRY_SIZE]) {
+  memset(chunk, 0, DIR_ENTRY_SIZE);
+
+  if (idx < 2) {
+    uint8_t bs[2 * DIR_ENTRY_SIZE];
+    uint32_t const block_count = _vfat.vol->block_count;
+    memset(bs, 0, sizeof(bs));
+
+    bs[0] = 0xEB; bs[1] = 0x3C; bs[2] = 0x90; // jump instruction
+    memcpy(bs + 3, "TinyUSB ", 8);
+    put_u16(bs + 11, VFAT_BLOCK_SIZE);
+    bs[13] = _vfat.cluster_sectors;
+    put_u16(bs + 14, RESERVED_SECTORS);
+    bs[16] = 1; // number of FATs
+    put_u16(bs + 17, CFG_VFAT_ROOT_ENTRIES);
+    put_u16(bs + 19, (uint16_t) (block_count < 0x10000 ? block_count : 0));
+    bs[21] = 0xF8; // media: fixed disk
+    put_u16(bs + 22, _vfat.fat_sectors);
+    put_u16(bs + 24, 1); // sectors per track
+    put_u16(bs + 26, 1); // number of heads
+    put_u32(bs + 32, block_count < 0x10000 ? 0 : block_count);
+    bs[36] = 0x80; // drive number
+    bs[38] = 0x29; // extended boot signature
+    put_u32(bs + 39, 0x1234ABCDUL); // volume serial
+    copy_padded(bs + 43, _vfat.vol->label, 11);
+    memcpy(bs + 54, _vfat.fat12 ? "FAT12   " : "FAT16   ", 8);
+
+    memcpy(chunk, bs + idx * DIR_ENTRY_SIZE, DIR_ENTRY_SIZE);
+  } else if (idx == VFAT_BLOCK_SIZE / DIR_ENTRY_SIZE - 1) {
+    chunk[30] = 0x55;
+    chunk[31] = 0xAA;
+  }
+}
+
+static uint16_t fat_entry(uint32_t cluster) {
+  uint16_t const eoc = _vfat.fat12 ? 0x0FFF : 0xFFFF;
+
+  if (cluster == 0) {
+    return eoc & 0xFFF8; // media descriptor
+  }
+  if (cluster == 1) {
+    return eoc;
+  }
+
+  uint32_t first = 0;
+  vfat_file_t const* file = find_file(cluster, &first);
+  if (file == NULL) {
+    return 0; // free
+  }
+
+  // contiguous chain
+  return (cluster == first + file_clusters(file) - 1) ? eoc : (uint16_t) (cluster + 1);
+}
+
+// byte of the FAT at offset
+static uint8_t fat_byte(uint32_t offset) {
+  if (!_vfat.fat12) {
+    uint16_t const entry = fat_entry(offset / 2);
+    return (uint8_t) ((offset & 1) ? (entry >> 8) : entry);
+  }
+
+  // FAT12: two entries are packed into three bytes
+  uint32_t const cluster = (offset / 3) * 2;
+  switch (offset % 3) {
+    case 0:  return (uint8_t) fat_entry(cluster);
+    case 1:  return (uint8_t) (((fat_entry(cluster) >> 8) & 0x0F) | ((fat_entry(cluster + 1) & 0x0F) << 4));
+    default: return (uint8_t) (fat_entry(cluster + 1) >> 4);
+  }
+}
+
+static void fat_chunk(uint32_t fat_sector, uint8_t idx, uint8_t chunk[DIR_ENTRY_SIZE]) {
+  uint32_t const offset = fat_sector * VFAT_BLOCK_SIZE + (uint32_t) idx * DIR_ENTRY_SIZE;
+  for (uint8_t i = 0; i < DIR_ENTRY_SIZE; i++) {
+    chunk[i] = fat_byte(offset + i);
+  }
+}
+
+// convert "NAME.EXT" to 8.3 directory name
+static void dir_name(uint8_t name[11], char const* fname) {
+  memset(name, ' ', 11);
+  uint8_t pos = 0;
+  for (; *fname; fname++) {
+    char c = *fname;
+    if (c == '.') {
+      pos = 8;
+      continue;
+    }
+    if (c >= 'a' && c <= 'z') {
+      c = (char) (c - 'a' + 'A');
+    }
+    if (pos < 11) {
+      name[pos++] = (uint8_t) c;
+    }
+  }
+}
+
+static void dir_chunk(uint32_t entry, uint8_t chunk[DIR_ENTRY_SIZE]) {
+  memset(chunk, 0, DIR_ENTRY_SIZE);
+
+  if (entry == 0) {
+    copy_padded(chunk, _vfat.vol->label, 11);
+    chunk[11] = ATTR_VOLUME_LABEL;
+  } else if (entry <= _vfat.vol->file_count) {
+    uint32_t cluster = 2;
+    for (uint32_t i = 0; i < entry - 1; i++) {
+      cluster += file_clusters(&_vfat.vol->files[i]);
+    }
+
+    vfat_file_t const* file = &_vfat.vol->files[entry - 1];
+    dir_name(chunk, file->name);
+    chunk[11] = ATTR_READ_ONLY | ATTR_ARCHIVE;
+    put_u16(chunk + 14, VFAT_TIME);
+    put_u16(chunk + 16, VFAT_DATE);
+    put_u16(chunk + 18, VFAT_DATE);
+    put_u16(chunk + 26, (uint16_t) (file->size ? cluster : 0));
+    put_u32(chunk + 28, file->size);
+  } else {
+    return; // free entry
+  }
+
+  put_u16(chunk + 22, VFAT_TIME);
+  put_u16(chunk + 24, VFAT_DATE);
+}
+
+// Generate part of a boot, FAT or root directory sector
+static void read_system(uint32_t lba, uint32_t offset, uint8_t* buf, uint32_t count) {
+  uint32_t const end = offset + count;
+  while (offset < end) {
+    uint8_t chunk[DIR_ENTRY_SIZE];
+    uint8_t const idx = (uint8_t) (offset / DIR_ENTRY_SIZE);
+
+    if (lba < FAT_START) {
+      boot_chunk(idx, chunk);
+    } else if (lba < _vfat.root_start) {
+      fat_chunk(lba - FAT_START, idx, chunk);
+    } else {
+      dir_chunk((lba - _vfat.root_start) * (VFAT_BLOCK_SIZE / DIR_ENTRY_SIZE) + idx, chunk);
+    }
+
+    uint32_t const pos = offset % DIR_ENTRY_SIZE;
+    uint32_t const n = min32(DIR_ENTRY_SIZE - pos, end - offset);
+    memcpy(buf, chunk + pos, n);
+    buf += n;
+    offset += n;
+  }
+}
+
+// Stream part of a data sector from file contents
+static void read_data(uint32_t lba, uint32_t offset, uint8_t* buf, uint32_t count) {
+  uint32_t const sector = lba - _vfat.data_start;
+  uint32_t first = 0;
+  vfat_file_t const* file = find_file(sector / _vfat.cluster_sectors + 2, &first);
+
+  uint32_t n = 0;
+  if (file != NULL) {
+    uint32_t const file_offset = (sector - (first - 2) * _vfat.cluster_sectors) * VFAT_BLOCK_SIZE + offset;
+    n = (file_offset < file->size) ? min32(count, file->size - file_offset) : 0;
+
+    if (n) {
+      if (file->data) {
+        memcpy(buf, (uint8_t const*) file->data + file_offset, n);
+      } else if (file->read) {
+        file->read(file_offset, buf, n);
+      } else {
+        memset(buf, 0, n);
+      }
+    }
+  }
+
+  // slack of the last cluster or free space
+  memset(buf + n, 0, count - n);
+}
+
+//--------------------------------------------------------------------+
+// Write
+//--------------------------------------------------------------------+
+static bool is_uf2_block(uint8_t const* block) {
+  return get_u32(block + offsetof(vfat_uf2_block_t, magic_start0)) == VFAT_UF2_MAGIC_START0 &&
+         get_u32(block + offsetof(vfat_uf2_block_t, magic_start1)) == VFAT_UF2_MAGIC_START1 &&
+         get_u32(block + offsetof(vfat_uf2_block_t, magic_end)) == VFAT_UF2_MAGIC_END &&
+         get_u32(block + offsetof(vfat_uf2_block_t, payload_size)) <= VFAT_UF2_PAYLOAD_MAX;
+}
+
+static void block_written(uint32_t lba, uint8_t const* block) {
+  vfat_volume_t const* vol = _vfat.vol;
+
+  if (vol->uf2_write && is_uf2_block(block)) {
+    vfat_uf2_block_t const* uf2 = (vfat_uf2_block_t const*) (uintptr_t) block;
+    if (!(uf2->flags & VFAT_UF2_FLAG_NOT_MAIN_FLASH)) {
+      vol->uf2_write(uf2);
+    }
+  } else if (vol->write) {
+    vol->write(lba, block);
+  }
+}
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+bool vfat_init(vfat_volume_t const* vol) {
+  if (vol == NULL || vol->file_count >= CFG_VFAT_ROOT_ENTRIES) {
+    return false;
+  }
+  _vfat.vol = vol;
+
+  uint32_t const root_end = RESERVED_SECTORS + ROOT_DIR_SECTORS;
+  if (vol->block_count <= root_end + 2) {
+    return false;
+  }
+
+  // smallest cluster size that keeps cluster count within FAT16 limit
+  for (uint32_t spc = 1; spc <= 128; spc *= 2) {
+    // estimate with all sectors except FAT, which can only overestimate the cluster count
+    uint32_t const estimate = (vol->block_count - root_end) / spc;
+    bool const fat12 = estimate <= FAT12_CLUSTER_MAX;
+    uint32_t const fat_bytes = fat12 ? ((estimate + 2) * 3 + 1) / 2 : (estimate + 2) * 2;
+    uint32_t const fat_sectors = (fat_bytes + VFAT_BLOCK_SIZE - 1) / VFAT_BLOCK_SIZE;
+
+    if (vol->block_count <= root_end + fat_sectors) {
+      return false;
+    }
+
+    uint32_t const clusters = (vol->block_count - root_end - fat_sectors) / spc;
+    if (clusters > FAT16_CLUSTER_MAX) {
+      continue;
+    }
+
+    _vfat.cluster_sectors = (uint8_t) spc;
+    _vfat.fat_sectors     = (uint16_t) fat_sectors;
+    _vfat.cluster_count   = clusters;
+    _vfat.fat12           = clusters <= FAT12_CLUSTER_MAX; // type is determined by cluster count only
+    _vfat.root_start      = FAT_START + fat_sectors;
+    _vfat.data_start      = _vfat.root_start + ROOT_DIR_SECTORS;
+
+    // files must fit
+    uint32_t used = 0;
+    for (uint16_t i = 0; i < vol->file_count; i++) {
+      used += file_clusters(&vol->files[i]);
+    }
+    return used <= clusters;
+  }
+
+  return false;
+}
+
+uint32_t vfat_block_count(void) {
+  return _vfat.vol ? _vfat.vol->block_count : 0;
+}
+
+int32_t vfat_read(uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  uint8_t* buf = (uint8_t*) buffer;
+  uint32_t remain = bufsize;
+
+  while (remain) {
+    if (_vfat.vol == NULL || lba >= _vfat.vol->block_count || offset >= VFAT_BLOCK_SIZE) {
+      return -1;
+    }
+
+    uint32_t const count = min32(remain, VFAT_BLOCK_SIZE - offset);
+    if (lba < _vfat.data_start) {
+      read_system(lba, offset, buf, count);
+    } else {
+      read_data(lba, offset, buf, count);
+    }
+
+    buf += count;
+    remain -= count;
+    lba++;
+    offset = 0;
+  }
+
+  return (int32_t) bufsize;
+}
+
+int32_t vfat_write(uint32_t lba, uint32_t offset, uint8_t const* buffer, uint32_t bufsize) {
+  uint32_t remain = bufsize;
+
+  while (remain) {
+    if (_vfat.vol == NULL || lba >= _vfat.vol->block_count || offset >= VFAT_BLOCK_SIZE) {
+      return -1;
+    }
+
+    uint32_t const count = min32(remain, VFAT_BLOCK_SIZE - offset);
+
+    // boot sector, FAT and directory writes are discarded
+    if (lba >= _vfat.data_start) {
+      if (offset == 0 && count == VFAT_BLOCK_SIZE) {
+        block_written(lba, buffer);
+      } else {
+        #if CFG_VFAT_WRITE_BUFFER
+        memcpy(_vfat_wbuf.buf + offset, buffer, count);
+        if (offset + count == VFAT_BLOCK_SIZE) {
+          block_written(lba, _vfat_wbuf.buf);
+        }
+        #else
+        return -1;
+        #endif
+      }
+    }
+
+    buffer += count;
+    remain -= count;
+    lba++;
+    offset = 0;
+  }
+
+  return (int32_t) bufsize;
+}
@@ -0,0 +1,142 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _VFAT_H_
+#define _VFAT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// Virtual FAT volume: boot sector, FAT and root directory are generated on the fly for each requested block
+// from a constant file table, file contents are streamed from memory or a read callback. Nothing of the
+// volume is kept in RAM, which allows to expose a multi-megabyte drive with a few bytes of state.
+// Files are laid out contiguously in the order of the table, FAT12 or FAT16 is chosen by volume size.
+//
+// Usage with the MSC device class:
+//   tud_msc_capacity_cb() : *block_count = vfat_block_count(); *block_size = VFAT_BLOCK_SIZE;
+//   tud_msc_read10_cb()   : return vfat_read(lba, offset, buffer, bufsize);
+//   tud_msc_write10_cb()  : return vfat_write(lba, offset, buffer, bufsize);
+//
+// Writes to boot sector, FAT and directory are accepted and discarded. Blocks written to the data area are
+// passed to the write callbacks, which is enough for self-describing formats such as UF2 where each block
+// carries its own target address regardless of where the host places the file.
+
+//--------------------------------------------------------------------+
+// Configuration
+//--------------------------------------------------------------------+
+
+// Number of root directory entries, including the volume label. Spare entries leave room for the host
+// to create files e.g when a UF2 file is dropped.
+#ifndef CFG_VFAT_ROOT_ENTRIES
+#define CFG_VFAT_ROOT_ENTRIES   64
+#endif
+
+// Buffer a partially written block until it is complete. Required if the MSC endpoint buffer
+// (CFG_TUD_MSC_EP_BUFSIZE) is smaller than a block, can be disabled otherwise to save RAM.
+#ifndef CFG_VFAT_WRITE_BUFFER
+#define CFG_VFAT_WRITE_BUFFER   1
+#endif
+
+#define VFAT_BLOCK_SIZE         512
+
+//--------------------------------------------------------------------+
+// UF2
+//--------------------------------------------------------------------+
+#define VFAT_UF2_MAGIC_START0   0x0A324655UL // "UF2\n"
+#define VFAT_UF2_MAGIC_START1   0x9E5D5157UL
+#define VFAT_UF2_MAGIC_END      0x0AB16F30UL
+#define VFAT_UF2_PAYLOAD_MAX    476
+
+enum {
+  VFAT_UF2_FLAG_NOT_MAIN_FLASH = 0x00000001UL,
+  VFAT_UF2_FLAG_FAMILY_ID      = 0x00002000UL,
+};
+
+typedef struct {
+  uint32_t magic_start0;
+  uint32_t magic_start1;
+  uint32_t flags;
+  uint32_t target_addr;
+  uint32_t payload_size;
+  uint32_t block_no;
+  uint32_t num_blocks;
+  uint32_t family_id;     // or file size if VFAT_UF2_FLAG_FAMILY_ID is not set
+  uint8_t  data[VFAT_UF2_PAYLOAD_MAX];
+  uint32_t magic_end;
+} vfat_uf2_block_t;
+
+//--------------------------------------------------------------------+
+// Volume
+//--------------------------------------------------------------------+
+
+typedef struct {
+  char const* name;   // 8.3 file name e.g "README.TXT"
+  uint32_t size;      // file size in bytes
+
+  // File contents in memory (or memory-mapped flash). If NULL, read callback is used.
+  void const* data;
+
+  // Read bufsize bytes of file contents starting at offset. Used when data is NULL, file reads as zeros
+  // if both are NULL.
+  void (*read)(uint32_t offset, void* buffer, uint32_t bufsize);
+} vfat_file_t;
+
+typedef struct {
+  char const* label;          // volume label, up to 11 characters
+  uint32_t block_count;       // volume size in blocks of VFAT_BLOCK_SIZE
+  vfat_file_t const* files;
+  uint16_t file_count;
+
+  // Invoked with each valid UF2 block written to the data area. Blocks with
+  // VFAT_UF2_FLAG_NOT_MAIN_FLASH are filtered out. Optional.
+  void (*uf2_write)(vfat_uf2_block_t const* block);
+
+  // Invoked with other blocks written to the data area. Optional.
+  void (*write)(uint32_t lba, uint8_t const* block);
+} vfat_volume_t;
+
+// Set up volume layout, the volume descriptor and file table must stay valid while in use.
+// Return false if the files do not fit into the volume.
+bool vfat_init(vfat_volume_t const* vol);
+
+// Number of blocks of the volume
+uint32_t vfat_block_count(void);
+
+// Read volume contents, same semantics as tud_msc_read10_cb(). Return number of bytes read or -1 on error.
+int32_t vfat_read(uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+
+// Write volume contents, same semantics as tud_msc_write10_cb(). Return number of bytes written or -1 on error.
+int32_t vfat_write(uint32_t lba, uint32_t offset, uint8_t const* buffer, uint32_t bufsize);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _VFAT_H_ */
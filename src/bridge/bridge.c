@@ -0,0 +1,451 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_BRIDGE && CFG_TUD_ENABLED && CFG_TUH_ENABLED
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+#include "host/usbh.h"
+
+#include "bridge.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+#define BUF_NONE  0xFFu
+
+TU_VERIFY_STATIC(CFG_TUSB_BRIDGE_BUFCOUNT < BUF_NONE, "too many bridge buffers");
+
+enum {
+  BUF_FREE = 0,
+  BUF_RX,     // receiving
+  BUF_QUEUED, // received, waiting to be sent
+  BUF_TX,     // sending
+};
+
+typedef struct {
+  uint8_t ch;
+  uint8_t state;
+  uint8_t next; // next buffer in channel's send queue
+  bool zlp;     // ZLP to send after data, to end transfer as it ended on receiving side
+  uint32_t len;
+} bridge_buf_t;
+
+typedef struct {
+  bool opened;
+  uint8_t daddr;
+  uint8_t ep_host;
+  uint8_t ep_dev;
+  uint8_t rhport;    // device stack
+  uint16_t mps_tx;   // packet size of the sending endpoint
+
+  uint8_t rx_buf;    // buffer being received, BUF_NONE if not armed
+  uint8_t tx_head;   // send queue, head is being sent if tx_busy
+  uint8_t tx_tail;
+  bool tx_busy;
+  uint8_t buf_count; // buffers owned: receiving, queued or sending, including ones in flight after close
+} bridge_channel_t;
+
+static bridge_channel_t _bridge_ch[CFG_TUSB_BRIDGE];
+static bridge_buf_t _bridge_buf[CFG_TUSB_BRIDGE_BUFCOUNT];
+
+CFG_TUSB_BRIDGE_MEM_SECTION CFG_TUSB_MEM_ALIGN
+static uint8_t _bridge_data[CFG_TUSB_BRIDGE_BUFCOUNT][CFG_TUSB_BRIDGE_BUFSIZE];
+
+// Device endpoints opened by claimed interfaces, 0 if not owned by bridge
+static struct {
+  uint8_t rhport;
+  uint16_t mps[CFG_TUD_ENDPPOINT_MAX][2];
+} _bridge_dev;
+
+static void host_xfer_cb(tuh_xfer_t* xfer);
+
+TU_ATTR_ALWAYS_INLINE static inline bool ch_is_in(bridge_channel_t const* p_ch) {
+  return tu_edpt_dir(p_ch->ep_host) == TUSB_DIR_IN;
+}
+
+//--------------------------------------------------------------------+
+// Buffer pool
+//--------------------------------------------------------------------+
+static uint8_t buf_alloc(uint8_t ch) {
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE_BUFCOUNT; i++) {
+    bridge_buf_t* buf = &_bridge_buf[i];
+    if (buf->state == BUF_FREE) {
+      buf->ch = ch;
+      buf->state = BUF_RX;
+      buf->next = BUF_NONE;
+      buf->zlp = false;
+      buf->len = 0;
+      _bridge_ch[ch].buf_count++;
+      return i;
+    }
+  }
+  return BUF_NONE;
+}
+
+static void buf_free(uint8_t idx) {
+  bridge_buf_t* buf = &_bridge_buf[idx];
+  _bridge_ch[buf->ch].buf_count--;
+  buf->state = BUF_FREE;
+}
+
+//--------------------------------------------------------------------+
+// Forwarding
+//--------------------------------------------------------------------+
+
+// Submit buffer to host or device side of channel
+static bool submit(bridge_channel_t* p_ch, bool host_side, uint8_t idx, uint32_t len) {
+  uint8_t* data = _bridge_data[idx];
+
+  if (host_side) {
+    tuh_xfer_t xfer = {
+      .daddr       = p_ch->daddr,
+      .ep_addr     = p_ch->ep_host,
+      .buflen      = len,
+      .buffer      = data,
+      .complete_cb = host_xfer_cb,
+      .user_data   = idx
+    };
+    return tuh_edpt_xfer(&xfer);
+  } else {
+    return usbd_edpt_xfer(p_ch->rhport, p_ch->ep_dev, data, len);
+  }
+}
+
+static void rx_arm(uint8_t ch) {
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  if (!p_ch->opened || p_ch->rx_buf != BUF_NONE || p_ch->buf_count >= CFG_TUSB_BRIDGE_DEPTH) return;
+
+  uint8_t const idx = buf_alloc(ch);
+  if (idx == BUF_NONE) return; // re-armed when another channel frees a buffer
+
+  // IN channel receives on host side
+  if (submit(p_ch, ch_is_in(p_ch), idx, CFG_TUSB_BRIDGE_BUFSIZE)) {
+    p_ch->rx_buf = idx;
+  } else {
+    buf_free(idx);
+  }
+}
+
+static void rx_arm_all(void) {
+  for (uint8_t ch = 0; ch < CFG_TUSB_BRIDGE; ch++) {
+    rx_arm(ch);
+  }
+}
+
+static void channel_stop(uint8_t ch, xfer_result_t result) {
+  tusb_bridge_close(ch);
+  if (tusb_bridge_close_cb) tusb_bridge_close_cb(ch, result);
+}
+
+static void tx_start(uint8_t ch) {
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  if (p_ch->tx_busy || p_ch->tx_head == BUF_NONE) return;
+
+  uint8_t const idx = p_ch->tx_head;
+  _bridge_buf[idx].state = BUF_TX;
+  p_ch->tx_busy = true;
+
+  // IN channel sends on device side
+  if (!submit(p_ch, !ch_is_in(p_ch), idx, _bridge_buf[idx].len)) {
+    buf_free(idx);
+    channel_stop(ch, XFER_RESULT_FAILED);
+  }
+}
+
+static void rx_complete(uint8_t ch, uint8_t idx, uint32_t xferred_bytes) {
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  bridge_buf_t* buf = &_bridge_buf[idx];
+  p_ch->rx_buf = BUF_NONE;
+
+  // transfer ended by short packet or ZLP rather than by filling the buffer
+  bool const short_end = (xferred_bytes < CFG_TUSB_BRIDGE_BUFSIZE);
+
+  buf->len = xferred_bytes;
+  bool forward = true;
+  if (tusb_bridge_forward_cb) {
+    forward = tusb_bridge_forward_cb(ch, _bridge_data[idx], &buf->len);
+    buf->len = tu_min32(buf->len, CFG_TUSB_BRIDGE_BUFSIZE);
+  }
+
+  if (forward) {
+    buf->zlp = short_end && buf->len && !(buf->len % p_ch->mps_tx);
+    buf->state = BUF_QUEUED;
+
+    if (p_ch->tx_head == BUF_NONE) {
+      p_ch->tx_head = idx;
+    } else {
+      _bridge_buf[p_ch->tx_tail].next = idx;
+    }
+    p_ch->tx_tail = idx;
+
+    tx_start(ch);
+  } else {
+    buf_free(idx);
+  }
+
+  rx_arm(ch);
+}
+
+static void tx_complete(uint8_t ch, uint8_t idx) {
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  bridge_buf_t* buf = &_bridge_buf[idx];
+
+  if (buf->zlp) {
+    buf->zlp = false;
+    if (!submit(p_ch, !ch_is_in(p_ch), idx, 0)) {
+      buf_free(idx);
+      channel_stop(ch, XFER_RESULT_FAILED);
+    }
+    return;
+  }
+
+  p_ch->tx_head = buf->next;
+  p_ch->tx_busy = false;
+  buf_free(idx);
+
+  tx_start(ch);
+  rx_arm_all(); // freed buffer may be waited by any channel
+}
+
+static void xfer_complete(uint8_t idx, bool host_side, xfer_result_t result, uint32_t xferred_bytes) {
+  bridge_buf_t* buf = &_bridge_buf[idx];
+  uint8_t const ch = buf->ch;
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+
+  // late completion of a closed channel
+  if (buf->state == BUF_FREE) return;
+  if (!p_ch->opened) {
+    buf_free(idx);
+    return;
+  }
+
+  if (result != XFER_RESULT_SUCCESS) {
+    buf_free(idx);
+    channel_stop(ch, result);
+    return;
+  }
+
+  bool const is_rx = (host_side == ch_is_in(p_ch));
+  if (is_rx) {
+    rx_complete(ch, idx, xferred_bytes);
+  } else {
+    tx_complete(ch, idx);
+  }
+}
+
+static void host_xfer_cb(tuh_xfer_t* xfer) {
+  xfer_complete((uint8_t) xfer->user_data, true, xfer->result, xfer->actual_len);
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tusb_bridge_open(uint8_t ch, uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, uint8_t ep_dev) {
+  TU_VERIFY(ch < CFG_TUSB_BRIDGE);
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  TU_VERIFY(!p_ch->opened && p_ch->buf_count == 0);
+
+  uint8_t const ep_host = desc_ep->bEndpointAddress;
+  TU_VERIFY(tu_edpt_dir(ep_host) == tu_edpt_dir(ep_dev));
+  TU_VERIFY(tu_edpt_number(ep_dev) < CFG_TUD_ENDPPOINT_MAX);
+
+  uint16_t const mps_dev = _bridge_dev.mps[tu_edpt_number(ep_dev)][tu_edpt_dir(ep_dev)];
+  TU_VERIFY(mps_dev);
+  TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+  p_ch->daddr = daddr;
+  p_ch->ep_host = ep_host;
+  p_ch->ep_dev = ep_dev;
+  p_ch->rhport = _bridge_dev.rhport;
+  p_ch->mps_tx = ch_is_in(p_ch) ? mps_dev : tu_edpt_packet_size(desc_ep);
+  p_ch->rx_buf = BUF_NONE;
+  p_ch->tx_head = p_ch->tx_tail = BUF_NONE;
+  p_ch->tx_busy = false;
+  p_ch->opened = true;
+
+  rx_arm(ch);
+
+  return true;
+}
+
+void tusb_bridge_close(uint8_t ch) {
+  TU_VERIFY(ch < CFG_TUSB_BRIDGE,);
+  bridge_channel_t* p_ch = &_bridge_ch[ch];
+  TU_VERIFY(p_ch->opened,);
+  p_ch->opened = false;
+
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE_BUFCOUNT; i++) {
+    bridge_buf_t* buf = &_bridge_buf[i];
+    if (buf->state == BUF_FREE || buf->ch != ch) continue;
+
+    if (buf->state == BUF_QUEUED) {
+      buf_free(i);
+    } else if (ch_is_in(p_ch) == (buf->state == BUF_RX)) {
+      // in flight on host side: reclaim if it can be aborted, otherwise freed on completion
+      if (tuh_edpt_abort_xfer(p_ch->daddr, p_ch->ep_host)) buf_free(i);
+    }
+    // in flight on device side: freed on completion or bus reset
+  }
+
+  rx_arm_all();
+}
+
+bool tusb_bridge_opened(uint8_t ch) {
+  TU_VERIFY(ch < CFG_TUSB_BRIDGE);
+  return _bridge_ch[ch].opened;
+}
+
+//--------------------------------------------------------------------+
+// Device Class Driver API
+//--------------------------------------------------------------------+
+void bridged_init(void) {
+  tu_memclr(_bridge_ch, sizeof(_bridge_ch));
+  tu_memclr(_bridge_buf, sizeof(_bridge_buf));
+  tu_memclr(&_bridge_dev, sizeof(_bridge_dev));
+}
+
+bool bridged_deinit(void) {
+  return true;
+}
+
+void bridged_reset(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(_bridge_dev.mps, sizeof(_bridge_dev.mps));
+
+  // device endpoints are closed: transfers in flight on device side are gone
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE_BUFCOUNT; i++) {
+    bridge_buf_t* buf = &_bridge_buf[i];
+    if (buf->state == BUF_FREE) continue;
+    bool const is_in = ch_is_in(&_bridge_ch[buf->ch]);
+    if ((buf->state == BUF_RX && !is_in) || (buf->state == BUF_TX && is_in)) buf_free(i);
+  }
+
+  for (uint8_t ch = 0; ch < CFG_TUSB_BRIDGE; ch++) {
+    if (_bridge_ch[ch].opened) channel_stop(ch, XFER_RESULT_FAILED);
+  }
+}
+
+uint16_t bridged_open(uint8_t rhport, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  TU_VERIFY(tud_bridge_claim_cb(rhport, desc_itf), 0);
+
+  _bridge_dev.rhport = rhport;
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  uint8_t const* desc_end = ((uint8_t const*) desc_itf) + max_len;
+
+  // open all endpoints until next interface
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+    if (desc_type == TUSB_DESC_INTERFACE || desc_type == TUSB_DESC_INTERFACE_ASSOCIATION) break;
+
+    if (desc_type == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      uint8_t const ep_addr = desc_ep->bEndpointAddress;
+      TU_ASSERT(tu_edpt_number(ep_addr) < CFG_TUD_ENDPPOINT_MAX, 0);
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+      _bridge_dev.mps[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = tu_edpt_packet_size(desc_ep);
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return (uint16_t) (p_desc - (uint8_t const*) desc_itf);
+}
+
+bool bridged_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+  TU_VERIFY(tud_bridge_control_xfer_cb);
+  return tud_bridge_control_xfer_cb(rhport, stage, request);
+}
+
+bool bridged_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) rhport;
+
+  for (uint8_t ch = 0; ch < CFG_TUSB_BRIDGE; ch++) {
+    bridge_channel_t* p_ch = &_bridge_ch[ch];
+    if (p_ch->ep_dev != ep_addr) continue;
+
+    // buffer in flight on this endpoint: receiving for OUT, head of send queue for IN
+    uint8_t const idx = ch_is_in(p_ch) ? p_ch->tx_head : p_ch->rx_buf;
+    if (idx != BUF_NONE && _bridge_buf[idx].ch == ch && _bridge_buf[idx].state != BUF_FREE) {
+      xfer_complete(idx, false, result, xferred_bytes);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//--------------------------------------------------------------------+
+// Host Class Driver API
+// Bridge does not claim any interface, it only needs to know when a downstream device is removed
+//--------------------------------------------------------------------+
+bool bridgeh_init(void) {
+  return true;
+}
+
+bool bridgeh_deinit(void) {
+  return true;
+}
+
+bool bridgeh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+  (void) dev_addr;
+  (void) desc_itf;
+  (void) max_len;
+  return false;
+}
+
+bool bridgeh_set_config(uint8_t dev_addr, uint8_t itf_num) {
+  (void) dev_addr;
+  (void) itf_num;
+  return false;
+}
+
+bool bridgeh_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  (void) dev_addr;
+  (void) ep_addr;
+  (void) result;
+  (void) xferred_bytes;
+  return false;
+}
+
+void bridgeh_close(uint8_t dev_addr) {
+  // host endpoints are closed: transfers in flight on host side are gone
+  for (uint8_t i = 0; i < CFG_TUSB_BRIDGE_BUFCOUNT; i++) {
+    bridge_buf_t* buf = &_bridge_buf[i];
+    if (buf->state == BUF_FREE || _bridge_ch[buf->ch].daddr != dev_addr) continue;
+    bool const is_in = ch_is_in(&_bridge_ch[buf->ch]);
+    if ((buf->state == BUF_RX && is_in) || (buf->state == BUF_TX && !is_in)) buf_free(i);
+  }
+
+  for (uint8_t ch = 0; ch < CFG_TUSB_BRIDGE; ch++) {
+    if (_bridge_ch[ch].opened && _bridge_ch[ch].daddr == dev_addr) channel_stop(ch, XFER_RESULT_FAILED);
+  }
+}
+
+#endif
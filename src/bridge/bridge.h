@@ -0,0 +1,123 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef _TUSB_BRIDGE_H_
+#define _TUSB_BRIDGE_H_
+
+#include "common/tusb_common.h"
+
+// Bridge connects endpoints of a device attached to the host stack with endpoints of the device stack, e.g a
+// protocol filter sitting between a PC and a USB device. Each channel forwards one direction:
+// - IN : host stack reads downstream device's IN endpoint, data is sent to upstream PC on device IN endpoint
+// - OUT: device OUT endpoint receives from upstream PC, data is written to downstream device's OUT endpoint
+// Received buffer is handed to the other side as-is, no copy, and receiving is re-armed with another buffer from a
+// pool shared by all channels. Transfer boundaries are kept: a transfer ended by short packet on the receiving side
+// is also ended by short packet (or zero-length packet) on the sending side.
+//
+// Device side endpoints belong to interfaces claimed with tud_bridge_claim_cb(). Host side endpoints are opened by
+// tusb_bridge_open() and must not belong to an interface claimed by a host class driver.
+// tud_task() and tuh_task() must run in the same thread.
+
+// Size of each pool buffer, which is the largest transfer forwarded at once. Multiple of the largest endpoint size
+#ifndef CFG_TUSB_BRIDGE_BUFSIZE
+#define CFG_TUSB_BRIDGE_BUFSIZE    512
+#endif
+
+// Number of buffers in pool shared by all channels
+#ifndef CFG_TUSB_BRIDGE_BUFCOUNT
+#define CFG_TUSB_BRIDGE_BUFCOUNT   (2*CFG_TUSB_BRIDGE)
+#endif
+
+// Maximum buffers used by one channel: 2 lets a channel receive next transfer while sending the previous one
+#ifndef CFG_TUSB_BRIDGE_DEPTH
+#define CFG_TUSB_BRIDGE_DEPTH      2
+#endif
+
+// Bridge buffers are accessed by both device and host controller
+#ifndef CFG_TUSB_BRIDGE_MEM_SECTION
+#define CFG_TUSB_BRIDGE_MEM_SECTION  CFG_TUSB_MEM_SECTION
+#endif
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Start forwarding between endpoint desc_ep of host device daddr and device endpoint ep_dev, both must have the same
+// direction. Host endpoint is opened here, device endpoint must be opened by a claimed interface i.e device is
+// configured. Return false if channel is in use or still has transfers in flight since it was closed.
+bool tusb_bridge_open(uint8_t ch, uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, uint8_t ep_dev);
+
+// Stop forwarding, data in flight is dropped
+void tusb_bridge_close(uint8_t ch);
+
+// Check if channel is forwarding
+bool tusb_bridge_opened(uint8_t ch);
+
+//--------------------------------------------------------------------+
+// Application Callback API (weak is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when device is configured for each interface not claimed by preceding drivers, return true to let
+// bridge open its endpoints for forwarding
+bool tud_bridge_claim_cb(uint8_t rhport, tusb_desc_interface_t const* desc_itf);
+
+// Invoked when a transfer is received, before forwarding. Data can be inspected and modified in place, *len can be
+// changed up to CFG_TUSB_BRIDGE_BUFSIZE. Return false to drop it.
+TU_ATTR_WEAK bool tusb_bridge_forward_cb(uint8_t ch, uint8_t* buffer, uint32_t* len);
+
+// Invoked when channel stops by itself: transfer failed or stalled, downstream device removed or device stack
+// reset by upstream host. tusb_bridge_close() is already done
+TU_ATTR_WEAK void tusb_bridge_close_cb(uint8_t ch, xfer_result_t result);
+
+// Invoked on class specific/vendor control request to a claimed interface or its endpoints, return false to stall.
+// Request can e.g be forwarded to downstream device with tuh_control_xfer() and answered when that completes.
+TU_ATTR_WEAK bool tud_bridge_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     bridged_init(void);
+bool     bridged_deinit(void);
+void     bridged_reset(uint8_t rhport);
+uint16_t bridged_open(uint8_t rhport, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool     bridged_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request);
+bool     bridged_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+
+bool     bridgeh_init(void);
+bool     bridgeh_deinit(void);
+bool     bridgeh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool     bridgeh_set_config(uint8_t dev_addr, uint8_t itf_num);
+bool     bridgeh_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     bridgeh_close(uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_BRIDGE_H_ */
@@ -0,0 +1,196 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_BRIDGE_CDC && CFG_TUD_CDC && CFG_TUH_CDC
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+#include "class/cdc/cdc_device.h"
+#include "class/cdc/cdc_host.h"
+
+#include "bridge_cdc.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+typedef struct {
+  bool attached;
+  uint8_t idx;         // host CDC interface
+
+  // line coding and control line state are applied to adapter one request at a time
+  bool ctrl_busy;
+  bool coding_pending;
+  bool state_pending;
+} bridge_cdc_t;
+
+static bridge_cdc_t _bridge_cdc[CFG_TUD_CDC];
+
+// return device interface bridged with host interface idx, or CFG_TUD_CDC
+static uint8_t find_itf(uint8_t idx) {
+  uint8_t itf;
+  for (itf = 0; itf < CFG_TUD_CDC; itf++) {
+    if (_bridge_cdc[itf].attached && _bridge_cdc[itf].idx == idx) break;
+  }
+  return itf;
+}
+
+//--------------------------------------------------------------------+
+// Line coding and control line state
+//--------------------------------------------------------------------+
+static void ctrl_next(uint8_t itf);
+
+static void ctrl_complete(tuh_xfer_t* xfer) {
+  uint8_t const itf = (uint8_t) xfer->user_data;
+  bridge_cdc_t* p_bridge = &_bridge_cdc[itf];
+  TU_VERIFY(p_bridge->attached, );
+
+  p_bridge->ctrl_busy = false;
+  ctrl_next(itf);
+}
+
+static void ctrl_next(uint8_t itf) {
+  bridge_cdc_t* p_bridge = &_bridge_cdc[itf];
+  if (!p_bridge->attached || p_bridge->ctrl_busy) return;
+
+  p_bridge->ctrl_busy = true;
+
+  if (p_bridge->coding_pending) {
+    cdc_line_coding_t coding;
+    tud_cdc_n_get_line_coding(itf, &coding);
+    if (tuh_cdc_set_line_coding(p_bridge->idx, &coding, ctrl_complete, itf)) {
+      p_bridge->coding_pending = false;
+      return;
+    }
+  } else if (p_bridge->state_pending) {
+    if (tuh_cdc_set_control_line_state(p_bridge->idx, tud_cdc_n_get_line_state(itf), ctrl_complete, itf)) {
+      p_bridge->state_pending = false;
+      return;
+    }
+  }
+
+  // nothing to do, or control pipe is busy: retried on next event
+  p_bridge->ctrl_busy = false;
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tusb_bridge_cdc_attach(uint8_t itf, uint8_t idx) {
+  TU_VERIFY(itf < CFG_TUD_CDC && !_bridge_cdc[itf].attached && find_itf(idx) == CFG_TUD_CDC);
+  TU_VERIFY(tuh_cdc_mounted(idx));
+
+  tu_fifo_t* const rx_ff = cdcd_get_fifo(itf, false);
+  tu_fifo_t* const tx_ff = cdcd_get_fifo(itf, true);
+  tu_fifo_clear(rx_ff);
+  tu_fifo_clear(tx_ff);
+
+  // adapter receives into device tx fifo and sends from device rx fifo
+  TU_VERIFY(cdch_share_fifo(idx, tx_ff, rx_ff));
+
+  bridge_cdc_t* p_bridge = &_bridge_cdc[itf];
+  tu_memclr(p_bridge, sizeof(bridge_cdc_t));
+  p_bridge->attached       = true;
+  p_bridge->idx            = idx;
+  p_bridge->coding_pending = true;
+  p_bridge->state_pending  = true;
+
+  ctrl_next(itf);
+  cdch_rx_xfer(idx);
+  cdcd_rx_xfer(itf);
+
+  return true;
+}
+
+void tusb_bridge_cdc_detach(uint8_t itf) {
+  TU_VERIFY(itf < CFG_TUD_CDC && _bridge_cdc[itf].attached, );
+
+  cdch_share_fifo(_bridge_cdc[itf].idx, NULL, NULL);
+  tu_memclr(&_bridge_cdc[itf], sizeof(bridge_cdc_t));
+}
+
+bool tusb_bridge_cdc_attached(uint8_t itf) {
+  return (itf < CFG_TUD_CDC) && _bridge_cdc[itf].attached;
+}
+
+//--------------------------------------------------------------------+
+// Device driver events
+//--------------------------------------------------------------------+
+bool bridge_cdcd_rx_cb(uint8_t itf) {
+  TU_VERIFY(_bridge_cdc[itf].attached);
+  tuh_cdc_write_flush(_bridge_cdc[itf].idx);
+  return true;
+}
+
+void bridge_cdcd_tx_complete_cb(uint8_t itf) {
+  TU_VERIFY(_bridge_cdc[itf].attached, );
+  cdch_rx_xfer(_bridge_cdc[itf].idx);
+}
+
+void bridge_cdcd_line_coding_cb(uint8_t itf) {
+  TU_VERIFY(_bridge_cdc[itf].attached, );
+  _bridge_cdc[itf].coding_pending = true;
+  ctrl_next(itf);
+}
+
+void bridge_cdcd_line_state_cb(uint8_t itf) {
+  TU_VERIFY(_bridge_cdc[itf].attached, );
+  _bridge_cdc[itf].state_pending = true;
+  ctrl_next(itf);
+
+  // terminal opened: send what adapter received meanwhile
+  tud_cdc_n_write_flush(itf);
+}
+
+//--------------------------------------------------------------------+
+// Host driver events
+//--------------------------------------------------------------------+
+bool bridge_cdch_rx_cb(uint8_t idx) {
+  uint8_t const itf = find_itf(idx);
+  TU_VERIFY(itf < CFG_TUD_CDC);
+
+  tud_cdc_n_write_flush(itf);
+  ctrl_next(itf);
+  return true;
+}
+
+void bridge_cdch_tx_complete_cb(uint8_t idx) {
+  uint8_t const itf = find_itf(idx);
+  TU_VERIFY(itf < CFG_TUD_CDC, );
+
+  cdcd_rx_xfer(itf);
+}
+
+void bridge_cdch_close_cb(uint8_t idx) {
+  uint8_t const itf = find_itf(idx);
+  TU_VERIFY(itf < CFG_TUD_CDC, );
+
+  tusb_bridge_cdc_detach(itf);
+}
+
+#endif
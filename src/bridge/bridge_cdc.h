@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#ifndef _TUSB_BRIDGE_CDC_H_
+#define _TUSB_BRIDGE_CDC_H_
+
+#include "common/tusb_common.h"
+
+// CDC bridge relays a serial adapter attached to the host stack (CDC-ACM, FTDI, CP210x, CH34x) to a CDC-ACM interface
+// of the device stack. Each direction uses one fifo of the device interface, shared with the host stream:
+// - adapter RX: host stream receives into device tx fifo, device IN endpoint sends from it
+// - adapter TX: device OUT endpoint receives into device rx fifo, host stream sends from it
+// Data is copied once between the endpoints, the other copy is skipped where the device controller transfers directly
+// from/to fifo (CFG_TUD_CDC_RX_FIFO_XFER, CFG_TUD_CDC_TX_FIFO_XFER). Line coding and control line state (DTR/RTS) set
+// by the upstream host are applied to the adapter. Bridged data is not passed to application receive callbacks.
+// tud_task() and tuh_task() must run in the same thread.
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Bridge device CDC interface itf with host CDC interface idx, typically from tuh_cdc_mount_cb().
+// Data still in fifos of both interfaces is dropped.
+bool tusb_bridge_cdc_attach(uint8_t itf, uint8_t idx);
+
+// Stop bridging, also done when the adapter is removed
+void tusb_bridge_cdc_detach(uint8_t itf);
+
+// Check if device CDC interface is bridged
+bool tusb_bridge_cdc_attached(uint8_t itf);
+
+//--------------------------------------------------------------------+
+// Internal API, invoked by CDC device and host drivers
+//--------------------------------------------------------------------+
+
+// Device received data into rx fifo, return true if it is forwarded
+bool bridge_cdcd_rx_cb(uint8_t itf);
+void bridge_cdcd_tx_complete_cb(uint8_t itf);
+void bridge_cdcd_line_coding_cb(uint8_t itf);
+void bridge_cdcd_line_state_cb(uint8_t itf);
+
+// Host received data into rx fifo, return true if it is forwarded
+bool bridge_cdch_rx_cb(uint8_t idx);
+void bridge_cdch_tx_complete_cb(uint8_t idx);
+void bridge_cdch_close_cb(uint8_t idx);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_BRIDGE_CDC_H_ */
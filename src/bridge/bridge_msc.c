@@ -0,0 +1,341 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_BRIDGE_MSC && CFG_TUD_MSC && CFG_TUH_MSC
+
+#include "device/usbd.h"
+#include "host/usbh.h"
+#include "class/msc/msc_device.h"
+#include "class/msc/msc_host.h"
+
+#include "bridge_msc.h"
+
+#if CFG_TUD_MSC_CACHE_LINES
+  #error "MSC passthrough requires CFG_TUD_MSC_CACHE_LINES = 0"
+#endif
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+typedef struct {
+  uint8_t daddr;  // 0 is not attached
+  uint8_t h_lun;
+  bool ready;     // INQUIRY data is read
+  bool inquiring;
+  bool busy;      // command is forwarded, device class waits for tud_msc_async_io_done()
+
+  // READ10 in progress, for tusb_bridge_msc_data_cb()
+  uint32_t lba;
+  uint8_t* buffer;
+
+  uint8_t vendor_id[8];
+  uint8_t product_id[16];
+  uint8_t product_rev[4];
+} bridge_msc_lun_t;
+
+static bridge_msc_lun_t _bridge_msc[CFG_TUSB_BRIDGE_MSC];
+
+// INQUIRY and REQUEST SENSE response, shared by all LUNs
+CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
+static uint8_t _bridge_msc_buf[sizeof(scsi_inquiry_resp_t)];
+static bool _bridge_msc_buf_busy;
+
+TU_VERIFY_STATIC(sizeof(scsi_inquiry_resp_t) >= sizeof(scsi_sense_fixed_resp_t), "buffer too small");
+
+TU_ATTR_ALWAYS_INLINE static inline bridge_msc_lun_t* get_lun(uint8_t lun) {
+  return (lun < CFG_TUSB_BRIDGE_MSC && _bridge_msc[lun].daddr) ? &_bridge_msc[lun] : NULL;
+}
+
+// forwarded command completed after LUN is detached or re-attached is dropped
+TU_ATTR_ALWAYS_INLINE static inline bridge_msc_lun_t* get_busy_lun(uint8_t daddr, uintptr_t arg) {
+  bridge_msc_lun_t* p_lun = get_lun((uint8_t) arg);
+  return (p_lun && p_lun->daddr == daddr && p_lun->busy) ? p_lun : NULL;
+}
+
+static void complete_io(uint8_t lun, bridge_msc_lun_t* p_lun, int32_t bytes_io) {
+  p_lun->busy = false;
+  tud_msc_async_io_done(lun, bytes_io, false);
+}
+
+//--------------------------------------------------------------------+
+// INQUIRY
+//--------------------------------------------------------------------+
+static bool inquiry_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  _bridge_msc_buf_busy = false;
+
+  bridge_msc_lun_t* p_lun = get_lun((uint8_t) cb_data->user_arg);
+  TU_VERIFY(p_lun && p_lun->daddr == daddr && p_lun->inquiring);
+  p_lun->inquiring = false;
+
+  if (cb_data->csw->status == MSC_CSW_STATUS_PASSED) {
+    scsi_inquiry_resp_t const* inquiry = (scsi_inquiry_resp_t const*) cb_data->scsi_data;
+    memcpy(p_lun->vendor_id, inquiry->vendor_id, sizeof(p_lun->vendor_id));
+    memcpy(p_lun->product_id, inquiry->product_id, sizeof(p_lun->product_id));
+    memcpy(p_lun->product_rev, inquiry->product_rev, sizeof(p_lun->product_rev));
+  }
+  p_lun->ready = true;
+
+  return true;
+}
+
+// Start reading INQUIRY data if shared buffer and drive LUN are free, otherwise retry on next TEST UNIT READY
+static void inquiry_start(uint8_t lun, bridge_msc_lun_t* p_lun) {
+  if (p_lun->ready || p_lun->inquiring || _bridge_msc_buf_busy) return;
+  if (!tuh_msc_lun_ready(p_lun->daddr, p_lun->h_lun)) return;
+
+  p_lun->inquiring = true;
+  _bridge_msc_buf_busy = true;
+  if (!tuh_msc_inquiry(p_lun->daddr, p_lun->h_lun, (scsi_inquiry_resp_t*) (void*) _bridge_msc_buf, inquiry_complete,
+                       lun)) {
+    p_lun->inquiring = false;
+    _bridge_msc_buf_busy = false;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tusb_bridge_msc_attach(uint8_t lun, uint8_t daddr, uint8_t h_lun) {
+  TU_VERIFY(lun < CFG_TUSB_BRIDGE_MSC && daddr && !_bridge_msc[lun].daddr);
+  TU_VERIFY(tuh_msc_mounted(daddr) && h_lun < tuh_msc_get_maxlun(daddr));
+
+  bridge_msc_lun_t* p_lun = &_bridge_msc[lun];
+  tu_memclr(p_lun, sizeof(bridge_msc_lun_t));
+  p_lun->daddr = daddr;
+  p_lun->h_lun = h_lun;
+
+  // reported until INQUIRY data is read, or if drive fails it
+  memcpy(p_lun->vendor_id, "TinyUSB ", sizeof(p_lun->vendor_id));
+  memcpy(p_lun->product_id, "MSC Passthrough ", sizeof(p_lun->product_id));
+  memcpy(p_lun->product_rev, "1.0 ", sizeof(p_lun->product_rev));
+
+  inquiry_start(lun, p_lun);
+  return true;
+}
+
+void tusb_bridge_msc_detach(uint8_t lun) {
+  bridge_msc_lun_t* p_lun = get_lun(lun);
+  if (!p_lun) return;
+
+  bool const busy = p_lun->busy;
+  tu_memclr(p_lun, sizeof(bridge_msc_lun_t));
+
+  if (busy) tud_msc_async_io_done(lun, TUD_MSC_RET_ERROR, false);
+}
+
+bool tusb_bridge_msc_attached(uint8_t lun) {
+  return get_lun(lun) != NULL;
+}
+
+//--------------------------------------------------------------------+
+// READ10/WRITE10
+//--------------------------------------------------------------------+
+static bool rdwr10_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  uint8_t const lun = (uint8_t) cb_data->user_arg;
+  bridge_msc_lun_t* p_lun = get_busy_lun(daddr, cb_data->user_arg);
+  TU_VERIFY(p_lun);
+
+  if (cb_data->csw->status != MSC_CSW_STATUS_PASSED) {
+    complete_io(lun, p_lun, TUD_MSC_RET_ERROR);
+    return true;
+  }
+
+  uint32_t const len = cb_data->cbw->total_bytes;
+  if ((cb_data->cbw->dir & TUSB_DIR_IN_MASK) && tusb_bridge_msc_data_cb) {
+    tusb_bridge_msc_data_cb(lun, false, p_lun->lba, p_lun->buffer, len);
+  }
+  complete_io(lun, p_lun, (int32_t) len);
+
+  return true;
+}
+
+static int32_t rdwr10_forward(uint8_t lun, bool is_write, uint32_t lba, uint32_t offset, uint8_t* buffer,
+                              uint32_t bufsize) {
+  bridge_msc_lun_t* p_lun = get_lun(lun);
+  TU_VERIFY(p_lun && p_lun->ready && tuh_msc_mounted(p_lun->daddr), TUD_MSC_RET_ERROR);
+
+  // class buffer holds at least one block, transfers are therefore split on block boundaries
+  uint32_t const block_size = tuh_msc_get_block_size(p_lun->daddr, p_lun->h_lun);
+  TU_VERIFY(block_size && offset == 0 && bufsize >= block_size, TUD_MSC_RET_ERROR);
+
+  // drive LUN is busy e.g with INQUIRY, callback is invoked again later
+  if (!tuh_msc_lun_ready(p_lun->daddr, p_lun->h_lun)) return TUD_MSC_RET_BUSY;
+
+  uint16_t const block_count = (uint16_t) tu_min32(bufsize / block_size, UINT16_MAX);
+
+  if (is_write && tusb_bridge_msc_data_cb) {
+    tusb_bridge_msc_data_cb(lun, true, lba, buffer, block_count * block_size);
+  }
+
+  p_lun->busy   = true;
+  p_lun->lba    = lba;
+  p_lun->buffer = buffer;
+
+  bool const ret = is_write ?
+    tuh_msc_write10(p_lun->daddr, p_lun->h_lun, buffer, lba, block_count, rdwr10_complete, lun) :
+    tuh_msc_read10(p_lun->daddr, p_lun->h_lun, buffer, lba, block_count, rdwr10_complete, lun);
+
+  if (!ret) {
+    p_lun->busy = false;
+    return TUD_MSC_RET_ERROR;
+  }
+
+  return TUD_MSC_RET_ASYNC;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  return rdwr10_forward(lun, false, lba, offset, (uint8_t*) buffer, bufsize);
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  return rdwr10_forward(lun, true, lba, offset, buffer, bufsize);
+}
+
+//--------------------------------------------------------------------+
+// Other SCSI commands
+//--------------------------------------------------------------------+
+static bool request_sense_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  _bridge_msc_buf_busy = false;
+
+  uint8_t const lun = (uint8_t) cb_data->user_arg;
+  bridge_msc_lun_t* p_lun = get_busy_lun(daddr, cb_data->user_arg);
+  TU_VERIFY(p_lun);
+
+  scsi_sense_fixed_resp_t const* sense = (scsi_sense_fixed_resp_t const*) cb_data->scsi_data;
+  if (cb_data->csw->status == MSC_CSW_STATUS_PASSED && sense->sense_key) {
+    tud_msc_set_sense(lun, sense->sense_key, sense->add_sense_code, sense->add_sense_qualifier);
+  } else {
+    tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00); // internal target failure
+  }
+
+  complete_io(lun, p_lun, TUD_MSC_RET_ERROR);
+  return true;
+}
+
+static bool scsi_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  uint8_t const lun = (uint8_t) cb_data->user_arg;
+  bridge_msc_lun_t* p_lun = get_busy_lun(daddr, cb_data->user_arg);
+  TU_VERIFY(p_lun);
+
+  msc_cbw_t const* cbw = cb_data->cbw;
+  msc_csw_t const* csw = cb_data->csw;
+
+  if (csw->status == MSC_CSW_STATUS_PASSED) {
+    // IN: bytes sent by drive, OUT: whole data is consumed
+    uint32_t const len = (cbw->dir & TUSB_DIR_IN_MASK) ?
+                         cbw->total_bytes - tu_min32(csw->data_residue, cbw->total_bytes) : cbw->total_bytes;
+    complete_io(lun, p_lun, (int32_t) len);
+    return true;
+  }
+
+  // fetch sense data of failed command from drive, drive LUN is free since this callback is invoked last
+  if (csw->status == MSC_CSW_STATUS_FAILED && !_bridge_msc_buf_busy) {
+    _bridge_msc_buf_busy = true;
+    if (tuh_msc_request_sense(daddr, p_lun->h_lun, _bridge_msc_buf, request_sense_complete, lun)) return true;
+    _bridge_msc_buf_busy = false;
+  }
+
+  tud_msc_set_sense(lun, SCSI_SENSE_HARDWARE_ERROR, 0x44, 0x00);
+  complete_io(lun, p_lun, TUD_MSC_RET_ERROR);
+  return true;
+}
+
+// CDB length from group code of operation code
+static uint8_t scsi_cmd_len(uint8_t opcode) {
+  switch (opcode >> 5) {
+    case 0:  return 6;
+    case 1:
+    case 2:  return 10;
+    case 5:  return 12;
+    default: return 16;
+  }
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize) {
+  bridge_msc_lun_t* p_lun = get_lun(lun);
+  TU_VERIFY(p_lun && p_lun->ready && tuh_msc_mounted(p_lun->daddr), -1);
+
+  msc_cbw_t const* dev_cbw = tud_msc_get_cbw();
+
+  msc_cbw_t cbw;
+  tu_memclr(&cbw, sizeof(msc_cbw_t));
+  cbw.signature   = MSC_CBW_SIGNATURE;
+  cbw.tag         = 0x54555342; // TUSB
+  cbw.lun         = p_lun->h_lun;
+  cbw.dir         = dev_cbw->dir & TUSB_DIR_IN_MASK;
+  cbw.total_bytes = dev_cbw->total_bytes ? tu_min32(bufsize, CFG_TUD_MSC_EP_BUFSIZE) : 0;
+  cbw.cmd_len     = scsi_cmd_len(scsi_cmd[0]);
+  memcpy(cbw.command, scsi_cmd, cbw.cmd_len);
+
+  p_lun->busy = true;
+  if (!tuh_msc_scsi_command(p_lun->daddr, &cbw, buffer, scsi_complete, lun)) {
+    p_lun->busy = false;
+    return -1;
+  }
+
+  return TUD_MSC_RET_ASYNC;
+}
+
+//--------------------------------------------------------------------+
+// Device MSC callbacks answered locally
+//--------------------------------------------------------------------+
+uint8_t tud_msc_get_maxlun_cb(void) {
+  return CFG_TUSB_BRIDGE_MSC;
+}
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
+  bridge_msc_lun_t const* p_lun = &_bridge_msc[lun < CFG_TUSB_BRIDGE_MSC ? lun : 0];
+  memcpy(vendor_id, p_lun->vendor_id, sizeof(p_lun->vendor_id));
+  memcpy(product_id, p_lun->product_id, sizeof(p_lun->product_id));
+  memcpy(product_rev, p_lun->product_rev, sizeof(p_lun->product_rev));
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+  bridge_msc_lun_t* p_lun = get_lun(lun);
+  if (!p_lun || !tuh_msc_mounted(p_lun->daddr)) return false; // medium not present
+
+  if (!p_lun->ready) {
+    inquiry_start(lun, p_lun);
+    tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x04, 0x01); // becoming ready
+    return false;
+  }
+
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size) {
+  bridge_msc_lun_t const* p_lun = get_lun(lun);
+  if (p_lun && p_lun->ready) {
+    *block_count = tuh_msc_get_block_count(p_lun->daddr, p_lun->h_lun);
+    *block_size  = (uint16_t) tuh_msc_get_block_size(p_lun->daddr, p_lun->h_lun);
+  } else {
+    *block_count = 0;
+    *block_size  = 0;
+  }
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+
+#ifndef _TUSB_BRIDGE_MSC_H_
+#define _TUSB_BRIDGE_MSC_H_
+
+#include "common/tusb_common.h"
+
+// MSC passthrough exposes LUNs of drives attached to the host stack as LUNs of the device MSC class, e.g a USB
+// drive firewall or inline encryption dongle. This module implements the device MSC application callbacks:
+// - READ10/WRITE10 are issued to the drive with tuh_msc_read10()/tuh_msc_write10() directly on the device class
+//   buffer, no copy, and completed asynchronously with tud_msc_async_io_done()
+// - INQUIRY, READ CAPACITY and TEST UNIT READY are answered from data cached by the host stack
+// - Other commands are forwarded as-is with tuh_msc_scsi_command(), sense data of a failed command is fetched from
+//   the drive with REQUEST SENSE
+// Device MSC buffers (CFG_TUD_MEM_SECTION) must be accessible by the host controller, CFG_TUD_MSC_EP_BUFSIZE must
+// hold at least one block and CFG_TUD_MSC_CACHE_LINES must be 0. tud_task() and tuh_task() must run in the same thread.
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Pass device LUN lun through to LUN h_lun of drive daddr, typically from tuh_msc_mount_cb(). LUN reports not ready
+// until drive's INQUIRY data is read.
+bool tusb_bridge_msc_attach(uint8_t lun, uint8_t daddr, uint8_t h_lun);
+
+// Detach LUN, typically from tuh_msc_umount_cb(). Command in progress fails, LUN reports medium not present.
+void tusb_bridge_msc_detach(uint8_t lun);
+
+// Check if LUN is attached to a drive
+bool tusb_bridge_msc_attached(uint8_t lun);
+
+//--------------------------------------------------------------------+
+// Application Callback API (weak is optional)
+//--------------------------------------------------------------------+
+
+// Invoked with block data passing through, to inspect or modify it in place e.g encryption:
+// - is_write = false: data was read from drive and is about to be sent to upstream host
+// - is_write = true : data was received from upstream host and is about to be written to drive
+TU_ATTR_WEAK void tusb_bridge_msc_data_cb(uint8_t lun, bool is_write, uint32_t lba, uint8_t* buffer, uint32_t len);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_BRIDGE_MSC_H_ */
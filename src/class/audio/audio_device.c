@@ -77,8 +77,8 @@
 // is available or driver is would need to be changed dramatically
 
 // Only STM32 and dcd_transdimension use non-linear buffer for now
-// dwc2 except esp32sx (since it may use dcd_esp32sx)
-#if (defined(TUP_USBIP_DWC2) && !TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)) || \
+// dwc2 except esp32sx (since it may use dcd_esp32sx) and DMA mode
+#if (defined(TUP_USBIP_DWC2) && !TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3) && !CFG_TUD_DWC2_DMA) || \
     defined(TUP_USBIP_FSDEV)          || \
     CFG_TUSB_MCU == OPT_MCU_RX63X     || \
     CFG_TUSB_MCU == OPT_MCU_RX65X     || \
@@ -272,6 +272,14 @@ uint8_t alt_setting_3[CFG_TUD_AUDIO_FUNC_3_N_AS_INT];
   #endif
 #endif
 
+// Progress of a circular DMA bound to EP FIFO. DMA interrupt only records it, FIFO positions are moved in usbd task
+// where they are serialized with the DCD which moves the other position of the same FIFO.
+typedef struct
+{
+  volatile uint32_t advanced;   // bytes moved by DMA, written in DMA interrupt only
+  volatile uint32_t applied;    // bytes applied to FIFO, written in usbd task only
+} audiod_dma_ring_t;
+
 typedef struct
 {
   uint8_t rhport;
@@ -315,6 +323,7 @@ typedef struct
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
 #if !CFG_TUD_AUDIO_ENABLE_DECODING
   tu_fifo_t ep_out_ff;
+  audiod_dma_ring_t ep_out_dma;
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
@@ -335,12 +344,13 @@ typedef struct
         uint32_t mclk_freq;
       }fixed;
 
-#if 0 // implement later
       struct {
-        uint32_t nominal_value;
-        uint32_t threshold_bytes;
+        uint32_t nominal_value; // nominal feedback value in 16.16
+        uint32_t target_bytes;  // FIFO level to regulate to
+        uint32_t kp;            // proportional gain: feedback deviation (16.16) per byte of error, 24.8 format
+        uint32_t level_avg;     // low-pass filtered FIFO level in bytes, 24.8 format
+        int32_t  integral;      // integral term in 16.16 with 8 extra fraction bits
       }fifo_count;
-#endif
     }compute;
 
   } feedback;
@@ -350,6 +360,7 @@ typedef struct
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
   tu_fifo_t ep_in_ff;
+  audiod_dma_ring_t ep_in_dma;
 #endif
 
   // Audio control interrupt buffer - no FIFO - 6 Bytes according to UAC 2 specification (p. 74)
@@ -368,6 +379,9 @@ typedef struct
   uint8_t n_bytes_per_sampe_rx;
   uint8_t n_channels_per_ff_rx;
   uint8_t n_ff_used_rx;
+#if CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION
+  uint8_t conv_format_rx;     // Conversion of active alternate setting, AUDIO_SUPP_FF_FORMAT_SUBSLOT if none is needed
+#endif
 #endif
 #endif
 
@@ -376,6 +390,14 @@ typedef struct
   uint16_t packet_sz_tx[3];
   uint8_t bclock_id_tx;
   uint8_t interval_tx;
+
+  // Packet schedule computed by audiod_calc_tx_packet_sz(): nav = sched_n_slots + sched_rem / sched_den slots per
+  // packet, a large packet is sent whenever the accumulated fraction sched_acc reaches a whole slot
+  uint16_t sched_n_slots;
+  uint16_t sched_rem;
+  uint16_t sched_den;
+  uint16_t sched_acc;
+  uint8_t sched_blackout;     // Packets until next drift correction is allowed
 #endif
 
   // Encoding parameters - parameters are set when alternate AS interface is set by host
@@ -388,6 +410,10 @@ typedef struct
   audio_data_format_type_I_t format_type_I_tx;
   uint8_t n_channels_per_ff_tx;
   uint8_t n_ff_used_tx;
+#if CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION
+  uint8_t conv_format_tx;     // Conversion of active alternate setting, AUDIO_SUPP_FF_FORMAT_SUBSLOT if none is needed
+  uint32_t dither_state_tx;   // Pseudo random generator of float dither
+#endif
 #endif
 #endif
 
@@ -415,6 +441,19 @@ typedef struct
 #define USE_LINEAR_BUFFER_TX   1
 #endif
 
+  // Support FIFO sample formats chosen by application, kept over bus reset
+#if CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION
+  uint8_t supp_ff_format_rx;
+  uint8_t supp_ff_format_tx;
+#endif
+
+  // Statistics are kept over bus reset and re-enumeration, they are only reset by tud_audio_n_stats_clear()
+#if CFG_TUD_AUDIO_ENABLE_STATS
+  tud_audio_stats_t stats;
+  uint8_t stats_fb_idx;       // Next write position in stats.fb_history
+  uint8_t stats_sof_pending;  // AUDIOD_STATS_SOF_RX/TX: SOF occurred and latency of next packet is not measured yet
+#endif
+
 } audiod_function_t;
 
 #ifndef USE_LINEAR_BUFFER_TX
@@ -425,6 +464,12 @@ typedef struct
 #define USE_LINEAR_BUFFER_RX   0
 #endif
 
+#define AUDIOD_CONV_RX   (CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING)
+#define AUDIOD_CONV_TX   (CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING)
+
+#define AUDIOD_BLOCK_RX  (CFG_TUD_AUDIO_BLOCK_FRAMES && CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING)
+#define AUDIOD_BLOCK_TX  (CFG_TUD_AUDIO_BLOCK_FRAMES && CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING)
+
 #define ITF_MEM_RESET_SIZE   offsetof(audiod_function_t, ctrl_buf)
 
 //--------------------------------------------------------------------+
@@ -432,6 +477,40 @@ typedef struct
 //--------------------------------------------------------------------+
 CFG_TUD_MEM_SECTION audiod_function_t _audiod_fct[CFG_TUD_AUDIO];
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+
+enum
+{
+  AUDIOD_STATS_SOF_RX = TU_BIT(0),
+  AUDIOD_STATS_SOF_TX = TU_BIT(1),
+};
+
+// Timestamp of last SOF
+static uint32_t _audiod_stats_sof_time;
+
+static inline void audiod_stats_level(tud_audio_stats_stream_t* stream, uint32_t level)
+{
+  stream->packets++;
+  stream->level_sum += level;
+  if (level < stream->level_min) stream->level_min = level;
+  if (level > stream->level_max) stream->level_max = level;
+}
+
+static inline void audiod_stats_sof_latency(audiod_function_t* audio, uint8_t dir_bit)
+{
+  if (!(audio->stats_sof_pending & dir_bit)) return;
+  audio->stats_sof_pending &= (uint8_t) ~dir_bit;
+
+  uint32_t const latency = tud_stats_timestamp_cb() - _audiod_stats_sof_time;
+  if (latency < audio->stats.sof_latency_min) audio->stats.sof_latency_min = latency;
+  if (latency > audio->stats.sof_latency_max) audio->stats.sof_latency_max = latency;
+}
+
+#define AUDIOD_STATS(_x)  _x
+#else
+#define AUDIOD_STATS(_x)
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT
 static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received);
 #endif
@@ -440,6 +519,10 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received);
 #endif
 
+#if AUDIOD_BLOCK_RX
+static void audiod_rx_block(audiod_function_t* audio);
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
 static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t* audio);
 #endif
@@ -448,6 +531,10 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t* audio);
 static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audio);
 #endif
 
+#if AUDIOD_BLOCK_TX
+static void audiod_tx_block(audiod_function_t* audio);
+#endif
+
 static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const * p_request);
 
@@ -469,11 +556,14 @@ static inline uint8_t tu_desc_subtype(void const* desc)
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
 static bool audiod_calc_tx_packet_sz(audiod_function_t* audio);
-static uint16_t audiod_tx_packet_size(const uint16_t* norminal_size, uint16_t data_count, uint16_t fifo_depth, uint16_t max_size);
+static uint16_t audiod_tx_packet_size(audiod_function_t* audio, uint16_t slot_sz, tu_fifo_size_t data_count, tu_fifo_size_t fifo_depth, uint16_t max_size);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, uint32_t mclk_freq);
+static void set_fb_params_fifo_count(audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, uint32_t target_bytes);
+static void audiod_fb_fifo_count_update(uint8_t func_id, bool compute);
+static void audiod_fb_params_prepare(uint8_t rhport, uint8_t func_id, uint8_t alt);
 #endif
 
 bool tud_audio_n_mounted(uint8_t func_id)
@@ -499,7 +589,9 @@ uint16_t tud_audio_n_available(uint8_t func_id)
 uint16_t tud_audio_n_read(uint8_t func_id, void* buffer, uint16_t bufsize)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
-  return tu_fifo_read_n(&_audiod_fct[func_id].ep_out_ff, buffer, bufsize);
+  uint16_t const count = tu_fifo_read_n(&_audiod_fct[func_id].ep_out_ff, buffer, bufsize);
+  AUDIOD_STATS( if (count < bufsize) _audiod_fct[func_id].stats.rx.underrun++; )
+  return count;
 }
 
 bool tud_audio_n_clear_ep_out_ff(uint8_t func_id)
@@ -514,6 +606,104 @@ tu_fifo_t* tud_audio_n_get_ep_out_ff(uint8_t func_id)
   return NULL;
 }
 
+/**
+ * \brief           Bind EP out buffer to a circular DMA ring
+ *
+ *  Zero-copy alternative to tud_audio_n_read() e.g for I2S/SAI playback. FIFO is cleared so that its read position
+ *  is at buffer start, where the circular DMA must be started. USB writes received data in front of the DMA position,
+ *  tud_audio_n_ep_out_dma_advance() must be called for every part (typically half) of the ring consumed by DMA.
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[out]      buffer: Start of FIFO storage to be used as DMA ring
+ * \param[out]      size: Size of DMA ring in bytes
+ * \return          false if audio function is not available
+ */
+bool tud_audio_n_ep_out_dma_ring(uint8_t func_id, void** buffer, uint16_t* size)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_t* ff = &_audiod_fct[func_id].ep_out_ff;
+
+  // Overwriting would move read position away from DMA position, drop received data when ring is full instead
+  tu_fifo_set_overwritable(ff, false);
+  tu_fifo_clear(ff);
+
+  // Start with silence until first data is received
+  memset(ff->buffer, 0, tu_fifo_depth(ff));
+  _audiod_fct[func_id].ep_out_dma.advanced = 0;
+  _audiod_fct[func_id].ep_out_dma.applied  = 0;
+
+  *buffer = ff->buffer;
+  *size   = (uint16_t) tu_fifo_depth(ff);
+  return true;
+}
+
+// Move EP out FIFO along with DMA, deferred from tud_audio_n_ep_out_dma_advance() to usbd task
+static void audiod_ep_out_dma_apply(void* param)
+{
+  audiod_function_t* audio = (audiod_function_t*) param;
+  tu_fifo_t* ff = &audio->ep_out_ff;
+
+  uint32_t const advanced = audio->ep_out_dma.advanced;
+  uint32_t n = advanced - audio->ep_out_dma.applied;
+
+  // DCD moves write position in ISR
+  usbd_spin_lock(false);
+
+  while (n)
+  {
+    tu_fifo_size_t const len   = (tu_fifo_size_t) TU_MIN(n, tu_fifo_depth(ff));
+    tu_fifo_size_t const count = tu_fifo_count(ff);
+
+    if (count < len)
+    {
+      // Underrun: DMA played stale content behind the received data. Replace it with silence in case nothing
+      // arrives until DMA wraps around, then move write position along with DMA.
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_write_info(ff, &info);
+
+      uint16_t const n_missing = (uint16_t) (len - count);
+      uint16_t const n_lin     = (uint16_t) TU_MIN(n_missing, info.len_lin);
+      memset(info.ptr_lin, 0, n_lin);
+      if (n_missing > n_lin) memset(info.ptr_wrap, 0, n_missing - n_lin);
+
+      tu_fifo_advance_write_pointer(ff, n_missing);
+      AUDIOD_STATS( audio->stats.rx.underrun++; )
+    }
+
+    tu_fifo_advance_read_pointer(ff, len);
+    n -= len;
+  }
+
+  usbd_spin_unlock(false);
+
+  audio->ep_out_dma.applied = advanced;
+}
+
+/**
+ * \brief           Advance EP out buffer by bytes consumed by DMA, called from DMA half/full transfer interrupt
+ *
+ *  Only the DMA progress is recorded here, FIFO is moved in usbd task since DCD modifies it in USB interrupt.
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[in]       len: # of bytes consumed by DMA since last call
+ * \return          Number of consumed bytes which were received data, the rest was an underrun
+ */
+uint16_t tud_audio_n_ep_out_dma_advance(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+
+  // received data not yet consumed by previous calls still waiting for usbd task
+  uint32_t const pending = audio->ep_out_dma.advanced - audio->ep_out_dma.applied;
+  uint32_t const count   = tu_fifo_count(&audio->ep_out_ff);
+  uint32_t const avail   = (count > pending) ? (count - pending) : 0;
+
+  audio->ep_out_dma.advanced += len;
+  usbd_defer_func(audiod_ep_out_dma_apply, audio, true);
+
+  return (uint16_t) TU_MIN(avail, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -533,7 +723,9 @@ uint16_t tud_audio_n_available_support_ff(uint8_t func_id, uint8_t ff_idx)
 uint16_t tud_audio_n_read_support_ff(uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff);
-  return tu_fifo_read_n(&_audiod_fct[func_id].rx_supp_ff[ff_idx], buffer, bufsize);
+  uint16_t const count = tu_fifo_read_n(&_audiod_fct[func_id].rx_supp_ff[ff_idx], buffer, bufsize);
+  AUDIOD_STATS( if (count < bufsize) _audiod_fct[func_id].stats.rx.underrun++; )
+  return count;
 }
 
 tu_fifo_t* tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
@@ -541,6 +733,15 @@ tu_fifo_t* tud_audio_n_get_rx_support_ff(uint8_t func_id, uint8_t ff_idx)
   if(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_rx_supp_ff) return &_audiod_fct[func_id].rx_supp_ff[ff_idx];
   return NULL;
 }
+
+#if AUDIOD_CONV_RX
+bool tud_audio_n_set_rx_support_ff_format(uint8_t func_id, audio_supp_ff_format_t format)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && format <= AUDIO_SUPP_FF_FORMAT_FLOAT32);
+  _audiod_fct[func_id].supp_ff_format_rx = (uint8_t) format;
+  return true;
+}
+#endif
 #endif
 
 // This function is called once an audio packet is received by the USB and is responsible for putting data from USB memory into EP_OUT_FIFO (or support FIFOs + decoding of received stream into audio channels).
@@ -602,6 +803,10 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
   // Prepare for next transmission
   TU_VERIFY(usbd_edpt_xfer(rhport, audio->ep_out, audio->lin_buf_out, audio->ep_out_sz), false);
 
+#if AUDIOD_BLOCK_RX
+  audiod_rx_block(audio);
+#endif
+
 #else
 
 #if USE_LINEAR_BUFFER_RX
@@ -615,6 +820,19 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
   TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_out, &audio->ep_out_ff, audio->ep_out_sz), false);
 #endif
 
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_STATS
+  {
+#if CFG_TUD_AUDIO_ENABLE_DECODING
+    tu_fifo_t* ff = &audio->rx_supp_ff[0];
+#else
+    tu_fifo_t* ff = &audio->ep_out_ff;
+#endif
+    // Overwritable FIFO stays overflowed until application reads, i.e. every packet received meanwhile is counted
+    if (tu_fifo_overflowed(ff)) audio->stats.rx.overrun++;
+    audiod_stats_level(&audio->stats.rx, tu_fifo_count(ff));
+  }
 #endif
 
   // Call a weak callback here - a possibility for user to get informed decoding was completed
@@ -628,13 +846,83 @@ static bool audiod_rx_done_cb(uint8_t rhport, audiod_function_t* audio, uint16_t
 
 #endif //CFG_TUD_AUDIO_ENABLE_EP_OUT
 
+#if AUDIOD_BLOCK_RX || AUDIOD_BLOCK_TX
+// Shared by all functions and both directions, block callbacks are invoked one at a time from usbd task
+TU_ATTR_ALIGNED(CFG_TUD_AUDIO_BLOCK_ALIGN) static uint8_t _audiod_block_buf[CFG_TUD_AUDIO_BLOCK_FRAMES * CFG_TUD_AUDIO_BLOCK_CHANNELS_MAX * 4];
+
+// Copy one block worth of samples between a support FIFO (linear + wrapped part) and the block buffer. The FIFO holds
+// ch_per_ff interleaved channels which are channels ch_first... of the block.
+static void audiod_block_copy(tu_fifo_buffer_info_t const * info, bool to_block, uint8_t n_channels, uint8_t ch_first, uint8_t ch_per_ff, uint8_t bps)
+{
+  uint16_t const n_frames = CFG_TUD_AUDIO_BLOCK_FRAMES;
+  uint32_t const len_lin = info->len_lin;
+  uint32_t pos = 0;
+
+  for (uint16_t f = 0; f < n_frames; f++)
+  {
+    for (uint8_t c = ch_first; c < ch_first + ch_per_ff; c++)
+    {
+#if CFG_TUD_AUDIO_BLOCK_PLANAR
+      (void) n_channels;
+      uint8_t * p_blk = &_audiod_block_buf[((uint32_t) c * n_frames + f) * bps];
+#else
+      uint8_t * p_blk = &_audiod_block_buf[((uint32_t) f * n_channels + c) * bps];
+#endif
+      if (pos + bps <= len_lin || pos >= len_lin)
+      {
+        uint8_t * p_ff = (pos < len_lin) ? ((uint8_t *) info->ptr_lin + pos) : ((uint8_t *) info->ptr_wrap + (pos - len_lin));
+        if (to_block) memcpy(p_blk, p_ff, bps);
+        else          memcpy(p_ff, p_blk, bps);
+      }
+      else
+      {
+        // sample is split by FIFO wrap, only if support FIFO depth is not a multiple of its sample size
+        for (uint8_t b = 0; b < bps; b++)
+        {
+          uint32_t const i = pos + b;
+          uint8_t * p_ff = (i < len_lin) ? ((uint8_t *) info->ptr_lin + i) : ((uint8_t *) info->ptr_wrap + (i - len_lin));
+          if (to_block) p_blk[b] = *p_ff;
+          else          *p_ff = p_blk[b];
+        }
+      }
+      pos += bps;
+    }
+  }
+}
+#endif
+
+#if AUDIOD_CONV_RX || AUDIOD_CONV_TX
+// Conversion needed for given subslot size, formats matching the subslot already need none
+static uint8_t audiod_conv_format(uint8_t format, uint8_t subslot_sz)
+{
+  if ((format == AUDIO_SUPP_FF_FORMAT_INT16 && subslot_sz == 2) ||
+      (format == AUDIO_SUPP_FF_FORMAT_INT32 && subslot_sz == 4))
+  {
+    return AUDIO_SUPP_FF_FORMAT_SUBSLOT;
+  }
+  return format;
+}
+
+// Size of one sample in support FIFO
+static uint8_t audiod_conv_sample_size(uint8_t format, uint8_t subslot_sz)
+{
+  switch (format)
+  {
+    case AUDIO_SUPP_FF_FORMAT_INT16:   return 2;
+    case AUDIO_SUPP_FF_FORMAT_INT32:
+    case AUDIO_SUPP_FF_FORMAT_FLOAT32: return 4;
+    default:                           return subslot_sz;
+  }
+}
+#endif
+
 // The following functions are used in case CFG_TUD_AUDIO_ENABLE_DECODING != 0
 #if CFG_TUD_AUDIO_ENABLE_DECODING && CFG_TUD_AUDIO_ENABLE_EP_OUT
 
 // Decoding according to 2.3.1.5 Audio Streams
 
 // Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+TU_ATTR_ALWAYS_INLINE static inline void * audiod_interleaved_copy_bytes_decode_n(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
 {
   // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
   uint16_t * dst16 = dst;
@@ -666,9 +954,17 @@ static inline void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nB
   {
     while(dst16 < dst_end16)
     {
+#if !TUP_ARCH_STRICT_ALIGN && !TUP_MCU_STRICT_ALIGN
+      // 6-byte slot is only 2-byte aligned, copy it with one unaligned word and one half-word
+      tu_unaligned_write32(dst16, tu_unaligned_read32(src16));
+      dst16[2] = src16[2];
+      dst16 += 3;
+      src16 += 3;
+#else
       *dst16++ = *src16++;
       *dst16++ = *src16++;
       *dst16++ = *src16++;
+#endif
       src16 += 3 * (n_ff_used - 1);
     }
     return src16;
@@ -685,10 +981,127 @@ static inline void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nB
   }
 }
 
+// Common layouts of 2, 4, 8 and 16 channels (1, 2, 4 and 8 FIFOs) are specialized so that the stride is a
+// compile-time constant, letting the compiler unroll and vectorize the copy loops for the target
+static void * audiod_interleaved_copy_bytes_fast_decode(uint16_t const nBytesPerSample, void * dst, const void * dst_end, void * src, uint8_t const n_ff_used)
+{
+  switch (n_ff_used)
+  {
+    case 1:
+    {
+      // Stream is the FIFO content as is
+      size_t const n = (size_t) ((uint8_t const *) dst_end - (uint8_t *) dst);
+      memcpy(dst, src, n);
+      return (uint8_t *) src + n;
+    }
+
+    case 2:  return audiod_interleaved_copy_bytes_decode_n(nBytesPerSample, dst, dst_end, src, 2);
+    case 4:  return audiod_interleaved_copy_bytes_decode_n(nBytesPerSample, dst, dst_end, src, 4);
+    case 8:  return audiod_interleaved_copy_bytes_decode_n(nBytesPerSample, dst, dst_end, src, 8);
+    default: return audiod_interleaved_copy_bytes_decode_n(nBytesPerSample, dst, dst_end, src, n_ff_used);
+  }
+}
+
+#if AUDIOD_CONV_RX
+// De-interleave and convert: a subslot is little endian and left-justified i.e. its bytes are the most significant
+// bytes of a 32-bit sample, which is then reduced to the support FIFO format
+TU_ATTR_ALWAYS_INLINE static inline uint8_t const * audiod_conv_decode_n(uint8_t const format, uint8_t const subslot_sz, uint8_t * dst, uint8_t const * dst_end, uint8_t const * src, uint8_t const n_ch_per_ff, uint16_t const src_skip)
+{
+  uint8_t const sample_sz = audiod_conv_sample_size(format, subslot_sz);
+
+  while (dst < dst_end)
+  {
+    for (uint8_t ch = 0; ch < n_ch_per_ff; ch++)
+    {
+      uint32_t v = 0;
+      for (uint8_t i = 0; i < subslot_sz; i++)
+      {
+        v |= (uint32_t) src[i] << (8 * (4 - subslot_sz + i));
+      }
+      src += subslot_sz;
+
+      if (format == AUDIO_SUPP_FF_FORMAT_INT16)
+      {
+        tu_unaligned_write16(dst, (uint16_t) (v >> 16));
+      }
+      else if (format == AUDIO_SUPP_FF_FORMAT_INT32)
+      {
+        tu_unaligned_write32(dst, v);
+      }
+      else
+      {
+        float const f = (float) (int32_t) v * (1.0f / 2147483648.0f);
+        memcpy(dst, &f, 4);
+      }
+      dst += sample_sz;
+    }
+    src += src_skip;
+  }
+
+  return src;
+}
+
+// Common conversions are specialized so that sizes are compile-time constants
+static uint8_t const * audiod_conv_decode(audiod_function_t * audio, uint8_t * dst, uint8_t const * dst_end, uint8_t const * src)
+{
+  uint8_t const format      = audio->conv_format_rx;
+  uint8_t const subslot_sz  = audio->n_bytes_per_sampe_rx;
+  uint8_t const n_ch_per_ff = audio->n_channels_per_ff_rx;
+  uint16_t const src_skip   = (uint16_t) ((audio->n_ff_used_rx - 1) * n_ch_per_ff * subslot_sz);
+
+  switch ((format << 4) | subslot_sz)
+  {
+    case (AUDIO_SUPP_FF_FORMAT_INT32 << 4) | 3:   return audiod_conv_decode_n(AUDIO_SUPP_FF_FORMAT_INT32, 3, dst, dst_end, src, n_ch_per_ff, src_skip);
+    case (AUDIO_SUPP_FF_FORMAT_INT16 << 4) | 4:   return audiod_conv_decode_n(AUDIO_SUPP_FF_FORMAT_INT16, 4, dst, dst_end, src, n_ch_per_ff, src_skip);
+    case (AUDIO_SUPP_FF_FORMAT_FLOAT32 << 4) | 2: return audiod_conv_decode_n(AUDIO_SUPP_FF_FORMAT_FLOAT32, 2, dst, dst_end, src, n_ch_per_ff, src_skip);
+    case (AUDIO_SUPP_FF_FORMAT_FLOAT32 << 4) | 3: return audiod_conv_decode_n(AUDIO_SUPP_FF_FORMAT_FLOAT32, 3, dst, dst_end, src, n_ch_per_ff, src_skip);
+    default:                                      return audiod_conv_decode_n(format, subslot_sz, dst, dst_end, src, n_ch_per_ff, src_skip);
+  }
+}
+
+// Decoding with sample conversion, FIFO depth is a multiple of FIFO slot size and received data of wire slot size
+static bool audiod_decode_type_I_pcm_convert(audiod_function_t* audio, uint16_t n_bytes_received)
+{
+  uint8_t const n_ff_used     = audio->n_ff_used_rx;
+  uint16_t const wire_slot_sz = (uint16_t) (audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx);
+  uint16_t const ff_slot_sz   = (uint16_t) (audio->n_channels_per_ff_rx * audiod_conv_sample_size(audio->conv_format_rx, audio->n_bytes_per_sampe_rx));
+  uint16_t const n_slots      = (uint16_t) (n_bytes_received / n_ff_used / wire_slot_sz);
+
+  tu_fifo_buffer_info_t info;
+
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
+  {
+    tu_fifo_get_write_info(&audio->rx_supp_ff[cnt_ff], &info);
+
+    if (info.len_lin != 0)
+    {
+      uint8_t const * src = &audio->lin_buf_out[cnt_ff * wire_slot_sz];
+
+      info.len_lin = TU_MIN((uint16_t) (n_slots * ff_slot_sz), info.len_lin);
+      src = audiod_conv_decode(audio, info.ptr_lin, (uint8_t const *) info.ptr_lin + info.len_lin, src);
+
+      // Handle wrapped part of FIFO
+      info.len_wrap = TU_MIN((uint16_t) (n_slots * ff_slot_sz - info.len_lin), info.len_wrap);
+      if (info.len_wrap != 0)
+      {
+        audiod_conv_decode(audio, info.ptr_wrap, (uint8_t const *) info.ptr_wrap + info.len_wrap, src);
+      }
+      tu_fifo_advance_write_pointer(&audio->rx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
+    }
+  }
+
+  return true;
+}
+#endif
+
 static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, uint16_t n_bytes_received)
 {
   (void) rhport;
 
+#if AUDIOD_CONV_RX
+  if (audio->conv_format_rx != AUDIO_SUPP_FF_FORMAT_SUBSLOT) return audiod_decode_type_I_pcm_convert(audio, n_bytes_received);
+#endif
+
   // Determine amount of samples
   uint8_t const n_ff_used               = audio->n_ff_used_rx;
   uint16_t const nBytesPerFFToRead      = n_bytes_received / n_ff_used;
@@ -706,13 +1119,13 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 
     if (info.len_lin != 0)
     {
-      info.len_lin = tu_min16(nBytesPerFFToRead, info.len_lin);
+      info.len_lin = TU_MIN(nBytesPerFFToRead, info.len_lin);
       src = &audio->lin_buf_out[cnt_ff*audio->n_channels_per_ff_rx * audio->n_bytes_per_sampe_rx];
       dst_end = info.ptr_lin + info.len_lin;
       src = audiod_interleaved_copy_bytes_fast_decode(audio->n_bytes_per_sampe_rx, info.ptr_lin, dst_end, src, n_ff_used);
 
       // Handle wrapped part of FIFO
-      info.len_wrap = tu_min16(nBytesPerFFToRead - info.len_lin, info.len_wrap);
+      info.len_wrap = TU_MIN(nBytesPerFFToRead - info.len_lin, info.len_wrap);
       if (info.len_wrap != 0)
       {
         dst_end = info.ptr_wrap + info.len_wrap;
@@ -727,6 +1140,46 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 
   return true;
 }
+
+#if AUDIOD_BLOCK_RX
+// Hand over decoded samples in blocks of CFG_TUD_AUDIO_BLOCK_FRAMES frames as long as all support FIFOs in use hold one
+static void audiod_rx_block(audiod_function_t* audio)
+{
+  if (!tud_audio_rx_block_cb) return;
+
+  uint8_t const n_ff_used  = audio->n_ff_used_rx;
+  uint8_t const ch_per_ff  = audio->n_channels_per_ff_rx;
+  uint8_t const n_channels = (uint8_t) (n_ff_used * ch_per_ff);
+#if AUDIOD_CONV_RX
+  uint8_t const bps = audiod_conv_sample_size(audio->conv_format_rx, audio->n_bytes_per_sampe_rx);
+#else
+  uint8_t const bps = audio->n_bytes_per_sampe_rx;
+#endif
+  tu_fifo_size_t const nBytesPerFF = (tu_fifo_size_t) (CFG_TUD_AUDIO_BLOCK_FRAMES * ch_per_ff * bps);
+
+  if (n_channels == 0 || n_channels > CFG_TUD_AUDIO_BLOCK_CHANNELS_MAX || bps == 0) return;
+
+  uint8_t const func_id = audiod_get_audio_fct_idx(audio);
+
+  while (1)
+  {
+    for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
+    {
+      if (tu_fifo_count(&audio->rx_supp_ff[cnt_ff]) < nBytesPerFF) return;
+    }
+
+    for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
+    {
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_read_info(&audio->rx_supp_ff[cnt_ff], &info);
+      audiod_block_copy(&info, true, n_channels, (uint8_t) (cnt_ff * ch_per_ff), ch_per_ff, bps);
+      tu_fifo_advance_read_pointer(&audio->rx_supp_ff[cnt_ff], nBytesPerFF);
+    }
+
+    tud_audio_rx_block_cb(func_id, _audiod_block_buf, CFG_TUD_AUDIO_BLOCK_FRAMES, n_channels, bps);
+  }
+}
+#endif
 #endif //CFG_TUD_AUDIO_ENABLE_DECODING
 
 //--------------------------------------------------------------------+
@@ -749,9 +1202,47 @@ static bool audiod_decode_type_I_pcm(uint8_t rhport, audiod_function_t* audio, u
 uint16_t tud_audio_n_write(uint8_t func_id, const void * data, uint16_t len)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  AUDIOD_STATS( if (tu_fifo_remaining(&_audiod_fct[func_id].ep_in_ff) < len) _audiod_fct[func_id].stats.tx.overrun++; )
   return tu_fifo_write_n(&_audiod_fct[func_id].ep_in_ff, data, len);
 }
 
+/**
+ * \brief           Get free space of EP in buffer to be filled in place
+ *
+ *  Zero-copy alternative to tud_audio_n_write() e.g for I2S DMA. The buffer is sent with usbd_edpt_xfer_fifo()
+ *  without intermediate copy. No other write must happen until data is committed with tud_audio_n_write_commit().
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[out]      info: Linear and wrapped part of free space
+ * \return          Number of bytes available
+ */
+uint16_t tud_audio_n_write_reserve(uint8_t func_id, tu_fifo_buffer_info_t* info)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_get_write_info(&_audiod_fct[func_id].ep_in_ff, info);
+  return (uint16_t) (info->len_lin + info->len_wrap);
+}
+
+/**
+ * \brief           Commit data filled in place after tud_audio_n_write_reserve()
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[in]       len: # of bytes filled
+ * \return          Number of bytes actually committed
+ */
+uint16_t tud_audio_n_write_commit(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_t* ff = &_audiod_fct[func_id].ep_in_ff;
+
+  tu_fifo_size_t const remaining = tu_fifo_remaining(ff);
+  AUDIOD_STATS( if (remaining < len) _audiod_fct[func_id].stats.tx.overrun++; )
+
+  len = (uint16_t) TU_MIN(len, remaining);
+  tu_fifo_advance_write_pointer(ff, len);
+  return len;
+}
+
 bool tud_audio_n_clear_ep_in_ff(uint8_t func_id)                          // Delete all content in the EP IN FIFO
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
@@ -764,6 +1255,90 @@ tu_fifo_t* tud_audio_n_get_ep_in_ff(uint8_t func_id)
   return NULL;
 }
 
+/**
+ * \brief           Bind EP in buffer to a circular DMA ring
+ *
+ *  Zero-copy alternative to tud_audio_n_write() e.g for I2S/SAI capture. FIFO is cleared so that its write position
+ *  is at buffer start, where the circular DMA must be started. USB sends data behind the DMA position,
+ *  tud_audio_n_ep_in_dma_advance() must be called for every part (typically half) of the ring filled by DMA.
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[out]      buffer: Start of FIFO storage to be used as DMA ring
+ * \param[out]      size: Size of DMA ring in bytes
+ * \return          false if audio function is not available
+ */
+bool tud_audio_n_ep_in_dma_ring(uint8_t func_id, void** buffer, uint16_t* size)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  tu_fifo_t* ff = &_audiod_fct[func_id].ep_in_ff;
+
+  tu_fifo_clear(ff);
+  _audiod_fct[func_id].ep_in_dma.advanced = 0;
+  _audiod_fct[func_id].ep_in_dma.applied  = 0;
+
+  *buffer = ff->buffer;
+  *size   = (uint16_t) tu_fifo_depth(ff);
+  return true;
+}
+
+// Move EP in FIFO along with DMA, deferred from tud_audio_n_ep_in_dma_advance() to usbd task
+static void audiod_ep_in_dma_apply(void* param)
+{
+  audiod_function_t* audio = (audiod_function_t*) param;
+  tu_fifo_t* ff = &audio->ep_in_ff;
+
+  uint32_t const advanced = audio->ep_in_dma.advanced;
+  uint32_t n = advanced - audio->ep_in_dma.applied;
+
+  // DCD moves read position in ISR
+  usbd_spin_lock(false);
+
+  while (n)
+  {
+    tu_fifo_size_t const len       = (tu_fifo_size_t) TU_MIN(n, tu_fifo_depth(ff));
+    tu_fifo_size_t const remaining = tu_fifo_remaining(ff);
+
+    // Overflow: host does not fetch fast enough and DMA has overwritten oldest data, drop it
+    if (remaining < len)
+    {
+      tu_fifo_advance_read_pointer(ff, (tu_fifo_size_t) (len - remaining));
+      AUDIOD_STATS( audio->stats.tx.overrun++; )
+    }
+
+    tu_fifo_advance_write_pointer(ff, len);
+    n -= len;
+  }
+
+  usbd_spin_unlock(false);
+
+  audio->ep_in_dma.applied = advanced;
+}
+
+/**
+ * \brief           Advance EP in buffer by bytes written by DMA, called from DMA half/full transfer interrupt
+ *
+ *  Only the DMA progress is recorded here, FIFO is moved in usbd task since DCD modifies it in USB interrupt.
+ *
+ * \param[in]       func_id: Index of audio function interface
+ * \param[in]       len: # of bytes written by DMA since last call
+ * \return          Number of bytes added without overwriting unsent data, the rest was an overflow
+ */
+uint16_t tud_audio_n_ep_in_dma_advance(uint8_t func_id, uint16_t len)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
+  audiod_function_t* audio = &_audiod_fct[func_id];
+
+  // data written by previous calls still waiting for usbd task
+  uint32_t const pending   = audio->ep_in_dma.advanced - audio->ep_in_dma.applied;
+  uint32_t const remaining = tu_fifo_remaining(&audio->ep_in_ff);
+  uint32_t const avail     = (remaining > pending) ? (remaining - pending) : 0;
+
+  audio->ep_in_dma.advanced += len;
+  usbd_defer_func(audiod_ep_in_dma_apply, audio, true);
+
+  return (uint16_t) TU_MIN(avail, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN
@@ -773,14 +1348,14 @@ uint16_t tud_audio_n_flush_tx_support_ff(uint8_t func_id)                 // For
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
   audiod_function_t* audio = &_audiod_fct[func_id];
 
-  uint16_t n_bytes_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
+  tu_fifo_size_t n_bytes_copied = tu_fifo_count(&audio->tx_supp_ff[0]);
 
   TU_VERIFY(audiod_tx_done_cb(audio->rhport, audio));
 
   n_bytes_copied -= tu_fifo_count(&audio->tx_supp_ff[0]);
   n_bytes_copied = n_bytes_copied*audio->tx_supp_ff[0].item_size;
 
-  return n_bytes_copied;
+  return (uint16_t) n_bytes_copied;
 }
 
 bool tud_audio_n_clear_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
@@ -792,6 +1367,7 @@ bool tud_audio_n_clear_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
 uint16_t tud_audio_n_write_support_ff(uint8_t func_id, uint8_t ff_idx, const void * data, uint16_t len)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL && ff_idx < _audiod_fct[func_id].n_tx_supp_ff);
+  AUDIOD_STATS( if (tu_fifo_remaining(&_audiod_fct[func_id].tx_supp_ff[ff_idx]) < len) _audiod_fct[func_id].stats.tx.overrun++; )
   return tu_fifo_write_n(&_audiod_fct[func_id].tx_supp_ff[ff_idx], data, len);
 }
 
@@ -801,6 +1377,15 @@ tu_fifo_t* tud_audio_n_get_tx_support_ff(uint8_t func_id, uint8_t ff_idx)
   return NULL;
 }
 
+#if AUDIOD_CONV_TX
+bool tud_audio_n_set_tx_support_ff_format(uint8_t func_id, audio_supp_ff_format_t format)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO && format <= AUDIO_SUPP_FF_FORMAT_FLOAT32);
+  _audiod_fct[func_id].supp_ff_format_tx = (uint8_t) format;
+  return true;
+}
+#endif
+
 #endif
 
 
@@ -853,8 +1438,20 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
   // Send everything in ISO EP FIFO
   uint16_t n_bytes_tx;
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+#if CFG_TUD_AUDIO_ENABLE_ENCODING
+  audiod_stats_level(&audio->stats.tx, tu_fifo_count(&audio->tx_supp_ff[0]));
+#else
+  audiod_stats_level(&audio->stats.tx, tu_fifo_count(&audio->ep_in_ff));
+#endif
+#endif
+
   // If support FIFOs are used, encode and schedule transmit
 #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_EP_IN
+#if AUDIOD_BLOCK_TX
+  audiod_tx_block(audio);
+#endif
+
   switch (audio->format_type_tx)
   {
     case AUDIO_FORMAT_TYPE_UNDEFINED:
@@ -895,10 +1492,10 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 #else
   // No support FIFOs, if no linear buffer required schedule transmit, else put data into linear buffer and schedule
 #if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
-  // packet_sz_tx is based on total packet size, here we want size for each support buffer.
-  n_bytes_tx = audiod_tx_packet_size(audio->packet_sz_tx, tu_fifo_count(&audio->ep_in_ff), audio->ep_in_ff.depth, audio->ep_in_sz);
+  n_bytes_tx = audiod_tx_packet_size(audio, (uint16_t) (audio->n_channels_tx * audio->n_bytes_per_sampe_tx),
+                                     tu_fifo_count(&audio->ep_in_ff), audio->ep_in_ff.depth, audio->ep_in_sz);
 #else
-  n_bytes_tx = tu_min16(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
+  n_bytes_tx = (uint16_t) TU_MIN(tu_fifo_count(&audio->ep_in_ff), audio->ep_in_sz);      // Limit up to max packet size, more can not be done for ISO
 #endif
 #if USE_LINEAR_BUFFER_TX
   tu_fifo_read_n(&audio->ep_in_ff, audio->lin_buf_in, n_bytes_tx);
@@ -908,6 +1505,22 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
   TU_VERIFY(usbd_edpt_xfer_fifo(rhport, audio->ep_in, &audio->ep_in_ff, n_bytes_tx));
 #endif
 
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_STATS
+  if (n_bytes_tx == 0)
+  {
+    audio->stats.tx.underrun++;
+  }
+#if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  else if (audio->packet_sz_tx[1] != 0)
+  {
+    int32_t const dev = (int32_t) n_bytes_tx - (int32_t) audio->packet_sz_tx[1];
+    if (dev != 0) audio->stats.tx_size_dev_count++;
+    if (dev < audio->stats.tx_size_dev_min) audio->stats.tx_size_dev_min = dev;
+    if (dev > audio->stats.tx_size_dev_max) audio->stats.tx_size_dev_max = dev;
+  }
+#endif
 #endif
 
   // Call a weak callback here - a possibility for user to get informed former TX was completed and how many bytes were loaded for the next frame
@@ -922,71 +1535,279 @@ static bool audiod_tx_done_cb(uint8_t rhport, audiod_function_t * audio)
 // Take samples from the support buffer and encode them into the IN EP software FIFO
 // Returns number of bytes written into linear buffer
 
-/* 2.3.1.7.1 PCM Format
-The PCM (Pulse Coded Modulation) format is the most commonly used audio format to represent audio
-data streams. The audio data is not compressed and uses a signed two’s-complement fixed point format. It
-is left-justified (the sign bit is the Msb) and data is padded with trailing zeros to fill the remaining unused
-bits of the subslot. The binary point is located to the right of the sign bit so that all values lie within the
-range [-1, +1)
- */
+/* 2.3.1.7.1 PCM Format
+The PCM (Pulse Coded Modulation) format is the most commonly used audio format to represent audio
+data streams. The audio data is not compressed and uses a signed two’s-complement fixed point format. It
+is left-justified (the sign bit is the Msb) and data is padded with trailing zeros to fill the remaining unused
+bits of the subslot. The binary point is located to the right of the sign bit so that all values lie within the
+range [-1, +1)
+ */
+
+/*
+ * This function encodes channels saved within the support FIFOs into one stream by interleaving the PCM samples
+ * in the support FIFOs according to 2.3.1.5 Audio Streams. It does not control justification (left or right) and
+ * does not change the number of bytes per sample.
+ * */
+
+// Helper function
+TU_ATTR_ALWAYS_INLINE static inline void * audiod_interleaved_copy_bytes_encode_n(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+{
+  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
+  uint16_t * dst16 = dst;
+  uint16_t * src16 = src;
+  const uint16_t * src_end16 = src_end;
+  uint32_t * dst32 = dst;
+  uint32_t * src32 = src;
+  const uint32_t * src_end32 = src_end;
+
+  if (nBytesPerSample == 1)
+  {
+    while(src16 < src_end16)
+    {
+      *dst16++ = *src16++;
+      dst16 += n_ff_used - 1;
+    }
+    return dst16;
+  }
+  else if (nBytesPerSample == 2)
+  {
+    while(src32 < src_end32)
+    {
+      *dst32++ = *src32++;
+      dst32 += n_ff_used - 1;
+    }
+    return dst32;
+  }
+  else if (nBytesPerSample == 3)
+  {
+    while(src16 < src_end16)
+    {
+#if !TUP_ARCH_STRICT_ALIGN && !TUP_MCU_STRICT_ALIGN
+      // 6-byte slot is only 2-byte aligned, copy it with one unaligned word and one half-word
+      tu_unaligned_write32(dst16, tu_unaligned_read32(src16));
+      dst16[2] = src16[2];
+      dst16 += 3;
+      src16 += 3;
+#else
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+      *dst16++ = *src16++;
+#endif
+      dst16 += 3 * (n_ff_used - 1);
+    }
+    return dst16;
+  }
+  else // nBytesPerSample == 4
+  {
+    while(src32 < src_end32)
+    {
+      *dst32++ = *src32++;
+      *dst32++ = *src32++;
+      dst32 += 2 * (n_ff_used - 1);
+    }
+    return dst32;
+  }
+}
+
+// Common layouts of 2, 4, 8 and 16 channels (1, 2, 4 and 8 FIFOs) are specialized so that the stride is a
+// compile-time constant, letting the compiler unroll and vectorize the copy loops for the target
+static void * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+{
+  switch (n_ff_used)
+  {
+    case 1:
+    {
+      // FIFO content is the stream as is
+      size_t const n = (size_t) ((uint8_t const *) src_end - (uint8_t *) src);
+      memcpy(dst, src, n);
+      return (uint8_t *) dst + n;
+    }
+
+    case 2:  return audiod_interleaved_copy_bytes_encode_n(nBytesPerSample, src, src_end, dst, 2);
+    case 4:  return audiod_interleaved_copy_bytes_encode_n(nBytesPerSample, src, src_end, dst, 4);
+    case 8:  return audiod_interleaved_copy_bytes_encode_n(nBytesPerSample, src, src_end, dst, 8);
+    default: return audiod_interleaved_copy_bytes_encode_n(nBytesPerSample, src, src_end, dst, n_ff_used);
+  }
+}
+
+#if AUDIOD_CONV_TX
+// Convert float to integer of subslot resolution with TPDF dither of +-1 LSB, returned left-justified
+TU_ATTR_ALWAYS_INLINE static inline uint32_t audiod_conv_float_to_int(uint8_t const * src, uint8_t const subslot_sz, uint32_t * dither_state)
+{
+  float f;
+  memcpy(&f, src, 4);
+
+  uint8_t const n_bits = (uint8_t) (8 * subslot_sz);
+  float const scale = (float) (1UL << (n_bits - 1));
+
+  // Triangular distribution is the difference of two uniform ones, taken from both halves of a LCG state
+  *dither_state = *dither_state * 1664525UL + 1013904223UL;
+  float const dither = (float) ((int32_t) (*dither_state & 0xFFFF) - (int32_t) (*dither_state >> 16)) * (1.0f / 65536.0f);
+
+  float const x = f * scale + dither + 0.5f;
+
+  // Saturate, NaN gives minimum
+  if (!(x >= -scale)) return (uint32_t) INT32_MIN;
+  if (x >= scale) return (uint32_t) INT32_MAX;
+
+  // Round by flooring x + 0.5
+  int32_t i = (int32_t) x;
+  if ((float) i > x) i--;
+
+  return (uint32_t) i << (32 - n_bits);
+}
+
+// Convert and interleave: samples of support FIFO format are made 32-bit left-justified, of which the most
+// significant bytes form the little endian subslot
+TU_ATTR_ALWAYS_INLINE static inline uint8_t * audiod_conv_encode_n(uint8_t const format, uint8_t const subslot_sz, uint8_t const * src, uint8_t const * src_end, uint8_t * dst, uint8_t const n_ch_per_ff, uint16_t const dst_skip, uint32_t * dither_state)
+{
+  uint8_t const sample_sz = audiod_conv_sample_size(format, subslot_sz);
+
+  while (src < src_end)
+  {
+    for (uint8_t ch = 0; ch < n_ch_per_ff; ch++)
+    {
+      uint32_t v;
+      if (format == AUDIO_SUPP_FF_FORMAT_INT16)
+      {
+        v = (uint32_t) tu_unaligned_read16(src) << 16;
+      }
+      else if (format == AUDIO_SUPP_FF_FORMAT_INT32)
+      {
+        v = tu_unaligned_read32(src);
+      }
+      else
+      {
+        v = audiod_conv_float_to_int(src, subslot_sz, dither_state);
+      }
+      src += sample_sz;
+
+      for (uint8_t i = 0; i < subslot_sz; i++)
+      {
+        dst[i] = (uint8_t) (v >> (8 * (4 - subslot_sz + i)));
+      }
+      dst += subslot_sz;
+    }
+    dst += dst_skip;
+  }
+
+  return dst;
+}
+
+// Common conversions are specialized so that sizes are compile-time constants
+static uint8_t * audiod_conv_encode(audiod_function_t * audio, uint8_t const * src, uint8_t const * src_end, uint8_t * dst)
+{
+  uint8_t const format      = audio->conv_format_tx;
+  uint8_t const subslot_sz  = audio->n_bytes_per_sampe_tx;
+  uint8_t const n_ch_per_ff = audio->n_channels_per_ff_tx;
+  uint16_t const dst_skip   = (uint16_t) ((audio->n_ff_used_tx - 1) * n_ch_per_ff * subslot_sz);
+  uint32_t * dither_state   = &audio->dither_state_tx;
 
-/*
- * This function encodes channels saved within the support FIFOs into one stream by interleaving the PCM samples
- * in the support FIFOs according to 2.3.1.5 Audio Streams. It does not control justification (left or right) and
- * does not change the number of bytes per sample.
- * */
+  switch ((format << 4) | subslot_sz)
+  {
+    case (AUDIO_SUPP_FF_FORMAT_INT32 << 4) | 3:   return audiod_conv_encode_n(AUDIO_SUPP_FF_FORMAT_INT32, 3, src, src_end, dst, n_ch_per_ff, dst_skip, dither_state);
+    case (AUDIO_SUPP_FF_FORMAT_INT16 << 4) | 4:   return audiod_conv_encode_n(AUDIO_SUPP_FF_FORMAT_INT16, 4, src, src_end, dst, n_ch_per_ff, dst_skip, dither_state);
+    case (AUDIO_SUPP_FF_FORMAT_FLOAT32 << 4) | 2: return audiod_conv_encode_n(AUDIO_SUPP_FF_FORMAT_FLOAT32, 2, src, src_end, dst, n_ch_per_ff, dst_skip, dither_state);
+    case (AUDIO_SUPP_FF_FORMAT_FLOAT32 << 4) | 3: return audiod_conv_encode_n(AUDIO_SUPP_FF_FORMAT_FLOAT32, 3, src, src_end, dst, n_ch_per_ff, dst_skip, dither_state);
+    default:                                      return audiod_conv_encode_n(format, subslot_sz, src, src_end, dst, n_ch_per_ff, dst_skip, dither_state);
+  }
+}
 
-// Helper function
-static inline void * audiod_interleaved_copy_bytes_fast_encode(uint16_t const nBytesPerSample, void * src, const void * src_end, void * dst, uint8_t const n_ff_used)
+// Encoding with sample conversion, sizes are computed in slots since FIFO and wire slot sizes differ
+static uint16_t audiod_encode_type_I_pcm_convert(audiod_function_t* audio)
 {
-  // Due to one FIFO contains 2 channels, data always aligned to (nBytesPerSample * 2)
-  uint16_t * dst16 = dst;
-  uint16_t * src16 = src;
-  const uint16_t * src_end16 = src_end;
-  uint32_t * dst32 = dst;
-  uint32_t * src32 = src;
-  const uint32_t * src_end32 = src_end;
+  uint8_t const n_ff_used     = audio->n_ff_used_tx;
+  uint16_t const wire_slot_sz = (uint16_t) (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx);
+  uint16_t const ff_slot_sz   = (uint16_t) (audio->n_channels_per_ff_tx * audiod_conv_sample_size(audio->conv_format_tx, audio->n_bytes_per_sampe_tx));
 
-  if (nBytesPerSample == 1)
+  tu_fifo_size_t n_slots = tu_fifo_count(&audio->tx_supp_ff[0]) / ff_slot_sz;
+  for (uint8_t cnt_ff = 1; cnt_ff < n_ff_used; cnt_ff++)
   {
-    while(src16 < src_end16)
-    {
-      *dst16++ = *src16++;
-      dst16 += n_ff_used - 1;
-    }
-    return dst16;
+    n_slots = TU_MIN(n_slots, tu_fifo_count(&audio->tx_supp_ff[cnt_ff]) / ff_slot_sz);
   }
-  else if (nBytesPerSample == 2)
+
+#if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  // Flow control works on wire sizes
+  uint16_t const n_wire = audiod_tx_packet_size(audio, wire_slot_sz, (tu_fifo_size_t) (n_slots * wire_slot_sz),
+                                                (tu_fifo_size_t) (audio->tx_supp_ff[0].depth / ff_slot_sz * wire_slot_sz),
+                                                audio->ep_in_sz / n_ff_used);
+  n_slots = n_wire / wire_slot_sz;
+#else
+  n_slots = TU_MIN(n_slots, (tu_fifo_size_t) (audio->ep_in_sz / n_ff_used / wire_slot_sz));
+#endif
+
+  if (n_slots == 0) return 0;
+
+  tu_fifo_size_t const nBytesPerFFToSend = (tu_fifo_size_t) (n_slots * ff_slot_sz);
+  tu_fifo_buffer_info_t info;
+
+  for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
   {
-    while(src32 < src_end32)
+    uint8_t * dst = &audio->lin_buf_in[cnt_ff * wire_slot_sz];
+
+    tu_fifo_get_read_info(&audio->tx_supp_ff[cnt_ff], &info);
+
+    info.len_lin = TU_MIN(nBytesPerFFToSend, info.len_lin);
+    dst = audiod_conv_encode(audio, info.ptr_lin, (uint8_t const *) info.ptr_lin + info.len_lin, dst);
+
+    // Handle wrapped part of FIFO
+    info.len_wrap = TU_MIN(nBytesPerFFToSend - info.len_lin, info.len_wrap);
+    if (info.len_wrap != 0)
     {
-      *dst32++ = *src32++;
-      dst32 += n_ff_used - 1;
+      audiod_conv_encode(audio, info.ptr_wrap, (uint8_t const *) info.ptr_wrap + info.len_wrap, dst);
     }
-    return dst32;
+
+    tu_fifo_advance_read_pointer(&audio->tx_supp_ff[cnt_ff], info.len_lin + info.len_wrap);
   }
-  else if (nBytesPerSample == 3)
+
+  return (uint16_t) (n_slots * wire_slot_sz * n_ff_used);
+}
+#endif
+
+#if AUDIOD_BLOCK_TX
+// Request blocks of CFG_TUD_AUDIO_BLOCK_FRAMES frames from application until support FIFOs hold one block plus one
+// packet: the next packet can always be encoded while latency stays at a minimum
+static void audiod_tx_block(audiod_function_t* audio)
+{
+  if (!tud_audio_tx_block_cb) return;
+
+  uint8_t const n_ff_used  = audio->n_ff_used_tx;
+  uint8_t const ch_per_ff  = audio->n_channels_per_ff_tx;
+  uint8_t const n_channels = (uint8_t) (n_ff_used * ch_per_ff);
+#if AUDIOD_CONV_TX
+  uint8_t const bps = audiod_conv_sample_size(audio->conv_format_tx, audio->n_bytes_per_sampe_tx);
+#else
+  uint8_t const bps = audio->n_bytes_per_sampe_tx;
+#endif
+
+  if (n_channels == 0 || n_channels > CFG_TUD_AUDIO_BLOCK_CHANNELS_MAX || bps == 0 || audio->n_channels_tx == 0) return;
+
+  uint16_t const nFramesPerPacket = (uint16_t) (audio->ep_in_sz / (audio->n_channels_tx * audio->n_bytes_per_sampe_tx));
+  tu_fifo_size_t const nBytesPerFF = (tu_fifo_size_t) (CFG_TUD_AUDIO_BLOCK_FRAMES * ch_per_ff * bps);
+  uint32_t const target = (uint32_t) (CFG_TUD_AUDIO_BLOCK_FRAMES + nFramesPerPacket) * ch_per_ff * bps;
+
+  uint8_t const func_id = audiod_get_audio_fct_idx(audio);
+
+  while (1)
   {
-    while(src16 < src_end16)
+    for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
     {
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      *dst16++ = *src16++;
-      dst16 += 3 * (n_ff_used - 1);
+      tu_fifo_t* ff = &audio->tx_supp_ff[cnt_ff];
+      if (tu_fifo_count(ff) >= target || tu_fifo_remaining(ff) < nBytesPerFF) return;
     }
-    return dst16;
-  }
-  else // nBytesPerSample == 4
-  {
-    while(src32 < src_end32)
+
+    if (!tud_audio_tx_block_cb(func_id, _audiod_block_buf, CFG_TUD_AUDIO_BLOCK_FRAMES, n_channels, bps)) return;
+
+    for (uint8_t cnt_ff = 0; cnt_ff < n_ff_used; cnt_ff++)
     {
-      *dst32++ = *src32++;
-      *dst32++ = *src32++;
-      dst32 += 2 * (n_ff_used - 1);
+      tu_fifo_buffer_info_t info;
+      tu_fifo_get_write_info(&audio->tx_supp_ff[cnt_ff], &info);
+      audiod_block_copy(&info, false, n_channels, (uint8_t) (cnt_ff * ch_per_ff), ch_per_ff, bps);
+      tu_fifo_advance_write_pointer(&audio->tx_supp_ff[cnt_ff], nBytesPerFF);
     }
-    return dst32;
   }
 }
+#endif
 
 static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audio)
 {
@@ -996,14 +1817,18 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   // We encode directly into IN EP's linear buffer - abort if previous transfer not complete
   TU_VERIFY(!usbd_edpt_busy(rhport, audio->ep_in));
 
+#if AUDIOD_CONV_TX
+  if (audio->conv_format_tx != AUDIO_SUPP_FF_FORMAT_SUBSLOT) return audiod_encode_type_I_pcm_convert(audio);
+#endif
+
   // Determine amount of samples
   uint8_t const n_ff_used               = audio->n_ff_used_tx;
-  uint16_t nBytesPerFFToSend            = tu_fifo_count(&audio->tx_supp_ff[0]);
+  tu_fifo_size_t nBytesPerFFToSend      = tu_fifo_count(&audio->tx_supp_ff[0]);
   uint8_t cnt_ff;
 
   for (cnt_ff = 1; cnt_ff < n_ff_used; cnt_ff++)
   {
-    uint16_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
+    tu_fifo_size_t const count = tu_fifo_count(&audio->tx_supp_ff[cnt_ff]);
     if (count < nBytesPerFFToSend)
     {
       nBytesPerFFToSend = count;
@@ -1011,18 +1836,16 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
   }
 
 #if CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
-  const uint16_t norm_packet_sz_tx[3] = {audio->packet_sz_tx[0] / n_ff_used,
-                                         audio->packet_sz_tx[1] / n_ff_used,
-                                         audio->packet_sz_tx[2] / n_ff_used};
-  // packet_sz_tx is based on total packet size, here we want size for each support buffer.
-  nBytesPerFFToSend = audiod_tx_packet_size(norm_packet_sz_tx, nBytesPerFFToSend, audio->tx_supp_ff[0].depth, audio->ep_in_sz / n_ff_used);
+  // Schedule is based on total packet size, here we want size for each support buffer.
+  nBytesPerFFToSend = audiod_tx_packet_size(audio, (uint16_t) (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx),
+                                            nBytesPerFFToSend, audio->tx_supp_ff[0].depth, audio->ep_in_sz / n_ff_used);
   // Check if there is enough data
   if (nBytesPerFFToSend == 0)    return 0;
 #else
   // Check if there is enough data
   if (nBytesPerFFToSend == 0)    return 0;
   // Limit to maximum sample number - THIS IS A POSSIBLE ERROR SOURCE IF TOO MANY SAMPLE WOULD NEED TO BE SENT BUT CAN NOT!
-  nBytesPerFFToSend = tu_min16(nBytesPerFFToSend, audio->ep_in_sz / n_ff_used);
+  nBytesPerFFToSend = TU_MIN(nBytesPerFFToSend, (tu_fifo_size_t) (audio->ep_in_sz / n_ff_used));
   // Round to full number of samples (flooring)
   uint16_t const nSlotSize = audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx;
   nBytesPerFFToSend = (nBytesPerFFToSend / nSlotSize) * nSlotSize;
@@ -1042,12 +1865,12 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
 
     if (info.len_lin != 0)
     {
-      info.len_lin = tu_min16(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
+      info.len_lin = TU_MIN(nBytesPerFFToSend, info.len_lin);       // Limit up to desired length
       src_end = (uint8_t *)info.ptr_lin + info.len_lin;
       dst = audiod_interleaved_copy_bytes_fast_encode(audio->n_bytes_per_sampe_tx, info.ptr_lin, src_end, dst, n_ff_used);
 
       // Limit up to desired length
-      info.len_wrap = tu_min16(nBytesPerFFToSend - info.len_lin, info.len_wrap);
+      info.len_wrap = TU_MIN(nBytesPerFFToSend - info.len_lin, info.len_wrap);
 
       // Handle wrapped part of FIFO
       if (info.len_wrap != 0)
@@ -1060,7 +1883,7 @@ static uint16_t audiod_encode_type_I_pcm(uint8_t rhport, audiod_function_t* audi
     }
   }
 
-  return nBytesPerFFToSend * n_ff_used;
+  return (uint16_t) (nBytesPerFFToSend * n_ff_used);
 }
 #endif //CFG_TUD_AUDIO_ENABLE_ENCODING
 
@@ -1084,6 +1907,10 @@ void audiod_init(void)
   {
     audiod_function_t* audio = &_audiod_fct[i];
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+    tud_audio_n_stats_clear(i);
+#endif
+
     // Initialize control buffers
     switch (i)
     {
@@ -1511,13 +2338,13 @@ uint16_t audiod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_IN
                   ep_in = desc_ep->bEndpointAddress;
-                  ep_in_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_in_size);
+                  ep_in_size = TU_MAX(tu_edpt_max_payload(desc_ep), ep_in_size);
   #endif
                 } else
                 {
   #if CFG_TUD_AUDIO_ENABLE_EP_OUT
                   ep_out = desc_ep->bEndpointAddress;
-                  ep_out_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_out_size);
+                  ep_out_size = TU_MAX(tu_edpt_max_payload(desc_ep), ep_out_size);
   #endif
                 }
               }
@@ -1639,6 +2466,35 @@ static bool audiod_get_interface(uint8_t rhport, tusb_control_request_t const *
   return true;
 }
 
+// Invoked after the application accepted SET_CUR of a sampling frequency control. Streaming continues without
+// toggling alternate settings: FIFO contents and endpoints stay untouched, feedback is re-seeded with the nominal
+// value of the new rate and the IN packet schedule is recomputed keeping its phase.
+static void audiod_sample_rate_changed(uint8_t rhport, uint8_t func_id, uint8_t entityID)
+{
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  (void) rhport;
+  (void) entityID;
+  (void) audio;
+
+#if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  if (audio->bclock_id_tx == entityID)
+  {
+    audio->sample_rate_tx = tu_le32toh(tu_unaligned_read32(audio->ctrl_buf));
+    if (audio->ep_in) audiod_calc_tx_packet_sz(audio);
+  }
+#endif
+
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
+  // Clock of OUT stream is not tracked, application reports the new rate in tud_audio_feedback_params_cb()
+  uint8_t idxItf;
+  uint8_t const *p_desc;
+  if (audio->ep_fb && audiod_get_AS_interface_index(audio->ep_out_as_intf_num, audio, &idxItf, &p_desc))
+  {
+    audiod_fb_params_prepare(rhport, func_id, audio->alt_setting[idxItf]);
+  }
+#endif
+}
+
 static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const * p_request)
 {
   (void) rhport;
@@ -1739,6 +2595,15 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
   // Get pointer at end
   uint8_t const *p_desc_end = audio->p_desc + audio->desc_length - TUD_AUDIO_DESC_IAD_LEN;
 
+#if CFG_TUD_ITF_INDEX_SZ
+  // Jump straight to the alternate setting if indexed, the search below then matches at once
+  uint8_t const *p_desc_alt = (uint8_t const *) usbd_itf_desc_find(itf, alt, NULL);
+  if (p_desc_alt && p_desc <= p_desc_alt && p_desc_alt < p_desc_end)
+  {
+    p_desc = p_desc_alt;
+  }
+#endif
+
   // p_desc starts at required interface with alternate setting zero
   while (p_desc < p_desc_end)
   {
@@ -1771,7 +2636,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_in = ep_addr;
             audio->ep_in_as_intf_num = itf;
-            audio->ep_in_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_in_sz = tu_edpt_max_payload(desc_ep);
 
             // If software encoding is enabled, parse for the corresponding parameters - doing this here means only AS interfaces with EPs get scanned for parameters
   #if CFG_TUD_AUDIO_ENABLE_ENCODING || CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
@@ -1779,8 +2644,15 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
-            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx))
-               * (audio->n_channels_per_ff_tx * audio->n_bytes_per_sampe_tx));
+      #if AUDIOD_CONV_TX
+            // FIFOs hold samples in format of application
+            audio->conv_format_tx = audiod_conv_format(audio->supp_ff_format_tx, audio->n_bytes_per_sampe_tx);
+            const uint8_t ff_sample_sz = audiod_conv_sample_size(audio->conv_format_tx, audio->n_bytes_per_sampe_tx);
+      #else
+            const uint8_t ff_sample_sz = audio->n_bytes_per_sampe_tx;
+      #endif
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->tx_supp_ff_sz_max / (audio->n_channels_per_ff_tx * ff_sample_sz))
+               * (audio->n_channels_per_ff_tx * ff_sample_sz));
             for (uint8_t cnt = 0; cnt < audio->n_tx_supp_ff; cnt++)
             {
               tu_fifo_config(&audio->tx_supp_ff[cnt], audio->tx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
@@ -1803,14 +2675,22 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             // Save address
             audio->ep_out = ep_addr;
             audio->ep_out_as_intf_num = itf;
-            audio->ep_out_sz = tu_edpt_packet_size(desc_ep);
+            audio->ep_out_sz = tu_edpt_max_payload(desc_ep);
 
   #if CFG_TUD_AUDIO_ENABLE_DECODING
             audiod_parse_for_AS_params(audio, p_desc_parse_for_params, p_desc_end, itf);
 
             // Reconfigure size of support FIFOs - this is necessary to avoid samples to get split in case of a wrap
     #if CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+      #if AUDIOD_CONV_RX
+            // FIFOs hold samples in format of application, whole slots are converted at once
+            audio->conv_format_rx = audiod_conv_format(audio->supp_ff_format_rx, audio->n_bytes_per_sampe_rx);
+            const uint16_t ff_slot_sz = (audio->conv_format_rx == AUDIO_SUPP_FF_FORMAT_SUBSLOT) ? audio->n_bytes_per_sampe_rx :
+                (uint16_t) (audio->n_channels_per_ff_rx * audiod_conv_sample_size(audio->conv_format_rx, audio->n_bytes_per_sampe_rx));
+            const uint16_t active_fifo_depth = (uint16_t) ((audio->rx_supp_ff_sz_max / ff_slot_sz) * ff_slot_sz);
+      #else
             const uint16_t active_fifo_depth = (audio->rx_supp_ff_sz_max / audio->n_bytes_per_sampe_rx) * audio->n_bytes_per_sampe_rx;
+      #endif
             for (uint8_t cnt = 0; cnt < audio->n_rx_supp_ff; cnt++)
             {
               tu_fifo_config(&audio->rx_supp_ff[cnt], audio->rx_supp_ff[cnt].buffer, active_fifo_depth, 1, true);
@@ -1835,7 +2715,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
             audio->feedback.frame_shift = desc_ep->bInterval -1;
 
             // Enable SOF interrupt if callback is implemented
-            if (tud_audio_feedback_interval_isr) usbd_sof_enable(rhport, true);
+            if (tud_audio_feedback_interval_isr) usbd_sof_subscribe(rhport, audiod_sof_isr, 1);
           }
   #endif
 #endif // CFG_TUD_AUDIO_ENABLE_EP_OUT
@@ -1852,42 +2732,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
 
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
       // Prepare feedback computation if callback is available
-      if (tud_audio_feedback_params_cb)
-      {
-        audio_feedback_params_t fb_param;
-
-        tud_audio_feedback_params_cb(func_id, alt, &fb_param);
-        audio->feedback.compute_method = fb_param.method;
-
-        // Minimal/Maximum value in 16.16 format for full speed (1ms per frame) or high speed (125 us per frame)
-        uint32_t const frame_div  = (TUSB_SPEED_FULL == tud_speed_get()) ? 1000 : 8000;
-        audio->feedback.min_value = (fb_param.sample_freq/frame_div - 1) << 16;
-        audio->feedback.max_value = (fb_param.sample_freq/frame_div + 1) << 16;
-
-        switch(fb_param.method)
-        {
-          case AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED:
-          case AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT:
-          case AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2:
-            set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq);
-          break;
-
-          #if 0 // implement later
-          case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
-          {
-            uint64_t fb64 = ((uint64_t) fb_param.sample_freq) << 16;
-            audio->feedback.compute.fifo_count.nominal_value = (uint32_t) (fb64 / frame_div);
-            audio->feedback.compute.fifo_count.threshold_bytes = fb_param.fifo_count.threshold_bytes;
-
-            tud_audio_fb_set(audio->feedback.compute.fifo_count.nominal_value);
-          }
-          break;
-          #endif
-
-          // nothing to do
-          default: break;
-        }
-      }
+      if (audio->ep_fb && audio->ep_out_as_intf_num == itf) audiod_fb_params_prepare(rhport, func_id, alt);
 #endif // CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 
       // We are done - abort loop
@@ -1909,7 +2754,7 @@ static bool audiod_set_interface(uint8_t rhport, tusb_control_request_t const *
       break;
     }
   }
-  if (disable) usbd_sof_enable(rhport, false);
+  if (disable) usbd_sof_subscribe(rhport, audiod_sof_isr, 0);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
@@ -1945,7 +2790,16 @@ static bool audiod_control_complete(uint8_t rhport, tusb_control_request_t const
             TU_VERIFY(audiod_verify_entity_exists(itf, entityID, &func_id));
 
             // Invoke callback
-            return tud_audio_set_req_entity_cb(rhport, p_request, _audiod_fct[func_id].ctrl_buf);
+            TU_VERIFY(tud_audio_set_req_entity_cb(rhport, p_request, _audiod_fct[func_id].ctrl_buf));
+
+            // Sample rate changed while streaming: keep FIFOs and endpoints, only re-seed feedback and packet schedule
+            if (TU_U16_HIGH(p_request->wValue) == AUDIO_CS_CTRL_SAM_FREQ && p_request->bRequest == AUDIO_CS_REQ_CUR &&
+                p_request->wLength == 4)
+            {
+              audiod_sample_rate_changed(rhport, func_id, entityID);
+            }
+
+            return true;
           }
           else
           {
@@ -2170,6 +3024,8 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
       // Be aware - we as a device are not able to know if the host polls for data with a faster rate as we stated this in the descriptors. Therefore we always have to put something into the EPs buffer. However, once we did that, there is no way of aborting this or replacing what we put into the buffer before!
       // This is the only place where we can fill something into the EPs buffer!
 
+      AUDIOD_STATS( audiod_stats_sof_latency(audio, AUDIOD_STATS_SOF_TX); )
+
       // Load new data
       TU_VERIFY(audiod_tx_done_cb(rhport, audio));
 
@@ -2183,6 +3039,7 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
     // New audio packet received
     if (audio->ep_out == ep_addr)
     {
+      AUDIOD_STATS( audiod_stats_sof_latency(audio, AUDIOD_STATS_SOF_RX); )
       TU_VERIFY(audiod_rx_done_cb(rhport, audio, (uint16_t) xferred_bytes));
       return true;
     }
@@ -2208,6 +3065,34 @@ bool audiod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   return false;
 }
 
+#if CFG_TUD_AUDIO_XFER_ISR
+// Isochronous data completion is handled here in ISR context (CFG_TUD_AUDIO_XFER_ISR), feedback and interrupt EP
+// are deferred to audiod_xfer_cb() in usbd task
+bool audiod_xfer_isr(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+  for (uint8_t func_id = 0; func_id < CFG_TUD_AUDIO; func_id++)
+  {
+    audiod_function_t const* audio = &_audiod_fct[func_id];
+    bool iso = false;
+#if CFG_TUD_AUDIO_ENABLE_EP_IN
+    iso = iso || (audio->ep_in == ep_addr && audio->alt_setting != 0);
+#endif
+#if CFG_TUD_AUDIO_ENABLE_EP_OUT
+    iso = iso || (audio->ep_out == ep_addr);
+#endif
+
+    if (iso)
+    {
+      // consumed even if stream was stopped in the meantime, there is nothing to re-arm then
+      (void) audiod_xfer_cb(rhport, ep_addr, result, xferred_bytes);
+      return true;
+    }
+  }
+
+  return false;
+}
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 
 static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, uint32_t mclk_freq)
@@ -2244,6 +3129,118 @@ static bool set_fb_params_freq(audiod_function_t* audio, uint32_t sample_freq, u
   return true;
 }
 
+static tu_fifo_t* audiod_fb_fifo(audiod_function_t* audio)
+{
+#if CFG_TUD_AUDIO_ENABLE_DECODING
+  return audio->n_rx_supp_ff ? &audio->rx_supp_ff[0] : NULL;
+#else
+  return &audio->ep_out_ff;
+#endif
+}
+
+static void set_fb_params_fifo_count(audiod_function_t* audio, uint32_t sample_freq, uint32_t frame_div, uint32_t target_bytes)
+{
+  tu_fifo_t* ff = audiod_fb_fifo(audio);
+  uint32_t const depth = ff ? tu_fifo_depth(ff) : 0;
+
+  // Regulate to half filled FIFO unless specified, leaving equal room for both directions
+  if ( target_bytes == 0 || target_bytes >= depth ) target_bytes = depth / 2;
+  if ( target_bytes == 0 ) target_bytes = 1;
+
+  audio->feedback.compute.fifo_count.nominal_value = (uint32_t) ((((uint64_t) sample_freq) << 16) / frame_div);
+  audio->feedback.compute.fifo_count.target_bytes  = target_bytes;
+
+  // An empty (or twice the target level) FIFO deviates the feedback by one sample per frame, which is the maximum
+  // allowed by FMT-2.0 section 2.3.1.1. On HS feedback is in samples per micro-frame, one sample deviation there is
+  // already 8 times larger per ms and could cause instability.
+  uint32_t kp = (1UL << 24) / target_bytes;
+  if ( TUSB_SPEED_HIGH == tud_speed_get() ) kp >>= 3;
+  audio->feedback.compute.fifo_count.kp = kp;
+
+  // Start from target level to avoid a feedback spike before the FIFO is first filled
+  audio->feedback.compute.fifo_count.level_avg = target_bytes << 8;
+  audio->feedback.compute.fifo_count.integral  = 0;
+}
+
+// Query feedback parameters of alternate setting and seed feedback with the nominal value, used when feedback EP
+// is opened and when sample rate changes while streaming
+static void audiod_fb_params_prepare(uint8_t rhport, uint8_t func_id, uint8_t alt)
+{
+  if (!tud_audio_feedback_params_cb) return;
+
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  audio_feedback_params_t fb_param;
+
+  tud_audio_feedback_params_cb(func_id, alt, &fb_param);
+  audio->feedback.compute_method = fb_param.method;
+
+  // Minimal/Maximum value in 16.16 format for full speed (1ms per frame) or high speed (125 us per frame)
+  uint32_t const frame_div  = (TUSB_SPEED_FULL == tud_speed_get()) ? 1000 : 8000;
+  audio->feedback.min_value = (fb_param.sample_freq/frame_div - 1) << 16;
+  audio->feedback.max_value = (fb_param.sample_freq/frame_div + 1) << 16;
+
+  switch(fb_param.method)
+  {
+    case AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED:
+    case AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT:
+    case AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2:
+      if (set_fb_params_freq(audio, fb_param.sample_freq, fb_param.frequency.mclk_freq))
+      {
+        // Host gets the new rate with the next feedback packet instead of after the first measurement interval
+        tud_audio_n_fb_set(func_id, (uint32_t) ((((uint64_t) fb_param.sample_freq) << 16) / frame_div));
+      }
+    break;
+
+    case AUDIO_FEEDBACK_METHOD_FIFO_COUNT:
+      set_fb_params_fifo_count(audio, fb_param.sample_freq, frame_div, fb_param.fifo_count.target_bytes);
+      tud_audio_n_fb_set(func_id, audio->feedback.compute.fifo_count.nominal_value);
+
+      // FIFO level is sampled on every SOF
+      usbd_sof_subscribe(rhport, audiod_sof_isr, 1);
+    break;
+
+    // nothing to do
+    default: break;
+  }
+}
+
+// Sample FIFO level on every SOF, compute and set feedback value at feedback interval
+TU_ATTR_FAST_FUNC static void audiod_fb_fifo_count_update(uint8_t func_id, bool compute)
+{
+  audiod_function_t* audio = &_audiod_fct[func_id];
+  tu_fifo_t* ff = audiod_fb_fifo(audio);
+  if ( ff == NULL ) return;
+
+  // Low-pass filter level since data is consumed in chunks (e.g. I2S DMA half buffer), time constant is 16 frames
+  int32_t const level     = (int32_t) (tu_fifo_count(ff) << 8);
+  int32_t const level_avg = (int32_t) audio->feedback.compute.fifo_count.level_avg;
+  audio->feedback.compute.fifo_count.level_avg = (uint32_t) (level_avg + (level - level_avg) / 16);
+
+  if ( !compute ) return;
+
+  // PI controller: error is positive when FIFO is below target i.e host should send more samples
+  int32_t const target = (int32_t) audio->feedback.compute.fifo_count.target_bytes;
+  int32_t error = target - (int32_t) (audio->feedback.compute.fifo_count.level_avg >> 8);
+  if ( error >  target ) error =  target;
+  if ( error < -target ) error = -target;
+
+  int32_t const p = (error * (int32_t) audio->feedback.compute.fifo_count.kp) / 256;
+
+  // Integral removes the static level offset caused by clock deviation, its gain is kept low relative to proportional
+  // gain and limited to one sample per frame to prevent windup
+  int32_t integral = audio->feedback.compute.fifo_count.integral + (p * 1024) / target;
+  if ( integral >  (1L << 24) ) integral =  (1L << 24);
+  if ( integral < -(1L << 24) ) integral = -(1L << 24);
+  audio->feedback.compute.fifo_count.integral = integral;
+
+  int32_t feedback = (int32_t) audio->feedback.compute.fifo_count.nominal_value + p + integral / 256;
+
+  if ( feedback > (int32_t) audio->feedback.max_value ) feedback = (int32_t) audio->feedback.max_value;
+  if ( feedback < (int32_t) audio->feedback.min_value ) feedback = (int32_t) audio->feedback.min_value;
+
+  tud_audio_n_fb_set(func_id, (uint32_t) feedback);
+}
+
 uint32_t tud_audio_feedback_update(uint8_t func_id, uint32_t cycles)
 {
   audiod_function_t* audio = &_audiod_fct[func_id];
@@ -2287,6 +3284,14 @@ TU_ATTR_FAST_FUNC void audiod_sof_isr (uint8_t rhport, uint32_t frame_count)
   (void) rhport;
   (void) frame_count;
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+  _audiod_stats_sof_time = tud_stats_timestamp_cb();
+  for(uint8_t i=0; i < CFG_TUD_AUDIO; i++)
+  {
+    _audiod_fct[i].stats_sof_pending = AUDIOD_STATS_SOF_RX | AUDIOD_STATS_SOF_TX;
+  }
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
   // Determine feedback value - The feedback method is described in 5.12.4.2 of the USB 2.0 spec
   // Boiled down, the feedback value Ff = n_samples / (micro)frame.
@@ -2303,8 +3308,16 @@ TU_ATTR_FAST_FUNC void audiod_sof_isr (uint8_t rhport, uint32_t frame_count)
     {
       // HS shift need to be adjusted since SOF event is generated for frame only
       uint8_t const hs_adjust = (TUSB_SPEED_HIGH == tud_speed_get()) ? 3 : 0;
-      uint32_t const interval = 1UL << (audio->feedback.frame_shift - hs_adjust);
-      if ( 0 == (frame_count & (interval-1)) )
+      uint8_t const shift = (audio->feedback.frame_shift > hs_adjust) ? (audio->feedback.frame_shift - hs_adjust) : 0;
+      uint32_t const interval = 1UL << shift;
+      bool const is_interval = (0 == (frame_count & (interval-1)));
+
+      if (audio->feedback.compute_method == AUDIO_FEEDBACK_METHOD_FIFO_COUNT)
+      {
+        audiod_fb_fifo_count_update(i, is_interval);
+      }
+
+      if (is_interval)
       {
         if(tud_audio_feedback_interval_isr) tud_audio_feedback_interval_isr(i, frame_count, audio->feedback.frame_shift);
       }
@@ -2612,9 +3625,10 @@ static bool audiod_calc_tx_packet_sz(audiod_function_t* audio)
   TU_VERIFY(audio->sample_rate_tx);
 
   const uint8_t interval = (tud_speed_get() == TUSB_SPEED_FULL) ? audio->interval_tx : 1 << (audio->interval_tx - 1);
+  const uint16_t frames_per_sec = (tud_speed_get() == TUSB_SPEED_FULL) ? 1000 : 8000;
 
-  const uint16_t sample_normimal = (uint16_t)(audio->sample_rate_tx * interval / ((tud_speed_get() == TUSB_SPEED_FULL) ? 1000 : 8000));
-  const uint16_t sample_reminder = (uint16_t)(audio->sample_rate_tx * interval % ((tud_speed_get() == TUSB_SPEED_FULL) ? 1000 : 8000));
+  const uint16_t sample_normimal = (uint16_t)(audio->sample_rate_tx * interval / frames_per_sec);
+  const uint16_t sample_reminder = (uint16_t)(audio->sample_rate_tx * interval % frames_per_sec);
 
   const uint16_t packet_sz_tx_min = (uint16_t)((sample_normimal - 1) * audio->n_channels_tx * audio->n_bytes_per_sampe_tx);
   const uint16_t packet_sz_tx_norm = (uint16_t)(sample_normimal * audio->n_channels_tx * audio->n_bytes_per_sampe_tx);
@@ -2639,54 +3653,86 @@ static bool audiod_calc_tx_packet_sz(audiod_function_t* audio)
     audio->packet_sz_tx[2] = packet_sz_tx_max;
   }
 
+  // Reduce fractional part of nav, the pattern of small and large packets repeats every sched_den packets
+  // e.g. 44.1 kHz at HS: nav = 5 + 41/80
+  uint16_t a = frames_per_sec;
+  uint16_t b = sample_reminder;
+  while (b)
+  {
+    uint16_t const t = a % b;
+    a = b;
+    b = t;
+  }
+
+  // Carry phase of running schedule over to the new denominator, a rate change while streaming then does not
+  // restart the small/large packet pattern
+  uint16_t const sched_den = (uint16_t) (frames_per_sec / a);
+  uint16_t sched_acc = 0;
+  if (audio->sched_den)
+  {
+    sched_acc = (uint16_t) ((uint32_t) audio->sched_acc * sched_den / audio->sched_den);
+    if (sched_acc >= sched_den) sched_acc = (uint16_t) (sched_den - 1);
+  }
+
+  audio->sched_n_slots  = sample_normimal;
+  audio->sched_rem      = sample_reminder / a;
+  audio->sched_den      = sched_den;
+  audio->sched_acc      = sched_acc;
+  audio->sched_blackout = 0;
+
   return true;
 }
 
-static uint16_t audiod_tx_packet_size(const uint16_t* norminal_size, uint16_t data_count, uint16_t fifo_depth, uint16_t max_depth)
+// Return size of next packet in bytes, slot_sz is the size of one audio slot in the (support) FIFO.
+// Packets follow the pre-computed schedule, only drift of the sample clock against SOF is corrected by the FIFO level.
+static uint16_t audiod_tx_packet_size(audiod_function_t* audio, uint16_t slot_sz, tu_fifo_size_t data_count, tu_fifo_size_t fifo_depth, uint16_t max_size)
 {
+  uint16_t const nominal_size = (uint16_t) (audio->sched_n_slots * slot_sz);
+
   // Flow control need a FIFO size of at least 4*Navg
-  if(norminal_size[1] && norminal_size[1] <= fifo_depth * 4)
+  if (!(nominal_size && nominal_size <= fifo_depth * 4))
   {
-    // Use blackout to prioritize normal size packet
-    static int ctrl_blackout = 0;
-    uint16_t packet_size;
-    uint16_t slot_size = norminal_size[2] - norminal_size[1];
-    if (data_count < norminal_size[0])
-    {
-        // If you get here frequently, then your I2S clock deviation is too big !
-        packet_size = 0;
-    } else
-    if (data_count < fifo_depth / 2 - slot_size && !ctrl_blackout)
-    {
-      packet_size = norminal_size[0];
-      ctrl_blackout = 10;
-    } else
-    if (data_count > fifo_depth / 2 + slot_size && !ctrl_blackout)
+    return (uint16_t) TU_MIN(data_count, max_size);
+  }
+
+  // Next step of schedule
+  uint16_t n_slots = audio->sched_n_slots;
+  audio->sched_acc = (uint16_t) (audio->sched_acc + audio->sched_rem);
+  if (audio->sched_acc >= audio->sched_den)
+  {
+    audio->sched_acc = (uint16_t) (audio->sched_acc - audio->sched_den);
+    n_slots++;
+  }
+
+  // Correct drift by one slot, use blackout to prioritize scheduled packets. If nav is fractional, packets must stay
+  // within small and large VFP i.e. only a large packet can be made small and vice versa.
+  if (audio->sched_blackout)
+  {
+    audio->sched_blackout--;
+  } else
+  {
+    bool const is_large = (n_slots != audio->sched_n_slots);
+    bool const is_integer = (audio->sched_rem == 0);
+
+    if (data_count + slot_sz < fifo_depth / 2 && (is_integer || is_large))
     {
-      packet_size = norminal_size[2];
-      if(norminal_size[0] == norminal_size[1])
-      {
-        // nav > INT(nav), eg. 44.1k, 88.2k
-        ctrl_blackout = 0;
-      } else
-      {
-        // nav = INT(nav), eg. 48k, 96k
-        ctrl_blackout = 10;
-      }
+      n_slots--;
+      audio->sched_blackout = 10;
     } else
+    if (data_count > fifo_depth / 2 + slot_sz && (is_integer || !is_large))
     {
-      packet_size = norminal_size[1];
-      if (ctrl_blackout)
-      {
-        ctrl_blackout--;
-      }
+      n_slots++;
+      audio->sched_blackout = 10;
     }
-    // Normally this cap is not necessary
-    return tu_min16(packet_size, max_depth);
-  } else
-  {
-    return tu_min16(data_count, max_depth);
   }
+
+  uint16_t const packet_size = (uint16_t) (n_slots * slot_sz);
+
+  // If you get here frequently, then your I2S clock deviation is too big !
+  if (data_count < packet_size) return 0;
+
+  // Normally this cap is not necessary
+  return tu_min16(packet_size, max_size);
 }
 
 #endif
@@ -2697,6 +3743,15 @@ bool tud_audio_n_fb_set(uint8_t func_id, uint32_t feedback)
 {
   TU_VERIFY(func_id < CFG_TUD_AUDIO && _audiod_fct[func_id].p_desc != NULL);
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+  {
+    audiod_function_t* audio = &_audiod_fct[func_id];
+    audio->stats.fb_history[audio->stats_fb_idx] = feedback;
+    audio->stats_fb_idx = (uint8_t) ((audio->stats_fb_idx + 1) % CFG_TUD_AUDIO_STATS_FB_HISTORY);
+    if (audio->stats.fb_history_count < CFG_TUD_AUDIO_STATS_FB_HISTORY) audio->stats.fb_history_count++;
+  }
+#endif
+
   // Format the feedback value
 #if CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION
   if ( TUSB_SPEED_FULL == tud_speed_get() )
@@ -2727,6 +3782,73 @@ bool tud_audio_n_fb_set(uint8_t func_id, uint32_t feedback)
 }
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+
+TU_VERIFY_STATIC(CFG_TUD_AUDIO_STATS_FB_HISTORY > 0 && CFG_TUD_AUDIO_STATS_FB_HISTORY < 256, "Feedback history must be 1 to 255");
+
+bool tud_audio_n_stats_get(uint8_t func_id, tud_audio_stats_t* stats)
+{
+  TU_VERIFY(func_id < CFG_TUD_AUDIO);
+  audiod_function_t const* audio = &_audiod_fct[func_id];
+
+  *stats = audio->stats;
+
+  // Replace sentinels of empty minimum/maximum
+  if (stats->rx.packets == 0) stats->rx.level_min = 0;
+  if (stats->tx.packets == 0) stats->tx.level_min = 0;
+  if (stats->tx_size_dev_min > stats->tx_size_dev_max) stats->tx_size_dev_min = stats->tx_size_dev_max = 0;
+  if (stats->sof_latency_min > stats->sof_latency_max) stats->sof_latency_min = 0;
+
+  // Order feedback history oldest first
+  uint8_t const count = audio->stats.fb_history_count;
+  uint8_t const start = (uint8_t) ((audio->stats_fb_idx + CFG_TUD_AUDIO_STATS_FB_HISTORY - count) % CFG_TUD_AUDIO_STATS_FB_HISTORY);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    stats->fb_history[i] = audio->stats.fb_history[(start + i) % CFG_TUD_AUDIO_STATS_FB_HISTORY];
+  }
+
+  return true;
+}
+
+void tud_audio_n_stats_clear(uint8_t func_id)
+{
+  if (func_id >= CFG_TUD_AUDIO) return;
+  audiod_function_t* audio = &_audiod_fct[func_id];
+
+  tu_memclr(&audio->stats, sizeof(audio->stats));
+  audio->stats.rx.level_min       = UINT32_MAX;
+  audio->stats.tx.level_min       = UINT32_MAX;
+  audio->stats.tx_size_dev_min    = INT32_MAX;
+  audio->stats.tx_size_dev_max    = INT32_MIN;
+  audio->stats.sof_latency_min    = UINT32_MAX;
+  audio->stats_fb_idx             = 0;
+  audio->stats_sof_pending        = 0;
+}
+
+bool tud_audio_stats_vendor_control_xfer(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
+{
+  TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_VENDOR &&
+            request->bmRequestType_bit.direction == TUSB_DIR_IN &&
+            request->bRequest == CFG_TUD_AUDIO_STATS_VENDOR_REQUEST &&
+            request->wIndex < CFG_TUD_AUDIO);
+
+  // Snapshot must stay valid until data stage is completed
+  static tud_audio_stats_t stats_buf;
+
+  if (stage == CONTROL_STAGE_SETUP)
+  {
+    uint8_t const func_id = (uint8_t) request->wIndex;
+    TU_VERIFY(tud_audio_n_stats_get(func_id, &stats_buf));
+    if (request->wValue & 0x01) tud_audio_n_stats_clear(func_id);
+
+    return tud_control_xfer(rhport, request, &stats_buf, (uint16_t) TU_MIN(sizeof(stats_buf), request->wLength));
+  }
+
+  return true;
+}
+
+#endif
+
 // No security checks here - internal function only which should always succeed
 uint8_t audiod_get_audio_fct_idx(audiod_function_t * audio)
 {
@@ -92,6 +92,7 @@
 #endif
 
 // Maximum EP sizes for all alternate AS interface settings - used for checks and buffer allocation
+// In bytes per (micro)frame, includes additional transactions of high-bandwidth EP (up to 3072)
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
 #ifndef CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX
 #error You must tell the driver the biggest EP IN size!
@@ -201,6 +202,29 @@
 #define CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP                   0                             // Feedback - 0 or 1
 #endif
 
+// Enable/disable statistics of streaming EPs per audio function, see tud_audio_n_stats_get()
+#ifndef CFG_TUD_AUDIO_ENABLE_STATS
+#define CFG_TUD_AUDIO_ENABLE_STATS                          0                             // 0 or 1
+#endif
+
+// Number of most recent feedback values kept in statistics
+#ifndef CFG_TUD_AUDIO_STATS_FB_HISTORY
+#define CFG_TUD_AUDIO_STATS_FB_HISTORY                      8
+#endif
+
+// bRequest of vendor request handled by tud_audio_stats_vendor_control_xfer()
+#ifndef CFG_TUD_AUDIO_STATS_VENDOR_REQUEST
+#define CFG_TUD_AUDIO_STATS_VENDOR_REQUEST                  0x5A
+#endif
+
+// Process isochronous transfer complete in ISR context: endpoint is re-armed and tud_audio_tx_done_pre/post_load_cb(),
+// tud_audio_rx_done_pre/post_read_cb() are invoked straight from the completion interrupt, so that the next
+// (micro)frame is not missed because of tud_task() scheduling. The callbacks must then be ISR-safe.
+// Feedback and interrupt EP are still handled in usbd task. Not supported with software encoding/decoding.
+#ifndef CFG_TUD_AUDIO_XFER_ISR
+#define CFG_TUD_AUDIO_XFER_ISR                              0
+#endif
+
 // Use software encoding/decoding
 
 // The software coding feature of the driver is not mandatory. It is useful if, for instance, you have two I2S streams which need to be interleaved
@@ -255,6 +279,10 @@
 #define CFG_TUD_AUDIO_ENABLE_DECODING                       0
 #endif
 
+#if CFG_TUD_AUDIO_XFER_ISR && (CFG_TUD_AUDIO_ENABLE_ENCODING || CFG_TUD_AUDIO_ENABLE_DECODING)
+#error CFG_TUD_AUDIO_XFER_ISR is not supported with software encoding/decoding
+#endif
+
 // This enabling allows to save the current coding parameters e.g. # of bytes per sample etc. - TYPE_I includes common PCM encoding
 #ifndef CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
 #define CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING                0
@@ -264,6 +292,36 @@
 #define CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING                0
 #endif
 
+// Enable sample format conversion within Type I PCM encoding/decoding: samples in the support FIFOs may use a
+// different format than the subslot size of the active alternate setting (e.g. 24-bit left-justified in 32-bit slots
+// while host selected 3-byte subslots), see tud_audio_n_set_tx_support_ff_format(). Conversion is fused into the
+// interleaving copy so that samples are touched once.
+#ifndef CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION
+#define CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION              0
+#endif
+
+// Block processing on support FIFOs: tud_audio_rx_block_cb() / tud_audio_tx_block_cb() are invoked with fixed size
+// blocks of CFG_TUD_AUDIO_BLOCK_FRAMES frames of all channels, independent of USB packet cadence (e.g. 44/45 frames
+// at 44.1 kHz), so that DSP code can run on e.g. power-of-two blocks. 0 to disable.
+#ifndef CFG_TUD_AUDIO_BLOCK_FRAMES
+#define CFG_TUD_AUDIO_BLOCK_FRAMES                          0
+#endif
+
+// Block layout: 0 interleaved (ch0 ch1 ch0 ch1 ...), 1 planar (all frames of ch0, then all frames of ch1 ...)
+#ifndef CFG_TUD_AUDIO_BLOCK_PLANAR
+#define CFG_TUD_AUDIO_BLOCK_PLANAR                          0
+#endif
+
+// Max number of channels of a block, sizes the block buffer together with max sample size of 4 bytes
+#ifndef CFG_TUD_AUDIO_BLOCK_CHANNELS_MAX
+#define CFG_TUD_AUDIO_BLOCK_CHANNELS_MAX                    2
+#endif
+
+// Alignment of block buffer in bytes e.g. cache line or SIMD width
+#ifndef CFG_TUD_AUDIO_BLOCK_ALIGN
+#define CFG_TUD_AUDIO_BLOCK_ALIGN                           4
+#endif
+
 // Type I Coding parameters not given within UAC2 descriptors
 // It would be possible to allow for a more flexible setting and not fix this parameter as done below. However, this is most often not needed and kept for later if really necessary. The more flexible setting could be implemented within set_interface(), however, how the values are saved per alternate setting is to be determined!
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
@@ -356,6 +414,15 @@ extern "C" {
  *  \defgroup   AUDIO_Serial_Device Device
  *  @{ */
 
+// Sample format of support FIFOs with CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION
+typedef enum
+{
+  AUDIO_SUPP_FF_FORMAT_SUBSLOT = 0, // Same as subslot of active alternate setting, no conversion (default)
+  AUDIO_SUPP_FF_FORMAT_INT16,       // int16_t, converted from/to subslot by shifting
+  AUDIO_SUPP_FF_FORMAT_INT32,       // int32_t left-justified e.g. 24-bit codec data in 32-bit slots, converted by truncating/padding
+  AUDIO_SUPP_FF_FORMAT_FLOAT32,     // float in range [-1, +1), converted to integer with TPDF dither
+} audio_supp_ff_format_t;
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Interfaces)
 // CFG_TUD_AUDIO > 1
@@ -367,6 +434,15 @@ uint16_t tud_audio_n_available                    (uint8_t func_id);
 uint16_t tud_audio_n_read                         (uint8_t func_id, void* buffer, uint16_t bufsize);
 bool     tud_audio_n_clear_ep_out_ff              (uint8_t func_id);                          // Delete all content in the EP OUT FIFO
 tu_fifo_t*   tud_audio_n_get_ep_out_ff            (uint8_t func_id);
+
+// Use EP OUT FIFO storage as ring of a circular DMA (e.g I2S/SAI) without intermediate copy. Clears FIFO and returns
+// its buffer and size, DMA must be started from buffer start. Half/full transfer interrupt then calls
+// tud_audio_n_ep_out_dma_advance() with number of bytes consumed by DMA, which returns how many of them were received
+// data. On underrun the missing part is filled with silence (zero). FIFO position follows DMA in usbd task, the DMA
+// interrupt only queues an event and must not preempt the USB interrupt (e.g use the same priority).
+// FIFO is cleared when alternate setting changes, DMA must be restarted after binding again e.g in tud_audio_set_itf_cb().
+bool     tud_audio_n_ep_out_dma_ring              (uint8_t func_id, void** buffer, uint16_t* size);
+uint16_t tud_audio_n_ep_out_dma_advance           (uint8_t func_id, uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -374,12 +450,28 @@ bool     tud_audio_n_clear_rx_support_ff          (uint8_t func_id, uint8_t ff_i
 uint16_t tud_audio_n_available_support_ff         (uint8_t func_id, uint8_t ff_idx);
 uint16_t tud_audio_n_read_support_ff              (uint8_t func_id, uint8_t ff_idx, void* buffer, uint16_t bufsize);
 tu_fifo_t* tud_audio_n_get_rx_support_ff          (uint8_t func_id, uint8_t ff_idx);
+
+#if CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_TYPE_I_DECODING
+// Set format of samples read from support RX FIFOs, effective when host selects the next alternate setting
+bool     tud_audio_n_set_rx_support_ff_format     (uint8_t func_id, audio_supp_ff_format_t format);
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
 uint16_t tud_audio_n_write                        (uint8_t func_id, const void * data, uint16_t len);
+uint16_t tud_audio_n_write_reserve                (uint8_t func_id, tu_fifo_buffer_info_t* info); // Get free space of EP IN FIFO to be filled in place
+uint16_t tud_audio_n_write_commit                 (uint8_t func_id, uint16_t len);           // Commit bytes filled in place
 bool     tud_audio_n_clear_ep_in_ff               (uint8_t func_id);                          // Delete all content in the EP IN FIFO
 tu_fifo_t*   tud_audio_n_get_ep_in_ff             (uint8_t func_id);
+
+// Use EP IN FIFO storage as ring of a circular DMA (e.g I2S/SAI) without intermediate copy. Clears FIFO and returns
+// its buffer and size, DMA must be started from buffer start. Half/full transfer interrupt then calls
+// tud_audio_n_ep_in_dma_advance() with number of bytes written by DMA, which returns how many of them were added
+// without overwriting data not yet sent. On overflow the oldest data is dropped. FIFO position follows DMA in usbd
+// task, the DMA interrupt only queues an event and must not preempt the USB interrupt (e.g use the same priority).
+// FIFO is cleared when alternate setting changes, DMA must be restarted after binding again e.g in tud_audio_set_itf_cb().
+bool     tud_audio_n_ep_in_dma_ring               (uint8_t func_id, void** buffer, uint16_t* size);
+uint16_t tud_audio_n_ep_in_dma_advance            (uint8_t func_id, uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -387,12 +479,59 @@ uint16_t tud_audio_n_flush_tx_support_ff          (uint8_t func_id);      // For
 bool     tud_audio_n_clear_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
 uint16_t tud_audio_n_write_support_ff             (uint8_t func_id, uint8_t ff_idx, const void * data, uint16_t len);
 tu_fifo_t* tud_audio_n_get_tx_support_ff          (uint8_t func_id, uint8_t ff_idx);
+
+#if CFG_TUD_AUDIO_ENABLE_SAMPLE_CONVERSION && CFG_TUD_AUDIO_ENABLE_TYPE_I_ENCODING
+// Set format of samples written into support TX FIFOs, effective when host selects the next alternate setting
+bool     tud_audio_n_set_tx_support_ff_format     (uint8_t func_id, audio_supp_ff_format_t format);
+#endif
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_INTERRUPT_EP
 bool    tud_audio_int_n_write                     (uint8_t func_id, const audio_interrupt_data_t * data);
 #endif
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+// Statistics of one streaming direction. FIFO is the EP FIFO or first support FIFO if encoding/decoding is enabled,
+// its level is sampled once per packet i.e per service interval: mean level is level_sum / packets.
+typedef struct {
+  uint32_t packets;   // packets received (RX) or loaded for transmission (TX)
+  uint32_t level_min; // FIFO level in bytes
+  uint32_t level_max;
+  uint64_t level_sum;
+  uint32_t underrun;  // RX: application/DMA read more than available, TX: no data for a packet (ZLP sent)
+  uint32_t overrun;   // RX: received data did not fit into FIFO, TX: application/DMA data did not fit into FIFO
+} tud_audio_stats_stream_t;
+
+// Counters are accumulated since tud_audio_n_stats_clear(), poll and clear periodically to get values per interval.
+// Time values are in unit of tud_stats_timestamp_cb() and stay 0 if it is not implemented.
+typedef struct {
+  tud_audio_stats_stream_t rx;
+  tud_audio_stats_stream_t tx;
+
+  // TX packet size deviation from nominal size in bytes, only with CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL
+  int32_t  tx_size_dev_min;
+  int32_t  tx_size_dev_max;
+  uint32_t tx_size_dev_count; // packets of other than nominal size
+
+  // Time from SOF until packet completion is handled by the driver, only measured while SOF interrupt is enabled
+  uint32_t sof_latency_min;
+  uint32_t sof_latency_max;
+
+  // Most recent feedback values in 16.16 format, oldest first
+  uint32_t fb_history[CFG_TUD_AUDIO_STATS_FB_HISTORY];
+  uint8_t  fb_history_count;
+} tud_audio_stats_t;
+
+bool     tud_audio_n_stats_get                    (uint8_t func_id, tud_audio_stats_t* stats);
+void     tud_audio_n_stats_clear                  (uint8_t func_id);
+
+// Handle vendor request reading statistics, to be called from tud_vendor_control_xfer_cb().
+// bmRequestType device-to-host vendor, bRequest CFG_TUD_AUDIO_STATS_VENDOR_REQUEST, wIndex audio function,
+// wValue 1 to clear counters after reading. Data stage is tud_audio_stats_t as-is (little endian, native alignment)
+// return false if request is not a statistics request or invalid
+bool     tud_audio_stats_vendor_control_xfer      (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
+#endif
+
 
 //--------------------------------------------------------------------+
 // Application API (Interface0)
@@ -400,6 +539,11 @@ bool    tud_audio_int_n_write                     (uint8_t func_id, const audio_
 
 static inline bool         tud_audio_mounted                (void);
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+static inline bool         tud_audio_stats_get              (tud_audio_stats_t* stats);
+static inline void         tud_audio_stats_clear            (void);
+#endif
+
 // RX API
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
@@ -407,6 +551,8 @@ static inline uint16_t     tud_audio_available              (void);
 static inline bool         tud_audio_clear_ep_out_ff        (void);                       // Delete all content in the EP OUT FIFO
 static inline uint16_t     tud_audio_read                   (void* buffer, uint16_t bufsize);
 static inline tu_fifo_t*   tud_audio_get_ep_out_ff          (void);
+static inline bool         tud_audio_ep_out_dma_ring        (void** buffer, uint16_t* size);
+static inline uint16_t     tud_audio_ep_out_dma_advance     (uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -420,8 +566,12 @@ static inline tu_fifo_t* tud_audio_get_rx_support_ff        (uint8_t ff_idx);
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && !CFG_TUD_AUDIO_ENABLE_ENCODING
 static inline uint16_t tud_audio_write                      (const void * data, uint16_t len);
+static inline uint16_t tud_audio_write_reserve              (tu_fifo_buffer_info_t* info);
+static inline uint16_t tud_audio_write_commit               (uint16_t len);
 static inline bool 	   tud_audio_clear_ep_in_ff             (void);
 static inline tu_fifo_t* tud_audio_get_ep_in_ff             (void);
+static inline bool     tud_audio_ep_in_dma_ring             (void** buffer, uint16_t* size);
+static inline uint16_t tud_audio_ep_in_dma_advance          (uint16_t len);
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -449,6 +599,7 @@ bool tud_audio_buffer_and_schedule_control_xfer(uint8_t rhport, tusb_control_req
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
 
+// Invoked in ISR context if CFG_TUD_AUDIO_XFER_ISR is set.
 #if CFG_TUD_AUDIO_ENABLE_EP_IN
 TU_ATTR_WEAK bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t func_id, uint8_t ep_in, uint8_t cur_alt_setting);
 TU_ATTR_WEAK bool tud_audio_tx_done_post_load_cb(uint8_t rhport, uint16_t n_bytes_copied, uint8_t func_id, uint8_t ep_in, uint8_t cur_alt_setting);
@@ -459,6 +610,19 @@ TU_ATTR_WEAK bool tud_audio_rx_done_pre_read_cb(uint8_t rhport, uint16_t n_bytes
 TU_ATTR_WEAK bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_bytes_received, uint8_t func_id, uint8_t ep_out, uint8_t cur_alt_setting);
 #endif
 
+#if CFG_TUD_AUDIO_BLOCK_FRAMES && CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
+// Invoked after a packet is decoded, once for every CFG_TUD_AUDIO_BLOCK_FRAMES frames available in all RX support FIFOs.
+// Block holds n_channels (all support FIFOs in use) samples of bytes_per_sample (support FIFO format) per frame,
+// layout according to CFG_TUD_AUDIO_BLOCK_PLANAR. Samples are consumed from the support FIFOs.
+TU_ATTR_WEAK void tud_audio_rx_block_cb(uint8_t func_id, void const* block, uint16_t n_frames, uint8_t n_channels, uint8_t bytes_per_sample);
+#endif
+
+#if CFG_TUD_AUDIO_BLOCK_FRAMES && CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
+// Invoked before a packet is encoded while TX support FIFOs hold less than one block plus one packet and can take
+// another block. Application fills the block (same layout as RX) and returns true, or false if it has no data.
+TU_ATTR_WEAK bool tud_audio_tx_block_cb(uint8_t func_id, void* block, uint16_t n_frames, uint8_t n_channels, uint8_t bytes_per_sample);
+#endif
+
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP
 TU_ATTR_WEAK void tud_audio_fb_done_cb(uint8_t func_id);
 
@@ -500,9 +664,7 @@ enum {
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FIXED,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_FLOAT,
   AUDIO_FEEDBACK_METHOD_FREQUENCY_POWER_OF_2,
-
-  // impelemnt later
-  // AUDIO_FEEDBACK_METHOD_FIFO_COUNT
+  AUDIO_FEEDBACK_METHOD_FIFO_COUNT
 };
 
 typedef struct {
@@ -514,15 +676,16 @@ typedef struct {
       uint32_t mclk_freq; // Main clock frequency in Hz i.e. master clock to which sample clock is based on
     }frequency;
 
-#if 0 // implement later
     struct {
-      uint32_t threshold_bytes; // minimum number of bytes received to be considered as filled/ready
+      uint32_t target_bytes; // FIFO level in bytes the controller regulates to, 0 for half of FIFO depth
     }fifo_count;
-#endif
   };
 }audio_feedback_params_t;
 
 // Invoked when needed to set feedback parameters
+// AUDIO_FEEDBACK_METHOD_FIFO_COUNT does not need a master clock counter: the driver samples EP OUT FIFO level
+// (first support FIFO if decoding is enabled) on every SOF and regulates it to fifo_count.target_bytes with a PI
+// controller, tud_audio_feedback_update() must not be used with this method.
 TU_ATTR_WEAK void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf, audio_feedback_params_t* feedback_param);
 
 // Callback in ISR context, invoked periodically according to feedback endpoint bInterval.
@@ -570,6 +733,18 @@ static inline bool tud_audio_mounted(void)
   return tud_audio_n_mounted(0);
 }
 
+#if CFG_TUD_AUDIO_ENABLE_STATS
+static inline bool tud_audio_stats_get(tud_audio_stats_t* stats)
+{
+  return tud_audio_n_stats_get(0, stats);
+}
+
+static inline void tud_audio_stats_clear(void)
+{
+  tud_audio_n_stats_clear(0);
+}
+#endif
+
 // RX API
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && !CFG_TUD_AUDIO_ENABLE_DECODING
@@ -594,6 +769,16 @@ static inline tu_fifo_t* tud_audio_get_ep_out_ff(void)
   return tud_audio_n_get_ep_out_ff(0);
 }
 
+static inline bool tud_audio_ep_out_dma_ring(void** buffer, uint16_t* size)
+{
+  return tud_audio_n_ep_out_dma_ring(0, buffer, size);
+}
+
+static inline uint16_t tud_audio_ep_out_dma_advance(uint16_t len)
+{
+  return tud_audio_n_ep_out_dma_advance(0, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_OUT && CFG_TUD_AUDIO_ENABLE_DECODING
@@ -629,6 +814,16 @@ static inline uint16_t tud_audio_write(const void * data, uint16_t len)
   return tud_audio_n_write(0, data, len);
 }
 
+static inline uint16_t tud_audio_write_reserve(tu_fifo_buffer_info_t* info)
+{
+  return tud_audio_n_write_reserve(0, info);
+}
+
+static inline uint16_t tud_audio_write_commit(uint16_t len)
+{
+  return tud_audio_n_write_commit(0, len);
+}
+
 static inline bool tud_audio_clear_ep_in_ff(void)
 {
   return tud_audio_n_clear_ep_in_ff(0);
@@ -639,6 +834,16 @@ static inline tu_fifo_t* tud_audio_get_ep_in_ff(void)
   return tud_audio_n_get_ep_in_ff(0);
 }
 
+static inline bool tud_audio_ep_in_dma_ring(void** buffer, uint16_t* size)
+{
+  return tud_audio_n_ep_in_dma_ring(0, buffer, size);
+}
+
+static inline uint16_t tud_audio_ep_in_dma_advance(uint16_t len)
+{
+  return tud_audio_n_ep_in_dma_advance(0, len);
+}
+
 #endif
 
 #if CFG_TUD_AUDIO_ENABLE_EP_IN && CFG_TUD_AUDIO_ENABLE_ENCODING
@@ -690,6 +895,7 @@ void     audiod_reset          (uint8_t rhport);
 uint16_t audiod_open           (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     audiod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     audiod_xfer_cb        (uint8_t rhport, uint8_t edpt_addr, xfer_result_t result, uint32_t xferred_bytes);
+bool     audiod_xfer_isr       (uint8_t rhport, uint8_t edpt_addr, xfer_result_t result, uint32_t xferred_bytes);
 void     audiod_sof_isr        (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
@@ -0,0 +1,767 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_AUDIO)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "audio_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_AUDIO_LOG_LEVEL
+  #define CFG_TUH_AUDIO_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_AUDIO_LOG_LEVEL, __VA_ARGS__)
+
+// Max number of clock entities and terminals of an audio function tracked while resolving stream's clock
+#define AUDIOH_ENTITY_MAX   16
+
+//--------------------------------------------------------------------+
+// Host Audio Stream
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t alt;
+  uint8_t channels;
+  uint8_t subslot_size;
+  uint8_t bit_resolution;
+  tusb_desc_endpoint_t ep_data;
+  tusb_desc_endpoint_t ep_fb;  // bLength = 0 if there is no explicit feedback endpoint
+} audioh_alt_t;
+
+enum {
+  AUDIOH_STATE_IDLE = 0,
+  AUDIOH_STATE_SET_RATE,
+  AUDIOH_STATE_SET_ITF,
+  AUDIOH_STATE_STOP,
+};
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t itf_ac;       // Audio Control interface
+  uint8_t itf_num;      // Audio Streaming interface
+  uint8_t itf_last;     // last interface of the audio function, bound to this driver
+  uint8_t dir;
+  uint8_t terminal;     // bTerminalLink
+  uint8_t clock_id;     // clock source of terminal, 0 if unknown
+  uint8_t alt_count;
+  bool mounted;
+
+  uint8_t state;
+  uint8_t cur;          // active (or being started) format
+  volatile bool streaming;
+
+  // active endpoints and packet parameters of current format
+  uint8_t ep_data;
+  uint8_t ep_fb;
+  uint8_t fb_len;
+  uint8_t interval_shift; // data endpoint service interval is 2^shift (micro)frames
+  uint8_t frame_bytes;    // bytes per audio frame (one sample of all channels)
+  uint8_t epbuf_idx;      // buffer for the next data transfer
+  uint16_t max_payload;
+
+  uint32_t sample_rate;
+  uint32_t fb_nominal;    // samples per (micro)frame in 16.16
+  volatile uint32_t fb_value;
+  uint32_t fb_acc;        // fraction of sample carried to next OUT packet
+
+  audioh_alt_t alts[CFG_TUH_AUDIO_ALT_MAX];
+
+  tu_fifo_t ff;
+  uint8_t ff_buf[CFG_TUH_AUDIO_FIFO_SIZE];
+
+  // data endpoint alternates between two buffers so that it is re-armed before the completed one is processed
+  CFG_TUH_MEM_ALIGN uint8_t ep_buf[2][CFG_TUH_AUDIO_EP_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t fb_buf[4];
+  CFG_TUH_MEM_ALIGN uint8_t ctrl_buf[4];
+} audioh_stream_t;
+
+CFG_TUH_MEM_SECTION
+static audioh_stream_t audioh_data[CFG_TUH_AUDIO];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline audioh_stream_t* get_stream(uint8_t idx) {
+  TU_VERIFY(idx < CFG_TUH_AUDIO, NULL);
+  audioh_stream_t* p_as = &audioh_data[idx];
+  return (p_as->daddr != 0) ? p_as : NULL;
+}
+
+static inline uint8_t get_idx_by_ep_addr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    audioh_stream_t const* p_as = &audioh_data[i];
+    if ((p_as->daddr == daddr) && (ep_addr == p_as->ep_data || ep_addr == p_as->ep_fb)) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+static audioh_alt_t const* find_alt(audioh_stream_t const* p_as, uint8_t alt) {
+  for (uint8_t i = 0; i < p_as->alt_count; i++) {
+    if (p_as->alts[i].alt == alt) return &p_as->alts[i];
+  }
+  return NULL;
+}
+
+// Submit transfer, endpoint must be claimed unless called from completion ISR (usbh just released it)
+static bool edpt_xfer(uint8_t daddr, uint8_t ep_addr, uint8_t* buf, uint16_t len, bool in_isr) {
+  if (in_isr) {
+    return usbh_edpt_xfer(daddr, ep_addr, buf, len);
+  }
+
+  TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+  if (!usbh_edpt_xfer(daddr, ep_addr, buf, len)) {
+    usbh_edpt_release(daddr, ep_addr);
+    return false;
+  }
+  return true;
+}
+
+// Fill next OUT packet: number of samples follows feedback (or nominal rate) with fraction carried over.
+// Fifo underrun is padded with silence to keep the device clock running.
+static uint16_t tx_prepare(audioh_stream_t* p_as, uint8_t* buf) {
+  p_as->fb_acc += p_as->fb_value << p_as->interval_shift;
+  uint32_t bytes = (p_as->fb_acc >> 16) * p_as->frame_bytes;
+  p_as->fb_acc &= 0xFFFFu;
+
+  uint32_t const max_bytes = p_as->max_payload - (uint32_t) (p_as->max_payload % p_as->frame_bytes);
+  bytes = tu_min32(bytes, max_bytes);
+
+  uint32_t count = tu_fifo_count(&p_as->ff);
+  count = tu_min32(bytes, count - (count % p_as->frame_bytes));
+  if (count) tu_fifo_read_n(&p_as->ff, buf, (tu_fifo_size_t) count);
+  if (count < bytes) memset(buf + count, 0, bytes - count);
+
+  return (uint16_t) bytes;
+}
+
+// Feedback is 10.14 in 3 bytes at full speed and 16.16 in 4 bytes at high speed. Some high speed devices send
+// full speed format, values far off nominal are tried in the other format then dropped.
+static void fb_update(audioh_stream_t* p_as, uint32_t len) {
+  uint32_t value;
+  if (len == 3) {
+    value = tu_le32toh(tu_unaligned_read32(p_as->fb_buf)) & 0x00FFFFFFu;
+    value <<= 2;
+  } else if (len == 4) {
+    value = tu_le32toh(tu_unaligned_read32(p_as->fb_buf));
+  } else {
+    return;
+  }
+
+  uint32_t const lo = p_as->fb_nominal / 2;
+  uint32_t const hi = p_as->fb_nominal * 2;
+  if (len == 4 && (value < lo || value > hi)) value <<= 2;
+  if (value >= lo && value <= hi) p_as->fb_value = value;
+}
+
+static void stream_xfer_complete(uint8_t idx, audioh_stream_t* p_as, uint8_t ep_addr, xfer_result_t result,
+                                 uint32_t xferred_bytes, bool in_isr) {
+  if (result != XFER_RESULT_SUCCESS) {
+    // missed (micro)frame or CRC error: packet is lost, keep stream going
+    xferred_bytes = 0;
+  }
+
+  if (ep_addr == p_as->ep_fb) {
+    if (xferred_bytes) fb_update(p_as, xferred_bytes);
+    (void) edpt_xfer(p_as->daddr, p_as->ep_fb, p_as->fb_buf, p_as->fb_len, in_isr);
+    return;
+  }
+
+  if (p_as->dir == TUSB_DIR_IN) {
+    // re-arm with the other buffer before draining this one
+    uint8_t* ep_buf = p_as->ep_buf[p_as->epbuf_idx ^ 1];
+    uint8_t* next_buf = p_as->ep_buf[p_as->epbuf_idx];
+    p_as->epbuf_idx ^= 1;
+    if (!edpt_xfer(p_as->daddr, p_as->ep_data, next_buf, p_as->max_payload, in_isr)) {
+      TU_LOG_DRV("  AUDIOh IN re-arm failed\r\n");
+    }
+
+    // samples are dropped if application does not keep up
+    if (xferred_bytes) tu_fifo_write_n(&p_as->ff, ep_buf, (tu_fifo_size_t) xferred_bytes);
+    if (xferred_bytes && tuh_audio_rx_cb) tuh_audio_rx_cb(idx, xferred_bytes);
+  } else {
+    uint8_t* ep_buf = p_as->ep_buf[p_as->epbuf_idx];
+    p_as->epbuf_idx ^= 1;
+    uint16_t const len = tx_prepare(p_as, ep_buf);
+    if (!edpt_xfer(p_as->daddr, p_as->ep_data, ep_buf, len, in_isr)) {
+      TU_LOG_DRV("  AUDIOh OUT re-arm failed\r\n");
+    }
+
+    if (tuh_audio_tx_cb) tuh_audio_tx_cb(idx, xferred_bytes);
+  }
+}
+
+// Set up packet parameters of current format and prime endpoints
+static bool stream_prime(audioh_stream_t* p_as) {
+  audioh_alt_t const* p_alt = &p_as->alts[p_as->cur];
+  bool const is_hs = (TUSB_SPEED_HIGH == tuh_speed_get(p_as->daddr));
+
+  p_as->ep_data = p_alt->ep_data.bEndpointAddress;
+  p_as->ep_fb = p_alt->ep_fb.bLength ? p_alt->ep_fb.bEndpointAddress : 0;
+  p_as->fb_len = is_hs ? 4 : 3;
+  p_as->interval_shift = (uint8_t) tu_min8(p_alt->ep_data.bInterval ? (uint8_t) (p_alt->ep_data.bInterval - 1) : 0, 15);
+  p_as->frame_bytes = (uint8_t) (p_alt->channels * p_alt->subslot_size);
+  p_as->max_payload = tu_edpt_max_payload(&p_alt->ep_data);
+  p_as->fb_nominal = (uint32_t) (((uint64_t) p_as->sample_rate << 16) / (is_hs ? 8000u : 1000u));
+  p_as->fb_value = p_as->fb_nominal;
+  p_as->fb_acc = 0;
+  p_as->epbuf_idx = 0;
+  p_as->streaming = true;
+
+  // endpoint could still be busy with a transfer of previous run, it is then re-armed by that completion
+  if (p_as->dir == TUSB_DIR_IN) {
+    (void) edpt_xfer(p_as->daddr, p_as->ep_data, p_as->ep_buf[0], p_as->max_payload, false);
+    p_as->epbuf_idx = 1;
+  } else {
+    uint16_t const len = tx_prepare(p_as, p_as->ep_buf[0]);
+    (void) edpt_xfer(p_as->daddr, p_as->ep_data, p_as->ep_buf[0], len, false);
+    p_as->epbuf_idx = 1;
+  }
+
+  if (p_as->ep_fb) {
+    (void) edpt_xfer(p_as->daddr, p_as->ep_fb, p_as->fb_buf, p_as->fb_len, false);
+  }
+
+  return true;
+}
+
+static void stream_control_complete(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) xfer->user_data;
+  audioh_stream_t* p_as = get_stream(idx);
+  if (!p_as) return;
+
+  switch (p_as->state) {
+    case AUDIOH_STATE_SET_RATE:
+      // device with fixed clock may stall the request, alternate setting could still work
+      if (xfer->result != XFER_RESULT_SUCCESS) {
+        TU_LOG_DRV("  AUDIOh set sample rate failed: %s\r\n", tu_str_xfer_result[xfer->result]);
+      }
+
+      p_as->state = AUDIOH_STATE_SET_ITF;
+      if (!tuh_interface_set(p_as->daddr, p_as->itf_num, p_as->alts[p_as->cur].alt, stream_control_complete, idx)) {
+        p_as->state = AUDIOH_STATE_IDLE;
+        if (tuh_audio_stream_start_cb) tuh_audio_stream_start_cb(idx, false);
+      }
+      break;
+
+    case AUDIOH_STATE_SET_ITF: {
+      p_as->state = AUDIOH_STATE_IDLE;
+      bool const success = (xfer->result == XFER_RESULT_SUCCESS) && stream_prime(p_as);
+      if (tuh_audio_stream_start_cb) tuh_audio_stream_start_cb(idx, success);
+      break;
+    }
+
+    case AUDIOH_STATE_STOP:
+      p_as->state = AUDIOH_STATE_IDLE;
+      break;
+
+    default: break;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_audio_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    audioh_stream_t const* p_as = &audioh_data[i];
+    if (p_as->daddr == daddr && p_as->itf_num == itf_num) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_audio_itf_get_info(uint8_t idx, tuh_itf_info_t* info) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && info);
+
+  info->daddr = p_as->daddr;
+
+  // re-construct descriptor
+  tusb_desc_interface_t* desc = &info->desc;
+  desc->bLength            = sizeof(tusb_desc_interface_t);
+  desc->bDescriptorType    = TUSB_DESC_INTERFACE;
+
+  desc->bInterfaceNumber   = p_as->itf_num;
+  desc->bAlternateSetting  = 0;
+  desc->bNumEndpoints      = 0;
+  desc->bInterfaceClass    = TUSB_CLASS_AUDIO;
+  desc->bInterfaceSubClass = AUDIO_SUBCLASS_STREAMING;
+  desc->bInterfaceProtocol = AUDIO_INT_PROTOCOL_CODE_V2;
+  desc->iInterface         = 0; // not used yet
+
+  return true;
+}
+
+bool tuh_audio_mounted(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as);
+  return p_as->mounted;
+}
+
+tusb_dir_t tuh_audio_stream_dir(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as, TUSB_DIR_OUT);
+  return (tusb_dir_t) p_as->dir;
+}
+
+uint8_t tuh_audio_format_count(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as, 0);
+  return p_as->alt_count;
+}
+
+bool tuh_audio_format_get(uint8_t idx, uint8_t fmt_idx, tuh_audio_format_t* fmt) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && fmt && fmt_idx < p_as->alt_count);
+
+  audioh_alt_t const* p_alt = &p_as->alts[fmt_idx];
+  fmt->alt            = p_alt->alt;
+  fmt->channels       = p_alt->channels;
+  fmt->subslot_size   = p_alt->subslot_size;
+  fmt->bit_resolution = p_alt->bit_resolution;
+  fmt->max_payload    = tu_edpt_max_payload(&p_alt->ep_data);
+  fmt->interval       = p_alt->ep_data.bInterval;
+  fmt->has_feedback   = (p_alt->ep_fb.bLength != 0);
+
+  return true;
+}
+
+bool tuh_audio_stream_start(uint8_t idx, uint8_t alt, uint32_t sample_rate) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->mounted && p_as->state == AUDIOH_STATE_IDLE && sample_rate);
+
+  audioh_alt_t const* p_alt = find_alt(p_as, alt);
+  TU_VERIFY(p_alt);
+
+  p_as->streaming = false;
+  p_as->cur = (uint8_t) (p_alt - p_as->alts);
+  p_as->sample_rate = sample_rate;
+
+  // OUT stream can be pre-filled while start is in progress
+  tu_fifo_clear(&p_as->ff);
+
+  if (p_as->clock_id == 0) {
+    // no clock to set, select alternate setting right away
+    p_as->state = AUDIOH_STATE_SET_ITF;
+    if (!tuh_interface_set(p_as->daddr, p_as->itf_num, alt, stream_control_complete, idx)) {
+      p_as->state = AUDIOH_STATE_IDLE;
+      return false;
+    }
+    return true;
+  }
+
+  // SET_CUR Sampling Frequency Control of the clock source
+  tu_unaligned_write32(p_as->ctrl_buf, tu_htole32(sample_rate));
+
+  tusb_control_request_t const request = {
+    .bmRequestType_bit = {
+      .recipient = TUSB_REQ_RCPT_INTERFACE,
+      .type      = TUSB_REQ_TYPE_CLASS,
+      .direction = TUSB_DIR_OUT
+    },
+    .bRequest = AUDIO_CS_REQ_CUR,
+    .wValue   = tu_htole16(AUDIO_CS_CTRL_SAM_FREQ << 8),
+    .wIndex   = tu_htole16((uint16_t) ((p_as->clock_id << 8) | p_as->itf_ac)),
+    .wLength  = tu_htole16(4)
+  };
+
+  tuh_xfer_t xfer = {
+    .daddr       = p_as->daddr,
+    .ep_addr     = 0,
+    .setup       = &request,
+    .buffer      = p_as->ctrl_buf,
+    .complete_cb = stream_control_complete,
+    .user_data   = idx
+  };
+
+  p_as->state = AUDIOH_STATE_SET_RATE;
+  if (!tuh_control_xfer(&xfer)) {
+    p_as->state = AUDIOH_STATE_IDLE;
+    return false;
+  }
+
+  return true;
+}
+
+bool tuh_audio_stream_stop(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->mounted && p_as->state == AUDIOH_STATE_IDLE);
+
+  // in-flight transfers complete without being re-armed
+  p_as->streaming = false;
+  if (p_as->ep_data) (void) tuh_edpt_abort_xfer(p_as->daddr, p_as->ep_data);
+  if (p_as->ep_fb) (void) tuh_edpt_abort_xfer(p_as->daddr, p_as->ep_fb);
+
+  p_as->state = AUDIOH_STATE_STOP;
+  if (!tuh_interface_set(p_as->daddr, p_as->itf_num, 0, stream_control_complete, idx)) {
+    p_as->state = AUDIOH_STATE_IDLE;
+    return false;
+  }
+
+  return true;
+}
+
+bool tuh_audio_streaming(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as);
+  return p_as->streaming;
+}
+
+uint32_t tuh_audio_available(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->dir == TUSB_DIR_IN, 0);
+  return tu_fifo_count(&p_as->ff);
+}
+
+uint32_t tuh_audio_read(uint8_t idx, void* buffer, uint32_t bufsize) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->dir == TUSB_DIR_IN, 0);
+  return tu_fifo_read_n(&p_as->ff, buffer, (tu_fifo_size_t) tu_min32(bufsize, CFG_TUH_AUDIO_FIFO_SIZE));
+}
+
+uint32_t tuh_audio_write_available(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->dir == TUSB_DIR_OUT, 0);
+  return tu_fifo_remaining(&p_as->ff);
+}
+
+uint32_t tuh_audio_write(uint8_t idx, void const* buffer, uint32_t bufsize) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as && p_as->dir == TUSB_DIR_OUT, 0);
+  return tu_fifo_write_n(&p_as->ff, buffer, (tu_fifo_size_t) tu_min32(bufsize, CFG_TUH_AUDIO_FIFO_SIZE));
+}
+
+uint32_t tuh_audio_feedback_get(uint8_t idx) {
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as, 0);
+  return p_as->fb_value;
+}
+
+//--------------------------------------------------------------------+
+// CLASS-USBH API
+//--------------------------------------------------------------------+
+
+bool audioh_init(void) {
+  TU_LOG_DRV("sizeof(audioh_stream_t) = %u\r\n", (unsigned int) sizeof(audioh_stream_t));
+  tu_memclr(audioh_data, sizeof(audioh_data));
+
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    audioh_stream_t* p_as = &audioh_data[i];
+    tu_fifo_config(&p_as->ff, p_as->ff_buf, CFG_TUH_AUDIO_FIFO_SIZE, 1, false);
+  }
+
+  return true;
+}
+
+bool audioh_deinit(void) {
+  return true;
+}
+
+static void stream_reset(audioh_stream_t* p_as) {
+  p_as->daddr = 0;
+  p_as->itf_ac = 0;
+  p_as->itf_num = 0;
+  p_as->itf_last = 0;
+  p_as->terminal = 0;
+  p_as->clock_id = 0;
+  p_as->alt_count = 0;
+  p_as->mounted = false;
+  p_as->state = AUDIOH_STATE_IDLE;
+  p_as->streaming = false;
+  p_as->ep_data = 0;
+  p_as->ep_fb = 0;
+  tu_fifo_clear(&p_as->ff);
+}
+
+void audioh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_stream_t* p_as = &audioh_data[idx];
+    if (p_as->daddr == daddr) {
+      TU_LOG_DRV("  AUDIOh close addr = %u index = %u\r\n", daddr, idx);
+
+      // Invoke application callback
+      if (p_as->mounted && tuh_audio_umount_cb) tuh_audio_umount_cb(idx);
+
+      stream_reset(p_as);
+    }
+  }
+}
+
+// Isochronous completion can be handled here in ISR context (CFG_TUH_AUDIO_XFER_ISR)
+bool audioh_xfer_isr(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  audioh_stream_t* p_as = get_stream(idx);
+  if (!p_as || !p_as->streaming) return false;
+
+  stream_xfer_complete(idx, p_as, ep_addr, result, xferred_bytes, true);
+  return true;
+}
+
+bool audioh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  audioh_stream_t* p_as = get_stream(idx);
+  TU_VERIFY(p_as);
+
+  // completion of last transfer after stream is stopped
+  if (!p_as->streaming) return true;
+
+  stream_xfer_complete(idx, p_as, ep_addr, result, xferred_bytes, false);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t id;
+  uint8_t subtype;
+  uint8_t source;  // clock entity this one is connected to
+} audioh_entity_t;
+
+// Follow terminal's clock through selector (first pin) and multiplier to the clock source
+static uint8_t resolve_clock(audioh_entity_t const* entities, uint8_t count, uint8_t terminal) {
+  uint8_t id = terminal;
+  for (uint8_t hop = 0; hop < 4 && id; hop++) {
+    audioh_entity_t const* ent = NULL;
+    for (uint8_t i = 0; i < count; i++) {
+      if (entities[i].id == id) {
+        ent = &entities[i];
+        break;
+      }
+    }
+    if (!ent) return 0;
+    if (ent->subtype == AUDIO_CS_AC_INTERFACE_CLOCK_SOURCE) return id;
+    id = ent->source;
+  }
+
+  return 0;
+}
+
+static bool alt_valid(audioh_alt_t const* p_alt) {
+  return p_alt->ep_data.bLength && p_alt->channels && p_alt->subslot_size;
+}
+
+// Open an endpoint once per address, using the alternate setting with the largest payload so that
+// switching format does not need to re-open it.
+static bool stream_open_endpoints(audioh_stream_t const* p_as) {
+  for (uint8_t i = 0; i < p_as->alt_count; i++) {
+    for (uint8_t is_fb = 0; is_fb < 2; is_fb++) {
+      tusb_desc_endpoint_t const* desc_ep = is_fb ? &p_as->alts[i].ep_fb : &p_as->alts[i].ep_data;
+      if (desc_ep->bLength == 0) continue;
+
+      bool skip = false;
+      for (uint8_t j = 0; j < p_as->alt_count; j++) {
+        tusb_desc_endpoint_t const* other = is_fb ? &p_as->alts[j].ep_fb : &p_as->alts[j].ep_data;
+        if (j == i || other->bLength == 0 || other->bEndpointAddress != desc_ep->bEndpointAddress) continue;
+        uint16_t const other_size = tu_edpt_max_payload(other);
+        uint16_t const size = tu_edpt_max_payload(desc_ep);
+        if (other_size > size || (other_size == size && j < i)) {
+          skip = true; // opened with a larger (or earlier equal) alternate setting
+          break;
+        }
+      }
+
+      if (!skip) TU_ASSERT(tuh_edpt_open(p_as->daddr, desc_ep));
+    }
+  }
+
+  return true;
+}
+
+bool audioh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  // Audio Control v2, usbh binds it together with all interfaces of the audio function (IAD)
+  TU_VERIFY(TUSB_CLASS_AUDIO            == desc_itf->bInterfaceClass    &&
+            AUDIO_SUBCLASS_CONTROL      == desc_itf->bInterfaceSubClass &&
+            AUDIO_FUNC_PROTOCOL_CODE_V2 == desc_itf->bInterfaceProtocol);
+
+  TU_LOG_DRV("AUDIO opening Interface %u (addr = %u)\r\n", desc_itf->bInterfaceNumber, daddr);
+
+  uint8_t const itf_ac = desc_itf->bInterfaceNumber;
+  uint8_t itf_last = itf_ac;
+
+  audioh_entity_t entities[AUDIOH_ENTITY_MAX];
+  uint8_t entity_count = 0;
+
+  audioh_stream_t* p_as = NULL;
+  audioh_alt_t* p_alt = NULL;
+  bool in_ac = true;
+
+  uint8_t const* p_desc = tu_desc_next(desc_itf);
+  uint8_t const* desc_end = ((uint8_t const*) desc_itf) + max_len;
+
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+
+    if (TUSB_DESC_INTERFACE == desc_type) {
+      tusb_desc_interface_t const* desc_as = (tusb_desc_interface_t const*) p_desc;
+      in_ac = false;
+      itf_last = tu_max8(itf_last, desc_as->bInterfaceNumber);
+
+      // previous alternate setting is kept if it has a usable format
+      if (p_alt && alt_valid(p_alt)) p_as->alt_count++;
+      p_alt = NULL;
+      p_as = NULL;
+
+      if (TUSB_CLASS_AUDIO == desc_as->bInterfaceClass && AUDIO_SUBCLASS_STREAMING == desc_as->bInterfaceSubClass) {
+        if (desc_as->bAlternateSetting == 0) {
+          for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+            if (audioh_data[i].daddr == 0) {
+              p_as = &audioh_data[i];
+              stream_reset(p_as);
+              p_as->daddr = daddr;
+              p_as->itf_ac = itf_ac;
+              p_as->itf_num = desc_as->bInterfaceNumber;
+              break;
+            }
+          }
+          if (!p_as) {
+            TU_LOG_DRV("  AUDIOh no room for interface %u\r\n", desc_as->bInterfaceNumber);
+          }
+        } else {
+          uint8_t const idx = tuh_audio_itf_get_index(daddr, desc_as->bInterfaceNumber);
+          p_as = (idx < CFG_TUH_AUDIO) ? &audioh_data[idx] : NULL;
+          if (p_as && p_as->alt_count < CFG_TUH_AUDIO_ALT_MAX && desc_as->bNumEndpoints) {
+            p_alt = &p_as->alts[p_as->alt_count];
+            tu_memclr(p_alt, sizeof(audioh_alt_t));
+            p_alt->alt = desc_as->bAlternateSetting;
+          }
+        }
+      }
+    } else if (TUSB_DESC_CS_INTERFACE == desc_type) {
+      uint8_t const subtype = p_desc[2];
+      if (in_ac) {
+        // clock entities and terminals, ID at offset 3
+        uint8_t source = 0;
+        bool track = true;
+        switch (subtype) {
+          case AUDIO_CS_AC_INTERFACE_CLOCK_SOURCE: break;
+          case AUDIO_CS_AC_INTERFACE_CLOCK_SELECTOR:
+            source = ((audio_desc_clock_selector_t const*) p_desc)->baCSourceID;
+            break;
+          case AUDIO_CS_AC_INTERFACE_CLOCK_MULTIPLIER:
+            source = ((audio_desc_clock_multiplier_t const*) p_desc)->bCSourceID;
+            break;
+          case AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL:
+            source = ((audio_desc_input_terminal_t const*) p_desc)->bCSourceID;
+            break;
+          case AUDIO_CS_AC_INTERFACE_OUTPUT_TERMINAL:
+            source = ((audio_desc_output_terminal_t const*) p_desc)->bCSourceID;
+            break;
+          default: track = false; break;
+        }
+
+        if (track && entity_count < AUDIOH_ENTITY_MAX) {
+          entities[entity_count].id = p_desc[3];
+          entities[entity_count].subtype = subtype;
+          entities[entity_count].source = source;
+          entity_count++;
+        }
+      } else if (p_alt) {
+        if (AUDIO_CS_AS_INTERFACE_AS_GENERAL == subtype) {
+          audio_desc_cs_as_interface_t const* desc_cs = (audio_desc_cs_as_interface_t const*) p_desc;
+          p_as->terminal = desc_cs->bTerminalLink;
+          p_alt->channels = desc_cs->bNrChannels;
+        } else if (AUDIO_CS_AS_INTERFACE_FORMAT_TYPE == subtype && AUDIO_FORMAT_TYPE_I == p_desc[3]) {
+          audio_desc_type_I_format_t const* desc_fmt = (audio_desc_type_I_format_t const*) p_desc;
+          p_alt->subslot_size = desc_fmt->bSubslotSize;
+          p_alt->bit_resolution = desc_fmt->bBitResolution;
+        }
+      }
+    } else if (TUSB_DESC_ENDPOINT == desc_type && p_alt) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (TUSB_XFER_ISOCHRONOUS == desc_ep->bmAttributes.xfer) {
+        if (desc_ep->bmAttributes.usage == (TUSB_ISO_EP_ATT_EXPLICIT_FB >> 4)) {
+          memcpy(&p_alt->ep_fb, desc_ep, sizeof(tusb_desc_endpoint_t));
+        } else if (tu_edpt_max_payload(desc_ep) <= CFG_TUH_AUDIO_EP_BUFSIZE) {
+          memcpy(&p_alt->ep_data, desc_ep, sizeof(tusb_desc_endpoint_t));
+          p_as->dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+        } else {
+          TU_LOG_DRV("  AUDIOh alt %u payload %u exceeds CFG_TUH_AUDIO_EP_BUFSIZE\r\n",
+                     p_alt->alt, tu_edpt_max_payload(desc_ep));
+        }
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  if (p_alt && alt_valid(p_alt)) p_as->alt_count++;
+
+  // resolve clock and open endpoints of streams in this function, streams without usable format are dropped
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < CFG_TUH_AUDIO; i++) {
+    audioh_stream_t* p_stream = &audioh_data[i];
+    if (p_stream->daddr != daddr || p_stream->itf_ac != itf_ac || p_stream->mounted) continue;
+
+    if (p_stream->alt_count == 0 || !stream_open_endpoints(p_stream)) {
+      stream_reset(p_stream);
+      continue;
+    }
+
+    p_stream->itf_last = itf_last;
+    p_stream->clock_id = resolve_clock(entities, entity_count, p_stream->terminal);
+    TU_LOG_DRV("  AUDIOh stream %u: itf %u, %s, %u formats, clock %u\r\n", i, p_stream->itf_num,
+               p_stream->dir == TUSB_DIR_IN ? "IN" : "OUT", p_stream->alt_count, p_stream->clock_id);
+    count++;
+  }
+
+  return count > 0;
+}
+
+bool audioh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t itf_last = itf_num;
+
+  for (uint8_t idx = 0; idx < CFG_TUH_AUDIO; idx++) {
+    audioh_stream_t* p_as = &audioh_data[idx];
+    if (p_as->daddr == daddr && p_as->itf_ac == itf_num && !p_as->mounted) {
+      itf_last = p_as->itf_last;
+      p_as->mounted = true;
+      if (tuh_audio_mount_cb) tuh_audio_mount_cb(idx);
+    }
+  }
+
+  TU_LOG_DRV("AUDIOh Set Configure complete\r\n");
+
+  // notify usbh that driver enumeration is complete, all interfaces of the function are bound to this driver
+  usbh_driver_set_config_complete(daddr, itf_last);
+
+  return true;
+}
+
+#endif
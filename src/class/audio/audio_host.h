@@ -0,0 +1,162 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_AUDIO_HOST_H_
+#define _TUSB_AUDIO_HOST_H_
+
+#include "audio.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+// USB Audio Class 2.0 host driver. Each Audio Streaming interface of a mounted audio function is a stream,
+// CFG_TUH_AUDIO is the total number of streams the driver can hold.
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Max number of alternate settings (formats) kept per stream, excluding zero-bandwidth alt 0
+#ifndef CFG_TUH_AUDIO_ALT_MAX
+#define CFG_TUH_AUDIO_ALT_MAX       4
+#endif
+
+// Endpoint buffer size, alternate settings with a larger max payload are ignored
+#ifndef CFG_TUH_AUDIO_EP_BUFSIZE
+#define CFG_TUH_AUDIO_EP_BUFSIZE    512
+#endif
+
+// Sample FIFO size per stream, at least two endpoint buffers to absorb jitter of the application
+#ifndef CFG_TUH_AUDIO_FIFO_SIZE
+#define CFG_TUH_AUDIO_FIFO_SIZE     (4 * CFG_TUH_AUDIO_EP_BUFSIZE)
+#endif
+
+// Process isochronous transfer complete in ISR context: endpoint is re-armed and tuh_audio_rx_cb()/tx_cb() are
+// invoked straight from the completion interrupt, so that the next (micro)frame is not missed because of
+// tuh_task() scheduling. The callbacks must then be ISR-safe.
+#ifndef CFG_TUH_AUDIO_XFER_ISR
+#define CFG_TUH_AUDIO_XFER_ISR      0
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Format of an alternate setting of an Audio Streaming interface
+typedef struct {
+  uint8_t alt;            // bAlternateSetting
+  uint8_t channels;       // bNrChannels
+  uint8_t subslot_size;   // bytes per sample of one channel
+  uint8_t bit_resolution; // used bits of a subslot
+  uint16_t max_payload;   // bytes per (micro)frame
+  uint8_t interval;       // bInterval of data endpoint
+  bool has_feedback;      // asynchronous OUT with explicit feedback endpoint
+} tuh_audio_format_t;
+
+// Get stream index from device address + Audio Streaming interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_audio_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Get Interface information of the Audio Streaming interface (alt 0)
+// return true if index is correct and interface is currently mounted
+bool tuh_audio_itf_get_info(uint8_t idx, tuh_itf_info_t* info);
+
+// Check if a stream is mounted
+bool tuh_audio_mounted(uint8_t idx);
+
+// Direction of stream: TUSB_DIR_IN for device to host (e.g microphone), TUSB_DIR_OUT for host to device (e.g speaker)
+tusb_dir_t tuh_audio_stream_dir(uint8_t idx);
+
+// Number of formats (non-zero alternate settings) of a stream
+uint8_t tuh_audio_format_count(uint8_t idx);
+
+// Get format by its position (0 .. count-1)
+bool tuh_audio_format_get(uint8_t idx, uint8_t fmt_idx, tuh_audio_format_t* fmt);
+
+// Start streaming: set sample rate on the clock of the stream, select alternate setting then start
+// isochronous transfers. Asynchronous, tuh_audio_stream_start_cb() is invoked when done.
+bool tuh_audio_stream_start(uint8_t idx, uint8_t alt, uint32_t sample_rate);
+
+// Stop streaming by selecting zero-bandwidth alternate setting 0
+bool tuh_audio_stream_stop(uint8_t idx);
+
+// Check if stream is running
+bool tuh_audio_streaming(uint8_t idx);
+
+// Bytes of received samples available to read (IN stream)
+uint32_t tuh_audio_available(uint8_t idx);
+
+// Read received samples (IN stream), return number of bytes read
+uint32_t tuh_audio_read(uint8_t idx, void* buffer, uint32_t bufsize);
+
+// Bytes that can be written to the sample fifo (OUT stream)
+uint32_t tuh_audio_write_available(uint8_t idx);
+
+// Write samples to be sent (OUT stream), return number of bytes written
+uint32_t tuh_audio_write(uint8_t idx, void const* buffer, uint32_t bufsize);
+
+// Latest feedback value of asynchronous OUT stream: samples per (micro)frame in 16.16 fixed point,
+// nominal value derived from sample rate if device has not sent feedback yet
+uint32_t tuh_audio_feedback_get(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with an Audio Streaming interface is mounted
+TU_ATTR_WEAK void tuh_audio_mount_cb(uint8_t idx);
+
+// Invoked when a device with an Audio Streaming interface is unmounted
+TU_ATTR_WEAK void tuh_audio_umount_cb(uint8_t idx);
+
+// Invoked when tuh_audio_stream_start() is complete
+TU_ATTR_WEAK void tuh_audio_stream_start_cb(uint8_t idx, bool success);
+
+// Invoked when samples of an isochronous packet are written to fifo (IN stream).
+// Invoked in ISR context if CFG_TUH_AUDIO_XFER_ISR is set.
+TU_ATTR_WEAK void tuh_audio_rx_cb(uint8_t idx, uint32_t xferred_bytes);
+
+// Invoked when an isochronous packet is sent (OUT stream), application should refill the fifo.
+// Invoked in ISR context if CFG_TUH_AUDIO_XFER_ISR is set.
+TU_ATTR_WEAK void tuh_audio_tx_cb(uint8_t idx, uint32_t xferred_bytes);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool audioh_init       (void);
+bool audioh_deinit     (void);
+bool audioh_open       (uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *desc_itf, uint16_t max_len);
+bool audioh_set_config (uint8_t dev_addr, uint8_t itf_num);
+bool audioh_xfer_cb    (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+bool audioh_xfer_isr   (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void audioh_close      (uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_AUDIO_HOST_H_ */
@@ -39,19 +39,45 @@
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_ev;
   uint8_t ep_acl_in;
   uint8_t ep_acl_out;
-  uint8_t ep_voice[2];  // Not used yet
+  uint8_t ep_voice[2];  // ISO endpoints, indexed by direction
   uint8_t ep_voice_size[2][CFG_TUD_BTH_ISO_ALT_COUNT];
 
+  // ACL OUT buffers on the endpoint in submission order: written by submitter, read by completion.
+  // Indices run over twice the buffer count to tell full from empty.
+  volatile uint8_t acl_out_wr;
+  volatile uint8_t acl_out_rd;
+  uint8_t* acl_out_buf[CFG_TUD_BTH_ACL_OUT_BUF_N];
+
+  #if CFG_TUD_BTH_SCO
+  uint8_t iso_alt; // current alternate setting of ISO interface
+
+  tu_fifo_t sco_rx_ff;
+  tu_fifo_t sco_tx_ff;
+  uint8_t sco_rx_ff_buf[CFG_TUD_BTH_SCO_RX_BUFSIZE];
+  uint8_t sco_tx_ff_buf[CFG_TUD_BTH_SCO_TX_BUFSIZE];
+
+  CFG_TUSB_MEM_ALIGN uint8_t sco_epout_buf[CFG_TUD_BTH_SCO_EPSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t sco_epin_buf[CFG_TUD_BTH_SCO_EPSIZE];
+  #endif
+
   // Endpoint Transfer buffer
   CFG_TUSB_MEM_ALIGN bt_hci_cmd_t hci_cmd;
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_BTH_DATA_EPSIZE];
+  #if !CFG_TUD_BTH_ACL_OUT_APP_BUF
+  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_BTH_ACL_OUT_BUF_N][CFG_TUD_BTH_DATA_EPSIZE];
+  #endif
 
 } btd_interface_t;
 
+#define ACL_OUT_IDX_NEXT(_idx)  ((uint8_t) (((_idx) + 1) % (2 * CFG_TUD_BTH_ACL_OUT_BUF_N)))
+
+TU_VERIFY_STATIC(CFG_TUD_BTH_ACL_OUT_BUF_N >= 1 && CFG_TUD_BTH_ACL_OUT_BUF_N <= CFG_TUD_EDPT_XFER_QUEUE_SZ + 1,
+                 "CFG_TUD_BTH_ACL_OUT_BUF_N - 1 buffers must fit in endpoint transfer queue");
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -59,20 +85,141 @@ CFG_TUD_MEM_SECTION btd_interface_t _btd_itf;
 
 static bool bt_tx_data(uint8_t ep, void *data, uint16_t len)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _btd_itf.rhport;
 
+  #if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  // queued after transfers in flight, fail only if queue is full
+  return usbd_edpt_xfer(rhport, ep, data, len);
+  #else
   // skip if previous transfer not complete
   TU_VERIFY(!usbd_edpt_busy(rhport, ep));
 
   TU_ASSERT(usbd_edpt_xfer(rhport, ep, data, len));
 
+  return true;
+  #endif
+}
+
+static bool acl_out_xfer(uint8_t* buf, uint16_t len)
+{
+  uint8_t const rhport = _btd_itf.rhport;
+  uint8_t const wr = _btd_itf.acl_out_wr;
+
+  uint8_t const count = (uint8_t) ((wr + 2 * CFG_TUD_BTH_ACL_OUT_BUF_N - _btd_itf.acl_out_rd) % (2 * CFG_TUD_BTH_ACL_OUT_BUF_N));
+
+  TU_VERIFY(count < CFG_TUD_BTH_ACL_OUT_BUF_N);
+
+  // record buffer first since transfer can complete before usbd_edpt_xfer() returns
+  _btd_itf.acl_out_buf[wr % CFG_TUD_BTH_ACL_OUT_BUF_N] = buf;
+  _btd_itf.acl_out_wr = ACL_OUT_IDX_NEXT(wr);
+
+  if ( !usbd_edpt_xfer(rhport, _btd_itf.ep_acl_out, buf, len) )
+  {
+    _btd_itf.acl_out_wr = wr;
+    return false;
+  }
+
+  return true;
+}
+
+#if CFG_TUD_BTH_SCO
+static inline uint16_t sco_ep_size(uint8_t dir)
+{
+  return _btd_itf.ep_voice_size[dir][_btd_itf.iso_alt];
+}
+
+// Send next isochronous packet, zero-length if controller has no data so that host keeps its schedule
+static void sco_tx_xfer(uint8_t rhport)
+{
+  uint16_t const count = tu_fifo_read_n(&_btd_itf.sco_tx_ff, _btd_itf.sco_epin_buf, sco_ep_size(TUSB_DIR_IN));
+  TU_ASSERT(usbd_edpt_xfer(rhport, _btd_itf.ep_voice[TUSB_DIR_IN], _btd_itf.sco_epin_buf, count), );
+}
+
+static bool sco_set_alt(uint8_t rhport, uint8_t alt)
+{
+  TU_VERIFY(alt < CFG_TUD_BTH_ISO_ALT_COUNT);
+
+  // close endpoints of previous alternate setting
+  for (uint8_t dir = 0; dir < 2; dir++)
+  {
+    if (_btd_itf.ep_voice[dir] && sco_ep_size(dir))
+    {
+      #ifndef TUP_DCD_EDPT_ISO_ALLOC
+      usbd_edpt_close(rhport, _btd_itf.ep_voice[dir]);
+      #endif
+    }
+  }
+
+  // data buffered for previous setting is stale
+  tu_fifo_clear(&_btd_itf.sco_rx_ff);
+  tu_fifo_clear(&_btd_itf.sco_tx_ff);
+
+  _btd_itf.iso_alt = alt;
+  if (tud_bt_sco_alt_setting_cb) tud_bt_sco_alt_setting_cb(alt);
+
+  for (uint8_t dir = 0; dir < 2; dir++)
+  {
+    uint16_t const ep_size = sco_ep_size(dir);
+    if (!_btd_itf.ep_voice[dir] || !ep_size) continue;
+
+    tusb_desc_endpoint_t const desc_ep =
+    {
+      .bLength          = sizeof(tusb_desc_endpoint_t),
+      .bDescriptorType  = TUSB_DESC_ENDPOINT,
+      .bEndpointAddress = _btd_itf.ep_voice[dir],
+      .bmAttributes     = { .xfer = TUSB_XFER_ISOCHRONOUS },
+      .wMaxPacketSize   = tu_htole16(ep_size),
+      .bInterval        = 1
+    };
+
+    #ifdef TUP_DCD_EDPT_ISO_ALLOC
+    TU_ASSERT(usbd_edpt_iso_activate(rhport, &desc_ep));
+    #else
+    TU_ASSERT(usbd_edpt_open(rhport, &desc_ep));
+    #endif
+  }
+
+  // start streaming
+  if (_btd_itf.ep_voice[TUSB_DIR_OUT] && sco_ep_size(TUSB_DIR_OUT))
+  {
+    TU_ASSERT(usbd_edpt_xfer(rhport, _btd_itf.ep_voice[TUSB_DIR_OUT], _btd_itf.sco_epout_buf, sco_ep_size(TUSB_DIR_OUT)));
+  }
+
+  if (_btd_itf.ep_voice[TUSB_DIR_IN] && sco_ep_size(TUSB_DIR_IN)) sco_tx_xfer(rhport);
+
   return true;
 }
+#endif
 
 //--------------------------------------------------------------------+
 // READ API
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_BTH_SCO
+uint8_t tud_bt_sco_alt_setting(void)
+{
+  return _btd_itf.iso_alt;
+}
+
+uint32_t tud_bt_sco_available(void)
+{
+  return tu_fifo_count(&_btd_itf.sco_rx_ff);
+}
+
+uint32_t tud_bt_sco_read(void *buffer, uint32_t bufsize)
+{
+  return tu_fifo_read_n(&_btd_itf.sco_rx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+}
+#endif
+
+#if CFG_TUD_BTH_ACL_OUT_APP_BUF
+bool tud_bt_acl_data_receive(void *acl_buf, uint16_t buf_len)
+{
+  TU_VERIFY(_btd_itf.ep_acl_out);
+  return acl_out_xfer((uint8_t*) acl_buf, buf_len);
+}
+#endif
+
 
 //--------------------------------------------------------------------+
 // WRITE API
@@ -88,11 +235,30 @@ bool tud_bt_acl_data_send(void *event, uint16_t event_len)
   return bt_tx_data(_btd_itf.ep_acl_in, event, event_len);
 }
 
+#if CFG_TUD_BTH_SCO
+uint32_t tud_bt_sco_write(void const *buffer, uint32_t bufsize)
+{
+  // no isochronous IN bandwidth
+  TU_VERIFY(sco_ep_size(TUSB_DIR_IN), 0);
+  return tu_fifo_write_n(&_btd_itf.sco_tx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+}
+
+uint32_t tud_bt_sco_write_available(void)
+{
+  return tu_fifo_remaining(&_btd_itf.sco_tx_ff);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
 void btd_init(void) {
   tu_memclr(&_btd_itf, sizeof(_btd_itf));
+
+  #if CFG_TUD_BTH_SCO
+  tu_fifo_config(&_btd_itf.sco_rx_ff, _btd_itf.sco_rx_ff_buf, CFG_TUD_BTH_SCO_RX_BUFSIZE, 1, true);
+  tu_fifo_config(&_btd_itf.sco_tx_ff, _btd_itf.sco_tx_ff_buf, CFG_TUD_BTH_SCO_TX_BUFSIZE, 1, false);
+  #endif
 }
 
 bool btd_deinit(void) {
@@ -102,6 +268,12 @@ bool btd_deinit(void) {
 void btd_reset(uint8_t rhport)
 {
   (void)rhport;
+
+  #if CFG_TUD_BTH_SCO
+  _btd_itf.iso_alt = 0;
+  tu_fifo_clear(&_btd_itf.sco_rx_ff);
+  tu_fifo_clear(&_btd_itf.sco_tx_ff);
+  #endif
 }
 
 uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_t max_len)
@@ -119,6 +291,7 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
 
   TU_ASSERT(itf_desc->bNumEndpoints == 3 && max_len >= hci_itf_size);
 
+  _btd_itf.rhport  = rhport;
   _btd_itf.itf_num = itf_desc->bInterfaceNumber;
 
   desc_ep = (tusb_desc_endpoint_t const *) tu_desc_next(itf_desc);
@@ -133,8 +306,15 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
 
   itf_desc = (tusb_desc_interface_t const *)tu_desc_next(tu_desc_next(tu_desc_next(desc_ep)));
 
-  // Prepare for incoming data from host
-  TU_ASSERT(usbd_edpt_xfer(rhport, _btd_itf.ep_acl_out, _btd_itf.epout_buf, CFG_TUD_BTH_DATA_EPSIZE), 0);
+  _btd_itf.acl_out_wr = _btd_itf.acl_out_rd = 0;
+
+  #if !CFG_TUD_BTH_ACL_OUT_APP_BUF
+  // Prepare for incoming data from host, controller provides buffers otherwise
+  for (uint8_t i = 0; i < CFG_TUD_BTH_ACL_OUT_BUF_N; i++)
+  {
+    TU_ASSERT(acl_out_xfer(_btd_itf.epout_buf[i], CFG_TUD_BTH_DATA_EPSIZE), 0);
+  }
+  #endif
 
   drv_len = hci_itf_size;
 
@@ -191,6 +371,23 @@ uint16_t btd_open(uint8_t rhport, tusb_desc_interface_t const *itf_desc, uint16_
     drv_len += iso_alt_itf_size;
   }
 
+  #if CFG_TUD_BTH_SCO
+  _btd_itf.iso_alt = 0;
+
+  #ifdef TUP_DCD_EDPT_ISO_ALLOC
+  // reserve endpoint memory for the largest alternate setting, endpoints are activated with SET_INTERFACE
+  for (uint8_t d = 0; d < 2; d++)
+  {
+    uint16_t max_size = 0;
+    for (uint8_t alt = 0; alt < CFG_TUD_BTH_ISO_ALT_COUNT; alt++)
+    {
+      max_size = tu_max16(max_size, _btd_itf.ep_voice_size[d][alt]);
+    }
+    TU_ASSERT(usbd_edpt_iso_alloc(rhport, _btd_itf.ep_voice[d], max_size), 0);
+  }
+  #endif
+  #endif
+
   return drv_len;
 }
 
@@ -213,9 +410,20 @@ bool btd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t c
     }
     else if (request->bmRequestType_bit.recipient == TUSB_REQ_RCPT_INTERFACE)
     {
-      if (request->bRequest == TUSB_REQ_SET_INTERFACE && _btd_itf.itf_num + 1 == request->wIndex)
+      if (request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && _btd_itf.itf_num + 1 == request->wIndex)
       {
-        // TODO: Set interface it would involve changing size of endpoint size
+        #if CFG_TUD_BTH_SCO
+        // ISO interface: alternate setting changes isochronous endpoint size
+        if (request->bRequest == TUSB_REQ_GET_INTERFACE)
+        {
+          return tud_control_xfer(rhport, request, &_btd_itf.iso_alt, 1);
+        }
+        TU_VERIFY(request->bRequest == TUSB_REQ_SET_INTERFACE);
+        TU_VERIFY(sco_set_alt(rhport, tu_u16_low(request->wValue)));
+        #else
+        TU_VERIFY(request->bRequest == TUSB_REQ_SET_INTERFACE);
+        #endif
+        return tud_control_status(rhport, request);
       }
       else
       {
@@ -240,16 +448,43 @@ bool btd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t c
 
 bool btd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
+  (void)rhport;
   (void)result;
 
   // received new data from host
   if (ep_addr == _btd_itf.ep_acl_out)
   {
-    if (tud_bt_acl_data_received_cb) tud_bt_acl_data_received_cb(_btd_itf.epout_buf, xferred_bytes);
+    // buffers complete in submission order
+    uint8_t const rd = _btd_itf.acl_out_rd;
+    uint8_t* buf = _btd_itf.acl_out_buf[rd % CFG_TUD_BTH_ACL_OUT_BUF_N];
+    _btd_itf.acl_out_rd = ACL_OUT_IDX_NEXT(rd);
+
+    if (tud_bt_acl_data_received_cb) tud_bt_acl_data_received_cb(buf, (uint16_t) xferred_bytes);
 
-    // prepare for next data
-    TU_ASSERT(usbd_edpt_xfer(rhport, _btd_itf.ep_acl_out, _btd_itf.epout_buf, CFG_TUD_BTH_DATA_EPSIZE));
+    #if !CFG_TUD_BTH_ACL_OUT_APP_BUF
+    // re-arm the same buffer behind the others already on the endpoint
+    TU_ASSERT(acl_out_xfer(buf, CFG_TUD_BTH_DATA_EPSIZE));
+    #endif
   }
+#if CFG_TUD_BTH_SCO
+  else if (ep_addr == _btd_itf.ep_voice[TUSB_DIR_OUT])
+  {
+    uint16_t const ep_size = sco_ep_size(TUSB_DIR_OUT);
+    if (ep_size == 0) return true; // alternate setting changed
+
+    if (result == XFER_RESULT_SUCCESS && xferred_bytes)
+    {
+      tu_fifo_write_n(&_btd_itf.sco_rx_ff, _btd_itf.sco_epout_buf, (tu_fifo_size_t) xferred_bytes);
+      if (tud_bt_sco_data_received_cb) tud_bt_sco_data_received_cb((uint16_t) xferred_bytes);
+    }
+
+    TU_ASSERT(usbd_edpt_xfer(rhport, ep_addr, _btd_itf.sco_epout_buf, ep_size));
+  }
+  else if (ep_addr == _btd_itf.ep_voice[TUSB_DIR_IN])
+  {
+    if (sco_ep_size(TUSB_DIR_IN)) sco_tx_xfer(rhport);
+  }
+#endif
   else if (ep_addr == _btd_itf.ep_ev)
   {
     if (tud_bt_event_sent_cb) tud_bt_event_sent_cb((uint16_t)xferred_bytes);
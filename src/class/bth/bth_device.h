@@ -41,6 +41,38 @@
 #define CFG_TUD_BTH_DATA_EPSIZE      64
 #endif
 
+// Number of ACL OUT buffers armed on the endpoint, next one is already receiving while
+// tud_bt_acl_data_received_cb() processes the previous. More than 1 requires CFG_TUD_EDPT_XFER_QUEUE_SZ >= N-1
+#ifndef CFG_TUD_BTH_ACL_OUT_BUF_N
+#define CFG_TUD_BTH_ACL_OUT_BUF_N    1
+#endif
+
+// Receive ACL OUT data directly into buffers of the controller stack given with tud_bt_acl_data_receive()
+// instead of driver buffers. CFG_TUD_BTH_ACL_OUT_BUF_N is then the number of buffers that can be outstanding.
+#ifndef CFG_TUD_BTH_ACL_OUT_APP_BUF
+#define CFG_TUD_BTH_ACL_OUT_APP_BUF  0
+#endif
+
+// Enable SCO (voice) data path over the isochronous endpoints of ISO interface
+#ifndef CFG_TUD_BTH_SCO
+#define CFG_TUD_BTH_SCO              0
+#endif
+
+// Largest isochronous endpoint size of all ISO alternate settings
+#ifndef CFG_TUD_BTH_SCO_EPSIZE
+#define CFG_TUD_BTH_SCO_EPSIZE       64
+#endif
+
+// SCO FIFO sizes, kept small since everything buffered adds to voice latency. RX FIFO overwrites
+// oldest data when controller does not keep up
+#ifndef CFG_TUD_BTH_SCO_RX_BUFSIZE
+#define CFG_TUD_BTH_SCO_RX_BUFSIZE   128
+#endif
+
+#ifndef CFG_TUD_BTH_SCO_TX_BUFSIZE
+#define CFG_TUD_BTH_SCO_TX_BUFSIZE   128
+#endif
+
 // Allow BTH class to work in historically compatibility mode where the bRequest is always 0xe0.
 // See Bluetooth Core v5.3, Vol. 4, Part B, Section 2.2
 #ifndef CFG_TUD_BTH_HISTORICAL_COMPATIBLE
@@ -74,8 +106,18 @@ TU_ATTR_WEAK void tud_bt_hci_cmd_cb(void *hci_cmd, size_t cmd_len);
 // Part E, 5.4.2.
 // Length is from 4 bytes, (12 bits for Handle, 4 bits for flags
 // and 16 bits for data total length) to endpoint size.
+// With CFG_TUD_BTH_ACL_OUT_APP_BUF acl_data is the buffer from tud_bt_acl_data_receive() which
+// is given back to controller, otherwise it is a driver buffer only valid in this callback.
 TU_ATTR_WEAK void tud_bt_acl_data_received_cb(void *acl_data, uint16_t data_len);
 
+// Invoked when host selects an alternate setting of ISO interface, which determines the
+// isochronous bandwidth for active SCO links and their air codec (Bluetooth core specification
+// Vol 4, Part B, 2.1.1). Alternate setting 0 means no SCO data. Controller should set up codec here.
+TU_ATTR_WEAK void tud_bt_sco_alt_setting_cb(uint8_t alt);
+
+// Invoked when SCO data was received over USB from Bluetooth host and written to SCO RX FIFO
+TU_ATTR_WEAK void tud_bt_sco_data_received_cb(uint16_t data_len);
+
 // Called when event sent with tud_bt_event_send() was delivered to BT stack.
 // Controller can release/reuse buffer with Event packet at this point.
 TU_ATTR_WEAK void tud_bt_event_sent_cb(uint16_t sent_bytes);
@@ -98,8 +140,31 @@ bool tud_bt_event_send(void *event, uint16_t event_len);
 // and 16 bits for data total length). Upper limit is not limited
 // to endpoint size since buffer is allocate by controller
 // and must not be reused till tud_bt_acl_data_sent_cb() is called.
+// With CFG_TUD_EDPT_XFER_QUEUE_SZ more packets can be sent before previous
+// ones are delivered, tud_bt_acl_data_sent_cb() is called for each in order.
 bool tud_bt_acl_data_send(void *acl_data, uint16_t data_len);
 
+#if CFG_TUD_BTH_ACL_OUT_APP_BUF
+// Bluetooth controller calls this to give a buffer for next ACL data packet
+// from host, up to CFG_TUD_BTH_ACL_OUT_BUF_N buffers can be outstanding. Buffer
+// is handed back with tud_bt_acl_data_received_cb() and filled in order.
+bool tud_bt_acl_data_receive(void *acl_buf, uint16_t buf_len);
+#endif
+
+#if CFG_TUD_BTH_SCO
+// Current alternate setting of ISO interface
+uint8_t tud_bt_sco_alt_setting(void);
+
+// SCO data packets from host as a byte stream (Bluetooth core specification Vol 2, Part E, 5.4.3)
+uint32_t tud_bt_sco_available(void);
+uint32_t tud_bt_sco_read(void *buffer, uint32_t bufsize);
+
+// SCO data packets to host, streamed out in isochronous packets of current alternate setting.
+// Data is dropped when alternate setting is 0.
+uint32_t tud_bt_sco_write(void const *buffer, uint32_t bufsize);
+uint32_t tud_bt_sco_write_available(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -186,6 +186,15 @@ typedef enum {
   CDC_CONTROL_LINE_STATE_RTS = 0x02,
 } cdc_control_line_state_t;
 
+/// Packet filter bitmap of SET_ETHERNET_PACKET_FILTER request [USBECM1.2 6.2.4]
+typedef enum {
+  CDC_ETHERNET_PACKET_TYPE_PROMISCUOUS   = 0x01,
+  CDC_ETHERNET_PACKET_TYPE_ALL_MULTICAST = 0x02,
+  CDC_ETHERNET_PACKET_TYPE_DIRECTED      = 0x04,
+  CDC_ETHERNET_PACKET_TYPE_BROADCAST     = 0x08,
+  CDC_ETHERNET_PACKET_TYPE_MULTICAST     = 0x10,
+} cdc_ethernet_packet_filter_t;
+
 typedef enum {
   CDC_LINE_CODING_STOP_BITS_1   = 0, // 1   bit
   CDC_LINE_CODING_STOP_BITS_1_5 = 1, // 1.5 bits
@@ -33,6 +33,10 @@
 
 #include "cdc_device.h"
 
+#if CFG_TUSB_BRIDGE_CDC
+#include "bridge/bridge_cdc.h"
+#endif
+
 // Level where CFG_TUSB_DEBUG must be at least for this driver is logged
 #ifndef CFG_TUD_CDC_LOG_LEVEL
   #define CFG_TUD_CDC_LOG_LEVEL   CFG_TUD_LOG_LEVEL
@@ -47,6 +51,7 @@
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_notif;
   uint8_t ep_in;
@@ -55,53 +60,76 @@ typedef struct
   // Bit 0:  DTR (Data Terminal Ready), Bit 1: RTS (Request to Send)
   uint8_t line_state;
 
+  uint16_t ep_out_size; // OUT endpoint max packet size
+
+  #if CFG_TUD_CDC_TX_FLUSH_SOF
+  volatile uint16_t tx_flush_sof; // SOF count down to auto flush, 0 if not armed
+  #endif
+  volatile bool tx_flush_deferred; // flush is queued to usbd task by *_from_isr() or SOF
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
-  char    wanted_char;
+  uint8_t wanted_count;
+  char    wanted_chars[CFG_TUD_CDC_WANTED_CHAR_MAX];
   TU_ATTR_ALIGNED(4) cdc_line_coding_t line_coding;
 
   // FIFO
   tu_fifo_t rx_ff;
   tu_fifo_t tx_ff;
 
+  #if !CFG_TUD_CDC_APP_FIFO_BUF
   uint8_t rx_ff_buf[CFG_TUD_CDC_RX_BUFSIZE];
   uint8_t tx_ff_buf[CFG_TUD_CDC_TX_BUFSIZE];
+  #endif
 
   OSAL_MUTEX_DEF(rx_ff_mutex);
   OSAL_MUTEX_DEF(tx_ff_mutex);
 
   // Endpoint Transfer buffer
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CDC_EP_BUFSIZE];
-  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CDC_EP_BUFSIZE];
+  #if !CFG_TUD_CDC_RX_FIFO_XFER
+  TUD_EPBUF_DEF(epout_buf, CFG_TUD_CDC_EP_BUFSIZE);
+  #endif
+  #if !CFG_TUD_CDC_TX_FIFO_XFER
+  TUD_EPBUF_DEF(epin_buf, CFG_TUD_CDC_EP_BUFSIZE);
+  #endif
 
 }cdcd_interface_t;
 
-#define ITF_MEM_RESET_SIZE   offsetof(cdcd_interface_t, wanted_char)
+#define ITF_MEM_RESET_SIZE   offsetof(cdcd_interface_t, wanted_count)
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 CFG_TUD_MEM_SECTION tu_static cdcd_interface_t _cdcd_itf[CFG_TUD_CDC];
 
+// Number of bytes to receive: as many whole packets as the ring buffer can store, up to CFG_TUD_CDC_EP_BUFSIZE.
+// Host can always send a full packet, so arming less than that could overflow the fifo.
+static uint16_t _out_xfer_len (cdcd_interface_t* p_cdc)
+{
+  uint32_t const len = TU_MIN(tu_fifo_remaining(&p_cdc->rx_ff), CFG_TUD_CDC_EP_BUFSIZE);
+  return (uint16_t) (len - (len % p_cdc->ep_out_size));
+}
+
 static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
 {
-  uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_cdc->rx_ff);
+  uint8_t const rhport = p_cdc->rhport;
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
-  // TODO Actually we can still carry out the transfer, keeping count of received bytes
-  // and slowly move it to the FIFO when read().
   // This pre-check reduces endpoint claiming
-  TU_VERIFY(available >= sizeof(p_cdc->epout_buf));
+  TU_VERIFY(p_cdc->ep_out && _out_xfer_len(p_cdc));
 
   // claim endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_cdc->ep_out));
 
   // fifo can be changed before endpoint is claimed
-  available = tu_fifo_remaining(&p_cdc->rx_ff);
+  uint16_t const xfer_len = _out_xfer_len(p_cdc);
 
-  if ( available >= sizeof(p_cdc->epout_buf) )
+  if ( xfer_len )
   {
-    return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, sizeof(p_cdc->epout_buf));
+    #if CFG_TUD_CDC_RX_FIFO_XFER
+    return usbd_edpt_xfer_fifo(rhport, p_cdc->ep_out, &p_cdc->rx_ff, xfer_len);
+    #else
+    return usbd_edpt_xfer(rhport, p_cdc->ep_out, p_cdc->epout_buf, xfer_len);
+    #endif
   }else
   {
     // Release endpoint since we don't make any transfer
@@ -111,6 +139,68 @@ static bool _prep_out_transaction (cdcd_interface_t* p_cdc)
   }
 }
 
+// Word at a time scan for wanted chars: a word has a matched byte if (word ^ pattern) has a zero byte.
+// Only words with a match are checked byte by byte to invoke callback in order of reception.
+typedef uintptr_t cdc_scan_word_t;
+
+#define SCAN_WORD_ONES     (((cdc_scan_word_t) -1) / 0xFFu)
+#define SCAN_WORD_HIGHS    (SCAN_WORD_ONES << 7)
+#define SCAN_HAS_ZERO(_w)  (((_w) - SCAN_WORD_ONES) & ~(_w) & SCAN_WORD_HIGHS)
+
+static void _scan_wanted_bytes(uint8_t itf, cdcd_interface_t* p_cdc, uint8_t const* buf, uint32_t len)
+{
+  for ( uint32_t i = 0; i < len; i++ )
+  {
+    for ( uint8_t k = 0; k < p_cdc->wanted_count; k++ )
+    {
+      char const wanted = p_cdc->wanted_chars[k];
+      if ( (wanted == (char) buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff) )
+      {
+        tud_cdc_rx_wanted_cb(itf, wanted);
+        break;
+      }
+    }
+  }
+}
+
+static void _scan_wanted_chars(uint8_t itf, cdcd_interface_t* p_cdc, uint8_t const* buf, uint32_t len)
+{
+  uint8_t const count = p_cdc->wanted_count;
+  cdc_scan_word_t pattern[CFG_TUD_CDC_WANTED_CHAR_MAX];
+
+  for ( uint8_t k = 0; k < count; k++ )
+  {
+    pattern[k] = SCAN_WORD_ONES * (uint8_t) p_cdc->wanted_chars[k];
+  }
+
+  // leading bytes until word aligned
+  uint32_t head = (uint32_t) ((sizeof(cdc_scan_word_t) - ((uintptr_t) buf % sizeof(cdc_scan_word_t))) % sizeof(cdc_scan_word_t));
+  head = TU_MIN(head, len);
+  _scan_wanted_bytes(itf, p_cdc, buf, head);
+  buf += head;
+  len -= head;
+
+  while ( len >= sizeof(cdc_scan_word_t) )
+  {
+    cdc_scan_word_t const word = *((cdc_scan_word_t const*) (uintptr_t) buf);
+    cdc_scan_word_t found = 0;
+
+    for ( uint8_t k = 0; k < count; k++ )
+    {
+      cdc_scan_word_t const x = word ^ pattern[k];
+      found |= SCAN_HAS_ZERO(x);
+    }
+
+    if ( found ) _scan_wanted_bytes(itf, p_cdc, buf, sizeof(cdc_scan_word_t));
+
+    buf += sizeof(cdc_scan_word_t);
+    len -= (uint32_t) sizeof(cdc_scan_word_t);
+  }
+
+  // remaining bytes
+  _scan_wanted_bytes(itf, p_cdc, buf, len);
+}
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -132,7 +222,21 @@ void tud_cdc_n_get_line_coding (uint8_t itf, cdc_line_coding_t* coding)
 
 void tud_cdc_n_set_wanted_char (uint8_t itf, char wanted)
 {
-  _cdcd_itf[itf].wanted_char = wanted;
+  _cdcd_itf[itf].wanted_chars[0] = wanted;
+  _cdcd_itf[itf].wanted_count    = (((signed char) wanted) != -1) ? 1 : 0;
+}
+
+bool tud_cdc_n_set_wanted_chars (uint8_t itf, char const* wanted, uint8_t count)
+{
+  TU_VERIFY(count <= CFG_TUD_CDC_WANTED_CHAR_MAX);
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  // disable detection while updating
+  p_cdc->wanted_count = 0;
+  if (count) memcpy(p_cdc->wanted_chars, wanted, count);
+  p_cdc->wanted_count = count;
+
+  return true;
 }
 
 
@@ -147,7 +251,7 @@ uint32_t tud_cdc_n_available(uint8_t itf)
 uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint32_t num_read = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (uint16_t) TU_MIN(bufsize, UINT16_MAX));
+  uint32_t num_read = tu_fifo_read_n(&p_cdc->rx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
   _prep_out_transaction(p_cdc);
   return num_read;
 }
@@ -167,19 +271,93 @@ void tud_cdc_n_read_flush (uint8_t itf)
 //--------------------------------------------------------------------+
 // WRITE API
 //--------------------------------------------------------------------+
-uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+
+// flush if queue more than packet size
+static void _write_flush_if_needed(uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (uint16_t) TU_MIN(bufsize, UINT16_MAX));
 
-  // flush if queue more than packet size
   if ( tu_fifo_count(&p_cdc->tx_ff) >= BULK_PACKET_SIZE
-       #if CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE
+       #if CFG_TUD_CDC_APP_FIFO_BUF || CFG_TUD_CDC_TX_BUFSIZE < BULK_PACKET_SIZE
        || tu_fifo_full(&p_cdc->tx_ff) // check full if fifo size is less than packet size
        #endif
       ) {
     tud_cdc_n_write_flush(itf);
   }
+  #if CFG_TUD_CDC_TX_FLUSH_SOF
+  else if ( p_cdc->tx_flush_sof == 0 && tu_fifo_count(&p_cdc->tx_ff) )
+  {
+    // arm deadline for data that is not sent yet
+    p_cdc->tx_flush_sof = CFG_TUD_CDC_TX_FLUSH_SOF;
+  }
+  #endif
+}
+
+uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+#if CFG_TUSB_FIFO_MPSC
+  tu_fifo_size_t ret = tu_fifo_write_n_mpsc(&p_cdc->tx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+#else
+  tu_fifo_size_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+#endif
+
+  _write_flush_if_needed(itf);
+
+  return ret;
+}
+
+static void _tx_flush_deferred(void* param)
+{
+  uint8_t const itf = (uint8_t) (uintptr_t) param;
+  _cdcd_itf[itf].tx_flush_deferred = false;
+  tud_cdc_n_write_flush(itf);
+}
+
+// Queue a flush to usbd task, at most one is pending per interface
+static void _tx_flush_defer(uint8_t itf, bool in_isr)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  if ( !p_cdc->tx_flush_deferred )
+  {
+    p_cdc->tx_flush_deferred = true;
+    usbd_defer_func(_tx_flush_deferred, (void*) (uintptr_t) itf, in_isr);
+  }
+}
+
+uint32_t tud_cdc_n_write_from_isr(uint8_t itf, void const* buffer, uint32_t bufsize)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+#if CFG_TUSB_FIFO_MPSC
+  tu_fifo_size_t ret = tu_fifo_write_n_mpsc(&p_cdc->tx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+#else
+  tu_fifo_size_t ret = tu_fifo_write_n_unlocked(&p_cdc->tx_ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+#endif
+
+  if ( ret ) tud_cdc_n_write_flush_from_isr(itf);
+  return ret;
+}
+
+bool tud_cdc_n_write_flush_from_isr(uint8_t itf)
+{
+  TU_VERIFY(tud_ready());
+  _tx_flush_defer(itf, true);
+  return true;
+}
+
+uint32_t tud_cdc_n_write_reserve(uint8_t itf, tu_fifo_buffer_info_t* info)
+{
+  tu_fifo_get_write_info(&_cdcd_itf[itf].tx_ff, info);
+  return info->len_lin + info->len_wrap;
+}
+
+uint32_t tud_cdc_n_write_commit(uint8_t itf, uint32_t count)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  tu_fifo_size_t const ret = (tu_fifo_size_t) TU_MIN(count, tu_fifo_remaining(&p_cdc->tx_ff));
+
+  tu_fifo_advance_write_pointer(&p_cdc->tx_ff, ret);
+  _write_flush_if_needed(itf);
 
   return ret;
 }
@@ -194,17 +372,30 @@ uint32_t tud_cdc_n_write_flush (uint8_t itf)
   // No data to send
   if ( !tu_fifo_count(&p_cdc->tx_ff) ) return 0;
 
-  uint8_t const rhport = 0;
+  uint8_t const rhport = p_cdc->rhport;
 
   // Claim the endpoint
   TU_VERIFY( usbd_edpt_claim(rhport, p_cdc->ep_in), 0 );
 
+  #if CFG_TUD_CDC_TX_FIFO_XFER
+  // Controller pulls data directly from FIFO
+  uint16_t const count = (uint16_t) TU_MIN(tu_fifo_count(&p_cdc->tx_ff), CFG_TUD_CDC_EP_BUFSIZE);
+  #else
   // Pull data from FIFO
   uint16_t const count = tu_fifo_read_n(&p_cdc->tx_ff, p_cdc->epin_buf, sizeof(p_cdc->epin_buf));
+  #endif
 
   if ( count )
   {
+    #if CFG_TUD_CDC_TX_FLUSH_SOF
+    p_cdc->tx_flush_sof = 0;
+    #endif
+
+    #if CFG_TUD_CDC_TX_FIFO_XFER
+    TU_ASSERT( usbd_edpt_xfer_fifo(rhport, p_cdc->ep_in, &p_cdc->tx_ff, count), 0 );
+    #else
     TU_ASSERT( usbd_edpt_xfer(rhport, p_cdc->ep_in, p_cdc->epin_buf, count), 0 );
+    #endif
     return count;
   }else
   {
@@ -225,6 +416,28 @@ bool tud_cdc_n_write_clear (uint8_t itf)
   return tu_fifo_clear(&_cdcd_itf[itf].tx_ff);
 }
 
+#if CFG_TUSB_FIFO_DROP_OLDEST
+uint32_t tud_cdc_n_write_dropped (uint8_t itf)
+{
+  return tu_fifo_dropped(&_cdcd_itf[itf].tx_ff);
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Bridge API
+//--------------------------------------------------------------------+
+tu_fifo_t* cdcd_get_fifo(uint8_t itf, bool is_tx)
+{
+  TU_VERIFY(itf < CFG_TUD_CDC, NULL);
+  return is_tx ? &_cdcd_itf[itf].tx_ff : &_cdcd_itf[itf].rx_ff;
+}
+
+bool cdcd_rx_xfer(uint8_t itf)
+{
+  TU_VERIFY(itf < CFG_TUD_CDC);
+  return _prep_out_transaction(&_cdcd_itf[itf]);
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -236,7 +449,7 @@ void cdcd_init(void)
   {
     cdcd_interface_t* p_cdc = &_cdcd_itf[i];
 
-    p_cdc->wanted_char = (char) -1;
+    p_cdc->wanted_count = 0;
 
     // default line coding is : stop bit = 1, parity = none, data bits = 8
     p_cdc->line_coding.bit_rate  = 115200;
@@ -244,22 +457,38 @@ void cdcd_init(void)
     p_cdc->line_coding.parity    = 0;
     p_cdc->line_coding.data_bits = 8;
 
+    #if CFG_TUD_CDC_APP_FIFO_BUF
+    tu_fifo_size_t rx_size = 0, tx_size = 0;
+    uint8_t* rx_buf = tud_cdc_fifo_buffer_cb(i, false, &rx_size);
+    uint8_t* tx_buf = tud_cdc_fifo_buffer_cb(i, true, &tx_size);
+    TU_ASSERT(rx_buf && rx_size && tx_buf && tx_size, );
+    #else
+    uint8_t* rx_buf = p_cdc->rx_ff_buf;
+    uint8_t* tx_buf = p_cdc->tx_ff_buf;
+    tu_fifo_size_t const rx_size = TU_ARRAY_SIZE(p_cdc->rx_ff_buf);
+    tu_fifo_size_t const tx_size = TU_ARRAY_SIZE(p_cdc->tx_ff_buf);
+    #endif
+
     // Config RX fifo
-    tu_fifo_config(&p_cdc->rx_ff, p_cdc->rx_ff_buf, TU_ARRAY_SIZE(p_cdc->rx_ff_buf), 1, false);
+    TU_ASSERT(tu_fifo_config(&p_cdc->rx_ff, rx_buf, rx_size, 1, false), );
 
     // Config TX fifo as overwritable at initialization and will be changed to non-overwritable
     // if terminal supports DTR bit. Without DTR we do not know if data is actually polled by terminal.
     // In this way, the most current data is prioritized.
-    tu_fifo_config(&p_cdc->tx_ff, p_cdc->tx_ff_buf, TU_ARRAY_SIZE(p_cdc->tx_ff_buf), 1, true);
+    TU_ASSERT(tu_fifo_config(&p_cdc->tx_ff, tx_buf, tx_size, 1, true), );
 
     #if OSAL_MUTEX_REQUIRED
     osal_mutex_t mutex_rd = osal_mutex_create(&p_cdc->rx_ff_mutex);
-    osal_mutex_t mutex_wr = osal_mutex_create(&p_cdc->tx_ff_mutex);
-    TU_ASSERT(mutex_rd != NULL && mutex_wr != NULL, );
-
+    TU_ASSERT(mutex_rd != NULL, );
     tu_fifo_config_mutex(&p_cdc->rx_ff, NULL, mutex_rd);
+
+    // TX fifo written without mutex by tu_fifo_write_n_mpsc()
+    #if !CFG_TUSB_FIFO_MPSC
+    osal_mutex_t mutex_wr = osal_mutex_create(&p_cdc->tx_ff_mutex);
+    TU_ASSERT(mutex_wr != NULL, );
     tu_fifo_config_mutex(&p_cdc->tx_ff, mutex_wr, NULL);
     #endif
+    #endif
   }
 }
 
@@ -319,6 +548,7 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(p_cdc, 0);
 
   //------------- Control Interface -------------//
+  p_cdc->rhport  = rhport;
   p_cdc->itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -354,12 +584,25 @@ uint16_t cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
     // Open endpoint pair
     TU_ASSERT( usbd_open_edpt_pair(rhport, p_desc, 2, TUSB_XFER_BULK, &p_cdc->ep_out, &p_cdc->ep_in), 0 );
 
+    uint8_t const * p_ep = p_desc;
+    for ( uint8_t i = 0; i < 2; i++ )
+    {
+      tusb_desc_endpoint_t const * desc_ep = (tusb_desc_endpoint_t const *) p_ep;
+      if ( desc_ep->bEndpointAddress == p_cdc->ep_out ) p_cdc->ep_out_size = tu_edpt_packet_size(desc_ep);
+      p_ep = tu_desc_next(p_ep);
+    }
+
     drv_len += 2*sizeof(tusb_desc_endpoint_t);
   }
 
   // Prepare for incoming data
   _prep_out_transaction(p_cdc);
 
+  #if CFG_TUD_CDC_TX_FLUSH_SOF
+  // SOF drives TX auto flush
+  usbd_sof_subscribe(rhport, cdcd_sof, 1);
+  #endif
+
   return drv_len;
 }
 
@@ -392,6 +635,10 @@ bool cdcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       }
       else if ( stage == CONTROL_STAGE_ACK)
       {
+        #if CFG_TUSB_BRIDGE_CDC
+        bridge_cdcd_line_coding_cb(itf);
+        #endif
+
         if ( tud_cdc_line_coding_cb ) tud_cdc_line_coding_cb(itf, &p_cdc->line_coding);
       }
     break;
@@ -426,6 +673,10 @@ bool cdcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
         TU_LOG_DRV("  Set Control Line State: DTR = %d, RTS = %d\r\n", dtr, rts);
 
+        #if CFG_TUSB_BRIDGE_CDC
+        bridge_cdcd_line_state_cb(itf);
+        #endif
+
         // Invoke callback
         if ( tud_cdc_line_state_cb ) tud_cdc_line_state_cb(itf, dtr, rts);
       }
@@ -466,22 +717,51 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   // Received new data
   if ( ep_addr == p_cdc->ep_out )
   {
+    #if CFG_TUD_CDC_RX_FIFO_XFER
+    // Data is already in rx fifo, new bytes are the last ones unless application has consumed them
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_read_info(&p_cdc->rx_ff, &info);
+
+    uint32_t const new_count = TU_MIN(xferred_bytes, (uint32_t) info.len_lin + info.len_wrap);
+    uint8_t const* chunk[2];
+    uint32_t chunk_len[2];
+
+    if ( new_count <= info.len_wrap )
+    {
+      chunk[0]     = (uint8_t const*) info.ptr_wrap + (info.len_wrap - new_count);
+      chunk_len[0] = new_count;
+      chunk_len[1] = 0;
+    }else
+    {
+      chunk_len[0] = new_count - info.len_wrap;
+      chunk[0]     = (uint8_t const*) info.ptr_lin + (info.len_lin - chunk_len[0]);
+      chunk[1]     = (uint8_t const*) info.ptr_wrap;
+      chunk_len[1] = info.len_wrap;
+    }
+    #else
     tu_fifo_write_n(&p_cdc->rx_ff, p_cdc->epout_buf, (uint16_t) xferred_bytes);
 
+    uint8_t const* chunk[2]  = { p_cdc->epout_buf, NULL };
+    uint32_t chunk_len[2]    = { xferred_bytes, 0 };
+    #endif
+
+    bool forwarded = false;
+    #if CFG_TUSB_BRIDGE_CDC
+    // data is forwarded by bridge, application does not read it
+    forwarded = bridge_cdcd_rx_cb(itf);
+    #endif
+
     // Check for wanted char and invoke callback if needed
-    if ( tud_cdc_rx_wanted_cb && (((signed char) p_cdc->wanted_char) != -1) )
+    if ( !forwarded && tud_cdc_rx_wanted_cb && p_cdc->wanted_count )
     {
-      for ( uint32_t i = 0; i < xferred_bytes; i++ )
+      for ( uint8_t c = 0; c < 2; c++ )
       {
-        if ( (p_cdc->wanted_char == p_cdc->epout_buf[i]) && !tu_fifo_empty(&p_cdc->rx_ff) )
-        {
-          tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
-        }
+        _scan_wanted_chars(itf, p_cdc, chunk[c], chunk_len[c]);
       }
     }
 
     // invoke receive callback (if there is still data)
-    if (tud_cdc_rx_cb && !tu_fifo_empty(&p_cdc->rx_ff) ) tud_cdc_rx_cb(itf);
+    if ( !forwarded && tud_cdc_rx_cb && !tu_fifo_empty(&p_cdc->rx_ff) ) tud_cdc_rx_cb(itf);
 
     // prepare for OUT transaction
     _prep_out_transaction(p_cdc);
@@ -507,6 +787,11 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
         }
       }
     }
+
+    #if CFG_TUSB_BRIDGE_CDC
+    // tx fifo has room again for data forwarded by bridge
+    bridge_cdcd_tx_complete_cb(itf);
+    #endif
   }
 
   // nothing to do with notif endpoint for now
@@ -514,4 +799,27 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 }
 
+#if CFG_TUD_CDC_TX_FLUSH_SOF
+// Invoked in ISR context
+void cdcd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  for(uint8_t itf=0; itf<CFG_TUD_CDC; itf++)
+  {
+    cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+    uint16_t const remain = p_cdc->tx_flush_sof;
+
+    if ( remain )
+    {
+      p_cdc->tx_flush_sof = (uint16_t) (remain - 1);
+
+      // deadline reached, flush in usbd task since it can not be done in ISR
+      if ( remain == 1 ) _tx_flush_defer(itf, true);
+    }
+  }
+}
+#endif
+
 #endif
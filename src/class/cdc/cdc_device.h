@@ -41,6 +41,43 @@
   #define CFG_TUD_CDC_EP_BUFSIZE    (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Auto flush TX data that does not make up a full packet after this number of SOF (microframe in highspeed)
+// since it is written. This gives full packets under load and bounded latency for interactive traffic.
+// 0 is disabled i.e tud_cdc_n_write_flush() must be called.
+#ifndef CFG_TUD_CDC_TX_FLUSH_SOF
+  #define CFG_TUD_CDC_TX_FLUSH_SOF  0
+#endif
+
+// Receive OUT data directly into rx fifo with usbd_edpt_xfer_fifo() instead of staging it in an endpoint buffer.
+// Only enabled by default for controller drivers that implement dcd_edpt_xfer_fifo() without DMA
+#ifndef CFG_TUD_CDC_RX_FIFO_XFER
+  #if (defined(TUP_USBIP_DWC2) && !TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3) && !CFG_TUD_DWC2_DMA) || \
+      defined(TUP_USBIP_FSDEV) || \
+      TU_CHECK_MCU(OPT_MCU_RX63X, OPT_MCU_RX65X, OPT_MCU_RX72N)
+    #define CFG_TUD_CDC_RX_FIFO_XFER  1
+  #else
+    #define CFG_TUD_CDC_RX_FIFO_XFER  0
+  #endif
+#endif
+
+// Send IN data directly from tx fifo with usbd_edpt_xfer_fifo() instead of copying it to an endpoint buffer first.
+// Controller driver must implement dcd_edpt_xfer_fifo(). Note: while DTR is not set tx fifo is overwritable, data
+// written then can overwrite bytes being sent.
+#ifndef CFG_TUD_CDC_TX_FIFO_XFER
+  #define CFG_TUD_CDC_TX_FIFO_XFER  0
+#endif
+
+// Maximum number of wanted characters that can be set with tud_cdc_n_set_wanted_chars() e.g 2 for '\r' and '\n'
+// RX/TX FIFO buffers are provided by application with tud_cdc_fifo_buffer_cb() instead of being embedded in every
+// interface with CFG_TUD_CDC_RX_BUFSIZE/CFG_TUD_CDC_TX_BUFSIZE, allowing different size per interface
+#ifndef CFG_TUD_CDC_APP_FIFO_BUF
+  #define CFG_TUD_CDC_APP_FIFO_BUF  0
+#endif
+
+#ifndef CFG_TUD_CDC_WANTED_CHAR_MAX
+  #define CFG_TUD_CDC_WANTED_CHAR_MAX  1
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -64,9 +101,12 @@ uint8_t  tud_cdc_n_get_line_state  (uint8_t itf);
 // Get current line encoding: bit rate, stop bits parity etc ..
 void     tud_cdc_n_get_line_coding (uint8_t itf, cdc_line_coding_t* coding);
 
-// Set special character that will trigger tud_cdc_rx_wanted_cb() callback on receiving
+// Set special character that will trigger tud_cdc_rx_wanted_cb() callback on receiving, -1 to disable
 void     tud_cdc_n_set_wanted_char (uint8_t itf, char wanted);
 
+// Set up to CFG_TUD_CDC_WANTED_CHAR_MAX characters that will trigger tud_cdc_rx_wanted_cb() on receiving, count = 0 to disable
+bool     tud_cdc_n_set_wanted_chars(uint8_t itf, char const* wanted, uint8_t count);
+
 // Get the number of bytes available for reading
 uint32_t tud_cdc_n_available       (uint8_t itf);
 
@@ -103,6 +143,25 @@ uint32_t tud_cdc_n_write_available (uint8_t itf);
 // Clear the transmit FIFO
 bool tud_cdc_n_write_clear (uint8_t itf);
 
+#if CFG_TUSB_FIFO_DROP_OLDEST
+// Number of bytes dropped from TX FIFO while it is overwritable (DTR not set) since it was last cleared
+uint32_t tud_cdc_n_write_dropped (uint8_t itf);
+#endif
+
+// Get linear and wrapped free space of TX FIFO to be filled in place e.g by a DMA, return total bytes available.
+// No other write must happen until data is committed with tud_cdc_n_write_commit()
+uint32_t tud_cdc_n_write_reserve   (uint8_t itf, tu_fifo_buffer_info_t* info);
+
+// Commit number of bytes filled in place after tud_cdc_n_write_reserve(), data is sent as with tud_cdc_n_write()
+uint32_t tud_cdc_n_write_commit    (uint8_t itf, uint32_t count);
+
+// Write bytes to TX FIFO from ISR e.g UART RX or DMA complete, then queue a flush to usbd task.
+// ISR must be the only writer of the interface unless CFG_TUSB_FIFO_MPSC is enabled.
+uint32_t tud_cdc_n_write_from_isr  (uint8_t itf, void const* buffer, uint32_t bufsize);
+
+// Queue a flush to usbd task from ISR, return false if usb is not ready
+bool     tud_cdc_n_write_flush_from_isr(uint8_t itf);
+
 //--------------------------------------------------------------------+
 // Application API (Single Port)
 //--------------------------------------------------------------------+
@@ -110,6 +169,7 @@ static inline bool     tud_cdc_connected       (void);
 static inline uint8_t  tud_cdc_get_line_state  (void);
 static inline void     tud_cdc_get_line_coding (cdc_line_coding_t* coding);
 static inline void     tud_cdc_set_wanted_char (char wanted);
+static inline bool     tud_cdc_set_wanted_chars(char const* wanted, uint8_t count);
 
 static inline uint32_t tud_cdc_available       (void);
 static inline int32_t  tud_cdc_read_char       (void);
@@ -123,15 +183,28 @@ static inline uint32_t tud_cdc_write_str       (char const* str);
 static inline uint32_t tud_cdc_write_flush     (void);
 static inline uint32_t tud_cdc_write_available (void);
 static inline bool     tud_cdc_write_clear     (void);
+#if CFG_TUSB_FIFO_DROP_OLDEST
+static inline uint32_t tud_cdc_write_dropped   (void);
+#endif
+static inline uint32_t tud_cdc_write_reserve   (tu_fifo_buffer_info_t* info);
+static inline uint32_t tud_cdc_write_commit    (uint32_t count);
+static inline uint32_t tud_cdc_write_from_isr  (void const* buffer, uint32_t bufsize);
+static inline bool     tud_cdc_write_flush_from_isr(void);
 
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
 
+#if CFG_TUD_CDC_APP_FIFO_BUF
+// Invoked by tud_init() to get RX (is_tx = false) or TX FIFO buffer of an interface, its size in bytes is returned in
+// bufsize. Buffer must stay valid as long as the stack is initialized. Required if CFG_TUD_CDC_APP_FIFO_BUF is enabled
+uint8_t* tud_cdc_fifo_buffer_cb(uint8_t itf, bool is_tx, tu_fifo_size_t* bufsize);
+#endif
+
 // Invoked when received new data
 TU_ATTR_WEAK void tud_cdc_rx_cb(uint8_t itf);
 
-// Invoked when received `wanted_char`
+// Invoked when received `wanted_char` (one of the wanted characters), once per occurrence
 TU_ATTR_WEAK void tud_cdc_rx_wanted_cb(uint8_t itf, char wanted_char);
 
 // Invoked when a TX is complete and therefore space becomes available in TX buffer
@@ -185,6 +258,11 @@ static inline void tud_cdc_set_wanted_char (char wanted)
   tud_cdc_n_set_wanted_char(0, wanted);
 }
 
+static inline bool tud_cdc_set_wanted_chars (char const* wanted, uint8_t count)
+{
+  return tud_cdc_n_set_wanted_chars(0, wanted, count);
+}
+
 static inline uint32_t tud_cdc_available (void)
 {
   return tud_cdc_n_available(0);
@@ -240,6 +318,33 @@ static inline bool tud_cdc_write_clear(void)
   return tud_cdc_n_write_clear(0);
 }
 
+#if CFG_TUSB_FIFO_DROP_OLDEST
+static inline uint32_t tud_cdc_write_dropped(void)
+{
+  return tud_cdc_n_write_dropped(0);
+}
+#endif
+
+static inline uint32_t tud_cdc_write_reserve(tu_fifo_buffer_info_t* info)
+{
+  return tud_cdc_n_write_reserve(0, info);
+}
+
+static inline uint32_t tud_cdc_write_commit(uint32_t count)
+{
+  return tud_cdc_n_write_commit(0, count);
+}
+
+static inline uint32_t tud_cdc_write_from_isr(void const* buffer, uint32_t bufsize)
+{
+  return tud_cdc_n_write_from_isr(0, buffer, bufsize);
+}
+
+static inline bool tud_cdc_write_flush_from_isr(void)
+{
+  return tud_cdc_n_write_flush_from_isr(0);
+}
+
 /** @} */
 /** @} */
 
@@ -252,6 +357,13 @@ void     cdcd_reset           (uint8_t rhport);
 uint16_t cdcd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     cdcd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     cdcd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     cdcd_sof             (uint8_t rhport, uint32_t frame_count);
+
+// Fifo of an interface, e.g to share it with a host stream
+tu_fifo_t* cdcd_get_fifo      (uint8_t itf, bool is_tx);
+
+// Receive more OUT data if rx fifo has room
+bool     cdcd_rx_xfer         (uint8_t itf);
 
 #ifdef __cplusplus
  }
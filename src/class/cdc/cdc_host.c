@@ -36,6 +36,10 @@
 
 #include "cdc_host.h"
 
+#if CFG_TUSB_BRIDGE_CDC
+#include "bridge/bridge_cdc.h"
+#endif
+
 // Level where CFG_TUSB_DEBUG must be at least for this driver is logged
 #ifndef CFG_TUH_CDC_LOG_LEVEL
   #define CFG_TUH_CDC_LOG_LEVEL   CFG_TUH_LOG_LEVEL
@@ -66,17 +70,36 @@ typedef struct {
   // 1 byte padding
   #endif
 
+  #if CFG_TUH_CDC_FTDI
+  uint8_t ftdi_status[2]; // modem status and line status from the last received packet
+  #endif
+
   tuh_xfer_cb_t user_control_cb;
 
+  // data stage of runtime control requests (line coding is the largest). The enumeration buffer may be in use by
+  // another device being enumerated, and application variable does not live long enough
+  TUH_EPBUF_DEF(ctrl_buf, sizeof(cdc_line_coding_t));
+
+  // read into application buffer bypassing rx fifo, see tuh_cdc_read_direct()
+  struct {
+    tuh_cdc_read_direct_cb_t cb; // pending if not NULL
+    uint8_t* buffer;
+    uint32_t bufsize;
+    bool active;                 // submitted to endpoint
+  } rx_direct;
+
   struct {
     tu_edpt_stream_t tx;
     tu_edpt_stream_t rx;
 
     uint8_t tx_ff_buf[CFG_TUH_CDC_TX_BUFSIZE];
-    CFG_TUH_MEM_ALIGN uint8_t tx_ep_buf[CFG_TUH_CDC_TX_EPSIZE];
+    TUH_EPBUF_DEF(tx_ep_buf, CFG_TUH_CDC_TX_EPSIZE);
 
-    uint8_t rx_ff_buf[CFG_TUH_CDC_TX_BUFSIZE];
-    CFG_TUH_MEM_ALIGN uint8_t rx_ep_buf[CFG_TUH_CDC_TX_EPSIZE];
+    uint8_t rx_ff_buf[CFG_TUH_CDC_RX_BUFSIZE];
+    TUH_EPBUF_DEF(rx_ep_buf, CFG_TUH_CDC_RX_EPSIZE);
+    #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+    TUH_EPBUF_DEF(rx_ep_buf_alt, CFG_TUH_CDC_RX_EPSIZE);
+    #endif
   } stream;
 } cdch_interface_t;
 
@@ -109,6 +132,7 @@ static bool ftdi_sio_set_baudrate(cdch_interface_t* p_cdc, uint32_t baudrate, tu
 static bool ftdi_set_data_format(cdch_interface_t* p_cdc, uint8_t stop_bits, uint8_t parity, uint8_t data_bits, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool ftdi_set_line_coding(cdch_interface_t* p_cdc, cdc_line_coding_t const* line_coding, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool ftdi_sio_set_modem_ctrl(cdch_interface_t* p_cdc, uint16_t line_state, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+static void ftdi_rx_xfer_complete(cdch_interface_t* p_cdc, uint32_t xferred_bytes);
 #endif
 
 //------------- CP210X prototypes -------------//
@@ -399,6 +423,79 @@ bool tuh_cdc_read_clear (uint8_t idx) {
   return ret;
 }
 
+static void rx_direct_complete(uint8_t idx, cdch_interface_t* p_cdc, uint32_t xferred_bytes) {
+  tuh_cdc_read_direct_cb_t const cb = p_cdc->rx_direct.cb;
+  uint8_t* const buffer = p_cdc->rx_direct.buffer;
+
+  // clear before invoking callback, which can start another read
+  p_cdc->rx_direct.cb = NULL;
+  p_cdc->rx_direct.active = false;
+  cb(idx, buffer, xferred_bytes);
+}
+
+// Serve pending direct read: data already in rx fifo is copied out, otherwise caller's buffer is submitted
+// to the IN endpoint if it is idle. If endpoint is busy with stream transfer, retried when that one completes.
+static void rx_direct_process(uint8_t idx, cdch_interface_t* p_cdc) {
+  tu_edpt_stream_t* s = &p_cdc->stream.rx;
+  if (p_cdc->rx_direct.cb == NULL || p_cdc->rx_direct.active) return;
+
+  if (tu_fifo_count(s->ff)) {
+    uint32_t const count = tu_fifo_read_n(s->ff, p_cdc->rx_direct.buffer,
+                                          (tu_fifo_size_t) TU_MIN(p_cdc->rx_direct.bufsize, TU_FIFO_SIZE_MAX));
+    rx_direct_complete(idx, p_cdc, count);
+    return;
+  }
+
+  TU_VERIFY(usbh_edpt_claim(p_cdc->daddr, s->ep_addr), );
+
+  // multiple of packet size so that device can not overrun caller's buffer
+  uint32_t const count = p_cdc->rx_direct.bufsize & ~((uint32_t) s->ep_packetsize - 1);
+  p_cdc->rx_direct.active = true;
+  if (!usbh_edpt_xfer(p_cdc->daddr, s->ep_addr, p_cdc->rx_direct.buffer, count)) {
+    p_cdc->rx_direct.active = false;
+    usbh_edpt_release(p_cdc->daddr, s->ep_addr);
+  }
+}
+
+bool tuh_cdc_read_direct(uint8_t idx, void* buffer, uint32_t bufsize, tuh_cdc_read_direct_cb_t cb) {
+  cdch_interface_t* p_cdc = get_itf(idx);
+  TU_VERIFY(p_cdc && p_cdc->mounted && buffer && cb);
+  TU_VERIFY(p_cdc->rx_direct.cb == NULL); // one read at a time
+  TU_VERIFY(bufsize >= p_cdc->stream.rx.ep_packetsize);
+
+  #if CFG_TUH_CDC_FTDI
+  // FTDI status bytes in every packet must be stripped by driver
+  TU_VERIFY(p_cdc->serial_drid != SERIAL_DRIVER_FTDI);
+  #endif
+
+  p_cdc->rx_direct.buffer = (uint8_t*) buffer;
+  p_cdc->rx_direct.bufsize = bufsize;
+  p_cdc->rx_direct.active = false;
+  p_cdc->rx_direct.cb = cb;
+
+  rx_direct_process(idx, p_cdc);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Bridge API
+//--------------------------------------------------------------------+
+bool cdch_share_fifo(uint8_t idx, tu_fifo_t* rx_ff, tu_fifo_t* tx_ff) {
+  cdch_interface_t* p_cdc = get_itf(idx);
+  TU_VERIFY(p_cdc);
+
+  tu_edpt_stream_share_fifo(&p_cdc->stream.rx, rx_ff);
+  tu_edpt_stream_share_fifo(&p_cdc->stream.tx, tx_ff);
+  return true;
+}
+
+uint32_t cdch_rx_xfer(uint8_t idx) {
+  cdch_interface_t* p_cdc = get_itf(idx);
+  TU_VERIFY(p_cdc, 0);
+
+  return tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+}
+
 //--------------------------------------------------------------------+
 // Control Endpoint API
 //--------------------------------------------------------------------+
@@ -633,6 +730,9 @@ bool cdch_init(void) {
     tu_edpt_stream_init(&p_cdc->stream.rx, true, false, false,
                         p_cdc->stream.rx_ff_buf, CFG_TUH_CDC_RX_BUFSIZE,
                         p_cdc->stream.rx_ep_buf, CFG_TUH_CDC_RX_EPSIZE);
+    #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+    tu_edpt_stream_set_double_buf(&p_cdc->stream.rx, p_cdc->stream.rx_ep_buf_alt);
+    #endif
   }
 
   return true;
@@ -656,9 +756,15 @@ void cdch_close(uint8_t daddr) {
       // Invoke application callback
       if (tuh_cdc_umount_cb) tuh_cdc_umount_cb(idx);
 
+      #if CFG_TUSB_BRIDGE_CDC
+      bridge_cdch_close_cb(idx);
+      #endif
+
       p_cdc->daddr = 0;
       p_cdc->bInterfaceNumber = 0;
       p_cdc->mounted = false;
+      p_cdc->rx_direct.cb = NULL;
+      p_cdc->rx_direct.active = false;
       tu_edpt_stream_close(&p_cdc->stream.tx);
       tu_edpt_stream_close(&p_cdc->stream.rx);
     }
@@ -682,23 +788,41 @@ bool cdch_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t
       // - xferred_bytes is multiple of EP Packet size and not zero
       tu_edpt_stream_write_zlp_if_needed(&p_cdc->stream.tx, xferred_bytes);
     }
+
+    #if CFG_TUSB_BRIDGE_CDC
+    // shared fifo has room again for data forwarded by bridge
+    bridge_cdch_tx_complete_cb(idx);
+    #endif
   } else if ( ep_addr == p_cdc->stream.rx.ep_addr ) {
+    if (p_cdc->rx_direct.active) {
+      // data is in caller's buffer, resume streaming into rx fifo unless callback starts another direct read
+      rx_direct_complete(idx, p_cdc, xferred_bytes);
+      if (p_cdc->rx_direct.cb == NULL) tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+      return true;
+    }
+
     #if CFG_TUH_CDC_FTDI
     if (p_cdc->serial_drid == SERIAL_DRIVER_FTDI) {
-      // FTDI reserve 2 bytes for status
-      // uint8_t status[2] = {p_cdc->stream.rx.ep_buf[0], p_cdc->stream.rx.ep_buf[1]};
-      tu_edpt_stream_read_xfer_complete_offset(&p_cdc->stream.rx, xferred_bytes, 2);
+      // FTDI reserve 2 bytes for status in every packet
+      ftdi_rx_xfer_complete(p_cdc, xferred_bytes);
     }else
     #endif
     {
       tu_edpt_stream_read_xfer_complete(&p_cdc->stream.rx, xferred_bytes);
     }
 
+    bool forwarded = false;
+    #if CFG_TUSB_BRIDGE_CDC
+    // data is forwarded by bridge, application does not read it
+    forwarded = bridge_cdch_rx_cb(idx);
+    #endif
+
     // invoke receive callback
-    if (tuh_cdc_rx_cb) tuh_cdc_rx_cb(idx);
+    if (!forwarded && tuh_cdc_rx_cb) tuh_cdc_rx_cb(idx);
 
-    // prepare for next transfer if needed
-    tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+    // pending direct read takes over the endpoint, otherwise prepare for next transfer if needed
+    rx_direct_process(idx, p_cdc);
+    if (p_cdc->rx_direct.cb == NULL) tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
   }else if ( ep_addr == p_cdc->ep_notif ) {
     // TODO handle notification endpoint
   }else {
@@ -734,9 +858,10 @@ bool cdch_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_d
   (void) rhport;
 
   // For CDC: only support ACM subclass
-  // Note: Protocol 0xFF can be RNDIS device
+  // Note: Protocol 0xFF can be RNDIS device, left to RNDIS driver if enabled
   if (TUSB_CLASS_CDC                           == itf_desc->bInterfaceClass &&
-      CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == itf_desc->bInterfaceSubClass) {
+      CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == itf_desc->bInterfaceSubClass &&
+      !(CFG_TUH_RNDIS && 0xFF == itf_desc->bInterfaceProtocol)) {
     return acm_open(daddr, itf_desc, max_len);
   }
   else if (SERIAL_DRIVER_COUNT > 1 &&
@@ -759,6 +884,10 @@ bool cdch_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *itf_d
 
 static void set_config_complete(cdch_interface_t * p_cdc, uint8_t idx, uint8_t itf_num) {
   TU_LOG_DRV("CDCh Set Configure complete\r\n");
+
+  // last control request is done: next interface can be configured while application handles the mount
+  usbh_driver_set_config_release(p_cdc->daddr, itf_num);
+
   p_cdc->mounted = true;
   if (tuh_cdc_mount_cb) tuh_cdc_mount_cb(idx);
 
@@ -769,6 +898,10 @@ static void set_config_complete(cdch_interface_t * p_cdc, uint8_t idx, uint8_t i
   usbh_driver_set_config_complete(p_cdc->daddr, itf_num);
 }
 
+// Serial configuration on mount is a per-driver state machine (process_set_config) chained by control transfer
+// complete callbacks, which run in usbh task so requests are issued back-to-back without involving application.
+// Interfaces of the same device share its control pipe: the next one is configured only after this one calls
+// usbh_driver_set_config_release() (or usbh_driver_set_config_complete()) when done with control transfers.
 bool cdch_set_config(uint8_t daddr, uint8_t itf_num) {
   tusb_control_request_t request;
   request.wIndex = tu_htole16((uint16_t) itf_num);
@@ -925,16 +1058,14 @@ static bool acm_set_line_coding(cdch_interface_t* p_cdc, cdc_line_coding_t const
     .wLength  = tu_htole16(sizeof(cdc_line_coding_t))
   };
 
-  // use usbh enum buf to hold line coding since user line_coding variable does not live long enough
-  uint8_t* enum_buf = usbh_get_enum_buf();
-  memcpy(enum_buf, line_coding, sizeof(cdc_line_coding_t));
+  memcpy(p_cdc->ctrl_buf, line_coding, sizeof(cdc_line_coding_t));
 
   p_cdc->user_control_cb = complete_cb;
   tuh_xfer_t xfer = {
     .daddr       = p_cdc->daddr,
     .ep_addr     = 0,
     .setup       = &request,
-    .buffer      = enum_buf,
+    .buffer      = p_cdc->ctrl_buf,
     .complete_cb = complete_cb ? cdch_internal_control_complete : NULL, // complete_cb is NULL for sync call
     .user_data   = user_data
   };
@@ -976,6 +1107,72 @@ enum {
   CONFIG_FTDI_COMPLETE
 };
 
+// Each max packet size chunk of an IN transfer starts with 2 status bytes. Strip them and copy the payload
+// of all packets into rx fifo in one pass, then update write index once.
+static void ftdi_rx_xfer_complete(cdch_interface_t* p_cdc, uint32_t xferred_bytes) {
+  tu_edpt_stream_t* s = &p_cdc->stream.rx;
+  uint16_t const mps = s->ep_packetsize;
+  if (xferred_bytes == 0) return;
+
+  uint8_t const* ep_buf = s->ep_buf;
+
+  #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  // re-arm endpoint with the other buffer before draining this one
+  if (s->ep_buf_alt) {
+    uint32_t const pkt_count = tu_div_ceil(xferred_bytes, mps);
+    uint32_t const last_len = xferred_bytes - (pkt_count - 1) * mps;
+    uint32_t const payload = (pkt_count - 1) * (uint32_t) (mps - 2) + (last_len > 2 ? last_len - 2 : 0);
+    ep_buf = tu_edpt_stream_read_rearm(s, payload);
+  }
+  #endif
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_write_info(s->ff, &info);
+
+  uint8_t* dst[2] = { (uint8_t*) info.ptr_lin, (uint8_t*) info.ptr_wrap };
+  uint32_t room[2] = { info.len_lin, info.len_wrap };
+  uint8_t seg = 0;
+  uint32_t written = 0;
+  uint8_t err_status = 0;
+
+  for (uint32_t offset = 0; offset < xferred_bytes; offset += mps) {
+    uint32_t const pkt_len = TU_MIN(mps, xferred_bytes - offset);
+    if (pkt_len < 2) break;
+
+    uint8_t const* src = ep_buf + offset;
+    p_cdc->ftdi_status[0] = src[0];
+    p_cdc->ftdi_status[1] = src[1];
+    err_status |= src[1];
+
+    src += 2;
+    uint32_t len = pkt_len - 2;
+
+    // copy into linear then wrapped part of fifo, drop what does not fit
+    while (len && seg < 2) {
+      if (room[seg] == 0) {
+        seg++;
+        continue;
+      }
+
+      uint32_t const n = TU_MIN(len, room[seg]);
+      memcpy(dst[seg], src, n);
+      dst[seg] += n;
+      room[seg] -= n;
+      src += n;
+      len -= n;
+      written += n;
+    }
+  }
+
+  tu_fifo_advance_write_pointer(s->ff, (tu_fifo_size_t) written);
+
+  // overrun, parity, framing error and break are latched per packet, report once per transfer
+  err_status &= (FTDI_RS_OE | FTDI_RS_PE | FTDI_RS_FE | FTDI_RS_BI);
+  if (err_status) {
+    TU_LOG_DRV("FTDI line status error %02X\r\n", err_status);
+  }
+}
+
 static bool ftdi_open(uint8_t daddr, const tusb_desc_interface_t *itf_desc, uint16_t max_len) {
   // FTDI Interface includes 1 vendor interface + 2 bulk endpoints
   TU_VERIFY(itf_desc->bInterfaceSubClass == 0xff && itf_desc->bInterfaceProtocol == 0xff && itf_desc->bNumEndpoints == 2);
@@ -1188,19 +1385,17 @@ static bool cp210x_set_request(cdch_interface_t* p_cdc, uint8_t command, uint16_
     .wLength  = tu_htole16(length)
   };
 
-  // use usbh enum buf since application variable does not live long enough
-  uint8_t* enum_buf = NULL;
-
+  uint8_t* data = NULL;
   if (buffer && length > 0) {
-    enum_buf = usbh_get_enum_buf();
-    tu_memcpy_s(enum_buf, CFG_TUH_ENUMERATION_BUFSIZE, buffer, length);
+    data = p_cdc->ctrl_buf;
+    TU_VERIFY(0 == tu_memcpy_s(data, sizeof(p_cdc->ctrl_buf), buffer, length));
   }
 
   tuh_xfer_t xfer = {
     .daddr       = p_cdc->daddr,
     .ep_addr     = 0,
     .setup       = &request,
-    .buffer      = enum_buf,
+    .buffer      = data,
     .complete_cb = complete_cb,
     .user_data   = user_data
   };
@@ -1309,7 +1504,7 @@ static uint16_t ch34x_get_divisor_prescaler(uint32_t baval);
 //------------- control request -------------//
 
 static bool ch34x_set_request(cdch_interface_t* p_cdc, uint8_t direction, uint8_t request, uint16_t value,
-                              uint16_t index, uint8_t* buffer, uint16_t length, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+                              uint16_t index, uint8_t const* buffer, uint16_t length, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
   tusb_control_request_t const request_setup = {
       .bmRequestType_bit = {
           .recipient = TUSB_REQ_RCPT_DEVICE,
@@ -1322,13 +1517,14 @@ static bool ch34x_set_request(cdch_interface_t* p_cdc, uint8_t direction, uint8_
       .wLength  = tu_htole16 (length)
   };
 
-  // use usbh enum buf since application variable does not live long enough
-  uint8_t* enum_buf = NULL;
-
-  if (buffer && length > 0) {
-    enum_buf = usbh_get_enum_buf();
+  // IN data is returned in xfer->buffer
+  uint8_t* data = NULL;
+  if (length > 0) {
+    data = p_cdc->ctrl_buf;
     if (direction == TUSB_DIR_OUT) {
-      tu_memcpy_s(enum_buf, CFG_TUH_ENUMERATION_BUFSIZE, buffer, length);
+      TU_VERIFY(0 == tu_memcpy_s(data, sizeof(p_cdc->ctrl_buf), buffer, length));
+    } else {
+      TU_VERIFY(length <= sizeof(p_cdc->ctrl_buf));
     }
   }
 
@@ -1336,7 +1532,7 @@ static bool ch34x_set_request(cdch_interface_t* p_cdc, uint8_t direction, uint8_
       .daddr       = p_cdc->daddr,
       .ep_addr     = 0,
       .setup       = &request_setup,
-      .buffer      = enum_buf,
+      .buffer      = data,
       .complete_cb = complete_cb,
       .user_data   = user_data
   };
@@ -1350,9 +1546,8 @@ static inline bool ch34x_control_out(cdch_interface_t* p_cdc, uint8_t request, u
 }
 
 static inline bool ch34x_control_in(cdch_interface_t* p_cdc, uint8_t request, uint16_t value, uint16_t index,
-                                    uint8_t* buffer, uint16_t buffersize, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
-  return ch34x_set_request(p_cdc, TUSB_DIR_IN, request, value, index, buffer, buffersize,
-                           complete_cb, user_data);
+                                    uint16_t length, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  return ch34x_set_request(p_cdc, TUSB_DIR_IN, request, value, index, NULL, length, complete_cb, user_data);
 }
 
 static inline bool ch34x_write_reg(cdch_interface_t* p_cdc, uint16_t reg, uint16_t reg_value, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
@@ -1360,9 +1555,9 @@ static inline bool ch34x_write_reg(cdch_interface_t* p_cdc, uint16_t reg, uint16
 }
 
 //static bool ch34x_read_reg_request ( cdch_interface_t* p_cdc, uint16_t reg,
-//                                     uint8_t *buffer, uint16_t buffersize, tuh_xfer_cb_t complete_cb, uintptr_t user_data )
+//                                     uint16_t length, tuh_xfer_cb_t complete_cb, uintptr_t user_data )
 //{
-//  return ch34x_control_in ( p_cdc, CH34X_REQ_READ_REG, reg, 0, buffer, buffersize, complete_cb, user_data );
+//  return ch34x_control_in ( p_cdc, CH34X_REQ_READ_REG, reg, 0, length, complete_cb, user_data );
 //}
 
 static bool ch34x_write_reg_baudrate(cdch_interface_t* p_cdc, uint32_t baudrate,
@@ -1522,14 +1717,13 @@ static void ch34x_process_config(tuh_xfer_t* xfer) {
   uint8_t const idx = tuh_cdc_itf_get_index(xfer->daddr, itf_num);
   cdch_interface_t* p_cdc = get_itf(idx);
   uintptr_t const state = xfer->user_data;
-  uint8_t buffer[2]; // TODO remove
   TU_ASSERT (p_cdc,);
   TU_ASSERT (xfer->result == XFER_RESULT_SUCCESS,);
 
   switch (state) {
     case CONFIG_CH34X_READ_VERSION:
       TU_LOG_DRV("[%u] CDCh CH34x attempt to read Chip Version\r\n", p_cdc->daddr);
-      TU_ASSERT (ch34x_control_in(p_cdc, CH34X_REQ_READ_VERSION, 0, 0, buffer, 2, ch34x_process_config, CONFIG_CH34X_SERIAL_INIT),);
+      TU_ASSERT (ch34x_control_in(p_cdc, CH34X_REQ_READ_VERSION, 0, 0, 2, ch34x_process_config, CONFIG_CH34X_SERIAL_INIT),);
       break;
 
     case CONFIG_CH34X_SERIAL_INIT: {
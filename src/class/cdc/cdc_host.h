@@ -52,7 +52,9 @@
 #define CFG_TUH_CDC_RX_BUFSIZE USBH_EPSIZE_BULK_MAX
 #endif
 
-// RX Endpoint size
+// RX Endpoint size: bytes requested per IN transfer. Set to a multiple of max packet size (and enable
+// CFG_TUSB_EDPT_STREAM_DOUBLE_BUF) to receive several packets per transfer and re-arm before the data is
+// copied to fifo, which is needed to keep up with adapters running at several Mbaud.
 #ifndef CFG_TUH_CDC_RX_EPSIZE
 #define CFG_TUH_CDC_RX_EPSIZE  USBH_EPSIZE_BULK_MAX
 #endif
@@ -132,6 +134,16 @@ bool tuh_cdc_peek(uint8_t idx, uint8_t* ch);
 // Clear the received FIFO
 bool tuh_cdc_read_clear (uint8_t idx);
 
+// Invoked when a read started by tuh_cdc_read_direct() is complete
+typedef void (*tuh_cdc_read_direct_cb_t)(uint8_t idx, void* buffer, uint32_t xferred_bytes);
+
+// Read into buffer without staging data in RX FIFO e.g for bulk download. If RX FIFO has data it is copied out
+// and cb is invoked before returning. Otherwise buffer is submitted to the IN endpoint as soon as it is idle.
+// - bufsize must be at least endpoint packet size, only a multiple of it is transferred
+// - buffer must be kept (and DMA accessible if HCD uses DMA) until cb is invoked
+// - only one direct read at a time, can be started again from cb. Not supported by FTDI
+bool tuh_cdc_read_direct(uint8_t idx, void* buffer, uint32_t bufsize, tuh_cdc_read_direct_cb_t cb);
+
 //--------------------------------------------------------------------+
 // Control Endpoint (Request) API
 // Each Function will make a USB control transfer request to/from device
@@ -199,6 +211,12 @@ bool cdch_set_config (uint8_t dev_addr, uint8_t itf_num);
 bool cdch_xfer_cb    (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
 void cdch_close      (uint8_t dev_addr);
 
+// Transfer from/to fifos of another driver instead of own ones, NULL restores own fifo
+bool cdch_share_fifo (uint8_t idx, tu_fifo_t* rx_ff, tu_fifo_t* tx_ff);
+
+// Receive more data if rx fifo has room
+uint32_t cdch_rx_xfer(uint8_t idx);
+
 #ifdef __cplusplus
  }
 #endif
@@ -26,264 +26,741 @@
 
 #include "tusb_option.h"
 
-#if (CFG_TUH_ENABLED && CFG_TUH_CDC && CFG_TUH_CDC_RNDIS)
+#if (CFG_TUH_ENABLED && CFG_TUH_RNDIS)
 
-//--------------------------------------------------------------------+
-// INCLUDE
-//--------------------------------------------------------------------+
-#include "common/tusb_common.h"
-#include "cdc_host.h"
-#include "cdc_rndis_host.h"
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
 
-#if 0  // TODO remove subtask related macros later
-// Sub Task
-#define OSAL_SUBTASK_BEGIN
-#define OSAL_SUBTASK_END                    return TUSB_ERROR_NONE;
+#include "cdc_rndis_host.h"
 
-#define STASK_RETURN(_error)                return _error;
-#define STASK_INVOKE(_subtask, _status)     (_status) = _subtask
-#define STASK_ASSERT(_cond)                 TU_VERIFY(_cond, TUSB_ERROR_OSAL_TASK_FAILED)
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_RNDIS_LOG_LEVEL
+  #define CFG_TUH_RNDIS_LOG_LEVEL   CFG_TUH_LOG_LEVEL
 #endif
 
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_RNDIS_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC(CFG_TUH_RNDIS_IN_XFER_SIZE >= 1600 && CFG_TUH_RNDIS_OUT_XFER_SIZE >= 1600,
+                 "transfer size must fit a full Ethernet frame with PACKET message header");
+TU_VERIFY_STATIC(CFG_TUH_RNDIS_IN_XFER_SIZE <= 0xFFFF && CFG_TUH_RNDIS_OUT_XFER_SIZE <= 0xFFFF,
+                 "transfer size must be less than 64 KiB");
+TU_VERIFY_STATIC((CFG_TUH_RNDIS_IN_XFER_SIZE % 4) == 0 && (CFG_TUH_RNDIS_OUT_XFER_SIZE % 4) == 0,
+                 "transfer size must be multiple of 4");
+TU_VERIFY_STATIC(CFG_TUH_RNDIS_IN_XFER_N >= 1, "at least one IN transfer buffer is required");
+TU_VERIFY_STATIC(CFG_TUH_RNDIS_OUT_XFER_N >= 2, "at least two OUT transfer buffers are required");
+TU_VERIFY_STATIC(CFG_TUH_ENUMERATION_BUFSIZE >= sizeof(rndis_msg_initialize_cmplt_t) + 8,
+                 "enumeration buffer is too small for RNDIS control messages");
+
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
-#define RNDIS_MSG_PAYLOAD_MAX   (1024*4)
 
-CFG_TUH_MEM_SECTION static uint8_t msg_notification[CFG_TUH_DEVICE_MAX][8];
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN static uint8_t msg_payload[RNDIS_MSG_PAYLOAD_MAX];
+enum {
+  RNDISH_NOTIF_BUFSIZE  = 8,  // RESPONSE_AVAILABLE notification
+  RNDISH_STATUS_BUFSIZE = 64, // INDICATE_STATUS message, without diagnostic info
+  RNDISH_PACKET_HEADER  = sizeof(rndis_msg_packet_t),
+  RNDISH_MAX_ALIGNMENT  = 7   // largest packet_alignment_factor accepted from device
+};
+
+typedef struct {
+  uint8_t daddr;
+
+  uint8_t itf_num;        // Communication (Control) Interface
+  uint8_t itf_data;       // Data Interface
+  bool mounted;           // Enumeration is complete
+  bool link_up;           // Last queried or reported by INDICATE_STATUS
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_out_size;
+
+  bool has_mac;
+  uint8_t mac_address[6];
+
+  uint32_t request_id;    // Id of last sent control message
+
+  // Parameters agreed with device by INITIALIZE message
+  uint16_t out_xfer_size;         // Maximum size of transmitted transfer
+  uint16_t out_alignment;         // Alignment of PACKET messages in transmitted transfer
+  uint8_t  max_packets_per_xfer;  // Maximum number of PACKET messages per transmitted transfer
+
+  // Receive
+  uint8_t rx_head;                // Index in receive_xfer[] of the oldest received transfer
+  uint8_t rx_count;               // Number of received transfers not yet fully consumed by client
+  uint16_t rx_offset;             // Offset of next PACKET message in receive_xfer[rx_head]
+  bool rx_holding;                // Client is holding a packet until tuh_network_recv_renew()
+  uint16_t rx_xfer_len[CFG_TUH_RNDIS_IN_XFER_N];
+
+  // Transmit
+  uint8_t tx_head;                // Index in transmit_xfer[] of the oldest closed transfer, sent first
+  uint8_t tx_count;               // Number of closed transfers waiting for or being transferred
+  uint8_t current_xfer;           // Index in transmit_xfer[] that is currently being filled with packets
+  uint8_t packet_count;           // Number of PACKET messages in transmit_xfer[current_xfer]
+  uint16_t xfer_length;           // Length of transmit_xfer[current_xfer] up to the end of last packet
+  uint16_t last_msg_offset;       // Offset of last PACKET message in transmit_xfer[current_xfer]
+  uint16_t tx_xfer_len[CFG_TUH_RNDIS_OUT_XFER_N];
+  bool transferring;
+
+  CFG_TUH_MEM_ALIGN uint8_t receive_xfer[CFG_TUH_RNDIS_IN_XFER_N][CFG_TUH_RNDIS_IN_XFER_SIZE];
+  CFG_TUH_MEM_ALIGN uint8_t transmit_xfer[CFG_TUH_RNDIS_OUT_XFER_N][CFG_TUH_RNDIS_OUT_XFER_SIZE];
+  CFG_TUH_MEM_ALIGN uint8_t notif_buf[RNDISH_NOTIF_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t status_buf[RNDISH_STATUS_BUFSIZE];
+} rndish_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static rndish_interface_t _rndish_itf[CFG_TUH_RNDIS];
 
-static rndish_data_t rndish_data[CFG_TUH_DEVICE_MAX];
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline rndish_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_RNDIS, NULL);
+  rndish_interface_t* p_rndis = &_rndish_itf[idx];
+  return (p_rndis->daddr != 0) ? p_rndis : NULL;
+}
+
+// Get instance ID by endpoint address
+static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_RNDIS; idx++) {
+    rndish_interface_t const* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr &&
+        (p_rndis->ep_notif == ep_addr || p_rndis->ep_in == ep_addr || p_rndis->ep_out == ep_addr)) {
+      return idx;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
 
-// TODO Microsoft requires message length for any get command must be at least 4096 bytes
+static rndish_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_RNDIS; i++) {
+    if (_rndish_itf[i].daddr == 0) return &_rndish_itf[i];
+  }
+  return NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t msg_read32(uint8_t const* msg, uint16_t offset) {
+  return tu_le32toh(tu_unaligned_read32(msg + offset));
+}
 
 //--------------------------------------------------------------------+
-// INTERNAL OBJECT & FUNCTION DECLARATION
+// Interface API
 //--------------------------------------------------------------------+
-static tusb_error_t rndis_body_subtask(void);
-static tusb_error_t send_message_get_response_subtask( uint8_t dev_addr, cdch_data_t *p_cdc,
-                                                       uint8_t * p_mess, uint32_t mess_length,
-                                                       uint8_t *p_response );
+uint8_t tuh_rndis_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_RNDIS; idx++) {
+    rndish_interface_t const* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr && p_rndis->itf_num == itf_num) return idx;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_rndis_mounted(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis);
+  return p_rndis->mounted;
+}
+
+bool tuh_rndis_get_mac_address(uint8_t idx, uint8_t mac[6]) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted && p_rndis->has_mac);
+  memcpy(mac, p_rndis->mac_address, 6);
+  return true;
+}
+
+bool tuh_rndis_link_is_up(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted);
+  return p_rndis->link_up;
+}
 
 //--------------------------------------------------------------------+
-// APPLICATION API
+// Receive
 //--------------------------------------------------------------------+
-tusb_error_t tusbh_cdc_rndis_get_mac_addr(uint8_t dev_addr, uint8_t mac_address[6])
-{
-  TU_ASSERT( tusbh_cdc_rndis_is_mounted(dev_addr),  TUSB_ERROR_CDCH_DEVICE_NOT_MOUNTED);
-  TU_VERIFY( mac_address,  TUSB_ERROR_INVALID_PARA);
 
-  memcpy(mac_address, rndish_data[dev_addr-1].mac_address, 6);
+// Receive the next transfer if there is a free buffer and the endpoint is idle
+static void rndish_recv_arm(rndish_interface_t* p_rndis) {
+  if (p_rndis->rx_count >= CFG_TUH_RNDIS_IN_XFER_N) return;
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_in),);
+
+  uint8_t const i = (p_rndis->rx_head + p_rndis->rx_count) % CFG_TUH_RNDIS_IN_XFER_N;
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_in, p_rndis->receive_xfer[i], CFG_TUH_RNDIS_IN_XFER_SIZE)) {
+    usbh_edpt_release(p_rndis->daddr, p_rndis->ep_in);
+  }
+}
+
+// Find the next PACKET message of received transfers, releasing the oldest transfer once all of its messages
+// are consumed. Device may concatenate up to max_packet_per_xfer messages (as set by INITIALIZE) in a transfer.
+static bool rndish_recv_next(rndish_interface_t* p_rndis, uint8_t const** data, uint16_t* len) {
+  while (p_rndis->rx_count) {
+    uint8_t const* xfer = p_rndis->receive_xfer[p_rndis->rx_head];
+    uint16_t const xfer_len = p_rndis->rx_xfer_len[p_rndis->rx_head];
+    uint16_t const offset = p_rndis->rx_offset;
+
+    // remaining bytes shorter than a header are padding to avoid ZLP
+    if (offset + RNDISH_PACKET_HEADER <= xfer_len) {
+      uint8_t const* msg = xfer + offset;
+      uint32_t const msg_type    = msg_read32(msg, 0);
+      uint32_t const msg_length  = msg_read32(msg, 4);
+      uint32_t const data_offset = msg_read32(msg, 8);
+      uint32_t const data_length = msg_read32(msg, 12);
+
+      if (msg_type == RNDIS_MSG_PACKET && msg_length >= RNDISH_PACKET_HEADER && msg_length <= (uint32_t) (xfer_len - offset)) {
+        p_rndis->rx_offset = (uint16_t) (offset + msg_length);
+
+        // data_offset is counted from data_offset field itself
+        if (data_length && 8 + data_offset + data_length <= msg_length) {
+          *data = msg + 8 + data_offset;
+          *len = (uint16_t) data_length;
+          return true;
+        }
+
+        TU_LOG_DRV("  RNDISh packet without data\r\n");
+        continue;
+      }
+
+      TU_LOG_DRV("  RNDISh invalid message type = %08" PRIX32 " length = %" PRIu32 "\r\n", msg_type, msg_length);
+    }
+
+    // release oldest transfer, rest of an invalid transfer is dropped
+    p_rndis->rx_offset = 0;
+    p_rndis->rx_head = (uint8_t) ((p_rndis->rx_head + 1) % CFG_TUH_RNDIS_IN_XFER_N);
+    p_rndis->rx_count--;
+  }
+
+  return false;
+}
+
+void tuh_network_recv_renew(uint8_t idx) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted,);
+
+  uint8_t const* data = NULL;
+  uint16_t len = 0;
+  p_rndis->rx_holding = rndish_recv_next(p_rndis, &data, &len);
+  rndish_recv_arm(p_rndis); // buffer may have been released
+
+  // packet is passed in place, client keeps it until next tuh_network_recv_renew()
+  if (p_rndis->rx_holding) tuh_network_recv_cb(idx, data, len);
+}
+
+static void handle_incoming_xfer(uint8_t idx, rndish_interface_t* p_rndis, uint32_t len) {
+  if (len > 0) {
+    uint8_t const i = (p_rndis->rx_head + p_rndis->rx_count) % CFG_TUH_RNDIS_IN_XFER_N;
+    p_rndis->rx_xfer_len[i] = (uint16_t) len;
+    p_rndis->rx_count++;
+
+    // deliver now if client is not holding a packet, otherwise on next tuh_network_recv_renew()
+    if (!p_rndis->rx_holding) {
+      tuh_network_recv_renew(idx);
+      return;
+    }
+  }
 
-  return TUSB_ERROR_NONE;
+  rndish_recv_arm(p_rndis);
 }
 
 //--------------------------------------------------------------------+
-// IMPLEMENTATION
+// Transmit
 //--------------------------------------------------------------------+
 
-// To enable the TASK_ASSERT style (quick return on false condition) in a real RTOS, a task must act as a wrapper
-// and is used mainly to call subtasks. Within a subtask return statement can be called freely, the task with
-// forever loop cannot have any return at all.
-OSAL_TASK_FUNCTION(cdch_rndis_task) (void* param;)
-{
-  OSAL_TASK_BEGIN
-  rndis_body_subtask();
-  OSAL_TASK_END
+// Offset where next PACKET message of current transfer is placed, all but the first are aligned to
+// packet_alignment_factor of device
+static uint16_t rndish_msg_offset(rndish_interface_t const* p_rndis) {
+  if (!p_rndis->packet_count) return 0;
+  return (uint16_t) (TU_DIV_CEIL(p_rndis->xfer_length, p_rndis->out_alignment) * p_rndis->out_alignment);
 }
 
-static tusb_error_t rndis_body_subtask(void)
-{
-  static uint8_t relative_addr;
+// Queue the current transfer for transmission, then start filling the next one in the ring with packets
+static void rndish_close_xfer(rndish_interface_t* p_rndis) {
+  uint8_t* xfer = p_rndis->transmit_xfer[p_rndis->current_xfer];
+  uint16_t xfer_length = p_rndis->xfer_length;
+
+  // transfer shorter than max_xfer_size must end with a short packet, pad one byte instead of sending ZLP
+  if ((xfer_length % p_rndis->ep_out_size) == 0 && xfer_length < p_rndis->out_xfer_size) {
+    xfer[xfer_length] = 0;
+    xfer_length++;
+  }
+
+  p_rndis->tx_xfer_len[p_rndis->current_xfer] = xfer_length;
+  p_rndis->tx_count++;
 
-  OSAL_SUBTASK_BEGIN
+  p_rndis->current_xfer = (uint8_t) ((p_rndis->current_xfer + 1) % CFG_TUH_RNDIS_OUT_XFER_N);
+  p_rndis->packet_count = 0;
+  p_rndis->xfer_length = 0;
+  p_rndis->last_msg_offset = 0;
+}
 
-  for (relative_addr = 0; relative_addr < CFG_TUH_DEVICE_MAX; relative_addr++)
-  {
+// If not already transmitting, start sending the oldest closed transfer to the device.
+// If there is none, close the current transfer if it has any packet and send it.
+static void rndish_start_tx(rndish_interface_t* p_rndis) {
+  if (p_rndis->transferring) return;
 
+  if (!p_rndis->tx_count) {
+    if (!p_rndis->packet_count) return;
+    rndish_close_xfer(p_rndis);
   }
 
-  osal_task_delay(100);
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_out),);
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_out, p_rndis->transmit_xfer[p_rndis->tx_head],
+                      p_rndis->tx_xfer_len[p_rndis->tx_head])) {
+    usbh_edpt_release(p_rndis->daddr, p_rndis->ep_out);
+    return;
+  }
 
-  OSAL_SUBTASK_END
+  p_rndis->transferring = true;
+}
+
+bool tuh_network_can_xmit(uint8_t idx, uint16_t size) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted);
+
+  bool const full_count = p_rndis->packet_count >= p_rndis->max_packets_per_xfer;
+  bool const full_size = rndish_msg_offset(p_rndis) + RNDISH_PACKET_HEADER + size > p_rndis->out_xfer_size;
+
+  if (full_count || full_size) {
+    // queue current transfer behind the one on the bus and continue with the next one, keeping one
+    // transfer always available for filling
+    if (!p_rndis->packet_count || p_rndis->tx_count + 2 > CFG_TUH_RNDIS_OUT_XFER_N) {
+      TU_LOG_DRV("RNDISh xfer full [by %s]\r\n", full_count ? "count" : "size");
+      return false;
+    }
+    rndish_close_xfer(p_rndis);
+
+    // packet does not fit in an empty transfer
+    TU_VERIFY(RNDISH_PACKET_HEADER + size <= p_rndis->out_xfer_size);
+  }
+
+  return true;
+}
+
+uint8_t* tuh_network_xmit_reserve(uint8_t idx, uint16_t size) {
+  TU_VERIFY(tuh_network_can_xmit(idx, size), NULL);
+
+  rndish_interface_t* p_rndis = &_rndish_itf[idx];
+  return p_rndis->transmit_xfer[p_rndis->current_xfer] + rndish_msg_offset(p_rndis) + RNDISH_PACKET_HEADER;
+}
+
+void tuh_network_xmit_commit(uint8_t idx, uint16_t size) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted,);
+
+  uint8_t* xfer = p_rndis->transmit_xfer[p_rndis->current_xfer];
+  uint16_t const offset = rndish_msg_offset(p_rndis);
+
+  if (p_rndis->packet_count) {
+    // previous message is extended with zero padding up to this one
+    rndis_msg_packet_t* prev = (rndis_msg_packet_t*) (xfer + p_rndis->last_msg_offset);
+    tu_memclr(xfer + p_rndis->xfer_length, offset - p_rndis->xfer_length);
+    prev->length = tu_htole32((uint32_t) (offset - p_rndis->last_msg_offset));
+  }
+
+  rndis_msg_packet_t* msg = (rndis_msg_packet_t*) (xfer + offset);
+  tu_memclr(msg, RNDISH_PACKET_HEADER);
+  msg->type        = tu_htole32(RNDIS_MSG_PACKET);
+  msg->length      = tu_htole32((uint32_t) (RNDISH_PACKET_HEADER + size));
+  msg->data_offset = tu_htole32((uint32_t) (RNDISH_PACKET_HEADER - 8));
+  msg->data_length = tu_htole32(size);
+
+  p_rndis->packet_count++;
+  p_rndis->last_msg_offset = offset;
+  p_rndis->xfer_length = (uint16_t) (offset + RNDISH_PACKET_HEADER + size);
+
+  rndish_start_tx(p_rndis);
+}
+
+void tuh_network_xmit(uint8_t idx, void* ref, uint16_t arg) {
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted,);
+
+  uint8_t* dst = p_rndis->transmit_xfer[p_rndis->current_xfer] + rndish_msg_offset(p_rndis) + RNDISH_PACKET_HEADER;
+  uint16_t const size = tuh_network_xmit_cb(idx, dst, ref, arg);
+  tuh_network_xmit_commit(idx, size);
+}
+
+//--------------------------------------------------------------------+
+// Control messages
+//--------------------------------------------------------------------+
+
+static bool rndish_control_xfer(uint8_t daddr, uint8_t itf_num, uint8_t request, tusb_dir_t dir,
+                                void* buffer, uint16_t len, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  tusb_control_request_t const req = {
+      .bmRequestType_bit = {
+          .recipient = TUSB_REQ_RCPT_INTERFACE,
+          .type      = TUSB_REQ_TYPE_CLASS,
+          .direction = dir
+      },
+      .bRequest = request,
+      .wValue   = 0,
+      .wIndex   = tu_htole16((uint16_t) itf_num),
+      .wLength  = tu_htole16(len)
+  };
+
+  tuh_xfer_t xfer = {
+      .daddr       = daddr,
+      .ep_addr     = 0,
+      .setup       = &req,
+      .buffer      = (uint8_t*) buffer,
+      .complete_cb = complete_cb,
+      .user_data   = user_data
+  };
+
+  return tuh_control_xfer(&xfer);
 }
 
 //--------------------------------------------------------------------+
-// RNDIS-CDC Driver API
+// Notification
 //--------------------------------------------------------------------+
-void rndish_init(void)
-{
-  tu_memclr(rndish_data, sizeof(rndish_data_t)*CFG_TUH_DEVICE_MAX);
 
-  //------------- Task creation -------------//
+static void rndish_notif_arm(rndish_interface_t* p_rndis) {
+  if (!p_rndis->ep_notif) return;
+  TU_VERIFY(usbh_edpt_claim(p_rndis->daddr, p_rndis->ep_notif),);
 
-  //------------- semaphore creation for notification pipe -------------//
-  for(uint8_t i=0; i<CFG_TUH_DEVICE_MAX; i++)
-  {
-    rndish_data[i].sem_notification_hdl = osal_semaphore_create( OSAL_SEM_REF(rndish_data[i].semaphore_notification) );
+  if (!usbh_edpt_xfer(p_rndis->daddr, p_rndis->ep_notif, p_rndis->notif_buf, RNDISH_NOTIF_BUFSIZE)) {
+    usbh_edpt_release(p_rndis->daddr, p_rndis->ep_notif);
   }
 }
 
-void rndish_close(uint8_t dev_addr)
-{
-  osal_semaphore_reset( rndish_data[dev_addr-1].sem_notification_hdl );
-//  tu_memclr(&rndish_data[dev_addr-1], sizeof(rndish_data_t)); TODO need to move semaphore & its handle out before memclr
+// Unsolicited response once mounted is INDICATE_STATUS, only media connect/disconnect are handled
+static void handle_status_response(tuh_xfer_t* xfer) {
+  uint8_t const idx = (uint8_t) xfer->user_data;
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis && p_rndis->mounted,);
+
+  if (xfer->result == XFER_RESULT_SUCCESS && xfer->actual_len >= 12 &&
+      msg_read32(p_rndis->status_buf, 0) == RNDIS_MSG_INDICATE_STATUS) {
+    uint32_t const status = msg_read32(p_rndis->status_buf, 8);
+    if (status == RNDIS_STATUS_MEDIA_CONNECT || status == RNDIS_STATUS_MEDIA_DISCONNECT) {
+      p_rndis->link_up = (status == RNDIS_STATUS_MEDIA_CONNECT);
+      TU_LOG_DRV("  RNDISh link %s\r\n", p_rndis->link_up ? "up" : "down");
+      if (tuh_network_link_state_cb) tuh_network_link_state_cb(idx, p_rndis->link_up);
+    }
+  }
+
+  rndish_notif_arm(p_rndis);
 }
 
+static void handle_notification(uint8_t idx, rndish_interface_t* p_rndis, uint32_t len) {
+  // RESPONSE_AVAILABLE, fetch the response and re-arm notification when done
+  if (len >= 4 && msg_read32(p_rndis->notif_buf, 0) == CDC_NOTIF_RESPONSE_AVAILABLE &&
+      rndish_control_xfer(p_rndis->daddr, p_rndis->itf_num, CDC_REQUEST_GET_ENCAPSULATED_RESPONSE, TUSB_DIR_IN,
+                          p_rndis->status_buf, RNDISH_STATUS_BUFSIZE, handle_status_response, idx)) {
+    return;
+  }
 
-static rndis_msg_initialize_t const msg_init =
-{
-    .type          = RNDIS_MSG_INITIALIZE,
-    .length        = sizeof(rndis_msg_initialize_t),
-    .request_id    = 1, // TODO should use some magic number
-    .major_version = 1,
-    .minor_version = 0,
-    .max_xfer_size = 0x4000 // TODO mimic windows
-};
+  rndish_notif_arm(p_rndis);
+}
 
-static rndis_msg_query_t const msg_query_permanent_addr =
-{
-    .type          = RNDIS_MSG_QUERY,
-    .length        = sizeof(rndis_msg_query_t)+6,
-    .request_id    = 1,
-    .oid           = RNDIS_OID_802_3_PERMANENT_ADDRESS,
-    .buffer_length = 6,
-    .buffer_offset = 20,
-};
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+bool rndish_init(void) {
+  TU_LOG_DRV("sizeof(rndish_interface_t) = %u\r\n", sizeof(rndish_interface_t));
+  tu_memclr(_rndish_itf, sizeof(_rndish_itf));
+  return true;
+}
 
-static rndis_msg_set_t const msg_set_packet_filter =
-{
-    .type          = RNDIS_MSG_SET,
-    .length        = sizeof(rndis_msg_set_t)+4,
-    .request_id    = 1,
-    .oid           = RNDIS_OID_GEN_CURRENT_PACKET_FILTER,
-    .buffer_length = 4,
-    .buffer_offset = 20,
-};
+bool rndish_deinit(void) {
+  return true;
+}
+
+bool rndish_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_epaddr(daddr, ep_addr);
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis);
+
+  if (ep_addr == p_rndis->ep_in) {
+    // failed transfer is dropped
+    handle_incoming_xfer(idx, p_rndis, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  } else if (ep_addr == p_rndis->ep_out) {
+    if (p_rndis->transferring) {
+      p_rndis->transferring = false;
+      p_rndis->tx_head = (uint8_t) ((p_rndis->tx_head + 1) % CFG_TUH_RNDIS_OUT_XFER_N);
+      p_rndis->tx_count--;
+    }
+
+    // Send transfers queued up while this one was being emitted, or packets added to the current one meanwhile
+    rndish_start_tx(p_rndis);
+  } else if (ep_addr == p_rndis->ep_notif) {
+    handle_notification(idx, p_rndis, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  }
+
+  return true;
+}
 
-tusb_error_t rndish_open_subtask(uint8_t dev_addr, cdch_data_t *p_cdc)
-{
-  tusb_error_t error;
-
-  OSAL_SUBTASK_BEGIN
-
-  //------------- Message Initialize -------------//
-  memcpy(msg_payload, &msg_init, sizeof(rndis_msg_initialize_t));
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_initialize_t),
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  // TODO currently not support multiple data packets per xfer
-  rndis_msg_initialize_cmplt_t * const p_init_cmpt = (rndis_msg_initialize_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_init_cmpt->type == RNDIS_MSG_INITIALIZE_CMPLT && p_init_cmpt->status == RNDIS_STATUS_SUCCESS &&
-                 p_init_cmpt->max_packet_per_xfer == 1 && p_init_cmpt->max_xfer_size <= RNDIS_MSG_PAYLOAD_MAX);
-  rndish_data[dev_addr-1].max_xfer_size = p_init_cmpt->max_xfer_size;
-
-  //------------- Message Query 802.3 Permanent Address -------------//
-  memcpy(msg_payload, &msg_query_permanent_addr, sizeof(rndis_msg_query_t));
-  tu_memclr(msg_payload + sizeof(rndis_msg_query_t), 6); // 6 bytes for MAC address
-
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_query_t) + 6,
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  rndis_msg_query_cmplt_t * const p_query_cmpt = (rndis_msg_query_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_query_cmpt->type == RNDIS_MSG_QUERY_CMPLT && p_query_cmpt->status == RNDIS_STATUS_SUCCESS);
-  memcpy(rndish_data[dev_addr-1].mac_address, msg_payload + 8 + p_query_cmpt->buffer_offset, 6);
-
-  //------------- Set OID_GEN_CURRENT_PACKET_FILTER to (DIRECTED | MULTICAST | BROADCAST) -------------//
-  memcpy(msg_payload, &msg_set_packet_filter, sizeof(rndis_msg_set_t));
-  tu_memclr(msg_payload + sizeof(rndis_msg_set_t), 4); // 4 bytes for filter flags
-  ((rndis_msg_set_t*) msg_payload)->oid_buffer[0] = (RNDIS_PACKET_TYPE_DIRECTED | RNDIS_PACKET_TYPE_MULTICAST | RNDIS_PACKET_TYPE_BROADCAST);
-
-  STASK_INVOKE(
-      send_message_get_response_subtask( dev_addr, p_cdc,
-                                         msg_payload, sizeof(rndis_msg_set_t) + 4,
-                                         msg_payload),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  rndis_msg_set_cmplt_t * const p_set_cmpt = (rndis_msg_set_cmplt_t *) msg_payload;
-  STASK_ASSERT(p_set_cmpt->type == RNDIS_MSG_SET_CMPLT && p_set_cmpt->status == RNDIS_STATUS_SUCCESS);
-
-  tusbh_cdc_rndis_mounted_cb(dev_addr);
-
-  OSAL_SUBTASK_END
-}
-
-void rndish_xfer_isr(cdch_data_t *p_cdc, pipe_handle_t pipe_hdl, xfer_result_t event, uint32_t xferred_bytes)
-{
-  if ( pipehandle_is_equal(pipe_hdl, p_cdc->pipe_notification) )
-  {
-    osal_semaphore_post( rndish_data[pipe_hdl.dev_addr-1].sem_notification_hdl );
+void rndish_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_RNDIS; idx++) {
+    rndish_interface_t* p_rndis = &_rndish_itf[idx];
+    if (p_rndis->daddr == daddr) {
+      TU_LOG_DRV("  RNDISh close addr = %u index = %u\r\n", daddr, idx);
+      if (tuh_rndis_umount_cb) tuh_rndis_umount_cb(idx);
+      tu_memclr(p_rndis, offsetof(rndish_interface_t, receive_xfer));
+    }
   }
 }
 
 //--------------------------------------------------------------------+
-// INTERNAL & HELPER
+// Enumeration
 //--------------------------------------------------------------------+
-static tusb_error_t send_message_get_response_subtask( uint8_t dev_addr, cdch_data_t *p_cdc,
-                                                       uint8_t * p_mess, uint32_t mess_length,
-                                                       uint8_t *p_response)
-{
-  tusb_error_t error;
-
-  OSAL_SUBTASK_BEGIN
-
-  //------------- Send RNDIS Control Message -------------//
-  STASK_INVOKE(
-      usbh_control_xfer_subtask( dev_addr, bm_request_type(TUSB_DIR_OUT, TUSB_REQ_TYPE_CLASS, TUSB_REQ_RCPT_INTERFACE),
-                                 CDC_REQUEST_SEND_ENCAPSULATED_COMMAND, 0, p_cdc->interface_number,
-                                 mess_length, p_mess),
-      error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  //------------- waiting for Response Available notification -------------//
-  (void) usbh_edpt_xfer(p_cdc->pipe_notification, msg_notification[dev_addr-1], 8);
-  osal_semaphore_wait(rndish_data[dev_addr-1].sem_notification_hdl, OSAL_TIMEOUT_NORMAL, &error);
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-  STASK_ASSERT(msg_notification[dev_addr-1][0] == 1);
-
-  //------------- Get RNDIS Message Initialize Complete -------------//
-  STASK_INVOKE(
-    usbh_control_xfer_subtask( dev_addr, bm_request_type(TUSB_DIR_IN, TUSB_REQ_TYPE_CLASS, TUSB_REQ_RCPT_INTERFACE),
-                               CDC_REQUEST_GET_ENCAPSULATED_RESPONSE, 0, p_cdc->interface_number,
-                               RNDIS_MSG_PAYLOAD_MAX, p_response),
-    error
-  );
-  if ( TUSB_ERROR_NONE != error )   STASK_RETURN(error);
-
-  OSAL_SUBTASK_END
-}
-
-//static tusb_error_t send_process_msg_initialize_subtask(uint8_t dev_addr, cdch_data_t *p_cdc)
-//{
-//  tusb_error_t error;
-//
-//  OSAL_SUBTASK_BEGIN
-//
-//  *((rndis_msg_initialize_t*) msg_payload) = (rndis_msg_initialize_t)
-//                                            {
-//                                                .type          = RNDIS_MSG_INITIALIZE,
-//                                                .length        = sizeof(rndis_msg_initialize_t),
-//                                                .request_id    = 1, // TODO should use some magic number
-//                                                .major_version = 1,
-//                                                .minor_version = 0,
-//                                                .max_xfer_size = 0x4000 // TODO mimic windows
-//                                            };
-//
-//
-//
-//  OSAL_SUBTASK_END
-//}
+
+bool rndish_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  // Control interface is CDC ACM with vendor protocol, or Wireless Controller RNDIS, or Misc RNDIS over Ethernet
+  uint8_t const itf_class = desc_itf->bInterfaceClass;
+  uint8_t const itf_subclass = desc_itf->bInterfaceSubClass;
+  uint8_t const itf_protocol = desc_itf->bInterfaceProtocol;
+  TU_VERIFY((TUSB_CLASS_CDC == itf_class && CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == itf_subclass &&
+             0xFF == itf_protocol) ||
+            (TUSB_CLASS_WIRELESS_CONTROLLER == itf_class && 0x01 == itf_subclass && 0x03 == itf_protocol) ||
+            (TUSB_CLASS_MISC == itf_class && 0x04 == itf_subclass && 0x01 == itf_protocol));
+  TU_LOG_DRV("[%u] RNDIS opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
+
+  rndish_interface_t* p_rndis = find_new_itf();
+  TU_ASSERT(p_rndis); // not enough interface, try to increase CFG_TUH_RNDIS
+  tu_memclr(p_rndis, offsetof(rndish_interface_t, receive_xfer)); // clean up after previous failed attempt, if any
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  //------------- Control Interface: notification endpoint -------------//
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer &&
+                TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress));
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+      p_rndis->ep_notif = desc_ep->bEndpointAddress;
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  //------------- Data Interface: bulk endpoints, no alternate setting -------------//
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* desc_data = (tusb_desc_interface_t const*) p_desc;
+      TU_ASSERT(TUSB_CLASS_CDC_DATA == desc_data->bInterfaceClass && 2 == desc_data->bNumEndpoints);
+      p_rndis->itf_data = desc_data->bInterfaceNumber;
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+      if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        p_rndis->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p_rndis->ep_out = desc_ep->bEndpointAddress;
+        p_rndis->ep_out_size = tu_edpt_packet_size(desc_ep);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_rndis->ep_in && p_rndis->ep_out);
+
+  p_rndis->daddr = daddr;
+  p_rndis->itf_num = desc_itf->bInterfaceNumber;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Set Configure
+//--------------------------------------------------------------------+
+
+// Each message is sent with SEND_ENCAPSULATED_COMMAND, then its completion is read back with
+// GET_ENCAPSULATED_RESPONSE in the following state
+enum {
+  CONFIG_INITIALIZE = 0,
+  CONFIG_GET_INITIALIZE_CMPLT,
+  CONFIG_QUERY_MAC_ADDRESS,
+  CONFIG_GET_MAC_ADDRESS,
+  CONFIG_QUERY_LINK,
+  CONFIG_GET_LINK,
+  CONFIG_SET_PACKET_FILTER,
+  CONFIG_GET_PACKET_FILTER_CMPLT,
+  CONFIG_COMPLETE
+};
+
+#define CONFIG_USER_DATA(_idx, _state)  ((uintptr_t) (((_idx) << 8) | (_state)))
+
+static void process_set_config(tuh_xfer_t* xfer);
+
+static bool rndish_send_msg(rndish_interface_t* p_rndis, uint8_t idx, uint8_t* msg, uint16_t len, uint8_t next_state) {
+  return rndish_control_xfer(p_rndis->daddr, p_rndis->itf_num, CDC_REQUEST_SEND_ENCAPSULATED_COMMAND, TUSB_DIR_OUT,
+                             msg, len, process_set_config, CONFIG_USER_DATA(idx, next_state));
+}
+
+static bool rndish_get_response(rndish_interface_t* p_rndis, uint8_t idx, uint8_t* buf, uint8_t next_state) {
+  return rndish_control_xfer(p_rndis->daddr, p_rndis->itf_num, CDC_REQUEST_GET_ENCAPSULATED_RESPONSE, TUSB_DIR_IN,
+                             buf, CFG_TUH_ENUMERATION_BUFSIZE, process_set_config, CONFIG_USER_DATA(idx, next_state));
+}
+
+// Build QUERY or SET message with optional 4-byte input value
+static uint16_t rndish_build_oid_msg(rndish_interface_t* p_rndis, uint8_t* buf, uint32_t type, uint32_t oid,
+                                     uint32_t const* value) {
+  rndis_msg_query_t* msg = (rndis_msg_query_t*) buf;
+  uint16_t const len = (uint16_t) (sizeof(rndis_msg_query_t) + (value ? 4 : 0));
+
+  tu_memclr(msg, sizeof(rndis_msg_query_t));
+  msg->type       = tu_htole32(type);
+  msg->length     = tu_htole32(len);
+  msg->request_id = tu_htole32(++p_rndis->request_id);
+  msg->oid        = tu_htole32(oid);
+
+  if (value) {
+    msg->buffer_length = tu_htole32(4);
+    msg->buffer_offset = tu_htole32(sizeof(rndis_msg_query_t) - 8); // counted from request_id
+    tu_unaligned_write32(msg->oid_buffer, tu_htole32(*value));
+  }
+
+  return len;
+}
+
+// Check completion message type, request id and status
+static bool rndish_check_cmplt(rndish_interface_t const* p_rndis, uint8_t const* buf, uint32_t len, uint32_t type) {
+  TU_VERIFY(len >= 16);
+  TU_VERIFY(msg_read32(buf, 0) == type && msg_read32(buf, 8) == p_rndis->request_id);
+  TU_VERIFY(msg_read32(buf, 12) == RNDIS_STATUS_SUCCESS);
+  return true;
+}
+
+// Get information buffer of QUERY_CMPLT, return its length
+static uint32_t rndish_query_data(uint8_t const* buf, uint32_t len, uint8_t const** data) {
+  TU_VERIFY(len >= sizeof(rndis_msg_query_cmplt_t), 0);
+  uint32_t const buf_length = msg_read32(buf, 16);
+  uint32_t const buf_offset = msg_read32(buf, 20); // counted from request_id
+  TU_VERIFY(8 + buf_offset + buf_length <= len, 0);
+  *data = buf + 8 + buf_offset;
+  return buf_length;
+}
+
+bool rndish_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_rndis_itf_get_index(daddr, itf_num);
+  TU_ASSERT(idx < CFG_TUH_RNDIS);
+
+  tusb_control_request_t request;
+  request.bRequest = 0;
+
+  // fake transfer to kick-off process
+  tuh_xfer_t xfer;
+  xfer.daddr = daddr;
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.setup = &request;
+  xfer.user_data = CONFIG_USER_DATA(idx, CONFIG_INITIALIZE);
+
+  process_set_config(&xfer);
+
+  return true;
+}
+
+static void process_set_config(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uintptr_t const state = xfer->user_data & 0xff;
+
+  rndish_interface_t* p_rndis = get_itf(idx);
+  TU_VERIFY(p_rndis,);
+  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS,);
+
+  uint8_t* enum_buf = usbh_get_enum_buf(daddr);
+
+  switch (state) {
+    case CONFIG_INITIALIZE: {
+      rndis_msg_initialize_t* msg = (rndis_msg_initialize_t*) enum_buf;
+      msg->type          = tu_htole32(RNDIS_MSG_INITIALIZE);
+      msg->length        = tu_htole32(sizeof(rndis_msg_initialize_t));
+      msg->request_id    = tu_htole32(++p_rndis->request_id);
+      msg->major_version = tu_htole32(1);
+      msg->minor_version = tu_htole32(0);
+      msg->max_xfer_size = tu_htole32(CFG_TUH_RNDIS_IN_XFER_SIZE); // device concatenates packets up to this
+
+      TU_ASSERT(rndish_send_msg(p_rndis, idx, enum_buf, sizeof(rndis_msg_initialize_t),
+                                CONFIG_GET_INITIALIZE_CMPLT),);
+      break;
+    }
+
+    case CONFIG_GET_INITIALIZE_CMPLT:
+    case CONFIG_GET_MAC_ADDRESS:
+    case CONFIG_GET_LINK:
+    case CONFIG_GET_PACKET_FILTER_CMPLT:
+      TU_ASSERT(rndish_get_response(p_rndis, idx, enum_buf, (uint8_t) (state + 1)),);
+      break;
+
+    case CONFIG_QUERY_MAC_ADDRESS: {
+      TU_ASSERT(rndish_check_cmplt(p_rndis, enum_buf, xfer->actual_len, RNDIS_MSG_INITIALIZE_CMPLT) &&
+                xfer->actual_len >= sizeof(rndis_msg_initialize_cmplt_t),);
+      uint32_t const max_packets = msg_read32(enum_buf, offsetof(rndis_msg_initialize_cmplt_t, max_packet_per_xfer));
+      uint32_t const max_xfer = msg_read32(enum_buf, offsetof(rndis_msg_initialize_cmplt_t, max_xfer_size));
+      uint32_t const align_factor = msg_read32(enum_buf, offsetof(rndis_msg_initialize_cmplt_t, packet_alignment_factor));
+
+      p_rndis->out_xfer_size = (uint16_t) tu_min32(max_xfer, CFG_TUH_RNDIS_OUT_XFER_SIZE);
+      p_rndis->max_packets_per_xfer = (max_packets && max_packets < CFG_TUH_RNDIS_MAX_PACKETS_PER_XFER)
+                                      ? (uint8_t) max_packets : CFG_TUH_RNDIS_MAX_PACKETS_PER_XFER;
+      p_rndis->out_alignment = tu_max16((uint16_t) (1u << tu_min32(align_factor, RNDISH_MAX_ALIGNMENT)), 4);
+
+      TU_LOG_DRV("  RNDISh max xfer = %" PRIu32 ", max packets = %u, alignment = %u\r\n",
+                 max_xfer, p_rndis->max_packets_per_xfer, p_rndis->out_alignment);
+      TU_ASSERT(p_rndis->out_xfer_size >= RNDISH_PACKET_HEADER + 1514,);
+
+      uint16_t const len = rndish_build_oid_msg(p_rndis, enum_buf, RNDIS_MSG_QUERY,
+                                                RNDIS_OID_802_3_PERMANENT_ADDRESS, NULL);
+      TU_ASSERT(rndish_send_msg(p_rndis, idx, enum_buf, len, CONFIG_GET_MAC_ADDRESS),);
+      break;
+    }
+
+    case CONFIG_QUERY_LINK: {
+      // MAC address is optional, network still works without it
+      uint8_t const* data;
+      if (rndish_check_cmplt(p_rndis, enum_buf, xfer->actual_len, RNDIS_MSG_QUERY_CMPLT) &&
+          rndish_query_data(enum_buf, xfer->actual_len, &data) >= 6) {
+        memcpy(p_rndis->mac_address, data, 6);
+        p_rndis->has_mac = true;
+      }
+
+      uint16_t const len = rndish_build_oid_msg(p_rndis, enum_buf, RNDIS_MSG_QUERY,
+                                                RNDIS_OID_GEN_MEDIA_CONNECT_STATUS, NULL);
+      TU_ASSERT(rndish_send_msg(p_rndis, idx, enum_buf, len, CONFIG_GET_LINK),);
+      break;
+    }
+
+    case CONFIG_SET_PACKET_FILTER: {
+      // media connect status is 0 when connected, assume connected if device can not tell
+      uint8_t const* data;
+      p_rndis->link_up = true;
+      if (rndish_check_cmplt(p_rndis, enum_buf, xfer->actual_len, RNDIS_MSG_QUERY_CMPLT) &&
+          rndish_query_data(enum_buf, xfer->actual_len, &data) >= 4) {
+        p_rndis->link_up = (tu_le32toh(tu_unaligned_read32(data)) == 0);
+      }
+
+      // device does not forward any packet until filter is set
+      uint32_t const filter = RNDIS_PACKET_TYPE_DIRECTED | RNDIS_PACKET_TYPE_MULTICAST | RNDIS_PACKET_TYPE_BROADCAST;
+      uint16_t const len = rndish_build_oid_msg(p_rndis, enum_buf, RNDIS_MSG_SET,
+                                                RNDIS_OID_GEN_CURRENT_PACKET_FILTER, &filter);
+      TU_ASSERT(rndish_send_msg(p_rndis, idx, enum_buf, len, CONFIG_GET_PACKET_FILTER_CMPLT),);
+      break;
+    }
+
+    case CONFIG_COMPLETE:
+      TU_ASSERT(rndish_check_cmplt(p_rndis, enum_buf, xfer->actual_len, RNDIS_MSG_SET_CMPLT),);
+
+      TU_LOG_DRV("RNDISh Set Configure complete\r\n");
+      p_rndis->mounted = true;
+
+      rndish_notif_arm(p_rndis);
+      rndish_recv_arm(p_rndis);
+
+      if (tuh_rndis_mount_cb) tuh_rndis_mount_cb(idx);
+      if (tuh_network_link_state_cb) tuh_network_link_state_cb(idx, p_rndis->link_up);
+
+      // notify usbh that driver enumeration is complete, data interface as well
+      usbh_driver_set_config_complete(daddr, p_rndis->itf_data);
+      break;
+
+    default:
+      break;
+  }
+}
+
 #endif
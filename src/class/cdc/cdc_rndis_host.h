@@ -31,27 +31,80 @@
 #ifndef _TUSB_CDC_RNDIS_HOST_H_
 #define _TUSB_CDC_RNDIS_HOST_H_
 
-#include "common/tusb_common.h"
-#include "host/usbh.h"
+#include "cdc.h"
 #include "cdc_rndis.h"
+#include "class/net/net_host.h"
 
 #ifdef __cplusplus
  extern "C" {
 #endif
 
 //--------------------------------------------------------------------+
-// INTERNAL RNDIS-CDC Driver API
+// Class Driver Configuration
 //--------------------------------------------------------------------+
-typedef struct {
-  OSAL_SEM_DEF(semaphore_notification);
-  osal_semaphore_handle_t sem_notification_hdl;  // used to wait on notification pipe
-  uint32_t max_xfer_size; // got from device's msg initialize complete
-  uint8_t mac_address[6];
-}rndish_data_t;
 
-void rndish_init(void);
-bool rndish_open_subtask(uint8_t dev_addr, cdch_data_t *p_cdc);
-void rndish_xfer_isr(cdch_data_t *p_cdc, pipe_handle_t pipe_hdl, xfer_result_t event, uint32_t xferred_bytes);
+// Size of each IN transfer buffer, reported to device as max_xfer_size of INITIALIZE message: device can
+// concatenate as many PACKET messages as fit into one transfer
+#ifndef CFG_TUH_RNDIS_IN_XFER_SIZE
+#define CFG_TUH_RNDIS_IN_XFER_SIZE 3200
+#endif
+
+// Number of IN transfer buffers: more than one allows receiving next transfer while packets of previous ones
+// are consumed
+#ifndef CFG_TUH_RNDIS_IN_XFER_N
+#define CFG_TUH_RNDIS_IN_XFER_N 2
+#endif
+
+// Size of each OUT transfer buffer, further limited by max_xfer_size of device
+#ifndef CFG_TUH_RNDIS_OUT_XFER_SIZE
+#define CFG_TUH_RNDIS_OUT_XFER_SIZE 3200
+#endif
+
+// Number of OUT transfer buffers: one is filled with packets while others are queued or on the bus
+#ifndef CFG_TUH_RNDIS_OUT_XFER_N
+#define CFG_TUH_RNDIS_OUT_XFER_N 2
+#endif
+
+// Maximum number of packets per OUT transfer, further limited by max_packet_per_xfer of device
+#ifndef CFG_TUH_RNDIS_MAX_PACKETS_PER_XFER
+#define CFG_TUH_RNDIS_MAX_PACKETS_PER_XFER 8
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + Communication interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_rndis_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Check if a interface is mounted
+bool tuh_rndis_mounted(uint8_t idx);
+
+// Get MAC address of device network interface, queried with OID_802_3_PERMANENT_ADDRESS
+bool tuh_rndis_get_mac_address(uint8_t idx, uint8_t mac[6]);
+
+// Check if device reported its network medium as connected
+bool tuh_rndis_link_is_up(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with RNDIS interface is mounted, network is ready for transfer
+TU_ATTR_WEAK extern void tuh_rndis_mount_cb(uint8_t idx);
+
+// Invoked when a device with RNDIS interface is unmounted
+TU_ATTR_WEAK extern void tuh_rndis_umount_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool rndish_init(void);
+bool rndish_deinit(void);
+bool rndish_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool rndish_set_config(uint8_t dev_addr, uint8_t itf_num);
+bool rndish_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 void rndish_close(uint8_t dev_addr);
 
 #ifdef __cplusplus
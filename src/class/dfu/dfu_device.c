@@ -44,6 +44,39 @@
 
 #define TU_LOG_DRV(...)   TU_LOG(CFG_TUD_DFU_LOG_LEVEL, __VA_ARGS__)
 
+#define DFU_XFER_BUF_N  (CFG_TUD_DFU_DNLOAD_DOUBLE_BUF ? 2 : 1)
+
+// next block or manifestation is started from usbd task when application finishes programming
+#define DFU_START_DEFERRED  (CFG_TUD_DFU_DNLOAD_DOUBLE_BUF || CFG_TUD_DFU_DECOMPRESS)
+
+#if CFG_TUD_DFU_DECOMPRESS
+#define DFU_WINDOW_SIZE  (1u << CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2)
+
+enum {
+  INFLATE_TAG = 0,
+  INFLATE_LITERAL,
+  INFLATE_INDEX,
+  INFLATE_COUNT,
+};
+
+// heatshrink decoder, state is kept so that decoding can stop at any bit of input or byte of output
+typedef struct {
+  uint8_t  state;
+  uint8_t  in_byte;
+  uint8_t  in_mask;   // next bit of in_byte, 0 if a new byte is needed
+  uint8_t  acc_bits;
+  uint16_t acc;
+  uint16_t head;      // next write position of window
+  uint16_t br_index;  // back-reference distance
+  uint16_t br_count;  // remaining bytes of back-reference
+  uint8_t  window[DFU_WINDOW_SIZE];
+} dfu_inflate_t;
+
+TU_VERIFY_STATIC(CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2 >= 4 && CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2 <= 15, "window size is 2^4 to 2^15");
+TU_VERIFY_STATIC(CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_SZ2 >= 3 && CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_SZ2 < CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2, "lookahead size is 2^3 to window size");
+TU_VERIFY_STATIC(CFG_TUD_DFU_DECOMPRESS_BUFSIZE <= UINT16_MAX, "decompress buffer is limited to 64 KiB");
+#endif
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -51,27 +84,227 @@ typedef struct
 {
   uint8_t attrs;
   uint8_t alt;
+  uint16_t transfer_size; // wTransferSize of functional descriptor
 
   dfu_state_t state;
   dfu_status_t status;
 
-  bool flashing_in_progress;
-  uint16_t block;
-  uint16_t length;
+  dfu_state_t getstatus_state; // state replied to GETSTATUS, entered on its ACK
 
-  CFG_TUSB_MEM_ALIGN uint8_t transfer_buf[CFG_TUD_DFU_XFER_BUFSIZE];
+  // Downloaded blocks waiting for or being programmed, in order of buf_rd, buf_rd+1 ...
+  uint8_t buf_rd;
+  uint8_t buf_count;
+  bool manifest_pending; // download complete, manifestation starts once all blocks are programmed
+  bool programming;      // application is busy with tud_dfu_download_cb() or tud_dfu_manifest_cb()
+  bool manifesting;
+
+  uint16_t block[DFU_XFER_BUF_N];
+  uint16_t length[DFU_XFER_BUF_N];
+
+  CFG_TUSB_MEM_ALIGN uint8_t transfer_buf[DFU_XFER_BUF_N][CFG_TUD_DFU_XFER_BUFSIZE];
+
+#if CFG_TUD_DFU_DECOMPRESS
+  uint16_t in_pos;    // decompressed position in block buf_rd
+  uint16_t out_len;   // bytes in out_buf
+  uint16_t out_block; // block_num of out_buf
+  dfu_inflate_t inflate;
+  CFG_TUSB_MEM_ALIGN uint8_t out_buf[CFG_TUD_DFU_DECOMPRESS_BUFSIZE];
+#endif
 } dfu_state_ctx_t;
 
 // Only a single dfu state is allowed
 CFG_TUD_MEM_SECTION tu_static dfu_state_ctx_t _dfu_ctx;
 
+TU_VERIFY_STATIC(CFG_TUD_DFU_XFER_BUFSIZE <= UINT16_MAX, "wTransferSize is limited to 64 KiB");
+
 static void reset_state(void)
 {
   _dfu_ctx.state = DFU_IDLE;
   _dfu_ctx.status = DFU_STATUS_OK;
-  _dfu_ctx.flashing_in_progress = false;
+  _dfu_ctx.buf_rd = 0;
+  _dfu_ctx.buf_count = 0;
+  _dfu_ctx.manifest_pending = false;
+  _dfu_ctx.programming = false;
+  _dfu_ctx.manifesting = false;
+
+  #if CFG_TUD_DFU_DECOMPRESS
+  _dfu_ctx.in_pos = 0;
+  _dfu_ctx.out_len = 0;
+  _dfu_ctx.out_block = 0;
+  tu_memclr(&_dfu_ctx.inflate, sizeof(dfu_inflate_t));
+  #endif
+}
+
+// downloaded block at buf_rd is done with, its buffer is free
+static void release_block(void)
+{
+  if (_dfu_ctx.buf_count)
+  {
+    _dfu_ctx.buf_rd = (uint8_t) ((_dfu_ctx.buf_rd + 1) % DFU_XFER_BUF_N);
+    _dfu_ctx.buf_count--;
+  }
+
+  if (_dfu_ctx.state == DFU_DNBUSY)
+  {
+    _dfu_ctx.state = DFU_DNLOAD_SYNC;
+  }
+}
+
+#if CFG_TUD_DFU_DECOMPRESS
+// Decode input into output until input is consumed or output is full.
+// Return number of output bytes, *in_used is number of input bytes consumed.
+static uint16_t inflate_block(dfu_inflate_t* dec, uint8_t const* in, uint16_t in_len, uint16_t* in_used, uint8_t* out, uint16_t out_len)
+{
+  uint16_t in_n = 0;
+  uint16_t out_n = 0;
+
+  while (out_n < out_len)
+  {
+    if (dec->br_count)
+    {
+      // copy back-reference, bytes before start of stream are zero
+      uint8_t const b = dec->window[(dec->head - dec->br_index) & (DFU_WINDOW_SIZE - 1)];
+      dec->window[dec->head] = b;
+      dec->head = (uint16_t) ((dec->head + 1) & (DFU_WINDOW_SIZE - 1));
+      out[out_n++] = b;
+      dec->br_count--;
+      continue;
+    }
+
+    uint8_t const need = (dec->state == INFLATE_TAG    ) ? 1 :
+                         (dec->state == INFLATE_LITERAL) ? 8 :
+                         (dec->state == INFLATE_INDEX  ) ? CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2 :
+                                                           CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_SZ2;
+
+    // fields are packed MSB first
+    while (dec->acc_bits < need)
+    {
+      if (!dec->in_mask)
+      {
+        if (in_n == in_len)
+        {
+          *in_used = in_n;
+          return out_n;
+        }
+        dec->in_byte = in[in_n++];
+        dec->in_mask = 0x80;
+      }
+
+      dec->acc = (uint16_t) ((dec->acc << 1) | ((dec->in_byte & dec->in_mask) ? 1 : 0));
+      dec->in_mask >>= 1;
+      dec->acc_bits++;
+    }
+
+    uint16_t const value = dec->acc;
+    dec->acc = 0;
+    dec->acc_bits = 0;
+
+    switch (dec->state)
+    {
+      case INFLATE_TAG:
+        dec->state = value ? INFLATE_LITERAL : INFLATE_INDEX;
+      break;
+
+      case INFLATE_LITERAL:
+        dec->window[dec->head] = (uint8_t) value;
+        dec->head = (uint16_t) ((dec->head + 1) & (DFU_WINDOW_SIZE - 1));
+        out[out_n++] = (uint8_t) value;
+        dec->state = INFLATE_TAG;
+      break;
+
+      case INFLATE_INDEX:
+        dec->br_index = (uint16_t) (value + 1);
+        dec->state = INFLATE_COUNT;
+      break;
+
+      default:
+        dec->br_count = (uint16_t) (value + 1);
+        dec->state = INFLATE_TAG;
+      break;
+    }
+  }
+
+  *in_used = in_n;
+  return out_n;
 }
 
+// Decompress queued blocks, program output once a whole block of CFG_TUD_DFU_DECOMPRESS_BUFSIZE is available
+static void start_download(void)
+{
+  while (_dfu_ctx.buf_count)
+  {
+    uint8_t const idx = _dfu_ctx.buf_rd;
+    uint16_t in_used = 0;
+
+    _dfu_ctx.out_len += inflate_block(&_dfu_ctx.inflate,
+                                      _dfu_ctx.transfer_buf[idx] + _dfu_ctx.in_pos, (uint16_t) (_dfu_ctx.length[idx] - _dfu_ctx.in_pos), &in_used,
+                                      _dfu_ctx.out_buf + _dfu_ctx.out_len, (uint16_t) (CFG_TUD_DFU_DECOMPRESS_BUFSIZE - _dfu_ctx.out_len));
+    _dfu_ctx.in_pos += in_used;
+
+    if (_dfu_ctx.out_len == CFG_TUD_DFU_DECOMPRESS_BUFSIZE)
+    {
+      _dfu_ctx.out_len = 0;
+      _dfu_ctx.programming = true;
+      tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.out_block++, _dfu_ctx.out_buf, CFG_TUD_DFU_DECOMPRESS_BUFSIZE);
+      return;
+    }
+
+    // input is consumed, continue with next queued block
+    _dfu_ctx.in_pos = 0;
+    release_block();
+  }
+}
+#else
+static void start_download(void)
+{
+  uint8_t const idx = _dfu_ctx.buf_rd;
+  _dfu_ctx.programming = true;
+  tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block[idx], _dfu_ctx.transfer_buf[idx], _dfu_ctx.length[idx]);
+}
+#endif
+
+static void start_manifest(void)
+{
+  #if CFG_TUD_DFU_DECOMPRESS
+  // program remaining decompressed data first, manifestation is started again once it is done
+  if (_dfu_ctx.out_len)
+  {
+    uint16_t const len = _dfu_ctx.out_len;
+    _dfu_ctx.out_len = 0;
+    _dfu_ctx.programming = true;
+    tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.out_block++, _dfu_ctx.out_buf, len);
+    return;
+  }
+  #endif
+
+  _dfu_ctx.manifest_pending = false;
+  _dfu_ctx.programming = true;
+  _dfu_ctx.manifesting = true;
+  tud_dfu_manifest_cb(_dfu_ctx.alt);
+}
+
+#if DFU_START_DEFERRED
+// Start programming next queued block or manifestation, deferred to usbd task since
+// tud_dfu_finish_flashing() may be called from tud_dfu_download_cb()
+static void start_next_deferred(void* param)
+{
+  (void) param;
+
+  if (_dfu_ctx.programming || _dfu_ctx.state == DFU_ERROR) return;
+
+  if (_dfu_ctx.buf_count)
+  {
+    start_download();
+  }
+
+  // compressed blocks may be consumed without anything to program
+  if (!_dfu_ctx.programming && !_dfu_ctx.buf_count && _dfu_ctx.manifest_pending && _dfu_ctx.state == DFU_MANIFEST)
+  {
+    start_manifest();
+  }
+}
+#endif
+
 static bool reply_getstatus(uint8_t rhport, tusb_control_request_t const * request, dfu_state_t state, dfu_status_t status, uint32_t timeout);
 static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
@@ -156,6 +389,7 @@ void dfu_moded_reset(uint8_t rhport)
 
   _dfu_ctx.attrs = 0;
   _dfu_ctx.alt = 0;
+  _dfu_ctx.transfer_size = 0;
 
   reset_state();
 }
@@ -201,9 +435,14 @@ uint16_t dfu_moded_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc,
 
   _dfu_ctx.attrs = func_desc->bAttributes;
 
-  // CFG_TUD_DFU_XFER_BUFSIZE has to be set to the buffer size used in TUD_DFU_DESCRIPTOR
+  // CFG_TUD_DFU_XFER_BUFSIZE has to be set to the buffer size used in TUD_DFU_DESCRIPTOR.
+  // Upload only function with tud_dfu_upload_zero_copy_cb() does not need a buffer.
   uint16_t const transfer_size = tu_le16toh( tu_unaligned_read16((uint8_t const*) func_desc + offsetof(tusb_desc_dfu_functional_t, wTransferSize)) );
-  TU_ASSERT(transfer_size <= CFG_TUD_DFU_XFER_BUFSIZE, drv_len);
+  if (!tud_dfu_upload_zero_copy_cb || (_dfu_ctx.attrs & DFU_ATTR_CAN_DOWNLOAD))
+  {
+    TU_ASSERT(transfer_size <= CFG_TUD_DFU_XFER_BUFSIZE, drv_len);
+  }
+  _dfu_ctx.transfer_size = transfer_size;
 
   return drv_len;
 }
@@ -292,12 +531,24 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
         if ( stage == CONTROL_STAGE_SETUP )
         {
           TU_VERIFY(_dfu_ctx.attrs & DFU_ATTR_CAN_UPLOAD);
+
+          if ( tud_dfu_upload_zero_copy_cb )
+          {
+            // send directly from application memory e.g memory-mapped flash
+            TU_VERIFY(request->wLength <= _dfu_ctx.transfer_size);
+
+            uint8_t const* data = NULL;
+            uint16_t const xfer_len = tud_dfu_upload_zero_copy_cb(_dfu_ctx.alt, request->wValue, &data, request->wLength);
+
+            return tud_control_xfer(rhport, request, (void*) (uintptr_t) data, xfer_len);
+          }
+
           TU_VERIFY(tud_dfu_upload_cb);
           TU_VERIFY(request->wLength <= CFG_TUD_DFU_XFER_BUFSIZE);
 
-          uint16_t const xfer_len = tud_dfu_upload_cb(_dfu_ctx.alt, request->wValue, _dfu_ctx.transfer_buf, request->wLength);
+          uint16_t const xfer_len = tud_dfu_upload_cb(_dfu_ctx.alt, request->wValue, _dfu_ctx.transfer_buf[0], request->wLength);
 
-          return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, xfer_len);
+          return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf[0], xfer_len);
         }
       break;
 
@@ -308,22 +559,25 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
           TU_VERIFY(_dfu_ctx.state == DFU_IDLE || _dfu_ctx.state == DFU_DNLOAD_IDLE);
           TU_VERIFY(request->wLength <= CFG_TUD_DFU_XFER_BUFSIZE);
 
-          // set to true for both download and manifest
-          _dfu_ctx.flashing_in_progress = true;
-
-          // save block and length for flashing
-          _dfu_ctx.block  = request->wValue;
-          _dfu_ctx.length = request->wLength;
-
           if ( request->wLength )
           {
+            // DNLOAD_IDLE is only reported while a buffer is free
+            TU_VERIFY(_dfu_ctx.buf_count < DFU_XFER_BUF_N);
+
+            // save block and length for flashing
+            uint8_t const idx = (uint8_t) ((_dfu_ctx.buf_rd + _dfu_ctx.buf_count) % DFU_XFER_BUF_N);
+            _dfu_ctx.block[idx]  = request->wValue;
+            _dfu_ctx.length[idx] = request->wLength;
+            _dfu_ctx.buf_count++;
+
             // Download with payload -> transition to DOWNLOAD SYNC
             _dfu_ctx.state = DFU_DNLOAD_SYNC;
-            return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf, request->wLength);
+            return tud_control_xfer(rhport, request, _dfu_ctx.transfer_buf[idx], request->wLength);
           }
           else
           {
             // Download is complete -> transition to MANIFEST SYNC
+            _dfu_ctx.manifest_pending = true;
             _dfu_ctx.state = DFU_MANIFEST_SYNC;
             return tud_control_status(rhport, request);
           }
@@ -359,15 +613,21 @@ bool dfu_moded_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_reque
 
 void tud_dfu_finish_flashing(uint8_t status)
 {
-  _dfu_ctx.flashing_in_progress = false;
+  bool const was_manifesting = _dfu_ctx.manifesting;
+  _dfu_ctx.programming = false;
+  _dfu_ctx.manifesting = false;
 
-  if ( status == DFU_STATUS_OK )
+  if ( status != DFU_STATUS_OK )
   {
-    if (_dfu_ctx.state == DFU_DNBUSY)
-    {
-      _dfu_ctx.state = DFU_DNLOAD_SYNC;
-    }
-    else if (_dfu_ctx.state == DFU_MANIFEST)
+    // failed while flashing, move to dfuError. Queued blocks are dropped
+    _dfu_ctx.state = DFU_ERROR;
+    _dfu_ctx.status = (dfu_status_t)status;
+    _dfu_ctx.buf_count = 0;
+    _dfu_ctx.manifest_pending = false;
+  }
+  else if ( was_manifesting )
+  {
+    if (_dfu_ctx.state == DFU_MANIFEST)
     {
       _dfu_ctx.state = (_dfu_ctx.attrs & DFU_ATTR_MANIFESTATION_TOLERANT)
                                ? DFU_MANIFEST_SYNC : DFU_MANIFEST_WAIT_RESET;
@@ -375,9 +635,19 @@ void tud_dfu_finish_flashing(uint8_t status)
   }
   else
   {
-    // failed while flashing, move to dfuError
-    _dfu_ctx.state = DFU_ERROR;
-    _dfu_ctx.status = (dfu_status_t)status;
+    #if !CFG_TUD_DFU_DECOMPRESS
+    // block is programmed, its buffer is free.
+    // Otherwise buffer is released once its remaining compressed data is decoded
+    release_block();
+    #endif
+
+    #if DFU_START_DEFERRED
+    // keep programming while host sends the next block
+    if (_dfu_ctx.buf_count || _dfu_ctx.manifest_pending)
+    {
+      usbd_defer_func(start_next_deferred, NULL, false);
+    }
+    #endif
   }
 }
 
@@ -386,32 +656,29 @@ static bool process_download_get_status(uint8_t rhport, uint8_t stage, tusb_cont
   if ( stage == CONTROL_STAGE_SETUP )
   {
     // only transition to next state on CONTROL_STAGE_ACK
-    dfu_state_t next_state;
     uint32_t timeout;
 
-    if ( _dfu_ctx.flashing_in_progress )
+    // Host may send next block as soon as a buffer is free, even if received blocks are still being programmed.
+    // Otherwise it waits for bwPollTimeout estimated by application before polling again.
+    if ( _dfu_ctx.buf_count >= DFU_XFER_BUF_N )
     {
-      next_state = DFU_DNBUSY;
-      timeout = tud_dfu_get_timeout_cb(_dfu_ctx.alt, (uint8_t) next_state);
+      _dfu_ctx.getstatus_state = DFU_DNBUSY;
+      timeout = tud_dfu_get_timeout_cb(_dfu_ctx.alt, (uint8_t) DFU_DNBUSY);
     }
     else
     {
-      next_state = DFU_DNLOAD_IDLE;
+      _dfu_ctx.getstatus_state = DFU_DNLOAD_IDLE;
       timeout = 0;
     }
 
-    return reply_getstatus(rhport, request, next_state, _dfu_ctx.status, timeout);
+    return reply_getstatus(rhport, request, _dfu_ctx.getstatus_state, _dfu_ctx.status, timeout);
   }
   else if ( stage == CONTROL_STAGE_ACK )
   {
-    if ( _dfu_ctx.flashing_in_progress )
-    {
-      _dfu_ctx.state = DFU_DNBUSY;
-      tud_dfu_download_cb(_dfu_ctx.alt, _dfu_ctx.block, _dfu_ctx.transfer_buf, _dfu_ctx.length);
-    }else
-    {
-      _dfu_ctx.state = DFU_DNLOAD_IDLE;
-    }
+    _dfu_ctx.state = _dfu_ctx.getstatus_state;
+
+    // program received block unless previous one is still in progress
+    if ( _dfu_ctx.buf_count && !_dfu_ctx.programming ) start_download();
   }
 
   return true;
@@ -422,32 +689,29 @@ static bool process_manifest_get_status(uint8_t rhport, uint8_t stage, tusb_cont
   if ( stage == CONTROL_STAGE_SETUP )
   {
     // only transition to next state on CONTROL_STAGE_ACK
-    dfu_state_t next_state;
     uint32_t timeout;
 
-    if ( _dfu_ctx.flashing_in_progress )
+    if ( _dfu_ctx.manifest_pending || _dfu_ctx.programming )
     {
-      next_state = DFU_MANIFEST;
-      timeout = tud_dfu_get_timeout_cb(_dfu_ctx.alt, next_state);
+      _dfu_ctx.getstatus_state = DFU_MANIFEST;
+      timeout = tud_dfu_get_timeout_cb(_dfu_ctx.alt, DFU_MANIFEST);
     }
     else
     {
-      next_state = DFU_IDLE;
+      _dfu_ctx.getstatus_state = DFU_IDLE;
       timeout = 0;
     }
 
-    return reply_getstatus(rhport, request, next_state, _dfu_ctx.status, timeout);
+    return reply_getstatus(rhport, request, _dfu_ctx.getstatus_state, _dfu_ctx.status, timeout);
   }
   else if ( stage == CONTROL_STAGE_ACK )
   {
-    if ( _dfu_ctx.flashing_in_progress )
-    {
-      _dfu_ctx.state = DFU_MANIFEST;
-      tud_dfu_manifest_cb(_dfu_ctx.alt);
-    }
-    else
+    _dfu_ctx.state = _dfu_ctx.getstatus_state;
+
+    // manifestation waits for blocks still being programmed
+    if ( _dfu_ctx.state == DFU_MANIFEST && _dfu_ctx.manifest_pending && !_dfu_ctx.programming && !_dfu_ctx.buf_count )
     {
-      _dfu_ctx.state = DFU_IDLE;
+      start_manifest();
     }
   }
 
@@ -41,6 +41,36 @@
   #error "CFG_TUD_DFU_XFER_BUFSIZE must be defined, it has to be set to the buffer size used in TUD_DFU_DESCRIPTOR"
 #endif
 
+// Receive next DFU_DNLOAD block into a second CFG_TUD_DFU_XFER_BUFSIZE buffer while the previous one is
+// being programmed. Host is told to send it right away (dfuDNLOAD-IDLE with zero bwPollTimeout) as long as a
+// buffer is free, tud_dfu_get_timeout_cb() is only asked when both are in use.
+// Error of a block is reported with the GETSTATUS of a following one.
+#ifndef CFG_TUD_DFU_DNLOAD_DOUBLE_BUF
+  #define CFG_TUD_DFU_DNLOAD_DOUBLE_BUF 0
+#endif
+
+// Downloaded image is compressed with heatshrink (LZSS) and decompressed on the fly. tud_dfu_download_cb() is
+// invoked with decompressed data in blocks of CFG_TUD_DFU_DECOMPRESS_BUFSIZE (e.g flash page size), block_num
+// counts these blocks. Only the last one, programmed before tud_dfu_manifest_cb(), can be shorter.
+// Window and lookahead size must match the encoder e.g "heatshrink -e -w 8 -l 4".
+#ifndef CFG_TUD_DFU_DECOMPRESS
+  #define CFG_TUD_DFU_DECOMPRESS 0
+#endif
+
+#ifndef CFG_TUD_DFU_DECOMPRESS_BUFSIZE
+  #define CFG_TUD_DFU_DECOMPRESS_BUFSIZE CFG_TUD_DFU_XFER_BUFSIZE
+#endif
+
+// log2 of window size in bytes, window is kept in RAM
+#ifndef CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2
+  #define CFG_TUD_DFU_DECOMPRESS_WINDOW_SZ2 8
+#endif
+
+// log2 of lookahead size, i.e max length of a back-reference
+#ifndef CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_SZ2
+  #define CFG_TUD_DFU_DECOMPRESS_LOOKAHEAD_SZ2 4
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -48,6 +78,8 @@
 // Must be called when the application is done with flashing started by
 // tud_dfu_download_cb() and tud_dfu_manifest_cb().
 // status is DFU_STATUS_OK if successful, any other error status will cause state to enter dfuError
+// With CFG_TUD_DFU_DNLOAD_DOUBLE_BUF or CFG_TUD_DFU_DECOMPRESS, next block is started from usbd task,
+// this must then not be called in ISR context.
 void tud_dfu_finish_flashing(uint8_t status);
 
 //--------------------------------------------------------------------+
@@ -58,6 +90,8 @@ void tud_dfu_finish_flashing(uint8_t status);
 
 // Invoked right before tud_dfu_download_cb() (state=DFU_DNBUSY) or tud_dfu_manifest_cb() (state=DFU_MANIFEST)
 // Application return timeout in milliseconds (bwPollTimeout) for the next download/manifest operation.
+// With CFG_TUD_DFU_DNLOAD_DOUBLE_BUF, DFU_DNBUSY is only asked when both buffers are full: return the
+// estimated time until the block being programmed is done.
 // During this period, USB host won't try to communicate with us.
 uint32_t tud_dfu_get_timeout_cb(uint8_t alt, uint8_t state);
 
@@ -76,6 +110,12 @@ void tud_dfu_manifest_cb(uint8_t alt);
 // Return the number of written bytes
 TU_ATTR_WEAK uint16_t tud_dfu_upload_cb(uint8_t alt, uint16_t block_num, uint8_t* data, uint16_t length);
 
+// Invoked when received DFU_UPLOAD request, used instead of tud_dfu_upload_cb() if implemented.
+// Application points data to up to length bytes (e.g in memory-mapped flash) which stay valid
+// until the transfer is complete, and return the number of bytes. Block can be as large as
+// wTransferSize even if it is bigger than CFG_TUD_DFU_XFER_BUFSIZE.
+TU_ATTR_WEAK uint16_t tud_dfu_upload_zero_copy_cb(uint8_t alt, uint16_t block_num, uint8_t const** data, uint16_t length);
+
 // Invoked when a DFU_DETACH request is received
 TU_ATTR_WEAK void tud_dfu_detach_cb(void);
 
@@ -39,19 +39,56 @@
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+// IN report waiting for the endpoint
 typedef struct {
+  uint16_t len;
+  uint8_t  report_id;
+  uint8_t  data[CFG_TUD_HID_EP_BUFSIZE]; // including report ID
+} hidd_report_t;
+
+TU_VERIFY_STATIC(CFG_TUD_HID_REPORT_QUEUE_SIZE < 128, "report queue too large");
+TU_VERIFY_STATIC(sizeof(hidd_report_t) == TUD_HID_REPORT_ENTRY_SZ, "TUD_HID_BUF_POOL_SZ is incorrect");
+#endif
+
+typedef struct {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;       // optional Out endpoint
   uint8_t itf_protocol; // Boot mouse or keyboard
 
   uint16_t report_desc_len;
+#if CFG_TUD_HID_SOF_PREPARE
+  uint16_t sof_interval;  // polling interval of IN endpoint in SOF periods
+  volatile uint16_t sof_countdown; // SOF periods until tud_hid_report_prepare_cb()
+#endif
+
   CFG_TUSB_MEM_ALIGN uint8_t protocol_mode; // Boot (0) or Report protocol (1)
   CFG_TUSB_MEM_ALIGN uint8_t idle_rate;     // up to application to handle idle rate
 
+#if CFG_TUD_BUF_POOL_ENABLED
+  // taken from usbd buffer pool in hidd_open()
+  uint8_t* epin_buf;
+  uint8_t* epout_buf;
+  uint8_t* ctrl_buf;
+#else
   CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_HID_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_HID_EP_BUFSIZE];
   CFG_TUSB_MEM_ALIGN uint8_t ctrl_buf[CFG_TUD_HID_EP_BUFSIZE];
+#endif
+
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+  #if CFG_TUD_BUF_POOL_ENABLED
+  hidd_report_t* report_queue; // taken from usbd buffer pool in hidd_open()
+  #else
+  hidd_report_t report_queue[CFG_TUD_HID_REPORT_QUEUE_SIZE];
+  #endif
+  volatile uint8_t queue_wr;  // free-running count of queued reports, only changed by tud_hid_n_report()
+  volatile uint8_t queue_rd;  // free-running count of sent reports, only changed while holding the endpoint claim
+  volatile uint8_t queue_seq; // odd while a queued report is being replaced
+  volatile bool queue_deferred; // sending queued reports is deferred to usbd task by tud_hid_n_report_from_isr()
+#endif
 
   // TODO save hid descriptor since host can specifically request this after enumeration
   // Note: HID descriptor may be not available from application after enumeration
@@ -71,21 +108,121 @@ static inline uint8_t get_index_by_itfnum(uint8_t itf_num)
   return 0xFF;
 }
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+// Send the oldest queued report if endpoint is free
+static bool queue_xfer(uint8_t rhport, hidd_interface_t *p_hid)
+{
+  for (;;) {
+    // the other context is sending
+    if (!usbd_edpt_claim(rhport, p_hid->ep_in)) return true;
+
+    if (p_hid->queue_rd == p_hid->queue_wr) {
+      usbd_edpt_release(rhport, p_hid->ep_in);
+      return true;
+    }
+
+    uint8_t const seq = p_hid->queue_seq;
+    hidd_report_t const *entry = &p_hid->report_queue[p_hid->queue_rd % CFG_TUD_HID_REPORT_QUEUE_SIZE];
+    uint16_t const len = entry->len;
+    if (!(seq & 1)) memcpy(p_hid->epin_buf, entry->data, len);
+
+    if ((seq & 1) || seq != p_hid->queue_seq) {
+      // report is being replaced: retry once replacement is done, or leave it to tud_hid_n_report()
+      usbd_edpt_release(rhport, p_hid->ep_in);
+      if (p_hid->queue_seq & 1) return true;
+      continue;
+    }
+
+    p_hid->queue_rd++;
+    return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
+  }
+}
+
+static void _queue_xfer_deferred(void *param)
+{
+  hidd_interface_t *p_hid = &_hidd_itf[(uint8_t) (uintptr_t) param];
+  p_hid->queue_deferred = false;
+  queue_xfer(p_hid->rhport, p_hid);
+}
+
+static bool queue_report(uint8_t rhport, hidd_interface_t *p_hid, uint8_t report_id, void const *report, uint16_t len,
+                         bool in_isr)
+{
+  TU_VERIFY(tud_ready() && p_hid->ep_in);
+  uint16_t const total_len = (uint16_t) (len + (report_id ? 1 : 0));
+  TU_VERIFY(total_len <= CFG_TUD_HID_EP_BUFSIZE);
+
+  hidd_report_t *entry = NULL;
+
+#if CFG_TUD_HID_REPORT_QUEUE_COALESCE
+  // replace the queued report with same ID, sending side skips it meanwhile
+  p_hid->queue_seq++;
+  for (uint8_t i = p_hid->queue_rd; i != p_hid->queue_wr; i++) {
+    hidd_report_t *cur = &p_hid->report_queue[i % CFG_TUD_HID_REPORT_QUEUE_SIZE];
+    if (cur->report_id == report_id) entry = cur;
+  }
+  if (!entry) p_hid->queue_seq++;
+#endif
+
+  bool const append = (entry == NULL);
+  if (append) {
+    if ((uint8_t) (p_hid->queue_wr - p_hid->queue_rd) >= CFG_TUD_HID_REPORT_QUEUE_SIZE) return false;
+    entry = &p_hid->report_queue[p_hid->queue_wr % CFG_TUD_HID_REPORT_QUEUE_SIZE];
+  }
+
+  entry->report_id = report_id;
+  entry->len       = total_len;
+  if (report_id) {
+    entry->data[0] = report_id;
+    memcpy(entry->data + 1, report, len);
+  } else {
+    memcpy(entry->data, report, len);
+  }
+
+  if (append) {
+    p_hid->queue_wr++;
+  } else {
+    p_hid->queue_seq++;
+  }
+
+  if (in_isr) {
+    // endpoint can not be claimed in ISR, send from usbd task
+    if (!p_hid->queue_deferred) {
+      p_hid->queue_deferred = true;
+      usbd_defer_func(_queue_xfer_deferred, (void *) (uintptr_t) (p_hid - _hidd_itf), true);
+    }
+    return true;
+  }
+
+  return queue_xfer(rhport, p_hid);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
 bool tud_hid_n_ready(uint8_t instance)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _hidd_itf[instance].rhport;
   uint8_t const ep_in = _hidd_itf[instance].ep_in;
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+  (void) rhport;
+  hidd_interface_t const *p_hid = &_hidd_itf[instance];
+  return tud_ready() && (ep_in != 0) &&
+         ((uint8_t) (p_hid->queue_wr - p_hid->queue_rd) < CFG_TUD_HID_REPORT_QUEUE_SIZE);
+#else
   return tud_ready() && (ep_in != 0) && !usbd_edpt_busy(rhport, ep_in);
+#endif
 }
 
 bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
 {
-  uint8_t const rhport = 0;
   hidd_interface_t *p_hid = &_hidd_itf[instance];
+  uint8_t const rhport = p_hid->rhport;
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+  return queue_report(rhport, p_hid, report_id, report, len, false);
+#else
   // claim endpoint
   TU_VERIFY(usbd_edpt_claim(rhport, p_hid->ep_in));
 
@@ -99,7 +236,16 @@ bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const *report, u
   }
 
   return usbd_edpt_xfer(rhport, p_hid->ep_in, p_hid->epin_buf, len);
+#endif
+}
+
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+bool tud_hid_n_report_from_isr(uint8_t instance, uint8_t report_id, void const *report, uint16_t len)
+{
+  hidd_interface_t *p_hid = &_hidd_itf[instance];
+  return queue_report(p_hid->rhport, p_hid, report_id, report, len, true);
 }
+#endif
 
 uint8_t tud_hid_n_interface_protocol(uint8_t instance) { return _hidd_itf[instance].itf_protocol; }
 
@@ -200,6 +346,17 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16
   }
   TU_ASSERT(p_hid, 0);
 
+#if CFG_TUD_BUF_POOL_ENABLED
+  p_hid->epin_buf = (uint8_t*) usbd_buf_alloc(CFG_TUD_HID_EP_BUFSIZE);
+  p_hid->ctrl_buf = (uint8_t*) usbd_buf_alloc(CFG_TUD_HID_EP_BUFSIZE);
+  TU_ASSERT(p_hid->epin_buf && p_hid->ctrl_buf, 0);
+
+  #if CFG_TUD_HID_REPORT_QUEUE_SIZE
+  p_hid->report_queue = (hidd_report_t*) usbd_buf_alloc(CFG_TUD_HID_REPORT_QUEUE_SIZE * sizeof(hidd_report_t));
+  TU_ASSERT(p_hid->report_queue, 0);
+  #endif
+#endif
+
   uint8_t const *p_desc = (uint8_t const *)desc_itf;
 
   //------------- HID descriptor -------------//
@@ -211,10 +368,28 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16
   p_desc = tu_desc_next(p_desc);
   TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in), 0);
 
+#if CFG_TUD_HID_SOF_PREPARE
+  if (tud_hid_report_prepare_cb) {
+    uint8_t const *p_ep = p_desc;
+    for (uint8_t i = 0; i < desc_itf->bNumEndpoints; i++, p_ep = tu_desc_next(p_ep)) {
+      tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *)p_ep;
+      if (desc_ep->bEndpointAddress != p_hid->ep_in) continue;
+
+      // interval in frames at full speed, 2^(bInterval-1) microframes at high speed
+      uint8_t const interval = tu_max8(desc_ep->bInterval, 1);
+      p_hid->sof_interval = (tud_speed_get() == TUSB_SPEED_HIGH) ? (uint16_t) (1u << tu_min8(interval - 1, 15))
+                                                                 : interval;
+      p_hid->sof_countdown = p_hid->sof_interval;
+      usbd_sof_subscribe(rhport, hidd_sof, 1);
+    }
+  }
+#endif
+
   if (desc_itf->bInterfaceSubClass == HID_SUBCLASS_BOOT)
     p_hid->itf_protocol = desc_itf->bInterfaceProtocol;
 
   p_hid->protocol_mode = HID_PROTOCOL_REPORT; // Per Specs: default is report mode
+  p_hid->rhport  = rhport;
   p_hid->itf_num = desc_itf->bInterfaceNumber;
 
   // Use offsetof to avoid pointer to the odd/misaligned address
@@ -222,7 +397,11 @@ uint16_t hidd_open(uint8_t rhport, tusb_desc_interface_t const *desc_itf, uint16
 
   // Prepare for output endpoint
   if (p_hid->ep_out) {
-    if (!usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf))) {
+#if CFG_TUD_BUF_POOL_ENABLED
+    p_hid->epout_buf = (uint8_t*) usbd_buf_alloc(CFG_TUD_HID_EP_BUFSIZE);
+    TU_ASSERT(p_hid->epout_buf, 0);
+#endif
+    if (!usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, CFG_TUD_HID_EP_BUFSIZE)) {
       TU_LOG_FAILED();
       TU_BREAKPOINT();
     }
@@ -289,7 +468,7 @@ bool hidd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
 
     case HID_REQ_CONTROL_SET_REPORT:
       if (stage == CONTROL_STAGE_SETUP) {
-        TU_VERIFY(request->wLength <= sizeof(p_hid->ctrl_buf));
+        TU_VERIFY(request->wLength <= CFG_TUD_HID_EP_BUFSIZE);
         tud_control_xfer(rhport, request, p_hid->ctrl_buf, request->wLength);
       } else if (stage == CONTROL_STAGE_ACK) {
         uint8_t const report_type = tu_u16_high(request->wValue);
@@ -378,7 +557,7 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     // Allow a new transfer to be received if issue happened on an OUT endpoint
     if (ep_addr == p_hid->ep_out) {
       // Prepare the OUT endpoint to be able to receive a new transfer
-      TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
+      TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, CFG_TUD_HID_EP_BUFSIZE));
     }
 
     return true;
@@ -389,14 +568,54 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     if (tud_hid_report_complete_cb) {
       tud_hid_report_complete_cb(instance, p_hid->epin_buf, (uint16_t)xferred_bytes);
     }
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+    // send next queued report
+    TU_ASSERT(queue_xfer(rhport, p_hid));
+#endif
+#if CFG_TUD_HID_SOF_PREPARE
+    // host polled just now, next poll is one interval later
+    if (p_hid->sof_interval) {
+      p_hid->sof_countdown = (p_hid->sof_interval > CFG_TUD_HID_SOF_PREPARE_LEAD) ?
+                             (uint16_t) (p_hid->sof_interval - CFG_TUD_HID_SOF_PREPARE_LEAD) : 1;
+    }
+#endif
   }
   // Received report successfully
   else if (ep_addr == p_hid->ep_out) {
     tud_hid_set_report_cb(instance, 0, HID_REPORT_TYPE_OUTPUT, p_hid->epout_buf, (uint16_t)xferred_bytes);
-    TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
+    TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, CFG_TUD_HID_EP_BUFSIZE));
   }
 
   return true;
 }
 
+#if CFG_TUD_HID_SOF_PREPARE
+static void _report_prepare_deferred(void *param)
+{
+  tud_hid_report_prepare_cb((uint8_t) (uintptr_t) param);
+}
+
+// Invoked in ISR context
+void hidd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  for (uint8_t instance = 0; instance < CFG_TUD_HID; instance++) {
+    hidd_interface_t *p_hid = &_hidd_itf[instance];
+    uint16_t const remain = p_hid->sof_countdown;
+    if (!remain) continue;
+
+    if (remain > 1) {
+      p_hid->sof_countdown = (uint16_t) (remain - 1);
+      continue;
+    }
+
+    // keep preparing every interval, re-synchronized by IN completion
+    p_hid->sof_countdown = p_hid->sof_interval;
+    usbd_defer_func(_report_prepare_deferred, (void *) (uintptr_t) instance, true);
+  }
+}
+#endif
+
 #endif
@@ -47,12 +47,43 @@
   #define CFG_TUD_HID_EP_BUFSIZE     64
 #endif
 
+// Number of IN reports which can be queued while the endpoint is busy, they are sent on the next IN completions.
+// 0 means tud_hid_n_report() fails while a report is being sent.
+#ifndef CFG_TUD_HID_REPORT_QUEUE_SIZE
+  #define CFG_TUD_HID_REPORT_QUEUE_SIZE  0
+#endif
+
+// Worst case bytes an interface takes from buffer pool (CFG_TUD_BUF_POOL_ENABLED): IN, OUT, control buffer and
+// report queue, whose entries hold length, report ID and data
+#define TUD_HID_REPORT_ENTRY_SZ  ((CFG_TUD_HID_EP_BUFSIZE + 4) & ~1u)
+#define TUD_HID_BUF_POOL_SZ \
+  (3*TUD_BUF_POOL_ALLOC_SZ(CFG_TUD_HID_EP_BUFSIZE) + \
+   (CFG_TUD_HID_REPORT_QUEUE_SIZE ? TUD_BUF_POOL_ALLOC_SZ(CFG_TUD_HID_REPORT_QUEUE_SIZE*TUD_HID_REPORT_ENTRY_SZ) : 0))
+
+// Replace a queued report which has the same report ID instead of queuing another one, so that only the latest
+// state is sent. Not suitable for reports carrying relative values e.g mouse movement.
+#ifndef CFG_TUD_HID_REPORT_QUEUE_COALESCE
+  #define CFG_TUD_HID_REPORT_QUEUE_COALESCE  0
+#endif
+
+// Invoke tud_hid_report_prepare_cb() shortly before the host is expected to poll the IN endpoint, using SOF and
+// bInterval. The poll phase is learned from IN completions.
+#ifndef CFG_TUD_HID_SOF_PREPARE
+  #define CFG_TUD_HID_SOF_PREPARE    0
+#endif
+
+// Lead time of tud_hid_report_prepare_cb() before the expected poll, in SOF periods (frames at full speed,
+// microframes at high speed). Should cover sampling time plus usbd task latency.
+#ifndef CFG_TUD_HID_SOF_PREPARE_LEAD
+  #define CFG_TUD_HID_SOF_PREPARE_LEAD  1
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Instances)
 // CFG_TUD_HID > 1
 //--------------------------------------------------------------------+
 
-// Check if the interface is ready to use
+// Check if the interface is ready to use i.e a report can be sent (or queued)
 bool tud_hid_n_ready(uint8_t instance);
 
 // Get interface supported protocol (bInterfaceProtocol) check out hid_interface_protocol_enum_t for possible values
@@ -61,9 +92,14 @@ uint8_t tud_hid_n_interface_protocol(uint8_t instance);
 // Get current active protocol: HID_PROTOCOL_BOOT (0) or HID_PROTOCOL_REPORT (1)
 uint8_t tud_hid_n_get_protocol(uint8_t instance);
 
-// Send report to host
+// Send report to host. With CFG_TUD_HID_REPORT_QUEUE_SIZE the report is queued if endpoint is busy.
 bool tud_hid_n_report(uint8_t instance, uint8_t report_id, void const* report, uint16_t len);
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+// Queue report from ISR, it is sent from usbd task. ISR must be the only one sending reports on this instance.
+bool tud_hid_n_report_from_isr(uint8_t instance, uint8_t report_id, void const* report, uint16_t len);
+#endif
+
 // KEYBOARD: convenient helper to send keyboard report if application
 // use template layout report as defined by hid_keyboard_report_t
 bool tud_hid_n_keyboard_report(uint8_t instance, uint8_t report_id, uint8_t modifier, uint8_t keycode[6]);
@@ -131,6 +167,10 @@ TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* re
 // Invoked when a transfer wasn't successful
 TU_ATTR_WEAK void tud_hid_report_fail_cb(uint8_t instance, uint8_t ep_addr, uint16_t len);
 
+// Invoked CFG_TUD_HID_SOF_PREPARE_LEAD SOF periods before host is expected to poll IN endpoint (CFG_TUD_HID_SOF_PREPARE).
+// Application can sample its input and send the report now.
+TU_ATTR_WEAK void tud_hid_report_prepare_cb(uint8_t instance);
+
 //--------------------------------------------------------------------+
 // Inline Functions
 //--------------------------------------------------------------------+
@@ -154,6 +194,13 @@ static inline bool tud_hid_report(uint8_t report_id, void const* report, uint16_
   return tud_hid_n_report(0, report_id, report, len);
 }
 
+#if CFG_TUD_HID_REPORT_QUEUE_SIZE
+static inline bool tud_hid_report_from_isr(uint8_t report_id, void const* report, uint16_t len)
+{
+  return tud_hid_n_report_from_isr(0, report_id, report, len);
+}
+#endif
+
 static inline bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, uint8_t keycode[6])
 {
   return tud_hid_n_keyboard_report(0, report_id, modifier, keycode);
@@ -472,6 +519,7 @@ void     hidd_reset           (uint8_t rhport);
 uint16_t hidd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     hidd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     hidd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void     hidd_sof             (uint8_t rhport, uint32_t frame_count);
 
 
 #ifdef __cplusplus
@@ -43,6 +43,12 @@
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
+
+// wrapper to keep every IN buffer aligned
+typedef struct {
+  CFG_TUH_MEM_ALIGN uint8_t buf[CFG_TUH_HID_EPIN_BUFSIZE];
+} hidh_epin_buf_t;
+
 typedef struct {
   uint8_t daddr;
 
@@ -60,8 +66,16 @@ typedef struct {
   uint16_t epin_size;
   uint16_t epout_size;
 
-  CFG_TUH_MEM_ALIGN uint8_t epin_buf[CFG_TUH_HID_EPIN_BUFSIZE];
+  uint8_t epin_idx;       // IN buffer of the next/current transfer
+  bool rx_continuous;     // re-arm IN endpoint on completion (CFG_TUH_HID_EPIN_BUF_COUNT > 1)
+
+  hidh_epin_buf_t epin_buf[CFG_TUH_HID_EPIN_BUF_COUNT];
   CFG_TUH_MEM_ALIGN uint8_t epout_buf[CFG_TUH_HID_EPOUT_BUFSIZE];
+
+#if CFG_TUH_HID_FIELD_MAX
+  uint8_t field_count;
+  tuh_hid_field_t fields[CFG_TUH_HID_FIELD_MAX];
+#endif
 } hidh_interface_t;
 
 CFG_TUH_MEM_SECTION
@@ -354,19 +368,24 @@ bool tuh_hid_receive_report(uint8_t daddr, uint8_t idx) {
   hidh_interface_t* p_hid = get_hid_itf(daddr, idx);
   TU_VERIFY(p_hid);
 
+  // already receiving continuously
+  if (p_hid->rx_continuous) return true;
+
   // claim endpoint
   TU_VERIFY(usbh_edpt_claim(daddr, p_hid->ep_in));
 
-  if (!usbh_edpt_xfer(daddr, p_hid->ep_in, p_hid->epin_buf, p_hid->epin_size)) {
+  if (!usbh_edpt_xfer(daddr, p_hid->ep_in, p_hid->epin_buf[p_hid->epin_idx].buf, p_hid->epin_size)) {
     usbh_edpt_release(daddr, p_hid->ep_in);
     return false;
   }
 
+  p_hid->rx_continuous = (CFG_TUH_HID_EPIN_BUF_COUNT > 1);
   return true;
 }
 bool tuh_hid_receive_abort(uint8_t dev_addr, uint8_t idx) {
   hidh_interface_t* p_hid = get_hid_itf(dev_addr, idx);
   TU_VERIFY(p_hid);
+  p_hid->rx_continuous = false;
   return tuh_edpt_abort_xfer(dev_addr, p_hid->ep_in);
 }
 
@@ -436,9 +455,26 @@ bool hidh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t
   TU_VERIFY(p_hid);
 
   if (dir == TUSB_DIR_IN) {
+    uint8_t const* report = p_hid->epin_buf[p_hid->epin_idx].buf;
+
+#if CFG_TUH_HID_EPIN_BUF_COUNT > 1
+    // re-arm with next buffer before application handles this report
+    if (p_hid->rx_continuous) {
+      p_hid->epin_idx = (uint8_t) ((p_hid->epin_idx + 1) % CFG_TUH_HID_EPIN_BUF_COUNT);
+      p_hid->rx_continuous = false;
+      if (result == XFER_RESULT_SUCCESS && usbh_edpt_claim(daddr, p_hid->ep_in)) {
+        if (usbh_edpt_xfer(daddr, p_hid->ep_in, p_hid->epin_buf[p_hid->epin_idx].buf, p_hid->epin_size)) {
+          p_hid->rx_continuous = true;
+        } else {
+          usbh_edpt_release(daddr, p_hid->ep_in);
+        }
+      }
+    }
+#endif
+
     TU_LOG_DRV("  Get Report callback (%u, %u)\r\n", daddr, idx);
-    TU_LOG3_MEM(p_hid->epin_buf, xferred_bytes, 2);
-    tuh_hid_report_received_cb(daddr, idx, p_hid->epin_buf, (uint16_t) xferred_bytes);
+    TU_LOG3_MEM(report, xferred_bytes, 2);
+    tuh_hid_report_received_cb(daddr, idx, report, (uint16_t) xferred_bytes);
   } else {
     if (tuh_hid_report_sent_cb) {
       tuh_hid_report_sent_cb(daddr, idx, p_hid->epout_buf, (uint16_t) xferred_bytes);
@@ -590,13 +626,13 @@ static void process_set_config(tuh_xfer_t* xfer) {
         config_driver_mount_complete(daddr, idx, NULL, 0);
       } else {
         tuh_descriptor_get_hid_report(daddr, itf_num, p_hid->report_desc_type, 0,
-                                      usbh_get_enum_buf(), p_hid->report_desc_len,
+                                      usbh_get_enum_buf(daddr), p_hid->report_desc_len,
                                       process_set_config, CONFIG_COMPLETE);
       }
       break;
 
     case CONFIG_COMPLETE: {
-      uint8_t const* desc_report = usbh_get_enum_buf();
+      uint8_t const* desc_report = usbh_get_enum_buf(daddr);
       uint16_t const desc_len = tu_le16toh(xfer->setup->wLength);
 
       config_driver_mount_complete(daddr, idx, desc_report, desc_len);
@@ -613,6 +649,11 @@ static void config_driver_mount_complete(uint8_t daddr, uint8_t idx, uint8_t con
   TU_VERIFY(p_hid,);
   p_hid->mounted = true;
 
+#if CFG_TUH_HID_FIELD_MAX
+  // parse once, reports are then decoded with cached field table
+  p_hid->field_count = desc_report ? tuh_hid_parse_report_fields(p_hid->fields, CFG_TUH_HID_FIELD_MAX, desc_report, desc_len) : 0;
+#endif
+
   // enumeration is complete
   if (tuh_hid_mount_cb) tuh_hid_mount_cb(daddr, idx, desc_report, desc_len);
 
@@ -751,4 +792,280 @@ uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr,
   return report_num;
 }
 
+//--------------------------------------------------------------------+
+// Report Field Parser
+//--------------------------------------------------------------------+
+
+// sizes of parser state, items beyond these limits are ignored
+#define HIDH_PARSER_USAGE_MAX     16 // usages of a main item
+#define HIDH_PARSER_REPORT_MAX    16 // report ID and type combinations
+#define HIDH_PARSER_STACK_DEPTH   2  // PUSH/POP
+
+typedef struct {
+  uint16_t usage_page;
+  uint8_t  report_id;
+  uint8_t  report_size;
+  uint16_t report_count;
+  int32_t  logical_min;
+  int32_t  logical_max;
+  uint8_t  logical_max_size;
+} hidh_parser_global_t;
+
+// read item data as unsigned
+static uint32_t item_udata(uint8_t const* data, uint8_t size) {
+  switch (size) {
+    case 1: return data[0];
+    case 2: return tu_unaligned_read16(data);
+    case 4: return tu_unaligned_read32(data);
+    default: return 0;
+  }
+}
+
+// read item data as signed
+static int32_t item_sdata(uint8_t const* data, uint8_t size) {
+  switch (size) {
+    case 1: return (int8_t) data[0];
+    case 2: return (int16_t) tu_unaligned_read16(data);
+    case 4: return (int32_t) tu_unaligned_read32(data);
+    default: return 0;
+  }
+}
+
+// bit offset of the next field of a report
+static uint16_t* report_bit_offset(uint8_t (*ids)[2], uint16_t* bits, uint8_t* count, uint8_t report_id, uint8_t type) {
+  for (uint8_t i = 0; i < *count; i++) {
+    if (ids[i][0] == report_id && ids[i][1] == type) return &bits[i];
+  }
+  TU_VERIFY(*count < HIDH_PARSER_REPORT_MAX, NULL);
+  ids[*count][0] = report_id;
+  ids[*count][1] = type;
+  bits[*count] = report_id ? 8 : 0;
+  return &bits[(*count)++];
+}
+
+uint8_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint8_t max_fields,
+                                    uint8_t const* desc_report, uint16_t desc_len) {
+  hidh_parser_global_t global = { 0 };
+  hidh_parser_global_t stack[HIDH_PARSER_STACK_DEPTH];
+  uint8_t stack_depth = 0;
+
+  // local items, extended (4 byte) usage carries its page in high 16 bits
+  uint32_t usages[HIDH_PARSER_USAGE_MAX];
+  uint8_t  usage_num = 0;
+  uint32_t usage_min = 0, usage_max = 0;
+  bool     has_range = false;
+
+  uint8_t  report_ids[HIDH_PARSER_REPORT_MAX][2];
+  uint16_t report_bits[HIDH_PARSER_REPORT_MAX];
+  uint8_t  report_num = 0;
+
+  uint8_t field_num = 0;
+
+  while (desc_len) {
+    uint8_t const header = *desc_report++;
+    desc_len--;
+
+    // long item: skip
+    if (header == 0xFE) {
+      TU_VERIFY(desc_len >= 2, field_num);
+      uint16_t const skip = (uint16_t) (2 + desc_report[0]);
+      if (skip > desc_len) break;
+      desc_report += skip;
+      desc_len -= skip;
+      continue;
+    }
+
+    uint8_t const size = (uint8_t) ((header & 0x03) == 3 ? 4 : (header & 0x03));
+    uint8_t const type = (header >> 2) & 0x03;
+    uint8_t const tag = header >> 4;
+    if (size > desc_len) break;
+
+    uint32_t const udata = item_udata(desc_report, size);
+
+    switch (type) {
+      case RI_TYPE_MAIN:
+        if (tag == RI_MAIN_INPUT || tag == RI_MAIN_OUTPUT || tag == RI_MAIN_FEATURE) {
+          uint8_t const report_type = (tag == RI_MAIN_INPUT) ? HID_REPORT_TYPE_INPUT :
+                                      (tag == RI_MAIN_OUTPUT) ? HID_REPORT_TYPE_OUTPUT : HID_REPORT_TYPE_FEATURE;
+          uint16_t* bit_offset = report_bit_offset(report_ids, report_bits, &report_num, global.report_id, report_type);
+          uint32_t const total_bits = (uint32_t) global.report_size * global.report_count;
+          uint8_t const flags = (uint8_t) udata;
+          bool const variable = (flags & 0x02) != 0;
+
+          if (bit_offset && (usage_num || has_range) && global.report_size && global.report_size <= 32) {
+            tuh_hid_field_t tmpl = {
+              .bit_offset  = *bit_offset,
+              .bit_size    = global.report_size,
+              .count       = (uint8_t) tu_min16(global.report_count, UINT8_MAX),
+              .report_id   = global.report_id,
+              .report_type = report_type,
+              .flags       = flags,
+              .logical_min = global.logical_min,
+              // logical maximum data is unsigned if values are unsigned e.g 0xFF for 255
+              .logical_max = (global.logical_min >= 0 && global.logical_max_size < 4) ?
+                             (int32_t) (((uint32_t) global.logical_max) & ((1ul << (8 * global.logical_max_size)) - 1)) :
+                             global.logical_max
+            };
+
+            if (has_range || !variable) {
+              // one field: range of usages, or array with usage values
+              uint32_t const first = has_range ? usage_min : usages[0];
+              uint32_t const last = has_range ? usage_max : usages[usage_num - 1];
+              if (field_num < max_fields) {
+                tuh_hid_field_t* field = &fields[field_num++];
+                *field = tmpl;
+                field->usage_page = (first >> 16) ? (uint16_t) (first >> 16) : global.usage_page;
+                field->usage      = (uint16_t) first;
+                field->usage_max  = (uint16_t) last;
+              }
+            } else {
+              // variable with usage list: one field per usage, last usage applies to the remaining elements
+              uint16_t element = 0;
+              for (uint8_t i = 0; i < usage_num && element < tmpl.count && field_num < max_fields; i++) {
+                tuh_hid_field_t* field = &fields[field_num++];
+                *field = tmpl;
+                field->usage_page = (usages[i] >> 16) ? (uint16_t) (usages[i] >> 16) : global.usage_page;
+                field->usage      = (uint16_t) usages[i];
+                field->usage_max  = (uint16_t) usages[i];
+                field->bit_offset = (uint16_t) (tmpl.bit_offset + element * tmpl.bit_size);
+                field->count      = (uint8_t) ((i == usage_num - 1) ? (tmpl.count - element) : 1);
+                element = (uint16_t) (element + field->count);
+              }
+            }
+          }
+
+          if (bit_offset) *bit_offset = (uint16_t) (*bit_offset + total_bits);
+        }
+
+        // local items only apply to next main item
+        usage_num = 0;
+        has_range = false;
+        break;
+
+      case RI_TYPE_GLOBAL:
+        switch (tag) {
+          case RI_GLOBAL_USAGE_PAGE: global.usage_page = (uint16_t) udata; break;
+          case RI_GLOBAL_LOGICAL_MIN: global.logical_min = item_sdata(desc_report, size); break;
+          case RI_GLOBAL_LOGICAL_MAX:
+            global.logical_max = item_sdata(desc_report, size);
+            global.logical_max_size = size;
+            break;
+          case RI_GLOBAL_REPORT_SIZE: global.report_size = (uint8_t) udata; break;
+          case RI_GLOBAL_REPORT_ID: global.report_id = (uint8_t) udata; break;
+          case RI_GLOBAL_REPORT_COUNT: global.report_count = (uint16_t) udata; break;
+
+          case RI_GLOBAL_PUSH:
+            if (stack_depth < HIDH_PARSER_STACK_DEPTH) stack[stack_depth++] = global;
+            break;
+
+          case RI_GLOBAL_POP:
+            if (stack_depth) global = stack[--stack_depth];
+            break;
+
+          default: break;
+        }
+        break;
+
+      case RI_TYPE_LOCAL: {
+        uint32_t const usage = (size == 4) ? udata : (udata & 0xFFFFu);
+        switch (tag) {
+          case RI_LOCAL_USAGE:
+            if (usage_num < HIDH_PARSER_USAGE_MAX) usages[usage_num++] = usage;
+            break;
+
+          case RI_LOCAL_USAGE_MIN:
+            usage_min = usage;
+            has_range = true;
+            break;
+
+          case RI_LOCAL_USAGE_MAX:
+            usage_max = usage;
+            has_range = true;
+            break;
+
+          default: break;
+        }
+        break;
+      }
+
+      default: break;
+    }
+
+    desc_report += size;
+    desc_len = (uint16_t) (desc_len - size);
+  }
+
+  for (uint8_t i = 0; i < field_num; i++) {
+    TU_LOG_DRV("%u: id = %u, type = %u, usage = %04X:%04X-%04X, offset = %u, size = %u x %u\r\n", i,
+               fields[i].report_id, fields[i].report_type, fields[i].usage_page, fields[i].usage, fields[i].usage_max,
+               fields[i].bit_offset, fields[i].bit_size, fields[i].count);
+  }
+
+  return field_num;
+}
+
+bool tuh_hid_field_extract(tuh_hid_field_t const* field, uint8_t const* report, uint16_t len, uint8_t element,
+                           int32_t* value) {
+  TU_VERIFY(element < field->count);
+  if (field->report_id) {
+    TU_VERIFY(len && report[0] == field->report_id);
+  }
+
+  uint32_t const bit_pos = (uint32_t) field->bit_offset + (uint32_t) element * field->bit_size;
+  uint8_t const size = field->bit_size;
+  TU_VERIFY(bit_pos + size <= 8u * len);
+
+  // gather up to 5 bytes covering the element
+  uint8_t const* p = report + bit_pos / 8;
+  uint8_t const shift = bit_pos % 8;
+  uint8_t const nbytes = (uint8_t) ((shift + size + 7) / 8);
+  uint64_t raw = 0;
+  for (uint8_t i = 0; i < nbytes; i++) {
+    raw |= ((uint64_t) p[i]) << (8 * i);
+  }
+  uint32_t v = (uint32_t) (raw >> shift);
+  if (size < 32) {
+    v &= (1ul << size) - 1;
+    // sign extension
+    if (field->logical_min < 0 && (v & (1ul << (size - 1)))) v |= ~((1ul << size) - 1);
+  }
+
+  *value = (int32_t) v;
+  return true;
+}
+
+#if CFG_TUH_HID_FIELD_MAX
+uint8_t tuh_hid_field_count(uint8_t daddr, uint8_t idx) {
+  hidh_interface_t* p_hid = get_hid_itf(daddr, idx);
+  TU_VERIFY(p_hid, 0);
+  return p_hid->field_count;
+}
+
+tuh_hid_field_t const* tuh_hid_field_info(uint8_t daddr, uint8_t idx, uint8_t field_id) {
+  hidh_interface_t* p_hid = get_hid_itf(daddr, idx);
+  TU_VERIFY(p_hid && field_id < p_hid->field_count, NULL);
+  return &p_hid->fields[field_id];
+}
+
+uint8_t tuh_hid_find_field(uint8_t daddr, uint8_t idx, uint8_t report_type, uint16_t usage_page, uint16_t usage) {
+  hidh_interface_t* p_hid = get_hid_itf(daddr, idx);
+  TU_VERIFY(p_hid, TUSB_INDEX_INVALID_8);
+
+  for (uint8_t i = 0; i < p_hid->field_count; i++) {
+    tuh_hid_field_t const* f = &p_hid->fields[i];
+    if (f->report_type != report_type || f->usage_page != usage_page) continue;
+    bool const variable = (f->flags & 0x02) != 0;
+    if (f->usage == usage || (variable && f->usage <= usage && usage <= f->usage_max)) return i;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_hid_get_field(uint8_t daddr, uint8_t idx, uint8_t const* report, uint16_t len, uint8_t field_id,
+                       uint8_t element, int32_t* value) {
+  tuh_hid_field_t const* field = tuh_hid_field_info(daddr, idx, field_id);
+  TU_VERIFY(field);
+  return tuh_hid_field_extract(field, report, len, element, value);
+}
+#endif
+
 #endif
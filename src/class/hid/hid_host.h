@@ -42,10 +42,24 @@ extern "C" {
 #define CFG_TUH_HID_EPIN_BUFSIZE 64
 #endif
 
+// Number of interrupt IN buffers per interface. With more than one, reception is continuous once started by
+// tuh_hid_receive_report(): IN endpoint is re-armed with the next buffer before tuh_hid_report_received_cb() is
+// invoked, until tuh_hid_receive_abort() or a failed transfer. A report buffer stays valid until
+// CFG_TUH_HID_EPIN_BUF_COUNT-1 more reports are received.
+#ifndef CFG_TUH_HID_EPIN_BUF_COUNT
+#define CFG_TUH_HID_EPIN_BUF_COUNT 1
+#endif
+
 #ifndef CFG_TUH_HID_EPOUT_BUFSIZE
 #define CFG_TUH_HID_EPOUT_BUFSIZE 64
 #endif
 
+// Number of report fields parsed from report descriptor and cached per interface when mounted, see tuh_hid_get_field().
+// 0 disables the cache, tuh_hid_parse_report_fields() can still be used with application storage.
+#ifndef CFG_TUH_HID_FIELD_MAX
+#define CFG_TUH_HID_FIELD_MAX 0
+#endif
+
 
 typedef struct {
   uint8_t report_id;
@@ -57,6 +71,21 @@ typedef struct {
 //  uint8_t out_len;     // length of OUT report
 } tuh_hid_report_info_t;
 
+// Field of a report, described by an Input, Output or Feature main item of the report descriptor
+typedef struct {
+  uint16_t usage_page;
+  uint16_t usage;       // usage of 1st element: variable items each element has next usage up to usage_max,
+  uint16_t usage_max;   // array items have values in usage..usage_max
+  uint16_t bit_offset;  // offset of 1st element from start of report, including report ID byte if any
+  uint8_t  bit_size;    // bits per element (Report Size), up to 32
+  uint8_t  count;       // number of elements (Report Count)
+  uint8_t  report_id;
+  uint8_t  report_type; // hid_report_type_t
+  uint8_t  flags;       // low byte of main item data: bit0 constant, bit1 variable, bit2 relative
+  int32_t  logical_min; // negative when values are signed
+  int32_t  logical_max;
+} tuh_hid_field_t;
+
 //--------------------------------------------------------------------+
 // Interface API
 //--------------------------------------------------------------------+
@@ -88,6 +117,32 @@ bool tuh_hid_mounted(uint8_t dev_addr, uint8_t idx);
 TU_ATTR_UNUSED uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* reports_info_arr, uint8_t arr_count,
                                                        uint8_t const* desc_report, uint16_t desc_len);
 
+// Parse all Input, Output and Feature items of report descriptor into field table and return number of fields.
+// Padding (constant items without usage) is skipped, variable items with a usage list get one field per usage.
+uint8_t tuh_hid_parse_report_fields(tuh_hid_field_t* fields, uint8_t max_fields,
+                                    uint8_t const* desc_report, uint16_t desc_len);
+
+// Extract element of a field from a report (including report ID byte if any), sign extended if logical_min < 0.
+// return false if report has other ID or is too short
+bool tuh_hid_field_extract(tuh_hid_field_t const* field, uint8_t const* report, uint16_t len, uint8_t element,
+                           int32_t* value);
+
+#if CFG_TUH_HID_FIELD_MAX
+// Get number of fields cached when interface was mounted
+uint8_t tuh_hid_field_count(uint8_t dev_addr, uint8_t idx);
+
+// Get cached field by its index, NULL if out of range
+tuh_hid_field_t const* tuh_hid_field_info(uint8_t dev_addr, uint8_t idx, uint8_t field_id);
+
+// Find field by report type and usage, return field index or TUSB_INDEX_INVALID_8 if not found.
+// Usage within usage..usage_max of a variable field matches as well.
+uint8_t tuh_hid_find_field(uint8_t dev_addr, uint8_t idx, uint8_t report_type, uint16_t usage_page, uint16_t usage);
+
+// Extract element of a cached field from report received in tuh_hid_report_received_cb()
+bool tuh_hid_get_field(uint8_t dev_addr, uint8_t idx, uint8_t const* report, uint16_t len, uint8_t field_id,
+                       uint8_t element, int32_t* value);
+#endif
+
 //--------------------------------------------------------------------+
 // Control Endpoint API
 //--------------------------------------------------------------------+
@@ -124,6 +179,7 @@ bool tuh_hid_receive_ready(uint8_t dev_addr, uint8_t idx);
 // Try to receive next report on Interrupt Endpoint. Immediately return
 // - true If succeeded, tuh_hid_report_received_cb() callback will be invoked when report is available
 // - false if failed to queue the transfer e.g endpoint is busy
+// With CFG_TUH_HID_EPIN_BUF_COUNT > 1 reception continues after the first call, further calls just return true
 bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx);
 
 // Abort receiving report on Interrupt Endpoint
@@ -142,7 +198,8 @@ bool tuh_hid_send_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, const
 
 // Invoked when device with hid interface is mounted
 // Report descriptor is also available for use. tuh_hid_parse_report_descriptor()
-// can be used to parse common/simple enough descriptor.
+// can be used to parse common/simple enough descriptor. With CFG_TUH_HID_FIELD_MAX, report fields
+// are already parsed and can be looked up with tuh_hid_find_field().
 // Note: if report descriptor length > CFG_TUH_ENUMERATION_BUFSIZE, it will be skipped
 // therefore report_desc = NULL, desc_len = 0
 TU_ATTR_WEAK void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t idx, uint8_t const* report_desc, uint16_t desc_len);
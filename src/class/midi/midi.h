@@ -52,9 +52,40 @@ typedef enum
 
 typedef enum
 {
-  MIDI_CS_ENDPOINT_GENERAL = 0x01
+  MIDI_CS_ENDPOINT_GENERAL     = 0x01,
+  MIDI_CS_ENDPOINT_GENERAL_2_0 = 0x02, // MIDI 2.0: lists associated Group Terminal Blocks
 } midi_cs_endpoint_subtype_t;
 
+// MIDI 2.0 Group Terminal Block descriptor, requested with GET_DESCRIPTOR to MIDI Streaming interface
+enum
+{
+  MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK = 0x26,
+};
+
+typedef enum
+{
+  MIDI_GTB_SUBTYPE_HEADER = 0x01,
+  MIDI_GTB_SUBTYPE_BLOCK  = 0x02,
+} midi_gtb_subtype_t;
+
+typedef enum
+{
+  MIDI_GTB_TYPE_BIDIRECTIONAL = 0x00,
+  MIDI_GTB_TYPE_INPUT_ONLY    = 0x01,
+  MIDI_GTB_TYPE_OUTPUT_ONLY   = 0x02,
+} midi_gtb_type_t;
+
+typedef enum
+{
+  MIDI_GTB_PROTOCOL_UNKNOWN        = 0x00,
+  MIDI_GTB_PROTOCOL_MIDI1_64       = 0x01, // MIDI 1.0 UMP, up to 64 bit packets
+  MIDI_GTB_PROTOCOL_MIDI1_64_JRTS  = 0x02, // with Jitter Reduction Timestamps
+  MIDI_GTB_PROTOCOL_MIDI1_128      = 0x03, // MIDI 1.0 UMP, up to 128 bit packets
+  MIDI_GTB_PROTOCOL_MIDI1_128_JRTS = 0x04,
+  MIDI_GTB_PROTOCOL_MIDI2          = 0x11,
+  MIDI_GTB_PROTOCOL_MIDI2_JRTS     = 0x12,
+} midi_gtb_protocol_t;
+
 typedef enum
 {
   MIDI_JACK_EMBEDDED = 0x01,
@@ -81,6 +112,27 @@ typedef enum
   MIDI_CIN_1BYTE_DATA = 15
 } midi_code_index_number_t;
 
+// Universal MIDI Packet (UMP) message type, upper nibble of 1st word
+typedef enum
+{
+  MIDI_UMP_MT_UTILITY         = 0x0,
+  MIDI_UMP_MT_SYSTEM          = 0x1,
+  MIDI_UMP_MT_MIDI1_CHANNEL   = 0x2,
+  MIDI_UMP_MT_DATA64          = 0x3, // SysEx 7-bit
+  MIDI_UMP_MT_MIDI2_CHANNEL   = 0x4,
+  MIDI_UMP_MT_DATA128         = 0x5, // SysEx 8-bit & Mixed Data Set
+  MIDI_UMP_MT_FLEX_DATA       = 0xD,
+  MIDI_UMP_MT_STREAM          = 0xF,
+} midi_ump_message_type_t;
+
+// Number of 32-bit words of an UMP, from its message type
+TU_ATTR_ALWAYS_INLINE static inline uint8_t midi_ump_word_count(uint8_t mt)
+{
+  // 0x0-0x2 & 0x6-0x7: 1, 0x3-0x4 & 0x8-0xA: 2, 0xB-0xC: 3, 0x5 & 0xD-0xF: 4
+  static uint8_t const count[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+  return count[mt & 0x0f];
+}
+
 // MIDI 1.0 status byte
 enum
 {
@@ -201,6 +253,31 @@ typedef struct TU_ATTR_PACKED
     uint8_t  iElement;          \
  }
 
+/// MIDI 2.0 Group Terminal Block Header Descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  bLength            ; ///< Size of this descriptor in bytes: 5
+  uint8_t  bDescriptorType    ; ///< MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK
+  uint8_t  bDescriptorSubType ; ///< MIDI_GTB_SUBTYPE_HEADER
+  uint16_t wTotalLength       ; ///< Header and all following block descriptors
+} midi_desc_gtb_header_t;
+
+/// MIDI 2.0 Group Terminal Block Descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  bLength            ; ///< Size of this descriptor in bytes: 13
+  uint8_t  bDescriptorType    ; ///< MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK
+  uint8_t  bDescriptorSubType ; ///< MIDI_GTB_SUBTYPE_BLOCK
+  uint8_t  bGrpTrmBlkID       ; ///< ID of this block, referenced by MS 2.0 endpoint descriptor
+  uint8_t  bGrpTrmBlkType     ; ///< midi_gtb_type_t
+  uint8_t  nGroupTrm          ; ///< First group (0-15) of this block
+  uint8_t  nNumGroupTrm       ; ///< Number of groups spanned
+  uint8_t  iBlockItem         ; ///< string descriptor
+  uint8_t  bMIDIProtocol      ; ///< midi_gtb_protocol_t
+  uint16_t wMaxInputBandwidth ; ///< 4KB/s unit, 0 is unknown
+  uint16_t wMaxOutputBandwidth; ///< 4KB/s unit, 0 is unknown
+} midi_desc_gtb_t;
+
 /** @} */
 
 #ifdef __cplusplus
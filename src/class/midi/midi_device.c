@@ -49,9 +49,16 @@ typedef struct
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;
+  uint8_t alt_setting;
+  bool    ump_mode; // MIDI 2.0 alternate setting is active
+
+  // MIDI Streaming interface descriptors including all alternate settings
+  uint8_t const* ms_desc;
+  uint16_t ms_desc_len;
 
   // For Stream read()/write() API
   // Messages are always 4 bytes long, queue them for reading and writing so the
@@ -92,8 +99,8 @@ bool tud_midi_n_mounted (uint8_t itf)
 
 static void _prep_out_transaction (midid_interface_t* p_midi)
 {
-  uint8_t const rhport = 0;
-  uint16_t available = tu_fifo_remaining(&p_midi->rx_ff);
+  uint8_t const rhport = p_midi->rhport;
+  tu_fifo_size_t available = tu_fifo_remaining(&p_midi->rx_ff);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
@@ -139,6 +146,7 @@ uint32_t tud_midi_n_stream_read(uint8_t itf, uint8_t cable_num, void* buffer, ui
 
   midid_interface_t* midi = &_midid_itf[itf];
   midid_stream_t* stream = &midi->stream_read;
+  TU_VERIFY(!midi->ump_mode, 0);
 
   uint32_t total_read = 0;
   while( bufsize )
@@ -203,7 +211,7 @@ uint32_t tud_midi_n_stream_read(uint8_t itf, uint8_t cable_num, void* buffer, ui
 bool tud_midi_n_packet_read (uint8_t itf, uint8_t packet[4])
 {
   midid_interface_t* midi = &_midid_itf[itf];
-  TU_VERIFY(midi->ep_out);
+  TU_VERIFY(midi->ep_out && !midi->ump_mode);
 
   uint32_t const num_read = tu_fifo_read_n(&midi->rx_ff, packet, 4);
   _prep_out_transaction(midi);
@@ -219,7 +227,7 @@ static uint32_t write_flush(midid_interface_t* midi)
   // No data to send
   if ( !tu_fifo_count(&midi->tx_ff) ) return 0;
 
-  uint8_t const rhport = 0;
+  uint8_t const rhport = midi->rhport;
 
   // skip if previous transfer not complete
   TU_VERIFY( usbd_edpt_claim(rhport, midi->ep_in), 0 );
@@ -238,117 +246,175 @@ static uint32_t write_flush(midid_interface_t* midi)
   }
 }
 
-uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize)
+// Encode next byte of stream, return true if an event packet is complete in stream->buffer
+static bool stream_encode(midid_stream_t* stream, uint8_t cable_num, uint8_t data)
 {
-  midid_interface_t* midi = &_midid_itf[itf];
-  TU_VERIFY(midi->ep_in, 0);
-
-  midid_stream_t* stream = &midi->stream_write;
-
-  uint32_t i = 0;
-  while ( (i < bufsize) && (tu_fifo_remaining(&midi->tx_ff) >= 4) )
+  if ( stream->index == 0 )
   {
-    uint8_t const data = buffer[i];
-    i++;
+    //------------- New event packet -------------//
 
-    if ( stream->index == 0 )
-    {
-      //------------- New event packet -------------//
-
-      uint8_t const msg = data >> 4;
+    uint8_t const msg = data >> 4;
 
-      stream->index = 2;
-      stream->buffer[1] = data;
+    stream->index = 2;
+    stream->buffer[1] = data;
 
-      // Check to see if we're still in a SysEx transmit.
-      if ( ((stream->buffer[0]) & 0xF) == MIDI_CIN_SYSEX_START )
+    // Check to see if we're still in a SysEx transmit.
+    if ( ((stream->buffer[0]) & 0xF) == MIDI_CIN_SYSEX_START )
+    {
+      if ( data == MIDI_STATUS_SYSEX_END )
       {
-        if ( data == MIDI_STATUS_SYSEX_END )
-        {
-          stream->buffer[0] = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_END_1BYTE);
-          stream->total = 2;
-        }
-        else
-        {
-          stream->total = 4;
-        }
+        stream->buffer[0] = (uint8_t) ((cable_num << 4) | MIDI_CIN_SYSEX_END_1BYTE);
+        stream->total = 2;
+      }
+      else
+      {
+        stream->total = 4;
       }
-      else if ( (msg >= 0x8 && msg <= 0xB) || msg == 0xE )
+    }
+    else if ( (msg >= 0x8 && msg <= 0xB) || msg == 0xE )
+    {
+      // Channel Voice Messages
+      stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+      stream->total = 4;
+    }
+    else if ( msg == 0xC || msg == 0xD)
+    {
+      // Channel Voice Messages, two-byte variants (Program Change and Channel Pressure)
+      stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+      stream->total = 3;
+    }
+    else if ( msg == 0xf )
+    {
+      // System message
+      if ( data == MIDI_STATUS_SYSEX_START )
       {
-        // Channel Voice Messages
-        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->buffer[0] = MIDI_CIN_SYSEX_START;
         stream->total = 4;
       }
-      else if ( msg == 0xC || msg == 0xD)
+      else if ( data == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME || data == MIDI_STATUS_SYSCOM_SONG_SELECT )
       {
-        // Channel Voice Messages, two-byte variants (Program Change and Channel Pressure)
-        stream->buffer[0] = (uint8_t) ((cable_num << 4) | msg);
+        stream->buffer[0] = MIDI_CIN_SYSCOM_2BYTE;
         stream->total = 3;
       }
-      else if ( msg == 0xf )
+      else if ( data == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER )
       {
-        // System message
-        if ( data == MIDI_STATUS_SYSEX_START )
-        {
-          stream->buffer[0] = MIDI_CIN_SYSEX_START;
-          stream->total = 4;
-        }
-        else if ( data == MIDI_STATUS_SYSCOM_TIME_CODE_QUARTER_FRAME || data == MIDI_STATUS_SYSCOM_SONG_SELECT )
-        {
-          stream->buffer[0] = MIDI_CIN_SYSCOM_2BYTE;
-          stream->total = 3;
-        }
-        else if ( data == MIDI_STATUS_SYSCOM_SONG_POSITION_POINTER )
-        {
-          stream->buffer[0] = MIDI_CIN_SYSCOM_3BYTE;
-          stream->total = 4;
-        }
-        else
-        {
-          stream->buffer[0] = MIDI_CIN_SYSEX_END_1BYTE;
-          stream->total = 2;
-        }
-        stream->buffer[0] |= (uint8_t)(cable_num << 4);
+        stream->buffer[0] = MIDI_CIN_SYSCOM_3BYTE;
+        stream->total = 4;
       }
       else
       {
-        // Pack individual bytes if we don't support packing them into words.
-        stream->buffer[0] = (uint8_t) (cable_num << 4 | 0xf);
-        stream->buffer[2] = 0;
-        stream->buffer[3] = 0;
-        stream->index = 2;
+        stream->buffer[0] = MIDI_CIN_SYSEX_END_1BYTE;
         stream->total = 2;
       }
+      stream->buffer[0] |= (uint8_t)(cable_num << 4);
     }
     else
     {
-      //------------- On-going (buffering) packet -------------//
+      // Pack individual bytes if we don't support packing them into words.
+      stream->buffer[0] = (uint8_t) (cable_num << 4 | 0xf);
+      stream->buffer[2] = 0;
+      stream->buffer[3] = 0;
+      stream->index = 2;
+      stream->total = 2;
+    }
+  }
+  else
+  {
+    //------------- On-going (buffering) packet -------------//
 
-      TU_ASSERT(stream->index < 4, i);
-      stream->buffer[stream->index] = data;
-      stream->index++;
+    TU_ASSERT(stream->index < 4);
+    stream->buffer[stream->index] = data;
+    stream->index++;
 
-      // See if this byte ends a SysEx.
-      if ( (stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START && data == MIDI_STATUS_SYSEX_END )
+    // See if this byte ends a SysEx.
+    if ( (stream->buffer[0] & 0xF) == MIDI_CIN_SYSEX_START && data == MIDI_STATUS_SYSEX_END )
+    {
+      stream->buffer[0] = (uint8_t) ((cable_num << 4) | (MIDI_CIN_SYSEX_START + (stream->index - 1)));
+      stream->total = stream->index;
+    }
+  }
+
+  if ( stream->index != stream->total ) return false;
+
+  // zeroes unused bytes
+  for(uint8_t idx = stream->total; idx < 4; idx++) stream->buffer[idx] = 0;
+
+  // complete current event packet, reset stream
+  stream->index = stream->total = 0;
+  return true;
+}
+
+// Event packets are encoded in batches on stack, then written to FIFO at once
+#define MIDI_STREAM_BATCH_SIZE  64
+
+uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const* buffer, uint32_t bufsize)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in && !midi->ump_mode, 0);
+
+  uint8_t const rhport = midi->rhport;
+  midid_stream_t* stream = &midi->stream_write;
+
+  // endpoint is idle and nothing queued: encode straight into endpoint buffer
+  bool direct = !tu_fifo_count(&midi->tx_ff) && usbd_edpt_claim(rhport, midi->ep_in);
+  uint16_t ep_count = 0;
+
+  uint8_t batch[MIDI_STREAM_BATCH_SIZE];
+  uint16_t batch_count = 0;
+  uint32_t room = tu_fifo_remaining(&midi->tx_ff); // only grows while we write
+
+  uint32_t i = 0;
+  while ( i < bufsize )
+  {
+    // make sure a completed packet can be stored
+    if ( !direct && (batch_count + 4u > room) )
+    {
+      tu_fifo_write_n(&midi->tx_ff, batch, batch_count);
+      batch_count = 0;
+      room = tu_fifo_remaining(&midi->tx_ff);
+      if ( room < 4 ) break;
+    }
+
+    if ( !stream_encode(stream, cable_num, buffer[i++]) ) continue;
+
+    if ( direct )
+    {
+      memcpy(midi->epin_buf + ep_count, stream->buffer, 4);
+      ep_count = (uint16_t) (ep_count + 4);
+
+      // endpoint buffer full, following packets are queued
+      if ( ep_count + 4u > CFG_TUD_MIDI_EP_BUFSIZE )
       {
-        stream->buffer[0] = (uint8_t) ((cable_num << 4) | (MIDI_CIN_SYSEX_START + (stream->index - 1)));
-        stream->total = stream->index;
+        TU_ASSERT( usbd_edpt_xfer(rhport, midi->ep_in, midi->epin_buf, ep_count), i );
+        direct = false;
       }
     }
-
-    // Send out packet
-    if ( stream->index == stream->total )
+    else
     {
-      // zeroes unused bytes
-      for(uint8_t idx = stream->total; idx < 4; idx++) stream->buffer[idx] = 0;
+      memcpy(batch + batch_count, stream->buffer, 4);
+      batch_count = (uint16_t) (batch_count + 4);
 
-      uint16_t const count = tu_fifo_write_n(&midi->tx_ff, stream->buffer, 4);
+      if ( batch_count == sizeof(batch) )
+      {
+        tu_fifo_write_n(&midi->tx_ff, batch, batch_count);
+        room -= batch_count;
+        batch_count = 0;
+      }
+    }
+  }
 
-      // complete current event packet, reset stream
-      stream->index = stream->total = 0;
+  if ( batch_count ) tu_fifo_write_n(&midi->tx_ff, batch, batch_count);
 
-      // FIFO overflown, since we already check fifo remaining. It is probably race condition
-      TU_ASSERT(count == 4, i);
+  if ( direct )
+  {
+    if ( ep_count )
+    {
+      TU_ASSERT( usbd_edpt_xfer(rhport, midi->ep_in, midi->epin_buf, ep_count), i );
+    }
+    else
+    {
+      // Release endpoint since we don't make any transfer
+      usbd_edpt_release(rhport, midi->ep_in);
     }
   }
 
@@ -360,7 +426,7 @@ uint32_t tud_midi_n_stream_write(uint8_t itf, uint8_t cable_num, uint8_t const*
 bool tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4])
 {
   midid_interface_t* midi = &_midid_itf[itf];
-  TU_VERIFY(midi->ep_in);
+  TU_VERIFY(midi->ep_in && !midi->ump_mode);
 
   if (tu_fifo_remaining(&midi->tx_ff) < 4) return false;
 
@@ -370,6 +436,105 @@ bool tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4])
   return true;
 }
 
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const* packets, uint32_t count)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in && !midi->ump_mode, 0);
+
+  uint8_t const rhport = midi->rhport;
+  uint32_t written = 0;
+
+  // endpoint is idle and nothing queued: copy straight into endpoint buffer
+  if ( !tu_fifo_count(&midi->tx_ff) && usbd_edpt_claim(rhport, midi->ep_in) )
+  {
+    written = tu_min32(count, CFG_TUD_MIDI_EP_BUFSIZE / 4);
+    if ( written )
+    {
+      memcpy(midi->epin_buf, packets, written * 4);
+      TU_ASSERT( usbd_edpt_xfer(rhport, midi->ep_in, midi->epin_buf, (uint16_t) (written * 4)), 0 );
+    }
+    else
+    {
+      usbd_edpt_release(rhport, midi->ep_in);
+    }
+  }
+
+  // queue the rest as far as FIFO allows
+  uint32_t const queued = tu_min32(count - written, tu_fifo_remaining(&midi->tx_ff) / 4);
+  if ( queued )
+  {
+    tu_fifo_write_n(&midi->tx_ff, packets + written * 4, (tu_fifo_size_t) (queued * 4));
+    write_flush(midi);
+  }
+
+  return written + queued;
+}
+
+//--------------------------------------------------------------------+
+// UMP API
+//--------------------------------------------------------------------+
+#if CFG_TUD_MIDI_UMP
+
+bool tud_midi_n_ump_mode(uint8_t itf)
+{
+  return _midid_itf[itf].ump_mode;
+}
+
+uint32_t tud_midi_n_ump_read(uint8_t itf, uint32_t* words, uint32_t max_words)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_out && midi->ump_mode, 0);
+
+  uint32_t num_read = 0;
+  while ( num_read < max_words )
+  {
+    // word count of next packet is encoded in message type of its 1st word (little endian on the bus)
+    uint8_t first[4];
+    if ( 4 != tu_fifo_peek_n(&midi->rx_ff, first, 4) ) break;
+
+    uint8_t const n_words = midi_ump_word_count(first[3] >> 4);
+    if ( (num_read + n_words > max_words) || (tu_fifo_count(&midi->rx_ff) < 4u * n_words) ) break;
+
+    tu_fifo_read_n(&midi->rx_ff, words + num_read, (tu_fifo_size_t) (4u * n_words));
+    for ( uint8_t i = 0; i < n_words; i++ )
+    {
+      words[num_read + i] = tu_le32toh(words[num_read + i]);
+    }
+
+    num_read += n_words;
+  }
+
+  _prep_out_transaction(midi);
+  return num_read;
+}
+
+uint32_t tud_midi_n_ump_write(uint8_t itf, uint32_t const* words, uint32_t n_words)
+{
+  midid_interface_t* midi = &_midid_itf[itf];
+  TU_VERIFY(midi->ep_in && midi->ump_mode, 0);
+
+  uint32_t num_written = 0;
+  while ( num_written < n_words )
+  {
+    uint8_t const count = midi_ump_word_count((uint8_t) (words[num_written] >> 28));
+    if ( (num_written + count > n_words) || (tu_fifo_remaining(&midi->tx_ff) < 4u * count) ) break;
+
+    uint32_t packet[4];
+    for ( uint8_t i = 0; i < count; i++ )
+    {
+      packet[i] = tu_htole32(words[num_written + i]);
+    }
+    tu_fifo_write_n(&midi->tx_ff, packet, (tu_fifo_size_t) (4u * count));
+
+    num_written += count;
+  }
+
+  write_flush(midi);
+  return num_written;
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -429,6 +594,79 @@ void midid_reset(uint8_t rhport)
   }
 }
 
+// Open endpoints of an alternate setting of MIDI Streaming interface
+static bool set_alt_setting(uint8_t rhport, midid_interface_t* p_midi, uint8_t alt)
+{
+  uint8_t const* p_desc = p_midi->ms_desc;
+  uint8_t const* desc_end = p_desc + p_midi->ms_desc_len;
+
+  // Find the alternate setting
+  while ( (p_desc < desc_end) && !(TUSB_DESC_INTERFACE == tu_desc_type(p_desc) &&
+                                   ((tusb_desc_interface_t const *) p_desc)->bAlternateSetting == alt) )
+  {
+    p_desc = tu_desc_next(p_desc);
+  }
+  TU_VERIFY(p_desc < desc_end);
+
+  uint8_t const num_ep = ((tusb_desc_interface_t const *) p_desc)->bNumEndpoints;
+  p_desc = tu_desc_next(p_desc);
+
+  // MS Header tells MIDI version of this alternate setting
+  bool ump_mode = false;
+  if ( TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && MIDI_CS_INTERFACE_HEADER == p_desc[2] )
+  {
+    ump_mode = (tu_le16toh(((midi_desc_header_t const*) p_desc)->bcdMSC) >= 0x0200);
+  }
+  TU_VERIFY(CFG_TUD_MIDI_UMP || !ump_mode);
+
+  // Close endpoints of previous alternate setting, pending data is no longer valid
+  if ( p_midi->ep_in )
+  {
+    usbd_edpt_close(rhport, p_midi->ep_in);
+    p_midi->ep_in = 0;
+  }
+  if ( p_midi->ep_out )
+  {
+    usbd_edpt_close(rhport, p_midi->ep_out);
+    p_midi->ep_out = 0;
+  }
+
+  tu_memclr(&p_midi->stream_write, sizeof(midid_stream_t));
+  tu_memclr(&p_midi->stream_read, sizeof(midid_stream_t));
+  tu_fifo_clear(&p_midi->rx_ff);
+  tu_fifo_clear(&p_midi->tx_ff);
+
+  // Find and open endpoint descriptors
+  uint8_t found_endpoints = 0;
+  while ( (found_endpoints < num_ep) && (p_desc < desc_end) && (TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) )
+  {
+    if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+    {
+      TU_ASSERT(usbd_edpt_open(rhport, (tusb_desc_endpoint_t const *) p_desc));
+      uint8_t ep_addr = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
+
+      if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN)
+      {
+        p_midi->ep_in = ep_addr;
+      } else {
+        p_midi->ep_out = ep_addr;
+      }
+
+      found_endpoints += 1;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  p_midi->alt_setting = alt;
+  p_midi->ump_mode = ump_mode;
+
+  // Prepare for incoming data
+  if ( p_midi->ep_out ) _prep_out_transaction(p_midi);
+
+  return true;
+}
+
 uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t max_len)
 {
   // 1st Interface is Audio Control v1
@@ -458,7 +696,7 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
   midid_interface_t * p_midi = NULL;
   for(uint8_t i=0; i<CFG_TUD_MIDI; i++)
   {
-    if ( _midid_itf[i].ep_in == 0 && _midid_itf[i].ep_out == 0 )
+    if ( _midid_itf[i].ms_desc == NULL )
     {
       p_midi = &_midid_itf[i];
       break;
@@ -466,42 +704,25 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
   }
   TU_ASSERT(p_midi);
 
+  p_midi->rhport  = rhport;
   p_midi->itf_num = desc_midi->bInterfaceNumber;
-  (void) p_midi->itf_num;
-
-  // next descriptor
-  drv_len += tu_desc_len(p_desc);
-  p_desc   = tu_desc_next(p_desc);
 
-  // Find and open endpoint descriptors
-  uint8_t found_endpoints = 0;
-  while ( (found_endpoints < desc_midi->bNumEndpoints) && (drv_len <= max_len)  )
+  // MIDI Streaming interface lasts until the next function or interface, all its alternate settings are claimed
+  p_midi->ms_desc = p_desc;
+  uint16_t ms_len = 0;
+  do
   {
-    if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
-    {
-      TU_ASSERT(usbd_edpt_open(rhport, (tusb_desc_endpoint_t const *) p_desc), 0);
-      uint8_t ep_addr = ((tusb_desc_endpoint_t const *) p_desc)->bEndpointAddress;
+    ms_len = (uint16_t) (ms_len + tu_desc_len(p_desc));
+    p_desc = tu_desc_next(p_desc);
+  } while ( (drv_len + ms_len < max_len) && !(
+              (TUSB_DESC_INTERFACE_ASSOCIATION == tu_desc_type(p_desc)) ||
+              (TUSB_DESC_INTERFACE == tu_desc_type(p_desc) &&
+               ((tusb_desc_interface_t const *) p_desc)->bInterfaceNumber != p_midi->itf_num)) );
 
-      if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN)
-      {
-        p_midi->ep_in = ep_addr;
-      } else {
-        p_midi->ep_out = ep_addr;
-      }
-
-      // Class Specific MIDI Stream endpoint descriptor
-      drv_len += tu_desc_len(p_desc);
-      p_desc   = tu_desc_next(p_desc);
-
-      found_endpoints += 1;
-    }
-
-    drv_len += tu_desc_len(p_desc);
-    p_desc   = tu_desc_next(p_desc);
-  }
+  p_midi->ms_desc_len = ms_len;
+  drv_len = (uint16_t) (drv_len + ms_len);
 
-  // Prepare for incoming data
-  _prep_out_transaction(p_midi);
+  TU_ASSERT(set_alt_setting(rhport, p_midi, 0), 0);
 
   return drv_len;
 }
@@ -511,12 +732,65 @@ uint16_t midid_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint
 // return false to stall control endpoint (e.g unsupported request)
 bool midid_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request)
 {
-  (void) rhport;
-  (void) stage;
-  (void) request;
+  // only standard requests to MIDI Streaming interface are supported
+  TU_VERIFY(TUSB_REQ_TYPE_STANDARD == request->bmRequestType_bit.type &&
+            TUSB_REQ_RCPT_INTERFACE == request->bmRequestType_bit.recipient);
+
+  uint8_t itf;
+  midid_interface_t* p_midi;
+  for (itf = 0; itf < CFG_TUD_MIDI; itf++)
+  {
+    p_midi = &_midid_itf[itf];
+    if ( p_midi->ms_desc && (p_midi->itf_num == tu_u16_low(request->wIndex)) ) break;
+  }
+  TU_VERIFY(itf < CFG_TUD_MIDI);
+
+  if ( stage != CONTROL_STAGE_SETUP ) return true;
 
-  // driver doesn't support any request yet
-  return false;
+  switch ( request->bRequest )
+  {
+    case TUSB_REQ_GET_INTERFACE:
+      TU_VERIFY( tud_control_xfer(rhport, request, &p_midi->alt_setting, 1) );
+    break;
+
+    case TUSB_REQ_SET_INTERFACE:
+    {
+      uint8_t const alt = tu_u16_low(request->wValue);
+      TU_VERIFY( set_alt_setting(rhport, p_midi, alt) );
+      #if CFG_TUD_MIDI_UMP
+      if ( tud_midi_ump_mode_cb ) tud_midi_ump_mode_cb(itf, p_midi->ump_mode);
+      #endif
+      TU_VERIFY( tud_control_status(rhport, request) );
+    }
+    break;
+
+    #if CFG_TUD_MIDI_UMP
+    case TUSB_REQ_GET_DESCRIPTOR:
+    {
+      TU_VERIFY( MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK == tu_u16_high(request->wValue) );
+
+      // single bidirectional block for group 1, with ID referenced by TUD_MIDI2_DESCRIPTOR()
+      static uint8_t const gtb_default[] =
+      {
+        5, MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK, MIDI_GTB_SUBTYPE_HEADER, U16_TO_U8S_LE(5 + 13),
+        13, MIDI_DESC_TYPE_GROUP_TERMINAL_BLOCK, MIDI_GTB_SUBTYPE_BLOCK, 1, MIDI_GTB_TYPE_BIDIRECTIONAL, 0, 1, 0,
+        MIDI_GTB_PROTOCOL_UNKNOWN, U16_TO_U8S_LE(0), U16_TO_U8S_LE(0)
+      };
+
+      uint8_t const* desc = tud_midi_group_terminal_block_descriptor_cb ?
+                            tud_midi_group_terminal_block_descriptor_cb(itf) : gtb_default;
+      TU_VERIFY(desc);
+
+      uint16_t const total_len = tu_le16toh(((midi_desc_gtb_header_t const*) desc)->wTotalLength);
+      TU_VERIFY( tud_control_xfer(rhport, request, (void*)(uintptr_t) desc, total_len) );
+    }
+    break;
+    #endif
+
+    default: return false;
+  }
+
+  return true;
 }
 
 bool midid_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
@@ -43,6 +43,11 @@
   #define CFG_TUD_MIDI_EP_BUFSIZE     (TUD_OPT_HIGH_SPEED ? 512 : 64)
 #endif
 
+// Support MIDI 2.0 Universal MIDI Packet (UMP) on alternate setting 1 (see TUD_MIDI2_DESCRIPTOR)
+#ifndef CFG_TUD_MIDI_UMP
+  #define CFG_TUD_MIDI_UMP            0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -75,6 +80,22 @@ bool     tud_midi_n_packet_read  (uint8_t itf, uint8_t packet[4]);
 // Write event packet            (4 bytes)
 bool     tud_midi_n_packet_write (uint8_t itf, uint8_t const packet[4]);
 
+// Write array of event packets (count * 4 bytes) at once, return number of packets written.
+// If endpoint is idle, packets are copied straight into endpoint buffer.
+uint32_t tud_midi_n_packet_write_n (uint8_t itf, uint8_t const* packets, uint32_t count);
+
+#if CFG_TUD_MIDI_UMP
+// Check if host selected MIDI 2.0 alternate setting: UMP API must be used instead of stream/packet API
+bool     tud_midi_n_ump_mode     (uint8_t itf);
+
+// Read whole Universal MIDI Packets (1 to 4 words each) up to max_words, return number of words read
+uint32_t tud_midi_n_ump_read     (uint8_t itf, uint32_t* words, uint32_t max_words);
+
+// Write whole Universal MIDI Packets, return number of words written.
+// A packet that does not fit in the FIFO is not written partially.
+uint32_t tud_midi_n_ump_write    (uint8_t itf, uint32_t const* words, uint32_t n_words);
+#endif
+
 //--------------------------------------------------------------------+
 // Application API (Single Interface)
 //--------------------------------------------------------------------+
@@ -86,6 +107,13 @@ static inline uint32_t tud_midi_stream_write (uint8_t cable_num, uint8_t const*
 
 static inline bool     tud_midi_packet_read  (uint8_t packet[4]);
 static inline bool     tud_midi_packet_write (uint8_t const packet[4]);
+static inline uint32_t tud_midi_packet_write_n (uint8_t const* packets, uint32_t count);
+
+#if CFG_TUD_MIDI_UMP
+static inline bool     tud_midi_ump_mode     (void);
+static inline uint32_t tud_midi_ump_read     (uint32_t* words, uint32_t max_words);
+static inline uint32_t tud_midi_ump_write    (uint32_t const* words, uint32_t n_words);
+#endif
 
 //------------- Deprecated API name  -------------//
 // TODO remove after 0.10.0 release
@@ -120,6 +148,16 @@ static inline bool tud_midi_receive(uint8_t packet[4])
 //--------------------------------------------------------------------+
 TU_ATTR_WEAK void tud_midi_rx_cb(uint8_t itf);
 
+#if CFG_TUD_MIDI_UMP
+// Invoked when host switches between MIDI 1.0 (alt 0) and MIDI 2.0 UMP (alt 1), FIFOs are cleared
+TU_ATTR_WEAK void tud_midi_ump_mode_cb(uint8_t itf, bool ump_mode);
+
+// Invoked when received GET_DESCRIPTOR for Group Terminal Block of MIDI Streaming interface.
+// Application return pointer to descriptor (header followed by blocks), whose contents must exist
+// long enough for transfer to complete. If not implemented, a single bidirectional block of group 1 is reported.
+TU_ATTR_WEAK uint8_t const* tud_midi_group_terminal_block_descriptor_cb(uint8_t itf);
+#endif
+
 //--------------------------------------------------------------------+
 // Inline Functions
 //--------------------------------------------------------------------+
@@ -154,6 +192,28 @@ static inline bool tud_midi_packet_write (uint8_t const packet[4])
   return tud_midi_n_packet_write(0, packet);
 }
 
+static inline uint32_t tud_midi_packet_write_n (uint8_t const* packets, uint32_t count)
+{
+  return tud_midi_n_packet_write_n(0, packets, count);
+}
+
+#if CFG_TUD_MIDI_UMP
+static inline bool tud_midi_ump_mode (void)
+{
+  return tud_midi_n_ump_mode(0);
+}
+
+static inline uint32_t tud_midi_ump_read (uint32_t* words, uint32_t max_words)
+{
+  return tud_midi_n_ump_read(0, words, max_words);
+}
+
+static inline uint32_t tud_midi_ump_write (uint32_t const* words, uint32_t n_words)
+{
+  return tud_midi_n_ump_write(0, words, n_words);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -0,0 +1,459 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_MIDI)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "midi_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_MIDI_LOG_LEVEL
+  #define CFG_TUH_MIDI_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_MIDI_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// Host MIDI Interface
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t bInterfaceNumber; // Audio Control interface
+  uint8_t itf_ms;           // MIDI Streaming interface
+  uint8_t ep_in;
+
+  uint8_t num_cables_rx;
+  uint8_t num_cables_tx;
+  bool mounted;
+
+  // IN endpoint alternates between two buffers: the next transfer is started before the
+  // completed buffer is drained into rx fifo, so that the endpoint is always primed.
+  uint8_t epin_idx;         // buffer for the next IN transfer
+  volatile bool rx_stopped; // no IN transfer in flight, fifo could not take another buffer
+
+  tu_fifo_t rx_ff;
+  uint8_t rx_ff_buf[CFG_TUH_MIDI_RX_BUFSIZE];
+
+  tu_edpt_stream_t tx;
+  uint8_t tx_ff_buf[CFG_TUH_MIDI_TX_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t tx_ep_buf[CFG_TUH_MIDI_EP_BUFSIZE];
+
+  CFG_TUH_MEM_ALIGN uint8_t epin_buf[2][CFG_TUH_MIDI_EP_BUFSIZE];
+} midih_interface_t;
+
+CFG_TUH_MEM_SECTION
+static midih_interface_t midih_data[CFG_TUH_MIDI];
+
+TU_VERIFY_STATIC(CFG_TUH_MIDI_EP_BUFSIZE % 4 == 0, "Endpoint buffer must hold whole event packets");
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline midih_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_MIDI, NULL);
+  midih_interface_t* p_midi = &midih_data[idx];
+  return (p_midi->daddr != 0) ? p_midi : NULL;
+}
+
+static inline uint8_t get_idx_by_ep_addr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t const* p_midi = &midih_data[i];
+    if ((p_midi->daddr == daddr) && (ep_addr == p_midi->ep_in || ep_addr == p_midi->tx.ep_addr)) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+// Start IN transfer on the next buffer if fifo can still take a whole buffer after pending bytes are written.
+// Endpoint must be claimed, or just released by usbh in the transfer complete ISR.
+static bool rx_xfer(midih_interface_t* p_midi, uint32_t pending) {
+  TU_VERIFY(tu_fifo_remaining(&p_midi->rx_ff) >= pending + CFG_TUH_MIDI_EP_BUFSIZE);
+
+  // switch buffer before submitting since transfer can complete before usbh_edpt_xfer() returns
+  uint8_t* ep_buf = p_midi->epin_buf[p_midi->epin_idx];
+  p_midi->epin_idx ^= 1;
+
+  if (!usbh_edpt_xfer(p_midi->daddr, p_midi->ep_in, ep_buf, CFG_TUH_MIDI_EP_BUFSIZE)) {
+    p_midi->epin_idx ^= 1;
+    return false;
+  }
+
+  return true;
+}
+
+// Restart IN endpoint stopped by full fifo. Not called in ISR.
+static void rx_restart(midih_interface_t* p_midi) {
+  if (!p_midi->rx_stopped) return;
+
+  #if CFG_TUH_MIDI_XFER_ISR
+  // completion ISR re-arms without claiming, keep it out while claiming here
+  usbh_int_set(false);
+  #endif
+
+  if (usbh_edpt_claim(p_midi->daddr, p_midi->ep_in)) {
+    if (p_midi->rx_stopped && rx_xfer(p_midi, 0)) {
+      p_midi->rx_stopped = false;
+    } else {
+      usbh_edpt_release(p_midi->daddr, p_midi->ep_in);
+    }
+  }
+
+  #if CFG_TUH_MIDI_XFER_ISR
+  usbh_int_set(true);
+  #endif
+}
+
+static void rx_complete(uint8_t idx, midih_interface_t* p_midi, uint32_t xferred_bytes, bool in_isr) {
+  // nobody re-arms IN endpoint until this completion is processed, buffer of last transfer is the other one
+  uint8_t* ep_buf = p_midi->epin_buf[p_midi->epin_idx ^ 1];
+  uint32_t count = xferred_bytes & ~3ul;
+
+  // re-arm with the other buffer before draining this one
+  bool armed = false;
+  if (in_isr) {
+    armed = rx_xfer(p_midi, count);
+  } else if (usbh_edpt_claim(p_midi->daddr, p_midi->ep_in)) {
+    armed = rx_xfer(p_midi, count);
+    if (!armed) usbh_edpt_release(p_midi->daddr, p_midi->ep_in);
+  }
+
+  // drop padding: some devices fill up the transfer with empty packets
+  uint32_t len = 0;
+  for (uint32_t i = 0; i < count; i += 4) {
+    if (ep_buf[i] | ep_buf[i + 1] | ep_buf[i + 2] | ep_buf[i + 3]) {
+      if (len != i) memcpy(ep_buf + len, ep_buf + i, 4);
+      len += 4;
+    }
+  }
+  if (len) tu_fifo_write_n(&p_midi->rx_ff, ep_buf, (tu_fifo_size_t) len);
+
+  if (!armed) {
+    // fifo is full, endpoint is restarted once application read some packets
+    p_midi->rx_stopped = true;
+    if (in_isr) {
+      if (rx_xfer(p_midi, 0)) p_midi->rx_stopped = false;
+    } else {
+      rx_restart(p_midi);
+    }
+  }
+
+  if (len && tuh_midi_rx_cb) tuh_midi_rx_cb(idx, len);
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+uint8_t tuh_midi_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t const* p_midi = &midih_data[i];
+    if (p_midi->daddr == daddr && p_midi->bInterfaceNumber == itf_num) return i;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_midi_itf_get_info(uint8_t idx, tuh_itf_info_t* info) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && info);
+
+  info->daddr = p_midi->daddr;
+
+  // re-construct descriptor
+  tusb_desc_interface_t* desc = &info->desc;
+  desc->bLength            = sizeof(tusb_desc_interface_t);
+  desc->bDescriptorType    = TUSB_DESC_INTERFACE;
+
+  desc->bInterfaceNumber   = p_midi->bInterfaceNumber;
+  desc->bAlternateSetting  = 0;
+  desc->bNumEndpoints      = 0;
+  desc->bInterfaceClass    = TUSB_CLASS_AUDIO;
+  desc->bInterfaceSubClass = AUDIO_SUBCLASS_CONTROL;
+  desc->bInterfaceProtocol = AUDIO_FUNC_PROTOCOL_CODE_UNDEF;
+  desc->iInterface         = 0; // not used yet
+
+  return true;
+}
+
+bool tuh_midi_mounted(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi);
+  return p_midi->mounted;
+}
+
+uint8_t tuh_midi_get_num_rx_cables(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+  return p_midi->num_cables_rx;
+}
+
+uint8_t tuh_midi_get_num_tx_cables(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+  return p_midi->num_cables_tx;
+}
+
+uint32_t tuh_midi_packet_available(uint8_t idx) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi, 0);
+  return tu_fifo_count(&p_midi->rx_ff) / 4;
+}
+
+bool tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]) {
+  return 1 == tuh_midi_packet_read_n(idx, packet, 1);
+}
+
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t* packets, uint32_t max_count) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->ep_in, 0);
+
+  uint32_t const count = tu_min32(max_count, tu_fifo_count(&p_midi->rx_ff) / 4);
+  if (count) {
+    tu_fifo_read_n(&p_midi->rx_ff, packets, (tu_fifo_size_t) (count * 4));
+  }
+
+  rx_restart(p_midi);
+  return count;
+}
+
+bool tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]) {
+  return 1 == tuh_midi_packet_write_n(idx, packet, 1);
+}
+
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const* packets, uint32_t count) {
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi && p_midi->tx.ep_addr, 0);
+
+  // only whole packets
+  count = tu_min32(count, tu_edpt_stream_write_available(&p_midi->tx) / 4);
+  if (count) {
+    tu_edpt_stream_write(&p_midi->tx, packets, count * 4);
+  }
+
+  // send right away for low latency, stream only flushes with a full packet otherwise
+  tu_edpt_stream_write_xfer(&p_midi->tx);
+
+  return count;
+}
+
+//--------------------------------------------------------------------+
+// CLASS-USBH API
+//--------------------------------------------------------------------+
+
+bool midih_init(void) {
+  TU_LOG_DRV("sizeof(midih_interface_t) = %u\r\n", (unsigned int) sizeof(midih_interface_t));
+  tu_memclr(midih_data, sizeof(midih_data));
+
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    midih_interface_t* p_midi = &midih_data[i];
+    tu_fifo_config(&p_midi->rx_ff, p_midi->rx_ff_buf, CFG_TUH_MIDI_RX_BUFSIZE, 1, false);
+    tu_edpt_stream_init(&p_midi->tx, true, true, false,
+                        p_midi->tx_ff_buf, CFG_TUH_MIDI_TX_BUFSIZE,
+                        p_midi->tx_ep_buf, CFG_TUH_MIDI_EP_BUFSIZE);
+  }
+
+  return true;
+}
+
+bool midih_deinit(void) {
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    tu_edpt_stream_deinit(&midih_data[i].tx);
+  }
+  return true;
+}
+
+void midih_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_MIDI; idx++) {
+    midih_interface_t* p_midi = &midih_data[idx];
+    if (p_midi->daddr == daddr) {
+      TU_LOG_DRV("  MIDIh close addr = %u index = %u\r\n", daddr, idx);
+
+      // Invoke application callback
+      if (p_midi->mounted && tuh_midi_umount_cb) tuh_midi_umount_cb(idx);
+
+      p_midi->daddr = 0;
+      p_midi->bInterfaceNumber = 0;
+      p_midi->itf_ms = 0;
+      p_midi->ep_in = 0;
+      p_midi->num_cables_rx = 0;
+      p_midi->num_cables_tx = 0;
+      p_midi->mounted = false;
+      p_midi->rx_stopped = false;
+      tu_fifo_clear(&p_midi->rx_ff);
+      tu_edpt_stream_close(&p_midi->tx);
+    }
+  }
+}
+
+// IN completion can be handled here in ISR context (CFG_TUH_MIDI_XFER_ISR), OUT is deferred to usbh task
+bool midih_xfer_isr(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  midih_interface_t* p_midi = get_itf(idx);
+  if (!p_midi || ep_addr != p_midi->ep_in || result != XFER_RESULT_SUCCESS) return false;
+
+  rx_complete(idx, p_midi, xferred_bytes, true);
+  return true;
+}
+
+bool midih_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_ep_addr(daddr, ep_addr);
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_VERIFY(p_midi);
+
+  if (ep_addr == p_midi->ep_in) {
+    if (result == XFER_RESULT_SUCCESS) {
+      rx_complete(idx, p_midi, xferred_bytes, false);
+    } else {
+      // TODO handle stall response, for now endpoint is retried with next read
+      TU_LOG_DRV("  MIDIh IN failed: %s\r\n", tu_str_xfer_result[result]);
+      p_midi->rx_stopped = true;
+    }
+  } else if (ep_addr == p_midi->tx.ep_addr) {
+    if (tuh_midi_tx_cb) tuh_midi_tx_cb(idx, xferred_bytes);
+
+    if (0 == tu_edpt_stream_write_xfer(&p_midi->tx)) {
+      // If there is no data left, a ZLP should be sent if:
+      // - xferred_bytes is multiple of EP Packet size and not zero
+      tu_edpt_stream_write_zlp_if_needed(&p_midi->tx, xferred_bytes);
+    }
+  } else {
+    TU_ASSERT(false);
+  }
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool midih_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const *desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  // 1st Interface is Audio Control v1, usbh binds it together with the following MIDI Streaming interface
+  TU_VERIFY(TUSB_CLASS_AUDIO               == desc_itf->bInterfaceClass    &&
+            AUDIO_SUBCLASS_CONTROL         == desc_itf->bInterfaceSubClass &&
+            AUDIO_FUNC_PROTOCOL_CODE_UNDEF == desc_itf->bInterfaceProtocol);
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  // Skip Class Specific descriptors of Audio Control
+  p_desc = tu_desc_next(p_desc);
+  while ((p_desc < desc_end) && (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc))) {
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  // 2nd Interface is MIDI Streaming
+  TU_VERIFY(p_desc < desc_end && TUSB_DESC_INTERFACE == tu_desc_type(p_desc));
+  tusb_desc_interface_t const* desc_ms = (tusb_desc_interface_t const*) p_desc;
+  TU_VERIFY(TUSB_CLASS_AUDIO              == desc_ms->bInterfaceClass &&
+            AUDIO_SUBCLASS_MIDI_STREAMING == desc_ms->bInterfaceSubClass);
+
+  midih_interface_t* p_midi = NULL;
+  for (uint8_t i = 0; i < CFG_TUH_MIDI; i++) {
+    if (midih_data[i].daddr == 0) {
+      p_midi = &midih_data[i];
+      break;
+    }
+  }
+  TU_VERIFY(p_midi);
+
+  TU_LOG_DRV("MIDI opening Interface %u (addr = %u)\r\n", desc_itf->bInterfaceNumber, daddr);
+
+  // Endpoints of alternate setting 0, each followed by class specific endpoint with number of embedded jacks.
+  // Following alternate setting (MIDI 2.0) is not used.
+  uint8_t ep_dir = TUSB_DIR_OUT;
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+    if (TUSB_DESC_INTERFACE == desc_type || TUSB_DESC_INTERFACE_ASSOCIATION == desc_type) break;
+
+    if (TUSB_DESC_ENDPOINT == desc_type) {
+      // Note: Audio v1.0's endpoint has 9 bytes instead of 7, starting with the same fields
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+      ep_dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+      if (TUSB_DIR_IN == ep_dir) {
+        p_midi->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        tu_edpt_stream_open(&p_midi->tx, daddr, desc_ep);
+      }
+    } else if (TUSB_DESC_CS_ENDPOINT == desc_type && MIDI_CS_ENDPOINT_GENERAL == p_desc[2]) {
+      uint8_t const num_jacks = p_desc[3];
+      if (TUSB_DIR_IN == ep_dir) {
+        p_midi->num_cables_rx = num_jacks;
+      } else {
+        p_midi->num_cables_tx = num_jacks;
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_midi->ep_in || p_midi->tx.ep_addr);
+
+  p_midi->daddr = daddr;
+  p_midi->bInterfaceNumber = desc_itf->bInterfaceNumber;
+  p_midi->itf_ms = desc_ms->bInterfaceNumber;
+  p_midi->epin_idx = 0;
+  p_midi->rx_stopped = false;
+
+  return true;
+}
+
+bool midih_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_midi_itf_get_index(daddr, itf_num);
+  midih_interface_t* p_midi = get_itf(idx);
+  TU_ASSERT(p_midi);
+
+  TU_LOG_DRV("MIDIh Set Configure complete\r\n");
+  p_midi->mounted = true;
+  if (tuh_midi_mount_cb) tuh_midi_mount_cb(idx, p_midi->num_cables_rx, p_midi->num_cables_tx);
+
+  // Prime IN endpoint
+  if (p_midi->ep_in) {
+    p_midi->rx_stopped = true;
+    rx_restart(p_midi);
+  }
+
+  // notify usbh that driver enumeration is complete, MIDI Streaming interface is bound to this driver
+  usbh_driver_set_config_complete(daddr, p_midi->itf_ms);
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_MIDI_HOST_H_
+#define _TUSB_MIDI_HOST_H_
+
+#include "class/audio/audio.h"
+#include "midi.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// RX FIFO size, should hold at least two endpoint buffers so that the IN endpoint stays primed
+#ifndef CFG_TUH_MIDI_RX_BUFSIZE
+#define CFG_TUH_MIDI_RX_BUFSIZE   (4 * USBH_EPSIZE_BULK_MAX)
+#endif
+
+// TX FIFO size
+#ifndef CFG_TUH_MIDI_TX_BUFSIZE
+#define CFG_TUH_MIDI_TX_BUFSIZE   USBH_EPSIZE_BULK_MAX
+#endif
+
+// Endpoint buffer size, IN endpoint uses two of them alternately
+#ifndef CFG_TUH_MIDI_EP_BUFSIZE
+#define CFG_TUH_MIDI_EP_BUFSIZE   USBH_EPSIZE_BULK_MAX
+#endif
+
+// Process IN transfer complete in ISR context: endpoint is re-armed and tuh_midi_rx_cb() is invoked
+// straight from the completion interrupt, so latency does not depend on tuh_task() scheduling.
+// tuh_midi_rx_cb() must then be ISR-safe.
+#ifndef CFG_TUH_MIDI_XFER_ISR
+#define CFG_TUH_MIDI_XFER_ISR     0
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + Audio Control interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_midi_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Get Interface information of the Audio Control interface
+// return true if index is correct and interface is currently mounted
+bool tuh_midi_itf_get_info(uint8_t idx, tuh_itf_info_t* info);
+
+// Check if a interface is mounted
+bool tuh_midi_mounted(uint8_t idx);
+
+// Number of embedded jacks (virtual cables) of IN (device to host) and OUT (host to device) endpoint
+uint8_t tuh_midi_get_num_rx_cables(uint8_t idx);
+uint8_t tuh_midi_get_num_tx_cables(uint8_t idx);
+
+// Get the number of event packets available for reading
+uint32_t tuh_midi_packet_available(uint8_t idx);
+
+// Read event packet (4 bytes), cable number is in the upper nibble of packet[0]
+bool tuh_midi_packet_read(uint8_t idx, uint8_t packet[4]);
+
+// Read up to max_count event packets (max_count * 4 bytes), return number of packets read
+uint32_t tuh_midi_packet_read_n(uint8_t idx, uint8_t* packets, uint32_t max_count);
+
+// Write event packet (4 bytes), transfer is started immediately if endpoint is idle
+bool tuh_midi_packet_write(uint8_t idx, uint8_t const packet[4]);
+
+// Write array of event packets (count * 4 bytes), return number of packets written
+uint32_t tuh_midi_packet_write_n(uint8_t idx, uint8_t const* packets, uint32_t count);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with MIDI interface is mounted
+TU_ATTR_WEAK void tuh_midi_mount_cb(uint8_t idx, uint8_t num_cables_rx, uint8_t num_cables_tx);
+
+// Invoked when a device with MIDI interface is unmounted
+TU_ATTR_WEAK void tuh_midi_umount_cb(uint8_t idx);
+
+// Invoked when event packets are received, xferred_bytes is the size (multiple of 4) of the completed transfer.
+// Invoked in ISR context if CFG_TUH_MIDI_XFER_ISR is set.
+TU_ATTR_WEAK void tuh_midi_rx_cb(uint8_t idx, uint32_t xferred_bytes);
+
+// Invoked when an OUT transfer is complete
+TU_ATTR_WEAK void tuh_midi_tx_cb(uint8_t idx, uint32_t xferred_bytes);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool midih_init       (void);
+bool midih_deinit     (void);
+bool midih_open       (uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *desc_itf, uint16_t max_len);
+bool midih_set_config (uint8_t dev_addr, uint8_t itf_num);
+bool midih_xfer_cb    (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+bool midih_xfer_isr   (uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void midih_close      (uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_MIDI_HOST_H_ */
@@ -58,7 +58,8 @@ typedef enum
 {
   MSC_PROTOCOL_CBI              = 0 ,  ///< Control/Bulk/Interrupt protocol (with command completion interrupt)
   MSC_PROTOCOL_CBI_NO_INTERRUPT = 1 ,  ///< Control/Bulk/Interrupt protocol (without command completion interrupt)
-  MSC_PROTOCOL_BOT              = 0x50 ///< Bulk-Only Transport
+  MSC_PROTOCOL_BOT              = 0x50,///< Bulk-Only Transport
+  MSC_PROTOCOL_UAS              = 0x62 ///< USB Attached SCSI
 }msc_protocol_type_t;
 
 /// MassStorage Class-Specific Control Request
@@ -103,6 +104,124 @@ typedef struct TU_ATTR_PACKED
 
 TU_VERIFY_STATIC(sizeof(msc_csw_t) == 13, "size is not correct");
 
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS)
+// NOTE: All data in Information Unit (IU) are in Big Endian
+//--------------------------------------------------------------------+
+
+/// UAS Pipe Usage class-specific descriptor type
+enum {
+  MSC_UAS_DESC_TYPE_PIPE_USAGE = 0x24
+};
+
+/// UAS Pipe ID of Pipe Usage descriptor
+enum {
+  MSC_UAS_PIPE_ID_COMMAND  = 1,
+  MSC_UAS_PIPE_ID_STATUS   = 2,
+  MSC_UAS_PIPE_ID_DATA_IN  = 3,
+  MSC_UAS_PIPE_ID_DATA_OUT = 4
+};
+
+/// UAS Information Unit ID
+enum {
+  MSC_UAS_IU_COMMAND     = 0x01,
+  MSC_UAS_IU_SENSE       = 0x03,
+  MSC_UAS_IU_RESPONSE    = 0x04,
+  MSC_UAS_IU_TASK_MGMT   = 0x05,
+  MSC_UAS_IU_READ_READY  = 0x06,
+  MSC_UAS_IU_WRITE_READY = 0x07
+};
+
+/// UAS Task Management Function
+enum {
+  MSC_UAS_TMF_ABORT_TASK        = 0x01,
+  MSC_UAS_TMF_ABORT_TASK_SET    = 0x02,
+  MSC_UAS_TMF_CLEAR_TASK_SET    = 0x04,
+  MSC_UAS_TMF_LUN_RESET         = 0x08,
+  MSC_UAS_TMF_IT_NEXUS_RESET    = 0x10,
+  MSC_UAS_TMF_QUERY_TASK        = 0x80,
+  MSC_UAS_TMF_QUERY_TASK_SET    = 0x81,
+  MSC_UAS_TMF_QUERY_ASYNC_EVENT = 0x82
+};
+
+/// UAS Response Code of Response IU
+enum {
+  MSC_UAS_RC_TMF_COMPLETE      = 0x00,
+  MSC_UAS_RC_INVALID_IU        = 0x02,
+  MSC_UAS_RC_TMF_NOT_SUPPORTED = 0x04,
+  MSC_UAS_RC_TMF_FAILED        = 0x05,
+  MSC_UAS_RC_TMF_SUCCEEDED     = 0x08,
+  MSC_UAS_RC_INCORRECT_LUN     = 0x09,
+  MSC_UAS_RC_OVERLAPPED_TAG    = 0x0A
+};
+
+/// UAS Command IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id        ; ///< \ref MSC_UAS_IU_COMMAND
+  uint8_t  reserved1    ;
+  uint16_t tag          ; ///< Identify the command, echoed back in Read/Write Ready and Sense IU
+  uint8_t  prio_attr    ; ///< Task priority and attribute
+  uint8_t  reserved5    ;
+  uint8_t  add_cdb_len  ; ///< Length of CDB exceeding 16 bytes, in 4-byte unit
+  uint8_t  reserved7    ;
+  uint8_t  lun[8]       ; ///< Logical Unit Number, single level LUN is in lun[1]
+  uint8_t  cdb[16]      ; ///< SCSI Command Descriptor Block
+}msc_uas_cmd_iu_t;
+
+TU_VERIFY_STATIC(sizeof(msc_uas_cmd_iu_t) == 32, "size is not correct");
+
+/// UAS Task Management IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id        ; ///< \ref MSC_UAS_IU_TASK_MGMT
+  uint8_t  reserved1    ;
+  uint16_t tag          ;
+  uint8_t  function     ; ///< Task Management Function
+  uint8_t  reserved5    ;
+  uint16_t task_tag     ; ///< Tag of the command to be managed
+  uint8_t  lun[8]       ;
+}msc_uas_task_mgmt_iu_t;
+
+TU_VERIFY_STATIC(sizeof(msc_uas_task_mgmt_iu_t) == 16, "size is not correct");
+
+/// UAS Read Ready and Write Ready IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id        ; ///< \ref MSC_UAS_IU_READ_READY or \ref MSC_UAS_IU_WRITE_READY
+  uint8_t  reserved1    ;
+  uint16_t tag          ;
+}msc_uas_ready_iu_t;
+
+TU_VERIFY_STATIC(sizeof(msc_uas_ready_iu_t) == 4, "size is not correct");
+
+/// UAS Response IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id        ; ///< \ref MSC_UAS_IU_RESPONSE
+  uint8_t  reserved1    ;
+  uint16_t tag          ;
+  uint8_t  add_rsp_info[3];
+  uint8_t  rsp_code     ; ///< Response Code
+}msc_uas_response_iu_t;
+
+TU_VERIFY_STATIC(sizeof(msc_uas_response_iu_t) == 8, "size is not correct");
+
+/// UAS Sense IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id        ; ///< \ref MSC_UAS_IU_SENSE
+  uint8_t  reserved1    ;
+  uint16_t tag          ;
+  uint16_t status_qualifier;
+  uint8_t  status       ; ///< SCSI status: GOOD (0) or CHECK CONDITION (2)
+  uint8_t  reserved7[7] ;
+  uint16_t length       ; ///< Length of sense data
+  uint8_t  sense_data[18];
+}msc_uas_sense_iu_t;
+
+TU_VERIFY_STATIC(sizeof(msc_uas_sense_iu_t) == 34, "size is not correct");
+
 //--------------------------------------------------------------------+
 // SCSI Constant
 //--------------------------------------------------------------------+
@@ -121,8 +240,37 @@ typedef enum
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests that the device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_SYNCHRONIZE_CACHE_10         = 0x35, ///< The SYNCHRONIZE CACHE (10) command requests that the device server ensure that the specified logical blocks have their most recent data values recorded in non-volatile cache and/or on the medium.
+  SCSI_CMD_WRITE_SAME_10                = 0x41, ///< The WRITE SAME (10) command writes one block of data to a range of blocks, or unmaps the range if UNMAP bit is set.
+  SCSI_CMD_UNMAP                        = 0x42, ///< The UNMAP command requests that the device server deallocate the block ranges listed in the parameter list.
+  SCSI_CMD_READ_16                      = 0x88, ///< The READ (16) command is READ (10) with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< The WRITE (16) command is WRITE (10) with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_WRITE_SAME_16                = 0x93, ///< The WRITE SAME (16) command is WRITE SAME (10) with 64-bit LBA and 32-bit block count.
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< Service action specified in the command e.g \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
+  SCSI_CMD_REPORT_LUNS                  = 0xA0, ///< The REPORT LUNS command requests the logical unit inventory of the target device.
 }scsi_cmd_type_t;
 
+/// SCSI Status, reported by UAS Sense IU
+enum
+{
+  SCSI_STATUS_GOOD            = 0x00,
+  SCSI_STATUS_CHECK_CONDITION = 0x02
+};
+
+/// SCSI Service Action of \ref SCSI_CMD_SERVICE_ACTION_IN_16
+enum
+{
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10, ///< Obtain 64-bit capacity information from a target device.
+};
+
+/// Vital Product Data page code of \ref SCSI_CMD_INQUIRY with EVPD bit set
+enum
+{
+  SCSI_VPD_SUPPORTED_PAGES            = 0x00, ///< List of supported VPD pages
+  SCSI_VPD_BLOCK_LIMITS               = 0xB0, ///< Transfer and unmap limits
+  SCSI_VPD_LOGICAL_BLOCK_PROVISIONING = 0xB2, ///< Thin provisioning capabilities
+};
+
 /// SCSI Sense Key
 typedef enum
 {
@@ -375,6 +523,122 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read Capacity 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< lower 5 bits is \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16
+  uint64_t lba            ; ///< Obsolete, shall be zero
+  uint32_t alloc_length   ; ///< Maximum number of bytes of response data
+  uint8_t  reserved       ;
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t last_lba   ; ///< The last Logical Block Address of the device
+  uint32_t block_size ; ///< Block size in bytes
+
+  uint8_t  prot_en                : 1; ///< Protection information enabled
+  uint8_t  p_type                 : 3; ///< Protection type
+  uint8_t                         : 4;
+
+  uint8_t  lbppbe                 : 4; ///< Logical blocks per physical block exponent
+  uint8_t  p_i_exponent           : 4; ///< Protection information intervals exponent
+
+  uint8_t  lowest_aligned_lba_msb : 6; ///< Lowest aligned LBA, bits 13:8
+  uint8_t  lbprz                  : 1; ///< Unmapped logical blocks read as zero
+  uint8_t  lbpme                  : 1; ///< Logical block provisioning management enabled (UNMAP supported)
+
+  uint8_t  lowest_aligned_lba_lsb    ; ///< Lowest aligned LBA, bits 7:0
+  uint8_t  reserved[16];
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  reserved    ;
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  reserved2   ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
+/// SCSI Write Same 10 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_WRITE_SAME_10
+  uint8_t  flags       ; ///< bit 3 UNMAP
+  uint32_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint8_t  group_number;
+  uint16_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  control     ;
+} scsi_write_same10_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_write_same10_t) == 10, "size is not correct");
+
+/// SCSI Write Same 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_WRITE_SAME_16
+  uint8_t  flags       ; ///< bit 3 UNMAP, bit 0 NDOB (no Data-Out buffer)
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  group_number;
+  uint8_t  control     ;
+} scsi_write_same16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_write_same16_t) == 16, "size is not correct");
+
+/// Flags of \ref scsi_write_same10_t and \ref scsi_write_same16_t
+enum
+{
+  SCSI_WRITE_SAME_FLAG_NDOB  = 0x01,
+  SCSI_WRITE_SAME_FLAG_UNMAP = 0x08,
+};
+
+/// SCSI Unmap Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code          ; ///< SCSI OpCode for \ref SCSI_CMD_UNMAP
+  uint8_t  anchor            ;
+  uint32_t reserved          ;
+  uint8_t  group_number      ;
+  uint16_t param_list_length ; ///< Length of parameter list in Data-Out buffer
+  uint8_t  control           ;
+} scsi_unmap_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_t) == 10, "size is not correct");
+
+/// SCSI Unmap Parameter List Header, followed by block descriptors
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t data_length       ; ///< Bytes following this field
+  uint16_t block_desc_length ; ///< Bytes of block descriptors
+  uint32_t reserved          ;
+} scsi_unmap_param_header_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_param_header_t) == 8, "size is not correct");
+
+/// SCSI Unmap Block Descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) to unmap
+  uint32_t block_count ; ///< Number of blocks to unmap
+  uint32_t reserved    ;
+} scsi_unmap_block_desc_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_block_desc_t) == 16, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
@@ -28,7 +28,6 @@
 
 #if (CFG_TUD_ENABLED && CFG_TUD_MSC)
 
-#include "device/dcd.h"         // for faking dcd_event_xfer_complete
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 
@@ -53,12 +52,32 @@ enum
   MSC_STAGE_NEED_RESET,
 };
 
+#define MSC_BUF_COUNT   (CFG_TUD_MSC_DOUBLE_BUF ? 2 : 1)
+
+// Max bytes of a READ10 transfer from memory mapped media, multiple of highspeed bulk packet size
+#define MSC_READ10_PTR_MAX   (32u*1024u)
+
+#if CFG_TUD_MSC_UAS
+typedef union
+{
+  msc_uas_cmd_iu_t       cmd;
+  msc_uas_task_mgmt_iu_t task_mgmt;
+} mscd_uas_cmd_iu_t;
+
+typedef union
+{
+  msc_uas_sense_iu_t    sense;
+  msc_uas_response_iu_t response;
+  msc_uas_ready_iu_t    ready;
+} mscd_uas_status_iu_t;
+#endif
+
 typedef struct
 {
-  // TODO optimize alignment
-  CFG_TUSB_MEM_ALIGN msc_cbw_t cbw;
-  CFG_TUSB_MEM_ALIGN msc_csw_t csw;
+  TUD_EPBUF_TYPE_DEF(msc_cbw_t, cbw);
+  TUD_EPBUF_TYPE_DEF(msc_csw_t, csw);
 
+  uint8_t  rhport;
   uint8_t  itf_num;
   uint8_t  ep_in;
   uint8_t  ep_out;
@@ -68,29 +87,144 @@ typedef struct
   uint32_t total_len;   // byte to be transferred, can be smaller than total_bytes in cbw
   uint32_t xferred_len; // numbered of bytes transferred so far in the Data Stage
 
+  // READ10/WRITE10 buffers: USB transfer uses usb_idx, media I/O (callback) uses io_idx
+  bool     pending_io;  // waiting for tud_msc_async_io_done()
+  bool     usb_busy;    // USB transfer on buffer usb_idx is in progress
+  uint8_t  usb_idx;
+  uint8_t  io_idx;
+  uint16_t buf_len[MSC_BUF_COUNT]; // READ10: read but not yet sent, WRITE10: received but not yet written
+  uint8_t const* buf_ptr[MSC_BUF_COUNT]; // READ10: memory mapped media data, NULL if in class buffer
+  uint32_t io_pos;      // READ10: bytes read from media, WRITE10: bytes requested from host
+
   // Sense Response Data
   uint8_t sense_key;
   uint8_t add_sense_code;
   uint8_t add_sense_qualifier;
+
+  #if CFG_TUD_MSC_UAS
+  // USB Attached SCSI (UAS) Protocol on alternate setting 1
+  TUD_EPBUF_TYPE_DEF(mscd_uas_cmd_iu_t, uas_cmd_iu);       // received on command pipe
+  TUD_EPBUF_TYPE_DEF(mscd_uas_status_iu_t, uas_status_iu); // sent on status pipe
+
+  msc_uas_cmd_iu_t uas_queue[CFG_TUD_MSC_UAS_QUEUE_DEPTH]; // received commands waiting to be executed
+
+  uint8_t const* desc_bot; // alternate setting 0
+  uint8_t const* desc_uas; // alternate setting 1, NULL if not available
+  uint16_t desc_uas_len;
+
+  uint8_t  alt_itf;
+  uint8_t  ep_cmd;
+  uint8_t  ep_status;
+  uint8_t  uas_queue_rd;
+  uint8_t  uas_queue_count;
+  bool     uas_ready_pending; // Read/Write Ready IU of current command is not yet sent
+  bool     uas_rsp_pending;   // Response IU is not yet sent
+  uint8_t  uas_rsp_code;
+  uint16_t uas_rsp_tag;
+  #endif
 }mscd_interface_t;
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static mscd_interface_t _mscd_itf;
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t _mscd_buf[CFG_TUD_MSC_EP_BUFSIZE];
+#if CFG_TUD_BUF_POOL_ENABLED
+// taken from usbd buffer pool in mscd_open()
+tu_static uint8_t* _mscd_rdwr_buf[MSC_BUF_COUNT];
+#define _mscd_buf   (_mscd_rdwr_buf[0])
+#else
+typedef struct
+{
+  TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE);
+  #if CFG_TUD_MSC_DOUBLE_BUF
+  TUD_EPBUF_DEF(buf_alt, CFG_TUD_MSC_EP_BUFSIZE);
+  #endif
+}mscd_epbuf_t;
+
+CFG_TUD_MEM_SECTION tu_static mscd_epbuf_t _mscd_epbuf;
+#define _mscd_buf       (_mscd_epbuf.buf)
+#define _mscd_buf_alt   (_mscd_epbuf.buf_alt)
+
+tu_static uint8_t* const _mscd_rdwr_buf[MSC_BUF_COUNT] =
+{
+  _mscd_buf,
+  #if CFG_TUD_MSC_DOUBLE_BUF
+  _mscd_buf_alt,
+  #endif
+};
+#endif
+
+#if CFG_TUD_MSC_CACHE_LINES
+typedef struct
+{
+  uint32_t lba;        // first block of line
+  uint32_t last_use;   // for least recently used eviction
+  uint16_t block_size;
+  uint16_t len;        // smaller than line size at end of media
+  uint16_t valid_len;  // bytes from start of line that are up to date, the rest is read from media when needed
+  uint8_t  lun;
+  bool     used;
+  bool     dirty;
+}mscd_cache_line_t;
+
+tu_static mscd_cache_line_t _mscd_cache[CFG_TUD_MSC_CACHE_LINES];
+tu_static uint32_t _mscd_cache_use_count;
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN TUD_EPBUF_DCACHE_ALIGNED
+tu_static uint8_t _mscd_cache_buf[CFG_TUD_MSC_CACHE_LINES][TUD_EPBUF_DCACHE_SIZE(CFG_TUD_MSC_CACHE_LINE_SIZE)];
+
+#if CFG_TUD_MSC_CACHE_FLUSH_SOF
+tu_static volatile uint16_t _mscd_cache_flush_sof; // SOF count down to idle flush, 0 if not armed
+#endif
+#endif
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
-static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
-
-static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
-static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static int32_t proc_inquiry_vpd(uint8_t lun, uint8_t page_code, uint8_t* buffer, uint32_t bufsize);
+static bool is_unmap_cmd(uint8_t const scsi_cmd[16]);
+static bool proc_unmap_cmd(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t const* param, uint32_t param_len);
+static void proc_rdwr10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+
+static void proc_read10_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static bool proc_read10_io_data(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes);
+static void proc_read10_pump(uint8_t rhport, mscd_interface_t* p_msc);
+
+static bool proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_write10_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes);
+static bool proc_write10_io_data(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes);
+static void proc_write10_pump(uint8_t rhport, mscd_interface_t* p_msc);
+
+static void proc_scsi_cmd(uint8_t rhport, mscd_interface_t* p_msc);
+static void proc_scsi_in_resp(uint8_t rhport, mscd_interface_t* p_msc, int32_t resplen);
+static void proc_scsi_out_done(uint8_t rhport, mscd_interface_t* p_msc, int32_t cb_result);
+static void proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc);
+
+#if CFG_TUD_MSC_UAS
+static bool uas_set_alt(uint8_t rhport, mscd_interface_t* p_msc, uint8_t alt);
+static void uas_proc_status(uint8_t rhport, mscd_interface_t* p_msc);
+#endif
 
 TU_ATTR_ALWAYS_INLINE static inline bool is_data_in(uint8_t dir)
 {
   return tu_bit_test(dir, 7);
 }
 
+// USB Attached SCSI (alternate setting 1) is active
+TU_ATTR_ALWAYS_INLINE static inline bool is_uas(mscd_interface_t const* p_msc)
+{
+#if CFG_TUD_MSC_UAS
+  return p_msc->alt_itf == 1;
+#else
+  (void) p_msc;
+  return false;
+#endif
+}
+
+static inline uint8_t get_maxlun(void)
+{
+  uint8_t maxlun = 1;
+  if (tud_msc_get_maxlun_cb) maxlun = tud_msc_get_maxlun_cb();
+  return maxlun;
+}
+
 static inline bool send_csw(uint8_t rhport, mscd_interface_t* p_msc)
 {
   // Data residue is always = host expect - actual transferred
@@ -118,6 +252,9 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   // failed but sense key is not set: default to Illegal Request
   if ( p_msc->sense_key == 0 ) tud_msc_set_sense(p_cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
 
+  // UAS does not stall data pipes, Sense IU is sent once the pending data transfer is complete
+  if ( is_uas(p_msc) ) return;
+
   // If there is data stage and not yet complete, stall it
   if ( p_cbw->total_bytes && p_csw->data_residue )
   {
@@ -132,17 +269,50 @@ static void fail_scsi_op(uint8_t rhport, mscd_interface_t* p_msc, uint8_t status
   }
 }
 
-static inline uint32_t rdwr10_get_lba(uint8_t const command[])
+TU_ATTR_ALWAYS_INLINE static inline bool is_read_cmd(uint8_t cmd)
 {
-  // use offsetof to avoid pointer to the odd/unaligned address
-  uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
+  return (cmd == SCSI_CMD_READ_10) || (cmd == SCSI_CMD_READ_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_write_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_WRITE_10) || (cmd == SCSI_CMD_WRITE_16);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_rdwr16_cmd(uint8_t cmd)
+{
+  return (cmd == SCSI_CMD_READ_16) || (cmd == SCSI_CMD_WRITE_16);
+}
+
+// 64-bit Big Endian field of SCSI command or parameter data
+static inline uint64_t scsi_read_u64(uint8_t const* p)
+{
+  uint32_t const hi = tu_ntohl(tu_unaligned_read32(p));
+  uint32_t const lo = tu_ntohl(tu_unaligned_read32(p + 4));
+  return (((uint64_t) hi) << 32) | lo;
+}
+
+// Get LBA of READ10/WRITE10 or READ16/WRITE16
+static inline uint64_t rdwr10_get_lba(uint8_t const command[])
+{
+  // use offsetof to avoid pointer to the odd/unaligned address, lba is in Big Endian
+  if ( is_rdwr16_cmd(command[0]) )
+  {
+    return scsi_read_u64(command + offsetof(scsi_write16_t, lba));
+  }
 
-  // lba is in Big Endian
+  uint32_t const lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
   return tu_ntohl(lba);
 }
 
-static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw)
+static inline uint32_t rdwr10_get_blockcount(msc_cbw_t const* cbw)
 {
+  if ( is_rdwr16_cmd(cbw->command[0]) )
+  {
+    uint32_t const block_count = tu_unaligned_read32(cbw->command + offsetof(scsi_write16_t, block_count));
+    return tu_ntohl(block_count);
+  }
+
   uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
   return tu_ntohs(block_count);
 }
@@ -150,7 +320,7 @@ static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw)
 static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw)
 {
   // first extract block count in the command
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr10_get_blockcount(cbw);
 
   // invalid block count
   if (block_count == 0) return 0;
@@ -161,7 +331,8 @@ static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw)
 uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
 {
   uint8_t status = MSC_CSW_STATUS_PASSED;
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr10_get_blockcount(cbw);
+  uint64_t const lba = rdwr10_get_lba(cbw->command);
 
   if ( cbw->total_bytes == 0 )
   {
@@ -175,12 +346,12 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
     }
   }else
   {
-    if ( SCSI_CMD_READ_10 == cbw->command[0] && !is_data_in(cbw->dir) )
+    if ( is_read_cmd(cbw->command[0]) && !is_data_in(cbw->dir) )
     {
       TU_LOG_DRV("  SCSI case 10 (Ho <> Di)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
-    else if ( SCSI_CMD_WRITE_10 == cbw->command[0] && is_data_in(cbw->dir) )
+    else if ( is_write_cmd(cbw->command[0]) && is_data_in(cbw->dir) )
     {
       TU_LOG_DRV("  SCSI case 8 (Hi <> Do)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
@@ -195,6 +366,13 @@ uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw)
       TU_LOG_DRV(" Computed block size = 0. SCSI case 7 Hi < Di (READ10) or case 13 Ho < Do (WRIT10)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     }
+    else if ( (lba > UINT32_MAX) || (lba + block_count > ((uint64_t) UINT32_MAX) + 1) )
+    {
+      // callbacks use 32-bit LBA, reject READ16/WRITE16 beyond that
+      TU_LOG_DRV("  LBA out of range\r\n");
+      tud_msc_set_sense(cbw->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+      status = MSC_CSW_STATUS_FAILED;
+    }
   }
 
   return status;
@@ -217,7 +395,12 @@ TU_ATTR_UNUSED tu_static tu_lookup_entry_t const _msc_scsi_cmd_lookup[] =
   { .key = SCSI_CMD_REQUEST_SENSE                , .data = "Request Sense" },
   { .key = SCSI_CMD_READ_FORMAT_CAPACITY         , .data = "Read Format Capacity" },
   { .key = SCSI_CMD_READ_10                      , .data = "Read10" },
-  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" }
+  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_10         , .data = "Synchronize Cache10" },
+  { .key = SCSI_CMD_READ_16                      , .data = "Read16" },
+  { .key = SCSI_CMD_WRITE_16                     , .data = "Write16" },
+  { .key = SCSI_CMD_SERVICE_ACTION_IN_16         , .data = "Service Action In16" },
+  { .key = SCSI_CMD_REPORT_LUNS                  , .data = "Report LUNs" }
 };
 
 TU_ATTR_UNUSED tu_static tu_lookup_table_t const _msc_scsi_cmd_table =
@@ -242,12 +425,330 @@ bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, u
   return true;
 }
 
+msc_cbw_t const* tud_msc_get_cbw(void)
+{
+  return &_mscd_itf.cbw;
+}
+
 static inline void set_sense_medium_not_present(uint8_t lun)
 {
   // default sense is NOT READY, MEDIUM NOT PRESENT
   tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
 }
 
+// current sense in fixed format
+static void get_sense_fixed(mscd_interface_t const* p_msc, scsi_sense_fixed_resp_t* sense_rsp)
+{
+  tu_memclr(sense_rsp, sizeof(scsi_sense_fixed_resp_t));
+
+  sense_rsp->response_code       = 0x70; // current, fixed format
+  sense_rsp->valid               = 1;
+  sense_rsp->add_sense_len       = sizeof(scsi_sense_fixed_resp_t) - 8;
+  sense_rsp->sense_key           = (uint8_t) (p_msc->sense_key & 0x0F);
+  sense_rsp->add_sense_code      = p_msc->add_sense_code;
+  sense_rsp->add_sense_qualifier = p_msc->add_sense_qualifier;
+}
+
+// Continue READ10/WRITE10 or other SCSI command in usbd task once asynchronous I/O is done
+static void proc_async_io_done(void* bytes_io)
+{
+  mscd_interface_t* p_msc = &_mscd_itf;
+  uint8_t const rhport = p_msc->rhport;
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+  int32_t const nbytes = (int32_t) (intptr_t) bytes_io;
+
+  // operation could be aborted by bus reset or BOT reset meanwhile
+  TU_VERIFY(p_msc->pending_io && p_msc->stage == MSC_STAGE_DATA, );
+  p_msc->pending_io = false;
+
+  if ( is_read_cmd(p_cbw->command[0]) )
+  {
+    if ( proc_read10_io_data(rhport, p_msc, nbytes) ) proc_read10_pump(rhport, p_msc);
+  }else if ( is_write_cmd(p_cbw->command[0]) )
+  {
+    if ( proc_write10_io_data(rhport, p_msc, nbytes) ) proc_write10_pump(rhport, p_msc);
+  }else if ( p_cbw->total_bytes && !is_data_in(p_cbw->dir) )
+  {
+    proc_scsi_out_done(rhport, p_msc, nbytes);
+  }else
+  {
+    proc_scsi_in_resp(rhport, p_msc, nbytes);
+  }
+
+  proc_stage_status(rhport, p_msc);
+}
+
+// Application is busy, invoke READ10/WRITE10 callback again later
+static void proc_rdwr10_retry(void* param)
+{
+  (void) param;
+  mscd_interface_t* p_msc = &_mscd_itf;
+  uint8_t const rhport = p_msc->rhport;
+
+  TU_VERIFY(!p_msc->pending_io && p_msc->stage == MSC_STAGE_DATA, );
+
+  if ( is_read_cmd(p_msc->cbw.command[0]) )
+  {
+    proc_read10_pump(rhport, p_msc);
+  }else if ( is_write_cmd(p_msc->cbw.command[0]) )
+  {
+    proc_write10_pump(rhport, p_msc);
+  }
+
+  proc_stage_status(rhport, p_msc);
+}
+
+bool tud_msc_async_io_done(uint8_t lun, int32_t bytes_io, bool in_isr)
+{
+  mscd_interface_t* p_msc = &_mscd_itf;
+  TU_VERIFY(p_msc->pending_io && lun == p_msc->cbw.lun);
+  TU_VERIFY(bytes_io != TUD_MSC_RET_ASYNC);
+
+  usbd_defer_func(proc_async_io_done, (void*) (intptr_t) bytes_io, in_isr);
+  return true;
+}
+
+#if CFG_TUD_MSC_CACHE_LINES
+//--------------------------------------------------------------------+
+// Write-back Cache
+// A line caches CFG_TUD_MSC_CACHE_LINE_SIZE bytes aligned on media. Only its first valid_len bytes are up to date,
+// sequential writes from start of line therefore do not need to read the line from media first.
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* cache_get_buf(mscd_cache_line_t const* line)
+{
+  return _mscd_cache_buf[line - _mscd_cache];
+}
+
+// line must hold whole blocks, otherwise media is accessed directly
+TU_ATTR_ALWAYS_INLINE static inline bool cache_is_usable(uint16_t block_size)
+{
+  return block_size && (block_size <= CFG_TUD_MSC_CACHE_LINE_SIZE) && ((CFG_TUD_MSC_CACHE_LINE_SIZE % block_size) == 0);
+}
+
+// position of block/offset in its cache line, also return first block of the line
+static uint32_t cache_get_pos(uint16_t block_size, uint32_t lba, uint32_t offset, uint32_t* line_lba)
+{
+  uint32_t const blocks_per_line = CFG_TUD_MSC_CACHE_LINE_SIZE / block_size;
+  *line_lba = lba - (lba % blocks_per_line);
+  return (lba - *line_lba) * block_size + offset;
+}
+
+static mscd_cache_line_t* cache_find(uint8_t lun, uint16_t block_size, uint32_t line_lba)
+{
+  for(uint8_t i=0; i<CFG_TUD_MSC_CACHE_LINES; i++)
+  {
+    mscd_cache_line_t* line = &_mscd_cache[i];
+    if ( line->used && line->lun == lun && line->lba == line_lba && line->block_size == block_size ) return line;
+  }
+  return NULL;
+}
+
+// read or write part of the line from/to media synchronously
+static bool cache_media_io(mscd_cache_line_t const* line, bool is_write, uint32_t pos, uint32_t len)
+{
+  uint8_t* buf = cache_get_buf(line);
+
+  while ( len )
+  {
+    uint32_t const lba    = line->lba + pos / line->block_size;
+    uint32_t const offset = pos % line->block_size;
+
+    int32_t const nbytes = is_write ? tud_msc_write10_cb(line->lun, lba, offset, buf + pos, len) :
+                                      tud_msc_read10_cb (line->lun, lba, offset, buf + pos, len);
+
+    // busy or asynchronous I/O can not be used
+    TU_VERIFY(nbytes > 0 && (uint32_t) nbytes <= len);
+
+    pos += (uint32_t) nbytes;
+    len -= (uint32_t) nbytes;
+  }
+
+  return true;
+}
+
+// bring line up to date until end
+static bool cache_fill(mscd_cache_line_t* line, uint16_t end)
+{
+  if ( line->valid_len < end )
+  {
+    TU_VERIFY( cache_media_io(line, false, line->valid_len, (uint32_t) (end - line->valid_len)) );
+    line->valid_len = end;
+  }
+  return true;
+}
+
+static bool cache_flush_line(mscd_cache_line_t* line)
+{
+  if ( line->dirty )
+  {
+    TU_VERIFY( cache_fill(line, line->len) );
+    TU_VERIFY( cache_media_io(line, true, 0, line->len) );
+    line->dirty = false;
+  }
+  return true;
+}
+
+// flush dirty lines of lun, or all luns if lun is 0xFF
+static bool cache_flush(uint8_t lun)
+{
+  bool ret = true;
+  for(uint8_t i=0; i<CFG_TUD_MSC_CACHE_LINES; i++)
+  {
+    mscd_cache_line_t* line = &_mscd_cache[i];
+    if ( line->used && (lun == 0xFF || line->lun == lun) )
+    {
+      if ( !cache_flush_line(line) ) ret = false;
+    }
+  }
+
+  #if CFG_TUD_MSC_CACHE_FLUSH_SOF
+  if (ret) _mscd_cache_flush_sof = 0;
+  #endif
+
+  return ret;
+}
+
+// evict least recently used line for new one
+static mscd_cache_line_t* cache_alloc(uint8_t lun, uint16_t block_size, uint32_t line_lba)
+{
+  mscd_cache_line_t* line = &_mscd_cache[0];
+  for(uint8_t i=1; i<CFG_TUD_MSC_CACHE_LINES && line->used; i++)
+  {
+    mscd_cache_line_t* cur = &_mscd_cache[i];
+    if ( !cur->used || (_mscd_cache_use_count - cur->last_use) > (_mscd_cache_use_count - line->last_use) ) line = cur;
+  }
+
+  TU_VERIFY( cache_flush_line(line), NULL );
+
+  // line does not go past end of media
+  uint32_t block_count = 0;
+  uint16_t lun_block_size = 0;
+  tud_msc_capacity_cb(lun, &block_count, &lun_block_size);
+  TU_VERIFY(line_lba < block_count, NULL);
+
+  line->used       = true;
+  line->dirty      = false;
+  line->lun        = lun;
+  line->lba        = line_lba;
+  line->block_size = block_size;
+  line->len        = (uint16_t) tu_min32(CFG_TUD_MSC_CACHE_LINE_SIZE, (block_count - line_lba) * block_size);
+  line->valid_len  = 0;
+
+  return line;
+}
+
+// READ10 chunk: return true and set *ptr if it is in cache. Otherwise *len is capped at end of the line
+// so that media read never includes data that is newer in cache
+static bool cache_read(uint8_t lun, uint16_t block_size, uint32_t lba, uint32_t offset, uint8_t const** ptr, uint32_t* len)
+{
+  TU_VERIFY( cache_is_usable(block_size) );
+
+  uint32_t line_lba;
+  uint32_t const pos = cache_get_pos(block_size, lba, offset, &line_lba);
+  mscd_cache_line_t* line = cache_find(lun, block_size, line_lba);
+
+  if ( line && pos < line->valid_len )
+  {
+    line->last_use = ++_mscd_cache_use_count;
+    *ptr = cache_get_buf(line) + pos;
+    *len = tu_min32(*len, line->valid_len - pos);
+    return true;
+  }
+
+  *len = tu_min32(*len, CFG_TUD_MSC_CACHE_LINE_SIZE - pos);
+  return false;
+}
+
+// WRITE10 chunk: merge data into cache, return number of bytes written or TUD_MSC_RET_ERROR
+static int32_t cache_write(uint8_t lun, uint16_t block_size, uint32_t lba, uint32_t offset, uint8_t* buf, uint32_t len)
+{
+  if ( !cache_is_usable(block_size) ) return tud_msc_write10_cb(lun, lba, offset, buf, len);
+
+  uint32_t written = 0;
+
+  while ( written < len )
+  {
+    uint32_t line_lba;
+    uint32_t const pos = cache_get_pos(block_size, lba + (offset + written) / block_size, (offset + written) % block_size, &line_lba);
+
+    mscd_cache_line_t* line = cache_find(lun, block_size, line_lba);
+    if ( !line ) line = cache_alloc(lun, block_size, line_lba);
+    TU_VERIFY(line && pos < line->len, TUD_MSC_RET_ERROR);
+
+    // skipped data must be read from media first
+    TU_VERIFY( cache_fill(line, (uint16_t) pos), TUD_MSC_RET_ERROR );
+
+    uint32_t const count = tu_min32(len - written, line->len - pos);
+    memcpy(cache_get_buf(line) + pos, buf + written, count);
+
+    line->valid_len = (uint16_t) tu_max32(line->valid_len, pos + count);
+    line->dirty     = true;
+    line->last_use  = ++_mscd_cache_use_count;
+    written += count;
+  }
+
+  #if CFG_TUD_MSC_CACHE_FLUSH_SOF
+  _mscd_cache_flush_sof = CFG_TUD_MSC_CACHE_FLUSH_SOF;
+  #endif
+
+  return (int32_t) written;
+}
+
+// flush and forget cached data e.g media could be changed while disconnected
+static void cache_flush_invalidate(void)
+{
+  if ( !cache_flush(0xFF) )
+  {
+    TU_LOG_DRV("  MSC cache flush failed\r\n");
+  }
+  tu_memclr(_mscd_cache, sizeof(_mscd_cache));
+}
+
+#if CFG_TUD_MSC_CACHE_FLUSH_SOF
+// flush in usbd task when host is idle
+static void cache_flush_deferred(void* param)
+{
+  (void) param;
+  mscd_interface_t const* p_msc = &_mscd_itf;
+
+  if ( p_msc->pending_io || p_msc->stage == MSC_STAGE_DATA )
+  {
+    // busy with a command, try again later
+    _mscd_cache_flush_sof = CFG_TUD_MSC_CACHE_FLUSH_SOF;
+  }else if ( !cache_flush(0xFF) )
+  {
+    TU_LOG_DRV("  MSC cache flush failed\r\n");
+  }
+}
+
+// Invoked in ISR context
+void mscd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  uint16_t const remain = _mscd_cache_flush_sof;
+  if ( remain )
+  {
+    _mscd_cache_flush_sof = (uint16_t) (remain - 1);
+
+    // deadline reached, flush in usbd task since it can not be done in ISR
+    if ( remain == 1 ) usbd_defer_func(cache_flush_deferred, NULL, true);
+  }
+}
+#endif
+#endif
+
+bool tud_msc_cache_flush(void)
+{
+#if CFG_TUD_MSC_CACHE_LINES
+  return cache_flush(0xFF);
+#else
+  return true;
+#endif
+}
+
 //--------------------------------------------------------------------+
 // USBD Driver API
 //--------------------------------------------------------------------+
@@ -263,6 +764,11 @@ bool mscd_deinit(void) {
 void mscd_reset(uint8_t rhport)
 {
   (void) rhport;
+
+  #if CFG_TUD_MSC_CACHE_LINES
+  cache_flush_invalidate();
+  #endif
+
   tu_memclr(&_mscd_itf, sizeof(mscd_interface_t));
 }
 
@@ -274,17 +780,59 @@ uint16_t mscd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
             MSC_PROTOCOL_BOT  == itf_desc->bInterfaceProtocol, 0);
 
   // msc driver length is fixed
-  uint16_t const drv_len = sizeof(tusb_desc_interface_t) + 2*sizeof(tusb_desc_endpoint_t);
+  uint16_t drv_len = sizeof(tusb_desc_interface_t) + 2*sizeof(tusb_desc_endpoint_t);
 
   // Max length must be at least 1 interface + 2 endpoints
   TU_ASSERT(max_len >= drv_len, 0);
 
   mscd_interface_t * p_msc = &_mscd_itf;
+  p_msc->rhport  = rhport;
   p_msc->itf_num = itf_desc->bInterfaceNumber;
 
+  #if CFG_TUD_BUF_POOL_ENABLED
+  for (uint8_t i = 0; i < MSC_BUF_COUNT; i++) {
+    _mscd_rdwr_buf[i] = (uint8_t*) usbd_buf_alloc(CFG_TUD_MSC_EP_BUFSIZE);
+    TU_ASSERT(_mscd_rdwr_buf[i], 0);
+  }
+  #endif
+
   // Open endpoint pair
   TU_ASSERT( usbd_open_edpt_pair(rhport, tu_desc_next(itf_desc), 2, TUSB_XFER_BULK, &p_msc->ep_out, &p_msc->ep_in), 0 );
 
+  #if CFG_TUD_MSC_UAS
+  p_msc->desc_bot = (uint8_t const*) itf_desc;
+
+  // UAS as alternate setting 1, endpoints are opened when it is selected by host
+  uint8_t const* p_desc   = ((uint8_t const*) itf_desc) + drv_len;
+  uint8_t const* desc_end = ((uint8_t const*) itf_desc) + max_len;
+  tusb_desc_interface_t const* uas_desc = (tusb_desc_interface_t const*) p_desc;
+
+  if ( (p_desc < desc_end) && (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) &&
+       (uas_desc->bInterfaceNumber   == itf_desc->bInterfaceNumber) &&
+       (uas_desc->bAlternateSetting  == 1) &&
+       (uas_desc->bInterfaceClass    == TUSB_CLASS_MSC) &&
+       (uas_desc->bInterfaceProtocol == MSC_PROTOCOL_UAS) &&
+       (uas_desc->bNumEndpoints      == 4) )
+  {
+    // endpoints with their Pipe Usage descriptors until next interface
+    p_desc = tu_desc_next(p_desc);
+    while ( (p_desc < desc_end) && (TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) &&
+            (TUSB_DESC_INTERFACE_ASSOCIATION != tu_desc_type(p_desc)) )
+    {
+      p_desc = tu_desc_next(p_desc);
+    }
+
+    p_msc->desc_uas     = (uint8_t const*) uas_desc;
+    p_msc->desc_uas_len = (uint16_t) (p_desc - p_msc->desc_uas);
+    drv_len += p_msc->desc_uas_len;
+  }
+  #endif
+
+  #if CFG_TUD_MSC_CACHE_LINES && CFG_TUD_MSC_CACHE_FLUSH_SOF
+  // SOF drives idle flush of cache
+  usbd_sof_subscribe(rhport, mscd_sof, 1);
+  #endif
+
   // Prepare for Command Block Wrapper
   TU_ASSERT( prepare_cbw(rhport, p_msc), drv_len);
 
@@ -296,6 +844,7 @@ static void proc_bot_reset(mscd_interface_t* p_msc)
   p_msc->stage       = MSC_STAGE_CMD;
   p_msc->total_len   = 0;
   p_msc->xferred_len = 0;
+  p_msc->pending_io  = false;
 
   p_msc->sense_key           = 0;
   p_msc->add_sense_code      = 0;
@@ -320,7 +869,11 @@ bool mscd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
   {
     uint8_t const ep_addr = tu_u16_low(request->wIndex);
 
-    if ( p_msc->stage == MSC_STAGE_NEED_RESET )
+    if ( is_uas(p_msc) )
+    {
+      // UAS never stalls its pipes, nothing to recover
+    }
+    else if ( p_msc->stage == MSC_STAGE_NEED_RESET )
     {
       // reset recovery is required to recover from this stage
       // Clear Stall request cannot resolve this -> continue to stall endpoint
@@ -353,6 +906,30 @@ bool mscd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
     return true;
   }
 
+  #if CFG_TUD_MSC_UAS
+  // Alternate setting 0 is BOT, 1 is UAS
+  if ( TUSB_REQ_TYPE_STANDARD  == request->bmRequestType_bit.type &&
+       TUSB_REQ_RCPT_INTERFACE == request->bmRequestType_bit.recipient )
+  {
+    switch ( request->bRequest )
+    {
+      case TUSB_REQ_GET_INTERFACE:
+        tud_control_xfer(rhport, request, &p_msc->alt_itf, 1);
+      break;
+
+      case TUSB_REQ_SET_INTERFACE:
+        TU_LOG_DRV("  MSC Set Alternate %u\r\n", request->wValue);
+        TU_VERIFY( uas_set_alt(rhport, p_msc, (uint8_t) request->wValue) );
+        tud_control_status(rhport, request);
+      break;
+
+      default: return false;
+    }
+
+    return true;
+  }
+  #endif
+
   // From this point only handle class request only
   TU_VERIFY(request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS);
 
@@ -373,8 +950,7 @@ bool mscd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       TU_LOG_DRV("  MSC Get Max Lun\r\n");
       TU_VERIFY(request->wValue == 0 && request->wLength == 1);
 
-      uint8_t maxlun = 1;
-      if (tud_msc_get_maxlun_cb) maxlun = tud_msc_get_maxlun_cb();
+      uint8_t maxlun = get_maxlun();
       TU_VERIFY(maxlun);
 
       // MAX LUN is minus 1 by specs
@@ -390,188 +966,705 @@ bool mscd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
   return true;
 }
 
-bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes)
+// Parse SCSI command in cbw and prepare DATA stage
+static void proc_scsi_cmd(uint8_t rhport, mscd_interface_t* p_msc)
 {
-  (void) event;
-
-  mscd_interface_t* p_msc = &_mscd_itf;
   msc_cbw_t const * p_cbw = &p_msc->cbw;
-  msc_csw_t       * p_csw = &p_msc->csw;
 
-  switch (p_msc->stage)
+  p_msc->stage = MSC_STAGE_DATA;
+  p_msc->total_len = p_cbw->total_bytes;
+  p_msc->xferred_len = 0;
+
+  // Read10 or Write10
+  if ( is_read_cmd(p_cbw->command[0]) || is_write_cmd(p_cbw->command[0]) )
   {
-    case MSC_STAGE_CMD:
-      //------------- new CBW received -------------//
-      // Complete IN while waiting for CMD is usually Status of previous SCSI op, ignore it
-      if(ep_addr != p_msc->ep_out) return true;
+    uint8_t const status = rdwr10_validate_cmd(p_cbw);
 
-      if ( !(xferred_bytes == sizeof(msc_cbw_t) && p_cbw->signature == MSC_CBW_SIGNATURE) )
+    if ( status != MSC_CSW_STATUS_PASSED)
+    {
+      fail_scsi_op(rhport, p_msc, status);
+    }else if ( p_cbw->total_bytes )
+    {
+      proc_rdwr10_cmd(rhport, p_msc);
+    }else
+    {
+      // no data transfer, only exist in complaint test suite
+      p_msc->stage = MSC_STAGE_STATUS;
+    }
+  }
+  else
+  {
+    // For other SCSI commands
+    // 1. OUT : queue transfer (invoke app callback after done)
+    // 2. IN & Zero: Process if is built-in, else Invoke app callback. Skip DATA if zero length
+    if ( (p_cbw->total_bytes > 0 ) && !is_data_in(p_cbw->dir) )
+    {
+      if (p_cbw->total_bytes > CFG_TUD_MSC_EP_BUFSIZE)
       {
-        TU_LOG_DRV("  SCSI CBW is not valid\r\n");
-
-        // BOT 6.6.1 If CBW is not valid stall both endpoints until reset recovery
-        p_msc->stage = MSC_STAGE_NEED_RESET;
+        TU_LOG_DRV("  SCSI reject non READ10/WRITE10 with large data\r\n");
+        fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+      }else
+      {
+        // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
+        // but it is OK to just receive data then responded with failed status
+        p_msc->usb_busy = true;
+        TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, (uint16_t) p_msc->total_len), );
+      }
+    }else
+    {
+      // First process if it is a built-in commands
+      int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_buf, CFG_TUD_MSC_EP_BUFSIZE);
 
-        // invalid CBW stall both endpoints
-        usbd_edpt_stall(rhport, p_msc->ep_in);
-        usbd_edpt_stall(rhport, p_msc->ep_out);
+      // Invoke user callback if not built-in
+      if ( (resplen < 0) && (p_msc->sense_key == 0) )
+      {
+        p_msc->pending_io = true;
+        resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
 
-        return false;
+        // response is completed later with tud_msc_async_io_done()
+        if ( resplen == TUD_MSC_RET_ASYNC ) return;
+        p_msc->pending_io = false;
       }
 
-      TU_LOG_DRV("  SCSI Command [Lun%u]: %s\r\n", p_cbw->lun, tu_lookup_find(&_msc_scsi_cmd_table, p_cbw->command[0]));
-      //TU_LOG_MEM(MSC_DEBUG, p_cbw, xferred_bytes, 2);
+      proc_scsi_in_resp(rhport, p_msc, resplen);
+    }
+  }
+}
 
-      p_csw->signature    = MSC_CSW_SIGNATURE;
-      p_csw->tag          = p_cbw->tag;
-      p_csw->data_residue = 0;
-      p_csw->status       = MSC_CSW_STATUS_PASSED;
+// Respond to IN or no-data SCSI command with resplen bytes prepared in _mscd_buf
+static void proc_scsi_in_resp(uint8_t rhport, mscd_interface_t* p_msc, int32_t resplen)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
 
-      /*------------- Parse command and prepare DATA -------------*/
-      p_msc->stage = MSC_STAGE_DATA;
-      p_msc->total_len = p_cbw->total_bytes;
-      p_msc->xferred_len = 0;
+  if ( resplen < 0 )
+  {
+    // unsupported command
+    TU_LOG_DRV("  SCSI unsupported or failed command\r\n");
+    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+  }
+  else if (resplen == 0)
+  {
+    // UAS data length is only an upper bound for commands unknown to the driver
+    if (p_cbw->total_bytes && !is_uas(p_msc))
+    {
+      // 6.7 The 13 Cases: case 4 (Hi > Dn)
+      // TU_LOG(MSC_DEBUG, "  SCSI case 4 (Hi > Dn): %lu\r\n", p_cbw->total_bytes);
+      fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    }else
+    {
+      // case 1 Hn = Dn: all good
+      p_msc->stage = MSC_STAGE_STATUS;
+    }
+  }
+  else
+  {
+    if ( p_cbw->total_bytes == 0 )
+    {
+      // 6.7 The 13 Cases: case 2 (Hn < Di)
+      // TU_LOG(MSC_DEBUG, "  SCSI case 2 (Hn < Di): %lu\r\n", p_cbw->total_bytes);
+      fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    }else
+    {
+      // cannot return more than host expect
+      p_msc->total_len = tu_min32((uint32_t) resplen, p_cbw->total_bytes);
+      p_msc->usb_busy = true;
+      TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) p_msc->total_len), );
+    }
+  }
+}
 
-      // Read10 or Write10
-      if ( (SCSI_CMD_READ_10 == p_cbw->command[0]) || (SCSI_CMD_WRITE_10 == p_cbw->command[0]) )
-      {
-        uint8_t const status = rdwr10_validate_cmd(p_cbw);
+// OUT data of SCSI command is processed by tud_msc_scsi_cb() with cb_result
+static void proc_scsi_out_done(uint8_t rhport, mscd_interface_t* p_msc, int32_t cb_result)
+{
+  if ( cb_result < 0 )
+  {
+    // unsupported command
+    TU_LOG_DRV("  SCSI unsupported command\r\n");
+    fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+  }else
+  {
+    // TODO haven't implement this scenario any further yet
+  }
 
-        if ( status != MSC_CSW_STATUS_PASSED)
-        {
-          fail_scsi_op(rhport, p_msc, status);
-        }else if ( p_cbw->total_bytes )
-        {
-          if (SCSI_CMD_READ_10 == p_cbw->command[0])
-          {
-            proc_read10_cmd(rhport, p_msc);
-          }else
-          {
-            proc_write10_cmd(rhport, p_msc);
-          }
-        }else
-        {
-          // no data transfer, only exist in complaint test suite
-          p_msc->stage = MSC_STAGE_STATUS;
-        }
-      }
-      else
-      {
-        // For other SCSI commands
-        // 1. OUT : queue transfer (invoke app callback after done)
-        // 2. IN & Zero: Process if is built-in, else Invoke app callback. Skip DATA if zero length
-        if ( (p_cbw->total_bytes > 0 ) && !is_data_in(p_cbw->dir) )
-        {
-          if (p_cbw->total_bytes > sizeof(_mscd_buf))
-          {
-            TU_LOG_DRV("  SCSI reject non READ10/WRITE10 with large data\r\n");
-            fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-          }else
-          {
-            // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
-            // but it is OK to just receive data then responded with failed status
-            TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, (uint16_t) p_msc->total_len) );
-          }
-        }else
-        {
-          // First process if it is a built-in commands
-          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_buf, sizeof(_mscd_buf));
+  if ( p_msc->xferred_len >= p_msc->total_len )
+  {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
+  }
+  else
+  {
+    // This scenario with command that take more than one transfer is already rejected at Command stage
+    TU_BREAKPOINT();
+  }
+}
 
-          // Invoke user callback if not built-in
-          if ( (resplen < 0) && (p_msc->sense_key == 0) )
-          {
-            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
-          }
+// DATA stage transfer is complete
+static void proc_data_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
 
-          if ( resplen < 0 )
-          {
-            // unsupported command
-            TU_LOG_DRV("  SCSI unsupported or failed command\r\n");
-            fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-          }
-          else if (resplen == 0)
-          {
-            if (p_cbw->total_bytes)
-            {
-              // 6.7 The 13 Cases: case 4 (Hi > Dn)
-              // TU_LOG(MSC_DEBUG, "  SCSI case 4 (Hi > Dn): %lu\r\n", p_cbw->total_bytes);
-              fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-            }else
-            {
-              // case 1 Hn = Dn: all good
-              p_msc->stage = MSC_STAGE_STATUS;
-            }
-          }
-          else
-          {
-            if ( p_cbw->total_bytes == 0 )
-            {
-              // 6.7 The 13 Cases: case 2 (Hn < Di)
-              // TU_LOG(MSC_DEBUG, "  SCSI case 2 (Hn < Di): %lu\r\n", p_cbw->total_bytes);
-              fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-            }else
-            {
-              // cannot return more than host expect
-              p_msc->total_len = tu_min32((uint32_t) resplen, p_cbw->total_bytes);
-              TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) p_msc->total_len) );
-            }
-          }
-        }
-      }
+  if ( is_read_cmd(p_cbw->command[0]) )
+  {
+    proc_read10_xfer_done(rhport, p_msc, xferred_bytes);
+  }
+  else if ( is_write_cmd(p_cbw->command[0]) )
+  {
+    proc_write10_xfer_done(rhport, p_msc, xferred_bytes);
+  }
+  else
+  {
+    p_msc->usb_busy = false;
+    p_msc->xferred_len += xferred_bytes;
+
+    // OUT transfer, invoke callback
+    int32_t cb_result = 0;
+    if ( !is_data_in(p_cbw->dir) && is_unmap_cmd(p_cbw->command) )
+    {
+      cb_result = proc_unmap_cmd(p_cbw->lun, p_cbw->command, _mscd_buf, p_msc->xferred_len) ? 0 : -1;
+    }
+    else if ( !is_data_in(p_cbw->dir) )
+    {
+      p_msc->pending_io = true;
+      cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+
+      // data is processed asynchronously, stay in DATA stage until tud_msc_async_io_done()
+      if ( cb_result == TUD_MSC_RET_ASYNC ) return;
+      p_msc->pending_io = false;
+    }
+
+    proc_scsi_out_done(rhport, p_msc, cb_result);
+  }
+}
+
+// Invoke complete callback of a SCSI op whose status is sent
+static void invoke_complete_cb(msc_cbw_t const * p_cbw)
+{
+  switch(p_cbw->command[0])
+  {
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
+      if ( tud_msc_read10_complete_cb ) tud_msc_read10_complete_cb(p_cbw->lun);
     break;
 
-    case MSC_STAGE_DATA:
-      TU_LOG_DRV("  SCSI Data [Lun%u]\r\n", p_cbw->lun);
-      //TU_LOG_MEM(MSC_DEBUG, _mscd_buf, xferred_bytes, 2);
+    case SCSI_CMD_WRITE_10:
+    case SCSI_CMD_WRITE_16:
+      if ( tud_msc_write10_complete_cb ) tud_msc_write10_complete_cb(p_cbw->lun);
+    break;
 
-      if (SCSI_CMD_READ_10 == p_cbw->command[0])
-      {
-        p_msc->xferred_len += xferred_bytes;
+    default:
+      if ( tud_msc_scsi_complete_cb ) tud_msc_scsi_complete_cb(p_cbw->lun, p_cbw->command);
+    break;
+  }
+}
 
-        if ( p_msc->xferred_len >= p_msc->total_len )
-        {
-          // Data Stage is complete
-          p_msc->stage = MSC_STAGE_STATUS;
-        }else
+#if CFG_TUD_MSC_UAS
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS)
+// Host queues Command IUs on command pipe while device is still busy with previous ones. Each command is converted
+// to a CBW and executed one by one with the same DATA stage as BOT: Read/Write Ready IU on status pipe, data on
+// data pipes, then Sense IU on status pipe. Streams are SuperSpeed only, IUs on status pipe are sent in order.
+//--------------------------------------------------------------------+
+
+static void uas_reset(mscd_interface_t* p_msc)
+{
+  p_msc->uas_queue_rd      = 0;
+  p_msc->uas_queue_count   = 0;
+  p_msc->uas_ready_pending = false;
+  p_msc->uas_rsp_pending   = false;
+  p_msc->usb_busy          = false;
+}
+
+// Receive next IU if there is room for it
+static void uas_prepare_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  // Response IU to previous IU is not sent yet, or queue is full
+  if ( p_msc->uas_rsp_pending || (p_msc->uas_queue_count >= CFG_TUD_MSC_UAS_QUEUE_DEPTH) ) return;
+  if ( !usbd_edpt_ready(rhport, p_msc->ep_cmd) ) return;
+
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_cmd, (uint8_t*) &p_msc->uas_cmd_iu, sizeof(p_msc->uas_cmd_iu)), );
+}
+
+static bool uas_set_alt(uint8_t rhport, mscd_interface_t* p_msc, uint8_t alt)
+{
+  TU_VERIFY( (alt == 0) || (alt == 1 && p_msc->desc_uas) );
+
+  // close endpoints of current setting, also abort its pending transfers
+  usbd_edpt_close(rhport, p_msc->ep_in);
+  usbd_edpt_close(rhport, p_msc->ep_out);
+  if ( is_uas(p_msc) )
+  {
+    usbd_edpt_close(rhport, p_msc->ep_cmd);
+    usbd_edpt_close(rhport, p_msc->ep_status);
+  }
+
+  p_msc->ep_in  = p_msc->ep_out    = 0;
+  p_msc->ep_cmd = p_msc->ep_status = 0;
+  p_msc->alt_itf = alt;
+  proc_bot_reset(p_msc);
+  uas_reset(p_msc);
+
+  if ( alt == 0 )
+  {
+    TU_ASSERT( usbd_open_edpt_pair(rhport, tu_desc_next(p_msc->desc_bot), 2, TUSB_XFER_BULK, &p_msc->ep_out, &p_msc->ep_in) );
+    TU_ASSERT( prepare_cbw(rhport, p_msc) );
+  }else
+  {
+    // Pipe Usage descriptor follows its endpoint
+    uint8_t const* p_desc   = tu_desc_next(p_msc->desc_uas);
+    uint8_t const* desc_end = p_msc->desc_uas + p_msc->desc_uas_len;
+    uint8_t ep_addr = 0;
+
+    while ( p_desc < desc_end )
+    {
+      if ( TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) )
+      {
+        tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+        TU_ASSERT( TUSB_XFER_BULK == desc_ep->bmAttributes.xfer );
+        TU_ASSERT( usbd_edpt_open(rhport, desc_ep) );
+        ep_addr = desc_ep->bEndpointAddress;
+      }
+      else if ( MSC_UAS_DESC_TYPE_PIPE_USAGE == tu_desc_type(p_desc) )
+      {
+        switch ( p_desc[2] )
         {
-          proc_read10_cmd(rhport, p_msc);
+          case MSC_UAS_PIPE_ID_COMMAND : p_msc->ep_cmd    = ep_addr; break;
+          case MSC_UAS_PIPE_ID_STATUS  : p_msc->ep_status = ep_addr; break;
+          // data pipes are used the same way as BOT
+          case MSC_UAS_PIPE_ID_DATA_IN : p_msc->ep_in     = ep_addr; break;
+          case MSC_UAS_PIPE_ID_DATA_OUT: p_msc->ep_out    = ep_addr; break;
+          default: break;
         }
       }
-      else if (SCSI_CMD_WRITE_10 == p_cbw->command[0])
+
+      p_desc = tu_desc_next(p_desc);
+    }
+
+    TU_ASSERT( p_msc->ep_cmd && p_msc->ep_status && p_msc->ep_in && p_msc->ep_out );
+    uas_prepare_cmd(rhport, p_msc);
+  }
+
+  return true;
+}
+
+static inline bool uas_lun_valid(uint8_t const lun[8])
+{
+  // only single level LUN
+  for(uint8_t i=2; i<8; i++)
+  {
+    if ( lun[i] ) return false;
+  }
+
+  return (lun[0] == 0) && (lun[1] < get_maxlun());
+}
+
+// tag of current or queued command
+static bool uas_tag_in_use(mscd_interface_t const* p_msc, uint16_t tag)
+{
+  if ( (p_msc->stage != MSC_STAGE_CMD) && ((uint16_t) p_msc->cbw.tag == tag) ) return true;
+
+  for(uint8_t i=0; i<p_msc->uas_queue_count; i++)
+  {
+    if ( p_msc->uas_queue[(p_msc->uas_queue_rd + i) % CFG_TUD_MSC_UAS_QUEUE_DEPTH].tag == tag ) return true;
+  }
+
+  return false;
+}
+
+// Remove queued commands matching lun (or any if NULL) and tag (or any if NULL), return number of removed commands
+static uint8_t uas_remove_cmd(mscd_interface_t* p_msc, uint8_t const* lun, uint16_t const* tag)
+{
+  uint8_t const count = p_msc->uas_queue_count;
+  uint8_t removed = 0;
+
+  // compact remaining commands in place
+  for(uint8_t i=0; i<count; i++)
+  {
+    msc_uas_cmd_iu_t const* cmd_iu = &p_msc->uas_queue[(p_msc->uas_queue_rd + i) % CFG_TUD_MSC_UAS_QUEUE_DEPTH];
+
+    if ( (!lun || cmd_iu->lun[1] == *lun) && (!tag || cmd_iu->tag == *tag) )
+    {
+      removed++;
+    }else if ( removed )
+    {
+      p_msc->uas_queue[(p_msc->uas_queue_rd + i - removed) % CFG_TUD_MSC_UAS_QUEUE_DEPTH] = *cmd_iu;
+    }
+  }
+
+  p_msc->uas_queue_count = (uint8_t) (count - removed);
+  return removed;
+}
+
+static void uas_task_mgmt(mscd_interface_t* p_msc, msc_uas_task_mgmt_iu_t const* tm_iu)
+{
+  uint8_t  const lun      = tm_iu->lun[1];
+  uint16_t const task_tag = tm_iu->task_tag;
+  bool     const active   = (p_msc->stage != MSC_STAGE_CMD);
+  uint8_t rsp_code;
+
+  TU_LOG_DRV("  UAS Task Management: function = 0x%02X\r\n", tm_iu->function);
+
+  if ( !uas_lun_valid(tm_iu->lun) && (tm_iu->function != MSC_UAS_TMF_IT_NEXUS_RESET) )
+  {
+    rsp_code = MSC_UAS_RC_INCORRECT_LUN;
+  }
+  else
+  {
+    // current command cannot be aborted in the middle of its data transfer
+    switch ( tm_iu->function )
+    {
+      case MSC_UAS_TMF_ABORT_TASK:
+        uas_remove_cmd(p_msc, &lun, &task_tag);
+        rsp_code = (active && (uint16_t) p_msc->cbw.tag == task_tag) ? MSC_UAS_RC_TMF_FAILED : MSC_UAS_RC_TMF_COMPLETE;
+      break;
+
+      case MSC_UAS_TMF_ABORT_TASK_SET:
+      case MSC_UAS_TMF_CLEAR_TASK_SET:
+      case MSC_UAS_TMF_LUN_RESET:
+        uas_remove_cmd(p_msc, &lun, NULL);
+        rsp_code = (active && p_msc->cbw.lun == lun) ? MSC_UAS_RC_TMF_FAILED : MSC_UAS_RC_TMF_COMPLETE;
+      break;
+
+      case MSC_UAS_TMF_IT_NEXUS_RESET:
+        uas_remove_cmd(p_msc, NULL, NULL);
+        rsp_code = active ? MSC_UAS_RC_TMF_FAILED : MSC_UAS_RC_TMF_COMPLETE;
+      break;
+
+      case MSC_UAS_TMF_QUERY_TASK:
+        rsp_code = uas_tag_in_use(p_msc, task_tag) ? MSC_UAS_RC_TMF_SUCCEEDED : MSC_UAS_RC_TMF_COMPLETE;
+      break;
+
+      default:
+        rsp_code = MSC_UAS_RC_TMF_NOT_SUPPORTED;
+      break;
+    }
+  }
+
+  p_msc->uas_rsp_pending = true;
+  p_msc->uas_rsp_tag     = tm_iu->tag;
+  p_msc->uas_rsp_code    = rsp_code;
+}
+
+// Command or Task Management IU received
+static void uas_proc_cmd_iu(mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  msc_uas_cmd_iu_t const* cmd_iu = &p_msc->uas_cmd_iu.cmd;
+  uint8_t rsp_code;
+
+  if ( (cmd_iu->iu_id == MSC_UAS_IU_COMMAND) && (xferred_bytes == sizeof(msc_uas_cmd_iu_t)) )
+  {
+    if ( !uas_lun_valid(cmd_iu->lun) )
+    {
+      rsp_code = MSC_UAS_RC_INCORRECT_LUN;
+    }
+    else if ( uas_tag_in_use(p_msc, cmd_iu->tag) )
+    {
+      rsp_code = MSC_UAS_RC_OVERLAPPED_TAG;
+    }
+    else if ( cmd_iu->add_cdb_len )
+    {
+      // only support CDB up to 16 bytes
+      rsp_code = MSC_UAS_RC_INVALID_IU;
+    }
+    else
+    {
+      // queue is never full since command pipe is only armed when there is room
+      p_msc->uas_queue[(p_msc->uas_queue_rd + p_msc->uas_queue_count) % CFG_TUD_MSC_UAS_QUEUE_DEPTH] = *cmd_iu;
+      p_msc->uas_queue_count++;
+      return;
+    }
+  }
+  else if ( (cmd_iu->iu_id == MSC_UAS_IU_TASK_MGMT) && (xferred_bytes == sizeof(msc_uas_task_mgmt_iu_t)) )
+  {
+    uas_task_mgmt(p_msc, &p_msc->uas_cmd_iu.task_mgmt);
+    return;
+  }
+  else
+  {
+    rsp_code = MSC_UAS_RC_INVALID_IU;
+  }
+
+  TU_LOG_DRV("  UAS Response: 0x%02X\r\n", rsp_code);
+  p_msc->uas_rsp_pending = true;
+  p_msc->uas_rsp_tag     = cmd_iu->tag;
+  p_msc->uas_rsp_code    = rsp_code;
+}
+
+// UAS Command IU does not carry length and direction of data, derive them from CDB
+static void uas_set_data_len(msc_cbw_t* p_cbw)
+{
+  uint8_t const* cdb = p_cbw->command;
+  uint32_t len;
+  bool dir_in = true;
+
+  switch ( cdb[0] )
+  {
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
+    case SCSI_CMD_WRITE_10:
+    case SCSI_CMD_WRITE_16:
+    {
+      uint32_t block_count;
+      uint16_t block_size;
+      tud_msc_capacity_cb(p_cbw->lun, &block_count, &block_size);
+
+      // zero length with non-zero block count is rejected by rdwr10_validate_cmd()
+      uint32_t const count = rdwr10_get_blockcount(p_cbw);
+      len = (block_size && count <= UINT32_MAX / block_size) ? count*block_size : 0;
+      dir_in = is_read_cmd(cdb[0]);
+    }
+    break;
+
+    case SCSI_CMD_TEST_UNIT_READY:
+    case SCSI_CMD_START_STOP_UNIT:
+    case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+      len = 0;
+    break;
+
+    case SCSI_CMD_MODE_SELECT_6:
+      len    = cdb[4];
+      dir_in = false;
+    break;
+
+    case SCSI_CMD_REQUEST_SENSE:
+    case SCSI_CMD_MODE_SENSE_6:
+      len = cdb[4];
+    break;
+
+    case SCSI_CMD_INQUIRY:
+      len = tu_ntohs(tu_unaligned_read16(cdb + 3));
+    break;
+
+    case SCSI_CMD_READ_CAPACITY_10:
+      len = sizeof(scsi_read_capacity10_resp_t);
+    break;
+
+    case SCSI_CMD_READ_FORMAT_CAPACITY:
+      len = tu_ntohs(tu_unaligned_read16(cdb + 7));
+    break;
+
+    case SCSI_CMD_REPORT_LUNS:
+      len = tu_ntohl(tu_unaligned_read32(cdb + 6));
+    break;
+
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+      len = tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_read_capacity16_t, alloc_length)));
+    break;
+
+    case SCSI_CMD_UNMAP:
+      len    = tu_ntohs(tu_unaligned_read16(cdb + offsetof(scsi_unmap_t, param_list_length)));
+      dir_in = false;
+    break;
+
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16:
+    {
+      // one block of data unless NDOB is set
+      uint32_t block_count;
+      uint16_t block_size;
+      tud_msc_capacity_cb(p_cbw->lun, &block_count, &block_size);
+
+      bool const ndob = (cdb[0] == SCSI_CMD_WRITE_SAME_16) && (cdb[1] & SCSI_WRITE_SAME_FLAG_NDOB);
+      len    = ndob ? 0 : block_size;
+      dir_in = false;
+    }
+    break;
+
+    default:
+      // application decides response length, up to the class buffer
+      len = CFG_TUD_MSC_EP_BUFSIZE;
+    break;
+  }
+
+  // response of other commands is limited to class buffer
+  if ( dir_in && !is_read_cmd(cdb[0]) ) len = tu_min32(len, CFG_TUD_MSC_EP_BUFSIZE);
+
+  p_cbw->total_bytes = len;
+  p_cbw->dir         = dir_in ? TUSB_DIR_IN_MASK : 0;
+}
+
+// Execute next queued command if idle
+static void uas_start_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  if ( (p_msc->stage != MSC_STAGE_CMD) || (p_msc->uas_queue_count == 0) ) return;
+
+  msc_uas_cmd_iu_t const* cmd_iu = &p_msc->uas_queue[p_msc->uas_queue_rd];
+  msc_cbw_t* p_cbw = &p_msc->cbw;
+
+  tu_memclr(p_cbw, sizeof(msc_cbw_t));
+  p_cbw->signature = MSC_CBW_SIGNATURE;
+  p_cbw->tag       = cmd_iu->tag;
+  p_cbw->lun       = cmd_iu->lun[1];
+  p_cbw->cmd_len   = sizeof(cmd_iu->cdb);
+  memcpy(p_cbw->command, cmd_iu->cdb, sizeof(cmd_iu->cdb));
+  uas_set_data_len(p_cbw);
+
+  p_msc->uas_queue_rd = (uint8_t) ((p_msc->uas_queue_rd + 1) % CFG_TUD_MSC_UAS_QUEUE_DEPTH);
+  p_msc->uas_queue_count--;
+
+  TU_LOG_DRV("  UAS Command [Lun%u]: %s\r\n", p_cbw->lun, tu_lookup_find(&_msc_scsi_cmd_table, p_cbw->command[0]));
+
+  p_msc->csw.tag    = p_cbw->tag;
+  p_msc->csw.status = MSC_CSW_STATUS_PASSED;
+  p_msc->usb_busy   = false;
+
+  proc_scsi_cmd(rhport, p_msc);
+
+  // data transfer is queued already, host starts it once Read/Write Ready IU is received
+  if ( p_msc->stage == MSC_STAGE_DATA ) p_msc->uas_ready_pending = true;
+}
+
+// Send next IU on status pipe: Response IU, then Read/Write Ready or Sense IU of current command
+static void uas_proc_status(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  if ( usbd_edpt_busy(rhport, p_msc->ep_status) ) return;
+
+  uint16_t len;
+
+  if ( p_msc->uas_rsp_pending )
+  {
+    msc_uas_response_iu_t* rsp_iu = &p_msc->uas_status_iu.response;
+    tu_memclr(rsp_iu, sizeof(msc_uas_response_iu_t));
+
+    rsp_iu->iu_id    = MSC_UAS_IU_RESPONSE;
+    rsp_iu->tag      = p_msc->uas_rsp_tag;
+    rsp_iu->rsp_code = p_msc->uas_rsp_code;
+    len = sizeof(msc_uas_response_iu_t);
+  }
+  else if ( p_msc->uas_ready_pending )
+  {
+    msc_uas_ready_iu_t* ready_iu = &p_msc->uas_status_iu.ready;
+
+    ready_iu->iu_id     = is_data_in(p_msc->cbw.dir) ? MSC_UAS_IU_READ_READY : MSC_UAS_IU_WRITE_READY;
+    ready_iu->reserved1 = 0;
+    ready_iu->tag       = (uint16_t) p_msc->cbw.tag;
+    len = sizeof(msc_uas_ready_iu_t);
+  }
+  else if ( (p_msc->stage == MSC_STAGE_STATUS) && !p_msc->usb_busy )
+  {
+    msc_uas_sense_iu_t* sense_iu = &p_msc->uas_status_iu.sense;
+    tu_memclr(sense_iu, sizeof(msc_uas_sense_iu_t));
+
+    sense_iu->iu_id = MSC_UAS_IU_SENSE;
+    sense_iu->tag   = (uint16_t) p_msc->cbw.tag;
+    len = offsetof(msc_uas_sense_iu_t, sense_data);
+
+    if ( p_msc->csw.status != MSC_CSW_STATUS_PASSED )
+    {
+      // sense data is reported along with status, there is no REQUEST SENSE
+      get_sense_fixed(p_msc, (scsi_sense_fixed_resp_t*) sense_iu->sense_data);
+      sense_iu->status = SCSI_STATUS_CHECK_CONDITION;
+      sense_iu->length = tu_htons(sizeof(scsi_sense_fixed_resp_t));
+      len += sizeof(scsi_sense_fixed_resp_t);
+    }
+
+    tud_msc_set_sense(p_msc->cbw.lun, 0, 0, 0);
+    p_msc->stage = MSC_STAGE_STATUS_SENT;
+  }
+  else
+  {
+    return;
+  }
+
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_status, (uint8_t*) &p_msc->uas_status_iu, len), );
+}
+
+static bool uas_xfer_cb(uint8_t rhport, mscd_interface_t* p_msc, uint8_t ep_addr, uint32_t xferred_bytes)
+{
+  if ( ep_addr == p_msc->ep_cmd )
+  {
+    uas_proc_cmd_iu(p_msc, xferred_bytes);
+  }
+  else if ( ep_addr == p_msc->ep_status )
+  {
+    switch ( p_msc->uas_status_iu.ready.iu_id )
+    {
+      case MSC_UAS_IU_RESPONSE:
+        p_msc->uas_rsp_pending = false;
+      break;
+
+      case MSC_UAS_IU_READ_READY:
+      case MSC_UAS_IU_WRITE_READY:
+        p_msc->uas_ready_pending = false;
+      break;
+
+      case MSC_UAS_IU_SENSE:
+        TU_LOG_DRV("  UAS Status [Lun%u] = %u\r\n", p_msc->cbw.lun, p_msc->csw.status);
+        invoke_complete_cb(&p_msc->cbw);
+        p_msc->stage = MSC_STAGE_CMD;
+      break;
+
+      default: break;
+    }
+  }
+  else if ( p_msc->stage == MSC_STAGE_DATA )
+  {
+    TU_LOG_DRV("  UAS Data [Lun%u]\r\n", p_msc->cbw.lun);
+    proc_data_xfer_done(rhport, p_msc, xferred_bytes);
+  }
+  else
+  {
+    // data transfer queued before command failed
+    p_msc->usb_busy = false;
+  }
+
+  uas_start_cmd(rhport, p_msc);
+  uas_prepare_cmd(rhport, p_msc);
+  uas_proc_status(rhport, p_msc);
+
+  return true;
+}
+#endif
+
+bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes)
+{
+  (void) event;
+
+  mscd_interface_t* p_msc = &_mscd_itf;
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+  msc_csw_t       * p_csw = &p_msc->csw;
+
+  #if CFG_TUD_MSC_UAS
+  if ( is_uas(p_msc) ) return uas_xfer_cb(rhport, p_msc, ep_addr, xferred_bytes);
+  #endif
+
+  switch (p_msc->stage)
+  {
+    case MSC_STAGE_CMD:
+      //------------- new CBW received -------------//
+      // Complete IN while waiting for CMD is usually Status of previous SCSI op, ignore it
+      if(ep_addr != p_msc->ep_out) return true;
+
+      if ( !(xferred_bytes == sizeof(msc_cbw_t) && p_cbw->signature == MSC_CBW_SIGNATURE) )
       {
-        proc_write10_new_data(rhport, p_msc, xferred_bytes);
+        TU_LOG_DRV("  SCSI CBW is not valid\r\n");
+
+        // BOT 6.6.1 If CBW is not valid stall both endpoints until reset recovery
+        p_msc->stage = MSC_STAGE_NEED_RESET;
+
+        // invalid CBW stall both endpoints
+        usbd_edpt_stall(rhport, p_msc->ep_in);
+        usbd_edpt_stall(rhport, p_msc->ep_out);
+
+        return false;
       }
-      else
-      {
-        p_msc->xferred_len += xferred_bytes;
 
-        // OUT transfer, invoke callback if needed
-        if ( !is_data_in(p_cbw->dir) )
-        {
-          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_buf, (uint16_t) p_msc->total_len);
+      TU_LOG_DRV("  SCSI Command [Lun%u]: %s\r\n", p_cbw->lun, tu_lookup_find(&_msc_scsi_cmd_table, p_cbw->command[0]));
+      //TU_LOG_MEM(MSC_DEBUG, p_cbw, xferred_bytes, 2);
+
+      p_csw->signature    = MSC_CSW_SIGNATURE;
+      p_csw->tag          = p_cbw->tag;
+      p_csw->data_residue = 0;
+      p_csw->status       = MSC_CSW_STATUS_PASSED;
+
+      /*------------- Parse command and prepare DATA -------------*/
+      proc_scsi_cmd(rhport, p_msc);
+    break;
 
-          if ( cb_result < 0 )
-          {
-            // unsupported command
-            TU_LOG_DRV("  SCSI unsupported command\r\n");
-            fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-          }else
-          {
-            // TODO haven't implement this scenario any further yet
-          }
-        }
+    case MSC_STAGE_DATA:
+      TU_LOG_DRV("  SCSI Data [Lun%u]\r\n", p_cbw->lun);
+      //TU_LOG_MEM(MSC_DEBUG, _mscd_buf, xferred_bytes, 2);
 
-        if ( p_msc->xferred_len >= p_msc->total_len )
-        {
-          // Data Stage is complete
-          p_msc->stage = MSC_STAGE_STATUS;
-        }
-        else
-        {
-          // This scenario with command that take more than one transfer is already rejected at Command stage
-          TU_BREAKPOINT();
-        }
-      }
+      proc_data_xfer_done(rhport, p_msc, xferred_bytes);
     break;
 
     case MSC_STAGE_STATUS:
@@ -588,20 +1681,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // Invoke complete callback if defined
         // Note: There is racing issue with samd51 + qspi flash testing with arduino
         // if complete_cb() is invoked after queuing the status.
-        switch(p_cbw->command[0])
-        {
-          case SCSI_CMD_READ_10:
-            if ( tud_msc_read10_complete_cb ) tud_msc_read10_complete_cb(p_cbw->lun);
-          break;
-
-          case SCSI_CMD_WRITE_10:
-            if ( tud_msc_write10_complete_cb ) tud_msc_write10_complete_cb(p_cbw->lun);
-          break;
-
-          default:
-            if ( tud_msc_scsi_complete_cb ) tud_msc_scsi_complete_cb(p_cbw->lun, p_cbw->command);
-          break;
-        }
+        invoke_complete_cb(p_cbw);
 
         TU_ASSERT( prepare_cbw(rhport, p_msc) );
       }else
@@ -614,6 +1694,24 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     default : break;
   }
 
+  proc_stage_status(rhport, p_msc);
+
+  return true;
+}
+
+// send status if data stage is complete
+static void proc_stage_status(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+
+  #if CFG_TUD_MSC_UAS
+  if ( is_uas(p_msc) )
+  {
+    uas_proc_status(rhport, p_msc);
+    return;
+  }
+  #endif
+
   if ( p_msc->stage == MSC_STAGE_STATUS )
   {
     // skip status if epin is currently stalled, will do it when received Clear Stall request
@@ -626,7 +1724,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         usbd_edpt_stall(rhport, p_msc->ep_in);
       }else
       {
-        TU_ASSERT( send_csw(rhport, p_msc) );
+        TU_ASSERT( send_csw(rhport, p_msc), );
       }
     }
 
@@ -641,8 +1739,6 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
     }
     #endif
   }
-
-  return true;
 }
 
 /*------------------------------------------------------------------*/
@@ -675,6 +1771,15 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     case SCSI_CMD_START_STOP_UNIT:
       resplen = 0;
 
+      #if CFG_TUD_MSC_CACHE_LINES
+      if ( !cache_flush(lun) )
+      {
+        tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // WRITE ERROR
+        resplen = -1;
+        break;
+      }
+      #endif
+
       if (tud_msc_start_stop_cb)
       {
         scsi_start_stop_unit_t const * start_stop = (scsi_start_stop_unit_t const *) scsi_cmd;
@@ -689,6 +1794,18 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       }
     break;
 
+    #if CFG_TUD_MSC_CACHE_LINES
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+      // always sync the whole lun regardless of requested range
+      resplen = 0;
+      if ( !cache_flush(lun) )
+      {
+        tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // WRITE ERROR
+        resplen = -1;
+      }
+    break;
+    #endif
+
     case SCSI_CMD_READ_CAPACITY_10:
     {
       uint32_t block_count;
@@ -719,6 +1836,49 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
     break;
 
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+    {
+      // only READ CAPACITY(16) is built-in, other service actions are passed to application
+      if ( (scsi_cmd[1] & 0x1Fu) != SCSI_SERVICE_ACTION_READ_CAPACITY_16 )
+      {
+        resplen = -1;
+        break;
+      }
+
+      uint32_t block_count;
+      uint16_t block_size;
+
+      tud_msc_capacity_cb(lun, &block_count, &block_size);
+
+      // Invalid block size/count from callback, possibly unit is not ready
+      // stall this request, set sense key to NOT READY
+      if (block_count == 0 || block_size == 0)
+      {
+        resplen = -1;
+
+        // set default sense if not set by callback
+        if ( p_msc->sense_key == 0 ) set_sense_medium_not_present(lun);
+      }else
+      {
+        scsi_read_capacity16_resp_t read_capa16;
+        tu_memclr(&read_capa16, sizeof(read_capa16));
+
+        // last lba is 64-bit Big Endian, but capacity callback is limited to 32-bit
+        uint8_t* p_lba = (uint8_t*) &read_capa16 + offsetof(scsi_read_capacity16_resp_t, last_lba);
+        tu_unaligned_write32(p_lba + 4, tu_htonl(block_count-1));
+        read_capa16.block_size = tu_htonl((uint32_t) block_size);
+
+        // logical block provisioning management is enabled when UNMAP is supported
+        if ( tud_msc_unmap_cb ) read_capa16.lbpme = 1;
+
+        // response is truncated to allocation length
+        uint32_t const alloc_len = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_read_capacity16_t, alloc_length)));
+        resplen = (int32_t) tu_min32(sizeof(read_capa16), alloc_len);
+        TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa16, (size_t) resplen));
+      }
+    }
+    break;
+
     case SCSI_CMD_READ_FORMAT_CAPACITY:
     {
       scsi_read_format_capacity_data_t read_fmt_capa =
@@ -755,6 +1915,13 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
     case SCSI_CMD_INQUIRY:
     {
+      // VPD pages are only needed to report logical block provisioning
+      if ( tud_msc_unmap_cb && (scsi_cmd[1] & 0x01u) )
+      {
+        resplen = proc_inquiry_vpd(lun, scsi_cmd[2], buffer, bufsize);
+        break;
+      }
+
       scsi_inquiry_resp_t inquiry_rsp =
       {
           .is_removable         = 1,
@@ -763,6 +1930,9 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
           .additional_length    = sizeof(scsi_inquiry_resp_t) - 5,
       };
 
+      // VPD pages B0h/B2h are defined by SPC-4, hosts do not query them from older devices
+      if ( tud_msc_unmap_cb ) inquiry_rsp.version = 6;
+
       // vendor_id, product_id, product_rev is space padded string
       memset(inquiry_rsp.vendor_id  , ' ', sizeof(inquiry_rsp.vendor_id));
       memset(inquiry_rsp.product_id , ' ', sizeof(inquiry_rsp.product_id));
@@ -799,18 +1969,39 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
     break;
 
-    case SCSI_CMD_REQUEST_SENSE:
+    case SCSI_CMD_REPORT_LUNS:
     {
-      scsi_sense_fixed_resp_t sense_rsp =
+      uint8_t const maxlun = get_maxlun();
+
+      // LUN list length followed by 8-byte single level LUNs
+      uint32_t const list_len = 8u*maxlun;
+      resplen = (int32_t) (8 + list_len);
+      TU_VERIFY(bufsize >= (uint32_t) resplen);
+
+      tu_memclr(buffer, (size_t) resplen);
+      tu_unaligned_write32(buffer, tu_htonl(list_len));
+      for(uint8_t i=0; i<maxlun; i++) buffer[8 + 8u*i + 1] = i;
+    }
+    break;
+
+    case SCSI_CMD_UNMAP:
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16:
+      // only without Data-Out i.e empty UNMAP parameter list or WRITE SAME(16) with NDOB, others are handled
+      // when data is received
+      if ( !is_unmap_cmd(scsi_cmd) )
       {
-          .response_code = 0x70, // current, fixed format
-          .valid         = 1
-      };
+        resplen = -1;
+      }else
+      {
+        resplen = proc_unmap_cmd(lun, scsi_cmd, NULL, 0) ? 0 : -1;
+      }
+    break;
 
-      sense_rsp.add_sense_len       = sizeof(scsi_sense_fixed_resp_t) - 8;
-      sense_rsp.sense_key           = (uint8_t) (p_msc->sense_key & 0x0F);
-      sense_rsp.add_sense_code      = p_msc->add_sense_code;
-      sense_rsp.add_sense_qualifier = p_msc->add_sense_qualifier;
+    case SCSI_CMD_REQUEST_SENSE:
+    {
+      scsi_sense_fixed_resp_t sense_rsp;
+      get_sense_fixed(p_msc, &sense_rsp);
 
       resplen = sizeof(sense_rsp);
       TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &sense_rsp, (size_t) resplen));
@@ -832,22 +2023,293 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
   return resplen;
 }
 
-static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+//--------------------------------------------------------------------+
+// UNMAP & WRITE SAME
+// Deallocation of blocks is forwarded to tud_msc_unmap_cb(). WRITE SAME without UNMAP bit is not built-in and
+// left to tud_msc_scsi_cb().
+//--------------------------------------------------------------------+
+
+// Vital Product Data pages reporting logical block provisioning
+static int32_t proc_inquiry_vpd(uint8_t lun, uint8_t page_code, uint8_t* buffer, uint32_t bufsize)
+{
+  // Block Limits is the longest page
+  TU_VERIFY(bufsize >= 64, -1);
+
+  tu_memclr(buffer, 64);
+  buffer[1] = page_code;
+
+  switch ( page_code )
+  {
+    case SCSI_VPD_SUPPORTED_PAGES:
+      buffer[3] = 3;
+      buffer[4] = SCSI_VPD_SUPPORTED_PAGES;
+      buffer[5] = SCSI_VPD_BLOCK_LIMITS;
+      buffer[6] = SCSI_VPD_LOGICAL_BLOCK_PROVISIONING;
+    return 4 + 3;
+
+    case SCSI_VPD_BLOCK_LIMITS:
+    {
+      buffer[3] = 0x3C;
+
+      // UNMAP: no limit of LBA count, block descriptors must fit in class buffer
+      uint32_t const max_desc = (CFG_TUD_MSC_EP_BUFSIZE - sizeof(scsi_unmap_param_header_t)) / sizeof(scsi_unmap_block_desc_t);
+      tu_unaligned_write32(buffer + 20, tu_htonl(UINT32_MAX));
+      tu_unaligned_write32(buffer + 24, tu_htonl(max_desc));
+
+      // Let host align discards to erase unit of media
+      #if CFG_TUD_MSC_UNMAP_GRANULARITY
+      tu_unaligned_write32(buffer + 28, tu_htonl(CFG_TUD_MSC_UNMAP_GRANULARITY));
+      #endif
+    }
+    return 4 + 0x3C;
+
+    case SCSI_VPD_LOGICAL_BLOCK_PROVISIONING:
+      buffer[3] = 4;
+      buffer[5] = 0xE0; // LBPU, LBPWS and LBPWS10: unmap with UNMAP, WRITE SAME(16) and WRITE SAME(10)
+      buffer[6] = 0x02; // thin provisioned
+    return 4 + 4;
+
+    default:
+      tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00); // INVALID FIELD IN CDB
+    return -1;
+  }
+}
+
+static bool is_unmap_cmd(uint8_t const scsi_cmd[16])
+{
+  if ( !tud_msc_unmap_cb ) return false;
+
+  switch ( scsi_cmd[0] )
+  {
+    case SCSI_CMD_UNMAP: return true;
+
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16:
+      return (scsi_cmd[1] & SCSI_WRITE_SAME_FLAG_UNMAP) != 0;
+
+    default: return false;
+  }
+}
+
+#if CFG_TUD_MSC_CACHE_LINES
+// Drop cached lines of unmapped range so that they are not written back later. Lines only partially in range are
+// written back first.
+static bool cache_unmap(uint8_t lun, uint32_t lba, uint32_t block_count)
+{
+  for(uint8_t i=0; i<CFG_TUD_MSC_CACHE_LINES; i++)
+  {
+    mscd_cache_line_t* line = &_mscd_cache[i];
+    if ( !line->used || line->lun != lun ) continue;
+
+    uint32_t const line_end = line->lba + line->len / line->block_size;
+    if ( line_end <= lba || line->lba >= lba + block_count ) continue;
+
+    if ( line->lba < lba || line_end > lba + block_count )
+    {
+      TU_VERIFY( cache_flush_line(line) );
+    }
+    line->used = false;
+  }
+  return true;
+}
+#endif
+
+// return false and set sense if range can not be unmapped
+static bool unmap_range(uint8_t lun, uint64_t lba, uint32_t block_count)
+{
+  mscd_interface_t const* p_msc = &_mscd_itf;
+
+  uint32_t capacity = 0;
+  uint16_t block_size = 0;
+  tud_msc_capacity_cb(lun, &capacity, &block_size);
+
+  if ( lba > capacity || block_count > capacity - lba )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00); // LBA OUT OF RANGE
+    return false;
+  }
+
+  if ( block_count == 0 ) return true;
+
+  #if CFG_TUD_MSC_CACHE_LINES
+  if ( !cache_unmap(lun, (uint32_t) lba, block_count) )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00); // WRITE ERROR
+    return false;
+  }
+  #endif
+
+  if ( !tud_msc_unmap_cb(lun, (uint32_t) lba, block_count) )
+  {
+    // set default sense if not set by callback
+    if ( p_msc->sense_key == 0 ) tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00);
+    return false;
+  }
+
+  return true;
+}
+
+// Carry out UNMAP with its parameter list, or WRITE SAME with UNMAP bit (data block is not needed).
+// return false with sense set if failed
+static bool proc_unmap_cmd(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t const* param, uint32_t param_len)
+{
+  if ( tud_msc_is_writable_cb && !tud_msc_is_writable_cb(lun) )
+  {
+    tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+    return false;
+  }
+
+  uint64_t lba;
+  uint32_t block_count;
+
+  switch ( scsi_cmd[0] )
+  {
+    case SCSI_CMD_UNMAP:
+    {
+      // parameter list with only header or even shorter has nothing to unmap
+      if ( param_len < sizeof(scsi_unmap_param_header_t) ) return true;
+
+      uint32_t desc_len = tu_ntohs(tu_unaligned_read16(param + offsetof(scsi_unmap_param_header_t, block_desc_length)));
+      desc_len = tu_min32(desc_len, param_len - (uint32_t) sizeof(scsi_unmap_param_header_t));
+
+      uint8_t const* desc = param + sizeof(scsi_unmap_param_header_t);
+      for ( ; desc_len >= sizeof(scsi_unmap_block_desc_t); desc_len -= (uint32_t) sizeof(scsi_unmap_block_desc_t),
+                                                            desc += sizeof(scsi_unmap_block_desc_t) )
+      {
+        lba         = scsi_read_u64(desc + offsetof(scsi_unmap_block_desc_t, lba));
+        block_count = tu_ntohl(tu_unaligned_read32(desc + offsetof(scsi_unmap_block_desc_t, block_count)));
+        TU_VERIFY( unmap_range(lun, lba, block_count) );
+      }
+    }
+    return true;
+
+    case SCSI_CMD_WRITE_SAME_10:
+      lba         = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_write_same10_t, lba)));
+      block_count = tu_ntohs(tu_unaligned_read16(scsi_cmd + offsetof(scsi_write_same10_t, block_count)));
+    break;
+
+    case SCSI_CMD_WRITE_SAME_16:
+      lba         = scsi_read_u64(scsi_cmd + offsetof(scsi_write_same16_t, lba));
+      block_count = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_write_same16_t, block_count)));
+    break;
+
+    default: return false;
+  }
+
+  // zero block count of WRITE SAME is up to the end of media
+  if ( block_count == 0 )
+  {
+    uint32_t capacity = 0;
+    uint16_t block_size = 0;
+    tud_msc_capacity_cb(lun, &capacity, &block_size);
+    if ( lba < capacity ) block_count = (uint32_t) (capacity - lba);
+  }
+
+  return unmap_range(lun, lba, block_count);
+}
+
+//--------------------------------------------------------------------+
+// READ10 & WRITE10
+// Data is moved in chunks of up to CFG_TUD_MSC_EP_BUFSIZE. With CFG_TUD_MSC_DOUBLE_BUF, callback works on
+// one buffer while the other one is on the bus, otherwise both take turn on the same buffer.
+//--------------------------------------------------------------------+
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t rdwr10_next_idx(uint8_t idx)
+{
+  return (uint8_t) ((idx + 1) % MSC_BUF_COUNT);
+}
+
+static void proc_rdwr10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+{
+  p_msc->pending_io = false;
+  p_msc->usb_busy   = false;
+  p_msc->usb_idx    = 0;
+  p_msc->io_idx     = 0;
+  p_msc->io_pos     = 0;
+  tu_memclr(p_msc->buf_len, sizeof(p_msc->buf_len));
+  tu_memclr(p_msc->buf_ptr, sizeof(p_msc->buf_ptr));
+
+  if ( is_read_cmd(p_msc->cbw.command[0]) )
+  {
+    proc_read10_pump(rhport, p_msc);
+  }else
+  {
+    if ( proc_write10_cmd(rhport, p_msc) ) proc_write10_pump(rhport, p_msc);
+  }
+}
+
+//------------- READ10 -------------//
+
+// Send data that is ready and read more from media into free buffer
+static void proc_read10_pump(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   // block size already verified not zero
   uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  while (1)
+  {
+    if ( !p_msc->usb_busy && p_msc->buf_len[p_msc->usb_idx] )
+    {
+      uint8_t const* buf = p_msc->buf_ptr[p_msc->usb_idx] ? p_msc->buf_ptr[p_msc->usb_idx] : _mscd_rdwr_buf[p_msc->usb_idx];
+      p_msc->usb_busy = true;
+      TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, (uint8_t*) (uintptr_t) buf, p_msc->buf_len[p_msc->usb_idx]), );
+    }
+
+    // buffer is still in use or all data is read
+    if ( p_msc->pending_io || p_msc->buf_len[p_msc->io_idx] || (p_msc->io_pos >= p_cbw->total_bytes) ) break;
+
+    // Adjust lba with read bytes
+    uint32_t const lba = (uint32_t) rdwr10_get_lba(p_cbw->command) + (p_msc->io_pos / block_sz);
+    uint32_t const offset = p_msc->io_pos % block_sz;
+    uint32_t remaining = p_cbw->total_bytes - p_msc->io_pos;
+
+    #if CFG_TUD_MSC_CACHE_LINES
+    // Newer data in write-back cache is sent directly from it
+    uint8_t const* cache_ptr;
+    if ( cache_read(p_cbw->lun, block_sz, lba, offset, &cache_ptr, &remaining) )
+    {
+      p_msc->buf_ptr[p_msc->io_idx] = cache_ptr;
+      if ( !proc_read10_io_data(rhport, p_msc, (int32_t) tu_min32(remaining, MSC_READ10_PTR_MAX)) ) break;
+      continue;
+    }
+    #endif
+
+    // Memory mapped media: send directly from it, capped at a multiple of packet size that fits buf_len
+    if ( tud_msc_read10_ptr_cb )
+    {
+      void const* ptr = NULL;
+      uint32_t len = tu_min32(MSC_READ10_PTR_MAX, remaining);
+
+      if ( tud_msc_read10_ptr_cb(p_cbw->lun, lba, offset, &ptr, &len) && ptr && len )
+      {
+        p_msc->buf_ptr[p_msc->io_idx] = (uint8_t const*) ptr;
+        if ( !proc_read10_io_data(rhport, p_msc, (int32_t) tu_min32(len, MSC_READ10_PTR_MAX)) ) break;
+        continue;
+      }
+    }
+
+    // remaining bytes capped at class buffer
+    int32_t nbytes = (int32_t) tu_min32(CFG_TUD_MSC_EP_BUFSIZE, remaining);
+
+    // Application can consume smaller bytes
+    // mark I/O pending first since asynchronous I/O can complete before callback returns
+    p_msc->pending_io = true;
+    nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_rdwr_buf[p_msc->io_idx], (uint32_t) nbytes);
 
-  // remaining bytes capped at class buffer
-  int32_t nbytes = (int32_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
+    // wait for tud_msc_async_io_done() if asynchronous
+    if ( nbytes == TUD_MSC_RET_ASYNC ) break;
 
-  // Application can consume smaller bytes
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_buf, (uint32_t) nbytes);
+    p_msc->pending_io = false;
+    if ( !proc_read10_io_data(rhport, p_msc, nbytes) ) break;
+  }
+}
+
+// process data read by application, return true if more data can be read
+static bool proc_read10_io_data(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   if ( nbytes < 0 )
   {
@@ -858,19 +2320,48 @@ static void proc_read10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
     set_sense_medium_not_present(p_cbw->lun);
 
     fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
+    return false;
   }
   else if ( nbytes == 0 )
   {
-    // zero means not ready -> simulate an transfer complete so that this driver callback will fired again
-    dcd_event_xfer_complete(rhport, p_msc->ep_in, 0, XFER_RESULT_SUCCESS, false);
+    // zero means not ready -> callback is invoked again later
+    usbd_defer_func(proc_rdwr10_retry, NULL, false);
+    return false;
   }
   else
   {
-    TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_buf, (uint16_t) nbytes), );
+    p_msc->buf_len[p_msc->io_idx] = (uint16_t) nbytes;
+    p_msc->io_pos += (uint32_t) nbytes;
+    p_msc->io_idx  = rdwr10_next_idx(p_msc->io_idx);
+    return true;
+  }
+}
+
+// USB transfer of a chunk is complete
+static void proc_read10_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  TU_VERIFY(p_msc->usb_busy, );
+
+  p_msc->xferred_len += xferred_bytes;
+  p_msc->buf_len[p_msc->usb_idx] = 0;
+  p_msc->buf_ptr[p_msc->usb_idx] = NULL;
+  p_msc->usb_busy = false;
+  p_msc->usb_idx  = rdwr10_next_idx(p_msc->usb_idx);
+
+  if ( p_msc->xferred_len >= p_msc->total_len )
+  {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
+  }else
+  {
+    proc_read10_pump(rhport, p_msc);
   }
 }
 
-static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
+//------------- WRITE10 -------------//
+
+// return false if LUN is write protected
+static bool proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
   bool writable = true;
@@ -886,30 +2377,64 @@ static void proc_write10_cmd(uint8_t rhport, mscd_interface_t* p_msc)
     // Sense = Write protected
     tud_msc_set_sense(p_cbw->lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
     fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-    return;
+    return false;
   }
 
-  // remaining bytes capped at class buffer
-  uint16_t nbytes = (uint16_t) tu_min32(sizeof(_mscd_buf), p_cbw->total_bytes-p_msc->xferred_len);
-
-  // Write10 callback will be called later when usb transfer complete
-  TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_buf, nbytes), );
+  return true;
 }
 
-// process new data arrived from WRITE10
-static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+// Receive more data into free buffer and let application write received data to media
+static void proc_write10_pump(uint8_t rhport, mscd_interface_t* p_msc)
 {
   msc_cbw_t const * p_cbw = &p_msc->cbw;
 
   // block size already verified not zero
   uint16_t const block_sz = rdwr10_get_blocksize(p_cbw);
 
-  // Adjust lba with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  while (1)
+  {
+    if ( !p_msc->usb_busy && !p_msc->buf_len[p_msc->usb_idx] && (p_msc->io_pos < p_cbw->total_bytes) )
+    {
+      // remaining bytes capped at class buffer
+      uint16_t const nbytes = (uint16_t) tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_cbw->total_bytes - p_msc->io_pos);
+
+      // Write10 callback will be called later when usb transfer complete
+      p_msc->usb_busy = true;
+      p_msc->io_pos  += nbytes;
+      TU_ASSERT( usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_rdwr_buf[p_msc->usb_idx], nbytes), );
+    }
+
+    // still writing or no received data
+    uint16_t const len = p_msc->buf_len[p_msc->io_idx];
+    if ( p_msc->pending_io || !len ) break;
+
+    // Adjust lba with transferred bytes
+    uint32_t const lba = (uint32_t) rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+
+    // Invoke callback to consume new data
+    // mark I/O pending first since asynchronous I/O can complete before callback returns
+    uint32_t const offset = p_msc->xferred_len % block_sz;
+    p_msc->pending_io = true;
+    #if CFG_TUD_MSC_CACHE_LINES
+    int32_t const nbytes = cache_write(p_cbw->lun, block_sz, lba, offset, _mscd_rdwr_buf[p_msc->io_idx], len);
+    #else
+    int32_t const nbytes = tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_rdwr_buf[p_msc->io_idx], len);
+    #endif
+
+    // wait for tud_msc_async_io_done() if asynchronous
+    if ( nbytes == TUD_MSC_RET_ASYNC ) break;
+
+    p_msc->pending_io = false;
+    if ( !proc_write10_io_data(rhport, p_msc, nbytes) ) break;
+  }
+}
 
-  // Invoke callback to consume new data
-  uint32_t const offset = p_msc->xferred_len % block_sz;
-  int32_t nbytes = tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_buf, xferred_bytes);
+// process result of application consuming received data, return true if more data can be written
+static bool proc_write10_io_data(uint8_t rhport, mscd_interface_t* p_msc, int32_t nbytes)
+{
+  msc_cbw_t const * p_cbw = &p_msc->cbw;
+  uint8_t* buf = _mscd_rdwr_buf[p_msc->io_idx];
+  uint32_t const len = p_msc->buf_len[p_msc->io_idx];
 
   if ( nbytes < 0 )
   {
@@ -917,43 +2442,56 @@ static void proc_write10_new_data(uint8_t rhport, mscd_interface_t* p_msc, uint3
     TU_LOG_DRV("  tud_msc_write10_cb() return -1\r\n");
 
     // update actual byte before failed
-    p_msc->xferred_len += xferred_bytes;
+    p_msc->xferred_len += len;
 
     // Set sense
     set_sense_medium_not_present(p_cbw->lun);
 
     fail_scsi_op(rhport, p_msc, MSC_CSW_STATUS_FAILED);
-  }else
+    return false;
+  }
+
+  // Application consume less than what we got (including zero)
+  if ( (uint32_t) nbytes < len )
   {
-    // Application consume less than what we got (including zero)
-    if ( (uint32_t) nbytes < xferred_bytes )
+    uint32_t const left_over = len - (uint32_t) nbytes;
+    if ( nbytes > 0 )
     {
-      uint32_t const left_over = xferred_bytes - (uint32_t) nbytes;
-      if ( nbytes > 0 )
-      {
-        p_msc->xferred_len += (uint16_t) nbytes;
-        memmove(_mscd_buf, _mscd_buf+nbytes, left_over);
-      }
-
-      // simulate an transfer complete with adjusted parameters --> callback will be invoked with adjusted parameter
-      dcd_event_xfer_complete(rhport, p_msc->ep_out, left_over, XFER_RESULT_SUCCESS, false);
+      p_msc->xferred_len += (uint16_t) nbytes;
+      memmove(buf, buf+nbytes, left_over);
+      p_msc->buf_len[p_msc->io_idx] = (uint16_t) left_over;
     }
-    else
-    {
-      // Application consume all bytes in our buffer
-      p_msc->xferred_len += xferred_bytes;
 
-      if ( p_msc->xferred_len >= p_msc->total_len )
-      {
-        // Data Stage is complete
-        p_msc->stage = MSC_STAGE_STATUS;
-      }else
-      {
-        // prepare to receive more data from host
-        proc_write10_cmd(rhport, p_msc);
-      }
-    }
+    // callback will be invoked again later with adjusted parameters
+    usbd_defer_func(proc_rdwr10_retry, NULL, false);
+    return false;
+  }
+
+  // Application consume all bytes in our buffer
+  p_msc->xferred_len += len;
+  p_msc->buf_len[p_msc->io_idx] = 0;
+  p_msc->io_idx = rdwr10_next_idx(p_msc->io_idx);
+
+  if ( p_msc->xferred_len >= p_msc->total_len )
+  {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
+    return false;
   }
+
+  return true;
+}
+
+// new data arrived from WRITE10
+static void proc_write10_xfer_done(uint8_t rhport, mscd_interface_t* p_msc, uint32_t xferred_bytes)
+{
+  TU_VERIFY(p_msc->usb_busy, );
+
+  p_msc->buf_len[p_msc->usb_idx] = (uint16_t) xferred_bytes;
+  p_msc->usb_busy = false;
+  p_msc->usb_idx  = rdwr10_next_idx(p_msc->usb_idx);
+
+  proc_write10_pump(rhport, p_msc);
 }
 
 #endif
@@ -50,6 +50,59 @@
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 
+// Use 2 buffers of CFG_TUD_MSC_EP_BUFSIZE for READ10/WRITE10 so that media I/O of a chunk overlaps
+// with USB transfer of the other one
+#ifndef CFG_TUD_MSC_DOUBLE_BUF
+  #define CFG_TUD_MSC_DOUBLE_BUF  0
+#endif
+
+// Bytes the interface takes from buffer pool (CFG_TUD_BUF_POOL_ENABLED)
+#define TUD_MSC_BUF_POOL_SZ   ((CFG_TUD_MSC_DOUBLE_BUF ? 2 : 1)*TUD_BUF_POOL_ALLOC_SZ(CFG_TUD_MSC_EP_BUFSIZE))
+
+// Support USB Attached SCSI (UAS) as alternate setting 1 of the MSC interface, see TUD_MSC_UAS_DESCRIPTOR().
+// Host can queue up commands instead of waiting for status of each one as with Bulk-Only Transport.
+#ifndef CFG_TUD_MSC_UAS
+  #define CFG_TUD_MSC_UAS  0
+#endif
+
+// Number of UAS commands that can be queued while device is executing a command
+#ifndef CFG_TUD_MSC_UAS_QUEUE_DEPTH
+  #define CFG_TUD_MSC_UAS_QUEUE_DEPTH  4
+#endif
+
+// Write-back cache of media with lines of CFG_TUD_MSC_CACHE_LINE_SIZE e.g flash erase block. WRITE10 data is merged
+// into cache lines which are written to media as a whole with tud_msc_write10_cb() when evicted (least recently used)
+// or flushed by SYNCHRONIZE CACHE, START STOP UNIT, bus reset, idle or tud_msc_cache_flush(). 0 is disabled.
+// Note: callbacks used to fill or flush a line must complete synchronously, busy and async are treated as error.
+#ifndef CFG_TUD_MSC_CACHE_LINES
+  #define CFG_TUD_MSC_CACHE_LINES  0
+#endif
+
+// Bytes of a cache line, must be a multiple of block size
+#ifndef CFG_TUD_MSC_CACHE_LINE_SIZE
+  #define CFG_TUD_MSC_CACHE_LINE_SIZE  4096
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_CACHE_LINE_SIZE <= 32768, "Size is not correct");
+
+// Number of SOF (ms) without media write before dirty cache lines are flushed, 0 is disabled
+#ifndef CFG_TUD_MSC_CACHE_FLUSH_SOF
+  #define CFG_TUD_MSC_CACHE_FLUSH_SOF  1000
+#endif
+
+// Optimal UNMAP granularity in blocks reported in Block Limits VPD page e.g flash erase block, 0 is not reported.
+// Only used if tud_msc_unmap_cb() is implemented.
+#ifndef CFG_TUD_MSC_UNMAP_GRANULARITY
+  #define CFG_TUD_MSC_UNMAP_GRANULARITY  0
+#endif
+
+// Special return value of tud_msc_read10_cb(), tud_msc_write10_cb() and tud_msc_scsi_cb()
+enum {
+  TUD_MSC_RET_ERROR = -1,  // error e.g invalid address
+  TUD_MSC_RET_BUSY  = 0,   // not ready yet e.g disk I/O busy, callback invoked again later
+  TUD_MSC_RET_ASYNC = -16, // I/O is carried out asynchronously, complete it with tud_msc_async_io_done()
+};
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -57,6 +110,19 @@ TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
 // Set SCSI sense response
 bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, uint8_t add_sense_qualifier);
 
+// Command Block Wrapper of SCSI command being processed, e.g for direction and data length in tud_msc_scsi_cb().
+// With UAS it is built from Command IU.
+msc_cbw_t const* tud_msc_get_cbw(void);
+
+// Complete I/O started by returning TUD_MSC_RET_ASYNC from tud_msc_read10_cb()/tud_msc_write10_cb()/tud_msc_scsi_cb().
+// bytes_io is number of bytes read into/written from buffer (same meaning as callback return value, except ASYNC).
+// Buffer must not be accessed after this call. Can be called from ISR e.g DMA complete with in_isr = true.
+bool tud_msc_async_io_done(uint8_t lun, int32_t bytes_io, bool in_isr);
+
+// Write dirty lines of cache to media e.g before power down, return false if media write failed.
+// Must be called in the same thread as tud_task()
+bool tud_msc_cache_flush(void);
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -73,8 +139,18 @@ bool tud_msc_set_sense(uint8_t lun, uint8_t sense_key, uint8_t add_sense_code, u
 //
 //   - read < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                      and return failed status in command status wrapper phase.
+//
+//   - TUD_MSC_RET_ASYNC : Application started reading into buffer, call tud_msc_async_io_done() when complete.
+//
+// Note: also invoked for READ16, whose LBA range is rejected with LBA OUT OF RANGE if it does not fit in 32-bit.
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
 
+// Invoked when received SCSI READ10 command, before tud_msc_read10_cb(), for memory mapped media e.g XIP flash or RAM disk
+// - Application set *ptr to address contents and *len to number of bytes (up to *len) that can be sent from there, and
+//   return true. Data is transferred directly from ptr, which must stay valid until transfer is complete.
+// - Return false to use tud_msc_read10_cb() instead, e.g address is not accessible by the USB controller's DMA
+TU_ATTR_WEAK bool tud_msc_read10_ptr_cb(uint8_t lun, uint32_t lba, uint32_t offset, void const** ptr, uint32_t* len);
+
 // Invoked when received SCSI WRITE10 command
 // - Address = lba * BLOCK_SIZE + offset
 //   - offset is only needed if CFG_TUD_MSC_EP_BUFSIZE is smaller than BLOCK_SIZE.
@@ -88,6 +164,10 @@ int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buf
 //   - write < 0       : Indicate application error e.g invalid address. This request will be STALLed
 //                       and return failed status in command status wrapper phase.
 //
+//   - TUD_MSC_RET_ASYNC : Application started writing from buffer, call tud_msc_async_io_done() when complete.
+//
+// Note: also invoked for WRITE16, whose LBA range is rejected with LBA OUT OF RANGE if it does not fit in 32-bit.
+//
 // TODO change buffer to const uint8_t*
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
 
@@ -106,6 +186,8 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_siz
 /**
  * Invoked when received an SCSI command not in built-in list below.
  * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
+ * - REPORT_LUNS, SYNCHRONIZE_CACHE10 (only with CFG_TUD_MSC_CACHE_LINES)
+ * - UNMAP, WRITE_SAME10/16 with UNMAP bit (only with tud_msc_unmap_cb)
  * - READ10 and WRITE10 has their own callbacks
  *
  * \param[in]   lun         Logical unit number
@@ -118,6 +200,8 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_siz
  * \return      Actual bytes processed, can be zero for no-data command.
  * \retval      negative    Indicate error e.g unsupported command, tinyusb will \b STALL the corresponding
  *                          endpoint and return failed status in command status wrapper phase.
+ * \retval      TUD_MSC_RET_ASYNC  Command is carried out asynchronously e.g forwarded to another device, buffer
+ *                          must stay valid until it is completed with tud_msc_async_io_done().
  */
 int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize);
 
@@ -146,6 +230,12 @@ TU_ATTR_WEAK void tud_msc_scsi_complete_cb(uint8_t lun, uint8_t const scsi_cmd[1
 // Invoked to check if device is writable as part of SCSI WRITE10
 TU_ATTR_WEAK bool tud_msc_is_writable_cb(uint8_t lun);
 
+// Invoked when host deallocates blocks with UNMAP or WRITE SAME with UNMAP bit e.g filesystem discard. Data of
+// unmapped blocks is indeterminate afterwards, flash translation layer can treat them as free. Implementing this
+// also reports thin provisioning to host (READ CAPACITY16 and VPD pages B0h/B2h) so that discard is enabled.
+// Return false to fail the command with MEDIUM ERROR unless sense is set.
+TU_ATTR_WEAK bool tud_msc_unmap_cb(uint8_t lun, uint32_t lba, uint32_t block_count);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -155,6 +245,7 @@ void     mscd_reset           (uint8_t rhport);
 uint16_t mscd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     mscd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
 bool     mscd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+void     mscd_sof             (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
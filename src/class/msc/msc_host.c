@@ -50,6 +50,43 @@ enum {
   MSC_STAGE_STATUS,
 };
 
+#if CFG_TUH_MSC_UAS
+enum {
+  UAS_SLOT_FREE = 0,
+  UAS_SLOT_PENDING, // waiting for command pipe
+  UAS_SLOT_SENT,    // Command IU sent, waiting for Ready or Sense IU
+};
+
+// a queued UAS command, identified by tag = slot index + 1
+typedef struct {
+  volatile uint8_t state;
+  uint8_t seq; // submit order
+  void* buffer;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t complete_arg;
+
+  msc_cbw_t cbw;
+  msc_csw_t csw;
+} msch_uas_slot_t;
+
+typedef union {
+  msc_uas_sense_iu_t    sense;
+  msc_uas_response_iu_t response;
+  msc_uas_ready_iu_t    ready;
+  uint8_t raw[64]; // Sense IU can come with more than fixed sense data
+} msch_uas_status_iu_t;
+#endif
+
+// a Bulk-Only command waiting for the bus, one per LUN
+typedef struct {
+  volatile bool pending;
+  void* buffer;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t complete_arg;
+
+  msc_cbw_t cbw;
+} msch_lun_cmd_t;
+
 typedef struct {
   uint8_t itf_num;
   uint8_t ep_in;
@@ -66,22 +103,42 @@ typedef struct {
   } capacity[CFG_TUH_MSC_MAXLUN];
 
   //------------- SCSI -------------//
-  uint8_t stage;
+  volatile uint8_t stage;
   void* buffer;
   tuh_msc_complete_cb_t complete_cb;
   uintptr_t complete_arg;
 
-  CFG_TUH_MEM_ALIGN msc_cbw_t cbw;
-  CFG_TUH_MEM_ALIGN msc_csw_t csw;
+  TUH_EPBUF_TYPE_DEF(msc_cbw_t, cbw);
+  TUH_EPBUF_TYPE_DEF(msc_csw_t, csw);
+
+  // responses of set_config sequence: Max LUN, Read Capacity and Request Sense (largest, 18 bytes). Interfaces are
+  // configured in parallel and past usbh_driver_set_config_release(), so each has its own
+  TUH_EPBUF_DEF(config_buf, 18);
+
+  uint8_t next_lun; // round-robin start when picking queued command
+  msch_lun_cmd_t lun_cmd[CFG_TUH_MSC_MAXLUN];
+
+#if CFG_TUH_MSC_UAS
+  //------------- UAS -------------//
+  // ep_in and ep_out are used as Data In and Data Out pipes
+  bool uas;           // UAS alternate is active
+  bool uas_available; // UAS alternate found when opened
+  uint8_t ep_cmd;
+  uint8_t ep_status;
+  uint8_t uas_seq;
+  uint8_t uas_cmd_tag;  // tag of Command IU on command pipe
+  uint8_t uas_data_tag; // tag of command in data phase
+
+  tusb_desc_endpoint_t uas_ep_desc[4]; // indexed by pipe ID - 1, opened after Set Interface
+  msch_uas_slot_t uas_slot[CFG_TUH_MSC_UAS_QUEUE_DEPTH];
+
+  TUH_EPBUF_TYPE_DEF(msc_uas_cmd_iu_t, uas_cmd_iu);
+  TUH_EPBUF_TYPE_DEF(msch_uas_status_iu_t, uas_status_iu);
+#endif
 } msch_interface_t;
 
 CFG_TUH_MEM_SECTION static msch_interface_t _msch_itf[CFG_TUH_DEVICE_MAX];
 
-// buffer used to read scsi information when mounted
-// largest response data currently is inquiry TODO Inquiry is not part of enum anymore
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
-static uint8_t _msch_buffer[sizeof(scsi_inquiry_resp_t)];
-
 // FIXME potential nul reference
 TU_ATTR_ALWAYS_INLINE
 static inline msch_interface_t* get_itf(uint8_t dev_addr) {
@@ -111,9 +168,55 @@ bool tuh_msc_mounted(uint8_t dev_addr) {
   return p_msc->mounted;
 }
 
+#if CFG_TUH_MSC_UAS
+static bool uas_scsi_command(uint8_t daddr, msch_interface_t* p_msc, msc_cbw_t const* cbw, void* data,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+static void uas_xfer_cb(uint8_t dev_addr, msch_interface_t* p_msc, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+
+TU_ATTR_ALWAYS_INLINE static inline msch_uas_slot_t* uas_find_slot(msch_interface_t* p_msc, uint8_t state) {
+  for (uint8_t i = 0; i < CFG_TUH_MSC_UAS_QUEUE_DEPTH; i++) {
+    if (p_msc->uas_slot[i].state == state) return &p_msc->uas_slot[i];
+  }
+  return NULL;
+}
+#endif
+
+static bool bot_has_pending(msch_interface_t const* p_msc) {
+  for (uint8_t lun = 0; lun < CFG_TUH_MSC_MAXLUN; lun++) {
+    if (p_msc->lun_cmd[lun].pending) return true;
+  }
+  return false;
+}
+
 bool tuh_msc_ready(uint8_t dev_addr) {
   msch_interface_t* p_msc = get_itf(dev_addr);
-  return p_msc->mounted && !usbh_edpt_busy(dev_addr, p_msc->ep_in) && !usbh_edpt_busy(dev_addr, p_msc->ep_out);
+#if CFG_TUH_MSC_UAS
+  if (p_msc->uas) {
+    return p_msc->mounted && (uas_find_slot(p_msc, UAS_SLOT_FREE) != NULL);
+  }
+#endif
+  return p_msc->mounted && (p_msc->stage == MSC_STAGE_IDLE) && !bot_has_pending(p_msc) &&
+         !usbh_edpt_busy(dev_addr, p_msc->ep_in) && !usbh_edpt_busy(dev_addr, p_msc->ep_out);
+}
+
+bool tuh_msc_lun_ready(uint8_t dev_addr, uint8_t lun) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+#if CFG_TUH_MSC_UAS
+  if (p_msc->uas) {
+    return tuh_msc_ready(dev_addr);
+  }
+#endif
+  return p_msc->mounted && (lun < CFG_TUH_MSC_MAXLUN) && !p_msc->lun_cmd[lun].pending;
+}
+
+bool tuh_msc_is_uas(uint8_t dev_addr) {
+#if CFG_TUH_MSC_UAS
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  return p_msc->uas;
+#else
+  (void) dev_addr;
+  return false;
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -126,24 +229,86 @@ static inline void cbw_init(msc_cbw_t* cbw, uint8_t lun) {
   cbw->lun       = lun;
 }
 
+static void bot_complete(uint8_t daddr, msch_interface_t* p_msc) {
+  if (p_msc->complete_cb) {
+    tuh_msc_complete_data_t const cb_data = {
+        .cbw = &p_msc->cbw,
+        .csw = &p_msc->csw,
+        .scsi_data = p_msc->buffer,
+        .user_arg = p_msc->complete_arg
+    };
+    p_msc->complete_cb(daddr, &cb_data);
+  }
+}
+
+// Send CBW of the next queued command (round-robin across LUNs) if no command is in progress.
+// Claiming ep_out serializes this between application and usbh task: whoever fails to claim relies on the holder
+// to re-check the queue after releasing.
+static void bot_start_next(uint8_t daddr, msch_interface_t* p_msc) {
+  while (p_msc->stage == MSC_STAGE_IDLE && bot_has_pending(p_msc)) {
+    // endpoint is busy or claimed by other context
+    TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_out), );
+
+    msch_lun_cmd_t* lun_cmd = NULL;
+    if (p_msc->stage == MSC_STAGE_IDLE) {
+      for (uint8_t i = 0; i < CFG_TUH_MSC_MAXLUN; i++) {
+        uint8_t const lun = (uint8_t) ((p_msc->next_lun + i) % CFG_TUH_MSC_MAXLUN);
+        if (p_msc->lun_cmd[lun].pending) {
+          lun_cmd = &p_msc->lun_cmd[lun];
+          p_msc->next_lun = (uint8_t) ((lun + 1) % CFG_TUH_MSC_MAXLUN);
+          break;
+        }
+      }
+    }
+
+    if (lun_cmd) {
+      p_msc->cbw = lun_cmd->cbw;
+      p_msc->buffer = lun_cmd->buffer;
+      p_msc->complete_cb = lun_cmd->complete_cb;
+      p_msc->complete_arg = lun_cmd->complete_arg;
+      p_msc->stage = MSC_STAGE_CMD;
+      lun_cmd->pending = false;
+
+      // endpoint is released once CBW is sent
+      if (usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) return;
+
+      // failed to send CBW: complete the command as failed
+      TU_LOG_DRV("  MSCh failed to send CBW\r\n");
+      p_msc->csw.signature = MSC_CSW_SIGNATURE;
+      p_msc->csw.tag = p_msc->cbw.tag;
+      p_msc->csw.data_residue = p_msc->cbw.total_bytes;
+      p_msc->csw.status = MSC_CSW_STATUS_FAILED;
+      p_msc->stage = MSC_STAGE_IDLE;
+      usbh_edpt_release(daddr, p_msc->ep_out);
+      bot_complete(daddr, p_msc);
+    } else {
+      usbh_edpt_release(daddr, p_msc->ep_out);
+    }
+  }
+}
+
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data,
                           tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(daddr);
   TU_VERIFY(p_msc->configured);
 
-  // claim endpoint
-  TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_out));
+#if CFG_TUH_MSC_UAS
+  if (p_msc->uas) {
+    return uas_scsi_command(daddr, p_msc, cbw, data, complete_cb, arg);
+  }
+#endif
+
+  TU_VERIFY(cbw->lun < CFG_TUH_MSC_MAXLUN);
+  msch_lun_cmd_t* lun_cmd = &p_msc->lun_cmd[cbw->lun];
+  TU_VERIFY(!lun_cmd->pending);
 
-  p_msc->cbw = *cbw;
-  p_msc->stage = MSC_STAGE_CMD;
-  p_msc->buffer = data;
-  p_msc->complete_cb = complete_cb;
-  p_msc->complete_arg = arg;
+  lun_cmd->cbw = *cbw;
+  lun_cmd->buffer = data;
+  lun_cmd->complete_cb = complete_cb;
+  lun_cmd->complete_arg = arg;
+  lun_cmd->pending = true;
 
-  if (!usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t))) {
-    usbh_edpt_release(daddr, p_msc->ep_out);
-    return false;
-  }
+  bot_start_next(daddr, p_msc);
 
   return true;
 }
@@ -263,6 +428,56 @@ bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t
   return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
 }
 
+// write 64-bit LBA and 32-bit block count of READ16/WRITE16 in Big Endian
+static void rdwr16_set_lba_count(uint8_t command[], uint64_t lba, uint32_t block_count) {
+  uint8_t* p_lba = command + offsetof(scsi_read16_t, lba);
+  tu_unaligned_write32(p_lba    , tu_htonl((uint32_t) (lba >> 32)));
+  tu_unaligned_write32(p_lba + 4, tu_htonl((uint32_t) lba));
+  tu_unaligned_write32(command + offsetof(scsi_read16_t, block_count), tu_htonl(block_count));
+}
+
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void* buffer, uint64_t lba, uint32_t block_count,
+                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // total bytes of CBW is 32-bit
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size && block_count <= UINT32_MAX / block_size);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = block_count * block_size;
+  cbw.dir         = TUSB_DIR_IN_MASK;
+  cbw.cmd_len     = sizeof(scsi_read16_t);
+  cbw.command[0]  = SCSI_CMD_READ_16;
+  rdwr16_set_lba_count(cbw.command, lba, block_count);
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, buffer, complete_cb, arg);
+}
+
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t block_count,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // total bytes of CBW is 32-bit
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size && block_count <= UINT32_MAX / block_size);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = block_count * block_size;
+  cbw.dir         = TUSB_DIR_OUT;
+  cbw.cmd_len     = sizeof(scsi_write16_t);
+  cbw.command[0]  = SCSI_CMD_WRITE_16;
+  rdwr16_set_lba_count(cbw.command, lba, block_count);
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
+}
+
 #if 0
 // MSC interface Reset (not used now)
 bool tuh_msc_reset(uint8_t dev_addr) {
@@ -281,6 +496,219 @@ bool tuh_msc_reset(uint8_t dev_addr) {
 }
 #endif
 
+#if CFG_TUH_MSC_UAS
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS)
+// Without streams (USB 2.0), device announces data phase of a command with Read/Write Ready IU and report
+// its status with Sense IU on status pipe. Commands are queued to device while older ones are executing.
+//--------------------------------------------------------------------+
+
+static inline msch_uas_slot_t* uas_get_slot(msch_interface_t* p_msc, uint16_t tag) {
+  if (tag == 0 || tag > CFG_TUH_MSC_UAS_QUEUE_DEPTH) return NULL;
+  msch_uas_slot_t* slot = &p_msc->uas_slot[tag - 1];
+  return (slot->state == UAS_SLOT_SENT) ? slot : NULL;
+}
+
+static void uas_complete(uint8_t daddr, msch_uas_slot_t* slot, uint8_t status) {
+  slot->csw.signature = MSC_CSW_SIGNATURE;
+  slot->csw.tag       = slot->cbw.tag;
+  slot->csw.status    = status;
+
+  // free slot first, callback may submit another command
+  slot->state = UAS_SLOT_FREE;
+
+  if (slot->complete_cb) {
+    tuh_msc_complete_data_t const cb_data = {
+        .cbw = &slot->cbw,
+        .csw = &slot->csw,
+        .scsi_data = slot->buffer,
+        .user_arg = slot->complete_arg
+    };
+    slot->complete_cb(daddr, &cb_data);
+  }
+}
+
+// send oldest pending Command IU if command pipe is free
+static void uas_send_cmd(uint8_t daddr, msch_interface_t* p_msc) {
+  TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_cmd), );
+
+  msch_uas_slot_t* slot = NULL;
+  uint8_t max_age = 0;
+  for (uint8_t i = 0; i < CFG_TUH_MSC_UAS_QUEUE_DEPTH; i++) {
+    msch_uas_slot_t* cur = &p_msc->uas_slot[i];
+    uint8_t const age = (uint8_t) (p_msc->uas_seq - cur->seq);
+    if (cur->state == UAS_SLOT_PENDING && (slot == NULL || age > max_age)) {
+      slot = cur;
+      max_age = age;
+    }
+  }
+
+  if (slot == NULL) {
+    usbh_edpt_release(daddr, p_msc->ep_cmd);
+    return;
+  }
+
+  msc_uas_cmd_iu_t* cmd_iu = &p_msc->uas_cmd_iu;
+  tu_memclr(cmd_iu, sizeof(msc_uas_cmd_iu_t));
+  cmd_iu->iu_id  = MSC_UAS_IU_COMMAND;
+  cmd_iu->tag    = tu_htons((uint16_t) slot->cbw.tag);
+  cmd_iu->lun[1] = slot->cbw.lun;
+  memcpy(cmd_iu->cdb, slot->cbw.command, tu_min8(slot->cbw.cmd_len, (uint8_t) sizeof(cmd_iu->cdb)));
+
+  slot->state = UAS_SLOT_SENT;
+  p_msc->uas_cmd_tag = (uint8_t) slot->cbw.tag;
+
+  if (!usbh_edpt_xfer(daddr, p_msc->ep_cmd, (uint8_t*) cmd_iu, sizeof(msc_uas_cmd_iu_t))) {
+    usbh_edpt_release(daddr, p_msc->ep_cmd);
+    uas_complete(daddr, slot, MSC_CSW_STATUS_PHASE_ERROR);
+  }
+}
+
+static bool uas_recv_status(uint8_t daddr, msch_interface_t* p_msc) {
+  return usbh_edpt_xfer(daddr, p_msc->ep_status, p_msc->uas_status_iu.raw, sizeof(p_msc->uas_status_iu));
+}
+
+static bool uas_scsi_command(uint8_t daddr, msch_interface_t* p_msc, msc_cbw_t const* cbw, void* data,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_uas_slot_t* slot = uas_find_slot(p_msc, UAS_SLOT_FREE);
+  TU_VERIFY(slot);
+
+  slot->cbw = *cbw;
+  slot->cbw.tag = (uint32_t) (slot - p_msc->uas_slot) + 1;
+  tu_memclr(&slot->csw, sizeof(msc_csw_t));
+  slot->csw.data_residue = cbw->total_bytes;
+  slot->buffer = data;
+  slot->complete_cb = complete_cb;
+  slot->complete_arg = arg;
+  slot->seq = p_msc->uas_seq++;
+  slot->state = UAS_SLOT_PENDING;
+
+  uas_send_cmd(daddr, p_msc);
+  return true;
+}
+
+static void uas_proc_status(uint8_t daddr, msch_interface_t* p_msc, uint32_t xferred_bytes) {
+  uint8_t const iu_id = p_msc->uas_status_iu.raw[0];
+  uint16_t const tag = tu_ntohs(tu_unaligned_read16(&p_msc->uas_status_iu.raw[2]));
+
+  msch_uas_slot_t* slot = uas_get_slot(p_msc, tag);
+  if (slot == NULL || xferred_bytes < sizeof(msc_uas_ready_iu_t)) {
+    TU_LOG_DRV("  UAS unexpected IU %u tag %u\r\n", iu_id, tag);
+    return;
+  }
+
+  switch (iu_id) {
+    case MSC_UAS_IU_READ_READY:
+    case MSC_UAS_IU_WRITE_READY: {
+      msc_cbw_t const* cbw = &slot->cbw;
+      uint8_t const ep_data = (iu_id == MSC_UAS_IU_READ_READY) ? p_msc->ep_in : p_msc->ep_out;
+      if (cbw->total_bytes && slot->buffer) {
+        p_msc->uas_data_tag = (uint8_t) tag;
+        TU_ASSERT(usbh_edpt_xfer(daddr, ep_data, slot->buffer, cbw->total_bytes), );
+      }
+      break;
+    }
+
+    case MSC_UAS_IU_SENSE: {
+      msc_uas_sense_iu_t const* sense_iu = &p_msc->uas_status_iu.sense;
+      uas_complete(daddr, slot, (sense_iu->status == SCSI_STATUS_GOOD) ? MSC_CSW_STATUS_PASSED : MSC_CSW_STATUS_FAILED);
+      break;
+    }
+
+    case MSC_UAS_IU_RESPONSE:
+      // command is rejected e.g invalid or overlapped tag
+      TU_LOG_DRV("  UAS response code %u\r\n", p_msc->uas_status_iu.response.rsp_code);
+      uas_complete(daddr, slot, MSC_CSW_STATUS_FAILED);
+      break;
+
+    default: break;
+  }
+}
+
+static void uas_xfer_cb(uint8_t dev_addr, msch_interface_t* p_msc, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  if (ep_addr == p_msc->ep_cmd) {
+    msch_uas_slot_t* slot = uas_get_slot(p_msc, p_msc->uas_cmd_tag);
+    if (slot && event != XFER_RESULT_SUCCESS) {
+      uas_complete(dev_addr, slot, MSC_CSW_STATUS_PHASE_ERROR);
+    }
+    uas_send_cmd(dev_addr, p_msc);
+  } else if (ep_addr == p_msc->ep_status) {
+    TU_ASSERT(event == XFER_RESULT_SUCCESS, );
+    uas_proc_status(dev_addr, p_msc, xferred_bytes);
+    TU_ASSERT(uas_recv_status(dev_addr, p_msc), );
+  } else {
+    // data phase is complete, status will follow in Sense IU
+    msch_uas_slot_t* slot = uas_get_slot(p_msc, p_msc->uas_data_tag);
+    if (slot) {
+      slot->csw.data_residue = slot->cbw.total_bytes - tu_min32(xferred_bytes, slot->cbw.total_bytes);
+    }
+  }
+}
+
+// find UAS alternate of the interface and save its endpoints for later opening
+static bool uas_parse_alt(msch_interface_t* p_msc, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+  uint8_t found = 0;
+
+  // skip alternate 0
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end && tu_desc_type(p_desc) != TUSB_DESC_INTERFACE) p_desc = tu_desc_next(p_desc);
+
+  while (p_desc < desc_end && tu_desc_type(p_desc) == TUSB_DESC_INTERFACE) {
+    tusb_desc_interface_t const* desc_alt = (tusb_desc_interface_t const*) p_desc;
+    p_desc = tu_desc_next(p_desc);
+
+    bool const is_uas = desc_alt->bInterfaceNumber == desc_itf->bInterfaceNumber &&
+                        desc_alt->bInterfaceClass == TUSB_CLASS_MSC &&
+                        desc_alt->bInterfaceProtocol == MSC_PROTOCOL_UAS &&
+                        desc_alt->bNumEndpoints == 4;
+
+    // each endpoint is followed by its Pipe Usage descriptor
+    uint8_t const* ep_desc = NULL;
+    while (p_desc < desc_end && tu_desc_type(p_desc) != TUSB_DESC_INTERFACE) {
+      if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+        ep_desc = p_desc;
+      } else if (is_uas && ep_desc && tu_desc_type(p_desc) == MSC_UAS_DESC_TYPE_PIPE_USAGE) {
+        uint8_t const pipe_id = p_desc[2];
+        if (pipe_id >= MSC_UAS_PIPE_ID_COMMAND && pipe_id <= MSC_UAS_PIPE_ID_DATA_OUT &&
+            TUSB_XFER_BULK == ((tusb_desc_endpoint_t const*) ep_desc)->bmAttributes.xfer) {
+          memcpy(&p_msc->uas_ep_desc[pipe_id - 1], ep_desc, sizeof(tusb_desc_endpoint_t));
+          found = (uint8_t) (found | TU_BIT(pipe_id - 1));
+        }
+        ep_desc = NULL;
+      }
+      p_desc = tu_desc_next(p_desc);
+    }
+
+    if (is_uas) break;
+  }
+
+  p_msc->uas_available = (found == 0x0F);
+  return p_msc->uas_available;
+}
+
+// open endpoints of UAS alternate, ones that have same address as Bulk-Only's are already opened
+static bool uas_open(uint8_t dev_addr, msch_interface_t* p_msc) {
+  uint8_t ep_addr[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    tusb_desc_endpoint_t const* ep_desc = &p_msc->uas_ep_desc[i];
+    ep_addr[i] = ep_desc->bEndpointAddress;
+    if (ep_addr[i] != p_msc->ep_in && ep_addr[i] != p_msc->ep_out) {
+      TU_ASSERT(tuh_edpt_open(dev_addr, ep_desc));
+    }
+  }
+
+  p_msc->ep_cmd    = ep_addr[MSC_UAS_PIPE_ID_COMMAND - 1];
+  p_msc->ep_status = ep_addr[MSC_UAS_PIPE_ID_STATUS - 1];
+  p_msc->ep_in     = ep_addr[MSC_UAS_PIPE_ID_DATA_IN - 1];
+  p_msc->ep_out    = ep_addr[MSC_UAS_PIPE_ID_DATA_OUT - 1];
+  p_msc->uas       = true;
+
+  return uas_recv_status(dev_addr, p_msc);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // CLASS-USBH API
 //--------------------------------------------------------------------+
@@ -312,7 +740,13 @@ void msch_close(uint8_t dev_addr) {
 bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   msc_cbw_t const * cbw = &p_msc->cbw;
-  msc_csw_t       * csw = &p_msc->csw;
+
+#if CFG_TUH_MSC_UAS
+  if (p_msc->uas) {
+    uas_xfer_cb(dev_addr, p_msc, ep_addr, event, xferred_bytes);
+    return true;
+  }
+#endif
 
   switch (p_msc->stage) {
     case MSC_STAGE_CMD:
@@ -338,18 +772,11 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
       break;
 
     case MSC_STAGE_STATUS:
-      // SCSI op is complete
+      // SCSI op is complete. Stay in status stage while invoking callback so that cbw/csw are kept intact, new
+      // command submitted by callback is queued and sent afterwards.
+      bot_complete(dev_addr, p_msc);
       p_msc->stage = MSC_STAGE_IDLE;
-
-      if (p_msc->complete_cb) {
-        tuh_msc_complete_data_t const cb_data = {
-            .cbw = cbw,
-            .csw = csw,
-            .scsi_data = p_msc->buffer,
-            .user_arg = p_msc->complete_arg
-        };
-        p_msc->complete_cb(dev_addr, &cb_data);
-      }
+      bot_start_next(dev_addr, p_msc);
       break;
 
       // unknown state
@@ -363,7 +790,11 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
 //--------------------------------------------------------------------+
 // MSC Enumeration
 //--------------------------------------------------------------------+
+static bool config_get_maxlun(uint8_t dev_addr, uint8_t itf_num);
 static void config_get_maxlun_complete(tuh_xfer_t* xfer);
+#if CFG_TUH_MSC_UAS
+static void config_set_uas_complete(tuh_xfer_t* xfer);
+#endif
 static bool config_test_unit_ready_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_request_sense_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
@@ -396,6 +827,12 @@ bool msch_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* de
 
   p_msc->itf_num = desc_itf->bInterfaceNumber;
 
+#if CFG_TUH_MSC_UAS
+  if (uas_parse_alt(p_msc, desc_itf, max_len)) {
+    TU_LOG_DRV("  UAS alternate found\r\n");
+  }
+#endif
+
   return true;
 }
 
@@ -405,8 +842,35 @@ bool msch_set_config(uint8_t dev_addr, uint8_t itf_num) {
 
   p_msc->configured = true;
 
-  //------------- Get Max Lun -------------//
+#if CFG_TUH_MSC_UAS
+  if (p_msc->uas_available) {
+    // switch to UAS alternate, fall back to Bulk-Only if failed
+    TU_ASSERT(tuh_interface_set(dev_addr, itf_num, 1, config_set_uas_complete, 0));
+    return true;
+  }
+#endif
+
+  return config_get_maxlun(dev_addr, itf_num);
+}
+
+#if CFG_TUH_MSC_UAS
+static void config_set_uas_complete(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  msch_interface_t* p_msc = get_itf(daddr);
+
+  if (XFER_RESULT_SUCCESS == xfer->result) {
+    TU_LOG_DRV("MSC UAS is selected\r\n");
+    TU_ASSERT(uas_open(daddr, p_msc), );
+  }
+
+  // UAS does not define Get Max Lun, STALL is treated as single LUN
+  TU_ASSERT(config_get_maxlun(daddr, p_msc->itf_num), );
+}
+#endif
+
+static bool config_get_maxlun(uint8_t dev_addr, uint8_t itf_num) {
   TU_LOG_DRV("MSC Get Max Lun\r\n");
+  msch_interface_t* p_msc = get_itf(dev_addr);
   tusb_control_request_t const request = {
       .bmRequestType_bit = {
           .recipient = TUSB_REQ_RCPT_INTERFACE,
@@ -423,7 +887,7 @@ bool msch_set_config(uint8_t dev_addr, uint8_t itf_num) {
       .daddr       = dev_addr,
       .ep_addr     = 0,
       .setup       = &request,
-      .buffer      = _msch_buffer,
+      .buffer      = p_msc->config_buf,
       .complete_cb = config_get_maxlun_complete,
       .user_data    = 0
   };
@@ -437,11 +901,14 @@ static void config_get_maxlun_complete(tuh_xfer_t* xfer) {
   msch_interface_t* p_msc = get_itf(daddr);
 
   // STALL means zero
-  p_msc->max_lun = (XFER_RESULT_SUCCESS == xfer->result) ? _msch_buffer[0] : 0;
+  p_msc->max_lun = (XFER_RESULT_SUCCESS == xfer->result) ? p_msc->config_buf[0] : 0;
   p_msc->max_lun++; // MAX LUN is minus 1 by specs
 
   TU_LOG_DRV("  Max LUN = %u\r\n", p_msc->max_lun);
 
+  // rest of the sequence is on bulk endpoints, other interfaces can be configured meanwhile
+  usbh_driver_set_config_release(daddr, p_msc->itf_num);
+
   // TODO multiple LUN support
   TU_LOG_DRV("SCSI Test Unit Ready\r\n");
   uint8_t const lun = 0;
@@ -451,18 +918,19 @@ static void config_get_maxlun_complete(tuh_xfer_t* xfer) {
 static bool config_test_unit_ready_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data) {
   msc_cbw_t const* cbw = cb_data->cbw;
   msc_csw_t const* csw = cb_data->csw;
+  msch_interface_t* p_msc = get_itf(dev_addr);
 
   if (csw->status == 0) {
     // Unit is ready, read its capacity
     TU_LOG_DRV("SCSI Read Capacity\r\n");
-    tuh_msc_read_capacity(dev_addr, cbw->lun, (scsi_read_capacity10_resp_t*) ((void*) _msch_buffer),
+    tuh_msc_read_capacity(dev_addr, cbw->lun, (scsi_read_capacity10_resp_t*) ((void*) p_msc->config_buf),
                           config_read_capacity_complete, 0);
   } else {
     // Note: During enumeration, some device fails Test Unit Ready and require a few retries
     // with Request Sense to start working !!
     // TODO limit number of retries
     TU_LOG_DRV("SCSI Request Sense\r\n");
-    TU_ASSERT(tuh_msc_request_sense(dev_addr, cbw->lun, _msch_buffer, config_request_sense_complete, 0));
+    TU_ASSERT(tuh_msc_request_sense(dev_addr, cbw->lun, p_msc->config_buf, config_request_sense_complete, 0));
   }
 
   return true;
@@ -486,7 +954,7 @@ static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_dat
   msch_interface_t* p_msc = get_itf(dev_addr);
 
   // Capacity response field: Block size and Last LBA are both Big-Endian
-  scsi_read_capacity10_resp_t* resp = (scsi_read_capacity10_resp_t*) ((void*) _msch_buffer);
+  scsi_read_capacity10_resp_t* resp = (scsi_read_capacity10_resp_t*) ((void*) p_msc->config_buf);
   p_msc->capacity[cbw->lun].block_count = tu_ntohl(resp->last_lba) + 1;
   p_msc->capacity[cbw->lun].block_size  = tu_ntohl(resp->block_size);
 
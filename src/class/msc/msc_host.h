@@ -41,6 +41,17 @@
 #define CFG_TUH_MSC_MAXLUN  4
 #endif
 
+// USB Attached SCSI (UAS): use alternate setting with UAS protocol if device supports it,
+// SCSI commands are tagged and queued to the device. Bulk-Only is used otherwise.
+#ifndef CFG_TUH_MSC_UAS
+#define CFG_TUH_MSC_UAS  0
+#endif
+
+// Number of UAS commands that can be submitted to a device at the same time
+#ifndef CFG_TUH_MSC_UAS_QUEUE_DEPTH
+#define CFG_TUH_MSC_UAS_QUEUE_DEPTH  4
+#endif
+
 typedef struct {
   msc_cbw_t const* cbw; // SCSI command
   msc_csw_t const* csw; // SCSI status
@@ -58,9 +69,18 @@ typedef bool (*tuh_msc_complete_cb_t)(uint8_t dev_addr, tuh_msc_complete_data_t
 // This function true after tuh_msc_mounted_cb() and false after tuh_msc_unmounted_cb()
 bool tuh_msc_mounted(uint8_t dev_addr);
 
-// Check if the interface is currently ready or busy transferring data
+// Check if the interface is currently ready or busy transferring data.
+// With UAS, true if another command can be queued
 bool tuh_msc_ready(uint8_t dev_addr);
 
+// Check if a command can be submitted to a LUN. Each LUN has its own command context: commands to different LUNs
+// can be submitted at the same time, they are queued by the driver and executed one at a time in round-robin.
+// With UAS, same as tuh_msc_ready()
+bool tuh_msc_lun_ready(uint8_t dev_addr, uint8_t lun);
+
+// Check if device is operated with USB Attached SCSI (UAS) rather than Bulk-Only Transport
+bool tuh_msc_is_uas(uint8_t dev_addr);
+
 // Get Max Lun
 uint8_t tuh_msc_get_maxlun(uint8_t dev_addr);
 
@@ -72,7 +92,11 @@ uint32_t tuh_msc_get_block_size(uint8_t dev_addr, uint8_t lun);
 
 // Perform a full SCSI command (cbw, data, csw) in non-blocking manner.
 // Complete callback is invoked when SCSI op is complete.
-// return true if success, false if there is already pending operation.
+// return true if success, false if there is already pending operation for the same LUN.
+// With Bulk-Only Transport, command is queued if another LUN's command is in progress. Complete callback can submit
+// a new command, it is executed after the ones already queued for other LUNs.
+// With UAS, up to CFG_TUH_MSC_UAS_QUEUE_DEPTH commands can be pending, CBW's tag is assigned by the stack and CSW
+// is converted from the Sense IU. Note: autosense data is not reported, Request Sense is not needed to clear it.
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
 // Perform SCSI Inquiry command
@@ -95,6 +119,16 @@ bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void * buffer, uint32_t lba,
 // Complete callback is invoked when SCSI op is complete.
 bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const * buffer, uint32_t lba, uint16_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read 16 command. Same as tuh_msc_read10() but with 64-bit LBA and 32-bit block count,
+// allowing large sequential reads with fewer commands. Total bytes must fit in 32-bit.
+// Complete callback is invoked when SCSI op is complete.
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void * buffer, uint64_t lba, uint32_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
+// Perform SCSI Write 16 command. Same as tuh_msc_write10() but with 64-bit LBA and 32-bit block count.
+// Total bytes must fit in 32-bit.
+// Complete callback is invoked when SCSI op is complete.
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, void const * buffer, uint64_t lba, uint32_t block_count, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 // Perform SCSI Read Capacity 10 command
 // Complete callback is invoked when SCSI op is complete.
 // Note: during enumeration, host stack already carried out this request. Application can retrieve capacity by
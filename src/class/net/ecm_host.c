@@ -0,0 +1,573 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_ECM)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "ecm_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_ECM_LOG_LEVEL
+  #define CFG_TUH_ECM_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_ECM_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC(CFG_TUH_ECM_FRAME_BUFSIZE >= 1514 + 1 && CFG_TUH_ECM_FRAME_BUFSIZE <= 0xFFFF,
+                 "frame buffer must hold a full Ethernet frame plus padding byte");
+TU_VERIFY_STATIC((CFG_TUH_ECM_FRAME_BUFSIZE % 64) == 0, "frame buffer size must be multiple of bulk packet size");
+TU_VERIFY_STATIC(CFG_TUH_ECM_RX_BUF_N >= 1 && CFG_TUH_ECM_TX_BUF_N >= 1, "at least one frame buffer is required");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+enum {
+  ECMH_NOTIF_BUFSIZE = 16 // notification header + 8 bytes of CONNECTION_SPEED_CHANGE data
+};
+
+typedef struct {
+  uint8_t daddr;
+
+  uint8_t itf_num;        // Communication Interface
+  uint8_t itf_data;       // Data Interface
+  uint8_t itf_data_alt;   // Alternate setting of Data Interface with bulk endpoints
+  bool mounted;           // Enumeration is complete
+  bool link_up;           // Last reported by NETWORK_CONNECTION notification
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_notif_size;
+  uint16_t ep_out_size;
+
+  uint8_t mac_str_index;  // iMACAddress of Ethernet Networking Functional Descriptor
+  bool has_mac;
+  uint8_t mac_address[6];
+
+  // Receive: one frame per transfer
+  uint8_t rx_head;        // Index in receive_buf[] of the oldest received frame
+  uint8_t rx_count;       // Number of received frames not yet released by client
+  bool rx_holding;        // Client is holding receive_buf[rx_head] until tuh_network_recv_renew()
+  uint16_t rx_len[CFG_TUH_ECM_RX_BUF_N];
+
+  // Transmit: one frame per transfer
+  uint8_t tx_head;        // Index in transmit_buf[] of the oldest queued frame, sent first
+  uint8_t tx_count;       // Number of frames waiting for or being transferred
+  bool transferring;
+  uint16_t tx_len[CFG_TUH_ECM_TX_BUF_N];
+
+  CFG_TUH_MEM_ALIGN uint8_t receive_buf[CFG_TUH_ECM_RX_BUF_N][CFG_TUH_ECM_FRAME_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t transmit_buf[CFG_TUH_ECM_TX_BUF_N][CFG_TUH_ECM_FRAME_BUFSIZE];
+  CFG_TUH_MEM_ALIGN uint8_t notif_buf[ECMH_NOTIF_BUFSIZE];
+} ecmh_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static ecmh_interface_t _ecmh_itf[CFG_TUH_ECM];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline ecmh_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_ECM, NULL);
+  ecmh_interface_t* p_ecm = &_ecmh_itf[idx];
+  return (p_ecm->daddr != 0) ? p_ecm : NULL;
+}
+
+// Get instance ID by endpoint address
+static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ECM; idx++) {
+    ecmh_interface_t const* p_ecm = &_ecmh_itf[idx];
+    if (p_ecm->daddr == daddr &&
+        (p_ecm->ep_notif == ep_addr || p_ecm->ep_in == ep_addr || p_ecm->ep_out == ep_addr)) {
+      return idx;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static ecmh_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_ECM; i++) {
+    if (_ecmh_itf[i].daddr == 0) return &_ecmh_itf[i];
+  }
+  return NULL;
+}
+
+static bool ecmh_control_xfer(uint8_t daddr, uint8_t itf_num, uint8_t request, uint16_t value,
+                              tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  tusb_control_request_t const req = {
+      .bmRequestType_bit = {
+          .recipient = TUSB_REQ_RCPT_INTERFACE,
+          .type      = TUSB_REQ_TYPE_CLASS,
+          .direction = TUSB_DIR_OUT
+      },
+      .bRequest = request,
+      .wValue   = tu_htole16(value),
+      .wIndex   = tu_htole16((uint16_t) itf_num),
+      .wLength  = 0
+  };
+
+  tuh_xfer_t xfer = {
+      .daddr       = daddr,
+      .ep_addr     = 0,
+      .setup       = &req,
+      .buffer      = NULL,
+      .complete_cb = complete_cb,
+      .user_data   = user_data
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+uint8_t tuh_ecm_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ECM; idx++) {
+    ecmh_interface_t const* p_ecm = &_ecmh_itf[idx];
+    if (p_ecm->daddr == daddr && p_ecm->itf_num == itf_num) return idx;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_ecm_mounted(uint8_t idx) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm);
+  return p_ecm->mounted;
+}
+
+bool tuh_ecm_get_mac_address(uint8_t idx, uint8_t mac[6]) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted && p_ecm->has_mac);
+  memcpy(mac, p_ecm->mac_address, 6);
+  return true;
+}
+
+bool tuh_ecm_link_is_up(uint8_t idx) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted);
+  return p_ecm->link_up;
+}
+
+bool tuh_ecm_set_packet_filter(uint8_t idx, uint16_t filter, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted);
+  return ecmh_control_xfer(p_ecm->daddr, p_ecm->itf_num, CDC_REQUEST_SET_ETHERNET_PACKET_FILTER, filter,
+                           complete_cb, user_data);
+}
+
+//--------------------------------------------------------------------+
+// Receive
+//--------------------------------------------------------------------+
+
+// Receive the next frame if there is a free buffer and the endpoint is idle
+static void ecmh_recv_arm(ecmh_interface_t* p_ecm) {
+  if (p_ecm->rx_count >= CFG_TUH_ECM_RX_BUF_N) return;
+  TU_VERIFY(usbh_edpt_claim(p_ecm->daddr, p_ecm->ep_in),);
+
+  uint8_t const i = (p_ecm->rx_head + p_ecm->rx_count) % CFG_TUH_ECM_RX_BUF_N;
+  if (!usbh_edpt_xfer(p_ecm->daddr, p_ecm->ep_in, p_ecm->receive_buf[i], CFG_TUH_ECM_FRAME_BUFSIZE)) {
+    usbh_edpt_release(p_ecm->daddr, p_ecm->ep_in);
+  }
+}
+
+void tuh_network_recv_renew(uint8_t idx) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted,);
+
+  // release frame held by client
+  if (p_ecm->rx_holding) {
+    p_ecm->rx_holding = false;
+    p_ecm->rx_head = (uint8_t) ((p_ecm->rx_head + 1) % CFG_TUH_ECM_RX_BUF_N);
+    p_ecm->rx_count--;
+  }
+  ecmh_recv_arm(p_ecm);
+
+  if (!p_ecm->rx_count) return;
+
+  p_ecm->rx_holding = true;
+  tuh_network_recv_cb(idx, p_ecm->receive_buf[p_ecm->rx_head], p_ecm->rx_len[p_ecm->rx_head]);
+}
+
+static void handle_incoming_frame(uint8_t idx, ecmh_interface_t* p_ecm, uint32_t len) {
+  if (len > 0) {
+    uint8_t const i = (p_ecm->rx_head + p_ecm->rx_count) % CFG_TUH_ECM_RX_BUF_N;
+    p_ecm->rx_len[i] = (uint16_t) len;
+    p_ecm->rx_count++;
+
+    // deliver now if client is not holding a frame, otherwise on next tuh_network_recv_renew()
+    if (!p_ecm->rx_holding) {
+      tuh_network_recv_renew(idx);
+      return;
+    }
+  }
+
+  // empty or failed transfer is dropped and its buffer is reused
+  ecmh_recv_arm(p_ecm);
+}
+
+//--------------------------------------------------------------------+
+// Transmit
+//--------------------------------------------------------------------+
+
+// If not already transmitting, start sending the oldest queued frame to the device
+static void ecmh_start_tx(ecmh_interface_t* p_ecm) {
+  if (p_ecm->transferring || !p_ecm->tx_count) return;
+
+  TU_VERIFY(usbh_edpt_claim(p_ecm->daddr, p_ecm->ep_out),);
+  if (!usbh_edpt_xfer(p_ecm->daddr, p_ecm->ep_out, p_ecm->transmit_buf[p_ecm->tx_head],
+                      p_ecm->tx_len[p_ecm->tx_head])) {
+    usbh_edpt_release(p_ecm->daddr, p_ecm->ep_out);
+    return;
+  }
+
+  p_ecm->transferring = true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* ecmh_tx_tail(ecmh_interface_t* p_ecm) {
+  return p_ecm->transmit_buf[(p_ecm->tx_head + p_ecm->tx_count) % CFG_TUH_ECM_TX_BUF_N];
+}
+
+bool tuh_network_can_xmit(uint8_t idx, uint16_t size) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted);
+
+  // keep one byte for padding
+  return p_ecm->tx_count < CFG_TUH_ECM_TX_BUF_N && size < CFG_TUH_ECM_FRAME_BUFSIZE;
+}
+
+uint8_t* tuh_network_xmit_reserve(uint8_t idx, uint16_t size) {
+  TU_VERIFY(tuh_network_can_xmit(idx, size), NULL);
+  return ecmh_tx_tail(&_ecmh_itf[idx]);
+}
+
+void tuh_network_xmit_commit(uint8_t idx, uint16_t size) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted,);
+
+  // frame must end with a short packet, pad one byte instead of sending ZLP. Same as Linux usbnet,
+  // devices ignore the extra byte after the Ethernet frame
+  if ((size % p_ecm->ep_out_size) == 0) {
+    ecmh_tx_tail(p_ecm)[size] = 0;
+    size++;
+  }
+
+  p_ecm->tx_len[(p_ecm->tx_head + p_ecm->tx_count) % CFG_TUH_ECM_TX_BUF_N] = size;
+  p_ecm->tx_count++;
+
+  ecmh_start_tx(p_ecm);
+}
+
+void tuh_network_xmit(uint8_t idx, void* ref, uint16_t arg) {
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm && p_ecm->mounted,);
+
+  uint16_t const size = tuh_network_xmit_cb(idx, ecmh_tx_tail(p_ecm), ref, arg);
+  tuh_network_xmit_commit(idx, size);
+}
+
+//--------------------------------------------------------------------+
+// Notification
+//--------------------------------------------------------------------+
+
+static void ecmh_notif_arm(ecmh_interface_t* p_ecm) {
+  if (!p_ecm->ep_notif) return;
+  TU_VERIFY(usbh_edpt_claim(p_ecm->daddr, p_ecm->ep_notif),);
+
+  // request one packet at most so that each notification completes on its own
+  uint16_t const len = tu_min16(p_ecm->ep_notif_size, ECMH_NOTIF_BUFSIZE);
+  if (!usbh_edpt_xfer(p_ecm->daddr, p_ecm->ep_notif, p_ecm->notif_buf, len)) {
+    usbh_edpt_release(p_ecm->daddr, p_ecm->ep_notif);
+  }
+}
+
+static void handle_notification(uint8_t idx, ecmh_interface_t* p_ecm, uint32_t len) {
+  tusb_control_request_t const* notif = (tusb_control_request_t const*) p_ecm->notif_buf;
+
+  if (len >= sizeof(tusb_control_request_t) && notif->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS) {
+    switch (notif->bRequest) {
+      case CDC_NOTIF_NETWORK_CONNECTION:
+        p_ecm->link_up = (tu_le16toh(notif->wValue) != 0);
+        TU_LOG_DRV("  ECMh link %s\r\n", p_ecm->link_up ? "up" : "down");
+        if (tuh_network_link_state_cb) tuh_network_link_state_cb(idx, p_ecm->link_up);
+        break;
+
+      case CDC_NOTIF_CONNECTION_SPEED_CHANGE:
+        // DLBitRate and ULBitRate follow in the same or next packet, only logged
+        if (len >= ECMH_NOTIF_BUFSIZE) {
+          TU_LOG_DRV("  ECMh speed down = %" PRIu32 ", up = %" PRIu32 "\r\n",
+                     tu_unaligned_read32(p_ecm->notif_buf + 8), tu_unaligned_read32(p_ecm->notif_buf + 12));
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  ecmh_notif_arm(p_ecm);
+}
+
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+bool ecmh_init(void) {
+  TU_LOG_DRV("sizeof(ecmh_interface_t) = %u\r\n", sizeof(ecmh_interface_t));
+  tu_memclr(_ecmh_itf, sizeof(_ecmh_itf));
+  return true;
+}
+
+bool ecmh_deinit(void) {
+  return true;
+}
+
+bool ecmh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_epaddr(daddr, ep_addr);
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm);
+
+  if (ep_addr == p_ecm->ep_in) {
+    handle_incoming_frame(idx, p_ecm, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  } else if (ep_addr == p_ecm->ep_out) {
+    if (p_ecm->transferring) {
+      p_ecm->transferring = false;
+      p_ecm->tx_head = (uint8_t) ((p_ecm->tx_head + 1) % CFG_TUH_ECM_TX_BUF_N);
+      p_ecm->tx_count--;
+    }
+
+    // Send frames queued up while this one was being emitted
+    ecmh_start_tx(p_ecm);
+  } else if (ep_addr == p_ecm->ep_notif) {
+    handle_notification(idx, p_ecm, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  }
+
+  return true;
+}
+
+void ecmh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ECM; idx++) {
+    ecmh_interface_t* p_ecm = &_ecmh_itf[idx];
+    if (p_ecm->daddr == daddr) {
+      TU_LOG_DRV("  ECMh close addr = %u index = %u\r\n", daddr, idx);
+      if (tuh_ecm_umount_cb) tuh_ecm_umount_cb(idx);
+      tu_memclr(p_ecm, offsetof(ecmh_interface_t, receive_buf));
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool ecmh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_CDC == desc_itf->bInterfaceClass &&
+            CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == desc_itf->bInterfaceSubClass);
+  TU_LOG_DRV("[%u] ECM opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
+
+  ecmh_interface_t* p_ecm = find_new_itf();
+  TU_ASSERT(p_ecm); // not enough interface, try to increase CFG_TUH_ECM
+  tu_memclr(p_ecm, offsetof(ecmh_interface_t, receive_buf)); // clean up after previous failed attempt, if any
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  //------------- Communication Interface: functional descriptors + notification endpoint -------------//
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && CDC_FUNC_DESC_ETHERNET_NETWORKING == p_desc[2]) {
+      p_ecm->mac_str_index = p_desc[3];
+      if (tu_desc_len(p_desc) >= 10 && tu_unaligned_read16(p_desc + 8) >= CFG_TUH_ECM_FRAME_BUFSIZE) {
+        TU_LOG_DRV("  ECMh wMaxSegmentSize %u exceeds frame buffer\r\n", tu_unaligned_read16(p_desc + 8));
+      }
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer &&
+                TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress));
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+      p_ecm->ep_notif = desc_ep->bEndpointAddress;
+      p_ecm->ep_notif_size = tu_edpt_packet_size(desc_ep);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  //------------- Data Interface: alternate 0 is idle, bulk endpoints are in alternate 1 -------------//
+  bool in_data_alt = false;
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* desc_data = (tusb_desc_interface_t const*) p_desc;
+      TU_ASSERT(TUSB_CLASS_CDC_DATA == desc_data->bInterfaceClass);
+
+      p_ecm->itf_data = desc_data->bInterfaceNumber;
+      in_data_alt = (2 == desc_data->bNumEndpoints);
+      if (in_data_alt) p_ecm->itf_data_alt = desc_data->bAlternateSetting;
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) && in_data_alt) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+      if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        p_ecm->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p_ecm->ep_out = desc_ep->bEndpointAddress;
+        p_ecm->ep_out_size = tu_edpt_packet_size(desc_ep);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_ecm->ep_in && p_ecm->ep_out);
+
+  p_ecm->daddr = daddr;
+  p_ecm->itf_num = desc_itf->bInterfaceNumber;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Set Configure
+//--------------------------------------------------------------------+
+
+enum {
+  CONFIG_GET_MAC_ADDRESS = 0,
+  CONFIG_SET_INTERFACE,
+  CONFIG_SET_PACKET_FILTER,
+  CONFIG_COMPLETE
+};
+
+// control requests of string descriptor and data interface do not carry Communication interface number,
+// therefore instance index is passed in user_data along with state
+#define CONFIG_USER_DATA(_idx, _state)  ((uintptr_t) (((_idx) << 8) | (_state)))
+
+static void process_set_config(tuh_xfer_t* xfer);
+
+// Parse 12 hex digits of iMACAddress string descriptor
+static bool parse_mac_string(uint8_t const* desc, uint32_t len, uint8_t mac[6]) {
+  TU_VERIFY(len >= 2 + 12*2 && desc[0] >= 2 + 12*2 && TUSB_DESC_STRING == desc[1]);
+
+  for (uint8_t i = 0; i < 12; i++) {
+    uint8_t const c = desc[2 + 2*i];
+    uint8_t nibble;
+    if (c >= '0' && c <= '9') {
+      nibble = (uint8_t) (c - '0');
+    } else if (c >= 'A' && c <= 'F') {
+      nibble = (uint8_t) (c - 'A' + 10);
+    } else if (c >= 'a' && c <= 'f') {
+      nibble = (uint8_t) (c - 'a' + 10);
+    } else {
+      return false;
+    }
+    mac[i / 2] = (uint8_t) ((i & 1) ? (mac[i / 2] | nibble) : (nibble << 4));
+  }
+
+  return true;
+}
+
+bool ecmh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_ecm_itf_get_index(daddr, itf_num);
+  TU_ASSERT(idx < CFG_TUH_ECM);
+
+  tusb_control_request_t request;
+  request.bRequest = 0;
+
+  // fake transfer to kick-off process
+  tuh_xfer_t xfer;
+  xfer.daddr = daddr;
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.setup = &request;
+  xfer.user_data = CONFIG_USER_DATA(idx, CONFIG_GET_MAC_ADDRESS);
+
+  process_set_config(&xfer);
+
+  return true;
+}
+
+static void process_set_config(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uintptr_t const state = xfer->user_data & 0xff;
+
+  ecmh_interface_t* p_ecm = get_itf(idx);
+  TU_VERIFY(p_ecm,);
+
+  // iMACAddress and packet filter are optional for us, failing them does not prevent network from working
+  if (!(xfer->setup->bRequest == TUSB_REQ_GET_DESCRIPTOR ||
+        xfer->setup->bRequest == CDC_REQUEST_SET_ETHERNET_PACKET_FILTER)) {
+    TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS,);
+  }
+
+  uint8_t* enum_buf = usbh_get_enum_buf(daddr);
+
+  switch (state) {
+    case CONFIG_GET_MAC_ADDRESS:
+      if (p_ecm->mac_str_index) {
+        TU_ASSERT(tuh_descriptor_get_string(daddr, p_ecm->mac_str_index, 0x0409, enum_buf, 2 + 12*2,
+                                            process_set_config, CONFIG_USER_DATA(idx, CONFIG_SET_INTERFACE)),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_INTERFACE:
+      if (xfer->setup->bRequest == TUSB_REQ_GET_DESCRIPTOR && xfer->result == XFER_RESULT_SUCCESS) {
+        p_ecm->has_mac = parse_mac_string(enum_buf, xfer->actual_len, p_ecm->mac_address);
+      }
+
+      TU_ASSERT(tuh_interface_set(daddr, p_ecm->itf_data, p_ecm->itf_data_alt,
+                                  process_set_config, CONFIG_USER_DATA(idx, CONFIG_SET_PACKET_FILTER)),);
+      break;
+
+    case CONFIG_SET_PACKET_FILTER:
+      // selecting the data alternate setting may reset filter of device, set it afterward
+      TU_ASSERT(ecmh_control_xfer(daddr, p_ecm->itf_num, CDC_REQUEST_SET_ETHERNET_PACKET_FILTER,
+                                  CFG_TUH_ECM_PACKET_FILTER, process_set_config,
+                                  CONFIG_USER_DATA(idx, CONFIG_COMPLETE)),);
+      break;
+
+    case CONFIG_COMPLETE:
+      TU_LOG_DRV("ECMh Set Configure complete\r\n");
+      p_ecm->mounted = true;
+
+      ecmh_notif_arm(p_ecm);
+      ecmh_recv_arm(p_ecm);
+
+      if (tuh_ecm_mount_cb) tuh_ecm_mount_cb(idx);
+
+      // notify usbh that driver enumeration is complete, data interface as well
+      usbh_driver_set_config_complete(daddr, p_ecm->itf_data);
+      break;
+
+    default:
+      break;
+  }
+}
+
+#endif
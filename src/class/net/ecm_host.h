@@ -0,0 +1,109 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_ECM_HOST_H_
+#define _TUSB_ECM_HOST_H_
+
+#include "class/cdc/cdc.h"
+#include "net_host.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Size of each frame buffer, must hold a full Ethernet frame (wMaxSegmentSize, usually 1514) plus one padding byte
+// and be a multiple of bulk packet size so that device can not overflow it
+#ifndef CFG_TUH_ECM_FRAME_BUFSIZE
+#define CFG_TUH_ECM_FRAME_BUFSIZE 1536
+#endif
+
+// Number of receive frame buffers: IN endpoint is re-armed with a free buffer as soon as a frame is received,
+// so back-to-back frames are not dropped while client still holds earlier ones
+#ifndef CFG_TUH_ECM_RX_BUF_N
+#define CFG_TUH_ECM_RX_BUF_N 4
+#endif
+
+// Number of transmit frame buffers: frames queued while one is on the bus
+#ifndef CFG_TUH_ECM_TX_BUF_N
+#define CFG_TUH_ECM_TX_BUF_N 2
+#endif
+
+// Packet filter set when device is mounted, combination of cdc_ethernet_packet_filter_t
+#ifndef CFG_TUH_ECM_PACKET_FILTER
+#define CFG_TUH_ECM_PACKET_FILTER (CDC_ETHERNET_PACKET_TYPE_DIRECTED | CDC_ETHERNET_PACKET_TYPE_BROADCAST | \
+                                   CDC_ETHERNET_PACKET_TYPE_ALL_MULTICAST)
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + Communication interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_ecm_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Check if a interface is mounted
+bool tuh_ecm_mounted(uint8_t idx);
+
+// Get MAC address of device network interface, read from iMACAddress of Ethernet Networking Functional Descriptor.
+// return false if not mounted or device does not report it
+bool tuh_ecm_get_mac_address(uint8_t idx, uint8_t mac[6]);
+
+// Get link state last reported by NETWORK_CONNECTION notification
+bool tuh_ecm_link_is_up(uint8_t idx);
+
+// Set packet filter of device with SET_ETHERNET_PACKET_FILTER request, combination of cdc_ethernet_packet_filter_t
+bool tuh_ecm_set_packet_filter(uint8_t idx, uint16_t filter, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with ECM interface is mounted, network is ready for transfer
+TU_ATTR_WEAK extern void tuh_ecm_mount_cb(uint8_t idx);
+
+// Invoked when a device with ECM interface is unmounted
+TU_ATTR_WEAK extern void tuh_ecm_umount_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool ecmh_init(void);
+bool ecmh_deinit(void);
+bool ecmh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool ecmh_set_config(uint8_t dev_addr, uint8_t itf_num);
+bool ecmh_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void ecmh_close(uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_ECM_HOST_H_ */
@@ -42,6 +42,7 @@ void rndis_class_set_handler(uint8_t *data, int size); /* found in ./misc/networ
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;      // Index number of Management Interface, +1 for Data Interface
   uint8_t itf_data_alt; // Alternate setting of Data Interface. 0 : inactive, 1 : active
 
@@ -61,11 +62,21 @@ typedef struct
 #define CFG_TUD_NET_PACKET_PREFIX_LEN sizeof(rndis_data_packet_t)
 #define CFG_TUD_NET_PACKET_SUFFIX_LEN 0
 
+// ECM frame or RNDIS transfer
+#define NETD_XFER_SIZE   TU_MAX(CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN, \
+                                TUD_NET_RNDIS_XFER_SIZE)
+
+// with multi-packet RNDIS, frames are queued in one buffer while the other is on the bus
+#define NETD_XMIT_BUF_N  ((CFG_TUD_NET_RNDIS_MAX_PACKETS > 1) ? 2 : 1)
+
+TU_VERIFY_STATIC(sizeof(rndis_data_packet_t) == 44, "RNDIS packet message header size is not correct");
+TU_VERIFY_STATIC(NETD_XFER_SIZE <= UINT16_MAX, "CFG_TUD_NET_RNDIS_MAX_PACKETS is too large");
+
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t received[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t received[NETD_XFER_SIZE];
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
-uint8_t transmitted[CFG_TUD_NET_PACKET_PREFIX_LEN + CFG_TUD_NET_MTU + CFG_TUD_NET_PACKET_PREFIX_LEN];
+uint8_t transmitted[NETD_XMIT_BUF_N][NETD_XFER_SIZE];
 
 struct ecm_notify_struct
 {
@@ -109,20 +120,184 @@ CFG_TUD_MEM_SECTION tu_static netd_interface_t _netd_itf;
 
 tu_static bool can_xmit;
 
+tu_static struct
+{
+  uint8_t  fill;  // transmitted[] buffer being filled with frames
+  uint8_t  count; // number of frames in it
+  uint16_t len;
+} _netd_tx;
+
+// passed to tud_network_recv_batch_cb(), valid until renewed
+tu_static tud_network_datagram_t received_datagrams[CFG_TUD_NET_RNDIS_MAX_PACKETS];
+
+// receive buffers provided by application, used before the internal one
+typedef struct
+{
+  uint8_t *buf;
+  uint16_t size;
+} netd_rx_buf_t;
+
+tu_static struct
+{
+  netd_rx_buf_t queue[CFG_TUD_NET_RX_BUF_N];
+  uint8_t head;
+  uint8_t count;
+
+  netd_rx_buf_t xfer;   // buffer of the OUT transfer in progress
+  bool received_in_use; // internal buffer is held by application until renewed
+
+  // internal buffer whose frames are passed to tud_network_recv_cb() one at a time
+  uint8_t const *pending_buf;
+  uint16_t pending_len;
+  uint16_t pending_offset;
+} _netd_rx;
+
+// Queue OUT transfer into the next application buffer, or into the internal one if it is free
+static void netd_recv_arm(void)
+{
+  if ( usbd_edpt_busy(_netd_itf.rhport, _netd_itf.ep_out) ) return;
+
+  if ( _netd_rx.count )
+  {
+    _netd_rx.xfer = _netd_rx.queue[_netd_rx.head];
+    _netd_rx.head = (uint8_t) ((_netd_rx.head + 1) % CFG_TUD_NET_RX_BUF_N);
+    _netd_rx.count--;
+  }
+  else if ( !_netd_rx.received_in_use )
+  {
+    _netd_rx.xfer.buf  = received;
+    _netd_rx.xfer.size = sizeof(received);
+  }
+  else
+  {
+    return;
+  }
+
+  usbd_edpt_xfer(_netd_itf.rhport, _netd_itf.ep_out, _netd_rx.xfer.buf, _netd_rx.xfer.size);
+}
+
+// put the buffer of an aborted transfer back to the front of the queue
+static void netd_recv_unarm(void)
+{
+  if ( _netd_rx.xfer.buf && _netd_rx.xfer.buf != received && _netd_rx.count < CFG_TUD_NET_RX_BUF_N )
+  {
+    _netd_rx.head = (uint8_t) ((_netd_rx.head + CFG_TUD_NET_RX_BUF_N - 1) % CFG_TUD_NET_RX_BUF_N);
+    _netd_rx.queue[_netd_rx.head] = _netd_rx.xfer;
+    _netd_rx.count++;
+  }
+  _netd_rx.xfer.buf = NULL;
+}
+
+// Get the next frame of a received transfer starting at *offset, and move offset past it. Return false if there is none
+static bool netd_next_frame(uint8_t const *buf, uint16_t len, uint16_t *offset, tud_network_datagram_t *frame)
+{
+  if (_netd_itf.ecm_mode)
+  {
+    // single frame per transfer
+    if (*offset >= len) return false;
+    *offset = len;
+    frame->buf = buf;
+    frame->len = len;
+    return true;
+  }
+
+  // one or more RNDIS packet messages, stop at the first malformed one
+  while ((uint32_t) *offset + sizeof(rndis_data_packet_t) <= len)
+  {
+    uint8_t const *msg = buf + *offset;
+    uint32_t const msg_type   = tu_unaligned_read32(msg + offsetof(rndis_data_packet_t, MessageType));
+    uint32_t const msg_len    = tu_unaligned_read32(msg + offsetof(rndis_data_packet_t, MessageLength));
+    uint32_t const data_start = tu_unaligned_read32(msg + offsetof(rndis_data_packet_t, DataOffset)) +
+                                offsetof(rndis_data_packet_t, DataOffset);
+    uint32_t const data_len   = tu_unaligned_read32(msg + offsetof(rndis_data_packet_t, DataLength));
+
+    if (msg_type != REMOTE_NDIS_PACKET_MSG || msg_len < sizeof(rndis_data_packet_t) || msg_len > (uint32_t) (len - *offset))
+    {
+      return false;
+    }
+    *offset = (uint16_t) (*offset + msg_len);
+
+    if (data_start <= msg_len && data_len <= msg_len - data_start)
+    {
+      frame->buf = msg + data_start;
+      frame->len = (uint16_t) data_len;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Pass the next frame of internal buffer to tud_network_recv_cb(), release the buffer once all are consumed
+static void netd_recv_next(void)
+{
+  tud_network_datagram_t frame;
+  while (netd_next_frame(_netd_rx.pending_buf, _netd_rx.pending_len, &_netd_rx.pending_offset, &frame))
+  {
+    // client renews when done with it
+    if (tud_network_recv_cb(frame.buf, frame.len)) return;
+  }
+
+  _netd_rx.pending_buf = NULL;
+  _netd_rx.received_in_use = false;
+  netd_recv_arm();
+}
+
 void tud_network_recv_renew(void)
 {
-  usbd_edpt_xfer(0, _netd_itf.ep_out, received, sizeof(received));
+  if (_netd_rx.pending_buf)
+  {
+    netd_recv_next();
+    return;
+  }
+
+  _netd_rx.received_in_use = false;
+  netd_recv_arm();
+}
+
+bool tud_network_recv_provide(uint8_t *buf, uint16_t size)
+{
+  TU_VERIFY(buf && size >= CFG_TUD_NET_MTU && _netd_rx.count < CFG_TUD_NET_RX_BUF_N);
+
+  uint8_t const idx = (uint8_t) ((_netd_rx.head + _netd_rx.count) % CFG_TUD_NET_RX_BUF_N);
+  _netd_rx.queue[idx].buf  = buf;
+  _netd_rx.queue[idx].size = size;
+  _netd_rx.count++;
+
+  // start receiving if endpoint is idle
+  if ( _netd_itf.ep_out ) netd_recv_arm();
+
+  return true;
 }
 
 static void do_in_xfer(uint8_t *buf, uint16_t len)
 {
   can_xmit = false;
-  usbd_edpt_xfer(0, _netd_itf.ep_in, buf, len);
+  usbd_edpt_xfer(_netd_itf.rhport, _netd_itf.ep_in, buf, len);
+}
+
+// Send frames queued in the buffer being filled, or mark endpoint idle if there is none
+static void netd_xmit_flush(void)
+{
+  if ( !_netd_tx.count )
+  {
+    can_xmit = true;
+    return;
+  }
+
+  uint8_t *buf = transmitted[_netd_tx.fill];
+  uint16_t const len = _netd_tx.len;
+
+  _netd_tx.fill  = (uint8_t) ((_netd_tx.fill + 1) % NETD_XMIT_BUF_N);
+  _netd_tx.count = 0;
+  _netd_tx.len   = 0;
+
+  do_in_xfer(buf, len);
 }
 
 void netd_report(uint8_t *buf, uint16_t len)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = _netd_itf.rhport;
 
   // skip if previous report not yet acknowledged by host
   if ( usbd_edpt_busy(rhport, _netd_itf.ep_notif) ) return;
@@ -134,6 +309,8 @@ void netd_report(uint8_t *buf, uint16_t len)
 //--------------------------------------------------------------------+
 void netd_init(void) {
   tu_memclr(&_netd_itf, sizeof(_netd_itf));
+  tu_memclr(&_netd_rx, sizeof(_netd_rx));
+  tu_memclr(&_netd_tx, sizeof(_netd_tx));
 }
 
 bool netd_deinit(void) {
@@ -144,7 +321,13 @@ void netd_reset(uint8_t rhport)
 {
   (void) rhport;
 
-  netd_init();
+  // application buffers are kept for next connection
+  netd_recv_unarm();
+  _netd_rx.received_in_use = false;
+  _netd_rx.pending_buf = NULL;
+
+  tu_memclr(&_netd_itf, sizeof(_netd_itf));
+  tu_memclr(&_netd_tx, sizeof(_netd_tx));
 }
 
 uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len)
@@ -166,6 +349,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   _netd_itf.ecm_mode = is_ecm;
 
   //------------- Management Interface -------------//
+  _netd_itf.rhport  = rhport;
   _netd_itf.itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -356,29 +540,51 @@ bool netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t
 
 static void handle_incoming_packet(uint32_t len)
 {
-  uint8_t *pnt = received;
-  uint32_t size = 0;
+  uint8_t *buf = _netd_rx.xfer.buf;
+  uint16_t offset = 0;
 
-  if (_netd_itf.ecm_mode)
+  _netd_rx.xfer.buf = NULL;
+  if ( buf == received )
   {
-    size = len;
+    _netd_rx.received_in_use = true;
+    if ( !tud_network_recv_batch_cb )
+    {
+      _netd_rx.pending_buf    = buf;
+      _netd_rx.pending_len    = (uint16_t) len;
+      _netd_rx.pending_offset = 0;
+    }
   }
-  else
+
+  // continue receiving into next free buffer while the frames go up the stack
+  netd_recv_arm();
+
+  if (tud_network_recv_batch_cb)
   {
-    rndis_data_packet_t *r = (rndis_data_packet_t *) ((void*) pnt);
-    if (len >= sizeof(rndis_data_packet_t))
-      if ( (r->MessageType == REMOTE_NDIS_PACKET_MSG) && (r->MessageLength <= len))
-        if ( (r->DataOffset + offsetof(rndis_data_packet_t, DataOffset) + r->DataLength) <= len)
-        {
-          pnt = &received[r->DataOffset + offsetof(rndis_data_packet_t, DataOffset)];
-          size = r->DataLength;
-        }
-  }
+    uint8_t count = 0;
+    while ( count < CFG_TUD_NET_RNDIS_MAX_PACKETS &&
+            netd_next_frame(buf, (uint16_t) len, &offset, &received_datagrams[count]) )
+    {
+      count++;
+    }
 
-  if (!tud_network_recv_cb(pnt, (uint16_t) size))
+    if ( !(count && tud_network_recv_batch_cb(received_datagrams, count)) && buf == received )
+    {
+      /* if a buffer was never handled by user code, we must renew on the user's behalf */
+      tud_network_recv_renew();
+    }
+  }
+  else if ( buf == received )
   {
-    /* if a buffer was never handled by user code, we must renew on the user's behalf */
-    tud_network_recv_renew();
+    netd_recv_next();
+  }
+  else
+  {
+    // application buffer is owned by client again once its frames are passed
+    tud_network_datagram_t frame;
+    while ( netd_next_frame(buf, (uint16_t) len, &offset, &frame) )
+    {
+      (void) tud_network_recv_cb(frame.buf, frame.len);
+    }
   }
 }
 
@@ -404,8 +610,8 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
     }
     else
     {
-      /* we're finally finished */
-      can_xmit = true;
+      /* we're finally finished, send frames queued meanwhile if any */
+      netd_xmit_flush();
     }
   }
 
@@ -419,35 +625,52 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 
 bool tud_network_can_xmit(uint16_t size)
 {
-  (void)size;
+  if (can_xmit) return true;
 
-  return can_xmit;
+#if CFG_TUD_NET_RNDIS_MAX_PACKETS > 1
+  // queue frame behind the transfer on the bus
+  return !_netd_itf.ecm_mode && _netd_tx.count < CFG_TUD_NET_RNDIS_MAX_PACKETS &&
+         (uint32_t) _netd_tx.len + CFG_TUD_NET_PACKET_PREFIX_LEN + size <= NETD_XFER_SIZE;
+#else
+  (void)size;
+  return false;
+#endif
 }
 
 void tud_network_xmit(void *ref, uint16_t arg)
 {
-  uint8_t *data;
+  uint8_t *buf;
   uint16_t len;
 
-  if (!can_xmit)
+  if (!tud_network_can_xmit(0))
     return;
 
+  buf = transmitted[_netd_tx.fill] + _netd_tx.len;
   len = (_netd_itf.ecm_mode) ? 0 : CFG_TUD_NET_PACKET_PREFIX_LEN;
-  data = transmitted + len;
 
-  len += tud_network_xmit_cb(data, ref, arg);
+  len += tud_network_xmit_cb(buf + len, ref, arg);
 
   if (!_netd_itf.ecm_mode)
   {
-    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) transmitted);
+    // keep next message aligned when several are sent in one transfer
+    uint16_t const msg_len = (CFG_TUD_NET_RNDIS_MAX_PACKETS > 1) ? (uint16_t) ((len + 3u) & ~3u) : len;
+
+    rndis_data_packet_t *hdr = (rndis_data_packet_t *) ((void*) buf);
     memset(hdr, 0, sizeof(rndis_data_packet_t));
     hdr->MessageType = REMOTE_NDIS_PACKET_MSG;
-    hdr->MessageLength = len;
+    hdr->MessageLength = msg_len;
     hdr->DataOffset = sizeof(rndis_data_packet_t) - offsetof(rndis_data_packet_t, DataOffset);
     hdr->DataLength = len - sizeof(rndis_data_packet_t);
+
+    memset(buf + len, 0, msg_len - len);
+    len = msg_len;
   }
 
-  do_in_xfer(transmitted, len);
+  _netd_tx.len = (uint16_t) (_netd_tx.len + len);
+  _netd_tx.count++;
+
+  // send now if endpoint is idle, otherwise once the transfer on the bus completes
+  if (can_xmit) netd_xmit_flush();
 }
 
 #endif
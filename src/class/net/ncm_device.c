@@ -45,54 +45,21 @@
 // MACRO CONSTANT TYPEDEF
 //--------------------------------------------------------------------+
 
-#define NTH16_SIGNATURE      0x484D434E
-#define NDP16_SIGNATURE_NCM0 0x304D434E
-#define NDP16_SIGNATURE_NCM1 0x314D434E
-
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wLength;
-  uint16_t bmNtbFormatsSupported;
-  uint32_t dwNtbInMaxSize;
-  uint16_t wNdbInDivisor;
-  uint16_t wNdbInPayloadRemainder;
-  uint16_t wNdbInAlignment;
-  uint16_t wReserved;
-  uint32_t dwNtbOutMaxSize;
-  uint16_t wNdbOutDivisor;
-  uint16_t wNdbOutPayloadRemainder;
-  uint16_t wNdbOutAlignment;
-  uint16_t wNtbOutMaxDatagrams;
-} ntb_parameters_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wHeaderLength;
-  uint16_t wSequence;
-  uint16_t wBlockLength;
-  uint16_t wNdpIndex;
-} nth16_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint16_t wDatagramIndex;
-  uint16_t wDatagramLength;
-} ndp16_datagram_t;
-
-typedef struct TU_ATTR_PACKED
-{
-  uint32_t dwSignature;
-  uint16_t wLength;
-  uint16_t wNextNdpIndex;
-  ndp16_datagram_t datagram[];
-} ndp16_t;
+#if CFG_TUD_NCM_NTB32
+  #define NCM_NTB32_ACTIVE()  (ncm_interface.ntb_format == NCM_NTB_FORMAT_32)
+#else
+  #define NCM_NTB32_ACTIVE()  false
+#endif
 
 typedef union TU_ATTR_PACKED {
   struct {
     nth16_t nth;
     ndp16_t ndp;
   };
+  struct {
+    nth32_t nth32;
+    ndp32_t ndp32;
+  };
   uint8_t data[CFG_TUD_NCM_IN_NTB_MAX_SIZE];
 } transmit_ntb_t;
 
@@ -104,6 +71,7 @@ struct ecm_notify_struct
 
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;      // Index number of Management Interface, +1 for Data Interface
   uint8_t itf_data_alt; // Alternate setting of Data Interface. 0 : inactive, 1 : active
 
@@ -111,8 +79,15 @@ typedef struct
   uint8_t ep_in;
   uint8_t ep_out;
 
-  const ndp16_t *ndp;
-  uint8_t num_datagrams, current_datagram_index;
+  uint16_t ntb_format;    // NCM_NTB_FORMAT_16 or NCM_NTB_FORMAT_32, selected by SET_NTB_FORMAT
+
+  const void *ndp;        // NDP16 or NDP32 of receive_ntb[rx_ntb_head] being delivered, NULL if none
+  uint16_t num_datagrams, current_datagram_index;
+
+  uint8_t rx_ntb_head;    // Index in receive_ntb[] of the oldest received NTB
+  uint8_t rx_ntb_count;   // Number of received NTBs not yet fully consumed by client
+
+  tud_network_datagram_t rx_batch[CFG_TUD_NCM_MAX_DATAGRAMS_PER_BATCH]; // datagrams passed to tud_network_recv_batch_cb()
 
   enum {
     REPORT_SPEED,
@@ -121,14 +96,21 @@ typedef struct
   } report_state;
   bool report_pending;
 
+  uint8_t  tx_ntb_head;           // Index in transmit_ntb[] of the oldest closed NTB, sent first
+  uint8_t  tx_ntb_count;          // Number of closed NTBs waiting for or being transferred
   uint8_t  current_ntb;           // Index in transmit_ntb[] that is currently being filled with datagrams
   uint8_t  datagram_count;        // Number of datagrams in transmit_ntb[current_ntb]
-  uint16_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
-  uint16_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
+  uint32_t next_datagram_offset;  // Offset in transmit_ntb[current_ntb].data to place the next datagram
+  uint32_t ntb_in_size;           // Maximum size of transmitted (IN to host) NTBs; initially CFG_TUD_NCM_IN_NTB_MAX_SIZE
   uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per NTB; initially CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 
   uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
 
+  #if CFG_TUD_NCM_IN_AGGREGATION_SOF
+  uint16_t tx_window;             // Current aggregation window in SOF frames, adapted to traffic
+  volatile uint16_t tx_flush_sof; // SOF count down to send current NTB, 0 if not armed
+  #endif
+
   bool transferring;
 
 } ncm_interface_t;
@@ -139,7 +121,7 @@ typedef struct
 
 CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_parameters = {
     .wLength                 = sizeof(ntb_parameters_t),
-    .bmNtbFormatsSupported   = 0x01,
+    .bmNtbFormatsSupported   = CFG_TUD_NCM_NTB32 ? 0x03 : 0x01,
     .dwNtbInMaxSize          = CFG_TUD_NCM_IN_NTB_MAX_SIZE,
     .wNdbInDivisor           = 4,
     .wNdbInPayloadRemainder  = 0,
@@ -152,9 +134,15 @@ CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static const ntb_parameters_t ntb_para
     .wNtbOutMaxDatagrams     = 0
 };
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static transmit_ntb_t transmit_ntb[2];
+TU_VERIFY_STATIC(CFG_TUD_NCM_IN_NTB_N >= 2, "At least 2 IN NTBs are required");
+TU_VERIFY_STATIC(CFG_TUD_NCM_OUT_NTB_N >= 1, "At least 1 OUT NTB is required");
+TU_VERIFY_STATIC((CFG_TUD_NCM_NTB32 && CFG_TUD_LARGE_XFER) ||
+                 (CFG_TUD_NCM_IN_NTB_MAX_SIZE <= 0xFFFF && CFG_TUD_NCM_OUT_NTB_MAX_SIZE <= 0xFFFF),
+                 "NTB larger than 64 KiB requires CFG_TUD_NCM_NTB32 and CFG_TUD_LARGE_XFER");
+
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static transmit_ntb_t transmit_ntb[CFG_TUD_NCM_IN_NTB_N];
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static uint8_t receive_ntb[CFG_TUD_NCM_OUT_NTB_N][CFG_TUD_NCM_OUT_NTB_MAX_SIZE];
 
 tu_static ncm_interface_t ncm_interface;
 
@@ -162,45 +150,117 @@ tu_static ncm_interface_t ncm_interface;
  * Set up the NTB state in ncm_interface to be ready to add datagrams.
  */
 static void ncm_prepare_for_tx(void) {
+  uint32_t const hdr_len = NCM_NTB32_ACTIVE()
+      ? sizeof(nth32_t) + sizeof(ndp32_t) + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp32_datagram_t))
+      : sizeof(nth16_t) + sizeof(ndp16_t) + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+
   ncm_interface.datagram_count = 0;
-  // datagrams start after all the headers
-  ncm_interface.next_datagram_offset = sizeof(nth16_t) + sizeof(ndp16_t)
-      + ((CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB + 1) * sizeof(ndp16_datagram_t));
+  // datagrams start after all the headers, aligned correctly
+  ncm_interface.next_datagram_offset = TU_DIV_CEIL(hdr_len, CFG_TUD_NCM_ALIGNMENT) * CFG_TUD_NCM_ALIGNMENT;
 }
 
 /*
- * If not already transmitting, start sending the current NTB to the host and swap buffers
- * to start filling the other one with datagrams.
+ * Select NTB16 or NTB32 for both directions, only changed while Data Interface is inactive.
+ */
+static void ncm_set_ntb_format(uint16_t format) {
+  ncm_interface.ntb_format = format;
+  ncm_interface.ntb_in_size = NCM_NTB32_ACTIVE() ? CFG_TUD_NCM_IN_NTB_MAX_SIZE : tu_min32(CFG_TUD_NCM_IN_NTB_MAX_SIZE, 0xFFFF);
+  ncm_prepare_for_tx();
+}
+
+/*
+ * Fill in the headers of the current NTB and queue it for transmission,
+ * then start filling the next NTB in the ring with datagrams.
+ */
+static void ncm_close_ntb(void) {
+  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
+  uint32_t ntb_length = ncm_interface.next_datagram_offset;
+
+  if (NCM_NTB32_ACTIVE()) {
+    // Fill in NTB header
+    ntb->nth32.dwSignature = NTH32_SIGNATURE;
+    ntb->nth32.wHeaderLength = sizeof(nth32_t);
+    ntb->nth32.wSequence = ncm_interface.nth_sequence++;
+    ntb->nth32.dwBlockLength = ntb_length;
+    ntb->nth32.dwNdpIndex = sizeof(nth32_t);
+
+    // Fill in NDP32 header and terminator
+    ntb->ndp32.dwSignature = NDP32_SIGNATURE_NCM0;
+    ntb->ndp32.wLength = sizeof(ndp32_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp32_datagram_t);
+    ntb->ndp32.wReserved6 = 0;
+    ntb->ndp32.dwNextNdpIndex = 0;
+    ntb->ndp32.dwReserved12 = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = 0;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = 0;
+  } else {
+    // Fill in NTB header
+    ntb->nth.dwSignature = NTH16_SIGNATURE;
+    ntb->nth.wHeaderLength = sizeof(nth16_t);
+    ntb->nth.wSequence = ncm_interface.nth_sequence++;
+    ntb->nth.wBlockLength = (uint16_t) ntb_length;
+    ntb->nth.wNdpIndex = sizeof(nth16_t);
+
+    // Fill in NDP16 header and terminator
+    ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
+    ntb->ndp.wLength = sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t);
+    ntb->ndp.wNextNdpIndex = 0;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
+  }
+
+  #if CFG_TUD_NCM_IN_AGGREGATION_SOF
+  // grow window while NTBs carry several datagrams, shrink it when traffic is sparse
+  if (ncm_interface.datagram_count > 1) {
+    ncm_interface.tx_window = (uint16_t) tu_min32(ncm_interface.tx_window ? 2u * ncm_interface.tx_window : 1u,
+                                                  CFG_TUD_NCM_IN_AGGREGATION_SOF);
+  } else {
+    ncm_interface.tx_window >>= 1;
+  }
+  ncm_interface.tx_flush_sof = 0;
+  #endif
+
+  // Move on to the next NTB and clear it out
+  ncm_interface.tx_ntb_count++;
+  ncm_interface.current_ntb = (ncm_interface.current_ntb + 1) % CFG_TUD_NCM_IN_NTB_N;
+  ncm_prepare_for_tx();
+}
+
+static uint32_t ncm_tx_ntb_length(transmit_ntb_t const *ntb) {
+  return NCM_NTB32_ACTIVE() ? ntb->nth32.dwBlockLength : ntb->nth.wBlockLength;
+}
+
+/*
+ * If not already transmitting, start sending the oldest closed NTB to the host.
+ * If there is none, close the current NTB if it has any datagram and send it.
  */
 static void ncm_start_tx(void) {
   if (ncm_interface.transferring) {
     return;
   }
 
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t ntb_length = ncm_interface.next_datagram_offset;
-
-  // Fill in NTB header
-  ntb->nth.dwSignature = NTH16_SIGNATURE;
-  ntb->nth.wHeaderLength = sizeof(nth16_t);
-  ntb->nth.wSequence = ncm_interface.nth_sequence++;
-  ntb->nth.wBlockLength = ntb_length;
-  ntb->nth.wNdpIndex = sizeof(nth16_t);
-
-  // Fill in NDP16 header and terminator
-  ntb->ndp.dwSignature = NDP16_SIGNATURE_NCM0;
-  ntb->ndp.wLength = sizeof(ndp16_t) + (ncm_interface.datagram_count + 1) * sizeof(ndp16_datagram_t);
-  ntb->ndp.wNextNdpIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = 0;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = 0;
+  if (!ncm_interface.tx_ntb_count) {
+    if (!ncm_interface.datagram_count) {
+      return;
+    }
+
+    #if CFG_TUD_NCM_IN_AGGREGATION_SOF
+    // hold partially filled NTB for more datagrams until the window expires
+    if (ncm_interface.tx_window && ncm_interface.datagram_count < ncm_interface.max_datagrams_per_ntb) {
+      if (!ncm_interface.tx_flush_sof) {
+        ncm_interface.tx_flush_sof = ncm_interface.tx_window;
+      }
+      return;
+    }
+    #endif
+
+    ncm_close_ntb();
+  }
+
+  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.tx_ntb_head];
 
   // Kick off an endpoint transfer
-  usbd_edpt_xfer(0, ncm_interface.ep_in, ntb->data, ntb_length);
+  usbd_edpt_xfer(ncm_interface.rhport, ncm_interface.ep_in, ntb->data, ncm_tx_ntb_length(ntb));
   ncm_interface.transferring = true;
-
-  // Swap to the other NTB and clear it out
-  ncm_interface.current_ntb = 1 - ncm_interface.current_ntb;
-  ncm_prepare_for_tx();
 }
 
 tu_static struct ecm_notify_struct ncm_notify_connected =
@@ -232,20 +292,129 @@ tu_static struct ecm_notify_struct ncm_notify_speed_change =
     .uplink = 10000000,
 };
 
-void tud_network_recv_renew(void)
+/*
+ * Receive the next NTB if there is a free buffer and the endpoint is idle.
+ */
+static void ncm_recv_arm(void)
 {
-  if (!ncm_interface.num_datagrams)
-  {
-    usbd_edpt_xfer(0, ncm_interface.ep_out, receive_ntb, sizeof(receive_ntb));
+  if (ncm_interface.rx_ntb_count >= CFG_TUD_NCM_OUT_NTB_N || usbd_edpt_busy(ncm_interface.rhport, ncm_interface.ep_out)) {
     return;
   }
 
-  const ndp16_t *ndp = ncm_interface.ndp;
-  const int i = ncm_interface.current_datagram_index;
+  uint8_t const idx = (ncm_interface.rx_ntb_head + ncm_interface.rx_ntb_count) % CFG_TUD_NCM_OUT_NTB_N;
+  usbd_edpt_xfer(ncm_interface.rhport, ncm_interface.ep_out, receive_ntb[idx], CFG_TUD_NCM_OUT_NTB_MAX_SIZE);
+}
+
+/*
+ * Get index and length of i-th datagram from NDP of the NTB being delivered
+ */
+static void ncm_get_datagram(uint16_t i, uint32_t *index, uint32_t *length)
+{
+  if (NCM_NTB32_ACTIVE()) {
+    const ndp32_t *ndp = (const ndp32_t *) ncm_interface.ndp;
+    *index = ndp->datagram[i].dwDatagramIndex;
+    *length = ndp->datagram[i].dwDatagramLength;
+  } else {
+    const ndp16_t *ndp = (const ndp16_t *) ncm_interface.ndp;
+    *index = ndp->datagram[i].wDatagramIndex;
+    *length = ndp->datagram[i].wDatagramLength;
+  }
+}
+
+/*
+ * Release the oldest NTB once all of its datagrams are consumed and parse the next received one, if any.
+ */
+static void ncm_recv_next(void)
+{
+  while (!ncm_interface.num_datagrams && ncm_interface.rx_ntb_count)
+  {
+    uint8_t const *ntb = receive_ntb[ncm_interface.rx_ntb_head];
+
+    if (ncm_interface.ndp) {
+      // all datagrams of oldest NTB are consumed, release it
+      ncm_interface.ndp = NULL;
+      ncm_interface.rx_ntb_head = (ncm_interface.rx_ntb_head + 1) % CFG_TUD_NCM_OUT_NTB_N;
+      ncm_interface.rx_ntb_count--;
+      continue;
+    }
+
+    // headers are already validated when received, number of entries excludes the terminator
+    int num_datagrams;
+    if (NCM_NTB32_ACTIVE()) {
+      const nth32_t *hdr = (const nth32_t *) ntb;
+      const ndp32_t *ndp = (const ndp32_t *) (ntb + hdr->dwNdpIndex);
+      num_datagrams = (ndp->wLength - 24) / 8;
+      ncm_interface.ndp = ndp;
+    } else {
+      const nth16_t *hdr = (const nth16_t *) ntb;
+      const ndp16_t *ndp = (const ndp16_t *) (ntb + hdr->wNdpIndex);
+      num_datagrams = (ndp->wLength - 12) / 4;
+      ncm_interface.ndp = ndp;
+    }
+
+    ncm_interface.current_datagram_index = 0;
+    ncm_interface.num_datagrams = 0;
+
+    for (int i = 0; i < num_datagrams; i++)
+    {
+      uint32_t index, length;
+      ncm_get_datagram((uint16_t) i, &index, &length);
+      if (!index || !length) break;
+
+      ncm_interface.num_datagrams++;
+    }
+  }
+}
+
+/*
+ * Take the next datagram of the NTB being delivered
+ */
+static void ncm_take_datagram(tud_network_datagram_t *datagram)
+{
+  uint32_t index, length;
+  ncm_get_datagram(ncm_interface.current_datagram_index, &index, &length);
   ncm_interface.current_datagram_index++;
   ncm_interface.num_datagrams--;
 
-  tud_network_recv_cb(receive_ntb + ndp->datagram[i].wDatagramIndex, ndp->datagram[i].wDatagramLength);
+  datagram->buf = receive_ntb[ncm_interface.rx_ntb_head] + index;
+  datagram->len = (uint16_t) length;
+}
+
+void tud_network_recv_renew(void)
+{
+  while (1)
+  {
+    ncm_recv_next();
+    ncm_recv_arm(); // buffer may have been released
+
+    if (!ncm_interface.num_datagrams)
+    {
+      return;
+    }
+
+    if (!tud_network_recv_batch_cb)
+    {
+      tud_network_datagram_t datagram;
+      ncm_take_datagram(&datagram);
+
+      tud_network_recv_cb(datagram.buf, datagram.len);
+      return;
+    }
+
+    uint8_t count = 0;
+    while (ncm_interface.num_datagrams && count < CFG_TUD_NCM_MAX_DATAGRAMS_PER_BATCH)
+    {
+      ncm_take_datagram(&ncm_interface.rx_batch[count]);
+      count++;
+    }
+
+    if (tud_network_recv_batch_cb(ncm_interface.rx_batch, count))
+    {
+      return;
+    }
+
+    // batch not accepted: release it and continue with next one
+  }
 }
 
 //--------------------------------------------------------------------+
@@ -255,9 +424,11 @@ void tud_network_recv_renew(void)
 void netd_init(void)
 {
   tu_memclr(&ncm_interface, sizeof(ncm_interface));
-  ncm_interface.ntb_in_size = CFG_TUD_NCM_IN_NTB_MAX_SIZE;
   ncm_interface.max_datagrams_per_ntb = CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB;
-  ncm_prepare_for_tx();
+  #if CFG_TUD_NCM_IN_AGGREGATION_SOF
+  ncm_interface.tx_window = CFG_TUD_NCM_IN_AGGREGATION_SOF;
+  #endif
+  ncm_set_ntb_format(NCM_NTB_FORMAT_16);
 }
 
 bool netd_deinit(void) {
@@ -277,6 +448,7 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
   TU_ASSERT(0 == ncm_interface.ep_notif, 0);
 
   //------------- Management Interface -------------//
+  ncm_interface.rhport  = rhport;
   ncm_interface.itf_num = itf_desc->bInterfaceNumber;
 
   uint16_t drv_len = sizeof(tusb_desc_interface_t);
@@ -322,12 +494,17 @@ uint16_t netd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint1
 
   drv_len += 2*sizeof(tusb_desc_endpoint_t);
 
+  #if CFG_TUD_NCM_IN_AGGREGATION_SOF
+  // SOF drives IN aggregation window
+  usbd_sof_subscribe(rhport, netd_sof, 1);
+  #endif
+
   return drv_len;
 }
 
 static void ncm_report(void)
 {
-  uint8_t const rhport = 0;
+  uint8_t const rhport = ncm_interface.rhport;
   if (ncm_interface.report_state == REPORT_SPEED) {
     ncm_notify_speed_change.header.wIndex = ncm_interface.itf_num;
     usbd_edpt_xfer(rhport, ncm_interface.ep_notif, (uint8_t *) &ncm_notify_speed_change, sizeof(ncm_notify_speed_change));
@@ -405,6 +582,19 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
       {
         tud_control_xfer(rhport, request, (void*)(uintptr_t) &ntb_parameters, sizeof(ntb_parameters));
       }
+      else if (NCM_GET_NTB_FORMAT == request->bRequest)
+      {
+        tud_control_xfer(rhport, request, &ncm_interface.ntb_format, sizeof(ncm_interface.ntb_format));
+      }
+      else if (NCM_SET_NTB_FORMAT == request->bRequest)
+      {
+        // format can only be changed while Data Interface is inactive
+        uint16_t const max_format = CFG_TUD_NCM_NTB32 ? NCM_NTB_FORMAT_32 : NCM_NTB_FORMAT_16;
+        TU_VERIFY(ncm_interface.itf_data_alt == 0 && request->wValue <= max_format);
+
+        ncm_set_ntb_format(request->wValue);
+        tud_control_status(rhport, request);
+      }
 
       break;
 
@@ -415,34 +605,56 @@ bool netd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t
   return true;
 }
 
-static void handle_incoming_datagram(uint32_t len)
+// return true if received NTB has valid headers
+static bool ncm_validate_ntb(const uint8_t *ntb, uint32_t len)
 {
-  uint32_t size = len;
+  TU_VERIFY(len > 0);
 
-  if (len == 0) {
-    return;
+#if CFG_TUD_NCM_NTB32
+  if (NCM_NTB32_ACTIVE()) {
+    TU_ASSERT(len >= sizeof(nth32_t));
+
+    const nth32_t *hdr = (const nth32_t *)ntb;
+    TU_ASSERT(hdr->dwSignature == NTH32_SIGNATURE);
+    TU_ASSERT(hdr->dwNdpIndex >= sizeof(nth32_t) && hdr->dwNdpIndex <= len - sizeof(ndp32_t));
+
+    const ndp32_t *ndp = (const ndp32_t *)(ntb + hdr->dwNdpIndex);
+    TU_ASSERT(ndp->dwSignature == NDP32_SIGNATURE_NCM0 || ndp->dwSignature == NDP32_SIGNATURE_NCM1);
+    TU_ASSERT(ndp->wLength <= len - hdr->dwNdpIndex);
+
+    return true;
   }
+#endif
 
-  TU_ASSERT(size >= sizeof(nth16_t), );
+  TU_ASSERT(len >= sizeof(nth16_t));
 
-  const nth16_t *hdr = (const nth16_t *)receive_ntb;
-  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE, );
-  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len, );
+  const nth16_t *hdr = (const nth16_t *)ntb;
+  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE);
+  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= len);
 
-  const ndp16_t *ndp = (const ndp16_t *)(receive_ntb + hdr->wNdpIndex);
-  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1, );
-  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len, );
+  const ndp16_t *ndp = (const ndp16_t *)(ntb + hdr->wNdpIndex);
+  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1);
+  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= len);
 
-  int num_datagrams = (ndp->wLength - 12) / 4;
-  ncm_interface.current_datagram_index = 0;
-  ncm_interface.num_datagrams = 0;
-  ncm_interface.ndp = ndp;
-  for (int i = 0; i < num_datagrams && ndp->datagram[i].wDatagramIndex && ndp->datagram[i].wDatagramLength; i++)
-  {
-    ncm_interface.num_datagrams++;
+  return true;
+}
+
+static void handle_incoming_datagram(uint32_t len)
+{
+  uint8_t const idx = (ncm_interface.rx_ntb_head + ncm_interface.rx_ntb_count) % CFG_TUD_NCM_OUT_NTB_N;
+
+  if (ncm_validate_ntb(receive_ntb[idx], len)) {
+    ncm_interface.rx_ntb_count++;
+
+    // deliver now if client is not holding a datagram, otherwise on next tud_network_recv_renew()
+    if (!ncm_interface.ndp) {
+      tud_network_recv_renew();
+      return;
+    }
   }
 
-  tud_network_recv_renew();
+  // invalid NTB is dropped and its buffer is reused
+  ncm_recv_arm();
 }
 
 bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
@@ -461,10 +673,12 @@ bool netd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   {
     if (ncm_interface.transferring) {
       ncm_interface.transferring = false;
+      ncm_interface.tx_ntb_head = (ncm_interface.tx_ntb_head + 1) % CFG_TUD_NCM_IN_NTB_N;
+      ncm_interface.tx_ntb_count--;
     }
 
-    // If there are datagrams queued up that we tried to send while this NTB was being emitted, send them now
-    if (ncm_interface.datagram_count && ncm_interface.itf_data_alt == 1) {
+    // Send NTBs queued up while this NTB was being emitted, or datagrams added to the current NTB meanwhile
+    if (ncm_interface.itf_data_alt == 1) {
       ncm_start_tx();
     }
   }
@@ -483,29 +697,45 @@ bool tud_network_can_xmit(uint16_t size)
 {
   TU_VERIFY(ncm_interface.itf_data_alt == 1);
 
-  if (ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb) {
-    TU_LOG_DRV("NTB full [by count]\r\n");
-    return false;
-  }
+  bool const full_count = ncm_interface.datagram_count >= ncm_interface.max_datagrams_per_ntb;
+  bool const full_size = ncm_interface.next_datagram_offset + size > ncm_interface.ntb_in_size;
+
+  if (full_count || full_size) {
+    // queue current NTB behind the one on the bus and continue with the next one, keeping one
+    // NTB always available for filling
+    if (!ncm_interface.datagram_count || ncm_interface.tx_ntb_count + 2 > CFG_TUD_NCM_IN_NTB_N) {
+      TU_LOG_DRV("NTB full [by %s]\r\n", full_count ? "count" : "size");
+      return false;
+    }
+    ncm_close_ntb();
 
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
-  if (next_datagram_offset + size > ncm_interface.ntb_in_size) {
-    TU_LOG_DRV("ntb full [by size]\r\n");
-    return false;
+    // datagram does not fit in an empty NTB
+    TU_VERIFY(ncm_interface.next_datagram_offset + size <= ncm_interface.ntb_in_size);
   }
 
   return true;
 }
 
-void tud_network_xmit(void *ref, uint16_t arg)
+uint8_t *tud_network_xmit_reserve(uint16_t size)
 {
-  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
-  size_t next_datagram_offset = ncm_interface.next_datagram_offset;
+  TU_VERIFY(tud_network_can_xmit(size), NULL);
 
-  uint16_t size = tud_network_xmit_cb(ntb->data + next_datagram_offset, ref, arg);
+  // datagram offset is always aligned to CFG_TUD_NCM_ALIGNMENT
+  return transmit_ntb[ncm_interface.current_ntb].data + ncm_interface.next_datagram_offset;
+}
 
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = ncm_interface.next_datagram_offset;
-  ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+void tud_network_xmit_commit(uint16_t size)
+{
+  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
+  uint32_t next_datagram_offset = ncm_interface.next_datagram_offset;
+
+  if (NCM_NTB32_ACTIVE()) {
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramIndex = next_datagram_offset;
+    ntb->ndp32.datagram[ncm_interface.datagram_count].dwDatagramLength = size;
+  } else {
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramIndex = (uint16_t) next_datagram_offset;
+    ntb->ndp.datagram[ncm_interface.datagram_count].wDatagramLength = size;
+  }
 
   ncm_interface.datagram_count++;
   next_datagram_offset += size;
@@ -519,4 +749,43 @@ void tud_network_xmit(void *ref, uint16_t arg)
   ncm_start_tx();
 }
 
+void tud_network_xmit(void *ref, uint16_t arg)
+{
+  transmit_ntb_t *ntb = &transmit_ntb[ncm_interface.current_ntb];
+
+  uint16_t size = tud_network_xmit_cb(ntb->data + ncm_interface.next_datagram_offset, ref, arg);
+  tud_network_xmit_commit(size);
+}
+
+#if CFG_TUD_NCM_IN_AGGREGATION_SOF
+static void ncm_tx_flush_deferred(void *param)
+{
+  (void) param;
+
+  // window expired: send current NTB now, or queue it if another one is on the bus
+  if (ncm_interface.itf_data_alt == 1 && ncm_interface.datagram_count &&
+      ncm_interface.tx_ntb_count + 2 <= CFG_TUD_NCM_IN_NTB_N) {
+    ncm_close_ntb();
+    ncm_start_tx();
+  }
+}
+
+// Invoked in ISR context
+void netd_sof(uint8_t rhport, uint32_t frame_count)
+{
+  (void) rhport;
+  (void) frame_count;
+
+  uint16_t const remain = ncm_interface.tx_flush_sof;
+  if (remain) {
+    ncm_interface.tx_flush_sof = (uint16_t) (remain - 1);
+
+    // deadline reached, send in usbd task since NTB can not be closed in ISR
+    if (remain == 1) {
+      usbd_defer_func(ncm_tx_flush_deferred, NULL, true);
+    }
+  }
+}
+#endif
+
 #endif
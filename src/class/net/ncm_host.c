@@ -0,0 +1,760 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUH_ENABLED && CFG_TUH_NCM)
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "ncm_host.h"
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUH_NCM_LOG_LEVEL
+  #define CFG_TUH_NCM_LOG_LEVEL   CFG_TUH_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUH_NCM_LOG_LEVEL, __VA_ARGS__)
+
+TU_VERIFY_STATIC(CFG_TUH_NCM_IN_NTB_MAX_SIZE >= 2048, "NTB input size must be at least 2048");
+TU_VERIFY_STATIC(CFG_TUH_NCM_IN_NTB_MAX_SIZE <= 0xFFFF && CFG_TUH_NCM_OUT_NTB_MAX_SIZE <= 0xFFFF,
+                 "only NTB16 is supported");
+TU_VERIFY_STATIC((CFG_TUH_NCM_IN_NTB_MAX_SIZE % 4) == 0 && (CFG_TUH_NCM_OUT_NTB_MAX_SIZE % 4) == 0,
+                 "NTB size must be multiple of 4");
+TU_VERIFY_STATIC(CFG_TUH_NCM_IN_NTB_N >= 1, "at least one IN NTB is required");
+TU_VERIFY_STATIC(CFG_TUH_NCM_OUT_NTB_N >= 2, "at least two OUT NTBs are required");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+enum {
+  NCMH_NOTIF_BUFSIZE = 16 // notification header + 8 bytes of CONNECTION_SPEED_CHANGE data
+};
+
+typedef union TU_ATTR_PACKED {
+  struct {
+    nth16_t nth;
+  };
+  uint8_t data[CFG_TUH_NCM_OUT_NTB_MAX_SIZE];
+} ncmh_transmit_ntb_t;
+
+typedef struct {
+  uint8_t daddr;
+
+  uint8_t itf_num;        // Communication Interface
+  uint8_t itf_data;       // Data Interface
+  uint8_t itf_data_alt;   // Alternate setting of Data Interface with bulk endpoints
+  bool mounted;           // Enumeration is complete
+  bool link_up;           // Last reported by NETWORK_CONNECTION notification
+
+  uint8_t ep_notif;
+  uint8_t ep_in;
+  uint8_t ep_out;
+  uint16_t ep_notif_size;
+  uint16_t ep_out_size;
+
+  uint8_t mac_str_index;  // iMACAddress of Ethernet Networking Functional Descriptor
+  bool has_mac;
+  uint8_t mac_address[6];
+
+  // NTB parameters agreed with device
+  uint16_t ntb_in_size;           // Maximum size of received NTBs
+  uint16_t ntb_out_size;          // Maximum size of transmitted NTBs
+  uint16_t ndp_out_index;         // Offset of NDP in transmitted NTBs, aligned to wNdpOutAlignment
+  uint16_t out_divisor;           // Datagram offset in transmitted NTBs % out_divisor == out_remainder
+  uint16_t out_remainder;
+  uint8_t  max_datagrams_per_ntb; // Maximum number of datagrams per transmitted NTB
+
+  // Receive
+  const ndp16_t* ndp;             // NDP of receive_ntb[rx_ntb_head] being delivered, NULL if none
+  uint16_t num_datagrams;
+  uint16_t current_datagram_index;
+  uint8_t rx_ntb_head;            // Index in receive_ntb[] of the oldest received NTB
+  uint8_t rx_ntb_count;           // Number of received NTBs not yet fully consumed by client
+
+  // Transmit
+  uint8_t tx_ntb_head;            // Index in transmit_ntb[] of the oldest closed NTB, sent first
+  uint8_t tx_ntb_count;           // Number of closed NTBs waiting for or being transferred
+  uint8_t current_ntb;            // Index in transmit_ntb[] that is currently being filled with datagrams
+  uint8_t datagram_count;         // Number of datagrams in transmit_ntb[current_ntb]
+  uint16_t ntb_length;            // Length of transmit_ntb[current_ntb] up to the end of last datagram
+  uint16_t nth_sequence;          // Sequence number counter for transmitted NTBs
+  bool transferring;
+
+  CFG_TUH_MEM_ALIGN uint8_t receive_ntb[CFG_TUH_NCM_IN_NTB_N][CFG_TUH_NCM_IN_NTB_MAX_SIZE];
+  CFG_TUH_MEM_ALIGN ncmh_transmit_ntb_t transmit_ntb[CFG_TUH_NCM_OUT_NTB_N];
+  CFG_TUH_MEM_ALIGN uint8_t notif_buf[NCMH_NOTIF_BUFSIZE];
+} ncmh_interface_t;
+
+CFG_TUH_MEM_SECTION
+tu_static ncmh_interface_t _ncmh_itf[CFG_TUH_NCM];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline ncmh_interface_t* get_itf(uint8_t idx) {
+  TU_ASSERT(idx < CFG_TUH_NCM, NULL);
+  ncmh_interface_t* p_ncm = &_ncmh_itf[idx];
+  return (p_ncm->daddr != 0) ? p_ncm : NULL;
+}
+
+// Get instance ID by endpoint address
+static uint8_t get_idx_by_epaddr(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t const* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr &&
+        (p_ncm->ep_notif == ep_addr || p_ncm->ep_in == ep_addr || p_ncm->ep_out == ep_addr)) {
+      return idx;
+    }
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static ncmh_interface_t* find_new_itf(void) {
+  for (uint8_t i = 0; i < CFG_TUH_NCM; i++) {
+    if (_ncmh_itf[i].daddr == 0) return &_ncmh_itf[i];
+  }
+  return NULL;
+}
+
+//--------------------------------------------------------------------+
+// Interface API
+//--------------------------------------------------------------------+
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr, uint8_t itf_num) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t const* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr && p_ncm->itf_num == itf_num) return idx;
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+bool tuh_ncm_itf_get_info(uint8_t idx, tuh_itf_info_t* info) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && info);
+
+  info->daddr = p_ncm->daddr;
+
+  // re-construct descriptor
+  tusb_desc_interface_t* desc = &info->desc;
+  desc->bLength            = sizeof(tusb_desc_interface_t);
+  desc->bDescriptorType    = TUSB_DESC_INTERFACE;
+
+  desc->bInterfaceNumber   = p_ncm->itf_num;
+  desc->bAlternateSetting  = 0;
+  desc->bNumEndpoints      = 1;
+  desc->bInterfaceClass    = TUSB_CLASS_CDC;
+  desc->bInterfaceSubClass = CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL;
+  desc->bInterfaceProtocol = 0;
+  desc->iInterface         = 0; // not used yet
+
+  return true;
+}
+
+bool tuh_ncm_mounted(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm);
+  return p_ncm->mounted;
+}
+
+bool tuh_ncm_get_mac_address(uint8_t idx, uint8_t mac[6]) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted && p_ncm->has_mac);
+  memcpy(mac, p_ncm->mac_address, 6);
+  return true;
+}
+
+bool tuh_ncm_link_is_up(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+  return p_ncm->link_up;
+}
+
+//--------------------------------------------------------------------+
+// Receive
+//--------------------------------------------------------------------+
+
+// Receive the next NTB if there is a free buffer and the endpoint is idle
+static void ncmh_recv_arm(ncmh_interface_t* p_ncm) {
+  if (p_ncm->rx_ntb_count >= CFG_TUH_NCM_IN_NTB_N) return;
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_in),);
+
+  uint8_t const i = (p_ncm->rx_ntb_head + p_ncm->rx_ntb_count) % CFG_TUH_NCM_IN_NTB_N;
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_in, p_ncm->receive_ntb[i], p_ncm->ntb_in_size)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_in);
+  }
+}
+
+// return true if received NTB has valid headers
+static bool ncmh_validate_ntb(uint8_t const* ntb, uint32_t len) {
+  TU_VERIFY(len > 0);
+  TU_ASSERT(len >= sizeof(nth16_t));
+
+  nth16_t const* hdr = (nth16_t const*) ntb;
+  TU_ASSERT(hdr->dwSignature == NTH16_SIGNATURE);
+  TU_ASSERT(hdr->wBlockLength <= len);
+  TU_ASSERT(hdr->wNdpIndex >= sizeof(nth16_t) && (hdr->wNdpIndex + sizeof(ndp16_t)) <= hdr->wBlockLength);
+
+  ndp16_t const* ndp = (ndp16_t const*) (ntb + hdr->wNdpIndex);
+  TU_ASSERT(ndp->dwSignature == NDP16_SIGNATURE_NCM0 || ndp->dwSignature == NDP16_SIGNATURE_NCM1);
+  TU_ASSERT(hdr->wNdpIndex + ndp->wLength <= hdr->wBlockLength);
+
+  return true;
+}
+
+// Release the oldest NTB once all of its datagrams are consumed and parse the next received one, if any
+static void ncmh_recv_next(ncmh_interface_t* p_ncm) {
+  while (!p_ncm->num_datagrams && p_ncm->rx_ntb_count) {
+    uint8_t const* ntb = p_ncm->receive_ntb[p_ncm->rx_ntb_head];
+
+    if (p_ncm->ndp) {
+      // all datagrams of oldest NTB are consumed, release it
+      p_ncm->ndp = NULL;
+      p_ncm->rx_ntb_head = (uint8_t) ((p_ncm->rx_ntb_head + 1) % CFG_TUH_NCM_IN_NTB_N);
+      p_ncm->rx_ntb_count--;
+      continue;
+    }
+
+    // headers are already validated when received, number of entries excludes the terminator
+    nth16_t const* hdr = (nth16_t const*) ntb;
+    ndp16_t const* ndp = (ndp16_t const*) (ntb + hdr->wNdpIndex);
+    uint16_t const max_datagrams = (uint16_t) ((ndp->wLength - sizeof(ndp16_t)) / sizeof(ndp16_datagram_t));
+
+    p_ncm->ndp = ndp;
+    p_ncm->current_datagram_index = 0;
+    p_ncm->num_datagrams = 0;
+
+    for (uint16_t i = 0; i < max_datagrams; i++) {
+      uint16_t const index  = ndp->datagram[i].wDatagramIndex;
+      uint16_t const length = ndp->datagram[i].wDatagramLength;
+      if (!index || !length) break;
+
+      if (index + length > hdr->wBlockLength) {
+        TU_LOG_DRV("  NCMh datagram %u out of NTB\r\n", i);
+        break;
+      }
+
+      p_ncm->num_datagrams++;
+    }
+  }
+}
+
+void tuh_network_recv_renew(uint8_t idx) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted,);
+
+  ncmh_recv_next(p_ncm);
+  ncmh_recv_arm(p_ncm); // buffer may have been released
+
+  if (!p_ncm->num_datagrams) return;
+
+  ndp16_datagram_t const* datagram = &p_ncm->ndp->datagram[p_ncm->current_datagram_index];
+  p_ncm->current_datagram_index++;
+  p_ncm->num_datagrams--;
+
+  tuh_network_recv_cb(idx, p_ncm->receive_ntb[p_ncm->rx_ntb_head] + datagram->wDatagramIndex,
+                      datagram->wDatagramLength);
+}
+
+static void handle_incoming_ntb(uint8_t idx, ncmh_interface_t* p_ncm, uint32_t len) {
+  uint8_t const i = (p_ncm->rx_ntb_head + p_ncm->rx_ntb_count) % CFG_TUH_NCM_IN_NTB_N;
+
+  if (ncmh_validate_ntb(p_ncm->receive_ntb[i], len)) {
+    p_ncm->rx_ntb_count++;
+
+    // deliver now if client is not holding a datagram, otherwise on next tuh_network_recv_renew()
+    if (!p_ncm->ndp) {
+      tuh_network_recv_renew(idx);
+      return;
+    }
+  }
+
+  // invalid NTB is dropped and its buffer is reused
+  ncmh_recv_arm(p_ncm);
+}
+
+//--------------------------------------------------------------------+
+// Transmit
+//--------------------------------------------------------------------+
+
+// Offset where next datagram of current NTB is placed, following wNdpOutDivisor and wNdpOutPayloadRemainder
+static uint16_t ncmh_datagram_offset(ncmh_interface_t const* p_ncm) {
+  uint16_t const rem = p_ncm->ntb_length % p_ncm->out_divisor;
+  return (uint16_t) (p_ncm->ntb_length + (p_ncm->out_divisor + p_ncm->out_remainder - rem) % p_ncm->out_divisor);
+}
+
+// Set up the current NTB to be ready to add datagrams
+static void ncmh_prepare_for_tx(ncmh_interface_t* p_ncm) {
+  p_ncm->datagram_count = 0;
+  // datagrams start after all the headers
+  p_ncm->ntb_length = (uint16_t) (p_ncm->ndp_out_index + sizeof(ndp16_t) +
+                                  (p_ncm->max_datagrams_per_ntb + 1) * sizeof(ndp16_datagram_t));
+}
+
+// Fill in the headers of the current NTB and queue it for transmission,
+// then start filling the next NTB in the ring with datagrams.
+static void ncmh_close_ntb(ncmh_interface_t* p_ncm) {
+  ncmh_transmit_ntb_t* ntb = &p_ncm->transmit_ntb[p_ncm->current_ntb];
+  uint16_t ntb_length = p_ncm->ntb_length;
+
+  // NTB shorter than ntb_out_size must end with a short packet, pad one byte instead of sending ZLP
+  if ((ntb_length % p_ncm->ep_out_size) == 0 && ntb_length < p_ncm->ntb_out_size) {
+    ntb->data[ntb_length] = 0;
+    ntb_length++;
+  }
+
+  // Fill in NTB header
+  ntb->nth.dwSignature   = NTH16_SIGNATURE;
+  ntb->nth.wHeaderLength = sizeof(nth16_t);
+  ntb->nth.wSequence     = p_ncm->nth_sequence++;
+  ntb->nth.wBlockLength  = ntb_length;
+  ntb->nth.wNdpIndex     = p_ncm->ndp_out_index;
+
+  // Fill in NDP16 header and terminator
+  ndp16_t* ndp = (ndp16_t*) (ntb->data + p_ncm->ndp_out_index);
+  ndp->dwSignature   = NDP16_SIGNATURE_NCM0;
+  ndp->wLength       = (uint16_t) (sizeof(ndp16_t) + (p_ncm->datagram_count + 1) * sizeof(ndp16_datagram_t));
+  ndp->wNextNdpIndex = 0;
+  ndp->datagram[p_ncm->datagram_count].wDatagramIndex  = 0;
+  ndp->datagram[p_ncm->datagram_count].wDatagramLength = 0;
+
+  // Move on to the next NTB and clear it out
+  p_ncm->tx_ntb_count++;
+  p_ncm->current_ntb = (uint8_t) ((p_ncm->current_ntb + 1) % CFG_TUH_NCM_OUT_NTB_N);
+  ncmh_prepare_for_tx(p_ncm);
+}
+
+// If not already transmitting, start sending the oldest closed NTB to the device.
+// If there is none, close the current NTB if it has any datagram and send it.
+static void ncmh_start_tx(ncmh_interface_t* p_ncm) {
+  if (p_ncm->transferring) return;
+
+  if (!p_ncm->tx_ntb_count) {
+    if (!p_ncm->datagram_count) return;
+    ncmh_close_ntb(p_ncm);
+  }
+
+  ncmh_transmit_ntb_t* ntb = &p_ncm->transmit_ntb[p_ncm->tx_ntb_head];
+
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_out),);
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_out, ntb->data, ntb->nth.wBlockLength)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_out);
+    return;
+  }
+
+  p_ncm->transferring = true;
+}
+
+bool tuh_network_can_xmit(uint8_t idx, uint16_t size) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted);
+
+  bool const full_count = p_ncm->datagram_count >= p_ncm->max_datagrams_per_ntb;
+  bool const full_size = ncmh_datagram_offset(p_ncm) + size > p_ncm->ntb_out_size;
+
+  if (full_count || full_size) {
+    // queue current NTB behind the one on the bus and continue with the next one, keeping one
+    // NTB always available for filling
+    if (!p_ncm->datagram_count || p_ncm->tx_ntb_count + 2 > CFG_TUH_NCM_OUT_NTB_N) {
+      TU_LOG_DRV("NTB full [by %s]\r\n", full_count ? "count" : "size");
+      return false;
+    }
+    ncmh_close_ntb(p_ncm);
+
+    // datagram does not fit in an empty NTB
+    TU_VERIFY(ncmh_datagram_offset(p_ncm) + size <= p_ncm->ntb_out_size);
+  }
+
+  return true;
+}
+
+uint8_t* tuh_network_xmit_reserve(uint8_t idx, uint16_t size) {
+  TU_VERIFY(tuh_network_can_xmit(idx, size), NULL);
+
+  ncmh_interface_t* p_ncm = &_ncmh_itf[idx];
+  return p_ncm->transmit_ntb[p_ncm->current_ntb].data + ncmh_datagram_offset(p_ncm);
+}
+
+void tuh_network_xmit_commit(uint8_t idx, uint16_t size) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted,);
+
+  ncmh_transmit_ntb_t* ntb = &p_ncm->transmit_ntb[p_ncm->current_ntb];
+  ndp16_t* ndp = (ndp16_t*) (ntb->data + p_ncm->ndp_out_index);
+  uint16_t const offset = ncmh_datagram_offset(p_ncm);
+
+  ndp->datagram[p_ncm->datagram_count].wDatagramIndex  = offset;
+  ndp->datagram[p_ncm->datagram_count].wDatagramLength = size;
+
+  p_ncm->datagram_count++;
+  p_ncm->ntb_length = (uint16_t) (offset + size);
+
+  ncmh_start_tx(p_ncm);
+}
+
+void tuh_network_xmit(uint8_t idx, void* ref, uint16_t arg) {
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm && p_ncm->mounted,);
+
+  uint8_t* dst = p_ncm->transmit_ntb[p_ncm->current_ntb].data + ncmh_datagram_offset(p_ncm);
+  uint16_t const size = tuh_network_xmit_cb(idx, dst, ref, arg);
+  tuh_network_xmit_commit(idx, size);
+}
+
+//--------------------------------------------------------------------+
+// Notification
+//--------------------------------------------------------------------+
+
+static void ncmh_notif_arm(ncmh_interface_t* p_ncm) {
+  if (!p_ncm->ep_notif) return;
+  TU_VERIFY(usbh_edpt_claim(p_ncm->daddr, p_ncm->ep_notif),);
+
+  // request one packet at most so that each notification completes on its own
+  uint16_t const len = tu_min16(p_ncm->ep_notif_size, NCMH_NOTIF_BUFSIZE);
+  if (!usbh_edpt_xfer(p_ncm->daddr, p_ncm->ep_notif, p_ncm->notif_buf, len)) {
+    usbh_edpt_release(p_ncm->daddr, p_ncm->ep_notif);
+  }
+}
+
+static void handle_notification(uint8_t idx, ncmh_interface_t* p_ncm, uint32_t len) {
+  tusb_control_request_t const* notif = (tusb_control_request_t const*) p_ncm->notif_buf;
+
+  if (len >= sizeof(tusb_control_request_t) && notif->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS) {
+    switch (notif->bRequest) {
+      case CDC_NOTIF_NETWORK_CONNECTION:
+        p_ncm->link_up = (tu_le16toh(notif->wValue) != 0);
+        TU_LOG_DRV("  NCMh link %s\r\n", p_ncm->link_up ? "up" : "down");
+        if (tuh_network_link_state_cb) tuh_network_link_state_cb(idx, p_ncm->link_up);
+        break;
+
+      case CDC_NOTIF_CONNECTION_SPEED_CHANGE:
+        // DLBitRate and ULBitRate follow in the same or next packet, only logged
+        if (len >= NCMH_NOTIF_BUFSIZE) {
+          TU_LOG_DRV("  NCMh speed down = %" PRIu32 ", up = %" PRIu32 "\r\n",
+                     tu_unaligned_read32(p_ncm->notif_buf + 8), tu_unaligned_read32(p_ncm->notif_buf + 12));
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  ncmh_notif_arm(p_ncm);
+}
+
+//--------------------------------------------------------------------+
+// USBH API
+//--------------------------------------------------------------------+
+bool ncmh_init(void) {
+  TU_LOG_DRV("sizeof(ncmh_interface_t) = %u\r\n", sizeof(ncmh_interface_t));
+  tu_memclr(_ncmh_itf, sizeof(_ncmh_itf));
+  return true;
+}
+
+bool ncmh_deinit(void) {
+  return true;
+}
+
+bool ncmh_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
+  uint8_t const idx = get_idx_by_epaddr(daddr, ep_addr);
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm);
+
+  if (ep_addr == p_ncm->ep_in) {
+    // NTB received, failed transfer is dropped as invalid
+    handle_incoming_ntb(idx, p_ncm, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  } else if (ep_addr == p_ncm->ep_out) {
+    if (p_ncm->transferring) {
+      p_ncm->transferring = false;
+      p_ncm->tx_ntb_head = (uint8_t) ((p_ncm->tx_ntb_head + 1) % CFG_TUH_NCM_OUT_NTB_N);
+      p_ncm->tx_ntb_count--;
+    }
+
+    // Send NTBs queued up while this NTB was being emitted, or datagrams added to the current NTB meanwhile
+    ncmh_start_tx(p_ncm);
+  } else if (ep_addr == p_ncm->ep_notif) {
+    handle_notification(idx, p_ncm, (result == XFER_RESULT_SUCCESS) ? xferred_bytes : 0);
+  }
+
+  return true;
+}
+
+void ncmh_close(uint8_t daddr) {
+  for (uint8_t idx = 0; idx < CFG_TUH_NCM; idx++) {
+    ncmh_interface_t* p_ncm = &_ncmh_itf[idx];
+    if (p_ncm->daddr == daddr) {
+      TU_LOG_DRV("  NCMh close addr = %u index = %u\r\n", daddr, idx);
+      if (tuh_ncm_umount_cb) tuh_ncm_umount_cb(idx);
+      tu_memclr(p_ncm, sizeof(ncmh_interface_t));
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Enumeration
+//--------------------------------------------------------------------+
+
+bool ncmh_open(uint8_t rhport, uint8_t daddr, tusb_desc_interface_t const* desc_itf, uint16_t max_len) {
+  (void) rhport;
+
+  TU_VERIFY(TUSB_CLASS_CDC == desc_itf->bInterfaceClass &&
+            CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == desc_itf->bInterfaceSubClass);
+  TU_LOG_DRV("[%u] NCM opening Interface %u\r\n", daddr, desc_itf->bInterfaceNumber);
+
+  ncmh_interface_t* p_ncm = find_new_itf();
+  TU_ASSERT(p_ncm); // not enough interface, try to increase CFG_TUH_NCM
+  tu_memclr(p_ncm, offsetof(ncmh_interface_t, receive_ntb)); // clean up after previous failed attempt, if any
+
+  uint8_t const* p_desc = (uint8_t const*) desc_itf;
+  uint8_t const* desc_end = p_desc + max_len;
+
+  //------------- Communication Interface: functional descriptors + notification endpoint -------------//
+  p_desc = tu_desc_next(p_desc);
+  while (p_desc < desc_end && TUSB_DESC_INTERFACE != tu_desc_type(p_desc)) {
+    if (TUSB_DESC_CS_INTERFACE == tu_desc_type(p_desc) && CDC_FUNC_DESC_ETHERNET_NETWORKING == p_desc[2]) {
+      p_ncm->mac_str_index = p_desc[3];
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_INTERRUPT == desc_ep->bmAttributes.xfer &&
+                TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress));
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+      p_ncm->ep_notif = desc_ep->bEndpointAddress;
+      p_ncm->ep_notif_size = tu_edpt_packet_size(desc_ep);
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  //------------- Data Interface: alternate 0 is idle, bulk endpoints are in alternate 1 -------------//
+  bool in_ntb_alt = false;
+  while (p_desc < desc_end) {
+    if (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) {
+      tusb_desc_interface_t const* desc_data = (tusb_desc_interface_t const*) p_desc;
+      TU_ASSERT(TUSB_CLASS_CDC_DATA == desc_data->bInterfaceClass);
+
+      p_ncm->itf_data = desc_data->bInterfaceNumber;
+      in_ntb_alt = (2 == desc_data->bNumEndpoints &&
+                    NCM_DATA_PROTOCOL_NETWORK_TRANSFER_BLOCK == desc_data->bInterfaceProtocol);
+      if (in_ntb_alt) p_ncm->itf_data_alt = desc_data->bAlternateSetting;
+    } else if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc) && in_ntb_alt) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer);
+      TU_ASSERT(tuh_edpt_open(daddr, desc_ep));
+
+      if (TUSB_DIR_IN == tu_edpt_dir(desc_ep->bEndpointAddress)) {
+        p_ncm->ep_in = desc_ep->bEndpointAddress;
+      } else {
+        p_ncm->ep_out = desc_ep->bEndpointAddress;
+        p_ncm->ep_out_size = tu_edpt_packet_size(desc_ep);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_ncm->ep_in && p_ncm->ep_out);
+
+  p_ncm->daddr = daddr;
+  p_ncm->itf_num = desc_itf->bInterfaceNumber;
+
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Set Configure
+//--------------------------------------------------------------------+
+
+enum {
+  CONFIG_GET_NTB_PARAMETERS = 0,
+  CONFIG_SET_NTB_INPUT_SIZE,
+  CONFIG_GET_MAC_ADDRESS,
+  CONFIG_SET_INTERFACE,
+  CONFIG_COMPLETE
+};
+
+// control requests of string descriptor and data interface do not carry Communication interface number,
+// therefore instance index is passed in user_data along with state
+#define CONFIG_USER_DATA(_idx, _state)  ((uintptr_t) (((_idx) << 8) | (_state)))
+
+static void process_set_config(tuh_xfer_t* xfer);
+
+static bool ncmh_control_xfer(uint8_t daddr, uint8_t itf_num, uint8_t request, tusb_dir_t dir,
+                              void* buffer, uint16_t len, uintptr_t user_data) {
+  tusb_control_request_t const req = {
+      .bmRequestType_bit = {
+          .recipient = TUSB_REQ_RCPT_INTERFACE,
+          .type      = TUSB_REQ_TYPE_CLASS,
+          .direction = dir
+      },
+      .bRequest = request,
+      .wValue   = 0,
+      .wIndex   = tu_htole16((uint16_t) itf_num),
+      .wLength  = tu_htole16(len)
+  };
+
+  tuh_xfer_t xfer = {
+      .daddr       = daddr,
+      .ep_addr     = 0,
+      .setup       = &req,
+      .buffer      = (uint8_t*) buffer,
+      .complete_cb = process_set_config,
+      .user_data   = user_data
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+// Parse 12 hex digits of iMACAddress string descriptor
+static bool parse_mac_string(uint8_t const* desc, uint32_t len, uint8_t mac[6]) {
+  TU_VERIFY(len >= 2 + 12*2 && desc[0] >= 2 + 12*2 && TUSB_DESC_STRING == desc[1]);
+
+  for (uint8_t i = 0; i < 12; i++) {
+    uint8_t const c = desc[2 + 2*i];
+    uint8_t nibble;
+    if (c >= '0' && c <= '9') {
+      nibble = (uint8_t) (c - '0');
+    } else if (c >= 'A' && c <= 'F') {
+      nibble = (uint8_t) (c - 'A' + 10);
+    } else if (c >= 'a' && c <= 'f') {
+      nibble = (uint8_t) (c - 'a' + 10);
+    } else {
+      return false;
+    }
+    mac[i / 2] = (uint8_t) ((i & 1) ? (mac[i / 2] | nibble) : (nibble << 4));
+  }
+
+  return true;
+}
+
+bool ncmh_set_config(uint8_t daddr, uint8_t itf_num) {
+  uint8_t const idx = tuh_ncm_itf_get_index(daddr, itf_num);
+  TU_ASSERT(idx < CFG_TUH_NCM);
+
+  tusb_control_request_t request;
+  request.bRequest = 0;
+
+  // fake transfer to kick-off process
+  tuh_xfer_t xfer;
+  xfer.daddr = daddr;
+  xfer.result = XFER_RESULT_SUCCESS;
+  xfer.setup = &request;
+  xfer.user_data = CONFIG_USER_DATA(idx, CONFIG_GET_NTB_PARAMETERS);
+
+  process_set_config(&xfer);
+
+  return true;
+}
+
+static void process_set_config(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const idx = (uint8_t) (xfer->user_data >> 8);
+  uintptr_t const state = xfer->user_data & 0xff;
+
+  ncmh_interface_t* p_ncm = get_itf(idx);
+  TU_VERIFY(p_ncm,);
+
+  // iMACAddress is optional, failing to get it does not prevent network from working
+  if (!(xfer->setup->bRequest == TUSB_REQ_GET_DESCRIPTOR)) {
+    TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS,);
+  }
+
+  uint8_t* enum_buf = usbh_get_enum_buf(daddr);
+
+  switch (state) {
+    case CONFIG_GET_NTB_PARAMETERS:
+      TU_ASSERT(ncmh_control_xfer(daddr, p_ncm->itf_num, NCM_GET_NTB_PARAMETERS, TUSB_DIR_IN,
+                                  enum_buf, sizeof(ntb_parameters_t),
+                                  CONFIG_USER_DATA(idx, CONFIG_SET_NTB_INPUT_SIZE)),);
+      break;
+
+    case CONFIG_SET_NTB_INPUT_SIZE: {
+      TU_ASSERT(xfer->actual_len >= sizeof(ntb_parameters_t),);
+      ntb_parameters_t const* param = (ntb_parameters_t const*) enum_buf;
+
+      uint32_t const in_max = tu_le32toh(param->dwNtbInMaxSize);
+      uint32_t const out_max = tu_le32toh(param->dwNtbOutMaxSize);
+      uint16_t const out_alignment = tu_max16(tu_le16toh(param->wNdbOutAlignment), 4);
+      uint16_t const out_max_datagrams = tu_le16toh(param->wNtbOutMaxDatagrams);
+
+      p_ncm->ntb_in_size = (uint16_t) tu_min32(in_max, CFG_TUH_NCM_IN_NTB_MAX_SIZE);
+      p_ncm->ntb_out_size = (uint16_t) tu_min32(out_max, CFG_TUH_NCM_OUT_NTB_MAX_SIZE);
+      p_ncm->ndp_out_index = (uint16_t) (TU_DIV_CEIL(sizeof(nth16_t), out_alignment) * out_alignment);
+      p_ncm->out_divisor = tu_max16(tu_le16toh(param->wNdbOutDivisor), 1);
+      p_ncm->out_remainder = tu_le16toh(param->wNdbOutPayloadRemainder) % p_ncm->out_divisor;
+      p_ncm->max_datagrams_per_ntb = (out_max_datagrams && out_max_datagrams < CFG_TUH_NCM_MAX_DATAGRAMS_PER_NTB)
+                                     ? (uint8_t) out_max_datagrams : CFG_TUH_NCM_MAX_DATAGRAMS_PER_NTB;
+      ncmh_prepare_for_tx(p_ncm);
+
+      TU_LOG_DRV("  NCMh NTB in = %" PRIu32 ", out = %" PRIu32 ", max datagrams = %u\r\n",
+                 in_max, out_max, p_ncm->max_datagrams_per_ntb);
+
+      if (in_max > CFG_TUH_NCM_IN_NTB_MAX_SIZE) {
+        // ask device to not send NTB larger than our buffer
+        tu_unaligned_write32(enum_buf, tu_htole32(CFG_TUH_NCM_IN_NTB_MAX_SIZE));
+        TU_ASSERT(ncmh_control_xfer(daddr, p_ncm->itf_num, NCM_SET_NTB_INPUT_SIZE, TUSB_DIR_OUT, enum_buf, 4,
+                                    CONFIG_USER_DATA(idx, CONFIG_GET_MAC_ADDRESS)),);
+        break;
+      }
+    }
+    TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_GET_MAC_ADDRESS:
+      if (p_ncm->mac_str_index) {
+        TU_ASSERT(tuh_descriptor_get_string(daddr, p_ncm->mac_str_index, 0x0409, enum_buf, 2 + 12*2,
+                                            process_set_config, CONFIG_USER_DATA(idx, CONFIG_SET_INTERFACE)),);
+        break;
+      }
+      TU_ATTR_FALLTHROUGH;
+
+    case CONFIG_SET_INTERFACE:
+      if (xfer->setup->bRequest == TUSB_REQ_GET_DESCRIPTOR && xfer->result == XFER_RESULT_SUCCESS) {
+        p_ncm->has_mac = parse_mac_string(enum_buf, xfer->actual_len, p_ncm->mac_address);
+      }
+
+      TU_ASSERT(tuh_interface_set(daddr, p_ncm->itf_data, p_ncm->itf_data_alt,
+                                  process_set_config, CONFIG_USER_DATA(idx, CONFIG_COMPLETE)),);
+      break;
+
+    case CONFIG_COMPLETE:
+      TU_LOG_DRV("NCMh Set Configure complete\r\n");
+      p_ncm->mounted = true;
+
+      ncmh_notif_arm(p_ncm);
+      ncmh_recv_arm(p_ncm);
+
+      if (tuh_ncm_mount_cb) tuh_ncm_mount_cb(idx);
+
+      // notify usbh that driver enumeration is complete, data interface as well
+      usbh_driver_set_config_complete(daddr, p_ncm->itf_data);
+      break;
+
+    default:
+      break;
+  }
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_NCM_HOST_H_
+#define _TUSB_NCM_HOST_H_
+
+#include "class/cdc/cdc.h"
+#include "ncm.h"
+#include "net_host.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Maximum size of NTB received from device (IN), device is asked to send NTBs no larger than this.
+// Must be at least 2048 (NCM 1.0 Section 6.2.7), only NTB16 is supported
+#ifndef CFG_TUH_NCM_IN_NTB_MAX_SIZE
+#define CFG_TUH_NCM_IN_NTB_MAX_SIZE 3200
+#endif
+
+// Maximum size of NTB sent to device (OUT), further limited by dwNtbOutMaxSize of device
+#ifndef CFG_TUH_NCM_OUT_NTB_MAX_SIZE
+#define CFG_TUH_NCM_OUT_NTB_MAX_SIZE 3200
+#endif
+
+// Number of IN NTBs: more than one allows receiving next NTB while datagrams of previous ones are consumed
+#ifndef CFG_TUH_NCM_IN_NTB_N
+#define CFG_TUH_NCM_IN_NTB_N 2
+#endif
+
+// Number of OUT NTBs: one is filled with datagrams while others are queued or on the bus
+#ifndef CFG_TUH_NCM_OUT_NTB_N
+#define CFG_TUH_NCM_OUT_NTB_N 2
+#endif
+
+// Maximum number of datagrams per OUT NTB, further limited by wNtbOutMaxDatagrams of device
+#ifndef CFG_TUH_NCM_MAX_DATAGRAMS_PER_NTB
+#define CFG_TUH_NCM_MAX_DATAGRAMS_PER_NTB 8
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+
+// Get Interface index from device address + Communication interface number
+// return TUSB_INDEX_INVALID_8 (0xFF) if not found
+uint8_t tuh_ncm_itf_get_index(uint8_t daddr, uint8_t itf_num);
+
+// Get Interface information of the Communication interface
+// return true if index is correct and interface is currently mounted
+bool tuh_ncm_itf_get_info(uint8_t idx, tuh_itf_info_t* info);
+
+// Check if a interface is mounted
+bool tuh_ncm_mounted(uint8_t idx);
+
+// Get MAC address of device network interface, read from iMACAddress of Ethernet Networking Functional Descriptor.
+// return false if not mounted or device does not report it
+bool tuh_ncm_get_mac_address(uint8_t idx, uint8_t mac[6]);
+
+// Get link state last reported by NETWORK_CONNECTION notification
+bool tuh_ncm_link_is_up(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// Invoked when a device with NCM interface is mounted, network is ready for transfer
+TU_ATTR_WEAK extern void tuh_ncm_mount_cb(uint8_t idx);
+
+// Invoked when a device with NCM interface is unmounted
+TU_ATTR_WEAK extern void tuh_ncm_umount_cb(uint8_t idx);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+bool ncmh_init(void);
+bool ncmh_deinit(void);
+bool ncmh_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const* desc_itf, uint16_t max_len);
+bool ncmh_set_config(uint8_t dev_addr, uint8_t itf_num);
+bool ncmh_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void ncmh_close(uint8_t dev_addr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_NCM_HOST_H_ */
@@ -44,6 +44,34 @@
 #define CFG_TUD_NET_MTU           1514
 #endif
 
+// Number of receive buffers application can provide ahead of time with tud_network_recv_provide() (ECM/RNDIS)
+#ifndef CFG_TUD_NET_RX_BUF_N
+#define CFG_TUD_NET_RX_BUF_N 2
+#endif
+
+// Maximum number of RNDIS packet messages in one USB transfer (MaxPacketsPerTransfer), in both directions. With more
+// than one, frames queued while an IN transfer is on the bus are sent together in the next one, and host may send
+// several frames per OUT transfer. Buffers provided with tud_network_recv_provide() should be TUD_NET_RNDIS_XFER_SIZE
+#ifndef CFG_TUD_NET_RNDIS_MAX_PACKETS
+#define CFG_TUD_NET_RNDIS_MAX_PACKETS 1
+#endif
+
+// RNDIS packet message (44 bytes header) carrying a full frame, padded to 4 bytes within multi-packet transfers
+#define TUD_NET_RNDIS_PACKET_SIZE ((44 + CFG_TUD_NET_MTU + 3) & ~3u)
+
+// Maximum RNDIS transfer size (MaxTransferSize)
+#if CFG_TUD_NET_RNDIS_MAX_PACKETS > 1
+#define TUD_NET_RNDIS_XFER_SIZE   (CFG_TUD_NET_RNDIS_MAX_PACKETS * TUD_NET_RNDIS_PACKET_SIZE)
+#else
+#define TUD_NET_RNDIS_XFER_SIZE   (44 + CFG_TUD_NET_MTU)
+#endif
+
+// Support 32-bit NTB (NTH32/NDP32) selected by host with SET_NTB_FORMAT.
+// NTB larger than 64 KiB requires this and CFG_TUD_LARGE_XFER
+#ifndef CFG_TUD_NCM_NTB32
+#define CFG_TUD_NCM_NTB32 0
+#endif
+
 #ifndef CFG_TUD_NCM_IN_NTB_MAX_SIZE
 #define CFG_TUD_NCM_IN_NTB_MAX_SIZE 3200
 #endif
@@ -52,10 +80,32 @@
 #define CFG_TUD_NCM_OUT_NTB_MAX_SIZE 3200
 #endif
 
+// Number of IN NTBs: one is filled with datagrams while others are queued or on the bus
+#ifndef CFG_TUD_NCM_IN_NTB_N
+#define CFG_TUD_NCM_IN_NTB_N 2
+#endif
+
+// Number of OUT NTBs: more than one allows receiving next NTB while datagrams of previous ones are consumed
+#ifndef CFG_TUD_NCM_OUT_NTB_N
+#define CFG_TUD_NCM_OUT_NTB_N 1
+#endif
+
 #ifndef CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB
 #define CFG_TUD_NCM_MAX_DATAGRAMS_PER_NTB 8
 #endif
 
+// Maximum number of SOF frames a partially filled IN NTB is held for more datagrams when the IN endpoint is idle, 0 to
+// send right away. Window adapts to traffic: it doubles (up to this value) while NTBs carry several datagrams and is
+// halved when they carry only one
+#ifndef CFG_TUD_NCM_IN_AGGREGATION_SOF
+#define CFG_TUD_NCM_IN_AGGREGATION_SOF 0
+#endif
+
+// Maximum number of received datagrams passed to tud_network_recv_batch_cb() at once
+#ifndef CFG_TUD_NCM_MAX_DATAGRAMS_PER_BATCH
+#define CFG_TUD_NCM_MAX_DATAGRAMS_PER_BATCH 8
+#endif
+
 #ifndef CFG_TUD_NCM_ALIGNMENT
 #define CFG_TUD_NCM_ALIGNMENT 4
 #endif
@@ -64,6 +114,12 @@
  extern "C" {
 #endif
 
+// received datagram
+typedef struct {
+  const uint8_t *buf;
+  uint16_t len;
+} tud_network_datagram_t;
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -84,6 +140,13 @@ void tud_network_xmit(void *ref, uint16_t arg);
 // client must provide this: return false if the packet buffer was not accepted
 bool tud_network_recv_cb(const uint8_t *src, uint16_t size);
 
+// Optional: receive datagrams in batch. If implemented, it is invoked instead of tud_network_recv_cb() with all
+// datagrams of an NCM NTB (up to CFG_TUD_NCM_MAX_DATAGRAMS_PER_BATCH at once), all frames of an RNDIS transfer or
+// the single ECM frame.
+// Datagrams and the list stay valid until client calls tud_network_recv_renew() to release the batch.
+// Return false if the batch was not accepted, it is released right away.
+TU_ATTR_WEAK bool tud_network_recv_batch_cb(tud_network_datagram_t const *datagrams, uint8_t count);
+
 // client must provide this: copy from network stack packet pointer to dst
 uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
 
@@ -92,6 +155,14 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
 // client must provide this: initialize any network state back to the beginning
 void tud_network_init_cb(void);
 
+// Provide buffer for receiving next frames directly, e.g payload of a network stack packet. Must be suitable for
+// USB transfer (CFG_TUD_MEM_SECTION, aligned) and at least CFG_TUD_NET_MTU bytes, plus 44 bytes for RNDIS header.
+// Up to CFG_TUD_NET_RX_BUF_N buffers are used in order before the internal one. Frame received into such buffer is
+// passed to tud_network_recv_cb() with src pointing inside it. Buffer is owned by client again from then on regardless
+// of the return value, tud_network_recv_renew() is not needed for it and reception continues with the next buffer.
+// Return false if queue is full.
+bool tud_network_recv_provide(uint8_t *buf, uint16_t size);
+
 // client must provide this: 48-bit MAC address
 // TODO removed later since it is not part of tinyusb stack
 extern uint8_t tud_network_mac_address[6];
@@ -101,6 +172,14 @@ extern uint8_t tud_network_mac_address[6];
 // callback to client providing optional indication of internal state of network driver
 void tud_network_link_state_cb(bool state);
 
+// Reserve space for a datagram of up to size bytes in the NTB being filled, so that client can write the frame
+// there directly instead of copying it in tud_network_xmit_cb(). Return pointer aligned to CFG_TUD_NCM_ALIGNMENT,
+// or NULL if datagram can not be accepted. Must be followed by tud_network_xmit_commit().
+uint8_t *tud_network_xmit_reserve(uint16_t size);
+
+// Complete the reserved datagram with its actual size (not larger than reserved) and queue it for transmission
+void tud_network_xmit_commit(uint16_t size);
+
 //--------------------------------------------------------------------+
 // INTERNAL USBD-CLASS DRIVER API
 //--------------------------------------------------------------------+
@@ -111,6 +190,7 @@ uint16_t netd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     netd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     netd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
 void     netd_report          (uint8_t *buf, uint16_t len);
+void     netd_sof             (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
@@ -0,0 +1,81 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef _TUSB_NET_HOST_H_
+#define _TUSB_NET_HOST_H_
+
+#include "common/tusb_common.h"
+
+// Network API is implemented by each host network driver, idx is the instance index of that driver
+#if ((CFG_TUH_NCM ? 1 : 0) + (CFG_TUH_RNDIS ? 1 : 0) + (CFG_TUH_ECM ? 1 : 0)) > 1
+#error "Only one of NCM, RNDIS and ECM host network drivers can be enabled"
+#endif
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Network API, mirroring net_device.h
+//--------------------------------------------------------------------+
+
+// indicate to network driver that client has finished with the packet provided to tuh_network_recv_cb()
+void tuh_network_recv_renew(uint8_t idx);
+
+// poll network driver for its ability to accept another packet to transmit
+bool tuh_network_can_xmit(uint8_t idx, uint16_t size);
+
+// if tuh_network_can_xmit() returns true, tuh_network_xmit() can be called once
+void tuh_network_xmit(uint8_t idx, void* ref, uint16_t arg);
+
+// Reserve space for a packet of up to size bytes in the transfer buffer being filled, so that client can write the
+// frame there directly instead of copying it in tuh_network_xmit_cb(). Pointer is at least 4-byte aligned, NCM
+// follows wNdpOutDivisor/wNdpOutPayloadRemainder of device. Return NULL if packet can not be accepted.
+// Must be followed by tuh_network_xmit_commit().
+uint8_t* tuh_network_xmit_reserve(uint8_t idx, uint16_t size);
+
+// Complete the reserved packet with its actual size (not larger than reserved) and queue it for transmission
+void tuh_network_xmit_commit(uint8_t idx, uint16_t size);
+
+//--------------------------------------------------------------------+
+// Application Callbacks (WEAK is optional)
+//--------------------------------------------------------------------+
+
+// client must provide this: return false if the packet buffer was not accepted.
+// Packet stays valid until tuh_network_recv_renew() is called.
+bool tuh_network_recv_cb(uint8_t idx, const uint8_t* src, uint16_t size);
+
+// client must provide this: copy from network stack packet pointer to dst
+uint16_t tuh_network_xmit_cb(uint8_t idx, uint8_t* dst, void* ref, uint16_t arg);
+
+// callback to client when device reports link state change
+TU_ATTR_WEAK void tuh_network_link_state_cb(uint8_t idx, bool state);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_NET_HOST_H_ */
@@ -147,6 +147,22 @@ typedef struct
 
   uint8_t const * devInBuffer; // pointer to application-layer used for transmissions
 
+  // Bulk OUT data received directly into application buffer by tud_usbtmc_receive_dev_msg_data()
+  uint8_t * rcv_direct_buf;
+  uint32_t rcv_direct_len; // requested length, 0 if not active
+
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+  // Streaming IN: one buffer is on the bus (or queued) while the other one is filled by the app
+  CFG_TUSB_MEM_ALIGN uint8_t stream_buf[2][CFG_TUD_USBTMC_STREAM_BUFSIZE];
+  uint32_t stream_len[2];
+  uint32_t stream_last_len; // length of the most recently submitted transfer
+  uint8_t stream_idx;       // buffer to be filled/submitted next
+  uint8_t stream_queued;    // transfers submitted but not yet completed
+  bool stream_active;
+  bool stream_filled;       // stream_buf[stream_idx] holds data not yet submitted
+  bool stream_termchar;
+#endif
+
   usbtmc_capabilities_specific_t const * capabilities;
 } usbtmc_interface_state_t;
 
@@ -158,6 +174,12 @@ CFG_TUD_MEM_SECTION tu_static usbtmc_interface_state_t usbtmc_state =
 // We need all headers to fit in a single packet in this implementation, 32 bytes will fit all standard USBTMC headers
 TU_VERIFY_STATIC(USBTMCD_BUFFER_SIZE >= 32u,"USBTMC dev buffer size too small");
 
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+// Every transfer but the last must end on a packet boundary
+TU_VERIFY_STATIC((CFG_TUD_USBTMC_STREAM_BUFSIZE % USBTMCD_BUFFER_SIZE) == 0, "USBTMC stream buffer size must be a multiple of packet size");
+TU_VERIFY_STATIC(CFG_TUD_USBTMC_STREAM_BUFSIZE <= UINT16_MAX, "USBTMC stream buffer size too large");
+#endif
+
 static bool handle_devMsgOutStart(uint8_t rhport, void *data, size_t len);
 static bool handle_devMsgOut(uint8_t rhport, void *data, size_t len, size_t packetLen);
 
@@ -247,6 +269,119 @@ bool tud_usbtmc_transmit_dev_msg_data(
   return true;
 }
 
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+// Fill stream buffer idx with the next chunk from the app, offset leaves room for the header
+static bool stream_fill(uint8_t idx, size_t offset)
+{
+  uint8_t *buf = usbtmc_state.stream_buf[idx];
+  const size_t n = tu_min32(usbtmc_state.transfer_size_remaining, (uint32_t) (CFG_TUD_USBTMC_STREAM_BUFSIZE - offset));
+
+  TU_ASSERT(tud_usbtmc_msg_data_stream_cb(buf + offset, n) == n);
+#ifndef NDEBUG
+  if(usbtmc_state.stream_termchar && (n == usbtmc_state.transfer_size_remaining))
+  {
+    TU_ASSERT(buf[offset + n - 1u] == termChar);
+  }
+#endif
+
+  usbtmc_state.transfer_size_remaining -= n;
+  usbtmc_state.transfer_size_sent += n;
+  usbtmc_state.stream_len[idx] = offset + n;
+  usbtmc_state.stream_filled = true;
+  return true;
+}
+
+static bool stream_submit(void)
+{
+  const uint8_t idx = usbtmc_state.stream_idx;
+  const uint16_t len = (uint16_t) usbtmc_state.stream_len[idx];
+
+  TU_ASSERT(usbd_edpt_xfer(usbtmc_state.rhport, usbtmc_state.ep_bulk_in, usbtmc_state.stream_buf[idx], len));
+  usbtmc_state.stream_last_len = len;
+  usbtmc_state.stream_filled = false;
+  usbtmc_state.stream_idx ^= 1u;
+  usbtmc_state.stream_queued++;
+  return true;
+}
+
+// Keep the endpoint busy: submit the filled buffer as soon as the endpoint accepts it
+// (immediately with the usbd transfer queue, otherwise once the previous one completed),
+// then refill the free buffer. Completes the message when everything has been sent.
+static bool stream_pump(void)
+{
+  const bool can_queue = (CFG_TUD_EDPT_XFER_QUEUE_SZ > 0);
+
+  if(usbtmc_state.stream_filled && (can_queue || usbtmc_state.stream_queued == 0u))
+  {
+    TU_VERIFY(stream_submit());
+  }
+
+  if(!usbtmc_state.stream_filled && (usbtmc_state.stream_queued < 2u) && (usbtmc_state.transfer_size_remaining > 0u))
+  {
+    TU_VERIFY(stream_fill(usbtmc_state.stream_idx, 0u));
+    if(can_queue || usbtmc_state.stream_queued == 0u)
+    {
+      TU_VERIFY(stream_submit());
+    }
+  }
+
+  if(!usbtmc_state.stream_filled && (usbtmc_state.stream_queued == 0u) && (usbtmc_state.transfer_size_remaining == 0u))
+  {
+    usbtmc_state.stream_active = false;
+    if((usbtmc_state.stream_last_len % usbtmc_state.ep_bulk_in_wMaxPacketSize) == 0u)
+    {
+      // Last transfer ended on a packet boundary, terminate with ZLP
+      TU_VERIFY(atomicChangeState(STATE_TX_INITIATED, STATE_TX_SHORTED));
+      TU_VERIFY(usbd_edpt_xfer(usbtmc_state.rhport, usbtmc_state.ep_bulk_in, usbtmc_state.ep_bulk_in_buf, 0u));
+    }
+    else
+    {
+      TU_VERIFY(atomicChangeState(STATE_TX_INITIATED, STATE_NAK));
+      TU_VERIFY(tud_usbtmc_msgBulkIn_complete_cb());
+    }
+  }
+
+  return true;
+}
+
+bool tud_usbtmc_transmit_dev_msg_stream(size_t len, bool endOfMessage, bool usingTermChar)
+{
+#ifndef NDEBUG
+  TU_ASSERT(len > 0u);
+  TU_ASSERT(len <= usbtmc_state.transfer_size_remaining);
+  TU_ASSERT(usbtmc_state.transfer_size_sent == 0u);
+  if(usingTermChar)
+  {
+    TU_ASSERT(usbtmc_state.capabilities->bmDevCapabilities.canEndBulkInOnTermChar);
+    TU_ASSERT(termCharRequested);
+  }
+#endif
+
+  TU_VERIFY(tud_usbtmc_msg_data_stream_cb);
+  TU_VERIFY(usbtmc_state.state == STATE_TX_REQUESTED);
+  usbtmc_msg_dev_dep_msg_in_header_t *hdr = (usbtmc_msg_dev_dep_msg_in_header_t*)usbtmc_state.stream_buf[0];
+  tu_varclr(hdr);
+  hdr->header.MsgID = USBTMC_MSGID_DEV_DEP_MSG_IN;
+  hdr->header.bTag = usbtmc_state.lastBulkInTag;
+  hdr->header.bTagInverse = (uint8_t)~(usbtmc_state.lastBulkInTag);
+  hdr->TransferSize = len;
+  hdr->bmTransferAttributes.EOM = endOfMessage;
+  hdr->bmTransferAttributes.UsingTermChar = usingTermChar;
+
+  usbtmc_state.transfer_size_remaining = len;
+  usbtmc_state.transfer_size_sent = 0u;
+  usbtmc_state.stream_idx = 0u;
+  usbtmc_state.stream_queued = 0u;
+  usbtmc_state.stream_termchar = usingTermChar;
+
+  // First buffer carries the header followed by as much data as fits
+  TU_VERIFY(stream_fill(0u, sizeof(*hdr)));
+  TU_VERIFY(atomicChangeState(STATE_TX_REQUESTED, STATE_TX_INITIATED));
+  usbtmc_state.stream_active = true;
+  return stream_pump();
+}
+#endif
+
 bool tud_usbtmc_transmit_notification_data(const void * data, size_t len)
 {
 #ifndef NDEBUG
@@ -380,6 +515,35 @@ uint16_t usbtmcd_open_cb(uint8_t rhport, tusb_desc_interface_t const * itf_desc,
 // processing a command (such as a clear). Returns true if it was
 // in the NAK state and successfully transitioned to the ACK wait
 // state.
+bool tud_usbtmc_receive_dev_msg_data(void * buf, size_t len)
+{
+  const uint32_t mps = usbtmc_state.ep_bulk_out_wMaxPacketSize;
+
+  TU_VERIFY(usbtmc_state.state == STATE_RCV && usbtmc_state.transfer_size_remaining > 0u);
+  TU_VERIFY(usbtmc_state.rcv_direct_len == 0u);
+
+  // Host pads the message to a multiple of 4 bytes, packet size is a multiple of 4 as well therefore the
+  // remaining data has the same alignment as TransferSize. Request exactly what is left so that transfer
+  // completes without relying on a short packet, otherwise whole packets that fit into buf.
+  const uint32_t maxLen = tu_min32((uint32_t) len, UINT16_MAX);
+  uint32_t n = usbtmc_state.transfer_size_remaining;
+  n += (0u - n) & 3u;
+  if(n > maxLen)
+  {
+    n = maxLen - (maxLen % mps);
+  }
+  TU_VERIFY(n > 0u);
+
+  usbtmc_state.rcv_direct_buf = (uint8_t*) buf;
+  usbtmc_state.rcv_direct_len = n;
+  if(!usbd_edpt_xfer(usbtmc_state.rhport, usbtmc_state.ep_bulk_out, usbtmc_state.rcv_direct_buf, (uint16_t) n))
+  {
+    usbtmc_state.rcv_direct_len = 0u;
+    return false;
+  }
+  return true;
+}
+
 bool tud_usbtmc_start_bus_read(void)
 {
   usbtmcd_state_enum oldState = usbtmc_state.state;
@@ -536,6 +700,20 @@ bool usbtmcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint
         return true;
       }
     case STATE_RCV:
+      if(usbtmc_state.rcv_direct_len)
+      {
+        // Multi-packet transfer is short if it received less than requested, report its last packet length
+        // so that a short transfer ends the message as a short packet does
+        const uint32_t mps = usbtmc_state.ep_bulk_out_wMaxPacketSize;
+        const size_t lastLen = (xferred_bytes < usbtmc_state.rcv_direct_len) ? (xferred_bytes % mps) : mps;
+        usbtmc_state.rcv_direct_len = 0u;
+        if(!handle_devMsgOut(rhport, usbtmc_state.rcv_direct_buf, xferred_bytes, lastLen))
+        {
+          usbd_edpt_stall(rhport, usbtmc_state.ep_bulk_out);
+          return false;
+        }
+        return true;
+      }
       if(!handle_devMsgOut(rhport, usbtmc_state.ep_bulk_out_buf, xferred_bytes, xferred_bytes))
       {
         usbd_edpt_stall(rhport, usbtmc_state.ep_bulk_out);
@@ -558,6 +736,20 @@ bool usbtmcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint
   }
   else if(ep_addr == usbtmc_state.ep_bulk_in)
   {
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+    if(usbtmc_state.stream_queued > 0u)
+    {
+      usbtmc_state.stream_queued--;
+      if(usbtmc_state.stream_active)
+      {
+        return stream_pump();
+      }
+      if(usbtmc_state.stream_queued > 0u)
+      {
+        return true; // stream was aborted, wait for its last transfer
+      }
+    }
+#endif
     switch(usbtmc_state.state) {
     case STATE_TX_SHORTED:
       TU_VERIFY(atomicChangeState(STATE_TX_SHORTED, STATE_NAK));
@@ -579,7 +771,7 @@ bool usbtmcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint
       {
         size_t packetLen = usbtmc_state.transfer_size_remaining;
         memcpy(usbtmc_state.ep_bulk_in_buf, usbtmc_state.devInBuffer, usbtmc_state.transfer_size_remaining);
-          usbtmc_state.transfer_size_sent += sizeof(usbtmc_state.transfer_size_remaining);
+        usbtmc_state.transfer_size_sent += packetLen;
         usbtmc_state.transfer_size_remaining = 0;
         usbtmc_state.devInBuffer = NULL;
         TU_VERIFY( usbd_edpt_xfer(rhport, usbtmc_state.ep_bulk_in, usbtmc_state.ep_bulk_in_buf, (uint16_t)packetLen) );
@@ -700,6 +892,7 @@ bool usbtmcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request
       // Check if we've queued a short packet
       criticalEnter();
       usbtmc_state.state = STATE_ABORTING_BULK_OUT;
+      usbtmc_state.rcv_direct_len = 0u;
       criticalLeave();
       TU_VERIFY(tud_usbtmc_initiate_abort_bulk_out_cb(&(rsp.USBTMC_status)));
       usbd_edpt_stall(rhport, usbtmc_state.ep_bulk_out);
@@ -738,7 +931,17 @@ bool usbtmcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request
     usbtmc_state.transfer_size_remaining = 0u;
       // Check if we've queued a short packet
       criticalEnter();
-      usbtmc_state.state = ((usbtmc_state.transfer_size_sent % usbtmc_state.ep_bulk_in_wMaxPacketSize) == 0) ?
+      uint32_t queuedLen = usbtmc_state.transfer_size_sent;
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+      if(usbtmc_state.stream_active)
+      {
+        // Buffers not yet submitted are dropped, only the last transfer on the bus matters
+        usbtmc_state.stream_active = false;
+        usbtmc_state.stream_filled = false;
+        queuedLen = usbtmc_state.stream_last_len;
+      }
+#endif
+      usbtmc_state.state = ((queuedLen % usbtmc_state.ep_bulk_in_wMaxPacketSize) == 0) ?
               STATE_ABORTING_BULK_IN : STATE_ABORTING_BULK_IN_SHORTED;
       criticalLeave();
       if(usbtmc_state.transfer_size_sent  == 0)
@@ -806,6 +1009,7 @@ bool usbtmcd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request
       usbtmc_state.transfer_size_remaining = 0;
       criticalEnter();
       usbtmc_state.state = STATE_CLEARING;
+      usbtmc_state.rcv_direct_len = 0u;
       criticalLeave();
       TU_VERIFY(tud_usbtmc_initiate_clear_cb(&tmcStatusCode));
       TU_VERIFY(tud_control_xfer(rhport, request, (void*)&tmcStatusCode,sizeof(tmcStatusCode)));
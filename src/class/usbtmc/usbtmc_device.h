@@ -35,6 +35,13 @@
 #define CFG_TUD_USBTMC_ENABLE_488 (1)
 #endif
 
+// Size of each of the two bulk IN buffers used by tud_usbtmc_transmit_dev_msg_stream(), 0 disables streaming.
+// Must be a multiple of the bulk endpoint size (512 for highspeed, 64 for fullspeed). Larger buffers let
+// the controller send more packets back to back before the driver has to refill.
+#ifndef CFG_TUD_USBTMC_STREAM_BUFSIZE
+#define CFG_TUD_USBTMC_STREAM_BUFSIZE 0
+#endif
+
 /***********************************************
  *  Functions to be implemented by the class implementation
  */
@@ -94,6 +101,20 @@ bool tud_usbtmc_transmit_dev_msg_data(
     const void * data, size_t len,
     bool endOfMessage, bool usingTermChar);
 
+#if CFG_TUD_USBTMC_STREAM_BUFSIZE
+// Called from app, typically in tud_usbtmc_msgBulkIn_request_cb()
+//
+// Send a DEV_DEP_MSG_IN of len bytes whose data is pulled from
+// tud_usbtmc_msg_data_stream_cb() instead of a contiguous buffer, e.g. a
+// large waveform. One stream buffer is on the bus while the other is filled.
+bool tud_usbtmc_transmit_dev_msg_stream(size_t len, bool endOfMessage, bool usingTermChar);
+
+// Fill buf with the next bufsize bytes of the streamed message and return
+// bufsize. When usingTermChar is set, the last byte of the message must be
+// the TermChar. Invoked in usbd task context.
+TU_ATTR_WEAK size_t tud_usbtmc_msg_data_stream_cb(uint8_t* buf, size_t bufsize);
+#endif
+
 // Buffers a notification to be sent to the host. The data starts
 // with the bNotify1 field, see the USBTMC Specification, Table 13.
 //
@@ -105,6 +126,17 @@ bool tud_usbtmc_transmit_notification_data(const void * data, size_t len);
 
 bool tud_usbtmc_start_bus_read(void);
 
+// Called from app instead of tud_usbtmc_start_bus_read() while a DEV_DEP_MSG_OUT
+// is being received, typically in tud_usbtmc_msg_data_cb() with transfer_complete
+// false, e.g. for a large waveform upload.
+//
+// The rest of the message is received with one multi-packet transfer straight
+// into buf, then reported by tud_usbtmc_msg_data_cb() with data pointing into
+// buf. At most len bytes (up to 65535) are received, rounded down to a multiple of the bulk
+// endpoint size unless the rest of the message (plus up to 3 alignment bytes)
+// fits. buf must stay valid until then.
+bool tud_usbtmc_receive_dev_msg_data(void * buf, size_t len);
+
 
 /* "callbacks" from USB device core */
 
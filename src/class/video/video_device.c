@@ -98,6 +98,28 @@ typedef union {
   tusb_desc_video_frame_framebased_t  frame_based;
 } tusb_desc_cs_video_frm_t;
 
+/* frame submitted for transfer */
+typedef struct TU_ATTR_PACKED {
+  uint8_t *buffer;
+  uint32_t bufsize;
+  uint8_t  timing_mode; /* videod_timing_mode_t */
+  tud_video_frame_timing_t timing;
+} videod_frame_t;
+
+/* source of PTS and SCR of a frame */
+typedef enum {
+  VIDEOD_TIMING_NONE = 0, /* no PTS and SCR in payload headers */
+  VIDEOD_TIMING_APP,      /* PTS and SCR given by application */
+  VIDEOD_TIMING_PTS_SOF,  /* PTS given by application, SCR derived from SOF count for every payload */
+} videod_timing_mode_t;
+
+/* longest payload header: header with PTS and SCR */
+#define VIDEOD_PAYLOAD_HDR_MAX   12
+
+/* one more entry than queue size to hold the submitted frame until it is started */
+#define VIDEOD_FRAME_QUEUE_LEN   (CFG_TUD_VIDEO_FRAME_QUEUE_SIZE + 1)
+TU_VERIFY_STATIC(VIDEOD_FRAME_QUEUE_LEN < 128, "frame queue too large");
+
 /* video streaming interface */
 typedef struct TU_ATTR_PACKED {
   uint8_t index_vc;  /* index of bound video control interface */
@@ -108,16 +130,30 @@ typedef struct TU_ATTR_PACKED {
     uint16_t cur;    /* Offset of the current settings */
     uint16_t ep[2];  /* Offset of endpoint descriptors. 0: streaming, 1: still capture */
   } desc;
-  uint8_t *buffer;   /* frame buffer. assume linear buffer. no support for stride access */
-  uint32_t bufsize;  /* frame buffer size */
+  uint8_t *buffer;   /* frame buffer. assume linear buffer. no support for stride access. NULL if data is provided by tud_video_frame_xfer_data_cb() */
+  uint32_t bufsize;  /* frame size, non-zero while a frame is transferred */
   uint32_t offset;   /* offset for the next payload transfer */
   uint32_t max_payload_transfer_size;
   uint8_t  error_code;/* error code */
   uint8_t  state;    /* 0:probing 1:committed 2:streaming */
+  videod_frame_t queue[VIDEOD_FRAME_QUEUE_LEN]; /* frames waiting for transfer */
+  uint8_t  queue_wr; /* free-running count of submitted frames, only changed by submission */
+  uint8_t  queue_rd; /* free-running count of started frames, only changed while holding the endpoint claim */
+  uint16_t bulk_mps; /* max packet size of bulk streaming endpoint, 0 for isochronous */
+  uint32_t payload_remaining; /* bytes of current bulk payload to be sent after the transfer in progress */
+  uint8_t  payload_hdr[VIDEOD_PAYLOAD_HDR_MAX]; /* payload header of current frame, copied in front of every payload */
+  uint8_t  scr_from_sof; /* update SCR of payload header from SOF count for every payload */
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  uint8_t  xfer_busy;   /* a transfer is in progress */
+  uint8_t  ep_buf_idx;  /* shared EP buffer used by the transfer in progress, VIDEOD_EP_BUF_NONE if none */
+  uint32_t frame_start; /* scheduled start of current frame, in units of 100ns (see videod_sched_t) */
+#endif
 
   video_probe_and_commit_control_t probe_commit_payload; /* Probe and Commit control */
+#if !CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
   /*------------- From this point, data is not cleared by bus reset -------------*/
   CFG_TUSB_MEM_ALIGN uint8_t ep_buf[CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE]; /* EP transfer buffer for streaming */
+#endif
 } videod_streaming_interface_t;
 
 /* video control interface */
@@ -128,13 +164,22 @@ typedef struct TU_ATTR_PACKED {
   uint8_t     stm[CFG_TUD_VIDEO_STREAMING]; /* Indices of streaming interface */
   uint8_t error_code;  /* error code */
   uint8_t power_mode;
+  uint8_t rhport;      /* root port the interface is opened on */
 
   /*------------- From this point, data is not cleared by bus reset -------------*/
   // CFG_TUSB_MEM_ALIGN uint8_t ctl_buf[64]; /* EP transfer buffer for interrupt transfer */
 
 } videod_interface_t;
 
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+#define ITF_STM_MEM_RESET_SIZE   sizeof(videod_streaming_interface_t)
+#define VIDEOD_EP_BUF_NONE       0xFFu
+#define VIDEOD_EP_BUF(_stm)      (_videod_ep_buf[(_stm)->ep_buf_idx])
+TU_VERIFY_STATIC(CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED <= 32, "shared EP buffers exceed busy bitmap");
+#else
 #define ITF_STM_MEM_RESET_SIZE   offsetof(videod_streaming_interface_t, ep_buf)
+#define VIDEOD_EP_BUF(_stm)      ((_stm)->ep_buf)
+#endif
 
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
@@ -142,6 +187,34 @@ typedef struct TU_ATTR_PACKED {
 CFG_TUD_MEM_SECTION tu_static videod_interface_t _videod_itf[CFG_TUD_VIDEO];
 CFG_TUD_MEM_SECTION tu_static videod_streaming_interface_t _videod_streaming_itf[CFG_TUD_VIDEO_STREAMING];
 
+/* SOF count, source of SCR and STC (see tud_video_n_get_stc()) */
+typedef struct {
+  volatile uint32_t ms;    /* running count of 1ms frames */
+  volatile uint16_t frame; /* last 11-bit frame number */
+  bool enabled;
+} videod_sof_t;
+
+tu_static videod_sof_t _videod_sof;
+
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+/* EP transfer buffers shared by all streaming interfaces */
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN tu_static
+uint8_t _videod_ep_buf[CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED][CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE];
+
+/* Payloads of streaming interfaces are scheduled earliest deadline first. Each frame is given its frame interval, and
+ * a payload is due when the part of frame before it would have been sent at a steady rate over that interval. Time is
+ * virtual, in units of 100ns as dwFrameInterval: it advances with the due time of scheduled payloads, so a stream which
+ * had no frame to send gains no credit over the others. */
+typedef struct {
+  uint32_t busy; /* bitmap of shared EP buffers used by transfers in progress */
+  uint32_t now;  /* due time of the latest scheduled payload */
+} videod_sched_t;
+
+tu_static videod_sched_t _videod_sched;
+
+static void _release_ep_buf(videod_streaming_interface_t *stm);
+#endif
+
 tu_static uint8_t const _cap_get     = 0x1u; /* support for GET */
 tu_static uint8_t const _cap_get_set = 0x3u; /* support for GET and SET */
 
@@ -330,6 +403,11 @@ static void const* _next_desc_itf(void const *beg, void const *end) {
  * @retval end   did not found interface descriptor */
 static inline uint8_t const* _find_desc_itf(void const *beg, void const *end, uint_fast8_t itfnum, uint_fast8_t altnum)
 {
+#if CFG_TUD_ITF_INDEX_SZ
+  /* Look up the configuration index first, search only if it is not indexed */
+  void const *itf = usbd_itf_desc_find((uint8_t)itfnum, (uint8_t)altnum, NULL);
+  if (itf && ((uintptr_t)beg <= (uintptr_t)itf) && ((uintptr_t)itf < (uintptr_t)end)) return (uint8_t const*)itf;
+#endif
   return (uint8_t const*) _find_desc_3(beg, end, TUSB_DESC_INTERFACE, itfnum, altnum);
 }
 
@@ -398,7 +476,7 @@ static inline void const *_find_desc_format(void const *beg, void const *end, ui
     if ((fmt == VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED ||
          fmt == VIDEO_CS_ITF_VS_FORMAT_MJPEG ||
          fmt == VIDEO_CS_ITF_VS_FORMAT_DV ||
-         fmt == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) &&
+         fmt == VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED) &&
         fmtnum == p[3]) {
       return cur;
     }
@@ -424,6 +502,87 @@ static inline void const *_find_desc_frame(void const *beg, void const *end, uin
   return end;
 }
 
+/** Return bFrameIntervalType of a frame descriptor, 0 means continuous intervals */
+static inline uint_fast8_t _get_frame_interval_type(tusb_desc_cs_video_frm_t const *frm)
+{
+  if (frm->bDescriptorSubType == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) return frm->frame_based.bFrameIntervalType;
+  return frm->uncompressed.bFrameIntervalType;
+}
+
+/** Return dwFrameInterval[idx] of a frame descriptor, the frame based layout differs from the others */
+static inline uint_fast32_t _get_frame_interval(tusb_desc_cs_video_frm_t const *frm, uint_fast8_t idx)
+{
+  if (frm->bDescriptorSubType == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) return frm->frame_based.dwFrameInterval[idx];
+  return frm->uncompressed.dwFrameInterval[idx];
+}
+
+/** Return dwDefaultFrameInterval of a frame descriptor */
+static inline uint_fast32_t _get_default_frame_interval(tusb_desc_cs_video_frm_t const *frm)
+{
+  if (frm->bDescriptorSubType == VIDEO_CS_ITF_VS_FRAME_FRAME_BASED) return frm->frame_based.dwDefaultFrameInterval;
+  return frm->uncompressed.dwDefaultFrameInterval;
+}
+
+/** Return the maximum frame size of a format and frame, 0 if unknown.
+ *  Compressed frames vary in size and are submitted with their own length, this is an upper limit only. */
+static uint_fast32_t _get_max_frame_size(tusb_desc_cs_video_fmt_t const *fmt, tusb_desc_cs_video_frm_t const *frm)
+{
+  switch (fmt->bDescriptorSubType) {
+    case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+      return (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
+
+    case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+      return (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
+
+    case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+      return (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->frame_based.bBitsPerPixel / 8; /* decoded size */
+
+    default: return 0;
+  }
+}
+
+/** Largest payload per service interval among isochronous alternate settings, 0 if streaming is bulk */
+static uint_fast32_t _max_iso_payload_size(videod_streaming_interface_t const *stm)
+{
+  uint8_t const *desc = _videod_itf[stm->index_vc].beg;
+  uint8_t const *end  = desc + stm->desc.end;
+  uint_fast32_t max_size = 0;
+  for (uint8_t const *cur = desc + stm->desc.beg; cur < end; cur = tu_desc_next(cur)) {
+    if (TUSB_DESC_ENDPOINT != tu_desc_type(cur)) continue;
+    tusb_desc_endpoint_t const *ep = (tusb_desc_endpoint_t const *)cur;
+    if (TUSB_XFER_ISOCHRONOUS == ep->bmAttributes.xfer && tu_edpt_max_payload(ep) > max_size) {
+      max_size = tu_edpt_max_payload(ep);
+    }
+  }
+  return max_size;
+}
+
+/** Upper limit of dwMaxPayloadTransferSize, bulk payloads larger than EP buffer are sent in several transfers.
+ *  Isochronous payloads are also limited by the largest alternate setting. */
+static uint_fast32_t _max_payload_size(videod_streaming_interface_t const *stm)
+{
+#if CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY
+  if (stm->bulk_mps) return UINT32_MAX;
+#endif
+  uint_fast32_t const iso_size = stm->bulk_mps ? 0 : _max_iso_payload_size(stm);
+  if (iso_size && iso_size < CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE) return iso_size;
+  return CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
+}
+
+/** Smallest dwMaxPayloadTransferSize which carries a frame of frame_size bytes within interval (100 ns units),
+ *  one payload per (micro)frame. Host selects the isochronous alternate setting whose packet size covers it. */
+static uint_fast32_t _payload_size(videod_streaming_interface_t const *stm, uint_fast32_t frame_size, uint_fast32_t interval)
+{
+  uint_fast32_t const period = (TUSB_SPEED_HIGH == tud_speed_get()) ? 1250 : 10000; /* (micro)frame in 100 ns */
+  uint_fast32_t const n_payloads = interval / period;
+  uint_fast32_t payload_size = VIDEOD_PAYLOAD_HDR_MAX;
+  payload_size += n_payloads ? (frame_size + n_payloads - 1) / n_payloads : frame_size;
+  if (_max_payload_size(stm) < payload_size) {
+    payload_size = _max_payload_size(stm);
+  }
+  return payload_size;
+}
+
 /** Set uniquely determined values to variables that have not been set
  *
  * @param[in,out] param       Target */
@@ -462,6 +621,7 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
       break;
 
     case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+    case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
       break;
 
     default: return false;
@@ -480,37 +640,22 @@ static bool _update_streaming_parameters(videod_streaming_interface_t const *stm
   /* Set the parameters determined by the frame  */
   uint_fast32_t frame_size = param->dwMaxVideoFrameSize;
   if (!frame_size) {
-    switch (fmt->bDescriptorSubType) {
-      case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
-        break;
-
-      case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
-        break;
-
-      default: break;
-    }
+    frame_size = _get_max_frame_size(fmt, frm);
     param->dwMaxVideoFrameSize = frame_size;
   }
 
   uint_fast32_t interval = param->dwFrameInterval;
   if (!interval) {
-    if ((1 < frm->uncompressed.bFrameIntervalType) ||
-        ((0 == frm->uncompressed.bFrameIntervalType) &&
-         (frm->uncompressed.dwFrameInterval[1] != frm->uncompressed.dwFrameInterval[0]))) {
+    uint_fast8_t const num_intervals = _get_frame_interval_type(frm);
+    if ((1 < num_intervals) ||
+        ((0 == num_intervals) && (_get_frame_interval(frm, 1) != _get_frame_interval(frm, 0)))) {
       return true;
     }
-    interval = frm->uncompressed.dwFrameInterval[0];
+    interval = _get_frame_interval(frm, 0);
     param->dwFrameInterval = interval;
   }
-  uint_fast32_t interval_ms = interval / 10000;
-  TU_ASSERT(interval_ms);
-  uint_fast32_t payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
-  if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-    payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
-  }
-  param->dwMaxPayloadTransferSize = payload_size;
+  TU_ASSERT(interval);
+  param->dwMaxPayloadTransferSize = _payload_size(stm, frame_size, interval);
   return true;
 }
 
@@ -578,6 +723,10 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
             frmnum = fmt->mjpeg.bDefaultFrameIndex;
             break;
 
+          case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+            frmnum = fmt->frame_based.bDefaultFrameIndex;
+            break;
+
           default: return false;
         }
         break;
@@ -586,18 +735,8 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     param->bFrameIndex = (uint8_t)frmnum;
     /* Set the parameters determined by the frame */
     tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
-    uint_fast32_t frame_size;
-    switch (fmt->bDescriptorSubType) {
-      case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * fmt->uncompressed.bBitsPerPixel / 8;
-        break;
-
-      case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
-        frame_size = (uint_fast32_t)frm->wWidth * frm->wHeight * 16 / 8; /* YUV422 */
-        break;
-
-      default: return false;
-    }
+    uint_fast32_t const frame_size = _get_max_frame_size(fmt, frm);
+    if (!frame_size) return false;
     param->dwMaxVideoFrameSize = frame_size;
     return true;
   }
@@ -609,42 +748,42 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     tusb_desc_cs_video_fmt_t const *fmt = _find_desc_format(tu_desc_next(vs), end, fmtnum);
     tusb_desc_cs_video_frm_t const *frm = _find_desc_frame(tu_desc_next(fmt), end, frmnum);
 
-    uint_fast32_t interval, interval_ms;
+    /* payload_interval is the frame interval the payload size is computed for, i.e. the shortest one for GET_MAX */
+    uint_fast32_t interval, payload_interval;
     switch (request) {
       case VIDEO_REQUEST_GET_MAX: {
         uint_fast32_t min_interval, max_interval;
-        uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
-        max_interval = num_intervals ? frm->uncompressed.dwFrameInterval[num_intervals - 1]: frm->uncompressed.dwFrameInterval[1];
-        min_interval = frm->uncompressed.dwFrameInterval[0];
+        uint_fast8_t num_intervals = _get_frame_interval_type(frm);
+        max_interval = _get_frame_interval(frm, num_intervals ? num_intervals - 1 : 1);
+        min_interval = _get_frame_interval(frm, 0);
         interval = max_interval;
-        interval_ms = min_interval / 10000;
+        payload_interval = min_interval;
         break;
       }
 
       case VIDEO_REQUEST_GET_MIN: {
         uint_fast32_t min_interval, max_interval;
-        uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
-        max_interval = num_intervals ? frm->uncompressed.dwFrameInterval[num_intervals - 1]: frm->uncompressed.dwFrameInterval[1];
-        min_interval = frm->uncompressed.dwFrameInterval[0];
+        uint_fast8_t num_intervals = _get_frame_interval_type(frm);
+        max_interval = _get_frame_interval(frm, num_intervals ? num_intervals - 1 : 1);
+        min_interval = _get_frame_interval(frm, 0);
         interval = min_interval;
-        interval_ms = max_interval / 10000;
+        payload_interval = max_interval;
         break;
       }
 
       case VIDEO_REQUEST_GET_DEF:
-        interval = frm->uncompressed.dwDefaultFrameInterval;
-        interval_ms = interval / 10000;
+        interval = _get_default_frame_interval(frm);
+        payload_interval = interval;
         break;
 
       case VIDEO_REQUEST_GET_RES: {
-        uint_fast8_t num_intervals = frm->uncompressed.bFrameIntervalType;
+        uint_fast8_t num_intervals = _get_frame_interval_type(frm);
         if (num_intervals) {
           interval = 0;
-          interval_ms = 0;
         } else {
-          interval = frm->uncompressed.dwFrameInterval[2];
-          interval_ms = interval / 10000;
+          interval = _get_frame_interval(frm, 2);
         }
+        payload_interval = interval;
         break;
       }
 
@@ -654,17 +793,7 @@ static bool _negotiate_streaming_parameters(videod_streaming_interface_t const *
     if (!interval) {
       param->dwMaxPayloadTransferSize = 0;
     } else {
-      uint_fast32_t frame_size = param->dwMaxVideoFrameSize;
-      uint_fast32_t payload_size;
-      if (!interval_ms) {
-        payload_size = frame_size + 2;
-      } else {
-        payload_size = (frame_size + interval_ms - 1) / interval_ms + 2;
-      }
-      if (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE < payload_size) {
-        payload_size = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE;
-      }
-      param->dwMaxPayloadTransferSize = payload_size;
+      param->dwMaxPayloadTransferSize = _payload_size(stm, param->dwMaxVideoFrameSize, payload_interval);
     }
     return true;
   }
@@ -770,10 +899,19 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   }
 #endif
 
-  /* clear transfer management information */
-  stm->buffer  = NULL;
-  stm->bufsize = 0;
-  stm->offset  = 0;
+  /* clear transfer management information, drop queued frames */
+  stm->buffer   = NULL;
+  stm->bufsize  = 0;
+  stm->offset   = 0;
+  stm->queue_rd = stm->queue_wr;
+  stm->payload_remaining = 0;
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  /* transfer on isochronous endpoint is aborted by closing it */
+  if (stm->xfer_busy && !stm->bulk_mps) _release_ep_buf(stm);
+  /* first frame is due right away */
+  stm->frame_start = _videod_sched.now - stm->probe_commit_payload.dwFrameInterval;
+#endif
+  stm->bulk_mps = 0;
 
   /* Find a alternate interface */
   uint8_t const *beg = desc + stm->desc.beg;
@@ -794,8 +932,8 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
     tusb_desc_endpoint_t const *ep = (tusb_desc_endpoint_t const*)cur;
     uint_fast32_t max_size = stm->max_payload_transfer_size;
     if (altnum && (TUSB_XFER_ISOCHRONOUS == ep->bmAttributes.xfer)) {
-      /* FS must be less than or equal to max packet size */
-      TU_VERIFY (tu_edpt_packet_size(ep) >= max_size);
+      /* FS must be less than or equal to max packet size (including additional transactions of high-bandwidth EP) */
+      TU_VERIFY (tu_edpt_max_payload(ep) >= max_size);
 #ifdef TUP_DCD_EDPT_ISO_ALLOC
       usbd_edpt_iso_activate(rhport, ep);
 #else
@@ -804,6 +942,7 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
     } else {
       TU_VERIFY(TUSB_XFER_BULK == ep->bmAttributes.xfer);
       TU_ASSERT(usbd_edpt_open(rhport, ep));
+      if (!i) stm->bulk_mps = tu_edpt_packet_size(ep);
     }
     stm->desc.ep[i] = (uint16_t) (cur - desc);
     TU_LOG_DRV("    open EP%02x\r\n", _desc_ep_addr(cur));
@@ -815,25 +954,122 @@ static bool _open_vs_itf(uint8_t rhport, videod_streaming_interface_t *stm, uint
   return true;
 }
 
-/** Prepare the next packet payload. */
+/** Return STC derived from SOF count in units of dwClockFrequency, and 11-bit frame number of the last SOF */
+static uint32_t _get_stc(videod_streaming_interface_t const *stm, uint16_t *frame)
+{
+  uint32_t ms;
+  do {
+    ms     = _videod_sof.ms;
+    *frame = _videod_sof.frame;
+  } while (ms != _videod_sof.ms);
+  return ms * (stm->probe_commit_payload.dwClockFrequency / 1000);
+}
+
+/** Write SCR (STC and frame number) of the last SOF */
+static void _write_scr_from_sof(videod_streaming_interface_t const *stm, uint8_t *dst)
+{
+  uint16_t frame;
+  uint32_t const stc = _get_stc(stm, &frame);
+  tu_unaligned_write32(&dst[0], tu_htole32(stc));
+  tu_unaligned_write16(&dst[4], tu_htole16(frame));
+}
+
+/** Copy the next part of the frame, from frame buffer or application */
+static uint_fast16_t _copy_frame_data(videod_streaming_interface_t *stm, uint8_t *dst, uint_fast16_t len)
+{
+  if (stm->buffer) {
+    memcpy(dst, stm->buffer + stm->offset, len);
+  } else {
+    /* ask application for the next part of the frame, fewer bytes just result in a shorter payload */
+    uint_fast16_t n = tud_video_frame_xfer_data_cb(stm->index_vc, stm->index_vs, stm->offset, dst, (uint16_t) len);
+    if (n < len) len = n;
+  }
+  stm->offset += len;
+  return len;
+}
+
+/** Prepare the next transfer in EP buffer.
+ *  Bulk streaming puts several full payloads into one transfer if dwMaxPayloadTransferSize is a multiple of the
+ *  packet size, or only the first part of a payload larger than EP buffer (see _prepare_in_payload_remaining()). */
 static uint_fast16_t _prepare_in_payload(videod_streaming_interface_t *stm)
 {
-  uint_fast16_t remaining = stm->bufsize - stm->offset;
-  uint_fast16_t hdr_len   = stm->ep_buf[0];
-  uint_fast16_t pkt_len   = stm->max_payload_transfer_size;
-  if (hdr_len + remaining < pkt_len) {
-    pkt_len = hdr_len + remaining;
+  uint_fast16_t const hdr_len     = stm->payload_hdr[0];
+  uint_fast32_t const max_payload = stm->max_payload_transfer_size;
+  bool const can_pack = stm->bulk_mps && !(max_payload % stm->bulk_mps);
+  uint_fast16_t xfer_len = 0;
+
+  for (;;) {
+    uint8_t *payload = &VIDEOD_EP_BUF(stm)[xfer_len];
+    uint_fast32_t remaining = stm->bufsize - stm->offset;
+    uint_fast32_t payload_len = max_payload;
+    if (hdr_len + remaining < payload_len) {
+      payload_len = hdr_len + remaining;
+    }
+    TU_ASSERT(payload_len >= hdr_len);
+
+    /* part of payload placed into EP buffer */
+    uint_fast32_t part_len = payload_len;
+    if (part_len > CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE - xfer_len) {
+      TU_ASSERT(stm->bulk_mps && !xfer_len && CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE >= stm->bulk_mps);
+#if CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY
+      /* first packet carries the header, the rest is sent from frame buffer */
+      part_len = stm->buffer ? stm->bulk_mps : CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE / stm->bulk_mps * stm->bulk_mps;
+#else
+      part_len = CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE / stm->bulk_mps * stm->bulk_mps;
+#endif
+      stm->payload_remaining = payload_len - part_len;
+    }
+
+    if (stm->scr_from_sof) _write_scr_from_sof(stm, &stm->payload_hdr[6]);
+    memcpy(payload, stm->payload_hdr, hdr_len);
+    uint_fast16_t data_len = (uint_fast16_t) (part_len - hdr_len);
+    uint_fast16_t n = _copy_frame_data(stm, &payload[hdr_len], data_len);
+    if (n < data_len) {
+      /* payload ends here */
+      stm->payload_remaining = 0;
+      payload_len = hdr_len + n;
+      part_len = payload_len;
+    }
+    if (payload_len - hdr_len == remaining) {
+      ((tusb_video_payload_header_t*)payload)->EndOfFrame = 1;
+    }
+    xfer_len += (uint_fast16_t) part_len;
+
+    /* all payloads but the last one of a transfer must have the full size */
+    if (!can_pack || payload_len != max_payload || stm->offset >= stm->bufsize ||
+        xfer_len + max_payload > CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE) {
+      break;
+    }
   }
-  TU_ASSERT(pkt_len >= hdr_len);
-  uint_fast16_t data_len = pkt_len - hdr_len;
-  memcpy(&stm->ep_buf[hdr_len], stm->buffer + stm->offset, data_len);
-  stm->offset += data_len;
-  remaining -= data_len;
-  if (!remaining) {
-    tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
-    hdr->EndOfFrame = 1;
+  return xfer_len;
+}
+
+/** Prepare the remaining part of a bulk payload larger than EP buffer, return pointer to data */
+static uint8_t* _prepare_in_payload_remaining(videod_streaming_interface_t *stm, uint_fast16_t *len)
+{
+  uint_fast32_t part_len = stm->payload_remaining;
+  uint8_t *ptr;
+#if CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY
+  if (stm->buffer) {
+    /* straight from frame buffer */
+    part_len = tu_min32(part_len, UINT16_MAX / stm->bulk_mps * stm->bulk_mps);
+    ptr = stm->buffer + stm->offset;
+    stm->offset += part_len;
+  } else
+#endif
+  {
+    part_len = tu_min32(part_len, CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE / stm->bulk_mps * stm->bulk_mps);
+    ptr = VIDEOD_EP_BUF(stm);
+    uint_fast16_t n = _copy_frame_data(stm, ptr, (uint_fast16_t) part_len);
+    if (n < part_len) {
+      /* payload ends here */
+      stm->payload_remaining = n;
+      part_len = n;
+    }
   }
-  return hdr_len + data_len;
+  stm->payload_remaining -= part_len;
+  *len = (uint_fast16_t) part_len;
+  return ptr;
 }
 
 /** Handle a standard request to the video control interface. */
@@ -1096,12 +1332,13 @@ static int handle_video_stm_cs_req(uint8_t rhport, uint8_t stage,
               ret = tud_video_commit_cb(self->index_vc, self->index_vs, param);
             }
             if (VIDEO_ERROR_NONE == ret) {
-              self->state   = VS_STATE_COMMITTED;
-              self->buffer  = NULL;
-              self->bufsize = 0;
-              self->offset  = 0;
+              self->state    = VS_STATE_COMMITTED;
+              self->buffer   = NULL;
+              self->bufsize  = 0;
+              self->offset   = 0;
+              self->queue_rd = self->queue_wr;
               /* initialize payload header */
-              tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)self->ep_buf;
+              tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)self->payload_hdr;
               hdr->bHeaderLength = sizeof(*hdr);
               hdr->bmHeaderInfo  = 0;
             }
@@ -1199,14 +1436,129 @@ bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
   return true;
 }
 
-bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+/** Take the next queued frame for transfer and set up its payload header */
+static void _load_next_frame(videod_streaming_interface_t *stm)
 {
-  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
-  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
-  if (!buffer || !bufsize) return false;
-  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
-  if (!stm || !stm->desc.ep[0] || stm->buffer) return false;
-  if (stm->state == VS_STATE_PROBING) return false;
+  videod_frame_t const *frame = &stm->queue[stm->queue_rd % VIDEOD_FRAME_QUEUE_LEN];
+
+  /* update the packet header */
+  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->payload_hdr;
+  hdr->FrameID   ^= 1;
+  hdr->EndOfFrame = 0;
+  stm->scr_from_sof = (frame->timing_mode == VIDEOD_TIMING_PTS_SOF);
+  if (frame->timing_mode != VIDEOD_TIMING_NONE) {
+    hdr->bHeaderLength        = (uint8_t) (sizeof(*hdr) + 4 + 6); /* PTS and SCR follow the header */
+    hdr->PresentationTime     = 1;
+    hdr->SourceClockReference = 1;
+    tu_unaligned_write32(&stm->payload_hdr[2], tu_htole32(frame->timing.pts));
+    tu_unaligned_write32(&stm->payload_hdr[6], tu_htole32(frame->timing.scr_stc));
+    tu_unaligned_write16(&stm->payload_hdr[10], tu_htole16(frame->timing.scr_sof & 0x7FFu));
+  } else {
+    hdr->bHeaderLength        = sizeof(*hdr);
+    hdr->PresentationTime     = 0;
+    hdr->SourceClockReference = 0;
+  }
+  /* update the packet data */
+  stm->buffer     = frame->buffer;
+  stm->bufsize    = frame->bufsize;
+  stm->queue_rd++;
+}
+
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+/** Return the shared EP buffer held by the transfer in progress, which has completed or was aborted */
+static void _release_ep_buf(videod_streaming_interface_t *stm)
+{
+  if (stm->ep_buf_idx != VIDEOD_EP_BUF_NONE) {
+    _videod_sched.busy &= ~TU_BIT(stm->ep_buf_idx);
+  }
+  stm->ep_buf_idx = VIDEOD_EP_BUF_NONE;
+  stm->xfer_busy  = 0;
+}
+
+/** Time the next payload of a stream is due, see videod_sched_t */
+static uint32_t _payload_due(videod_streaming_interface_t const *stm)
+{
+  uint32_t const interval = stm->probe_commit_payload.dwFrameInterval;
+  if (!stm->bufsize) {
+    /* next frame: one interval after the previous one, but not earlier than now */
+    uint32_t const start = stm->frame_start + interval;
+    return ((int32_t) (start - _videod_sched.now) < 0) ? _videod_sched.now : start;
+  }
+  return stm->frame_start + (uint32_t) ((uint64_t) interval * stm->offset / stm->bufsize);
+}
+
+/** Start transfers of streams waiting for a payload while shared EP buffers are free, earliest due first.
+ *  Only called from usbd task: on submission of a frame (deferred) and on completion of a transfer. */
+static void _schedule_payloads(uint8_t rhport)
+{
+  for (;;) {
+    videod_streaming_interface_t *next = NULL;
+    uint32_t next_due = 0;
+    for (uint_fast8_t i = 0; i < CFG_TUD_VIDEO_STREAMING; ++i) {
+      videod_streaming_interface_t *stm = &_videod_streaming_itf[i];
+      if (!stm->desc.ep[0] || stm->xfer_busy || _videod_itf[stm->index_vc].rhport != rhport) continue;
+      if (!stm->bufsize && stm->queue_rd == stm->queue_wr) continue;
+      uint32_t const due = _payload_due(stm);
+      if (!next || (int32_t) (due - next_due) < 0) {
+        next     = stm;
+        next_due = due;
+      }
+    }
+    if (!next) return;
+
+    /* remaining part of bulk payload sent from frame buffer needs no EP buffer */
+    bool const zero_copy = CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY && next->payload_remaining && next->buffer;
+    uint8_t ep_buf_idx = VIDEOD_EP_BUF_NONE;
+    if (!zero_copy) {
+      for (uint8_t i = 0; i < CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED; ++i) {
+        if (!(_videod_sched.busy & TU_BIT(i))) {
+          ep_buf_idx = i;
+          break;
+        }
+      }
+      if (ep_buf_idx == VIDEOD_EP_BUF_NONE) return;
+    }
+
+    uint8_t const ep_addr = _desc_ep_addr(_videod_itf[next->index_vc].beg + next->desc.ep[0]);
+    if (!usbd_edpt_claim(rhport, ep_addr)) return;
+
+    if (!next->bufsize) {
+      _load_next_frame(next);
+      next->frame_start = next_due;
+    }
+    if ((int32_t) (next_due - _videod_sched.now) > 0) _videod_sched.now = next_due;
+
+    if (ep_buf_idx != VIDEOD_EP_BUF_NONE) _videod_sched.busy |= TU_BIT(ep_buf_idx);
+    next->ep_buf_idx = ep_buf_idx;
+    next->xfer_busy  = 1;
+
+    uint8_t *ptr;
+    uint_fast16_t len;
+    if (next->payload_remaining) {
+      ptr = _prepare_in_payload_remaining(next, &len);
+    } else {
+      len = _prepare_in_payload(next);
+      ptr = VIDEOD_EP_BUF(next);
+    }
+    if (!usbd_edpt_xfer(rhport, ep_addr, ptr, (uint16_t) len)) {
+      _release_ep_buf(next);
+      TU_BREAKPOINT();
+      return;
+    }
+  }
+}
+
+static void _schedule_payloads_deferred(void *param)
+{
+  _schedule_payloads((uint8_t) (uintptr_t) param);
+}
+
+#else
+/** Start transfer of the next queued frame if no frame is in progress.
+ *  Called on submission and on completion of a frame, the endpoint claim decides which one starts the frame. */
+static bool _start_next_frame(uint8_t rhport, videod_streaming_interface_t *stm)
+{
+  if (stm->bufsize || stm->queue_rd == stm->queue_wr) return true;
 
   /* Find EP address */
   uint8_t const *desc = _videod_itf[stm->index_vc].beg;
@@ -1219,18 +1571,98 @@ bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *bu
   }
   if (!ep_addr) return false;
 
-  TU_VERIFY( usbd_edpt_claim(0, ep_addr) );
-  /* update the packet header */
-  tusb_video_payload_header_t *hdr = (tusb_video_payload_header_t*)stm->ep_buf;
-  hdr->FrameID   ^= 1;
-  hdr->EndOfFrame = 0;
-  /* update the packet data */
-  stm->buffer     = (uint8_t*)buffer;
-  stm->bufsize    = bufsize;
+  /* the other context is starting the frame */
+  if (!usbd_edpt_claim(rhport, ep_addr)) return true;
+  if (stm->bufsize || stm->queue_rd == stm->queue_wr) {
+    usbd_edpt_release(rhport, ep_addr);
+    return true;
+  }
+
+  _load_next_frame(stm);
   uint_fast16_t pkt_len = _prepare_in_payload(stm);
-  TU_ASSERT( usbd_edpt_xfer(0, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
+  TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, VIDEOD_EP_BUF(stm), (uint16_t) pkt_len), 0);
   return true;
 }
+#endif
+
+static bool _frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize,
+                        uint8_t timing_mode, tud_video_frame_timing_t const *timing)
+{
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING);
+  if (!bufsize) return false;
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  if (!stm || !stm->desc.ep[0]) return false;
+  if (stm->state == VS_STATE_PROBING) return false;
+  /* frames of compressed formats vary in size, but must not exceed the negotiated maximum */
+  uint32_t const max_frame_size = stm->probe_commit_payload.dwMaxVideoFrameSize;
+  if (max_frame_size && bufsize > max_frame_size) return false;
+
+  /* the entry of a frame in progress is already free */
+  uint8_t const n_queued = (uint8_t) (stm->queue_wr - stm->queue_rd);
+  if (n_queued >= CFG_TUD_VIDEO_FRAME_QUEUE_SIZE + (stm->bufsize ? 0 : 1)) return false;
+
+  videod_frame_t *frame = &stm->queue[stm->queue_wr % VIDEOD_FRAME_QUEUE_LEN];
+  frame->buffer     = (uint8_t*)buffer;
+  frame->bufsize    = bufsize;
+  frame->timing_mode = timing_mode;
+  if (timing) frame->timing = *timing;
+  stm->queue_wr++;
+
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  /* shared EP buffers are only handed out in usbd task */
+  usbd_defer_func(_schedule_payloads_deferred, (void*) (uintptr_t) _videod_itf[stm->index_vc].rhport, false);
+  return true;
+#else
+  return _start_next_frame(_videod_itf[stm->index_vc].rhport, stm);
+#endif
+}
+
+bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize)
+{
+  if (!buffer) return false;
+  return _frame_xfer(ctl_idx, stm_idx, buffer, bufsize, VIDEOD_TIMING_NONE, NULL);
+}
+
+bool tud_video_n_frame_xfer_stream(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, size_t frame_size)
+{
+  if (!tud_video_frame_xfer_data_cb) return false;
+  return _frame_xfer(ctl_idx, stm_idx, NULL, frame_size, VIDEOD_TIMING_NONE, NULL);
+}
+
+bool tud_video_n_frame_xfer_timed(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize,
+                                  tud_video_frame_timing_t const *timing)
+{
+  if (!timing) return false;
+  if (!buffer && !tud_video_frame_xfer_data_cb) return false;
+  return _frame_xfer(ctl_idx, stm_idx, buffer, bufsize, VIDEOD_TIMING_APP, timing);
+}
+
+bool tud_video_n_frame_xfer_pts(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize,
+                                uint32_t pts)
+{
+  if (!buffer && !tud_video_frame_xfer_data_cb) return false;
+  if (!_videod_sof.enabled) {
+    _videod_sof.enabled = true;
+    usbd_sof_subscribe(_videod_itf[ctl_idx].rhport, videod_sof, 1);
+  }
+  tud_video_frame_timing_t const timing = { .pts = pts, .scr_stc = 0, .scr_sof = 0 };
+  return _frame_xfer(ctl_idx, stm_idx, buffer, bufsize, VIDEOD_TIMING_PTS_SOF, &timing);
+}
+
+uint32_t tud_video_n_get_stc(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
+{
+  TU_ASSERT(ctl_idx < CFG_TUD_VIDEO, 0);
+  TU_ASSERT(stm_idx < CFG_TUD_VIDEO_STREAMING, 0);
+  videod_streaming_interface_t *stm = _get_instance_streaming(ctl_idx, stm_idx);
+  TU_VERIFY(stm, 0);
+  if (!_videod_sof.enabled) {
+    _videod_sof.enabled = true;
+    usbd_sof_subscribe(_videod_itf[ctl_idx].rhport, videod_sof, 1);
+  }
+  uint16_t frame;
+  return _get_stc(stm, &frame);
+}
 
 //--------------------------------------------------------------------+
 // USBD Driver API
@@ -1244,6 +1676,9 @@ void videod_init(void) {
     videod_streaming_interface_t *stm = &_videod_streaming_itf[i];
     tu_memclr(stm, ITF_STM_MEM_RESET_SIZE);
   }
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  tu_memclr(&_videod_sched, sizeof(_videod_sched));
+#endif
 }
 
 bool videod_deinit(void) {
@@ -1260,6 +1695,19 @@ void videod_reset(uint8_t rhport) {
     videod_streaming_interface_t *stm = &_videod_streaming_itf[i];
     tu_memclr(stm, ITF_STM_MEM_RESET_SIZE);
   }
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  tu_memclr(&_videod_sched, sizeof(_videod_sched));
+#endif
+  // SOF subscription is dropped by usbd on reset
+  _videod_sof.enabled = false;
+}
+
+void videod_sof(uint8_t rhport, uint32_t frame_count) {
+  (void) rhport;
+  /* extend the 11-bit frame number, which is repeated in the microframes of high speed */
+  uint16_t const frame = (uint16_t) (frame_count & 0x7FFu);
+  _videod_sof.ms   += (uint16_t) (frame - _videod_sof.frame) & 0x7FFu;
+  _videod_sof.frame = frame;
 }
 
 uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len) {
@@ -1280,6 +1728,7 @@ uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
   uint8_t const *end = (uint8_t const*)itf_desc + max_len;
   self->beg = (uint8_t const*) itf_desc;
   self->len = max_len;
+  self->rhport = rhport;
 
   /*------------- Video Control Interface -------------*/
   TU_VERIFY(_open_vc_itf(rhport, self, 0), 0);
@@ -1315,7 +1764,7 @@ uint16_t videod_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uin
         tusb_desc_endpoint_t const *desc_ep = (tusb_desc_endpoint_t const *) p_desc;
         if (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
               ep_addr = desc_ep->bEndpointAddress;
-              ep_size = TU_MAX(tu_edpt_packet_size(desc_ep), ep_size);
+              ep_size = TU_MAX(tu_edpt_max_payload(desc_ep), ep_size);
         }
       }
       p_desc = tu_desc_next(p_desc);
@@ -1394,11 +1843,32 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
   }
 
   TU_ASSERT(itf < CFG_TUD_VIDEO_STREAMING);
-  if (stm->offset < stm->bufsize) {
+#if CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+  /* stale completion of a transfer already released on closing the stream */
+  if (!stm->xfer_busy) return true;
+  _release_ep_buf(stm);
+  if (!stm->payload_remaining && stm->offset >= stm->bufsize) {
+    stm->buffer  = NULL;
+    stm->bufsize = 0;
+    stm->offset  = 0;
+    if (tud_video_frame_xfer_complete_cb) {
+      tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
+    }
+  }
+  /* this stream and any other waiting for an EP buffer */
+  _schedule_payloads(rhport);
+#else
+  if (stm->payload_remaining) {
+    /* Claim the endpoint */
+    TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
+    uint_fast16_t len;
+    uint8_t *ptr = _prepare_in_payload_remaining(stm, &len);
+    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, ptr, (uint16_t) len), 0);
+  } else if (stm->offset < stm->bufsize) {
     /* Claim the endpoint */
     TU_VERIFY( usbd_edpt_claim(rhport, ep_addr), 0);
     uint_fast16_t pkt_len = _prepare_in_payload(stm);
-    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, stm->ep_buf, (uint16_t) pkt_len), 0);
+    TU_ASSERT( usbd_edpt_xfer(rhport, ep_addr, VIDEOD_EP_BUF(stm), (uint16_t) pkt_len), 0);
   } else {
     stm->buffer  = NULL;
     stm->bufsize = 0;
@@ -1406,7 +1876,10 @@ bool videod_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint3
     if (tud_video_frame_xfer_complete_cb) {
       tud_video_frame_xfer_complete_cb(stm->index_vc, stm->index_vs);
     }
+    /* next frame starts right after end of the previous one */
+    TU_ASSERT(_start_next_frame(rhport, stm));
   }
+#endif
   return true;
 }
 
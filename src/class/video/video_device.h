@@ -35,6 +35,33 @@
 extern "C" {
 #endif
 
+// Number of frames which can be submitted while a frame is being transferred, they are started right after the
+// end of the previous frame. 0 means only one frame can be submitted at a time.
+#ifndef CFG_TUD_VIDEO_FRAME_QUEUE_SIZE
+#define CFG_TUD_VIDEO_FRAME_QUEUE_SIZE 0
+#endif
+
+// Bulk streaming: allow payloads (dwMaxPayloadTransferSize) larger than CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE. Only the
+// header and first packet of a payload go through the EP buffer, the rest is sent directly from the frame buffer,
+// which must therefore be accessible by the USB controller (e.g DMA capable memory).
+#ifndef CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY
+#define CFG_TUD_VIDEO_STREAMING_BULK_ZERO_COPY 0
+#endif
+
+// Number of EP buffers (CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE each) shared by all streaming interfaces instead of one per
+// interface. Payloads of concurrent streams are then prepared earliest deadline first according to their frame
+// interval, so that each stream keeps its frame rate. 0: each streaming interface has its own EP buffer.
+#ifndef CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED
+#define CFG_TUD_VIDEO_STREAMING_EP_BUF_SHARED 0
+#endif
+
+/* Timing information of a frame, see UVC 1.5 2.4.3.3 Video and Still Image Payload Headers */
+typedef struct {
+  uint32_t pts;     /* Presentation time stamp in units of dwClockFrequency */
+  uint32_t scr_stc; /* Source clock reference: source time clock in units of dwClockFrequency */
+  uint16_t scr_sof; /* Source clock reference: 11-bit USB SOF token counter */
+} tud_video_frame_timing_t;
+
 //--------------------------------------------------------------------+
 // Application API (Multiple Ports)
 // CFG_TUD_VIDEO > 1
@@ -47,20 +74,74 @@ extern "C" {
 bool tud_video_n_streaming(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
 /** Transfer a frame
+ *
+ * If a frame is being transferred, the frame is queued when CFG_TUD_VIDEO_FRAME_QUEUE_SIZE allows it.
  *
  * @param[in] ctl_idx    Destination control interface index
  * @param[in] stm_idx    Destination streaming interface index
  * @param[in] buffer     Frame buffer. The caller must not use this buffer until the operation is completed.
- * @param[in] bufsize    Byte size of the frame buffer */
+ * @param[in] bufsize    Byte size of the frame buffer
+ * @return false if frame can not be submitted e.g. queue is full */
 bool tud_video_n_frame_xfer(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize);
 
+/** Transfer a frame with presentation time and source clock reference in its payload headers
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] buffer     Frame buffer, NULL if data is provided by tud_video_frame_xfer_data_cb()
+ * @param[in] bufsize    Byte size of the frame
+ * @param[in] timing     PTS and SCR of the frame */
+bool tud_video_n_frame_xfer_timed(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize,
+                                  tud_video_frame_timing_t const *timing);
+
+/** Transfer a frame with presentation time: SCR of its payload headers is derived from the SOF count
+ *
+ * Suitable for compressed (MJPEG, frame based) formats whose frames vary in size up to dwMaxVideoFrameSize.
+ * The PTS should be in the clock returned by tud_video_n_get_stc(), e.g. the STC when capture of the frame started.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] buffer     Frame buffer, NULL if data is provided by tud_video_frame_xfer_data_cb()
+ * @param[in] bufsize    Byte size of this frame
+ * @param[in] pts        Presentation time stamp in units of dwClockFrequency */
+bool tud_video_n_frame_xfer_pts(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, void *buffer, size_t bufsize,
+                                uint32_t pts);
+
+/** Return the source time clock derived from the SOF count in units of dwClockFrequency
+ *
+ * The SOF interrupt is enabled on first use, the clock does not advance while the bus is suspended.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index */
+uint32_t tud_video_n_get_stc(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
+
+/** Transfer a frame whose data is provided piecewise by tud_video_frame_xfer_data_cb()
+ *
+ * No frame buffer is required, e.g. a frame can be rendered or captured line by line into the packet buffer.
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] frame_size Byte size of the frame */
+bool tud_video_n_frame_xfer_stream(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, size_t frame_size);
+
 /*------------- Optional callbacks -------------*/
-/** Invoked when compeletion of a frame transfer
+/** Invoked when compeletion of a frame transfer, queued frames are completed in order of submission
  *
  * @param[in] ctl_idx    Destination control interface index
  * @param[in] stm_idx    Destination streaming interface index */
 TU_ATTR_WEAK void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx);
 
+/** Invoked when the next part of a frame started by tud_video_n_frame_xfer_stream() is needed for a payload
+ *
+ * @param[in] ctl_idx    Destination control interface index
+ * @param[in] stm_idx    Destination streaming interface index
+ * @param[in] offset     Byte offset of requested data within the frame
+ * @param[out] buffer    Destination to copy frame data to
+ * @param[in] len        Number of bytes requested, at most the remaining size of the frame
+ * @return Number of bytes copied. Fewer bytes than requested result in a shorter payload. */
+TU_ATTR_WEAK uint16_t tud_video_frame_xfer_data_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, size_t offset,
+                                                   void *buffer, uint16_t len);
+
 //--------------------------------------------------------------------+
 // Application Callback API (weak is optional)
 //--------------------------------------------------------------------+
@@ -90,6 +171,7 @@ void     videod_reset          (uint8_t rhport);
 uint16_t videod_open           (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     videod_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     videod_xfer_cb        (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     videod_sof            (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
@@ -169,6 +169,13 @@
     #define TU_BSWAP32(u32) (__builtin_bswap32(u32))
   #endif
 
+  // Full memory barrier for both compiler and CPU (other core), used by lock-free single producer single consumer
+  #if defined(__XC16)
+    #define TU_MEMORY_BARRIER()         __asm__ volatile ("" ::: "memory")
+  #else
+    #define TU_MEMORY_BARRIER()         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+  #endif
+
 	#ifndef __ARMCC_VERSION
   // List of obsolete callback function that is renamed and should not be defined.
   // Put it here since only gcc support this pragma
@@ -230,6 +237,8 @@
   #define TU_BSWAP16(u16) (__iar_builtin_REV16(u16))
   #define TU_BSWAP32(u32) (__iar_builtin_REV(u32))
 
+  #define TU_MEMORY_BARRIER()           __DMB()
+
 #elif defined(__CCRX__)
   #define TU_ATTR_ALIGNED(Bytes)
   #define TU_ATTR_SECTION(sec_name)
@@ -134,6 +134,55 @@ static inline const char* tu_lookup_find(tu_lookup_table_t const* p_table, uint3
 
 // TODO replace all TU_LOGn with TU_LOG(n)
 
+//--------------------------------------------------------------------+
+// Trace (CFG_TUSB_TRACE)
+// Binary records in a RAM ring, decoded on host by tools/trace_decode.py
+//--------------------------------------------------------------------+
+
+enum {
+  TU_TRACE_NONE = 0,       // free slot
+  TU_TRACE_DCD_EVENT,      // dcd_event_handler() in ISR: ep_addr, arg = event id, value = xferred bytes
+  TU_TRACE_USBD_TASK,      // usbd task dispatches event: ep_addr (xfer complete), arg = event id
+  TU_TRACE_USBD_XFER,      // usbd_edpt_xfer() submits transfer: value = bytes
+  TU_TRACE_USBD_CLASS_CB,  // class driver xfer_cb() is invoked: arg = result, value = xferred bytes
+  TU_TRACE_USBD_CLASS_END, // class driver xfer_cb() returns
+  TU_TRACE_USBD_CONTROL,   // control request: ep_addr = recipient, arg = bRequest, value = wLength
+  TU_TRACE_HCD_EVENT,      // hcd_event_handler() in ISR: ep_addr, arg = event id, value = xferred bytes
+  TU_TRACE_USBH_TASK,      // usbh task dispatches event: ep_addr (xfer complete), arg = event id
+  TU_TRACE_USBH_XFER,      // usbh_edpt_xfer() submits transfer: ep_addr, arg = device address, value = bytes
+  TU_TRACE_USBH_CLASS_CB,  // host class driver xfer_cb() is invoked: arg = result, value = xferred bytes
+  TU_TRACE_USBH_CLASS_END, // host class driver xfer_cb() returns
+  TU_TRACE_USER = 0x80     // first id for application records, added with TU_TRACE()
+};
+
+typedef struct {
+  uint32_t timestamp; // tusb_trace_timestamp_cb()
+  uint8_t  id;
+  uint8_t  rhport;
+  uint8_t  ep_addr;
+  uint8_t  arg;
+  uint32_t value;
+} tu_trace_rec_t;
+
+#if CFG_TUSB_TRACE
+  #define TU_TRACE(_id, _rhport, _ep_addr, _arg, _value) \
+    tu_trace_record(_id, _rhport, _ep_addr, (uint8_t) (_arg), (uint32_t) (_value))
+#else
+  #define TU_TRACE(_id, _rhport, _ep_addr, _arg, _value)
+#endif
+
+// Add a record, can be called from any context
+void tu_trace_record(uint8_t id, uint8_t rhport, uint8_t ep_addr, uint8_t arg, uint32_t value);
+
+// Take up to count oldest records out of ring, return number of records read. Single reader only
+uint32_t tusb_trace_read(tu_trace_rec_t* rec, uint32_t count);
+
+// Number of records lost since ring was full
+uint32_t tusb_trace_dropped(void);
+
+// Invoked to get timestamp of a record, e.g cycle counter (DWT->CYCCNT) or microsecond timer. Must be ISR-safe
+uint32_t tusb_trace_timestamp_cb(void);
+
 #define TU_LOG0(...)
 #define TU_LOG0_MEM(...)
 #define TU_LOG0_BUF(...)
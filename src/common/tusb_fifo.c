@@ -55,6 +55,13 @@ TU_ATTR_ALWAYS_INLINE static inline void _ff_unlock(osal_mutex_t mutex)
 
 #endif
 
+// an async (DMA) transfer owns the write (read) side of fifo until it completes
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+  #define _ff_dma_busy(_job)   ((_job).busy)
+#else
+  #define _ff_dma_busy(_job)   false
+#endif
+
 /** \enum tu_fifo_copy_mode_t
  * \brief Write modes intended to allow special read and write functions to be able to
  *        copy data to and from USB hardware FIFOs as needed for e.g. STM32s and others
@@ -67,12 +74,12 @@ typedef enum
 #endif
 } tu_fifo_copy_mode_t;
 
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_size_t depth, uint16_t item_size, bool overwritable)
 {
   // Limit index space to 2*depth - this allows for a fast "modulo" calculation
-  // but limits the maximum depth to 2^16/2 = 2^15 and buffer overflows are detectable
+  // but limits the maximum depth to half of index space e.g 2^15 and buffer overflows are detectable
   // only if overflow happens once (important for unsupervised DMA applications)
-  if (depth > 0x8000) return false;
+  if (depth > TU_FIFO_DEPTH_MAX) return false;
 
   _ff_lock(f->mutex_wr);
   _ff_lock(f->mutex_rd);
@@ -83,6 +90,16 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   f->overwritable = overwritable;
   f->rd_idx       = 0;
   f->wr_idx       = 0;
+#if CFG_TUSB_FIFO_MPSC
+  f->mpsc_state   = 0;
+#endif
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  f->dropped      = 0;
+#endif
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+  f->dma_wr.busy  = false;
+  f->dma_rd.busy  = false;
+#endif
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
@@ -98,20 +115,101 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
 // Intended to be used to read from hardware USB FIFO in e.g. STM32 where all data is read from a constant address
 // Code adapted from dcd_synopsys.c
 // TODO generalize with configurable 1 byte or 4 byte each read
-static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t len)
+
+// Cores that cannot store unaligned words natively (tu_unaligned_write32 falls back to byte access) merge
+// consecutive register words with shifts, so the fifo buffer is still written with aligned word stores.
+#if (TUP_ARCH_STRICT_ALIGN || TUP_MCU_STRICT_ALIGN) && (TU_BYTE_ORDER == TU_LITTLE_ENDIAN)
+  #define TU_FIFO_CST_SHIFT_MERGE 1
+#else
+  #define TU_FIFO_CST_SHIFT_MERGE 0
+#endif
+
+TU_ATTR_FAST_FUNC static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, tu_fifo_size_t len)
 {
   volatile const uint32_t * reg_rx = (volatile const uint32_t *) app_buf;
 
   // Reading full available 32 bit words from const app address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+  tu_fifo_size_t full_words = len >> 2;
+  uint8_t const bytes_rem = len & 0x03;
+
+  uint8_t const offset = (uint8_t) (((uintptr_t) ff_buf) & 0x03u);
+
+  if ( offset == 0 )
   {
-    tu_unaligned_write32(ff_buf, *reg_rx);
-    ff_buf += 4;
+    // Word aligned buffer: 4 words per loop iteration
+    uint32_t* ff_buf32 = (uint32_t*) (uintptr_t) ff_buf;
+
+    while ( full_words >= 4 )
+    {
+      ff_buf32[0] = *reg_rx;
+      ff_buf32[1] = *reg_rx;
+      ff_buf32[2] = *reg_rx;
+      ff_buf32[3] = *reg_rx;
+      ff_buf32 += 4;
+      full_words -= 4;
+    }
+
+    while ( full_words-- ) *ff_buf32++ = *reg_rx;
+
+    ff_buf = (uint8_t*) ff_buf32;
+  }
+#if TU_FIFO_CST_SHIFT_MERGE
+  else if ( full_words )
+  {
+    uint8_t const shift_lo = (uint8_t) (offset << 3);
+    uint8_t const shift_hi = (uint8_t) (32 - shift_lo);
+
+    // Head: fill up to the next word boundary, keep the upper 'offset' bytes as carry
+    uint32_t tmp32 = *reg_rx;
+    memcpy(ff_buf, &tmp32, 4u - offset);
+    ff_buf += 4u - offset;
+    uint32_t carry = tmp32 >> shift_hi;
+
+    uint32_t* ff_buf32 = (uint32_t*) (uintptr_t) ff_buf;
+    while ( --full_words )
+    {
+      tmp32 = *reg_rx;
+      *ff_buf32++ = carry | (tmp32 << shift_lo);
+      carry = tmp32 >> shift_hi;
+    }
+    ff_buf = (uint8_t*) ff_buf32;
+
+    // Tail: carry bytes plus the remaining 1-3 bytes from one more read
+    if ( bytes_rem )
+    {
+      tmp32 = *reg_rx;
+      uint32_t const merged = carry | (tmp32 << shift_lo);
+      uint8_t const count = (uint8_t) (offset + bytes_rem);
+
+      if ( count <= 4 )
+      {
+        memcpy(ff_buf, &merged, count);
+      }
+      else
+      {
+        *((uint32_t*) (uintptr_t) ff_buf) = merged;
+        tmp32 >>= shift_hi;
+        memcpy(ff_buf + 4, &tmp32, count - 4u);
+      }
+    }
+    else
+    {
+      memcpy(ff_buf, &carry, offset);
+    }
+
+    return;
+  }
+#endif
+  else
+  {
+    while ( full_words-- )
+    {
+      tu_unaligned_write32(ff_buf, *reg_rx);
+      ff_buf += 4;
+    }
   }
 
   // Read the remaining 1-3 bytes from const app address
-  uint8_t const bytes_rem = len & 0x03;
   if ( bytes_rem )
   {
     uint32_t tmp32 = *reg_rx;
@@ -121,20 +219,73 @@ static void _ff_push_const_addr(uint8_t * ff_buf, const void * app_buf, uint16_t
 
 // Intended to be used to write to hardware USB FIFO in e.g. STM32
 // where all data is written to a constant address in full word copies
-static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t len)
+TU_ATTR_FAST_FUNC static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, tu_fifo_size_t len)
 {
   volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
   // Write full available 32 bit words to const address
-  uint16_t full_words = len >> 2;
-  while(full_words--)
+  tu_fifo_size_t full_words = len >> 2;
+  uint8_t const bytes_rem = len & 0x03;
+
+  uint8_t const offset = (uint8_t) (((uintptr_t) ff_buf) & 0x03u);
+
+  if ( offset == 0 )
+  {
+    // Word aligned buffer: 4 words per loop iteration
+    uint32_t const* ff_buf32 = (uint32_t const*) (uintptr_t) ff_buf;
+
+    while ( full_words >= 4 )
+    {
+      *reg_tx = ff_buf32[0];
+      *reg_tx = ff_buf32[1];
+      *reg_tx = ff_buf32[2];
+      *reg_tx = ff_buf32[3];
+      ff_buf32 += 4;
+      full_words -= 4;
+    }
+
+    while ( full_words-- ) *reg_tx = *ff_buf32++;
+
+    ff_buf = (uint8_t const*) ff_buf32;
+  }
+#if TU_FIFO_CST_SHIFT_MERGE
+  else if ( full_words )
+  {
+    uint8_t const shift_lo = (uint8_t) (offset << 3);
+    uint8_t const shift_hi = (uint8_t) (32 - shift_lo);
+
+    // Head: bytes up to the next word boundary
+    uint32_t carry = 0;
+    memcpy(&carry, ff_buf, 4u - offset);
+    ff_buf += 4u - offset;
+
+    // Aligned word loads, never reading past the last word of data
+    uint32_t const* ff_buf32 = (uint32_t const*) (uintptr_t) ff_buf;
+    while ( --full_words )
+    {
+      uint32_t const tmp32 = *ff_buf32++;
+      *reg_tx = carry | (tmp32 << shift_hi);
+      carry = tmp32 >> shift_lo;
+    }
+    ff_buf = (uint8_t const*) ff_buf32;
+
+    // Last full word completed by 'offset' bytes
+    uint32_t tmp32 = 0;
+    memcpy(&tmp32, ff_buf, offset);
+    *reg_tx = carry | (tmp32 << shift_hi);
+    ff_buf += offset;
+  }
+#endif
+  else
   {
-    *reg_tx = tu_unaligned_read32(ff_buf);
-    ff_buf += 4;
+    while ( full_words-- )
+    {
+      *reg_tx = tu_unaligned_read32(ff_buf);
+      ff_buf += 4;
+    }
   }
 
   // Write the remaining 1-3 bytes into const address
-  uint8_t const bytes_rem = len & 0x03;
   if ( bytes_rem )
   {
     uint32_t tmp32 = 0;
@@ -146,19 +297,19 @@ static void _ff_pull_const_addr(void * app_buf, const uint8_t * ff_buf, uint16_t
 #endif
 
 // send one item to fifo WITHOUT updating write pointer
-static inline void _ff_push(tu_fifo_t* f, void const * app_buf, uint16_t rel)
+static inline void _ff_push(tu_fifo_t* f, void const * app_buf, tu_fifo_size_t rel)
 {
   memcpy(f->buffer + (rel * f->item_size), app_buf, f->item_size);
 }
 
 // send n items to fifo WITHOUT updating write pointer
-static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static void _ff_push_n(tu_fifo_t* f, void const * app_buf, tu_fifo_size_t n, tu_fifo_size_t wr_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - wr_ptr;
-  uint16_t const wrap_count = n - lin_count;
+  tu_fifo_size_t const lin_count = f->depth - wr_ptr;
+  tu_fifo_size_t const wrap_count = n - lin_count;
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  tu_fifo_size_t lin_bytes = lin_count * f->item_size;
+  tu_fifo_size_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (wr_ptr * f->item_size);
@@ -196,7 +347,7 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         // Wrap around case
 
         // Write full words to linear part of buffer
-        uint16_t nLin_4n_bytes = lin_bytes & 0xFFFC;
+        tu_fifo_size_t nLin_4n_bytes = lin_bytes & (tu_fifo_size_t) ~0x03u;
         _ff_push_const_addr(ff_buf, app_buf, nLin_4n_bytes);
         ff_buf += nLin_4n_bytes;
 
@@ -206,18 +357,18 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
         {
           volatile const uint32_t * rx_fifo = (volatile const uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) TU_MIN(wrap_bytes, (tu_fifo_size_t) (4-rem));
           wrap_bytes -= remrem;
 
           uint32_t tmp32 = *rx_fifo;
-          uint8_t * src_u8 = ((uint8_t *) &tmp32);
+          uint8_t const * src_u8 = ((uint8_t const *) &tmp32);
 
           // Write 1-3 bytes before wrapped boundary
-          while(rem--) *ff_buf++ = *src_u8++;
+          memcpy(ff_buf, src_u8, rem);
 
           // Read more bytes to beginning to complete a word
-          ff_buf = f->buffer;
-          while(remrem--) *ff_buf++ = *src_u8++;
+          memcpy(f->buffer, src_u8 + rem, remrem);
+          ff_buf = f->buffer + remrem;
         }
         else
         {
@@ -234,19 +385,19 @@ static void _ff_push_n(tu_fifo_t* f, void const * app_buf, uint16_t n, uint16_t
 }
 
 // get one item from fifo WITHOUT updating read pointer
-static inline void _ff_pull(tu_fifo_t* f, void * app_buf, uint16_t rel)
+static inline void _ff_pull(tu_fifo_t* f, void * app_buf, tu_fifo_size_t rel)
 {
   memcpy(app_buf, f->buffer + (rel * f->item_size), f->item_size);
 }
 
 // get n items from fifo WITHOUT updating read pointer
-static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static void _ff_pull_n(tu_fifo_t* f, void* app_buf, tu_fifo_size_t n, tu_fifo_size_t rd_ptr, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t const lin_count = f->depth - rd_ptr;
-  uint16_t const wrap_count = n - lin_count; // only used if wrapped
+  tu_fifo_size_t const lin_count = f->depth - rd_ptr;
+  tu_fifo_size_t const wrap_count = n - lin_count; // only used if wrapped
 
-  uint16_t lin_bytes = lin_count * f->item_size;
-  uint16_t wrap_bytes = wrap_count * f->item_size;
+  tu_fifo_size_t lin_bytes = lin_count * f->item_size;
+  tu_fifo_size_t wrap_bytes = wrap_count * f->item_size;
 
   // current buffer of fifo
   uint8_t* ff_buf = f->buffer + (rd_ptr * f->item_size);
@@ -282,7 +433,7 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         // Wrap around case
 
         // Read full words from linear part of buffer
-        uint16_t lin_4n_bytes = lin_bytes & 0xFFFC;
+        tu_fifo_size_t lin_4n_bytes = lin_bytes & (tu_fifo_size_t) ~0x03u;
         _ff_pull_const_addr(app_buf, ff_buf, lin_4n_bytes);
         ff_buf += lin_4n_bytes;
 
@@ -292,18 +443,18 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
         {
           volatile uint32_t * reg_tx = (volatile uint32_t *) app_buf;
 
-          uint8_t remrem = (uint8_t) tu_min16(wrap_bytes, 4-rem);
+          uint8_t remrem = (uint8_t) TU_MIN(wrap_bytes, (tu_fifo_size_t) (4-rem));
           wrap_bytes -= remrem;
 
           uint32_t tmp32=0;
           uint8_t * dst_u8 = (uint8_t *)&tmp32;
 
           // Read 1-3 bytes before wrapped boundary
-          while(rem--) *dst_u8++ = *ff_buf++;
+          memcpy(dst_u8, ff_buf, rem);
 
           // Read more bytes from beginning to complete a word
-          ff_buf = f->buffer;
-          while(remrem--) *dst_u8++ = *ff_buf++;
+          memcpy(dst_u8 + rem, f->buffer, remrem);
+          ff_buf = f->buffer + remrem;
 
           *reg_tx = tmp32;
         }
@@ -326,25 +477,11 @@ static void _ff_pull_n(tu_fifo_t* f, void* app_buf, uint16_t n, uint16_t rd_ptr,
 // Helper
 //--------------------------------------------------------------------+
 
-// return only the index difference and as such can be used to determine an overflow i.e overflowable count
-TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_count(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
-{
-  // In case we have non-power of two depth we need a further modification
-  if (wr_idx >= rd_idx)
-  {
-    return (uint16_t) (wr_idx - rd_idx);
-  } else
-  {
-    return (uint16_t) (2*depth - (rd_idx - wr_idx));
-  }
-}
-
 // return remaining slot in fifo
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
+tu_fifo_size_t _ff_remaining(tu_fifo_size_t depth, tu_fifo_size_t wr_idx, tu_fifo_size_t rd_idx)
 {
-  uint16_t const count = _ff_count(depth, wr_idx, rd_idx);
+  tu_fifo_size_t const count = _ff_count(depth, wr_idx, rd_idx);
   return (depth > count) ? (depth - count) : 0;
 }
 
@@ -354,55 +491,36 @@ uint16_t _ff_remaining(uint16_t depth, uint16_t wr_idx, uint16_t rd_idx)
 
 // Advance an absolute index
 // "absolute" index is only in the range of [0..2*depth)
-static uint16_t advance_index(uint16_t depth, uint16_t idx, uint16_t offset)
+TU_ATTR_FAST_FUNC static tu_fifo_size_t advance_index(tu_fifo_size_t depth, tu_fifo_size_t idx, tu_fifo_size_t offset)
 {
-  // We limit the index space of p such that a correct wrap around happens
-  // Check for a wrap around or if we are in unused index space - This has to be checked first!!
-  // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx + offset);
-  if ( (idx > new_idx) || (new_idx >= 2*depth) )
-  {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx + non_used_index_space);
-  }
-
-  return new_idx;
+  return _ff_advance_index(depth, idx, offset);
 }
 
 #if 0 // not used but
 // Backward an absolute index
-static uint16_t backward_index(uint16_t depth, uint16_t idx, uint16_t offset)
+static tu_fifo_size_t backward_index(tu_fifo_size_t depth, tu_fifo_size_t idx, tu_fifo_size_t offset)
 {
   // We limit the index space of p such that a correct wrap around happens
   // Check for a wrap around or if we are in unused index space - This has to be checked first!!
   // We are exploiting the wrap around to the correct index
-  uint16_t new_idx = (uint16_t) (idx - offset);
+  tu_fifo_size_t new_idx = (tu_fifo_size_t) (idx - offset);
   if ( (idx < new_idx) || (new_idx >= 2*depth) )
   {
-    uint16_t const non_used_index_space = (uint16_t) (UINT16_MAX - (2*depth-1));
-    new_idx = (uint16_t) (new_idx - non_used_index_space);
+    tu_fifo_size_t const non_used_index_space = (tu_fifo_size_t) (TU_FIFO_SIZE_MAX - (2*depth-1));
+    new_idx = (tu_fifo_size_t) (new_idx - non_used_index_space);
   }
 
   return new_idx;
 }
 #endif
 
-// index to pointer, simply an modulo with minus.
-TU_ATTR_ALWAYS_INLINE static inline
-uint16_t idx2ptr(uint16_t depth, uint16_t idx)
-{
-  // Only run at most 3 times since index is limit in the range of [0..2*depth)
-  while ( idx >= depth ) idx -= depth;
-  return idx;
-}
-
 // Works on local copies of w
 // When an overwritable fifo is overflowed, rd_idx will be re-index so that it forms
 // an full fifo i.e _ff_count() = depth
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
+tu_fifo_size_t _ff_correct_read_index(tu_fifo_t* f, tu_fifo_size_t wr_idx)
 {
-  uint16_t rd_idx;
+  tu_fifo_size_t rd_idx;
   if ( wr_idx >= f->depth )
   {
     rd_idx = wr_idx - f->depth;
@@ -416,11 +534,33 @@ uint16_t _ff_correct_read_index(tu_fifo_t* f, uint16_t wr_idx)
   return rd_idx;
 }
 
+#if CFG_TUSB_FIFO_DROP_OLDEST
+// Make room for n (at most depth) items in an overwritable fifo by dropping the oldest ones. Read index is
+// advanced with compare-and-swap since reader moves it too, a reader still copying dropped items then retries.
+static void _ff_drop_oldest(tu_fifo_t* f, tu_fifo_size_t wr_idx, tu_fifo_size_t n)
+{
+  tu_fifo_size_t rd_idx = __atomic_load_n(&f->rd_idx, __ATOMIC_ACQUIRE);
+  while (1)
+  {
+    tu_fifo_size_t const cnt = _ff_count(f->depth, wr_idx, rd_idx);
+    if ( cnt + n <= f->depth ) return;
+
+    tu_fifo_size_t const drop = (tu_fifo_size_t) (cnt + n - f->depth);
+    if ( __atomic_compare_exchange_n(&f->rd_idx, &rd_idx, advance_index(f->depth, rd_idx, drop), false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) )
+    {
+      f->dropped += drop;
+      return;
+    }
+  }
+}
+#endif
+
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16_t rd_idx)
+static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, tu_fifo_size_t wr_idx, tu_fifo_size_t rd_idx)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_size_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return false;
@@ -432,7 +572,7 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
     cnt = f->depth;
   }
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_size_t rd_ptr = _ff_idx2ptr(f->depth, rd_idx);
 
   // Peek data
   _ff_pull(f, p_buffer, rd_ptr);
@@ -442,9 +582,9 @@ static bool _tu_fifo_peek(tu_fifo_t* f, void * p_buffer, uint16_t wr_idx, uint16
 
 // Works on local copies of w and r
 // Must be protected by mutexes since in case of an overflow read pointer gets modified
-static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint16_t wr_idx, uint16_t rd_idx, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static tu_fifo_size_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_size_t n, tu_fifo_size_t wr_idx, tu_fifo_size_t rd_idx, tu_fifo_copy_mode_t copy_mode)
 {
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_size_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
 
   // nothing to peek
   if ( cnt == 0 ) return 0;
@@ -459,7 +599,7 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   // Check if we can read something at and after offset - if too less is available we read what remains
   if ( cnt < n ) n = cnt;
 
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_size_t rd_ptr = _ff_idx2ptr(f->depth, rd_idx);
 
   // Peek data
   _ff_pull_n(f, p_buffer, n, rd_ptr, copy_mode);
@@ -467,14 +607,35 @@ static uint16_t _tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n, uint1
   return n;
 }
 
-static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+#if CFG_TUSB_FIFO_DROP_OLDEST
+// Peek up to n items of an overwritable fifo and advance read index by the number peeked if requested. Writer
+// may advance read index at any time to drop oldest items, copy is then repeated since it could have been
+// overwritten. A copy to constant address (hardware fifo) can not be repeated and is taken as it is.
+static tu_fifo_size_t _ff_read_overwritable(tu_fifo_t* f, void * p_buffer, tu_fifo_size_t n, bool advance,
+                                            tu_fifo_copy_mode_t copy_mode)
 {
-  if ( n == 0 ) return 0;
+  tu_fifo_size_t rd_idx;
+  tu_fifo_size_t cnt;
+  bool done;
 
-  _ff_lock(f->mutex_wr);
+  do
+  {
+    rd_idx = __atomic_load_n(&f->rd_idx, __ATOMIC_ACQUIRE);
+    cnt    = _tu_fifo_peek_n(f, p_buffer, n, __atomic_load_n(&f->wr_idx, __ATOMIC_ACQUIRE), rd_idx, copy_mode);
+    done   = __atomic_compare_exchange_n(&f->rd_idx, &rd_idx, advance_index(f->depth, rd_idx, advance ? cnt : 0),
+                                         false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+  } while ( !done && (copy_mode == TU_FIFO_COPY_INC) );
+
+  return cnt;
+}
+#endif
+
+TU_ATTR_FAST_FUNC static tu_fifo_size_t _tu_fifo_write_n_unlocked(tu_fifo_t* f, const void * data, tu_fifo_size_t n, tu_fifo_copy_mode_t copy_mode)
+{
+  if (_ff_dma_busy(f->dma_wr)) return 0;
 
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
+  tu_fifo_size_t wr_idx = f->wr_idx;
+  tu_fifo_size_t rd_idx = f->rd_idx;
 
   uint8_t const* buf8 = (uint8_t const*) data;
 
@@ -484,11 +645,34 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
   if ( !f->overwritable )
   {
     // limit up to full
-    uint16_t const remain = _ff_remaining(f->depth, wr_idx, rd_idx);
-    n = tu_min16(n, remain);
+    tu_fifo_size_t const remain = _ff_remaining(f->depth, wr_idx, rd_idx);
+    n = TU_MIN(n, remain);
   }
   else
   {
+#if CFG_TUSB_FIFO_DROP_OLDEST
+    // In over-writable mode, fifo_write() is allowed even when fifo is full. In such case,
+    // oldest items are dropped by advancing the read index so that fifo holds the latest
+    // depth items after the write
+    if ( n > f->depth )
+    {
+      // Only copy last part, the items before it are dropped right away
+      tu_fifo_size_t const skip = (tu_fifo_size_t) (n - f->depth);
+      if ( copy_mode == TU_FIFO_COPY_INC )
+      {
+        buf8 += skip * f->item_size;
+      }else
+      {
+        // TODO should read from hw fifo to discard data, however reading an odd number could
+        // accidentally discard data.
+      }
+
+      f->dropped += skip;
+      n = f->depth;
+    }
+
+    _ff_drop_oldest(f, wr_idx, n);
+#else
     // In over-writable mode, fifo_write() is allowed even when fifo is full. In such case,
     // oldest data in fifo i.e at read pointer data will be overwritten
     // Note: we can modify read buffer contents but we must not modify the read index itself within a write function!
@@ -512,7 +696,7 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     }
     else
     {
-      uint16_t const overflowable_count = _ff_count(f->depth, wr_idx, rd_idx);
+      tu_fifo_size_t const overflowable_count = _ff_count(f->depth, wr_idx, rd_idx);
       if (overflowable_count + n >= 2*f->depth)
       {
         // Double overflowed
@@ -532,11 +716,12 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
         // we will correct (re-position) read index later on in fifo_read() function
       }
     }
+#endif
   }
 
   if (n)
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+    tu_fifo_size_t wr_ptr = _ff_idx2ptr(f->depth, wr_idx);
 
     TU_LOG(TU_FIFO_DBG, "actual_n = %u, wr_ptr = %u", n, wr_ptr);
 
@@ -549,15 +734,39 @@ static uint16_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n, tu
     TU_LOG(TU_FIFO_DBG, "\tnew_wr = %u\r\n", f->wr_idx);
   }
 
+  return n;
+}
+
+TU_ATTR_FAST_FUNC static tu_fifo_size_t _tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_size_t n, tu_fifo_copy_mode_t copy_mode)
+{
+  if ( n == 0 ) return 0;
+
+  _ff_lock(f->mutex_wr);
+  n = _tu_fifo_write_n_unlocked(f, data, n, copy_mode);
   _ff_unlock(f->mutex_wr);
 
   return n;
 }
 
-static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo_copy_mode_t copy_mode)
+TU_ATTR_FAST_FUNC static tu_fifo_size_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_size_t n, tu_fifo_copy_mode_t copy_mode)
 {
   _ff_lock(f->mutex_rd);
 
+  if (_ff_dma_busy(f->dma_rd))
+  {
+    _ff_unlock(f->mutex_rd);
+    return 0;
+  }
+
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  if ( f->overwritable )
+  {
+    n = _ff_read_overwritable(f, buffer, n, true, copy_mode);
+    _ff_unlock(f->mutex_rd);
+    return n;
+  }
+#endif
+
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
   n = _tu_fifo_peek_n(f, buffer, n, f->wr_idx, f->rd_idx, copy_mode);
@@ -588,9 +797,9 @@ static uint16_t _tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n, tu_fifo
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_count(tu_fifo_t* f)
+tu_fifo_size_t tu_fifo_count(tu_fifo_t* f)
 {
-  return tu_min16(_ff_count(f->depth, f->wr_idx, f->rd_idx), f->depth);
+  return TU_MIN(_ff_count(f->depth, f->wr_idx, f->rd_idx), f->depth);
 }
 
 /******************************************************************************/
@@ -642,7 +851,7 @@ bool tu_fifo_full(tu_fifo_t* f)
     @returns Number of items in FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_remaining(tu_fifo_t* f)
+tu_fifo_size_t tu_fifo_remaining(tu_fifo_t* f)
 {
   return _ff_remaining(f->depth, f->wr_idx, f->rd_idx);
 }
@@ -697,13 +906,31 @@ void tu_fifo_correct_read_pointer(tu_fifo_t* f)
     @returns TRUE if the queue is not empty
  */
 /******************************************************************************/
-bool tu_fifo_read(tu_fifo_t* f, void * buffer)
+TU_ATTR_FAST_FUNC bool tu_fifo_read(tu_fifo_t* f, void * buffer)
 {
   _ff_lock(f->mutex_rd);
 
+  if (_ff_dma_busy(f->dma_rd))
+  {
+    _ff_unlock(f->mutex_rd);
+    return false;
+  }
+
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  if ( f->overwritable )
+  {
+    bool const ret = _ff_read_overwritable(f, buffer, 1, true, TU_FIFO_COPY_INC) != 0;
+    _ff_unlock(f->mutex_rd);
+    return ret;
+  }
+#endif
+
   // Peek the data
   // f->rd_idx might get modified in case of an overflow so we can not use a local variable
-  bool ret = _tu_fifo_peek(f, buffer, f->wr_idx, f->rd_idx);
+  tu_fifo_size_t const wr_idx = f->wr_idx;
+  _ff_barrier();
+  bool ret = _tu_fifo_peek(f, buffer, wr_idx, f->rd_idx);
+  _ff_barrier();
 
   // Advance pointer
   f->rd_idx = advance_index(f->depth, f->rd_idx, ret);
@@ -728,7 +955,7 @@ bool tu_fifo_read(tu_fifo_t* f, void * buffer)
     @returns number of items read from the FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, tu_fifo_size_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_INC);
 }
@@ -751,7 +978,7 @@ uint16_t tu_fifo_read_n(tu_fifo_t* f, void * buffer, uint16_t n)
     @returns number of items read from the FIFO
  */
 /******************************************************************************/
-uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, tu_fifo_size_t n)
 {
   return _tu_fifo_read_n(f, buffer, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
@@ -773,7 +1000,12 @@ uint16_t tu_fifo_read_n_const_addr_full_words(tu_fifo_t* f, void * buffer, uint1
 bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
 {
   _ff_lock(f->mutex_rd);
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  bool ret = f->overwritable ? (_ff_read_overwritable(f, p_buffer, 1, false, TU_FIFO_COPY_INC) != 0) :
+                               _tu_fifo_peek(f, p_buffer, f->wr_idx, f->rd_idx);
+#else
   bool ret = _tu_fifo_peek(f, p_buffer, f->wr_idx, f->rd_idx);
+#endif
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -793,10 +1025,15 @@ bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
     @returns Number of bytes written to p_buffer
  */
 /******************************************************************************/
-uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
+tu_fifo_size_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, tu_fifo_size_t n)
 {
   _ff_lock(f->mutex_rd);
-  uint16_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  tu_fifo_size_t ret = f->overwritable ? _ff_read_overwritable(f, p_buffer, n, false, TU_FIFO_COPY_INC) :
+                                         _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+#else
+  tu_fifo_size_t ret = _tu_fifo_peek_n(f, p_buffer, n, f->wr_idx, f->rd_idx, TU_FIFO_COPY_INC);
+#endif
   _ff_unlock(f->mutex_rd);
   return ret;
 }
@@ -817,22 +1054,28 @@ uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t n)
              FIFO will always return TRUE)
  */
 /******************************************************************************/
-bool tu_fifo_write(tu_fifo_t* f, const void * data)
+TU_ATTR_FAST_FUNC bool tu_fifo_write(tu_fifo_t* f, const void * data)
 {
   _ff_lock(f->mutex_wr);
 
   bool ret;
-  uint16_t const wr_idx = f->wr_idx;
+  tu_fifo_size_t const wr_idx = f->wr_idx;
 
-  if ( tu_fifo_full(f) && !f->overwritable )
+  if ( (tu_fifo_full(f) && !f->overwritable) || _ff_dma_busy(f->dma_wr) )
   {
     ret = false;
   }else
   {
-    uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
+#if CFG_TUSB_FIFO_DROP_OLDEST
+    if ( f->overwritable ) _ff_drop_oldest(f, wr_idx, 1);
+#endif
+
+    tu_fifo_size_t wr_ptr = _ff_idx2ptr(f->depth, wr_idx);
 
     // Write data
+    _ff_barrier();
     _ff_push(f, data, wr_ptr);
+    _ff_barrier();
 
     // Advance pointer
     f->wr_idx = advance_index(f->depth, wr_idx, 1);
@@ -859,11 +1102,32 @@ bool tu_fifo_write(tu_fifo_t* f, const void * data)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_write_n(tu_fifo_t* f, const void * data, tu_fifo_size_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_INC);
 }
 
+/******************************************************************************/
+/*!
+    @brief Same as tu_fifo_write_n() but without taking the write mutex, so that
+    it can be called from an ISR. Caller must be the only writer of the fifo
+    (e.g the ISR feeding it), otherwise use tu_fifo_write_n_mpsc().
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  data
+                The pointer to data to add to the FIFO
+    @param[in]  count
+                Number of element
+    @return Number of written elements
+ */
+/******************************************************************************/
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_write_n_unlocked(tu_fifo_t* f, const void * data, tu_fifo_size_t n)
+{
+  if ( n == 0 ) return 0;
+  return _tu_fifo_write_n_unlocked(f, data, n, TU_FIFO_COPY_INC);
+}
+
 #ifdef TUP_MEM_CONST_ADDR
 /******************************************************************************/
 /*!
@@ -880,12 +1144,270 @@ uint16_t tu_fifo_write_n(tu_fifo_t* f, const void * data, uint16_t n)
     @return Number of written elements
  */
 /******************************************************************************/
-uint16_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, uint16_t n)
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_write_n_const_addr_full_words(tu_fifo_t* f, const void * data, tu_fifo_size_t n)
 {
   return _tu_fifo_write_n(f, data, n, TU_FIFO_COPY_CST_FULL_WORDS);
 }
 #endif
 
+#if CFG_TUSB_FIFO_MPSC
+
+#define MPSC_RESERVE(_state)  ((tu_fifo_size_t) ((_state) & 0xFFFFu))
+#define MPSC_ACTIVE(_state)   ((_state) >> 16)
+
+/******************************************************************************/
+/*!
+    @brief Lock-free write of n elements for multiple producers (threads or ISRs)
+    and a single consumer. Space is reserved by advancing the reserve index and
+    producer count in one atomic step, data is copied without lock, and the last
+    producer to finish publishes the write index so that readers never see
+    partially copied data. Fifo is never overwritten: if not enough space is
+    available only the remaining elements are written.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  data
+                The pointer to data to add to the FIFO
+    @param[in]  count
+                Number of element
+    @return Number of written elements
+ */
+/******************************************************************************/
+TU_ATTR_FAST_FUNC tu_fifo_size_t tu_fifo_write_n_mpsc(tu_fifo_t* f, const void * data, tu_fifo_size_t n)
+{
+  if ( n == 0 ) return 0;
+
+  uint32_t state = __atomic_load_n(&f->mpsc_state, __ATOMIC_RELAXED);
+  uint32_t new_state;
+  tu_fifo_size_t wr_idx;
+  tu_fifo_size_t count;
+
+  // Reserve space
+  do
+  {
+    wr_idx = MPSC_RESERVE(state);
+    count  = TU_MIN(n, _ff_remaining(f->depth, wr_idx, __atomic_load_n(&f->rd_idx, __ATOMIC_ACQUIRE)));
+    if ( count == 0 ) return 0;
+
+    new_state = ((MPSC_ACTIVE(state) + 1) << 16) | advance_index(f->depth, wr_idx, count);
+  } while ( !__atomic_compare_exchange_n(&f->mpsc_state, &state, new_state, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) );
+
+  // Published index is sampled while this producer is still active, therefore no other
+  // producer can have published past our data yet
+  tu_fifo_size_t published = __atomic_load_n(&f->wr_idx, __ATOMIC_RELAXED);
+
+  _ff_push_n(f, data, count, _ff_idx2ptr(f->depth, wr_idx), TU_FIFO_COPY_INC);
+
+  // Commit: leave active set
+  state = __atomic_sub_fetch(&f->mpsc_state, 1ul << 16, __ATOMIC_ACQ_REL);
+
+  // Last active producer publishes everything reserved so far. Compare-exchange makes sure an older
+  // reserve index never overwrites a newer one published by a producer that preempted us.
+  while ( MPSC_ACTIVE(state) == 0 )
+  {
+    tu_fifo_size_t const target = MPSC_RESERVE(state);
+    if ( published == target ) break;
+    if ( __atomic_compare_exchange_n(&f->wr_idx, &published, target, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED) ) break;
+
+    state = __atomic_load_n(&f->mpsc_state, __ATOMIC_ACQUIRE);
+  }
+
+  return count;
+}
+
+#endif
+
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+
+TU_ATTR_WEAK bool tu_fifo_dma_copy_async(void* dst, void const* src, uint32_t len, void (*done_cb)(void* param), void* param)
+{
+  (void) dst; (void) src; (void) len; (void) done_cb; (void) param;
+  return false;
+}
+
+// Start copying n items between application buffer and fifo at buffer offset ptr: linear segment now, the wrapped
+// one from done_cb. Return false if copied with CPU already (below threshold or no DMA available)
+static bool _ff_dma_start(tu_fifo_t* f, tu_fifo_dma_job_t* job, bool is_write, uint8_t* app_buf, tu_fifo_size_t n,
+                          tu_fifo_size_t ptr, void (*complete_cb)(void* arg, tu_fifo_size_t n), void* arg,
+                          void (*done_cb)(void* param))
+{
+  tu_fifo_size_t const lin_count = TU_MIN(n, (tu_fifo_size_t) (f->depth - ptr));
+  uint32_t const lin_bytes  = (uint32_t) lin_count * f->item_size;
+  uint32_t const wrap_bytes = (uint32_t) (n - lin_count) * f->item_size;
+  uint8_t* ff_buf = f->buffer + ((uint32_t) ptr * f->item_size);
+
+  uint8_t* dst = is_write ? ff_buf : app_buf;
+  uint8_t const* src = is_write ? app_buf : ff_buf;
+
+  job->complete_cb = complete_cb;
+  job->arg         = arg;
+  job->n           = n;
+  job->wrap_dst    = is_write ? f->buffer : (app_buf + lin_bytes);
+  job->wrap_src    = is_write ? (app_buf + lin_bytes) : f->buffer;
+  job->wrap_len    = wrap_bytes;
+
+  if (lin_bytes + wrap_bytes >= CFG_TUSB_FIFO_DMA_THRESHOLD)
+  {
+    job->busy = true; // DMA may complete before the hook returns
+    if (tu_fifo_dma_copy_async(dst, src, lin_bytes, done_cb, f)) return true;
+    job->busy = false;
+  }
+
+  memcpy(dst, src, lin_bytes);
+  if (wrap_bytes) memcpy(job->wrap_dst, job->wrap_src, wrap_bytes);
+  return false;
+}
+
+// Linear segment is done: start wrapped segment if any, return true if it is still in progress
+static bool _ff_dma_continue(tu_fifo_dma_job_t* job, void (*done_cb)(void* param), void* param)
+{
+  uint32_t const len = job->wrap_len;
+  if (len == 0) return false;
+
+  job->wrap_len = 0;
+  if (tu_fifo_dma_copy_async(job->wrap_dst, job->wrap_src, len, done_cb, param)) return true;
+
+  memcpy(job->wrap_dst, job->wrap_src, len);
+  return false;
+}
+
+static void _ff_dma_finish(tu_fifo_dma_job_t* job)
+{
+  void (*complete_cb)(void* arg, tu_fifo_size_t n) = job->complete_cb;
+  void* arg = job->arg;
+  tu_fifo_size_t const n = job->n;
+
+  job->busy = false;
+  if (complete_cb) complete_cb(arg, n);
+}
+
+static void _ff_dma_write_done(void* param)
+{
+  tu_fifo_t* f = (tu_fifo_t*) param;
+  if (_ff_dma_continue(&f->dma_wr, _ff_dma_write_done, param)) return;
+
+  _ff_barrier();
+  f->wr_idx = advance_index(f->depth, f->wr_idx, f->dma_wr.n);
+  _ff_dma_finish(&f->dma_wr);
+}
+
+static void _ff_dma_read_done(void* param)
+{
+  tu_fifo_t* f = (tu_fifo_t*) param;
+  if (_ff_dma_continue(&f->dma_rd, _ff_dma_read_done, param)) return;
+
+  _ff_barrier();
+  f->rd_idx = advance_index(f->depth, f->rd_idx, f->dma_rd.n);
+  _ff_dma_finish(&f->dma_rd);
+}
+
+/******************************************************************************/
+/*!
+    @brief Write n elements into the fifo asynchronously, large copies are
+    done with DMA via tu_fifo_dma_copy_async(). Write index is advanced and
+    complete_cb invoked once all data is in the fifo.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  data
+                The pointer to data to add to the FIFO, valid until complete_cb
+    @param[in]  n
+                Number of element
+    @return Number of elements accepted, 0 if full or busy
+ */
+/******************************************************************************/
+tu_fifo_size_t tu_fifo_write_n_async(tu_fifo_t* f, void const * data, tu_fifo_size_t n,
+                                     void (*complete_cb)(void* arg, tu_fifo_size_t n), void* arg)
+{
+  TU_VERIFY(n && !f->overwritable, 0);
+
+  _ff_lock(f->mutex_wr);
+
+  bool started = false;
+  if (f->dma_wr.busy)
+  {
+    n = 0;
+  }
+  else
+  {
+    tu_fifo_size_t const wr_idx = f->wr_idx;
+    n = TU_MIN(n, _ff_remaining(f->depth, wr_idx, f->rd_idx));
+
+    if (n)
+    {
+      started = _ff_dma_start(f, &f->dma_wr, true, (uint8_t*) (uintptr_t) data, n, _ff_idx2ptr(f->depth, wr_idx),
+                              complete_cb, arg, _ff_dma_write_done);
+      if (!started)
+      {
+        _ff_barrier();
+        f->wr_idx = advance_index(f->depth, wr_idx, n);
+      }
+    }
+  }
+
+  _ff_unlock(f->mutex_wr);
+
+  // copied by CPU: complete now, outside of the fifo lock
+  if (n && !started && complete_cb) complete_cb(arg, n);
+
+  return n;
+}
+
+/******************************************************************************/
+/*!
+    @brief Read n elements from the fifo asynchronously, large copies are
+    done with DMA via tu_fifo_dma_copy_async(). Read index is advanced and
+    complete_cb invoked once all data is in buffer.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  buffer
+                The pointer to data location, valid until complete_cb
+    @param[in]  n
+                Number of element that buffer can afford
+    @return Number of elements to be read, 0 if empty or busy
+ */
+/******************************************************************************/
+tu_fifo_size_t tu_fifo_read_n_async(tu_fifo_t* f, void * buffer, tu_fifo_size_t n,
+                                    void (*complete_cb)(void* arg, tu_fifo_size_t n), void* arg)
+{
+  TU_VERIFY(n && !f->overwritable, 0);
+
+  _ff_lock(f->mutex_rd);
+
+  bool started = false;
+  if (f->dma_rd.busy)
+  {
+    n = 0;
+  }
+  else
+  {
+    tu_fifo_size_t const rd_idx = f->rd_idx;
+    n = TU_MIN(n, _ff_count(f->depth, f->wr_idx, rd_idx));
+
+    if (n)
+    {
+      _ff_barrier();
+      started = _ff_dma_start(f, &f->dma_rd, false, (uint8_t*) buffer, n, _ff_idx2ptr(f->depth, rd_idx),
+                              complete_cb, arg, _ff_dma_read_done);
+      if (!started)
+      {
+        _ff_barrier();
+        f->rd_idx = advance_index(f->depth, rd_idx, n);
+      }
+    }
+  }
+
+  _ff_unlock(f->mutex_rd);
+
+  // copied by CPU: complete now, outside of the fifo lock
+  if (n && !started && complete_cb) complete_cb(arg, n);
+
+  return n;
+}
+
+#endif
+
 /******************************************************************************/
 /*!
     @brief Clear the fifo read and write pointers
@@ -901,6 +1423,12 @@ bool tu_fifo_clear(tu_fifo_t *f)
 
   f->rd_idx = 0;
   f->wr_idx = 0;
+#if CFG_TUSB_FIFO_MPSC
+  f->mpsc_state = 0;
+#endif
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  f->dropped    = 0;
+#endif
 
   _ff_unlock(f->mutex_wr);
   _ff_unlock(f->mutex_rd);
@@ -946,9 +1474,12 @@ bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable)
                 Number of items the write pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
+TU_ATTR_FAST_FUNC void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_size_t n)
 {
   f->wr_idx = advance_index(f->depth, f->wr_idx, n);
+#if CFG_TUSB_FIFO_MPSC
+  f->mpsc_state = f->wr_idx; // no producer is active in between
+#endif
 }
 
 /******************************************************************************/
@@ -967,7 +1498,7 @@ void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n)
                 Number of items the read pointer moves forward
  */
 /******************************************************************************/
-void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
+TU_ATTR_FAST_FUNC void tu_fifo_advance_read_pointer(tu_fifo_t *f, tu_fifo_size_t n)
 {
   f->rd_idx = advance_index(f->depth, f->rd_idx, n);
 }
@@ -987,13 +1518,13 @@ void tu_fifo_advance_read_pointer(tu_fifo_t *f, uint16_t n)
                     Pointer to struct which holds the desired infos
  */
 /******************************************************************************/
-void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+TU_ATTR_FAST_FUNC void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
   // Operate on temporary values in case they change in between
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
+  tu_fifo_size_t wr_idx = f->wr_idx;
+  tu_fifo_size_t rd_idx = f->rd_idx;
 
-  uint16_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
+  tu_fifo_size_t cnt = _ff_count(f->depth, wr_idx, rd_idx);
 
   // Check overflow and correct if required - may happen in case a DMA wrote too fast
   if (cnt > f->depth)
@@ -1016,8 +1547,8 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_size_t wr_ptr = _ff_idx2ptr(f->depth, wr_idx);
+  tu_fifo_size_t rd_ptr = _ff_idx2ptr(f->depth, rd_idx);
 
   // Copy pointer to buffer to start reading from
   info->ptr_lin = &f->buffer[rd_ptr];
@@ -1055,11 +1586,11 @@ void tu_fifo_get_read_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
                     Pointer to struct which holds the desired infos
  */
 /******************************************************************************/
-void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
+TU_ATTR_FAST_FUNC void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
 {
-  uint16_t wr_idx = f->wr_idx;
-  uint16_t rd_idx = f->rd_idx;
-  uint16_t remain = _ff_remaining(f->depth, wr_idx, rd_idx);
+  tu_fifo_size_t wr_idx = f->wr_idx;
+  tu_fifo_size_t rd_idx = f->rd_idx;
+  tu_fifo_size_t remain = _ff_remaining(f->depth, wr_idx, rd_idx);
 
   if (remain == 0)
   {
@@ -1071,8 +1602,8 @@ void tu_fifo_get_write_info(tu_fifo_t *f, tu_fifo_buffer_info_t *info)
   }
 
   // Get relative pointers
-  uint16_t wr_ptr = idx2ptr(f->depth, wr_idx);
-  uint16_t rd_ptr = idx2ptr(f->depth, rd_idx);
+  tu_fifo_size_t wr_ptr = _ff_idx2ptr(f->depth, wr_idx);
+  tu_fifo_size_t rd_ptr = _ff_idx2ptr(f->depth, rd_idx);
 
   // Copy pointer to buffer to start writing to
   info->ptr_lin = &f->buffer[wr_ptr];
@@ -40,6 +40,13 @@ extern "C" {
 // Also, this FIFO is ready to be used in combination with a DMA as the write and
 // read pointers can be updated from within a DMA ISR. Overflows are detectable
 // within a certain number (see tu_fifo_overflow()).
+// With CFG_TUSB_FIFO_MPSC, tu_fifo_write_n_mpsc() allows several threads and ISRs to
+// write concurrently without mutex. Such fifo must then only be written with it.
+// tu_fifo_write_n_unlocked() skips the write mutex of RTOS config for a fifo whose only
+// writer is an ISR.
+// With CFG_TUSB_FIFO_DROP_OLDEST, writing to a full overwritable fifo drops the oldest
+// items by advancing the read index atomically, so overflow is never left for the reader
+// to correct.
 
 #include "common/tusb_common.h"
 #include "osal/osal.h"
@@ -48,6 +55,37 @@ extern "C" {
 // for OS None, we don't get preempted
 #define CFG_FIFO_MUTEX      OSAL_MUTEX_REQUIRED
 
+// Type of depth, index and item count. 16-bit limits depth to 2^15 items, 32-bit (CFG_TUSB_FIFO_LARGE)
+// allows fifo larger than 64 KiB at the cost of 4 more bytes per fifo
+#if CFG_TUSB_FIFO_LARGE
+typedef uint32_t tu_fifo_size_t;
+#define TU_FIFO_SIZE_MAX    UINT32_MAX
+#else
+typedef uint16_t tu_fifo_size_t;
+#define TU_FIFO_SIZE_MAX    UINT16_MAX
+#endif
+
+// reserve index and producer count are packed into one 32-bit atomic word
+#if CFG_TUSB_FIFO_MPSC && CFG_TUSB_FIFO_LARGE
+  #error "CFG_TUSB_FIFO_MPSC is not supported with CFG_TUSB_FIFO_LARGE"
+#endif
+
+// index space is [0..2*depth)
+#define TU_FIFO_DEPTH_MAX   ((TU_FIFO_SIZE_MAX >> 1) + 1)
+
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+// Asynchronous (DMA) read or write in progress, see tu_fifo_write_n_async()
+typedef struct {
+  void (*complete_cb)(void* arg, tu_fifo_size_t n);
+  void* arg;
+  uint8_t* wrap_dst;        // wrapped segment, copied once the linear one is done
+  uint8_t const* wrap_src;
+  uint32_t wrap_len;
+  tu_fifo_size_t n;
+  volatile bool busy;
+} tu_fifo_dma_job_t;
+#endif
+
 /* Write/Read index is always in the range of:
  *      0 .. 2*depth-1
  * The extra window allow us to determine the fifo state of empty or full with only 2 indices
@@ -102,29 +140,49 @@ extern "C" {
  *                  |
  *      -------------------------
  *      | R | 1 | 2 | W | 4 | 5 |
+ *
+ * With CFG_TUSB_FIFO_DROP_OLDEST, write() instead advances R by the number of items that do not fit
+ * (compare-and-swap, as reader advances it too) before writing, so count never exceeds depth and the
+ * fifo always holds the latest depth items. A read()/peek() that finds R moved while copying retries.
+ *
+ * If depth is a power of two, index arithmetic is done with masks only, which is cheaper for
+ * per-item access e.g CDC/MIDI. Therefore power of two depth is preferred when possible.
  */
 typedef struct {
   uint8_t* buffer          ; // buffer pointer
-  uint16_t depth           ; // max items
+  tu_fifo_size_t depth     ; // max items
 
   struct TU_ATTR_PACKED {
     uint16_t item_size : 15; // size of each item
     bool overwritable  : 1 ; // ovwerwritable when full
   };
 
-  volatile uint16_t wr_idx ; // write index
-  volatile uint16_t rd_idx ; // read index
+  volatile tu_fifo_size_t wr_idx ; // write index
+  volatile tu_fifo_size_t rd_idx ; // read index
+
+#if CFG_TUSB_FIFO_MPSC
+  uint32_t mpsc_state; // multi-producer: reserve index (low 16-bit) and active producers (high 16-bit)
+#endif
+
+#if CFG_TUSB_FIFO_DROP_OLDEST
+  volatile uint32_t dropped; // items dropped by overwriting, only updated by writer
+#endif
 
 #if OSAL_MUTEX_REQUIRED
   osal_mutex_t mutex_wr;
   osal_mutex_t mutex_rd;
 #endif
 
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+  tu_fifo_dma_job_t dma_wr;
+  tu_fifo_dma_job_t dma_rd;
+#endif
+
 } tu_fifo_t;
 
 typedef struct {
-  uint16_t len_lin  ; ///< linear length in item size
-  uint16_t len_wrap ; ///< wrapped length in item size
+  tu_fifo_size_t len_lin  ; ///< linear length in item size
+  tu_fifo_size_t len_wrap ; ///< wrapped length in item size
   void * ptr_lin    ; ///< linear part start pointer
   void * ptr_wrap   ; ///< wrapped part start pointer
 } tu_fifo_buffer_info_t;
@@ -140,9 +198,117 @@ typedef struct {
     uint8_t _name##_buf[_depth*sizeof(_type)];                                \
     tu_fifo_t _name = TU_FIFO_INIT(_name##_buf, _depth, _type, _overwritable)
 
+//--------------------------------------------------------------------+
+// Index helpers, also used by item-type specialized functions
+//--------------------------------------------------------------------+
+
+// Order index and buffer accesses of tu_fifo_read()/tu_fifo_write() so that a single reader and a single writer
+// in different contexts (task and ISR, or other core) never see an index ahead of its data
+#ifdef TU_MEMORY_BARRIER
+  #define _ff_barrier()   TU_MEMORY_BARRIER()
+#else
+  #define _ff_barrier()
+#endif
+
+// For power of two depth, index arithmetic in [0..2*depth) reduces to masking e.g TU_FIFO_DEF(ff, 64, ...)
+TU_ATTR_ALWAYS_INLINE static inline
+bool _ff_is_pow2(tu_fifo_size_t depth)
+{
+  return (depth & (depth - 1)) == 0;
+}
+
+// return only the index difference and as such can be used to determine an overflow i.e overflowable count
+TU_ATTR_ALWAYS_INLINE static inline
+tu_fifo_size_t _ff_count(tu_fifo_size_t depth, tu_fifo_size_t wr_idx, tu_fifo_size_t rd_idx)
+{
+  if ( _ff_is_pow2(depth) )
+  {
+    return (tu_fifo_size_t) ((wr_idx - rd_idx) & (2*depth - 1));
+  }
+
+  // In case we have non-power of two depth we need a further modification
+  if (wr_idx >= rd_idx)
+  {
+    return (tu_fifo_size_t) (wr_idx - rd_idx);
+  } else
+  {
+    return (tu_fifo_size_t) (2*depth - (rd_idx - wr_idx));
+  }
+}
+
+// Advance an absolute index
+// "absolute" index is only in the range of [0..2*depth)
+TU_ATTR_ALWAYS_INLINE static inline
+tu_fifo_size_t _ff_advance_index(tu_fifo_size_t depth, tu_fifo_size_t idx, tu_fifo_size_t offset)
+{
+  if ( _ff_is_pow2(depth) )
+  {
+    return (tu_fifo_size_t) ((idx + offset) & (2*depth - 1));
+  }
+
+  // We limit the index space of p such that a correct wrap around happens
+  // Check for a wrap around or if we are in unused index space - This has to be checked first!!
+  // We are exploiting the wrap around to the correct index
+  tu_fifo_size_t new_idx = (tu_fifo_size_t) (idx + offset);
+  if ( (idx > new_idx) || (new_idx >= 2*depth) )
+  {
+    tu_fifo_size_t const non_used_index_space = (tu_fifo_size_t) (TU_FIFO_SIZE_MAX - (2*depth-1));
+    new_idx = (tu_fifo_size_t) (new_idx + non_used_index_space);
+  }
+
+  return new_idx;
+}
+
+// index to pointer, simply an modulo with minus.
+TU_ATTR_ALWAYS_INLINE static inline
+tu_fifo_size_t _ff_idx2ptr(tu_fifo_size_t depth, tu_fifo_size_t idx)
+{
+  if ( _ff_is_pow2(depth) )
+  {
+    return (tu_fifo_size_t) (idx & (depth - 1));
+  }
+
+  // Only run at most 3 times since index is limit in the range of [0..2*depth)
+  while ( idx >= depth ) idx -= depth;
+  return idx;
+}
+
+//--------------------------------------------------------------------+
+// Item-type specialized functions
+//--------------------------------------------------------------------+
+
+// Generate _prefix##_write()/_prefix##_read()/_prefix##_peek() for fifos of _depth items of _type. They behave as
+// tu_fifo_write()/tu_fifo_read()/tu_fifo_peek() but item size and depth are compile-time constants: index math
+// folds (to masking for power of two depth) and an item is copied with fixed size loads/stores, without branching
+// on item_size or overwritable. Only for non-overwritable fifo without async transfer, accessed by one writer and
+// one reader at a time since mutex is not taken. Other tu_fifo_*() functions still work on the same fifo.
+#define TU_FIFO_TYPED_FUNC(_prefix, _depth, _type)                                                  \
+  static inline bool _prefix##_write(tu_fifo_t* f, void const* item) {                              \
+    tu_fifo_size_t const wr_idx = f->wr_idx;                                                        \
+    if (_ff_count(_depth, wr_idx, f->rd_idx) >= (_depth)) return false;                             \
+    _ff_barrier();                                                                                  \
+    memcpy(f->buffer + _ff_idx2ptr(_depth, wr_idx) * sizeof(_type), item, sizeof(_type));           \
+    _ff_barrier();                                                                                  \
+    f->wr_idx = _ff_advance_index(_depth, wr_idx, 1);                                               \
+    return true;                                                                                    \
+  }                                                                                                 \
+  static inline bool _prefix##_peek(tu_fifo_t* f, void* item) {                                     \
+    tu_fifo_size_t const rd_idx = f->rd_idx;                                                        \
+    if (_ff_count(_depth, f->wr_idx, rd_idx) == 0) return false;                                    \
+    _ff_barrier();                                                                                  \
+    memcpy(item, f->buffer + _ff_idx2ptr(_depth, rd_idx) * sizeof(_type), sizeof(_type));           \
+    return true;                                                                                    \
+  }                                                                                                 \
+  static inline bool _prefix##_read(tu_fifo_t* f, void* item) {                                     \
+    if (!_prefix##_peek(f, item)) return false;                                                     \
+    _ff_barrier();                                                                                  \
+    f->rd_idx = _ff_advance_index(_depth, f->rd_idx, 1);                                            \
+    return true;                                                                                    \
+  }
+
 bool tu_fifo_set_overwritable(tu_fifo_t *f, bool overwritable);
 bool tu_fifo_clear(tu_fifo_t *f);
-bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
+bool tu_fifo_config(tu_fifo_t *f, void* buffer, tu_fifo_size_t depth, uint16_t item_size, bool overwritable);
 
 #if OSAL_MUTEX_REQUIRED
 TU_ATTR_ALWAYS_INLINE static inline
@@ -154,37 +320,67 @@ void tu_fifo_config_mutex(tu_fifo_t *f, osal_mutex_t wr_mutex, osal_mutex_t rd_m
 #define tu_fifo_config_mutex(_f, _wr_mutex, _rd_mutex)
 #endif
 
-bool     tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
-uint16_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, uint16_t n);
+bool           tu_fifo_write                  (tu_fifo_t* f, void const * p_data);
+tu_fifo_size_t tu_fifo_write_n                (tu_fifo_t* f, void const * p_data, tu_fifo_size_t n);
+tu_fifo_size_t tu_fifo_write_n_unlocked       (tu_fifo_t* f, void const * p_data, tu_fifo_size_t n);
 #ifdef TUP_MEM_CONST_ADDR
-uint16_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, uint16_t n);
+tu_fifo_size_t tu_fifo_write_n_const_addr_full_words    (tu_fifo_t* f, const void * data, tu_fifo_size_t n);
+#endif
+#if CFG_TUSB_FIFO_MPSC
+tu_fifo_size_t tu_fifo_write_n_mpsc           (tu_fifo_t* f, void const * p_data, tu_fifo_size_t n);
 #endif
 
-bool     tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
+bool           tu_fifo_read                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_size_t tu_fifo_read_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_size_t n);
 #ifdef TUP_MEM_CONST_ADDR
-uint16_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, uint16_t n);
+tu_fifo_size_t tu_fifo_read_n_const_addr_full_words     (tu_fifo_t* f, void * buffer, tu_fifo_size_t n);
 #endif
 
-bool     tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
-uint16_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, uint16_t n);
+#if CFG_TUSB_FIFO_DMA_THRESHOLD
+// Asynchronous write/read of n items: copies of CFG_TUSB_FIFO_DMA_THRESHOLD bytes or more are done with
+// tu_fifo_dma_copy_async() (linear then wrapped segment), smaller ones or when no DMA is available with CPU.
+// Return number of items accepted, 0 if fifo is full/empty or another async transfer of the same direction is in
+// progress. The write (read) index is advanced and complete_cb(arg, n) invoked once data is copied, possibly in
+// DMA ISR or before returning. data/buffer must stay valid until then, and the fifo must not be overwritable.
+// Other writes (reads) of the fifo fail while an async one is in progress.
+tu_fifo_size_t tu_fifo_write_n_async          (tu_fifo_t* f, void const * data, tu_fifo_size_t n,
+                                               void (*complete_cb)(void* arg, tu_fifo_size_t n), void* arg);
+tu_fifo_size_t tu_fifo_read_n_async           (tu_fifo_t* f, void * buffer, tu_fifo_size_t n,
+                                               void (*complete_cb)(void* arg, tu_fifo_size_t n), void* arg);
+
+// Copy hook implemented by application (weak default returns false): start copying len bytes from src to dst with
+// a DMA channel and invoke done_cb(param) when complete (typically from DMA ISR). Data cache maintenance of both
+// buffers is up to the hook. Return false if no channel is available, copy is then done with CPU.
+bool tu_fifo_dma_copy_async(void* dst, void const* src, uint32_t len, void (*done_cb)(void* param), void* param);
+#endif
 
-uint16_t tu_fifo_count                  (tu_fifo_t* f);
-uint16_t tu_fifo_remaining              (tu_fifo_t* f);
-bool     tu_fifo_empty                  (tu_fifo_t* f);
-bool     tu_fifo_full                   (tu_fifo_t* f);
-bool     tu_fifo_overflowed             (tu_fifo_t* f);
-void     tu_fifo_correct_read_pointer   (tu_fifo_t* f);
+bool           tu_fifo_peek                   (tu_fifo_t* f, void * p_buffer);
+tu_fifo_size_t tu_fifo_peek_n                 (tu_fifo_t* f, void * p_buffer, tu_fifo_size_t n);
+
+tu_fifo_size_t tu_fifo_count                  (tu_fifo_t* f);
+tu_fifo_size_t tu_fifo_remaining              (tu_fifo_t* f);
+bool           tu_fifo_empty                  (tu_fifo_t* f);
+bool           tu_fifo_full                   (tu_fifo_t* f);
+bool           tu_fifo_overflowed             (tu_fifo_t* f);
+void           tu_fifo_correct_read_pointer   (tu_fifo_t* f);
+
+#if CFG_TUSB_FIFO_DROP_OLDEST
+// Number of items an overwritable fifo dropped to make room for new ones since config/clear, wraps around
+TU_ATTR_ALWAYS_INLINE static inline
+uint32_t tu_fifo_dropped(tu_fifo_t const* f) {
+  return f->dropped;
+}
+#endif
 
 TU_ATTR_ALWAYS_INLINE static inline
-uint16_t tu_fifo_depth(tu_fifo_t* f) {
+tu_fifo_size_t tu_fifo_depth(tu_fifo_t* f) {
   return f->depth;
 }
 
 // Pointer modifications intended to be used in combinations with DMAs.
 // USE WITH CARE - NO SAFETY CHECKS CONDUCTED HERE! NOT MUTEX PROTECTED!
-void tu_fifo_advance_write_pointer(tu_fifo_t *f, uint16_t n);
-void tu_fifo_advance_read_pointer (tu_fifo_t *f, uint16_t n);
+void tu_fifo_advance_write_pointer(tu_fifo_t *f, tu_fifo_size_t n);
+void tu_fifo_advance_read_pointer (tu_fifo_t *f, tu_fifo_size_t n);
 
 // If you want to read/write from/to the FIFO by use of a DMA, you may need to conduct two copies
 // to handle a possible wrapping part. These functions deliver a pointer to start
@@ -135,6 +135,7 @@
 #elif TU_CHECK_MCU(OPT_MCU_SAMD21, OPT_MCU_SAMD51, OPT_MCU_SAME5X) || \
       TU_CHECK_MCU(OPT_MCU_SAMD11, OPT_MCU_SAML21, OPT_MCU_SAML22)
   #define TUP_DCD_ENDPOINT_MAX    8
+  #define TUP_DCD_EDPT_XFER_CHAIN // dual-bank endpoints
 
 #elif TU_CHECK_MCU(OPT_MCU_SAMG)
   #define TUP_DCD_ENDPOINT_MAX    6
@@ -344,7 +345,9 @@
 #elif TU_CHECK_MCU(OPT_MCU_RP2040)
   #define TUP_DCD_ENDPOINT_MAX    16
 
-  #define TU_ATTR_FAST_FUNC       __attribute__((section(".time_critical.tinyusb")))
+  #ifndef CFG_TUSB_FAST_FUNC_SECTION
+    #define TU_ATTR_FAST_FUNC     __attribute__((section(".time_critical.tinyusb")))
+  #endif
 
 //--------------------------------------------------------------------+
 // Silabs
@@ -407,6 +410,11 @@
 #elif TU_CHECK_MCU(OPT_MCU_CH32F20X)
   #define TUP_DCD_ENDPOINT_MAX    16
   #define TUP_RHPORT_HIGHSPEED    1
+
+//------------- Virtual -------------//
+#elif TU_CHECK_MCU(OPT_MCU_LOOPBACK)
+  #define TUP_DCD_ENDPOINT_MAX    16
+  #define TUP_RHPORT_HIGHSPEED    1
 #endif
 
 
@@ -439,7 +447,12 @@
   #define TUP_RHPORT_HIGHSPEED    0
 #endif
 
-// fast function, normally mean placing function in SRAM
+// fast function, normally mean placing function in SRAM. Application can override the port default
+// with CFG_TUSB_FAST_FUNC_SECTION e.g ".ramfunc" or ".itcm_text" that its linker script copies into RAM.
+#if defined(CFG_TUSB_FAST_FUNC_SECTION) && !defined(TU_ATTR_FAST_FUNC)
+  #define TU_ATTR_FAST_FUNC       __attribute__((section(CFG_TUSB_FAST_FUNC_SECTION)))
+#endif
+
 #ifndef TU_ATTR_FAST_FUNC
   #define TU_ATTR_FAST_FUNC
 #endif
@@ -452,4 +465,14 @@
   #define TUP_MEM_CONST_ADDR
 #endif
 
+// DCD can transfer more than one packet on control endpoint at once, directly from/to the given buffer
+#if defined(TUP_USBIP_DWC2) || defined(TUP_USBIP_CHIPIDEA_HS)
+  #define TUP_DCD_EDPT0_MULTI_PACKET
+#endif
+
+// DCD can hold several transfers on an endpoint, chained in hardware and completed in order
+#if defined(TUP_USBIP_CHIPIDEA_HS)
+  #define TUP_DCD_EDPT_XFER_CHAIN
+#endif
+
 #endif
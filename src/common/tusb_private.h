@@ -54,10 +54,15 @@ typedef struct {
   uint16_t ep_packetsize;
   uint16_t ep_bufsize;
 
-  // TODO xfer_fifo can skip this buffer
+  // NULL: device controller transfers directly from/to ff with usbd_edpt_xfer_fifo()
   uint8_t* ep_buf;
 
-  tu_fifo_t ff;
+  #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  uint8_t* ep_buf_alt; // second buffer for OUT, swapped with ep_buf on each completed transfer
+  #endif
+
+  tu_fifo_t* ff; // own_ff or fifo shared with another driver, see tu_edpt_stream_share_fifo()
+  tu_fifo_t own_ff;
 
   // mutex: read if ep rx, write if e tx
   OSAL_MUTEX_DEF(ff_mutexdef);
@@ -83,22 +88,75 @@ bool tu_edpt_claim(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 // Release an endpoint with provided mutex
 bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex);
 
+//--------------------------------------------------------------------+
+// Scatter-gather transfer
+// Segments are transferred in place as a whole number of packets, only a packet straddling two segments goes
+// through a one-packet bounce buffer. Controller gets one part at a time, the next one is submitted from the
+// transfer complete ISR.
+//--------------------------------------------------------------------+
+typedef struct {
+  tu_iovec_t const* iov; // NULL if no transfer in progress
+  uint8_t* bounce;       // one packet buffer
+  uint32_t total;        // total length of all segments
+  uint32_t xferred;      // bytes completed by previous parts
+  uint16_t offset;       // position in current segment
+  uint16_t part_len;     // length of part submitted to controller
+  uint16_t mps;
+  uint8_t count;
+  uint8_t idx;           // current segment
+  uint8_t hwid;          // device address (host mode), unused in device mode
+  uint8_t ep_addr;
+  bool part_bounced;
+} tu_sg_xfer_t;
+
+// Start a scatter-gather transfer, bounce buffer must hold at least mps bytes
+void tu_sg_xfer_init(tu_sg_xfer_t* sg, tu_iovec_t const* iov, uint8_t count, uint16_t mps, uint8_t* bounce);
+
+// Get buffer and length of the next part to submit, IN data straddling segments is gathered into bounce buffer
+uint16_t tu_sg_xfer_part(tu_sg_xfer_t* sg, uint8_t** buffer);
+
+// Account for a completed part, OUT data received in bounce buffer is scattered into segments.
+// Return true if there is more to transfer i.e part is not short and not all segments are done
+bool tu_sg_xfer_advance(tu_sg_xfer_t* sg, uint32_t xferred);
+
+// Count value into log2 histogram of CFG_TUSB_STATS_HIST_BINS bins (statistics)
+TU_ATTR_ALWAYS_INLINE static inline void tu_stats_hist_add(uint32_t hist[], uint32_t value) {
+  uint8_t const bin = tu_log2(value);
+  hist[bin < CFG_TUSB_STATS_HIST_BINS ? bin : CFG_TUSB_STATS_HIST_BINS - 1]++;
+}
+
 //--------------------------------------------------------------------+
 // Endpoint Stream
 //--------------------------------------------------------------------+
 
-// Init an endpoint stream
+// Init an endpoint stream. For device stream ep_buf can be NULL for zero-copy transfer from/to the fifo if
+// dcd_edpt_xfer_fifo() is supported, ep_bufsize is then the maximum transfer size
 bool tu_edpt_stream_init(tu_edpt_stream_t* s, bool is_host, bool is_tx, bool overwritable,
                          void* ff_buf, uint16_t ff_bufsize, uint8_t* ep_buf, uint16_t ep_bufsize);
 
 // Deinit an endpoint stream
 bool tu_edpt_stream_deinit(tu_edpt_stream_t* s);
 
+#if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+// Set second endpoint buffer (same size as ep_buf) for OUT stream
+TU_ATTR_ALWAYS_INLINE static inline
+void tu_edpt_stream_set_double_buf(tu_edpt_stream_t* s, uint8_t* ep_buf_alt) {
+  s->ep_buf_alt = ep_buf_alt;
+}
+#endif
+
+// Transfer from/to fifo of another driver instead of own one, e.g to forward a host stream to a device class without
+// copy in between. NULL restores own fifo. Stream must be idle.
+TU_ATTR_ALWAYS_INLINE static inline
+void tu_edpt_stream_share_fifo(tu_edpt_stream_t* s, tu_fifo_t* ff) {
+  s->ff = ff ? ff : &s->own_ff;
+}
+
 // Open an stream for an endpoint
 // hwid is either device address (host mode) or rhport (device mode)
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_edpt_stream_open(tu_edpt_stream_t* s, uint8_t hwid, tusb_desc_endpoint_t const *desc_ep) {
-  tu_fifo_clear(&s->ff);
+  tu_fifo_clear(s->ff);
   s->hwid = hwid;
   s->ep_addr = desc_ep->bEndpointAddress;
   s->ep_packetsize = tu_edpt_packet_size(desc_ep);
@@ -113,7 +171,7 @@ void tu_edpt_stream_close(tu_edpt_stream_t* s) {
 // Clear fifo
 TU_ATTR_ALWAYS_INLINE static inline
 bool tu_edpt_stream_clear(tu_edpt_stream_t* s) {
-  return tu_fifo_clear(&s->ff);
+  return tu_fifo_clear(s->ff);
 }
 
 //--------------------------------------------------------------------+
@@ -132,9 +190,20 @@ bool tu_edpt_stream_write_zlp_if_needed(tu_edpt_stream_t* s, uint32_t last_xferr
 // Get the number of bytes available for writing
 TU_ATTR_ALWAYS_INLINE static inline
 uint32_t tu_edpt_stream_write_available(tu_edpt_stream_t* s) {
-  return (uint32_t) tu_fifo_remaining(&s->ff);
+  return (uint32_t) tu_fifo_remaining(s->ff);
 }
 
+// Get linear and wrapped free space of fifo to be written in place (e.g by DMA), return total bytes available.
+// Data must be committed with tu_edpt_stream_write_commit() before any other write to the stream
+TU_ATTR_ALWAYS_INLINE static inline
+uint32_t tu_edpt_stream_write_reserve(tu_edpt_stream_t* s, tu_fifo_buffer_info_t* info) {
+  tu_fifo_get_write_info(s->ff, info);
+  return (uint32_t) (info->len_lin + info->len_wrap);
+}
+
+// Commit bytes written in place after tu_edpt_stream_write_reserve()
+uint32_t tu_edpt_stream_write_commit(tu_edpt_stream_t* s, uint32_t count);
+
 //--------------------------------------------------------------------+
 // Stream Read
 //--------------------------------------------------------------------+
@@ -145,29 +214,45 @@ uint32_t tu_edpt_stream_read(tu_edpt_stream_t* s, void* buffer, uint32_t bufsize
 // Start an usb transfer if endpoint is not busy
 uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s);
 
-// Must be called in the transfer complete callback
-TU_ATTR_ALWAYS_INLINE static inline
-void tu_edpt_stream_read_xfer_complete(tu_edpt_stream_t* s, uint32_t xferred_bytes) {
-  tu_fifo_write_n(&s->ff, s->ep_buf, (uint16_t) xferred_bytes);
-}
+#if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+// Swap endpoint buffers and start next transfer while keeping pending bytes free in fifo, return completed buffer
+uint8_t* tu_edpt_stream_read_rearm(tu_edpt_stream_t* s, uint32_t pending);
+#endif
 
 // Same as tu_edpt_stream_read_xfer_complete but skip the first n bytes
 TU_ATTR_ALWAYS_INLINE static inline
 void tu_edpt_stream_read_xfer_complete_offset(tu_edpt_stream_t* s, uint32_t xferred_bytes, uint32_t skip_offset) {
-  if (skip_offset < xferred_bytes) {
-    tu_fifo_write_n(&s->ff, s->ep_buf + skip_offset, (uint16_t) (xferred_bytes - skip_offset));
+  uint32_t const count = (skip_offset < xferred_bytes) ? (xferred_bytes - skip_offset) : 0;
+  uint8_t const* ep_buf = s->ep_buf;
+
+  #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  // re-arm endpoint with the other buffer before draining this one
+  if (s->ep_buf_alt) {
+    ep_buf = tu_edpt_stream_read_rearm(s, count);
+  }
+  #endif
+
+  // data is already in fifo with zero-copy transfer
+  if (ep_buf && count) {
+    tu_fifo_write_n(s->ff, ep_buf + skip_offset, (uint16_t) count);
   }
 }
 
+// Must be called in the transfer complete callback
+TU_ATTR_ALWAYS_INLINE static inline
+void tu_edpt_stream_read_xfer_complete(tu_edpt_stream_t* s, uint32_t xferred_bytes) {
+  tu_edpt_stream_read_xfer_complete_offset(s, xferred_bytes, 0);
+}
+
 // Get the number of bytes available for reading
 TU_ATTR_ALWAYS_INLINE static inline
 uint32_t tu_edpt_stream_read_available(tu_edpt_stream_t* s) {
-  return (uint32_t) tu_fifo_count(&s->ff);
+  return (uint32_t) tu_fifo_count(s->ff);
 }
 
 TU_ATTR_ALWAYS_INLINE static inline
 bool tu_edpt_stream_peek(tu_edpt_stream_t* s, uint8_t* ch) {
-  return tu_fifo_peek(&s->ff, ch);
+  return tu_fifo_peek(s->ff, ch);
 }
 
 #ifdef __cplusplus
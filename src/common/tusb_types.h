@@ -225,6 +225,63 @@ typedef enum {
   XFER_RESULT_INVALID
 } xfer_result_t;
 
+// Buffer segment of a scatter-gather transfer
+typedef struct {
+  void* buf;
+  uint16_t len;
+} tu_iovec_t;
+
+//------------- Endpoint buffer -------------//
+// With data cache maintenance (CFG_TUD_MEM_DCACHE_ENABLE, CFG_TUH_MEM_DCACHE_ENABLE) an endpoint buffer must not
+// share a cache line with other data, it is aligned and padded to CFG_TUSB_MEM_DCACHE_LINE_SIZE. These are struct
+// members (anonymous union) so that sizeof(_name) excludes the padding.
+#define TU_DCACHE_ROUNDUP(_size) \
+  ((((_size) + CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1) / CFG_TUSB_MEM_DCACHE_LINE_SIZE) * CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  #define TUD_EPBUF_DCACHE_SIZE(_size)  TU_DCACHE_ROUNDUP(_size)
+  #define TUD_EPBUF_DCACHE_ALIGNED      TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+#else
+  #define TUD_EPBUF_DCACHE_SIZE(_size)  (_size)
+  #define TUD_EPBUF_DCACHE_ALIGNED
+#endif
+
+#if CFG_TUH_MEM_DCACHE_ENABLE
+  #define TUH_EPBUF_DCACHE_SIZE(_size)  TU_DCACHE_ROUNDUP(_size)
+  #define TUH_EPBUF_DCACHE_ALIGNED      TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+#else
+  #define TUH_EPBUF_DCACHE_SIZE(_size)  (_size)
+  #define TUH_EPBUF_DCACHE_ALIGNED
+#endif
+
+// uint8_t _name[_size] endpoint buffer for device stack
+#define TUD_EPBUF_DEF(_name, _size) \
+  union { \
+    CFG_TUD_MEM_ALIGN uint8_t _name[_size]; \
+    TUD_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUD_EPBUF_DCACHE_SIZE(_size)]; \
+  }
+
+// _type _name endpoint buffer for device stack
+#define TUD_EPBUF_TYPE_DEF(_type, _name) \
+  union { \
+    CFG_TUD_MEM_ALIGN _type _name; \
+    TUD_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUD_EPBUF_DCACHE_SIZE(sizeof(_type))]; \
+  }
+
+// uint8_t _name[_size] endpoint buffer for host stack
+#define TUH_EPBUF_DEF(_name, _size) \
+  union { \
+    CFG_TUH_MEM_ALIGN uint8_t _name[_size]; \
+    TUH_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUH_EPBUF_DCACHE_SIZE(_size)]; \
+  }
+
+// _type _name endpoint buffer for host stack
+#define TUH_EPBUF_TYPE_DEF(_type, _name) \
+  union { \
+    CFG_TUH_MEM_ALIGN _type _name; \
+    TUH_EPBUF_DCACHE_ALIGNED uint8_t _name##_dcache_padding[TUH_EPBUF_DCACHE_SIZE(sizeof(_type))]; \
+  }
+
 // TODO remove
 enum {
   DESC_OFFSET_LEN  = 0,
@@ -492,6 +549,21 @@ TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_packet_size(tusb_desc_endpo
   return tu_le16toh(desc_ep->wMaxPacketSize) & 0x7FF;
 }
 
+// Number of transactions per micro-frame (1 to 3) of high-bandwidth highspeed isochronous/interrupt endpoint
+TU_ATTR_ALWAYS_INLINE static inline uint8_t tu_edpt_packet_mult(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint8_t) (1 + ((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x03));
+}
+
+// Maximum number of bytes per service interval i.e packet size x transactions per micro-frame
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tu_edpt_max_payload(tusb_desc_endpoint_t const* desc_ep) {
+  return (uint16_t) (tu_edpt_packet_size(desc_ep) * tu_edpt_packet_mult(desc_ep));
+}
+
+// wMaxPacketSize for a high-bandwidth endpoint carrying up to _bytes (max 3072) per micro-frame, split evenly into
+// 1-3 transactions. Can be used in place of the endpoint size of descriptor templates e.g audio or video ISO EP.
+#define TUSB_EDPT_HIGH_BANDWIDTH_SIZE(_bytes) \
+  ( (((_bytes) + ((_bytes) + 1023) / 1024 - 1) / (((_bytes) + 1023) / 1024)) | (((((_bytes) + 1023) / 1024) - 1) << 11) )
+
 #if CFG_TUSB_DEBUG
 TU_ATTR_ALWAYS_INLINE static inline const char *tu_edpt_type_str(tusb_xfer_type_t t) {
   tu_static const char *str[] = {"control", "isochronous", "bulk", "interrupt"};
@@ -36,24 +36,25 @@
 #endif
 
 //--------------------------------------------------------------------+
-// Configuration
+// MACRO CONSTANT TYPEDEF PROTYPES
 //--------------------------------------------------------------------+
 
-#ifndef CFG_TUD_ENDPPOINT_MAX
-  #define CFG_TUD_ENDPPOINT_MAX   TUP_DCD_ENDPOINT_MAX
+// Max number of transfers usbd submits to DCD on a non-control endpoint before the first one completes.
+// It is more than one only if DCD can chain transfers and large transfer (chunked by usbd) is not used.
+#if defined(TUP_DCD_EDPT_XFER_CHAIN) && CFG_TUD_EDPT_XFER_QUEUE_SZ && !CFG_TUD_LARGE_XFER
+  #define DCD_EDPT_XFER_DEPTH  TU_MIN(CFG_TUD_EDPT_XFER_CHAIN_DEPTH, CFG_TUD_EDPT_XFER_QUEUE_SZ + 1)
+#else
+  #define DCD_EDPT_XFER_DEPTH  1
 #endif
 
-//--------------------------------------------------------------------+
-// MACRO CONSTANT TYPEDEF PROTYPES
-//--------------------------------------------------------------------+
-
 typedef enum {
   DCD_EVENT_INVALID = 0,
   DCD_EVENT_BUS_RESET,
   DCD_EVENT_UNPLUGGED,
   DCD_EVENT_SOF,
-  DCD_EVENT_SUSPEND, // TODO LPM Sleep L1 support
-  DCD_EVENT_RESUME,
+  DCD_EVENT_SUSPEND,
+  DCD_EVENT_RESUME,  // from either suspend (L2) or LPM sleep (L1)
+  DCD_EVENT_LPM_SLEEP, // LPM token acked, link is in sleep (L1)
 
   DCD_EVENT_SETUP_RECEIVED,
   DCD_EVENT_XFER_COMPLETE,
@@ -79,6 +80,12 @@ typedef struct TU_ATTR_ALIGNED(4) {
       uint32_t frame_count;
     }sof;
 
+    // LPM_SLEEP
+    struct {
+      uint8_t besl;          // Best Effort Service Latency requested by host, see tud_lpm_besl_to_us()
+      bool remote_wakeup_en; // bRemoteWake of the LPM token
+    } lpm_sleep;
+
     // SETUP_RECEIVED
     tusb_control_request_t setup_received;
 
@@ -86,6 +93,7 @@ typedef struct TU_ATTR_ALIGNED(4) {
     struct {
       uint8_t  ep_addr;
       uint8_t  result;
+      uint8_t  gen; // set by usbd when queued to a task worker
       uint32_t len;
     }xfer_complete;
 
@@ -95,6 +103,10 @@ typedef struct TU_ATTR_ALIGNED(4) {
       void* param;
     }func_call;
   };
+
+#if CFG_TUD_STATS
+  uint32_t timestamp; // set by usbd when queued
+#endif
 } dcd_event_t;
 
 //TU_VERIFY_STATIC(sizeof(dcd_event_t) <= 12, "size is not correct");
@@ -137,7 +149,7 @@ void dcd_int_disable(uint8_t rhport);
 // Receive Set Address request, mcu port must also include status IN response
 void dcd_set_address(uint8_t rhport, uint8_t dev_addr);
 
-// Wake up host
+// Wake up host, from suspend (L2) or LPM sleep (L1) whichever the bus is in
 void dcd_remote_wakeup(uint8_t rhport);
 
 // Connect by enabling internal pull-up resistor on D+/D-
@@ -157,6 +169,11 @@ void dcd_sof_enable(uint8_t rhport, bool en);
 // May help DCD to prepare for next control transfer, this API is optional.
 void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request_t const * request);
 
+// Invoked by SET_CONFIGURATION with the whole configuration descriptor before any endpoint is opened.
+// DCD can plan endpoint resources (e.g packet memory) for all endpoints and alternate settings at once.
+// This API is optional, return false if configuration can not be supported.
+bool dcd_config_prepare       (uint8_t rhport, tusb_desc_configuration_t const * desc_cfg);
+
 // Configure endpoint's registers according to descriptor
 bool dcd_edpt_open            (uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 
@@ -210,6 +227,14 @@ TU_ATTR_ALWAYS_INLINE static inline  void dcd_event_bus_reset (uint8_t rhport, t
   dcd_event_handler(&event, in_isr);
 }
 
+// helper to send LPM sleep (L1) event
+TU_ATTR_ALWAYS_INLINE static inline void dcd_event_lpm_sleep(uint8_t rhport, uint8_t besl, bool remote_wakeup_en, bool in_isr) {
+  dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_LPM_SLEEP };
+  event.lpm_sleep.besl = besl;
+  event.lpm_sleep.remote_wakeup_en = remote_wakeup_en;
+  dcd_event_handler(&event, in_isr);
+}
+
 // helper to send setup received
 TU_ATTR_ALWAYS_INLINE static inline void dcd_event_setup_received(uint8_t rhport, uint8_t const * setup, bool in_isr) {
   dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_SETUP_RECEIVED };
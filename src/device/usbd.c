@@ -42,6 +42,27 @@
   #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+// Size of a separate queue for control endpoint and bus events (SETUP, EP0 transfer complete, bus reset, unplug,
+// suspend and resume), which usbd task always drains before the other events. This keeps control transfer latency
+// bounded under heavy bulk traffic, while control and bus events stay in order among themselves.
+// 0 means disabled: all events share the same queue
+#ifndef CFG_TUD_TASK_CTRL_QUEUE_SZ
+  #define CFG_TUD_TASK_CTRL_QUEUE_SZ   0
+#endif
+
+// Number of worker queues for class transfer callbacks (RTOS only). Application maps interfaces to workers with
+// tud_task_worker_map_cb() and runs tud_task_worker() of each worker in its own task, so that e.g a blocking
+// storage access in MSC callbacks does not delay other classes. Control requests are always handled by tud_task()
+#ifndef CFG_TUD_TASK_WORKER_NUM
+  #define CFG_TUD_TASK_WORKER_NUM   0
+#endif
+
+#ifndef CFG_TUD_TASK_WORKER_QUEUE_SZ
+  #define CFG_TUD_TASK_WORKER_QUEUE_SZ   CFG_TUD_TASK_QUEUE_SZ
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_TASK_WORKER_NUM <= 4, "CFG_TUD_TASK_WORKER_NUM must be at most 4");
+
 //--------------------------------------------------------------------+
 // Weak stubs: invoked if no strong implementation is available
 //--------------------------------------------------------------------+
@@ -50,12 +71,42 @@ TU_ATTR_WEAK bool dcd_deinit(uint8_t rhport) {
   return false;
 }
 
+TU_ATTR_WEAK bool dcd_config_prepare(uint8_t rhport, tusb_desc_configuration_t const * desc_cfg) {
+  (void) rhport;
+  (void) desc_cfg;
+  return true;
+}
+
 TU_ATTR_WEAK void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr) {
   (void)rhport;
   (void)eventid;
   (void)in_isr;
 }
 
+TU_ATTR_WEAK void tud_task_wakeup_cb(uint8_t rhport, bool in_isr) {
+  (void)rhport;
+  (void)in_isr;
+}
+
+TU_ATTR_WEAK uint32_t tud_stats_timestamp_cb(void) {
+  return 0;
+}
+
+TU_ATTR_WEAK void tud_int_enter_cb(uint8_t rhport) {
+  (void) rhport;
+}
+
+TU_ATTR_WEAK void tud_int_exit_cb(uint8_t rhport, uint32_t duration) {
+  (void) rhport;
+  (void) duration;
+}
+
+TU_ATTR_WEAK uint8_t tud_task_worker_map_cb(uint8_t rhport, tusb_desc_interface_t const* desc_itf) {
+  (void) rhport;
+  (void) desc_itf;
+  return 0;
+}
+
 //--------------------------------------------------------------------+
 // Device Data
 //--------------------------------------------------------------------+
@@ -63,6 +114,57 @@ TU_ATTR_WEAK void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_is
 // Invalid driver ID in itf2drv[] ep2drv[][] mapping
 enum { DRVID_INVALID = 0xFFu };
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+// Transfer waiting for its endpoint to become idle in DCD
+typedef struct {
+  uint8_t* buffer;
+  uint32_t total_bytes;
+} usbd_xfer_desc_t;
+
+typedef struct {
+  usbd_xfer_desc_t desc[CFG_TUD_EDPT_XFER_QUEUE_SZ];
+  volatile uint8_t rd_idx;
+  volatile uint8_t count;   // number of transfers waiting in desc[]
+  volatile uint8_t active;  // number of transfers in progress in DCD, up to DCD_EDPT_XFER_DEPTH
+  uint8_t pending;          // submitted transfers whose completion is not yet processed by usbd task
+
+#if CFG_TUD_EVENT_COALESCE
+  uint32_t merged_len;            // accumulated length of completions merged into the queued event
+  volatile uint8_t merged_count;  // number of completions merged into the queued event, 0 if none
+  volatile uint8_t merge_open;    // no other event of this endpoint is queued after the merged one
+#endif
+} usbd_xfer_queue_t;
+
+// Internal result marking a transfer complete event whose length/count are kept in usbd_xfer_queue_t
+enum { XFER_RESULT_COALESCED = 0x80u };
+#endif
+
+#if CFG_TUD_LARGE_XFER
+// Transfer larger than what DCD can do at once (64 KiB) is split into chunks
+typedef struct {
+  uint8_t* buffer;    // start of current chunk
+  uint32_t remaining; // bytes not yet submitted to DCD
+  uint32_t xferred;   // bytes completed by previous chunks
+  uint16_t chunk_len; // length of current chunk
+  uint16_t mps;       // endpoint max packet size
+} usbd_large_xfer_t;
+#endif
+
+#if CFG_TUD_ITF_INDEX_SZ
+TU_VERIFY_STATIC(CFG_TUD_ITF_INDEX_SZ < 0xFF, "CFG_TUD_ITF_INDEX_SZ must be less than 255");
+
+// Interface descriptors of the active configuration in descriptor order. Alternate settings of an interface
+// are consecutive, therefore first[itf] + alt is normally the entry of that alternate setting
+typedef struct {
+  uint8_t const* desc_cfg;
+  uint16_t ofs[CFG_TUD_ITF_INDEX_SZ];   // offset of interface descriptor within configuration descriptor
+  uint16_t len[CFG_TUD_ITF_INDEX_SZ];   // length up to the next interface (association) descriptor
+  uint8_t first[CFG_TUD_INTERFACE_MAX]; // entry of the first alternate setting
+  uint8_t count[CFG_TUD_INTERFACE_MAX]; // number of entries from first to the last alternate setting, 0 if none
+  uint8_t total;
+} usbd_itf_index_t;
+#endif
+
 typedef struct {
   struct TU_ATTR_PACKED {
     volatile uint8_t connected    : 1;
@@ -72,6 +174,9 @@ typedef struct {
     uint8_t remote_wakeup_en      : 1; // enable/disable by host
     uint8_t remote_wakeup_support : 1; // configuration descriptor's attribute
     uint8_t self_powered          : 1; // configuration descriptor's attribute
+
+    volatile uint8_t lpm_sleep    : 1; // LPM sleep (L1)
+    uint8_t lpm_remote_wakeup_en  : 1; // bRemoteWake of the last LPM token
   };
   volatile uint8_t cfg_num; // current active configuration (0x00 is not configured)
   uint8_t speed;
@@ -82,10 +187,63 @@ typedef struct {
 
   tu_edpt_state_t ep_status[CFG_TUD_ENDPPOINT_MAX][2];
 
+#if CFG_TUD_TASK_WORKER_NUM
+  uint8_t ep2worker[CFG_TUD_ENDPPOINT_MAX][2]; // map endpoint to worker dispatching its xfer_cb (0 is usbd task)
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  usbd_xfer_queue_t xfer_queue[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_LARGE_XFER
+  usbd_large_xfer_t large_xfer[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_XFER_SG
+  uint16_t ep_mps[CFG_TUD_ENDPPOINT_MAX][2];
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+  uint8_t ep_coalesce[CFG_TUD_ENDPPOINT_MAX][2]; // driver opted in by usbd_edpt_xfer_coalesce(), reset by open
+#endif
+
+#if CFG_TUD_ITF_INDEX_SZ
+  usbd_itf_index_t itf_index;
+#endif
+
+#ifdef TUP_DCD_EDPT_ISO_ALLOC
+  uint32_t iso_reserved; // ISO endpoints reserved by iso_plan(), bit (epnum + 16*dir)
+#endif
+
+#if CFG_TUD_BUF_POOL_ENABLED
+  uint32_t buf_pool_used; // bytes of _usbd_buf_pool allocated by drivers of the active configuration
+#endif
+
 }usbd_device_t;
 
 tu_static usbd_device_t _usbd_dev;
 
+#if CFG_TUD_BUF_POOL_ENABLED
+TU_VERIFY_STATIC(CFG_TUD_BUF_POOL_ALIGN >= 4 && (CFG_TUD_BUF_POOL_ALIGN & (CFG_TUD_BUF_POOL_ALIGN - 1)) == 0,
+                 "CFG_TUD_BUF_POOL_ALIGN must be a power of 2 and at least 4");
+
+// Class buffers shared across configurations, see usbd_buf_alloc()
+#if CFG_TUD_BUF_POOL_ARENA
+tu_static uint8_t* _usbd_buf_pool = NULL; // arena passed to tud_init_arena()
+tu_static uint32_t _usbd_buf_pool_sz = 0;
+#else
+CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(CFG_TUD_BUF_POOL_ALIGN) tu_static uint8_t _usbd_buf_pool[CFG_TUD_BUF_POOL_SZ];
+#define _usbd_buf_pool_sz   CFG_TUD_BUF_POOL_SZ
+#endif
+#endif
+
+#if CFG_TUD_STRING_TABLE_SZ
+// UTF-16 string descriptors encoded by tud_string_table_set(), each one is 4-byte aligned for control transfer
+CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(4) tu_static uint8_t _usbd_str_buf[CFG_TUD_STRING_TABLE_SZ];
+tu_static uint16_t _usbd_str_offset[CFG_TUD_STRING_TABLE_MAX]; // offset in _usbd_str_buf, UINT16_MAX for NULL entry
+tu_static volatile uint8_t _usbd_str_count = 0;
+#endif
+
 //--------------------------------------------------------------------+
 // Class Driver
 //--------------------------------------------------------------------+
@@ -97,6 +255,21 @@ tu_static usbd_device_t _usbd_dev;
 
 // Built-in class drivers
 tu_static usbd_class_driver_t const _usbd_driver[] = {
+    #if CFG_TUSB_BRIDGE
+    // first so that application decides which interfaces are bridged
+    {
+        DRIVER_NAME("BRIDGE")
+        .init             = bridged_init,
+        .deinit           = bridged_deinit,
+        .reset            = bridged_reset,
+        .open             = bridged_open,
+        .control_xfer_cb  = bridged_control_xfer_cb,
+        .xfer_cb          = bridged_xfer_cb,
+        .xfer_isr         = NULL,
+        .sof              = NULL
+    },
+    #endif
+
     #if CFG_TUD_CDC
     {
         DRIVER_NAME("CDC")
@@ -106,7 +279,12 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = cdcd_open,
         .control_xfer_cb  = cdcd_control_xfer_cb,
         .xfer_cb          = cdcd_xfer_cb,
+        .xfer_isr         = NULL,
+        #if CFG_TUD_CDC_TX_FLUSH_SOF
+        .sof              = cdcd_sof
+        #else
         .sof              = NULL
+        #endif
     },
     #endif
 
@@ -119,7 +297,12 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = mscd_open,
         .control_xfer_cb  = mscd_control_xfer_cb,
         .xfer_cb          = mscd_xfer_cb,
+        .xfer_isr         = NULL,
+        #if CFG_TUD_MSC_CACHE_LINES && CFG_TUD_MSC_CACHE_FLUSH_SOF
+        .sof              = mscd_sof
+        #else
         .sof              = NULL
+        #endif
     },
     #endif
 
@@ -132,7 +315,12 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = hidd_open,
         .control_xfer_cb  = hidd_control_xfer_cb,
         .xfer_cb          = hidd_xfer_cb,
+        .xfer_isr         = NULL,
+        #if CFG_TUD_HID_SOF_PREPARE
+        .sof              = hidd_sof
+        #else
         .sof              = NULL
+        #endif
     },
     #endif
 
@@ -145,6 +333,11 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = audiod_open,
         .control_xfer_cb  = audiod_control_xfer_cb,
         .xfer_cb          = audiod_xfer_cb,
+        #if CFG_TUD_AUDIO_XFER_ISR
+        .xfer_isr         = audiod_xfer_isr,
+        #else
+        .xfer_isr         = NULL,
+        #endif
         .sof              = audiod_sof_isr
     },
     #endif
@@ -158,7 +351,8 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = videod_open,
         .control_xfer_cb  = videod_control_xfer_cb,
         .xfer_cb          = videod_xfer_cb,
-        .sof              = NULL
+        .xfer_isr         = NULL,
+        .sof              = videod_sof
     },
     #endif
 
@@ -171,6 +365,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .reset            = midid_reset,
         .control_xfer_cb  = midid_control_xfer_cb,
         .xfer_cb          = midid_xfer_cb,
+        .xfer_isr         = NULL,
         .sof              = NULL
     },
     #endif
@@ -184,7 +379,12 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = vendord_open,
         .control_xfer_cb  = tud_vendor_control_xfer_cb,
         .xfer_cb          = vendord_xfer_cb,
+        .xfer_isr         = NULL,
+        #if CFG_TUD_VENDOR_TX_FLUSH_SOF
+        .sof              = vendord_sof
+        #else
         .sof              = NULL
+        #endif
     },
     #endif
 
@@ -197,6 +397,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = usbtmcd_open_cb,
         .control_xfer_cb  = usbtmcd_control_xfer_cb,
         .xfer_cb          = usbtmcd_xfer_cb,
+        .xfer_isr         = NULL,
         .sof              = NULL
     },
     #endif
@@ -210,6 +411,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = dfu_rtd_open,
         .control_xfer_cb  = dfu_rtd_control_xfer_cb,
         .xfer_cb          = NULL,
+        .xfer_isr         = NULL,
         .sof              = NULL
     },
     #endif
@@ -223,6 +425,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = dfu_moded_open,
         .control_xfer_cb  = dfu_moded_control_xfer_cb,
         .xfer_cb          = NULL,
+        .xfer_isr         = NULL,
         .sof              = NULL
     },
     #endif
@@ -236,7 +439,12 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = netd_open,
         .control_xfer_cb  = netd_control_xfer_cb,
         .xfer_cb          = netd_xfer_cb,
-        .sof                  = NULL,
+        .xfer_isr         = NULL,
+        #if CFG_TUD_NCM && CFG_TUD_NCM_IN_AGGREGATION_SOF
+        .sof              = netd_sof
+        #else
+        .sof              = NULL
+        #endif
     },
     #endif
 
@@ -249,6 +457,7 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
         .open             = btd_open,
         .control_xfer_cb  = btd_control_xfer_cb,
         .xfer_cb          = btd_xfer_cb,
+        .xfer_isr         = NULL,
         .sof              = NULL
     },
     #endif
@@ -256,6 +465,41 @@ tu_static usbd_class_driver_t const _usbd_driver[] = {
 
 enum { BUILTIN_DRIVER_COUNT = TU_ARRAY_SIZE(_usbd_driver) };
 
+#if CFG_TUD_DRIVER_STATIC
+// Built-in drivers only: driver count is a compile-time constant so that loops over drivers are unrolled with
+// constant table index, and callbacks of the first drivers are dispatched by a switch with constant index as well.
+// Compiler then calls (and can inline) them directly instead of through function pointers.
+#define TOTAL_DRIVER_COUNT    BUILTIN_DRIVER_COUNT
+TU_VERIFY_STATIC(BUILTIN_DRIVER_COUNT > 0, "CFG_TUD_DRIVER_STATIC requires a built-in class driver");
+
+TU_ATTR_ALWAYS_INLINE static inline usbd_class_driver_t const * get_driver(uint8_t drvid) {
+  return (drvid < BUILTIN_DRIVER_COUNT) ? &_usbd_driver[drvid] : NULL;
+}
+
+#define DRIVER_CASE(_n, _func, ...) \
+  case _n: if ((_n) < BUILTIN_DRIVER_COUNT) return _usbd_driver[(_n) < BUILTIN_DRIVER_COUNT ? (_n) : 0]._func(__VA_ARGS__); break
+
+#define DRIVER_DISPATCH(_drvid, _func, ...) \
+  switch (_drvid) { \
+    DRIVER_CASE(0, _func, __VA_ARGS__); \
+    DRIVER_CASE(1, _func, __VA_ARGS__); \
+    DRIVER_CASE(2, _func, __VA_ARGS__); \
+    DRIVER_CASE(3, _func, __VA_ARGS__); \
+    default: if ((_drvid) < BUILTIN_DRIVER_COUNT) return _usbd_driver[_drvid]._func(__VA_ARGS__); break; \
+  }
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_cb(uint8_t drvid, uint8_t rhport, uint8_t ep_addr,
+                                                        xfer_result_t result, uint32_t xferred_bytes) {
+  DRIVER_DISPATCH(drvid, xfer_cb, rhport, ep_addr, result, xferred_bytes);
+  return false;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_isr(uint8_t drvid, uint8_t rhport, uint8_t ep_addr,
+                                                         xfer_result_t result, uint32_t xferred_bytes) {
+  DRIVER_DISPATCH(drvid, xfer_isr, rhport, ep_addr, result, xferred_bytes);
+  return false;
+}
+#else
 // Additional class drivers implemented by application
 tu_static usbd_class_driver_t const * _app_driver = NULL;
 tu_static uint8_t _app_driver_count = 0;
@@ -275,6 +519,17 @@ TU_ATTR_ALWAYS_INLINE static inline usbd_class_driver_t const * get_driver(uint8
   return driver;
 }
 
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_cb(uint8_t drvid, uint8_t rhport, uint8_t ep_addr,
+                                                        xfer_result_t result, uint32_t xferred_bytes) {
+  return get_driver(drvid)->xfer_cb(rhport, ep_addr, result, xferred_bytes);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_isr(uint8_t drvid, uint8_t rhport, uint8_t ep_addr,
+                                                         xfer_result_t result, uint32_t xferred_bytes) {
+  return get_driver(drvid)->xfer_isr(rhport, ep_addr, result, xferred_bytes);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // DCD Event
 //--------------------------------------------------------------------+
@@ -287,6 +542,79 @@ tu_static uint8_t _usbd_rhport = RHPORT_INVALID;
 OSAL_QUEUE_DEF(usbd_int_set, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
 tu_static osal_queue_t _usbd_q;
 
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+OSAL_QUEUE_DEF(usbd_int_set, _usbd_ctrl_qdef, CFG_TUD_TASK_CTRL_QUEUE_SZ, dcd_event_t);
+tu_static osal_queue_t _usbd_ctrl_q;
+#endif
+
+#if CFG_TUD_TASK_WORKER_NUM
+OSAL_QUEUE_DEF(usbd_int_set, _usbd_worker1_qdef, CFG_TUD_TASK_WORKER_QUEUE_SZ, dcd_event_t);
+#if CFG_TUD_TASK_WORKER_NUM > 1
+OSAL_QUEUE_DEF(usbd_int_set, _usbd_worker2_qdef, CFG_TUD_TASK_WORKER_QUEUE_SZ, dcd_event_t);
+#endif
+#if CFG_TUD_TASK_WORKER_NUM > 2
+OSAL_QUEUE_DEF(usbd_int_set, _usbd_worker3_qdef, CFG_TUD_TASK_WORKER_QUEUE_SZ, dcd_event_t);
+#endif
+#if CFG_TUD_TASK_WORKER_NUM > 3
+OSAL_QUEUE_DEF(usbd_int_set, _usbd_worker4_qdef, CFG_TUD_TASK_WORKER_QUEUE_SZ, dcd_event_t);
+#endif
+
+tu_static osal_queue_def_t* const _usbd_worker_qdef[CFG_TUD_TASK_WORKER_NUM] = {
+  &_usbd_worker1_qdef,
+#if CFG_TUD_TASK_WORKER_NUM > 1
+  &_usbd_worker2_qdef,
+#endif
+#if CFG_TUD_TASK_WORKER_NUM > 2
+  &_usbd_worker3_qdef,
+#endif
+#if CFG_TUD_TASK_WORKER_NUM > 3
+  &_usbd_worker4_qdef,
+#endif
+};
+
+tu_static osal_queue_t _usbd_worker_q[CFG_TUD_TASK_WORKER_NUM];
+
+// One lock per worker, held by that worker for the dispatch of an event so that workers do not serialize each other.
+// configuration_reset() takes all of them and bumps the generation so that events queued to workers before the
+// reset are dropped instead of reaching a re-opened driver
+#if OSAL_MUTEX_REQUIRED
+  tu_static osal_mutex_def_t _usbd_worker_mutexdef[CFG_TUD_TASK_WORKER_NUM];
+  tu_static osal_mutex_t _usbd_worker_mutex[CFG_TUD_TASK_WORKER_NUM];
+  #define worker_mutex(_idx)   _usbd_worker_mutex[_idx]
+#else
+  #define worker_mutex(_idx)   NULL
+#endif
+tu_static volatile uint8_t _usbd_worker_gen;
+#endif
+
+// Critical section for state shared between task and ISR (which may run on the other core)
+OSAL_SPINLOCK_DEF(_usbd_spin, usbd_int_set);
+
+// true while class driver's xfer_isr() is invoked in ISR context
+tu_static volatile bool _usbd_in_xfer_isr = false;
+
+// SOF subscribers: compact list walked by SOF ISR, SOF interrupt is enabled while it is not empty
+typedef struct {
+  void (*sof)(uint8_t rhport, uint32_t frame_count);
+  uint16_t interval;
+  uint16_t countdown;
+} usbd_sof_sub_t;
+
+tu_static usbd_sof_sub_t _usbd_sof_sub[CFG_TUD_SOF_SUBSCRIBER_MAX];
+tu_static volatile uint8_t _usbd_sof_sub_count = 0;
+
+// true while sof() handlers are invoked in ISR context
+tu_static volatile bool _usbd_in_sof_isr = false;
+
+#if CFG_TUD_SETUP_IN_ISR
+// Control events (bus reset, unplugged, setup, EP0 transfer) queued but not yet processed by usbd task. SETUP is
+// only answered in ISR when this is zero so that ISR and usbd task never drive the control endpoint at the same time
+tu_static volatile uint8_t _usbd_ctrl_pending = 0;
+
+// true while current control transfer is answered in ISR, its EP0 completions are then also handled in ISR
+tu_static volatile bool _usbd_ctrl_in_isr = false;
+#endif
+
 // Mutex for claiming endpoint
 #if OSAL_MUTEX_REQUIRED
   tu_static osal_mutex_def_t _ubsd_mutexdef;
@@ -295,9 +623,155 @@ tu_static osal_queue_t _usbd_q;
   #define _usbd_mutex   NULL
 #endif
 
+#if CFG_TUD_STATS
+tu_static tud_stats_t _usbd_stats;
+tu_static uint32_t _usbd_stats_queued; // total events put into queue, minus event_count is current queue depth
+
+TU_ATTR_ALWAYS_INLINE static inline void stats_event_queued(bool in_isr) {
+  osal_spin_lock(&_usbd_spin, in_isr);
+  _usbd_stats_queued++;
+  uint32_t const depth = _usbd_stats_queued - _usbd_stats.event_count;
+  if (depth > _usbd_stats.event_queue_hwm) {
+    _usbd_stats.event_queue_hwm = (uint16_t) depth;
+  }
+  osal_spin_unlock(&_usbd_spin, in_isr);
+}
+
+// event is taken out of queue by usbd task or a worker
+TU_ATTR_ALWAYS_INLINE static inline void stats_event_dispatched(dcd_event_t const* event) {
+  uint32_t const latency = tud_stats_timestamp_cb() - event->timestamp;
+  osal_spin_lock(&_usbd_spin, false);
+  _usbd_stats.event_count++;
+  if (latency > _usbd_stats.event_latency_max) _usbd_stats.event_latency_max = latency;
+  tu_stats_hist_add(_usbd_stats.event_latency_hist, latency);
+  osal_spin_unlock(&_usbd_spin, false);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void stats_xfer_complete(dcd_event_t const* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  tud_stats_edpt_t* ep_stats = &_usbd_stats.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  ep_stats->xfer_count++;
+  ep_stats->xfer_bytes += event->xfer_complete.len;
+  if (event->xfer_complete.result != XFER_RESULT_SUCCESS) ep_stats->xfer_failed++;
+}
+#endif
+
+#if CFG_TUD_SETUP_IN_ISR
+TU_ATTR_ALWAYS_INLINE static inline bool is_ctrl_event(dcd_event_t const* event) {
+  switch (event->event_id) {
+    case DCD_EVENT_BUS_RESET:
+    case DCD_EVENT_UNPLUGGED:
+    case DCD_EVENT_SETUP_RECEIVED:
+      return true;
+
+    case DCD_EVENT_XFER_COMPLETE:
+      return 0 == tu_edpt_number(event->xfer_complete.ep_addr);
+
+    default:
+      return false;
+  }
+}
+#endif
+
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+// Events of control queue: bus events must stay in order with SETUP e.g SETUP right after bus reset is only processed
+// after usbd_reset()
+TU_ATTR_ALWAYS_INLINE static inline bool is_ctrl_queue_event(dcd_event_t const* event) {
+  switch (event->event_id) {
+    case DCD_EVENT_BUS_RESET:
+    case DCD_EVENT_UNPLUGGED:
+    case DCD_EVENT_SUSPEND:
+    case DCD_EVENT_RESUME:
+    case DCD_EVENT_SETUP_RECEIVED:
+      return true;
+
+    case DCD_EVENT_XFER_COMPLETE:
+      return 0 == tu_edpt_number(event->xfer_complete.ep_addr);
+
+    default:
+      return false;
+  }
+}
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline bool queue_is_empty(void) {
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+  if (!osal_queue_empty(_usbd_ctrl_q)) return false;
+#endif
+  return osal_queue_empty(_usbd_q);
+}
+
+#if CFG_TUD_TASK_WORKER_NUM
+// worker handling the event, 0 is usbd task
+TU_ATTR_ALWAYS_INLINE static inline uint8_t event_worker(dcd_event_t const * event) {
+  if (event->event_id != DCD_EVENT_XFER_COMPLETE) return 0;
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  return _usbd_dev.ep2worker[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+#endif
+
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(dcd_event_t const * event, bool in_isr) {
-  TU_ASSERT(osal_queue_send(_usbd_q, event, in_isr));
+  osal_queue_t qhdl = _usbd_q;
+#if CFG_TUD_TASK_WORKER_NUM
+  uint8_t const worker = event_worker(event);
+  dcd_event_t event_gen;
+  if (worker) {
+    qhdl = _usbd_worker_q[worker - 1];
+    event_gen = *event;
+    event_gen.xfer_complete.gen = _usbd_worker_gen;
+    event = &event_gen;
+  }
+#else
+  uint8_t const worker = 0;
+#endif
+
+  // usbd task has nothing to do before this event: notify application to wake up its mainloop
+  bool const wakeup = !worker && queue_is_empty();
+
+#if CFG_TUD_STATS
+  // timestamp to measure latency until usbd task dispatches the event
+  dcd_event_t event_stamped = *event;
+  event_stamped.timestamp = tud_stats_timestamp_cb();
+  event = &event_stamped;
+#endif
+
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+  bool const is_ctrl = is_ctrl_queue_event(event);
+  if (is_ctrl) qhdl = _usbd_ctrl_q;
+#endif
+
+  if (!osal_queue_send(qhdl, event, in_isr)) {
+#if CFG_TUD_STATS
+    osal_spin_lock(&_usbd_spin, in_isr);
+    _usbd_stats.event_dropped++;
+    osal_spin_unlock(&_usbd_spin, in_isr);
+#endif
+    TU_ASSERT(false);
+  }
+#if CFG_TUD_STATS
+  stats_event_queued(in_isr);
+#endif
+
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ && CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
+  if (is_ctrl) {
+    // wake up usbd task blocked on the main queue with an empty function call. If the main queue is full,
+    // usbd task is busy anyway and will pick up control event before the next one.
+    dcd_event_t event_wakeup = *event;
+    event_wakeup.event_id = USBD_EVENT_FUNC_CALL;
+    event_wakeup.func_call.func = NULL;
+    if (osal_queue_send(_usbd_q, &event_wakeup, in_isr)) {
+  #if CFG_TUD_STATS
+      stats_event_queued(in_isr);
+  #endif
+    }
+  }
+#endif
+
   tud_event_hook_cb(event->rhport, event->event_id, in_isr);
+  if (wakeup) {
+    tud_task_wakeup_cb(event->rhport, in_isr);
+  }
   return true;
 }
 
@@ -308,6 +782,35 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num);
 static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const * p_request);
 
+static bool edpt_xfer_start(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes);
+
+#if CFG_TUD_MEM_DCACHE_ENABLE
+static void dcache_xfer_complete(uint8_t ep_addr, uint32_t xferred);
+static void dcache_xfer_clear(uint8_t epnum);
+#endif
+
+#if CFG_TUD_EDPT_XFER_SG
+static bool sg_xfer_continue(dcd_event_t* event);
+static void sg_xfer_clear(uint8_t ep_addr);
+#endif
+
+#if CFG_TUD_LARGE_XFER
+static bool large_xfer_continue(dcd_event_t* event);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+static bool xfer_queue_submit(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes);
+static void xfer_queue_next(uint8_t rhport, uint8_t ep_addr, bool in_isr);
+static bool xfer_queue_retire(uint8_t epnum, uint8_t dir, bool in_isr);
+static void xfer_queue_clear(uint8_t epnum, uint8_t dir);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+static void queue_xfer_event(dcd_event_t const* event, bool in_isr);
+#else
+  #define queue_xfer_event(_event, _in_isr)  (void) queue_event(_event, _in_isr)
+#endif
+
 // from usbd_control.c
 void usbd_control_reset(void);
 void usbd_control_set_request(tusb_control_request_t const *request);
@@ -326,6 +829,7 @@ tu_static char const* const _usbd_event_str[DCD_EVENT_COUNT] = {
     "SOF",
     "Suspend",
     "Resume",
+    "LPM Sleep",
     "Setup Received",
     "Xfer Complete",
     "Func Call"
@@ -363,9 +867,16 @@ bool tud_suspended(void) {
   return _usbd_dev.suspended;
 }
 
+bool tud_lpm_sleeping(void) {
+  return _usbd_dev.lpm_sleep;
+}
+
 bool tud_remote_wakeup(void) {
-  // only wake up host if this feature is supported and enabled and we are suspended
-  TU_VERIFY (_usbd_dev.suspended && _usbd_dev.remote_wakeup_support && _usbd_dev.remote_wakeup_en);
+  // only wake up host if this feature is supported and enabled and we are suspended, or in LPM sleep with
+  // remote wakeup allowed by the LPM token
+  bool const l2_wakeup = _usbd_dev.suspended && _usbd_dev.remote_wakeup_support && _usbd_dev.remote_wakeup_en;
+  bool const l1_wakeup = _usbd_dev.lpm_sleep && _usbd_dev.lpm_remote_wakeup_en;
+  TU_VERIFY(l2_wakeup || l1_wakeup);
   dcd_remote_wakeup(_usbd_rhport);
   return true;
 }
@@ -382,6 +893,70 @@ bool tud_connect(void) {
   return true;
 }
 
+#if CFG_TUD_STRING_TABLE_SZ
+bool tud_string_table_set(char const* const* table, uint8_t count) {
+  TU_VERIFY(count <= CFG_TUD_STRING_TABLE_MAX);
+  _usbd_str_count = 0; // stop serving old table while encoding
+
+  uint32_t offset = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    char const* str = table[i];
+    if (str == NULL) {
+      _usbd_str_offset[i] = UINT16_MAX;
+      continue;
+    }
+
+    // index 0 is LANGID (raw 2 bytes), others are ASCII capped at the max descriptor length
+    size_t const chr_count = (i == 0) ? 1 : tu_min32((uint32_t) strlen(str), (UINT8_MAX - 2) / 2);
+    uint32_t const desc_len = 2 + 2 * (uint32_t) chr_count;
+    TU_VERIFY(offset + desc_len <= CFG_TUD_STRING_TABLE_SZ);
+
+    uint8_t* desc = _usbd_str_buf + offset;
+    desc[0] = (uint8_t) desc_len;
+    desc[1] = TUSB_DESC_STRING;
+    if (i == 0) {
+      memcpy(desc + 2, str, 2);
+    } else {
+      for (size_t c = 0; c < chr_count; c++) {
+        desc[2 + 2 * c] = (uint8_t) str[c];
+        desc[3 + 2 * c] = 0;
+      }
+    }
+
+    _usbd_str_offset[i] = (uint16_t) offset;
+    offset = tu_align4(offset + desc_len + 3);
+  }
+
+  _usbd_str_count = count;
+  return true;
+}
+
+// pre-encoded string descriptor or NULL if not in table
+static uint8_t const* string_table_get(uint8_t index) {
+  if (index >= _usbd_str_count || _usbd_str_offset[index] == UINT16_MAX) return NULL;
+  return _usbd_str_buf + _usbd_str_offset[index];
+}
+#endif
+
+#if CFG_TUD_STATS
+bool tud_stats_get(tud_stats_t* stats) {
+  TU_VERIFY(stats && tud_inited());
+  osal_spin_lock(&_usbd_spin, false);
+  *stats = _usbd_stats;
+  osal_spin_unlock(&_usbd_spin, false);
+  return true;
+}
+
+void tud_stats_clear(void) {
+  bool const inited = tud_inited();
+  if (inited) osal_spin_lock(&_usbd_spin, false);
+  // keep events that are still in queue
+  _usbd_stats_queued -= _usbd_stats.event_count;
+  tu_varclr(&_usbd_stats);
+  if (inited) osal_spin_unlock(&_usbd_spin, false);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USBD Task
 //--------------------------------------------------------------------+
@@ -389,6 +964,23 @@ bool tud_inited(void) {
   return _usbd_rhport != RHPORT_INVALID;
 }
 
+#if CFG_TUD_BUF_POOL_ARENA
+bool tud_init_arena(uint8_t rhport, void* arena, uint32_t arena_size) {
+  // arena can't be swapped while drivers may hold buffers of it
+  TU_VERIFY(!tud_inited());
+
+  // align start of arena
+  uintptr_t const addr = (uintptr_t) arena;
+  uint32_t const pad = (uint32_t) (TUD_BUF_POOL_ALLOC_SZ(addr) - addr);
+  TU_ASSERT(arena && arena_size > pad);
+
+  _usbd_buf_pool = (uint8_t*) arena + pad;
+  _usbd_buf_pool_sz = arena_size - pad;
+
+  return tud_init(rhport);
+}
+#endif
+
 bool tud_init(uint8_t rhport) {
   // skip if already initialized
   if (tud_inited()) return true;
@@ -401,20 +993,52 @@ bool tud_init(uint8_t rhport) {
 
   tu_varclr(&_usbd_dev);
 
+#if CFG_TUD_SETUP_IN_ISR
+  _usbd_ctrl_pending = 0;
+  _usbd_ctrl_in_isr = false;
+#endif
+
+#if CFG_TUD_STATS
+  tu_varclr(&_usbd_stats);
+  _usbd_stats_queued = 0;
+#endif
+
 #if OSAL_MUTEX_REQUIRED
   // Init device mutex
   _usbd_mutex = osal_mutex_create(&_ubsd_mutexdef);
   TU_ASSERT(_usbd_mutex);
 #endif
 
+  osal_spin_init(&_usbd_spin);
+
   // Init device queue & task
   _usbd_q = osal_queue_create(&_usbd_qdef);
   TU_ASSERT(_usbd_q);
 
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+  _usbd_ctrl_q = osal_queue_create(&_usbd_ctrl_qdef);
+  TU_ASSERT(_usbd_ctrl_q);
+#endif
+
+#if CFG_TUD_TASK_WORKER_NUM
+  for (uint8_t i = 0; i < CFG_TUD_TASK_WORKER_NUM; i++) {
+    _usbd_worker_q[i] = osal_queue_create(_usbd_worker_qdef[i]);
+    TU_ASSERT(_usbd_worker_q[i]);
+  }
+  #if OSAL_MUTEX_REQUIRED
+  for (uint8_t i = 0; i < CFG_TUD_TASK_WORKER_NUM; i++) {
+    _usbd_worker_mutex[i] = osal_mutex_create(&_usbd_worker_mutexdef[i]);
+    TU_ASSERT(_usbd_worker_mutex[i]);
+  }
+  #endif
+#endif
+
+#if !CFG_TUD_DRIVER_STATIC
   // Get application driver if available
   if (usbd_app_driver_get_cb) {
     _app_driver = usbd_app_driver_get_cb(&_app_driver_count);
   }
+#endif
 
   // Init class drivers
   for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
@@ -457,6 +1081,24 @@ bool tud_deinit(uint8_t rhport) {
   osal_queue_delete(_usbd_q);
   _usbd_q = NULL;
 
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+  osal_queue_delete(_usbd_ctrl_q);
+  _usbd_ctrl_q = NULL;
+#endif
+
+#if CFG_TUD_TASK_WORKER_NUM
+  for (uint8_t i = 0; i < CFG_TUD_TASK_WORKER_NUM; i++) {
+    osal_queue_delete(_usbd_worker_q[i]);
+    _usbd_worker_q[i] = NULL;
+  }
+  #if OSAL_MUTEX_REQUIRED
+  for (uint8_t i = 0; i < CFG_TUD_TASK_WORKER_NUM; i++) {
+    osal_mutex_delete(_usbd_worker_mutex[i]);
+    _usbd_worker_mutex[i] = NULL;
+  }
+  #endif
+#endif
+
 #if OSAL_MUTEX_REQUIRED
   // TODO make sure there is no task waiting on this mutex
   osal_mutex_delete(_usbd_mutex);
@@ -469,15 +1111,45 @@ bool tud_deinit(uint8_t rhport) {
 }
 
 static void configuration_reset(uint8_t rhport) {
+#if CFG_TUD_TASK_WORKER_NUM
+  // wait for workers to finish their current xfer_cb() and keep them out until drivers and mapping are reset.
+  // Workers only take their own lock, so taking all of them in order cannot deadlock
+  for (uint8_t i = 0; i < CFG_TUD_TASK_WORKER_NUM; i++) {
+    (void) osal_mutex_lock(worker_mutex(i), OSAL_TIMEOUT_WAIT_FOREVER);
+  }
+#endif
+
   for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
     usbd_class_driver_t const* driver = get_driver(i);
     TU_ASSERT(driver,);
     driver->reset(rhport);
   }
 
+  // drivers subscribe to SOF again when opened
+  osal_spin_lock(&_usbd_spin, false);
+  if (_usbd_sof_sub_count) {
+    _usbd_sof_sub_count = 0;
+    dcd_sof_enable(rhport, false);
+  }
+  osal_spin_unlock(&_usbd_spin, false);
+
   tu_varclr(&_usbd_dev);
+#if CFG_TUD_EDPT_XFER_SG
+  sg_xfer_clear(0);
+#endif
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  dcache_xfer_clear(0xff);
+#endif
   memset(_usbd_dev.itf2drv, DRVID_INVALID, sizeof(_usbd_dev.itf2drv)); // invalid mapping
   memset(_usbd_dev.ep2drv, DRVID_INVALID, sizeof(_usbd_dev.ep2drv)); // invalid mapping
+
+#if CFG_TUD_TASK_WORKER_NUM
+  // events already in worker queues (or queued during the reset) belong to the old configuration
+  _usbd_worker_gen++;
+  for (uint8_t i = CFG_TUD_TASK_WORKER_NUM; i > 0; i--) {
+    (void) osal_mutex_unlock(worker_mutex(i - 1));
+  }
+#endif
 }
 
 static void usbd_reset(uint8_t rhport) {
@@ -488,33 +1160,116 @@ static void usbd_reset(uint8_t rhport) {
 bool tud_task_event_ready(void) {
   // Skip if stack is not initialized
   if (!tud_inited()) return false;
-  return !osal_queue_empty(_usbd_q);
+  return !queue_is_empty();
 }
 
-/* USB Device Driver task
- * This top level thread manages all device controller event and delegates events to class-specific drivers.
- * This should be called periodically within the mainloop or rtos thread.
- *
-    int main(void) {
-      application_init();
-      tusb_init();
+bool tud_task_sleep(void (*sleep_func)(void)) {
+  // Called with interrupts masked: an event queued after this check keeps its interrupt pending, which wakes up
+  // sleep_func() right away
+  if (tud_task_event_ready()) return false;
+  sleep_func();
+  return true;
+}
 
-      while(1) { // the mainloop
-        application_code();
-        tud_task(); // tinyusb device task
-      }
+// Invoke the class callback associated with the endpoint address, in usbd task or worker
+static void process_xfer_complete(dcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const ep_dir = tu_edpt_dir(ep_addr);
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+  uint8_t xfer_count = 1;
+  if (event->xfer_complete.result == XFER_RESULT_COALESCED) {
+    usbd_xfer_queue_t* q = &_usbd_dev.xfer_queue[epnum][ep_dir];
+
+    // take merged completions, ISR will queue a new event for the next one
+    osal_spin_lock(&_usbd_spin, false);
+    xfer_count = q->merged_count;
+    event->xfer_complete.len = q->merged_len;
+    event->xfer_complete.result = XFER_RESULT_SUCCESS;
+    q->merged_count = 0;
+    q->merge_open = 0;
+    osal_spin_unlock(&_usbd_spin, false);
+
+    // endpoint is stalled/closed since
+    if (xfer_count == 0) {
+      TU_LOG_USBD("on EP %02X Skipped\r\n", ep_addr);
+      return;
     }
- */
-void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
-  (void) in_isr; // not implemented yet
+  }
+#endif
 
-  // Skip if stack is not initialized
-  if (!tud_inited()) return;
+  TU_LOG_USBD("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event->xfer_complete.len);
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  if (epnum) {
+    // endpoint is only released when all its queued transfers are complete
+  #if CFG_TUD_EVENT_COALESCE
+    while (xfer_count--) {
+      (void) xfer_queue_retire(epnum, ep_dir, false);
+    }
+  #else
+    (void) xfer_queue_retire(epnum, ep_dir, false);
+  #endif
+  } else
+#endif
+  {
+    _usbd_dev.ep_status[epnum][ep_dir].busy = 0;
+    _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+  }
+
+  if (0 == epnum) {
+    usbd_control_xfer_cb(event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                         event->xfer_complete.len);
+  } else {
+    uint8_t const drvid = _usbd_dev.ep2drv[epnum][ep_dir];
+    usbd_class_driver_t const* driver = get_driver(drvid);
+    TU_ASSERT(driver,);
+
+    TU_LOG_USBD("  %s xfer callback\r\n", driver->name);
+    TU_TRACE(TU_TRACE_USBD_CLASS_CB, event->rhport, ep_addr, event->xfer_complete.result, event->xfer_complete.len);
+    driver_xfer_cb(drvid, event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                   event->xfer_complete.len);
+    TU_TRACE(TU_TRACE_USBD_CLASS_END, event->rhport, ep_addr, 0, 0);
+  }
+}
+
+/* USB Device Driver task
+ * This top level thread manages all device controller event and delegates events to class-specific drivers.
+ * This should be called periodically within the mainloop or rtos thread.
+ *
+    int main(void) {
+      application_init();
+      tusb_init();
+
+      while(1) { // the mainloop
+        application_code();
+        tud_task(); // tinyusb device task
+      }
+    }
+ */
+// Process queued events until there is no more or max_events are processed. Return number of processed events
+static uint32_t usbd_task_run(uint32_t timeout_ms, uint32_t max_events) {
+  uint32_t count = 0;
 
   // Loop until there is no more events in the queue
-  while (1) {
+  while (count < max_events) {
     dcd_event_t event;
-    if (!osal_queue_receive(_usbd_q, &event, timeout_ms)) return;
+#if CFG_TUD_TASK_CTRL_QUEUE_SZ
+    // control events take precedence over the rest
+    if (!osal_queue_receive(_usbd_ctrl_q, &event, 0))
+#endif
+    {
+      if (!osal_queue_receive(_usbd_q, &event, timeout_ms)) break;
+    }
+    count++;
+
+#if CFG_TUD_STATS
+    stats_event_dispatched(&event);
+#endif
+
+    TU_TRACE(TU_TRACE_USBD_TASK, event.rhport,
+             event.event_id == DCD_EVENT_XFER_COMPLETE ? event.xfer_complete.ep_addr : 0, event.event_id, 0);
 
 #if CFG_TUSB_DEBUG >= CFG_TUD_LOG_LEVEL
     if (event.event_id == DCD_EVENT_SETUP_RECEIVED) TU_LOG_USBD("\r\n"); // extra line for setup
@@ -561,29 +1316,9 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         }
         break;
 
-      case DCD_EVENT_XFER_COMPLETE: {
-        // Invoke the class callback associated with the endpoint address
-        uint8_t const ep_addr = event.xfer_complete.ep_addr;
-        uint8_t const epnum = tu_edpt_number(ep_addr);
-        uint8_t const ep_dir = tu_edpt_dir(ep_addr);
-
-        TU_LOG_USBD("on EP %02X with %u bytes\r\n", ep_addr, (unsigned int) event.xfer_complete.len);
-
-        _usbd_dev.ep_status[epnum][ep_dir].busy = 0;
-        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
-
-        if (0 == epnum) {
-          usbd_control_xfer_cb(event.rhport, ep_addr, (xfer_result_t) event.xfer_complete.result,
-                               event.xfer_complete.len);
-        } else {
-          usbd_class_driver_t const* driver = get_driver(_usbd_dev.ep2drv[epnum][ep_dir]);
-          TU_ASSERT(driver,);
-
-          TU_LOG_USBD("  %s xfer callback\r\n", driver->name);
-          driver->xfer_cb(event.rhport, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
-        }
+      case DCD_EVENT_XFER_COMPLETE:
+        process_xfer_complete(&event);
         break;
-      }
 
       case DCD_EVENT_SUSPEND:
         // NOTE: When plugging/unplugging device, the D+/D- state are unstable and
@@ -606,6 +1341,11 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         }
         break;
 
+      case DCD_EVENT_LPM_SLEEP:
+        TU_LOG_USBD(": BESL = %u, Remote Wakeup = %u\r\n", event.lpm_sleep.besl, event.lpm_sleep.remote_wakeup_en);
+        if (tud_lpm_sleep_cb) tud_lpm_sleep_cb(event.lpm_sleep.besl, event.lpm_sleep.remote_wakeup_en);
+        break;
+
       case USBD_EVENT_FUNC_CALL:
         TU_LOG_USBD("\r\n");
         if (event.func_call.func) event.func_call.func(event.func_call.param);
@@ -617,12 +1357,71 @@ void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
         break;
     }
 
+#if CFG_TUD_SETUP_IN_ISR
+    if (is_ctrl_event(&event)) {
+      osal_spin_lock(&_usbd_spin, false);
+      _usbd_ctrl_pending--;
+      osal_spin_unlock(&_usbd_spin, false);
+    }
+#endif
+
 #if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
     // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbd_q)) return;
+    if (!tud_task_event_ready()) break;
+#endif
+  }
+
+  return count;
+}
+
+void tud_task_ext(uint32_t timeout_ms, bool in_isr) {
+  (void) in_isr; // not implemented yet
+
+  // Skip if stack is not initialized
+  if (!tud_inited()) return;
+
+  (void) usbd_task_run(timeout_ms, UINT32_MAX);
+}
+
+uint32_t tud_task_budget(uint32_t max_events) {
+  if (!tud_inited()) return 0;
+  return usbd_task_run(0, max_events);
+}
+
+#if CFG_TUD_TASK_WORKER_NUM
+void tud_task_worker(uint8_t worker, uint32_t timeout_ms) {
+  // Skip if stack is not initialized
+  if (!tud_inited()) return;
+  TU_VERIFY(0 < worker && worker <= CFG_TUD_TASK_WORKER_NUM,);
+
+  osal_queue_t const qhdl = _usbd_worker_q[worker - 1];
+
+  while (1) {
+    dcd_event_t event;
+    if (!osal_queue_receive(qhdl, &event, timeout_ms)) return;
+
+#if CFG_TUD_STATS
+    stats_event_dispatched(&event);
+#endif
+
+    TU_LOG_USBD("USBD worker %u Xfer Complete ", worker);
+
+    (void) osal_mutex_lock(worker_mutex(worker - 1), OSAL_TIMEOUT_WAIT_FOREVER);
+    // bus reset or configuration change since event was queued
+    if (event.xfer_complete.gen == _usbd_worker_gen && event_worker(&event) == worker) {
+      process_xfer_complete(&event);
+    } else {
+      TU_LOG_USBD("on EP %02X Skipped\r\n", event.xfer_complete.ep_addr);
+    }
+    (void) osal_mutex_unlock(worker_mutex(worker - 1));
+
+#if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
+    // return if there is no more events, for application to run other background
+    if (osal_queue_empty(qhdl)) return;
 #endif
   }
 }
+#endif
 
 //--------------------------------------------------------------------+
 // Control Request Parser & Handling
@@ -638,6 +1437,8 @@ static bool invoke_class_control(uint8_t rhport, usbd_class_driver_t const * dri
 // This handles the actual request and its response.
 // Returns false if unable to complete the request, causing caller to stall control endpoints.
 static bool process_control_request(uint8_t rhport, tusb_control_request_t const * p_request) {
+  TU_TRACE(TU_TRACE_USBD_CONTROL, rhport, p_request->bmRequestType_bit.recipient, p_request->bRequest,
+           p_request->wLength);
   usbd_control_set_complete_callback(NULL);
   TU_ASSERT(p_request->bmRequestType_bit.type < TUSB_REQ_TYPE_INVALID);
 
@@ -867,6 +1668,169 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
   return true;
 }
 
+#if CFG_TUD_ITF_INDEX_SZ
+// Index all interface descriptors of the configuration, descriptors that do not fit are simply not indexed and
+// usbd_itf_desc_find() returns NULL for them so that drivers fall back to walking the descriptor
+static void itf_index_build(tusb_desc_configuration_t const* desc_cfg) {
+  usbd_itf_index_t* idx = &_usbd_dev.itf_index;
+  uint8_t const* desc_base = (uint8_t const*) desc_cfg;
+  uint8_t const* p_desc = desc_base + sizeof(tusb_desc_configuration_t);
+  uint8_t const* desc_end = desc_base + tu_le16toh(desc_cfg->wTotalLength);
+  uint8_t open_entry = 0xFF; // entry whose length is not yet known
+
+  idx->desc_cfg = desc_base;
+
+  while (p_desc < desc_end) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+    uint16_t const ofs = (uint16_t) (p_desc - desc_base);
+
+    if (desc_type == TUSB_DESC_INTERFACE || desc_type == TUSB_DESC_INTERFACE_ASSOCIATION) {
+      if (open_entry != 0xFF) {
+        idx->len[open_entry] = (uint16_t) (ofs - idx->ofs[open_entry]);
+        open_entry = 0xFF;
+      }
+    }
+
+    if (desc_type == TUSB_DESC_INTERFACE) {
+      uint8_t const itf_num = ((tusb_desc_interface_t const*) p_desc)->bInterfaceNumber;
+      if (idx->total < CFG_TUD_ITF_INDEX_SZ && itf_num < CFG_TUD_INTERFACE_MAX) {
+        uint8_t const entry = idx->total++;
+        idx->ofs[entry] = ofs;
+        if (idx->count[itf_num] == 0) {
+          idx->first[itf_num] = entry;
+        }
+        idx->count[itf_num] = (uint8_t) (entry - idx->first[itf_num] + 1);
+        open_entry = entry;
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  if (open_entry != 0xFF) {
+    idx->len[open_entry] = (uint16_t) ((desc_end - desc_base) - idx->ofs[open_entry]);
+  }
+
+  TU_LOG_USBD("  Indexed %u interface descriptors\r\n", idx->total);
+}
+#endif
+
+tusb_desc_interface_t const* usbd_itf_desc_find(uint8_t itf_num, uint8_t alt, uint16_t* len) {
+#if CFG_TUD_ITF_INDEX_SZ
+  usbd_itf_index_t const* idx = &_usbd_dev.itf_index;
+  TU_VERIFY(itf_num < CFG_TUD_INTERFACE_MAX && idx->count[itf_num], NULL);
+
+  uint8_t const first = idx->first[itf_num];
+  uint8_t const count = idx->count[itf_num];
+
+  // alternate settings are normally numbered in descriptor order, otherwise search the entries of this interface
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t const entry = (uint8_t) (first + ((alt + i) % count));
+    tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) (idx->desc_cfg + idx->ofs[entry]);
+    if (desc_itf->bInterfaceNumber == itf_num && desc_itf->bAlternateSetting == alt) {
+      if (len) {
+        *len = idx->len[entry];
+      }
+      return desc_itf;
+    }
+  }
+#else
+  (void) itf_num;
+  (void) alt;
+  (void) len;
+#endif
+
+  return NULL;
+}
+
+void* usbd_buf_alloc(uint16_t size) {
+#if CFG_TUD_BUF_POOL_ENABLED
+  uint32_t const alloc_sz = TUD_BUF_POOL_ALLOC_SZ(size);
+  if (alloc_sz > _usbd_buf_pool_sz - _usbd_dev.buf_pool_used) {
+    TU_LOG_USBD("  Buffer pool exhausted: %u bytes requested, %lu free\r\n", size,
+                (unsigned long) (_usbd_buf_pool_sz - _usbd_dev.buf_pool_used));
+    return NULL;
+  }
+
+  void* buf = _usbd_buf_pool + _usbd_dev.buf_pool_used;
+  _usbd_dev.buf_pool_used += alloc_sz;
+  return buf;
+#else
+  (void) size;
+  return NULL;
+#endif
+}
+
+#ifdef TUP_DCD_EDPT_ISO_ALLOC
+// Periodic bandwidth per (micro)frame that USB 2.0 (5.6.4) allows for isochronous transfers, together with the
+// protocol overhead of each ISO transaction: 90% of a full-speed frame, 80% of a high-speed micro-frame.
+enum {
+  ISO_BUDGET_FS   = 1350,
+  ISO_OVERHEAD_FS = 9,
+  ISO_BUDGET_HS   = 6000,
+  ISO_OVERHEAD_HS = 38
+};
+
+// Plan all isochronous endpoints of a configuration at once: each endpoint address is reserved with the largest
+// footprint among all alternate settings, and the combined bandwidth assuming every function streams with its
+// largest alternate is checked against the spec limit. Class drivers' later usbd_edpt_iso_alloc() then only hit
+// the reservation, a combination that can not work fails SET_CONFIGURATION instead of a later SET_INTERFACE.
+// Buffer limits are DCD specific, see dcd_edpt_iso_alloc in docs/contributing/porting.rst
+static bool iso_plan(uint8_t rhport, tusb_desc_configuration_t const* desc_cfg) {
+  uint16_t ep_size[CFG_TUD_ENDPPOINT_MAX][2] = {{0}};
+  uint16_t ep_bw[CFG_TUD_ENDPPOINT_MAX][2] = {{0}};
+
+  bool const highspeed = (_usbd_dev.speed == TUSB_SPEED_HIGH);
+  uint16_t const overhead = highspeed ? ISO_OVERHEAD_HS : ISO_OVERHEAD_FS;
+
+  uint8_t const* p_desc = (uint8_t const*) desc_cfg;
+  uint8_t const* desc_end = p_desc + tu_le16toh(desc_cfg->wTotalLength);
+
+  while (p_desc < desc_end) {
+    if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      if (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+        uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+        uint8_t const dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+        TU_ASSERT(epnum < CFG_TUD_ENDPPOINT_MAX);
+
+        uint16_t const size = tu_edpt_max_payload(desc_ep);
+        ep_size[epnum][dir] = tu_max16(ep_size[epnum][dir], size);
+
+        // bInterval is 2^(n-1) (micro)frames for ISO, average the footprint over it
+        uint8_t const interval = (uint8_t) (TU_MIN(TU_MAX(desc_ep->bInterval, 1u), 16u) - 1u);
+        uint32_t const bytes = size + (uint32_t) tu_edpt_packet_mult(desc_ep) * overhead;
+        uint16_t const bw = (uint16_t) tu_div_ceil(bytes, TU_BIT(interval));
+        ep_bw[epnum][dir] = tu_max16(ep_bw[epnum][dir], bw);
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  uint32_t bw_total = 0;
+  for (uint8_t epnum = 1; epnum < CFG_TUD_ENDPPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      if (ep_size[epnum][dir] == 0) {
+        continue;
+      }
+      bw_total += ep_bw[epnum][dir];
+
+      uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+      TU_LOG_USBD("  ISO plan: EP %02X reserve %u bytes, %u bytes/frame\r\n", ep_addr, ep_size[epnum][dir],
+                  ep_bw[epnum][dir]);
+      TU_ASSERT(dcd_edpt_iso_alloc(rhport, ep_addr, ep_size[epnum][dir]));
+      _usbd_dev.iso_reserved |= TU_BIT(epnum + 16u * dir);
+    }
+  }
+
+  uint32_t const budget = highspeed ? ISO_BUDGET_HS : ISO_BUDGET_FS;
+  TU_LOG_USBD("  ISO plan: %lu of %lu bytes/frame\r\n", (unsigned long) bw_total, (unsigned long) budget);
+  TU_ASSERT(bw_total <= budget);
+
+  return true;
+}
+#endif
+
 // Process Set Configure Request
 // This function parse configuration descriptor & open drivers accordingly
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
@@ -879,6 +1843,21 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
   _usbd_dev.remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1u : 0u;
   _usbd_dev.self_powered          = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED ) ? 1u : 0u;
 
+#if CFG_TUD_ITF_INDEX_SZ
+  // Index interfaces first, drivers may already look up alternate settings when opened
+  itf_index_build(desc_cfg);
+#endif
+
+  // Let DCD plan endpoint resources of the whole configuration
+  TU_ASSERT(dcd_config_prepare(rhport, desc_cfg));
+
+#ifdef TUP_DCD_EDPT_ISO_ALLOC
+  // Reserve ISO buffers and check their bandwidth for all functions together before any driver is opened
+  if (dcd_edpt_iso_alloc) {
+    TU_ASSERT(iso_plan(rhport, desc_cfg));
+  }
+#endif
+
   // Parse interface descriptor
   uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
   uint8_t const * desc_end = ((uint8_t const*) desc_cfg) + tu_le16toh(desc_cfg->wTotalLength);
@@ -947,6 +1926,13 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
         // bind all endpoints to found driver
         tu_edpt_bind_driver(_usbd_dev.ep2drv, desc_itf, drv_len, drv_id);
 
+        #if CFG_TUD_TASK_WORKER_NUM
+        // transfer callbacks of these endpoints are dispatched to worker chosen by application
+        uint8_t const worker = tud_task_worker_map_cb(rhport, desc_itf);
+        TU_ASSERT(worker <= CFG_TUD_TASK_WORKER_NUM);
+        tu_edpt_bind_driver(_usbd_dev.ep2worker, desc_itf, drv_len, worker);
+        #endif
+
         // next Interface
         p_desc += drv_len;
 
@@ -958,6 +1944,11 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
     TU_ASSERT(drv_id < TOTAL_DRIVER_COUNT);
   }
 
+#if CFG_TUD_BUF_POOL_ENABLED
+  TU_LOG_USBD("  Buffer pool: %lu of %lu bytes used\r\n", (unsigned long) _usbd_dev.buf_pool_used,
+              (unsigned long) _usbd_buf_pool_sz);
+#endif
+
   return true;
 }
 
@@ -1041,7 +2032,14 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
       TU_LOG_USBD(" String[%u]\r\n", desc_index);
 
       // String Descriptor always uses the desc set from user
-      uint8_t const* desc_str = (uint8_t const*) tud_descriptor_string_cb(desc_index, tu_le16toh(p_request->wIndex));
+      uint8_t const* desc_str = NULL;
+      #if CFG_TUD_STRING_TABLE_SZ
+      desc_str = string_table_get(desc_index);
+      #endif
+      if (desc_str == NULL) {
+        TU_VERIFY(tud_descriptor_string_cb);
+        desc_str = (uint8_t const*) tud_descriptor_string_cb(desc_index, tu_le16toh(p_request->wIndex));
+      }
       TU_VERIFY(desc_str);
 
       // first byte of descriptor is its size
@@ -1070,7 +2068,105 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+#if CFG_TUD_STATS || CFG_TUD_INT_HOOK
+TU_ATTR_FAST_FUNC void tud_int_handler_ext(uint8_t rhport) {
+#if CFG_TUD_INT_HOOK
+  tud_int_enter_cb(rhport);
+#endif
+
+  uint32_t const start = tud_stats_timestamp_cb();
+  dcd_int_handler(rhport);
+  uint32_t const duration = tud_stats_timestamp_cb() - start;
+
+#if CFG_TUD_STATS
+  osal_spin_lock(&_usbd_spin, true);
+  _usbd_stats.isr_count++;
+  if (duration > _usbd_stats.isr_duration_max) _usbd_stats.isr_duration_max = duration;
+  tu_stats_hist_add(_usbd_stats.isr_duration_hist, duration);
+  osal_spin_unlock(&_usbd_spin, true);
+#endif
+
+#if CFG_TUD_INT_HOOK
+  tud_int_exit_cb(rhport, duration);
+#endif
+}
+#endif
+
+#if CFG_TUD_SETUP_IN_ISR
+// Answer simple standard request in ISR, return false to defer it to usbd task
+TU_ATTR_FAST_FUNC static bool setup_isr_process(uint8_t rhport, tusb_control_request_t const* request) {
+  // usbd task is still catching up with control events, or previous control transfer is not complete
+  if (_usbd_ctrl_pending || _usbd_dev.ep_status[0][TUSB_DIR_OUT].busy || _usbd_dev.ep_status[0][TUSB_DIR_IN].busy) {
+    return false;
+  }
+
+  // standard, device recipient, IN direction
+  if (request->bmRequestType != 0x80) return false;
+
+  if (request->bRequest == TUSB_REQ_GET_DESCRIPTOR) {
+    switch (tu_u16_high(request->wValue)) {
+      case TUSB_DESC_DEVICE:
+      case TUSB_DESC_CONFIGURATION:
+      case TUSB_DESC_STRING:
+      case TUSB_DESC_BOS:
+      case TUSB_DESC_DEVICE_QUALIFIER:
+        break;
+
+      default: return false;
+    }
+  } else if (request->bRequest != TUSB_REQ_GET_STATUS) {
+    return false;
+  }
+
+  TU_TRACE(TU_TRACE_USBD_CONTROL, rhport, request->bmRequestType_bit.recipient, request->bRequest, request->wLength);
+
+  _usbd_dev.connected = 1;
+  _usbd_ctrl_in_isr = true;
+  usbd_control_set_complete_callback(NULL);
+
+  bool ret;
+  if (request->bRequest == TUSB_REQ_GET_STATUS) {
+    uint16_t status = (uint16_t) ((_usbd_dev.self_powered ? 1u : 0u) | (_usbd_dev.remote_wakeup_en ? 2u : 0u));
+    ret = tud_control_xfer(rhport, request, &status, 2);
+  } else {
+    ret = process_get_descriptor(rhport, request);
+  }
+
+  if (!ret) {
+    _usbd_ctrl_in_isr = false;
+    dcd_edpt_stall(rhport, 0);
+    dcd_edpt_stall(rhport, 0 | TUSB_DIR_IN_MASK);
+  }
+
+  return true;
+}
+
+// EP0 transfer complete of a control transfer answered in ISR
+TU_ATTR_FAST_FUNC static void control_xfer_isr(dcd_event_t const* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const ep_dir = tu_edpt_dir(ep_addr);
+
+  _usbd_dev.ep_status[0][ep_dir].busy = 0;
+  _usbd_dev.ep_status[0][ep_dir].claimed = 0;
+
+  // all requests answered in ISR are IN: OUT completion is the status stage
+  if (ep_dir == TUSB_DIR_OUT) {
+    _usbd_ctrl_in_isr = false;
+  }
+
+  usbd_control_xfer_cb(event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+}
+#endif
+
 TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr) {
+#if CFG_TUD_STATS
+  uint32_t const isr_start = tud_stats_timestamp_cb();
+#endif
+
+  TU_TRACE(TU_TRACE_DCD_EVENT, event->rhport,
+           event->event_id == DCD_EVENT_XFER_COMPLETE ? event->xfer_complete.ep_addr : 0, event->event_id,
+           event->event_id == DCD_EVENT_XFER_COMPLETE ? event->xfer_complete.len : 0);
+
   bool send = false;
   switch (event->event_id) {
     case DCD_EVENT_UNPLUGGED:
@@ -1078,6 +2174,7 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
       _usbd_dev.addressed = 0;
       _usbd_dev.cfg_num = 0;
       _usbd_dev.suspended = 0;
+      _usbd_dev.lpm_sleep = 0;
       send = true;
       break;
 
@@ -1087,6 +2184,10 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
       // In addition, some MCUs such as SAMD or boards that haven no VBUS detection cannot distinguish
       // suspended vs disconnected. We will skip handling SUSPEND/RESUME event if not currently connected
       if (_usbd_dev.connected) {
+        #if CFG_TUD_EVENT_COALESCE
+        // already suspended
+        if (_usbd_dev.suspended) break;
+        #endif
         _usbd_dev.suspended = 1;
         send = true;
       }
@@ -1095,7 +2196,21 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
     case DCD_EVENT_RESUME:
       // skip event if not connected (especially required for SAMD)
       if (_usbd_dev.connected) {
+        #if CFG_TUD_EVENT_COALESCE
+        // already resumed e.g by SOF
+        if (!_usbd_dev.suspended && !_usbd_dev.lpm_sleep) break;
+        #endif
         _usbd_dev.suspended = 0;
+        _usbd_dev.lpm_sleep = 0;
+        send = true;
+      }
+      break;
+
+    case DCD_EVENT_LPM_SLEEP:
+      // L1 is only entered from the configured, active state
+      if (_usbd_dev.connected) {
+        _usbd_dev.lpm_sleep = 1;
+        _usbd_dev.lpm_remote_wakeup_en = event->lpm_sleep.remote_wakeup_en ? 1u : 0u;
         send = true;
       }
       break;
@@ -1103,37 +2218,140 @@ TU_ATTR_FAST_FUNC void dcd_event_handler(dcd_event_t const* event, bool in_isr)
     case DCD_EVENT_SOF:
       // Some MCUs after running dcd_remote_wakeup() does not have way to detect the end of remote wakeup
       // which last 1-15 ms. DCD can use SOF as a clear indicator that bus is back to operational
-      if (_usbd_dev.suspended) {
+      if (_usbd_dev.suspended || _usbd_dev.lpm_sleep) {
         _usbd_dev.suspended = 0;
+        _usbd_dev.lpm_sleep = 0;
 
         dcd_event_t const event_resume = {.rhport = event->rhport, .event_id = DCD_EVENT_RESUME};
         queue_event(&event_resume, in_isr);
       }
 
-      // SOF driver handler in ISR context
-      for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
-        usbd_class_driver_t const* driver = get_driver(i);
-        if (driver && driver->sof) {
-          driver->sof(event->rhport, event->sof.frame_count);
+      // SOF handler of subscribed drivers in ISR context. Walk backward so that a handler can (un)subscribe itself:
+      // removal moves the last (already visited) entry into its slot, new entry is appended and starts next frame
+      _usbd_in_sof_isr = true;
+      for (uint8_t i = _usbd_sof_sub_count; i > 0; i--) {
+        usbd_sof_sub_t* sub = &_usbd_sof_sub[i - 1];
+        if (--sub->countdown == 0) {
+          sub->countdown = sub->interval;
+          sub->sof(event->rhport, event->sof.frame_count);
         }
       }
+      _usbd_in_sof_isr = false;
 
       // skip osal queue for SOF in usbd task
       break;
 
     case DCD_EVENT_SETUP_RECEIVED:
+      #if CFG_TUD_MEM_DCACHE_ENABLE
+      // setup packet supersedes control transfer in progress
+      dcache_xfer_clear(0);
+      #endif
+      #if CFG_TUD_SETUP_IN_ISR
+      if (setup_isr_process(event->rhport, &event->setup_received)) break;
+      #endif
       _usbd_dev.setup_count++;
       send = true;
       break;
 
+    case DCD_EVENT_XFER_COMPLETE: {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      uint8_t const epnum = tu_edpt_number(ep_addr);
+      uint8_t const ep_dir = tu_edpt_dir(ep_addr);
+
+      #if CFG_TUD_MEM_DCACHE_ENABLE
+      dcache_xfer_complete(ep_addr, event->xfer_complete.len);
+      #endif
+
+      if (0 == epnum) {
+        #if CFG_TUD_STATS
+        stats_xfer_complete(event);
+        #endif
+        #if CFG_TUD_SETUP_IN_ISR
+        if (_usbd_ctrl_in_isr) {
+          control_xfer_isr(event);
+          break;
+        }
+        #endif
+        send = true;
+        break;
+      }
+
+      #if CFG_TUD_LARGE_XFER || CFG_TUD_EDPT_XFER_SG
+      // submit next part/chunk if this is part of a scatter-gather or large transfer, otherwise update event with
+      // total length
+      dcd_event_t event_large = *event;
+      #if CFG_TUD_EDPT_XFER_SG
+      if (sg_xfer_continue(&event_large)) break;
+      #endif
+      #if CFG_TUD_LARGE_XFER
+      if (large_xfer_continue(&event_large)) break;
+      #endif
+      event = &event_large;
+      #endif
+
+      #if CFG_TUD_STATS
+      stats_xfer_complete(event);
+      #endif
+
+      uint8_t const drvid = _usbd_dev.ep2drv[epnum][ep_dir];
+      usbd_class_driver_t const* driver = get_driver(drvid);
+      if (driver && driver->xfer_isr) {
+        #if CFG_TUD_EDPT_XFER_QUEUE_SZ
+        // hand the next queued transfer (if any) to DCD before invoking driver
+        xfer_queue_next(event->rhport, ep_addr, in_isr);
+        #else
+        // mark endpoint as ready so that driver can re-arm it within xfer_isr()
+        _usbd_dev.ep_status[epnum][ep_dir].busy = 0;
+        _usbd_dev.ep_status[epnum][ep_dir].claimed = 0;
+        #endif
+
+        _usbd_in_xfer_isr = in_isr;
+        bool const consumed = driver_xfer_isr(drvid, event->rhport, ep_addr,
+                                              (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+        _usbd_in_xfer_isr = false;
+
+        if (consumed) {
+          #if CFG_TUD_EDPT_XFER_QUEUE_SZ
+          (void) xfer_queue_retire(epnum, ep_dir, in_isr);
+          #endif
+        } else {
+          // defer to xfer_cb() in usbd task
+          queue_xfer_event(event, in_isr);
+        }
+        break;
+      }
+
+      queue_xfer_event(event, in_isr);
+
+      #if CFG_TUD_EDPT_XFER_QUEUE_SZ
+      // hand the next queued transfer (if any) to DCD right away
+      xfer_queue_next(event->rhport, ep_addr, in_isr);
+      #endif
+      break;
+    }
+
     default:
       send = true;
       break;
   }
 
   if (send) {
+    #if CFG_TUD_SETUP_IN_ISR
+    if (is_ctrl_event(event)) {
+      // usbd task takes over the control endpoint
+      osal_spin_lock(&_usbd_spin, in_isr);
+      _usbd_ctrl_pending++;
+      _usbd_ctrl_in_isr = false;
+      osal_spin_unlock(&_usbd_spin, in_isr);
+    }
+    #endif
     queue_event(event, in_isr);
   }
+
+#if CFG_TUD_STATS
+  uint32_t const isr_time = tud_stats_timestamp_cb() - isr_start;
+  if (isr_time > _usbd_stats.isr_time_max) _usbd_stats.isr_time_max = isr_time;
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -1151,6 +2369,14 @@ void usbd_int_set(bool enabled)
   }
 }
 
+void usbd_spin_lock(bool in_isr) {
+  osal_spin_lock(&_usbd_spin, in_isr);
+}
+
+void usbd_spin_unlock(bool in_isr) {
+  osal_spin_unlock(&_usbd_spin, in_isr);
+}
+
 // Parse consecutive endpoint descriptors (IN & OUT)
 bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in)
 {
@@ -1197,9 +2423,30 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
   TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < CFG_TUD_ENDPPOINT_MAX);
   TU_ASSERT(tu_edpt_validate(desc_ep, (tusb_speed_t) _usbd_dev.speed));
 
+#if CFG_TUD_LARGE_XFER
+  _usbd_dev.large_xfer[tu_edpt_number(desc_ep->bEndpointAddress)][tu_edpt_dir(desc_ep->bEndpointAddress)].mps =
+    tu_edpt_packet_size(desc_ep);
+#endif
+#if CFG_TUD_EDPT_XFER_SG
+  _usbd_dev.ep_mps[tu_edpt_number(desc_ep->bEndpointAddress)][tu_edpt_dir(desc_ep->bEndpointAddress)] =
+    tu_edpt_packet_size(desc_ep);
+#endif
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+  _usbd_dev.ep_coalesce[tu_edpt_number(desc_ep->bEndpointAddress)][tu_edpt_dir(desc_ep->bEndpointAddress)] = 0;
+#endif
+
   return dcd_edpt_open(rhport, desc_ep);
 }
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+void usbd_edpt_xfer_coalesce(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum > 0 && epnum < CFG_TUD_ENDPPOINT_MAX,);
+  _usbd_dev.ep_coalesce[epnum][tu_edpt_dir(ep_addr)] = 1;
+}
+#endif
+
 bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr) {
   (void) rhport;
 
@@ -1223,8 +2470,9 @@ bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr) {
   return tu_edpt_release(ep_state, _usbd_mutex);
 }
 
-bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes) {
   rhport = _usbd_rhport;
+  TU_TRACE(TU_TRACE_USBD_XFER, rhport, ep_addr, 0, total_bytes);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
@@ -1232,13 +2480,25 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
   // TODO skip ready() check for now since enumeration also use this API
   // TU_VERIFY(tud_ready());
 
-  TU_LOG_USBD("  Queue EP %02X with %u bytes ...\r\n", ep_addr, total_bytes);
+  TU_LOG_USBD("  Queue EP %02X with %u bytes ...\r\n", ep_addr, (unsigned int) total_bytes);
+
+#if CFG_TUD_LARGE_XFER
+  TU_ASSERT(epnum || total_bytes <= UINT16_MAX);
+#else
+  TU_ASSERT(total_bytes <= UINT16_MAX);
+#endif
 #if CFG_TUD_LOG_LEVEL >= 3
   if(dir == TUSB_DIR_IN) {
     TU_LOG_MEM(CFG_TUD_LOG_LEVEL, buffer, total_bytes, 2);
   }
 #endif
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  if (epnum) {
+    return xfer_queue_submit(rhport, ep_addr, buffer, total_bytes);
+  }
+#endif
+
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
 
@@ -1246,7 +2506,22 @@ bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t t
   // could return and USBD task can preempt and clear the busy
   _usbd_dev.ep_status[epnum][dir].busy = 1;
 
-  if (dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes)) {
+#if CFG_TUD_MEM_DCACHE_ENABLE && CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+  bool started;
+  if (dir == TUSB_DIR_OUT && total_bytes) {
+    // bounce buffers are also taken by transfers submitted from ISR
+    bool const in_isr = _usbd_in_xfer_isr;
+    osal_spin_lock(&_usbd_spin, in_isr);
+    started = edpt_xfer_start(rhport, ep_addr, buffer, total_bytes);
+    osal_spin_unlock(&_usbd_spin, in_isr);
+  } else {
+    started = edpt_xfer_start(rhport, ep_addr, buffer, total_bytes);
+  }
+#else
+  bool const started = edpt_xfer_start(rhport, ep_addr, buffer, total_bytes);
+#endif
+
+  if (started) {
     return true;
   } else {
     // DCD error, mark endpoint as ready to allow next transfer
@@ -1268,7 +2543,10 @@ bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
-  TU_LOG_USBD("  Queue ISO EP %02X with %u bytes ... ", ep_addr, total_bytes);
+  TU_LOG_USBD("  Queue EP %02X with %u bytes (fifo) ... ", ep_addr, total_bytes);
+
+  // not all controllers support transfer with fifo
+  TU_ASSERT(dcd_edpt_xfer_fifo);
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(_usbd_dev.ep_status[epnum][dir].busy == 0);
@@ -1310,6 +2588,18 @@ void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
   dcd_edpt_stall(rhport, ep_addr);
   _usbd_dev.ep_status[epnum][dir].stalled = 1;
   _usbd_dev.ep_status[epnum][dir].busy = 1;
+
+#if CFG_TUD_STATS
+  _usbd_stats.edpt[epnum][dir].stall_count++;
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  // stalling removes any transfer queued in DCD, do the same for our queue
+  xfer_queue_clear(epnum, dir);
+#endif
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  if (dir == TUSB_DIR_OUT) dcache_xfer_clear(epnum);
+#endif
 }
 
 void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
@@ -1352,15 +2642,67 @@ void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
   _usbd_dev.ep_status[epnum][dir].busy = 0;
   _usbd_dev.ep_status[epnum][dir].claimed = 0;
 
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  xfer_queue_clear(epnum, dir);
+#endif
+#if CFG_TUD_EDPT_XFER_SG
+  sg_xfer_clear(ep_addr);
+#endif
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  if (dir == TUSB_DIR_OUT) dcache_xfer_clear(epnum);
+#endif
+
   return;
 }
 
-void usbd_sof_enable(uint8_t rhport, bool en) {
+bool usbd_sof_subscribe(uint8_t rhport, void (*sof)(uint8_t rhport, uint32_t frame_count), uint16_t interval) {
   rhport = _usbd_rhport;
+  TU_ASSERT(sof);
+
+  bool const in_isr = _usbd_in_sof_isr || _usbd_in_xfer_isr;
+  bool ret = true;
+
+  osal_spin_lock(&_usbd_spin, in_isr);
+  uint8_t const prev_count = _usbd_sof_sub_count;
+  uint8_t count = prev_count;
+
+  uint8_t idx = 0;
+  while (idx < count && _usbd_sof_sub[idx].sof != sof) idx++;
+
+  if (interval) {
+    if (idx == count) {
+      if (count < CFG_TUD_SOF_SUBSCRIBER_MAX) {
+        _usbd_sof_sub[idx].sof = sof;
+        count++;
+      } else {
+        ret = false;
+      }
+    }
+    if (ret) {
+      _usbd_sof_sub[idx].interval = interval;
+      _usbd_sof_sub[idx].countdown = interval;
+    }
+  } else if (idx < count) {
+    // keep list compact
+    count--;
+    _usbd_sof_sub[idx] = _usbd_sof_sub[count];
+  }
+
+  _usbd_sof_sub_count = count;
+
+  // SOF interrupt is only needed while there is a subscriber
+  if ((prev_count == 0) != (count == 0)) dcd_sof_enable(rhport, count > 0);
+  osal_spin_unlock(&_usbd_spin, in_isr);
 
-  // TODO: Check needed if all drivers including the user sof_cb does not need an active SOF ISR any more.
-  // Only if all drivers switched off SOF calls the SOF interrupt may be disabled
-  dcd_sof_enable(rhport, en);
+  TU_ASSERT(ret);
+  return true;
+}
+
+void usbd_sof_enable(uint8_t rhport, bool en) {
+  for (uint8_t i = 0; i < TOTAL_DRIVER_COUNT; i++) {
+    usbd_class_driver_t const* driver = get_driver(i);
+    if (driver && driver->sof) usbd_sof_subscribe(rhport, driver->sof, en ? 1 : 0);
+  }
 }
 
 bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
@@ -1369,6 +2711,14 @@ bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packe
   TU_ASSERT(dcd_edpt_iso_alloc);
   TU_ASSERT(tu_edpt_number(ep_addr) < CFG_TUD_ENDPPOINT_MAX);
 
+#ifdef TUP_DCD_EDPT_ISO_ALLOC
+  // already reserved with the largest size of all its alternate settings by iso_plan()
+  if (_usbd_dev.iso_reserved & TU_BIT(tu_edpt_number(ep_addr) + 16u * tu_edpt_dir(ep_addr))) {
+    (void) largest_packet_size;
+    return true;
+  }
+#endif
+
   return dcd_edpt_iso_alloc(rhport, ep_addr, largest_packet_size);
 }
 
@@ -1385,7 +2735,503 @@ bool usbd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep)
   _usbd_dev.ep_status[epnum][dir].stalled = 0;
   _usbd_dev.ep_status[epnum][dir].busy = 0;
   _usbd_dev.ep_status[epnum][dir].claimed = 0;
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+  xfer_queue_clear(epnum, dir);
+#endif
+#if CFG_TUD_LARGE_XFER
+  _usbd_dev.large_xfer[epnum][dir].mps = tu_edpt_packet_size(desc_ep);
+#endif
+#if CFG_TUD_EDPT_XFER_SG
+  _usbd_dev.ep_mps[epnum][dir] = tu_edpt_packet_size(desc_ep);
+  sg_xfer_clear(desc_ep->bEndpointAddress);
+#endif
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+  _usbd_dev.ep_coalesce[epnum][dir] = 0;
+#endif
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  if (dir == TUSB_DIR_OUT) dcache_xfer_clear(epnum);
+#endif
   return dcd_edpt_iso_activate(rhport, desc_ep);
 }
 
+//--------------------------------------------------------------------+
+// Data Cache Maintenance
+// Buffer is cleaned (IN) or cleaned and invalidated (OUT) once per transfer submitted to DCD, data received by OUT
+// transfer is invalidated on completion. Range is extended to whole cache lines: OUT buffer not aligned to cache
+// line goes through a bounce buffer if available, since invalidating its first/last line would also discard CPU
+// writes to data sharing it.
+//--------------------------------------------------------------------+
+#if CFG_TUD_MEM_DCACHE_ENABLE
+TU_VERIFY_STATIC((CFG_TUSB_MEM_DCACHE_LINE_SIZE & (CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1)) == 0,
+                 "CFG_TUSB_MEM_DCACHE_LINE_SIZE must be a power of 2");
+
+typedef struct {
+  uint8_t* buffer; // buffer of class driver
+  int8_t bounce;   // index of bounce buffer, -1 if received in place
+} usbd_dcache_xfer_t;
+
+// OUT transfers submitted to DCD, they complete in order
+typedef struct {
+  usbd_dcache_xfer_t xfer[DCD_EDPT_XFER_DEPTH];
+  uint8_t rd_idx;
+  uint8_t count;
+} usbd_dcache_edpt_t;
+
+tu_static usbd_dcache_edpt_t _usbd_dcache[CFG_TUD_ENDPPOINT_MAX];
+
+#if CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+tu_static uint8_t _usbd_dcache_bounce[CFG_TUD_MEM_DCACHE_BOUNCE_NUM][TU_DCACHE_ROUNDUP(CFG_TUD_MEM_DCACHE_BOUNCE_SZ)];
+tu_static bool _usbd_dcache_bounce_used[CFG_TUD_MEM_DCACHE_BOUNCE_NUM];
+#endif
+
+// Apply cache operation to whole lines covering buffer
+TU_ATTR_ALWAYS_INLINE static inline void dcache_lines(void (*op)(void const*, uint32_t), uint8_t const* buffer,
+                                                      uint32_t len) {
+  if (op && len) {
+    uintptr_t const start = (uintptr_t) buffer & ~((uintptr_t) CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1);
+    op((void const*) start, (uint32_t) TU_DCACHE_ROUNDUP((uintptr_t) buffer + len - start));
+  }
+}
+
+// Cache maintenance before DCD transfer, return buffer to hand to DCD: bounce buffer or the same one.
+// Bounce buffers are shared by all endpoints: caller must hold _usbd_spin or be in ISR.
+TU_ATTR_FAST_FUNC static uint8_t* dcache_xfer_prepare(uint8_t ep_addr, uint8_t* buffer, uint16_t len) {
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
+    dcache_lines(dcd_dcache_clean, buffer, len);
+    return buffer;
+  }
+
+  usbd_dcache_edpt_t* de = &_usbd_dcache[tu_edpt_number(ep_addr)];
+  TU_ASSERT(de->count < DCD_EDPT_XFER_DEPTH, buffer);
+  usbd_dcache_xfer_t* dx = &de->xfer[(de->rd_idx + de->count) % DCD_EDPT_XFER_DEPTH];
+  de->count++;
+  dx->buffer = buffer;
+  dx->bounce = -1;
+
+  #if CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+  bool const aligned = (((uintptr_t) buffer | len) & (CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1)) == 0;
+  if (!aligned && len <= CFG_TUD_MEM_DCACHE_BOUNCE_SZ) {
+    for (uint8_t i = 0; i < CFG_TUD_MEM_DCACHE_BOUNCE_NUM; i++) {
+      if (!_usbd_dcache_bounce_used[i]) {
+        _usbd_dcache_bounce_used[i] = true;
+        dx->bounce = (int8_t) i;
+        buffer = _usbd_dcache_bounce[i];
+        break;
+      }
+    }
+  }
+  #endif
+
+  dcache_lines(dcd_dcache_clean_invalidate, buffer, len);
+  return buffer;
+}
+
+// Release bounce buffer of an OUT transfer, copying received data to class driver buffer
+TU_ATTR_ALWAYS_INLINE static inline void dcache_bounce_release(usbd_dcache_xfer_t const* dx, uint32_t xferred) {
+  #if CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+  if (dx->bounce >= 0) {
+    if (xferred) memcpy(dx->buffer, _usbd_dcache_bounce[dx->bounce], xferred);
+    _usbd_dcache_bounce_used[dx->bounce] = false;
+  }
+  #else
+  (void) dx;
+  (void) xferred;
+  #endif
+}
+
+// Cache maintenance after DCD transfer is complete
+TU_ATTR_FAST_FUNC static void dcache_xfer_complete(uint8_t ep_addr, uint32_t xferred) {
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) return;
+
+  usbd_dcache_edpt_t* de = &_usbd_dcache[tu_edpt_number(ep_addr)];
+  if (de->count == 0) return;
+  usbd_dcache_xfer_t const* dx = &de->xfer[de->rd_idx];
+  de->rd_idx = (uint8_t) ((de->rd_idx + 1) % DCD_EDPT_XFER_DEPTH);
+  de->count--;
+
+  #if CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+  uint8_t const* buffer = (dx->bounce >= 0) ? _usbd_dcache_bounce[dx->bounce] : dx->buffer;
+  #else
+  uint8_t const* buffer = dx->buffer;
+  #endif
+  dcache_lines(dcd_dcache_invalidate, buffer, xferred);
+  dcache_bounce_release(dx, xferred);
+}
+
+// Forget OUT transfers of an endpoint (all endpoints if epnum is 0xff) that ended without completion
+// e.g closed, stalled or superseded by setup packet
+static void dcache_xfer_clear(uint8_t epnum) {
+  for (uint8_t i = 0; i < CFG_TUD_ENDPPOINT_MAX; i++) {
+    if (epnum != 0xff && epnum != i) continue;
+    usbd_dcache_edpt_t* de = &_usbd_dcache[i];
+    while (de->count) {
+      dcache_bounce_release(&de->xfer[de->rd_idx], 0);
+      de->rd_idx = (uint8_t) ((de->rd_idx + 1) % DCD_EDPT_XFER_DEPTH);
+      de->count--;
+    }
+  }
+}
+#endif
+
+// Hand a transfer (or a part of it) to DCD
+TU_ATTR_FAST_FUNC static bool edpt_dcd_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t len) {
+#if CFG_TUD_MEM_DCACHE_ENABLE
+  if (dcd_edpt_xfer(rhport, ep_addr, dcache_xfer_prepare(ep_addr, buffer, len), len)) return true;
+
+  // not started: drop record of this transfer i.e the most recent one
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) {
+    usbd_dcache_edpt_t* de = &_usbd_dcache[tu_edpt_number(ep_addr)];
+    if (de->count) {
+      de->count--;
+      dcache_bounce_release(&de->xfer[(de->rd_idx + de->count) % DCD_EDPT_XFER_DEPTH], 0);
+    }
+  }
+  return false;
+#else
+  return dcd_edpt_xfer(rhport, ep_addr, buffer, len);
+#endif
+}
+
+//--------------------------------------------------------------------+
+// Large Transfer
+// DCD transfer length is 16-bit: transfer larger than that is split into chunks of multiple of
+// max packet size. Next chunk is submitted from transfer complete ISR, class driver only gets
+// a single callback when the whole transfer is complete or ended by a short packet.
+//--------------------------------------------------------------------+
+
+// Submit a transfer to DCD, splitting it into chunks if needed
+TU_ATTR_FAST_FUNC static bool edpt_xfer_start(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes) {
+#if CFG_TUD_LARGE_XFER
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  if (epnum) {
+    usbd_large_xfer_t* lx = &_usbd_dev.large_xfer[epnum][tu_edpt_dir(ep_addr)];
+    uint16_t const mps = lx->mps ? lx->mps : 64;
+    uint16_t const max_chunk = (uint16_t) ((UINT16_MAX / mps) * mps);
+
+    lx->buffer = buffer;
+    lx->chunk_len = (uint16_t) tu_min32(total_bytes, max_chunk);
+    lx->remaining = total_bytes - lx->chunk_len;
+    lx->xferred = 0;
+
+    return edpt_dcd_xfer(rhport, ep_addr, buffer, lx->chunk_len);
+  }
+#endif
+
+  return edpt_dcd_xfer(rhport, ep_addr, buffer, (uint16_t) total_bytes);
+}
+
+#if CFG_TUD_LARGE_XFER
+// Return true if the next chunk is submitted i.e transfer is not complete yet.
+// Otherwise event's length is updated to the total transferred bytes.
+TU_ATTR_FAST_FUNC static bool large_xfer_continue(dcd_event_t* event) {
+  uint8_t const rhport = event->rhport;
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  usbd_large_xfer_t* lx = &_usbd_dev.large_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  lx->xferred += event->xfer_complete.len;
+
+  // continue only if previous chunk is fully transferred (no short packet)
+  if (lx->remaining && event->xfer_complete.result == XFER_RESULT_SUCCESS &&
+      event->xfer_complete.len == lx->chunk_len) {
+    uint16_t const max_chunk = lx->chunk_len; // first chunk is always the largest possible
+    lx->buffer += lx->chunk_len;
+    lx->chunk_len = (uint16_t) tu_min32(lx->remaining, max_chunk);
+    lx->remaining -= lx->chunk_len;
+
+    if (edpt_dcd_xfer(rhport, ep_addr, lx->buffer, lx->chunk_len)) return true;
+
+    event->xfer_complete.result = XFER_RESULT_FAILED;
+  }
+
+  event->xfer_complete.len = lx->xferred;
+  lx->remaining = 0;
+  lx->xferred = 0;
+
+  return false;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Scatter-gather Transfer
+// Segments are handed to DCD one part at a time (see tu_sg_xfer_t), the next part is submitted from transfer
+// complete ISR. Class driver only gets a single callback for the whole list.
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_XFER_SG
+tu_static tu_sg_xfer_t _usbd_sg[CFG_TUD_EDPT_XFER_SG];
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN TUD_EPBUF_DCACHE_ALIGNED
+tu_static uint8_t _usbd_sg_bounce[CFG_TUD_EDPT_XFER_SG][TUD_EPBUF_DCACHE_SIZE(CFG_TUD_EDPT_XFER_SG_BOUNCE_SZ)];
+
+// scatter-gather transfer in progress on endpoint, NULL if none
+TU_ATTR_FAST_FUNC static tu_sg_xfer_t* sg_xfer_find(uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUD_EDPT_XFER_SG; i++) {
+    if (_usbd_sg[i].iov && _usbd_sg[i].ep_addr == ep_addr) return &_usbd_sg[i];
+  }
+  return NULL;
+}
+
+// abort scatter-gather transfer of endpoint, or all of them if ep_addr is 0
+static void sg_xfer_clear(uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUD_EDPT_XFER_SG; i++) {
+    if (ep_addr == 0 || _usbd_sg[i].ep_addr == ep_addr) _usbd_sg[i].iov = NULL;
+  }
+}
+
+bool usbd_edpt_xfer_sg(uint8_t rhport, uint8_t ep_addr, tu_iovec_t const* iov, uint8_t count) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  TU_ASSERT(iov && count && epnum && epnum < CFG_TUD_ENDPPOINT_MAX);
+
+  uint16_t const mps = _usbd_dev.ep_mps[epnum][dir];
+  TU_ASSERT(mps && mps <= CFG_TUD_EDPT_XFER_SG_BOUNCE_SZ);
+
+  // must not interleave with other transfers of this endpoint
+  TU_VERIFY(!_usbd_dev.ep_status[epnum][dir].busy);
+
+  // reserve a free slot
+  tu_sg_xfer_t* sg = NULL;
+  uint8_t slot;
+  bool const in_isr = _usbd_in_xfer_isr;
+  osal_spin_lock(&_usbd_spin, in_isr);
+  for (slot = 0; slot < CFG_TUD_EDPT_XFER_SG; slot++) {
+    if (_usbd_sg[slot].iov == NULL) {
+      sg = &_usbd_sg[slot];
+      sg->ep_addr = ep_addr;
+      sg->iov = iov;
+      break;
+    }
+  }
+  osal_spin_unlock(&_usbd_spin, in_isr);
+  TU_VERIFY(sg);
+
+  tu_sg_xfer_init(sg, iov, count, mps, _usbd_sg_bounce[slot]);
+
+  uint8_t* buffer;
+  uint16_t const len = tu_sg_xfer_part(sg, &buffer);
+  if (!usbd_edpt_xfer(rhport, ep_addr, buffer, len)) {
+    sg->iov = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+// Return true if the next part is submitted i.e transfer is not complete yet.
+// Otherwise event's length is updated to the total transferred bytes.
+TU_ATTR_FAST_FUNC static bool sg_xfer_continue(dcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  tu_sg_xfer_t* sg = sg_xfer_find(ep_addr);
+  if (sg == NULL) return false;
+
+  bool const success = (event->xfer_complete.result == XFER_RESULT_SUCCESS);
+  if (tu_sg_xfer_advance(sg, event->xfer_complete.len) && success) {
+    uint8_t* buffer;
+    uint16_t const len = tu_sg_xfer_part(sg, &buffer);
+    if (edpt_dcd_xfer(event->rhport, ep_addr, buffer, len)) return true;
+
+    event->xfer_complete.result = XFER_RESULT_FAILED;
+  }
+
+  event->xfer_complete.len = sg->xferred;
+  sg->iov = NULL;
+
+  return false;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Endpoint Transfer Queue
+// Transfers submitted while endpoint is busy are kept in a per-endpoint ring and handed to DCD
+// from the transfer complete ISR, removing the round trip to usbd task between transfers.
+// Completion callbacks are still invoked in usbd task, one per transfer and in submission order
+// (unless merged by CFG_TUD_EVENT_COALESCE). DCD that chains transfers in hardware gets up to
+// DCD_EDPT_XFER_DEPTH of them at once.
+//--------------------------------------------------------------------+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ
+
+// Mutex is skipped in ISR context e.g when used by class driver's xfer_isr()
+TU_ATTR_ALWAYS_INLINE static inline void xfer_queue_lock(bool in_isr) {
+  if (!in_isr) {
+    (void) osal_mutex_lock(_usbd_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  }
+  osal_spin_lock(&_usbd_spin, in_isr);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void xfer_queue_unlock(bool in_isr) {
+  osal_spin_unlock(&_usbd_spin, in_isr);
+  if (!in_isr) {
+    (void) osal_mutex_unlock(_usbd_mutex);
+  }
+}
+
+static bool xfer_queue_submit(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  tu_edpt_state_t* ep_state = &_usbd_dev.ep_status[epnum][dir];
+  usbd_xfer_queue_t* q = &_usbd_dev.xfer_queue[epnum][dir];
+
+  // Attempt to transfer on a stalled endpoint
+  TU_ASSERT(!ep_state->stalled);
+
+  bool started = false;
+  bool queued = false;
+  bool dcd_failed = false;
+
+  // DCD is called with queue locked: a transfer submitted from ISR (e.g class driver's xfer_isr()) must not
+  // overtake this one
+  bool const in_isr = _usbd_in_xfer_isr;
+  xfer_queue_lock(in_isr);
+  bool dcd_room = (q->count == 0 && q->active < DCD_EDPT_XFER_DEPTH);
+  #if CFG_TUD_EDPT_XFER_SG
+  // parts of a scatter-gather transfer are submitted one by one, nothing can be chained behind them
+  if (q->active && sg_xfer_find(ep_addr)) dcd_room = false;
+  #endif
+
+  if (dcd_room) {
+    // DCD has room: submit now
+    q->active++;
+    q->pending++;
+    ep_state->busy = 1;
+
+    started = edpt_xfer_start(rhport, ep_addr, buffer, total_bytes);
+    if (!started) {
+      dcd_failed = true;
+      q->active--;
+      q->pending--;
+      if (q->pending == 0) {
+        // DCD error, mark endpoint as ready to allow next transfer
+        ep_state->busy = 0;
+        ep_state->claimed = 0;
+      }
+    }
+  } else if (q->count < CFG_TUD_EDPT_XFER_QUEUE_SZ) {
+    usbd_xfer_desc_t* desc = &q->desc[(q->rd_idx + q->count) % CFG_TUD_EDPT_XFER_QUEUE_SZ];
+    desc->buffer = buffer;
+    desc->total_bytes = total_bytes;
+    q->count++;
+    q->pending++;
+    ep_state->busy = 1;
+    queued = true;
+  }
+  xfer_queue_unlock(in_isr);
+
+  if (dcd_failed) {
+    TU_LOG_USBD("FAILED\r\n");
+    TU_BREAKPOINT();
+    return false;
+  }
+
+  // queue is full
+  TU_VERIFY(started || queued);
+
+  return true;
+}
+
+// Submit the next queued transfer to DCD. Called when DCD completes a transfer on this endpoint,
+// mostly in ISR context. Must not be called with xfer_queue_lock() held.
+TU_ATTR_FAST_FUNC static void xfer_queue_next(uint8_t rhport, uint8_t ep_addr, bool in_isr) {
+  usbd_xfer_queue_t* q = &_usbd_dev.xfer_queue[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  uint8_t failed = 0;
+
+  osal_spin_lock(&_usbd_spin, in_isr);
+  if (q->active) q->active--;
+  while (q->count && q->active < DCD_EDPT_XFER_DEPTH) {
+    usbd_xfer_desc_t const desc = q->desc[q->rd_idx];
+    q->rd_idx = (uint8_t) ((q->rd_idx + 1) % CFG_TUD_EDPT_XFER_QUEUE_SZ);
+    q->count--;
+    q->active++;
+
+    if (edpt_xfer_start(rhport, ep_addr, desc.buffer, desc.total_bytes)) continue;
+
+    q->active--;
+    failed++;
+  }
+  osal_spin_unlock(&_usbd_spin, in_isr);
+
+  // report as failed transfer so that class driver still gets one callback per submission
+  for (; failed; failed--) {
+    dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_XFER_COMPLETE };
+    event.xfer_complete.ep_addr = ep_addr;
+    event.xfer_complete.len     = 0;
+    event.xfer_complete.result  = XFER_RESULT_FAILED;
+    queue_xfer_event(&event, in_isr);
+  }
+}
+
+// Called by usbd task when a transfer complete event is processed, or in ISR if consumed by xfer_isr().
+// Return true if endpoint has no more outstanding transfer and is released.
+static bool xfer_queue_retire(uint8_t epnum, uint8_t dir, bool in_isr) {
+  tu_edpt_state_t* ep_state = &_usbd_dev.ep_status[epnum][dir];
+  usbd_xfer_queue_t* q = &_usbd_dev.xfer_queue[epnum][dir];
+
+  xfer_queue_lock(in_isr);
+  if (q->pending) q->pending--;
+
+  bool const idle = (q->pending == 0);
+  if (idle) {
+    ep_state->busy = 0;
+    ep_state->claimed = 0;
+  }
+  xfer_queue_unlock(in_isr);
+
+  return idle;
+}
+
+static void xfer_queue_clear(uint8_t epnum, uint8_t dir) {
+  bool const in_isr = _usbd_in_xfer_isr;
+  xfer_queue_lock(in_isr);
+  tu_varclr(&_usbd_dev.xfer_queue[epnum][dir]);
+  xfer_queue_unlock(in_isr);
+}
+
+#if CFG_TUD_EVENT_COALESCE
+// Queue transfer complete event of a non-control endpoint. A successful completion is merged into the event
+// already in queue for this endpoint as long as no other event of the same endpoint is queued after it.
+// Only endpoints whose driver opted in by usbd_edpt_xfer_coalesce() are merged, other drivers rely on one
+// xfer_cb() per submitted transfer.
+TU_ATTR_FAST_FUNC static void queue_xfer_event(dcd_event_t const* event, bool in_isr) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  if (!_usbd_dev.ep_coalesce[epnum][dir]) {
+    (void) queue_event(event, in_isr);
+    return;
+  }
+
+  usbd_xfer_queue_t* q = &_usbd_dev.xfer_queue[epnum][dir];
+  bool const success = (event->xfer_complete.result == XFER_RESULT_SUCCESS);
+  dcd_event_t event_merged;
+
+  osal_spin_lock(&_usbd_spin, in_isr);
+
+  if (q->merged_count) {
+    if (success && q->merge_open && q->merged_count < UINT8_MAX) {
+      q->merged_len += event->xfer_complete.len;
+      q->merged_count++;
+      event = NULL;
+    } else {
+      // keep order: later completions must not be merged into an event ahead of this one
+      q->merge_open = 0;
+    }
+  } else if (success) {
+    q->merged_len = event->xfer_complete.len;
+    q->merged_count = 1;
+    q->merge_open = 1;
+
+    event_merged = *event;
+    event_merged.xfer_complete.result = XFER_RESULT_COALESCED;
+    event = &event_merged;
+  }
+
+  osal_spin_unlock(&_usbd_spin, in_isr);
+
+  if (event && !queue_event(event, in_isr) && event == &event_merged) {
+    q->merged_count = 0;
+  }
+}
+#endif
+
+#endif
+
 #endif
@@ -40,6 +40,10 @@ extern "C" {
 // Init device stack on roothub port
 bool tud_init (uint8_t rhport);
 
+// Init device stack on roothub port with an arena for CFG_TUD_BUF_POOL_ARENA, from which class drivers take their
+// buffers when configuration is mounted. Arena must stay valid until tud_deinit()
+bool tud_init_arena(uint8_t rhport, void* arena, uint32_t arena_size);
+
 // Deinit device stack on roothub port
 bool tud_deinit(uint8_t rhport);
 
@@ -57,15 +61,37 @@ void tud_task (void) {
   tud_task_ext(UINT32_MAX, false);
 }
 
+// Task function with bounded run time for bare-metal mainloop: process at most max_events pending events without
+// waiting, then return even if more are queued, so that time-critical application work is interleaved with USB
+// servicing. Events left over are processed by next call. Return number of processed events
+uint32_t tud_task_budget(uint32_t max_events);
+
 // Check if there is pending events need processing by tud_task()
 bool tud_task_event_ready(void);
 
+// Race-free sleep for bare-metal mainloop: call with interrupts globally masked (e.g __disable_irq() on Cortex-M),
+// sleep_func() is invoked only if there is no pending event and must enter a sleep that a masked pending interrupt
+// still wakes up from (e.g __WFI). Interrupts are re-enabled by caller afterward.
+// Return true if sleep_func() was invoked, false if tud_task() has work to do
+bool tud_task_sleep(void (*sleep_func)(void));
+
+// Worker function for CFG_TUD_TASK_WORKER_NUM > 0, each worker (1 to CFG_TUD_TASK_WORKER_NUM) should be called in
+// its own rtos task. It invokes transfer callbacks of the class drivers mapped to it by tud_task_worker_map_cb()
+// - timeout_ms: millisecond to wait, zero = no wait, 0xFFFFFFFF = wait forever
+void tud_task_worker(uint8_t worker, uint32_t timeout_ms);
+
 #ifndef _TUSB_DCD_H_
 extern void dcd_int_handler(uint8_t rhport);
 #endif
 
+#if CFG_TUD_STATS || CFG_TUD_INT_HOOK
+// dcd_int_handler() wrapped with duration statistics and enter/exit hooks
+void tud_int_handler_ext(uint8_t rhport);
+#define tud_int_handler   tud_int_handler_ext
+#else
 // Interrupt handler, name alias to DCD
 #define tud_int_handler   dcd_int_handler
+#endif
 
 // Get current bus speed
 tusb_speed_t tud_speed_get(void);
@@ -86,7 +112,11 @@ bool tud_ready(void) {
   return tud_mounted() && !tud_suspended();
 }
 
-// Remote wake up host, only if suspended and enabled by host
+// Check if link is in LPM sleep (L1). Unlike suspend, transfers can still be queued: host resumes the link itself
+// when it has traffic to schedule
+bool tud_lpm_sleeping(void);
+
+// Remote wake up host, only if suspended and enabled by host, or in LPM sleep and enabled by the LPM token
 bool tud_remote_wakeup(void);
 
 // Enable pull-up resistor on D+ D-
@@ -97,6 +127,14 @@ bool tud_disconnect(void);
 // Return false on unsupported MCUs
 bool tud_connect(void);
 
+#if CFG_TUD_STRING_TABLE_SZ
+// Encode an ASCII string table into UTF-16 string descriptors once (CFG_TUD_STRING_TABLE_SZ), which are then sent
+// directly for GET_DESCRIPTOR(string) without invoking tud_descriptor_string_cb(). table[0] is the 2-byte LANGID
+// e.g (const char[]) {0x09, 0x04}. NULL entries, and index past count, are still requested from the callback
+// e.g for serial number. Should be called before tud_init() or while disconnected. Return false if not fit
+bool tud_string_table_set(char const* const* table, uint8_t count);
+#endif
+
 // Carry out Data and Status stage of control transfer
 // - If len = 0, it is equivalent to sending status only
 // - If len > wLength : it will be truncated
@@ -105,6 +143,52 @@ bool tud_control_xfer(uint8_t rhport, tusb_control_request_t const * request, vo
 // Send STATUS (zero length) packet
 bool tud_control_status(uint8_t rhport, tusb_control_request_t const * request);
 
+//--------------------------------------------------------------------+
+// Buffer pool (CFG_TUD_BUF_POOL_SZ or CFG_TUD_BUF_POOL_ARENA)
+//--------------------------------------------------------------------+
+
+// Bytes taken from pool by a buffer of _size. Pool size needed by a configuration is the sum of
+// TUD_<CLASS>_BUF_POOL_SZ of its interfaces, which can be checked at compile time e.g
+//   TU_VERIFY_STATIC(CFG_TUD_BUF_POOL_SZ >= TUD_MSC_BUF_POOL_SZ + 2*TUD_HID_BUF_POOL_SZ, "pool too small");
+#define TUD_BUF_POOL_ALLOC_SZ(_size) \
+  ((((_size) + CFG_TUD_BUF_POOL_ALIGN - 1) / CFG_TUD_BUF_POOL_ALIGN) * CFG_TUD_BUF_POOL_ALIGN)
+
+//--------------------------------------------------------------------+
+// Statistics (CFG_TUD_STATS)
+// Counters are accumulated since tud_init() or tud_stats_clear(). Time values are in unit of
+// tud_stats_timestamp_cb() and stay 0 if it is not implemented.
+//--------------------------------------------------------------------+
+#if CFG_TUD_STATS
+typedef struct {
+  uint32_t xfer_count;  // completed transfers
+  uint32_t xfer_failed; // completed transfers with result other than success
+  uint32_t stall_count; // endpoint stalled by stack/class driver
+  uint64_t xfer_bytes;  // total bytes of completed transfers
+} tud_stats_edpt_t;
+
+typedef struct {
+  tud_stats_edpt_t edpt[CFG_TUD_ENDPPOINT_MAX][2];
+
+  uint32_t event_count;       // events dispatched by usbd task
+  uint16_t event_queue_hwm;   // highest number of events waiting in queue
+  uint16_t event_dropped;     // events lost due to full queue
+  uint32_t event_latency_max; // longest time from event queued to being dispatched by usbd task
+  uint32_t isr_time_max;      // longest time spent in dcd_event_handler()
+
+  // tud_int_handler() i.e whole USB interrupt, ports registering dcd_int_handler() directly are not measured
+  uint32_t isr_count;         // invocations of tud_int_handler()
+  uint32_t isr_duration_max;  // longest tud_int_handler()
+  uint32_t isr_duration_hist[CFG_TUSB_STATS_HIST_BINS]; // tud_int_handler() durations, see CFG_TUSB_STATS_HIST_BINS
+  uint32_t event_latency_hist[CFG_TUSB_STATS_HIST_BINS]; // event age when dispatched by usbd task
+} tud_stats_t;
+
+// Get a snapshot of statistics
+bool tud_stats_get(tud_stats_t* stats);
+
+// Reset all statistics counters
+void tud_stats_clear(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -117,9 +201,9 @@ uint8_t const * tud_descriptor_device_cb(void);
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
 uint8_t const * tud_descriptor_configuration_cb(uint8_t index);
 
-// Invoked when received GET STRING DESCRIPTOR request
+// Invoked when received GET STRING DESCRIPTOR request, that is not in table passed to tud_string_table_set()
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
-uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid);
+TU_ATTR_WEAK uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid);
 
 // Invoked when received GET BOS DESCRIPTOR request
 // Application return pointer to descriptor
@@ -146,12 +230,35 @@ TU_ATTR_WEAK void tud_umount_cb(void);
 // Within 7ms, device must draw an average of current less than 2.5 mA from bus
 TU_ATTR_WEAK void tud_suspend_cb(bool remote_wakeup_en);
 
-// Invoked when usb bus is resumed
+// Invoked when usb bus is resumed, from suspend or LPM sleep
 TU_ATTR_WEAK void tud_resume_cb(void);
 
+// Invoked when host put the link into LPM sleep (L1), requires LPM to be advertised with
+// TUD_BOS_USB20_EXT_DESCRIPTOR() and bcdUSB 0x0201 and a DCD supporting it (CFG_TUD_LPM).
+// Device may enter a low power state it can leave within tud_lpm_besl_to_us(besl) microseconds
+TU_ATTR_WEAK void tud_lpm_sleep_cb(uint8_t besl, bool remote_wakeup_en);
+
 // Invoked when there is a new usb event, which need to be processed by tud_task()/tud_task_ext()
 void tud_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 
+// Invoked when the event queue goes from empty to non-empty i.e tud_task() has work to do again, may be in ISR.
+// Can be used to wake up a sleeping mainloop or signal the task running tud_task()
+void tud_task_wakeup_cb(uint8_t rhport, bool in_isr);
+
+// Invoked when a class driver is opened by SET_CONFIGURATION (CFG_TUD_TASK_WORKER_NUM > 0). Return the worker
+// (1 to CFG_TUD_TASK_WORKER_NUM) running transfer callbacks of that interface, or 0 for tud_task(). Control requests
+// are always handled by tud_task(): class driver must tolerate such a callback concurrent with its worker.
+uint8_t tud_task_worker_map_cb(uint8_t rhport, tusb_desc_interface_t const* desc_itf);
+
+// Invoked by tud_int_handler() before/after dcd_int_handler() (CFG_TUD_INT_HOOK), e.g to toggle a GPIO for a scope
+// or to check interrupt nesting. exit_cb() gets duration of dcd_int_handler() if tud_stats_timestamp_cb() is implemented
+void tud_int_enter_cb(uint8_t rhport);
+void tud_int_exit_cb(uint8_t rhport, uint32_t duration);
+
+// Invoked to get current time for statistics (CFG_TUD_STATS), e.g cycle counter or microsecond timer.
+// Must be ISR-safe, unit is up to application.
+uint32_t tud_stats_timestamp_cb(void);
+
 // Invoked when received control request with VENDOR TYPE
 TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 
@@ -169,6 +276,25 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
 #define TUD_BOS_PLATFORM_DESCRIPTOR(...) \
   4+TU_ARGS_NUM(__VA_ARGS__), TUSB_DESC_DEVICE_CAPABILITY, DEVICE_CAPABILITY_PLATFORM, 0x00, __VA_ARGS__
 
+//------------- USB 2.0 Extension -------------//
+#define TUD_BOS_USB20_EXT_DESC_LEN   7
+
+// Attributes e.g TUD_BOS_USB20_EXT_LPM() or 0
+#define TUD_BOS_USB20_EXT_DESCRIPTOR(_attr) \
+  7, TUSB_DESC_DEVICE_CAPABILITY, DEVICE_CAPABILITY_USB20_EXTENSION, U32_TO_U8S_LE(_attr)
+
+// LPM supported with BESL, baseline and deep BESL (0-15) recommended by device
+#define TUD_BOS_USB20_EXT_LPM(_baseline_besl, _deep_besl) \
+  (TU_BIT(1) | TU_BIT(2) | TU_BIT(3) | TU_BIT(4) | ((_baseline_besl) << 8) | ((_deep_besl) << 12))
+
+// Convert BESL value of an LPM token to the resume latency in microseconds
+TU_ATTR_ALWAYS_INLINE static inline uint16_t tud_lpm_besl_to_us(uint8_t besl) {
+  if (besl == 0) return 125;
+  if (besl == 1) return 150;
+  if (besl <= 5) return (uint16_t) (besl * 100u);
+  return (uint16_t) ((besl - 5u) * 1000u);
+}
+
 //------------- WebUSB BOS Platform -------------//
 
 // Descriptor Length
@@ -250,6 +376,28 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
 
+// Length of template descriptor: 76 bytes
+#define TUD_MSC_UAS_DESC_LEN    (TUD_MSC_DESC_LEN + 9 + 4*(7+4))
+
+// Interface number, string index, EP Command (Out), Status (In), Data In, Data Out address, EP size
+// Alternate 0 is Bulk-Only Transport using the data endpoints, alternate 1 is USB Attached SCSI (CFG_TUD_MSC_UAS)
+#define TUD_MSC_UAS_DESCRIPTOR(_itfnum, _stridx, _epcmd, _epstatus, _epdin, _epdout, _epsize) \
+  TUD_MSC_DESCRIPTOR(_itfnum, _stridx, _epdout, _epdin, _epsize),\
+  /* Interface Alternate 1 */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 1, 4, TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI, MSC_PROTOCOL_UAS, _stridx,\
+  /* Endpoint Command Out */\
+  7, TUSB_DESC_ENDPOINT, _epcmd, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, MSC_UAS_DESC_TYPE_PIPE_USAGE, MSC_UAS_PIPE_ID_COMMAND, 0,\
+  /* Endpoint Status In */\
+  7, TUSB_DESC_ENDPOINT, _epstatus, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, MSC_UAS_DESC_TYPE_PIPE_USAGE, MSC_UAS_PIPE_ID_STATUS, 0,\
+  /* Endpoint Data In */\
+  7, TUSB_DESC_ENDPOINT, _epdin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, MSC_UAS_DESC_TYPE_PIPE_USAGE, MSC_UAS_PIPE_ID_DATA_IN, 0,\
+  /* Endpoint Data Out */\
+  7, TUSB_DESC_ENDPOINT, _epdout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  4, MSC_UAS_DESC_TYPE_PIPE_USAGE, MSC_UAS_PIPE_ID_DATA_OUT, 0
+
 
 //--------------------------------------------------------------------+
 // HID Descriptor Templates
@@ -345,6 +493,38 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
   TUD_MIDI_DESC_EP(_epin, _epsize, 1),\
   TUD_MIDI_JACKID_OUT_EMB(1)
 
+//------------- MIDI 2.0 -------------//
+// MIDI 2.0 function keeps MIDI 1.0 as alternate setting 0 for legacy hosts,
+// Universal MIDI Packets (UMP) are exchanged on alternate setting 1.
+
+#define TUD_MIDI2_DESC_ALT_LEN (9 + 7)
+#define TUD_MIDI2_DESC_ALT(_itfnum) \
+  /* MIDI Streaming (MS) Interface, alternate setting 1 */\
+  9, TUSB_DESC_INTERFACE, (uint8_t)((_itfnum) + 1), 1, 2, TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_MIDI_STREAMING, AUDIO_FUNC_PROTOCOL_CODE_UNDEF, 0,\
+  /* MS Header 2.0 */\
+  7, TUSB_DESC_CS_INTERFACE, MIDI_CS_INTERFACE_HEADER, U16_TO_U8S_LE(0x0200), U16_TO_U8S_LE(7)
+
+#define TUD_MIDI2_DESC_EP_LEN(_numgtb) (7 + 4 + (_numgtb))
+#define TUD_MIDI2_DESC_EP(_epaddr, _epsize, _numgtb) \
+  /* Endpoint */\
+  7, TUSB_DESC_ENDPOINT, _epaddr, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0, \
+  /* MS 2.0 Endpoint, followed by associated Group Terminal Block IDs */\
+  (uint8_t)(4 + (_numgtb)), TUSB_DESC_CS_ENDPOINT, MIDI_CS_ENDPOINT_GENERAL_2_0, _numgtb
+
+// Length of template descriptor (132 bytes)
+#define TUD_MIDI2_DESC_LEN (TUD_MIDI_DESC_LEN + TUD_MIDI2_DESC_ALT_LEN + TUD_MIDI2_DESC_EP_LEN(1) * 2)
+
+// MIDI 2.0 simple descriptor
+// - alternate setting 0: same as TUD_MIDI_DESCRIPTOR()
+// - alternate setting 1: UMP endpoints associated with Group Terminal Block 1
+#define TUD_MIDI2_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  TUD_MIDI_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize),\
+  TUD_MIDI2_DESC_ALT(_itfnum),\
+  TUD_MIDI2_DESC_EP(_epout, _epsize, 1),\
+  1,\
+  TUD_MIDI2_DESC_EP(_epin, _epsize, 1),\
+  1
+
 //--------------------------------------------------------------------+
 // Audio v2.0 Descriptor Templates
 //--------------------------------------------------------------------+
@@ -583,6 +763,9 @@ TU_ATTR_WEAK bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb
 #define TUD_AUDIO_EP_SIZE(_maxFrequency, _nBytesPerSample, _nChannels) \
     ((((_maxFrequency + (TUD_OPT_HIGH_SPEED ? 7999 : 999)) / (TUD_OPT_HIGH_SPEED ? 8000 : 1000)) + 1) * _nBytesPerSample * _nChannels)
 
+//   Highspeed EP larger than 1024 bytes per micro-frame needs additional transactions: use
+//   TUSB_EDPT_HIGH_BANDWIDTH_SIZE(TUD_AUDIO_EP_SIZE(...)) as _maxEPsize in descriptor, EP_SZ_MAX is still in bytes
+
 
 //--------------------------------------------------------------------+
 // USBTMC/USB488 Descriptor Templates
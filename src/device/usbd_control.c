@@ -63,8 +63,8 @@ typedef struct {
 
 tu_static usbd_control_xfer_t _ctrl_xfer;
 
-CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN
-tu_static uint8_t _usbd_ctrl_buf[CFG_TUD_ENDPOINT0_SIZE];
+CFG_TUD_MEM_SECTION CFG_TUSB_MEM_ALIGN TUD_EPBUF_DCACHE_ALIGNED
+tu_static uint8_t _usbd_ctrl_buf[TUD_EPBUF_DCACHE_SIZE(CFG_TUD_ENDPOINT0_SIZE)];
 
 //--------------------------------------------------------------------+
 // Application API
@@ -98,6 +98,15 @@ static bool _data_stage_xact(uint8_t rhport) {
 
   if (_ctrl_xfer.request.bmRequestType_bit.direction == TUSB_DIR_IN) {
     ep_addr = EDPT_CTRL_IN;
+
+#if CFG_TUD_CONTROL_IN_ZERO_COPY && defined(TUP_DCD_EDPT0_MULTI_PACKET)
+    // Send all remaining data as one multi-packet transfer straight from the source
+    uint16_t const remaining = (uint16_t) (_ctrl_xfer.data_len - _ctrl_xfer.total_xferred);
+    if (remaining > CFG_TUD_ENDPOINT0_SIZE && 0 == ((uintptr_t) _ctrl_xfer.buffer & 0x03)) {
+      return usbd_edpt_xfer(rhport, ep_addr, _ctrl_xfer.buffer, remaining);
+    }
+#endif
+
     if (xact_len) {
       TU_VERIFY(0 == tu_memcpy_s(_usbd_ctrl_buf, CFG_TUD_ENDPOINT0_SIZE, _ctrl_xfer.buffer, xact_len));
     }
@@ -187,9 +196,10 @@ bool usbd_control_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result,
   _ctrl_xfer.buffer += xferred_bytes;
 
   // Data Stage is complete when all request's length are transferred or
-  // a short packet is sent including zero-length packet.
+  // a short packet is sent including zero-length packet. A transaction can span several packets
+  // (CFG_TUD_CONTROL_IN_ZERO_COPY), only its last one may be short.
   if ((_ctrl_xfer.request.wLength == _ctrl_xfer.total_xferred) ||
-      (xferred_bytes < CFG_TUD_ENDPOINT0_SIZE)) {
+      (xferred_bytes == 0) || (xferred_bytes % CFG_TUD_ENDPOINT0_SIZE)) {
     // DATA stage is complete
     bool is_ok = true;
 
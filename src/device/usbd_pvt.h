@@ -50,6 +50,11 @@ typedef struct {
   uint16_t (* open             ) (uint8_t rhport, tusb_desc_interface_t const * desc_intf, uint16_t max_len);
   bool     (* control_xfer_cb  ) (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
   bool     (* xfer_cb          ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+  // optional, invoked in ISR context: return false to defer to xfer_cb(). Built-in drivers only use it when opted in
+  // (CFG_TUD_AUDIO_XFER_ISR), since their application callbacks (e.g tud_hid_report_complete_cb() calling
+  // tud_hid_report()) may block on a mutex. Within it only usbd_edpt_xfer(), usbd_edpt_xfer_fifo() (without claiming
+  // the endpoint) and usbd_defer_func() may be used.
+  bool     (* xfer_isr         ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
   void     (* sof              ) (uint8_t rhport, uint32_t frame_count); // optional
 } usbd_class_driver_t;
 
@@ -62,6 +67,10 @@ typedef bool (*usbd_control_xfer_cb_t)(uint8_t rhport, uint8_t stage, tusb_contr
 
 void usbd_int_set(bool enabled);
 
+// Critical section shared with usbd ISR handling, for class state that is also modified by DCD in USB interrupt
+void usbd_spin_lock(bool in_isr);
+void usbd_spin_unlock(bool in_isr);
+
 //--------------------------------------------------------------------+
 // USBD Endpoint API
 // Note: rhport should be 0 since device stack only support 1 rhport for now
@@ -74,7 +83,21 @@ bool usbd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * desc_ep);
 void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr);
 
 // Submit a usb transfer
-bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
+// Transfer larger than 64 KiB requires CFG_TUD_LARGE_XFER
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes);
+
+#if CFG_TUD_EDPT_XFER_SG
+// Submit a scatter-gather transfer of count segments e.g header + payload without copying them into one buffer,
+// requires CFG_TUD_EDPT_XFER_SG. Segment list and buffers must be kept until the transfer completes, which is
+// reported once with the total length. Endpoint must be idle: no other transfer is queued or in progress
+bool usbd_edpt_xfer_sg(uint8_t rhport, uint8_t ep_addr, tu_iovec_t const* iov, uint8_t count);
+#endif
+
+#if CFG_TUD_EDPT_XFER_QUEUE_SZ && CFG_TUD_EVENT_COALESCE
+// Allow back-to-back completions of queued transfers on an opened endpoint to be reported by a single xfer_cb()
+// with the accumulated length. Only for drivers that don't count callbacks per transfer, reset by usbd_edpt_open()
+void usbd_edpt_xfer_coalesce(uint8_t rhport, uint8_t ep_addr);
+#endif
 
 // Submit a usb ISO transfer by use of a FIFO (ring buffer) - all bytes in FIFO get transmitted
 bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes);
@@ -104,13 +127,28 @@ bool usbd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packe
 // Configure and enable an ISO endpoint according to descriptor
 bool usbd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpoint_desc);
 
+// Get interface descriptor of an alternate setting in the active configuration from the index built at
+// SET_CONFIGURATION (CFG_TUD_ITF_INDEX_SZ). len (optional) is the length up to the next interface descriptor.
+// Return NULL if not indexed, caller should then search the configuration descriptor itself
+tusb_desc_interface_t const* usbd_itf_desc_find(uint8_t itf_num, uint8_t alt, uint16_t* len);
+
+// Allocate a buffer from pool (CFG_TUD_BUF_POOL_SZ or arena of tud_init_arena()), aligned to CFG_TUD_BUF_POOL_ALIGN.
+// Should be called in driver's open(). Return NULL if pool is exhausted. There is no free: all buffers are released
+// together when configuration is reset
+void* usbd_buf_alloc(uint16_t size);
+
 // Check if endpoint is ready (not busy and not stalled)
 TU_ATTR_ALWAYS_INLINE static inline
 bool usbd_edpt_ready(uint8_t rhport, uint8_t ep_addr) {
   return !usbd_edpt_busy(rhport, ep_addr) && !usbd_edpt_stalled(rhport, ep_addr);
 }
 
-// Enable SOF interrupt
+// Subscribe driver's sof() handler to be invoked in ISR context every 'interval' frames, 0 to unsubscribe.
+// SOF interrupt is only enabled while there is at least one subscriber. All subscriptions are dropped when
+// configuration is reset, driver should subscribe again in open() or when needed.
+bool usbd_sof_subscribe(uint8_t rhport, void (*sof)(uint8_t rhport, uint32_t frame_count), uint16_t interval);
+
+// Legacy: subscribe (or unsubscribe) sof() handler of all class drivers, every frame
 void usbd_sof_enable(uint8_t rhport, bool en);
 
 /*------------------------------------------------------------------*/
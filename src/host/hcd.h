@@ -57,6 +57,7 @@ typedef enum
 {
   HCD_EVENT_DEVICE_ATTACH,
   HCD_EVENT_DEVICE_REMOVE,
+  HCD_EVENT_DEVICE_RESUME, // suspended port resumed, by host or remote wakeup
   HCD_EVENT_XFER_COMPLETE,
 
   // Not an HCD event, just a convenient way to defer ISR function
@@ -73,7 +74,7 @@ typedef struct
 
   union
   {
-    // Attach, Remove
+    // Attach, Remove, Resume
     struct {
       uint8_t hub_addr;
       uint8_t hub_port;
@@ -94,6 +95,9 @@ typedef struct
     }func_call;
   };
 
+#if CFG_TUH_STATS
+  uint32_t timestamp; // set by usbh when queued
+#endif
 } hcd_event_t;
 
 typedef struct
@@ -102,6 +106,7 @@ typedef struct
   uint8_t hub_addr;
   uint8_t hub_port;
   uint8_t speed;
+  uint8_t multi_tt; // hub has one transaction translator per port, split transactions of other ports don't compete
 } hcd_devtree_info_t;
 
 //--------------------------------------------------------------------+
@@ -142,7 +147,8 @@ void hcd_int_enable (uint8_t rhport);
 // Disable USB interrupt
 void hcd_int_disable(uint8_t rhport);
 
-// Get frame number (1ms)
+// Get frame number (1ms). Must count all 32 bits, HCD with a narrower hardware counter extends it in software
+// since usbh measures elapsed time as unsigned difference of two frame numbers
 uint32_t hcd_frame_number(uint8_t rhport);
 
 //--------------------------------------------------------------------+
@@ -162,6 +168,17 @@ void hcd_port_reset_end(uint8_t rhport);
 // Get port link speed
 tusb_speed_t hcd_port_speed_get(uint8_t rhport);
 
+// Suspend the port (selective suspend of the attached device). Optional, return false if not supported.
+// Remote wakeup detected on a suspended port is reported with hcd_event_device_resume()
+bool hcd_port_suspend(uint8_t rhport) TU_ATTR_WEAK;
+
+// Start resume signaling on a suspended port, or keep it going after a remote wakeup.
+// USBH ends it with hcd_port_resume_end() after 20ms
+void hcd_port_resume(uint8_t rhport) TU_ATTR_WEAK;
+
+// Stop resume signaling, port is back to enabled
+void hcd_port_resume_end(uint8_t rhport) TU_ATTR_WEAK;
+
 // HCD closes all opened endpoints belong to this device
 void hcd_device_close(uint8_t rhport, uint8_t dev_addr);
 
@@ -223,6 +240,18 @@ void hcd_event_device_remove(uint8_t rhport, bool in_isr) {
   hcd_event_handler(&event, in_isr);
 }
 
+// Helper to send remote wakeup event of a suspended roothub port
+TU_ATTR_ALWAYS_INLINE static inline
+void hcd_event_device_resume(uint8_t rhport, bool in_isr) {
+  hcd_event_t event;
+  event.rhport              = rhport;
+  event.event_id            = HCD_EVENT_DEVICE_RESUME;
+  event.connection.hub_addr = 0;
+  event.connection.hub_port = 0;
+
+  hcd_event_handler(&event, in_isr);
+}
+
 // Helper to send USB transfer event
 TU_ATTR_ALWAYS_INLINE static inline
 void hcd_event_xfer_complete(uint8_t dev_addr, uint8_t ep_addr, uint32_t xferred_bytes, xfer_result_t result, bool in_isr) {
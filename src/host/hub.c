@@ -45,6 +45,10 @@ typedef struct
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t port_count;
+  uint8_t multi_tt_alt;   // alternate setting of multi-TT interface, 0 if hub only has a single TT
+  uint8_t multi_tt;       // multi-TT alternate setting is selected
+  uint8_t pwr_good_ms;    // time from power-on to power-good of a port (bPwrOn2PwrGood)
+  uint8_t change_pending; // hub (bit 0) and ports whose status change is not yet processed
 
   CFG_TUH_MEM_ALIGN uint8_t status_change;
   CFG_TUH_MEM_ALIGN hub_port_status_response_t port_status;
@@ -52,7 +56,6 @@ typedef struct
 } hub_interface_t;
 
 CFG_TUH_MEM_SECTION static hub_interface_t hub_data[CFG_TUH_HUB];
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN static uint8_t _hub_buffer[sizeof(descriptor_hub_desc_t)];
 
 TU_ATTR_ALWAYS_INLINE
 static inline hub_interface_t* get_itf(uint8_t dev_addr)
@@ -198,10 +201,9 @@ bool hub_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf
   TU_VERIFY(TUSB_CLASS_HUB == itf_desc->bInterfaceClass &&
             0              == itf_desc->bInterfaceSubClass);
 
-  // hub driver does not support multiple TT yet
+  // first alternate setting is single TT, multi-TT hub has another alternate setting with protocol 2
   TU_VERIFY(itf_desc->bInterfaceProtocol <= 1);
 
-  // msc driver length is fixed
   uint16_t const drv_len = sizeof(tusb_desc_interface_t) + sizeof(tusb_desc_endpoint_t);
   TU_ASSERT(drv_len <= max_len);
 
@@ -217,6 +219,21 @@ bool hub_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const *itf
 
   p_hub->itf_num = itf_desc->bInterfaceNumber;
   p_hub->ep_in   = desc_ep->bEndpointAddress;
+  p_hub->multi_tt_alt = 0;
+  p_hub->multi_tt = 0;
+
+  // look for multi-TT alternate setting (USB 2.0 11.23.1)
+  uint8_t const* p_desc = (uint8_t const*) itf_desc;
+  uint8_t const* desc_end = p_desc + max_len;
+  for (p_desc = tu_desc_next(desc_ep); p_desc < desc_end; p_desc = tu_desc_next(p_desc)) {
+    if (tu_desc_type(p_desc) != TUSB_DESC_INTERFACE) continue;
+    tusb_desc_interface_t const* desc_alt = (tusb_desc_interface_t const*) p_desc;
+    if (desc_alt->bInterfaceNumber != itf_desc->bInterfaceNumber) break;
+    if (desc_alt->bAlternateSetting && desc_alt->bInterfaceProtocol == 2) {
+      p_hub->multi_tt_alt = desc_alt->bAlternateSetting;
+      break;
+    }
+  }
 
   return true;
 }
@@ -232,8 +249,13 @@ void hub_close(uint8_t dev_addr)
   }
 }
 
+static bool process_next_change(uint8_t dev_addr);
+
 bool hub_edpt_status_xfer(uint8_t dev_addr)
 {
+  // all changes reported by last status change are processed before polling interrupt endpoint again
+  if (process_next_change(dev_addr)) return true;
+
   hub_interface_t* hub_itf = get_itf(dev_addr);
   return usbh_edpt_xfer(dev_addr, hub_itf->ep_in, &hub_itf->status_change, 1);
 }
@@ -243,14 +265,47 @@ bool hub_edpt_status_xfer(uint8_t dev_addr)
 // Set Configure
 //--------------------------------------------------------------------+
 
+static bool config_get_hub_desc (uint8_t dev_addr);
+static void config_multi_tt_complete (tuh_xfer_t* xfer);
 static void config_set_port_power (tuh_xfer_t* xfer);
 static void config_port_power_complete (tuh_xfer_t* xfer);
 
+bool hub_is_multi_tt(uint8_t hub_addr)
+{
+  if (hub_addr <= CFG_TUH_DEVICE_MAX || hub_addr > CFG_TUH_DEVICE_MAX + CFG_TUH_HUB) return false;
+  return get_itf(hub_addr)->multi_tt;
+}
+
 bool hub_set_config(uint8_t dev_addr, uint8_t itf_num)
 {
   hub_interface_t* p_hub = get_itf(dev_addr);
   TU_ASSERT(itf_num == p_hub->itf_num);
 
+  // Select multi-TT so that Full/Low speed devices on different ports don't share a single TT's bandwidth.
+  // Must be done before any device is attached since TT mode affects their split transactions.
+  if (p_hub->multi_tt_alt)
+  {
+    TU_LOG_DRV("  HUB select multi-TT, alt = %u\r\n", p_hub->multi_tt_alt);
+    TU_ASSERT( tuh_interface_set(dev_addr, itf_num, p_hub->multi_tt_alt, config_multi_tt_complete, 0) );
+    return true;
+  }
+
+  return config_get_hub_desc(dev_addr);
+}
+
+static void config_multi_tt_complete (tuh_xfer_t* xfer)
+{
+  uint8_t const daddr = xfer->daddr;
+  hub_interface_t* p_hub = get_itf(daddr);
+
+  // stay with single TT if hub refuses it
+  p_hub->multi_tt = (xfer->result == XFER_RESULT_SUCCESS) ? 1 : 0;
+
+  TU_ASSERT( config_get_hub_desc(daddr), );
+}
+
+static bool config_get_hub_desc (uint8_t dev_addr)
+{
   // Get Hub Descriptor
   tusb_control_request_t const request =
   {
@@ -271,7 +326,7 @@ bool hub_set_config(uint8_t dev_addr, uint8_t itf_num)
     .daddr       = dev_addr,
     .ep_addr     = 0,
     .setup       = &request,
-    .buffer      = _hub_buffer,
+    .buffer      = usbh_get_enum_buf(dev_addr), // hubs may be enumerated in parallel
     .complete_cb = config_set_port_power,
     .user_data    = 0
   };
@@ -289,12 +344,14 @@ static void config_set_port_power (tuh_xfer_t* xfer)
   hub_interface_t* p_hub = get_itf(daddr);
 
   // only use number of ports in hub descriptor
-  descriptor_hub_desc_t const* desc_hub = (descriptor_hub_desc_t const*) _hub_buffer;
+  descriptor_hub_desc_t const* desc_hub = (descriptor_hub_desc_t const*) usbh_get_enum_buf(daddr);
   p_hub->port_count = desc_hub->bNbrPorts;
+  p_hub->pwr_good_ms = (uint8_t) tu_min16(2u * desc_hub->bPwrOn2PwrGood, UINT8_MAX);
 
   // May need to GET_STATUS
 
-  // Set Port Power to be able to detect connection, starting with port 1
+  // Set Port Power to be able to detect connection, starting with port 1. All ports are powered back-to-back
+  // and share a single power-good wait afterwards.
   uint8_t const hub_port = 1;
   hub_port_set_feature(daddr, hub_port, HUB_FEATURE_PORT_POWER, config_port_power_complete, 0);
 }
@@ -308,8 +365,9 @@ static void config_port_power_complete (tuh_xfer_t* xfer)
 
   if (xfer->setup->wIndex == p_hub->port_count)
   {
-    // All ports are power -> queue notification status endpoint and
-    // complete the SET CONFIGURATION
+    // All ports are power -> wait for power to be good on all of them, then queue notification
+    // status endpoint and complete the SET CONFIGURATION
+    if (p_hub->pwr_good_ms) osal_task_delay(p_hub->pwr_good_ms);
     TU_ASSERT( usbh_edpt_xfer(daddr, p_hub->ep_in, &p_hub->status_change, 1), );
 
     usbh_driver_set_config_complete(daddr, p_hub->itf_num);
@@ -329,6 +387,7 @@ static void hub_port_get_status_complete (tuh_xfer_t* xfer);
 static void hub_get_status_complete (tuh_xfer_t* xfer);
 static void connection_clear_conn_change_complete (tuh_xfer_t* xfer);
 static void connection_port_reset_complete (tuh_xfer_t* xfer);
+static void port_clear_change_complete (tuh_xfer_t* xfer);
 
 // callback as response of interrupt endpoint polling
 bool hub_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
@@ -341,35 +400,47 @@ bool hub_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32
   uint8_t const status_change = p_hub->status_change;
   TU_LOG2("  Hub Status Change = 0x%02X\r\n", status_change);
 
-  if ( status_change == 0 ) {
+  // ignore bits beyond the number of ports, only the first byte of the bitmap (up to 7 ports) is polled
+  uint8_t const change_mask = (uint8_t) (TU_BIT(tu_min8(p_hub->port_count, 7) + 1) - 1);
+  p_hub->change_pending = status_change & change_mask;
+
+  if ( p_hub->change_pending == 0 ) {
     // The status change event was neither for the hub, nor for any of its ports.
     // This shouldn't happen, but it does with some devices.
     // Initiate the next interrupt poll here.
     return hub_edpt_status_xfer(dev_addr);
   }
 
-  if (tu_bit_test(status_change, 0)) {
-    // Hub bit 0 is for the hub device events
-    if (hub_port_get_status(dev_addr, 0, &p_hub->hub_status, hub_get_status_complete, 0) == false) {
-      //Hub status control transfer failed, retry
-      hub_edpt_status_xfer(dev_addr);
-    }
+  if (!process_next_change(dev_addr)) {
+    //Hub status control transfer failed, retry
+    hub_edpt_status_xfer(dev_addr);
   }
-  else {
-    // Hub bits 1 to n are hub port events
-    for (uint8_t port=1; port <= p_hub->port_count; port++) {
-      if ( tu_bit_test(status_change, port) ) {
-        if (hub_port_get_status(dev_addr, port, &p_hub->port_status, hub_port_get_status_complete, 0) == false) {
-          //Hub status control transfer failed, retry
-          hub_edpt_status_xfer(dev_addr);
-        }
-        break;
-      }
+
+  return true;
+}
+
+// Get status of the next hub/port with pending change, each control transfer chain ends with
+// hub_edpt_status_xfer() which continues here. Return false if there is no more change to process.
+static bool process_next_change(uint8_t dev_addr) {
+  hub_interface_t* p_hub = get_itf(dev_addr);
+
+  while (p_hub->change_pending) {
+    uint8_t port = 0;
+    while (!tu_bit_test(p_hub->change_pending, port)) port++;
+    p_hub->change_pending = (uint8_t) tu_bit_clear(p_hub->change_pending, port);
+
+    bool ret;
+    if (port == 0) {
+      // Hub bit 0 is for the hub device events
+      ret = hub_port_get_status(dev_addr, 0, &p_hub->hub_status, hub_get_status_complete, 0);
+    } else {
+      // Hub bits 1 to n are hub port events
+      ret = hub_port_get_status(dev_addr, port, &p_hub->port_status, hub_port_get_status_complete, 0);
     }
+    if (ret) return true;
   }
 
-  // NOTE: next status transfer is queued by usbh.c after handling this request
-  return true;
+  return false;
 }
 
 static void hub_clear_feature_complete_stub(tuh_xfer_t* xfer)
@@ -399,6 +470,11 @@ static void hub_get_status_complete (tuh_xfer_t* xfer)
     TU_LOG1("HUB Over Current, addr = %u\r\n", daddr);
     hub_port_clear_feature(daddr, port_num, HUB_FEATURE_HUB_OVER_CURRENT_CHANGE, hub_clear_feature_complete_stub, 0);
   }
+  else
+  {
+    // nothing to clear, continue with the next change
+    hub_edpt_status_xfer(daddr);
+  }
 }
 
 static void hub_port_get_status_complete (tuh_xfer_t* xfer)
@@ -420,32 +496,72 @@ static void hub_port_get_status_complete (tuh_xfer_t* xfer)
   }else
   {
     // Clear other port status change interrupts. TODO Not currently handled - just cleared.
-    if (p_hub->port_status.change.port_enable)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_ENABLE_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.suspend)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_SUSPEND_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.over_current)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_OVER_CURRENT_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    else if (p_hub->port_status.change.reset)
-    {
-      hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_RESET_CHANGE, hub_clear_feature_complete_stub, 0);
-    }
-    // Other changes are: L1 state
-    // TODO clear change
+    port_clear_change_complete(xfer);
+  }
+}
+
+// Clear the remaining change bits of a port one by one, then continue with the next change
+static void port_clear_change_complete (tuh_xfer_t* xfer)
+{
+  TU_ASSERT(xfer->result == XFER_RESULT_SUCCESS, );
+
+  uint8_t const daddr = xfer->daddr;
+  hub_interface_t* p_hub = get_itf(daddr);
+  uint8_t const port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
+  hub_port_status_response_t* port_status = &p_hub->port_status;
 
-    else
+  uint8_t feature;
+  if (port_status->change.port_enable)
+  {
+    port_status->change.port_enable = 0;
+    feature = HUB_FEATURE_PORT_ENABLE_CHANGE;
+  }
+  else if (port_status->change.suspend)
+  {
+    port_status->change.suspend = 0;
+    feature = HUB_FEATURE_PORT_SUSPEND_CHANGE;
+
+    // resume is complete, requested by host or remote wakeup of the device
+    if (!port_status->status.suspend)
     {
-      // prepare for next hub status
-      // TODO continue with status_change, or maybe we can do it again with status
-      hub_edpt_status_xfer(daddr);
+      hcd_event_t event =
+      {
+        .rhport     = usbh_get_rhport(daddr),
+        .event_id   = HCD_EVENT_DEVICE_RESUME,
+        .connection =
+        {
+          .hub_addr = daddr,
+          .hub_port = port_num
+        }
+      };
+
+      hcd_event_handler(&event, false);
     }
   }
+  else if (port_status->change.over_current)
+  {
+    port_status->change.over_current = 0;
+    feature = HUB_FEATURE_PORT_OVER_CURRENT_CHANGE;
+  }
+  else if (port_status->change.reset)
+  {
+    port_status->change.reset = 0;
+    feature = HUB_FEATURE_PORT_RESET_CHANGE;
+  }
+  // Other changes are: L1 state
+  // TODO clear change
+
+  else
+  {
+    // prepare for next hub status
+    hub_edpt_status_xfer(daddr);
+    return;
+  }
+
+  if (!hub_port_clear_feature(daddr, port_num, feature, port_clear_change_complete, 0))
+  {
+    hub_edpt_status_xfer(daddr);
+  }
 }
 
 static void connection_clear_conn_change_complete (tuh_xfer_t* xfer)
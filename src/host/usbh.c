@@ -65,9 +65,78 @@ TU_ATTR_WEAK void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_is
   (void) in_isr;
 }
 
+TU_ATTR_WEAK void tuh_task_wakeup_cb(uint8_t rhport, bool in_isr) {
+  (void) rhport;
+  (void) in_isr;
+}
+
+TU_ATTR_WEAK uint32_t tuh_stats_timestamp_cb(void) {
+  return 0;
+}
+
+TU_ATTR_WEAK void tuh_int_enter_cb(uint8_t rhport) {
+  (void) rhport;
+}
+
+TU_ATTR_WEAK void tuh_int_exit_cb(uint8_t rhport, uint32_t duration) {
+  (void) rhport;
+  (void) duration;
+}
+
 //--------------------------------------------------------------------+
 // USBH-HCD common data structure
 //--------------------------------------------------------------------+
+#if CFG_TUH_LARGE_XFER
+// Transfer larger than what HCD can do at once (64 KiB) is split into chunks
+typedef struct {
+  uint8_t* buffer;    // start of current chunk
+  uint32_t remaining; // bytes not yet submitted to HCD
+  uint32_t xferred;   // bytes completed by previous chunks
+  uint16_t chunk_len; // length of current chunk
+  uint16_t mps;       // endpoint max packet size
+} usbh_large_xfer_t;
+#endif
+
+#if CFG_TUH_API_EDPT_XFER
+typedef struct {
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+  bool in_isr; // invoke complete_cb in HCD interrupt
+} usbh_xfer_cb_t;
+#endif
+
+#if CFG_TUH_XFER_TIMEOUT
+typedef struct {
+  uint32_t timeout_ms; // 0 if transfer has no timeout
+  uint32_t start;      // frame number when transfer was started
+} usbh_xfer_timeout_t;
+#endif
+
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+typedef struct {
+  uint8_t* buffer;
+  uint32_t total_bytes;
+#if CFG_TUH_XFER_TIMEOUT
+  uint32_t timeout_ms; // loaded into ep_timeout when this transfer starts
+#endif
+} usbh_xfer_desc_t;
+
+typedef struct {
+  usbh_xfer_desc_t desc[CFG_TUH_EDPT_XFER_QUEUE_SZ];
+  volatile uint8_t rd_idx;
+  volatile uint8_t count;   // number of transfers waiting in desc[]
+  volatile uint8_t active;  // HCD has a transfer in progress
+  uint8_t pending;          // submitted transfers whose completion is not yet processed by usbh task
+
+#if CFG_TUH_API_EDPT_XFER
+  // callback of each pending transfer in submission order, cb_idx is the oldest one
+  usbh_xfer_cb_t cb[CFG_TUH_EDPT_XFER_QUEUE_SZ + 1];
+  uint8_t cb_idx;
+  volatile uint8_t completed; // completed by HCD but not yet retired
+#endif
+} usbh_xfer_queue_t;
+#endif
+
 typedef struct {
   // port
   uint8_t rhport;
@@ -94,10 +163,17 @@ typedef struct {
     volatile uint8_t addressed  : 1; // After SET_ADDR
     volatile uint8_t configured : 1; // After SET_CONFIG and all drivers are configured
     volatile uint8_t suspended  : 1; // Bus suspended
+    uint8_t resuming              : 1; // resume requested by host, waiting for hub to complete it
+    uint8_t remote_wakeup_support : 1; // configuration descriptor's attribute
 
     // volatile uint8_t removing : 1; // Physically disconnected, waiting to be processed by usbh
   };
 
+#if CFG_TUH_AUTO_SUSPEND
+  uint16_t auto_suspend_ms; // idle time before suspended, 0 if disabled
+  uint32_t last_active;     // frame number of the last transfer activity
+#endif
+
   // Device Descriptor
   uint8_t  ep0_size;
 
@@ -108,6 +184,19 @@ typedef struct {
   uint8_t  i_product;
   uint8_t  i_serial;
 
+#if CFG_TUH_DESC_CACHE_COUNT
+  uint32_t desc_cache_id; // descriptor cache entry of this device, 0 if none
+#endif
+
+#if CFG_TUH_CONFIG_ITF_ALT_MAX
+  // interface alternate settings of active configuration, each followed by its endpoints in ep_desc[]
+  tusb_desc_interface_t itf_alt[CFG_TUH_CONFIG_ITF_ALT_MAX];
+  uint8_t itf_alt_ep_idx[CFG_TUH_CONFIG_ITF_ALT_MAX]; // index of first endpoint in ep_desc[]
+  tusb_desc_endpoint_t ep_desc[CFG_TUH_CONFIG_EP_MAX];
+  uint8_t itf_alt_count;
+  uint8_t ep_desc_count;
+#endif
+
   // Configuration Descriptor
   // uint8_t interface_count; // bNumInterfaces alias
 
@@ -115,14 +204,36 @@ typedef struct {
   uint8_t itf2drv[CFG_TUH_INTERFACE_MAX];  // map interface number to driver (0xff is invalid)
   uint8_t ep2drv[CFG_TUH_ENDPOINT_MAX][2]; // map endpoint to driver ( 0xff is invalid ), can use only 4-bit each
 
+  // Interface configuration after SET_CONFIGURATION: set_config() of the next interface is started once the
+  // active one releases the control pipe, either when it completes or early with usbh_driver_set_config_release()
+  uint8_t itf_cfg_next;    // next interface to start set_config() on
+  uint8_t itf_cfg_active;  // interface using control pipe, TUSB_INDEX_INVALID_8 if none
+  uint8_t itf_cfg_pending; // number of interfaces started but not yet complete
+
   tu_edpt_state_t ep_status[CFG_TUH_ENDPOINT_MAX][2];
 
-#if CFG_TUH_API_EDPT_XFER
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+  // TODO array can be CFG_TUH_ENDPOINT_MAX-1
+  usbh_xfer_queue_t xfer_queue[CFG_TUH_ENDPOINT_MAX][2];
+#elif CFG_TUH_API_EDPT_XFER
   // TODO array can be CFG_TUH_ENDPOINT_MAX-1
-  struct {
-    tuh_xfer_cb_t complete_cb;
-    uintptr_t user_data;
-  }ep_callback[CFG_TUH_ENDPOINT_MAX][2];
+  usbh_xfer_cb_t ep_callback[CFG_TUH_ENDPOINT_MAX][2];
+#endif
+
+#if CFG_TUH_STATS
+  tuh_stats_edpt_t ep_stats[CFG_TUH_ENDPOINT_MAX][2];
+#endif
+
+#if CFG_TUH_LARGE_XFER
+  usbh_large_xfer_t large_xfer[CFG_TUH_ENDPOINT_MAX][2];
+#endif
+
+#if CFG_TUH_EDPT_XFER_SG
+  uint16_t ep_mps[CFG_TUH_ENDPOINT_MAX][2];
+#endif
+
+#if CFG_TUH_XFER_TIMEOUT
+  usbh_xfer_timeout_t ep_timeout[CFG_TUH_ENDPOINT_MAX][2]; // timeout of transfer in progress on endpoint
 #endif
 
 } usbh_device_t;
@@ -136,6 +247,73 @@ typedef struct {
   #define DRIVER_NAME(_name)  NULL
 #endif
 
+// Interfaces handled by built-in drivers, others are not offered to their open()
+#if CFG_TUH_CDC
+static usbh_class_match_t const cdch_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL),
+    #if CFG_TUH_CDC_FTDI || CFG_TUH_CDC_CP210X || CFG_TUH_CDC_CH34X
+    // vendor serial chips, checked against their VID/PID lists by driver
+    USBH_MATCH_CLASS(TUSB_CLASS_VENDOR_SPECIFIC),
+    #endif
+};
+#endif
+
+#if CFG_TUH_MSC
+static usbh_class_match_t const msch_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI),
+};
+#endif
+
+#if CFG_TUH_HID
+static usbh_class_match_t const hidh_match[] = {
+    USBH_MATCH_CLASS(TUSB_CLASS_HID),
+};
+#endif
+
+#if CFG_TUH_MIDI
+static usbh_class_match_t const midih_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_CONTROL),
+};
+#endif
+
+#if CFG_TUH_AUDIO
+static usbh_class_match_t const audioh_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_AUDIO, AUDIO_SUBCLASS_CONTROL),
+};
+#endif
+
+#if CFG_TUH_RNDIS
+static usbh_class_match_t const rndish_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS_PROTOCOL(TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL, 0xFF),
+    USBH_MATCH_CLASS_SUBCLASS_PROTOCOL(TUSB_CLASS_WIRELESS_CONTROLLER, 0x01, 0x03),
+    USBH_MATCH_CLASS_SUBCLASS_PROTOCOL(TUSB_CLASS_MISC, 0x04, 0x01),
+};
+#endif
+
+#if CFG_TUH_ECM
+static usbh_class_match_t const ecmh_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL),
+};
+#endif
+
+#if CFG_TUH_NCM
+static usbh_class_match_t const ncmh_match[] = {
+    USBH_MATCH_CLASS_SUBCLASS(TUSB_CLASS_CDC, CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL),
+};
+#endif
+
+#if CFG_TUH_HUB
+static usbh_class_match_t const hub_match[] = {
+    USBH_MATCH_CLASS(TUSB_CLASS_HUB),
+};
+#endif
+
+#if CFG_TUH_VENDOR
+static usbh_class_match_t const vendorh_match[] = {
+    USBH_MATCH_CLASS(TUSB_CLASS_VENDOR_SPECIFIC),
+};
+#endif
+
 static usbh_class_driver_t const usbh_class_drivers[] = {
     #if CFG_TUH_CDC
     {
@@ -145,7 +323,9 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
         .open       = cdch_open,
         .set_config = cdch_set_config,
         .xfer_cb    = cdch_xfer_cb,
-        .close      = cdch_close
+        .close      = cdch_close,
+        .match       = cdch_match,
+        .match_count = TU_ARRAY_SIZE(cdch_match)
     },
     #endif
 
@@ -157,7 +337,9 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
         .open       = msch_open,
         .set_config = msch_set_config,
         .xfer_cb    = msch_xfer_cb,
-        .close      = msch_close
+        .close      = msch_close,
+        .match       = msch_match,
+        .match_count = TU_ARRAY_SIZE(msch_match)
     },
     #endif
 
@@ -169,7 +351,85 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
         .open       = hidh_open,
         .set_config = hidh_set_config,
         .xfer_cb    = hidh_xfer_cb,
-        .close      = hidh_close
+        .close      = hidh_close,
+        .match       = hidh_match,
+        .match_count = TU_ARRAY_SIZE(hidh_match)
+    },
+    #endif
+
+    #if CFG_TUH_MIDI
+    {
+        .name       = DRIVER_NAME("MIDI"),
+        .init       = midih_init,
+        .deinit     = midih_deinit,
+        .open       = midih_open,
+        .set_config = midih_set_config,
+        .xfer_cb    = midih_xfer_cb,
+        #if CFG_TUH_MIDI_XFER_ISR
+        .xfer_isr   = midih_xfer_isr,
+        #endif
+        .close      = midih_close,
+        .match       = midih_match,
+        .match_count = TU_ARRAY_SIZE(midih_match)
+    },
+    #endif
+
+    #if CFG_TUH_AUDIO
+    {
+        .name       = DRIVER_NAME("AUDIO"),
+        .init       = audioh_init,
+        .deinit     = audioh_deinit,
+        .open       = audioh_open,
+        .set_config = audioh_set_config,
+        .xfer_cb    = audioh_xfer_cb,
+        #if CFG_TUH_AUDIO_XFER_ISR
+        .xfer_isr   = audioh_xfer_isr,
+        #endif
+        .close      = audioh_close,
+        .match       = audioh_match,
+        .match_count = TU_ARRAY_SIZE(audioh_match)
+    },
+    #endif
+
+    #if CFG_TUH_RNDIS
+    {
+        .name       = DRIVER_NAME("RNDIS"),
+        .init       = rndish_init,
+        .deinit     = rndish_deinit,
+        .open       = rndish_open,
+        .set_config = rndish_set_config,
+        .xfer_cb    = rndish_xfer_cb,
+        .close      = rndish_close,
+        .match       = rndish_match,
+        .match_count = TU_ARRAY_SIZE(rndish_match)
+    },
+    #endif
+
+    #if CFG_TUH_ECM
+    {
+        .name       = DRIVER_NAME("ECM"),
+        .init       = ecmh_init,
+        .deinit     = ecmh_deinit,
+        .open       = ecmh_open,
+        .set_config = ecmh_set_config,
+        .xfer_cb    = ecmh_xfer_cb,
+        .close      = ecmh_close,
+        .match       = ecmh_match,
+        .match_count = TU_ARRAY_SIZE(ecmh_match)
+    },
+    #endif
+
+    #if CFG_TUH_NCM
+    {
+        .name       = DRIVER_NAME("NCM"),
+        .init       = ncmh_init,
+        .deinit     = ncmh_deinit,
+        .open       = ncmh_open,
+        .set_config = ncmh_set_config,
+        .xfer_cb    = ncmh_xfer_cb,
+        .close      = ncmh_close,
+        .match       = ncmh_match,
+        .match_count = TU_ARRAY_SIZE(ncmh_match)
     },
     #endif
 
@@ -181,26 +441,75 @@ static usbh_class_driver_t const usbh_class_drivers[] = {
         .open       = hub_open,
         .set_config = hub_set_config,
         .xfer_cb    = hub_xfer_cb,
-        .close      = hub_close
+        .close      = hub_close,
+        .match       = hub_match,
+        .match_count = TU_ARRAY_SIZE(hub_match)
     },
     #endif
 
     #if CFG_TUH_VENDOR
     {
-      .name       = DRIVER_NAME("VENDOR"),
-      .init       = cush_init,
-      .deinit     = cush_deinit,
-      .open       = cush_open,
-      .set_config = cush_set_config,
-      .xfer_cb    = cush_isr,
-      .close      = cush_close
-    }
+        .name       = DRIVER_NAME("VENDOR"),
+        .init       = vendorh_init,
+        .deinit     = vendorh_deinit,
+        .open       = vendorh_open,
+        .set_config = vendorh_set_config,
+        .xfer_cb    = vendorh_xfer_cb,
+        .close      = vendorh_close,
+        .match       = vendorh_match,
+        .match_count = TU_ARRAY_SIZE(vendorh_match)
+    },
+    #endif
+
+    #if CFG_TUSB_BRIDGE
+    {
+        .name       = DRIVER_NAME("BRIDGE"),
+        .init       = bridgeh_init,
+        .deinit     = bridgeh_deinit,
+        .open       = bridgeh_open,
+        .set_config = bridgeh_set_config,
+        .xfer_cb    = bridgeh_xfer_cb,
+        .close      = bridgeh_close
+    },
     #endif
 };
 
 enum { BUILTIN_DRIVER_COUNT = TU_ARRAY_SIZE(usbh_class_drivers) };
 enum { CONFIG_NUM = 1 }; // default to use configuration 1
 
+#if CFG_TUH_DRIVER_STATIC
+// Built-in drivers only, callbacks are resolved at compile time: see CFG_TUD_DRIVER_STATIC in usbd.c
+#define TOTAL_DRIVER_COUNT    BUILTIN_DRIVER_COUNT
+TU_VERIFY_STATIC(BUILTIN_DRIVER_COUNT > 0, "CFG_TUH_DRIVER_STATIC requires a built-in class driver");
+
+static inline usbh_class_driver_t const *get_driver(uint8_t drv_id) {
+  return (drv_id < BUILTIN_DRIVER_COUNT) ? &usbh_class_drivers[drv_id] : NULL;
+}
+
+#define DRIVER_CASE(_n, _func, ...) \
+  case _n: if ((_n) < BUILTIN_DRIVER_COUNT) return usbh_class_drivers[(_n) < BUILTIN_DRIVER_COUNT ? (_n) : 0]._func(__VA_ARGS__); break
+
+#define DRIVER_DISPATCH(_drv_id, _func, ...) \
+  switch (_drv_id) { \
+    DRIVER_CASE(0, _func, __VA_ARGS__); \
+    DRIVER_CASE(1, _func, __VA_ARGS__); \
+    DRIVER_CASE(2, _func, __VA_ARGS__); \
+    DRIVER_CASE(3, _func, __VA_ARGS__); \
+    default: if ((_drv_id) < BUILTIN_DRIVER_COUNT) return usbh_class_drivers[_drv_id]._func(__VA_ARGS__); break; \
+  }
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_cb(uint8_t drv_id, uint8_t daddr, uint8_t ep_addr,
+                                                        xfer_result_t result, uint32_t xferred_bytes) {
+  DRIVER_DISPATCH(drv_id, xfer_cb, daddr, ep_addr, result, xferred_bytes);
+  return false;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_isr(uint8_t drv_id, uint8_t daddr, uint8_t ep_addr,
+                                                         xfer_result_t result, uint32_t xferred_bytes) {
+  DRIVER_DISPATCH(drv_id, xfer_isr, daddr, ep_addr, result, xferred_bytes);
+  return false;
+}
+#else
 // Additional class drivers implemented by application
 tu_static usbh_class_driver_t const * _app_driver = NULL;
 tu_static uint8_t _app_driver_count = 0;
@@ -219,6 +528,17 @@ static inline usbh_class_driver_t const *get_driver(uint8_t drv_id) {
   return driver;
 }
 
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_cb(uint8_t drv_id, uint8_t daddr, uint8_t ep_addr,
+                                                        xfer_result_t result, uint32_t xferred_bytes) {
+  return get_driver(drv_id)->xfer_cb(daddr, ep_addr, result, xferred_bytes);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool driver_xfer_isr(uint8_t drv_id, uint8_t daddr, uint8_t ep_addr,
+                                                         xfer_result_t result, uint32_t xferred_bytes) {
+  return get_driver(drv_id)->xfer_isr(daddr, ep_addr, result, xferred_bytes);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -244,27 +564,157 @@ static usbh_device_t _usbh_devices[TOTAL_DEVICES];
   #define _usbh_mutex   NULL
 #endif
 
-// Event queue
+// Event queue, one per root port with CFG_TUH_TASK_RHPORT_NUM > 1
 // usbh_int_set is used as mutex in OS NONE config
+TU_VERIFY_STATIC(CFG_TUH_TASK_RHPORT_NUM >= 1 && CFG_TUH_TASK_RHPORT_NUM <= 4, "CFG_TUH_TASK_RHPORT_NUM must be 1-4");
+
 OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
-static osal_queue_t _usbh_q;
+#if CFG_TUH_TASK_RHPORT_NUM > 1
+OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef1, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+#endif
+#if CFG_TUH_TASK_RHPORT_NUM > 2
+OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef2, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+#endif
+#if CFG_TUH_TASK_RHPORT_NUM > 3
+OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef3, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
+#endif
+
+static osal_queue_def_t* const _usbh_qdef_list[CFG_TUH_TASK_RHPORT_NUM] = {
+  &_usbh_qdef,
+#if CFG_TUH_TASK_RHPORT_NUM > 1
+  &_usbh_qdef1,
+#endif
+#if CFG_TUH_TASK_RHPORT_NUM > 2
+  &_usbh_qdef2,
+#endif
+#if CFG_TUH_TASK_RHPORT_NUM > 3
+  &_usbh_qdef3,
+#endif
+};
+
+static osal_queue_t _usbh_q[CFG_TUH_TASK_RHPORT_NUM];
+
+TU_ATTR_ALWAYS_INLINE static inline osal_queue_t rhport_queue(uint8_t rhport) {
+  return _usbh_q[rhport % CFG_TUH_TASK_RHPORT_NUM];
+}
+
+// Lock for stack state shared by all root ports, only needed when their tasks run in separate threads
+#if CFG_TUH_TASK_RHPORT_NUM > 1 && OSAL_MUTEX_REQUIRED
+  static osal_mutex_def_t _usbh_task_mutexdef;
+  static osal_mutex_t _usbh_task_mutex;
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline void usbh_task_lock(void) {
+#if CFG_TUH_TASK_RHPORT_NUM > 1 && OSAL_MUTEX_REQUIRED
+  (void) osal_mutex_lock(_usbh_task_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void usbh_task_unlock(void) {
+#if CFG_TUH_TASK_RHPORT_NUM > 1 && OSAL_MUTEX_REQUIRED
+  (void) osal_mutex_unlock(_usbh_task_mutex);
+#endif
+}
+
+// class driver's xfer_isr() or a complete_in_isr callback is running, used to skip mutex when it submits a transfer
+tu_static volatile bool _usbh_in_xfer_isr = false;
+
+// Enumeration buffer for each device being enumerated in parallel
+CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED
+static uint8_t _usbh_ctrl_buf[CFG_TUH_ENUMERATION_PARALLEL][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_ENUMERATION_BUFSIZE)];
+
+// Enumeration: only the default address phase (reset, 8-byte device descriptor, SET_ADDRESS) is serialized with
+// _dev0. Afterwards device continues at its new address, in parallel with up to CFG_TUH_ENUMERATION_PARALLEL others.
+typedef struct {
+  bool active;
+  bool slow;            // fall back to default timing (adaptive timing)
+  uint8_t daddr;        // assigned address, 0 while in default address phase
+  uint8_t failed_count;
+
+  // Delays (reset, debounce, recovery, retry) are timed by frame number and checked by tuh_task() instead of
+  // blocking it, so that other devices keep running meanwhile
+  uint8_t wait_step;    // step resumed when delay is over, ENUM_IDLE if not waiting
+  uint8_t wait_rhport;
+  uint16_t wait_ms;
+  uint32_t wait_start;
+
+  // failed transfer retried after delay, setup is copied since control request of a hub may be reused meanwhile
+  tuh_xfer_t retry_xfer;
+  tusb_control_request_t retry_setup;
+} usbh_enum_t;
+
+static tuh_configure_enum_timing_t const _enum_timing_default = {
+  .debounce_ms       = 450, // when plug/unplug a device, physical connection can be bouncing and may generate a
+                            // series of attach/detach event. This delay wait for stable connection
+  .reset_ms          = 50,  // USB specs: 10 to 50ms
+  .reset_recovery_ms = 10,  // USB specs: TRSTRCY 10ms
+  .set_address_ms    = 2,   // USB specs: TDSETADDR 2ms
+  .retry_ms          = 100,
+  .adaptive          = 0
+};
+
+static tuh_configure_enum_timing_t _enum_timing = {
+  .debounce_ms       = 450,
+  .reset_ms          = 50,
+  .reset_recovery_ms = 10,
+  .set_address_ms    = 2,
+  .retry_ms          = 100,
+  .adaptive          = 0
+};
+
+// Ports that fell back to default timing with adaptive timing
+typedef struct {
+  uint8_t rhport;
+  uint8_t hub_addr;
+  uint8_t hub_port;
+  bool valid;
+} usbh_slow_port_t;
+
+static usbh_slow_port_t _enum_slow_ports[TOTAL_DEVICES];
+static uint8_t _enum_slow_wr;
 
-CFG_TUH_MEM_SECTION CFG_TUH_MEM_ALIGN
-static uint8_t _usbh_ctrl_buf[CFG_TUH_ENUMERATION_BUFSIZE];
+static usbh_enum_t _usbh_enum[CFG_TUH_ENUMERATION_PARALLEL];
 
-// Control transfers: since most controllers do not support multiple control transfers
-// on multiple devices concurrently and control transfers are not used much except for
-// enumeration, we will only execute control transfers one at a time.
-CFG_TUH_MEM_SECTION struct {
+#if CFG_TUH_DESC_CACHE_COUNT
+// Descriptor cache: skip reading configuration descriptor when the same device is attached again
+typedef struct {
+  uint32_t id;          // unique per insertion, 0 for empty entry
+  uint32_t lru;         // last use stamp
+  uint16_t config_len;  // 0 while configuration descriptor is not stored yet
+  tusb_desc_device_t desc_device;
+  uint8_t desc_config[CFG_TUH_DESC_CACHE_CONFIG_SIZE];
+} usbh_desc_cache_t;
+
+static usbh_desc_cache_t _desc_cache[CFG_TUH_DESC_CACHE_COUNT];
+static uint32_t _desc_cache_stamp;
+#endif
+static uint8_t _enum_dev0_idx = TUSB_INDEX_INVALID_8; // enumeration in default address phase
+static uint8_t _enum_hub_held = 0; // hub whose status polling is held back until an enumeration is free
+
+// Control transfers: each device (including address 0 while enumerating) has its own control transfer state,
+// so that a request to one device does not fail because another device is busy. Since most controllers do not
+// support control transfers on multiple devices concurrently, only one is on the bus at a time: requests of other
+// devices are queued and started in round-robin order when the bus is free (unless CFG_TUH_CONTROL_XFER_CONCURRENT)
+typedef struct {
   CFG_TUH_MEM_ALIGN tusb_control_request_t request;
   uint8_t* buffer;
   tuh_xfer_cb_t complete_cb;
   uintptr_t user_data;
 
-  uint8_t daddr;
   volatile uint8_t stage;
+  volatile bool queued; // waiting for the bus, setup not sent yet
   volatile uint16_t actual_len;
-}_ctrl_xfer;
+
+#if CFG_TUH_XFER_TIMEOUT
+  usbh_xfer_timeout_t timeout; // started when setup is sent, waiting for the bus is not counted
+#endif
+} usbh_ctrl_xfer_t;
+
+CFG_TUH_MEM_SECTION static usbh_ctrl_xfer_t _ctrl_xfer[TOTAL_DEVICES + 1]; // indexed by device address
+
+#if !CFG_TUH_CONTROL_XFER_CONCURRENT
+static uint8_t _ctrl_bus_daddr = TUSB_INDEX_INVALID_8; // device whose control transfer is on the bus
+#endif
 
 //------------- Helper Function -------------//
 
@@ -273,10 +723,46 @@ TU_ATTR_ALWAYS_INLINE static inline usbh_device_t* get_device(uint8_t dev_addr)
   return &_usbh_devices[dev_addr-1];
 }
 
+TU_ATTR_ALWAYS_INLINE static inline usbh_ctrl_xfer_t* get_ctrl_xfer(uint8_t dev_addr) {
+  TU_VERIFY(dev_addr <= TOTAL_DEVICES, NULL);
+  return &_ctrl_xfer[dev_addr];
+}
+
 static bool enum_new_device(hcd_event_t* event);
+static uint8_t enum_get_free(void);
+static void enum_slot_free(uint8_t idx);
+static uint8_t enum_find(uint8_t daddr);
+static bool enum_port_is_slow(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
+static void enum_delay_check(void);
+static uint32_t enum_delay_remaining(void);
 static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
+static void process_resuming_device(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
+static bool device_awake(usbh_device_t* dev, uint8_t daddr);
+static bool edpt_xfer_submit(uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes,
+                             tuh_xfer_cb_t complete_cb, uintptr_t user_data, bool cb_in_isr, uint32_t timeout_ms);
+#if CFG_TUH_API_EDPT_XFER
+TU_ATTR_FAST_FUNC static void invoke_xfer_cb(usbh_xfer_cb_t const* xfer_cb, uint8_t daddr, uint8_t ep_addr,
+                                             xfer_result_t result, uint32_t xferred_bytes, bool in_isr);
+#endif
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+TU_ATTR_FAST_FUNC static bool edpt_xfer_start(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer,
+                                              uint32_t total_bytes, uint32_t timeout_ms);
+TU_ATTR_FAST_FUNC static bool edpt_hcd_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t* buffer,
+                                            uint16_t len);
+#if CFG_TUH_MEM_DCACHE_ENABLE
+static void dcache_xfer_complete(uint8_t daddr, uint8_t ep_addr, uint32_t xferred);
+static void dcache_xfer_clear(uint8_t daddr, uint8_t ep_addr);
+#endif
+
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+static bool xfer_queue_submit(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer,
+                              uint32_t total_bytes, tuh_xfer_cb_t complete_cb, uintptr_t user_data, bool cb_in_isr,
+                              uint32_t timeout_ms);
+TU_ATTR_FAST_FUNC static void xfer_queue_next(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, bool in_isr);
+static bool xfer_queue_retire(usbh_device_t* dev, uint8_t epnum, uint8_t dir, bool in_isr);
+static void xfer_queue_clear(usbh_device_t* dev, uint8_t epnum, uint8_t dir);
+#endif
 
 #if CFG_TUSB_OS == OPT_OS_NONE
 // TODO rework time-related function later
@@ -287,9 +773,51 @@ TU_ATTR_WEAK void osal_task_delay(uint32_t msec) {
 }
 #endif
 
+#if CFG_TUH_STATS
+static tuh_stats_t _usbh_stats;
+static uint32_t _usbh_stats_queued; // total events put into queue, minus event_count is current queue depth
+
+TU_ATTR_ALWAYS_INLINE static inline void stats_xfer_complete(hcd_event_t const* event) {
+  usbh_device_t* dev = get_device(event->dev_addr);
+  if (dev) {
+    uint8_t const ep_addr = event->xfer_complete.ep_addr;
+    tuh_stats_edpt_t* ep_stats = &dev->ep_stats[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+    ep_stats->xfer_count++;
+    ep_stats->xfer_bytes += event->xfer_complete.len;
+    if (event->xfer_complete.result == XFER_RESULT_STALLED) ep_stats->stall_count++;
+    if (event->xfer_complete.result != XFER_RESULT_SUCCESS) ep_stats->xfer_failed++;
+  }
+}
+#endif
+
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(hcd_event_t const * event, bool in_isr) {
-  TU_ASSERT(osal_queue_send(_usbh_q, event, in_isr));
+  // usbh task has nothing to do before this event: notify application to wake up its mainloop
+  osal_queue_t const queue = rhport_queue(event->rhport);
+  bool const wakeup = osal_queue_empty(queue);
+
+#if CFG_TUH_STATS
+  // timestamp to measure latency until usbh task dispatches the event
+  hcd_event_t event_stamped = *event;
+  event_stamped.timestamp = tuh_stats_timestamp_cb();
+  event = &event_stamped;
+
+  if (!osal_queue_send(queue, event, in_isr)) {
+    _usbh_stats.event_dropped++;
+    TU_ASSERT(false);
+  }
+
+  _usbh_stats_queued++;
+  uint32_t const depth = _usbh_stats_queued - _usbh_stats.event_count;
+  if (depth > _usbh_stats.event_queue_hwm) _usbh_stats.event_queue_hwm = (uint16_t) depth;
+#else
+  TU_ASSERT(osal_queue_send(queue, event, in_isr));
+#endif
+
   tuh_event_hook_cb(event->rhport, event->event_id, in_isr);
+  if (wakeup) {
+    tuh_task_wakeup_cb(event->rhport, in_isr);
+  }
   return true;
 }
 
@@ -334,11 +862,317 @@ bool tuh_rhport_reset_bus(uint8_t rhport, bool active) {
   return true;
 }
 
+//--------------------------------------------------------------------+
+// Suspend & Resume
+//--------------------------------------------------------------------+
+
+// no control or OUT transfer in flight. IN endpoints armed by class drivers for polling are fine, they are simply
+// not serviced while the port is suspended
+static bool device_is_idle(uint8_t daddr) {
+  usbh_device_t const* dev = get_device(daddr);
+  if (_ctrl_xfer[daddr].stage != CONTROL_STAGE_IDLE) return false;
+  for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    if (dev->ep_status[epnum][TUSB_DIR_OUT].busy) return false;
+  }
+  return true;
+}
+
+// Transfers can't reach a suspended device, kick off resume if it was suspended by auto-suspend
+static bool device_awake(usbh_device_t* dev, uint8_t daddr) {
+  if (!dev->suspended) return true;
+#if CFG_TUH_AUTO_SUSPEND
+  if (dev->auto_suspend_ms && !dev->resuming) (void) tuh_resume(daddr);
+#else
+  (void) daddr;
+#endif
+  return false;
+}
+
+bool tuh_suspended(uint8_t daddr) {
+  usbh_device_t const* dev = get_device(daddr);
+  while (dev) {
+    if (dev->suspended) return true;
+    dev = dev->hub_addr ? get_device(dev->hub_addr) : NULL;
+  }
+  return false;
+}
+
+static void suspend_complete(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  dev->suspended = 1;
+  TU_LOG_USBH("[%u] USBH Suspended\r\n", daddr);
+  if (tuh_suspend_cb) tuh_suspend_cb(daddr);
+}
+
+#if CFG_TUH_HUB
+static void suspend_port_complete(tuh_xfer_t* xfer) {
+  TU_VERIFY(xfer->result == XFER_RESULT_SUCCESS,);
+  suspend_complete((uint8_t) xfer->user_data);
+}
+#endif
+
+static bool suspend_port(uint8_t daddr) {
+  usbh_device_t const* dev = get_device(daddr);
+#if CFG_TUH_HUB
+  if (dev->hub_addr) {
+    return hub_port_set_feature(dev->hub_addr, dev->hub_port, HUB_FEATURE_PORT_SUSPEND, suspend_port_complete, daddr);
+  }
+#endif
+  TU_VERIFY(hcd_port_suspend && hcd_port_suspend(dev->rhport));
+  suspend_complete(daddr);
+  return true;
+}
+
+static void remote_wakeup_enable_complete(tuh_xfer_t* xfer) {
+  // suspend anyway if device refuses remote wakeup, host can still resume it
+  (void) suspend_port(xfer->daddr);
+}
+
+bool tuh_suspend(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->configured && !dev->suspended && device_is_idle(daddr));
+
+  if (dev->remote_wakeup_support) {
+    tusb_control_request_t const request = {
+        .bmRequestType_bit = {
+            .recipient = TUSB_REQ_RCPT_DEVICE,
+            .type      = TUSB_REQ_TYPE_STANDARD,
+            .direction = TUSB_DIR_OUT
+        },
+        .bRequest = TUSB_REQ_SET_FEATURE,
+        .wValue   = tu_htole16(TUSB_REQ_FEATURE_REMOTE_WAKEUP),
+        .wIndex   = 0,
+        .wLength  = 0
+    };
+    tuh_xfer_t xfer = {
+        .daddr       = daddr,
+        .ep_addr     = 0,
+        .setup       = &request,
+        .buffer      = NULL,
+        .complete_cb = remote_wakeup_enable_complete,
+        .user_data   = 0
+    };
+    return tuh_control_xfer(&xfer);
+  }
+
+  return suspend_port(daddr);
+}
+
+// Drive resume signaling on roothub port, USB 2.0 7.1.7.7: at least 20ms
+static void rhport_resume(uint8_t rhport) {
+  hcd_port_resume(rhport);
+  osal_task_delay(20);
+  hcd_port_resume_end(rhport);
+}
+
+static void resume_complete(uint8_t daddr, bool remote_wakeup) {
+  usbh_device_t* dev = get_device(daddr);
+
+  // USB 2.0 7.1.7.7: TRSMRCY 10ms recovery before device is communicated with
+  osal_task_delay(10);
+
+  dev->suspended = 0;
+  dev->resuming = 0;
+#if CFG_TUH_AUTO_SUSPEND
+  dev->last_active = hcd_frame_number(dev->rhport);
+#endif
+
+  TU_LOG_USBH("[%u] USBH Resumed%s\r\n", daddr, remote_wakeup ? " by remote wakeup" : "");
+  if (tuh_resume_cb) tuh_resume_cb(daddr, remote_wakeup);
+}
+
+#if CFG_TUH_HUB
+static void resume_port_complete(tuh_xfer_t* xfer) {
+  // hub reports end of resume signaling with a port suspend change
+  if (xfer->result != XFER_RESULT_SUCCESS) {
+    usbh_device_t* dev = get_device((uint8_t) xfer->user_data);
+    dev->resuming = 0;
+  }
+}
+#endif
+
+bool tuh_resume(uint8_t daddr) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->suspended && !dev->resuming);
+
+  dev->resuming = 1;
+#if CFG_TUH_HUB
+  if (dev->hub_addr) {
+    if (!hub_port_clear_feature(dev->hub_addr, dev->hub_port, HUB_FEATURE_PORT_SUSPEND, resume_port_complete, daddr)) {
+      dev->resuming = 0;
+      return false;
+    }
+    return true;
+  }
+#endif
+
+  if (!(hcd_port_resume && hcd_port_resume_end)) {
+    dev->resuming = 0;
+    return false;
+  }
+  rhport_resume(dev->rhport);
+  resume_complete(daddr, false);
+  return true;
+}
+
+// a suspended rhport:hub_addr:hub_port is resumed, by host or by remote wakeup of its device
+static void process_resuming_device(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port) {
+  for (uint8_t dev_id = 0; dev_id < TOTAL_DEVICES; dev_id++) {
+    usbh_device_t* dev = &_usbh_devices[dev_id];
+    if (dev->rhport == rhport && dev->connected && dev->suspended &&
+        dev->hub_addr == hub_addr && dev->hub_port == hub_port) {
+      bool const remote_wakeup = !dev->resuming;
+
+      // HCD only detected the remote wakeup, host drives resume signaling after it
+      if (hub_addr == 0 && remote_wakeup) rhport_resume(rhport);
+
+      resume_complete(dev_id + 1, remote_wakeup);
+      break;
+    }
+  }
+}
+
+#if CFG_TUH_AUTO_SUSPEND
+bool tuh_auto_suspend_set(uint8_t daddr, uint16_t idle_ms) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected);
+  dev->auto_suspend_ms = idle_ms;
+  dev->last_active = hcd_frame_number(dev->rhport);
+  return true;
+}
+
+static void auto_suspend_check(void) {
+  for (uint8_t dev_id = 0; dev_id < TOTAL_DEVICES; dev_id++) {
+    usbh_device_t* dev = &_usbh_devices[dev_id];
+    uint8_t const daddr = dev_id + 1;
+    if (!dev->auto_suspend_ms || !dev->configured || dev->suspended) continue;
+
+    uint32_t const now = hcd_frame_number(dev->rhport);
+    if (!device_is_idle(daddr)) {
+      dev->last_active = now;
+    } else if (now - dev->last_active >= dev->auto_suspend_ms) {
+      (void) tuh_suspend(daddr); // retried on next check if hub control pipe is busy
+    }
+  }
+}
+#endif
+
+#if CFG_TUH_XFER_TIMEOUT
+// Time in ms until transfer times out (0 if expired), UINT32_MAX if it has no timeout
+TU_ATTR_ALWAYS_INLINE static inline uint32_t xfer_timeout_remaining(uint8_t rhport, usbh_xfer_timeout_t const* t) {
+  if (!t->timeout_ms) return UINT32_MAX;
+  uint32_t const elapsed = hcd_frame_number(rhport) - t->start;
+  return (elapsed >= t->timeout_ms) ? 0 : (t->timeout_ms - elapsed);
+}
+
+// Abort transfer and complete it with XFER_RESULT_TIMEOUT as if reported by HCD, so that control bus, queued
+// transfers and callbacks are handled as usual. Nothing to do if HCD has no transfer left i.e it just completed.
+static void xfer_timeout_abort(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
+  TU_LOG_USBH("[%u:%u] Transfer timeout on EP %02X\r\n", rhport, daddr, ep_addr);
+  if (!hcd_edpt_abort_xfer(rhport, daddr, ep_addr)) return;
+
+  hcd_event_t event = { .rhport = rhport, .event_id = HCD_EVENT_XFER_COMPLETE, .dev_addr = daddr };
+  event.xfer_complete.ep_addr = ep_addr;
+  event.xfer_complete.len     = 0;
+  event.xfer_complete.result  = XFER_RESULT_TIMEOUT;
+
+  usbh_int_set(false);
+  hcd_event_handler(&event, false);
+  usbh_int_set(true);
+}
+
+// Abort expired transfers. Return time in ms until the earliest deadline of the others, UINT32_MAX if none
+static uint32_t xfer_timeout_check(void) {
+  uint32_t next = UINT32_MAX;
+  for (uint8_t daddr = 0; daddr <= TOTAL_DEVICES; daddr++) {
+    uint8_t const rhport = usbh_get_rhport(daddr);
+
+    usbh_ctrl_xfer_t* ctrl = &_ctrl_xfer[daddr];
+    uint8_t const stage = ctrl->stage;
+    if (stage != CONTROL_STAGE_IDLE && !ctrl->queued) {
+      uint32_t const remaining = xfer_timeout_remaining(rhport, &ctrl->timeout);
+      if (remaining == 0) {
+        ctrl->timeout.timeout_ms = 0; // checked once, HCD may not be able to abort
+        uint8_t const dir = ctrl->request.bmRequestType_bit.direction;
+        uint8_t const ep_addr = (stage == CONTROL_STAGE_SETUP) ? 0 :
+                                tu_edpt_addr(0, (stage == CONTROL_STAGE_DATA) ? dir : 1 - dir);
+        xfer_timeout_abort(rhport, daddr, ep_addr);
+      } else {
+        next = tu_min32(next, remaining);
+      }
+    }
+
+    usbh_device_t* dev = get_device(daddr);
+    if (!dev || !dev->connected) continue;
+    for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        usbh_xfer_timeout_t* t = &dev->ep_timeout[epnum][dir];
+        if (!dev->ep_status[epnum][dir].busy) continue;
+
+        uint32_t const remaining = xfer_timeout_remaining(rhport, t);
+        if (remaining == 0) {
+          t->timeout_ms = 0;
+          xfer_timeout_abort(rhport, daddr, tu_edpt_addr(epnum, dir));
+        } else {
+          next = tu_min32(next, remaining);
+        }
+      }
+    }
+  }
+
+  // frame number is the time base: while transfers are armed, re-check at least every second in case it stalls
+  // (e.g. port suspended) or a new transfer is armed by another thread with an earlier deadline
+  return (next == UINT32_MAX) ? UINT32_MAX : tu_min32(next, 1000);
+}
+#endif
+
+#if CFG_TUH_STATS
+bool tuh_stats_get(tuh_stats_t* stats) {
+  TU_VERIFY(stats && tuh_inited());
+  usbh_int_set(false);
+  *stats = _usbh_stats;
+  usbh_int_set(true);
+  return true;
+}
+
+bool tuh_stats_edpt_get(uint8_t daddr, uint8_t ep_addr, tuh_stats_edpt_t* stats) {
+  usbh_device_t const* dev = get_device(daddr);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(stats && dev && epnum < CFG_TUH_ENDPOINT_MAX);
+
+  usbh_int_set(false);
+  *stats = dev->ep_stats[epnum][tu_edpt_dir(ep_addr)];
+  usbh_int_set(true);
+  return true;
+}
+
+void tuh_stats_clear(void) {
+  bool const inited = tuh_inited();
+  if (inited) usbh_int_set(false);
+
+  // keep events that are still in queue
+  _usbh_stats_queued -= _usbh_stats.event_count;
+  tu_varclr(&_usbh_stats);
+
+  for (uint8_t i = 0; i < TOTAL_DEVICES; i++) {
+    tu_varclr(&_usbh_devices[i].ep_stats);
+  }
+
+  if (inited) usbh_int_set(true);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // PUBLIC API (Parameter Verification is required)
 //--------------------------------------------------------------------+
 
 bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
+  if (cfg_id == TUH_CFGID_ENUM_TIMING) {
+    TU_VERIFY(cfg_param);
+    _enum_timing = *((tuh_configure_enum_timing_t const*) cfg_param);
+    return true;
+  }
+
   return hcd_configure(rhport, cfg_id, cfg_param);
 }
 
@@ -362,30 +1196,56 @@ bool tuh_init(uint8_t rhport) {
   if (!tuh_inited()) {
     TU_LOG_INT_USBH(sizeof(usbh_device_t));
     TU_LOG_INT_USBH(sizeof(hcd_event_t));
-    TU_LOG_INT_USBH(sizeof(_ctrl_xfer));
+    TU_LOG_INT_USBH(sizeof(usbh_ctrl_xfer_t));
     TU_LOG_INT_USBH(sizeof(tuh_xfer_t));
     TU_LOG_INT_USBH(sizeof(tu_fifo_t));
     TU_LOG_INT_USBH(sizeof(tu_edpt_stream_t));
 
     // Event queue
-    _usbh_q = osal_queue_create(&_usbh_qdef);
-    TU_ASSERT(_usbh_q != NULL);
+    for (uint8_t qid = 0; qid < CFG_TUH_TASK_RHPORT_NUM; qid++) {
+      _usbh_q[qid] = osal_queue_create(_usbh_qdef_list[qid]);
+      TU_ASSERT(_usbh_q[qid] != NULL);
+    }
 
 #if OSAL_MUTEX_REQUIRED
     // Init mutex
     _usbh_mutex = osal_mutex_create(&_usbh_mutexdef);
     TU_ASSERT(_usbh_mutex);
+
+  #if CFG_TUH_TASK_RHPORT_NUM > 1
+    _usbh_task_mutex = osal_mutex_create(&_usbh_task_mutexdef);
+    TU_ASSERT(_usbh_task_mutex);
+  #endif
 #endif
 
+#if !CFG_TUH_DRIVER_STATIC
     // Get application driver if available
     if (usbh_app_driver_get_cb) {
       _app_driver = usbh_app_driver_get_cb(&_app_driver_count);
     }
+#endif
 
     // Device
     tu_memclr(&_dev0, sizeof(_dev0));
+    tu_memclr(_usbh_enum, sizeof(_usbh_enum));
+#if CFG_TUH_DESC_CACHE_COUNT
+    tu_memclr(_desc_cache, sizeof(_desc_cache));
+    _desc_cache_stamp = 0;
+#endif
+    _enum_dev0_idx = TUSB_INDEX_INVALID_8;
+    _enum_hub_held = 0;
+    tu_memclr(_enum_slow_ports, sizeof(_enum_slow_ports));
+    _enum_slow_wr = 0;
     tu_memclr(_usbh_devices, sizeof(_usbh_devices));
-    tu_memclr(&_ctrl_xfer, sizeof(_ctrl_xfer));
+    tu_memclr(_ctrl_xfer, sizeof(_ctrl_xfer));
+#if !CFG_TUH_CONTROL_XFER_CONCURRENT
+    _ctrl_bus_daddr = TUSB_INDEX_INVALID_8;
+#endif
+
+#if CFG_TUH_STATS
+    tu_varclr(&_usbh_stats);
+    _usbh_stats_queued = 0;
+#endif
 
     for (uint8_t i = 0; i < TOTAL_DEVICES; i++) {
       clear_device(&_usbh_devices[i]);
@@ -431,13 +1291,20 @@ bool tuh_deinit(uint8_t rhport) {
       }
     }
 
-    osal_queue_delete(_usbh_q);
-    _usbh_q = NULL;
+    for (uint8_t qid = 0; qid < CFG_TUH_TASK_RHPORT_NUM; qid++) {
+      osal_queue_delete(_usbh_q[qid]);
+      _usbh_q[qid] = NULL;
+    }
 
     #if OSAL_MUTEX_REQUIRED
     // TODO make sure there is no task waiting on this mutex
     osal_mutex_delete(_usbh_mutex);
     _usbh_mutex = NULL;
+
+    #if CFG_TUH_TASK_RHPORT_NUM > 1
+    osal_mutex_delete(_usbh_task_mutex);
+    _usbh_task_mutex = NULL;
+    #endif
     #endif
   }
 
@@ -448,7 +1315,186 @@ bool tuh_task_event_ready(void) {
   // Skip if stack is not initialized
   if ( !tuh_inited() ) return false;
 
-  return !osal_queue_empty(_usbh_q);
+  for (uint8_t qid = 0; qid < CFG_TUH_TASK_RHPORT_NUM; qid++) {
+    if (!osal_queue_empty(_usbh_q[qid])) return true;
+  }
+  return false;
+}
+
+bool tuh_task_sleep(void (*sleep_func)(void)) {
+  // Called with interrupts masked: an event queued after this check keeps its interrupt pending, which wakes up
+  // sleep_func() right away
+  if (tuh_task_event_ready()) return false;
+  sleep_func();
+  return true;
+}
+
+// Process an event, return false if task should stop processing its queue for now
+static bool process_event(hcd_event_t* event, bool in_isr) {
+#if CFG_TUH_STATS
+  _usbh_stats.event_count++;
+  uint32_t const latency = tuh_stats_timestamp_cb() - event->timestamp;
+  if (latency > _usbh_stats.event_latency_max) _usbh_stats.event_latency_max = latency;
+  tu_stats_hist_add(_usbh_stats.event_latency_hist, latency);
+#endif
+
+  TU_TRACE(TU_TRACE_USBH_TASK, event->rhport,
+           event->event_id == HCD_EVENT_XFER_COMPLETE ? event->xfer_complete.ep_addr : 0, event->event_id, 0);
+
+  switch (event->event_id) {
+    case HCD_EVENT_DEVICE_ATTACH:
+      // default address can only be used by one device at a time, and each enumeration needs its own buffer
+      // TODO better to have an separated queue for newly attached devices
+      if (_enum_dev0_idx != TUSB_INDEX_INVALID_8 || enum_get_free() == TUSB_INDEX_INVALID_8) {
+        TU_LOG_USBH("[%u:] USBH Defer Attach until current enumeration complete\r\n", event->rhport);
+
+        bool is_empty = osal_queue_empty(rhport_queue(event->rhport));
+        queue_event(event, in_isr);
+
+        if (is_empty) {
+          // Exit if this is the only event in the queue, otherwise we may loop forever
+          return false;
+        }
+      } else {
+        TU_LOG_USBH("[%u:] USBH DEVICE ATTACH\r\n", event->rhport);
+        _enum_dev0_idx = enum_get_free();
+        _usbh_enum[_enum_dev0_idx] = (usbh_enum_t) {
+          .active = true,
+          .slow = enum_port_is_slow(event->rhport, event->connection.hub_addr, event->connection.hub_port),
+          .daddr = 0,
+          .failed_count = 0
+        };
+        _dev0.enumerating = 1;
+        enum_new_device(event);
+      }
+      break;
+
+    case HCD_EVENT_DEVICE_REMOVE:
+      TU_LOG_USBH("[%u:%u:%u] USBH DEVICE REMOVED\r\n", event->rhport, event->connection.hub_addr, event->connection.hub_port);
+      process_removing_device(event->rhport, event->connection.hub_addr, event->connection.hub_port);
+
+      #if CFG_TUH_HUB
+      // TODO remove
+      if (event->connection.hub_addr != 0 && event->connection.hub_port != 0) {
+        // done with hub, waiting for next data on status pipe
+        (void) hub_edpt_status_xfer(event->connection.hub_addr);
+      }
+      #endif
+      break;
+
+    case HCD_EVENT_DEVICE_RESUME:
+      TU_LOG_USBH("[%u:%u:%u] USBH DEVICE RESUME\r\n", event->rhport, event->connection.hub_addr, event->connection.hub_port);
+      process_resuming_device(event->rhport, event->connection.hub_addr, event->connection.hub_port);
+      break;
+
+    case HCD_EVENT_XFER_COMPLETE: {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+      uint8_t const epnum = tu_edpt_number(ep_addr);
+      uint8_t const ep_dir = (uint8_t) tu_edpt_dir(ep_addr);
+
+      TU_LOG_USBH("on EP %02X with %u bytes: %s\r\n", ep_addr, (unsigned int) event->xfer_complete.len, tu_str_xfer_result[event->xfer_complete.result]);
+
+      if (event->dev_addr == 0) {
+        // device 0 only has control endpoint
+        TU_ASSERT(epnum == 0, false);
+        usbh_control_xfer_cb(event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+      } else {
+        usbh_device_t* dev = get_device(event->dev_addr);
+        TU_VERIFY(dev && dev->connected, false);
+        #if CFG_TUH_AUTO_SUSPEND
+        dev->last_active = hcd_frame_number(event->rhport);
+        #endif
+
+        #if CFG_TUH_API_EDPT_XFER
+        usbh_xfer_cb_t xfer_cb = { .complete_cb = NULL, .user_data = 0 };
+        #endif
+
+        #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+        if (epnum) {
+          #if CFG_TUH_API_EDPT_XFER
+          usbh_xfer_queue_t const* q = &dev->xfer_queue[epnum][ep_dir];
+          if (q->pending) xfer_cb = q->cb[q->cb_idx];
+          #endif
+          (void) xfer_queue_retire(dev, epnum, ep_dir, false);
+        } else
+        #endif
+        {
+          dev->ep_status[epnum][ep_dir].busy = 0;
+          dev->ep_status[epnum][ep_dir].claimed = 0;
+
+          #if CFG_TUH_API_EDPT_XFER && !CFG_TUH_EDPT_XFER_QUEUE_SZ
+          if (epnum) xfer_cb = dev->ep_callback[epnum][ep_dir];
+          #endif
+        }
+
+        if (0 == epnum) {
+          usbh_control_xfer_cb(event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+        } else {
+          // Prefer application callback over built-in one if available. This occurs when tuh_edpt_xfer() is used
+          // with enabled driver e.g HID endpoint
+          #if CFG_TUH_API_EDPT_XFER
+          if (xfer_cb.complete_cb) {
+            invoke_xfer_cb(&xfer_cb, event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                           event->xfer_complete.len, false);
+          }else
+          #endif
+          {
+            uint8_t const drv_id = dev->ep2drv[epnum][ep_dir];
+            usbh_class_driver_t const* driver = get_driver(drv_id);
+            if (driver) {
+              TU_LOG_USBH("%s xfer callback\r\n", driver->name);
+              TU_TRACE(TU_TRACE_USBH_CLASS_CB, event->rhport, ep_addr, event->xfer_complete.result,
+                       event->xfer_complete.len);
+              driver_xfer_cb(drv_id, event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                             event->xfer_complete.len);
+              TU_TRACE(TU_TRACE_USBH_CLASS_END, event->rhport, ep_addr, 0, 0);
+            } else {
+              // no driver/callback responsible for this transfer
+              TU_ASSERT(false, false);
+            }
+          }
+        }
+      }
+      break;
+    }
+
+    case USBH_EVENT_FUNC_CALL:
+      if (event->func_call.func) event->func_call.func(event->func_call.param);
+      break;
+
+    default:
+      break;
+  }
+
+  return true;
+}
+
+// Process events of a queue until there is no more or max_events are processed. Return number of processed events
+static uint32_t task_process_queue(uint8_t qid, uint32_t timeout_ms, bool in_isr, uint32_t max_events) {
+  uint32_t count = 0;
+
+  // Loop until there is no more events in the queue
+  while (count < max_events) {
+    hcd_event_t event;
+    if (!osal_queue_receive(_usbh_q[qid], &event, timeout_ms)) break;
+    count++;
+
+    // Enumeration, device table and control transfers are shared by all root ports: their events are processed with
+    // the task lock. Data endpoint completions only touch their own device and are dispatched without it, so that
+    // a root port's task is not held up by another one.
+    bool const shared = !(event.event_id == HCD_EVENT_XFER_COMPLETE && tu_edpt_number(event.xfer_complete.ep_addr) != 0);
+    if (shared) usbh_task_lock();
+    bool const more = process_event(&event, in_isr);
+    if (shared) usbh_task_unlock();
+    if (!more) break;
+
+#if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
+    // return if there is no more events, for application to run other background
+    if (osal_queue_empty(_usbh_q[qid])) break;
+#endif
+  }
+
+  return count;
 }
 
 /* USB Host Driver task
@@ -469,133 +1515,147 @@ bool tuh_task_event_ready(void) {
     }
     @endcode
  */
+// Run timers and process queued events of all root ports, up to max_events. Return number of processed events
+static uint32_t usbh_task_run(uint32_t timeout_ms, bool in_isr, uint32_t max_events) {
+#if CFG_TUH_AUTO_SUSPEND
+  usbh_task_lock();
+  auto_suspend_check();
+  usbh_task_unlock();
+#endif
+
+#if CFG_TUH_XFER_TIMEOUT
+  usbh_task_lock();
+  timeout_ms = tu_min32(timeout_ms, xfer_timeout_check());
+  usbh_task_unlock();
+#endif
+
+  usbh_task_lock();
+  enum_delay_check();
+  usbh_task_unlock();
+
+  // other root ports' queues are only polled, wait is done on the first one but not past a pending enumeration delay
+  // or transfer deadline
+  uint32_t count = 0;
+  for (uint8_t qid = 1; qid < CFG_TUH_TASK_RHPORT_NUM; qid++) {
+    count += task_process_queue(qid, 0, in_isr, max_events - count);
+  }
+  count += task_process_queue(0, tu_min32(timeout_ms, enum_delay_remaining()), in_isr, max_events - count);
+
+  return count;
+}
+
 void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
   (void) in_isr; // not implemented yet
 
   // Skip if stack is not initialized
   if (!tuh_inited()) return;
 
-  // Loop until there is no more events in the queue
-  while (1) {
-    hcd_event_t event;
-    if (!osal_queue_receive(_usbh_q, &event, timeout_ms)) return;
+  (void) usbh_task_run(timeout_ms, in_isr, UINT32_MAX);
+}
 
-    switch (event.event_id) {
-      case HCD_EVENT_DEVICE_ATTACH:
-        // due to the shared _usbh_ctrl_buf, we must complete enumerating one device before enumerating another one.
-        // TODO better to have an separated queue for newly attached devices
-        if (_dev0.enumerating) {
-          TU_LOG_USBH("[%u:] USBH Defer Attach until current enumeration complete\r\n", event.rhport);
+uint32_t tuh_task_budget(uint32_t max_events) {
+  if (!tuh_inited()) return 0;
+  return usbh_task_run(0, false, max_events);
+}
 
-          bool is_empty = osal_queue_empty(_usbh_q);
-          queue_event(&event, in_isr);
+void tuh_task_rhport_ext(uint8_t rhport, uint32_t timeout_ms, bool in_isr) {
+  (void) in_isr; // not implemented yet
 
-          if (is_empty) {
-            // Exit if this is the only event in the queue, otherwise we may loop forever
-            return;
-          }
-        } else {
-          TU_LOG_USBH("[%u:] USBH DEVICE ATTACH\r\n", event.rhport);
-          _dev0.enumerating = 1;
-          enum_new_device(&event);
-        }
-        break;
+  // Skip if stack is not initialized
+  if (!tuh_inited()) return;
 
-      case HCD_EVENT_DEVICE_REMOVE:
-        TU_LOG_USBH("[%u:%u:%u] USBH DEVICE REMOVED\r\n", event.rhport, event.connection.hub_addr, event.connection.hub_port);
-        process_removing_device(event.rhport, event.connection.hub_addr, event.connection.hub_port);
+#if CFG_TUH_AUTO_SUSPEND
+  usbh_task_lock();
+  auto_suspend_check();
+  usbh_task_unlock();
+#endif
 
-        #if CFG_TUH_HUB
-        // TODO remove
-        if (event.connection.hub_addr != 0 && event.connection.hub_port != 0) {
-          // done with hub, waiting for next data on status pipe
-          (void) hub_edpt_status_xfer(event.connection.hub_addr);
-        }
-        #endif
-        break;
+#if CFG_TUH_XFER_TIMEOUT
+  usbh_task_lock();
+  timeout_ms = tu_min32(timeout_ms, xfer_timeout_check());
+  usbh_task_unlock();
+#endif
 
-      case HCD_EVENT_XFER_COMPLETE: {
-        uint8_t const ep_addr = event.xfer_complete.ep_addr;
-        uint8_t const epnum = tu_edpt_number(ep_addr);
-        uint8_t const ep_dir = (uint8_t) tu_edpt_dir(ep_addr);
+  usbh_task_lock();
+  enum_delay_check();
+  usbh_task_unlock();
 
-        TU_LOG_USBH("on EP %02X with %u bytes: %s\r\n", ep_addr, (unsigned int) event.xfer_complete.len, tu_str_xfer_result[event.xfer_complete.result]);
+  (void) task_process_queue(rhport % CFG_TUH_TASK_RHPORT_NUM, tu_min32(timeout_ms, enum_delay_remaining()), in_isr,
+                            UINT32_MAX);
+}
 
-        if (event.dev_addr == 0) {
-          // device 0 only has control endpoint
-          TU_ASSERT(epnum == 0,);
-          usbh_control_xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
-        } else {
-          usbh_device_t* dev = get_device(event.dev_addr);
-          TU_VERIFY(dev && dev->connected,);
+//--------------------------------------------------------------------+
+// Control transfer
+//--------------------------------------------------------------------+
 
-          dev->ep_status[epnum][ep_dir].busy = 0;
-          dev->ep_status[epnum][ep_dir].claimed = 0;
+static void _control_blocking_complete_cb(tuh_xfer_t* xfer) {
+  // update result
+  *((xfer_result_t*) xfer->user_data) = xfer->result;
+}
 
-          if (0 == epnum) {
-            usbh_control_xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
-          } else {
-            // Prefer application callback over built-in one if available. This occurs when tuh_edpt_xfer() is used
-            // with enabled driver e.g HID endpoint
-            #if CFG_TUH_API_EDPT_XFER
-            tuh_xfer_cb_t const complete_cb = dev->ep_callback[epnum][ep_dir].complete_cb;
-            if ( complete_cb ) {
-              // re-construct xfer info
-              tuh_xfer_t xfer = {
-                  .daddr       = event.dev_addr,
-                  .ep_addr     = ep_addr,
-                  .result      = event.xfer_complete.result,
-                  .actual_len  = event.xfer_complete.len,
-                  .buflen      = 0,    // not available
-                  .buffer      = NULL, // not available
-                  .complete_cb = complete_cb,
-                  .user_data   = dev->ep_callback[epnum][ep_dir].user_data
-              };
-              complete_cb(&xfer);
-            }else
-            #endif
-            {
-              uint8_t drv_id = dev->ep2drv[epnum][ep_dir];
-              usbh_class_driver_t const* driver = get_driver(drv_id);
-              if (driver) {
-                TU_LOG_USBH("%s xfer callback\r\n", driver->name);
-                driver->xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result,
-                                event.xfer_complete.len);
-              } else {
-                // no driver/callback responsible for this transfer
-                TU_ASSERT(false,);
-              }
-            }
-          }
-        }
-        break;
-      }
+static void _control_xfer_complete(uint8_t daddr, xfer_result_t result);
 
-      case USBH_EVENT_FUNC_CALL:
-        if (event.func_call.func) event.func_call.func(event.func_call.param);
-        break;
+// Send setup packet of a device's control transfer
+static bool _control_xfer_send_setup(uint8_t daddr) {
+  usbh_ctrl_xfer_t* ctrl = &_ctrl_xfer[daddr];
+  const uint8_t rhport = usbh_get_rhport(daddr);
 
-      default:
-        break;
-    }
+  TU_LOG_USBH("[%u:%u] %s: ", rhport, daddr,
+              (ctrl->request.bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && ctrl->request.bRequest <= TUSB_REQ_SYNCH_FRAME) ?
+                  tu_str_std_request[ctrl->request.bRequest] : "Class Request");
+  TU_LOG_BUF_USBH(&ctrl->request, 8);
 
-#if CFG_TUSB_OS != OPT_OS_NONE && CFG_TUSB_OS != OPT_OS_PICO
-    // return if there is no more events, for application to run other background
-    if (osal_queue_empty(_usbh_q)) return;
-#endif
+  #if CFG_TUH_MEM_DCACHE_ENABLE
+  // setup packet supersedes control transfer in progress
+  dcache_xfer_clear(daddr, TUSB_DIR_IN_MASK);
+  #endif
+
+  #if CFG_TUH_XFER_TIMEOUT
+  ctrl->timeout.start = hcd_frame_number(rhport);
+  #endif
+
+  return hcd_setup_send(rhport, daddr, (uint8_t const*) &ctrl->request);
+}
+
+#if !CFG_TUH_CONTROL_XFER_CONCURRENT
+// Claim the bus for daddr's control transfer, otherwise mark it as queued. Return true if claimed
+static bool _control_bus_claim(uint8_t daddr) {
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  bool const claimed = (_ctrl_bus_daddr == TUSB_INDEX_INVALID_8);
+  if (claimed) {
+    _ctrl_bus_daddr = daddr;
+  } else {
+    _ctrl_xfer[daddr].queued = true;
   }
+  (void) osal_mutex_unlock(_usbh_mutex);
+  return claimed;
 }
 
-//--------------------------------------------------------------------+
-// Control transfer
-//--------------------------------------------------------------------+
+// Release the bus held by daddr and start the next queued control transfer, searching round-robin after daddr
+static void _control_bus_release(uint8_t daddr) {
+  uint8_t next = TUSB_INDEX_INVALID_8;
 
-static void _control_blocking_complete_cb(tuh_xfer_t* xfer) {
-  // update result
-  *((xfer_result_t*) xfer->user_data) = xfer->result;
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  if (_ctrl_bus_daddr == daddr) {
+    _ctrl_bus_daddr = TUSB_INDEX_INVALID_8;
+    for (uint8_t i = 1; i <= TOTAL_DEVICES + 1; i++) {
+      uint8_t const addr = (uint8_t) ((daddr + i) % (TOTAL_DEVICES + 1));
+      if (_ctrl_xfer[addr].queued) {
+        _ctrl_xfer[addr].queued = false;
+        _ctrl_bus_daddr = next = addr;
+        break;
+      }
+    }
+  }
+  (void) osal_mutex_unlock(_usbh_mutex);
+
+  if (next != TUSB_INDEX_INVALID_8 && !_control_xfer_send_setup(next)) {
+    // report failure, which also moves on to the next queued transfer
+    _control_xfer_complete(next, XFER_RESULT_FAILED);
+  }
 }
+#endif
 
-// TODO timeout_ms is not supported yet
 bool tuh_control_xfer (tuh_xfer_t* xfer) {
   // EP0 with setup packet
   TU_VERIFY(xfer->ep_addr == 0 && xfer->setup);
@@ -605,56 +1665,74 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
   if ( daddr == 0 ) {
     if (!_dev0.enumerating) return false;
   } else {
-    usbh_device_t const* dev = get_device(daddr);
+    usbh_device_t* dev = get_device(daddr);
     if (dev && dev->connected == 0) return false;
+    if (dev && !device_awake(dev, daddr)) return false;
   }
 
+  usbh_ctrl_xfer_t* ctrl = get_ctrl_xfer(daddr);
+  TU_VERIFY(ctrl);
+
   // pre-check to help reducing mutex lock
-  TU_VERIFY(_ctrl_xfer.stage == CONTROL_STAGE_IDLE);
+  TU_VERIFY(ctrl->stage == CONTROL_STAGE_IDLE);
   (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
 
-  bool const is_idle = (_ctrl_xfer.stage == CONTROL_STAGE_IDLE);
+  bool const is_idle = (ctrl->stage == CONTROL_STAGE_IDLE);
   if (is_idle) {
-    _ctrl_xfer.stage       = CONTROL_STAGE_SETUP;
-    _ctrl_xfer.daddr       = daddr;
-    _ctrl_xfer.actual_len  = 0;
-
-    _ctrl_xfer.request     = (*xfer->setup);
-    _ctrl_xfer.buffer      = xfer->buffer;
-    _ctrl_xfer.complete_cb = xfer->complete_cb;
-    _ctrl_xfer.user_data   = xfer->user_data;
+    ctrl->stage       = CONTROL_STAGE_SETUP;
+    ctrl->actual_len  = 0;
+
+    ctrl->request     = (*xfer->setup);
+    ctrl->buffer      = xfer->buffer;
+    ctrl->complete_cb = xfer->complete_cb;
+    ctrl->user_data   = xfer->user_data;
+    #if CFG_TUH_XFER_TIMEOUT
+    ctrl->timeout.timeout_ms = xfer->timeout_ms;
+    #endif
   }
 
   (void) osal_mutex_unlock(_usbh_mutex);
 
   TU_VERIFY(is_idle);
-  const uint8_t rhport = usbh_get_rhport(daddr);
-
-  TU_LOG_USBH("[%u:%u] %s: ", rhport, daddr,
-              (xfer->setup->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && xfer->setup->bRequest <= TUSB_REQ_SYNCH_FRAME) ?
-                  tu_str_std_request[xfer->setup->bRequest] : "Class Request");
-  TU_LOG_BUF_USBH(xfer->setup, 8);
-
-  if (xfer->complete_cb) {
-    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t const*) &_ctrl_xfer.request) );
-  }else {
-    // blocking if complete callback is not provided
-    // change callback to internal blocking, and result as user argument
-    volatile xfer_result_t result = XFER_RESULT_INVALID;
 
+  // blocking if complete callback is not provided
+  // change callback to internal blocking, and result as user argument
+  volatile xfer_result_t result = XFER_RESULT_INVALID;
+  if (!xfer->complete_cb) {
     // use user_data to point to xfer_result_t
-    _ctrl_xfer.user_data   = (uintptr_t) &result;
-    _ctrl_xfer.complete_cb = _control_blocking_complete_cb;
+    ctrl->user_data   = (uintptr_t) &result;
+    ctrl->complete_cb = _control_blocking_complete_cb;
+  }
 
-    TU_ASSERT( hcd_setup_send(rhport, daddr, (uint8_t*) &_ctrl_xfer.request) );
+#if !CFG_TUH_CONTROL_XFER_CONCURRENT
+  // setup is sent when the control transfer of another device completes
+  if (_control_bus_claim(daddr))
+#endif
+  {
+    if (!_control_xfer_send_setup(daddr)) {
+      ctrl->stage = CONTROL_STAGE_IDLE;
+      #if !CFG_TUH_CONTROL_XFER_CONCURRENT
+      _control_bus_release(daddr);
+      #endif
+      TU_ASSERT(false);
+    }
+  }
 
+  if (!xfer->complete_cb) {
     while (result == XFER_RESULT_INVALID) {
       // Note: this can be called within an callback ie. part of tuh_task()
       // therefore event with RTOS tuh_task() still need to be invoked
       if (tuh_task_event_ready()) {
         tuh_task();
       }
-      // TODO probably some timeout to prevent hanged
+      #if CFG_TUH_XFER_TIMEOUT
+      // tuh_task() is only run for events, timeout is checked here meanwhile
+      else if (xfer->timeout_ms) {
+        usbh_task_lock();
+        (void) xfer_timeout_check();
+        usbh_task_unlock();
+      }
+      #endif
     }
 
     // update transfer result, user_data is expected to point to xfer_result_t
@@ -662,35 +1740,49 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
       *((xfer_result_t*) xfer->user_data) = result;
     }
     xfer->result     = result;
-    xfer->actual_len = _ctrl_xfer.actual_len;
+    xfer->actual_len = ctrl->actual_len;
   }
 
   return true;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline void _set_control_xfer_stage(uint8_t stage) {
+TU_ATTR_ALWAYS_INLINE static inline void _set_control_xfer_stage(uint8_t daddr, uint8_t stage) {
+  (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  _ctrl_xfer[daddr].stage = stage;
+  (void) osal_mutex_unlock(_usbh_mutex);
+}
+
+// Reset control transfer of a device to idle without invoking callback e.g aborted or device removed
+static void _control_xfer_reset(uint8_t daddr) {
   (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
-  _ctrl_xfer.stage = stage;
+  _ctrl_xfer[daddr].stage = CONTROL_STAGE_IDLE;
+  _ctrl_xfer[daddr].queued = false;
   (void) osal_mutex_unlock(_usbh_mutex);
+
+#if !CFG_TUH_CONTROL_XFER_CONCURRENT
+  _control_bus_release(daddr);
+#endif
 }
 
 static void _control_xfer_complete(uint8_t daddr, xfer_result_t result) {
   TU_LOG_USBH("\r\n");
+  usbh_ctrl_xfer_t* ctrl = &_ctrl_xfer[daddr];
 
   // duplicate xfer since user can execute control transfer within callback
-  tusb_control_request_t const request = _ctrl_xfer.request;
+  tusb_control_request_t const request = ctrl->request;
   tuh_xfer_t xfer_temp = {
     .daddr       = daddr,
     .ep_addr     = 0,
     .result      = result,
     .setup       = &request,
-    .actual_len  = (uint32_t) _ctrl_xfer.actual_len,
-    .buffer      = _ctrl_xfer.buffer,
-    .complete_cb = _ctrl_xfer.complete_cb,
-    .user_data   = _ctrl_xfer.user_data
+    .actual_len  = (uint32_t) ctrl->actual_len,
+    .buffer      = ctrl->buffer,
+    .complete_cb = ctrl->complete_cb,
+    .user_data   = ctrl->user_data
   };
 
-  _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+  // free the bus before invoking callback so that queued transfers of other devices go first
+  _control_xfer_reset(daddr);
 
   if (xfer_temp.complete_cb) {
     xfer_temp.complete_cb(&xfer_temp);
@@ -701,7 +1793,9 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
   (void) ep_addr;
 
   const uint8_t rhport = usbh_get_rhport(daddr);
-  tusb_control_request_t const * request = &_ctrl_xfer.request;
+  usbh_ctrl_xfer_t* ctrl = get_ctrl_xfer(daddr);
+  TU_VERIFY(ctrl && ctrl->stage != CONTROL_STAGE_IDLE);
+  tusb_control_request_t const * request = &ctrl->request;
 
   if (XFER_RESULT_SUCCESS != result) {
     TU_LOG_USBH("[%u:%u] Control %s, xferred_bytes = %" PRIu32 "\r\n", rhport, daddr, result == XFER_RESULT_STALLED ? "STALLED" : "FAILED", xferred_bytes);
@@ -710,12 +1804,21 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
     // terminate transfer if any stage failed
     _control_xfer_complete(daddr, result);
   }else {
-    switch(_ctrl_xfer.stage) {
+    switch(ctrl->stage) {
       case CONTROL_STAGE_SETUP:
         if (request->wLength) {
           // DATA stage: initial data toggle is always 1
-          _set_control_xfer_stage(CONTROL_STAGE_DATA);
-          TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), _ctrl_xfer.buffer, request->wLength) );
+          _set_control_xfer_stage(daddr, CONTROL_STAGE_DATA);
+          #if CFG_TUH_MEM_DCACHE_ENABLE && CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+          // bounce buffers are also taken by transfers submitted from ISR
+          usbh_int_set(false);
+          bool const started = edpt_hcd_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction),
+                                             ctrl->buffer, request->wLength);
+          usbh_int_set(true);
+          TU_ASSERT(started);
+          #else
+          TU_ASSERT( edpt_hcd_xfer(rhport, daddr, tu_edpt_addr(0, request->bmRequestType_bit.direction), ctrl->buffer, request->wLength) );
+          #endif
           return true;
         }
         TU_ATTR_FALLTHROUGH;
@@ -723,14 +1826,14 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
       case CONTROL_STAGE_DATA:
         if (request->wLength) {
           TU_LOG_USBH("[%u:%u] Control data:\r\n", rhport, daddr);
-          TU_LOG_MEM_USBH(_ctrl_xfer.buffer, xferred_bytes, 2);
+          TU_LOG_MEM_USBH(ctrl->buffer, xferred_bytes, 2);
         }
 
-        _ctrl_xfer.actual_len = (uint16_t) xferred_bytes;
+        ctrl->actual_len = (uint16_t) xferred_bytes;
 
         // ACK stage: toggle is always 1
-        _set_control_xfer_stage(CONTROL_STAGE_ACK);
-        TU_ASSERT( hcd_edpt_xfer(rhport, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction), NULL, 0) );
+        _set_control_xfer_stage(daddr, CONTROL_STAGE_ACK);
+        TU_ASSERT( edpt_hcd_xfer(rhport, daddr, tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction), NULL, 0) );
         break;
 
       case CONTROL_STAGE_ACK: {
@@ -759,20 +1862,52 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
 //
 //--------------------------------------------------------------------+
 
+#if CFG_TUH_API_EDPT_XFER
+// re-construct xfer info and invoke application callback of tuh_edpt_xfer()
+TU_ATTR_FAST_FUNC static void invoke_xfer_cb(usbh_xfer_cb_t const* xfer_cb, uint8_t daddr, uint8_t ep_addr,
+                                             xfer_result_t result, uint32_t xferred_bytes, bool in_isr) {
+  tuh_xfer_t xfer = {
+      .daddr           = daddr,
+      .ep_addr         = ep_addr,
+      .complete_in_isr = in_isr,
+      .result          = result,
+      .actual_len      = xferred_bytes,
+      .buflen          = 0,    // not available
+      .buffer          = NULL, // not available
+      .complete_cb     = xfer_cb->complete_cb,
+      .user_data       = xfer_cb->user_data
+  };
+  xfer_cb->complete_cb(&xfer);
+}
+#endif
+
 bool tuh_edpt_xfer(tuh_xfer_t* xfer) {
   uint8_t const daddr = xfer->daddr;
   uint8_t const ep_addr = xfer->ep_addr;
 
   TU_VERIFY(daddr && ep_addr);
+
+#if CFG_TUH_XFER_TIMEOUT
+  uint32_t const timeout_ms = xfer->timeout_ms;
+#else
+  uint32_t const timeout_ms = 0;
+#endif
+
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+  // endpoint is not claimed so that more transfers can be queued while it is busy
+  return edpt_xfer_submit(daddr, ep_addr, xfer->buffer, xfer->buflen, xfer->complete_cb, xfer->user_data,
+                          xfer->complete_in_isr, timeout_ms);
+#else
   TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
 
-  if (!usbh_edpt_xfer_with_callback(daddr, ep_addr, xfer->buffer, (uint16_t) xfer->buflen,
-                                    xfer->complete_cb, xfer->user_data)) {
+  if (!edpt_xfer_submit(daddr, ep_addr, xfer->buffer, xfer->buflen, xfer->complete_cb, xfer->user_data,
+                        xfer->complete_in_isr, timeout_ms)) {
     usbh_edpt_release(daddr, ep_addr);
     return false;
   }
 
   return true;
+#endif
 }
 
 bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr) {
@@ -785,15 +1920,28 @@ bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr) {
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   if ( epnum == 0 ) {
-    // control transfer: only 1 control at a time, check if we are aborting the current one
-    TU_VERIFY(daddr == _ctrl_xfer.daddr && _ctrl_xfer.stage != CONTROL_STAGE_IDLE);
-    TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
+    usbh_ctrl_xfer_t* ctrl = &_ctrl_xfer[daddr];
+    TU_VERIFY(ctrl->stage != CONTROL_STAGE_IDLE);
+    // a queued transfer is not on the bus yet
+    if (!ctrl->queued) {
+      TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
+    }
     // reset control transfer state to idle
-    _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+    _control_xfer_reset(daddr);
+    #if CFG_TUH_MEM_DCACHE_ENABLE
+    dcache_xfer_clear(daddr, TUSB_DIR_IN_MASK);
+    #endif
   } else {
     // non-control skip if not busy
     TU_VERIFY(dev->ep_status[epnum][dir].busy);
     TU_VERIFY(hcd_edpt_abort_xfer(dev->rhport, daddr, ep_addr));
+    #if CFG_TUH_MEM_DCACHE_ENABLE
+    if (dir == TUSB_DIR_IN) dcache_xfer_clear(daddr, ep_addr);
+    #endif
+    #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+    // queued transfers are dropped as well
+    xfer_queue_clear(dev, epnum, dir);
+    #endif
     // mark as ready and release endpoint if transfer is aborted
     dev->ep_status[epnum][dir].busy = false;
     tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex);
@@ -811,8 +1959,12 @@ uint8_t usbh_get_rhport(uint8_t dev_addr) {
   return dev ? dev->rhport : _dev0.rhport;
 }
 
-uint8_t *usbh_get_enum_buf(void) {
-  return _usbh_ctrl_buf;
+uint8_t *usbh_get_enum_buf(uint8_t dev_addr) {
+  // only while enumerated (incl. set config): buffer is reused by next enumeration afterward, runtime requests of
+  // class drivers must use their own buffer
+  uint8_t const idx = enum_find(dev_addr);
+  TU_ASSERT(idx != TUSB_INDEX_INVALID_8, NULL);
+  return _usbh_ctrl_buf[idx];
 }
 
 void usbh_int_set(bool enabled) {
@@ -846,7 +1998,15 @@ bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr) {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
-  TU_VERIFY(tu_edpt_claim(&dev->ep_status[epnum][dir], _usbh_mutex));
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+  if (_usbh_in_xfer_isr) {
+    // mutex can't be taken in ISR, which is already exclusive with usbh task
+    TU_VERIFY(!ep_state->busy && !ep_state->claimed);
+    ep_state->claimed = 1;
+  } else {
+    TU_VERIFY(tu_edpt_claim(ep_state, _usbh_mutex));
+  }
   TU_LOG_USBH("[%u] Claimed EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
@@ -861,27 +2021,202 @@ bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr) {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
-  TU_VERIFY(tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex));
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+
+  if (_usbh_in_xfer_isr) {
+    TU_VERIFY(ep_state->claimed && !ep_state->busy);
+    ep_state->claimed = 0;
+  } else {
+    TU_VERIFY(tu_edpt_release(ep_state, _usbh_mutex));
+  }
   TU_LOG_USBH("[%u] Released EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
 }
 
+//--------------------------------------------------------------------+
+// Data Cache Maintenance
+// Same as usbd: buffer is cleaned (OUT) or cleaned and invalidated (IN) once per transfer submitted to HCD, data
+// received by IN transfer is invalidated on completion. IN buffer not aligned to cache line goes through a bounce
+// buffer if available.
+//--------------------------------------------------------------------+
+#if CFG_TUH_MEM_DCACHE_ENABLE
+TU_VERIFY_STATIC((CFG_TUSB_MEM_DCACHE_LINE_SIZE & (CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1)) == 0,
+                 "CFG_TUSB_MEM_DCACHE_LINE_SIZE must be a power of 2");
+
+// IN transfer submitted to HCD, at most one per endpoint
+typedef struct {
+  uint8_t* buffer; // buffer of class driver
+  int8_t bounce;   // index of bounce buffer, -1 if received in place
+  bool pending;
+} usbh_dcache_xfer_t;
+
+tu_static usbh_dcache_xfer_t _usbh_dcache[TOTAL_DEVICES + 1][CFG_TUH_ENDPOINT_MAX]; // indexed by device address
+
+#if CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+CFG_TUH_MEM_SECTION TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE)
+tu_static uint8_t _usbh_dcache_bounce[CFG_TUH_MEM_DCACHE_BOUNCE_NUM][TU_DCACHE_ROUNDUP(CFG_TUH_MEM_DCACHE_BOUNCE_SZ)];
+tu_static bool _usbh_dcache_bounce_used[CFG_TUH_MEM_DCACHE_BOUNCE_NUM];
+#endif
+
+// Apply cache operation to whole lines covering buffer
+TU_ATTR_ALWAYS_INLINE static inline void dcache_lines(bool (*op)(void const*, uint32_t), uint8_t const* buffer,
+                                                      uint32_t len) {
+  if (op && len) {
+    uintptr_t const start = (uintptr_t) buffer & ~((uintptr_t) CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1);
+    (void) op((void const*) start, (uint32_t) TU_DCACHE_ROUNDUP((uintptr_t) buffer + len - start));
+  }
+}
+
+// Cache maintenance before HCD transfer, return buffer to hand to HCD: bounce buffer or the same one.
+// Bounce buffers are shared by all endpoints: caller must have interrupt disabled or be in ISR.
+TU_ATTR_FAST_FUNC static uint8_t* dcache_xfer_prepare(uint8_t daddr, uint8_t ep_addr, uint8_t* buffer,
+                                                      uint16_t len) {
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT) {
+    dcache_lines(hcd_dcache_clean, buffer, len);
+    return buffer;
+  }
+
+  usbh_dcache_xfer_t* dx = &_usbh_dcache[daddr][tu_edpt_number(ep_addr)];
+  dx->buffer = buffer;
+  dx->bounce = -1;
+  dx->pending = true;
+
+  #if CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+  bool const aligned = (((uintptr_t) buffer | len) & (CFG_TUSB_MEM_DCACHE_LINE_SIZE - 1)) == 0;
+  if (!aligned && len && len <= CFG_TUH_MEM_DCACHE_BOUNCE_SZ) {
+    for (uint8_t i = 0; i < CFG_TUH_MEM_DCACHE_BOUNCE_NUM; i++) {
+      if (!_usbh_dcache_bounce_used[i]) {
+        _usbh_dcache_bounce_used[i] = true;
+        dx->bounce = (int8_t) i;
+        buffer = _usbh_dcache_bounce[i];
+        break;
+      }
+    }
+  }
+  #endif
+
+  dcache_lines(hcd_dcache_clean_invalidate, buffer, len);
+  return buffer;
+}
+
+// Release bounce buffer of an IN transfer, copying received data to class driver buffer
+TU_ATTR_ALWAYS_INLINE static inline void dcache_bounce_release(usbh_dcache_xfer_t* dx, uint32_t xferred) {
+  #if CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+  if (dx->bounce >= 0) {
+    if (xferred) memcpy(dx->buffer, _usbh_dcache_bounce[dx->bounce], xferred);
+    _usbh_dcache_bounce_used[dx->bounce] = false;
+    dx->bounce = -1;
+  }
+  #else
+  (void) dx;
+  (void) xferred;
+  #endif
+}
+
+// Cache maintenance after HCD transfer is complete
+TU_ATTR_FAST_FUNC static void dcache_xfer_complete(uint8_t daddr, uint8_t ep_addr, uint32_t xferred) {
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_OUT || daddr > TOTAL_DEVICES) return;
+
+  usbh_dcache_xfer_t* dx = &_usbh_dcache[daddr][tu_edpt_number(ep_addr)];
+  if (!dx->pending) return;
+  dx->pending = false;
+
+  #if CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+  uint8_t const* buffer = (dx->bounce >= 0) ? _usbh_dcache_bounce[dx->bounce] : dx->buffer;
+  #else
+  uint8_t const* buffer = dx->buffer;
+  #endif
+  dcache_lines(hcd_dcache_invalidate, buffer, xferred);
+  dcache_bounce_release(dx, xferred);
+}
+
+// Forget IN transfer of an endpoint (all endpoints of device if ep_addr is 0xff) that ended without completion
+static void dcache_xfer_clear(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_ENDPOINT_MAX; i++) {
+    if (ep_addr != 0xff && ep_addr != tu_edpt_addr(i, TUSB_DIR_IN)) continue;
+    usbh_dcache_xfer_t* dx = &_usbh_dcache[daddr][i];
+    dcache_bounce_release(dx, 0);
+    dx->pending = false;
+  }
+}
+#endif
+
+// Hand a transfer (or a part of it) to HCD
+TU_ATTR_FAST_FUNC static bool edpt_hcd_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t* buffer,
+                                            uint16_t len) {
+#if CFG_TUH_MEM_DCACHE_ENABLE
+  if (hcd_edpt_xfer(rhport, daddr, ep_addr, dcache_xfer_prepare(daddr, ep_addr, buffer, len), len)) return true;
+  if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) dcache_xfer_clear(daddr, ep_addr);
+  return false;
+#else
+  return hcd_edpt_xfer(rhport, daddr, ep_addr, buffer, len);
+#endif
+}
+
+// Hand a transfer to HCD, large transfer is split into chunks. Also called from transfer complete ISR.
+// Timeout (0 for none) is counted from now.
+TU_ATTR_FAST_FUNC static bool edpt_xfer_start(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer,
+                                              uint32_t total_bytes, uint32_t timeout_ms) {
+#if CFG_TUH_LARGE_XFER
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint16_t xact_len = (uint16_t) total_bytes;
+  if (epnum) {
+    usbh_large_xfer_t* lx = &dev->large_xfer[epnum][tu_edpt_dir(ep_addr)];
+    uint16_t const mps = lx->mps ? lx->mps : 64;
+    uint16_t const max_chunk = (uint16_t) ((UINT16_MAX / mps) * mps);
+
+    lx->buffer = buffer;
+    lx->chunk_len = (uint16_t) tu_min32(total_bytes, max_chunk);
+    lx->remaining = total_bytes - lx->chunk_len;
+    lx->xferred = 0;
+    xact_len = lx->chunk_len;
+  }
+#else
+  uint16_t const xact_len = (uint16_t) total_bytes;
+#endif
+
+#if CFG_TUH_XFER_TIMEOUT
+  usbh_xfer_timeout_t* t = &dev->ep_timeout[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  t->start = hcd_frame_number(dev->rhport);
+  t->timeout_ms = timeout_ms;
+#else
+  (void) timeout_ms;
+#endif
+
+  return edpt_hcd_xfer(dev->rhport, dev_addr, ep_addr, buffer, xact_len);
+}
+
 // Submit an transfer
 // TODO call usbh_edpt_release if failed
-bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes,
-                                  tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+static bool edpt_xfer_submit(uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes,
+                             tuh_xfer_cb_t complete_cb, uintptr_t user_data, bool cb_in_isr, uint32_t timeout_ms) {
   (void) complete_cb;
   (void) user_data;
+  (void) cb_in_isr;
 
   usbh_device_t* dev = get_device(dev_addr);
-  TU_VERIFY(dev);
+  TU_VERIFY(dev && device_awake(dev, dev_addr));
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
   tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
 
-  TU_LOG_USBH("  Queue EP %02X with %u bytes ... \r\n", ep_addr, total_bytes);
+  TU_LOG_USBH("  Queue EP %02X with %u bytes ... \r\n", ep_addr, (unsigned int) total_bytes);
+  TU_TRACE(TU_TRACE_USBH_XFER, dev->rhport, ep_addr, dev_addr, total_bytes);
+
+#if CFG_TUH_LARGE_XFER
+  TU_ASSERT(epnum || total_bytes <= UINT16_MAX);
+#else
+  TU_ASSERT(total_bytes <= UINT16_MAX);
+#endif
+
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+  if (epnum) {
+    return xfer_queue_submit(dev, dev_addr, ep_addr, buffer, total_bytes, complete_cb, user_data, cb_in_isr,
+                             timeout_ms);
+  }
+#endif
 
   // Attempt to transfer on a busy endpoint, sound like an race condition !
   TU_ASSERT(ep_state->busy == 0);
@@ -890,12 +2225,27 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   // could return and USBH task can preempt and clear the busy
   ep_state->busy = 1;
 
-#if CFG_TUH_API_EDPT_XFER
+#if CFG_TUH_API_EDPT_XFER && !CFG_TUH_EDPT_XFER_QUEUE_SZ
   dev->ep_callback[epnum][dir].complete_cb = complete_cb;
   dev->ep_callback[epnum][dir].user_data   = user_data;
+  dev->ep_callback[epnum][dir].in_isr      = cb_in_isr;
+#endif
+
+#if CFG_TUH_MEM_DCACHE_ENABLE && CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+  bool started;
+  if (dir == TUSB_DIR_IN && total_bytes) {
+    // bounce buffers are also taken by transfers submitted from ISR
+    usbh_int_set(false);
+    started = edpt_xfer_start(dev, dev_addr, ep_addr, buffer, total_bytes, timeout_ms);
+    usbh_int_set(true);
+  } else {
+    started = edpt_xfer_start(dev, dev_addr, ep_addr, buffer, total_bytes, timeout_ms);
+  }
+#else
+  bool const started = edpt_xfer_start(dev, dev_addr, ep_addr, buffer, total_bytes, timeout_ms);
 #endif
 
-  if (hcd_edpt_xfer(dev->rhport, dev_addr, ep_addr, buffer, total_bytes)) {
+  if (started) {
     TU_LOG_USBH("OK\r\n");
     return true;
   } else {
@@ -908,6 +2258,242 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   }
 }
 
+bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint32_t total_bytes,
+                                  tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  return edpt_xfer_submit(dev_addr, ep_addr, buffer, total_bytes, complete_cb, user_data, false, 0);
+}
+
+//--------------------------------------------------------------------+
+// Scatter-gather Transfer
+// Segments are handed to HCD one part at a time (see tu_sg_xfer_t), the next part is submitted from transfer
+// complete ISR. Class driver only gets a single callback for the whole list.
+//--------------------------------------------------------------------+
+#if CFG_TUH_EDPT_XFER_SG
+tu_static tu_sg_xfer_t _usbh_sg[CFG_TUH_EDPT_XFER_SG];
+CFG_TUH_MEM_SECTION CFG_TUSB_MEM_ALIGN TUH_EPBUF_DCACHE_ALIGNED
+tu_static uint8_t _usbh_sg_bounce[CFG_TUH_EDPT_XFER_SG][TUH_EPBUF_DCACHE_SIZE(CFG_TUH_EDPT_XFER_SG_BOUNCE_SZ)];
+
+// scatter-gather transfer in progress on device's endpoint, NULL if none
+TU_ATTR_FAST_FUNC static tu_sg_xfer_t* sg_xfer_find(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_EDPT_XFER_SG; i++) {
+    if (_usbh_sg[i].iov && _usbh_sg[i].hwid == daddr && _usbh_sg[i].ep_addr == ep_addr) return &_usbh_sg[i];
+  }
+  return NULL;
+}
+
+// abort all scatter-gather transfers of a device
+static void sg_xfer_clear(uint8_t daddr) {
+  for (uint8_t i = 0; i < CFG_TUH_EDPT_XFER_SG; i++) {
+    if (_usbh_sg[i].hwid == daddr) _usbh_sg[i].iov = NULL;
+  }
+}
+
+bool usbh_edpt_xfer_sg(uint8_t dev_addr, uint8_t ep_addr, tu_iovec_t const* iov, uint8_t count) {
+  usbh_device_t* dev = get_device(dev_addr);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  TU_ASSERT(dev && iov && count && epnum && epnum < CFG_TUH_ENDPOINT_MAX);
+
+  uint16_t const mps = dev->ep_mps[epnum][dir];
+  TU_ASSERT(mps && mps <= CFG_TUH_EDPT_XFER_SG_BOUNCE_SZ);
+
+  // must not interleave with other transfers of this endpoint
+  TU_VERIFY(!dev->ep_status[epnum][dir].busy);
+
+  // reserve a free slot
+  tu_sg_xfer_t* sg = NULL;
+  uint8_t slot;
+  usbh_int_set(false);
+  for (slot = 0; slot < CFG_TUH_EDPT_XFER_SG; slot++) {
+    if (_usbh_sg[slot].iov == NULL) {
+      sg = &_usbh_sg[slot];
+      sg->hwid = dev_addr;
+      sg->ep_addr = ep_addr;
+      sg->iov = iov;
+      break;
+    }
+  }
+  usbh_int_set(true);
+  TU_VERIFY(sg);
+
+  tu_sg_xfer_init(sg, iov, count, mps, _usbh_sg_bounce[slot]);
+
+  uint8_t* buffer;
+  uint16_t const len = tu_sg_xfer_part(sg, &buffer);
+  if (!edpt_xfer_submit(dev_addr, ep_addr, buffer, len, NULL, 0, false, 0)) {
+    sg->iov = NULL;
+    return false;
+  }
+
+  return true;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Endpoint Transfer Queue
+// Transfers submitted while endpoint is busy are kept in a per-endpoint ring and handed to HCD
+// from the transfer complete ISR, removing the round trip to usbh task between transfers.
+// Completion callbacks are still invoked in usbh task, one per transfer and in submission order.
+//--------------------------------------------------------------------+
+#if CFG_TUH_EDPT_XFER_QUEUE_SZ
+
+// Mutex is skipped when used by class driver's xfer_isr() since it is in ISR context
+TU_ATTR_ALWAYS_INLINE static inline void xfer_queue_lock(void) {
+  if (!_usbh_in_xfer_isr) {
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  }
+  usbh_int_set(false);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void xfer_queue_unlock(void) {
+  usbh_int_set(true);
+  if (!_usbh_in_xfer_isr) {
+    (void) osal_mutex_unlock(_usbh_mutex);
+  }
+}
+
+static bool xfer_queue_submit(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer,
+                              uint32_t total_bytes, tuh_xfer_cb_t complete_cb, uintptr_t user_data, bool cb_in_isr,
+                              uint32_t timeout_ms) {
+  (void) complete_cb;
+  (void) user_data;
+  (void) cb_in_isr;
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+  usbh_xfer_queue_t* q = &dev->xfer_queue[epnum][dir];
+
+  bool start_now = false;
+  bool queued = false;
+
+  xfer_queue_lock();
+  if (!q->active) {
+    // HCD is idle: submit now
+    q->active = 1;
+    start_now = true;
+  } else if (q->count < CFG_TUH_EDPT_XFER_QUEUE_SZ) {
+    usbh_xfer_desc_t* desc = &q->desc[(q->rd_idx + q->count) % CFG_TUH_EDPT_XFER_QUEUE_SZ];
+    desc->buffer = buffer;
+    desc->total_bytes = total_bytes;
+    #if CFG_TUH_XFER_TIMEOUT
+    desc->timeout_ms = timeout_ms;
+    #endif
+    q->count++;
+    queued = true;
+  }
+
+  if (start_now || queued) {
+    #if CFG_TUH_API_EDPT_XFER
+    usbh_xfer_cb_t* cb = &q->cb[(q->cb_idx + q->pending) % (CFG_TUH_EDPT_XFER_QUEUE_SZ + 1)];
+    cb->complete_cb = complete_cb;
+    cb->user_data = user_data;
+    cb->in_isr = cb_in_isr;
+    #endif
+
+    // Set busy first since the actual transfer can be complete before hcd_edpt_xfer() could return
+    q->pending++;
+    ep_state->busy = 1;
+  }
+  xfer_queue_unlock();
+
+  // queue is full
+  TU_VERIFY(start_now || queued);
+
+  if (start_now && !edpt_xfer_start(dev, dev_addr, ep_addr, buffer, total_bytes, timeout_ms)) {
+    TU_LOG1("Failed\r\n");
+
+    xfer_queue_lock();
+    q->pending--;
+    bool const has_queued = (q->count > 0);
+    if (!has_queued) {
+      q->active = 0;
+      if (q->pending == 0) {
+        // HCD error, mark endpoint as ready to allow next transfer
+        ep_state->busy = 0;
+        ep_state->claimed = 0;
+      }
+    }
+    xfer_queue_unlock();
+
+    // other transfers are queued in the meantime, kick off the next one
+    if (has_queued) {
+      xfer_queue_next(dev, dev_addr, ep_addr, false);
+    }
+
+    return false;
+  }
+
+  TU_LOG_USBH("OK\r\n");
+  return true;
+}
+
+// Submit the next queued transfer to HCD. Called when HCD completes a transfer on this endpoint,
+// mostly in ISR context. Must not be called with xfer_queue_lock() held.
+TU_ATTR_FAST_FUNC static void xfer_queue_next(usbh_device_t* dev, uint8_t dev_addr, uint8_t ep_addr, bool in_isr) {
+  usbh_xfer_queue_t* q = &dev->xfer_queue[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  q->active = 0;
+  while (q->count) {
+    usbh_xfer_desc_t const desc = q->desc[q->rd_idx];
+    q->rd_idx = (uint8_t) ((q->rd_idx + 1) % CFG_TUH_EDPT_XFER_QUEUE_SZ);
+    q->count--;
+    q->active = 1;
+
+    #if CFG_TUH_XFER_TIMEOUT
+    uint32_t const timeout_ms = desc.timeout_ms;
+    #else
+    uint32_t const timeout_ms = 0;
+    #endif
+    if (edpt_xfer_start(dev, dev_addr, ep_addr, desc.buffer, desc.total_bytes, timeout_ms)) return;
+
+    // report as failed transfer so that caller still gets one callback per submission
+    q->active = 0;
+    #if CFG_TUH_API_EDPT_XFER
+    q->completed++;
+    #endif
+    hcd_event_t event = { .rhport = dev->rhport, .event_id = HCD_EVENT_XFER_COMPLETE, .dev_addr = dev_addr };
+    event.xfer_complete.ep_addr = ep_addr;
+    event.xfer_complete.len     = 0;
+    event.xfer_complete.result  = XFER_RESULT_FAILED;
+    queue_event(&event, in_isr);
+  }
+}
+
+// Called by usbh task when a transfer complete event is processed, or in ISR if consumed by xfer_isr().
+// Return true if endpoint has no more outstanding transfer and is released.
+static bool xfer_queue_retire(usbh_device_t* dev, uint8_t epnum, uint8_t dir, bool in_isr) {
+  tu_edpt_state_t* ep_state = &dev->ep_status[epnum][dir];
+  usbh_xfer_queue_t* q = &dev->xfer_queue[epnum][dir];
+
+  // already exclusive in ISR context
+  if (!in_isr) xfer_queue_lock();
+  if (q->pending) {
+    q->pending--;
+    #if CFG_TUH_API_EDPT_XFER
+    q->cb_idx = (uint8_t) ((q->cb_idx + 1) % (CFG_TUH_EDPT_XFER_QUEUE_SZ + 1));
+    if (q->completed) q->completed--;
+    #endif
+  }
+
+  bool const idle = (q->pending == 0);
+  if (idle) {
+    ep_state->busy = 0;
+    ep_state->claimed = 0;
+  }
+  if (!in_isr) xfer_queue_unlock();
+
+  return idle;
+}
+
+static void xfer_queue_clear(usbh_device_t* dev, uint8_t epnum, uint8_t dir) {
+  xfer_queue_lock();
+  tu_varclr(&dev->xfer_queue[epnum][dir]);
+  xfer_queue_unlock();
+}
+
+#endif
+
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size) {
   TU_LOG_USBH("[%u:%u] Open EP0 with Size = %u\r\n", usbh_get_rhport(dev_addr), dev_addr, max_packet_size);
   tusb_desc_endpoint_t ep0_desc = {
@@ -924,6 +2510,19 @@ static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size) {
 
 bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* desc_ep) {
   TU_ASSERT(tu_edpt_validate(desc_ep, tuh_speed_get(dev_addr)));
+
+#if CFG_TUH_LARGE_XFER || CFG_TUH_EDPT_XFER_SG
+  usbh_device_t* dev = get_device(dev_addr);
+  if (dev) {
+    uint8_t const ep_addr = desc_ep->bEndpointAddress;
+    #if CFG_TUH_LARGE_XFER
+    dev->large_xfer[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].mps = tu_edpt_packet_size(desc_ep);
+    #endif
+    #if CFG_TUH_EDPT_XFER_SG
+    dev->ep_mps[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = tu_edpt_packet_size(desc_ep);
+    #endif
+  }
+#endif
   return hcd_edpt_open(usbh_get_rhport(dev_addr), dev_addr, desc_ep);
 }
 
@@ -937,26 +2536,125 @@ bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr) {
   return dev->ep_status[epnum][dir].busy;
 }
 
-//--------------------------------------------------------------------+
-// HCD Event Handler
-//--------------------------------------------------------------------+
+//--------------------------------------------------------------------+
+// HCD Event Handler
+//--------------------------------------------------------------------+
+
+void hcd_devtree_get_info(uint8_t dev_addr, hcd_devtree_info_t* devtree_info) {
+  usbh_device_t const* dev = get_device(dev_addr);
+  if (dev) {
+    devtree_info->rhport = dev->rhport;
+    devtree_info->hub_addr = dev->hub_addr;
+    devtree_info->hub_port = dev->hub_port;
+    devtree_info->speed = dev->speed;
+  } else {
+    devtree_info->rhport = _dev0.rhport;
+    devtree_info->hub_addr = _dev0.hub_addr;
+    devtree_info->hub_port = _dev0.hub_port;
+    devtree_info->speed = _dev0.speed;
+  }
+
+#if CFG_TUH_HUB
+  devtree_info->multi_tt = (devtree_info->hub_addr && hub_is_multi_tt(devtree_info->hub_addr)) ? 1 : 0;
+#else
+  devtree_info->multi_tt = 0;
+#endif
+}
+
+#if CFG_TUH_EDPT_XFER_SG
+// Return true if the next part of a scatter-gather transfer is submitted i.e transfer is not complete yet.
+// Otherwise event's length is updated to the total transferred bytes.
+TU_ATTR_FAST_FUNC static bool sg_xfer_continue(hcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  tu_sg_xfer_t* sg = sg_xfer_find(event->dev_addr, ep_addr);
+  if (sg == NULL) return false;
+
+  bool const success = (event->xfer_complete.result == XFER_RESULT_SUCCESS);
+  if (tu_sg_xfer_advance(sg, event->xfer_complete.len) && success) {
+    usbh_device_t const* dev = get_device(event->dev_addr);
+    uint8_t* buffer;
+    uint16_t const len = tu_sg_xfer_part(sg, &buffer);
+    if (dev && edpt_hcd_xfer(dev->rhport, event->dev_addr, ep_addr, buffer, len)) return true;
+
+    event->xfer_complete.result = XFER_RESULT_FAILED;
+  }
+
+  event->xfer_complete.len = sg->xferred;
+  sg->iov = NULL;
+
+  return false;
+}
+#endif
+
+#if CFG_TUH_LARGE_XFER
+// Return true if the next chunk of a large transfer is submitted i.e transfer is not complete yet.
+// Otherwise event's length is updated to the total transferred bytes.
+TU_ATTR_FAST_FUNC static bool large_xfer_continue(hcd_event_t* event) {
+  uint8_t const ep_addr = event->xfer_complete.ep_addr;
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+
+  usbh_device_t* dev = get_device(event->dev_addr);
+  if (dev == NULL || epnum == 0) return false;
+
+  usbh_large_xfer_t* lx = &dev->large_xfer[epnum][tu_edpt_dir(ep_addr)];
+  lx->xferred += event->xfer_complete.len;
+
+  // continue only if previous chunk is fully transferred (no short packet)
+  if (lx->remaining && event->xfer_complete.result == XFER_RESULT_SUCCESS &&
+      event->xfer_complete.len == lx->chunk_len) {
+    uint16_t const max_chunk = lx->chunk_len; // first chunk is always the largest possible
+    lx->buffer += lx->chunk_len;
+    lx->chunk_len = (uint16_t) tu_min32(lx->remaining, max_chunk);
+    lx->remaining -= lx->chunk_len;
+
+    if (edpt_hcd_xfer(dev->rhport, event->dev_addr, ep_addr, lx->buffer, lx->chunk_len)) return true;
+
+    event->xfer_complete.result = XFER_RESULT_FAILED;
+  }
+
+  event->xfer_complete.len = lx->xferred;
+  lx->remaining = 0;
+  lx->xferred = 0;
+
+  return false;
+}
+#endif
+
+#if CFG_TUH_STATS || CFG_TUH_INT_HOOK
+TU_ATTR_FAST_FUNC void tuh_int_handler_ext(uint8_t rhport, bool in_isr) {
+#if CFG_TUH_INT_HOOK
+  tuh_int_enter_cb(rhport);
+#endif
+
+  uint32_t const start = tuh_stats_timestamp_cb();
+  hcd_int_handler(rhport, in_isr);
+  uint32_t const duration = tuh_stats_timestamp_cb() - start;
+
+#if CFG_TUH_STATS
+  _usbh_stats.isr_count++;
+  if (duration > _usbh_stats.isr_duration_max) _usbh_stats.isr_duration_max = duration;
+  tu_stats_hist_add(_usbh_stats.isr_duration_hist, duration);
+#endif
 
-void hcd_devtree_get_info(uint8_t dev_addr, hcd_devtree_info_t* devtree_info) {
-  usbh_device_t const* dev = get_device(dev_addr);
-  if (dev) {
-    devtree_info->rhport = dev->rhport;
-    devtree_info->hub_addr = dev->hub_addr;
-    devtree_info->hub_port = dev->hub_port;
-    devtree_info->speed = dev->speed;
-  } else {
-    devtree_info->rhport = _dev0.rhport;
-    devtree_info->hub_addr = _dev0.hub_addr;
-    devtree_info->hub_port = _dev0.hub_port;
-    devtree_info->speed = _dev0.speed;
-  }
+#if CFG_TUH_INT_HOOK
+  tuh_int_exit_cb(rhport, duration);
+#endif
 }
+#endif
 
 TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr) {
+#if CFG_TUH_STATS
+  uint32_t const isr_start = tuh_stats_timestamp_cb();
+#endif
+
+  TU_TRACE(TU_TRACE_HCD_EVENT, event->rhport,
+           event->event_id == HCD_EVENT_XFER_COMPLETE ? event->xfer_complete.ep_addr : 0, event->event_id,
+           event->event_id == HCD_EVENT_XFER_COMPLETE ? event->xfer_complete.len : 0);
+#if CFG_TUH_LARGE_XFER || CFG_TUH_EDPT_XFER_SG
+  hcd_event_t event_large;
+#endif
+  bool send = true;
+
   switch (event->event_id) {
     case HCD_EVENT_DEVICE_REMOVE:
       // FIXME device remove from a hub need an HCD API for hcd to free up endpoint
@@ -969,10 +2667,128 @@ TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr)
       }
       break;
 
+    case HCD_EVENT_XFER_COMPLETE:
+#if CFG_TUH_MEM_DCACHE_ENABLE
+      dcache_xfer_complete(event->dev_addr, event->xfer_complete.ep_addr, event->xfer_complete.len);
+#endif
+
+#if CFG_TUH_LARGE_XFER || CFG_TUH_EDPT_XFER_SG
+      // submit next part/chunk if this is part of a scatter-gather or large transfer, otherwise update event with
+      // total length
+      event_large = *event;
+  #if CFG_TUH_EDPT_XFER_SG
+      if (sg_xfer_continue(&event_large)) {
+        send = false;
+        break;
+      }
+  #endif
+  #if CFG_TUH_LARGE_XFER
+      if (large_xfer_continue(&event_large)) {
+        send = false;
+        break;
+      }
+  #endif
+      event = &event_large;
+#endif
+
+#if CFG_TUH_STATS
+      stats_xfer_complete(event);
+#endif
+
+      if (event->dev_addr != 0 && tu_edpt_number(event->xfer_complete.ep_addr) != 0) {
+        usbh_device_t* dev = get_device(event->dev_addr);
+        if (dev && dev->connected) {
+          uint8_t const ep_addr = event->xfer_complete.ep_addr;
+          uint8_t const epnum = tu_edpt_number(ep_addr);
+          uint8_t const ep_dir = (uint8_t) tu_edpt_dir(ep_addr);
+          uint8_t const drv_id = dev->ep2drv[epnum][ep_dir];
+          usbh_class_driver_t const* driver = get_driver(drv_id);
+
+          #if CFG_TUH_API_EDPT_XFER
+          // application callback of tuh_edpt_xfer() is invoked in usbh task unless it asks for ISR
+          #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+          usbh_xfer_queue_t* q = &dev->xfer_queue[epnum][ep_dir];
+          usbh_xfer_cb_t const xfer_cb = q->cb[(q->cb_idx + q->completed) % (CFG_TUH_EDPT_XFER_QUEUE_SZ + 1)];
+          // only the oldest completion can be retired here, otherwise callbacks would be out of order
+          bool const cb_in_isr = xfer_cb.in_isr && (q->completed == 0);
+          q->completed++;
+          #else
+          usbh_xfer_cb_t const xfer_cb = dev->ep_callback[epnum][ep_dir];
+          bool const cb_in_isr = xfer_cb.in_isr;
+          #endif
+
+          if (xfer_cb.complete_cb) {
+            driver = NULL;
+
+            if (cb_in_isr) {
+              #if CFG_TUH_AUTO_SUSPEND
+              dev->last_active = hcd_frame_number(event->rhport);
+              #endif
+              #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+              xfer_queue_next(dev, event->dev_addr, ep_addr, in_isr);
+              #else
+              // mark endpoint as ready so that callback can re-arm it
+              dev->ep_status[epnum][ep_dir].busy = 0;
+              dev->ep_status[epnum][ep_dir].claimed = 0;
+              #endif
+
+              _usbh_in_xfer_isr = in_isr;
+              invoke_xfer_cb(&xfer_cb, event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                             event->xfer_complete.len, true);
+              _usbh_in_xfer_isr = false;
+
+              #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+              (void) xfer_queue_retire(dev, epnum, ep_dir, in_isr);
+              #endif
+              send = false;
+              break;
+            }
+          }
+          #endif
+
+          if (driver && driver->xfer_isr) {
+            #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+            // hand the next queued transfer (if any) to HCD before invoking driver
+            xfer_queue_next(dev, event->dev_addr, ep_addr, in_isr);
+            #else
+            // mark endpoint as ready so that driver can re-arm it within xfer_isr()
+            dev->ep_status[epnum][ep_dir].busy = 0;
+            dev->ep_status[epnum][ep_dir].claimed = 0;
+            #endif
+
+            // consumed by driver in ISR, otherwise deferred to xfer_cb() in usbh task
+            _usbh_in_xfer_isr = in_isr;
+            send = !driver_xfer_isr(drv_id, event->dev_addr, ep_addr, (xfer_result_t) event->xfer_complete.result,
+                                    event->xfer_complete.len);
+            _usbh_in_xfer_isr = false;
+
+            #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+            if (!send) (void) xfer_queue_retire(dev, epnum, ep_dir, in_isr);
+            #endif
+          }
+          #if CFG_TUH_EDPT_XFER_QUEUE_SZ
+          else {
+            // hand the next queued transfer (if any) to HCD right away, after this completion is queued
+            queue_event(event, in_isr);
+            send = false;
+            xfer_queue_next(dev, event->dev_addr, ep_addr, in_isr);
+          }
+          #endif
+        }
+      }
+      break;
+
     default: break;
   }
 
-  queue_event(event, in_isr);
+  if (send) {
+    queue_event(event, in_isr);
+  }
+
+#if CFG_TUH_STATS
+  uint32_t const isr_time = tuh_stats_timestamp_cb() - isr_start;
+  if (isr_time > _usbh_stats.isr_time_max) _usbh_stats.isr_time_max = isr_time;
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -981,6 +2797,79 @@ TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr)
 
 // generic helper to get a descriptor
 // if blocking, user_data is pointed to xfer_result
+#if CFG_TUH_DESC_CACHE_COUNT
+// Find entry with the same device descriptor
+static usbh_desc_cache_t* desc_cache_find(tusb_desc_device_t const* desc_device) {
+  for (uint8_t i = 0; i < CFG_TUH_DESC_CACHE_COUNT; i++) {
+    usbh_desc_cache_t* cache = &_desc_cache[i];
+    if (cache->id && 0 == memcmp(&cache->desc_device, desc_device, sizeof(tusb_desc_device_t))) {
+      cache->lru = ++_desc_cache_stamp;
+      return cache;
+    }
+  }
+  return NULL;
+}
+
+// Replace empty or least recently used entry
+static usbh_desc_cache_t* desc_cache_alloc(tusb_desc_device_t const* desc_device) {
+  usbh_desc_cache_t* cache = &_desc_cache[0];
+  for (uint8_t i = 0; i < CFG_TUH_DESC_CACHE_COUNT && cache->id; i++) {
+    if (!_desc_cache[i].id || _desc_cache[i].lru < cache->lru) cache = &_desc_cache[i];
+  }
+
+  cache->id = ++_desc_cache_stamp;
+  cache->lru = cache->id;
+  cache->config_len = 0;
+  memcpy(&cache->desc_device, desc_device, sizeof(tusb_desc_device_t));
+  return cache;
+}
+
+// Entry of a device, NULL if it has been replaced since
+static usbh_desc_cache_t* desc_cache_get(uint8_t daddr) {
+  usbh_device_t const* dev = get_device(daddr);
+  if (dev == NULL || dev->desc_cache_id == 0) return NULL;
+  for (uint8_t i = 0; i < CFG_TUH_DESC_CACHE_COUNT; i++) {
+    if (_desc_cache[i].id == dev->desc_cache_id) return &_desc_cache[i];
+  }
+  return NULL;
+}
+
+// Complete GET_DESCRIPTOR (device or configuration) from cache, return false if not cached
+static bool desc_cache_xfer(tuh_xfer_t* xfer) {
+  usbh_desc_cache_t* cache = desc_cache_get(xfer->daddr);
+  TU_VERIFY(cache && cache->config_len);
+
+  uint8_t const type  = tu_u16_high(tu_le16toh(xfer->setup->wValue));
+  uint8_t const index = tu_u16_low(tu_le16toh(xfer->setup->wValue));
+  void const* src;
+  uint16_t src_len;
+
+  if (type == TUSB_DESC_DEVICE) {
+    src = &cache->desc_device;
+    src_len = sizeof(tusb_desc_device_t);
+  } else if (type == TUSB_DESC_CONFIGURATION && index == CONFIG_NUM - 1) {
+    src = cache->desc_config;
+    src_len = cache->config_len;
+  } else {
+    return false;
+  }
+
+  cache->lru = ++_desc_cache_stamp;
+  xfer->actual_len = tu_min16(tu_le16toh(xfer->setup->wLength), src_len);
+  memcpy(xfer->buffer, src, xfer->actual_len);
+  xfer->result = XFER_RESULT_SUCCESS;
+
+  if (xfer->complete_cb) {
+    xfer->complete_cb(xfer);
+  } else if (xfer->user_data) {
+    // blocking: user_data is expected to point to xfer_result_t, same as tuh_control_xfer()
+    *((xfer_result_t*) xfer->user_data) = XFER_RESULT_SUCCESS;
+  }
+
+  return true;
+}
+#endif
+
 static bool _get_descriptor(uint8_t daddr, uint8_t type, uint8_t index, uint16_t language_id, void* buffer, uint16_t len,
                             tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
   tusb_control_request_t const request = {
@@ -1003,6 +2892,10 @@ static bool _get_descriptor(uint8_t daddr, uint8_t type, uint8_t index, uint16_t
     .user_data   = user_data
   };
 
+#if CFG_TUH_DESC_CACHE_COUNT
+  if (language_id == 0 && desc_cache_xfer(&xfer)) return true;
+#endif
+
   return tuh_control_xfer(&xfer);
 }
 
@@ -1113,7 +3006,7 @@ bool tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt,
   TU_LOG_USBH("Set Interface %u Alternate %u\r\n", itf_num, itf_alt);
   tusb_control_request_t const request = {
       .bmRequestType_bit = {
-          .recipient = TUSB_REQ_RCPT_DEVICE,
+          .recipient = TUSB_REQ_RCPT_INTERFACE,
           .type      = TUSB_REQ_TYPE_STANDARD,
           .direction = TUSB_DIR_OUT
       },
@@ -1134,6 +3027,24 @@ bool tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt,
   return tuh_control_xfer(&xfer);
 }
 
+#if CFG_TUH_CONFIG_ITF_ALT_MAX
+bool tuh_interface_alt_get(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt, tuh_itf_alt_info_t* info) {
+  usbh_device_t const* dev = get_device(daddr);
+  TU_VERIFY(dev && info);
+
+  for (uint8_t i = 0; i < dev->itf_alt_count; i++) {
+    tusb_desc_interface_t const* desc_itf = &dev->itf_alt[i];
+    if (desc_itf->bInterfaceNumber == itf_num && desc_itf->bAlternateSetting == itf_alt) {
+      info->desc = *desc_itf;
+      info->ep = &dev->ep_desc[dev->itf_alt_ep_idx[i]];
+      return true;
+    }
+  }
+
+  return false;
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Descriptor Sync
 //--------------------------------------------------------------------+
@@ -1242,9 +3153,20 @@ static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hu
 
         hcd_device_close(rhport, daddr);
         clear_device(dev);
+        #if CFG_TUH_EDPT_XFER_SG
+        sg_xfer_clear(daddr);
+        #endif
+        #if CFG_TUH_MEM_DCACHE_ENABLE
+        dcache_xfer_clear(daddr, 0xff);
+        #endif
 
-        // abort on-going control xfer on this device if any
-        if (_ctrl_xfer.daddr == daddr) _set_control_xfer_stage(CONTROL_STAGE_IDLE);
+        // stop enumeration of this device if not yet complete
+        uint8_t const enum_idx = enum_find(daddr);
+        if (enum_idx != TUSB_INDEX_INVALID_8) enum_slot_free(enum_idx);
+        if (_enum_hub_held == daddr) _enum_hub_held = 0;
+
+        // abort on-going or queued control xfer on this device if any
+        if (_ctrl_xfer[daddr].stage != CONTROL_STAGE_IDLE) _control_xfer_reset(daddr);
       }
     }
 
@@ -1274,16 +3196,10 @@ static void process_removing_device(uint8_t rhport, uint8_t hub_addr, uint8_t hu
 // Enumeration Process
 // is a lengthy process with a series of control transfer to configure
 // newly attached device.
-// NOTE: due to the shared _usbh_ctrl_buf, we must complete enumerating
-// one device before enumerating another one.
+// NOTE: only one device can be in the default address phase at a time,
+// after SET_ADDRESS it continues in parallel with other enumerations.
 //--------------------------------------------------------------------+
 
-enum {
-  ENUM_RESET_DELAY = 50, // USB specs: 10 to 50ms
-  ENUM_CONTACT_DEBOUNCING_DELAY = 450, // when plug/unplug a device, physical connection can be bouncing and may
-                                       // generate a series of attach/detach event. This delay wait for stable connection
-};
-
 enum {
   ENUM_IDLE,
   ENUM_RESET_1,         // 1st reset when attached
@@ -1299,42 +3215,171 @@ enum {
   ENUM_GET_9BYTE_CONFIG_DESC,
   ENUM_GET_FULL_CONFIG_DESC,
   ENUM_SET_CONFIG,
-  ENUM_CONFIG_DRIVER
+  ENUM_CONFIG_DRIVER,
+
+  // steps resumed after a delay
+  ENUM_DEBOUNCE,
+  ENUM_ADDR0_GET_DESC,
+  ENUM_ADDR_GET_DESC,
+  ENUM_RETRY
 };
 
-static bool enum_request_set_addr(void);
+static bool enum_request_set_addr(uint8_t const* enum_buf);
 static bool _parse_configuration_descriptor (uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg);
-static void enum_full_complete(void);
+static void enum_full_complete(uint8_t idx);
+static void driver_set_config_next(uint8_t dev_addr);
+static void enum_dev0_release(void);
+
+// Timing of an enumeration: configured one, or default once it failed with adaptive timing
+static tuh_configure_enum_timing_t const* enum_timing(usbh_enum_t const* p_enum) {
+  return (_enum_timing.adaptive && p_enum->slow) ? &_enum_timing_default : &_enum_timing;
+}
+
+static void enum_delay_complete(uint8_t idx, uint8_t step);
+
+// Continue enumeration with step once ms elapsed, without blocking the host task
+static void enum_delay(uint8_t idx, uint16_t ms, uint8_t step) {
+  if (ms == 0) {
+    enum_delay_complete(idx, step);
+    return;
+  }
+
+  usbh_enum_t* p_enum = &_usbh_enum[idx];
+  usbh_device_t const* dev = get_device(p_enum->daddr);
+  p_enum->wait_rhport = dev ? dev->rhport : _dev0.rhport;
+  p_enum->wait_start = hcd_frame_number(p_enum->wait_rhport);
+  p_enum->wait_ms = ms;
+  p_enum->wait_step = step;
+}
+
+// Resume enumerations whose delay is over, called by host task
+static void enum_delay_check(void) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUMERATION_PARALLEL; idx++) {
+    usbh_enum_t* p_enum = &_usbh_enum[idx];
+    if (!p_enum->active || p_enum->wait_step == ENUM_IDLE) continue;
+
+    if (hcd_frame_number(p_enum->wait_rhport) - p_enum->wait_start >= p_enum->wait_ms) {
+      uint8_t const step = p_enum->wait_step;
+      p_enum->wait_step = ENUM_IDLE;
+      enum_delay_complete(idx, step);
+    }
+  }
+}
+
+// Time in ms until the earliest enumeration delay is over, UINT32_MAX if none
+static uint32_t enum_delay_remaining(void) {
+  uint32_t remaining = UINT32_MAX;
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUMERATION_PARALLEL; idx++) {
+    usbh_enum_t const* p_enum = &_usbh_enum[idx];
+    if (!p_enum->active || p_enum->wait_step == ENUM_IDLE) continue;
+
+    uint32_t const elapsed = hcd_frame_number(p_enum->wait_rhport) - p_enum->wait_start;
+    remaining = tu_min32(remaining, (elapsed >= p_enum->wait_ms) ? 0 : (p_enum->wait_ms - elapsed));
+  }
+  return remaining;
+}
+
+static bool enum_port_is_slow(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port) {
+  for (uint8_t i = 0; i < TU_ARRAY_SIZE(_enum_slow_ports); i++) {
+    usbh_slow_port_t const* port = &_enum_slow_ports[i];
+    if (port->valid && port->rhport == rhport && port->hub_addr == hub_addr && port->hub_port == hub_port) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Enumeration failed with configured timing, use default timing on this port from now on
+static void enum_fall_back(usbh_enum_t* p_enum) {
+  if (!_enum_timing.adaptive || p_enum->slow) return;
+  p_enum->slow = true;
+
+  usbh_device_t const* dev = get_device(p_enum->daddr);
+  usbh_slow_port_t const port = {
+    .rhport   = dev ? dev->rhport   : _dev0.rhport,
+    .hub_addr = dev ? dev->hub_addr : _dev0.hub_addr,
+    .hub_port = dev ? dev->hub_port : _dev0.hub_port,
+    .valid    = true
+  };
+  TU_LOG_USBH("[%u:%u:%u] Enumeration falls back to default timing\r\n", port.rhport, port.hub_addr, port.hub_port);
+
+  if (!enum_port_is_slow(port.rhport, port.hub_addr, port.hub_port)) {
+    _enum_slow_ports[_enum_slow_wr] = port;
+    _enum_slow_wr = (uint8_t) ((_enum_slow_wr + 1) % TU_ARRAY_SIZE(_enum_slow_ports));
+  }
+}
+
+static uint8_t enum_get_free(void) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUMERATION_PARALLEL; idx++) {
+    if (!_usbh_enum[idx].active) return idx;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+// find enumeration of an addressed device
+static uint8_t enum_find(uint8_t daddr) {
+  if (daddr == 0) return TUSB_INDEX_INVALID_8;
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUMERATION_PARALLEL; idx++) {
+    if (_usbh_enum[idx].active && _usbh_enum[idx].daddr == daddr) return idx;
+  }
+  return TUSB_INDEX_INVALID_8;
+}
+
+static void enum_slot_free(uint8_t idx) {
+  _usbh_enum[idx].active = false;
+  _usbh_enum[idx].wait_step = ENUM_IDLE;
+
+#if CFG_TUH_HUB
+  // resume hub status polling held back while all enumerations were busy, next attach can start now
+  if (_enum_hub_held) {
+    uint8_t const hub_addr = _enum_hub_held;
+    _enum_hub_held = 0;
+    hub_edpt_status_xfer(hub_addr);
+  }
+#endif
+}
 
 // process device enumeration
 static void process_enumeration(tuh_xfer_t* xfer) {
   // Retry a few times with transfers in enumeration since device can be unstable when starting up
   enum {
-    ATTEMPT_COUNT_MAX = 3,
-    ATTEMPT_DELAY_MS = 100
+    ATTEMPT_COUNT_MAX = 3
   };
-  static uint8_t failed_count = 0;
+  uint8_t const daddr = xfer->daddr;
+  uintptr_t const state = xfer->user_data;
+
+  // states up to SET_ADDRESS completion belong to the enumeration in default address phase,
+  // note that daddr of hub port requests in this phase is the hub address
+  bool const is_dev0 = (state <= ENUM_GET_DEVICE_DESC);
+  uint8_t const idx = is_dev0 ? _enum_dev0_idx : enum_find(daddr);
+  if (idx == TUSB_INDEX_INVALID_8) return; // device removed
+  usbh_enum_t* p_enum = &_usbh_enum[idx];
+  uint8_t* enum_buf = _usbh_ctrl_buf[idx];
+
+  // device at default address is removed
+  if (is_dev0 && !_dev0.enumerating) {
+    enum_full_complete(idx);
+    return;
+  }
 
   if (XFER_RESULT_SUCCESS != xfer->result) {
     // retry if not reaching max attempt
-    bool retry = _dev0.enumerating && (failed_count < ATTEMPT_COUNT_MAX);
-    if ( retry ) {
-      failed_count++;
-      osal_task_delay(ATTEMPT_DELAY_MS); // delay a bit
-      TU_LOG1("Enumeration attempt %u\r\n", failed_count);
-      retry = tuh_control_xfer(xfer);
-    }
-
-    if (!retry) {
-      enum_full_complete();
+    if (p_enum->failed_count < ATTEMPT_COUNT_MAX) {
+      p_enum->failed_count++;
+      enum_fall_back(p_enum);
+      TU_LOG1("Enumeration attempt %u\r\n", p_enum->failed_count);
+
+      p_enum->retry_setup = *xfer->setup;
+      p_enum->retry_xfer = *xfer;
+      p_enum->retry_xfer.setup = &p_enum->retry_setup;
+      enum_delay(idx, enum_timing(p_enum)->retry_ms, ENUM_RETRY); // delay a bit
+    } else {
+      enum_full_complete(idx);
     }
 
     return;
   }
-  failed_count = 0;
-
-  uint8_t const daddr = xfer->daddr;
-  uintptr_t const state = xfer->user_data;
+  p_enum->failed_count = 0;
 
   switch (state) {
     #if CFG_TUH_HUB
@@ -1342,11 +3387,11 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 
     case ENUM_HUB_CLEAR_RESET_1: {
       hub_port_status_response_t port_status;
-      memcpy(&port_status, _usbh_ctrl_buf, sizeof(hub_port_status_response_t));
+      memcpy(&port_status, enum_buf, sizeof(hub_port_status_response_t));
 
       if (!port_status.status.connection) {
         // device unplugged while delaying, nothing else to do
-        enum_full_complete();
+        enum_full_complete(idx);
         return;
       }
 
@@ -1362,14 +3407,12 @@ static void process_enumeration(tuh_xfer_t* xfer) {
     }
 
     case ENUM_HUB_GET_STATUS_2:
-      osal_task_delay(ENUM_RESET_DELAY);
-      TU_ASSERT(hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf,
-                                    process_enumeration, ENUM_HUB_CLEAR_RESET_2),);
+      enum_delay(idx, enum_timing(p_enum)->reset_ms, ENUM_HUB_GET_STATUS_2);
       break;
 
     case ENUM_HUB_CLEAR_RESET_2: {
       hub_port_status_response_t port_status;
-      memcpy(&port_status, _usbh_ctrl_buf, sizeof(hub_port_status_response_t));
+      memcpy(&port_status, enum_buf, sizeof(hub_port_status_response_t));
 
       // Acknowledge Port Reset Change if Reset Successful
       if (port_status.change.reset) {
@@ -1385,10 +3428,8 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       uint8_t const addr0 = 0;
       TU_ASSERT(usbh_edpt_control_open(addr0, 8),);
 
-      // Get first 8 bytes of device descriptor for Control Endpoint size
-      TU_LOG_USBH("Get 8 byte of Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(addr0, _usbh_ctrl_buf, 8,
-                                          process_enumeration, ENUM_SET_ADDR),);
+      // reset recovery, then get first 8 bytes of device descriptor for Control Endpoint size
+      enum_delay(idx, enum_timing(p_enum)->reset_recovery_ms, ENUM_ADDR0_GET_DESC);
       break;
     }
 
@@ -1417,7 +3458,7 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 #endif
 
     case ENUM_SET_ADDR:
-      enum_request_set_addr();
+      enum_request_set_addr(enum_buf);
       break;
 
     case ENUM_GET_DEVICE_DESC: {
@@ -1430,18 +3471,20 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       // Close device 0
       hcd_device_close(_dev0.rhport, 0);
 
+      // default address is free: continue at new address and let next device start its enumeration
+      p_enum->daddr = new_addr;
+      enum_dev0_release();
+
       // open control pipe for new address
       TU_ASSERT(usbh_edpt_control_open(new_addr, new_dev->ep0_size),);
 
-      // Get full device descriptor
-      TU_LOG_USBH("Get Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(new_addr, _usbh_ctrl_buf, sizeof(tusb_desc_device_t),
-                                          process_enumeration, ENUM_GET_9BYTE_CONFIG_DESC),);
+      // SET_ADDRESS recovery, then get full device descriptor
+      enum_delay(idx, enum_timing(p_enum)->set_address_ms, ENUM_ADDR_GET_DESC);
       break;
     }
 
     case ENUM_GET_9BYTE_CONFIG_DESC: {
-      tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) _usbh_ctrl_buf;
+      tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) enum_buf;
       usbh_device_t* dev = get_device(daddr);
       TU_ASSERT(dev,);
 
@@ -1451,18 +3494,33 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       dev->i_product = desc_device->iProduct;
       dev->i_serial = desc_device->iSerialNumber;
 
-      //  if (tuh_attach_cb) tuh_attach_cb((tusb_desc_device_t*) _usbh_ctrl_buf);
+      //  if (tuh_attach_cb) tuh_attach_cb((tusb_desc_device_t*) enum_buf);
+
+#if CFG_TUH_DESC_CACHE_COUNT
+      usbh_desc_cache_t* cache = desc_cache_find(desc_device);
+      if (cache && cache->config_len) {
+        // same device seen before, skip reading configuration descriptor
+        TU_LOG_USBH("Configuration Descriptor from cache\r\n");
+        dev->desc_cache_id = cache->id;
+        memcpy(enum_buf, cache->desc_config, cache->config_len);
+        TU_ASSERT(tuh_configuration_set(daddr, CONFIG_NUM, process_enumeration, ENUM_CONFIG_DRIVER),);
+        break;
+      }
+      // configuration descriptor is stored once read
+      if (cache == NULL) cache = desc_cache_alloc(desc_device);
+      dev->desc_cache_id = cache->id;
+#endif
 
       // Get 9-byte for total length
       uint8_t const config_idx = CONFIG_NUM - 1;
       TU_LOG_USBH("Get Configuration[0] Descriptor (9 bytes)\r\n");
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_ctrl_buf, 9,
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, enum_buf, 9,
                                                  process_enumeration, ENUM_GET_FULL_CONFIG_DESC),);
       break;
     }
 
     case ENUM_GET_FULL_CONFIG_DESC: {
-      uint8_t const* desc_config = _usbh_ctrl_buf;
+      uint8_t const* desc_config = enum_buf;
 
       // Use offsetof to avoid pointer to the odd/misaligned address
       uint16_t const total_len = tu_le16toh(
@@ -1474,14 +3532,25 @@ static void process_enumeration(tuh_xfer_t* xfer) {
       // Get full configuration descriptor
       uint8_t const config_idx = CONFIG_NUM - 1;
       TU_LOG_USBH("Get Configuration[0] Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_ctrl_buf, total_len,
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, enum_buf, total_len,
                                                  process_enumeration, ENUM_SET_CONFIG),);
       break;
     }
 
-    case ENUM_SET_CONFIG:
+    case ENUM_SET_CONFIG: {
+#if CFG_TUH_DESC_CACHE_COUNT
+      usbh_desc_cache_t* cache = desc_cache_get(daddr);
+      uint16_t const total_len = tu_le16toh(
+          tu_unaligned_read16(enum_buf + offsetof(tusb_desc_configuration_t, wTotalLength)));
+      if (cache && xfer->actual_len == total_len && total_len <= CFG_TUH_DESC_CACHE_CONFIG_SIZE) {
+        memcpy(cache->desc_config, enum_buf, total_len);
+        cache->config_len = total_len;
+      }
+#endif
+
       TU_ASSERT(tuh_configuration_set(daddr, CONFIG_NUM, process_enumeration, ENUM_CONFIG_DRIVER),);
       break;
+    }
 
     case ENUM_CONFIG_DRIVER: {
       TU_LOG_USBH("Device configured\r\n");
@@ -1492,69 +3561,123 @@ static void process_enumeration(tuh_xfer_t* xfer) {
 
       // Parse configuration & set up drivers
       // driver_open() must not make any usb transfer
-      TU_ASSERT(_parse_configuration_descriptor(daddr, (tusb_desc_configuration_t*) _usbh_ctrl_buf),);
+      TU_ASSERT(_parse_configuration_descriptor(daddr, (tusb_desc_configuration_t*) enum_buf),);
 
-      // Start the Set Configuration process for interfaces (itf = TUSB_INDEX_INVALID_8)
+      // Start the Set Configuration process for interfaces
       // Since driver can perform control transfer within its set_config, this is done asynchronously.
-      // The process continue with next interface when class driver complete its sequence with usbh_driver_set_config_complete()
-      // TODO use separated API instead of using TUSB_INDEX_INVALID_8
-      usbh_driver_set_config_complete(daddr, TUSB_INDEX_INVALID_8);
+      // The process continue with next interface when class driver releases the control pipe with
+      // usbh_driver_set_config_release() or usbh_driver_set_config_complete()
+      dev->itf_cfg_next = 0;
+      dev->itf_cfg_active = TUSB_INDEX_INVALID_8;
+      dev->itf_cfg_pending = 0;
+      driver_set_config_next(daddr);
       break;
     }
 
     default:
       // stop enumeration if unknown state
-      enum_full_complete();
+      enum_full_complete(idx);
       break;
   }
 }
 
 static bool enum_new_device(hcd_event_t* event) {
+  uint8_t const idx = _enum_dev0_idx;
+  tuh_configure_enum_timing_t const* timing = enum_timing(&_usbh_enum[idx]);
   _dev0.rhport = event->rhport;
   _dev0.hub_addr = event->connection.hub_addr;
   _dev0.hub_port = event->connection.hub_port;
 
   if (_dev0.hub_addr == 0) {
-    // connected/disconnected directly with roothub
+    // connected/disconnected directly with roothub, reset is ended after reset_ms.
+    // TODO may not work for no-OS on MCU that require reset_end() since sof of controller may not running while resetting
     hcd_port_reset(_dev0.rhport);
-    osal_task_delay(ENUM_RESET_DELAY); // TODO may not work for no-OS on MCU that require reset_end() since
-    // sof of controller may not running while resetting
-    hcd_port_reset_end(_dev0.rhport);
-
-    // wait until device connection is stable TODO non blocking
-    osal_task_delay(ENUM_CONTACT_DEBOUNCING_DELAY);
+    enum_delay(idx, timing->reset_ms, ENUM_RESET_1);
+  }
+#if CFG_TUH_HUB
+  else {
+    // connected/disconnected via external hub, wait until device connection is stable
+    enum_delay(idx, timing->debounce_ms, ENUM_DEBOUNCE);
+  }
+#endif // hub
 
-    // device unplugged while delaying
-    if (!hcd_port_connect_status(_dev0.rhport)) {
-      enum_full_complete();
-      return true;
-    }
+  return true;
+}
 
-    _dev0.speed = hcd_port_speed_get(_dev0.rhport);
-    TU_LOG_USBH("%s Speed\r\n", tu_str_speed[_dev0.speed]);
+// Continue enumeration after a delay
+static void enum_delay_complete(uint8_t idx, uint8_t step) {
+  usbh_enum_t* p_enum = &_usbh_enum[idx];
 
-    // fake transfer to kick-off the enumeration process
-    tuh_xfer_t xfer;
-    xfer.daddr = 0;
-    xfer.result = XFER_RESULT_SUCCESS;
-    xfer.user_data = ENUM_ADDR0_DEVICE_DESC;
+  if (step == ENUM_RETRY) {
+    if (!tuh_control_xfer(&p_enum->retry_xfer)) {
+      enum_full_complete(idx);
+    }
+    return;
+  }
 
-    process_enumeration(&xfer);
+  if (step == ENUM_ADDR_GET_DESC) {
+    TU_LOG_USBH("Get Device Descriptor\r\n");
+    TU_ASSERT(tuh_descriptor_get_device(p_enum->daddr, _usbh_ctrl_buf[idx], sizeof(tusb_desc_device_t),
+                                        process_enumeration, ENUM_GET_9BYTE_CONFIG_DESC),);
+    return;
   }
-#if CFG_TUH_HUB
-  else {
-    // connected/disconnected via external hub
-    // wait until device connection is stable TODO non blocking
-    osal_task_delay(ENUM_CONTACT_DEBOUNCING_DELAY);
 
-    // ENUM_HUB_GET_STATUS
-    //TU_ASSERT( hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf, enum_hub_get_status0_complete, 0) );
-    TU_ASSERT(hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf,
-                                  process_enumeration, ENUM_HUB_CLEAR_RESET_1));
+  // other steps are in default address phase: device unplugged while delaying
+  if (idx != _enum_dev0_idx || !_dev0.enumerating) {
+    enum_full_complete(idx);
+    return;
   }
-#endif // hub
 
-  return true;
+  switch (step) {
+    case ENUM_RESET_1:
+      hcd_port_reset_end(_dev0.rhport);
+
+      // wait until device connection is stable
+      enum_delay(idx, enum_timing(p_enum)->debounce_ms, ENUM_DEBOUNCE);
+      break;
+
+    case ENUM_DEBOUNCE:
+      if (_dev0.hub_addr == 0) {
+        if (!hcd_port_connect_status(_dev0.rhport)) {
+          enum_full_complete(idx);
+          return;
+        }
+
+        _dev0.speed = hcd_port_speed_get(_dev0.rhport);
+        TU_LOG_USBH("%s Speed\r\n", tu_str_speed[_dev0.speed]);
+
+        // fake transfer to kick-off the enumeration process
+        tuh_xfer_t xfer;
+        xfer.daddr = 0;
+        xfer.result = XFER_RESULT_SUCCESS;
+        xfer.user_data = ENUM_ADDR0_DEVICE_DESC;
+
+        process_enumeration(&xfer);
+      }
+      #if CFG_TUH_HUB
+      else if (!hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf[idx],
+                                    process_enumeration, ENUM_HUB_CLEAR_RESET_1)) {
+        enum_full_complete(idx);
+      }
+      #endif
+      break;
+
+    #if CFG_TUH_HUB
+    case ENUM_HUB_GET_STATUS_2:
+      TU_ASSERT(hub_port_get_status(_dev0.hub_addr, _dev0.hub_port, _usbh_ctrl_buf[idx],
+                                    process_enumeration, ENUM_HUB_CLEAR_RESET_2),);
+      break;
+    #endif
+
+    case ENUM_ADDR0_GET_DESC:
+      TU_LOG_USBH("Get 8 byte of Device Descriptor\r\n");
+      TU_ASSERT(tuh_descriptor_get_device(0, _usbh_ctrl_buf[idx], 8, process_enumeration, ENUM_SET_ADDR),);
+      break;
+
+    default:
+      enum_full_complete(idx);
+      break;
+  }
 }
 
 static uint8_t get_new_address(bool is_hub) {
@@ -1576,8 +3699,8 @@ static uint8_t get_new_address(bool is_hub) {
   return 0; // invalid address
 }
 
-static bool enum_request_set_addr(void) {
-  tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) _usbh_ctrl_buf;
+static bool enum_request_set_addr(uint8_t const* enum_buf) {
+  tusb_desc_device_t const* desc_device = (tusb_desc_device_t const*) enum_buf;
 
   // Get new address
   uint8_t const new_addr = get_new_address(desc_device->bDeviceClass == TUSB_CLASS_HUB);
@@ -1616,14 +3739,73 @@ static bool enum_request_set_addr(void) {
   return true;
 }
 
+static bool driver_match(usbh_class_driver_t const* driver, usbh_device_t const* dev,
+                         tusb_desc_interface_t const* desc_itf) {
+  if (driver->match == NULL) return true;
+
+  for (uint8_t i = 0; i < driver->match_count; i++) {
+    usbh_class_match_t const* m = &driver->match[i];
+    uint8_t const flags = m->match_flags;
+    if ((flags & USBH_MATCH_VID)          && m->vid          != dev->vid) continue;
+    if ((flags & USBH_MATCH_PID)          && m->pid          != dev->pid) continue;
+    if ((flags & USBH_MATCH_ITF_CLASS)    && m->itf_class    != desc_itf->bInterfaceClass) continue;
+    if ((flags & USBH_MATCH_ITF_SUBCLASS) && m->itf_subclass != desc_itf->bInterfaceSubClass) continue;
+    if ((flags & USBH_MATCH_ITF_PROTOCOL) && m->itf_protocol != desc_itf->bInterfaceProtocol) continue;
+    return true;
+  }
+
+  return false;
+}
+
+#if CFG_TUH_CONFIG_ITF_ALT_MAX
+// Keep interface and endpoint descriptors of all alternate settings, until there is no more room
+static void config_itf_alt_save(usbh_device_t* dev, tusb_desc_configuration_t const* desc_cfg) {
+  uint8_t const* desc_end = ((uint8_t const*) desc_cfg) + tu_le16toh(desc_cfg->wTotalLength);
+  uint8_t const* p_desc   = tu_desc_next(desc_cfg);
+  uint8_t ep_idx = 0; // next endpoint slot of current interface
+  uint8_t ep_end = 0; // slots reserved for current interface by bNumEndpoints
+
+  tu_memclr(dev->ep_desc, sizeof(dev->ep_desc));
+  dev->itf_alt_count = 0;
+  dev->ep_desc_count = 0;
+
+  for (; p_desc < desc_end && tu_desc_len(p_desc); p_desc = tu_desc_next(p_desc)) {
+    uint8_t const desc_type = tu_desc_type(p_desc);
+
+    if (desc_type == TUSB_DESC_INTERFACE) {
+      tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+      if (dev->itf_alt_count == CFG_TUH_CONFIG_ITF_ALT_MAX ||
+          dev->ep_desc_count + desc_itf->bNumEndpoints > CFG_TUH_CONFIG_EP_MAX) {
+        TU_LOG_USBH("  No room to keep Interface %u Alternate %u and later ones\r\n", desc_itf->bInterfaceNumber,
+                    desc_itf->bAlternateSetting);
+        break;
+      }
+      dev->itf_alt_ep_idx[dev->itf_alt_count] = dev->ep_desc_count;
+      memcpy(&dev->itf_alt[dev->itf_alt_count++], desc_itf, sizeof(tusb_desc_interface_t));
+
+      ep_idx = dev->ep_desc_count;
+      dev->ep_desc_count = (uint8_t) (dev->ep_desc_count + desc_itf->bNumEndpoints);
+      ep_end = dev->ep_desc_count;
+    } else if (desc_type == TUSB_DESC_ENDPOINT && ep_idx < ep_end) {
+      memcpy(&dev->ep_desc[ep_idx++], p_desc, sizeof(tusb_desc_endpoint_t));
+    }
+  }
+}
+#endif
+
 static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg) {
   usbh_device_t* dev = get_device(dev_addr);
   uint16_t const total_len = tu_le16toh(desc_cfg->wTotalLength);
+  dev->remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1u : 0u;
   uint8_t const* desc_end = ((uint8_t const*) desc_cfg) + total_len;
   uint8_t const* p_desc   = tu_desc_next(desc_cfg);
 
   TU_LOG_USBH("Parsing Configuration descriptor (wTotalLength = %u)\r\n", total_len);
 
+#if CFG_TUH_CONFIG_ITF_ALT_MAX
+  config_itf_alt_save(dev, desc_cfg);
+#endif
+
   // parse each interfaces
   while( p_desc < desc_end ) {
     uint8_t assoc_itf_count = 1;
@@ -1664,13 +3846,44 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
     }
 #endif
 
+#if CFG_TUH_ECM
+    // ECM Communication + Data interface, some devices do not use IAD
+    if (1                                        == assoc_itf_count              &&
+        TUSB_CLASS_CDC                           == desc_itf->bInterfaceClass    &&
+        CDC_COMM_SUBCLASS_ETHERNET_CONTROL_MODEL == desc_itf->bInterfaceSubClass) {
+      assoc_itf_count = 2;
+    }
+#endif
+
+#if CFG_TUH_NCM
+    // NCM Communication + Data interface, some devices do not use IAD
+    if (1                                       == assoc_itf_count              &&
+        TUSB_CLASS_CDC                          == desc_itf->bInterfaceClass    &&
+        CDC_COMM_SUBCLASS_NETWORK_CONTROL_MODEL == desc_itf->bInterfaceSubClass) {
+      assoc_itf_count = 2;
+    }
+#endif
+
+#if CFG_TUH_RNDIS
+    // RNDIS Control + Data interface, some devices do not use IAD
+    if (1 == assoc_itf_count &&
+        ((TUSB_CLASS_CDC == desc_itf->bInterfaceClass &&
+          CDC_COMM_SUBCLASS_ABSTRACT_CONTROL_MODEL == desc_itf->bInterfaceSubClass && 0xFF == desc_itf->bInterfaceProtocol) ||
+         (TUSB_CLASS_WIRELESS_CONTROLLER == desc_itf->bInterfaceClass &&
+          0x01 == desc_itf->bInterfaceSubClass && 0x03 == desc_itf->bInterfaceProtocol) ||
+         (TUSB_CLASS_MISC == desc_itf->bInterfaceClass &&
+          0x04 == desc_itf->bInterfaceSubClass && 0x01 == desc_itf->bInterfaceProtocol))) {
+      assoc_itf_count = 2;
+    }
+#endif
+
     uint16_t const drv_len = tu_desc_get_interface_total_len(desc_itf, assoc_itf_count, (uint16_t) (desc_end-p_desc));
     TU_ASSERT(drv_len >= sizeof(tusb_desc_interface_t));
 
-    // Find driver for this interface
+    // Find driver for this interface, only drivers whose match table accepts it get to parse its descriptors
     for (uint8_t drv_id = 0; drv_id < TOTAL_DRIVER_COUNT; drv_id++) {
       usbh_class_driver_t const * driver = get_driver(drv_id);
-      if (driver && driver->open(dev->rhport, dev_addr, desc_itf, drv_len) ) {
+      if (driver && driver_match(driver, dev, desc_itf) && driver->open(dev->rhport, dev_addr, desc_itf, drv_len)) {
         // open successfully
         TU_LOG_USBH("  %s opened\r\n", driver->name);
 
@@ -1702,44 +3915,87 @@ static bool _parse_configuration_descriptor(uint8_t dev_addr, tusb_desc_configur
   return true;
 }
 
-void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
+// Start set_config() of the next interface if control pipe is free, mount device when all interfaces are complete
+static void driver_set_config_next(uint8_t dev_addr) {
   usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev,);
+  if (dev->itf_cfg_active != TUSB_INDEX_INVALID_8) return;
 
-  for(itf_num++; itf_num < CFG_TUH_INTERFACE_MAX; itf_num++) {
-    // continue with next valid interface
-    // IAD binding interface such as CDCs should return itf_num + 1 when complete
-    // with usbh_driver_set_config_complete()
+  for (uint8_t itf_num = dev->itf_cfg_next; itf_num < CFG_TUH_INTERFACE_MAX; itf_num++) {
     uint8_t const drv_id = dev->itf2drv[itf_num];
     usbh_class_driver_t const * driver = get_driver(drv_id);
     if (driver) {
+      dev->itf_cfg_next = (uint8_t) (itf_num + 1);
+      dev->itf_cfg_active = itf_num;
+      dev->itf_cfg_pending++;
+
       TU_LOG_USBH("%s set config: itf = %u\r\n", driver->name, itf_num);
       driver->set_config(dev_addr, itf_num);
-      break;
+      return;
     }
   }
 
+  dev->itf_cfg_next = CFG_TUH_INTERFACE_MAX;
+  if (dev->itf_cfg_pending) return; // released interfaces are still being configured
+
   // all interface are configured
-  if (itf_num == CFG_TUH_INTERFACE_MAX) {
-    enum_full_complete();
-
-    if (is_hub_addr(dev_addr)) {
-      TU_LOG_USBH("HUB address = %u is mounted\r\n", dev_addr);
-    }else {
-      // Invoke callback if available
-      if (tuh_mount_cb) tuh_mount_cb(dev_addr);
-    }
+  dev->itf_cfg_pending = TUSB_INDEX_INVALID_8; // mount only once
+  uint8_t const enum_idx = enum_find(dev_addr);
+  if (enum_idx != TUSB_INDEX_INVALID_8) enum_full_complete(enum_idx);
+
+  if (is_hub_addr(dev_addr)) {
+    TU_LOG_USBH("HUB address = %u is mounted\r\n", dev_addr);
+  }else {
+    // Invoke callback if available
+    if (tuh_mount_cb) tuh_mount_cb(dev_addr);
   }
 }
 
-static void enum_full_complete(void) {
-  // mark enumeration as complete
+// Active interface is done with control transfers (and enumeration buffer), itf_num is its last interface.
+// IAD binding interface such as CDCs should pass its last bound interface
+void usbh_driver_set_config_release(uint8_t dev_addr, uint8_t itf_num) {
+  usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev && dev->itf_cfg_active != TUSB_INDEX_INVALID_8 && itf_num >= dev->itf_cfg_active,);
+
+  dev->itf_cfg_active = TUSB_INDEX_INVALID_8;
+  if (dev->itf_cfg_next <= itf_num) dev->itf_cfg_next = (uint8_t) (itf_num + 1);
+  driver_set_config_next(dev_addr);
+}
+
+void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
+  usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev && dev->itf_cfg_pending && dev->itf_cfg_pending != TUSB_INDEX_INVALID_8,);
+  dev->itf_cfg_pending--;
+
+  // interface started after all released ones, complete also releases control pipe if not done yet
+  if (dev->itf_cfg_active != TUSB_INDEX_INVALID_8 && itf_num >= dev->itf_cfg_active) {
+    usbh_driver_set_config_release(dev_addr, itf_num);
+  } else {
+    driver_set_config_next(dev_addr);
+  }
+}
+
+// Default address phase is done (successfully or not)
+static void enum_dev0_release(void) {
   _dev0.enumerating = 0;
+  _enum_dev0_idx = TUSB_INDEX_INVALID_8;
 
 #if CFG_TUH_HUB
-  // get next hub status
-  if (_dev0.hub_addr) hub_edpt_status_xfer(_dev0.hub_addr);
+  // get next hub status, or hold it back until an enumeration is free since hub resets the port on attach
+  if (_dev0.hub_addr) {
+    if (enum_get_free() != TUSB_INDEX_INVALID_8) {
+      hub_edpt_status_xfer(_dev0.hub_addr);
+    } else {
+      _enum_hub_held = _dev0.hub_addr;
+    }
+  }
 #endif
+}
 
+static void enum_full_complete(uint8_t idx) {
+  // mark enumeration as complete
+  enum_slot_free(idx);
+  if (idx == _enum_dev0_idx) enum_dev0_release();
 }
 
 #endif
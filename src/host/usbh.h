@@ -50,7 +50,7 @@ typedef void (*tuh_xfer_cb_t)(tuh_xfer_t* xfer);
 struct tuh_xfer_s {
   uint8_t daddr;
   uint8_t ep_addr;
-  uint8_t TU_RESERVED;      // reserved
+  bool complete_in_isr;     // invoke complete_cb from HCD interrupt instead of usbh task, non-control transfer only
   xfer_result_t result;
 
   uint32_t actual_len;      // excluding setup packet
@@ -64,7 +64,8 @@ struct tuh_xfer_s {
   tuh_xfer_cb_t complete_cb;
   uintptr_t user_data;
 
-  // uint32_t timeout_ms;    // place holder, not supported yet
+  uint32_t timeout_ms;      // abort transfer and complete it with XFER_RESULT_TIMEOUT if not done within this time,
+                            // 0 for no timeout. Requires CFG_TUH_XFER_TIMEOUT
 };
 
 // Subject to change
@@ -73,23 +74,62 @@ typedef struct {
   tusb_desc_interface_t desc;
 } tuh_itf_info_t;
 
+// Interface alternate setting of the active configuration (CFG_TUH_CONFIG_ITF_ALT_MAX)
+typedef struct {
+  tusb_desc_interface_t desc;
+  tusb_desc_endpoint_t const* ep; // desc.bNumEndpoints endpoint descriptors
+} tuh_itf_alt_info_t;
+
 // ConfigID for tuh_configure()
 enum {
   TUH_CFGID_INVALID = 0,
   TUH_CFGID_RPI_PIO_USB_CONFIGURATION = 100, // cfg_param: pio_usb_configuration_t
+  TUH_CFGID_RPI_PIO_USB_ADD_PORT = 101, // cfg_param: tuh_configure_pio_usb_port_t
   TUH_CFGID_MAX3421 = 200,
+  TUH_CFGID_ENUM_TIMING = 300, // cfg_param: tuh_configure_enum_timing_t, common to all ports
+  TUH_CFGID_EHCI = 400, // cfg_param: tuh_configure_ehci_t
 };
 
+// Additional PIO-USB root port, becomes rhport (BOARD_TUH_RHPORT + n) in the order they are added.
+// Number of ports is limited by PIO_USB_ROOT_PORT_CNT of Pico-PIO-USB
+typedef struct {
+  uint8_t pin_dp; // D+ pin, D- is pin_dp+1 (or pin_dp-1 with PIO_USB_PINOUT_DMDP)
+  uint8_t pinout; // PIO_USB_PINOUT
+} tuh_configure_pio_usb_port_t;
+
 typedef struct {
   uint8_t max_nak; // max NAK per endpoint per frame
   uint8_t cpuctl; // R16: CPU Control Register
   uint8_t pinctl; // R17: Pin Control Register. FDUPSPI bit is ignored
+  uint8_t nak_backoff_max; // max frames a bulk endpoint is skipped after consecutive NAKed frames. 0 is no back-off
 } tuh_configure_max3421_t;
 
+// Enumeration timing in milliseconds. Default values follow USB specs with margin for slow devices
+typedef struct {
+  uint16_t debounce_ms;       // wait for stable connection after attach (default 450)
+  uint16_t reset_ms;          // root port reset duration (default 50)
+  uint16_t reset_recovery_ms; // after reset before first request (default 10)
+  uint16_t set_address_ms;    // after SET_ADDRESS before next request (default 2)
+  uint16_t retry_ms;          // before retrying a failed request (default 100)
+
+  // Adaptive: above values are tried first, a port falls back to default timing once enumeration of its device
+  // failed, and stays so for following attaches
+  uint8_t adaptive;
+} tuh_configure_enum_timing_t;
+
+typedef struct {
+  // Interrupt threshold control (USBCMD ITC): max rate in microframes at which HC raises transfer interrupts,
+  // completions within the window are reported by one interrupt. Valid 1, 2, 4, 8 (default), 16, 32, 64
+  uint8_t int_threshold;
+} tuh_configure_ehci_t;
+
 typedef union {
   // For TUH_CFGID_RPI_PIO_USB_CONFIGURATION use pio_usb_configuration_t
 
+  tuh_configure_pio_usb_port_t pio_usb_port;
   tuh_configure_max3421_t max3421;
+  tuh_configure_enum_timing_t enum_timing;
+  tuh_configure_ehci_t ehci;
 } tuh_configure_param_t;
 
 //--------------------------------------------------------------------+
@@ -107,9 +147,26 @@ TU_ATTR_WEAK void tuh_mount_cb (uint8_t daddr);
 // Invoked when a device is unmounted (detached)
 TU_ATTR_WEAK void tuh_umount_cb(uint8_t daddr);
 
+// Invoked when a device is suspended by tuh_suspend() or auto-suspend
+TU_ATTR_WEAK void tuh_suspend_cb(uint8_t daddr);
+
+// Invoked when a suspended device is resumed and ready to communicate again, by tuh_resume() or its remote wakeup
+TU_ATTR_WEAK void tuh_resume_cb(uint8_t daddr, bool remote_wakeup);
+
 // Invoked when there is a new usb event, which need to be processed by tuh_task()/tuh_task_ext()
 void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 
+// Invoked when the event queue goes from empty to non-empty i.e tuh_task() has work to do again, may be in ISR
+void tuh_task_wakeup_cb(uint8_t rhport, bool in_isr);
+
+// Invoked to get current time for statistics (CFG_TUH_STATS), e.g cycle counter or microsecond timer.
+// Must be ISR-safe, unit is up to application.
+uint32_t tuh_stats_timestamp_cb(void);
+
+// Invoked by tuh_int_handler() before/after hcd_int_handler() (CFG_TUH_INT_HOOK), see tud_int_enter_cb()
+void tuh_int_enter_cb(uint8_t rhport);
+void tuh_int_exit_cb(uint8_t rhport, uint32_t duration);
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -141,9 +198,21 @@ void tuh_task(void) {
   tuh_task_ext(UINT32_MAX, false);
 }
 
+// Task function for a single root port, only processes events of rhport's queue (CFG_TUH_TASK_RHPORT_NUM).
+// Can be called for each root port from its own RTOS thread, parameters are the same as tuh_task_ext()
+void tuh_task_rhport_ext(uint8_t rhport, uint32_t timeout_ms, bool in_isr);
+
+// Task function with bounded run time for bare-metal mainloop, see tud_task_budget().
+// Budget is shared by all root port queues. Return number of processed events
+uint32_t tuh_task_budget(uint32_t max_events);
+
 // Check if there is pending events need processing by tuh_task()
 bool tuh_task_event_ready(void);
 
+// Race-free sleep for bare-metal mainloop, see tud_task_sleep()
+// Return true if sleep_func() was invoked, false if tuh_task() has work to do
+bool tuh_task_sleep(void (*sleep_func)(void));
+
 #ifndef _TUSB_HCD_H_
 extern void hcd_int_handler(uint8_t rhport, bool in_isr);
 #endif
@@ -152,8 +221,15 @@ extern void hcd_int_handler(uint8_t rhport, bool in_isr);
 // - tuh_int_handler(rhport) --> hcd_int_handler(rhport, true)
 // - tuh_int_handler(rhport, in_isr) --> hcd_int_handler(rhport, in_isr)
 // Note: this is similar to TU_VERIFY(), _GET_3RD_ARG() is defined in tusb_verify.h
+#if CFG_TUH_STATS || CFG_TUH_INT_HOOK
+// hcd_int_handler() wrapped with duration statistics and enter/exit hooks
+void tuh_int_handler_ext(uint8_t rhport, bool in_isr);
+#define _tuh_int_handler_1arg(_rhport)            tuh_int_handler_ext(_rhport, true)
+#define _tuh_int_hanlder_2arg(_rhport, _in_isr)   tuh_int_handler_ext(_rhport, _in_isr)
+#else
 #define _tuh_int_handler_1arg(_rhport)            hcd_int_handler(_rhport, true)
 #define _tuh_int_hanlder_2arg(_rhport, _in_isr)   hcd_int_handler(_rhport, _in_isr)
+#endif
 #define tuh_int_handler(...)   _GET_3RD_ARG(__VA_ARGS__, _tuh_int_hanlder_2arg, _tuh_int_handler_1arg, _dummy)(__VA_ARGS__)
 
 // Check if roothub port is initialized and active as a host
@@ -175,13 +251,22 @@ tusb_speed_t tuh_speed_get(uint8_t daddr);
 // Check if device is connected and configured
 bool tuh_mounted(uint8_t daddr);
 
-// Check if device is suspended
-TU_ATTR_ALWAYS_INLINE static inline
-bool tuh_suspended(uint8_t daddr) {
-  // TODO implement suspend & resume on host
-  (void) daddr;
-  return false;
-}
+// Check if device is suspended, itself or by one of its upstream hubs
+bool tuh_suspended(uint8_t daddr);
+
+// Selectively suspend a device: its hub port (or roothub port) stops forwarding bus traffic. Remote wakeup is enabled
+// first if the device supports it. Device must have no transfer in flight, abort polling endpoints beforehand.
+// Suspending a hub suspends all its downstream devices. tuh_suspend_cb() is invoked when done
+bool tuh_suspend(uint8_t daddr);
+
+// Resume a suspended device, tuh_resume_cb() is invoked when it can be communicated with again
+bool tuh_resume(uint8_t daddr);
+
+#if CFG_TUH_AUTO_SUSPEND
+// Suspend device once it has had no transfer for idle_ms, 0 to disable. A transfer submitted to an auto-suspended
+// device fails but starts resuming it, it can be retried in tuh_resume_cb()
+bool tuh_auto_suspend_set(uint8_t daddr, uint16_t idle_ms);
+#endif
 
 // Check if device is ready to communicate with
 TU_ATTR_ALWAYS_INLINE static inline
@@ -201,6 +286,9 @@ bool tuh_control_xfer(tuh_xfer_t* xfer);
 // Submit a bulk/interrupt transfer
 //  - async: complete callback invoked when finished.
 //  - sync : blocking if complete callback is NULL.
+// With complete_in_isr, callback runs in interrupt context right after HCD reports the completion. It must be short
+// and only use ISR-safe API: tuh_edpt_xfer() to re-arm the endpoint is allowed. Callback is still deferred to usbh
+// task while earlier completions of the same endpoint are waiting there, to keep them in order.
 bool tuh_edpt_xfer(tuh_xfer_t* xfer);
 
 // Open a non-control endpoint
@@ -223,6 +311,49 @@ bool tuh_configuration_set(uint8_t daddr, uint8_t config_num,
 bool tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt,
                        tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 
+#if CFG_TUH_CONFIG_ITF_ALT_MAX
+// Get an interface alternate setting of the active configuration, kept since enumeration.
+// Return false if not found, or not kept since there is no room left (CFG_TUH_CONFIG_ITF_ALT_MAX/EP_MAX).
+bool tuh_interface_alt_get(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt, tuh_itf_alt_info_t* info);
+#endif
+
+//--------------------------------------------------------------------+
+// Statistics (CFG_TUH_STATS)
+// Counters are accumulated since tuh_init() or tuh_stats_clear(), endpoint counters are also reset when device
+// is removed. Time values are in unit of tuh_stats_timestamp_cb() and stay 0 if it is not implemented.
+//--------------------------------------------------------------------+
+#if CFG_TUH_STATS
+typedef struct {
+  uint32_t xfer_count;  // completed transfers
+  uint32_t xfer_failed; // completed transfers with result other than success
+  uint32_t stall_count; // transfers completed with stall
+  uint64_t xfer_bytes;  // total bytes of completed transfers
+} tuh_stats_edpt_t;
+
+typedef struct {
+  uint32_t event_count;       // events dispatched by usbh task
+  uint16_t event_queue_hwm;   // highest number of events waiting in queue
+  uint16_t event_dropped;     // events lost due to full queue
+  uint32_t event_latency_max; // longest time from event queued to being dispatched by usbh task
+  uint32_t isr_time_max;      // longest time spent in hcd_event_handler()
+
+  // tuh_int_handler() i.e whole USB interrupt, ports registering hcd_int_handler() directly are not measured
+  uint32_t isr_count;         // invocations of tuh_int_handler()
+  uint32_t isr_duration_max;  // longest tuh_int_handler()
+  uint32_t isr_duration_hist[CFG_TUSB_STATS_HIST_BINS]; // tuh_int_handler() durations, see CFG_TUSB_STATS_HIST_BINS
+  uint32_t event_latency_hist[CFG_TUSB_STATS_HIST_BINS]; // event age when dispatched by usbh task
+} tuh_stats_t;
+
+// Get a snapshot of event queue statistics
+bool tuh_stats_get(tuh_stats_t* stats);
+
+// Get a snapshot of endpoint statistics of a device
+bool tuh_stats_edpt_get(uint8_t daddr, uint8_t ep_addr, tuh_stats_edpt_t* stats);
+
+// Reset all statistics counters
+void tuh_stats_clear(void);
+#endif
+
 //--------------------------------------------------------------------+
 // Descriptors Asynchronous (non-blocking)
 //--------------------------------------------------------------------+
@@ -250,6 +381,8 @@ bool tuh_descriptor_get_hid_report(uint8_t daddr, uint8_t itf_num, uint8_t desc_
 // Get string descriptor (control transfer)
 // true on success, false if there is on-going control transfer or incorrect parameters
 // Blocking if complete callback is NULL, in this case 'user_data' must contain xfer_result_t variable
+// Note: enumeration does not read any string descriptor (not even language ID), they are only fetched when requested
+// by these APIs, therefore slow or string-heavy devices do not delay mounting of class drivers.
 bool tuh_descriptor_get_string(uint8_t daddr, uint8_t index, uint16_t language_id, void* buffer, uint16_t len,
                                tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 
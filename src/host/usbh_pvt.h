@@ -49,6 +49,39 @@ enum {
 // Class Driver API
 //--------------------------------------------------------------------+
 
+// Fields of usbh_class_match_t compared against an interface (and its device), others are ignored
+enum {
+  USBH_MATCH_VID          = 0x01,
+  USBH_MATCH_PID          = 0x02,
+  USBH_MATCH_ITF_CLASS    = 0x04,
+  USBH_MATCH_ITF_SUBCLASS = 0x08,
+  USBH_MATCH_ITF_PROTOCOL = 0x10,
+};
+
+// Interface is offered to driver's open() only if it matches one of the driver's entries. Interface is the first
+// one of a function i.e following an Interface Association descriptor if any.
+typedef struct {
+  uint8_t  match_flags;
+  uint8_t  itf_class;
+  uint8_t  itf_subclass;
+  uint8_t  itf_protocol;
+  uint16_t vid;
+  uint16_t pid;
+} usbh_class_match_t;
+
+#define USBH_MATCH_CLASS(_class) \
+  { .match_flags = USBH_MATCH_ITF_CLASS, .itf_class = (_class) }
+
+#define USBH_MATCH_CLASS_SUBCLASS(_class, _subclass) \
+  { .match_flags = USBH_MATCH_ITF_CLASS | USBH_MATCH_ITF_SUBCLASS, .itf_class = (_class), .itf_subclass = (_subclass) }
+
+#define USBH_MATCH_CLASS_SUBCLASS_PROTOCOL(_class, _subclass, _protocol) \
+  { .match_flags = USBH_MATCH_ITF_CLASS | USBH_MATCH_ITF_SUBCLASS | USBH_MATCH_ITF_PROTOCOL, \
+    .itf_class = (_class), .itf_subclass = (_subclass), .itf_protocol = (_protocol) }
+
+#define USBH_MATCH_DEVICE(_vid, _pid) \
+  { .match_flags = USBH_MATCH_VID | USBH_MATCH_PID, .vid = (_vid), .pid = (_pid) }
+
 typedef struct {
   char const* name;
   bool (* const init       )(void);
@@ -56,7 +89,10 @@ typedef struct {
   bool (* const open       )(uint8_t rhport, uint8_t dev_addr, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
   bool (* const set_config )(uint8_t dev_addr, uint8_t itf_num);
   bool (* const xfer_cb    )(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+  bool (* const xfer_isr   )(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes); // optional, return false to defer to xfer_cb()
   void (* const close      )(uint8_t dev_addr);
+  usbh_class_match_t const* match; // optional, every interface is offered to open() if NULL
+  uint8_t match_count;
 } usbh_class_driver_t;
 
 // Invoked when initializing host stack to get additional class drivers.
@@ -67,9 +103,16 @@ usbh_class_driver_t const* usbh_app_driver_get_cb(uint8_t* driver_count) TU_ATTR
 // Call by class driver to tell USBH that it has complete the enumeration
 void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num);
 
+// Optionally called by class driver within its set_config sequence once it no longer uses control transfers (and
+// enumeration buffer): set_config() of the next interface is started without waiting for this one to complete.
+// itf_num is the same as for usbh_driver_set_config_complete(), which must still be called when done.
+void usbh_driver_set_config_release(uint8_t dev_addr, uint8_t itf_num);
+
 uint8_t usbh_get_rhport(uint8_t dev_addr);
 
-uint8_t* usbh_get_enum_buf(void);
+// Enumeration buffer of a device, devices enumerating in parallel each have their own. Only valid until the device
+// is configured (NULL otherwise), runtime requests need their own buffer
+uint8_t* usbh_get_enum_buf(uint8_t dev_addr);
 
 void usbh_int_set(bool enabled);
 
@@ -80,14 +123,21 @@ void usbh_defer_func(osal_task_func_t func, void *param, bool in_isr);
 //--------------------------------------------------------------------+
 
 // Submit a usb transfer with callback support, require CFG_TUH_API_EDPT_XFER
-bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes,
+// Transfer larger than 64 KiB requires CFG_TUH_LARGE_XFER
+bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes,
                                   tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 
 TU_ATTR_ALWAYS_INLINE
-static inline bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes) {
+static inline bool usbh_edpt_xfer(uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes) {
   return usbh_edpt_xfer_with_callback(dev_addr, ep_addr, buffer, total_bytes, NULL, 0);
 }
 
+#if CFG_TUH_EDPT_XFER_SG
+// Submit a scatter-gather transfer of count segments, completion is reported to class driver's xfer_cb() once with
+// the total length. Segment list and buffers must be kept until then, endpoint must be idle. See usbd_edpt_xfer_sg()
+bool usbh_edpt_xfer_sg(uint8_t dev_addr, uint8_t ep_addr, tu_iovec_t const* iov, uint8_t count);
+#endif
+
 // Claim an endpoint before submitting a transfer.
 // If caller does not make any transfer, it must release endpoint for others.
 bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr);
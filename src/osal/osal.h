@@ -69,6 +69,29 @@ typedef void (*osal_task_func_t)( void * );
   #error OS is not supported yet
 #endif
 
+// Spinlock API: critical section between task and ISR, may nest. Default for OS NONE and single core RTOS without
+// their own: disable USB interrupt from task, nothing to do in ISR since it can not be preempted by task
+#ifndef OSAL_SPINLOCK_DEF
+typedef struct {
+  void (* interrupt_set)(bool);
+} osal_spinlock_t;
+
+#define OSAL_SPINLOCK_DEF(_name, _int_set) \
+  osal_spinlock_t _name = { .interrupt_set = _int_set }
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_init(osal_spinlock_t* ctx) {
+  (void) ctx;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_lock(osal_spinlock_t* ctx, bool in_isr) {
+  if (!in_isr) ctx->interrupt_set(false);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_unlock(osal_spinlock_t* ctx, bool in_isr) {
+  if (!in_isr) ctx->interrupt_set(true);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // OSAL Porting API
 // Should be implemented as static inline function in osal_port.h header
@@ -84,6 +107,10 @@ typedef void (*osal_task_func_t)( void * );
    bool osal_mutex_lock (osal_mutex_t sem_hdl, uint32_t msec);
    bool osal_mutex_unlock(osal_mutex_t mutex_hdl);
 
+   void osal_spin_init(osal_spinlock_t* ctx);
+   void osal_spin_lock(osal_spinlock_t* ctx, bool in_isr); // may nest
+   void osal_spin_unlock(osal_spinlock_t* ctx, bool in_isr);
+
    osal_queue_t osal_queue_create(osal_queue_def_t* qdef);
    bool osal_queue_delete(osal_queue_t qhdl);
    bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec);
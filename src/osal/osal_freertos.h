@@ -54,6 +54,24 @@ typedef SemaphoreHandle_t osal_semaphore_t;
 typedef SemaphoreHandle_t osal_mutex_t;
 typedef QueueHandle_t osal_queue_t;
 
+#if defined(ESP_PLATFORM)
+  // ESP-IDF spinlock works across cores and may nest
+  typedef struct {
+    portMUX_TYPE mux;
+  } osal_spinlock_t;
+
+  #define OSAL_SPINLOCK_DEF(_name, _int_set) \
+    osal_spinlock_t _name = { .mux = portMUX_INITIALIZER_UNLOCKED }
+#else
+  // kernel critical section, ISR is assumed to run on the same core as callers
+  typedef struct {
+    uint8_t unused;
+  } osal_spinlock_t;
+
+  #define OSAL_SPINLOCK_DEF(_name, _int_set) \
+    osal_spinlock_t _name
+#endif
+
 typedef struct
 {
   uint16_t depth;
@@ -171,6 +189,48 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hd
   return xSemaphoreGive(mutex_hdl);
 }
 
+//--------------------------------------------------------------------+
+// Spinlock API
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_init(osal_spinlock_t* ctx) {
+#if defined(ESP_PLATFORM)
+  portMUX_INITIALIZE(&ctx->mux);
+#else
+  (void) ctx;
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_lock(osal_spinlock_t* ctx, bool in_isr) {
+#if defined(ESP_PLATFORM)
+  if (in_isr) {
+    portENTER_CRITICAL_ISR(&ctx->mux);
+  } else {
+    portENTER_CRITICAL(&ctx->mux);
+  }
+#else
+  (void) ctx;
+  // ISR can not be preempted by task: only task needs to mask it
+  if (!in_isr) {
+    taskENTER_CRITICAL();
+  }
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_unlock(osal_spinlock_t* ctx, bool in_isr) {
+#if defined(ESP_PLATFORM)
+  if (in_isr) {
+    portEXIT_CRITICAL_ISR(&ctx->mux);
+  } else {
+    portEXIT_CRITICAL(&ctx->mux);
+  }
+#else
+  (void) ctx;
+  if (!in_isr) {
+    taskEXIT_CRITICAL();
+  }
+#endif
+}
+
 //--------------------------------------------------------------------+
 // QUEUE API
 //--------------------------------------------------------------------+
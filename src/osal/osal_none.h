@@ -124,6 +124,8 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hd
 
 typedef struct {
   void (* interrupt_set)(bool);
+  bool (* ff_write)(tu_fifo_t* f, void const* item); // tu_fifo_write()/tu_fifo_read() specialized for queue item type
+  bool (* ff_read)(tu_fifo_t* f, void* item);
   tu_fifo_t ff;
 } osal_queue_def_t;
 
@@ -131,9 +133,12 @@ typedef osal_queue_def_t* osal_queue_t;
 
 // _int_set is used as mutex in OS NONE (disable/enable USB ISR)
 #define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type)    \
+  TU_FIFO_TYPED_FUNC(_name##_ff, _depth, _type)           \
   uint8_t _name##_buf[_depth*sizeof(_type)];              \
   osal_queue_def_t _name = {                              \
     .interrupt_set = _int_set,                            \
+    .ff_write = _name##_ff_write,                         \
+    .ff_read = _name##_ff_read,                           \
     .ff = TU_FIFO_INIT(_name##_buf, _depth, _type, false) \
   }
 
@@ -159,22 +164,30 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_delete(osal_queue_t qhdl) {
   return true; // nothing to do
 }
 
+// Queue has a single consumer (task) and its producers are serialized: ISR, or task with the ISR disabled.
+// With memory barrier available, reading is safe against a concurrent write and receive never
+// disables the USB interrupt.
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
   (void) msec; // not used, always behave as msec = 0
 
+#ifdef TU_MEMORY_BARRIER
+  return qhdl->ff_read(&qhdl->ff, data);
+#else
   _osal_q_lock(qhdl);
-  bool success = tu_fifo_read(&qhdl->ff, data);
+  bool success = qhdl->ff_read(&qhdl->ff, data);
   _osal_q_unlock(qhdl);
 
   return success;
+#endif
 }
 
 TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const* data, bool in_isr) {
+  // sending from task races with ISR as the other producer
   if (!in_isr) {
     _osal_q_lock(qhdl);
   }
 
-  bool success = tu_fifo_write(&qhdl->ff, data);
+  bool success = qhdl->ff_write(&qhdl->ff, data);
 
   if (!in_isr) {
     _osal_q_unlock(qhdl);
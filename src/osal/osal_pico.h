@@ -31,6 +31,7 @@
 #include "pico/sem.h"
 #include "pico/mutex.h"
 #include "pico/critical_section.h"
+#include "hardware/sync.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +44,57 @@ TU_ATTR_ALWAYS_INLINE static inline void osal_task_delay(uint32_t msec) {
   sleep_ms(msec);
 }
 
+//--------------------------------------------------------------------+
+// Spinlock API
+// Critical section between task and ISR which may run on the other core: hardware spin lock with local
+// interrupts disabled. May nest on the same core.
+//--------------------------------------------------------------------+
+typedef struct {
+  spin_lock_t* lock;
+  volatile uint8_t owner; // core holding the lock, 0xff if free
+  uint8_t depth;
+  uint32_t irq_save;
+} osal_spinlock_t;
+
+// _int_set is not used, lock works across cores
+#define OSAL_SPINLOCK_DEF(_name, _int_set) \
+  osal_spinlock_t _name = { .lock = NULL, .owner = 0xff }
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_init(osal_spinlock_t* ctx) {
+  // own lock rather than a striped one, which may be taken by a critical_section nested inside
+  if (ctx->lock == NULL) {
+    ctx->lock = spin_lock_instance((uint) spin_lock_claim_unused(true));
+  }
+  ctx->owner = 0xff;
+  ctx->depth = 0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_lock(osal_spinlock_t* ctx, bool in_isr) {
+  (void) in_isr;
+  uint32_t const save = save_and_disable_interrupts();
+  uint8_t const core = (uint8_t) get_core_num();
+
+  // only this core can set owner to its own number
+  if (ctx->owner == core) {
+    ctx->depth++;
+    restore_interrupts(save); // still disabled by outer lock
+    return;
+  }
+
+  spin_lock_unsafe_blocking(ctx->lock);
+  ctx->owner = core;
+  ctx->depth = 1;
+  ctx->irq_save = save;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_unlock(osal_spinlock_t* ctx, bool in_isr) {
+  (void) in_isr;
+  if (--ctx->depth) return;
+
+  ctx->owner = 0xff;
+  spin_unlock(ctx->lock, ctx->irq_save);
+}
+
 //--------------------------------------------------------------------+
 // Binary Semaphore API
 //--------------------------------------------------------------------+
@@ -105,15 +157,20 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hd
 typedef struct {
   tu_fifo_t ff;
   struct critical_section critsec; // osal_queue may be used in IRQs, so need critical section
+  bool (* ff_write)(tu_fifo_t* f, void const* item); // tu_fifo_write()/tu_fifo_read() specialized for queue item type
+  bool (* ff_read)(tu_fifo_t* f, void* item);
 } osal_queue_def_t;
 
 typedef osal_queue_def_t* osal_queue_t;
 
 // role device/host is used by OS NONE for mutex (disable usb isr) only
-#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type)    \
-  uint8_t _name##_buf[_depth*sizeof(_type)];              \
-  osal_queue_def_t _name = {                              \
-    .ff = TU_FIFO_INIT(_name##_buf, _depth, _type, false) \
+#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type)     \
+  TU_FIFO_TYPED_FUNC(_name##_ff, _depth, _type)            \
+  uint8_t _name##_buf[_depth*sizeof(_type)];               \
+  osal_queue_def_t _name = {                               \
+    .ff = TU_FIFO_INIT(_name##_buf, _depth, _type, false), \
+    .ff_write = _name##_ff_write,                          \
+    .ff_read = _name##_ff_read,                            \
   }
 
 TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef) {
@@ -132,7 +189,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, v
   (void) msec; // not used, always behave as msec = 0
 
   critical_section_enter_blocking(&qhdl->critsec);
-  bool success = tu_fifo_read(&qhdl->ff, data);
+  bool success = qhdl->ff_read(&qhdl->ff, data);
   critical_section_exit(&qhdl->critsec);
 
   return success;
@@ -142,7 +199,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void
   (void) in_isr;
 
   critical_section_enter_blocking(&qhdl->critsec);
-  bool success = tu_fifo_write(&qhdl->ff, data);
+  bool success = qhdl->ff_write(&qhdl->ff, data);
   critical_section_exit(&qhdl->critsec);
 
   return success;
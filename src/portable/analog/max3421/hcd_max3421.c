@@ -168,7 +168,12 @@ enum {
 };
 
 enum {
-  MAX_NAK_DEFAULT = 1 // Number of NAK per endpoint per usb frame
+  MAX_NAK_DEFAULT = 1, // Number of NAK per endpoint per usb frame
+  NAK_BACKOFF_MAX_DEFAULT = 4 // Max frames to skip a bulk endpoint that keeps NAKing
+};
+
+enum {
+  FIFO_SIZE = 64 // SNDFIFO, RCVFIFO buffer size
 };
 
 enum {
@@ -204,10 +209,15 @@ typedef struct {
 
   uint16_t total_len;
   uint16_t xferred_len;
+
+  uint8_t interval;    // polling interval in frames for interrupt endpoint, 0 for others
+  uint8_t nak_backoff; // number of consecutive frames the endpoint was NAKed out
+  uint16_t next_frame; // endpoint is not scheduled before this frame
+
   uint8_t* buf;
 } max3421_ep_t;
 
-TU_VERIFY_STATIC(sizeof(max3421_ep_t) == 12, "size is not correct");
+TU_VERIFY_STATIC(sizeof(max3421_ep_t) == 16, "size is not correct");
 
 typedef struct {
   volatile uint16_t frame_count;
@@ -222,6 +232,9 @@ typedef struct {
 
   atomic_flag busy; // busy transferring
 
+  // command byte + fifo data are sent in one spi transfer, only used while spi is locked
+  uint8_t spi_buf[1 + FIFO_SIZE];
+
 #if OSAL_MUTEX_REQUIRED
   OSAL_MUTEX_DEF(spi_mutexdef);
   osal_mutex_t spi_mutex;
@@ -237,6 +250,7 @@ static tuh_configure_max3421_t _tuh_cfg = {
     .max_nak = MAX_NAK_DEFAULT,
     .cpuctl = 0, // default: INT pulse width = 10.6 us
     .pinctl = 0, // default: negative edge interrupt
+    .nak_backoff_max = NAK_BACKOFF_MAX_DEFAULT,
 };
 
 //--------------------------------------------------------------------+
@@ -316,28 +330,33 @@ bool tuh_max3421_reg_write(uint8_t rhport, uint8_t reg, uint8_t data, bool in_is
   return ret;
 }
 
+// Command byte and data are coalesced into a single spi_xfer_api() call so that a packet is one contiguous
+// (DMA friendly) transfer instead of two back-to-back ones
 static void fifo_write(uint8_t rhport, uint8_t reg, uint8_t const * buffer, uint16_t len, bool in_isr) {
-  uint8_t hirq;
-  reg |= CMDBYTE_WRITE;
+  uint8_t* spi_buf = _hcd_data.spi_buf;
+  TU_ASSERT(len <= FIFO_SIZE,);
 
   max3421_spi_lock(rhport, in_isr);
 
-  tuh_max3421_spi_xfer_api(rhport, &reg, &hirq, 1);
-  _hcd_data.hirq = hirq;
-  tuh_max3421_spi_xfer_api(rhport, buffer, NULL, len);
+  spi_buf[0] = reg | CMDBYTE_WRITE;
+  memcpy(spi_buf + 1, buffer, len);
+  tuh_max3421_spi_xfer_api(rhport, spi_buf, spi_buf, 1u + len);
+  _hcd_data.hirq = spi_buf[0];
 
   max3421_spi_unlock(rhport, in_isr);
 }
 
 static void fifo_read(uint8_t rhport, uint8_t * buffer, uint16_t len, bool in_isr) {
-  uint8_t hirq;
-  uint8_t const reg = RCVVFIFO_ADDR;
+  uint8_t* spi_buf = _hcd_data.spi_buf;
+  TU_ASSERT(len <= FIFO_SIZE,);
 
   max3421_spi_lock(rhport, in_isr);
 
-  tuh_max3421_spi_xfer_api(rhport, &reg, &hirq, 1);
-  _hcd_data.hirq = hirq;
-  tuh_max3421_spi_xfer_api(rhport, NULL, buffer, len);
+  // tx data after command byte is don't care
+  spi_buf[0] = RCVVFIFO_ADDR;
+  tuh_max3421_spi_xfer_api(rhport, spi_buf, spi_buf, 1u + len);
+  _hcd_data.hirq = spi_buf[0];
+  memcpy(buffer, spi_buf + 1, len);
 
   max3421_spi_unlock(rhport, in_isr);
 }
@@ -416,16 +435,34 @@ static void free_ep(uint8_t daddr) {
   }
 }
 
-// Check if endpoint has an queued transfer and not reach max NAK
+// Check if endpoint is allowed to be scheduled in current frame
+TU_ATTR_ALWAYS_INLINE static inline bool is_ep_due(max3421_ep_t const * ep) {
+  return (int16_t) (_hcd_data.frame_count - ep->next_frame) >= 0;
+}
+
+// Check if endpoint has an queued transfer, is due and not reach max NAK
 TU_ATTR_ALWAYS_INLINE static inline bool is_ep_pending(max3421_ep_t const * ep) {
   uint8_t const state = ep->state;
   return ep->packet_size && (state >= EP_STATE_ATTEMPT_1) &&
-         (_tuh_cfg.max_nak == 0 || state < EP_STATE_ATTEMPT_1 + _tuh_cfg.max_nak);
+         (_tuh_cfg.max_nak == 0 || state < EP_STATE_ATTEMPT_1 + _tuh_cfg.max_nak) && is_ep_due(ep);
+}
+
+// Endpoint is NAKed: interrupt endpoint waits for its next interval, bulk endpoint backs off exponentially once it
+// has used up all its NAKs of a frame for consecutive frames
+static void ep_nak_schedule(max3421_ep_t * ep) {
+  if (ep->interval) {
+    ep->next_frame = (uint16_t) (_hcd_data.frame_count + ep->interval);
+  } else if (_tuh_cfg.max_nak && ep->state >= EP_STATE_ATTEMPT_1 + _tuh_cfg.max_nak) {
+    uint8_t const delay = (uint8_t) tu_min8(_tuh_cfg.nak_backoff_max, (uint8_t) ((1u << ep->nak_backoff) - 1));
+    ep->next_frame = (uint16_t) (_hcd_data.frame_count + 1 + delay);
+    if (delay < _tuh_cfg.nak_backoff_max) {
+      ep->nak_backoff++;
+    }
+  }
 }
 
 // Find the next pending endpoint using round-robin scheduling, starting from next endpoint.
 // return NULL if not found
-// TODO respect interrupt endpoint's interval
 static max3421_ep_t * find_next_pending_ep(max3421_ep_t * cur_ep) {
   size_t const idx = (size_t) (cur_ep - _hcd_data.ep);
 
@@ -610,6 +647,11 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const * e
 
   ep->packet_size = (uint16_t) (tu_edpt_packet_size(ep_desc) & 0x7ff);
 
+  // MAX3421 is full/low speed only, interrupt bInterval is in frames
+  ep->interval = (TUSB_XFER_INTERRUPT == ep_desc->bmAttributes.xfer) ? tu_max8(ep_desc->bInterval, 1) : 0;
+  ep->nak_backoff = 0;
+  ep->next_frame = _hcd_data.frame_count;
+
   return true;
 }
 
@@ -692,10 +734,17 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buf
   ep->buf = buffer;
   ep->total_len = buflen;
   ep->xferred_len = 0;
+
+  // frame counter may have wrapped around since endpoint was last scheduled
+  uint16_t const max_wait = tu_max16(ep->interval, _tuh_cfg.nak_backoff_max) + 1u;
+  if ((int16_t) (ep->next_frame - _hcd_data.frame_count) > (int16_t) max_wait) {
+    ep->next_frame = _hcd_data.frame_count;
+  }
+
   ep->state = EP_STATE_ATTEMPT_1;
 
-  // carry out transfer if not busy
-  if (!atomic_flag_test_and_set(&_hcd_data.busy)) {
+  // carry out transfer if not busy, otherwise it is picked up when due by the frame or completion handler
+  if (is_ep_due(ep) && !atomic_flag_test_and_set(&_hcd_data.busy)) {
     xact_generic(rhport, ep, true, false);
   }
 
@@ -804,6 +853,9 @@ static void xfer_complete_isr(uint8_t rhport, max3421_ep_t *ep, xfer_result_t re
   }
 
   ep->state = EP_STATE_IDLE;
+  if (ep->interval) {
+    ep->next_frame = (uint16_t) (_hcd_data.frame_count + ep->interval);
+  }
   hcd_event_xfer_complete(ep->daddr, ep_addr, ep->xferred_len, result, in_isr);
 
   // Find next pending endpoint
@@ -845,6 +897,7 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
         if (ep->state < EP_STATE_ATTEMPT_MAX) {
           ep->state++;
         }
+        ep_nak_schedule(ep);
 
         max3421_ep_t * next_ep = find_next_pending_ep(ep);
         if (ep == next_ep) {
@@ -875,6 +928,9 @@ static void handle_xfer_done(uint8_t rhport, bool in_isr) {
     return;
   }
 
+  // endpoint has data, stop backing off
+  ep->nak_backoff = 0;
+
   if (ep_dir) {
     // IN transfer: fifo data is already received in RCVDAV IRQ
 
@@ -942,23 +998,22 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   if (hirq & HIRQ_FRAME_IRQ) {
     _hcd_data.frame_count++;
 
-    max3421_ep_t* ep_retry = NULL;
-
     // reset all endpoints attempt counter
     for (size_t i = 0; i < CFG_TUH_MAX3421_ENDPOINT_TOTAL; i++) {
       max3421_ep_t* ep = &_hcd_data.ep[i];
       if (ep->packet_size && ep->state > EP_STATE_ATTEMPT_1) {
         ep->state = EP_STATE_ATTEMPT_1;
-
-        if (ep_retry == NULL) {
-          ep_retry = ep;
-        }
       }
     }
 
-    // start usb transfer if not busy
-    if (ep_retry != NULL && !atomic_flag_test_and_set(&_hcd_data.busy)) {
-      xact_generic(rhport, ep_retry, true, in_isr);
+    // start usb transfer of endpoint that is due in this frame if not busy
+    if (!atomic_flag_test_and_set(&_hcd_data.busy)) {
+      max3421_ep_t* ep_retry = find_next_pending_ep(&_hcd_data.ep[CFG_TUH_MAX3421_ENDPOINT_TOTAL - 1]);
+      if (ep_retry != NULL) {
+        xact_generic(rhport, ep_retry, true, in_isr);
+      } else {
+        atomic_flag_clear(&_hcd_data.busy);
+      }
     }
   }
 
@@ -126,7 +126,8 @@ typedef struct
   // Therefore there are 4 bytes padding that we can use.
   //--------------------------------------------------------------------+
   uint16_t expected_bytes;
-  uint8_t reserved[2];
+  uint8_t xfer_end; // last dTD of a transfer
+  uint8_t reserved[1];
 } dcd_qtd_t;
 
 TU_VERIFY_STATIC( sizeof(dcd_qtd_t) == 32, "size is not correct");
@@ -156,7 +157,9 @@ typedef struct
   // Therefore there are 16 bytes padding that we can use.
   //--------------------------------------------------------------------+
   tu_fifo_t * ff;
-  uint8_t reserved[12];
+  volatile uint8_t qtd_rd; // oldest dTD not retired yet, ring index in range 0 .. 2*QTD_PER_EDPT-1
+  volatile uint8_t qtd_wr; // next free dTD
+  uint8_t reserved[10];
 } dcd_qhd_t;
 
 TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
@@ -167,12 +170,19 @@ TU_VERIFY_STATIC( sizeof(dcd_qhd_t) == 64, "size is not correct");
 
 #define QTD_NEXT_INVALID 0x01
 
+// A dTD covers 5 pages i.e at least 16 KiB, a transfer of up to 64 KiB takes at most 5 dTDs
+#define QTD_PER_XFER   5
+
+// dTDs of an endpoint form a ring, holding up to DCD_EDPT_XFER_DEPTH chained transfers
+#define QTD_PER_EDPT   (QTD_PER_XFER * DCD_EDPT_XFER_DEPTH)
+
+TU_VERIFY_STATIC(2*QTD_PER_EDPT <= UINT8_MAX, "too many dTDs per endpoint");
+
 typedef struct {
   // Must be at 2K alignment
   // Each endpoint with direction (IN/OUT) occupies a queue head
-  // for portability, TinyUSB only queue 1 TD for each Qhd
   dcd_qhd_t qhd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(64);
-  dcd_qtd_t qtd[TUP_DCD_ENDPOINT_MAX][2] TU_ATTR_ALIGNED(32);
+  dcd_qtd_t qtd[TUP_DCD_ENDPOINT_MAX][2][QTD_PER_EDPT] TU_ATTR_ALIGNED(32);
 }dcd_data_t;
 
 CFG_TUD_MEM_SECTION TU_ATTR_ALIGNED(2048)
@@ -188,6 +198,33 @@ static inline uint8_t ci_ep_count(ci_hs_regs_t const* dcd_reg)
   return dcd_reg->DCCPARAMS & DCCPARAMS_DEN_MASK;
 }
 
+// dTD ring indices run over twice the ring size to tell full from empty, same as tu_fifo
+TU_ATTR_ALWAYS_INLINE
+static inline uint8_t qtd_ring_advance(uint8_t idx, uint8_t n)
+{
+  return (uint8_t) ((idx + n) % (2*QTD_PER_EDPT));
+}
+
+TU_ATTR_ALWAYS_INLINE
+static inline uint8_t qtd_ring_count(dcd_qhd_t const* p_qhd)
+{
+  return (uint8_t) ((p_qhd->qtd_wr + 2*QTD_PER_EDPT - p_qhd->qtd_rd) % (2*QTD_PER_EDPT));
+}
+
+TU_ATTR_ALWAYS_INLINE
+static inline dcd_qtd_t* qtd_ring_get(uint8_t epnum, uint8_t dir, uint8_t idx)
+{
+  return &_dcd_data.qtd[epnum][dir][idx % QTD_PER_EDPT];
+}
+
+// Drop all dTDs of endpoint, must be called after endpoint is flushed
+TU_ATTR_ALWAYS_INLINE
+static inline void qtd_ring_clear(uint8_t epnum, uint8_t dir)
+{
+  dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
+  p_qhd->qtd_rd = p_qhd->qtd_wr;
+}
+
 //--------------------------------------------------------------------+
 // Controller API
 //--------------------------------------------------------------------+
@@ -319,18 +356,20 @@ void dcd_sof_enable(uint8_t rhport, bool en)
 // HELPER
 //--------------------------------------------------------------------+
 
-static void qtd_init(dcd_qtd_t* p_qtd, void * data_ptr, uint16_t total_bytes)
+// Force the CPU to flush the buffer. We increase the size by 31 because the call aligns the
+// address to 32-byte boundaries. Buffer must be word aligned
+TU_ATTR_ALWAYS_INLINE static inline void buffer_dcache_flush(void const* data_ptr, uint32_t total_bytes)
 {
-  // Force the CPU to flush the buffer. We increase the size by 31 because the call aligns the
-  // address to 32-byte boundaries. Buffer must be word aligned
   dcd_dcache_clean_invalidate((uint32_t*) tu_align((uint32_t) data_ptr, 4), total_bytes + 31);
+}
 
+TU_ATTR_FAST_FUNC static void qtd_init(dcd_qtd_t* p_qtd, void * data_ptr, uint16_t total_bytes)
+{
   tu_memclr(p_qtd, sizeof(dcd_qtd_t));
 
   p_qtd->next            = QTD_NEXT_INVALID;
   p_qtd->active          = 1;
   p_qtd->total_bytes     = p_qtd->expected_bytes = total_bytes;
-  p_qtd->int_on_complete = true;
 
   if (data_ptr != NULL)
   {
@@ -361,7 +400,10 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   dcd_reg->ENDPTCTRL[epnum] |= ENDPTCTRL_STALL << (dir ? 16 : 0);
 
   // flush to abort any primed buffer
-  dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
+  uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
+  dcd_reg->ENDPTFLUSH = flush_mask;
+  while(dcd_reg->ENDPTFLUSH & flush_mask) {}
+  qtd_ring_clear(epnum, dir);
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
@@ -393,7 +435,8 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
   p_qhd->max_packet_size         = tu_edpt_packet_size(p_endpoint_desc);
   if (p_endpoint_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS)
   {
-    p_qhd->iso_mult = 1;
+    // 1 to 3 transactions per micro-frame for high-bandwidth endpoint
+    p_qhd->iso_mult = tu_edpt_packet_mult(p_endpoint_desc);
   }
 
   p_qhd->qtd_overlay.next        = QTD_NEXT_INVALID;
@@ -427,6 +470,9 @@ void dcd_edpt_close_all (uint8_t rhport)
 
     dcd_reg->ENDPTFLUSH = TU_BIT(epnum) |  TU_BIT(epnum+16);
     dcd_reg->ENDPTCTRL[epnum] = (TUSB_XFER_BULK << ENDPTCTRL_TYPE_POS) | (TUSB_XFER_BULK << (16+ENDPTCTRL_TYPE_POS));
+
+    qtd_ring_clear(epnum, TUSB_DIR_OUT);
+    qtd_ring_clear(epnum, TUSB_DIR_IN);
   }
 }
 
@@ -443,23 +489,53 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
   dcd_reg->ENDPTFLUSH = flush_mask;
   while(dcd_reg->ENDPTFLUSH & flush_mask);
+  qtd_ring_clear(epnum, dir);
 
   // Clear EP enable
   dcd_reg->ENDPTCTRL[epnum] &=~(ENDPTCTRL_ENABLE << (dir ? 16 : 0));
 }
 
-static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
+// Append prepared dTDs (starting at ring write index) to endpoint and start them
+TU_ATTR_FAST_FUNC static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir, uint8_t qtd_count)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
   dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
+  dcd_qtd_t* p_qtd = qtd_ring_get(epnum, dir, p_qhd->qtd_wr);
+  uint32_t const edpt_mask = TU_BIT(epnum + (dir ? 16 : 0));
 
-  p_qhd->qtd_overlay.halted = false;            // clear any previous error
-  p_qhd->qtd_overlay.next   = (uint32_t) p_qtd; // link qtd to qhd
+  // dTDs of previous transfers are still in the list, link behind the last one
+  bool const chained = (qtd_ring_count(p_qhd) > 0);
+  if ( chained )
+  {
+    dcd_qtd_t* p_last = qtd_ring_get(epnum, dir, qtd_ring_advance(p_qhd->qtd_wr, 2*QTD_PER_EDPT - 1));
+    p_last->next = (uint32_t) p_qtd;
+  }
+  p_qhd->qtd_wr = qtd_ring_advance(p_qhd->qtd_wr, qtd_count);
 
   // flush cache
   dcd_dcache_clean_invalidate(&_dcd_data, sizeof(dcd_data_t));
 
+  if ( chained )
+  {
+    // follows UM 23.10.11.3 Executing a transfer descriptor, case 2 (linked list is not empty):
+    // controller picks up the new dTDs by itself unless it already reached the end of list before they are linked
+    if ( dcd_reg->ENDPTPRIME & edpt_mask ) return;
+
+    uint32_t edpt_status;
+    do
+    {
+      dcd_reg->USBCMD |= USBCMD_ADD_QTD_TRIPWIRE;
+      edpt_status = dcd_reg->ENDPTSTAT & edpt_mask;
+    } while ( !(dcd_reg->USBCMD & USBCMD_ADD_QTD_TRIPWIRE) );
+    dcd_reg->USBCMD &= ~USBCMD_ADD_QTD_TRIPWIRE;
+
+    if ( edpt_status ) return;
+  }
+
+  p_qhd->qtd_overlay.halted = false;            // clear any previous error
+  p_qhd->qtd_overlay.next   = (uint32_t) p_qtd; // link qtd to qhd
+  dcd_dcache_clean_invalidate(p_qhd, sizeof(dcd_qhd_t));
+
   if ( epnum == 0 )
   {
     // follows UM 24.10.8.1.1 Setup packet handling using setup lockout mechanism
@@ -468,35 +544,88 @@ static void qhd_start_xfer(uint8_t rhport, uint8_t epnum, uint8_t dir)
   }
 
   // start transfer
-  dcd_reg->ENDPTPRIME = TU_BIT(epnum + (dir ? 16 : 0));
+  dcd_reg->ENDPTPRIME = edpt_mask;
 }
 
-bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_qhd_t* p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t* p_qtd = &_dcd_data.qtd[epnum][dir];
+  uint16_t const mps = p_qhd->max_packet_size;
+
+  // Control transfers are never chained: a new setup packet supersedes any primed data/status stage
+  if ( epnum == 0 ) qtd_ring_clear(0, dir);
+
+  // Prepare chain of dTDs, each covers up to 5 pages. Only the last one may end with a short packet,
+  // completion interrupt is raised on the last one only.
+  // A short packet does not stop the controller from advancing to the next dTD, therefore an OUT transfer is
+  // limited to a single dTD (at least 16 KiB) so that a short packet always ends the transfer.
+  #if !CFG_TUD_MEM_DCACHE_ENABLE
+  // done once per transfer by usbd when CFG_TUD_MEM_DCACHE_ENABLE
+  if ( buffer != NULL ) buffer_dcache_flush(buffer, total_bytes);
+  #endif
+
+  uint8_t const qtd_free = QTD_PER_EDPT - qtd_ring_count(p_qhd);
+  uint8_t idx = p_qhd->qtd_wr;
+  uint8_t qtd_count = 0;
+  dcd_qtd_t* p_prev = NULL;
+
+  do
+  {
+    TU_ASSERT(qtd_count < qtd_free);
+
+    dcd_qtd_t* p_qtd = qtd_ring_get(epnum, dir, idx);
+    uint16_t len = total_bytes;
+
+    if ( buffer != NULL )
+    {
+      uint32_t const page_max = tu_align4k((uint32_t) buffer) + 5*4096 - (uint32_t) buffer;
+      if ( len > page_max )
+      {
+        TU_ASSERT(dir == TUSB_DIR_IN);
+        len = (uint16_t) (page_max - (page_max % mps));
+      }
+    }
 
-  // Prepare qtd
-  qtd_init(p_qtd, buffer, total_bytes);
+    qtd_init(p_qtd, buffer, len);
+
+    // High-bandwidth ISO IN: only send as many transactions as needed for this data so that PID sequence matches
+    if ( dir && p_qhd->iso_mult > 1 )
+    {
+      uint16_t const n_xact = (uint16_t) tu_div_ceil(len, mps);
+      p_qtd->iso_mult_override = (n_xact == 0) ? 1 : tu_min16(n_xact, p_qhd->iso_mult);
+    }
+
+    if ( p_prev ) p_prev->next = (uint32_t) p_qtd;
+    p_prev = p_qtd;
+
+    if ( buffer != NULL ) buffer += len;
+    total_bytes -= len;
+    idx = qtd_ring_advance(idx, 1);
+    qtd_count++;
+  } while ( total_bytes );
+
+  p_prev->int_on_complete = 1;
+  p_prev->xfer_end        = 1;
 
   // Start qhd transfer
   p_qhd->ff = NULL;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_start_xfer(rhport, epnum, dir, qtd_count);
 
   return true;
 }
 
 // fifo has to be aligned to 4k boundary
-bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
+  TU_ASSERT(qtd_ring_count(p_qhd) < QTD_PER_EDPT);
+  dcd_qtd_t * p_qtd = qtd_ring_get(epnum, dir, p_qhd->qtd_wr);
 
   tu_fifo_buffer_info_t fifo_info;
 
@@ -511,6 +640,7 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   if ( fifo_info.len_lin >= total_bytes )
   {
     // Linear length is enough for this transfer
+    buffer_dcache_flush(fifo_info.ptr_lin, total_bytes);
     qtd_init(p_qtd, fifo_info.ptr_lin, total_bytes);
   }
   else
@@ -518,6 +648,7 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
     // linear part is not enough
 
     // prepare TD up to linear length
+    buffer_dcache_flush(fifo_info.ptr_lin, fifo_info.len_lin);
     qtd_init(p_qtd, fifo_info.ptr_lin, fifo_info.len_lin);
 
     if ( !tu_offset4k((uint32_t) fifo_info.ptr_wrap) && !tu_offset4k(tu_fifo_depth(ff)) )
@@ -536,7 +667,7 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
         }
       }
 
-      dcd_dcache_clean_invalidate((uint32_t*) tu_align((uint32_t) fifo_info.ptr_wrap, 4), total_bytes - fifo_info.len_wrap + 31);
+      buffer_dcache_flush(fifo_info.ptr_wrap, total_bytes - fifo_info.len_wrap);
     }
     else
     {
@@ -545,9 +676,19 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
     }
   }
 
+  // High-bandwidth ISO IN: only send as many transactions as needed for this data so that PID sequence matches
+  if ( dir && p_qhd->iso_mult > 1 )
+  {
+    uint16_t const n_xact = (uint16_t) tu_div_ceil(p_qtd->total_bytes, p_qhd->max_packet_size);
+    p_qtd->iso_mult_override = (n_xact == 0) ? 1 : tu_min16(n_xact, p_qhd->iso_mult);
+  }
+
+  p_qtd->int_on_complete = 1;
+  p_qtd->xfer_end        = 1;
+
   // Start qhd transfer
   p_qhd->ff = ff;
-  qhd_start_xfer(rhport, epnum, dir);
+  qhd_start_xfer(rhport, epnum, dir, 1);
 
   return true;
 }
@@ -556,39 +697,90 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
 // ISR
 //--------------------------------------------------------------------+
 
-static void process_edpt_complete_isr(uint8_t rhport, uint8_t epnum, uint8_t dir)
+// Retire completed transfers of endpoint in submission order
+TU_ATTR_FAST_FUNC static void process_edpt_complete_isr(uint8_t rhport, uint8_t epnum, uint8_t dir)
 {
   dcd_qhd_t * p_qhd = &_dcd_data.qhd[epnum][dir];
-  dcd_qtd_t * p_qtd = &_dcd_data.qtd[epnum][dir];
-
-  uint8_t result = p_qtd->halted ? XFER_RESULT_STALLED :
-      ( p_qtd->xact_err || p_qtd->buffer_err ) ? XFER_RESULT_FAILED : XFER_RESULT_SUCCESS;
 
-  if ( result != XFER_RESULT_SUCCESS )
+  while ( qtd_ring_count(p_qhd) )
   {
-    ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
-    // flush to abort error buffer
-    dcd_reg->ENDPTFLUSH = TU_BIT(epnum + (dir ? 16 : 0));
-  }
+    // Transfer is complete when its last dTD is retired or any of its dTD failed
+    uint8_t idx = p_qhd->qtd_rd;
+    uint32_t xferred_bytes = 0;
+    uint8_t result = XFER_RESULT_SUCCESS;
+    bool complete = false;
+
+    while ( idx != p_qhd->qtd_wr )
+    {
+      dcd_qtd_t * p_qtd = qtd_ring_get(epnum, dir, idx);
+      if ( p_qtd->active ) break;
 
-  uint16_t const xferred_bytes = p_qtd->expected_bytes - p_qtd->total_bytes;
+      idx = qtd_ring_advance(idx, 1);
+      xferred_bytes += p_qtd->expected_bytes - p_qtd->total_bytes;
 
-  if (p_qhd->ff)
-  {
-    if (dir == TUSB_DIR_IN)
+      if ( p_qtd->halted || p_qtd->xact_err || p_qtd->buffer_err )
+      {
+        result = p_qtd->halted ? XFER_RESULT_STALLED : XFER_RESULT_FAILED;
+        complete = true;
+        break;
+      }
+
+      if ( p_qtd->xfer_end )
+      {
+        complete = true;
+        break;
+      }
+    }
+
+    if ( !complete ) break;
+
+    // number of chained transfers behind a failed one, they are aborted as well
+    uint8_t aborted_count = 0;
+
+    if ( result != XFER_RESULT_SUCCESS )
     {
-      tu_fifo_advance_read_pointer(p_qhd->ff, xferred_bytes);
-    } else
+      ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
+      // flush to abort error buffer
+      uint32_t const flush_mask = TU_BIT(epnum + (dir ? 16 : 0));
+      dcd_reg->ENDPTFLUSH = flush_mask;
+      while(dcd_reg->ENDPTFLUSH & flush_mask) {}
+
+      // skip remaining dTDs of this transfer, then count transfers after it
+      bool in_xfer = !qtd_ring_get(epnum, dir, qtd_ring_advance(idx, 2*QTD_PER_EDPT - 1))->xfer_end;
+      for ( ; idx != p_qhd->qtd_wr; idx = qtd_ring_advance(idx, 1) )
+      {
+        if ( qtd_ring_get(epnum, dir, idx)->xfer_end )
+        {
+          if ( !in_xfer ) aborted_count++;
+          in_xfer = false;
+        }
+      }
+    }
+
+    // release dTDs before notifying stack, which may submit next transfer right away
+    p_qhd->qtd_rd = idx;
+
+    if (p_qhd->ff)
+    {
+      if (dir == TUSB_DIR_IN)
+      {
+        tu_fifo_advance_read_pointer(p_qhd->ff, (uint16_t) xferred_bytes);
+      } else
+      {
+        tu_fifo_advance_write_pointer(p_qhd->ff, (uint16_t) xferred_bytes);
+      }
+    }
+
+    dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, result, true);
+
+    while ( aborted_count-- )
     {
-      tu_fifo_advance_write_pointer(p_qhd->ff, xferred_bytes);
+      dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), 0, XFER_RESULT_FAILED, true);
     }
   }
-
-  // only number of bytes in the IOC qtd
-  dcd_event_xfer_complete(rhport, tu_edpt_addr(epnum, dir), xferred_bytes, result, true);
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
   ci_hs_regs_t* dcd_reg = CI_HS_REG(rhport);
 
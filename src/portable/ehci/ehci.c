@@ -34,6 +34,7 @@
 #include "osal/osal.h"
 
 #include "host/hcd.h"
+#include "host/usbh.h"
 #include "ehci_api.h"
 #include "ehci.h"
 
@@ -60,7 +61,80 @@
 
 // Total queue head pool. TODO should be user configurable and more optimize memory usage in the future
 #define QHD_MAX      (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX + CFG_TUH_HUB)
-#define QTD_MAX      QHD_MAX
+#define QTD_MAX      (QHD_MAX * CFG_TUH_EHCI_QTD_PER_XFER)
+
+// Each pool QHD has dedicated pool QTDs since a QHD only has one attached transfer at a time
+TU_VERIFY_STATIC(CFG_TUH_EHCI_QTD_PER_XFER >= 1 && CFG_TUH_EHCI_QTD_PER_XFER <= 4, "1 to 4 QTDs per transfer");
+
+// device addresses including dev0, each has its own control QHD/QTD
+#define QHD_CONTROL_MAX   (CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1)
+
+#define BITMAP_WORDS(_bits)   (((_bits) + 31u) / 32u)
+
+// index + 1 of pool QHD, 0 means none
+#if QHD_MAX < UINT8_MAX
+typedef uint8_t qhd_idx_t;
+#else
+typedef uint16_t qhd_idx_t;
+#endif
+
+// Periodic bandwidth budget (USB 2.0 5.7.4): 80% of a highspeed uframe, 90% of a full speed frame of each TT.
+// Budget is tracked for 8 frames which is the longest interval of period tree, frame slot = frame % 8
+#define BW_SLOT_MAX       8
+#define BW_HS_UFRAME_US   100
+#define BW_FS_FRAME_US    900
+
+// Approximate bus time (us) of a periodic transaction with worst case bit stuffing and protocol overhead
+#define BW_HS_US(_bytes)  (((_bytes) * 28u / 3u + 304u) / 480u + 1u)
+#define BW_FS_US(_bytes)  (((_bytes) * 28u / 3u + 112u) / 12u + 1u)
+#define BW_LS_US(_bytes)  (((_bytes) * 28u / 3u + 96u) * 2u / 3u + 1u)
+
+typedef struct {
+  uint8_t  interval;    // frames: 1, 2, 4 or 8
+  uint8_t  phase;       // first frame slot, less than interval
+  uint8_t  uframe_mask; // uframes used on highspeed bus
+  uint8_t  hs_us;       // highspeed bus time in each used uframe
+  uint8_t  tt_idx;      // TT (hub address) of full/low speed endpoint
+  uint16_t fs_us;       // full/low speed bus time per frame, 0 for highspeed endpoint
+} bw_alloc_t;
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+// Frames ahead of current one for the first TD of a new stream, a continuing stream only needs to be in the future
+#define ISO_SCHED_MARGIN  2
+
+TU_VERIFY_STATIC(CFG_TUH_EHCI_ISO_FRAME_PER_XFER >= 1 && CFG_TUH_EHCI_ISO_FRAME_PER_XFER <= FRAMELIST_SIZE - ISO_SCHED_MARGIN,
+                 "isochronous transfer must fit in frame list");
+
+// A TD covers one frame: iTD for highspeed, siTD for full speed split transaction
+typedef union TU_ATTR_ALIGNED(32) {
+  ehci_itd_t  itd;
+  ehci_sitd_t sitd;
+} ehci_iso_td_t;
+
+typedef struct {
+  uint8_t  dev_addr;
+  uint8_t  ep_addr;       // 0 if not opened
+  uint8_t  is_hs;
+  uint8_t  mult;          // highspeed transactions per uframe
+  uint16_t mps;
+  uint16_t packet_size;   // bytes per service interval
+  uint8_t  pkt_per_frame; // highspeed: service intervals in a frame, split: 1
+  uint8_t  smask;         // highspeed: uframes with transaction, split: start split uframes
+  uint8_t  cmask;         // split: complete split uframes
+  uint8_t  hub_addr;
+  uint8_t  hub_port;
+  uint8_t  td_set;        // sets alternate between transfers
+  volatile uint8_t td_count; // TDs of transfer in progress, 0 if idle
+
+  bw_alloc_t bw;
+
+  uint8_t* buffer;
+  uint16_t buflen;
+  uint16_t pkt_count;
+  uint32_t start_frame;
+  uint32_t next_frame;    // frame following the last scheduled service interval, next transfer continues from here
+} ehci_iso_ep_t;
+#endif
 
 typedef struct
 {
@@ -80,6 +154,29 @@ typedef struct
   ehci_qhd_t qhd_pool[QHD_MAX];
   ehci_qtd_t qtd_pool[QTD_MAX] TU_ATTR_ALIGNED(32);
 
+#if CFG_TUH_EHCI_QTD_PER_XFER > 1
+  // Inactive TD used as alternate next of chained IN TDs: HC stops the chain on short packet
+  ehci_qtd_t qtd_short_stop TU_ATTR_ALIGNED(32);
+#endif
+
+  // Constant time pool management: endpoint lookup table and bitmaps, bits are updated atomically since
+  // they are changed in both ISR and thread context
+  qhd_idx_t ep2qhd[QHD_CONTROL_MAX][CFG_TUH_ENDPOINT_MAX][2];
+  uint32_t qhd_free_map[BITMAP_WORDS(QHD_MAX)];
+  uint32_t qhd_removing_map[BITMAP_WORDS(QHD_MAX)]; // removed from async list, free after async advance
+  uint32_t qhd_busy_map[BITMAP_WORDS(QHD_CONTROL_MAX + QHD_MAX)]; // QHD with attached TD, control QHDs first
+
+  // Periodic bandwidth in use: highspeed bus per uframe, full/low speed bus per TT (hub address) per frame
+  uint8_t  bw_hs_us[BW_SLOT_MAX][8];
+  uint16_t bw_tt_us[QHD_CONTROL_MAX][BW_SLOT_MAX];
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+  // TDs of an endpoint alternate between two sets so that the ones of a just retired transfer, which HC may
+  // still walk in the current frame, are not rewritten right away by the next transfer
+  ehci_iso_td_t iso_td[CFG_TUH_EHCI_ISO_EP_MAX][2][CFG_TUH_EHCI_ISO_FRAME_PER_XFER];
+  ehci_iso_ep_t iso_ep[CFG_TUH_EHCI_ISO_EP_MAX];
+#endif
+
   ehci_registers_t* regs;         // operational register
   ehci_cap_registers_t* cap_regs; // capability register
 
@@ -89,6 +186,9 @@ typedef struct
 // Periodic frame list must be 4K alignment
 CFG_TUH_MEM_SECTION TU_ATTR_ALIGNED(4096) static ehci_data_t ehci_data;
 
+// Interrupt threshold in microframes, kept outside ehci_data since it is set before ehci_init()
+static uint8_t _ehci_int_threshold = 8;
+
 //--------------------------------------------------------------------+
 // Debug
 //--------------------------------------------------------------------+
@@ -135,14 +235,16 @@ TU_ATTR_WEAK bool hcd_dcache_clean_invalidate(void const* addr, uint32_t data_si
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_control(uint8_t dev_addr);
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_next (ehci_qhd_t const * p_qhd);
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_find_free (void);
+TU_ATTR_ALWAYS_INLINE static inline uint32_t qhd_busy_bit (ehci_qhd_t const* qhd);
 static ehci_qhd_t* qhd_get_from_addr (uint8_t dev_addr, uint8_t ep_addr);
 static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
 static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd);
 static void qhd_remove_qtd(ehci_qhd_t *qhd);
 
 TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr);
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_find_free (void);
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_from_qhd (ehci_qhd_t const* qhd);
 static void qtd_init (ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes);
+static uint16_t qtd_xfer_len(void const* buffer, uint32_t remaining, uint16_t mps);
 
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint32_t interval_ms);
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* list_get_async_head(uint8_t rhport);
@@ -150,6 +252,26 @@ TU_ATTR_ALWAYS_INLINE static inline void list_insert (ehci_link_t *current, ehci
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_next (ehci_link_t const *p_link);
 static void list_remove_qhd_by_daddr(ehci_link_t* list_head, uint8_t dev_addr);
 
+static bool bw_update(bw_alloc_t const* bw, bool reserve);
+static void qhd_bw_get(ehci_qhd_t const* qhd, bw_alloc_t* bw);
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+static bool bw_alloc(bw_alloc_t* bw, uint8_t uframe_mask);
+static ehci_iso_ep_t* iso_ep_get(uint8_t dev_addr, uint8_t ep_addr);
+static bool iso_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* ep_desc);
+static bool iso_edpt_xfer(ehci_iso_ep_t* ep, uint8_t* buffer, uint16_t buflen);
+static void iso_td_unlink_all(ehci_iso_ep_t* ep);
+static void iso_xfer_isr(void);
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline void bitmap_set(uint32_t* map, uint32_t bit) {
+  (void) __atomic_fetch_or(&map[bit / 32], (uint32_t) TU_BIT(bit % 32), __ATOMIC_RELAXED);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void bitmap_clear(uint32_t* map, uint32_t bit) {
+  (void) __atomic_fetch_and(&map[bit / 32], ~((uint32_t) TU_BIT(bit % 32)), __ATOMIC_RELAXED);
+}
+
 static void ehci_disable_schedule(ehci_registers_t* regs, bool is_period) {
   // maybe have a timeout for status
   if (is_period) {
@@ -176,6 +298,22 @@ static void ehci_enable_schedule(ehci_registers_t* regs, bool is_period) {
 // HCD API
 //--------------------------------------------------------------------+
 
+bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void* cfg_param)
+{
+  (void) rhport;
+  TU_VERIFY(cfg_id == TUH_CFGID_EHCI && cfg_param != NULL);
+
+  tuh_configure_param_t const* cfg = (tuh_configure_param_t const*) cfg_param;
+  uint8_t const itc = cfg->ehci.int_threshold;
+
+  // only 1, 2, 4, 8, 16, 32, 64 are valid. Changing ITC while HC is running is undefined (EHCI 2.3.1),
+  // therefore it takes effect on next ehci_init()
+  TU_VERIFY(itc && itc <= 64 && tu_is_power_of_two(itc));
+  _ehci_int_threshold = itc;
+
+  return true;
+}
+
 uint32_t hcd_frame_number(uint8_t rhport)
 {
   (void) rhport;
@@ -221,6 +359,37 @@ void hcd_port_reset_end(uint8_t rhport)
   regs->portsc = portsc;
 }
 
+bool hcd_port_suspend(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+  TU_VERIFY(regs->portsc_bm.port_enabled);
+
+  uint32_t const portsc = regs->portsc & ~EHCI_PORTSC_MASK_W1C;
+  regs->portsc = portsc | EHCI_PORTSC_MASK_PORT_SUSPEND;
+  return true;
+}
+
+void hcd_port_resume(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+
+  // already set by controller if resume is signaled by remote wakeup
+  uint32_t const portsc = regs->portsc & ~EHCI_PORTSC_MASK_W1C;
+  regs->portsc = portsc | EHCI_PORTSC_MASK_FORCE_RESUME;
+}
+
+void hcd_port_resume_end(uint8_t rhport)
+{
+  (void) rhport;
+  ehci_registers_t* regs = ehci_data.regs;
+
+  // controller clears Suspend bit once resume signaling is done
+  uint32_t const portsc = regs->portsc & ~EHCI_PORTSC_MASK_W1C;
+  regs->portsc = portsc & ~EHCI_PORTSC_MASK_FORCE_RESUME;
+}
+
 bool hcd_port_connect_status(uint8_t rhport)
 {
   (void) rhport;
@@ -249,6 +418,21 @@ void hcd_device_close(uint8_t rhport, uint8_t daddr)
     list_remove_qhd_by_daddr((ehci_link_t *) &ehci_data.period_head_arr[i], daddr);
   }
 
+  tu_memclr(ehci_data.ep2qhd[daddr], sizeof(ehci_data.ep2qhd[daddr]));
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+  // Unlink TDs of pending transfer (dropped) and give back bandwidth
+  for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EP_MAX; i++) {
+    ehci_iso_ep_t* ep = &ehci_data.iso_ep[i];
+    if (ep->ep_addr && ep->dev_addr == daddr) {
+      iso_td_unlink_all(ep);
+      bw_update(&ep->bw, false);
+      ep->dev_addr = 0;
+      ep->ep_addr  = 0;
+    }
+  }
+#endif
+
   // Async doorbell (EHCI 4.8.2 for operational details)
   ehci_data.regs->command_bm.async_adv_doorbell = 1;
 }
@@ -296,6 +480,16 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
 {
   tu_memclr(&ehci_data, sizeof(ehci_data_t));
 
+  for (uint32_t i = 0; i < QHD_MAX; i++) {
+    bitmap_set(ehci_data.qhd_free_map, i);
+  }
+
+#if CFG_TUH_EHCI_QTD_PER_XFER > 1
+  ehci_data.qtd_short_stop.next.terminate      = 1;
+  ehci_data.qtd_short_stop.alternate.terminate = 1;
+  hcd_dcache_clean(&ehci_data.qtd_short_stop, sizeof(ehci_qtd_t));
+#endif
+
   ehci_data.regs = (ehci_registers_t*) operatial_reg;
   ehci_data.cap_regs = (ehci_cap_registers_t*) capability_reg;
 
@@ -339,6 +533,7 @@ bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
   regs->nxp_tt_control = 0;
 
   //------------- USB CMD Register -------------//
+  regs->command_bm.int_threshold = _ehci_int_threshold;
   regs->command |= EHCI_USBCMD_RUN_STOP | EHCI_USBCMD_PERIOD_SCHEDULE_ENABLE | EHCI_USBCMD_ASYNC_SCHEDULE_ENABLE |
                    FRAMELIST_SIZE_USBCMD_VALUE;
 
@@ -379,8 +574,14 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 {
   (void) rhport;
 
-  // TODO not support ISO yet
-  TU_ASSERT (ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+  #if CFG_TUH_EHCI_ISO_EP_MAX
+    return iso_edpt_open(dev_addr, ep_desc);
+  #else
+    TU_LOG1("EHCI: isochronous is disabled, see CFG_TUH_EHCI_ISO_EP_MAX\r\n");
+    return false;
+  #endif
+  }
 
   //------------- Prepare Queue Head -------------//
   ehci_qhd_t *p_qhd = (ep_desc->bEndpointAddress == 0) ? qhd_control(dev_addr) : qhd_find_free();
@@ -388,6 +589,22 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 
   qhd_init(p_qhd, dev_addr, ep_desc);
 
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_INTERRUPT) {
+    bw_alloc_t bw;
+    qhd_bw_get(p_qhd, &bw);
+    if (!bw_update(&bw, true)) {
+      TU_LOG1("EHCI: not enough periodic bandwidth\r\n");
+      p_qhd->used = 0;
+      bitmap_set(ehci_data.qhd_free_map, (uint32_t) (p_qhd - ehci_data.qhd_pool));
+      return false;
+    }
+  }
+
+  if (ep_desc->bEndpointAddress != 0) {
+    ehci_data.ep2qhd[dev_addr][tu_edpt_number(ep_desc->bEndpointAddress)][tu_edpt_dir(ep_desc->bEndpointAddress)] =
+        (qhd_idx_t) (p_qhd - ehci_data.qhd_pool + 1);
+  }
+
   // control of dev0 is always present as async head
   if ( dev_addr == 0 ) return true;
 
@@ -405,10 +622,6 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
       list_head = list_get_period_head(rhport, p_qhd->interval_ms);
     break;
 
-    case TUSB_XFER_ISOCHRONOUS:
-      // TODO iso is not supported
-    break;
-
     default: break;
   }
   TU_ASSERT(list_head);
@@ -444,7 +657,7 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   return true;
 }
 
-bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
+TU_ATTR_FAST_FUNC bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen)
 {
   (void) rhport;
 
@@ -454,6 +667,16 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   ehci_qhd_t* qhd = qhd_get_from_addr(dev_addr, ep_addr);
   ehci_qtd_t* qtd;
 
+#if CFG_TUH_EHCI_ISO_EP_MAX
+  if (qhd == NULL) {
+    ehci_iso_ep_t* iso_ep = iso_ep_get(dev_addr, ep_addr);
+    TU_ASSERT(iso_ep);
+    return iso_edpt_xfer(iso_ep, buffer, buflen);
+  }
+#endif
+
+  TU_ASSERT(qhd);
+
   if (epnum == 0) {
     // Control endpoint never be stalled. Skip reset Data Toggle since it is fixed per stage
     if (qhd->qtd_overlay.halted) {
@@ -467,22 +690,54 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
     qtd->data_toggle = 1;
     qtd->pid = dir ? EHCI_PID_IN : EHCI_PID_OUT;
   } else {
-    // skip if endpoint is halted
-    TU_VERIFY(!qhd->qtd_overlay.halted);
+    // skip if endpoint is halted or still has a transfer in progress
+    TU_VERIFY(!qhd->qtd_overlay.halted && qhd->attached_qtd == NULL);
+
+    qtd = qtd_from_qhd(qhd);
+
+    #if CFG_TUH_EHCI_QTD_PER_XFER > 1
+    // chain as many TDs as needed, all but the last one hold whole packets only
+    uint8_t count = 0;
+    uint8_t* td_buf = buffer;
+    uint32_t remaining = buflen;
+    do {
+      TU_ASSERT(count < CFG_TUH_EHCI_QTD_PER_XFER);
+      uint16_t const td_len = qtd_xfer_len(td_buf, remaining, qhd->max_packet_size);
+      ehci_qtd_t* td = &qtd[count];
+
+      qtd_init(td, td_buf, td_len);
+      td->pid = qhd->pid;
+      if (count) {
+        qtd[count - 1].next.address = (uint32_t) td; // also clear terminate
+        qtd[count - 1].int_on_complete = 0;
+      }
 
-    qtd = qtd_find_free();
-    TU_ASSERT(qtd);
+      td_buf += td_len;
+      remaining -= td_len;
+      count++;
+    } while (remaining);
 
+    if (count > 1 && dir) {
+      for (uint8_t i = 0; i < count; i++) {
+        qtd[i].alternate.address = (uint32_t) &ehci_data.qtd_short_stop;
+      }
+    }
+    qhd->attached_count = count;
+    #else
+    TU_ASSERT(buflen <= qtd_xfer_len(buffer, buflen, qhd->max_packet_size));
     qtd_init(qtd, buffer, buflen);
     qtd->pid = qhd->pid;
+    #endif
   }
 
   // IN transfer: invalidate buffer, OUT transfer: clean buffer
+  #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh
   if (dir) {
     hcd_dcache_invalidate(buffer, buflen);
   }else {
     hcd_dcache_clean(buffer, buflen);
   }
+  #endif
 
   // attach TD to QHD -> start transferring
   qhd_attach_qtd(qhd, qtd);
@@ -493,8 +748,22 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
 bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
   (void) rhport;
 
-  // TODO ISO not supported yet
   ehci_qhd_t* qhd = qhd_get_from_addr(dev_addr, ep_addr);
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+  if (qhd == NULL) {
+    ehci_iso_ep_t* iso_ep = iso_ep_get(dev_addr, ep_addr);
+    TU_VERIFY(iso_ep && iso_ep->td_count);
+
+    // stop HC from walking the TDs while they are unlinked
+    ehci_disable_schedule(ehci_data.regs, true);
+    iso_td_unlink_all(iso_ep);
+    ehci_enable_schedule(ehci_data.regs, true);
+    return true;
+  }
+#endif
+
+  TU_VERIFY(qhd);
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
   TU_VERIFY(qtd != NULL); // no queued transfer
 
@@ -525,6 +794,7 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
   (void) rhport;
   ehci_qhd_t *qhd = qhd_get_from_addr(daddr, ep_addr);
+  TU_VERIFY(qhd);
   qhd->qtd_overlay.halted = 0;
   qhd->qtd_overlay.data_toggle = 0;
   hcd_dcache_clean_invalidate(qhd, sizeof(ehci_qhd_t));
@@ -544,11 +814,17 @@ void async_advance_isr(uint8_t rhport)
 {
   (void) rhport;
 
-  ehci_qhd_t *qhd_pool = ehci_data.qhd_pool;
-  for (uint32_t i = 0; i < QHD_MAX; i++) {
-    if (qhd_pool[i].removing) {
-      qhd_pool[i].removing = 0;
-      qhd_pool[i].used = 0;
+  for (uint32_t w = 0; w < TU_ARRAY_SIZE(ehci_data.qhd_removing_map); w++) {
+    uint32_t const removed = __atomic_exchange_n(&ehci_data.qhd_removing_map[w], 0, __ATOMIC_RELAXED);
+    if (removed) {
+      uint32_t bits = removed;
+      while (bits) {
+        uint32_t const i = w * 32 + (uint32_t) __builtin_ctz(bits);
+        bits &= bits - 1;
+        ehci_data.qhd_pool[i].removing = 0;
+        ehci_data.qhd_pool[i].used = 0;
+      }
+      (void) __atomic_fetch_or(&ehci_data.qhd_free_map[w], removed, __ATOMIC_RELAXED);
     }
   }
 }
@@ -592,15 +868,28 @@ void qhd_xfer_complete_isr(ehci_qhd_t * qhd) {
     }
 
     ehci_qtd_t * volatile qtd = qhd->attached_qtd;
-    hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t)); // HC may have written back TD
+    hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t) * tu_max8(qhd->attached_count, 1)); // HC may have written back TD
 
     uint8_t const dir = (qtd->pid == EHCI_PID_IN) ? 1 : 0;
-    uint32_t const xferred_bytes = qtd->expected_bytes - qtd->total_bytes;
+    uint32_t xferred_bytes = qtd->expected_bytes - qtd->total_bytes;
+
+    #if CFG_TUH_EHCI_QTD_PER_XFER > 1
+    // chain ends with the last TD, or the one with error or short packet. A still active TD means
+    // HC has just retired the previous one and is advancing, transfer is not complete yet.
+    for (uint8_t i = 1; i < qhd->attached_count; i++) {
+      ehci_qtd_t const* prev_td = &qtd[i - 1];
+      if (prev_td->halted || prev_td->total_bytes) break;
+      if (qtd[i].active) return;
+      xferred_bytes += qtd[i].expected_bytes - qtd[i].total_bytes;
+    }
+    #endif
 
     // invalidate dcache if IN transfer with data
+    #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh
     if (dir == 1 && qhd->attached_buffer != 0 && xferred_bytes > 0) {
       hcd_dcache_invalidate((void*) qhd->attached_buffer, xferred_bytes);
     }
+    #endif
 
     // remove and free TD before invoking callback
     qhd_remove_qtd(qhd);
@@ -611,52 +900,23 @@ void qhd_xfer_complete_isr(ehci_qhd_t * qhd) {
   }
 }
 
+// Only QHDs with an attached TD are checked, regardless of how many endpoints are opened
 TU_ATTR_ALWAYS_INLINE static inline
-void proccess_async_xfer_isr(ehci_qhd_t * const list_head)
-{
-  ehci_qhd_t *qhd = list_head;
-
-  do {
-    qhd_xfer_complete_isr(qhd);
-    qhd = qhd_next(qhd);
-  } while ( qhd != list_head ); // async list traversal, stop if loop around
-}
-
-TU_ATTR_ALWAYS_INLINE static inline
-void process_period_xfer_isr(uint8_t rhport, uint32_t interval_ms)
-{
-  uint32_t const period_1ms_addr = (uint32_t) list_get_period_head(rhport, 1u);
-  ehci_link_t next_link = *list_get_period_head(rhport, interval_ms);
-
-  while (!next_link.terminate) {
-    if (interval_ms > 1 && period_1ms_addr == tu_align32(next_link.address)) {
-      // 1ms period list is end of list for all larger interval
-      break;
-    }
-
-    uintptr_t const entry_addr = tu_align32(next_link.address);
-
-    switch (next_link.type) {
-      case EHCI_QTYPE_QHD: {
-        ehci_qhd_t *qhd = (ehci_qhd_t *) entry_addr;
-        qhd_xfer_complete_isr(qhd);
-      }
-        break;
-
-      // TODO support hs/fs ISO
-      case EHCI_QTYPE_ITD:
-      case EHCI_QTYPE_SITD:
-      case EHCI_QTYPE_FSTN:
-      default:
-        break;
+void process_xfer_isr(void) {
+  for (uint32_t w = 0; w < TU_ARRAY_SIZE(ehci_data.qhd_busy_map); w++) {
+    uint32_t busy = __atomic_load_n(&ehci_data.qhd_busy_map[w], __ATOMIC_RELAXED);
+    while (busy) {
+      uint32_t const bit = w * 32 + (uint32_t) __builtin_ctz(busy);
+      busy &= busy - 1;
+
+      ehci_qhd_t* qhd = (bit < QHD_CONTROL_MAX) ? qhd_control((uint8_t) bit) : &ehci_data.qhd_pool[bit - QHD_CONTROL_MAX];
+      qhd_xfer_complete_isr(qhd);
     }
-
-    next_link = *list_next(&next_link);
   }
 }
 
 //------------- Host Controller Driver's Interrupt Handler -------------//
-void hcd_int_handler(uint8_t rhport, bool in_isr) {
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr) {
   (void) in_isr;
   ehci_registers_t* regs = ehci_data.regs;
   uint32_t const int_status = regs->status;
@@ -671,6 +931,10 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   if (int_status & EHCI_INT_MASK_FRAMELIST_ROLLOVER) {
     ehci_data.uframe_number += (FRAMELIST_SIZE << 3);
     regs->status = EHCI_INT_MASK_FRAMELIST_ROLLOVER; // Acknowledge
+
+    #if CFG_TUH_EHCI_ISO_EP_MAX
+    iso_xfer_isr(); // retire isochronous transfer whose TDs are missed i.e never interrupt
+    #endif
   }
 
   if (int_status & EHCI_INT_MASK_PORT_CHANGE) {
@@ -682,6 +946,11 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
       port_connect_status_change_isr(rhport);
     }
 
+    // Force port resume is set by controller when a suspended port detects remote wakeup
+    if (regs->portsc_bm.suspend && regs->portsc_bm.force_port_resume) {
+      hcd_event_device_resume(rhport, true);
+    }
+
     regs->portsc |= port_status; // Acknowledge change bits in portsc
     regs->status = EHCI_INT_MASK_PORT_CHANGE; // Acknowledge
   }
@@ -689,12 +958,10 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   // A USB transfer is completed (OK or error)
   uint32_t const usb_int = int_status & (EHCI_INT_MASK_USB | EHCI_INT_MASK_ERROR);
   if (usb_int) {
-    proccess_async_xfer_isr(list_get_async_head(rhport));
-
-    for ( uint32_t i = 1; i <= FRAMELIST_SIZE; i *= 2 ) {
-      process_period_xfer_isr(rhport, i);
-    }
-
+    process_xfer_isr();
+    #if CFG_TUH_EHCI_ISO_EP_MAX
+    iso_xfer_isr();
+    #endif
     regs->status = usb_int; // Acknowledge
   }
 
@@ -751,15 +1018,27 @@ static void list_remove_qhd_by_daddr(ehci_link_t* list_head, uint8_t dev_addr) {
       // EHCI 4.8.2 link the removed qhd's next to async head (which always reachable by Host Controller)
       qhd->next.address = ((uint32_t) list_head) | (EHCI_QTYPE_QHD << 1);
 
+      // pending transfer of removed endpoint is dropped
+      uint32_t const pool_idx = (uint32_t) (qhd - ehci_data.qhd_pool);
+      bitmap_clear(ehci_data.qhd_busy_map, qhd_busy_bit(qhd));
+      qhd->attached_qtd = NULL;
+      qhd->attached_buffer = 0;
+
       if ( qhd->int_smask )
       {
         // period list queue element is guarantee to be free in the next frame (1 ms)
+        bw_alloc_t bw;
+        qhd_bw_get(qhd, &bw);
+        bw_update(&bw, false);
+
         qhd->used = 0;
+        bitmap_set(ehci_data.qhd_free_map, pool_idx);
       }else
       {
         // async list use async advance handshake
         // mark as removing, will completely re-usable when async advance isr occurs
         qhd->removing = 1;
+        bitmap_set(ehci_data.qhd_removing_map, pool_idx);
       }
 
       hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
@@ -780,14 +1059,27 @@ TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_control(uint8_t dev_addr) {
   return &ehci_data.control[dev_addr].qhd;
 }
 
-// Find a free queue head
+// Allocate a free queue head
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t *qhd_find_free(void) {
-  for ( uint32_t i = 0; i < QHD_MAX; i++ ) {
-    if ( !ehci_data.qhd_pool[i].used ) return &ehci_data.qhd_pool[i];
+  for (uint32_t w = 0; w < TU_ARRAY_SIZE(ehci_data.qhd_free_map); w++) {
+    uint32_t const free_bits = __atomic_load_n(&ehci_data.qhd_free_map[w], __ATOMIC_RELAXED);
+    if (free_bits) {
+      uint32_t const i = w * 32 + (uint32_t) __builtin_ctz(free_bits);
+      bitmap_clear(ehci_data.qhd_free_map, i);
+      return &ehci_data.qhd_pool[i];
+    }
   }
   return NULL;
 }
 
+// Bit of queue head in busy map: control QHDs first, then pool QHDs
+TU_ATTR_ALWAYS_INLINE static inline uint32_t qhd_busy_bit(ehci_qhd_t const* qhd) {
+  if (qhd >= ehci_data.qhd_pool) {
+    return QHD_CONTROL_MAX + (uint32_t) (qhd - ehci_data.qhd_pool);
+  }
+  return (uint32_t) (((uintptr_t) qhd - (uintptr_t) ehci_data.control) / sizeof(ehci_data.control[0]));
+}
+
 // Next queue head link
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t *qhd_next(ehci_qhd_t const *p_qhd) {
   return (ehci_qhd_t *) tu_align32(p_qhd->next.address);
@@ -799,16 +1091,8 @@ static ehci_qhd_t *qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr) {
     return qhd_control(dev_addr);
   }
 
-  ehci_qhd_t *qhd_pool = ehci_data.qhd_pool;
-
-  for ( uint32_t i = 0; i < QHD_MAX; i++ ) {
-    if ( (qhd_pool[i].dev_addr == dev_addr) &&
-         ep_addr == tu_edpt_addr(qhd_pool[i].ep_number, qhd_pool[i].pid) ) {
-      return &qhd_pool[i];
-    }
-  }
-
-  return NULL;
+  qhd_idx_t const idx = ehci_data.ep2qhd[dev_addr][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  return idx ? &ehci_data.qhd_pool[idx - 1] : NULL;
 }
 
 // Init queue head with endpoint descriptor
@@ -855,9 +1139,14 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
     }else
     {
       TU_ASSERT( 0 != interval, );
-      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at 1 us & complete split at 2,3,4 uframes
-      p_qhd->int_smask    = 0x01;
-      p_qhd->fl_int_cmask = TU_BIN8(11100);
+      // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at uframe N & complete split at N+2,N+3,N+4.
+      // Endpoints sharing a TT are spread over uframe 0-3 so that their start splits don't all land in the
+      // same uframe of hub's TT budget. With multi-TT hub each port has its own TT, only endpoints of the
+      // same device compete.
+      uint8_t const tt_key  = devtree_info.multi_tt ? 0 : dev_addr;
+      uint8_t const ss_uframe = (uint8_t) ((tt_key + p_qhd->ep_number) & 0x03);
+      p_qhd->int_smask    = (uint8_t) TU_BIT(ss_uframe);
+      p_qhd->fl_int_cmask = (uint8_t) (TU_BIN8(11100) << ss_uframe);
       p_qhd->interval_ms  = interval;
     }
   }else
@@ -887,24 +1176,29 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
 }
 
 // Attach a TD to queue head
-static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd) {
+TU_ATTR_FAST_FUNC static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd) {
   qhd->attached_qtd = qtd;
   qhd->attached_buffer = qtd->buffer[0];
 
   // clean and invalidate cache before physically write
   hcd_dcache_clean_invalidate(qtd, sizeof(ehci_qtd_t));
 
+  // mark busy before HC can complete it
+  bitmap_set(ehci_data.qhd_busy_map, qhd_busy_bit(qhd));
+
   qhd->qtd_overlay.next.address = (uint32_t) qtd;
   hcd_dcache_clean_invalidate(qhd, sizeof(ehci_qhd_t));
 }
 
 // Remove an attached TD from queue head
-static void qhd_remove_qtd(ehci_qhd_t *qhd) {
+TU_ATTR_FAST_FUNC static void qhd_remove_qtd(ehci_qhd_t *qhd) {
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
 
   qhd->attached_qtd = NULL;
   qhd->attached_buffer = 0;
+  qhd->attached_count = 0;
   hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
+  bitmap_clear(ehci_data.qhd_busy_map, qhd_busy_bit(qhd));
 
   qtd->used = 0; // free QTD
   hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
@@ -919,14 +1213,20 @@ TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr) {
   return &ehci_data.control[dev_addr].qtd;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t *qtd_find_free(void) {
-  for (uint32_t i = 0; i < QTD_MAX; i++) {
-    if (!ehci_data.qtd_pool[i].used) return &ehci_data.qtd_pool[i];
-  }
-  return NULL;
+// Get first dedicated TD of a pool queue head
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t *qtd_from_qhd(ehci_qhd_t const* qhd) {
+  return &ehci_data.qtd_pool[(qhd - ehci_data.qhd_pool) * CFG_TUH_EHCI_QTD_PER_XFER];
+}
+
+// Number of bytes a TD starting at buffer can take: 5 page pointers, limited to whole packets if
+// transfer does not fit (a packet cannot span TDs)
+TU_ATTR_FAST_FUNC static uint16_t qtd_xfer_len(void const* buffer, uint32_t remaining, uint16_t mps) {
+  uint32_t const capacity = 5 * 4096u - ((uint32_t) (uintptr_t) buffer & 0xFFFu);
+  if (remaining <= capacity) return (uint16_t) remaining;
+  return (uint16_t) (mps ? (capacity / mps) * mps : capacity);
 }
 
-static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes) {
+TU_ATTR_FAST_FUNC static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes) {
   tu_memclr(qtd, sizeof(ehci_qtd_t));
   qtd->used                = 1;
 
@@ -945,4 +1245,440 @@ static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes)
   }
 }
 
+//--------------------------------------------------------------------+
+// Periodic bandwidth helper
+//--------------------------------------------------------------------+
+
+// Reserve or release bandwidth of a periodic endpoint. Reserve fails without any change if a uframe or a
+// frame of the TT would be overcommitted.
+static bool bw_update(bw_alloc_t const* bw, bool reserve) {
+  if (reserve) {
+    for (uint8_t slot = bw->phase; slot < BW_SLOT_MAX; slot += bw->interval) {
+      if (ehci_data.bw_tt_us[bw->tt_idx][slot] + bw->fs_us > BW_FS_FRAME_US) {
+        return false;
+      }
+      for (uint8_t u = 0; u < 8; u++) {
+        if (tu_bit_test(bw->uframe_mask, u) && ehci_data.bw_hs_us[slot][u] + bw->hs_us > BW_HS_UFRAME_US) {
+          return false;
+        }
+      }
+    }
+  }
+
+  for (uint8_t slot = bw->phase; slot < BW_SLOT_MAX; slot += bw->interval) {
+    uint16_t* tt_us = &ehci_data.bw_tt_us[bw->tt_idx][slot];
+    *tt_us = (uint16_t) (reserve ? (*tt_us + bw->fs_us) : (*tt_us > bw->fs_us ? *tt_us - bw->fs_us : 0));
+
+    for (uint8_t u = 0; u < 8; u++) {
+      if (tu_bit_test(bw->uframe_mask, u)) {
+        uint8_t* hs_us = &ehci_data.bw_hs_us[slot][u];
+        *hs_us = (uint8_t) (reserve ? (*hs_us + bw->hs_us) : (*hs_us > bw->hs_us ? *hs_us - bw->hs_us : 0));
+      }
+    }
+  }
+
+  return true;
+}
+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+// Reserve bandwidth for uframe mask in the first frame phase that fits
+static bool bw_alloc(bw_alloc_t* bw, uint8_t uframe_mask) {
+  bw->uframe_mask = uframe_mask;
+  for (uint8_t phase = 0; phase < bw->interval; phase++) {
+    bw->phase = phase;
+    if (bw_update(bw, true)) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+// Bandwidth of an interrupt queue head, frame slots follow the period tree built by init_periodic_list()
+static void qhd_bw_get(ehci_qhd_t const* qhd, bw_alloc_t* bw) {
+  uint8_t const interval = (uint8_t) (1u << tu_log2(tu_max32(1, tu_min32(BW_SLOT_MAX, qhd->interval_ms))));
+  uint16_t const mps = qhd->max_packet_size;
+
+  bw->interval    = interval;
+  bw->phase       = (interval == 4) ? 1 : (interval == 8) ? 3 : 0;
+  bw->uframe_mask = (uint8_t) (qhd->int_smask | qhd->fl_int_cmask);
+
+  if (qhd->ep_speed == TUSB_SPEED_HIGH) {
+    bw->hs_us  = (uint8_t) BW_HS_US(mps);
+    bw->tt_idx = 0;
+    bw->fs_us  = 0;
+  } else {
+    // split transaction: at most 188 bytes on highspeed bus per uframe
+    bw->hs_us  = (uint8_t) BW_HS_US(tu_min16(mps, 188));
+    bw->tt_idx = qhd->fl_hub_addr;
+    bw->fs_us  = (uint16_t) ((qhd->ep_speed == TUSB_SPEED_LOW) ? BW_LS_US(mps) : BW_FS_US(mps));
+  }
+}
+
+//--------------------------------------------------------------------+
+// Isochronous helper
+//--------------------------------------------------------------------+
+#if CFG_TUH_EHCI_ISO_EP_MAX
+
+static ehci_iso_ep_t* iso_ep_get(uint8_t dev_addr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EP_MAX; i++) {
+    ehci_iso_ep_t* ep = &ehci_data.iso_ep[i];
+    if (ep->ep_addr == ep_addr && ep->dev_addr == dev_addr) {
+      return ep;
+    }
+  }
+  return NULL;
+}
+
+// TDs for the next transfer of endpoint
+TU_ATTR_ALWAYS_INLINE static inline ehci_iso_td_t* iso_td_set(ehci_iso_ep_t const* ep) {
+  return ehci_data.iso_td[ep - ehci_data.iso_ep][ep->td_set];
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool iso_td_active(ehci_iso_ep_t const* ep, ehci_iso_td_t const* td) {
+  if (ep->is_hs) {
+    for (uint8_t u = 0; u < 8; u++) {
+      if (td->itd.xact[u].active) {
+        return true;
+      }
+    }
+    return false;
+  }
+  return td->sitd.active;
+}
+
+static bool iso_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* ep_desc) {
+  ehci_iso_ep_t* ep = iso_ep_get(0, 0); // free slot
+  TU_ASSERT(ep);
+
+  hcd_devtree_info_t devtree_info;
+  hcd_devtree_get_info(dev_addr, &devtree_info);
+
+  uint8_t const binterval = ep_desc->bInterval;
+  bool const is_hs  = (devtree_info.speed == TUSB_SPEED_HIGH);
+  bool const dir_in = (tu_edpt_dir(ep_desc->bEndpointAddress) == TUSB_DIR_IN);
+
+  // service interval is limited to 8 frames (budget slots), which is also the smallest frame list
+  TU_ASSERT(binterval >= 1 && binterval <= (is_hs ? 7 : 4));
+
+  // EHCI 4.12.3: up to 188 bytes per uframe are transferred on full speed bus. Complete splits of IN must
+  // be within the frame since back pointer is not used, which limits IN packet to 940 bytes.
+  TU_ASSERT(is_hs || !dir_in || tu_edpt_packet_size(ep_desc) <= 5 * 188);
+
+  tu_memclr(ep, sizeof(ehci_iso_ep_t));
+  ep->dev_addr = dev_addr;
+  ep->is_hs    = is_hs;
+  ep->mps      = tu_edpt_packet_size(ep_desc);
+  ep->hub_addr = devtree_info.hub_addr;
+  ep->hub_port = devtree_info.hub_port;
+
+  bw_alloc_t* bw = &ep->bw;
+  bool found = false;
+
+  if (is_hs) {
+    ep->mult        = tu_edpt_packet_mult(ep_desc);
+    ep->packet_size = tu_edpt_max_payload(ep_desc);
+
+    // bInterval 1-4: service interval of 1, 2, 4 or 8 uframes, longer ones are whole frames
+    uint8_t const uinterval = (binterval <= 4) ? (uint8_t) (1u << (binterval - 1)) : 8;
+    bw->interval = (binterval <= 4) ? 1 : (uint8_t) (1u << (binterval - 4));
+    bw->hs_us    = (uint8_t) (ep->mult * BW_HS_US(ep->mps));
+    ep->pkt_per_frame = 8 / uinterval;
+
+    for (uint8_t u0 = 0; u0 < uinterval && !found; u0++) {
+      uint8_t uframe_mask = 0;
+      for (uint8_t u = u0; u < 8; u += uinterval) {
+        uframe_mask |= (uint8_t) TU_BIT(u);
+      }
+      found = bw_alloc(bw, uframe_mask);
+      ep->smask = uframe_mask;
+    }
+  } else {
+    ep->mult          = 1;
+    ep->packet_size   = ep->mps;
+    ep->pkt_per_frame = 1;
+
+    bw->interval = (uint8_t) (1u << (binterval - 1));
+    bw->tt_idx   = devtree_info.hub_addr;
+    bw->hs_us    = (uint8_t) BW_HS_US(tu_min16(ep->mps, 188));
+    bw->fs_us    = (uint16_t) BW_FS_US(ep->mps);
+
+    uint8_t const n_uframe = (uint8_t) tu_max32(1, tu_div_ceil(ep->mps, 188));
+
+    if (dir_in) {
+      // start split in uframe s, complete splits in the n+1 uframes starting from s+2
+      for (uint8_t s = 0; s + n_uframe + 2 <= 7 && !found; s++) {
+        ep->smask = (uint8_t) TU_BIT(s);
+        ep->cmask = (uint8_t) ((TU_BIT(n_uframe + 1) - 1) << (s + 2));
+        found = bw_alloc(bw, ep->smask | ep->cmask);
+      }
+    } else {
+      // one start split per 188 bytes, no complete split
+      for (uint8_t s = 0; s + n_uframe <= 7 && !found; s++) {
+        ep->smask = (uint8_t) ((TU_BIT(n_uframe) - 1) << s);
+        ep->cmask = 0;
+        found = bw_alloc(bw, ep->smask);
+      }
+    }
+  }
+
+  if (!found) {
+    TU_LOG1("EHCI: not enough periodic bandwidth\r\n");
+    ep->dev_addr = 0; // free slot
+    return false;
+  }
+
+  // start a new stream with the first transfer
+  ep->next_frame = hcd_frame_number(0);
+  ep->ep_addr    = ep_desc->bEndpointAddress;
+
+  return true;
+}
+
+// Insert TD in front of the frame's list: isochronous TDs are walked before the interrupt period tree
+static void iso_td_link(uint32_t frame, ehci_iso_td_t* td, uint8_t type) {
+  ehci_link_t* slot = &ehci_data.period_framelist[frame % FRAMELIST_SIZE];
+
+  td->itd.next.address = slot->address; // next link is word 0 of both iTD and siTD
+  hcd_dcache_clean(td, sizeof(ehci_iso_td_t));
+
+  slot->address = ((uint32_t) td) | ((uint32_t) type << 1);
+  hcd_dcache_clean(slot, sizeof(ehci_link_t));
+}
+
+static void iso_td_unlink(uint32_t frame, ehci_iso_td_t const* td) {
+  ehci_link_t* prev = &ehci_data.period_framelist[frame % FRAMELIST_SIZE];
+
+  // stop at first queue head (period tree), isochronous TDs are always in front of it
+  while (!prev->terminate && prev->type != EHCI_QTYPE_QHD) {
+    ehci_link_t* cur = list_next(prev);
+    if ((uintptr_t) cur == (uintptr_t) td) {
+      prev->address = cur->address;
+      hcd_dcache_clean(prev, sizeof(ehci_link_t));
+      return;
+    }
+    prev = cur;
+  }
+}
+
+// Unlink TDs of transfer in progress (if any), transfer is dropped
+static void iso_td_unlink_all(ehci_iso_ep_t* ep) {
+  uint8_t const td_count = ep->td_count;
+  ehci_iso_td_t const* td_set = iso_td_set(ep);
+
+  for (uint8_t i = 0; i < td_count; i++) {
+    iso_td_unlink(ep->start_frame + i * ep->bw.interval, &td_set[i]);
+  }
+
+  if (td_count) {
+    ep->td_count = 0;
+    ep->td_set ^= 1;
+  }
+}
+
+// A transfer is split into packets of one service interval, with one TD per frame. Packets of a frame are
+// transactions of an iTD (highspeed) or a single siTD (full speed split).
+TU_ATTR_FAST_FUNC static bool iso_edpt_xfer(ehci_iso_ep_t* ep, uint8_t* buffer, uint16_t buflen) {
+  TU_VERIFY(ep->td_count == 0); // one transfer at a time
+
+  uint32_t const pkt_count = tu_max32(1, tu_div_ceil(buflen, ep->packet_size));
+  uint32_t const td_count  = tu_div_ceil(pkt_count, ep->pkt_per_frame);
+  TU_ASSERT(td_count <= CFG_TUH_EHCI_ISO_FRAME_PER_XFER);
+
+  uint8_t const interval = ep->bw.interval;
+  uint32_t const now = hcd_frame_number(0);
+
+  // continue the stream if its next service interval is still ahead, otherwise restart after a safe margin
+  uint32_t start = ep->next_frame;
+  if ((int32_t) (start - now) <= 0 || start - now >= FRAMELIST_SIZE) {
+    start = now + ISO_SCHED_MARGIN;
+    start += (uint32_t) (ep->bw.phase - start) & (interval - 1u);
+  }
+
+  // frame list wraps around: a TD further ahead than its size would be executed in an earlier frame
+  TU_ASSERT(start + (td_count - 1) * interval - now < FRAMELIST_SIZE);
+
+  bool const dir_in = (tu_edpt_dir(ep->ep_addr) == TUSB_DIR_IN);
+  #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh
+  if (dir_in) {
+    hcd_dcache_invalidate(buffer, buflen);
+  } else {
+    hcd_dcache_clean(buffer, buflen);
+  }
+  #endif
+
+  ehci_iso_td_t* td_set = iso_td_set(ep);
+  uint8_t* td_buf = buffer;
+  uint32_t remaining = buflen;
+  uint32_t pkt_left = pkt_count;
+
+  for (uint32_t i = 0; i < td_count; i++) {
+    ehci_iso_td_t* td = &td_set[i];
+    bool const last_td = (i == td_count - 1);
+    tu_memclr(td, sizeof(ehci_iso_td_t));
+
+    if (ep->is_hs) {
+      ehci_itd_t* itd = &td->itd;
+
+      // 7 pages can hold 8 transactions of 3 KiB from any offset
+      uint32_t const page0 = tu_align4k((uint32_t) td_buf);
+      for (uint8_t p = 0; p < 7; p++) {
+        itd->BufferPointer[p] = page0 + p * 4096u;
+      }
+      itd->BufferPointer[0] |= ep->dev_addr | ((uint32_t) tu_edpt_number(ep->ep_addr) << 8);
+      itd->BufferPointer[1] |= ep->mps | (dir_in ? TU_BIT(11) : 0);
+      itd->BufferPointer[2] |= ep->mult;
+
+      uint32_t const offset0 = tu_offset4k((uint32_t) td_buf);
+      uint32_t offset = offset0;
+      uint8_t last_u = 0;
+
+      for (uint8_t u = 0; u < 8 && pkt_left; u++) {
+        if (!tu_bit_test(ep->smask, u)) continue;
+
+        uint16_t const len = (uint16_t) tu_min32(remaining, ep->packet_size);
+        itd->xact[u].offset      = offset & 0xFFFu;
+        itd->xact[u].page_select = (offset >> 12) & 0x07u;
+        itd->xact[u].length      = len & 0xFFFu;
+        itd->xact[u].active      = 1;
+
+        offset    += len;
+        remaining -= len;
+        pkt_left--;
+        last_u = u;
+      }
+
+      itd->xact[last_u].int_on_complete = last_td ? 1 : 0;
+      td_buf += offset - offset0;
+    } else {
+      ehci_sitd_t* sitd = &td->sitd;
+      uint16_t const len = (uint16_t) tu_min32(remaining, ep->packet_size);
+
+      sitd->dev_addr     = ep->dev_addr & 0x7Fu;
+      sitd->ep_number    = tu_edpt_number(ep->ep_addr) & 0x0Fu;
+      sitd->hub_addr     = ep->hub_addr & 0x7Fu;
+      sitd->port_number  = ep->hub_port & 0x7Fu;
+      sitd->direction    = dir_in ? 1 : 0;
+      sitd->int_smask    = ep->smask;
+      sitd->fl_int_cmask = ep->cmask;
+
+      sitd->total_bytes     = len & 0x3FFu;
+      sitd->int_on_complete = last_td ? 1 : 0;
+      sitd->active          = 1;
+
+      sitd->buffer[0] = (uint32_t) td_buf;
+      sitd->buffer[1] = tu_align4k((uint32_t) td_buf) + 4096u;
+      if (!dir_in) {
+        // OUT data is sent by start splits of up to 188 bytes: transaction count and position (all or begin)
+        uint32_t const tcount = tu_max32(1, tu_div_ceil(len, 188));
+        sitd->buffer[1] |= tcount | ((tcount > 1 ? 1u : 0u) << 3);
+      }
+      sitd->back.terminate = 1;
+
+      td_buf    += len;
+      remaining -= len;
+      pkt_left--;
+    }
+  }
+
+  ep->buffer      = buffer;
+  ep->buflen      = buflen;
+  ep->pkt_count   = (uint16_t) pkt_count;
+  ep->start_frame = start;
+  ep->next_frame  = start + td_count * interval;
+
+  for (uint32_t i = 0; i < td_count; i++) {
+    iso_td_link(start + i * interval, &td_set[i], ep->is_hs ? EHCI_QTYPE_ITD : EHCI_QTYPE_SITD);
+  }
+
+  ep->td_count = (uint8_t) td_count; // ISR can complete it from now on
+
+  return true;
+}
+
+// Check isochronous endpoint for transfer complete
+TU_ATTR_FAST_FUNC static void iso_xfer_complete_isr(ehci_iso_ep_t* ep) {
+  uint8_t const td_count = ep->td_count;
+  ehci_iso_td_t* td_set = iso_td_set(ep);
+  hcd_dcache_invalidate(td_set, td_count * sizeof(ehci_iso_td_t)); // HC may have written back TDs
+
+  // complete once HC has retired all TDs, or frame of the last one has passed since some are missed
+  uint32_t const last_frame = ep->next_frame - ep->bw.interval;
+  if ((int32_t) (hcd_frame_number(0) - last_frame) <= 0) {
+    for (uint8_t i = 0; i < td_count; i++) {
+      if (iso_td_active(ep, &td_set[i])) return;
+    }
+  }
+
+  bool const dir_in = (tu_edpt_dir(ep->ep_addr) == TUSB_DIR_IN);
+  #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh
+  if (dir_in) {
+    hcd_dcache_invalidate(ep->buffer, ep->buflen);
+  }
+  #endif
+
+  xfer_result_t result = XFER_RESULT_SUCCESS;
+  uint32_t xferred_bytes = 0;
+  uint32_t remaining = ep->buflen;
+  uint16_t pkt_left = ep->pkt_count;
+  uint8_t const* src = ep->buffer;
+  uint8_t const xact_mask = ep->is_hs ? ep->smask : 1;
+
+  for (uint8_t i = 0; i < td_count; i++) {
+    ehci_iso_td_t const* td = &td_set[i];
+
+    for (uint8_t u = 0; u < 8 && pkt_left; u++) {
+      if (!tu_bit_test(xact_mask, u)) continue;
+
+      uint16_t const expected = (uint16_t) tu_min32(remaining, ep->packet_size);
+      uint16_t actual;
+      bool active, error;
+
+      if (ep->is_hs) {
+        ehci_itd_t const* itd = &td->itd;
+        active = itd->xact[u].active;
+        error  = itd->xact[u].error || itd->xact[u].babble_err || itd->xact[u].buffer_err;
+        actual = dir_in ? (uint16_t) itd->xact[u].length : expected; // HC only writes back IN length
+      } else {
+        ehci_sitd_t const* sitd = &td->sitd;
+        active = sitd->active;
+        error  = sitd->error || sitd->xact_err || sitd->babble_err || sitd->buffer_err || sitd->missed_uframe;
+        actual = (uint16_t) (expected - sitd->total_bytes);
+      }
+
+      if (active) {
+        actual = 0; // service interval is missed
+      } else if (error) {
+        actual = 0;
+        result = XFER_RESULT_FAILED;
+      }
+
+      // a short IN packet leaves a gap before the next one: move data so that it is contiguous in buffer
+      uint8_t* dst = ep->buffer + xferred_bytes;
+      if (dir_in && actual && dst != src) {
+        memmove(dst, src, actual);
+      }
+
+      xferred_bytes += actual;
+      src           += expected;
+      remaining     -= expected;
+      pkt_left--;
+    }
+  }
+
+  iso_td_unlink_all(ep);
+
+  hcd_event_xfer_complete(ep->dev_addr, ep->ep_addr, xferred_bytes, result, true);
+}
+
+TU_ATTR_FAST_FUNC static void iso_xfer_isr(void) {
+  for (uint8_t i = 0; i < CFG_TUH_EHCI_ISO_EP_MAX; i++) {
+    if (ehci_data.iso_ep[i].td_count) {
+      iso_xfer_complete_isr(&ehci_data.iso_ep[i]);
+    }
+  }
+}
+
+#endif
+
 #endif
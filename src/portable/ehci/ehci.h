@@ -164,9 +164,10 @@ typedef struct TU_ATTR_ALIGNED(32)
 	uint8_t pid;
 	uint8_t interval_ms; // polling interval in frames (or millisecond)
 
-	uint8_t TU_RESERVED[4];
+	uint8_t attached_count; // number of chained TDs of the attached transfer
+	uint8_t TU_RESERVED[3];
 
-  // Attached TD management, note usbh will only queue 1 TD per QHD.
+  // Attached TD management, note usbh will only queue 1 transfer per QHD which may be chained into several TDs.
   // buffer for dcache invalidate since td's buffer is modified by HC and finding initial buffer address is not trivial
   uint32_t attached_buffer;
 	ehci_qtd_t * volatile attached_qtd;
@@ -52,6 +52,10 @@ _Pragma("GCC diagnostic ignored \"-Waddress-of-packed-member\"");
   #error "Unsupported MCUs"
 #endif
 
+#if CFG_TUD_MUSB_DMA && !TU_CHECK_MCU(OPT_MCU_MSP432E4)
+  #error "CFG_TUD_MUSB_DMA requires the integrated DMA controller of MSP432E4"
+#endif
+
 /*------------------------------------------------------------------
  * MACRO TYPEDEF CONSTANT ENUM DECLARATION
  *------------------------------------------------------------------*/
@@ -79,6 +83,18 @@ typedef union {
   uint32_t  u32;
 } hw_fifo_t;
 
+#if CFG_TUD_MUSB_DMA
+#define DMA_CHANNEL_MAX  8
+#define DMA_INTR_OFFSET  0x200u /* DMAINTR, channel registers follow with stride 0x10 */
+
+typedef struct {
+  volatile uint32_t CTL;
+  volatile uint32_t ADDR;
+  volatile uint32_t COUNT;
+  volatile uint32_t RESERVED;
+} hw_dma_channel_t;
+#endif
+
 typedef struct TU_ATTR_PACKED
 {
   void      *buf;      /* the start address of a transfer data buffer */
@@ -94,6 +110,10 @@ typedef struct
   pipe_state_t pipe0;
   pipe_state_t pipe[2][7];   /* pipe[direction][endpoint number - 1] */
   uint16_t     pipe_buf_is_fifo[2]; /* Bitmap. Each bit means whether 1:TU_FIFO or 0:POD. */
+#if CFG_TUD_MUSB_DMA
+  uint8_t      dma_ep[DMA_CHANNEL_MAX];  /* endpoint address served by each channel, 0 is free */
+  uint16_t     dma_len[DMA_CHANNEL_MAX]; /* the number of bytes programmed to each channel */
+#endif
 } dcd_data_t;
 
 /*------------------------------------------------------------------
@@ -210,9 +230,13 @@ static unsigned find_free_memory(uint_fast16_t size_in_log2_minus3)
     uint_fast16_t sz = free_block_size(cur);
     if (sz < size_in_8byte_unit) continue;
     if (size_in_8byte_unit == sz) return cur->beg;
-    if (sz < min_sz) min = cur;
+    if (sz < min_sz) {
+      min    = cur;
+      min_sz = sz;
+    }
   }
-  TU_ASSERT(min, 0);
+  /* Not an error by itself, the caller may retry with a smaller size */
+  TU_VERIFY(min, 0);
   return min->beg;
 }
 
@@ -363,6 +387,139 @@ static bool handle_xfer_out(uint_fast8_t ep_addr)
   return false;
 }
 
+#if CFG_TUD_MUSB_DMA
+static inline volatile hw_dma_channel_t* dma_regs(unsigned ch)
+{
+  return (volatile hw_dma_channel_t*)((uintptr_t)USB0 + DMA_INTR_OFFSET + 4u) + ch;
+}
+
+static int dma_find_channel(uint_fast8_t ep_addr)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_MAX; ++ch) {
+    if (_dcd.dma_ep[ch] == ep_addr) return (int)ch;
+  }
+  return -1;
+}
+
+/* Stop the channel and return the endpoint to CPU driven transfers.
+ * Returns the number of bytes the DMA actually moved. */
+static unsigned dma_release(unsigned ch)
+{
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  unsigned const ep_addr = _dcd.dma_ep[ch];
+  unsigned const epnum_minus1 = tu_edpt_number(ep_addr) - 1;
+  volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
+  pipe_state_t *pipe = &_dcd.pipe[tu_edpt_dir(ep_addr)][epnum_minus1];
+
+  dma->CTL = 0;
+  unsigned const done = TU_MIN(_dcd.dma_len[ch], dma->ADDR - (uintptr_t)pipe->buf);
+  /* DMAMOD must not be cleared in the same write as DMAEN */
+  if (tu_edpt_dir(ep_addr)) {
+    regs->TXCSRH &= ~(USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN);
+    regs->TXCSRH &= ~USB_TXCSRH1_DMAMOD;
+    USB0->TXIE   |= TU_BIT(epnum_minus1 + 1);
+  } else {
+    regs->RXCSRH &= ~(USB_RXCSRH1_AUTOCL | USB_RXCSRH1_DMAEN);
+    regs->RXCSRH &= ~USB_RXCSRH1_DMAMOD;
+  }
+  _dcd.dma_ep[ch] = 0;
+  pipe->buf       = (uint8_t*)pipe->buf + done;
+  pipe->remaining = pipe->remaining - done;
+  return done;
+}
+
+/* Hand the full packets of a transfer over to a free DMA channel in request
+ * mode 1. The controller then loads or unloads every packet by itself
+ * (AUTOSET/AUTOCL), and the CPU sees one DMA interrupt for the run instead
+ * of one endpoint interrupt per packet. A short tail or a short OUT packet
+ * is finished by the CPU. */
+static bool dma_xfer_start(uint_fast8_t ep_addr)
+{
+  unsigned const epnum_minus1 = tu_edpt_number(ep_addr) - 1;
+  unsigned const dir_in = tu_edpt_dir(ep_addr);
+  pipe_state_t *pipe = &_dcd.pipe[dir_in][epnum_minus1];
+  volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
+
+  if (_dcd.pipe_buf_is_fifo[dir_in] & TU_BIT(epnum_minus1)) return false;
+  if ((uintptr_t)pipe->buf & 3u) return false; /* DMA works in words */
+  if (dir_in ? (regs->TXCSRH & USB_TXCSRH1_ISO) : (regs->RXCSRH & USB_RXCSRH1_ISO)) return false;
+
+  unsigned const mps = dir_in ? regs->TXMAXP : regs->RXMAXP;
+  if (mps & 3u) return false;
+  unsigned const len = pipe->remaining - pipe->remaining % mps;
+  if (len < 2 * mps) return false; /* Not worth it */
+
+  int const ch = dma_find_channel(0);
+  if (ch < 0) return false;
+
+  _dcd.dma_ep[ch]  = ep_addr;
+  _dcd.dma_len[ch] = len;
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->ADDR  = (uintptr_t)pipe->buf;
+  dma->COUNT = len;
+  if (dir_in) {
+    /* Endpoint interrupts are meaningless until the DMA has finished */
+    USB0->TXIE   &= ~TU_BIT(epnum_minus1 + 1);
+    regs->TXCSRH |= USB_TXCSRH1_DMAMOD;
+    regs->TXCSRH |= USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN;
+  } else {
+    /* In mode 1 the endpoint interrupt fires only for a short packet */
+    regs->RXCSRH |= USB_RXCSRH1_DMAMOD;
+    regs->RXCSRH |= USB_RXCSRH1_AUTOCL | USB_RXCSRH1_DMAEN;
+  }
+  dma->CTL = ((epnum_minus1 + 1) << USB_DMACTL0_EP_S) |
+             (dir_in ? USB_DMACTL0_DIR : 0) |
+             USB_DMACTL0_MODE | USB_DMACTL0_IE | USB_DMACTL0_ENABLE;
+  return true;
+}
+
+static void dma_release_all(void)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_MAX; ++ch) {
+    if (_dcd.dma_ep[ch]) dma_release(ch);
+  }
+}
+
+static void process_dma(uint8_t rhport)
+{
+  unsigned intr = *(volatile uint32_t const*)((uintptr_t)USB0 + DMA_INTR_OFFSET); /* read and clear */
+  while (intr) {
+    unsigned const ch = __builtin_ctz(intr);
+    intr &= ~TU_BIT(ch);
+    unsigned const ep_addr = _dcd.dma_ep[ch];
+    if (!ep_addr) continue;
+
+    unsigned const epnum_minus1 = tu_edpt_number(ep_addr) - 1;
+    unsigned const dir_in = tu_edpt_dir(ep_addr);
+    volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
+    bool const err = dma_regs(ch)->CTL & USB_DMACTL0_ERR;
+    dma_release(ch);
+
+    pipe_state_t *pipe = &_dcd.pipe[dir_in][epnum_minus1];
+    bool completed = false;
+    if (err) {
+      pipe->buf = NULL;
+      dcd_event_xfer_complete(rhport, ep_addr, pipe->length - pipe->remaining,
+                              XFER_RESULT_FAILED, true);
+      continue;
+    }
+    if (dir_in) {
+      /* Otherwise the endpoint interrupt continues once the FIFO drains */
+      if (!(regs->TXCSRL & USB_TXCSRL1_TXRDY)) completed = handle_xfer_in(ep_addr);
+    } else if (!pipe->remaining) {
+      pipe->buf = NULL;
+      completed = true;
+    } else if (regs->RXCSRL & USB_RXCSRL1_RXRDY) {
+      completed = handle_xfer_out(ep_addr);
+    }
+    if (completed) {
+      dcd_event_xfer_complete(rhport, ep_addr, pipe->length - pipe->remaining,
+                              XFER_RESULT_SUCCESS, true);
+    }
+  }
+}
+#endif
+
 static bool edpt_n_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
 {
   (void)rhport;
@@ -375,8 +532,13 @@ static bool edpt_n_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16
   pipe->length       = total_bytes;
   pipe->remaining    = total_bytes;
 
+#if CFG_TUD_MUSB_DMA
+  bool const dma = dma_xfer_start(ep_addr);
+#else
+  bool const dma = false;
+#endif
   if (dir_in) {
-    handle_xfer_in(ep_addr);
+    if (!dma) handle_xfer_in(ep_addr);
   } else {
     volatile hw_endpoint_t *regs = edpt_regs(epnum_minus1);
     if (regs->RXCSRL & USB_RXCSRL1_RXRDY) regs->RXCSRL = 0;
@@ -551,6 +713,14 @@ static void process_edpt_n(uint8_t rhport, uint_fast8_t ep_addr)
       regs->RXCSRL &= ~(USB_RXCSRL1_STALLED | USB_RXCSRL1_OVER);
       return;
     }
+#if CFG_TUD_MUSB_DMA
+    int const ch = dma_find_channel(ep_addr);
+    if (ch >= 0) {
+      /* A full packet is unloaded by the DMA, a short one ends the run early */
+      if (!(regs->RXCSRL & USB_RXCSRL1_RXRDY) || regs->RXCOUNT == regs->RXMAXP) return;
+      dma_release(ch);
+    }
+#endif
     completed = handle_xfer_out(ep_addr);
   }
 
@@ -571,6 +741,9 @@ static void process_bus_reset(uint8_t rhport)
   /* When pipe0.buf has not NULL, DATA stage works in progress. */
   _dcd.pipe0.buf = NULL;
 
+#if CFG_TUD_MUSB_DMA
+  dma_release_all();
+#endif
   USB0->TXIE = 1; /* Enable only EP0 */
   USB0->RXIE = 0;
 
@@ -697,19 +870,27 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
     USB0->RXIE |= TU_BIT(epn);
   }
 
-  /* Setup FIFO */
+  /* Setup FIFO. Bulk endpoints get double packet buffering when the FIFO
+   * RAM has room for it, so the next packet can be loaded or received
+   * while the other one is on the bus. */
   int size_in_log2_minus3 = 28 - TU_MIN(28, __CLZ((uint32_t)mps));
   if ((8u << size_in_log2_minus3) < mps) ++size_in_log2_minus3;
-  unsigned addr = find_free_memory(size_in_log2_minus3);
+  unsigned fifosz = size_in_log2_minus3;
+  unsigned addr   = 0;
+  if (xfer == TUSB_XFER_BULK) {
+    addr = find_free_memory(size_in_log2_minus3 + 1);
+    if (addr) fifosz |= USB_TXFIFOSZ_DPB; /* Same bit position for RXFIFOSZ */
+  }
+  if (!addr) addr = find_free_memory(size_in_log2_minus3);
   TU_ASSERT(addr);
 
   USB0->EPIDX = epn;
   if (dir_in) {
     USB0->TXFIFOADD = addr;
-    USB0->TXFIFOSZ  = size_in_log2_minus3;
+    USB0->TXFIFOSZ  = fifosz;
   } else {
     USB0->RXFIFOADD = addr;
-    USB0->RXFIFOSZ  = size_in_log2_minus3;
+    USB0->RXFIFOSZ  = fifosz;
   }
 
   return true;
@@ -721,6 +902,9 @@ void dcd_edpt_close_all(uint8_t rhport)
   volatile hw_endpoint_t *regs = (volatile hw_endpoint_t *)(uintptr_t)&USB0->TXMAXP1;
   unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
   NVIC_DisableIRQ(USB0_IRQn);
+#if CFG_TUD_MUSB_DMA
+  dma_release_all();
+#endif
   USB0->TXIE = 1; /* Enable only EP0 */
   USB0->RXIE = 0;
   for (unsigned i = 1; i < TUP_DCD_ENDPOINT_MAX; ++i) {
@@ -756,6 +940,10 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   hw_endpoint_t volatile *regs = edpt_regs(epn - 1);
   unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
   NVIC_DisableIRQ(USB0_IRQn);
+#if CFG_TUD_MUSB_DMA
+  int const ch = dma_find_channel(ep_addr);
+  if (ch >= 0) dma_release(ch);
+#endif
   if (dir_in) {
     USB0->TXIE  &= ~TU_BIT(epn);
     regs->TXMAXP = 0;
@@ -903,6 +1091,11 @@ void dcd_int_handler(uint8_t rhport)
     process_edpt_n(rhport, tu_edpt_addr(num, TUSB_DIR_OUT));
     rxis &= ~TU_BIT(num);
   }
+#if CFG_TUD_MUSB_DMA
+  /* After the endpoints: a stale TX status latched while its DMA was
+   * running must not be mistaken for the FIFO draining afterwards. */
+  process_dma(rhport);
+#endif
 }
 
 #endif
@@ -51,6 +51,10 @@ _Pragma("GCC diagnostic ignored \"-Waddress-of-packed-member\"");
   #error "Unsupported MCUs"
 #endif
 
+#if CFG_TUH_MUSB_DMA && !TU_CHECK_MCU(OPT_MCU_MSP432E4)
+  #error "CFG_TUH_MUSB_DMA requires the integrated DMA controller of MSP432E4"
+#endif
+
 #ifndef HCD_ATTR_ENDPOINT_MAX
 # define HCD_ATTR_ENDPOINT_MAX 8
 #endif
@@ -60,6 +64,13 @@ _Pragma("GCC diagnostic ignored \"-Waddress-of-packed-member\"");
  *------------------------------------------------------------------*/
 #define REQUEST_TYPE_INVALID  (0xFFu)
 
+// Bit 7 of TXHUBADDR/RXHUBADDR: hub has multiple transaction translators
+#define HUBADDR_MULTI_TT      (0x80u)
+
+// NAK limit of a bulk IN pipe shared by several endpoints: 2^(n-1) (micro)frames
+// without data before the pipe is handed over to the next waiting endpoint
+#define SHARED_NAK_LIMIT      (4u)
+
 typedef struct {
   uint_fast16_t beg; /* offset of including first element */
   uint_fast16_t end; /* offset of excluding the last element */
@@ -110,14 +121,54 @@ typedef struct TU_ATTR_PACKED
   uint8_t ep;
 } pipe_addr_t;
 
+/* A bulk endpoint that takes turns with others on a hardware pipe once all
+ * pipes are in use. While it does not own the pipe, its register settings
+ * and transfer state are kept here. */
+typedef struct
+{
+  pipe_addr_t  addr;       /* dev is 0 when the slot is free */
+  uint8_t      pipenum;
+  bool         pending;    /* a transfer is waiting for the pipe */
+  uint8_t      hub_addr;
+  uint8_t      hub_port;
+  uint8_t      type;       /* TXTYPE/RXTYPE */
+  uint8_t      interval;   /* TXINTERVAL/RXINTERVAL */
+  uint16_t     mps;
+  uint8_t      toggle;
+  pipe_state_t state;
+} shared_ep_t;
+
+#if CFG_TUH_MUSB_DMA
+#define DMA_CHANNEL_MAX  8
+#define DMA_INTR_OFFSET  0x200u /* DMAINTR, channel registers follow with stride 0x10 */
+
+typedef struct {
+  volatile uint32_t CTL;
+  volatile uint32_t ADDR;
+  volatile uint32_t COUNT;
+  volatile uint32_t RESERVED;
+} hw_dma_channel_t;
+#endif
+
 typedef struct
 {
   bool         need_reset;     /* The device has not been reset after connection. */
+  uint16_t     frame_last;     /* The last FRAME read, used to extend the frame number to 32-bit */
+  uint32_t     frame_count;
   uint8_t      bmRequestType;
   uint8_t      ctl_mps[7]; /* EP0 max packet size for each device */
+  uint8_t      busy[2];    /* busy[direction 0:RX 1:TX], bitmap of pipes with a transfer in progress */
+  uint8_t      shared_next; /* round robin start of the search for a waiting shared endpoint */
   pipe_state_t pipe0;
   pipe_state_t pipe[7][2];   /* pipe[pipe number - 1][direction 0:RX 1:TX] */
   pipe_addr_t  addr[7][2];   /* addr[pipe number - 1][direction 0:RX 1:TX] */
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+  shared_ep_t  shared[CFG_TUH_MUSB_SHARED_EP_MAX];
+#endif
+#if CFG_TUH_MUSB_DMA
+  uint8_t      dma_pipe[DMA_CHANNEL_MAX]; /* pipe number served by each channel with bit 7 set for RX, 0 is free */
+  uint16_t     dma_len[DMA_CHANNEL_MAX];  /* the number of bytes programmed to each channel */
+#endif
 } hcd_data_t;
 
 /*------------------------------------------------------------------
@@ -217,9 +268,13 @@ static unsigned find_free_memory(uint_fast16_t size_in_log2_minus3)
     uint_fast16_t sz = free_block_size(cur);
     if (sz < size_in_8byte_unit) continue;
     if (size_in_8byte_unit == sz) return cur->beg;
-    if (sz < min_sz) min = cur;
+    if (sz < min_sz) {
+      min    = cur;
+      min_sz = sz;
+    }
   }
-  TU_ASSERT(min, 0);
+  /* Not an error by itself, the caller may retry with a smaller size */
+  TU_VERIFY(min, 0);
   return min->beg;
 }
 
@@ -352,12 +407,15 @@ static bool edpt0_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_
 static bool pipe_xfer_out(uint_fast8_t pipenum)
 {
   pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][1];
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
   unsigned const rem = pipe->remaining;
   if (!rem) {
+    /* With double packet buffering or after a DMA run, the last packet
+     * may still be waiting in the FIFO */
+    if (regs->TXCSRL & (USB_TXCSRL1_TXRDY | USB_TXCSRL1_FIFONE)) return false;
     pipe->buf = NULL;
     return true;
   }
-  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
   unsigned const mps = regs->TXMAXP;
   unsigned const len = TU_MIN(rem, mps);
   void          *buf = pipe->buf;
@@ -395,23 +453,323 @@ static bool pipe_xfer_in(uint_fast8_t pipenum)
   return false;
 }
 
-static bool edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *buffer, uint16_t buflen)
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+static inline unsigned shared_dir_tx(shared_ep_t const *s)
 {
-  (void)rhport;
-  unsigned const pipenum = find_pipe(dev_addr, ep_addr);
-  unsigned const dir_tx  = tu_edpt_dir(ep_addr) ? 0: 1;
+  return tu_edpt_dir(s->addr.ep) ? 0: 1;
+}
+
+static shared_ep_t *find_shared(uint_fast8_t dev_addr, uint_fast8_t ep_addr)
+{
+  for (unsigned i = 0; i < CFG_TUH_MUSB_SHARED_EP_MAX; ++i) {
+    shared_ep_t *s = &_hcd.shared[i];
+    if ((dev_addr == s->addr.dev) && (ep_addr == s->addr.ep)) return s;
+  }
+  return NULL;
+}
+
+/* Find an endpoint taking turns on the pipe. With waiting, only one that
+ * has a pending transfer is returned, in round robin order. */
+static shared_ep_t *find_sharer(uint_fast8_t pipenum, unsigned dir_tx, bool waiting)
+{
+  for (unsigned k = 0; k < CFG_TUH_MUSB_SHARED_EP_MAX; ++k) {
+    unsigned const i = (_hcd.shared_next + k) % CFG_TUH_MUSB_SHARED_EP_MAX;
+    shared_ep_t *s = &_hcd.shared[i];
+    if (!s->addr.dev || (pipenum != s->pipenum) || (dir_tx != shared_dir_tx(s))) continue;
+    if (waiting) {
+      if (!s->pending) continue;
+      _hcd.shared_next = (i + 1) % CFG_TUH_MUSB_SHARED_EP_MAX;
+    }
+    return s;
+  }
+  return NULL;
+}
+
+static unsigned count_sharers(uint_fast8_t pipenum, unsigned dir_tx)
+{
+  unsigned num = 0;
+  for (unsigned i = 0; i < CFG_TUH_MUSB_SHARED_EP_MAX; ++i) {
+    shared_ep_t const *s = &_hcd.shared[i];
+    if (s->addr.dev && (pipenum == s->pipenum) && (dir_tx == shared_dir_tx(s))) ++num;
+  }
+  return num;
+}
+
+/* Program the pipe registers with the settings of a shared endpoint */
+static void pipe_load(uint_fast8_t pipenum, unsigned dir_tx, shared_ep_t const *s)
+{
+  hw_addr_t volatile     *fadr = (hw_addr_t volatile*)&USB0->TXFUNCADDR0 + pipenum;
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
+  if (dir_tx) {
+    fadr->TXFUNCADDR = s->addr.dev;
+    fadr->TXHUBADDR  = s->hub_addr;
+    fadr->TXHUBPORT  = s->hub_port;
+    regs->TXMAXP     = s->mps;
+    regs->TXTYPE     = s->type;
+    regs->TXINTERVAL = s->interval;
+    regs->TXCSRH     = (regs->TXCSRH & ~USB_TXCSRH1_DT) | USB_TXCSRH1_DTWE |
+                       (s->toggle ? USB_TXCSRH1_DT: 0);
+  } else {
+    fadr->RXFUNCADDR = s->addr.dev;
+    fadr->RXHUBADDR  = s->hub_addr;
+    fadr->RXHUBPORT  = s->hub_port;
+    regs->RXMAXP     = s->mps;
+    regs->RXTYPE     = s->type;
+    regs->RXINTERVAL = s->interval;
+    regs->RXCSRH     = (regs->RXCSRH & ~USB_RXCSRH1_DT) | USB_RXCSRH1_DTWE |
+                       (s->toggle ? USB_RXCSRH1_DT: 0);
+  }
+  _hcd.addr[pipenum - 1][dir_tx] = s->addr;
+  _hcd.pipe[pipenum - 1][dir_tx] = s->state;
+}
+
+/* Read back the settings and the data toggle of the endpoint owning the pipe */
+static void pipe_save(uint_fast8_t pipenum, unsigned dir_tx, shared_ep_t *s)
+{
+  hw_addr_t volatile     *fadr = (hw_addr_t volatile*)&USB0->TXFUNCADDR0 + pipenum;
+  hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
+  if (dir_tx) {
+    s->hub_addr = fadr->TXHUBADDR;
+    s->hub_port = fadr->TXHUBPORT;
+    s->mps      = regs->TXMAXP;
+    s->type     = regs->TXTYPE;
+    s->interval = regs->TXINTERVAL;
+    s->toggle   = (regs->TXCSRH & USB_TXCSRH1_DT) ? 1: 0;
+  } else {
+    s->hub_addr = fadr->RXHUBADDR;
+    s->hub_port = fadr->RXHUBPORT;
+    s->mps      = regs->RXMAXP;
+    s->type     = regs->RXTYPE;
+    s->interval = regs->RXINTERVAL;
+    s->toggle   = (regs->RXCSRH & USB_RXCSRH1_DT) ? 1: 0;
+  }
+  s->pipenum = pipenum;
+  s->addr    = _hcd.addr[pipenum - 1][dir_tx];
+  s->state   = _hcd.pipe[pipenum - 1][dir_tx];
+}
+
+/* Hand the idle pipe over to the shared endpoint s. The endpoint owning the
+ * pipe so far takes the place of s and waits for its next turn if pending. */
+static void pipe_swap(uint_fast8_t pipenum, unsigned dir_tx, shared_ep_t *s, bool pending)
+{
+  shared_ep_t prev;
+  pipe_save(pipenum, dir_tx, &prev);
+  prev.pending = pending;
+  pipe_load(pipenum, dir_tx, s);
+  *s = prev;
+}
+
+/* All pipes are in use: let the bulk endpoint take turns on the pipe of the
+ * same direction with the fewest sharers whose FIFO can hold its packets. */
+static bool shared_ep_open(uint_fast8_t dev_addr, uint_fast8_t ep_addr, uint8_t type,
+                           unsigned mps, uint8_t hub_addr, uint8_t hub_port)
+{
+  unsigned const dir_tx = tu_edpt_dir(ep_addr) ? 0: 1;
+  bool ret = false;
+
+  unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
+  NVIC_DisableIRQ(USB0_IRQn);
+  shared_ep_t *s = find_shared(0, 0);
+  unsigned pipenum = 0;
+  unsigned min_num = UINT8_MAX;
+  for (unsigned i = 1; s && i < HCD_ATTR_ENDPOINT_MAX; ++i) {
+    hw_endpoint_t volatile *regs = edpt_regs(i - 1);
+    unsigned const pipe_type = dir_tx ? regs->TXTYPE: regs->RXTYPE;
+    if ((pipe_type & USB_TXTYPE1_PROTO_M) != USB_TXTYPE1_PROTO_BULK) continue;
+    USB0->EPIDX = i;
+    unsigned const sz = (dir_tx ? USB0->TXFIFOSZ: USB0->RXFIFOSZ) & USB_TXFIFOSZ_SIZE_M;
+    if ((8u << sz) < mps) continue;
+    unsigned const num = count_sharers(i, dir_tx);
+    if (num < min_num) {
+      min_num = num;
+      pipenum = i;
+    }
+  }
+  if (pipenum) {
+    s->pipenum   = pipenum;
+    s->pending   = false;
+    s->hub_addr  = hub_addr;
+    s->hub_port  = hub_port;
+    s->type      = type;
+    s->mps       = mps;
+    s->toggle    = 0;
+    s->state.buf       = NULL;
+    s->state.length    = 0;
+    s->state.remaining = 0;
+    if (dir_tx) {
+      s->interval = 0;
+    } else {
+      /* A bulk IN endpoint has to give up the pipe while its device has
+       * nothing to send, the owner included */
+      s->interval = SHARED_NAK_LIMIT;
+      edpt_regs(pipenum - 1)->RXINTERVAL = SHARED_NAK_LIMIT;
+    }
+    s->addr.dev  = dev_addr;
+    s->addr.ep   = ep_addr;
+    ret = true;
+  }
+  if (ie) NVIC_EnableIRQ(USB0_IRQn);
+  TU_ASSERT(ret);
+  return true;
+}
+#endif
+
+#if CFG_TUH_MUSB_DMA
+static inline volatile hw_dma_channel_t* dma_regs(unsigned ch)
+{
+  return (volatile hw_dma_channel_t*)((uintptr_t)USB0 + DMA_INTR_OFFSET + 4u) + ch;
+}
+
+/* pipe_addr is the pipe number with bit 7 set for RX, like an endpoint address */
+static int dma_find_channel(uint_fast8_t pipe_addr)
+{
+  for (unsigned ch = 0; ch < DMA_CHANNEL_MAX; ++ch) {
+    if (_hcd.dma_pipe[ch] == pipe_addr) return (int)ch;
+  }
+  return -1;
+}
+
+/* Stop the channel and return the pipe to CPU driven transfers */
+static void dma_release(unsigned ch)
+{
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  unsigned const pipenum = tu_edpt_number(_hcd.dma_pipe[ch]);
+  unsigned const dir_tx  = tu_edpt_dir(_hcd.dma_pipe[ch]) ? 0: 1;
+  volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
   pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
-  pipe->buf          = buffer;
-  pipe->length       = buflen;
-  pipe->remaining    = buflen;
+
+  dma->CTL = 0;
+  unsigned const done = TU_MIN(_hcd.dma_len[ch], dma->ADDR - (uintptr_t)pipe->buf);
+  /* DMAMOD must not be cleared in the same write as DMAEN */
   if (dir_tx) {
-    pipe_xfer_out(pipenum);
+    regs->TXCSRH &= ~(USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN);
+    regs->TXCSRH &= ~USB_TXCSRH1_DMAMOD;
+    USB0->TXIE   |= TU_BIT(pipenum);
   } else {
-    volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
-    regs->RXCSRL = USB_RXCSRL1_REQPKT;
+    regs->RXCSRH &= ~(USB_RXCSRH1_AUTOCL | USB_RXCSRH1_AUTORQ | USB_RXCSRH1_DMAEN);
+    regs->RXCSRH &= ~USB_RXCSRH1_DMAMOD;
   }
+  _hcd.dma_pipe[ch] = 0;
+  pipe->buf       = (uint8_t*)pipe->buf + done;
+  pipe->remaining = pipe->remaining - done;
+}
+
+/* Hand the full packets of a bulk transfer over to a free DMA channel in
+ * request mode 1. The controller then loads or unloads every packet by
+ * itself (AUTOSET, AUTOCL/AUTORQ), and the CPU sees one DMA interrupt for
+ * the run instead of one pipe interrupt per packet. */
+static bool dma_xfer_start(uint_fast8_t pipenum, unsigned dir_tx)
+{
+  pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
+  volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
+
+  if ((uintptr_t)pipe->buf & 3u) return false; /* DMA works in words */
+  unsigned const type = dir_tx ? regs->TXTYPE: regs->RXTYPE;
+  if ((type & USB_TXTYPE1_PROTO_M) != USB_TXTYPE1_PROTO_BULK) return false;
+
+  unsigned const mps = dir_tx ? regs->TXMAXP: regs->RXMAXP;
+  if (mps & 3u) return false;
+  unsigned len = pipe->remaining - pipe->remaining % mps;
+  /* AUTORQ requests one more packet after the DMA has unloaded its last
+   * one, so the final full packet of an IN transfer is left to the CPU */
+  if (!dir_tx && len) len -= mps;
+  if (len < 2 * mps) return false; /* Not worth it */
+
+  int const ch = dma_find_channel(0);
+  if (ch < 0) return false;
+
+  _hcd.dma_pipe[ch] = tu_edpt_addr(pipenum, dir_tx ? TUSB_DIR_OUT: TUSB_DIR_IN);
+  _hcd.dma_len[ch]  = len;
+  volatile hw_dma_channel_t *dma = dma_regs(ch);
+  dma->ADDR  = (uintptr_t)pipe->buf;
+  dma->COUNT = len;
+  if (dir_tx) {
+    /* Pipe interrupts are meaningless until the DMA has finished */
+    USB0->TXIE   &= ~TU_BIT(pipenum);
+    regs->TXCSRH |= USB_TXCSRH1_DMAMOD;
+    regs->TXCSRH |= USB_TXCSRH1_AUTOSET | USB_TXCSRH1_DMAEN;
+  } else {
+    /* In mode 1 the pipe interrupt fires only for a short packet */
+    regs->RXCSRH |= USB_RXCSRH1_DMAMOD;
+    regs->RXCSRH |= USB_RXCSRH1_AUTOCL | USB_RXCSRH1_AUTORQ | USB_RXCSRH1_DMAEN;
+  }
+  dma->CTL = (pipenum << USB_DMACTL0_EP_S) |
+             (dir_tx ? USB_DMACTL0_DIR: 0) |
+             USB_DMACTL0_MODE | USB_DMACTL0_IE | USB_DMACTL0_ENABLE;
   return true;
 }
+#endif
+
+/* Start the transfer prepared in _hcd.pipe on the pipe */
+static void pipe_start(uint_fast8_t pipenum, unsigned dir_tx)
+{
+  volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
+  _hcd.busy[dir_tx] |= TU_BIT(pipenum);
+#if CFG_TUH_MUSB_DMA
+  bool const dma = dma_xfer_start(pipenum, dir_tx);
+#else
+  bool const dma = false;
+#endif
+  if (dir_tx) {
+    if (!_hcd.pipe[pipenum - 1][1].remaining)
+      regs->TXCSRL = USB_TXCSRL1_TXRDY; /* zero length packet */
+    else if (!dma)
+      pipe_xfer_out(pipenum);
+  } else {
+    regs->RXCSRL = USB_RXCSRL1_REQPKT;
+  }
+}
+
+/* Give an idle pipe to the next shared endpoint waiting for it */
+static void pipe_schedule(uint_fast8_t pipenum, unsigned dir_tx)
+{
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+  if (_hcd.busy[dir_tx] & TU_BIT(pipenum)) return;
+  shared_ep_t *s = find_sharer(pipenum, dir_tx, true);
+  if (!s) return;
+  pipe_swap(pipenum, dir_tx, s, false);
+  pipe_start(pipenum, dir_tx);
+#else
+  (void)pipenum;
+  (void)dir_tx;
+#endif
+}
+
+static bool edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *buffer, uint16_t buflen)
+{
+  (void)rhport;
+  unsigned const dir_tx = tu_edpt_dir(ep_addr) ? 0: 1;
+  pipe_state_t const state = {
+    .buf       = buffer,
+    .length    = buflen,
+    .remaining = buflen
+  };
+  bool ret = true;
+
+  /* The ISR hands shared pipes over between endpoints */
+  unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
+  NVIC_DisableIRQ(USB0_IRQn);
+  unsigned const pipenum = find_pipe(dev_addr, ep_addr);
+  if (pipenum) {
+    _hcd.pipe[pipenum - 1][dir_tx] = state;
+    pipe_start(pipenum, dir_tx);
+  } else {
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+    shared_ep_t *s = find_shared(dev_addr, ep_addr);
+    if (s) {
+      s->state   = state;
+      s->pending = true;
+      pipe_schedule(s->pipenum, dir_tx);
+    } else {
+      ret = false;
+    }
+#else
+    ret = false;
+#endif
+  }
+  if (ie) NVIC_EnableIRQ(USB0_IRQn);
+  return ret;
+}
 
 static void process_ep0(uint8_t rhport)
 {
@@ -500,6 +858,40 @@ static void process_ep0(uint8_t rhport)
   }
 }
 
+static void pipe_complete(uint_fast8_t pipenum, unsigned dir_tx, xfer_result_t result)
+{
+  pipe_addr_t  *addr = &_hcd.addr[pipenum - 1][dir_tx];
+  pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
+  _hcd.busy[dir_tx] &= ~TU_BIT(pipenum);
+  hcd_event_xfer_complete(addr->dev, addr->ep,
+                          pipe->length - pipe->remaining,
+                          result, true);
+  pipe_schedule(pipenum, dir_tx);
+}
+
+/* A bulk IN pipe got nothing but NAKs for its NAK limit. When it is shared,
+ * the next waiting endpoint gets the pipe, and the interrupted transfer
+ * resumes on its next turn. */
+static void pipe_rx_nak_timeout(uint_fast8_t pipenum)
+{
+  volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+  shared_ep_t *s = find_sharer(pipenum, 0, true);
+  if (s) {
+#if CFG_TUH_MUSB_DMA
+    int const ch = dma_find_channel(tu_edpt_addr(pipenum, TUSB_DIR_IN));
+    if (ch >= 0) dma_release(ch);
+#endif
+    regs->RXCSRL = 0; /* Stop requesting and clear NAKTO */
+    _hcd.busy[0] &= ~TU_BIT(pipenum);
+    pipe_swap(pipenum, 0, s, true);
+    pipe_start(pipenum, 0);
+    return;
+  }
+#endif
+  regs->RXCSRL = USB_RXCSRL1_REQPKT; /* Clear NAKTO and keep on requesting */
+}
+
 static void process_pipe_tx(uint8_t rhport, uint_fast8_t pipenum)
 {
   (void)rhport;
@@ -510,23 +902,25 @@ static void process_pipe_tx(uint8_t rhport, uint_fast8_t pipenum)
   unsigned const csrl = regs->TXCSRL;
   // TU_LOG1(" TXCSRL%d = %x\r\n", pipenum, csrl);
   if (csrl & (USB_TXCSRL1_STALLED | USB_TXCSRL1_ERROR)) {
+#if CFG_TUH_MUSB_DMA
+    int const ch = dma_find_channel(tu_edpt_addr(pipenum, TUSB_DIR_OUT));
+    if (ch >= 0) dma_release(ch);
+#endif
     if (csrl & USB_TXCSRL1_TXRDY)
       regs->TXCSRL = (csrl & ~(USB_TXCSRL1_STALLED | USB_TXCSRL1_ERROR)) | USB_TXCSRL1_FLUSH;
     else
       regs->TXCSRL = csrl & ~(USB_TXCSRL1_STALLED | USB_TXCSRL1_ERROR);
     completed = true;
     result    = (csrl & USB_TXCSRL1_STALLED) ? XFER_RESULT_STALLED: XFER_RESULT_FAILED;
+  } else if (csrl & USB_TXCSRL1_NAKTO) {
+    /* The pipe halts until NAKTO is cleared */
+    regs->TXCSRL = csrl & ~USB_TXCSRL1_NAKTO;
+    return;
   } else {
     completed = pipe_xfer_out(pipenum);
     result    = XFER_RESULT_SUCCESS;
   }
-  if (completed) {
-    pipe_addr_t  *addr = &_hcd.addr[pipenum - 1][1];
-    pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][1];
-    hcd_event_xfer_complete(addr->dev, addr->ep,
-                            pipe->length - pipe->remaining,
-                            result, true);
-  }
+  if (completed) pipe_complete(pipenum, 1, result);
 }
 
 static void process_pipe_rx(uint8_t rhport, uint_fast8_t pipenum)
@@ -537,26 +931,75 @@ static void process_pipe_rx(uint8_t rhport, uint_fast8_t pipenum)
 
   volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
   unsigned const csrl = regs->RXCSRL;
+#if CFG_TUH_MUSB_DMA
+  int const ch = dma_find_channel(tu_edpt_addr(pipenum, TUSB_DIR_IN));
+#endif
   // TU_LOG1(" RXCSRL%d = %x\r\n", pipenum, csrl);
   if (csrl & (USB_RXCSRL1_STALLED | USB_RXCSRL1_ERROR)) {
+#if CFG_TUH_MUSB_DMA
+    if (ch >= 0) dma_release(ch);
+#endif
     if (csrl & USB_RXCSRL1_RXRDY)
       regs->RXCSRL = (csrl & ~(USB_RXCSRL1_STALLED | USB_RXCSRL1_ERROR)) | USB_RXCSRL1_FLUSH;
     else
       regs->RXCSRL = csrl & ~(USB_RXCSRL1_STALLED | USB_RXCSRL1_ERROR);
     completed = true;
     result    = (csrl & USB_RXCSRL1_STALLED) ? XFER_RESULT_STALLED: XFER_RESULT_FAILED;
+  } else if ((csrl & (USB_RXCSRL1_NAKTO | USB_RXCSRL1_RXRDY)) == USB_RXCSRL1_NAKTO) {
+    pipe_rx_nak_timeout(pipenum);
+    return;
   } else {
+#if CFG_TUH_MUSB_DMA
+    if (ch >= 0) {
+      /* A full packet is unloaded by the DMA, a short one ends the run early */
+      if (!(csrl & USB_RXCSRL1_RXRDY) || regs->RXCOUNT == regs->RXMAXP) return;
+      dma_release(ch);
+    }
+#endif
     completed = pipe_xfer_in(pipenum);
     result    = XFER_RESULT_SUCCESS;
   }
-  if (completed) {
-    pipe_addr_t  *addr = &_hcd.addr[pipenum - 1][0];
-    pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][0];
-    hcd_event_xfer_complete(addr->dev, addr->ep,
-                            pipe->length - pipe->remaining,
-                            result, true);
+  if (completed) pipe_complete(pipenum, 0, result);
+}
+
+#if CFG_TUH_MUSB_DMA
+static void process_dma(void)
+{
+  unsigned intr = *(volatile uint32_t const*)((uintptr_t)USB0 + DMA_INTR_OFFSET); /* read and clear */
+  while (intr) {
+    unsigned const ch = __builtin_ctz(intr);
+    intr &= ~TU_BIT(ch);
+    unsigned const pipe_addr = _hcd.dma_pipe[ch];
+    if (!pipe_addr) continue;
+
+    unsigned const pipenum = tu_edpt_number(pipe_addr);
+    unsigned const dir_tx  = tu_edpt_dir(pipe_addr) ? 0: 1;
+    volatile hw_endpoint_t *regs = edpt_regs(pipenum - 1);
+    bool const err = dma_regs(ch)->CTL & USB_DMACTL0_ERR;
+    dma_release(ch);
+
+    bool completed = false;
+    if (err) {
+      if (dir_tx) {
+        if (regs->TXCSRL & USB_TXCSRL1_TXRDY) regs->TXCSRL = USB_TXCSRL1_FLUSH;
+      } else {
+        regs->RXCSRL = (regs->RXCSRL & USB_RXCSRL1_RXRDY) ? USB_RXCSRL1_FLUSH: 0;
+      }
+      pipe_complete(pipenum, dir_tx, XFER_RESULT_FAILED);
+      continue;
+    }
+    if (dir_tx) {
+      /* Otherwise the pipe interrupt continues once the FIFO drains */
+      if (!(regs->TXCSRL & USB_TXCSRL1_TXRDY)) completed = pipe_xfer_out(pipenum);
+    } else if (regs->RXCSRL & USB_RXCSRL1_RXRDY) {
+      completed = pipe_xfer_in(pipenum);
+    } else if (!(regs->RXCSRL & USB_RXCSRL1_REQPKT)) {
+      regs->RXCSRL = USB_RXCSRL1_REQPKT;
+    }
+    if (completed) pipe_complete(pipenum, dir_tx, XFER_RESULT_SUCCESS);
   }
 }
+#endif
 
 /*------------------------------------------------------------------
  * Host API
@@ -591,7 +1034,11 @@ uint32_t hcd_frame_number(uint8_t rhport)
   /* The device must be reset at least once after connection
    * in order to start the frame counter. */
   if (_hcd.need_reset) hcd_port_reset(rhport);
-  return USB0->FRAME;
+  /* Extend 11-bit hardware frame number to 32-bit */
+  uint16_t const frnum = USB0->FRAME;
+  _hcd.frame_count += (uint16_t)(frnum - _hcd.frame_last) & 0x7FFu;
+  _hcd.frame_last   = frnum;
+  return _hcd.frame_count;
 }
 
 //--------------------------------------------------------------------+
@@ -640,7 +1087,20 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
   unsigned const ie = NVIC_GetEnableIRQ(USB0_IRQn);
   NVIC_DisableIRQ(USB0_IRQn);
   _hcd.ctl_mps[dev_addr] = 0;
-  if (!dev_addr) return;
+  if (!dev_addr) {
+    if (ie) NVIC_EnableIRQ(USB0_IRQn);
+    return;
+  }
+
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+  for (unsigned i = 0; i < CFG_TUH_MUSB_SHARED_EP_MAX; ++i) {
+    shared_ep_t *s = &_hcd.shared[i];
+    if (dev_addr != s->addr.dev) continue;
+    s->addr.dev = 0;
+    s->addr.ep  = 0;
+    s->pending  = false;
+  }
+#endif
 
   pipe_addr_t *p = &_hcd.addr[0][0];
   for (unsigned i = 0; i < sizeof(_hcd.addr)/sizeof(_hcd.addr[0]); ++i) {
@@ -648,6 +1108,29 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
       if (dev_addr != p->dev) continue;
       hw_addr_t volatile     *fadr = (hw_addr_t volatile*)&USB0->TXFUNCADDR0 + i + 1;
       hw_endpoint_t volatile *regs = edpt_regs(i);
+#if CFG_TUH_MUSB_DMA
+      int const ch = dma_find_channel(tu_edpt_addr(i + 1, j ? TUSB_DIR_OUT: TUSB_DIR_IN));
+      if (ch >= 0) dma_release(ch);
+#endif
+      _hcd.busy[j] &= ~TU_BIT(i + 1);
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+      shared_ep_t *s = find_sharer(i + 1, j, false);
+      if (s) {
+        /* Another endpoint taking turns on the pipe inherits it along with its FIFO */
+        if (j) {
+          if (regs->TXCSRL & USB_TXCSRL1_TXRDY) regs->TXCSRL = USB_TXCSRL1_FLUSH;
+        } else {
+          regs->RXCSRL = (regs->RXCSRL & USB_RXCSRL1_RXRDY) ? USB_RXCSRL1_FLUSH: 0;
+        }
+        bool const pending = s->pending;
+        pipe_load(i + 1, j, s);
+        s->addr.dev = 0;
+        s->addr.ep  = 0;
+        s->pending  = false;
+        if (pending) pipe_start(i + 1, j);
+        continue;
+      }
+#endif
       USB0->EPIDX = i + 1;
       if (j) {
         USB0->TXIE      &= ~TU_BIT(i + 1);
@@ -709,7 +1192,7 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
     case TUSB_SPEED_FULL: USB0->TYPE0 = USB_TYPE0_SPEED_FULL; break;
     case TUSB_SPEED_HIGH: USB0->TYPE0 = USB_TYPE0_SPEED_HIGH; break;
   }
-  USB0->TXHUBADDR0     = devtree.hub_addr;
+  USB0->TXHUBADDR0     = (uint8_t) (devtree.hub_addr | (devtree.multi_tt ? HUBADDR_MULTI_TT : 0));
   USB0->TXHUBPORT0     = devtree.hub_port;
   USB0->TXFUNCADDR0    = dev_addr;
   USB0->CSRL0 = USB_CSRL0_TXRDY | USB_CSRL0_SETUP;
@@ -728,26 +1211,8 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
   }
 
   unsigned const dir_tx = tu_edpt_dir(ep_addr) ? 0: 1;
-  /* Find a free pipe */
-  unsigned pipenum = 0;
-  pipe_addr_t *p = &_hcd.addr[0][dir_tx];
-  for (unsigned i = 0; i < sizeof(_hcd.addr)/sizeof(_hcd.addr[0]); ++i, p += 2) {
-    if (0 == p->ep) {
-      p->dev  = dev_addr;
-      p->ep   = ep_addr;
-      pipenum = i + 1;
-      break;
-    }
-  }
-  if (!pipenum) return false;
-
-  unsigned const xfer = ep_desc->bmAttributes.xfer;
-  unsigned const mps  = tu_edpt_packet_size(ep_desc);
-
-  pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
-  pipe->buf       = NULL;
-  pipe->length    = 0;
-  pipe->remaining = 0;
+  unsigned const xfer   = ep_desc->bmAttributes.xfer;
+  unsigned const mps    = tu_edpt_packet_size(ep_desc);
 
   uint8_t pipe_type = 0;
   hcd_devtree_info_t devtree;
@@ -764,12 +1229,40 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     case TUSB_XFER_INTERRUPT:   pipe_type |= USB_TXTYPE1_PROTO_INT;  break;
     case TUSB_XFER_ISOCHRONOUS: pipe_type |= USB_TXTYPE1_PROTO_ISOC; break;
   }
+  uint8_t const hub_addr = (uint8_t) (devtree.hub_addr | (devtree.multi_tt ? HUBADDR_MULTI_TT : 0));
+
+  /* Find a free pipe */
+  unsigned pipenum = 0;
+  pipe_addr_t *p = &_hcd.addr[0][dir_tx];
+  for (unsigned i = 0; i < sizeof(_hcd.addr)/sizeof(_hcd.addr[0]); ++i, p += 2) {
+    if (0 == p->ep) {
+      p->dev  = dev_addr;
+      p->ep   = ep_addr;
+      pipenum = i + 1;
+      break;
+    }
+  }
+  if (!pipenum) {
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+    /* Several devices behind a hub easily use up all pipes, bulk endpoints
+     * can still take turns on one */
+    TU_VERIFY(TUSB_XFER_BULK == xfer);
+    return shared_ep_open(dev_addr, ep_addr, pipe_type | epn, mps, hub_addr, devtree.hub_port);
+#else
+    return false;
+#endif
+  }
+
+  pipe_state_t *pipe = &_hcd.pipe[pipenum - 1][dir_tx];
+  pipe->buf       = NULL;
+  pipe->length    = 0;
+  pipe->remaining = 0;
 
   hw_addr_t volatile     *fadr = (hw_addr_t volatile*)&USB0->TXFUNCADDR0 + pipenum;
   hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
   if (dir_tx) {
     fadr->TXFUNCADDR = dev_addr;
-    fadr->TXHUBADDR  = devtree.hub_addr;
+    fadr->TXHUBADDR  = hub_addr;
     fadr->TXHUBPORT  = devtree.hub_port;
     regs->TXMAXP     = mps;
     regs->TXTYPE     = pipe_type | epn;
@@ -781,7 +1274,7 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     USB0->TXIE |= TU_BIT(pipenum);
   } else {
     fadr->RXFUNCADDR = dev_addr;
-    fadr->RXHUBADDR  = devtree.hub_addr;
+    fadr->RXHUBADDR  = hub_addr;
     fadr->RXHUBPORT  = devtree.hub_port;
     regs->RXMAXP     = mps;
     regs->RXTYPE     = pipe_type | epn;
@@ -793,19 +1286,36 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     USB0->RXIE |= TU_BIT(pipenum);
   }
 
-  /* Setup FIFO */
+  /* Setup FIFO. Bulk pipes get double packet buffering when the FIFO RAM
+   * has room for it, so the next packet can be loaded or received while
+   * the other one is on the bus. */
   int size_in_log2_minus3 = 28 - TU_MIN(28, __CLZ((uint32_t)mps));
   if ((8u << size_in_log2_minus3) < mps) ++size_in_log2_minus3;
-  unsigned addr = find_free_memory(size_in_log2_minus3);
-  TU_ASSERT(addr);
+  unsigned fifosz = size_in_log2_minus3;
+  unsigned addr   = 0;
+  if (xfer == TUSB_XFER_BULK) {
+    addr = find_free_memory(size_in_log2_minus3 + 1);
+    if (addr) fifosz |= USB_TXFIFOSZ_DPB; /* Same bit position for RXFIFOSZ */
+  }
+  if (!addr) addr = find_free_memory(size_in_log2_minus3);
+  if (!addr) {
+    /* Out of FIFO RAM, give the pipe back */
+    if (dir_tx)
+      USB0->TXIE &= ~TU_BIT(pipenum);
+    else
+      USB0->RXIE &= ~TU_BIT(pipenum);
+    p->dev = 0;
+    p->ep  = 0;
+    TU_ASSERT(false);
+  }
 
   USB0->EPIDX = pipenum;
   if (dir_tx) {
     USB0->TXFIFOADD = addr;
-    USB0->TXFIFOSZ  = size_in_log2_minus3;
+    USB0->TXFIFOSZ  = fifosz;
   } else {
     USB0->RXFIFOADD = addr;
-    USB0->RXFIFOSZ  = size_in_log2_minus3;
+    USB0->RXFIFOSZ  = fifosz;
   }
   return true;
 }
@@ -834,7 +1344,17 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
   (void) rhport;
   unsigned const pipenum = find_pipe(dev_addr, ep_addr);
-  if (!pipenum) return false;
+  if (!pipenum) {
+#if CFG_TUH_MUSB_SHARED_EP_MAX
+    /* Not on the pipe right now, the toggle is restored on its next turn */
+    shared_ep_t *s = find_shared(dev_addr, ep_addr);
+    TU_VERIFY(s);
+    s->toggle = 0;
+    return true;
+#else
+    return false;
+#endif
+  }
   hw_endpoint_t volatile *regs = edpt_regs(pipenum - 1);
   unsigned const dir_tx = tu_edpt_dir(ep_addr) ? 0: 1;
   if (dir_tx)
@@ -886,6 +1406,11 @@ void hcd_int_handler(uint8_t rhport, bool in_isr)
     process_pipe_rx(rhport, num);
     rxis &= ~TU_BIT(num);
   }
+#if CFG_TUH_MUSB_DMA
+  /* After the pipes: a stale TX status latched while its DMA was
+   * running must not be mistaken for the FIFO draining afterwards. */
+  process_dma();
+#endif
 }
 
 #endif
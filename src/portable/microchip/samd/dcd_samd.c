@@ -39,6 +39,24 @@
  *------------------------------------------------------------------*/
 static TU_ATTR_ALIGNED(4) UsbDeviceDescBank sram_registers[8][2];
 
+// Bulk and ISO endpoints use dual-bank (ping-pong) mode when usbd can chain transfers: each bank holds one
+// transfer and controller toggles to the other bank by itself, without NAKing while the ISR re-arms the descriptor.
+// Both banks then belong to the same direction, therefore it is only possible if the endpoint number is not
+// used in the opposite direction.
+#define DUAL_BANK_ENABLED   (DCD_EDPT_XFER_DEPTH > 1)
+#define EPTYPE_DUAL_BANK    5
+
+typedef struct {
+  uint8_t* buffer;        // transfer waiting for the bank in single-bank mode
+  uint16_t total_bytes;
+  uint8_t dual_bank : 1;
+  uint8_t next_bank : 1;  // bank of next submitted transfer (dual-bank)
+  uint8_t done_bank : 1;  // bank of oldest transfer in progress (dual-bank)
+  uint8_t count     : 2;  // transfers in progress, up to DCD_EDPT_XFER_DEPTH
+} xfer_ctl_t;
+
+static xfer_ctl_t _xfer_ctl[8][2];
+
 // Setup packet is only 8 bytes in length. However under certain scenario,
 // USB DMA controller may decide to overwrite/overflow the buffer  with
 // 2 extra bytes of CRC. From datasheet's "Management of SETUP Transactions" section
@@ -71,10 +89,35 @@ static void bus_reset(void)
   ep->EPCFG.reg = USB_DEVICE_EPCFG_EPTYPE0(0x1) | USB_DEVICE_EPCFG_EPTYPE1(0x1);
   ep->EPINTENSET.reg = USB_DEVICE_EPINTENSET_TRCPT0 | USB_DEVICE_EPINTENSET_TRCPT1 | USB_DEVICE_EPINTENSET_RXSTP;
 
+  dcd_edpt_close_all(0);
+
   // Prepare for setup packet
   prepare_setup();
 }
 
+// Program a bank with a transfer and hand it to controller
+static void bank_xfer(uint8_t epnum, uint8_t dir, uint8_t bank, uint8_t* buffer, uint16_t total_bytes)
+{
+  UsbDeviceDescBank* desc = &sram_registers[epnum][bank];
+  UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
+
+  desc->ADDR.reg = (uint32_t) buffer;
+
+  if ( dir == TUSB_DIR_OUT )
+  {
+    desc->PCKSIZE.bit.MULTI_PACKET_SIZE = total_bytes;
+    desc->PCKSIZE.bit.BYTE_COUNT = 0;
+    ep->EPINTFLAG.reg = (uint8_t) (USB_DEVICE_EPINTFLAG_TRFAIL0 << bank);
+    ep->EPSTATUSCLR.reg = (uint8_t) (USB_DEVICE_EPSTATUSCLR_BK0RDY << bank);
+  } else
+  {
+    desc->PCKSIZE.bit.MULTI_PACKET_SIZE = 0;
+    desc->PCKSIZE.bit.BYTE_COUNT = total_bytes;
+    ep->EPINTFLAG.reg = (uint8_t) (USB_DEVICE_EPINTFLAG_TRFAIL0 << bank);
+    ep->EPSTATUSSET.reg = (uint8_t) (USB_DEVICE_EPSTATUSSET_BK0RDY << bank);
+  }
+}
+
 /*------------------------------------------------------------------*/
 /* Controller API
  *------------------------------------------------------------------*/
@@ -234,19 +277,49 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * desc_edpt)
   bank->PCKSIZE.bit.SIZE = size_value;
 
   UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
+  uint8_t const eptype = desc_edpt->bmAttributes.xfer + 1;
+
+  xfer_ctl_t* xfer = &_xfer_ctl[epnum][dir];
+  tu_memclr(xfer, sizeof(xfer_ctl_t));
+
+  // opposite direction of the same number may have been opened in dual-bank mode: it is back to single bank
+  // since its borrowed bank is taken by this direction below
+  _xfer_ctl[epnum][1 - dir].dual_bank = 0;
+
+#if DUAL_BANK_ENABLED
+  uint8_t const xfer_type = desc_edpt->bmAttributes.xfer;
+  uint8_t const opposite_eptype = (dir == TUSB_DIR_OUT) ? ep->EPCFG.bit.EPTYPE1 : ep->EPCFG.bit.EPTYPE0;
+  if ( epnum && opposite_eptype == 0 && (xfer_type == TUSB_XFER_BULK || xfer_type == TUSB_XFER_ISOCHRONOUS) )
+  {
+    // other bank is used by this direction as well
+    xfer->dual_bank = 1;
+    sram_registers[epnum][1 - dir].PCKSIZE.bit.SIZE = size_value;
+  }
+#endif
 
   if ( dir == TUSB_DIR_OUT )
   {
-    ep->EPCFG.bit.EPTYPE0 = desc_edpt->bmAttributes.xfer + 1;
+    ep->EPCFG.bit.EPTYPE0 = eptype;
+    if ( xfer->dual_bank ) ep->EPCFG.bit.EPTYPE1 = EPTYPE_DUAL_BANK;
     ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_STALLRQ0 | USB_DEVICE_EPSTATUSCLR_DTGLOUT; // clear stall & dtoggle
+    ep->EPSTATUSSET.reg = USB_DEVICE_EPSTATUSSET_BK0RDY | (xfer->dual_bank ? USB_DEVICE_EPSTATUSSET_BK1RDY : 0); // banks not ready
     ep->EPINTENSET.bit.TRCPT0 = true;
   }else
   {
-    ep->EPCFG.bit.EPTYPE1 = desc_edpt->bmAttributes.xfer + 1;
+    ep->EPCFG.bit.EPTYPE1 = eptype;
+    if ( xfer->dual_bank ) ep->EPCFG.bit.EPTYPE0 = EPTYPE_DUAL_BANK;
     ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_STALLRQ1 | USB_DEVICE_EPSTATUSCLR_DTGLIN; // clear stall & dtoggle
+    ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_BK1RDY | (xfer->dual_bank ? USB_DEVICE_EPSTATUSCLR_BK0RDY : 0); // banks empty
     ep->EPINTENSET.bit.TRCPT1 = true;
   }
 
+  if ( xfer->dual_bank )
+  {
+    // start with bank 0
+    ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_CURBK;
+    ep->EPINTENSET.reg = USB_DEVICE_EPINTENSET_TRCPT0 | USB_DEVICE_EPINTENSET_TRCPT1;
+  }
+
   return true;
 }
 
@@ -260,7 +333,16 @@ void dcd_edpt_close (uint8_t rhport, uint8_t ep_addr) {
 void dcd_edpt_close_all (uint8_t rhport)
 {
   (void) rhport;
-  // TODO implement dcd_edpt_close_all()
+
+  // disable all non-control endpoints, also frees banks borrowed by dual-bank mode
+  for ( uint8_t epnum = 1; epnum < USB_EPT_NUM; epnum++ )
+  {
+    UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
+    ep->EPINTENCLR.reg = USB_DEVICE_EPINTENCLR_TRCPT0 | USB_DEVICE_EPINTENCLR_TRCPT1;
+    ep->EPCFG.reg = 0;
+    ep->EPINTFLAG.reg = USB_DEVICE_EPINTFLAG_TRCPT0 | USB_DEVICE_EPINTFLAG_TRCPT1;
+  }
+  tu_memclr(_xfer_ctl, sizeof(_xfer_ctl));
 }
 
 bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes)
@@ -270,6 +352,30 @@ bool dcd_edpt_xfer (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
+  if ( epnum )
+  {
+    xfer_ctl_t* xfer = &_xfer_ctl[epnum][dir];
+    TU_ASSERT(xfer->count < DCD_EDPT_XFER_DEPTH);
+
+    if ( xfer->dual_bank )
+    {
+      // hand to the next bank, controller switches to it when current one is complete
+      bank_xfer(epnum, dir, xfer->next_bank, buffer, total_bytes);
+      xfer->next_bank ^= 1;
+    } else if ( xfer->count == 0 )
+    {
+      bank_xfer(epnum, dir, dir, buffer, total_bytes);
+    } else
+    {
+      // started from ISR when the bank is complete
+      xfer->buffer = buffer;
+      xfer->total_bytes = total_bytes;
+    }
+    xfer->count++;
+
+    return true;
+  }
+
   UsbDeviceDescBank* bank = &sram_registers[epnum][dir];
   UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
 
@@ -325,11 +431,61 @@ void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr)
   } else {
     ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_STALLRQ0 | USB_DEVICE_EPSTATUSCLR_DTGLOUT;
   }
+
+  // usbd drops transfers in progress when clearing stall, forget them as well
+  if ( epnum )
+  {
+    uint8_t const dir = tu_edpt_dir(ep_addr);
+    xfer_ctl_t* xfer = &_xfer_ctl[epnum][dir];
+    if ( xfer->dual_bank )
+    {
+      // banks are not ready, controller continues with the bank it was waiting for
+      if ( dir == TUSB_DIR_OUT )
+      {
+        ep->EPSTATUSSET.reg = USB_DEVICE_EPSTATUSSET_BK0RDY | USB_DEVICE_EPSTATUSSET_BK1RDY;
+      } else
+      {
+        ep->EPSTATUSCLR.reg = USB_DEVICE_EPSTATUSCLR_BK0RDY | USB_DEVICE_EPSTATUSCLR_BK1RDY;
+      }
+      xfer->next_bank = xfer->done_bank;
+    }
+    xfer->count = 0;
+  }
 }
 
 //--------------------------------------------------------------------+
 // Interrupt Handler
 //--------------------------------------------------------------------+
+// Report completed banks of a non-control endpoint direction in submission order
+static void edpt_xfer_complete(uint8_t epnum, uint8_t dir)
+{
+  UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
+  xfer_ctl_t* xfer = &_xfer_ctl[epnum][dir];
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+
+  while ( xfer->count )
+  {
+    uint8_t const bank = xfer->dual_bank ? xfer->done_bank : dir;
+    uint8_t const flag = (uint8_t) (USB_DEVICE_EPINTFLAG_TRCPT0 << bank);
+    if ( (ep->EPINTFLAG.reg & flag) == 0 ) break;
+
+    ep->EPINTFLAG.reg = flag;
+    uint16_t const total_transfer_size = sram_registers[epnum][bank].PCKSIZE.bit.BYTE_COUNT;
+
+    xfer->count--;
+    if ( xfer->dual_bank )
+    {
+      xfer->done_bank ^= 1;
+    } else if ( xfer->count )
+    {
+      // start waiting transfer before reporting so that bank is re-armed as soon as possible
+      bank_xfer(epnum, dir, bank, xfer->buffer, xfer->total_bytes);
+    }
+
+    dcd_event_xfer_complete(0, ep_addr, total_transfer_size, XFER_RESULT_SUCCESS, true);
+  }
+}
+
 void maybe_transfer_complete(void) {
   uint32_t epints = USB->DEVICE.EPINTSMRY.reg;
 
@@ -338,6 +494,12 @@ void maybe_transfer_complete(void) {
       continue;
     }
 
+    if (epnum) {
+      edpt_xfer_complete(epnum, TUSB_DIR_IN);
+      edpt_xfer_complete(epnum, TUSB_DIR_OUT);
+      continue;
+    }
+
     UsbDeviceEndpoint* ep = &USB->DEVICE.DeviceEndpoint[epnum];
     uint32_t epintflag = ep->EPINTFLAG.reg;
 
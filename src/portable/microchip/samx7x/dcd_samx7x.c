@@ -44,13 +44,10 @@
 
 // Dual bank can improve performance, but need 2 times bigger packet buffer
 // As SAM7x has only 4KB packet buffer, use with caution !
-// Enable in FS mode as packets are smaller
+// In HS mode it is only used by endpoints with DMA channel: bus fills/drains one bank while DMA
+// services the other. Endpoint falls back to single bank if packet buffer is exhausted.
 #ifndef USE_DUAL_BANK
-#  if TUD_OPT_HIGH_SPEED
-#    define USE_DUAL_BANK   0
-#  else
-#    define USE_DUAL_BANK   1
-#  endif
+#  define USE_DUAL_BANK   1
 #endif
 
 #define EP_GET_FIFO_PTR(ep, scale) (((TU_XSTRCAT(TU_STRCAT(uint, scale),_t) (*)[0x8000 / ((scale) / 8)])FIFO_RAM_ADDR)[(ep)])
@@ -519,25 +516,32 @@ bool dcd_edpt_open (uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
     // Set up the maxpacket size, fifo start address fifosize
     // and enable the interrupt. CLear the data toggle.
     // AUTOSW is needed for DMA ack !
-    USB_REG->DEVEPTCFG[epnum] =
+    uint32_t cfg =
       (
        (fifoSize << DEVEPTCFG_EPSIZE_Pos)            |
        (eptype  << DEVEPTCFG_EPTYPE_Pos)             |
-       (DEVEPTCFG_EPBK_1_BANK << DEVEPTCFG_EPBK_Pos) |
        DEVEPTCFG_AUTOSW |
        ((dir & 0x01) << DEVEPTCFG_EPDIR_Pos)
        );
     if (eptype == TUSB_XFER_ISOCHRONOUS)
     {
-      USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_NBTRANS_1_TRANS;
+      cfg |= DEVEPTCFG_NBTRANS_1_TRANS;
     }
+    bool dual_bank = false;
 #if USE_DUAL_BANK
-    if (eptype == TUSB_XFER_ISOCHRONOUS || eptype == TUSB_XFER_BULK)
+    if ((eptype == TUSB_XFER_ISOCHRONOUS || eptype == TUSB_XFER_BULK) &&
+        (!TUD_OPT_HIGH_SPEED || EP_DMA_SUPPORT(epnum)))
     {
-      USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_EPBK_2_BANK;
+      dual_bank = true;
     }
 #endif
-    USB_REG->DEVEPTCFG[epnum] |= DEVEPTCFG_ALLOC;
+    USB_REG->DEVEPTCFG[epnum] = cfg | (dual_bank ? DEVEPTCFG_EPBK_2_BANK : DEVEPTCFG_EPBK_1_BANK) | DEVEPTCFG_ALLOC;
+    if (dual_bank && !(USB_REG->DEVEPTISR[epnum] & DEVEPTISR_CFGOK))
+    {
+      // Not enough packet buffer for 2 banks, retry with single bank
+      USB_REG->DEVEPTCFG[epnum] &= ~DEVEPTCFG_ALLOC;
+      USB_REG->DEVEPTCFG[epnum] = cfg | DEVEPTCFG_EPBK_1_BANK | DEVEPTCFG_ALLOC;
+    }
     USB_REG->DEVEPTIER[epnum] = DEVEPTIER_RSTDTS;
     USB_REG->DEVEPTIDR[epnum] = DEVEPTIDR_CTRL_STALLRQC;
     if (DEVEPTISR_CFGOK == (USB_REG->DEVEPTISR[epnum] & DEVEPTISR_CFGOK))
@@ -672,8 +676,6 @@ bool dcd_edpt_xfer_fifo (uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   xfer_ctl_t * xfer = &xfer_status[epnum];
-  if(epnum == 0x80)
-    xfer = &xfer_status[EP_MAX];
 
   xfer->buffer = NULL;
   xfer->total_len = total_bytes;
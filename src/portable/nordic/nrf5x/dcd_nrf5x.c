@@ -50,7 +50,6 @@
 
 // TODO remove later
 #include "device/usbd.h"
-#include "device/usbd_pvt.h" // to use defer function helper
 
 #if CFG_TUSB_OS == OPT_OS_MYNEWT
 #include "mcu/mcu.h"
@@ -94,6 +93,14 @@ enum {
   EP_CBI_COUNT = 8  // Control Bulk Interrupt endpoints count
 };
 
+// EasyDMA requests, bit position in dma_pending. Lower bit is served first
+enum {
+  DMA_REQ_EPIN0 = 0,                             // STARTEPIN[0-7], STARTISOIN
+  DMA_REQ_EPOUT0 = DMA_REQ_EPIN0 + EP_ISO_NUM + 1, // STARTEPOUT[0-7], STARTISOOUT
+  DMA_REQ_EP0STATUS = DMA_REQ_EPOUT0 + EP_ISO_NUM + 1,
+  DMA_REQ_EP0RCVOUT,
+};
+
 // Transfer Descriptor
 typedef struct {
   uint8_t* buffer;
@@ -120,6 +127,9 @@ static struct {
 
   // nRF can only carry one DMA at a time, this is used to guard the access to EasyDMA
   atomic_flag dma_running;
+
+  // Requests waiting for EasyDMA, started from the ENDED interrupt of the running one
+  atomic_uint_least32_t dma_pending;
 } _dcd;
 
 /*------------------------------------------------------------------*/
@@ -136,26 +146,6 @@ static void start_dma(volatile uint32_t* reg_startep) {
   (*reg_startep) = 1;
   __ISB();
   __DSB();
-
-  // TASKS_EP0STATUS, TASKS_EP0RCVOUT seem to need EasyDMA to be available
-  // However these don't trigger any DMA transfer and got ENDED event subsequently
-  // Therefore dma_pending is corrected right away
-  if ((reg_startep == &NRF_USBD->TASKS_EP0STATUS) || (reg_startep == &NRF_USBD->TASKS_EP0RCVOUT)) {
-    atomic_flag_clear(&_dcd.dma_running);
-  }
-}
-
-static void edpt_dma_start(volatile uint32_t* reg_startep) {
-  if (atomic_flag_test_and_set(&_dcd.dma_running)) {
-    usbd_defer_func((osal_task_func_t)(uintptr_t ) edpt_dma_start, (void*) (uintptr_t) reg_startep, true);
-  } else {
-    start_dma(reg_startep);
-  }
-}
-
-// DMA is complete
-static void edpt_dma_end(void) {
-  atomic_flag_clear(&_dcd.dma_running);
 }
 
 // helper getting td
@@ -163,41 +153,25 @@ static inline xfer_td_t* get_td(uint8_t epnum, uint8_t dir) {
   return &_dcd.xfer[epnum][dir];
 }
 
-static void xact_out_dma(uint8_t epnum);
-
-// Function wraps xact_out_dma which wants uint8_t while usbd_defer_func wants void (*)(void *)
-static void xact_out_dma_wrapper(void* epnum) {
-  xact_out_dma((uint8_t) ((uintptr_t) epnum));
-}
-
-// Start DMA to move data from Endpoint -> RAM
-static void xact_out_dma(uint8_t epnum) {
+// Start DMA to move data from Endpoint -> RAM, caller must own EasyDMA.
+// Return false if there is nothing to move
+static bool xact_out_dma(uint8_t epnum) {
   xfer_td_t* xfer = get_td(epnum, TUSB_DIR_OUT);
   uint32_t xact_len;
 
-  // DMA can't be active during read of SIZE.EPOUT or SIZE.ISOOUT, so try to lock,
-  // If already running defer call regardless if it was called from ISR or task,
-  if (atomic_flag_test_and_set(&_dcd.dma_running)) {
-    usbd_defer_func((osal_task_func_t) xact_out_dma_wrapper, (void*) (uint32_t) epnum, is_in_isr());
-    return;
-  }
+  // DMA can't be active during read of SIZE.EPOUT or SIZE.ISOOUT
   if (epnum == EP_ISO_NUM) {
     xact_len = NRF_USBD->SIZE.ISOOUT;
     // If ZERO bit is set, ignore ISOOUT length
-    if (xact_len & USBD_SIZE_ISOOUT_ZERO_Msk) {
-      xact_len = 0;
-      atomic_flag_clear(&_dcd.dma_running);
-    } else {
-      if (xfer->started) {
-        // Trigger DMA move data from Endpoint -> SRAM
-        NRF_USBD->ISOOUT.PTR = (uint32_t) xfer->buffer;
-        NRF_USBD->ISOOUT.MAXCNT = xact_len;
-
-        start_dma(&NRF_USBD->TASKS_STARTISOOUT);
-      } else {
-        atomic_flag_clear(&_dcd.dma_running);
-      }
+    if ((xact_len & USBD_SIZE_ISOOUT_ZERO_Msk) || !xfer->started) {
+      return false;
     }
+
+    // Trigger DMA move data from Endpoint -> SRAM
+    NRF_USBD->ISOOUT.PTR = (uint32_t) xfer->buffer;
+    NRF_USBD->ISOOUT.MAXCNT = xact_len;
+
+    start_dma(&NRF_USBD->TASKS_STARTISOOUT);
   } else {
     // limit xact len to remaining length
     xact_len = tu_min16((uint16_t) NRF_USBD->SIZE.EPOUT[epnum], xfer->total_len - xfer->actual_len);
@@ -208,6 +182,56 @@ static void xact_out_dma(uint8_t epnum) {
 
     start_dma(&NRF_USBD->TASKS_STARTEPOUT[epnum]);
   }
+
+  return true;
+}
+
+// Start a request while owning EasyDMA. Return false if no DMA transfer (and ENDED event) follows
+static bool dma_dispatch(uint8_t req) {
+  if (req == DMA_REQ_EP0STATUS || req == DMA_REQ_EP0RCVOUT) {
+    // TASKS_EP0STATUS, TASKS_EP0RCVOUT seem to need EasyDMA to be available
+    // However these don't trigger any DMA transfer and got ENDED event subsequently
+    // Therefore EasyDMA is available again right away
+    start_dma(req == DMA_REQ_EP0STATUS ? &NRF_USBD->TASKS_EP0STATUS : &NRF_USBD->TASKS_EP0RCVOUT);
+    return false;
+  } else if (req >= DMA_REQ_EPOUT0) {
+    return xact_out_dma(req - DMA_REQ_EPOUT0);
+  } else {
+    // EPIN PTR/MAXCNT are already set by xact_in_dma()
+    start_dma(&NRF_USBD->TASKS_STARTEPIN[req - DMA_REQ_EPIN0]);
+    return true;
+  }
+}
+
+// Start pending requests, lowest first (control endpoint has priority), until one of them occupies EasyDMA.
+// Can be called from both task and ISR: whoever wins dma_running serves the queue, the loop re-checks
+// the queue after releasing in case a request was added meanwhile.
+static void dma_service(void) {
+  while (atomic_load(&_dcd.dma_pending) && !atomic_flag_test_and_set(&_dcd.dma_running)) {
+    uint32_t pending;
+    while ((pending = atomic_load(&_dcd.dma_pending)) != 0) {
+      uint8_t req = 0;
+      while (!tu_bit_test(pending, req)) req++;
+      atomic_fetch_and(&_dcd.dma_pending, ~TU_BIT(req));
+
+      if (dma_dispatch(req)) {
+        return; // EasyDMA is released by ENDED event
+      }
+    }
+    atomic_flag_clear(&_dcd.dma_running);
+  }
+}
+
+// Queue a request for EasyDMA, it is started right away if EasyDMA is idle
+static void edpt_dma_start(uint8_t req) {
+  atomic_fetch_or(&_dcd.dma_pending, TU_BIT(req));
+  dma_service();
+}
+
+// DMA is complete, start the next pending request
+static void edpt_dma_end(void) {
+  atomic_flag_clear(&_dcd.dma_running);
+  dma_service();
 }
 
 // Prepare for a CBI transaction IN, call at the start
@@ -221,7 +245,7 @@ static void xact_in_dma(uint8_t epnum) {
   NRF_USBD->EPIN[epnum].PTR = (uint32_t) xfer->buffer;
   NRF_USBD->EPIN[epnum].MAXCNT = xact_len;
 
-  edpt_dma_start(&NRF_USBD->TASKS_STARTEPIN[epnum]);
+  edpt_dma_start(DMA_REQ_EPIN0 + epnum);
 }
 
 //--------------------------------------------------------------------+
@@ -354,6 +378,10 @@ void dcd_edpt_close_all(uint8_t rhport) {
   // disable interrupt to prevent race condition
   dcd_int_disable(rhport);
 
+  // drop queued DMA requests of non-control endpoints
+  atomic_fetch_and(&_dcd.dma_pending, TU_BIT(DMA_REQ_EPIN0) | TU_BIT(DMA_REQ_EPOUT0) |
+                                      TU_BIT(DMA_REQ_EP0STATUS) | TU_BIT(DMA_REQ_EP0RCVOUT));
+
   // disable all non-control (bulk + interrupt) endpoints
   for (uint8_t ep = 1; ep < EP_CBI_COUNT; ep++) {
     NRF_USBD->INTENCLR = TU_BIT(USBD_INTEN_ENDEPOUT0_Pos + ep) | TU_BIT(USBD_INTEN_ENDEPIN0_Pos + ep);
@@ -413,6 +441,7 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
       NRF_USBD->INTENCLR = USBD_INTENCLR_SOF_Msk;
   }
   _dcd.xfer[epnum][dir].started = false;
+  atomic_fetch_and(&_dcd.dma_pending, ~TU_BIT((dir == TUSB_DIR_OUT ? DMA_REQ_EPOUT0 : DMA_REQ_EPIN0) + epnum));
   __ISB();
   __DSB();
 }
@@ -435,7 +464,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
 
   if (control_status) {
     // Status Phase also requires EasyDMA has to be available as well !!!!
-    edpt_dma_start(&NRF_USBD->TASKS_EP0STATUS);
+    edpt_dma_start(DMA_REQ_EP0STATUS);
 
     // The nRF doesn't interrupt on status transmit so we queue up a success response.
     dcd_event_xfer_complete(0, ep_addr, 0, XFER_RESULT_SUCCESS, is_in_isr());
@@ -443,7 +472,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
     xfer->started = true;
     if (epnum == 0) {
       // Accept next Control Out packet. TASKS_EP0RCVOUT also require EasyDMA
-      edpt_dma_start(&NRF_USBD->TASKS_EP0RCVOUT);
+      edpt_dma_start(DMA_REQ_EP0RCVOUT);
     } else {
       // started just set, it could start DMA transfer if interrupt was trigger after this line
       // code only needs to start transfer (from Endpoint to RAM) when data_received was set
@@ -456,7 +485,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
         // Data is already received previously
         // start DMA to copy to SRAM
         xfer->data_received = false;
-        xact_out_dma(epnum);
+        edpt_dma_start(DMA_REQ_EPOUT0 + epnum);
       } else {
         // nRF auto accept next Bulk/Interrupt OUT packet
         // nothing to do
@@ -487,7 +516,7 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
     // There maybe data in endpoint fifo already, we need to pull it out
     if ((dir == TUSB_DIR_OUT) && xfer->data_received) {
       xfer->data_received = false;
-      xact_out_dma(epnum);
+      edpt_dma_start(DMA_REQ_EPOUT0 + epnum);
     }
   }
 
@@ -592,7 +621,7 @@ void dcd_int_handler(uint8_t rhport) {
       // Transfer from endpoint to RAM only if data is not corrupted
       if ((int_status & USBD_INTEN_USBEVENT_Msk) == 0 ||
           (NRF_USBD->EVENTCAUSE & USBD_EVENTCAUSE_ISOOUTCRC_Msk) == 0) {
-        xact_out_dma(EP_ISO_NUM);
+        edpt_dma_start(DMA_REQ_EPOUT0 + EP_ISO_NUM);
       }
     }
 
@@ -722,7 +751,7 @@ void dcd_int_handler(uint8_t rhport) {
       if ((epnum != EP_ISO_NUM) && (xact_len == xfer->mps) && (xfer->actual_len < xfer->total_len)) {
         if (epnum == 0) {
           // Accept next Control Out packet. TASKS_EP0RCVOUT also require EasyDMA
-          edpt_dma_start(&NRF_USBD->TASKS_EP0RCVOUT);
+          edpt_dma_start(DMA_REQ_EP0RCVOUT);
         } else {
           // nRF auto accept next Bulk/Interrupt OUT packet
           // nothing to do
@@ -778,7 +807,7 @@ void dcd_int_handler(uint8_t rhport) {
         xfer_td_t* xfer = get_td(epnum, TUSB_DIR_OUT);
 
         if (xfer->started && xfer->actual_len < xfer->total_len) {
-          xact_out_dma(epnum);
+          edpt_dma_start(DMA_REQ_EPOUT0 + epnum);
         } else {
           // Data overflow !!! Nah, nRF will auto accept next Bulk/Interrupt OUT packet
           // Mark this endpoint with data received
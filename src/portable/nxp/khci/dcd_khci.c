@@ -190,6 +190,14 @@ static void process_tokdne(uint8_t rhport)
     }
     return;
   }
+  if (remaining) {
+    /* A short packet ended the transfer while the other bank was still
+     * armed for its next packet. Take that bank back, otherwise the next
+     * packet would land past the end of the completed transfer and the
+     * next dcd_edpt_xfer() would find its bank owned by the SIE. */
+    buffer_descriptor_t *other = (buffer_descriptor_t *)&_dcd.bda[s ^ USB_STAT_ODD_MASK];
+    other->own = 0;
+  }
   const unsigned length = ep->length;
   dcd_event_xfer_complete(rhport,
                           tu_edpt_addr(epnum, dir),
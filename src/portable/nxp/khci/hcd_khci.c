@@ -116,6 +116,9 @@ typedef struct TU_ATTR_PACKED
   uint8_t *buffer;
   uint16_t length;
   uint16_t remaining;
+  uint8_t  interval;   /* Polling interval in frames, 1 for other than interrupt */
+  uint8_t  wait;       /* Frames to wait before the pipe is pending no more */
+  uint16_t last_frame; /* Frame number of the last token of interrupt pipe */
 } pipe_state_t;
 
 
@@ -130,7 +133,11 @@ typedef struct
   pipe_state_t pipe[CFG_TUH_ENDPOINT_MAX * 2];
   uint32_t     in_progress; /* Bitmap. Each bit indicates that a transfer of the corresponding pipe is in progress */
   uint32_t     pending;     /* Bitmap. Each bit indicates that a transfer of the corresponding pipe will be resume the next frame */
+  int          last_pipenum; /* The pipe scheduled last, round-robin starts after it */
+  bool         busy;        /* A token is on the bus */
   bool         need_reset;  /* The device has not been reset after connection. */
+  uint16_t     frame_last;  /* The last frame number read, used to extend it to 32-bit */
+  uint32_t     frame_count;
 } hcd_data_t;
 
 //--------------------------------------------------------------------+
@@ -189,16 +196,37 @@ static int prepare_packets(int pipenum)
   return num_tokens;
 }
 
+static uint16_t frame_number(void)
+{
+  return (uint16_t)(KHCI->FRMNUML | (KHCI->FRMNUMH << 8u));
+}
+
+/* Round-robin: the first ready pipe after pipenum, pipenum itself is the last candidate */
 static int select_next_pipenum(int pipenum)
 {
-  unsigned wip  = _hcd.in_progress & ~_hcd.pending;
-  if (!wip) return -1;
-  unsigned msk  = TU_GENMASK(31, pipenum);
-  int      next = __builtin_ctz(wip & msk);
-  if (next) return next;
-  msk  = TU_GENMASK(pipenum, 0);
-  next = __builtin_ctz(wip & msk);
-  return next;
+  uint32_t const ready = _hcd.in_progress & ~_hcd.pending;
+  if (!ready) return -1;
+  uint32_t const after = ready & ~TU_GENMASK(pipenum, 0);
+  return __builtin_ctz(after ? after : ready);
+}
+
+/* Called every frame while some pipes are pending: a pipe becomes ready once its wait has elapsed,
+ * i.e. the next frame for bulk pipes and after the polling interval for interrupt pipes. */
+static void release_pending_pipes(void)
+{
+  uint32_t pending = _hcd.pending;
+  while (pending) {
+    int const pipenum  = __builtin_ctz(pending);
+    pending           &= ~TU_BIT(pipenum);
+    pipe_state_t *pipe = &_hcd.pipe[pipenum];
+    if (pipe->wait > 1) {
+      --pipe->wait;
+    } else {
+      pipe->wait    = 0;
+      _hcd.pending &= ~TU_BIT(pipenum);
+    }
+  }
+  if (_hcd.pending) KHCI->INTEN |= USB_ISTAT_SOFTOK_MASK;
 }
 
 /* When transfer is completed, return true. */
@@ -256,6 +284,10 @@ static bool resume_transfer(int pipenum)
   KHCI->ENDPOINT[0].ENDPT = flags;
   KHCI->ADDR  = (KHCI->ADDR & USB_ADDR_LSEN_MASK) | pipe->dev_addr;
 
+  _hcd.busy         = true;
+  _hcd.last_pipenum = pipenum;
+  if (TUSB_XFER_INTERRUPT == pipe->xfer) pipe->last_frame = frame_number();
+
   unsigned const token = tu_edpt_number(pipe->ep_addr) |
     ((tu_edpt_dir(pipe->ep_addr) ? TOK_PID_IN: TOK_PID_OUT) << USB_TOKEN_TOKENPID_SHIFT);
   do {
@@ -273,6 +305,8 @@ static void suspend_transfer(int pipenum, buffer_descriptor_t *bd)
   pipe->data    = bd->data ^ 1;
   if ((TUSB_XFER_INTERRUPT == pipe->xfer) ||
       (TUSB_XFER_BULK == pipe->xfer)) {
+    /* NAKed: retry bulk in the next frame, interrupt after its polling interval */
+    pipe->wait    = pipe->interval;
     _hcd.pending |= TU_BIT(pipenum);
     KHCI->INTEN |= USB_ISTAT_SOFTOK_MASK;
   }
@@ -312,6 +346,7 @@ static void process_tokdne(uint8_t rhport)
       result = XFER_RESULT_SUCCESS;
       break;
     case TOK_PID_NAK:
+      _hcd.busy = false;
       suspend_transfer(pipenum, bd);
       next_pipenum = select_next_pipenum(pipenum);
       if (0 <= next_pipenum)
@@ -325,6 +360,7 @@ static void process_tokdne(uint8_t rhport)
       result = XFER_RESULT_FAILED;
       break;
   }
+  _hcd.busy         = false;
   _hcd.in_progress  &= ~TU_BIT(pipenum);
   pipe_state_t *pipe = &_hcd.pipe[ep->pipenum];
   hcd_event_xfer_complete(pipe->dev_addr,
@@ -359,6 +395,7 @@ static void process_bus_reset(uint8_t rhport)
 
   _hcd.in_progress = 0;
   _hcd.pending     = 0;
+  _hcd.busy        = false;
   buffer_descriptor_t *bd = &_hcd.bdt[0][0];
   for (unsigned i = 0; i < 2; ++i, ++bd) {
     bd->head = 0;
@@ -419,9 +456,11 @@ uint32_t hcd_frame_number(uint8_t rhport)
   /* The device must be reset at least once after connection
    * in order to start the frame counter. */
   if (_hcd.need_reset) hcd_port_reset(rhport);
-  uint32_t frmnum = KHCI->FRMNUML;
-  frmnum |= KHCI->FRMNUMH << 8u;
-   return frmnum;
+  /* Extend 11-bit hardware frame number to 32-bit */
+  uint16_t const frnum = frame_number();
+  _hcd.frame_count += (uint16_t)(frnum - _hcd.frame_last) & 0x7FFu;
+  _hcd.frame_last   = frnum;
+  return _hcd.frame_count;
 }
 
 /*--------------------------------------------------------------------+
@@ -500,6 +539,8 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
     return false;
 
   _hcd.in_progress |= TU_BIT(pipenum);
+  _hcd.busy         = true;
+  _hcd.last_pipenum = pipenum;
 
   unsigned hostwohub = KHCI->ENDPOINT[0].ENDPT & USB_ENDPT_HOSTWOHUB_MASK;
   KHCI->ENDPOINT[0].ENDPT = hostwohub |
@@ -528,6 +569,9 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
   p->max_packet_size = ep_desc->wMaxPacketSize;
   p->xfer            = ep_desc->bmAttributes.xfer;
   p->data            = 0;
+  p->interval        = (TUSB_XFER_INTERRUPT == p->xfer) ? tu_max8(ep_desc->bInterval, 1) : 1;
+  p->wait            = 0;
+  p->last_frame      = frame_number();
   if (!ep_addr) {
     /* Open one more pipe for Control IN transfer */
     TU_ASSERT(TUSB_XFER_CONTROL == p->xfer);
@@ -538,6 +582,7 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     q->max_packet_size = ep_desc->wMaxPacketSize;
     q->xfer            = ep_desc->bmAttributes.xfer;
     q->data            = 1;
+    q->interval        = 1;
   }
   return true;
 }
@@ -559,6 +604,12 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   pipe->buffer       = buffer;
   pipe->length       = buflen;
   pipe->remaining    = buflen;
+  pipe->wait         = 0;
+  if (TUSB_XFER_INTERRUPT == pipe->xfer) {
+    /* Do not poll again before the interval elapsed since the last token */
+    unsigned const elapsed = (frame_number() - pipe->last_frame) & 0x7FFu;
+    if (elapsed < pipe->interval) pipe->wait = (uint8_t)(pipe->interval - elapsed);
+  }
   _hcd.in_progress  |= TU_BIT(pipenum);
   _hcd.pending      |= TU_BIT(pipenum); /* Send at the next Frame */
   KHCI->INTEN |= USB_ISTAT_SOFTOK_MASK;
@@ -627,10 +678,13 @@ void hcd_int_handler(uint8_t rhport, bool in_isr)
     msk &= ~USB_ISTAT_SOFTOK_MASK;
     KHCI->INTEN = msk;
     if (_hcd.pending) {
-      int pipenum = __builtin_ctz(_hcd.pending);
-      _hcd.pending = 0;
-      if (!(is & USB_ISTAT_TOKDNE_MASK))
-        resume_transfer(pipenum);
+      release_pending_pipes();
+      /* Otherwise the completion of the token on the bus schedules the next pipe */
+      if (!_hcd.busy) {
+        int pipenum = select_next_pipenum(_hcd.last_pipenum);
+        if (0 <= pipenum)
+          resume_transfer(pipenum);
+      }
     }
   }
   if (is & USB_ISTAT_TOKDNE_MASK) {
@@ -166,7 +166,13 @@ typedef struct
   uint16_t total_bytes;
   uint16_t xferred_bytes;
 
-  uint16_t nbytes;
+  uint16_t nbytes[2];    // nbytes programmed to buffer 0/1
+
+  // Double buffered endpoint only
+  uint16_t queued_bytes; // bytes handed to the controller so far
+  uint16_t base_offset;  // buffer offset of the transfer start (64-byte unit)
+  uint8_t  armed;        // bitmap of buffers programmed and not completed yet
+  uint8_t  buf_next;     // buffer the controller completes next
 
   // prevent unaligned access on Highspeed port on USB_SRAM
   uint16_t TU_RESERVED;
@@ -181,11 +187,14 @@ typedef struct
 // current_td is used to keep track of number of remaining & xferred bytes of the current request.
 typedef struct
 {
-  // 256 byte aligned, 2 for double buffer (not used)
+  // 256 byte aligned, 2 for double buffer
   // Each cmd_sts can only transfer up to DMA_NBYTES_MAX bytes each
   ep_cmd_sts_t ep[2*MAX_EP_PAIRS][2];
   xfer_dma_t dma[2*MAX_EP_PAIRS];
 
+  // Max nbytes per buffer of double buffered endpoints, 0 if single buffered
+  uint16_t dbuf_max[2*MAX_EP_PAIRS];
+
   TU_ATTR_ALIGNED(64) uint8_t setup_packet[8];
 }dcd_data_t;
 
@@ -361,6 +370,9 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
   // TODO cannot able to STALL Control OUT endpoint !!!!! FIXME try some walk-around
   uint8_t const ep_id = ep_addr2id(ep_addr);
   _dcd.ep[ep_id][0].cmd_sts.stall = 1;
+
+  // double buffered endpoint stalls only when both buffers do
+  if (_dcd.dbuf_max[ep_id]) _dcd.ep[ep_id][1].cmd_sts.stall = 1;
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
@@ -372,6 +384,8 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
   _dcd.ep[ep_id][0].cmd_sts.stall        = 0;
   _dcd.ep[ep_id][0].cmd_sts.toggle_reset = 1;
   _dcd.ep[ep_id][0].cmd_sts.rf_tv        = 0;
+
+  if (_dcd.dbuf_max[ep_id]) _dcd.ep[ep_id][1].cmd_sts.stall = 0;
 }
 
 bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
@@ -405,8 +419,31 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
     default: break;
   }
 
-  // Enable EP interrupt
   dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+
+  // Double buffer bulk and ISO endpoints: the controller switches to the other buffer as soon as one completes,
+  // while the ISR refills the first one. Each buffer must start 64-byte aligned and hold whole packets.
+  uint16_t const mps    = tu_edpt_packet_size(p_endpoint_desc);
+  uint8_t const  xfer   = p_endpoint_desc->bmAttributes.xfer;
+  bool const     is_iso = (xfer == TUSB_XFER_ISOCHRONOUS);
+  bool           dbuf   = (xfer == TUSB_XFER_BULK || is_iso) && mps && (mps & 0x3f) == 0;
+  #if TU_CHECK_MCU(OPT_MCU_LPC54)
+  // keep the NBytes errata work-around (see prepare_ep_xfer) on the single buffer path
+  if ( rhport_is_highspeed(rhport) ) dbuf = false;
+  #endif
+
+  if (dbuf) {
+    uint16_t const max_n = rhport_is_highspeed(rhport) ? (is_iso ? NBYTES_ISO_HS_MAX : NBYTES_CBI_HS_MAX)
+                                                      : (is_iso ? NBYTES_ISO_FS_MAX : NBYTES_CBI_FS_MAX);
+    _dcd.dbuf_max[ep_id] = is_iso ? mps : (uint16_t) ((max_n / mps) * mps);
+    dcd_reg->EPINUSE  &= ~TU_BIT(ep_id);
+    dcd_reg->EPBUFCFG |= TU_BIT(ep_id);
+  } else {
+    _dcd.dbuf_max[ep_id] = 0;
+    dcd_reg->EPBUFCFG &= ~TU_BIT(ep_id);
+  }
+
+  // Enable EP interrupt
   dcd_reg->INTEN |= TU_BIT(ep_id);
 
   return true;
@@ -430,14 +467,16 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   _dcd.ep[ep_id][0].cmd_sts.disable = _dcd.ep[ep_id][1].cmd_sts.disable = 1;
 }
 
-static void prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint16_t buf_offset, uint16_t total_bytes) {
+// Program buffer buf_id with the next part of a transfer, return its nbytes
+static uint16_t prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint8_t buf_id, uint16_t buf_offset, uint16_t total_bytes) {
   uint16_t nbytes;
   ep_cmd_sts_t* ep_cs = get_ep_cs(ep_id);
 
   const bool is_iso = ep_is_iso(ep_cs, _dcd_controller[rhport].is_highspeed);
+  const uint16_t dbuf_max = _dcd.dbuf_max[ep_id];
 
   if ( rhport_is_highspeed(rhport) ) {
-    nbytes = tu_min16(total_bytes, is_iso ? NBYTES_ISO_HS_MAX : NBYTES_CBI_HS_MAX);
+    nbytes = tu_min16(total_bytes, dbuf_max ? dbuf_max : (is_iso ? NBYTES_ISO_HS_MAX : NBYTES_CBI_HS_MAX));
     #if TU_CHECK_MCU(OPT_MCU_LPC54)
     // LPC54 Errata USB.1: In USB high-speed device mode, the NBytes field does not decrement after BULK OUT transfer.
     // Suggested Work-around: Program the NByte to the max packet size (512)
@@ -450,16 +489,28 @@ static void prepare_ep_xfer(uint8_t rhport, uint8_t ep_id, uint16_t buf_offset,
     }
     #endif
 
-    ep_cs[0].buffer_hs.offset = buf_offset;
-    ep_cs[0].buffer_hs.nbytes = nbytes;
+    ep_cs[buf_id].buffer_hs.offset = buf_offset;
+    ep_cs[buf_id].buffer_hs.nbytes = nbytes;
   }else {
-    nbytes = tu_min16(total_bytes, is_iso ? NBYTES_ISO_FS_MAX : NBYTES_CBI_FS_MAX);
-    ep_cs[0].buffer_fs.offset = buf_offset;
-    ep_cs[0].buffer_fs.nbytes = nbytes;
+    nbytes = tu_min16(total_bytes, dbuf_max ? dbuf_max : (is_iso ? NBYTES_ISO_FS_MAX : NBYTES_CBI_FS_MAX));
+    ep_cs[buf_id].buffer_fs.offset = buf_offset;
+    ep_cs[buf_id].buffer_fs.nbytes = nbytes;
   }
 
-  _dcd.dma[ep_id].nbytes = nbytes;
-  ep_cs[0].cmd_sts.active = 1;
+  _dcd.dma[ep_id].nbytes[buf_id] = nbytes;
+  ep_cs[buf_id].cmd_sts.active = 1;
+
+  return nbytes;
+}
+
+// Double buffered endpoint: hand the next chunk of the transfer to buffer buf_id
+static void dbuf_arm(uint8_t rhport, uint8_t ep_id, uint8_t buf_id) {
+  xfer_dma_t* xfer_dma = &_dcd.dma[ep_id];
+  // chunks are whole multiples of 64 bytes except the last one, so every chunk starts aligned
+  uint16_t const buf_offset = xfer_dma->base_offset + (xfer_dma->queued_bytes >> 6);
+  xfer_dma->queued_bytes += prepare_ep_xfer(rhport, ep_id, buf_id, buf_offset,
+                                            xfer_dma->total_bytes - xfer_dma->queued_bytes);
+  xfer_dma->armed |= TU_BIT(buf_id);
 }
 
 bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
@@ -471,10 +522,24 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
     buffer = (uint8_t *) (uint32_t) dummy;
   }
 
-  tu_memclr(&_dcd.dma[ep_id], sizeof(xfer_dma_t));
-  _dcd.dma[ep_id].total_bytes = total_bytes;
+  xfer_dma_t* xfer_dma = &_dcd.dma[ep_id];
+  tu_memclr(xfer_dma, sizeof(xfer_dma_t));
+  xfer_dma->total_bytes = total_bytes;
 
-  prepare_ep_xfer(rhport, ep_id, get_buf_offset(buffer), total_bytes);
+  if (_dcd.dbuf_max[ep_id]) {
+    // arm the buffer the controller uses next, then the other one if the transfer spans both
+    dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+    uint8_t const buf_id = (dcd_reg->EPINUSE & TU_BIT(ep_id)) ? 1 : 0;
+
+    xfer_dma->base_offset = get_buf_offset(buffer);
+    xfer_dma->buf_next    = buf_id;
+    dbuf_arm(rhport, ep_id, buf_id);
+    if (xfer_dma->queued_bytes < total_bytes) {
+      dbuf_arm(rhport, ep_id, buf_id ^ 1);
+    }
+  } else {
+    prepare_ep_xfer(rhport, ep_id, 0, get_buf_offset(buffer), total_bytes);
+  }
 
   return true;
 }
@@ -504,11 +569,54 @@ static void bus_reset(uint8_t rhport)
   dcd_reg->INTEN        = INT_DEVICE_STATUS_MASK | TU_BIT(0) | TU_BIT(1); // enable device status & control endpoints
 }
 
+static void process_dbuf_isr(uint8_t rhport, uint8_t ep_id) {
+  dcd_registers_t* dcd_reg = _dcd_controller[rhport].regs;
+  ep_cmd_sts_t* ep_cs = get_ep_cs(ep_id);
+  xfer_dma_t* xfer_dma = &_dcd.dma[ep_id];
+
+  // Both buffers may have completed by the time the interrupt is serviced
+  while ( xfer_dma->armed & TU_BIT(xfer_dma->buf_next) ) {
+    uint8_t const buf_id = xfer_dma->buf_next;
+    if ( ep_cs[buf_id].cmd_sts.active ) break;
+
+    uint16_t const buf_nbytes = rhport_is_highspeed(rhport) ? ep_cs[buf_id].buffer_hs.nbytes
+                                                            : ep_cs[buf_id].buffer_fs.nbytes;
+    xfer_dma->armed        &= ~TU_BIT(buf_id);
+    xfer_dma->buf_next      = buf_id ^ 1;
+    xfer_dma->xferred_bytes += xfer_dma->nbytes[buf_id] - buf_nbytes;
+
+    if ( (buf_nbytes == 0) && (xfer_dma->total_bytes > xfer_dma->xferred_bytes) ) {
+      // The other buffer is on the bus now, refill this one with the chunk after it
+      if ( xfer_dma->queued_bytes < xfer_dma->total_bytes ) {
+        dbuf_arm(rhport, ep_id, buf_id);
+      }
+      continue;
+    }
+
+    if ( xfer_dma->armed ) {
+      // A short packet ended the transfer while the other buffer was still armed for it.
+      // Skip that buffer so it does not take data of the next transfer.
+      dcd_reg->EPSKIP = TU_BIT(ep_id);
+      while ( dcd_reg->EPSKIP & TU_BIT(ep_id) ) {}
+      xfer_dma->armed = 0;
+    }
+
+    // for detecting ZLP
+    xfer_dma->total_bytes = xfer_dma->xferred_bytes;
+
+    uint8_t const ep_addr = tu_edpt_addr(ep_id / 2, ep_id & 0x01);
+    dcd_event_xfer_complete(rhport, ep_addr, xfer_dma->xferred_bytes, XFER_RESULT_SUCCESS, true);
+    break;
+  }
+}
+
 static void process_xfer_isr(uint8_t rhport, uint32_t int_status) {
   uint8_t const max_ep = 2*_dcd_controller[rhport].ep_pairs;
 
   for(uint8_t ep_id = 0; ep_id < max_ep; ep_id++ ) {
-    if ( tu_bit_test(int_status, ep_id) ) {
+    if ( tu_bit_test(int_status, ep_id) && _dcd.dbuf_max[ep_id] ) {
+      process_dbuf_isr(rhport, ep_id);
+    } else if ( tu_bit_test(int_status, ep_id) ) {
       ep_cmd_sts_t * ep_cs = &_dcd.ep[ep_id][0];
       xfer_dma_t* xfer_dma = &_dcd.dma[ep_id];
 
@@ -536,12 +644,12 @@ static void process_xfer_isr(uint8_t rhport, uint32_t int_status) {
         buf_nbytes = ep_cs->buffer_fs.nbytes;
       }
 
-      xfer_dma->xferred_bytes += xfer_dma->nbytes - buf_nbytes;
+      xfer_dma->xferred_bytes += xfer_dma->nbytes[0] - buf_nbytes;
 
       if ( (buf_nbytes == 0) && (xfer_dma->total_bytes > xfer_dma->xferred_bytes) ) {
         // There is more data to transfer
         // buff_offset has been already increased by hw to correct value for next transfer
-        prepare_ep_xfer(rhport, ep_id, buf_offset, xfer_dma->total_bytes - xfer_dma->xferred_bytes);
+        prepare_ep_xfer(rhport, ep_id, 0, buf_offset, xfer_dma->total_bytes - xfer_dma->xferred_bytes);
       } else {
         // for detecting ZLP
         xfer_dma->total_bytes = xfer_dma->xferred_bytes;
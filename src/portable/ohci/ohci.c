@@ -142,6 +142,11 @@ enum {
   PID_FROM_TD = 0,
 };
 
+// Frames ahead of current one for the first packet of a new isochronous stream
+enum {
+  ITD_SCHED_MARGIN = 2,
+};
+
 //--------------------------------------------------------------------+
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
@@ -152,12 +157,41 @@ static ohci_ed_t * const p_ed_head[] =
     [TUSB_XFER_CONTROL]     = &ohci_data.control[0].ed,
     [TUSB_XFER_BULK   ]     = &ohci_data.bulk_head_ed,
     [TUSB_XFER_INTERRUPT]   = &ohci_data.period_head_ed,
-    [TUSB_XFER_ISOCHRONOUS] = NULL // TODO Isochronous
+    [TUSB_XFER_ISOCHRONOUS] = &ohci_data.period_head_ed // isochronous EDs are at the tail of periodic list
 };
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed);
 static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr);
 static gtd_extra_data_t *gtd_get_extra_data(ohci_gtd_t const * const gtd);
+static void gtd_free(ohci_gtd_t* gtd);
+static void ed_drop_queued_td(ohci_ed_t* p_ed);
+
+#if CFG_TUH_OHCI_ISO_EP_MAX
+static bool itd_alloc(ed_idx_t ed_idx);
+static bool itd_xfer(ohci_ed_t* ed, uint8_t* buffer, uint16_t buflen);
+static void itd_done_isr(ochi_itd_t* itd);
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline void bitmap_set(uint32_t* map, uint32_t bit) {
+  (void) __atomic_fetch_or(&map[bit / 32], TU_BIT(bit % 32), __ATOMIC_RELAXED);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void bitmap_clear(uint32_t* map, uint32_t bit) {
+  (void) __atomic_fetch_and(&map[bit / 32], ~TU_BIT(bit % 32), __ATOMIC_RELAXED);
+}
+
+// Take the first set bit of a free map, return -1 if none
+static int32_t bitmap_take(uint32_t* map, uint32_t words) {
+  for (uint32_t w = 0; w < words; w++) {
+    uint32_t const free_bits = __atomic_load_n(&map[w], __ATOMIC_RELAXED);
+    if (free_bits) {
+      uint32_t const i = w * 32 + (uint32_t) __builtin_ctz(free_bits);
+      bitmap_clear(map, i);
+      return (int32_t) i;
+    }
+  }
+  return -1;
+}
 
 //--------------------------------------------------------------------+
 // USBH-HCD API
@@ -193,6 +227,13 @@ bool hcd_init(uint8_t rhport)
   ohci_data.bulk_head_ed.skip   = 1;
   ohci_data.period_head_ed.skip = 1;
 
+  for (uint32_t i = 0; i < ED_MAX; i++) {
+    bitmap_set(ohci_data.ed_free_map, i);
+  }
+  for (uint32_t i = 0; i < GTD_MAX; i++) {
+    bitmap_set(ohci_data.gtd_free_map, i);
+  }
+
   //If OHCI hardware is in SMM mode, gain ownership (Ref OHCI spec 5.1.1.3.3)
   if (OHCI_REG->control_bit.interrupt_routing == 1)
   {
@@ -231,7 +272,8 @@ bool hcd_init(uint8_t rhport)
       OHCI_INT_MASTER_ENABLE_MASK;
 
   OHCI_REG->control = OHCI_CONTROL_CONTROL_BULK_RATIO | OHCI_CONTROL_LIST_CONTROL_ENABLE_MASK |
-       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK; // TODO Isochronous
+       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK |
+       (CFG_TUH_OHCI_ISO_EP_MAX ? OHCI_CONTROL_LIST_ISOCHRONOUS_ENABLE_MASK : 0);
 
   OHCI_REG->frame_interval = (OHCI_FMINTERVAL_FSMPS << 16) | OHCI_FMINTERVAL_FI;
   OHCI_REG->frame_interval ^= (1 << 31); //Must toggle when frame_interval is updated.
@@ -297,10 +339,20 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
     // remove bulk
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_BULK], dev_addr);
 
-    // remove interrupt
+#if CFG_TUH_OHCI_ISO_EP_MAX
+    // free iTD of isochronous endpoints, pending transfer is dropped
+    for (uint8_t i = 0; i < CFG_TUH_OHCI_ISO_EP_MAX; i++) {
+      itd_extra_data_t* itd_extra = &ohci_data.itd_extra[i];
+      if (itd_extra->ed_idx && ohci_data.ed_pool[itd_extra->ed_idx - 1].dev_addr == dev_addr) {
+        tu_memclr(itd_extra, sizeof(itd_extra_data_t));
+      }
+    }
+#endif
+
+    // remove interrupt and isochronous
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_INTERRUPT], dev_addr);
 
-    // TODO remove ISO
+    tu_memclr(ohci_data.ep2ed[dev_addr], sizeof(ohci_data.ep2ed[dev_addr]));
   }
 }
 
@@ -366,30 +418,19 @@ static ohci_ed_t * ed_from_addr(uint8_t dev_addr, uint8_t ep_addr)
 {
   if ( tu_edpt_number(ep_addr) == 0 ) return &ohci_data.control[dev_addr].ed;
 
-  ohci_ed_t* ed_pool = ohci_data.ed_pool;
-
-  for(uint32_t i=0; i<ED_MAX; i++)
-  {
-    if ( (ed_pool[i].dev_addr == dev_addr) &&
-          ep_addr == tu_edpt_addr(ed_pool[i].ep_number, ed_pool[i].pid == PID_IN) )
-    {
-      return &ed_pool[i];
-    }
-  }
-
-  return NULL;
+  ed_idx_t const idx = ohci_data.ep2ed[dev_addr][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  return idx ? &ohci_data.ed_pool[idx - 1] : NULL;
 }
 
 static ohci_ed_t * ed_find_free(void)
 {
-  ohci_ed_t* ed_pool = ohci_data.ed_pool;
-
-  for(uint8_t i = 0; i < ED_MAX; i++)
-  {
-    if ( !ed_pool[i].used ) return &ed_pool[i];
-  }
+  int32_t const i = bitmap_take(ohci_data.ed_free_map, TU_ARRAY_SIZE(ohci_data.ed_free_map));
+  return (i < 0) ? NULL : &ohci_data.ed_pool[i];
+}
 
-  return NULL;
+TU_ATTR_ALWAYS_INLINE static inline bool ed_is_pool(ohci_ed_t const * const p_ed)
+{
+  return (p_ed >= ohci_data.ed_pool) && (p_ed < ohci_data.ed_pool + ED_MAX);
 }
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed)
@@ -418,6 +459,12 @@ static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr)
       ed->next = (uint32_t) _phys_addr(p_head);
       ed->used = 0;
       ed->skip = 0;
+
+      if (ed_is_pool(ed)) {
+        // return still queued TDs to the pool, iTD is owned by its slot
+        if (!ed->is_iso) ed_drop_queued_td(ed);
+        bitmap_set(ohci_data.ed_free_map, (uint32_t) (ed - ohci_data.ed_pool));
+      }
     }else
     {
       p_prev = (ohci_ed_t*) _virt_addr((void *)p_prev->next);
@@ -427,27 +474,51 @@ static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr)
 
 static ohci_gtd_t * gtd_find_free(void)
 {
-  for(uint8_t i=0; i < GTD_MAX; i++)
-  {
-    if ( !ohci_data.gtd_pool[i].used ) return &ohci_data.gtd_pool[i];
-  }
+  int32_t const i = bitmap_take(ohci_data.gtd_free_map, TU_ARRAY_SIZE(ohci_data.gtd_free_map));
+  if (i < 0) return NULL;
 
-  return NULL;
+  ohci_data.gtd_pool[i].used = 1;
+  return &ohci_data.gtd_pool[i];
 }
 
+// Number of bytes a TD starting at buffer can take: buffer can cross 4K page boundary only once, limited to
+// whole packets if transfer does not fit (a packet cannot span TDs)
+static uint16_t gtd_xfer_len(void const* buffer, uint32_t remaining, uint16_t mps)
+{
+  uint32_t const capacity = 8192u - tu_offset4k((uint32_t) _phys_addr((void*) (uintptr_t) buffer));
+  if (remaining <= capacity) return (uint16_t) remaining;
+  return (uint16_t) (mps ? (capacity / mps) * mps : capacity);
+}
+
+// Append TD (chain) to ED's queue, tail is always NULL
 static void td_insert_to_ed(ohci_ed_t* p_ed, ohci_gtd_t * p_gtd)
 {
-  // tail is always NULL
   if ( tu_align16(p_ed->td_head.address) == 0 )
   { // TD queue is empty --> head = TD
     p_ed->td_head.address |= (uint32_t) _phys_addr(p_gtd);
   }
   else
-  { // TODO currently only support queue up to 2 TD each endpoint at a time
-    ((ohci_gtd_t*) tu_align16((uint32_t)_virt_addr((void *)p_ed->td_head.address)))->next = (uint32_t) _phys_addr(p_gtd);
+  {
+    ohci_td_item_t* last = (ohci_td_item_t*) _virt_addr((void *) tu_align16(p_ed->td_head.address));
+    while (last->next) {
+      last = (ohci_td_item_t*) _virt_addr((void *) last->next);
+    }
+    last->next = (uint32_t) _phys_addr(p_gtd);
   }
 }
 
+// Free TDs still queued on a halted ED e.g rest of chain after an error, data toggle carry is kept
+static void ed_drop_queued_td(ohci_ed_t* p_ed)
+{
+  uint32_t td_addr = tu_align16(p_ed->td_head.address);
+  while (td_addr) {
+    ohci_gtd_t* gtd = (ohci_gtd_t*) _virt_addr((void *) td_addr);
+    td_addr = gtd->next;
+    gtd_free(gtd);
+  }
+  p_ed->td_head.address &= 0x0Ful;
+}
+
 //--------------------------------------------------------------------+
 // Endpoint API
 //--------------------------------------------------------------------+
@@ -456,8 +527,14 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
 {
   (void) rhport;
 
-  // TODO iso support
-  TU_ASSERT(ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  uint8_t const xfer_type = ep_desc->bmAttributes.xfer;
+
+#if CFG_TUH_OHCI_ISO_EP_MAX
+  // packets of an iTD are sent in consecutive frames
+  TU_ASSERT(xfer_type != TUSB_XFER_ISOCHRONOUS || ep_desc->bInterval == 1);
+#else
+  TU_ASSERT(xfer_type != TUSB_XFER_ISOCHRONOUS);
+#endif
 
   //------------- Prepare Queue Head -------------//
   ohci_ed_t * p_ed;
@@ -471,8 +548,16 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
   }
   TU_ASSERT(p_ed);
 
+#if CFG_TUH_OHCI_ISO_EP_MAX
+  if ( xfer_type == TUSB_XFER_ISOCHRONOUS && !itd_alloc((ed_idx_t) (p_ed - ohci_data.ed_pool)) )
+  {
+    bitmap_set(ohci_data.ed_free_map, (uint32_t) (p_ed - ohci_data.ed_pool));
+    TU_ASSERT(false);
+  }
+#endif
+
   ed_init( p_ed, dev_addr, tu_edpt_packet_size(ep_desc), ep_desc->bEndpointAddress,
-            ep_desc->bmAttributes.xfer, ep_desc->bInterval );
+            xfer_type, ep_desc->bInterval );
 
   // control of dev0 is used as static async head
   if ( dev_addr == 0 )
@@ -481,7 +566,19 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     return true;
   }
 
-  ed_list_insert( p_ed_head[ep_desc->bmAttributes.xfer], p_ed );
+  if ( ep_desc->bEndpointAddress != 0 )
+  {
+    ohci_data.ep2ed[dev_addr][tu_edpt_number(ep_desc->bEndpointAddress)][tu_edpt_dir(ep_desc->bEndpointAddress)] =
+        (ed_idx_t) (p_ed - ohci_data.ed_pool + 1);
+  }
+
+  ohci_ed_t* p_pre = p_ed_head[xfer_type];
+  if ( xfer_type == TUSB_XFER_ISOCHRONOUS )
+  {
+    // OHCI 5.2.7.2: isochronous EDs must follow all interrupt EDs of periodic list
+    while ( p_pre->next ) p_pre = (ohci_ed_t*) _virt_addr((void *) p_pre->next);
+  }
+  ed_list_insert( p_pre, p_ed );
 
   return true;
 }
@@ -532,17 +629,70 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   }else
   {
     ohci_ed_t * ed = ed_from_addr(dev_addr, ep_addr);
-    ohci_gtd_t* gtd = gtd_find_free();
+    TU_ASSERT(ed);
 
-    TU_ASSERT(gtd);
+#if CFG_TUH_OHCI_ISO_EP_MAX
+    if ( ed->is_iso ) return itd_xfer(ed, buffer, buflen);
+#endif
 
-    gtd_init(gtd, buffer, buflen);
-    gtd->index = ed-ohci_data.ed_pool;
-    gtd->delay_interrupt = OHCI_INT_ON_COMPLETE_YES;
+    uint8_t const ed_idx = (uint8_t) (ed - ohci_data.ed_pool);
+    uint16_t const mps = ed->max_packet_size;
+
+    // count TDs first so that nothing is allocated if transfer does not fit
+    uint8_t td_count = 0;
+    uint32_t remaining = buflen;
+    uint8_t* td_buf = buffer;
+    do {
+      uint16_t const td_len = gtd_xfer_len(td_buf, remaining, mps);
+      td_buf += td_len;
+      remaining -= td_len;
+      td_count++;
+    } while ( remaining );
+    TU_ASSERT(td_count <= CFG_TUH_OHCI_GTD_PER_XFER);
+
+    // chain TDs: only the last one interrupts. Short packet of earlier IN TD is a data underrun error
+    // (no buffer rounding) which halts the ED, rest of the chain is then dropped by done queue isr.
+    ohci_gtd_t* first = NULL;
+    ohci_gtd_t* prev  = NULL;
+    remaining = buflen;
+    td_buf = buffer;
+    for ( uint8_t i = 0; i < td_count; i++ )
+    {
+      ohci_gtd_t* gtd = gtd_find_free();
+      if ( gtd == NULL )
+      {
+        while ( first ) {
+          ohci_gtd_t* next = first->next ? (ohci_gtd_t*) _virt_addr((void *) first->next) : NULL;
+          gtd_free(first);
+          first = next;
+        }
+        TU_ASSERT(false);
+      }
+
+      uint16_t const td_len = gtd_xfer_len(td_buf, remaining, mps);
+      bool const is_last = (i == td_count - 1);
+
+      gtd_init(gtd, td_buf, td_len);
+      gtd->index = ed_idx;
+      if ( is_last )
+      {
+        gtd->delay_interrupt = OHCI_INT_ON_COMPLETE_YES;
+      }else if ( dir )
+      {
+        gtd->buffer_rounding = 0;
+      }
 
-    td_insert_to_ed(ed, gtd);
+      if ( prev ) prev->next = (uint32_t) _phys_addr(gtd); else first = gtd;
+      prev = gtd;
 
-    tusb_xfer_type_t xfer_type = ed_get_xfer_type( ed_from_addr(dev_addr, ep_addr) );
+      td_buf += td_len;
+      remaining -= td_len;
+    }
+
+    ohci_data.ed_xferred_bytes[ed_idx] = 0;
+    td_insert_to_ed(ed, first);
+
+    tusb_xfer_type_t xfer_type = ed_get_xfer_type(ed);
     if (TUSB_XFER_BULK == xfer_type) OHCI_REG->command_status_bit.bulk_list_filled = 1;
   }
 
@@ -631,6 +781,140 @@ static inline uint32_t gtd_xfer_byte_left(uint32_t buffer_end, uint32_t current_
       tu_offset4k(buffer_end) - tu_offset4k(current_buffer) + 1;
 }
 
+static void gtd_free(ohci_gtd_t* gtd)
+{
+  gtd->used = 0;
+  if ( !gtd_is_control(gtd) ) bitmap_set(ohci_data.gtd_free_map, (uint32_t) (gtd - ohci_data.gtd_pool));
+}
+
+//--------------------------------------------------------------------+
+// Isochronous TD
+//--------------------------------------------------------------------+
+#if CFG_TUH_OHCI_ISO_EP_MAX
+
+static inline bool itd_is_iso(ohci_td_item_t const * td)
+{
+  return ((uintptr_t) td >= (uintptr_t) ohci_data.itd) &&
+         ((uintptr_t) td < (uintptr_t) (ohci_data.itd + CFG_TUH_OHCI_ISO_EP_MAX));
+}
+
+// Get iTD slot of an isochronous ED, -1 if not found
+static int8_t itd_find(ed_idx_t ed_idx)
+{
+  for ( uint8_t i = 0; i < CFG_TUH_OHCI_ISO_EP_MAX; i++ )
+  {
+    if ( ohci_data.itd_extra[i].ed_idx == ed_idx + 1 ) return (int8_t) i;
+  }
+  return -1;
+}
+
+static bool itd_alloc(ed_idx_t ed_idx)
+{
+  for ( uint8_t i = 0; i < CFG_TUH_OHCI_ISO_EP_MAX; i++ )
+  {
+    itd_extra_data_t* extra = &ohci_data.itd_extra[i];
+    if ( extra->ed_idx == 0 )
+    {
+      tu_memclr(extra, sizeof(itd_extra_data_t));
+      extra->ed_idx = (ed_idx_t) (ed_idx + 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Queue one packet per frame, up to 8 frames. Stream is continued from the previous transfer if it is still
+// ahead of the current frame otherwise restarted a few frames ahead.
+static bool itd_xfer(ohci_ed_t* ed, uint8_t* buffer, uint16_t buflen)
+{
+  int8_t const slot = itd_find((ed_idx_t) (ed - ohci_data.ed_pool));
+  TU_ASSERT(slot >= 0 && buflen);
+
+  ochi_itd_t* itd = &ohci_data.itd[slot];
+  itd_extra_data_t* extra = &ohci_data.itd_extra[slot];
+  TU_VERIFY(!extra->busy);
+
+  uint16_t const mps = ed->max_packet_size;
+  uint8_t const pkt_count = (uint8_t) ((buflen + mps - 1) / mps);
+  uint32_t const phys = (uint32_t) _phys_addr(buffer);
+
+  // iTD has 8 packets and buffer can only cross one 4K page boundary
+  TU_ASSERT(pkt_count <= TU_ARRAY_SIZE(itd->offset_packetstatus));
+  TU_ASSERT(tu_offset4k(phys) + buflen <= 8192u);
+
+  uint16_t const now   = (uint16_t) OHCI_REG->frame_number;
+  int16_t  const ahead = (int16_t) (extra->next_frame - now);
+  uint16_t const start = (ahead > 0 && ahead <= 2*ITD_SCHED_MARGIN) ? extra->next_frame : (uint16_t) (now + ITD_SCHED_MARGIN);
+
+  tu_memclr(itd, sizeof(ochi_itd_t));
+  itd->starting_frame  = start;
+  itd->delay_interrupt = OHCI_INT_ON_COMPLETE_YES;
+  itd->frame_count     = (uint32_t) (pkt_count - 1);
+  itd->condition_code  = OHCI_CCODE_NOT_ACCESSED;
+  itd->buffer_page0    = tu_align4k(phys);
+  itd->buffer_end      = phys + buflen - 1;
+
+  for ( uint8_t p = 0; p < pkt_count; p++ )
+  {
+    uint32_t const offset = phys + p*mps - itd->buffer_page0; // bit 12 selects page of buffer_end
+    itd->offset_packetstatus[p] = (uint16_t) ((OHCI_CCODE_NOT_ACCESSED << 12) | (offset & 0x1FFFu));
+  }
+
+  extra->buffer     = buffer;
+  extra->buflen     = buflen;
+  extra->pkt_count  = pkt_count;
+  extra->next_frame = (uint16_t) (start + pkt_count);
+  extra->busy       = 1;
+
+  td_insert_to_ed(ed, (ohci_gtd_t*) itd);
+
+  return true;
+}
+
+// Packets missed because the frame already passed are reported as 0 bytes, IN data is compacted so that the
+// transfer buffer is contiguous
+static void itd_done_isr(ochi_itd_t* itd)
+{
+  itd_extra_data_t* extra = &ohci_data.itd_extra[itd - ohci_data.itd];
+  if ( extra->ed_idx == 0 ) return; // device is closed
+
+  ohci_ed_t* ed = &ohci_data.ed_pool[extra->ed_idx - 1];
+  bool const is_in = (ed->pid == PID_IN);
+  uint16_t const mps = ed->max_packet_size;
+
+  xfer_result_t result = XFER_RESULT_SUCCESS;
+  uint32_t xferred_bytes = 0;
+
+  for ( uint8_t p = 0; p < extra->pkt_count; p++ )
+  {
+    uint16_t const psw = itd->offset_packetstatus[p];
+    uint8_t  const cc  = (uint8_t) (psw >> 12);
+    uint32_t const pkt_offset = (uint32_t) p * mps;
+    uint16_t size = 0;
+
+    if ( cc == OHCI_CCODE_NO_ERROR || cc == OHCI_CCODE_DATA_UNDERRUN )
+    {
+      // IN: size received, OUT: packet is sent in full
+      size = is_in ? (psw & 0x7FFu) : (uint16_t) tu_min32(mps, extra->buflen - pkt_offset);
+    }
+    else if ( cc < OHCI_CCODE_NOT_ACCESSED )
+    {
+      result = XFER_RESULT_FAILED;
+    }
+
+    if ( is_in && size && xferred_bytes != pkt_offset )
+    {
+      memmove(extra->buffer + xferred_bytes, extra->buffer + pkt_offset, size);
+    }
+    xferred_bytes += size;
+  }
+
+  extra->busy = 0;
+  hcd_event_xfer_complete(ed->dev_addr, tu_edpt_addr(ed->ep_number, is_in), xferred_bytes, result, true);
+}
+
+#endif
+
 static void done_queue_isr(uint8_t hostid)
 {
   (void) hostid;
@@ -641,17 +925,49 @@ static void done_queue_isr(uint8_t hostid)
 
   while( td_head != NULL )
   {
-    // TODO check if td_head is iso td
+    // TD may be reused by a transfer queued from the completion event, get next first
+    ohci_td_item_t* const td_next = td_head->next ? (ohci_td_item_t*) _virt_addr((void *) td_head->next) : NULL;
+
+#if CFG_TUH_OHCI_ISO_EP_MAX
+    if ( itd_is_iso(td_head) )
+    {
+      itd_done_isr((ochi_itd_t*) td_head);
+      td_head = td_next;
+      continue;
+    }
+#endif
+
     //------------- Non ISO transfer -------------//
     ohci_gtd_t * const qtd = (ohci_gtd_t *) td_head;
-    xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
+    bool const is_last = (qtd->delay_interrupt == OHCI_INT_ON_COMPLETE_YES);
+
+    // short packet of a chained IN TD (not the last): transfer is complete
+    bool const is_short = !is_last && (qtd->condition_code == OHCI_CCODE_DATA_UNDERRUN);
+
+    xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR || is_short) ? XFER_RESULT_SUCCESS :
                                 (qtd->condition_code == OHCI_CCODE_STALL) ? XFER_RESULT_STALLED : XFER_RESULT_FAILED;
 
-    qtd->used = 0; // free TD
-    if ( (qtd->delay_interrupt == OHCI_INT_ON_COMPLETE_YES) || (event != XFER_RESULT_SUCCESS) )
+    ohci_ed_t * const ed = gtd_get_ed(qtd);
+    uint32_t xferred_bytes = gtd_get_extra_data(qtd)->expected_bytes - gtd_xfer_byte_left((uint32_t) qtd->buffer_end, (uint32_t) qtd->current_buffer_pointer);
+
+    if ( !gtd_is_control(qtd) )
+    {
+      // accumulate bytes of chained TDs
+      uint16_t* ed_xferred = &ohci_data.ed_xferred_bytes[ed - ohci_data.ed_pool];
+      xferred_bytes += *ed_xferred;
+      *ed_xferred = (uint16_t) xferred_bytes;
+    }
+
+    gtd_free(qtd);
+
+    if ( is_last || (event != XFER_RESULT_SUCCESS) || is_short )
     {
-      ohci_ed_t * const ed  = gtd_get_ed(qtd);
-      uint32_t const xferred_bytes = gtd_get_extra_data(qtd)->expected_bytes - gtd_xfer_byte_left((uint32_t) qtd->buffer_end, (uint32_t) qtd->current_buffer_pointer);
+      // ED is halted if chain stops before its last TD, drop the rest of it
+      if ( !is_last )
+      {
+        ed_drop_queued_td(ed);
+        if ( is_short ) ed->td_head.halted = 0;
+      }
 
       // NOTE Assuming the current list is BULK and there is no other EDs in the list has queued TDs.
       // When there is a error resulting this ED is halted, and this EP still has other queued TD
@@ -672,7 +988,7 @@ static void done_queue_isr(uint8_t hostid)
       hcd_event_xfer_complete(ed->dev_addr, tu_edpt_addr(ed->ep_number, dir), xferred_bytes, event, true);
     }
 
-    td_head = (ohci_td_item_t*) _virt_addr((void *)td_head->next);
+    td_head = td_next;
   }
 }
 
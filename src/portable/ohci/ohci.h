@@ -38,15 +38,24 @@
 #define OHCI_PERIODIC_LIST (defined HOST_HCD_XFER_INTERRUPT || defined HOST_HCD_XFER_ISOCHRONOUS)
 
 // TODO merge OHCI with EHCI
-enum {
-  OHCI_MAX_ITD = 4
-};
-
 #define ED_MAX       (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
-#define GTD_MAX      ED_MAX
+#define GTD_MAX      (ED_MAX*CFG_TUH_OHCI_GTD_PER_XFER)
+
+// device addresses including dev0, each has its own control ED/TD
+#define ED_CONTROL_MAX  (CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1)
+
+#define OHCI_BITMAP_WORDS(_bits)  (((_bits) + 31u) / 32u)
 
 // tinyUSB's OHCI implementation caps number of EDs to 8 bits
 TU_VERIFY_STATIC (ED_MAX <= 256, "Reduce CFG_TUH_DEVICE_MAX or CFG_TUH_ENDPOINT_MAX");
+TU_VERIFY_STATIC (CFG_TUH_OHCI_GTD_PER_XFER >= 1, "at least 1 TD per transfer");
+
+// index + 1 of pool ED, 0 means none
+#if ED_MAX < UINT8_MAX
+typedef uint8_t ed_idx_t;
+#else
+typedef uint16_t ed_idx_t;
+#endif
 
 //--------------------------------------------------------------------+
 // OHCI Data Structure
@@ -158,6 +167,15 @@ typedef struct {
   uint16_t expected_bytes; // up to 8192 bytes so max is 13 bits
 } gtd_extra_data_t;
 
+typedef struct {
+  uint8_t* buffer;
+  uint16_t buflen;
+  uint16_t next_frame; // frame following the last packet, next transfer continues the stream from here
+  ed_idx_t ed_idx;     // index + 1 of isochronous ED, 0 if free
+  uint8_t  pkt_count;
+  volatile uint8_t busy;
+} itd_extra_data_t;
+
 // structure with member alignment required from large to small
 typedef struct TU_ATTR_ALIGNED(256) {
   ohci_hcca_t hcca;
@@ -171,13 +189,26 @@ typedef struct TU_ATTR_ALIGNED(256) {
     ohci_gtd_t gtd;
   } control[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1];
 
-  //  ochi_itd_t itd[OHCI_MAX_ITD]; // itd requires alignment of 32
+#if CFG_TUH_OHCI_ISO_EP_MAX
+  ochi_itd_t itd[CFG_TUH_OHCI_ISO_EP_MAX]; // one per isochronous endpoint, itd requires alignment of 32
+#endif
   ohci_ed_t ed_pool[ED_MAX];
   ohci_gtd_t gtd_pool[GTD_MAX];
 
   // extra data needed by TDs that can't fit in the TD struct
   gtd_extra_data_t gtd_extra_control[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1];
   gtd_extra_data_t gtd_extra[GTD_MAX];
+#if CFG_TUH_OHCI_ISO_EP_MAX
+  itd_extra_data_t itd_extra[CFG_TUH_OHCI_ISO_EP_MAX];
+#endif
+
+  // Constant time pool management: endpoint lookup table and free bitmaps. Bits are updated atomically since
+  // TDs are freed in ISR
+  ed_idx_t ep2ed[ED_CONTROL_MAX][CFG_TUH_ENDPOINT_MAX][2];
+  uint32_t ed_free_map[OHCI_BITMAP_WORDS(ED_MAX)];
+  uint32_t gtd_free_map[OHCI_BITMAP_WORDS(GTD_MAX)];
+
+  uint16_t ed_xferred_bytes[ED_MAX]; // bytes of TDs of the transfer in progress retired so far
 
   volatile uint16_t frame_number_hi;
 } ohci_data_t;
@@ -40,26 +40,165 @@
 #include "host/hcd.h"
 #include "host/usbh.h"
 
+#if CFG_TUH_RPI_PIO_USB_CORE1
+#include "pico/multicore.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#endif
+
 #define RHPORT_OFFSET     1
 #define RHPORT_PIO(_x)    ((_x)-RHPORT_OFFSET)
 
+// Events queued from core1 frame engine to core0, must be power of 2
+#ifndef PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE
+#define PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE   32
+#endif
+
+TU_VERIFY_STATIC((PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE & (PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE - 1)) == 0,
+                 "queue size must be power of 2");
+
 static pio_usb_configuration_t pio_host_cfg = PIO_USB_DEFAULT_CONFIG;
 
+// Additional root ports added with TUH_CFGID_RPI_PIO_USB_ADD_PORT, they share the PIO state machines of the first one
+static tuh_configure_pio_usb_port_t _extra_port[PIO_USB_ROOT_PORT_CNT - 1];
+static uint8_t _extra_port_count = 0;
+
+static void pio_host_init(void) {
+  pio_usb_host_init(&pio_host_cfg);
+
+  for (uint8_t i = 0; i < _extra_port_count; i++) {
+    pio_usb_host_add_port(_extra_port[i].pin_dp, (PIO_USB_PINOUT) _extra_port[i].pinout);
+  }
+}
+
+//--------------------------------------------------------------------+
+// Core1 offload
+// Frame engine (SOF and all transactions) runs on core1 in a tight loop. Events are passed to core0 with a
+// single producer, single consumer ring. Core1 rings a doorbell by writing to the inter-core FIFO whose
+// SIO_IRQ_PROC0 interrupt then forwards the events to usbh on core0.
+//--------------------------------------------------------------------+
+#if CFG_TUH_RPI_PIO_USB_CORE1
+
+#define CORE1_READY   0x55534231u
+
+typedef struct {
+  hcd_event_t event[PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE];
+  uint16_t wr_idx; // written by core1 only
+  uint16_t rd_idx; // written by core0 only
+} core1_event_queue_t;
+
+static core1_event_queue_t _core1_evq;
+
+// core1: queue an event to core0
+static void __no_inline_not_in_flash_func(core1_event_push)(hcd_event_t const* event) {
+  const uint16_t wr_idx = _core1_evq.wr_idx;
+
+  // queue full: wait for core0, an event must never be dropped otherwise usbh would stall
+  while ((uint16_t) (wr_idx - __atomic_load_n(&_core1_evq.rd_idx, __ATOMIC_ACQUIRE)) >=
+         PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE) {
+    tight_loop_contents();
+  }
+
+  _core1_evq.event[wr_idx & (PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE - 1)] = *event;
+  __atomic_store_n(&_core1_evq.wr_idx, (uint16_t) (wr_idx + 1), __ATOMIC_RELEASE);
+
+  // doorbell; if FIFO is full core0 has interrupt pending and will see this event anyway
+  if (multicore_fifo_wready()) {
+    sio_hw->fifo_wr = 0;
+  }
+}
+
+// core0: SIO FIFO interrupt, forward queued events to usbh
+static void __no_inline_not_in_flash_func(core1_event_isr)(void) {
+  // drain doorbells first so that any event queued after the ring is read raises the interrupt again
+  multicore_fifo_drain();
+  multicore_fifo_clear_irq();
+
+  uint16_t rd_idx = _core1_evq.rd_idx;
+  while (rd_idx != __atomic_load_n(&_core1_evq.wr_idx, __ATOMIC_ACQUIRE)) {
+    hcd_event_handler(&_core1_evq.event[rd_idx & (PIO_USB_HOST_CORE1_EVENT_QUEUE_SIZE - 1)], true);
+    rd_idx++;
+    __atomic_store_n(&_core1_evq.rd_idx, rd_idx, __ATOMIC_RELEASE);
+  }
+}
+
+static void __no_inline_not_in_flash_func(core1_main)(void) {
+  pio_host_init();
+  multicore_fifo_push_blocking(CORE1_READY);
+
+  // run frame every 1 ms, resync if we fell behind more than a frame e.g flash write lockout
+  uint64_t next_us = time_us_64();
+  while (1) {
+    next_us += 1000;
+    while ((int64_t) (time_us_64() - next_us) < 0) {
+      tight_loop_contents();
+    }
+    if (time_us_64() - next_us > 1000) {
+      next_us = time_us_64();
+    }
+
+    pio_usb_host_frame();
+  }
+}
+
+#endif
+
+TU_ATTR_ALWAYS_INLINE static inline void pio_event_submit(hcd_event_t const* event) {
+#if CFG_TUH_RPI_PIO_USB_CORE1
+  core1_event_push(event);
+#else
+  hcd_event_handler(event, true);
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void port_event_submit(uint8_t rhport, uint8_t event_id) {
+  hcd_event_t event = {
+    .rhport   = rhport,
+    .event_id = event_id,
+  };
+  event.connection.hub_addr = 0;
+  event.connection.hub_port = 0;
+  pio_event_submit(&event);
+}
+
 //--------------------------------------------------------------------+
 // HCD API
 //--------------------------------------------------------------------+
 bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
   (void) rhport;
-  TU_VERIFY(cfg_id == TUH_CFGID_RPI_PIO_USB_CONFIGURATION);
-  memcpy(&pio_host_cfg, cfg_param, sizeof(pio_usb_configuration_t));
-  return true;
+
+  switch (cfg_id) {
+    case TUH_CFGID_RPI_PIO_USB_CONFIGURATION:
+      memcpy(&pio_host_cfg, cfg_param, sizeof(pio_usb_configuration_t));
+      return true;
+
+    case TUH_CFGID_RPI_PIO_USB_ADD_PORT:
+      TU_VERIFY(_extra_port_count < TU_ARRAY_SIZE(_extra_port));
+      memcpy(&_extra_port[_extra_port_count++], cfg_param, sizeof(tuh_configure_pio_usb_port_t));
+      return true;
+
+    default:
+      return false;
+  }
 }
 
 bool hcd_init(uint8_t rhport) {
   (void) rhport;
 
+#if CFG_TUH_RPI_PIO_USB_CORE1
+  // frame is driven by core1 loop instead of alarm pool
+  pio_host_cfg.skip_alarm_pool = true;
+
+  multicore_launch_core1(core1_main);
+  TU_VERIFY(multicore_fifo_pop_blocking() == CORE1_READY);
+
+  multicore_fifo_drain();
+  multicore_fifo_clear_irq();
+  irq_set_exclusive_handler(SIO_IRQ_PROC0, core1_event_isr); // enabled by hcd_int_enable()
+#else
   // To run USB SOF interrupt in core1, call this init in core1
-  pio_usb_host_init(&pio_host_cfg);
+  pio_host_init();
+#endif
 
   return true;
 }
@@ -102,10 +241,16 @@ uint32_t hcd_frame_number(uint8_t rhport) {
 
 void hcd_int_enable(uint8_t rhport) {
   (void) rhport;
+#if CFG_TUH_RPI_PIO_USB_CORE1
+  irq_set_enabled(SIO_IRQ_PROC0, true);
+#endif
 }
 
 void hcd_int_disable(uint8_t rhport) {
   (void) rhport;
+#if CFG_TUH_RPI_PIO_USB_CORE1
+  irq_set_enabled(SIO_IRQ_PROC0, false);
+#endif
 }
 
 //--------------------------------------------------------------------+
@@ -168,7 +313,15 @@ static void __no_inline_not_in_flash_func(handle_endpoint_irq)(root_port_t *rpor
 
     if ( ep_all & mask ) {
       endpoint_t * ep = PIO_USB_ENDPOINT(ep_idx);
-      hcd_event_xfer_complete(ep->dev_addr, ep->ep_num, ep->actual_len, result, true);
+      hcd_event_t event = {
+        .rhport   = 0,
+        .event_id = HCD_EVENT_XFER_COMPLETE,
+        .dev_addr = ep->dev_addr,
+      };
+      event.xfer_complete.ep_addr = ep->ep_num;
+      event.xfer_complete.result = result;
+      event.xfer_complete.len = ep->actual_len;
+      pio_event_submit(&event);
     }
   }
 
@@ -176,9 +329,9 @@ static void __no_inline_not_in_flash_func(handle_endpoint_irq)(root_port_t *rpor
   (*ep_reg) &= ~ep_all;
 }
 
-// IRQ Handler
+// IRQ Handler, invoked by the frame engine (on core1 with CFG_TUH_RPI_PIO_USB_CORE1)
 void __no_inline_not_in_flash_func(pio_usb_host_irq_handler)(uint8_t root_id) {
-  uint8_t const tu_rhport = root_id + 1;
+  uint8_t const tu_rhport = root_id + RHPORT_OFFSET;
   root_port_t *rport = PIO_USB_ROOT_PORT(root_id);
   uint32_t const ints = rport->ints;
 
@@ -195,11 +348,11 @@ void __no_inline_not_in_flash_func(pio_usb_host_irq_handler)(uint8_t root_id) {
   }
 
   if ( ints & PIO_USB_INTS_CONNECT_BITS ) {
-    hcd_event_device_attach(tu_rhport, true);
+    port_event_submit(tu_rhport, HCD_EVENT_DEVICE_ATTACH);
   }
 
   if ( ints & PIO_USB_INTS_DISCONNECT_BITS ) {
-    hcd_event_device_remove(tu_rhport, true);
+    port_event_submit(tu_rhport, HCD_EVENT_DEVICE_REMOVE);
   }
 
   // clear all
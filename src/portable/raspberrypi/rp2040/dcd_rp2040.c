@@ -164,7 +164,11 @@ static void hw_endpoint_init(uint8_t ep_addr, uint16_t wMaxPacketSize, uint8_t t
 
 static void hw_endpoint_xfer(uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
   struct hw_endpoint* ep = hw_endpoint_get_by_addr(ep_addr);
-  hw_endpoint_xfer_start(ep, buffer, total_bytes);
+  if (hw_endpoint_xfer_start(ep, buffer, total_bytes)) {
+    // OUT data was already received in buffer that was armed ahead of this transfer
+    dcd_event_xfer_complete(0, ep->ep_addr, ep->xferred_len, XFER_RESULT_SUCCESS, false);
+    hw_endpoint_reset_transfer(ep);
+  }
 }
 
 static void __tusb_irq_path_func(hw_handle_buff_status)(void) {
@@ -524,6 +528,7 @@ void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
   // stall and clear current pending buffer
   // may need to use EP_ABORT
   _hw_endpoint_buffer_control_set_value32(ep, USB_BUF_CTRL_STALL);
+  hw_endpoint_reset_double_buffer(ep);
 }
 
 void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
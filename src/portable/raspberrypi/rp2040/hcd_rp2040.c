@@ -30,6 +30,7 @@
 #if CFG_TUH_ENABLED && (CFG_TUSB_MCU == OPT_MCU_RP2040) && !CFG_TUH_RPI_PIO_USB && !CFG_TUH_MAX3421
 
 #include "pico.h"
+#include "hardware/sync.h"
 #include "rp2040_usb.h"
 
 //--------------------------------------------------------------------+
@@ -52,16 +53,62 @@
 #endif
 static_assert(PICO_USB_HOST_INTERRUPT_ENDPOINTS <= USB_MAX_ENDPOINTS, "");
 
+// Bulk endpoints time-share epx with control endpoint, which is switched between pending transfers every frame.
+// Unlike "interrupt" endpoints (polled at most once per frame) epx can transfer multiple packets per frame.
+// Bulk endpoints fall back to interrupt endpoints if set to 0 or epx endpoints are all used.
+#ifndef PICO_USB_HOST_EPX_BULK_ENDPOINTS
+#define PICO_USB_HOST_EPX_BULK_ENDPOINTS (2 * CFG_TUH_DEVICE_MAX)
+#endif
+static_assert(PICO_USB_HOST_EPX_BULK_ENDPOINTS < 32, "");
+
 // Host mode uses one shared endpoint register for non-interrupt endpoint
 static struct hw_endpoint ep_pool[1 + PICO_USB_HOST_INTERRUPT_ENDPOINTS];
 #define epx (ep_pool[0])
 
+// Bulk endpoints sharing epx, hardware registers are only written while endpoint owns epx
+static struct hw_endpoint epx_bulk[PICO_USB_HOST_EPX_BULK_ENDPOINTS ? PICO_USB_HOST_EPX_BULK_ENDPOINTS : 1];
+
+// epx scheduler: index 0 is control endpoint, index 1+n is epx_bulk[n]
+enum {
+  EPX_IDX_NONE = 0xff
+};
+
+static struct {
+  volatile uint32_t pending_map; // transfer is queued waiting for epx
+  uint32_t nak_map;              // endpoint was NAKed during its last time slice, lower priority
+  volatile uint8_t owner;        // endpoint currently using epx
+  uint8_t last;                  // last scheduled bulk endpoint, for round-robin
+  bool setup;                    // control endpoint is queued to send setup packet
+} epx_sched;
+
+// extend 11-bit hardware frame number to 32-bit
+static struct {
+  uint32_t count;
+  uint16_t last; // last sof_rd read
+} frame_ext;
+
 // Flags we set by default in sie_ctrl (we add other bits on top)
 enum {
   SIE_CTRL_BASE = USB_SIE_CTRL_SOF_EN_BITS      | USB_SIE_CTRL_KEEP_ALIVE_EN_BITS |
                   USB_SIE_CTRL_PULLDOWN_EN_BITS | USB_SIE_CTRL_EP0_INT_1BUF_BITS
 };
 
+TU_ATTR_ALWAYS_INLINE static inline struct hw_endpoint* epx_get(uint8_t idx)
+{
+  return idx ? &epx_bulk[idx - 1] : &epx;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t epx_idx(struct hw_endpoint const * ep)
+{
+  return (ep == &epx) ? 0 : (uint8_t) (ep - epx_bulk + 1);
+}
+
+// Endpoint is (time) sharing epx registers
+TU_ATTR_ALWAYS_INLINE static inline bool epx_shared(struct hw_endpoint const * ep)
+{
+  return ep->endpoint_control == &usbh_dpram->epx_ctrl;
+}
+
 static struct hw_endpoint *get_dev_ep(uint8_t dev_addr, uint8_t ep_addr)
 {
   uint8_t num = tu_edpt_number(ep_addr);
@@ -73,6 +120,12 @@ static struct hw_endpoint *get_dev_ep(uint8_t dev_addr, uint8_t ep_addr)
     if ( ep->configured && (ep->dev_addr == dev_addr) && (ep->ep_addr == ep_addr) ) return ep;
   }
 
+  for ( uint32_t i = 0; i < TU_ARRAY_SIZE(epx_bulk); i++ )
+  {
+    struct hw_endpoint *ep = &epx_bulk[i];
+    if ( ep->configured && (ep->dev_addr == dev_addr) && (ep->ep_addr == ep_addr) ) return ep;
+  }
+
   return NULL;
 }
 
@@ -88,6 +141,120 @@ TU_ATTR_ALWAYS_INLINE static inline bool need_pre(uint8_t dev_addr)
   return hcd_port_speed_get(0) != tuh_speed_get(dev_addr);
 }
 
+//--------------------------------------------------------------------+
+// epx scheduler
+//--------------------------------------------------------------------+
+
+static uint32_t ep_ctrl_value(struct hw_endpoint const *ep, uint8_t bmInterval)
+{
+  uint32_t ep_reg = EP_CTRL_ENABLE_BITS
+                    | EP_CTRL_INTERRUPT_PER_BUFFER
+                    | (ep->transfer_type << EP_CTRL_BUFFER_TYPE_LSB)
+                    | hw_data_offset(ep->hw_data_buf);
+  if ( bmInterval )
+  {
+    ep_reg |= (uint32_t) ((bmInterval - 1) << EP_CTRL_HOST_INTERRUPT_INTERVAL_LSB);
+  }
+  return ep_reg;
+}
+
+// SOF interrupt is only needed to switch epx while other endpoints are waiting for it
+static void __tusb_irq_path_func(epx_sof_update)(void)
+{
+  if ( epx_sched.pending_map && epx_sched.owner != EPX_IDX_NONE )
+  {
+    usb_hw_set->inte = USB_INTE_HOST_SOF_BITS;
+  }else
+  {
+    usb_hw_clear->inte = USB_INTE_HOST_SOF_BITS;
+  }
+}
+
+// Program epx registers with the endpoint and start (or resume) its transfer
+static void __tusb_irq_path_func(epx_start)(uint8_t idx)
+{
+  struct hw_endpoint *ep = epx_get(idx);
+  uint8_t const dev_addr = ep->dev_addr;
+
+  epx_sched.owner = idx;
+  epx_sched.pending_map &= ~TU_BIT(idx);
+
+  *ep->endpoint_control = ep_ctrl_value(ep, 0);
+  usb_hw_clear->sie_status = USB_SIE_STATUS_NAK_REC_BITS;
+
+  uint32_t flags = USB_SIE_CTRL_START_TRANS_BITS | SIE_CTRL_BASE |
+                   (need_pre(dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
+
+  if ( idx == 0 && epx_sched.setup )
+  {
+    epx_sched.setup = false;
+    usb_hw->dev_addr_ctrl = dev_addr;
+    flags |= USB_SIE_CTRL_SEND_SETUP_BITS;
+  }else
+  {
+    hw_endpoint_start_next_buffer(ep);
+    usb_hw->dev_addr_ctrl = (uint32_t) (dev_addr | (tu_edpt_number(ep->ep_addr) << USB_ADDR_ENDP_ENDPOINT_LSB));
+    flags |= (ep->rx ? USB_SIE_CTRL_RECEIVE_DATA_BITS : USB_SIE_CTRL_SEND_DATA_BITS);
+  }
+
+  // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
+  // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
+  // We write everything except the START_TRANS bit first, then wait some cycles.
+  usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
+  busy_wait_at_least_cycles(12);
+  usb_hw->sie_ctrl = flags;
+}
+
+// Pick next endpoint for epx if it is idle: control first, then round-robin of bulk endpoints
+// that were not NAKed in their last slice, then the NAKed ones.
+static void __tusb_irq_path_func(epx_schedule)(void)
+{
+  uint32_t const pending = epx_sched.pending_map;
+
+  if ( epx_sched.owner == EPX_IDX_NONE && pending )
+  {
+    uint8_t next = 0;
+
+    if ( !(pending & TU_BIT(0)) )
+    {
+      uint32_t candidates = pending & ~epx_sched.nak_map;
+      if ( candidates )
+      {
+        // NAKed endpoints skip this round only
+        epx_sched.nak_map &= ~pending;
+      }else
+      {
+        candidates = pending;
+      }
+
+      // rotate so that search starts after last scheduled endpoint
+      uint32_t const after = candidates & ~((TU_BIT(epx_sched.last) << 1) - 1);
+      next = (uint8_t) __builtin_ctz(after ? after : candidates);
+      epx_sched.last = next;
+    }
+
+    epx_start(next);
+  }
+
+  epx_sof_update();
+}
+
+// Queue transfer on an epx endpoint, it is started right away if epx is idle
+static void epx_xfer_queue(struct hw_endpoint *ep, uint8_t *buffer, uint16_t buflen)
+{
+  uint32_t const save = save_and_disable_interrupts();
+
+  ep->remaining_len = buflen;
+  ep->xferred_len   = 0;
+  ep->user_buf      = buffer;
+  ep->active        = true;
+
+  epx_sched.pending_map |= TU_BIT(epx_idx(ep));
+  epx_schedule();
+
+  restore_interrupts(save);
+}
+
 static void __tusb_irq_path_func(hw_xfer_complete)(struct hw_endpoint *ep, xfer_result_t xfer_result)
 {
   // Mark transfer as done before we tell the tinyusb stack
@@ -95,7 +262,60 @@ static void __tusb_irq_path_func(hw_xfer_complete)(struct hw_endpoint *ep, xfer_
   uint8_t ep_addr = ep->ep_addr;
   uint xferred_len = ep->xferred_len;
   hw_endpoint_reset_transfer(ep);
+
+  // release epx so that next pending endpoint can use it
+  bool const is_epx = epx_shared(ep);
+  if ( is_epx )
+  {
+    epx_sched.owner = EPX_IDX_NONE;
+    epx_sched.nak_map &= ~TU_BIT(epx_idx(ep));
+  }
+
   hcd_event_xfer_complete(dev_addr, ep_addr, xferred_len, xfer_result, true);
+
+  if ( is_epx ) epx_schedule();
+}
+
+// Switch epx to another pending endpoint at start of frame. Current bulk transfer is stopped after the
+// ongoing transaction and resumed when it is scheduled again. Control transfers are never preempted.
+static void __tusb_irq_path_func(epx_sof_isr)(void)
+{
+  uint8_t const idx = epx_sched.owner;
+  bool const nak = usb_hw->sie_status & USB_SIE_STATUS_NAK_REC_BITS;
+  usb_hw_clear->sie_status = USB_SIE_STATUS_NAK_REC_BITS;
+
+  if ( idx == EPX_IDX_NONE || idx == 0 || !epx_sched.pending_map )
+  {
+    epx_sof_update();
+    return;
+  }
+
+  struct hw_endpoint *ep = epx_get(idx);
+
+  usb_hw_set->sie_ctrl = USB_SIE_CTRL_STOP_TRANS_BITS;
+  busy_wait_at_least_cycles(12);
+
+  bool const done = hw_endpoint_xfer_pause(ep);
+  usb_hw_clear->buf_status = 0b1; // epx buffer (if any) is already synced
+  usb_hw_clear->sie_status = USB_SIE_STATUS_TRANS_COMPLETE_BITS; // not to be mistaken for next setup packet
+
+  if ( nak )
+  {
+    epx_sched.nak_map |= TU_BIT(idx);
+  }else
+  {
+    epx_sched.nak_map &= ~TU_BIT(idx);
+  }
+
+  if ( done )
+  {
+    hw_xfer_complete(ep, XFER_RESULT_SUCCESS);
+  }else
+  {
+    epx_sched.owner = EPX_IDX_NONE;
+    epx_sched.pending_map |= TU_BIT(idx);
+    epx_schedule();
+  }
 }
 
 static void __tusb_irq_path_func(_handle_buff_status_bit)(uint bit, struct hw_endpoint *ep)
@@ -120,7 +340,7 @@ static void __tusb_irq_path_func(hw_handle_buff_status)(void)
   if ( remaining_buffers & bit )
   {
     remaining_buffers &= ~bit;
-    struct hw_endpoint * ep = &epx;
+    struct hw_endpoint * ep = epx_get(epx_sched.owner == EPX_IDX_NONE ? 0 : epx_sched.owner);
 
     uint32_t ep_ctrl = *ep->endpoint_control;
     if ( ep_ctrl & EP_CTRL_DOUBLE_BUFFERED_BITS )
@@ -133,7 +353,14 @@ static void __tusb_irq_path_func(hw_handle_buff_status)(void)
     }
     TU_LOG_HEX(3, ep_ctrl);
 
-    _handle_buff_status_bit(bit, ep);
+    if ( epx_sched.owner == EPX_IDX_NONE )
+    {
+      // transfer was already stopped and its buffers synced when switching epx
+      usb_hw_clear->buf_status = bit;
+    }else
+    {
+      _handle_buff_status_bit(bit, ep);
+    }
   }
 
   // Check "interrupt" (asynchronous) endpoints for both IN and OUT
@@ -166,7 +393,7 @@ static void __tusb_irq_path_func(hw_handle_buff_status)(void)
 
 static void __tusb_irq_path_func(hw_trans_complete)(void)
 {
-  if (usb_hw->sie_ctrl & USB_SIE_CTRL_SEND_SETUP_BITS)
+  if ( epx_sched.owner == 0 && (usb_hw->sie_ctrl & USB_SIE_CTRL_SEND_SETUP_BITS) )
   {
     pico_trace("Sent setup packet\n");
     struct hw_endpoint *ep = &epx;
@@ -213,7 +440,7 @@ static void __tusb_irq_path_func(hcd_rp2040_irq)(void)
     pico_trace("Stall REC\n");
     handled |= USB_INTS_STALL_BITS;
     usb_hw_clear->sie_status = USB_SIE_STATUS_STALL_REC_BITS;
-    hw_xfer_complete(&epx, XFER_RESULT_STALLED);
+    hw_xfer_complete(epx_sched.owner == EPX_IDX_NONE ? &epx : epx_get(epx_sched.owner), XFER_RESULT_STALLED);
   }
 
   if ( status & USB_INTS_BUFF_STATUS_BITS )
@@ -231,6 +458,13 @@ static void __tusb_irq_path_func(hcd_rp2040_irq)(void)
     hw_trans_complete();
   }
 
+  if ( status & USB_INTS_HOST_SOF_BITS )
+  {
+    handled |= USB_INTS_HOST_SOF_BITS;
+    (void) usb_hw->sof_rd; // clear SOF interrupt
+    epx_sof_isr();
+  }
+
   if ( status & USB_INTS_ERROR_RX_TIMEOUT_BITS )
   {
     handled |= USB_INTS_ERROR_RX_TIMEOUT_BITS;
@@ -274,11 +508,28 @@ static struct hw_endpoint *_next_free_interrupt_ep(void)
   return ep;
 }
 
+static struct hw_endpoint *_next_free_epx_bulk_ep(void)
+{
+  for ( uint i = 0; i < TU_ARRAY_SIZE(epx_bulk); i++ )
+  {
+    if ( !epx_bulk[i].configured ) return &epx_bulk[i];
+  }
+  return NULL;
+}
+
 static struct hw_endpoint *_hw_endpoint_allocate(uint8_t transfer_type)
 {
   struct hw_endpoint * ep = NULL;
 
-  if ( transfer_type != TUSB_XFER_CONTROL )
+  if ( PICO_USB_HOST_EPX_BULK_ENDPOINTS && transfer_type == TUSB_XFER_BULK && (ep = _next_free_epx_bulk_ep()) != NULL )
+  {
+    // share epx with control endpoint, double buffered
+    pico_info("Allocate %s ep on epx\n", tu_edpt_type_str(transfer_type));
+    ep->buffer_control = &usbh_dpram->epx_buf_ctrl;
+    ep->endpoint_control = &usbh_dpram->epx_ctrl;
+    ep->hw_data_buf = &usbh_dpram->epx_data[0];
+  }
+  else if ( transfer_type != TUSB_XFER_CONTROL )
   {
     // Note: even though datasheet name these "Interrupt" endpoints. These are actually
     // "Asynchronous" endpoints and can be used for other type such as: Bulk  (ISO need confirmation)
@@ -287,7 +538,7 @@ static struct hw_endpoint *_hw_endpoint_allocate(uint8_t transfer_type)
     assert(ep);
     ep->buffer_control = &usbh_dpram->int_ep_buffer_ctrl[ep->interrupt_num].ctrl;
     ep->endpoint_control = &usbh_dpram->int_ep_ctrl[ep->interrupt_num].ctrl;
-    // 0 for epx (double buffered): TODO increase to 1024 for ISO
+    // 0 for epx (double buffered)
     // 2x64 for intep0
     // 3x64 for intep1
     // etc
@@ -327,25 +578,18 @@ static void _hw_endpoint_init(struct hw_endpoint *ep, uint8_t dev_addr, uint8_t
 
   pico_trace("hw_endpoint_init dev %d ep %02X xfer %d\n", ep->dev_addr, ep->ep_addr, ep->transfer_type);
   pico_trace("dev %d ep %02X setup buffer @ 0x%p\n", ep->dev_addr, ep->ep_addr, ep->hw_data_buf);
-  uint dpram_offset = hw_data_offset(ep->hw_data_buf);
   // Bits 0-5 should be 0
-  assert(!(dpram_offset & 0b111111));
-
-  // Fill in endpoint control register with buffer offset
-  uint32_t ep_reg = EP_CTRL_ENABLE_BITS
-                    | EP_CTRL_INTERRUPT_PER_BUFFER
-                    | (ep->transfer_type << EP_CTRL_BUFFER_TYPE_LSB)
-                    | dpram_offset;
-  if ( bmInterval )
-  {
-    ep_reg |= (uint32_t) ((bmInterval - 1) << EP_CTRL_HOST_INTERRUPT_INTERVAL_LSB);
-  }
-  *ep->endpoint_control = ep_reg;
-  pico_trace("endpoint control (0x%p) <- 0x%lx\n", ep->endpoint_control, ep_reg);
+  assert(!(hw_data_offset(ep->hw_data_buf) & 0b111111));
   ep->configured = true;
 
-  if ( ep != &epx )
+  // epx registers are written by epx_start() when endpoint is scheduled
+  if ( !epx_shared(ep) )
   {
+    // Fill in endpoint control register with buffer offset
+    uint32_t const ep_reg = ep_ctrl_value(ep, bmInterval);
+    *ep->endpoint_control = ep_reg;
+    pico_trace("endpoint control (0x%p) <- 0x%lx\n", ep->endpoint_control, ep_reg);
+
     // Endpoint has its own addr_endp and interrupt bits to be setup!
     // This is an interrupt/async endpoint. so need to set up ADDR_ENDP register with:
     // - device address
@@ -394,6 +638,9 @@ bool hcd_init(uint8_t rhport)
 
   // clear epx and interrupt eps
   memset(&ep_pool, 0, sizeof(ep_pool));
+  memset(&epx_bulk, 0, sizeof(epx_bulk));
+  memset(&epx_sched, 0, sizeof(epx_sched));
+  epx_sched.owner = EPX_IDX_NONE;
 
   // Enable in host mode with SOF / Keep alive on
   usb_hw->main_ctrl = USB_MAIN_CTRL_CONTROLLER_EN_BITS | USB_MAIN_CTRL_HOST_NDEVICE_BITS;
@@ -483,12 +730,47 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr)
       hw_endpoint_reset_transfer(ep);
     }
   }
+
+  uint32_t const save = save_and_disable_interrupts();
+
+  for (size_t i = 0; i < TU_ARRAY_SIZE(epx_bulk); i++)
+  {
+    hw_endpoint_t* ep = &epx_bulk[i];
+
+    if (ep->dev_addr == dev_addr && ep->configured)
+    {
+      uint8_t const idx = epx_idx(ep);
+
+      if (epx_sched.owner == idx)
+      {
+        // stop transfer in progress and release epx
+        usb_hw_set->sie_ctrl = USB_SIE_CTRL_STOP_TRANS_BITS;
+        busy_wait_at_least_cycles(12);
+        *ep->buffer_control = 0;
+        usb_hw_clear->buf_status = 0b1;
+        usb_hw_clear->sie_status = USB_SIE_STATUS_TRANS_COMPLETE_BITS;
+        epx_sched.owner = EPX_IDX_NONE;
+      }
+
+      epx_sched.pending_map &= ~TU_BIT(idx);
+      epx_sched.nak_map &= ~TU_BIT(idx);
+
+      ep->configured = false;
+      hw_endpoint_reset_transfer(ep);
+    }
+  }
+
+  epx_schedule();
+  restore_interrupts(save);
 }
 
 uint32_t hcd_frame_number(uint8_t rhport)
 {
   (void) rhport;
-  return usb_hw->sof_rd;
+  uint16_t const frnum = (uint16_t) usb_hw->sof_rd;
+  frame_ext.count += (uint16_t) (frnum - frame_ext.last) & 0x7FFu;
+  frame_ext.last = frnum;
+  return frame_ext.count;
 }
 
 void hcd_int_enable(uint8_t rhport)
@@ -536,9 +818,6 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
 
   pico_trace("hcd_edpt_xfer dev_addr %d, ep_addr 0x%x, len %d\n", dev_addr, ep_addr, buflen);
 
-  uint8_t const ep_num = tu_edpt_number(ep_addr);
-  tusb_dir_t const ep_dir = tu_edpt_dir(ep_addr);
-
   // Get appropriate ep. Either EPX or interrupt endpoint
   struct hw_endpoint *ep = get_dev_ep(dev_addr, ep_addr);
 
@@ -550,32 +829,18 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   // Control endpoint can change direction 0x00 <-> 0x80
   if ( ep_addr != ep->ep_addr )
   {
-    assert(ep_num == 0);
+    assert(tu_edpt_number(ep_addr) == 0);
 
     // Direction has flipped on endpoint control so re init it but with same properties
     _hw_endpoint_init(ep, dev_addr, ep_addr, ep->wMaxPacketSize, ep->transfer_type, 0);
   }
 
-  // If a normal transfer (non-interrupt) then initiate using
-  // sie ctrl registers. Otherwise interrupt ep registers should
+  // If a normal transfer (non-interrupt) then queue it for epx, which is initiated
+  // using sie ctrl registers once scheduled. Otherwise interrupt ep registers should
   // already be configured
-  if ( ep == &epx )
+  if ( epx_shared(ep) )
   {
-    hw_endpoint_xfer_start(ep, buffer, buflen);
-
-    // That has set up buffer control, endpoint control etc
-    // for host we have to initiate the transfer
-    usb_hw->dev_addr_ctrl = (uint32_t) (dev_addr | (ep_num << USB_ADDR_ENDP_ENDPOINT_LSB));
-
-    uint32_t flags = USB_SIE_CTRL_START_TRANS_BITS | SIE_CTRL_BASE |
-                     (ep_dir ? USB_SIE_CTRL_RECEIVE_DATA_BITS : USB_SIE_CTRL_SEND_DATA_BITS) |
-                     (need_pre(dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
-    // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
-    // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
-    // We write everything except the START_TRANS bit first, then wait some cycles.
-    usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
-    busy_wait_at_least_cycles(12);
-    usb_hw->sie_ctrl = flags;
+    epx_xfer_queue(ep, buffer, buflen);
   }else
   {
     hw_endpoint_xfer_start(ep, buffer, buflen);
@@ -613,22 +878,17 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   _hw_endpoint_init(ep, dev_addr, 0x00, ep->wMaxPacketSize, 0, 0);
   assert(ep->configured);
 
+  // Setup packet is sent (with pre if needed) when epx is scheduled for control endpoint
+  uint32_t const save = save_and_disable_interrupts();
+
   ep->remaining_len = 8;
   ep->active = true;
 
-  // Set device address
-  usb_hw->dev_addr_ctrl = dev_addr;
+  epx_sched.setup = true;
+  epx_sched.pending_map |= TU_BIT(0);
+  epx_schedule();
 
-  // Set pre if we are a low speed device on full speed hub
-  uint32_t const flags = SIE_CTRL_BASE | USB_SIE_CTRL_SEND_SETUP_BITS | USB_SIE_CTRL_START_TRANS_BITS |
-                         (need_pre(dev_addr) ? USB_SIE_CTRL_PREAMBLE_EN_BITS : 0);
-
-  // START_TRANS bit on SIE_CTRL seems to exhibit the same behavior as the AVAILABLE bit
-  // described in RP2040 Datasheet, release 2.1, section "4.1.2.5.1. Concurrent access".
-  // We write everything except the START_TRANS bit first, then wait some cycles.
-  usb_hw->sie_ctrl = flags & ~USB_SIE_CTRL_START_TRANS_BITS;
-  busy_wait_at_least_cycles(12);
-  usb_hw->sie_ctrl = flags;
+  restore_interrupts(save);
 
   return true;
 }
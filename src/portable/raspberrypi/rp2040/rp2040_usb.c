@@ -30,6 +30,7 @@
 #if CFG_TUSB_MCU == OPT_MCU_RP2040
 
 #include <stdlib.h>
+#include "hardware/sync.h"
 #include "rp2040_usb.h"
 
 //--------------------------------------------------------------------+
@@ -37,6 +38,14 @@
 //--------------------------------------------------------------------+
 static void _hw_endpoint_xfer_sync(struct hw_endpoint* ep);
 
+// Recursive endpoint lock, see hw_endpoint_lock_update()
+static struct {
+  spin_lock_t* lock;
+  volatile uint8_t owner; // core holding the lock, 0xff if free
+  uint8_t depth;
+  uint32_t irq_save;
+} _ep_lock = { .lock = NULL, .owner = 0xff, .depth = 0, .irq_save = 0 };
+
 #if TUD_OPT_RP2040_USB_DEVICE_UFRAME_FIX
   static bool e15_is_bulkin_ep(struct hw_endpoint* ep);
   static bool e15_is_critical_frame_period(struct hw_endpoint* ep);
@@ -50,6 +59,17 @@ TU_ATTR_ALWAYS_INLINE static inline bool is_host_mode(void) {
   return (usb_hw->main_ctrl & USB_MAIN_CTRL_HOST_NDEVICE_BITS) ? true : false;
 }
 
+#if CFG_TUD_ENABLED
+static bool out_db_process(struct hw_endpoint* ep);
+
+// Device bulk OUT runs its two buffers as ping-pong (dcd allocates 2 buffers for bulk)
+TU_ATTR_ALWAYS_INLINE static inline bool is_out_double_buffered(struct hw_endpoint const* ep) {
+  return !is_host_mode() && ep->rx && ep->transfer_type == TUSB_XFER_BULK && tu_edpt_number(ep->ep_addr) != 0;
+}
+#else
+#define is_out_double_buffered(x) (false)
+#endif
+
 //--------------------------------------------------------------------+
 // Implementation
 //--------------------------------------------------------------------+
@@ -76,9 +96,37 @@ void rp2040_usb_init(void) {
   // Mux the controller to the onboard usb phy
   usb_hw->muxing = USB_USB_MUXING_TO_PHY_BITS | USB_USB_MUXING_SOFTCON_BITS;
 
+  if (_ep_lock.lock == NULL) {
+    _ep_lock.lock = spin_lock_instance((uint) spin_lock_claim_unused(true));
+  }
+
   TU_LOG2_INT(sizeof(hw_endpoint_t));
 }
 
+// A single lock guards all endpoints: hardware spinlocks are scarce and the sections are short
+void __tusb_irq_path_func(hw_endpoint_lock_update)(__unused struct hw_endpoint* ep, int delta) {
+  uint const core = get_core_num();
+
+  if (delta > 0) {
+    uint32_t const save = save_and_disable_interrupts();
+    if (_ep_lock.owner == core) {
+      // nested, interrupts are already disabled by the outer level
+      _ep_lock.depth++;
+      restore_interrupts(save);
+    } else {
+      spin_lock_unsafe_blocking(_ep_lock.lock);
+      _ep_lock.owner = (uint8_t) core;
+      _ep_lock.depth = 1;
+      _ep_lock.irq_save = save;
+    }
+  } else {
+    if (--_ep_lock.depth == 0) {
+      _ep_lock.owner = 0xff;
+      spin_unlock(_ep_lock.lock, _ep_lock.irq_save);
+    }
+  }
+}
+
 void __tusb_irq_path_func(hw_endpoint_reset_transfer)(struct hw_endpoint* ep) {
   ep->active = false;
   ep->remaining_len = 0;
@@ -151,14 +199,13 @@ void __tusb_irq_path_func(hw_endpoint_start_next_buffer)(struct hw_endpoint* ep)
   // always compute and start with buffer 0
   uint32_t buf_ctrl = prepare_ep_buffer(ep, 0) | USB_BUF_CTRL_SEL;
 
-  // For now: skip double buffered for OUT endpoint in Device mode, since
-  // host could send < 64 bytes and cause short packet on buffer0
+  // Device OUT is single buffered here, host could send < 64 bytes and cause short packet on buffer0.
+  // Device bulk OUT is double buffered by out_db_process() instead, which handles this case.
   // NOTE: this could happen to Host mode IN endpoint
-  // Also, Host mode "interrupt" endpoint hardware is only single buffered,
-  // NOTE2: Currently Host bulk is implemented using "interrupt" endpoint
+  // Also, Host mode "interrupt" endpoint hardware is only single buffered, epx (control and bulk) is double buffered
   bool const is_host = is_host_mode();
   bool const force_single = (!is_host && !tu_edpt_dir(ep->ep_addr)) ||
-                            (is_host && tu_edpt_number(ep->ep_addr) != 0);
+                            (is_host && ep->endpoint_control != &usbh_dpram->epx_ctrl);
 
   if (ep->remaining_len && !force_single) {
     // Use buffer 1 (double buffered) if there is still data
@@ -184,7 +231,29 @@ void __tusb_irq_path_func(hw_endpoint_start_next_buffer)(struct hw_endpoint* ep)
   _hw_endpoint_buffer_control_set_value32(ep, buf_ctrl);
 }
 
-void hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t total_len) {
+bool hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t total_len) {
+#if CFG_TUD_ENABLED
+  if (is_out_double_buffered(ep)) {
+    // buffer completion interrupt may race with us
+    hw_endpoint_lock_update(ep, 1);
+
+    ep->remaining_len = total_len;
+    ep->rx_room = total_len;
+    ep->xferred_len = 0;
+    ep->active = true;
+    ep->user_buf = buffer;
+
+    // buffer still armed (or already filled) after a short packet ended previous transfer belongs to this one
+    if (ep->buf_armed) {
+      ep->remaining_len = (uint16_t) (ep->remaining_len - tu_min16(ep->remaining_len, ep->wMaxPacketSize));
+    }
+
+    bool const done = out_db_process(ep);
+    hw_endpoint_lock_update(ep, -1);
+    return done;
+  }
+#endif
+
   hw_endpoint_lock_update(ep, 1);
 
   if (ep->active) {
@@ -210,6 +279,7 @@ void hw_endpoint_xfer_start(struct hw_endpoint* ep, uint8_t* buffer, uint16_t to
   }
 
   hw_endpoint_lock_update(ep, -1);
+  return false;
 }
 
 // sync endpoint buffer and return transferred bytes
@@ -293,6 +363,17 @@ static void __tusb_irq_path_func(_hw_endpoint_xfer_sync)(struct hw_endpoint* ep)
 
 // Returns true if transfer is complete
 bool __tusb_irq_path_func(hw_endpoint_xfer_continue)(struct hw_endpoint* ep) {
+#if CFG_TUD_ENABLED
+  if (is_out_double_buffered(ep)) {
+    // No transfer: packet of next transfer is kept in hardware buffer until it is queued
+    // worker may be starting a transfer on the other core
+    hw_endpoint_lock_update(ep, 1);
+    bool const done = ep->active && out_db_process(ep);
+    hw_endpoint_lock_update(ep, -1);
+    return done;
+  }
+#endif
+
   hw_endpoint_lock_update(ep, 1);
 
   // Part way through a transfer
@@ -323,6 +404,133 @@ bool __tusb_irq_path_func(hw_endpoint_xfer_continue)(struct hw_endpoint* ep) {
   return false;
 }
 
+// Return buffer that is still available (not yet transferred by controller) to the transfer
+static void __tusb_irq_path_func(unprepare_ep_buffer)(struct hw_endpoint* ep, uint32_t buf_ctrl) {
+  uint16_t const buflen = buf_ctrl & USB_BUF_CTRL_LEN_MASK;
+
+  ep->remaining_len = (uint16_t) (ep->remaining_len + buflen);
+  ep->next_pid ^= 1u;
+  if (!ep->rx) {
+    ep->user_buf -= buflen;
+  }
+}
+
+// Host: pause transfer after transaction is stopped e.g to switch epx to another endpoint. Buffers completed by
+// controller are synced, buffers still available are returned so that transfer can be resumed later with
+// hw_endpoint_start_next_buffer(). Returns true if transfer is complete
+bool __tusb_irq_path_func(hw_endpoint_xfer_pause)(struct hw_endpoint* ep) {
+  hw_endpoint_lock_update(ep, 1);
+
+  uint32_t const buf_ctrl = _hw_endpoint_buffer_control_get_value32(ep);
+  bool const is_double = (*ep->endpoint_control) & EP_CTRL_DOUBLE_BUFFERED_BITS;
+  uint32_t const buf0 = tu_u32_low16(buf_ctrl);
+  uint32_t const buf1 = tu_u32_high16(buf_ctrl);
+
+  TU_LOG(3, "  Pause BufCtrl: [0] = 0x%04lx  [1] = 0x%04lx\r\n", buf0, buf1);
+
+  // controller processes buffer 0 then buffer 1
+  if (buf0 & USB_BUF_CTRL_AVAIL) {
+    if (is_double) unprepare_ep_buffer(ep, buf1);
+    unprepare_ep_buffer(ep, buf0);
+  } else if (sync_ep_buffer(ep, 0) == ep->wMaxPacketSize && is_double) {
+    if (buf1 & USB_BUF_CTRL_AVAIL) {
+      unprepare_ep_buffer(ep, buf1);
+    } else {
+      sync_ep_buffer(ep, 1);
+    }
+  }
+
+  _hw_endpoint_buffer_control_set_value32(ep, 0);
+
+  hw_endpoint_lock_update(ep, -1);
+  return ep->remaining_len == 0;
+}
+
+//--------------------------------------------------------------------+
+// Device double buffered OUT
+//--------------------------------------------------------------------+
+#if CFG_TUD_ENABLED
+
+// Buffers are given to the controller one at a time with full packet size and an interrupt per buffer, the
+// controller fills them alternately starting from buf_sel. A short packet ends the transfer while the other
+// buffer may still be armed: it keeps the next packet, which is handed to the next transfer of this
+// endpoint. Host is NAKed meanwhile since there is no other buffer.
+
+// Arm one buffer (with full packet size), buffer halves are updated separately so the other one is not disturbed
+static void __tusb_irq_path_func(out_db_arm)(struct hw_endpoint* ep, uint8_t buf_id) {
+  io_rw_16* buf_ctrl16 = ((io_rw_16*) (uintptr_t) ep->buffer_control) + buf_id;
+
+  ep->remaining_len = (uint16_t) (ep->remaining_len - tu_min16(ep->remaining_len, ep->wMaxPacketSize));
+
+  uint16_t value = (uint16_t) (ep->wMaxPacketSize | (ep->next_pid ? USB_BUF_CTRL_DATA1_PID : USB_BUF_CTRL_DATA0_PID));
+  ep->next_pid ^= 1u;
+
+  // nothing armed: also reset buffer selector so that controller starts with buffer 0, in sync with buf_sel
+  if (!ep->buf_armed) {
+    value |= USB_BUF_CTRL_SEL;
+  }
+  ep->buf_armed |= (uint8_t) TU_BIT(buf_id);
+
+  // 4.1.2.5.1 Con-current access: AVAILABLE is written 12 cycles after the rest
+  *buf_ctrl16 = value;
+  busy_wait_at_least_cycles(12);
+  *buf_ctrl16 = (uint16_t) (value | USB_BUF_CTRL_AVAIL);
+}
+
+// Consume buffers filled by controller in order and re-arm free ones. Return true if transfer is complete
+static bool __tusb_irq_path_func(out_db_process)(struct hw_endpoint* ep) {
+  uint16_t const mps = ep->wMaxPacketSize;
+
+  while (ep->buf_armed & TU_BIT(ep->buf_sel)) {
+    uint32_t const buf_ctrl = _hw_endpoint_buffer_control_get_value32(ep) >> (16 * ep->buf_sel);
+    if (buf_ctrl & USB_BUF_CTRL_AVAIL) break; // not yet filled
+
+    uint16_t const pkt_len = buf_ctrl & USB_BUF_CTRL_LEN_MASK;
+    uint16_t const count = tu_min16(pkt_len, ep->rx_room);
+
+    memcpy(ep->user_buf, ep->hw_data_buf + ep->buf_sel * 64, count);
+    ep->user_buf += count;
+    ep->xferred_len = (uint16_t) (ep->xferred_len + count);
+    ep->rx_room = (uint16_t) (ep->rx_room - count);
+
+    ep->buf_armed &= (uint8_t) ~TU_BIT(ep->buf_sel);
+    ep->buf_sel ^= 1u;
+
+    if (pkt_len < mps || ep->rx_room == 0) {
+      pico_trace("  Completed OUT transfer of %u bytes on ep %02X\r\n", ep->xferred_len, ep->ep_addr);
+      ep->remaining_len = 0;
+      return true;
+    }
+  }
+
+  // nothing armed: (re)start ping-pong from buffer 0
+  if (!ep->buf_armed) {
+    ep->buf_sel = 0;
+    uint32_t ep_ctrl = *ep->endpoint_control;
+    ep_ctrl &= ~EP_CTRL_INTERRUPT_PER_DOUBLE_BUFFER;
+    ep_ctrl |= EP_CTRL_DOUBLE_BUFFERED_BITS | EP_CTRL_INTERRUPT_PER_BUFFER;
+    *ep->endpoint_control = ep_ctrl;
+
+    // at least one buffer is armed e.g for zero length transfer
+    out_db_arm(ep, 0);
+  }
+
+  // keep the second buffer armed while transfer still has room for it
+  if (ep->remaining_len && ep->buf_armed != 0b11) {
+    out_db_arm(ep, ep->buf_sel ^ 1u);
+  }
+
+  return false;
+}
+
+// Drop buffers armed ahead e.g when endpoint is stalled or its buffer control is reset
+void hw_endpoint_reset_double_buffer(struct hw_endpoint* ep) {
+  ep->buf_armed = 0;
+  ep->buf_sel = 0;
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // Errata 15
 //--------------------------------------------------------------------+
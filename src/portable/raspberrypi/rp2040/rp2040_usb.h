@@ -83,6 +83,13 @@ typedef struct hw_endpoint
     // Transfer scheduled but not active
     uint8_t pending;
 
+#if CFG_TUD_ENABLED
+    // Only needed for device double buffered OUT
+    uint8_t buf_sel;   // buffer to be filled next by controller
+    uint8_t buf_armed; // bit mask of buffers given to controller, can be ahead of current transfer
+    uint16_t rx_room;  // space left in user buffer
+#endif
+
 #if CFG_TUH_ENABLED
     // Only needed for host
     uint8_t dev_addr;
@@ -99,16 +106,19 @@ extern volatile uint32_t e15_last_sof;
 
 void rp2040_usb_init(void);
 
-void hw_endpoint_xfer_start(struct hw_endpoint *ep, uint8_t *buffer, uint16_t total_len);
+bool hw_endpoint_xfer_start(struct hw_endpoint *ep, uint8_t *buffer, uint16_t total_len);
 bool hw_endpoint_xfer_continue(struct hw_endpoint *ep);
 void hw_endpoint_reset_transfer(struct hw_endpoint *ep);
 void hw_endpoint_start_next_buffer(struct hw_endpoint *ep);
+bool hw_endpoint_xfer_pause(struct hw_endpoint *ep);
 
-TU_ATTR_ALWAYS_INLINE static inline void hw_endpoint_lock_update(__unused struct hw_endpoint * ep, __unused int delta) {
-  // todo add critsec as necessary to prevent issues between worker and IRQ...
-  //  note that this is perhaps as simple as disabling IRQs because it would make
-  //  sense to have worker and IRQ on same core, however I think using critsec is about equivalent.
-}
+#if CFG_TUD_ENABLED
+void hw_endpoint_reset_double_buffer(struct hw_endpoint *ep);
+#endif
+
+// Critical section between worker and IRQ, may be nested. Backed by a hardware spinlock so that
+// it also holds when the worker runs on the other core than the USB IRQ. delta is +1 to enter, -1 to exit.
+void hw_endpoint_lock_update(struct hw_endpoint *ep, int delta);
 
 void _hw_endpoint_buffer_control_update32(struct hw_endpoint *ep, uint32_t and_mask, uint32_t or_mask);
 
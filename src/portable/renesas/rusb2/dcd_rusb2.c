@@ -199,15 +199,31 @@ static void pipe_write_packet(rusb2_reg_t * rusb, void *buf, volatile void *fifo
 }
 
 // Read data buffer <-- hw fifo
+// FIFO port must be selected with MBW_16BIT (and BIGEND on big-endian cores)
 static void pipe_read_packet(rusb2_reg_t * rusb, void *buf, volatile void *fifo, unsigned len)
 {
-  (void) rusb;
+  volatile uint16_t *ff16;
+
+  // Highspeed FIFO is 32-bit
+  if ( rusb2_is_highspeed_reg(rusb) ) {
+    ff16 = (volatile uint16_t*) ((uintptr_t) fifo+2);
+  }else {
+    ff16 = (volatile uint16_t*) fifo;
+  }
 
-  // TODO 16/32-bit access for better performance
+  uint8_t *buf8 = (uint8_t*) buf;
+
+  while (len >= 2) {
+    tu_unaligned_write16(buf8, *ff16);
+    buf8 += 2;
+    len  -= 2;
+  }
 
-  uint8_t *p = (uint8_t*)buf;
-  volatile uint8_t *reg = (volatile uint8_t*)fifo;  /* byte access is always at base register address */
-  while (len--) *p++ = *reg;
+  if (len > 0) {
+    // odd tail: the first byte in memory order is the valid one
+    uint16_t const tmp = *ff16;
+    memcpy(buf8, &tmp, 1);
+  }
 }
 
 // Write data sw fifo --> hw fifo
@@ -215,12 +231,12 @@ static void pipe_write_packet_ff(rusb2_reg_t * rusb, tu_fifo_t *f, volatile void
   tu_fifo_buffer_info_t info;
   tu_fifo_get_read_info(f, &info);
 
-  uint16_t count = tu_min16(total_len, info.len_lin);
+  uint16_t count = (uint16_t) TU_MIN(total_len, info.len_lin);
   pipe_write_packet(rusb, info.ptr_lin, fifo, count);
 
   uint16_t rem = total_len - count;
   if (rem) {
-    rem = tu_min16(rem, info.len_wrap);
+    rem = (uint16_t) TU_MIN(rem, info.len_wrap);
     pipe_write_packet(rusb, info.ptr_wrap, fifo, rem);
     count += rem;
   }
@@ -233,17 +249,23 @@ static void pipe_read_packet_ff(rusb2_reg_t * rusb, tu_fifo_t *f, volatile void
   tu_fifo_buffer_info_t info;
   tu_fifo_get_write_info(f, &info);
 
-  uint16_t count = tu_min16(total_len, info.len_lin);
-  pipe_read_packet(rusb, info.ptr_lin, fifo, count);
-
-  uint16_t rem = total_len - count;
-  if (rem) {
-    rem = tu_min16(rem, info.len_wrap);
-    pipe_read_packet(rusb, info.ptr_wrap, fifo, rem);
-    count += rem;
+  uint16_t count = (uint16_t) TU_MIN(total_len, info.len_lin);
+  uint16_t rem   = (uint16_t) TU_MIN(total_len - count, info.len_wrap);
+
+  if (rem && (count & 1)) {
+    // a 16-bit FIFO read straddles the wrap, split it by hand
+    uint8_t tmp[2];
+    pipe_read_packet(rusb, info.ptr_lin, fifo, count - 1u);
+    pipe_read_packet(rusb, tmp, fifo, 2);
+    ((uint8_t*) info.ptr_lin)[count - 1] = tmp[0];
+    ((uint8_t*) info.ptr_wrap)[0]        = tmp[1];
+    pipe_read_packet(rusb, (uint8_t*) info.ptr_wrap + 1, fifo, rem - 1u);
+  } else {
+    pipe_read_packet(rusb, info.ptr_lin, fifo, count);
+    if (rem) pipe_read_packet(rusb, info.ptr_wrap, fifo, rem);
   }
 
-  tu_fifo_advance_write_pointer(f, count);
+  tu_fifo_advance_write_pointer(f, count + rem);
 }
 
 //--------------------------------------------------------------------+
@@ -355,7 +377,7 @@ static bool pipe_xfer_out(rusb2_reg_t* rusb, unsigned num)
   pipe_state_t  *pipe = &_dcd.pipe[num];
   const uint16_t rem  = pipe->remaining;
 
-  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_8BIT;
+  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_16BIT | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
   const uint16_t mps = edpt_max_packet_size(rusb, num);
   pipe_wait_for_ready(rusb, num);
 
@@ -430,8 +452,9 @@ static bool process_pipe0_xfer(rusb2_reg_t* rusb, int buffer_type, uint8_t ep_ad
                      (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
     while ( !(rusb->CFIFOSEL & RUSB2_CFIFOSEL_ISEL_WRITE) ) {}
   } else {
-    /* OUT, a byte */
-    rusb->CFIFOSEL = RUSB2_FIFOSEL_MBW_8BIT;
+    /* OUT, 2 bytes */
+    rusb->CFIFOSEL = RUSB2_FIFOSEL_MBW_16BIT |
+                     (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
     while ( rusb->CFIFOSEL & RUSB2_CFIFOSEL_ISEL_WRITE ) {}
   }
 
@@ -793,13 +816,11 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
   /* setup pipe */
   dcd_int_disable(rhport);
 
-  if ( rusb2_is_highspeed_rhport(rhport) ) {
-    // FIXME shouldn't be after pipe selection and config, also the BUFNMB should be changed
-    //       depending on the allocation scheme
-    rusb->PIPEBUF = 0x7C08;
-  }
-
   rusb->PIPESEL = num;
+  if ( rusb2_is_highspeed_rhport(rhport) && num <= 5 ) {
+    // each pipe owns its own double buffered slice of the buffer RAM
+    rusb->PIPEBUF = rusb2_pipebuf(num, mps);
+  }
   rusb->PIPEMAXP = mps;
   volatile uint16_t *ctr = get_pipectr(rusb, num);
   *ctr = RUSB2_PIPE_CTR_ACLRM_Msk | RUSB2_PIPE_CTR_SQCLR_Msk;
@@ -78,6 +78,8 @@ TU_ATTR_BIT_FIELD_ORDER_END
 typedef struct
 {
   bool         need_reset; /* The device has not been reset after connection. */
+  uint16_t     frame_last; /* The last FRNM read, used to extend the frame number to 32-bit */
+  uint32_t     frame_count;
   pipe_state_t pipe[PIPE_COUNT];
   uint8_t ep[4][2][15];   /* a lookup table for a pipe index from an endpoint address */
   uint8_t      ctl_mps[5]; /* EP0 max packet size for each device */
@@ -181,11 +183,21 @@ static void pipe_write_packet(void *buf, volatile void *fifo, unsigned len)
   }
 }
 
+// FIFO port must be selected with MBW_16BIT (and BIGEND on big-endian cores)
 static void pipe_read_packet(void *buf, volatile void *fifo, unsigned len)
 {
-  uint8_t *p   = (uint8_t*)buf;
-  volatile uint8_t *reg = (volatile uint8_t*)fifo;  /* byte access is always at base register address */
-  while (len--) *p++ = *reg;
+  volatile hw_fifo_t *reg = (volatile hw_fifo_t*)fifo;
+  uint8_t *p = (uint8_t*)buf;
+  while (len >= 2) {
+    tu_unaligned_write16(p, reg->u16);
+    p   += 2;
+    len -= 2;
+  }
+  if (len) {
+    /* odd tail: the first byte in memory order is the valid one */
+    uint16_t const tmp = reg->u16;
+    memcpy(p, &tmp, 1);
+  }
 }
 
 static bool pipe0_xfer_in(rusb2_reg_t* rusb)
@@ -241,7 +253,7 @@ static bool pipe_xfer_in(rusb2_reg_t* rusb, unsigned num)
   pipe_state_t  *pipe = &_hcd.pipe[num];
   const unsigned rem  = pipe->remaining;
 
-  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_8BIT;
+  rusb->D0FIFOSEL = num | RUSB2_FIFOSEL_MBW_16BIT | (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
   const unsigned mps  = edpt_max_packet_size(rusb, num);
   pipe_wait_for_ready(rusb, num);
   const unsigned vld  = rusb->D0FIFOCTR_b.DTLN;
@@ -300,8 +312,9 @@ static bool process_pipe0_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr
   const unsigned dir_in = tu_edpt_dir(ep_addr);
 
   /* configure fifo direction and access unit settings */
-  if (dir_in) { /* IN, a byte */
-    rusb->CFIFOSEL = RUSB2_FIFOSEL_MBW_8BIT;
+  if (dir_in) { /* IN, 2 bytes */
+    rusb->CFIFOSEL = RUSB2_FIFOSEL_MBW_16BIT |
+                     (TU_BYTE_ORDER == TU_BIG_ENDIAN ? RUSB2_FIFOSEL_BIGEND : 0);
     while (rusb->CFIFOSEL & RUSB2_CFIFOSEL_ISEL_WRITE) ;
   } else { /* OUT, 2 bytes */
     rusb->CFIFOSEL = RUSB2_CFIFOSEL_ISEL_WRITE | RUSB2_FIFOSEL_MBW_16BIT |
@@ -541,7 +554,11 @@ uint32_t hcd_frame_number(uint8_t rhport)
   /* The device must be reset at least once after connection
    * in order to start the frame counter. */
   if (_hcd.need_reset) hcd_port_reset(rhport);
-  return rusb->FRMNUM_b.FRNM;
+  /* Extend 11-bit hardware frame number to 32-bit */
+  uint16_t const frnum = rusb->FRMNUM_b.FRNM;
+  _hcd.frame_count += (uint16_t)(frnum - _hcd.frame_last) & 0x7FFu;
+  _hcd.frame_last   = frnum;
+  return _hcd.frame_count;
 }
 
 /*--------------------------------------------------------------------+
@@ -690,6 +707,10 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
   hcd_int_disable(rhport);
 
   rusb->PIPESEL = num;
+  if (rusb2_is_highspeed_rhport(rhport) && num <= 5) {
+    /* each pipe owns its own double buffered slice of the buffer RAM */
+    rusb->PIPEBUF = rusb2_pipebuf(num, mps);
+  }
   rusb->PIPEMAXP = (dev_addr << 12) | mps;
   volatile uint16_t *ctr = get_pipectr(rusb, num);
   *ctr = RUSB2_PIPE_CTR_ACLRM_Msk | RUSB2_PIPE_CTR_SQCLR_Msk;
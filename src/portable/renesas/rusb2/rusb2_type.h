@@ -1701,6 +1701,20 @@ TU_ATTR_BIT_FIELD_ORDER_END
 #define RUSB2_PIPECFG_TYPE_INT          (2U << RUSB2_PIPECFG_TYPE_Pos)
 #define RUSB2_PIPECFG_TYPE_ISO          (3U << RUSB2_PIPECFG_TYPE_Pos)
 
+//--------------------------------------------------------------------+
+// Buffer RAM layout (high-speed only, full-speed has a fixed layout)
+//--------------------------------------------------------------------+
+
+// The buffer RAM is divided in 64-byte blocks: 0-3 belong to DCP and 4-7 to pipes 6-9.
+// Pipes 1-5 get fixed slices large enough to double buffer their largest packet:
+// 2 x 1024 bytes for the ISO capable pipes 1-2 and 2 x 512 bytes for bulk pipes 3-5.
+// Returns the PIPEBUF value for the selected pipe.
+TU_ATTR_ALWAYS_INLINE static inline uint16_t rusb2_pipebuf(unsigned num, unsigned mps) {
+  unsigned const bufnmb  = (num <= 2) ? (8 + 32 * (num - 1)) : (72 + 16 * (num - 3));
+  unsigned const bufsize = (mps + 63) / 64 - 1; /* size of one buffer plane */
+  return (uint16_t) ((bufsize << RUSB2_PIPEBUF_BUFSIZE_Pos) | bufnmb);
+}
+
 //--------------------------------------------------------------------+
 // Static Assert
 //--------------------------------------------------------------------+
@@ -66,11 +66,9 @@
  * Current driver limitations (i.e., a list of features for you to add):
  * - STALL handled, but not tested.
  *   - Does it work? No clue.
- * - All EP BTABLE buffers are created based on max packet size of first EP opened with that address.
  * - Packet buffer memory is copied in the interrupt.
  *   - This is better for performance, but means interrupts are disabled for longer
  *   - DMA may be the best choice, but it could also be pushed to the USBD task.
- * - No double-buffering
  * - No DMA
  * - Minimal error handling
  *   - Perhaps error interrupts should be reported to the stack, or cause a device reset?
@@ -79,7 +77,7 @@
  * - F3 models use three separate interrupts. I think we could only use the LP interrupt for
  *     everything?  However, the interrupts are configurable so the DisableInt and EnableInt
  *     below functions could be adjusting the wrong interrupts (if they had been reconfigured)
- * - LPM is not used correctly, or at all?
+ * - LPM (L1) is only enabled with CFG_TUD_LPM, BESL threshold/deep sleep is not used
  *
  * USB documentation and Reference implementations
  * - STM32 Reference manuals
@@ -95,9 +93,12 @@
  * - Tiny (saves RAM, assumes a single USB peripheral)
  *
  * Notes:
- * - The buffer table is allocated as endpoints are opened. The allocation is only
- *   cleared when the device is reset. This may be bad if the USB device needs
- *   to be reconfigured.
+ * - The buffer table is allocated as endpoints are opened, first fit. Buffers are returned
+ *   when the endpoint is closed (except ISO, whose buffers are reserved by dcd_edpt_iso_alloc),
+ *   so switching alternate settings does not exhaust the PMA.
+ * - Bulk endpoints are double-buffered (DBL_BUF) when CFG_TUD_FSDEV_DOUBLE_BUFFER is set. Each one
+ *   then uses a hardware endpoint of its own and two packet buffers; if either runs out the
+ *   endpoint falls back to a single buffer.
  */
 
 #include "tusb_option.h"
@@ -132,6 +133,12 @@
 #define DCD_STM32_BTABLE_SIZE (FSDEV_PMA_SIZE - DCD_STM32_BTABLE_BASE)
 #endif
 
+// Double-buffer bulk endpoints, this doubles their PMA usage so it is only enabled by default
+// on devices with more than 512 bytes of PMA
+#ifndef CFG_TUD_FSDEV_DOUBLE_BUFFER
+#define CFG_TUD_FSDEV_DOUBLE_BUFFER (FSDEV_PMA_SIZE > 512u)
+#endif
+
 /***************************************************
  * Checks, structs, defines, function definitions, etc.
  */
@@ -153,6 +160,8 @@ typedef struct {
   uint16_t max_packet_size;
   uint8_t ep_idx;   // index for USB_EPnR register
   bool iso_in_sending; // Workaround for ISO IN EP doesn't have interrupt mask
+  bool dbuf;        // double-buffered bulk endpoint
+  bool dbuf_filled; // double-buffered IN: next packet is already written to the buffer not used by USB
 } xfer_ctl_t;
 
 // EP allocator
@@ -160,6 +169,9 @@ typedef struct {
   uint8_t ep_num;
   uint8_t ep_type;
   bool allocated[2];
+  bool exclusive;       // ISO or double-buffered bulk: both BTABLE entries belong to one direction
+  uint16_t pma_addr[2]; // PMA buffer of each direction, both buffers when exclusive
+  uint16_t pma_size[2]; // 0 if not allocated
 } ep_alloc_t;
 
 static xfer_ctl_t xfer_status[MAX_EP_COUNT][2];
@@ -170,6 +182,13 @@ static TU_ATTR_ALIGNED(4) uint32_t _setup_packet[6];
 
 static uint8_t remoteWakeCountdown; // When wake is requested
 
+#if CFG_TUD_LPM && defined(USB_ISTR_L1REQ)
+  #define FSDEV_LPM 1
+  static volatile bool lpmSleep; // link is in LPM sleep (L1)
+#else
+  #define FSDEV_LPM 0
+#endif
+
 //--------------------------------------------------------------------+
 // Prototypes
 //--------------------------------------------------------------------+
@@ -177,13 +196,14 @@ static uint8_t remoteWakeCountdown; // When wake is requested
 // into the stack.
 static void dcd_handle_bus_reset(void);
 static void dcd_transmit_packet(xfer_ctl_t *xfer, uint16_t ep_ix);
+static void dcd_transmit_packet_dbuf(xfer_ctl_t *xfer, uint16_t ep_ix);
 static bool edpt_xfer(uint8_t rhport, uint8_t ep_addr);
 static void dcd_ep_ctr_handler(void);
 
 // PMA allocation/access
-static uint16_t ep_buf_ptr; ///< Points to first free memory location
-static uint32_t dcd_pma_alloc(uint16_t length, bool dbuf);
-static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type);
+static uint32_t dcd_pma_alloc(uint8_t ep_idx, uint8_t dir, uint16_t length, bool dbuf);
+static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type, bool exclusive);
+static void dcd_ep_free(uint8_t ep_idx, uint8_t dir);
 static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes);
 static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes);
 
@@ -245,6 +265,12 @@ void dcd_init(uint8_t rhport)
   }
 
   USB->CNTR |= USB_CNTR_RESETM | USB_CNTR_ESOFM | USB_CNTR_CTRM | USB_CNTR_SUSPM | USB_CNTR_WKUPM;
+
+#if FSDEV_LPM
+  // Ack LPM tokens, entering L1 is reported by L1REQ, leaving it by WKUP
+  USB->LPMCSR = USB_LPMCSR_LMPEN | USB_LPMCSR_LPMACK;
+  USB->CNTR |= USB_CNTR_L1REQM;
+#endif
   dcd_handle_bus_reset();
 
   // Enable pull-up if supported
@@ -435,6 +461,13 @@ void dcd_remote_wakeup(uint8_t rhport)
 {
   (void)rhport;
 
+#if FSDEV_LPM
+  if (lpmSleep) {
+    USB->CNTR |= USB_CNTR_L1RESUME; // 50 us resume signaling, cleared by hardware
+    return;
+  }
+#endif
+
   USB->CNTR |= USB_CNTR_RESUME;
   remoteWakeCountdown = 4u; // required to be 1 to 15 ms, ESOF should trigger every 1ms.
 }
@@ -461,17 +494,12 @@ static void dcd_handle_bus_reset(void)
 {
   USB->DADDR = 0u; // disable USB peripheral by clearing the EF flag
 
-  for (uint32_t i = 0; i < STFSDEV_EP_COUNT; i++) {
-    // Clear EP allocation status
-    ep_alloc_status[i].ep_num = 0xFF;
-    ep_alloc_status[i].ep_type = 0xFF;
-    ep_alloc_status[i].allocated[0] = false;
-    ep_alloc_status[i].allocated[1] = false;
+  for (uint8_t i = 0; i < STFSDEV_EP_COUNT; i++) {
+    // Clear EP and PMA allocation status
+    dcd_ep_free(i, TUSB_DIR_OUT);
+    dcd_ep_free(i, TUSB_DIR_IN);
   }
 
-  // Reset PMA allocation
-  ep_buf_ptr = DCD_STM32_BTABLE_BASE + 8 * MAX_EP_COUNT;
-
   dcd_edpt_open(0, &ep0OUT_desc);
   dcd_edpt_open(0, &ep0IN_desc);
 
@@ -481,7 +509,7 @@ static void dcd_handle_bus_reset(void)
 // Handle CTR interrupt for the TX/IN direction
 //
 // Upon call, (wIstr & USB_ISTR_DIR) == 0U
-static void dcd_ep_ctr_tx_handler(uint32_t wIstr)
+TU_ATTR_FAST_FUNC static void dcd_ep_ctr_tx_handler(uint32_t wIstr)
 {
   uint32_t EPindex = wIstr & USB_ISTR_EP_ID;
   uint32_t wEPRegVal = pcd_get_endpoint(USB, EPindex);
@@ -514,7 +542,13 @@ static void dcd_ep_ctr_tx_handler(uint32_t wIstr)
     }
   }
 
-  if ((xfer->total_len != xfer->queued_len)) {
+  if (xfer->dbuf) {
+    if (xfer->dbuf_filled || (xfer->total_len != xfer->queued_len)) {
+      dcd_transmit_packet_dbuf(xfer, EPindex);
+    } else {
+      dcd_event_xfer_complete(0, ep_addr, xfer->total_len, XFER_RESULT_SUCCESS, true);
+    }
+  } else if ((xfer->total_len != xfer->queued_len)) {
     dcd_transmit_packet(xfer, EPindex);
   } else {
     dcd_event_xfer_complete(0, ep_addr, xfer->total_len, XFER_RESULT_SUCCESS, true);
@@ -523,7 +557,7 @@ static void dcd_ep_ctr_tx_handler(uint32_t wIstr)
 
 // Handle CTR interrupt for the RX/OUT direction
 // Upon call, (wIstr & USB_ISTR_DIR) == 0U
-static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
+TU_ATTR_FAST_FUNC static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
 {
 #ifdef FSDEV_BUS_32BIT
   /* https://www.st.com/resource/en/errata_sheet/es0561-stm32h503cbebkbrb-device-errata-stmicroelectronics.pdf
@@ -593,6 +627,15 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
         count = pcd_get_ep_dbuf1_cnt(USB, EPindex);
         addr = pcd_get_ep_dbuf1_address(USB, EPindex);
       }
+    } else if (xfer->dbuf) {
+      // DTOG_RX already points to the buffer receiving next, data is in the other one
+      if (wEPRegVal & USB_EP_DTOG_RX) {
+        count = pcd_get_ep_dbuf0_cnt(USB, EPindex);
+        addr = pcd_get_ep_dbuf0_address(USB, EPindex);
+      } else {
+        count = pcd_get_ep_dbuf1_cnt(USB, EPindex);
+        addr = pcd_get_ep_dbuf1_address(USB, EPindex);
+      }
     } else {
       count = pcd_get_ep_rx_cnt(USB, EPindex);
       addr = pcd_get_ep_rx_address(USB, EPindex);
@@ -600,6 +643,20 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
 
     TU_ASSERT(count <= xfer->max_packet_size, /**/);
 
+    if (xfer->dbuf) {
+      uint16_t const remaining = (uint16_t)(xfer->total_len - xfer->queued_len);
+
+      // More data expected: hand the other buffer back to USB (toggle SW_BUF = DTOG_TX) before reading
+      // this one, so the next packet is received meanwhile. The endpoint NAKs while DTOG_RX == SW_BUF.
+      if ((count == xfer->max_packet_size) && (count < remaining) &&
+          (!(wEPRegVal & USB_EP_DTOG_RX) == !(wEPRegVal & USB_EP_DTOG_TX))) {
+        pcd_tx_dtog(USB, EPindex);
+      }
+
+      // buffers are sized for a full packet, never write past the end of the transfer
+      count = tu_min16((uint16_t)count, remaining);
+    }
+
     if (count != 0U) {
       if (xfer->ff) {
         dcd_read_packet_memory_ff(xfer->ff, addr, count);
@@ -612,11 +669,14 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
 
     if ((count < xfer->max_packet_size) || (xfer->queued_len == xfer->total_len)) {
       // all bytes received or short packet
+      if (xfer->dbuf) {
+        pcd_set_ep_rx_status(USB, EPindex, USB_EP_RX_NAK);
+      }
       dcd_event_xfer_complete(0, ep_addr, xfer->queued_len, XFER_RESULT_SUCCESS, true);
     } else {
       /* Set endpoint active again for receiving more data.
-       * Note that isochronous endpoints stay active always */
-      if ((wEPRegVal & USB_EP_TYPE_MASK) != USB_EP_ISOCHRONOUS) {
+       * Note that isochronous endpoints stay active always, double-buffered ones are already released above */
+      if (((wEPRegVal & USB_EP_TYPE_MASK) != USB_EP_ISOCHRONOUS) && !xfer->dbuf) {
         uint16_t remaining = xfer->total_len - xfer->queued_len;
         uint16_t cnt = tu_min16(remaining, xfer->max_packet_size);
         pcd_set_ep_rx_cnt(USB, EPindex, cnt);
@@ -635,7 +695,7 @@ static void dcd_ep_ctr_rx_handler(uint32_t wIstr)
   }
 }
 
-static void dcd_ep_ctr_handler(void)
+TU_ATTR_FAST_FUNC static void dcd_ep_ctr_handler(void)
 {
   uint32_t wIstr;
 
@@ -651,7 +711,7 @@ static void dcd_ep_ctr_handler(void)
   }
 }
 
-void dcd_int_handler(uint8_t rhport)
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport)
 {
 
   (void)rhport;
@@ -674,6 +734,9 @@ void dcd_int_handler(uint8_t rhport)
   if (int_status & USB_ISTR_RESET) {
     // USBRST is start of reset.
     USB->ISTR = (fsdev_bus_t)~USB_ISTR_RESET;
+#if FSDEV_LPM
+    lpmSleep = false;
+#endif
     dcd_handle_bus_reset();
     dcd_event_bus_reset(0, TUSB_SPEED_FULL, true);
     return; // Don't do the rest of the things here; perhaps they've been cleared?
@@ -690,6 +753,9 @@ void dcd_int_handler(uint8_t rhport)
     USB->CNTR &= ~USB_CNTR_FSUSP;
 
     USB->ISTR = (fsdev_bus_t)~USB_ISTR_WKUP;
+#if FSDEV_LPM
+    lpmSleep = false;
+#endif
     dcd_event_bus_signal(0, DCD_EVENT_RESUME, true);
   }
 
@@ -706,6 +772,21 @@ void dcd_int_handler(uint8_t rhport)
     dcd_event_bus_signal(0, DCD_EVENT_SUSPEND, true);
   }
 
+#if FSDEV_LPM
+  if (int_status & USB_ISTR_L1REQ) {
+    /* Force low-power mode in the macrocell, same as suspend */
+    USB->CNTR |= USB_CNTR_FSUSP;
+    USB->CNTR |= USB_CNTR_LPMODE;
+
+    USB->ISTR = (fsdev_bus_t)~USB_ISTR_L1REQ;
+    lpmSleep = true;
+
+    uint32_t const lpmcsr = USB->LPMCSR;
+    uint8_t const besl = (uint8_t) ((lpmcsr & USB_LPMCSR_BESL) >> 4); // BESL[7:4]
+    dcd_event_lpm_sleep(0, besl, (lpmcsr & USB_LPMCSR_REMWAKE) != 0, true);
+  }
+#endif
+
   if (int_status & USB_ISTR_ESOF) {
     if (remoteWakeCountdown == 1u) {
       USB->CNTR &= ~USB_CNTR_RESUME;
@@ -739,11 +820,12 @@ void dcd_edpt0_status_complete(uint8_t rhport, tusb_control_request_t const *req
 }
 
 /***
- * Allocate a section of PMA
+ * Allocate a section of PMA for one direction of a hardware endpoint, first fit.
+ * Any buffer previously held by that direction is released first.
  * In case of double buffering, high 16bit is the address of 2nd buffer
- * During failure, TU_ASSERT is used. If this happens, rework/reallocate memory manually.
+ * Returns 0xFFFF if there is no room; rework/reallocate memory manually if the driver asserts on it.
  */
-static uint32_t dcd_pma_alloc(uint16_t length, bool dbuf)
+static uint32_t dcd_pma_alloc(uint8_t ep_idx, uint8_t dir, uint16_t length, bool dbuf)
 {
   // Ensure allocated buffer is aligned
 #ifdef FSDEV_BUS_32BIT
@@ -752,47 +834,71 @@ static uint32_t dcd_pma_alloc(uint16_t length, bool dbuf)
   length = (length + 1) & ~0x01;
 #endif
 
-  uint32_t addr = ep_buf_ptr;
-  ep_buf_ptr = (uint16_t)(ep_buf_ptr + length); // increment buffer pointer
+  uint16_t const total = (uint16_t)(dbuf ? 2 * length : length);
+  ep_alloc_status[ep_idx].pma_size[dir] = 0;
+
+  // Start after the BTABLE and skip past every allocated buffer overlapping the candidate range
+  uint32_t addr = DCD_STM32_BTABLE_BASE + 8 * MAX_EP_COUNT;
+  bool overlap;
+  do {
+    overlap = false;
+    for (uint8_t i = 0; i < STFSDEV_EP_COUNT; i++) {
+      for (uint8_t d = 0; d < 2; d++) {
+        uint32_t const buf_addr = ep_alloc_status[i].pma_addr[d];
+        uint32_t const buf_size = ep_alloc_status[i].pma_size[d];
+        if (buf_size && (addr < buf_addr + buf_size) && (buf_addr < addr + total)) {
+          addr = buf_addr + buf_size;
+          overlap = true;
+        }
+      }
+    }
+  } while (overlap);
+
+  // Verify packet buffer is not overflowed
+  TU_VERIFY(addr + total <= FSDEV_PMA_SIZE, 0xFFFF);
+
+  ep_alloc_status[ep_idx].pma_addr[dir] = (uint16_t)addr;
+  ep_alloc_status[ep_idx].pma_size[dir] = total;
 
   if (dbuf) {
-    addr |= ((uint32_t)ep_buf_ptr) << 16;
-    ep_buf_ptr = (uint16_t)(ep_buf_ptr + length); // increment buffer pointer
+    addr |= (addr + length) << 16;
   }
 
-  // Verify packet buffer is not overflowed
-  TU_ASSERT(ep_buf_ptr <= FSDEV_PMA_SIZE, 0xFFFF);
-
   return addr;
 }
 
 /***
- * Allocate hardware endpoint
+ * Allocate hardware endpoint.
+ * Exclusive endpoints (ISO, double-buffered bulk) need both directions of the hardware endpoint.
+ * Returns 0xFF if no suitable hardware endpoint is free.
  */
-static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type)
+static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type, bool exclusive)
 {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   for (uint8_t i = 0; i < STFSDEV_EP_COUNT; i++) {
+    ep_alloc_t *ep_alloc = &ep_alloc_status[i];
+
     // Check if already allocated
-    if (ep_alloc_status[i].allocated[dir] &&
-        ep_alloc_status[i].ep_type == ep_type &&
-        ep_alloc_status[i].ep_num == epnum) {
-      return i;
+    if (ep_alloc->allocated[dir] &&
+        ep_alloc->ep_type == ep_type &&
+        ep_alloc->ep_num == epnum) {
+      return (exclusive && !ep_alloc->exclusive) ? 0xFF : i;
     }
 
     // If EP of current direction is not allocated
-    // Except for ISO endpoint, both direction should be free
-    if (!ep_alloc_status[i].allocated[dir] &&
-        (ep_type != TUSB_XFER_ISOCHRONOUS || !ep_alloc_status[i].allocated[dir ^ 1])) {
+    // Except for exclusive endpoints, both direction should be free
+    if (!ep_alloc->allocated[dir] &&
+        (!ep_alloc->allocated[dir ^ 1] || (!exclusive && !ep_alloc->exclusive))) {
       // Check if EP number is the same
-      if (ep_alloc_status[i].ep_num == 0xFF || ep_alloc_status[i].ep_num == epnum) {
+      if (ep_alloc->ep_num == 0xFF || ep_alloc->ep_num == epnum) {
         // One EP pair has to be the same type
-        if (ep_alloc_status[i].ep_type == 0xFF || ep_alloc_status[i].ep_type == ep_type) {
-          ep_alloc_status[i].ep_num = epnum;
-          ep_alloc_status[i].ep_type = ep_type;
-          ep_alloc_status[i].allocated[dir] = true;
+        if (ep_alloc->ep_type == 0xFF || ep_alloc->ep_type == ep_type) {
+          ep_alloc->ep_num = epnum;
+          ep_alloc->ep_type = ep_type;
+          ep_alloc->allocated[dir] = true;
+          ep_alloc->exclusive = exclusive;
 
           return i;
         }
@@ -801,7 +907,24 @@ static uint8_t dcd_ep_alloc(uint8_t ep_addr, uint8_t ep_type)
   }
 
   // Allocation failed
-  TU_ASSERT(0);
+  return 0xFF;
+}
+
+/***
+ * Release one direction of a hardware endpoint and its PMA buffer
+ */
+static void dcd_ep_free(uint8_t ep_idx, uint8_t dir)
+{
+  ep_alloc_t *ep_alloc = &ep_alloc_status[ep_idx];
+
+  ep_alloc->allocated[dir] = false;
+  ep_alloc->pma_size[dir] = 0;
+
+  if (!ep_alloc->allocated[dir ^ 1]) {
+    ep_alloc->ep_num = 0xFF;
+    ep_alloc->ep_type = 0xFF;
+    ep_alloc->exclusive = false;
+  }
 }
 
 // The STM32F0 doesn't seem to like |= or &= to manipulate the EP#R registers,
@@ -811,18 +934,19 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *p_endpoint_desc)
 {
   (void)rhport;
   uint8_t const ep_addr = p_endpoint_desc->bEndpointAddress;
-  uint8_t const ep_idx = dcd_ep_alloc(ep_addr, p_endpoint_desc->bmAttributes.xfer);
+  uint8_t const ep_type = p_endpoint_desc->bmAttributes.xfer;
   uint8_t const dir = tu_edpt_dir(ep_addr);
   const uint16_t packet_size = tu_edpt_packet_size(p_endpoint_desc);
   const uint16_t buffer_size = pcd_aligned_buffer_size(packet_size);
-  uint16_t pma_addr;
+  xfer_ctl_t *xfer = xfer_ctl_ptr(ep_addr);
+  uint8_t ep_idx = 0xFF;
+  uint32_t pma_addr = 0xFFFF;
   uint32_t wType;
 
-  TU_ASSERT(ep_idx < STFSDEV_EP_COUNT);
   TU_ASSERT(buffer_size <= 64);
 
   // Set type
-  switch (p_endpoint_desc->bmAttributes.xfer) {
+  switch (ep_type) {
     case TUSB_XFER_CONTROL:
       wType = USB_EP_CONTROL;
       break;
@@ -839,24 +963,69 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *p_endpoint_desc)
       TU_ASSERT(false);
   }
 
-  pcd_set_eptype(USB, ep_idx, wType);
+#if CFG_TUD_FSDEV_DOUBLE_BUFFER
+  // Double-buffered bulk takes a whole hardware endpoint and two packet buffers,
+  // fall back to single buffer if either runs out.
+  if (ep_type == TUSB_XFER_BULK) {
+    ep_idx = dcd_ep_alloc(ep_addr, ep_type, true);
+    if (ep_idx < STFSDEV_EP_COUNT) {
+      pma_addr = dcd_pma_alloc(ep_idx, dir, buffer_size, true);
+      if (pma_addr == 0xFFFF) {
+        dcd_ep_free(ep_idx, dir);
+        ep_idx = 0xFF;
+      }
+    }
+  }
+#endif
+
+  xfer->dbuf = (ep_idx < STFSDEV_EP_COUNT);
+  xfer->dbuf_filled = false;
+
+  if (!xfer->dbuf) {
+    ep_idx = dcd_ep_alloc(ep_addr, ep_type, false);
+    TU_ASSERT(ep_idx < STFSDEV_EP_COUNT);
+
+    /* Create a packet memory buffer area. */
+    pma_addr = dcd_pma_alloc(ep_idx, dir, buffer_size, false);
+    TU_ASSERT(pma_addr != 0xFFFF);
+  }
+
+  pcd_set_eptype(USB, ep_idx, xfer->dbuf ? USB_EP_BULK : wType);
   pcd_set_ep_address(USB, ep_idx, tu_edpt_number(ep_addr));
 
-  /* Create a packet memory buffer area. */
-  pma_addr = dcd_pma_alloc(buffer_size, false);
+  // EP_KIND is DBL_BUF for bulk endpoints
+  if (xfer->dbuf) {
+    pcd_set_ep_kind(USB, ep_idx);
+    pcd_set_ep_dbuf0_address(USB, ep_idx, pma_addr & 0xFFFFu);
+    pcd_set_ep_dbuf1_address(USB, ep_idx, pma_addr >> 16);
+  } else {
+    pcd_clear_ep_kind(USB, ep_idx);
+  }
 
+  // For double-buffered endpoints the data toggle of the other direction is SW_BUF, the buffer
+  // owned by software. Start with DTOG == SW_BUF i.e. no buffer handed to USB yet.
   if (dir == TUSB_DIR_IN) {
-    pcd_set_ep_tx_address(USB, ep_idx, pma_addr);
+    if (xfer->dbuf) {
+      pcd_clear_rx_dtog(USB, ep_idx);
+    } else {
+      pcd_set_ep_tx_address(USB, ep_idx, pma_addr);
+    }
     pcd_set_ep_tx_status(USB, ep_idx, USB_EP_TX_NAK);
     pcd_clear_tx_dtog(USB, ep_idx);
   } else {
-    pcd_set_ep_rx_address(USB, ep_idx, pma_addr);
+    if (xfer->dbuf) {
+      pcd_set_ep_rx_dbuf0_cnt(USB, ep_idx, packet_size);
+      pcd_set_ep_rx_dbuf1_cnt(USB, ep_idx, packet_size);
+      pcd_clear_tx_dtog(USB, ep_idx);
+    } else {
+      pcd_set_ep_rx_address(USB, ep_idx, pma_addr);
+    }
     pcd_set_ep_rx_status(USB, ep_idx, USB_EP_RX_NAK);
     pcd_clear_rx_dtog(USB, ep_idx);
   }
 
-  xfer_ctl_ptr(ep_addr)->max_packet_size = packet_size;
-  xfer_ctl_ptr(ep_addr)->ep_idx = ep_idx;
+  xfer->max_packet_size = packet_size;
+  xfer->ep_idx = ep_idx;
 
   return true;
 }
@@ -865,18 +1034,13 @@ void dcd_edpt_close_all(uint8_t rhport)
 {
   (void)rhport;
 
-  for (uint32_t i = 1; i < STFSDEV_EP_COUNT; i++) {
+  for (uint8_t i = 1; i < STFSDEV_EP_COUNT; i++) {
     // Reset endpoint
     pcd_set_endpoint(USB, i, 0);
-    // Clear EP allocation status
-    ep_alloc_status[i].ep_num = 0xFF;
-    ep_alloc_status[i].ep_type = 0xFF;
-    ep_alloc_status[i].allocated[0] = false;
-    ep_alloc_status[i].allocated[1] = false;
+    // Clear EP and PMA allocation status, EP0 buffers are kept
+    dcd_ep_free(i, TUSB_DIR_OUT);
+    dcd_ep_free(i, TUSB_DIR_IN);
   }
-
-  // Reset PMA allocation
-  ep_buf_ptr = DCD_STM32_BTABLE_BASE + 8 * MAX_EP_COUNT + 2 * CFG_TUD_ENDPOINT0_SIZE;
 }
 
 /**
@@ -885,6 +1049,8 @@ void dcd_edpt_close_all(uint8_t rhport)
  * This function may be called with interrupts enabled or disabled.
  *
  * This also clears transfers in progress, should there be any.
+ * The hardware endpoint and PMA buffer are released, except for ISO endpoints
+ * whose resources are reserved by dcd_edpt_iso_alloc().
  */
 void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
 {
@@ -899,30 +1065,40 @@ void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
   } else {
     pcd_set_ep_rx_status(USB, ep_idx, USB_EP_RX_DIS);
   }
+
+  if (pcd_get_eptype(USB, ep_idx) != USB_EP_ISOCHRONOUS) {
+    dcd_ep_free(ep_idx, dir);
+  }
 }
 
 bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size)
 {
   (void)rhport;
 
-  uint8_t const ep_idx = dcd_ep_alloc(ep_addr, TUSB_XFER_ISOCHRONOUS);
+  uint8_t const ep_idx = dcd_ep_alloc(ep_addr, TUSB_XFER_ISOCHRONOUS, true);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
   const uint16_t buffer_size = pcd_aligned_buffer_size(largest_packet_size);
 
+  TU_ASSERT(ep_idx < STFSDEV_EP_COUNT);
+
   /* Create a packet memory buffer area. Enable double buffering for devices with 2048 bytes PMA,
      for smaller devices double buffering occupy too much space. */
 #if FSDEV_PMA_SIZE > 1024u
-  uint32_t pma_addr = dcd_pma_alloc(buffer_size, true);
+  uint32_t pma_addr = dcd_pma_alloc(ep_idx, dir, buffer_size, true);
   uint16_t pma_addr2 = pma_addr >> 16;
 #else
-  uint32_t pma_addr = dcd_pma_alloc(buffer_size, true);
+  uint32_t pma_addr = dcd_pma_alloc(ep_idx, dir, buffer_size, false);
   uint16_t pma_addr2 = pma_addr;
 #endif
+  TU_ASSERT(pma_addr != 0xFFFF);
+
   pcd_set_ep_tx_address(USB, ep_idx, pma_addr);
   pcd_set_ep_rx_address(USB, ep_idx, pma_addr2);
 
   pcd_set_eptype(USB, ep_idx, USB_EP_ISOCHRONOUS);
 
   xfer_ctl_ptr(ep_addr)->ep_idx = ep_idx;
+  xfer_ctl_ptr(ep_addr)->dbuf = false;
 
   return true;
 }
@@ -954,9 +1130,9 @@ bool dcd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const *p_endpoin
   return true;
 }
 
-// Currently, single-buffered, and only 64 bytes at a time (max)
+// Single-buffered (or ISO), and only 64 bytes at a time (max)
 
-static void dcd_transmit_packet(xfer_ctl_t *xfer, uint16_t ep_ix)
+TU_ATTR_FAST_FUNC static void dcd_transmit_packet(xfer_ctl_t *xfer, uint16_t ep_ix)
 {
   uint16_t len = (uint16_t)(xfer->total_len - xfer->queued_len);
   if (len > xfer->max_packet_size) {
@@ -995,7 +1171,48 @@ static void dcd_transmit_packet(xfer_ctl_t *xfer, uint16_t ep_ix)
   dcd_int_enable(0);
 }
 
-static bool edpt_xfer(uint8_t rhport, uint8_t ep_addr)
+// Write the next packet of a double-buffered bulk IN transfer into one of the buffers
+TU_ATTR_FAST_FUNC static void dcd_write_packet_dbuf(xfer_ctl_t *xfer, uint16_t ep_ix, bool buf1)
+{
+  uint16_t const len = tu_min16((uint16_t)(xfer->total_len - xfer->queued_len), xfer->max_packet_size);
+  uint16_t addr_ptr;
+
+  if (buf1) {
+    addr_ptr = pcd_get_ep_dbuf1_address(USB, ep_ix);
+    pcd_set_ep_tx_dbuf1_cnt(USB, ep_ix, len);
+  } else {
+    addr_ptr = pcd_get_ep_dbuf0_address(USB, ep_ix);
+    pcd_set_ep_tx_dbuf0_cnt(USB, ep_ix, len);
+  }
+
+  if (xfer->ff) {
+    dcd_write_packet_memory_ff(xfer->ff, addr_ptr, len);
+  } else {
+    dcd_write_packet_memory(addr_ptr, &(xfer->buffer[xfer->queued_len]), len);
+  }
+  xfer->queued_len = (uint16_t)(xfer->queued_len + len);
+}
+
+// Double-buffered bulk IN. Called while no buffer is handed to USB (DTOG_TX == SW_BUF): release the
+// buffer USB sends next (DTOG_TX) by toggling SW_BUF (DTOG_RX), then prepare the following packet in the
+// other buffer while this one is on the bus.
+TU_ATTR_FAST_FUNC static void dcd_transmit_packet_dbuf(xfer_ctl_t *xfer, uint16_t ep_ix)
+{
+  bool const usb_buf1 = (pcd_get_endpoint(USB, ep_ix) & USB_EP_DTOG_TX) != 0;
+
+  if (!xfer->dbuf_filled) {
+    dcd_write_packet_dbuf(xfer, ep_ix, usb_buf1);
+  }
+  pcd_rx_dtog(USB, ep_ix);
+  xfer->dbuf_filled = false;
+
+  if (xfer->queued_len != xfer->total_len) {
+    dcd_write_packet_dbuf(xfer, ep_ix, !usb_buf1);
+    xfer->dbuf_filled = true;
+  }
+}
+
+TU_ATTR_FAST_FUNC static bool edpt_xfer(uint8_t rhport, uint8_t ep_addr)
 {
   (void)rhport;
 
@@ -1004,7 +1221,24 @@ static bool edpt_xfer(uint8_t rhport, uint8_t ep_addr)
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
   if (dir == TUSB_DIR_IN) {
-    dcd_transmit_packet(xfer, ep_idx);
+    if (xfer->dbuf) {
+      // endpoint stays valid, flow is controlled by SW_BUF
+      dcd_int_disable(0);
+      xfer->dbuf_filled = false;
+      pcd_set_ep_tx_status(USB, ep_idx, USB_EP_TX_VALID);
+      dcd_transmit_packet_dbuf(xfer, ep_idx);
+      dcd_int_enable(0);
+    } else {
+      dcd_transmit_packet(xfer, ep_idx);
+    }
+  } else if (xfer->dbuf) {
+    // Both buffers are sized for a full packet at open. Hand one to USB (SW_BUF = DTOG_TX != DTOG_RX),
+    // the other is released as packets are received.
+    uint32_t const ep_reg = pcd_get_endpoint(USB, ep_idx);
+    if (!(ep_reg & USB_EP_DTOG_RX) == !(ep_reg & USB_EP_DTOG_TX)) {
+      pcd_tx_dtog(USB, ep_idx);
+    }
+    pcd_set_ep_rx_status(USB, ep_idx, USB_EP_RX_VALID);
   } else {
     // A setup token can occur immediately after an OUT STATUS packet so make sure we have a valid
     // buffer for the control endpoint.
@@ -1028,7 +1262,7 @@ static bool edpt_xfer(uint8_t rhport, uint8_t ep_addr)
   return true;
 }
 
-bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t total_bytes)
 {
   xfer_ctl_t *xfer = xfer_ctl_ptr(ep_addr);
 
@@ -1040,7 +1274,7 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
   return edpt_xfer(rhport, ep_addr);
 }
 
-bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t *ff, uint16_t total_bytes)
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t *ff, uint16_t total_bytes)
 {
   xfer_ctl_t *xfer = xfer_ctl_ptr(ep_addr);
   xfer->buffer = NULL;
@@ -1081,17 +1315,24 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 
     /* Reset to DATA0 if clearing stall condition. */
     pcd_clear_tx_dtog(USB, ep_idx);
+    if (xfer->dbuf) {
+      pcd_clear_rx_dtog(USB, ep_idx); // SW_BUF
+      xfer->dbuf_filled = false;
+    }
   } else { // OUT
     if (pcd_get_eptype(USB, ep_idx) != USB_EP_ISOCHRONOUS) {
       pcd_set_ep_rx_status(USB, ep_idx, USB_EP_RX_NAK);
     }
     /* Reset to DATA0 if clearing stall condition. */
     pcd_clear_rx_dtog(USB, ep_idx);
+    if (xfer->dbuf) {
+      pcd_clear_tx_dtog(USB, ep_idx); // SW_BUF
+    }
   }
 }
 
 #ifdef FSDEV_BUS_32BIT
-static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
 {
   const uint8_t *srcVal = src;
   volatile uint32_t *dst32 = (volatile uint32_t *)(USB_PMAADDR + dst);
@@ -1132,7 +1373,7 @@ static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, ui
  * @param   wNBytes no. of bytes to be copied.
  * @retval None
  */
-static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, uint16_t wNBytes)
 {
   uint32_t n = (uint32_t)wNBytes >> 1U;
   uint16_t temp1, temp2;
@@ -1169,7 +1410,7 @@ static bool dcd_write_packet_memory(uint16_t dst, const void *__restrict src, ui
  * @param   wNBytes no. of bytes to be copied.
  * @retval None
  */
-static bool dcd_write_packet_memory_ff(tu_fifo_t *ff, uint16_t dst, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_write_packet_memory_ff(tu_fifo_t *ff, uint16_t dst, uint16_t wNBytes)
 {
   // Since we copy from a ring buffer FIFO, a wrap might occur making it necessary to conduct two copies
   tu_fifo_buffer_info_t info;
@@ -1239,7 +1480,7 @@ static bool dcd_write_packet_memory_ff(tu_fifo_t *ff, uint16_t dst, uint16_t wNB
 }
 
 #ifdef FSDEV_BUS_32BIT
-static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
 {
   uint8_t *dstVal = dst;
   volatile uint32_t *src32 = (volatile uint32_t *)(USB_PMAADDR + src);
@@ -1275,7 +1516,7 @@ static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t
  * @param   wNBytes no. of bytes to be copied.
  * @retval None
  */
-static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t wNBytes)
 {
   uint32_t n = (uint32_t)wNBytes >> 1U;
   // The GCC optimizer will combine access to 32-bit sizes if we let it. Force
@@ -1308,7 +1549,7 @@ static bool dcd_read_packet_memory(void *__restrict dst, uint16_t src, uint16_t
  * @param   wNBytes no. of bytes to be copied.
  * @retval None
  */
-static bool dcd_read_packet_memory_ff(tu_fifo_t *ff, uint16_t src, uint16_t wNBytes)
+TU_ATTR_FAST_FUNC static bool dcd_read_packet_memory_ff(tu_fifo_t *ff, uint16_t src, uint16_t wNBytes)
 {
   // Since we copy into a ring buffer FIFO, a wrap might occur making it necessary to conduct two copies
   // Check for first linear part
@@ -66,6 +66,7 @@ static uint8_t const* _rx_buf;
 static uint8_t const* _tx_pending_buf;
 static uint16_t _tx_pending_bytes;
 static uint16_t _tx_xferring_bytes;
+static bool _tx_good_crc; // GoodCRC is being sent, its completion is not reported to stack
 
 static pd_header_t _good_crc = {
     .msg_type   = PD_CTRL_GOOD_CRC,
@@ -80,6 +81,11 @@ static pd_header_t _good_crc = {
 // address of DMA channel rx, tx for each port
 #define CFG_TUC_STM32_DMA  { { DMA1_Channel1_BASE, DMA1_Channel2_BASE } }
 
+// Optional basic timer e.g TIM7 used as CRCReceiveTimer for message retries, together with its IRQn.
+// Timer clock must be enabled by board and run at SystemCoreClock, its IRQ handler must call tuc_int_handler().
+// #define CFG_TUC_STM32_TIMER       TIM7
+// #define CFG_TUC_STM32_TIMER_IRQn  TIM7_DAC_IRQn
+
 //--------------------------------------------------------------------+
 // DMA
 //--------------------------------------------------------------------+
@@ -160,6 +166,36 @@ TU_ATTR_ALWAYS_INLINE static inline void dma_tx_stop(uint8_t rhport) {
   dma_stop(rhport, false);
 }
 
+//--------------------------------------------------------------------+
+// Timer
+//--------------------------------------------------------------------+
+#ifdef CFG_TUC_STM32_TIMER
+
+void tcd_timer_start(uint8_t rhport, uint32_t timeout_us) {
+  (void) rhport;
+  TIM_TypeDef* tim = CFG_TUC_STM32_TIMER;
+
+  // one pulse with 1 us tick, update event only on overflow
+  tim->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+  tim->PSC = SystemCoreClock / 1000000u - 1;
+  tim->ARR = timeout_us;
+  tim->CNT = 0;
+  tim->EGR = TIM_EGR_UG; // load prescaler
+  tim->SR = 0;
+  tim->DIER = TIM_DIER_UIE;
+  tim->CR1 |= TIM_CR1_CEN;
+}
+
+void tcd_timer_stop(uint8_t rhport) {
+  (void) rhport;
+  TIM_TypeDef* tim = CFG_TUC_STM32_TIMER;
+  tim->CR1 &= ~TIM_CR1_CEN;
+  tim->DIER = 0;
+  tim->SR = 0;
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 //
 //--------------------------------------------------------------------+
@@ -202,12 +238,18 @@ bool tcd_init(uint8_t rhport, uint32_t port_type) {
 void tcd_int_enable (uint8_t rhport) {
   (void) rhport;
   NVIC_EnableIRQ(UCPD1_IRQn);
+  #ifdef CFG_TUC_STM32_TIMER_IRQn
+  NVIC_EnableIRQ(CFG_TUC_STM32_TIMER_IRQn);
+  #endif
 }
 
 // Disable interrupt
 void tcd_int_disable(uint8_t rhport) {
   (void) rhport;
   NVIC_DisableIRQ(UCPD1_IRQn);
+  #ifdef CFG_TUC_STM32_TIMER_IRQn
+  NVIC_DisableIRQ(CFG_TUC_STM32_TIMER_IRQn);
+  #endif
 }
 
 bool tcd_msg_receive(uint8_t rhport, uint8_t* buffer, uint16_t total_bytes) {
@@ -238,6 +280,15 @@ bool tcd_msg_send(uint8_t rhport, uint8_t const* buffer, uint16_t total_bytes) {
 void tcd_int_handler(uint8_t rhport) {
   (void) rhport;
 
+  #ifdef CFG_TUC_STM32_TIMER
+  TIM_TypeDef* tim = CFG_TUC_STM32_TIMER;
+  if ((tim->DIER & TIM_DIER_UIE) && (tim->SR & TIM_SR_UIF)) {
+    tim->DIER = 0;
+    tim->SR = 0;
+    tcd_event_timeout(rhport, true);
+  }
+  #endif
+
   uint32_t sr = UCPD1->SR;
   sr &= UCPD1->IMR;
 
@@ -307,11 +358,16 @@ void tcd_int_handler(uint8_t rhport) {
     uint8_t result;
 
     if (!(sr & UCPD_SR_RXERR)) {
-      // response with good crc
-      // TODO move this to usbc stack
+      // response with GoodCRC right away (within tTransmit), except to GoodCRC itself
       if (_rx_buf) {
-        _good_crc.msg_id = ((pd_header_t const *) _rx_buf)->msg_id;
-        dma_tx_start(rhport, &_good_crc, 2);
+        pd_header_t const* rx_header = (pd_header_t const *) _rx_buf;
+        if (!(rx_header->n_data_obj == 0 && rx_header->msg_type == PD_CTRL_GOOD_CRC)) {
+          _good_crc.msg_id = rx_header->msg_id;
+          _good_crc.specs_rev = rx_header->specs_rev;
+
+          _tx_good_crc = true;
+          dma_tx_start(rhport, &_good_crc, 2);
+        }
       }
 
       result = XFER_RESULT_SUCCESS;
@@ -354,9 +410,13 @@ void tcd_int_handler(uint8_t rhport) {
       UCPD1->ICR = UCPD_SR_TXMSGDISC | UCPD_SR_TXMSGABT | UCPD_SR_TXUND;
     }
 
+    bool const was_good_crc = _tx_good_crc;
+    _tx_good_crc = false;
+
     // start pending TX if any
     if (_tx_pending_buf && _tx_pending_bytes ) {
       // Start the pending TX
+      _tx_xferring_bytes = _tx_pending_bytes;
       dma_tx_start(rhport, _tx_pending_buf, _tx_pending_bytes);
 
       // clear pending
@@ -364,8 +424,10 @@ void tcd_int_handler(uint8_t rhport) {
       _tx_pending_bytes = 0;
     }
 
-    // notify stack
-    tcd_event_tx_complete(rhport, xferred_bytes, result, true);
+    // notify stack, GoodCRC is handled by TCD
+    if (!was_good_crc) {
+      tcd_event_tx_complete(rhport, xferred_bytes, result, true);
+    }
   }
 }
 
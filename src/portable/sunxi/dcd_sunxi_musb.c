@@ -472,9 +472,13 @@ static unsigned find_free_memory(uint_fast16_t size_in_log2_minus3)
     uint_fast16_t sz = free_block_size(cur);
     if (sz < size_in_8byte_unit) continue;
     if (size_in_8byte_unit == sz) return cur->beg;
-    if (sz < min_sz) min = cur;
+    if (sz < min_sz) {
+      min    = cur;
+      min_sz = sz;
+    }
   }
-  TU_ASSERT(min, 0);
+  /* Not an error by itself, the caller may retry with a smaller size */
+  TU_VERIFY(min, 0);
   return min->beg;
 }
 
@@ -1018,18 +1022,26 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * ep_desc)
     USBC_INT_EnableRxEp(epn);
   }
 
-  /* Setup FIFO */
+  /* Setup FIFO. Bulk endpoints get double packet buffering when the FIFO
+   * RAM has room for it, so the next packet can be loaded or received
+   * while the other one is on the bus. */
   int size_in_log2_minus3 = 28 - TU_MIN(28, __clz((uint32_t)mps));
   if ((8u << size_in_log2_minus3) < mps) ++size_in_log2_minus3;
-  unsigned addr = find_free_memory(size_in_log2_minus3);
+  unsigned fifosz = size_in_log2_minus3;
+  unsigned addr   = 0;
+  if (xfer == TUSB_XFER_BULK) {
+    addr = find_free_memory(size_in_log2_minus3 + 1);
+    if (addr) fifosz |= USB_TXFIFOSZ_DPB; /* Same bit position for RXFIFOSZ */
+  }
+  if (!addr) addr = find_free_memory(size_in_log2_minus3);
   TU_ASSERT(addr);
 
   if (dir_in) {
     USBC_Writew(addr, USBC_REG_TXFIFOAD(USBC0_BASE));
-    USBC_Writeb(size_in_log2_minus3, USBC_REG_TXFIFOSZ(USBC0_BASE));
+    USBC_Writeb(fifosz, USBC_REG_TXFIFOSZ(USBC0_BASE));
   } else {
     USBC_Writew(addr, USBC_REG_RXFIFOAD(USBC0_BASE));
-    USBC_Writeb(size_in_log2_minus3, USBC_REG_RXFIFOSZ(USBC0_BASE));
+    USBC_Writeb(fifosz, USBC_REG_RXFIFOSZ(USBC0_BASE));
   }
 
   musb_int_unmask();
@@ -67,6 +67,13 @@
 // Debug level for DWC2
 #define DWC2_DEBUG    2
 
+// Cortex-M7/M55 data cache by address when usbd does cache maintenance of transfer buffers
+#if CFG_TUD_MEM_DCACHE_ENABLE && !defined(dcache_clean) && defined(__DCACHE_PRESENT) && __DCACHE_PRESENT
+#define dcache_clean(_addr, _size)            SCB_CleanDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#define dcache_invalidate(_addr, _size)       SCB_InvalidateDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#define dcache_clean_invalidate(_addr, _size) SCB_CleanInvalidateDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#endif
+
 #ifndef dcache_clean
 #define dcache_clean(_addr, _size)
 #endif
@@ -79,7 +86,27 @@
 #define dcache_clean_invalidate(_addr, _size)
 #endif
 
+#if CFG_TUD_MEM_DCACHE_ENABLE
+TU_ATTR_WEAK void dcd_dcache_clean(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_clean(addr, data_size);
+}
+
+TU_ATTR_WEAK void dcd_dcache_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_invalidate(addr, data_size);
+}
+
+TU_ATTR_WEAK void dcd_dcache_clean_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_clean_invalidate(addr, data_size);
+}
+
+// setup packet is written by DMA, it has a cache line on its own
+static TU_ATTR_ALIGNED(CFG_TUSB_MEM_DCACHE_LINE_SIZE) uint32_t _setup_packet[TU_MAX(2, CFG_TUSB_MEM_DCACHE_LINE_SIZE / 4)];
+#else
 static TU_ATTR_ALIGNED(4) uint32_t _setup_packet[2];
+#endif
 
 typedef struct {
   uint8_t* buffer;
@@ -98,9 +125,28 @@ static uint16_t ep0_pending[2];               // Index determines direction as t
 // TX FIFO RAM allocation so far in words - RX FIFO size is readily available from dwc2->grxfsiz
 static uint16_t _allocated_fifo_words_tx;     // TX FIFO size in words (IN EPs)
 
+// Top of FIFO RAM usable for RX/TX FIFOs in words. In DMA mode, the core keeps endpoint DMA addresses at the top
+static uint16_t _dfifo_top;
+
+// FIFO partition computed from configuration descriptor by dcd_config_prepare(). If not planned (or did not fit),
+// FIFOs are allocated dynamically in dcd_edpt_open() order
+static bool _dfifo_planned;
+static uint16_t _dfifo_rx_max_packet;          // largest OUT packet size RX FIFO is sized for
+static uint16_t _dfifo_tx_words[DWC2_EP_MAX];  // TX FIFO size in words of each IN endpoint
+
 // SOF enabling flag - required for SOF to not get disabled in ISR when SOF was enabled by
 static bool _sof_en;
 
+// Buffer DMA mode: enabled by CFG_TUD_DWC2_DMA and core synthesized with internal DMA
+TU_ATTR_ALWAYS_INLINE static inline bool dma_enabled(dwc2_regs_t* dwc2) {
+  (void) dwc2;
+#if CFG_TUD_DWC2_DMA
+  return dwc2->ghwcfg2_bm.arch == GHWCFG2_ARCH_INTERNAL_DMA;
+#else
+  return false;
+#endif
+}
+
 // Calculate the RX FIFO size according to minimum recommendations from reference manual
 // RxFIFO = (5 * number of control endpoints + 8) +
 //          ((largest USB packet used / 4) + 1 for status information) +
@@ -133,6 +179,16 @@ static bool fifo_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t packet_size) {
 
   uint16_t fifo_size = tu_div_ceil(packet_size, 4);
 
+  // FIFO is already partitioned for this configuration
+  if (_dfifo_planned) {
+    if (dir == TUSB_DIR_OUT) {
+      TU_ASSERT(packet_size <= _dfifo_rx_max_packet);
+    } else {
+      TU_ASSERT(fifo_size <= _dfifo_tx_words[epnum]);
+    }
+    return true;
+  }
+
   // "USB Data FIFOs" section in reference manual
   // Peripheral FIFO architecture
   //
@@ -159,7 +215,7 @@ static bool fifo_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t packet_size) {
 
     // If size_rx needs to be extended check if possible and if so enlarge it
     if (dwc2->grxfsiz < sz) {
-      TU_ASSERT(sz + _allocated_fifo_words_tx <= _dwc2_controller[rhport].ep_fifo_size / 4);
+      TU_ASSERT(sz + _allocated_fifo_words_tx <= _dfifo_top);
 
       // Enlarge RX FIFO
       dwc2->grxfsiz = sz;
@@ -172,15 +228,14 @@ static bool fifo_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t packet_size) {
     }
 
     // Check if free space is available
-    TU_ASSERT(_allocated_fifo_words_tx + fifo_size + dwc2->grxfsiz <= _dwc2_controller[rhport].ep_fifo_size / 4);
+    TU_ASSERT(_allocated_fifo_words_tx + fifo_size + dwc2->grxfsiz <= _dfifo_top);
     _allocated_fifo_words_tx += fifo_size;
     TU_LOG(DWC2_DEBUG, "    Allocated %u bytes at offset %" PRIu32, fifo_size * 4,
-           _dwc2_controller[rhport].ep_fifo_size - _allocated_fifo_words_tx * 4);
+           (uint32_t) (_dfifo_top - _allocated_fifo_words_tx) * 4);
 
     // DIEPTXF starts at FIFO #1.
     // Both TXFD and TXSA are in unit of 32-bit words.
-    dwc2->dieptxf[epnum - 1] = (fifo_size << DIEPTXF_INEPTXFD_Pos) |
-                               (_dwc2_controller[rhport].ep_fifo_size / 4 - _allocated_fifo_words_tx);
+    dwc2->dieptxf[epnum - 1] = (fifo_size << DIEPTXF_INEPTXFD_Pos) | (_dfifo_top - _allocated_fifo_words_tx);
   }
 
   return true;
@@ -263,6 +318,21 @@ static void edpt_disable(uint8_t rhport, uint8_t ep_addr, bool stall) {
   }
 }
 
+// DMA mode: arm EP0 OUT to receive next SETUP packet into _setup_packet
+TU_ATTR_FAST_FUNC static void dma_setup_prepare(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2_epout_t* epout = &dwc2->epout[0];
+
+  // From 3.00a, SETUP is received even if EP0 OUT is enabled for data/status stage; no need to re-arm
+  if ((dwc2->gsnpsid >= DWC2_CORE_REV_3_00a) && (epout->doepctl & DOEPCTL_EPENA)) {
+    return;
+  }
+
+  epout->doeptsiz = (1u << DOEPTSIZ_STUPCNT_Pos) | (1u << DOEPTSIZ_PKTCNT_Pos) | (8u << DOEPTSIZ_XFRSIZ_Pos);
+  epout->doepdma = (uint32_t) (uintptr_t) _setup_packet;
+  epout->doepctl |= DOEPCTL_EPENA | DOEPCTL_USBAEP;
+}
+
 // Start of Bus Reset
 static void bus_reset(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
@@ -271,6 +341,7 @@ static void bus_reset(uint8_t rhport) {
   tu_memclr(xfer_status, sizeof(xfer_status));
 
   _sof_en = false;
+  _dfifo_planned = false;
 
   // clear device address
   dwc2->dcfg &= ~DCFG_DAD_Msk;
@@ -348,64 +419,103 @@ static void bus_reset(uint8_t rhport) {
   // EP0 out max is 64
   dwc2->grxfsiz = calc_grxfsiz(64, ep_count);
 
+  // In buffer DMA mode, core uses one FIFO RAM word per endpoint direction (EPINFO) to hold DMA addresses
+  _dfifo_top = _dwc2_controller[rhport].ep_fifo_size / 4;
+  if (dma_enabled(dwc2)) {
+    _dfifo_top -= 2 * ep_count;
+    dwc2->gdfifocfg = ((uint32_t) _dfifo_top << GDFIFOCFG_EPINFOBASE_Pos) | _dfifo_top;
+  }
+
   // Setup the control endpoint 0
   _allocated_fifo_words_tx = 16;
 
   // Control IN uses FIFO 0 with 64 bytes ( 16 32-bit word )
-  dwc2->dieptxf0 = (16 << DIEPTXF0_TX0FD_Pos) | (_dwc2_controller[rhport].ep_fifo_size / 4 - _allocated_fifo_words_tx);
+  dwc2->dieptxf0 = (16 << DIEPTXF0_TX0FD_Pos) | (_dfifo_top - _allocated_fifo_words_tx);
 
   // Fixed control EP0 size to 64 bytes
   dwc2->epin[0].diepctl &= ~(0x03 << DIEPCTL_MPSIZ_Pos);
   xfer_status[0][TUSB_DIR_OUT].max_size = 64;
   xfer_status[0][TUSB_DIR_IN].max_size = 64;
 
-  dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+  if (dma_enabled(dwc2)) {
+    dma_setup_prepare(rhport);
+  } else {
+    dwc2->epout[0].doeptsiz |= (3 << DOEPTSIZ_STUPCNT_Pos);
+  }
 
   dwc2->gintmsk |= GINTMSK_OEPINT | GINTMSK_IEPINT;
 }
 
-static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t const num_packets,
+TU_ATTR_FAST_FUNC static void edpt_schedule_packets(uint8_t rhport, uint8_t const epnum, uint8_t const dir, uint16_t const num_packets,
                                   uint16_t total_bytes) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
 
+  xfer_ctl_t* const xfer = XFER_CTL_BASE(epnum, dir);
+  bool const is_dma = dma_enabled(dwc2);
+
+  // DMA continues from where previous EP0 packet ended
+  uint32_t dma_addr = (uint32_t) (uintptr_t) xfer->buffer;
+
   // EP0 is limited to one packet each xfer
   // We use multiple transaction of xfer->max_size length to get a whole transfer done
   if (epnum == 0) {
-    xfer_ctl_t* const xfer = XFER_CTL_BASE(epnum, dir);
+    dma_addr += (uint32_t) (xfer->total_len - ep0_pending[dir]);
     total_bytes = tu_min16(ep0_pending[dir], xfer->max_size);
     ep0_pending[dir] -= total_bytes;
+
+    // status stage ZLP, DMA still needs a valid address
+    if (xfer->buffer == NULL) {
+      dma_addr = (uint32_t) (uintptr_t) _setup_packet;
+    }
   }
 
   // IN and OUT endpoint xfers are interrupt-driven, we just schedule them here.
   if (dir == TUSB_DIR_IN) {
     dwc2_epin_t* epin = dwc2->epin;
 
+    bool const is_iso = (epin[epnum].diepctl & DIEPCTL_EPTYP) == DIEPCTL_EPTYP_0;
+
     // A full IN transfer (multiple packets, possibly) triggers XFRC.
-    epin[epnum].dieptsiz = (num_packets << DIEPTSIZ_PKTCNT_Pos) |
+    // For ISO, multi count is the number of packets sent per (micro)frame: up to 3 for high-bandwidth endpoint.
+    uint32_t const mulcnt = is_iso ? tu_min16(tu_max16(num_packets, 1), 3) : 0;
+    epin[epnum].dieptsiz = (mulcnt << DIEPTSIZ_MULCNT_Pos) | (num_packets << DIEPTSIZ_PKTCNT_Pos) |
                            ((total_bytes << DIEPTSIZ_XFRSIZ_Pos) & DIEPTSIZ_XFRSIZ_Msk);
 
+    if (is_dma) {
+      epin[epnum].diepdma = dma_addr;
+    }
+
     epin[epnum].diepctl |= DIEPCTL_EPENA | DIEPCTL_CNAK;
 
     // For ISO endpoint set correct odd/even bit for next frame.
-    if ((epin[epnum].diepctl & DIEPCTL_EPTYP) == DIEPCTL_EPTYP_0 && (XFER_CTL_BASE(epnum, dir))->interval == 1) {
+    if (is_iso && (XFER_CTL_BASE(epnum, dir))->interval == 1) {
       // Take odd/even bit from frame counter.
       uint32_t const odd_frame_now = (dwc2->dsts & (1u << DSTS_FNSOF_Pos));
       epin[epnum].diepctl |= (odd_frame_now ? DIEPCTL_SD0PID_SEVNFRM_Msk : DIEPCTL_SODDFRM_Msk);
     }
-    // Enable fifo empty interrupt only if there are something to put in the fifo.
-    if (total_bytes != 0) {
+    // Enable fifo empty interrupt only if there are something to put in the fifo (slave mode).
+    if (!is_dma && total_bytes != 0) {
       dwc2->diepempmsk |= (1 << epnum);
     }
   } else {
     dwc2_epout_t* epout = dwc2->epout;
 
+    // DMA writes whole packets, transfer size must be multiple of max packet size
+    if (is_dma && epnum != 0) {
+      total_bytes = (uint16_t) (tu_max16(num_packets, 1) * xfer->max_size);
+    }
+
     // A full OUT transfer (multiple packets, possibly) triggers XFRC.
     epout[epnum].doeptsiz &= ~(DOEPTSIZ_PKTCNT_Msk | DOEPTSIZ_XFRSIZ);
     epout[epnum].doeptsiz |= (num_packets << DOEPTSIZ_PKTCNT_Pos) |
                              ((total_bytes << DOEPTSIZ_XFRSIZ_Pos) & DOEPTSIZ_XFRSIZ_Msk);
 
+    if (is_dma) {
+      epout[epnum].doepdma = dma_addr;
+    }
+
     epout[epnum].doepctl |= DOEPCTL_EPENA | DOEPCTL_CNAK;
     if ((epout[epnum].doepctl & DOEPCTL_EPTYP) == DOEPCTL_EPTYP_0 &&
         XFER_CTL_BASE(epnum, dir)->interval == 1) {
@@ -610,8 +720,23 @@ void dcd_init(uint8_t rhport) {
   dwc2->gotgint |= int_mask;
 
   // Required as part of core initialization.
-  dwc2->gintmsk = GINTMSK_OTGINT | GINTMSK_RXFLVLM |
-                  GINTMSK_USBSUSPM | GINTMSK_USBRST | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+  dwc2->gintmsk = GINTMSK_OTGINT | GINTMSK_USBSUSPM | GINTMSK_USBRST | GINTMSK_ENUMDNEM | GINTMSK_WUIM;
+
+#if CFG_TUD_LPM
+  // Ack LPM tokens: entering sleep (L1) is reported by LPMINT, leaving it by WKUINT same as resume from suspend
+  if (dwc2->ghwcfg3_bm.lpm_mode) {
+    dwc2->glpmcfg = GLPMCFG_LPMEN | GLPMCFG_LPMACK | GLPMCFG_ENBESL;
+    dwc2->gintmsk |= GINTMSK_LPMINTM;
+  }
+#endif
+
+  if (dma_enabled(dwc2)) {
+    // Buffer DMA: core moves data between FIFO and endpoint buffers, RX FIFO level interrupt is not used
+    TU_LOG(DWC2_DEBUG, "Buffer DMA mode\r\n");
+    dwc2->gahbcfg = (dwc2->gahbcfg & ~GAHBCFG_HBSTLEN_Msk) | GAHBCFG_DMAEN | GAHBCFG_HBSTLEN_2;
+  } else {
+    dwc2->gintmsk |= GINTMSK_RXFLVLM;
+  }
 
   // Configure TX FIFO empty level for interrupt. Default is complete empty
   dwc2->gahbcfg |= GAHBCFG_TXFELVL;
@@ -651,6 +776,14 @@ void dcd_remote_wakeup(uint8_t rhport) {
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
 
+#if CFG_TUD_LPM
+  // In sleep (L1) core drives resume for 50 us then clears the bit itself
+  if (dwc2->glpmcfg & GLPMCFG_SLPSTS) {
+    dwc2->dctl |= DCTL_RWUSIG;
+    return;
+  }
+#endif
+
   // set remote wakeup
   dwc2->dctl |= DCTL_RWUSIG;
 
@@ -695,8 +828,90 @@ void dcd_sof_enable(uint8_t rhport, bool en) {
 /* DCD Endpoint port
  *------------------------------------------------------------------*/
 
+// Partition FIFO RAM for all endpoints of the configuration (across all alternate settings) at once:
+// - RX FIFO is sized for the largest OUT packet and the number of OUT endpoints
+// - each IN endpoint gets its largest payload, ISO high-bandwidth includes all transactions of a micro-frame
+// - bulk IN gets room for 2 packets so that next packet can be queued while current one is transmitted, dropped
+//   if it does not fit
+// If even the minimum does not fit (e.g alternate settings with different endpoints that are never active together)
+// dynamic allocation in dcd_edpt_open() order is used as before.
+bool dcd_config_prepare(uint8_t rhport, tusb_desc_configuration_t const* desc_cfg) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
+
+  uint16_t tx_words[DWC2_EP_MAX] = {0};
+  uint16_t tx_extra[DWC2_EP_MAX] = {0}; // additional words for double packet
+  uint16_t rx_max_packet = 64;          // EP0
+  uint32_t out_map = TU_BIT(0);
+
+  uint8_t const* p_desc = (uint8_t const*) desc_cfg;
+  uint8_t const* desc_end = p_desc + tu_le16toh(desc_cfg->wTotalLength);
+
+  while (p_desc < desc_end) {
+    if (tu_desc_type(p_desc) == TUSB_DESC_ENDPOINT) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+      uint16_t const size = tu_edpt_max_payload(desc_ep);
+      TU_ASSERT(epnum < ep_count);
+
+      if (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_OUT) {
+        rx_max_packet = tu_max16(rx_max_packet, size);
+        out_map |= TU_BIT(epnum);
+      } else {
+        uint16_t const words = (uint16_t) tu_div_ceil(size, 4);
+        tx_words[epnum] = tu_max16(tx_words[epnum], words);
+        if (desc_ep->bmAttributes.xfer == TUSB_XFER_BULK) {
+          tx_extra[epnum] = tu_max16(tx_extra[epnum], words);
+        }
+      }
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  uint8_t out_count = 0;
+  uint32_t tx_total = 0;
+  uint32_t extra_total = 0;
+  for (uint8_t n = 0; n < ep_count; n++) {
+    if (out_map & TU_BIT(n)) {
+      out_count++;
+    }
+    tx_total += tx_words[n];
+    extra_total += tx_extra[n];
+  }
+  uint16_t const rx_words = calc_grxfsiz(rx_max_packet, out_count);
+
+  // EP0 IN uses 16 words
+  uint32_t const available = _dfifo_top - 16u;
+  if (rx_words + tx_total > available) {
+    TU_LOG(DWC2_DEBUG, "  FIFO plan does not fit (%u words), allocate on open\r\n", (unsigned) (rx_words + tx_total));
+    return true;
+  }
+
+  bool const double_packet = (rx_words + tx_total + extra_total <= available);
+
+  _dfifo_rx_max_packet = rx_max_packet;
+  dwc2->grxfsiz = rx_words;
+
+  _allocated_fifo_words_tx = 16;
+  for (uint8_t n = 1; n < ep_count; n++) {
+    uint16_t const words = (uint16_t) (tx_words[n] + (double_packet ? tx_extra[n] : 0));
+    _dfifo_tx_words[n] = words;
+    if (words) {
+      _allocated_fifo_words_tx += words;
+      dwc2->dieptxf[n - 1] = ((uint32_t) words << DIEPTXF_INEPTXFD_Pos) | (_dfifo_top - _allocated_fifo_words_tx);
+    }
+  }
+
+  _dfifo_planned = true;
+  TU_LOG(DWC2_DEBUG, "  FIFO plan: RX %u words, TX %u words, double packet %u\r\n", rx_words,
+         _allocated_fifo_words_tx, double_packet);
+
+  return true;
+}
+
 bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_edpt) {
-  TU_ASSERT(fifo_alloc(rhport, desc_edpt->bEndpointAddress, tu_edpt_packet_size(desc_edpt)));
+  // High-bandwidth endpoint needs FIFO space for all transactions of a micro-frame
+  TU_ASSERT(fifo_alloc(rhport, desc_edpt->bEndpointAddress, tu_edpt_max_payload(desc_edpt)));
   edpt_activate(rhport, desc_edpt);
   return true;
 }
@@ -727,6 +942,7 @@ void dcd_edpt_close_all(uint8_t rhport) {
   dwc2->grxfsiz = calc_grxfsiz(64, ep_count);
   // reset allocated fifo IN
   _allocated_fifo_words_tx = 16;
+  _dfifo_planned = false;
 
   fifo_flush_tx(dwc2, 0x10); // all tx fifo
   fifo_flush_rx(dwc2);
@@ -746,7 +962,7 @@ bool dcd_edpt_iso_activate(uint8_t rhport,  tusb_desc_endpoint_t const * p_endpo
   return true;
 }
 
-bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
@@ -755,6 +971,18 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
   xfer->ff = NULL;
   xfer->total_len = total_bytes;
 
+  if (dma_enabled(DWC2_REG(rhport))) {
+    // DMA transfers in 32-bit words over AHB
+    TU_ASSERT(((uintptr_t) buffer & 0x03) == 0);
+    #if !CFG_TUD_MEM_DCACHE_ENABLE // otherwise done by usbd
+    if (dir == TUSB_DIR_IN) {
+      dcache_clean(buffer, total_bytes);
+    } else {
+      dcache_clean_invalidate(buffer, total_bytes);
+    }
+    #endif
+  }
+
   // EP0 can only handle one packet
   if (epnum == 0) {
     ep0_pending[dir] = total_bytes;
@@ -779,10 +1007,13 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t to
 // bytes should be written and second to keep the return value free to give back a boolean
 // success message. If total_bytes is too big, the FIFO will copy only what is available
 // into the USB buffer!
-bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+TU_ATTR_FAST_FUNC bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
   // USB buffers always work in bytes so to avoid unnecessary divisions we demand item_size = 1
   TU_ASSERT(ff->item_size == 1);
 
+  // buffer DMA can not wrap around ring buffer
+  TU_ASSERT(!dma_enabled(DWC2_REG(rhport)));
+
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir = tu_edpt_dir(ep_addr);
 
@@ -832,7 +1063,7 @@ void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
 /*------------------------------------------------------------------*/
 
 // Read a single data packet from receive FIFO
-static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
+TU_ATTR_FAST_FUNC static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
@@ -856,7 +1087,7 @@ static void read_fifo_packet(uint8_t rhport, uint8_t* dst, uint16_t len) {
 }
 
 // Write a single data packet to EPIN FIFO
-static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* src, uint16_t len) {
+TU_ATTR_FAST_FUNC static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* src, uint16_t len) {
   (void) rhport;
 
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
@@ -880,7 +1111,7 @@ static void write_fifo_packet(uint8_t rhport, uint8_t fifo_num, uint8_t const* s
   }
 }
 
-static void handle_rxflvl_irq(uint8_t rhport) {
+TU_ATTR_FAST_FUNC static void handle_rxflvl_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   volatile uint32_t const* rx_fifo = dwc2->fifo[0];
 
@@ -979,14 +1210,91 @@ static void handle_rxflvl_irq(uint8_t rhport) {
   }
 }
 
-static void handle_epout_irq(uint8_t rhport) {
+// DMA mode: data is already in endpoint buffer when XFRC is raised
+TU_ATTR_FAST_FUNC static void handle_epout_dma(uint8_t rhport, uint8_t epnum) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2_epout_t* epout = &dwc2->epout[epnum];
+
+  uint32_t const doepint = epout->doepint;
+  epout->doepint = doepint;
+
+  // SETUP packet Setup Phase done.
+  if (doepint & DOEPINT_STUP) {
+    dma_setup_prepare(rhport);
+    dcache_invalidate(_setup_packet, 8);
+    dcd_event_setup_received(rhport, (uint8_t*) _setup_packet, true);
+    return;
+  }
+
+  // OUT XFER complete, skip the one generated for setup packet/status phase received (3.00a+)
+  if ((doepint & DOEPINT_XFRC) && !(doepint & (DOEPINT_STPKTRX | DOEPINT_OTEPSPR))) {
+    xfer_ctl_t* xfer = XFER_CTL_BASE(epnum, TUSB_DIR_OUT);
+    uint16_t const remain = (uint16_t) ((epout->doeptsiz & DOEPTSIZ_XFRSIZ_Msk) >> DOEPTSIZ_XFRSIZ_Pos);
+
+    if (epnum == 0) {
+      if (remain == 0 && ep0_pending[TUSB_DIR_OUT]) {
+        // EP0 can only handle one packet, schedule another packet to be received.
+        edpt_schedule_packets(rhport, epnum, TUSB_DIR_OUT, 1, ep0_pending[TUSB_DIR_OUT]);
+        return;
+      }
+
+      // short packet: truncate transfer length
+      xfer->total_len -= (uint16_t) (remain + ep0_pending[TUSB_DIR_OUT]);
+      ep0_pending[TUSB_DIR_OUT] = 0;
+
+      // status stage (or short data stage) is done, prepare for next SETUP
+      if (xfer->total_len == 0) {
+        dma_setup_prepare(rhport);
+      }
+    } else {
+      // transfer size was rounded up to multiple of packet size
+      uint16_t const num_packets = tu_max16((uint16_t) tu_div_ceil(xfer->total_len, xfer->max_size), 1);
+      uint16_t const received = (uint16_t) (num_packets * xfer->max_size - remain);
+      xfer->total_len = tu_min16(xfer->total_len, received);
+    }
+
+    #if !CFG_TUD_MEM_DCACHE_ENABLE // otherwise done by usbd
+    dcache_invalidate(xfer->buffer, xfer->total_len);
+    #endif
+    dcd_event_xfer_complete(rhport, epnum, xfer->total_len, XFER_RESULT_SUCCESS, true);
+  }
+}
+
+TU_ATTR_FAST_FUNC static void handle_epin_dma(uint8_t rhport, uint8_t epnum) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2_epin_t* epin = &dwc2->epin[epnum];
+
+  if (epin->diepint & DIEPINT_XFRC) {
+    epin->diepint = DIEPINT_XFRC;
+    xfer_ctl_t* xfer = XFER_CTL_BASE(epnum, TUSB_DIR_IN);
+
+    if ((epnum == 0) && ep0_pending[TUSB_DIR_IN]) {
+      // EP0 can only handle one packet, schedule another packet to be transmitted.
+      edpt_schedule_packets(rhport, epnum, TUSB_DIR_IN, 1, ep0_pending[TUSB_DIR_IN]);
+    } else {
+      // EP0 OUT must be ready for next SETUP (or status stage which may come right after)
+      if (epnum == 0) {
+        dma_setup_prepare(rhport);
+      }
+      dcd_event_xfer_complete(rhport, epnum | TUSB_DIR_IN_MASK, xfer->total_len, XFER_RESULT_SUCCESS, true);
+    }
+  }
+}
+
+TU_ATTR_FAST_FUNC static void handle_epout_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
+  bool const is_dma = dma_enabled(dwc2);
 
   // DAINT for a given EP clears when DOEPINTx is cleared.
   // OEPINT will be cleared when DAINT's out bits are cleared.
   for (uint8_t n = 0; n < ep_count; n++) {
     if (dwc2->daint & TU_BIT(DAINT_OEPINT_Pos + n)) {
+      if (is_dma) {
+        handle_epout_dma(rhport, n);
+        continue;
+      }
+
       dwc2_epout_t* epout = &dwc2->epout[n];
 
       uint32_t const doepint = epout->doepint;
@@ -1022,15 +1330,21 @@ static void handle_epout_irq(uint8_t rhport) {
   }
 }
 
-static void handle_epin_irq(uint8_t rhport) {
+TU_ATTR_FAST_FUNC static void handle_epin_irq(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
   uint8_t const ep_count = _dwc2_controller[rhport].ep_count;
   dwc2_epin_t* epin = dwc2->epin;
+  bool const is_dma = dma_enabled(dwc2);
 
   // DAINT for a given EP clears when DIEPINTx is cleared.
   // IEPINT will be cleared when DAINT's out bits are cleared.
   for (uint8_t n = 0; n < ep_count; n++) {
     if (dwc2->daint & TU_BIT(DAINT_IEPINT_Pos + n)) {
+      if (is_dma) {
+        handle_epin_dma(rhport, n);
+        continue;
+      }
+
       // IN XFER complete (entire xfer).
       xfer_ctl_t* xfer = XFER_CTL_BASE(n, TUSB_DIR_IN);
 
@@ -1087,7 +1401,7 @@ static void handle_epin_irq(uint8_t rhport) {
   }
 }
 
-void dcd_int_handler(uint8_t rhport) {
+TU_ATTR_FAST_FUNC void dcd_int_handler(uint8_t rhport) {
   dwc2_regs_t* dwc2 = DWC2_REG(rhport);
 
   uint32_t const int_mask = dwc2->gintmsk;
@@ -1135,6 +1449,15 @@ void dcd_int_handler(uint8_t rhport) {
     dcd_event_bus_signal(rhport, DCD_EVENT_RESUME, true);
   }
 
+#if CFG_TUD_LPM
+  if (int_status & GINTSTS_LPMINT) {
+    dwc2->gintsts = GINTSTS_LPMINT;
+    uint32_t const glpmcfg = dwc2->glpmcfg;
+    uint8_t const besl = (uint8_t) ((glpmcfg & GLPMCFG_BESL) >> GLPMCFG_BESL_Pos);
+    dcd_event_lpm_sleep(rhport, besl, (glpmcfg & GLPMCFG_REMWAKE) != 0, true);
+  }
+#endif
+
   // TODO check GINTSTS_DISCINT for disconnect detection
   // if(int_status & GINTSTS_DISCINT)
 
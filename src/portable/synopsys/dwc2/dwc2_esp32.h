@@ -46,6 +46,9 @@ static const dwc2_controller_t _dwc2_controller[] =
 
 static intr_handle_t usb_ih;
 
+#if CFG_TUD_ENABLED
+#include "device/dcd.h"
+
 static void dcd_int_handler_wrap(void* arg)
 {
   (void) arg;
@@ -65,6 +68,31 @@ static inline void dwc2_dcd_int_disable (uint8_t rhport)
   (void) rhport;
   esp_intr_free(usb_ih);
 }
+#endif
+
+#if CFG_TUH_ENABLED
+#include "host/hcd.h"
+
+static void hcd_int_handler_wrap(void* arg)
+{
+  (void) arg;
+  hcd_int_handler(0, true);
+}
+
+TU_ATTR_ALWAYS_INLINE
+static inline void dwc2_hcd_int_enable (uint8_t rhport)
+{
+  (void) rhport;
+  esp_intr_alloc(ETS_USB_INTR_SOURCE, ESP_INTR_FLAG_LOWMED, hcd_int_handler_wrap, NULL, &usb_ih);
+}
+
+TU_ATTR_ALWAYS_INLINE
+static inline void dwc2_hcd_int_disable (uint8_t rhport)
+{
+  (void) rhport;
+  esp_intr_free(usb_ih);
+}
+#endif
 
 static inline void dwc2_remote_wakeup_delay(void)
 {
@@ -75,6 +75,12 @@ enum {
   HS_PHY_TYPE_UTMI_ULPI ,
 };
 
+enum {
+  GHWCFG2_ARCH_SLAVE_ONLY = 0,
+  GHWCFG2_ARCH_EXTERNAL_DMA,
+  GHWCFG2_ARCH_INTERNAL_DMA,
+};
+
 enum {
   FS_PHY_TYPE_NONE = 0,  // not supported
   FS_PHY_TYPE_DEDICATED,
@@ -989,6 +995,14 @@ TU_VERIFY_STATIC(offsetof(dwc2_regs_t, fifo   ) == 0x1000, "incorrect size");
 #define GRXFSIZ_RXFD_Msk                 (0xFFFFUL << GRXFSIZ_RXFD_Pos)           // 0x0000FFFF
 #define GRXFSIZ_RXFD                     GRXFSIZ_RXFD_Msk                         // RxFIFO depth
 
+/********************  Bit definition for GDFIFOCFG register  ********************/
+#define GDFIFOCFG_GDFIFOCFG_Pos          (0U)
+#define GDFIFOCFG_GDFIFOCFG_Msk          (0xFFFFUL << GDFIFOCFG_GDFIFOCFG_Pos)    // 0x0000FFFF
+#define GDFIFOCFG_GDFIFOCFG              GDFIFOCFG_GDFIFOCFG_Msk                  // DFIFO config (total depth)
+#define GDFIFOCFG_EPINFOBASE_Pos         (16U)
+#define GDFIFOCFG_EPINFOBASE_Msk         (0xFFFFUL << GDFIFOCFG_EPINFOBASE_Pos)   // 0xFFFF0000
+#define GDFIFOCFG_EPINFOBASE             GDFIFOCFG_EPINFOBASE_Msk                 // Endpoint info (DMA address) base
+
 /********************  Bit definition for DVBUSDIS register  ********************/
 #define DVBUSDIS_VBUSDT_Pos              (0U)
 #define DVBUSDIS_VBUSDT_Msk              (0xFFFFUL << DVBUSDIS_VBUSDT_Pos)        // 0x0000FFFF
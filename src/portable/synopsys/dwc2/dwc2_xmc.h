@@ -54,6 +54,19 @@ static inline void dwc2_dcd_int_disable (uint8_t rhport)
   NVIC_DisableIRQ(_dwc2_controller[rhport].irqnum);
 }
 
+// Host and device use the same controller interrupt
+TU_ATTR_ALWAYS_INLINE
+static inline void dwc2_hcd_int_enable(uint8_t rhport)
+{
+  NVIC_EnableIRQ(_dwc2_controller[rhport].irqnum);
+}
+
+TU_ATTR_ALWAYS_INLINE
+static inline void dwc2_hcd_int_disable (uint8_t rhport)
+{
+  NVIC_DisableIRQ(_dwc2_controller[rhport].irqnum);
+}
+
 static inline void dwc2_remote_wakeup_delay(void)
 {
   // try to delay for 1 ms
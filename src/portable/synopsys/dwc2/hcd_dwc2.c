@@ -0,0 +1,1319 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024, Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED && defined(TUP_USBIP_DWC2) && !(defined(CFG_TUH_MAX3421) && CFG_TUH_MAX3421)
+
+#include "host/hcd.h"
+#include "dwc2_type.h"
+
+// Following symbols must be defined by port header
+// - _dwc2_controller[]: array of controllers
+// - dwc2_phy_init/dwc2_phy_update: phy init called before and after core reset
+// - dwc2_hcd_int_enable/dwc2_hcd_int_disable
+
+#if defined(TUP_USBIP_DWC2_STM32)
+  #include "dwc2_stm32.h"
+#elif TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)
+  #include "dwc2_esp32.h"
+#elif TU_CHECK_MCU(OPT_MCU_GD32VF103)
+  #include "dwc2_gd32.h"
+#elif TU_CHECK_MCU(OPT_MCU_BCM2711, OPT_MCU_BCM2835, OPT_MCU_BCM2837)
+  #include "dwc2_bcm.h"
+#elif TU_CHECK_MCU(OPT_MCU_EFM32GG)
+  #include "dwc2_efm32.h"
+#elif TU_CHECK_MCU(OPT_MCU_XMC4000)
+  #include "dwc2_xmc.h"
+#else
+  #error "Unsupported MCUs"
+#endif
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM
+//--------------------------------------------------------------------+
+
+// DWC2 registers
+#define DWC2_REG(_port)       ((dwc2_regs_t*) _dwc2_controller[_port].reg_base)
+
+// Debug level for DWC2
+#define DWC2_DEBUG    2
+
+// Cortex-M7/M55 data cache by address when usbh does cache maintenance of transfer buffers
+#if CFG_TUH_MEM_DCACHE_ENABLE && !defined(dcache_clean) && defined(__DCACHE_PRESENT) && __DCACHE_PRESENT
+#define dcache_clean(_addr, _size)            SCB_CleanDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#define dcache_invalidate(_addr, _size)       SCB_InvalidateDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#define dcache_clean_invalidate(_addr, _size) SCB_CleanInvalidateDCache_by_Addr((uint32_t*) (uintptr_t) (_addr), (int32_t) (_size))
+#endif
+
+#ifndef dcache_clean
+#define dcache_clean(_addr, _size)
+#endif
+
+#ifndef dcache_invalidate
+#define dcache_invalidate(_addr, _size)
+#endif
+
+#ifndef dcache_clean_invalidate
+#define dcache_clean_invalidate(_addr, _size)
+#endif
+
+#if CFG_TUH_MEM_DCACHE_ENABLE
+TU_ATTR_WEAK bool hcd_dcache_clean(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_clean(addr, data_size);
+  return true;
+}
+
+TU_ATTR_WEAK bool hcd_dcache_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_invalidate(addr, data_size);
+  return true;
+}
+
+TU_ATTR_WEAK bool hcd_dcache_clean_invalidate(void const* addr, uint32_t data_size) {
+  (void) addr; (void) data_size;
+  dcache_clean_invalidate(addr, data_size);
+  return true;
+}
+#endif
+
+// Max number of endpoints (of all devices) tracked by driver. Endpoints share the core's host channels: a transfer
+// waits for a free channel (round-robin) when there are more active endpoints than channels.
+#ifndef CFG_TUH_DWC2_ENDPOINT_MAX
+  #define CFG_TUH_DWC2_ENDPOINT_MAX   (8 + 4*(CFG_TUH_DEVICE_MAX-1))
+#endif
+
+enum {
+  DWC2_CHANNEL_COUNT_MAX = 16,   // absolute max channel count of the core
+  HCD_XFER_ERROR_MAX     = 3,    // consecutive transaction errors before transfer is failed
+  HCD_SPLIT_NYET_MAX     = 3,    // periodic complete split NYET retries before start split is re-issued
+  HCTSIZ_PKTCNT_MAX      = 1023,
+  HFNUM_FRAME_MASK       = 0x3FFF,
+};
+
+// HPRT bits that are cleared by writing 1, they must be masked out when modifying other bits
+enum {
+  HPRT_W1C_MASK = HPRT_PCDET | HPRT_PENA | HPRT_PENCHNG | HPRT_POCCHNG
+};
+
+enum {
+  HPRT_SPEED_HIGH = 0,
+  HPRT_SPEED_FULL,
+  HPRT_SPEED_LOW,
+};
+
+enum {
+  HCFG_FSLSPCS_30_60MHZ = 0,
+  HCFG_FSLSPCS_48MHZ,
+  HCFG_FSLSPCS_6MHZ,
+};
+
+enum {
+  HCTSIZ_PID_DATA0 = 0,
+  HCTSIZ_PID_DATA2,
+  HCTSIZ_PID_DATA1,
+  HCTSIZ_PID_SETUP, // MDATA for non-control
+};
+
+enum {
+  EDPT_STATE_IDLE = 0, // no transfer
+  EDPT_STATE_PENDING,  // transfer queued, waiting for a free channel or its (micro)frame
+  EDPT_STATE_ACTIVE,   // transfer is running on a channel
+};
+
+typedef struct {
+  uint32_t hcchar;      // HCCHAR value without CHENA, CHDIS and ODDFRM
+  uint32_t hcsplt;      // HCSPLT value, non-zero if split transaction is used (FS/LS device behind HS hub)
+  uint8_t* buffer;
+  uint16_t buflen;
+  uint16_t xferred;     // bytes transferred so far
+  uint16_t interval;    // periodic interval in (micro)frames of root port
+  uint16_t next_frame;  // HFNUM (micro)frame number periodic endpoint is due
+
+  uint8_t allocated : 1;
+  uint8_t state     : 2;
+  uint8_t next_pid  : 2; // HCTSIZ DPID of next packet
+  uint8_t err_count : 3;
+} hcd_endpoint_t;
+
+typedef struct {
+  uint8_t ep_id;         // index of endpoint using this channel, TUSB_INDEX_INVALID_8 if free
+  uint8_t closing    : 1; // endpoint is gone (device closed, aborted), release channel once halted
+  uint8_t halting    : 1; // halt requested, waiting for halted interrupt
+  uint8_t split_nyet : 3; // NYET count of complete split
+  uint16_t pkt_count;    // packets programmed in current channel run
+  uint32_t xfer_len;     // bytes programmed in current channel run
+  uint32_t fifo_bytes;   // slave mode: bytes written to/read from FIFO in current channel run
+  uint32_t hcint;        // slave mode: interrupt status accumulated until channel is halted
+} hcd_channel_t;
+
+typedef struct {
+  hcd_channel_t channel[DWC2_CHANNEL_COUNT_MAX];
+  hcd_endpoint_t edpt[CFG_TUH_DWC2_ENDPOINT_MAX];
+
+  uint8_t channel_count;
+  uint8_t rr_next;        // round-robin: first endpoint to look at for next free channel
+  bool fs_phy;            // FS PHY: clock of PHY must be adjusted to port speed (FS/LS)
+  bool root_hs;           // root port is high speed: (micro)frame is 125us, FS/LS devices behind hub use split
+
+  uint16_t frame_last;    // last HFNUM read, used to extend frame number to 32-bit
+  uint32_t frame_count;
+} hcd_data_t;
+
+static hcd_data_t _hcd_data;
+
+// DMA requires aligned setup buffer
+static TU_ATTR_ALIGNED(4) uint8_t _setup_packet[8];
+
+// Buffer DMA mode: enabled by CFG_TUH_DWC2_DMA and core synthesized with internal DMA
+TU_ATTR_ALWAYS_INLINE static inline bool dma_enabled(dwc2_regs_t* dwc2) {
+  (void) dwc2;
+#if CFG_TUH_DWC2_DMA
+  return dwc2->ghwcfg2_bm.arch == GHWCFG2_ARCH_INTERNAL_DMA;
+#else
+  return false;
+#endif
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t frame_current(dwc2_regs_t* dwc2) {
+  return (uint16_t) (dwc2->hfnum & HFNUM_FRAME_MASK);
+}
+
+// true if (micro)frame 'target' is now or already passed
+TU_ATTR_ALWAYS_INLINE static inline bool frame_reached(uint16_t now, uint16_t target) {
+  return ((uint16_t) (now - target) & HFNUM_FRAME_MASK) < (HFNUM_FRAME_MASK + 1) / 2;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t edpt_number(hcd_endpoint_t const* edpt) {
+  return (uint8_t) ((edpt->hcchar & HCCHAR_EPNUM_Msk) >> HCCHAR_EPNUM_Pos);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t edpt_daddr(hcd_endpoint_t const* edpt) {
+  return (uint8_t) ((edpt->hcchar & HCCHAR_DAD_Msk) >> HCCHAR_DAD_Pos);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t edpt_packet_size(hcd_endpoint_t const* edpt) {
+  return (uint16_t) ((edpt->hcchar & HCCHAR_MPSIZ_Msk) >> HCCHAR_MPSIZ_Pos);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool edpt_is_in(hcd_endpoint_t const* edpt) {
+  return (edpt->hcchar & HCCHAR_EPDIR) != 0;
+}
+
+// Interrupt and Isochronous endpoints are scheduled in periodic queue and TX FIFO
+TU_ATTR_ALWAYS_INLINE static inline bool edpt_is_periodic(hcd_endpoint_t const* edpt) {
+  uint8_t const xfer_type = (uint8_t) ((edpt->hcchar & HCCHAR_EPTYP_Msk) >> HCCHAR_EPTYP_Pos);
+  return (xfer_type == TUSB_XFER_INTERRUPT) || (xfer_type == TUSB_XFER_ISOCHRONOUS);
+}
+
+// Critical section against our ISR for API called from task: mask core global interrupt
+TU_ATTR_ALWAYS_INLINE static inline void core_int_lock(dwc2_regs_t* dwc2) {
+  dwc2->gahbcfg &= ~GAHBCFG_GINT;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void core_int_unlock(dwc2_regs_t* dwc2) {
+  dwc2->gahbcfg |= GAHBCFG_GINT;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void fifo_flush_tx(dwc2_regs_t* dwc2, uint8_t fnum) {
+  // flush TX fifo and wait for it cleared
+  dwc2->grstctl = GRSTCTL_TXFFLSH | (fnum << GRSTCTL_TXFNUM_Pos);
+  while (dwc2->grstctl & GRSTCTL_TXFFLSH_Msk) {}
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void fifo_flush_rx(dwc2_regs_t* dwc2) {
+  // flush RX fifo and wait for it cleared
+  dwc2->grstctl = GRSTCTL_RXFFLSH;
+  while (dwc2->grstctl & GRSTCTL_RXFFLSH_Msk) {}
+}
+
+//--------------------------------------------------------------------+
+// Endpoint helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_FAST_FUNC static uint8_t edpt_find(uint8_t dev_addr, uint8_t ep_addr) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir = tu_edpt_dir(ep_addr);
+
+  for (uint8_t i = 0; i < CFG_TUH_DWC2_ENDPOINT_MAX; i++) {
+    hcd_endpoint_t const* edpt = &_hcd_data.edpt[i];
+    // control endpoint is bidirectional
+    if (edpt->allocated && edpt_daddr(edpt) == dev_addr && edpt_number(edpt) == epnum &&
+        (epnum == 0 || (edpt_is_in(edpt) ? TUSB_DIR_IN : TUSB_DIR_OUT) == dir)) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+static uint8_t edpt_alloc(void) {
+  for (uint8_t i = 0; i < CFG_TUH_DWC2_ENDPOINT_MAX; i++) {
+    if (!_hcd_data.edpt[i].allocated) {
+      return i;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+//--------------------------------------------------------------------+
+// Channel helper
+//--------------------------------------------------------------------+
+
+TU_ATTR_FAST_FUNC static uint8_t channel_alloc(void) {
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    hcd_channel_t const* ch = &_hcd_data.channel[ch_id];
+    if (ch->ep_id == TUSB_INDEX_INVALID_8 && !ch->closing) {
+      return ch_id;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+TU_ATTR_FAST_FUNC static uint8_t channel_find(uint8_t ep_id) {
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    if (_hcd_data.channel[ch_id].ep_id == ep_id) {
+      return ch_id;
+    }
+  }
+
+  return TUSB_INDEX_INVALID_8;
+}
+
+TU_ATTR_FAST_FUNC static void channel_release(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  ch->ep_id = TUSB_INDEX_INVALID_8;
+  ch->closing = 0;
+  ch->halting = 0;
+
+  dwc2->channel[ch_id].hcintmsk = 0;
+  dwc2->haintmsk &= ~TU_BIT(ch_id);
+}
+
+// Request channel halt, transfer continues/finishes in channel halted interrupt.
+// Both CHENA and CHDIS must be set; in slave mode the halt request takes one entry of the request queue.
+TU_ATTR_FAST_FUNC static void channel_disable(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  _hcd_data.channel[ch_id].halting = 1;
+  channel->hcintmsk = HCINT_CHH | HCINT_AHBERR;
+  channel->hcchar |= HCCHAR_CHENA | HCCHAR_CHDIS;
+}
+
+// Slave mode: write as many packets of OUT channel to its TX FIFO as space allows. Return true if all are written.
+TU_ATTR_FAST_FUNC static bool channel_write_packets(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t const* edpt = &_hcd_data.edpt[ch->ep_id];
+  bool const is_periodic = edpt_is_periodic(edpt);
+  uint16_t const packet_size = edpt_packet_size(edpt);
+  volatile uint32_t* tx_fifo = dwc2->fifo[ch_id];
+
+  while (ch->fifo_bytes < ch->xfer_len) {
+    // Periodic and Non-periodic TX status have same layout: [15:0] FIFO words available, [23:16] queue available
+    uint32_t const txsts = is_periodic ? dwc2->hptxsts : dwc2->gnptxsts;
+    uint16_t const words_avail = (uint16_t) (txsts & GNPTXSTS_NPTXFSAV_Msk);
+    uint8_t const queue_avail = (uint8_t) ((txsts & GNPTXSTS_NPTQXSAV_Msk) >> GNPTXSTS_NPTQXSAV_Pos);
+    uint16_t const len = (uint16_t) tu_min32(packet_size, ch->xfer_len - ch->fifo_bytes);
+
+    if (queue_avail == 0 || words_avail < tu_div_ceil(len, 4)) {
+      return false;
+    }
+
+    uint8_t const* src = edpt->buffer + edpt->xferred + ch->fifo_bytes;
+
+    // Pushing full available 32 bit words to fifo
+    uint16_t full_words = len >> 2;
+    while (full_words--) {
+      *tx_fifo = tu_unaligned_read32(src);
+      src += 4;
+    }
+
+    // Write the remaining 1-3 bytes into fifo
+    uint8_t const bytes_rem = len & 0x03;
+    if (bytes_rem) {
+      uint32_t tmp_word = src[0];
+      if (bytes_rem > 1) tmp_word |= (src[1] << 8);
+      if (bytes_rem > 2) tmp_word |= (src[2] << 16);
+
+      *tx_fifo = tmp_word;
+    }
+
+    ch->fifo_bytes += len;
+  }
+
+  return true;
+}
+
+// Program channel for remaining data of its endpoint and enable it.
+// Split transaction moves one packet per start/complete split pair; complete split re-uses current packet.
+TU_ATTR_FAST_FUNC static void channel_xfer_start(dwc2_regs_t* dwc2, uint8_t ch_id, bool complete_split) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ch->ep_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+  bool const is_in = edpt_is_in(edpt);
+  bool const is_periodic = edpt_is_periodic(edpt);
+  uint16_t const packet_size = edpt_packet_size(edpt);
+  uint16_t const remaining = edpt->buflen - edpt->xferred;
+
+  uint16_t pkt_count;
+  uint32_t len;
+  if (edpt->hcsplt) {
+    pkt_count = 1;
+    len = tu_min16(remaining, packet_size);
+  } else {
+    pkt_count = remaining ? (uint16_t) tu_div_ceil(remaining, packet_size) : 1;
+    if (pkt_count > HCTSIZ_PKTCNT_MAX) pkt_count = HCTSIZ_PKTCNT_MAX;
+    len = tu_min32(remaining, (uint32_t) pkt_count * packet_size);
+  }
+
+  // IN is always programmed in whole packets, a short packet ends the transfer
+  if (is_in) len = (uint32_t) pkt_count * packet_size;
+
+  ch->pkt_count = pkt_count;
+  ch->xfer_len = len;
+  ch->hcint = 0;
+  ch->halting = 0;
+  // complete split OUT does not carry data
+  ch->fifo_bytes = (complete_split && !is_in) ? len : 0;
+  if (!complete_split) ch->split_nyet = 0;
+
+  channel->hcint = 0xFFFFFFFFu;
+  channel->hctsiz = ((uint32_t) edpt->next_pid << HCTSIZ_DPID_Pos) | ((uint32_t) pkt_count << HCTSIZ_PKTCNT_Pos) |
+                    ((complete_split && !is_in) ? 0 : len);
+  channel->hcsplt = edpt->hcsplt | (complete_split ? HCSPLT_COMPLSPLT : 0);
+
+  uint32_t hcintmsk;
+  if (dma_enabled(dwc2)) {
+    uint8_t* buf = edpt->buffer + edpt->xferred;
+    channel->hcdma = (uint32_t) (uintptr_t) buf;
+    #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh for the whole transfer
+    if (!complete_split && len) {
+      if (is_in) {
+        dcache_invalidate(buf, len);
+      } else {
+        dcache_clean(buf, len);
+      }
+    }
+    #endif
+
+    // DMA: core handles data and non-split NAK/NYET retries, everything else is reported with channel halted
+    hcintmsk = HCINT_CHH | HCINT_AHBERR;
+  } else {
+    hcintmsk = HCINT_CHH | HCINT_XFRC | HCINT_STALL | HCINT_NAK | HCINT_TXERR | HCINT_BBERR | HCINT_FRMOR |
+               HCINT_DTERR | HCINT_NYET | (edpt->hcsplt ? HCINT_ACK : 0);
+  }
+  channel->hcintmsk = hcintmsk;
+  dwc2->haintmsk |= TU_BIT(ch_id);
+
+  uint32_t hcchar = edpt->hcchar | HCCHAR_CHENA;
+  if (is_periodic && !(frame_current(dwc2) & 1)) {
+    // schedule in next (odd) frame
+    hcchar |= HCCHAR_ODDFRM;
+  }
+  channel->hcchar = hcchar;
+
+  // Slave mode: push OUT data, continue in TX FIFO empty interrupt if it does not fit
+  if (!dma_enabled(dwc2) && !is_in && !channel_write_packets(dwc2, ch_id)) {
+    dwc2->gintmsk |= is_periodic ? GINTMSK_PTXFEM : GINTMSK_NPTXFEM;
+  }
+}
+
+// Start pending transfers on free channels. Endpoints are looked up round-robin starting after the last one that
+// got a channel so that more endpoints than channels share them fairly. Periodic endpoints not yet due keep SOF
+// interrupt enabled to be re-scheduled at their (micro)frame.
+TU_ATTR_FAST_FUNC static void schedule_pending(dwc2_regs_t* dwc2) {
+  uint16_t const now = frame_current(dwc2);
+  bool wait_frame = false;
+
+  for (uint8_t i = 0; i < CFG_TUH_DWC2_ENDPOINT_MAX; i++) {
+    uint8_t const ep_id = (uint8_t) ((_hcd_data.rr_next + i) % CFG_TUH_DWC2_ENDPOINT_MAX);
+    hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+
+    if (edpt->state != EDPT_STATE_PENDING) continue;
+
+    if (edpt_is_periodic(edpt) && !frame_reached(now, edpt->next_frame)) {
+      wait_frame = true;
+      continue;
+    }
+
+    uint8_t const ch_id = channel_alloc();
+    if (ch_id == TUSB_INDEX_INVALID_8) {
+      // no free channel: continue when one is released
+      break;
+    }
+
+    _hcd_data.rr_next = (uint8_t) ((ep_id + 1) % CFG_TUH_DWC2_ENDPOINT_MAX);
+    _hcd_data.channel[ch_id].ep_id = ep_id;
+    edpt->state = EDPT_STATE_ACTIVE;
+    channel_xfer_start(dwc2, ch_id, false);
+  }
+
+  if (wait_frame) {
+    dwc2->gintmsk |= GINTMSK_SOFM;
+  } else {
+    dwc2->gintmsk &= ~GINTMSK_SOFM;
+  }
+}
+
+// Endpoint transfer is finished: free its channel, notify stack and start next pending transfer
+TU_ATTR_FAST_FUNC static void edpt_xfer_complete(dwc2_regs_t* dwc2, uint8_t ch_id, xfer_result_t result) {
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[_hcd_data.channel[ch_id].ep_id];
+  uint8_t const ep_addr = tu_edpt_addr(edpt_number(edpt), edpt_is_in(edpt) ? TUSB_DIR_IN : TUSB_DIR_OUT);
+
+  edpt->state = EDPT_STATE_IDLE;
+  if (edpt_is_periodic(edpt)) {
+    edpt->next_frame = (uint16_t) (frame_current(dwc2) + edpt->interval);
+  }
+
+  channel_release(dwc2, ch_id);
+  hcd_event_xfer_complete(edpt_daddr(edpt), ep_addr, edpt->xferred, result, true);
+  schedule_pending(dwc2);
+}
+
+// Transfer is not finished but cannot continue now (NAK): give the channel to next pending endpoint.
+// Periodic endpoint is retried at its next interval.
+TU_ATTR_FAST_FUNC static void edpt_xfer_requeue(dwc2_regs_t* dwc2, uint8_t ch_id) {
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[_hcd_data.channel[ch_id].ep_id];
+
+  edpt->state = EDPT_STATE_PENDING;
+  if (edpt_is_periodic(edpt)) {
+    edpt->next_frame = (uint16_t) (frame_current(dwc2) + edpt->interval);
+  }
+
+  channel_release(dwc2, ch_id);
+  schedule_pending(dwc2);
+}
+
+//--------------------------------------------------------------------+
+// Controller API
+//--------------------------------------------------------------------+
+
+static bool check_dwc2(dwc2_regs_t* dwc2) {
+  // For some reasons: GD32VF103 snpsid and all hwcfg register are always zero (skip it)
+  (void) dwc2;
+#if !TU_CHECK_MCU(OPT_MCU_GD32VF103)
+  uint32_t const gsnpsid = dwc2->gsnpsid & GSNPSID_ID_MASK;
+  TU_ASSERT(gsnpsid == DWC2_OTG_ID || gsnpsid == DWC2_FS_IOT_ID || gsnpsid == DWC2_HS_IOT_ID);
+#endif
+
+  return true;
+}
+
+static void reset_core(dwc2_regs_t* dwc2) {
+  // reset core
+  dwc2->grstctl |= GRSTCTL_CSRST;
+
+  // wait for reset bit is cleared
+  while (dwc2->grstctl & GRSTCTL_CSRST) {}
+
+  // wait for AHB master IDLE
+  while (!(dwc2->grstctl & GRSTCTL_AHBIDL)) {}
+}
+
+static bool phy_hs_supported(dwc2_regs_t* dwc2) {
+  (void) dwc2;
+
+#if TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)
+  // note: esp32 incorrect report its hs_phy_type as utmi
+  return false;
+#elif !TUH_OPT_HIGH_SPEED
+  return false;
+#else
+  return dwc2->ghwcfg2_bm.hs_phy_type != HS_PHY_TYPE_NONE;
+#endif
+}
+
+static void phy_fs_init(dwc2_regs_t* dwc2) {
+  TU_LOG(DWC2_DEBUG, "Fullspeed PHY init\r\n");
+
+  // Select FS PHY
+  dwc2->gusbcfg |= GUSBCFG_PHYSEL;
+
+  // MCU specific PHY init before reset
+  dwc2_phy_init(dwc2, HS_PHY_TYPE_NONE);
+
+  // Reset core after selecting PHY
+  reset_core(dwc2);
+
+  // USB turnaround time, default is 5
+  dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_TRDT_Msk) | (5u << GUSBCFG_TRDT_Pos);
+
+  // MCU specific PHY update post reset
+  dwc2_phy_update(dwc2, HS_PHY_TYPE_NONE);
+
+  // FS/LS only, PHY clock is 48 MHz (adjusted to 6 MHz when a low speed device is attached)
+  dwc2->hcfg = (dwc2->hcfg & ~HCFG_FSLSPCS_Msk) | HCFG_FSLSS | (HCFG_FSLSPCS_48MHZ << HCFG_FSLSPCS_Pos);
+}
+
+static void phy_hs_init(dwc2_regs_t* dwc2) {
+  uint32_t gusbcfg = dwc2->gusbcfg;
+
+  // De-select FS PHY
+  gusbcfg &= ~GUSBCFG_PHYSEL;
+
+  if (dwc2->ghwcfg2_bm.hs_phy_type == HS_PHY_TYPE_ULPI) {
+    TU_LOG(DWC2_DEBUG, "Highspeed ULPI PHY init\r\n");
+
+    // Select ULPI, 8-bit interface, single data rate
+    gusbcfg |= GUSBCFG_ULPI_UTMI_SEL;
+    gusbcfg &= ~(GUSBCFG_PHYIF16 | GUSBCFG_DDRSEL);
+
+    // default internal VBUS Indicator and Drive
+    gusbcfg &= ~(GUSBCFG_ULPIEVBUSD | GUSBCFG_ULPIEVBUSI);
+
+    // Disable FS/LS ULPI
+    gusbcfg &= ~(GUSBCFG_ULPIFSLS | GUSBCFG_ULPICSM);
+  } else {
+    TU_LOG(DWC2_DEBUG, "Highspeed UTMI+ PHY init\r\n");
+
+    // Select UTMI+ with 8-bit interface, 16-bit if supported
+    gusbcfg &= ~(GUSBCFG_ULPI_UTMI_SEL | GUSBCFG_PHYIF16);
+    if (dwc2->ghwcfg4_bm.utmi_phy_data_width) gusbcfg |= GUSBCFG_PHYIF16;
+  }
+
+  dwc2->gusbcfg = gusbcfg;
+
+  // mcu specific phy init
+  dwc2_phy_init(dwc2, dwc2->ghwcfg2_bm.hs_phy_type);
+
+  // Reset core after selecting PHY
+  reset_core(dwc2);
+
+  // Set turn-around, must after core reset otherwise it will be clear
+  gusbcfg &= ~GUSBCFG_TRDT_Msk;
+  gusbcfg |= (dwc2->ghwcfg4_bm.utmi_phy_data_width ? 5u : 9u) << GUSBCFG_TRDT_Pos;
+  dwc2->gusbcfg = gusbcfg;
+
+  // MCU specific PHY update post reset
+  dwc2_phy_update(dwc2, dwc2->ghwcfg2_bm.hs_phy_type);
+
+  // HS capable, PHY clock is 30/60 MHz
+  dwc2->hcfg &= ~(HCFG_FSLSS | HCFG_FSLSPCS_Msk);
+}
+
+// Host FIFO RAM partition (in 32-bit words), fixed for the whole session:
+//
+// --------------- top (in DMA mode, core keeps channel DMA addresses above)
+// | Periodic TX | 1/4
+// ---------------
+// | Non-Per TX  | 1/4 : holds 2 bulk packets at HS
+// ---------------
+// | RX FIFO     | 1/2 : shared by all IN channels
+// --------------- 0
+static void fifo_init(dwc2_regs_t* dwc2, uint16_t top) {
+  uint16_t const rx_words = top / 2;
+  uint16_t const nptx_words = top / 4;
+  uint16_t const ptx_words = top - rx_words - nptx_words;
+
+  dwc2->grxfsiz = rx_words;
+  dwc2->gnptxfsiz = ((uint32_t) nptx_words << DIEPTXF0_TX0FD_Pos) | rx_words;
+  dwc2->hptxfsiz = ((uint32_t) ptx_words << HPTXFSIZ_PTXFD_Pos) | (uint32_t) (rx_words + nptx_words);
+
+  fifo_flush_tx(dwc2, 0x10); // all tx fifo
+  fifo_flush_rx(dwc2);
+}
+
+bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void* cfg_param) {
+  (void) rhport;
+  (void) cfg_id;
+  (void) cfg_param;
+
+  return false;
+}
+
+bool hcd_init(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // Check Synopsys ID register, failed if controller clock/power is not enabled
+  TU_ASSERT(check_dwc2(dwc2));
+
+  tu_memclr(&_hcd_data, sizeof(_hcd_data));
+  for (uint8_t ch_id = 0; ch_id < DWC2_CHANNEL_COUNT_MAX; ch_id++) {
+    _hcd_data.channel[ch_id].ep_id = TUSB_INDEX_INVALID_8;
+  }
+
+  // disable global interrupt while configuring
+  dwc2->gahbcfg &= ~GAHBCFG_GINT;
+
+  if (phy_hs_supported(dwc2)) {
+    phy_hs_init(dwc2); // Highspeed
+  } else {
+    phy_fs_init(dwc2); // core does not support highspeed or hs phy is not present
+    _hcd_data.fs_phy = true;
+  }
+
+  // Restart PHY clock
+  dwc2->pcgctl &= ~(PCGCTL_STOPPCLK | PCGCTL_GATEHCLK | PCGCTL_PWRCLMP | PCGCTL_RSTPDWNMODULE);
+
+  // Set HS/FS Timeout Calibration to 7 (max available value), see dcd_init()
+  dwc2->gusbcfg |= (7ul << GUSBCFG_TOCAL_Pos);
+
+  // Force host mode and wait for core to switch (can take up to 25 ms)
+  dwc2->gusbcfg = (dwc2->gusbcfg & ~GUSBCFG_FDMOD) | GUSBCFG_FHMOD;
+  while ((dwc2->gintsts & GINTSTS_CMOD) == 0) {}
+
+  // Clear B override, force A-device session and VBUS valid
+  dwc2->gotgctl = (dwc2->gotgctl & ~(GOTGCTL_BVALOEN | GOTGCTL_BVALOVAL)) |
+                  GOTGCTL_AVALOEN | GOTGCTL_AVALOVAL | GOTGCTL_VBVALOEN | GOTGCTL_VBVALOVAL;
+
+#if TU_CHECK_MCU(OPT_MCU_GD32VF103)
+  _hcd_data.channel_count = 8;
+#else
+  _hcd_data.channel_count = dwc2->ghwcfg2_bm.num_host_ch + 1;
+#endif
+  _hcd_data.channel_count = tu_min8(_hcd_data.channel_count, DWC2_CHANNEL_COUNT_MAX);
+
+  // In buffer DMA mode, core uses one FIFO RAM word per channel to hold its DMA address
+  uint16_t dfifo_top = _dwc2_controller[rhport].ep_fifo_size / 4;
+  if (dma_enabled(dwc2)) {
+    dfifo_top -= _hcd_data.channel_count;
+    dwc2->gdfifocfg = ((uint32_t) dfifo_top << GDFIFOCFG_EPINFOBASE_Pos) | dfifo_top;
+  }
+  fifo_init(dwc2, dfifo_top);
+
+  // Halt state for all channels
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    dwc2->channel[ch_id].hcintmsk = 0;
+    dwc2->channel[ch_id].hcint = 0xFFFFFFFFu;
+  }
+  dwc2->haintmsk = 0;
+
+  // Clear all interrupts
+  uint32_t int_mask = dwc2->gintsts;
+  dwc2->gintsts |= int_mask;
+  int_mask = dwc2->gotgint;
+  dwc2->gotgint |= int_mask;
+
+  dwc2->gintmsk = GINTMSK_OTGINT | GINTMSK_PRTIM | GINTMSK_HCIM | GINTMSK_DISCINT | GINTMSK_WUIM;
+
+  if (dma_enabled(dwc2)) {
+    // Buffer DMA: core moves data between FIFO and transfer buffers, RX FIFO level interrupt is not used
+    TU_LOG(DWC2_DEBUG, "Buffer DMA mode\r\n");
+    dwc2->gahbcfg = (dwc2->gahbcfg & ~GAHBCFG_HBSTLEN_Msk) | GAHBCFG_DMAEN | GAHBCFG_HBSTLEN_2;
+  } else {
+    // TX FIFO empty interrupts are raised when FIFO is half empty (default), 2 packets fit in non-periodic FIFO
+    dwc2->gahbcfg &= ~(GAHBCFG_TXFELVL | GAHBCFG_PTXFELVL);
+    dwc2->gintmsk |= GINTMSK_RXFLVLM;
+  }
+
+  // Power up the port
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PPWR;
+
+  // Enable global interrupt
+  dwc2->gahbcfg |= GAHBCFG_GINT;
+
+  return true;
+}
+
+bool hcd_deinit(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  dwc2->gahbcfg &= ~GAHBCFG_GINT;
+  dwc2->gintmsk = 0;
+  dwc2->haintmsk = 0;
+
+  // Power down the port
+  dwc2->hprt = dwc2->hprt & ~(HPRT_W1C_MASK | HPRT_PPWR);
+
+  return true;
+}
+
+void hcd_int_enable(uint8_t rhport) {
+  dwc2_hcd_int_enable(rhport);
+}
+
+void hcd_int_disable(uint8_t rhport) {
+  dwc2_hcd_int_disable(rhport);
+}
+
+uint32_t hcd_frame_number(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // extend 14-bit hardware (micro)frame number to 32-bit
+  uint16_t const frnum = frame_current(dwc2);
+  _hcd_data.frame_count += (uint16_t) (frnum - _hcd_data.frame_last) & HFNUM_FRAME_MASK;
+  _hcd_data.frame_last = frnum;
+
+  return _hcd_data.root_hs ? (_hcd_data.frame_count >> 3) : _hcd_data.frame_count;
+}
+
+//--------------------------------------------------------------------+
+// Port API
+//--------------------------------------------------------------------+
+
+bool hcd_port_connect_status(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  return (dwc2->hprt & HPRT_PCSTS) != 0;
+}
+
+void hcd_port_reset(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PRST;
+}
+
+void hcd_port_reset_end(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = dwc2->hprt & ~(HPRT_W1C_MASK | HPRT_PRST);
+}
+
+bool hcd_port_suspend(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  TU_VERIFY(dwc2->hprt & HPRT_PENA);
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PSUSP;
+  return true;
+}
+
+void hcd_port_resume(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = (dwc2->hprt & ~HPRT_W1C_MASK) | HPRT_PRES;
+}
+
+void hcd_port_resume_end(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  dwc2->hprt = dwc2->hprt & ~(HPRT_W1C_MASK | HPRT_PRES);
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const speed = (dwc2->hprt & HPRT_PSPD_Msk) >> HPRT_PSPD_Pos;
+
+  switch (speed) {
+    case HPRT_SPEED_HIGH: return TUSB_SPEED_HIGH;
+    case HPRT_SPEED_LOW : return TUSB_SPEED_LOW;
+    default             : return TUSB_SPEED_FULL;
+  }
+}
+
+// Close all opened endpoint belong to this device
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  core_int_lock(dwc2);
+  for (uint8_t ep_id = 0; ep_id < CFG_TUH_DWC2_ENDPOINT_MAX; ep_id++) {
+    hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+    if (!edpt->allocated || edpt_daddr(edpt) != dev_addr) continue;
+
+    uint8_t const ch_id = channel_find(ep_id);
+    if (ch_id != TUSB_INDEX_INVALID_8) {
+      // channel is released when halted
+      hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+      ch->ep_id = TUSB_INDEX_INVALID_8;
+      ch->closing = 1;
+      channel_disable(dwc2, ch_id);
+    }
+
+    tu_memclr(edpt, sizeof(hcd_endpoint_t));
+  }
+  core_int_unlock(dwc2);
+}
+
+//--------------------------------------------------------------------+
+// Endpoints API
+//--------------------------------------------------------------------+
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const* desc_ep) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  hcd_devtree_info_t devtree;
+  hcd_devtree_get_info(dev_addr, &devtree);
+
+  // control endpoint of address 0 is re-opened for each enumeration
+  uint8_t ep_id = edpt_find(dev_addr, desc_ep->bEndpointAddress);
+  if (ep_id == TUSB_INDEX_INVALID_8) {
+    ep_id = edpt_alloc();
+  }
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+  uint8_t const xfer_type = desc_ep->bmAttributes.xfer;
+  uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+  uint8_t const dir = tu_edpt_dir(desc_ep->bEndpointAddress);
+  uint16_t const packet_size = tu_edpt_packet_size(desc_ep);
+  bool const is_periodic = (xfer_type == TUSB_XFER_INTERRUPT) || (xfer_type == TUSB_XFER_ISOCHRONOUS);
+
+  // high-bandwidth periodic endpoint: up to 3 transactions per microframe
+  uint8_t mult = 1;
+  if (devtree.speed == TUSB_SPEED_HIGH && is_periodic) {
+    mult = (uint8_t) (((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x03) + 1);
+  }
+
+  tu_memclr(edpt, sizeof(hcd_endpoint_t));
+  edpt->hcchar = ((uint32_t) packet_size << HCCHAR_MPSIZ_Pos) | ((uint32_t) epnum << HCCHAR_EPNUM_Pos) |
+                 (dir == TUSB_DIR_IN ? HCCHAR_EPDIR : 0) |
+                 (devtree.speed == TUSB_SPEED_LOW ? HCCHAR_LSDEV : 0) |
+                 ((uint32_t) xfer_type << HCCHAR_EPTYP_Pos) | ((uint32_t) mult << HCCHAR_MC_Pos) |
+                 ((uint32_t) dev_addr << HCCHAR_DAD_Pos);
+
+  // FS/LS device behind HS hub: split transaction to hub's transaction translator
+  if (_hcd_data.root_hs && devtree.speed != TUSB_SPEED_HIGH && devtree.hub_addr) {
+    edpt->hcsplt = HCSPLT_SPLITEN | ((uint32_t) devtree.hub_port << HCSPLT_PRTADDR_Pos) |
+                   ((uint32_t) devtree.hub_addr << HCSPLT_HUBADDR_Pos) | (3u << HCSPLT_XACTPOS_Pos);
+  }
+
+  // Periodic interval in (micro)frames of root port
+  if (is_periodic) {
+    uint8_t const binterval = tu_max8(desc_ep->bInterval, 1);
+    uint32_t interval;
+    if (devtree.speed == TUSB_SPEED_HIGH || xfer_type == TUSB_XFER_ISOCHRONOUS) {
+      // 2^(bInterval-1) in (micro)frames of device's speed
+      interval = 1ul << (tu_min8(binterval, 13) - 1);
+    } else {
+      // FS/LS interrupt: bInterval in frames
+      interval = binterval;
+    }
+
+    // FS/LS device on HS root port: frame is 8 microframes
+    if (_hcd_data.root_hs && devtree.speed != TUSB_SPEED_HIGH) {
+      interval *= 8;
+    }
+
+    edpt->interval = (uint16_t) tu_min32(interval, (HFNUM_FRAME_MASK + 1) / 4);
+    edpt->next_frame = frame_current(dwc2);
+  }
+
+  edpt->next_pid = HCTSIZ_PID_DATA0;
+  edpt->state = EDPT_STATE_IDLE;
+  edpt->allocated = 1;
+
+  return true;
+}
+
+// Submit a transfer, when complete hcd_event_xfer_complete() must be invoked
+TU_ATTR_FAST_FUNC bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t* buffer, uint16_t buflen) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+  TU_ASSERT(edpt->state == EDPT_STATE_IDLE);
+
+  // DMA buffer must be word aligned
+  if (dma_enabled(dwc2)) {
+    TU_ASSERT(buflen == 0 || (((uintptr_t) buffer) & 0x03) == 0);
+  }
+
+  core_int_lock(dwc2);
+
+  if (tu_edpt_number(ep_addr) == 0) {
+    // control data/status stage: direction follows ep_addr, always start with DATA1
+    edpt->hcchar = (edpt->hcchar & ~HCCHAR_EPDIR) | (tu_edpt_dir(ep_addr) == TUSB_DIR_IN ? HCCHAR_EPDIR : 0);
+    edpt->next_pid = HCTSIZ_PID_DATA1;
+  }
+
+  if (edpt_is_periodic(edpt)) {
+    // endpoint has been idle for long: due now
+    uint16_t const wait = (uint16_t) (edpt->next_frame - frame_current(dwc2)) & HFNUM_FRAME_MASK;
+    if (wait > edpt->interval) {
+      edpt->next_frame = frame_current(dwc2);
+    }
+  }
+
+  edpt->buffer = buffer;
+  edpt->buflen = buflen;
+  edpt->xferred = 0;
+  edpt->err_count = 0;
+  edpt->state = EDPT_STATE_PENDING;
+
+  schedule_pending(dwc2);
+  core_int_unlock(dwc2);
+
+  return true;
+}
+
+// Abort a queued transfer. A transfer running on a channel is stopped, its channel is released when halted.
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_VERIFY(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+
+  core_int_lock(dwc2);
+  bool const aborted = (edpt->state != EDPT_STATE_IDLE);
+  if (edpt->state == EDPT_STATE_ACTIVE) {
+    uint8_t const ch_id = channel_find(ep_id);
+    if (ch_id != TUSB_INDEX_INVALID_8) {
+      hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+      edpt->next_pid = (uint8_t) ((dwc2->channel[ch_id].hctsiz & HCTSIZ_DPID_Msk) >> HCTSIZ_DPID_Pos);
+      ch->ep_id = TUSB_INDEX_INVALID_8;
+      ch->closing = 1;
+      channel_disable(dwc2, ch_id);
+    }
+  }
+  edpt->state = EDPT_STATE_IDLE;
+  core_int_unlock(dwc2);
+
+  return aborted;
+}
+
+// Submit a special transfer to send 8-byte Setup Packet, when complete hcd_event_xfer_complete() must be invoked
+bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet[8]) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  uint8_t const ep_id = edpt_find(dev_addr, 0);
+  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
+  TU_ASSERT(edpt->state == EDPT_STATE_IDLE);
+
+  memcpy(_setup_packet, setup_packet, 8);
+
+  core_int_lock(dwc2);
+  edpt->hcchar &= ~HCCHAR_EPDIR;
+  edpt->next_pid = HCTSIZ_PID_SETUP;
+  edpt->buffer = _setup_packet;
+  edpt->buflen = 8;
+  edpt->xferred = 0;
+  edpt->err_count = 0;
+  edpt->state = EDPT_STATE_PENDING;
+
+  schedule_pending(dwc2);
+  core_int_unlock(dwc2);
+
+  return true;
+}
+
+// clear stall, data toggle is also reset to DATA0
+bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+
+  uint8_t const ep_id = edpt_find(dev_addr, ep_addr);
+  TU_VERIFY(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  _hcd_data.edpt[ep_id].next_pid = HCTSIZ_PID_DATA0;
+
+  return true;
+}
+
+//--------------------------------------------------------------------
+// HCD Event Handler
+//--------------------------------------------------------------------
+
+// Slave mode: read a packet from RX FIFO into IN channel buffer. Data beyond the buffer is discarded.
+TU_ATTR_FAST_FUNC static void handle_rxflvl_irq(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  volatile uint32_t const* rx_fifo = dwc2->fifo[0];
+
+  uint32_t const grxstsp = dwc2->grxstsp;
+  uint8_t const ch_id = (uint8_t) (grxstsp & GRXSTSP_EPNUM_Msk);
+  uint8_t const pktsts = (uint8_t) ((grxstsp & GRXSTSP_PKTSTS_Msk) >> GRXSTSP_PKTSTS_Pos);
+  uint16_t const byte_count = (uint16_t) ((grxstsp & GRXSTSP_BCNT_Msk) >> GRXSTSP_BCNT_Pos);
+
+  if (pktsts != GRXSTS_PKTSTS_HCHIN || byte_count == 0) {
+    // transfer completed, data toggle error and channel halted are handled by channel interrupt
+    return;
+  }
+
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  uint8_t* dst = NULL;
+  uint16_t len = 0;
+  if (ch->ep_id != TUSB_INDEX_INVALID_8) {
+    hcd_endpoint_t const* edpt = &_hcd_data.edpt[ch->ep_id];
+    uint32_t const offset = edpt->xferred + ch->fifo_bytes;
+    dst = edpt->buffer + offset;
+    len = (uint16_t) tu_min32(byte_count, (offset < edpt->buflen) ? (edpt->buflen - offset) : 0);
+  }
+  ch->fifo_bytes += byte_count;
+
+  // Reading full available 32 bit words from fifo
+  uint16_t i = 0;
+  for (; i + 4 <= len; i += 4) {
+    tu_unaligned_write32(dst + i, *rx_fifo);
+  }
+
+  // Remaining bytes, anything beyond buffer is dropped
+  for (; i < byte_count; i += 4) {
+    uint32_t const tmp = *rx_fifo;
+    for (uint16_t b = i; b < len && b < i + 4; b++) {
+      dst[b] = (uint8_t) (tmp >> (8 * (b - i)));
+    }
+  }
+
+  // Re-activate channel to receive next packet
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+  if ((channel->hctsiz & HCTSIZ_PKTCNT_Msk) && !ch->halting) {
+    channel->hcchar = (channel->hcchar & ~HCCHAR_CHDIS) | HCCHAR_CHENA;
+  }
+}
+
+// Slave mode: TX FIFO has room, continue writing OUT channels of this queue
+TU_ATTR_FAST_FUNC static void handle_txfifo_empty(dwc2_regs_t* dwc2, bool is_periodic) {
+  bool all_written = true;
+
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    hcd_channel_t const* ch = &_hcd_data.channel[ch_id];
+    if (ch->ep_id == TUSB_INDEX_INVALID_8 || ch->halting || ch->fifo_bytes >= ch->xfer_len) continue;
+
+    hcd_endpoint_t const* edpt = &_hcd_data.edpt[ch->ep_id];
+    if (edpt_is_in(edpt) || edpt_is_periodic(edpt) != is_periodic) continue;
+
+    if (!channel_write_packets(dwc2, ch_id)) {
+      all_written = false;
+    }
+  }
+
+  if (all_written) {
+    dwc2->gintmsk &= ~(is_periodic ? GINTMSK_PTXFEM : GINTMSK_NPTXFEM);
+  }
+}
+
+// Channel is halted: decide transfer result, retry, or continue with remaining data
+TU_ATTR_FAST_FUNC static void channel_halted(dwc2_regs_t* dwc2, uint8_t ch_id, uint32_t hcint) {
+  hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+  dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+  if (ch->closing || ch->ep_id == TUSB_INDEX_INVALID_8) {
+    channel_release(dwc2, ch_id);
+    schedule_pending(dwc2);
+    return;
+  }
+
+  hcd_endpoint_t* edpt = &_hcd_data.edpt[ch->ep_id];
+  bool const is_in = edpt_is_in(edpt);
+  bool const is_split = (edpt->hcsplt != 0);
+  bool const is_csplit = (channel->hcsplt & HCSPLT_COMPLSPLT) != 0;
+  uint32_t const hctsiz = channel->hctsiz;
+  uint16_t const packet_size = edpt_packet_size(edpt);
+
+  // data toggle is only advanced by the core on successful transaction
+  edpt->next_pid = (uint8_t) ((hctsiz & HCTSIZ_DPID_Msk) >> HCTSIZ_DPID_Pos);
+
+  // bytes transferred in this channel run
+  uint32_t run_bytes;
+  if (is_split) {
+    // a split packet is only done with complete split
+    run_bytes = (hcint & HCINT_XFRC) ? (is_in ? ch->xfer_len - (hctsiz & HCTSIZ_XFRSIZ_Msk) : ch->xfer_len) : 0;
+  } else if (is_in) {
+    run_bytes = ch->xfer_len - (hctsiz & HCTSIZ_XFRSIZ_Msk);
+  } else {
+    uint16_t const pkt_done = ch->pkt_count - (uint16_t) ((hctsiz & HCTSIZ_PKTCNT_Msk) >> HCTSIZ_PKTCNT_Pos);
+    run_bytes = tu_min32(ch->xfer_len, (uint32_t) pkt_done * packet_size);
+  }
+
+  uint8_t* run_buf = edpt->buffer + edpt->xferred;
+  run_bytes = tu_min32(run_bytes, edpt->buflen - edpt->xferred);
+  edpt->xferred += (uint16_t) run_bytes;
+  #if !CFG_TUH_MEM_DCACHE_ENABLE // otherwise done by usbh on completion
+  if (dma_enabled(dwc2) && is_in && run_bytes) {
+    dcache_invalidate(run_buf, run_bytes);
+  }
+  #endif
+  (void) run_buf;
+
+  if (hcint & (HCINT_AHBERR | HCINT_BBERR)) {
+    edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_FAILED);
+  } else if (hcint & HCINT_STALL) {
+    edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_STALLED);
+  } else if (hcint & HCINT_XFRC) {
+    edpt->err_count = 0;
+    if (is_split && run_bytes == packet_size && edpt->xferred < edpt->buflen) {
+      // split moves one packet at a time, proceed with next one
+      channel_xfer_start(dwc2, ch_id, false);
+    } else {
+      edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_SUCCESS);
+    }
+  } else if (hcint & HCINT_NYET) {
+    edpt->err_count = 0;
+    if (is_csplit) {
+      // hub has not finished the transaction yet, poll it again. Periodic gives up after few attempts and starts
+      // over with start split at next interval
+      if (edpt_is_periodic(edpt) && ++ch->split_nyet >= HCD_SPLIT_NYET_MAX) {
+        edpt_xfer_requeue(dwc2, ch_id);
+      } else {
+        channel_xfer_start(dwc2, ch_id, true);
+      }
+    } else if (edpt->xferred < edpt->buflen) {
+      // HS OUT: packet is accepted but device has no room for next one yet
+      channel_xfer_start(dwc2, ch_id, false);
+    } else {
+      edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_SUCCESS);
+    }
+  } else if (is_split && !is_csplit && (hcint & HCINT_ACK)) {
+    // start split is accepted by hub, issue complete split
+    channel_xfer_start(dwc2, ch_id, true);
+  } else if (hcint & HCINT_NAK) {
+    edpt->err_count = 0;
+    edpt_xfer_requeue(dwc2, ch_id);
+  } else if (hcint & (HCINT_TXERR | HCINT_DTERR | HCINT_FRMOR)) {
+    if (++edpt->err_count >= HCD_XFER_ERROR_MAX) {
+      edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_FAILED);
+    } else if (edpt_is_periodic(edpt)) {
+      edpt_xfer_requeue(dwc2, ch_id);
+    } else {
+      channel_xfer_start(dwc2, ch_id, false);
+    }
+  } else {
+    // halted without error e.g slave mode IN with all packets received: continue with remaining data if any
+    if (!is_split && !is_in && edpt->xferred >= edpt->buflen) {
+      edpt_xfer_complete(dwc2, ch_id, XFER_RESULT_SUCCESS);
+    } else {
+      channel_xfer_start(dwc2, ch_id, is_csplit);
+    }
+  }
+}
+
+TU_ATTR_FAST_FUNC static void handle_channel_irq(uint8_t rhport) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const haint = dwc2->haint;
+
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    if (!(haint & TU_BIT(ch_id))) continue;
+
+    hcd_channel_t* ch = &_hcd_data.channel[ch_id];
+    dwc2_channel_t* channel = &dwc2->channel[ch_id];
+
+    uint32_t const hcint = channel->hcint;
+    channel->hcint = hcint; // clear
+    ch->hcint |= hcint;
+
+    if (hcint & HCINT_CHH) {
+      uint32_t const cause = ch->hcint;
+      ch->hcint = 0;
+      ch->halting = 0;
+      channel_halted(dwc2, ch_id, cause);
+    } else if (hcint & HCINT_AHBERR) {
+      channel_disable(dwc2, ch_id);
+    } else if (!dma_enabled(dwc2) && !ch->halting && (hcint & channel->hcintmsk)) {
+      // Slave mode: stop channel on any event, transfer continues when it is halted
+      channel_disable(dwc2, ch_id);
+    }
+  }
+}
+
+static void handle_hprt_irq(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const hprt = dwc2->hprt;
+  uint32_t hprt_w1c = 0;
+
+  if (hprt & HPRT_PCDET) {
+    hprt_w1c |= HPRT_PCDET;
+    if (hprt & HPRT_PCSTS) {
+      hcd_event_device_attach(rhport, in_isr);
+    }
+  }
+
+  if (hprt & HPRT_PENCHNG) {
+    hprt_w1c |= HPRT_PENCHNG;
+
+    if (hprt & HPRT_PENA) {
+      uint32_t const speed = (hprt & HPRT_PSPD_Msk) >> HPRT_PSPD_Pos;
+      _hcd_data.root_hs = (speed == HPRT_SPEED_HIGH);
+
+      // FS PHY: PHY clock and frame interval must match attached device speed
+      if (_hcd_data.fs_phy) {
+        bool const is_ls = (speed == HPRT_SPEED_LOW);
+        uint32_t const fslspcs = is_ls ? HCFG_FSLSPCS_6MHZ : HCFG_FSLSPCS_48MHZ;
+        dwc2->hcfg = (dwc2->hcfg & ~HCFG_FSLSPCS_Msk) | (fslspcs << HCFG_FSLSPCS_Pos);
+        dwc2->hfir = is_ls ? 6000u : 48000u;
+      }
+    }
+  }
+
+  if (hprt & HPRT_POCCHNG) {
+    hprt_w1c |= HPRT_POCCHNG;
+    TU_LOG(DWC2_DEBUG, "Port over-current %s\r\n", (hprt & HPRT_POCA) ? "active" : "cleared");
+  }
+
+  // write back keeping other bits, PENA must not be written 1 (it would disable the port)
+  dwc2->hprt = (hprt & ~HPRT_W1C_MASK) | hprt_w1c;
+}
+
+static void handle_disconnect(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+
+  // channels are halted by the core, release them all. usbh closes devices which frees endpoints
+  for (uint8_t ch_id = 0; ch_id < _hcd_data.channel_count; ch_id++) {
+    dwc2->channel[ch_id].hcint = 0xFFFFFFFFu;
+    channel_release(dwc2, ch_id);
+  }
+
+  for (uint8_t ep_id = 0; ep_id < CFG_TUH_DWC2_ENDPOINT_MAX; ep_id++) {
+    _hcd_data.edpt[ep_id].state = EDPT_STATE_IDLE;
+  }
+
+  dwc2->gintmsk &= ~(GINTMSK_SOFM | GINTMSK_NPTXFEM | GINTMSK_PTXFEM);
+  fifo_flush_tx(dwc2, 0x10);
+  fifo_flush_rx(dwc2);
+
+  hcd_event_device_remove(rhport, in_isr);
+}
+
+TU_ATTR_FAST_FUNC void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  uint32_t const int_status = dwc2->gintsts & dwc2->gintmsk;
+
+  if (int_status & GINTSTS_DISCINT) {
+    dwc2->gintsts = GINTSTS_DISCINT;
+    handle_disconnect(rhport, in_isr);
+  }
+
+  if (int_status & GINTSTS_HPRTINT) {
+    // port interrupt is cleared by clearing its source in HPRT
+    handle_hprt_irq(rhport, in_isr);
+  }
+
+  if (int_status & GINTSTS_WKUINT) {
+    // remote wakeup on suspended port, usbh drives resume signaling
+    dwc2->gintsts = GINTSTS_WKUINT;
+    hcd_event_device_resume(rhport, in_isr);
+  }
+
+  // RX FIFO before channel interrupts: IN data must be read before its transfer complete is processed
+  if (int_status & GINTSTS_RXFLVL) {
+    // RXFLVL bit is read-only, mask it while reading FIFO
+    dwc2->gintmsk &= ~GINTMSK_RXFLVLM;
+    do {
+      handle_rxflvl_irq(rhport);
+    } while (dwc2->gintsts & GINTSTS_RXFLVL);
+    dwc2->gintmsk |= GINTMSK_RXFLVLM;
+  }
+
+  if (int_status & GINTSTS_NPTXFE) {
+    handle_txfifo_empty(dwc2, false);
+  }
+
+  if (int_status & GINTSTS_PTXFE) {
+    handle_txfifo_empty(dwc2, true);
+  }
+
+  if (int_status & GINTSTS_HCINT) {
+    handle_channel_irq(rhport);
+  }
+
+  if (int_status & GINTSTS_SOF) {
+    // periodic endpoints waiting for their interval
+    dwc2->gintsts = GINTSTS_SOF;
+    schedule_pending(dwc2);
+  }
+
+  if (int_status & GINTSTS_OTGINT) {
+    uint32_t const otg_int = dwc2->gotgint;
+    dwc2->gotgint = otg_int;
+  }
+}
+
+#endif
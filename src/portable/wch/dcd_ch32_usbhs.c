@@ -161,6 +161,7 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const *desc_edpt) {
 
     if (epnum != 0) {
         if (tu_edpt_dir(desc_edpt->bEndpointAddress) == TUSB_DIR_OUT) {
+            EP_RX_MAX_LEN(epnum) = xfer->max_size;
             EP_RX_CTRL(epnum) = USBHS_EP_R_AUTOTOG | USBHS_EP_R_RES_ACK;
         } else {
             EP_TX_LEN(epnum) = 0;
@@ -232,6 +233,25 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
     xfer->queued_len = 0;
     xfer->short_packet = false;
 
+    if (epnum != 0) {
+        // Packets are moved by DMA straight from/to the transfer buffer, the ISR only
+        // advances the DMA address for the next packet (see edpt_n_next_packet()).
+        if (dir == TUSB_DIR_IN) {
+            uint16_t const len = tu_min16(total_bytes, xfer->max_size);
+            xfer->queued_len = len;
+
+            EP_TX_DMA_ADDR(epnum) = (uint32_t)buffer;
+            USBHSD->ENDP_CONFIG |= (USBHS_EP0_T_EN << epnum);
+            EP_TX_LEN(epnum) = len;
+            EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
+        } else {
+            EP_RX_DMA_ADDR(epnum) = (uint32_t)buffer;
+            USBHSD->ENDP_CONFIG |= (USBHS_EP0_R_EN << epnum);
+            EP_RX_CTRL(epnum) = (EP_RX_CTRL(epnum) & ~(USBHS_EP_R_RES_MASK)) | USBHS_EP_R_RES_ACK;
+        }
+        return true;
+    }
+
     // uint16_t num_packets = (total_bytes / xfer->max_size);
     uint16_t short_packet_size = total_bytes % (xfer->max_size + 1);
 
@@ -243,45 +263,26 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
     if (tu_edpt_dir(ep_addr) == TUSB_DIR_IN) {
         if (!total_bytes) {
             xfer->short_packet = true;
-            if (epnum == 0) {
-                USBHSD->UEP0_TX_LEN = 0;
-                USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
-                USBHS_Dev_Endp0_Tog ^= 1;
-            } else {
-                EP_TX_LEN(epnum) = 0;
-                EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
-            }
+            USBHSD->UEP0_TX_LEN = 0;
+            USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
+            USBHS_Dev_Endp0_Tog ^= 1;
         } else {
-            if (epnum == 0) {
-                xfer->queued_len += short_packet_size;
-                memcpy(&EP0_DatabufHD[0], buffer, short_packet_size);
-
-                USBHSD->UEP0_TX_LEN = short_packet_size;
-                USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
-                USBHS_Dev_Endp0_Tog ^= 1;
-            } else {
-                xfer->queued_len += short_packet_size;
+            xfer->queued_len += short_packet_size;
+            memcpy(&EP0_DatabufHD[0], buffer, short_packet_size);
 
-                EP_TX_DMA_ADDR(epnum) = (uint32_t)buffer;
-                USBHSD->ENDP_CONFIG |= (USBHS_EP0_T_EN << epnum);
-                EP_TX_LEN(epnum) = short_packet_size;
-                EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_ACK;
-            }
+            USBHSD->UEP0_TX_LEN = short_packet_size;
+            USBHSD->UEP0_TX_CTRL = USBHS_EP_T_RES_ACK | (USBHS_Dev_Endp0_Tog ? USBHS_EP_T_TOG_1 : USBHS_EP_T_TOG_0);
+            USBHS_Dev_Endp0_Tog ^= 1;
         }
     } else { /* TUSB_DIR_OUT */
-        if (epnum == 0) {
-            uint32_t read_count = USBHSD->RX_LEN;
-            read_count = TU_MIN(read_count, total_bytes);
+        uint32_t read_count = USBHSD->RX_LEN;
+        read_count = TU_MIN(read_count, total_bytes);
 
-            if ((total_bytes == 8)) {
-                read_count = 8;
-                memcpy(buffer, &EP0_DatabufHD[0], 8);
-            } else {
-                memcpy(buffer, &EP0_DatabufHD[0], read_count);
-            }
+        if ((total_bytes == 8)) {
+            read_count = 8;
+            memcpy(buffer, &EP0_DatabufHD[0], 8);
         } else {
-            EP_RX_DMA_ADDR(epnum) = (uint32_t)xfer->buffer;
-            USBHSD->ENDP_CONFIG |= (USBHS_EP0_R_EN << epnum);
+            memcpy(buffer, &EP0_DatabufHD[0], read_count);
         }
 
         // usbd_ep_read(ep_addr, buffer, total_bytes, &ret_bytes);
@@ -289,6 +290,37 @@ bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t *buffer, uint16_t to
     return true;
 }
 
+// Non-control endpoint: a packet has been moved, either arm the next one or complete.
+// The controller NAKs while the transfer interrupt is pending (USBHS_INT_BUSY_EN), so
+// updating the DMA address here cannot race with the next packet.
+static void edpt_n_next_packet(uint8_t epnum, uint8_t dir) {
+    xfer_ctl_t *xfer = XFER_CTL_BASE(epnum, dir);
+
+    if (dir == TUSB_DIR_IN) {
+        if (xfer->queued_len < xfer->total_len) {
+            uint16_t const len = tu_min16(xfer->total_len - xfer->queued_len, xfer->max_size);
+            EP_TX_DMA_ADDR(epnum) = (uint32_t)(xfer->buffer + xfer->queued_len);
+            EP_TX_LEN(epnum) = len;
+            xfer->queued_len += len;
+            return;
+        }
+        EP_TX_CTRL(epnum) = (EP_TX_CTRL(epnum) & ~(USBHS_EP_T_RES_MASK)) | USBHS_EP_T_RES_NAK;
+    } else {
+        uint16_t const rx_len = USBHSD->RX_LEN;
+        xfer->queued_len += rx_len;
+
+        // Per USB spec, a short OUT packet (including length 0) ends the transfer
+        if ((rx_len == xfer->max_size) && (xfer->queued_len < xfer->total_len)) {
+            EP_RX_DMA_ADDR(epnum) = (uint32_t)(xfer->buffer + xfer->queued_len);
+            return;
+        }
+        // hold further packets until the next transfer is queued
+        EP_RX_CTRL(epnum) = (EP_RX_CTRL(epnum) & ~(USBHS_EP_R_RES_MASK)) | USBHS_EP_R_RES_NAK;
+    }
+
+    dcd_event_xfer_complete(0, tu_edpt_addr(epnum, dir), xfer->queued_len, XFER_RESULT_SUCCESS, true);
+}
+
 
 static void receive_packet(xfer_ctl_t *xfer, uint16_t xfer_size) {
     // xfer->queued_len = xfer->total_len - remaining;
@@ -332,7 +364,9 @@ void dcd_int_handler(uint8_t rhport) {
 
         xfer_ctl_t *xfer = XFER_CTL_BASE(end_num, tu_edpt_dir(endp));
 
-        if (rx_token == PID_OUT) {
+        if (end_num != 0 && (rx_token == PID_OUT || rx_token == PID_IN)) {
+            edpt_n_next_packet(end_num, tu_edpt_dir(endp));
+        } else if (rx_token == PID_OUT) {
             uint16_t rx_len = USBHSD->RX_LEN;
 
             receive_packet(xfer, rx_len);
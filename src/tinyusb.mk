@@ -19,8 +19,16 @@ TINYUSB_SRC_C += \
 	src/class/vendor/vendor_device.c \
   src/host/usbh.c \
   src/host/hub.c \
+  src/class/audio/audio_host.c \
   src/class/cdc/cdc_host.c \
   src/class/hid/hid_host.c \
+  src/class/midi/midi_host.c \
   src/class/msc/msc_host.c \
+  src/class/net/ecm_host.c \
+  src/class/net/ncm_host.c \
+  src/class/cdc/cdc_rndis_host.c \
   src/class/vendor/vendor_host.c \
   src/typec/usbc.c \
+  src/bridge/bridge.c \
+  src/bridge/bridge_msc.c \
+  src/bridge/bridge_cdc.c \
@@ -136,7 +136,14 @@ bool tu_edpt_release(tu_edpt_state_t* ep_state, osal_mutex_t mutex) {
 
 bool tu_edpt_validate(tusb_desc_endpoint_t const* desc_ep, tusb_speed_t speed) {
   uint16_t const max_packet_size = tu_edpt_packet_size(desc_ep);
-  TU_LOG2("  Open EP %02X with Size = %u\r\n", desc_ep->bEndpointAddress, max_packet_size);
+  uint8_t const mult = tu_edpt_packet_mult(desc_ep);
+  TU_LOG2("  Open EP %02X with Size = %u x %u\r\n", desc_ep->bEndpointAddress, max_packet_size, mult);
+
+  // Additional transactions per micro-frame are only allowed for highspeed periodic endpoints (value 3 is reserved)
+  if (mult > 1) {
+    TU_ASSERT(speed == TUSB_SPEED_HIGH && mult <= 3);
+    TU_ASSERT(desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS || desc_ep->bmAttributes.xfer == TUSB_XFER_INTERRUPT);
+  }
 
   switch (desc_ep->bmAttributes.xfer) {
     case TUSB_XFER_ISOCHRONOUS: {
@@ -210,22 +217,128 @@ uint16_t tu_desc_get_interface_total_len(tusb_desc_interface_t const* desc_itf,
   return len;
 }
 
+//--------------------------------------------------------------------+
+// Scatter-gather Transfer Helper for both Host and Device stack
+//--------------------------------------------------------------------+
+#if (CFG_TUD_ENABLED && CFG_TUD_EDPT_XFER_SG) || (CFG_TUH_ENABLED && CFG_TUH_EDPT_XFER_SG)
+
+void tu_sg_xfer_init(tu_sg_xfer_t* sg, tu_iovec_t const* iov, uint8_t count, uint16_t mps, uint8_t* bounce) {
+  sg->iov = iov;
+  sg->bounce = bounce;
+  sg->count = count;
+  sg->mps = mps;
+  sg->idx = 0;
+  sg->offset = 0;
+  sg->xferred = 0;
+  sg->part_len = 0;
+  sg->part_bounced = false;
+
+  sg->total = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    sg->total += iov[i].len;
+  }
+}
+
+TU_ATTR_FAST_FUNC uint16_t tu_sg_xfer_part(tu_sg_xfer_t* sg, uint8_t** buffer) {
+  // skip segments already done, the last one is kept for its (possibly zero-length) remainder
+  while (sg->idx + 1 < sg->count && sg->offset == sg->iov[sg->idx].len) {
+    sg->idx++;
+    sg->offset = 0;
+  }
+
+  tu_iovec_t const* seg = &sg->iov[sg->idx];
+  uint16_t const remain = (uint16_t) (seg->len - sg->offset);
+  bool const is_last = (sg->idx + 1 == sg->count);
+
+  if (is_last || remain >= sg->mps) {
+    // in place: whole packets of this segment, or the rest of the last one
+    uint16_t const max_part = (uint16_t) ((UINT16_MAX / sg->mps) * sg->mps);
+    uint16_t len = is_last ? remain : (uint16_t) (remain - remain % sg->mps);
+
+    sg->part_bounced = false;
+    sg->part_len = tu_min16(len, max_part);
+    *buffer = (uint8_t*) seg->buf + sg->offset;
+    return sg->part_len;
+  }
+
+  // packet straddling segments: gather up to one packet into bounce buffer
+  bool const is_in = (tu_edpt_dir(sg->ep_addr) == TUSB_DIR_IN);
+  uint16_t len = 0;
+  uint8_t idx = sg->idx;
+  uint16_t offset = sg->offset;
+
+  while (len < sg->mps && idx < sg->count) {
+    uint16_t const take = tu_min16((uint16_t) (sg->mps - len), (uint16_t) (sg->iov[idx].len - offset));
+    if (is_in) {
+      memcpy(sg->bounce + len, (uint8_t const*) sg->iov[idx].buf + offset, take);
+    }
+    len += take;
+    offset += take;
+
+    if (offset == sg->iov[idx].len) {
+      idx++;
+      offset = 0;
+    }
+  }
+
+  sg->part_bounced = true;
+  sg->part_len = len;
+  *buffer = sg->bounce;
+  return len;
+}
+
+TU_ATTR_FAST_FUNC bool tu_sg_xfer_advance(tu_sg_xfer_t* sg, uint32_t xferred) {
+  bool const scatter = sg->part_bounced && (tu_edpt_dir(sg->ep_addr) == TUSB_DIR_OUT);
+  xferred = tu_min32(xferred, sg->part_len);
+
+  uint16_t done = 0;
+  while (done < xferred) {
+    tu_iovec_t const* seg = &sg->iov[sg->idx];
+    uint16_t const take = tu_min16((uint16_t) (xferred - done), (uint16_t) (seg->len - sg->offset));
+    if (scatter) {
+      memcpy((uint8_t*) seg->buf + sg->offset, sg->bounce + done, take);
+    }
+    done += take;
+    sg->offset += take;
+
+    if (sg->offset == seg->len) {
+      if (sg->idx + 1 == sg->count) break;
+      sg->idx++;
+      sg->offset = 0;
+    }
+  }
+
+  sg->xferred += xferred;
+
+  // short packet ends the transfer
+  return (xferred == sg->part_len) && (sg->xferred < sg->total);
+}
+
+#endif
+
 //--------------------------------------------------------------------+
 // Endpoint Stream Helper for both Host and Device stack
 //--------------------------------------------------------------------+
 
 bool tu_edpt_stream_init(tu_edpt_stream_t* s, bool is_host, bool is_tx, bool overwritable,
                          void* ff_buf, uint16_t ff_bufsize, uint8_t* ep_buf, uint16_t ep_bufsize) {
+  // host controller does not support transfer with fifo
+  TU_ASSERT(ep_buf != NULL || !is_host);
+
   osal_mutex_t new_mutex = osal_mutex_create(&s->ff_mutexdef);
   (void) new_mutex;
   (void) is_tx;
 
   s->is_host = is_host;
-  tu_fifo_config(&s->ff, ff_buf, ff_bufsize, 1, overwritable);
-  tu_fifo_config_mutex(&s->ff, is_tx ? new_mutex : NULL, is_tx ? NULL : new_mutex);
+  s->ff = &s->own_ff;
+  tu_fifo_config(&s->own_ff, ff_buf, ff_bufsize, 1, overwritable);
+  tu_fifo_config_mutex(&s->own_ff, is_tx ? new_mutex : NULL, is_tx ? NULL : new_mutex);
 
   s->ep_buf = ep_buf;
   s->ep_bufsize = ep_bufsize;
+  #if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  s->ep_buf_alt = NULL;
+  #endif
 
   return true;
 }
@@ -233,8 +346,8 @@ bool tu_edpt_stream_init(tu_edpt_stream_t* s, bool is_host, bool is_tx, bool ove
 bool tu_edpt_stream_deinit(tu_edpt_stream_t* s) {
   (void) s;
   #if OSAL_MUTEX_REQUIRED
-  if (s->ff.mutex_wr) osal_mutex_delete(s->ff.mutex_wr);
-  if (s->ff.mutex_rd) osal_mutex_delete(s->ff.mutex_rd);
+  if (s->own_ff.mutex_wr) osal_mutex_delete(s->own_ff.mutex_wr);
+  if (s->own_ff.mutex_rd) osal_mutex_delete(s->own_ff.mutex_rd);
   #endif
   return true;
 }
@@ -261,6 +374,9 @@ bool stream_xfer(tu_edpt_stream_t* s, uint16_t count) {
     #endif
   } else {
     #if CFG_TUD_ENABLED
+    if (s->ep_buf == NULL && count) {
+      return usbd_edpt_xfer_fifo(s->rhport, s->ep_addr, s->ff, count);
+    }
     return usbd_edpt_xfer(s->rhport, s->ep_addr, count ? s->ep_buf : NULL, count);
     #endif
   }
@@ -286,7 +402,7 @@ bool stream_release(tu_edpt_stream_t* s) {
 //--------------------------------------------------------------------+
 bool tu_edpt_stream_write_zlp_if_needed(tu_edpt_stream_t* s, uint32_t last_xferred_bytes) {
   // ZLP condition: no pending data, last transferred bytes is multiple of packet size
-  TU_VERIFY(!tu_fifo_count(&s->ff) && last_xferred_bytes && (0 == (last_xferred_bytes & (s->ep_packetsize - 1))));
+  TU_VERIFY(!tu_fifo_count(s->ff) && last_xferred_bytes && (0 == (last_xferred_bytes & (s->ep_packetsize - 1))));
   TU_VERIFY(stream_claim(s));
   TU_ASSERT(stream_xfer(s, 0));
   return true;
@@ -294,13 +410,19 @@ bool tu_edpt_stream_write_zlp_if_needed(tu_edpt_stream_t* s, uint32_t last_xferr
 
 uint32_t tu_edpt_stream_write_xfer(tu_edpt_stream_t* s) {
   // skip if no data
-  TU_VERIFY(tu_fifo_count(&s->ff), 0);
+  TU_VERIFY(tu_fifo_count(s->ff), 0);
 
   // Claim the endpoint
   TU_VERIFY(stream_claim(s), 0);
 
-  // Pull data from FIFO -> EP buf
-  uint16_t const count = tu_fifo_read_n(&s->ff, s->ep_buf, s->ep_bufsize);
+  uint16_t count;
+  if (s->ep_buf) {
+    // Pull data from FIFO -> EP buf
+    count = (uint16_t) tu_fifo_read_n(s->ff, s->ep_buf, s->ep_bufsize);
+  } else {
+    // Controller pulls data directly from FIFO
+    count = (uint16_t) TU_MIN(tu_fifo_count(s->ff), s->ep_bufsize);
+  }
 
   if (count) {
     TU_ASSERT(stream_xfer(s, count), 0);
@@ -313,24 +435,38 @@ uint32_t tu_edpt_stream_write_xfer(tu_edpt_stream_t* s) {
   }
 }
 
-uint32_t tu_edpt_stream_write(tu_edpt_stream_t* s, void const* buffer, uint32_t bufsize) {
-  TU_VERIFY(bufsize); // TODO support ZLP
-  uint16_t ret = tu_fifo_write_n(&s->ff, buffer, (uint16_t) bufsize);
-
+TU_ATTR_ALWAYS_INLINE static inline
+void stream_write_xfer_if_needed(tu_edpt_stream_t* s) {
   // flush if fifo has more than packet size or
   // in rare case: fifo depth is configured too small (which never reach packet size)
-  if ((tu_fifo_count(&s->ff) >= s->ep_packetsize) || (tu_fifo_depth(&s->ff) < s->ep_packetsize)) {
+  if ((tu_fifo_count(s->ff) >= s->ep_packetsize) || (tu_fifo_depth(s->ff) < s->ep_packetsize)) {
     tu_edpt_stream_write_xfer(s);
   }
+}
 
+uint32_t tu_edpt_stream_write(tu_edpt_stream_t* s, void const* buffer, uint32_t bufsize) {
+  TU_VERIFY(bufsize); // TODO support ZLP
+  tu_fifo_size_t ret = tu_fifo_write_n(s->ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
+  stream_write_xfer_if_needed(s);
+  return ret;
+}
+
+uint32_t tu_edpt_stream_write_commit(tu_edpt_stream_t* s, uint32_t count) {
+  tu_fifo_size_t const ret = (tu_fifo_size_t) TU_MIN(count, tu_fifo_remaining(s->ff));
+  TU_VERIFY(ret, 0);
+  tu_fifo_advance_write_pointer(s->ff, ret);
+  stream_write_xfer_if_needed(s);
   return ret;
 }
 
 //--------------------------------------------------------------------+
 // Stream Read
 //--------------------------------------------------------------------+
-uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s) {
-  uint16_t available = tu_fifo_remaining(&s->ff);
+// pending: bytes that will be written into fifo without transfer e.g data in the other double buffer
+static uint32_t stream_read_xfer(tu_edpt_stream_t* s, uint32_t pending) {
+  tu_fifo_size_t available = tu_fifo_remaining(s->ff);
+  TU_VERIFY(available >= pending, 0);
+  available = (tu_fifo_size_t) (available - pending);
 
   // Prepare for incoming data but only allow what we can store in the ring buffer.
   // TODO Actually we can still carry out the transfer, keeping count of received bytes
@@ -342,14 +478,15 @@ uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s) {
   TU_VERIFY(stream_claim(s), 0);
 
   // get available again since fifo can be changed before endpoint is claimed
-  available = tu_fifo_remaining(&s->ff);
+  available = tu_fifo_remaining(s->ff);
+  available = (available >= pending) ? (tu_fifo_size_t) (available - pending) : 0;
 
   if (available >= s->ep_packetsize) {
     // multiple of packet size limit by ep bufsize
-    uint16_t count = (uint16_t) (available & ~(s->ep_packetsize - 1));
-    count = tu_min16(count, s->ep_bufsize);
+    tu_fifo_size_t count = available & (tu_fifo_size_t) ~(s->ep_packetsize - 1);
+    count = TU_MIN(count, s->ep_bufsize);
 
-    TU_ASSERT(stream_xfer(s, count), 0);
+    TU_ASSERT(stream_xfer(s, (uint16_t) count), 0);
     return count;
   } else {
     // Release endpoint since we don't make any transfer
@@ -358,12 +495,121 @@ uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s) {
   }
 }
 
+uint32_t tu_edpt_stream_read_xfer(tu_edpt_stream_t* s) {
+  return stream_read_xfer(s, 0);
+}
+
+#if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+uint8_t* tu_edpt_stream_read_rearm(tu_edpt_stream_t* s, uint32_t pending) {
+  uint8_t* const done = s->ep_buf;
+  s->ep_buf = s->ep_buf_alt;
+  s->ep_buf_alt = done;
+
+  stream_read_xfer(s, pending);
+  return done;
+}
+#endif
+
 uint32_t tu_edpt_stream_read(tu_edpt_stream_t* s, void* buffer, uint32_t bufsize) {
-  uint32_t num_read = tu_fifo_read_n(&s->ff, buffer, (uint16_t) bufsize);
+  uint32_t num_read = tu_fifo_read_n(s->ff, buffer, (tu_fifo_size_t) TU_MIN(bufsize, TU_FIFO_SIZE_MAX));
   tu_edpt_stream_read_xfer(s);
   return num_read;
 }
 
+//--------------------------------------------------------------------+
+// Trace
+//--------------------------------------------------------------------+
+
+#if CFG_TUSB_TRACE
+TU_VERIFY_STATIC((CFG_TUSB_TRACE_DEPTH & (CFG_TUSB_TRACE_DEPTH - 1)) == 0, "CFG_TUSB_TRACE_DEPTH must be power of 2");
+TU_VERIFY_STATIC(sizeof(tu_trace_rec_t) == 12, "record size is part of the decoder format");
+
+#ifdef TU_MEMORY_BARRIER
+  #define _trace_barrier()   TU_MEMORY_BARRIER()
+#else
+  #define _trace_barrier()
+#endif
+
+// Writers in any context reserve a slot by advancing wr, then commit it by writing its id last.
+// Reader stops at the first reserved but not yet committed slot.
+typedef struct {
+  volatile uint32_t wr;
+  volatile uint32_t rd;
+  volatile uint32_t dropped;
+  tu_trace_rec_t volatile rec[CFG_TUSB_TRACE_DEPTH];
+} tu_trace_ring_t;
+
+tu_static tu_trace_ring_t _tu_trace;
+
+TU_ATTR_WEAK uint32_t tusb_trace_timestamp_cb(void) {
+  return 0;
+}
+
+TU_ATTR_FAST_FUNC void tu_trace_record(uint8_t id, uint8_t rhport, uint8_t ep_addr, uint8_t arg, uint32_t value) {
+  uint32_t const timestamp = tusb_trace_timestamp_cb();
+  uint32_t wr;
+
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_4
+  wr = __atomic_load_n(&_tu_trace.wr, __ATOMIC_RELAXED);
+  do {
+    if (wr - _tu_trace.rd >= CFG_TUSB_TRACE_DEPTH) {
+      _tu_trace.dropped++;
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&_tu_trace.wr, &wr, wr + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+  // no compare-and-swap (e.g Cortex-M0): a record preempted right here by another one in ISR can be overwritten
+  wr = _tu_trace.wr;
+  if (wr - _tu_trace.rd >= CFG_TUSB_TRACE_DEPTH) {
+    _tu_trace.dropped++;
+    return;
+  }
+  _tu_trace.wr = wr + 1;
+#endif
+
+  tu_trace_rec_t volatile* rec = &_tu_trace.rec[wr & (CFG_TUSB_TRACE_DEPTH - 1)];
+  rec->timestamp = timestamp;
+  rec->rhport = rhport;
+  rec->ep_addr = ep_addr;
+  rec->arg = arg;
+  rec->value = value;
+  _trace_barrier();
+  rec->id = id;
+}
+
+uint32_t tusb_trace_read(tu_trace_rec_t* rec, uint32_t count) {
+  uint32_t n = 0;
+
+  while (n < count) {
+    uint32_t const rd = _tu_trace.rd;
+    if (rd == _tu_trace.wr) break;
+
+    tu_trace_rec_t volatile* slot = &_tu_trace.rec[rd & (CFG_TUSB_TRACE_DEPTH - 1)];
+    if (slot->id == TU_TRACE_NONE) break; // writer is still filling it
+    _trace_barrier();
+
+    rec[n].timestamp = slot->timestamp;
+    rec[n].id = slot->id;
+    rec[n].rhport = slot->rhport;
+    rec[n].ep_addr = slot->ep_addr;
+    rec[n].arg = slot->arg;
+    rec[n].value = slot->value;
+    n++;
+
+    // free slot before it can be reserved again
+    slot->id = TU_TRACE_NONE;
+    _trace_barrier();
+    _tu_trace.rd = rd + 1;
+  }
+
+  return n;
+}
+
+uint32_t tusb_trace_dropped(void) {
+  return _tu_trace.dropped;
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Debug
 //--------------------------------------------------------------------+
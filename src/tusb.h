@@ -51,6 +51,14 @@
     #include "class/hid/hid_host.h"
   #endif
 
+  #if CFG_TUH_MIDI
+    #include "class/midi/midi_host.h"
+  #endif
+
+  #if CFG_TUH_AUDIO
+    #include "class/audio/audio_host.h"
+  #endif
+
   #if CFG_TUH_MSC
     #include "class/msc/msc_host.h"
   #endif
@@ -59,6 +67,18 @@
     #include "class/cdc/cdc_host.h"
   #endif
 
+  #if CFG_TUH_NCM
+    #include "class/net/ncm_host.h"
+  #endif
+
+  #if CFG_TUH_RNDIS
+    #include "class/cdc/cdc_rndis_host.h"
+  #endif
+
+  #if CFG_TUH_ECM
+    #include "class/net/ecm_host.h"
+  #endif
+
   #if CFG_TUH_VENDOR
     #include "class/vendor/vendor_host.h"
   #endif
@@ -125,6 +145,19 @@
   #endif
 #endif
 
+//------------- Bridge -------------//
+#if CFG_TUSB_BRIDGE
+  #include "bridge/bridge.h"
+#endif
+
+#if CFG_TUSB_BRIDGE_MSC
+  #include "bridge/bridge_msc.h"
+#endif
+
+#if CFG_TUSB_BRIDGE_CDC
+  #include "bridge/bridge_cdc.h"
+#endif
+
 
 //--------------------------------------------------------------------+
 // APPLICATION API
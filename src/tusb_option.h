@@ -187,6 +187,9 @@
 #define OPT_MCU_MCXN9            2300  ///< NXP MCX N9 Series
 #define OPT_MCU_MCXA15           2301  ///< NXP MCX A15 Series
 
+// Virtual
+#define OPT_MCU_LOOPBACK         2400  ///< Virtual device and host controllers wired together on a PC, see test/loopback
+
 // Check if configured MCU is one of listed
 // Apply _TU_CHECK_MCU with || as separator to list of input
 #define _TU_CHECK_MCU(_m)    (CFG_TUSB_MCU == _m)
@@ -306,6 +309,12 @@
 // Common Options (Default)
 //--------------------------------------------------------------------+
 
+// Number of log2 bins of duration/latency histograms in device and host statistics: bin n counts values in
+// [2^n, 2^(n+1)) timestamp units (bin 0 also counts 0), the last bin counts everything above
+#ifndef CFG_TUSB_STATS_HIST_BINS
+  #define CFG_TUSB_STATS_HIST_BINS  16
+#endif
+
 // Debug enable to print out error message
 #ifndef CFG_TUSB_DEBUG
   #define CFG_TUSB_DEBUG 0
@@ -321,18 +330,40 @@
   #define CFG_TUD_LOG_LEVEL   2
 #endif
 
+// Binary trace of stack events into a RAM ring, drained by application with tusb_trace_read() e.g to RTT or ITM.
+// Unlike logging a record takes only a few cycles, timing is therefore preserved. Independent of CFG_TUSB_DEBUG
+#ifndef CFG_TUSB_TRACE
+  #define CFG_TUSB_TRACE   0
+#endif
+
+// Number of records (12 bytes each) in trace ring, must be power of 2
+#ifndef CFG_TUSB_TRACE_DEPTH
+  #define CFG_TUSB_TRACE_DEPTH   256
+#endif
+
 // Memory section for placing buffer used for usb transferring. If MEM_SECTION is different for
 // host and device use: CFG_TUD_MEM_SECTION, CFG_TUH_MEM_SECTION instead
 #ifndef CFG_TUSB_MEM_SECTION
   #define CFG_TUSB_MEM_SECTION
 #endif
 
+// Section for placing the interrupt hot path (ISR -> event queue, endpoint transfer and fifo copy) to
+// run from RAM/ITCM instead of flash e.g ".ramfunc". The linker script must place and copy this section.
+// Leave undefined to use port default: TU_ATTR_FAST_FUNC in tusb_mcu.h
+// #define CFG_TUSB_FAST_FUNC_SECTION ".ramfunc"
+
 // Alignment requirement of buffer used for usb transferring. if MEM_ALIGN is different for
 // host and device controller use: CFG_TUD_MEM_ALIGN, CFG_TUH_MEM_ALIGN instead
 #ifndef CFG_TUSB_MEM_ALIGN
   #define CFG_TUSB_MEM_ALIGN      TU_ATTR_ALIGNED(4)
 #endif
 
+// Data cache line size, endpoint buffers are aligned and padded to it when usbd/usbh does data cache maintenance
+// (CFG_TUD_MEM_DCACHE_ENABLE, CFG_TUH_MEM_DCACHE_ENABLE). 32 for Cortex-M7/M55, must be a power of 2
+#ifndef CFG_TUSB_MEM_DCACHE_LINE_SIZE
+  #define CFG_TUSB_MEM_DCACHE_LINE_SIZE  32
+#endif
+
 // OS selection
 #ifndef CFG_TUSB_OS
   #define CFG_TUSB_OS             OPT_OS_NONE
@@ -342,6 +373,39 @@
   #define CFG_TUSB_OS_INC_PATH
 #endif
 
+// Use 32-bit depth/index in tu_fifo (and functions built on it such as edpt stream, CDC, vendor and audio) to
+// allow fifo larger than 32K items. Default is 16-bit to save RAM.
+#ifndef CFG_TUSB_FIFO_LARGE
+  #define CFG_TUSB_FIFO_LARGE     0
+#endif
+
+// Lock-free multi-producer single-consumer write tu_fifo_write_n_mpsc() using compiler atomics (LDREX/STREX on
+// ARMv7-M and later). CDC device TX fifo uses it instead of the writer mutex so that several tasks can write
+// concurrently. Requires 16-bit fifo index i.e CFG_TUSB_FIFO_LARGE = 0
+#ifndef CFG_TUSB_FIFO_MPSC
+  #define CFG_TUSB_FIFO_MPSC      0
+#endif
+
+// Overwritable tu_fifo drops its oldest items when full: write advances the read index in O(1) with compiler atomic
+// compare-and-swap (LDREX/STREX on ARMv7-M and later), a read that raced with it is retried, and dropped items are
+// counted (tu_fifo_dropped()). Otherwise the read index is only re-derived by the next read, which races with a
+// concurrent reader and loses an unknown amount of data once the fifo overflows twice
+#ifndef CFG_TUSB_FIFO_DROP_OLDEST
+  #define CFG_TUSB_FIFO_DROP_OLDEST 0
+#endif
+
+// Minimum size in bytes of a tu_fifo_write_n_async()/tu_fifo_read_n_async() copy that is offloaded to DMA with
+// tu_fifo_dma_copy_async(), 0 is disabled. Adds two DMA job states to every tu_fifo_t
+#ifndef CFG_TUSB_FIFO_DMA_THRESHOLD
+  #define CFG_TUSB_FIFO_DMA_THRESHOLD 0
+#endif
+
+// Double buffer for OUT endpoint stream (e.g CDC host): endpoint is re-armed with the second buffer while received
+// data is copied into fifo, keeping endpoint primed at the cost of one more endpoint buffer
+#ifndef CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  #define CFG_TUSB_EDPT_STREAM_DOUBLE_BUF 0
+#endif
+
 //--------------------------------------------------------------------
 // Device Options (Default)
 //--------------------------------------------------------------------
@@ -356,6 +420,25 @@
   #define CFG_TUD_MEM_ALIGN       CFG_TUSB_MEM_ALIGN
 #endif
 
+// Data cache maintenance of transfer buffers by usbd, for DMA controller on MCU with data cache (e.g Cortex-M7/M55)
+// so that buffers can be in cached RAM: buffer is cleaned (IN) or cleaned and invalidated (OUT) once per transfer
+// submitted to DCD and received data is invalidated on completion, with dcd_dcache_clean/invalidate(). Class driver
+// endpoint buffers (TUD_EPBUF_DEF) are aligned and padded to CFG_TUSB_MEM_DCACHE_LINE_SIZE.
+#ifndef CFG_TUD_MEM_DCACHE_ENABLE
+  #define CFG_TUD_MEM_DCACHE_ENABLE  0
+#endif
+
+// Number of bounce buffers for OUT transfers whose buffer does not start and end on a cache line boundary (e.g
+// application buffer), invalidating it would discard CPU writes to data sharing its first or last line. Transfer
+// larger than CFG_TUD_MEM_DCACHE_BOUNCE_SZ or when all bounce buffers are in use is received in place.
+#ifndef CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+  #define CFG_TUD_MEM_DCACHE_BOUNCE_NUM  0
+#endif
+
+#ifndef CFG_TUD_MEM_DCACHE_BOUNCE_SZ
+  #define CFG_TUD_MEM_DCACHE_BOUNCE_SZ  (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
 #ifndef CFG_TUD_ENDPOINT0_SIZE
   #define CFG_TUD_ENDPOINT0_SIZE  64
 #endif
@@ -364,6 +447,136 @@
   #define CFG_TUD_INTERFACE_MAX   16
 #endif
 
+#ifndef CFG_TUD_ENDPPOINT_MAX
+  #define CFG_TUD_ENDPPOINT_MAX   TUP_DCD_ENDPOINT_MAX
+#endif
+
+// Number of transfers that can be queued on a (non-control) endpoint while it is busy. Queued transfers are
+// submitted to the DCD directly from the transfer complete ISR. 0 means disabled: only one transfer per endpoint
+#ifndef CFG_TUD_EDPT_XFER_QUEUE_SZ
+  #define CFG_TUD_EDPT_XFER_QUEUE_SZ  0
+#endif
+
+// Number of queued transfers handed to the DCD at once on an endpoint if it can chain them in hardware
+// (TUP_DCD_EDPT_XFER_CHAIN), so that the controller continues with the next one without waiting for the ISR
+#ifndef CFG_TUD_EDPT_XFER_CHAIN_DEPTH
+  #define CFG_TUD_EDPT_XFER_CHAIN_DEPTH  2
+#endif
+
+// Allow transfers larger than 64 KiB on non-control endpoints. DCD API is limited to 16-bit length, therefore
+// the stack splits large transfers into chunks which are re-submitted from transfer complete ISR and only
+// reports a single completion for the whole transfer.
+#ifndef CFG_TUD_LARGE_XFER
+  #define CFG_TUD_LARGE_XFER  0
+#endif
+
+// Number of scatter-gather transfers (usbd_edpt_xfer_sg()) that can be in progress at the same time, 0 is disabled.
+// Each one has a bounce buffer of CFG_TUD_EDPT_XFER_SG_BOUNCE_SZ for the packet straddling two segments, which must
+// be at least the endpoint max packet size
+#ifndef CFG_TUD_EDPT_XFER_SG
+  #define CFG_TUD_EDPT_XFER_SG  0
+#endif
+
+#ifndef CFG_TUD_EDPT_XFER_SG_BOUNCE_SZ
+  #define CFG_TUD_EDPT_XFER_SG_BOUNCE_SZ  (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
+// Resolve class drivers at compile time: only built-in drivers are used (usbd_app_driver_get_cb() is ignored) so
+// that callbacks are called directly instead of through the driver table, and can be inlined into usbd task.
+// Most useful for builds with one or two classes.
+#ifndef CFG_TUD_DRIVER_STATIC
+  #define CFG_TUD_DRIVER_STATIC  0
+#endif
+
+// Merge redundant events before they reach the usbd task queue, so that the queue can be sized smaller:
+// - back-to-back successful transfer completions on a queued endpoint (CFG_TUD_EDPT_XFER_QUEUE_SZ) are reported
+//   as a single xfer_cb() with the accumulated length, only on endpoints whose driver opted in with
+//   usbd_edpt_xfer_coalesce() (vendor direct transfer). Other drivers still get one xfer_cb() per transfer
+// - repeated SUSPEND/RESUME events that don't change the bus state are dropped
+#ifndef CFG_TUD_EVENT_COALESCE
+  #define CFG_TUD_EVENT_COALESCE  0
+#endif
+
+// Max number of class drivers subscribed to SOF with usbd_sof_subscribe() at the same time
+#ifndef CFG_TUD_SOF_SUBSCRIBER_MAX
+  #define CFG_TUD_SOF_SUBSCRIBER_MAX  8
+#endif
+
+// Let DCD acknowledge USB 2.0 LPM tokens so that host can put the link into sleep (L1) which is entered and left in
+// microseconds instead of milliseconds for suspend. Application must also advertise LPM in the BOS descriptor.
+// Supported by DWC2 and FSDEV with LPM hardware
+#ifndef CFG_TUD_LPM
+  #define CFG_TUD_LPM  0
+#endif
+
+// Transmit control IN data stage longer than one packet in a single transfer straight from the buffer passed to
+// tud_control_xfer() (descriptors included) instead of copying it packet by packet into the control endpoint
+// buffer. Only effective with DCD supporting it (TUP_DCD_EDPT0_MULTI_PACKET) and 4-byte aligned buffers.
+// Application must make sure such buffers are reachable by the controller DMA e.g not in DTCM
+#ifndef CFG_TUD_CONTROL_IN_ZERO_COPY
+  #define CFG_TUD_CONTROL_IN_ZERO_COPY  0
+#endif
+
+// Answer standard GET_DESCRIPTOR (device, configuration, string, BOS, device qualifier) and device GET_STATUS
+// requests directly in the DCD setup ISR instead of waiting for usbd task, so that enumeration does not stall
+// when the task is starved. Other requests, or any request while usbd task still has control events pending,
+// are deferred as usual. The descriptor callbacks are then invoked in ISR context and must be ISR-safe.
+#ifndef CFG_TUD_SETUP_IN_ISR
+  #define CFG_TUD_SETUP_IN_ISR  0
+#endif
+
+// Size in bytes of the buffer holding string descriptors pre-encoded by tud_string_table_set(), each string takes
+// 2 + 2*length bytes rounded up to 4. 0 means disabled: every string is requested with tud_descriptor_string_cb()
+#ifndef CFG_TUD_STRING_TABLE_SZ
+  #define CFG_TUD_STRING_TABLE_SZ  0
+#endif
+
+// Maximum number of strings (index 0 i.e LANGID included) in table passed to tud_string_table_set()
+#ifndef CFG_TUD_STRING_TABLE_MAX
+  #define CFG_TUD_STRING_TABLE_MAX  16
+#endif
+
+// Number of interface descriptors (alternate settings included) of the active configuration indexed at
+// SET_CONFIGURATION, so that class drivers can look up an alternate setting with usbd_itf_desc_find() instead of
+// walking the configuration descriptor on every SET_INTERFACE. 0 means disabled. Maximum is 254
+#ifndef CFG_TUD_ITF_INDEX_SZ
+  #define CFG_TUD_ITF_INDEX_SZ  0
+#endif
+
+// Size of a buffer pool shared by class drivers (HID, MSC), which then take their endpoint buffers from it in open()
+// instead of allocating them statically. The pool is released as a whole when the configuration is reset, so it only
+// has to fit the most demanding configuration: add up TUD_<CLASS>_BUF_POOL_SZ of its interfaces. 0 means disabled
+#ifndef CFG_TUD_BUF_POOL_SZ
+  #define CFG_TUD_BUF_POOL_SZ  0
+#endif
+
+// Pool is an arena passed by application to tud_init_arena() instead of CFG_TUD_BUF_POOL_SZ static memory, so that
+// one firmware image can serve several descriptor sets and only the interfaces actually mounted take memory
+#ifndef CFG_TUD_BUF_POOL_ARENA
+  #define CFG_TUD_BUF_POOL_ARENA  0
+#endif
+
+#define CFG_TUD_BUF_POOL_ENABLED  (CFG_TUD_BUF_POOL_SZ > 0 || CFG_TUD_BUF_POOL_ARENA)
+
+// Alignment of each buffer allocated from the pool, e.g cache line size for DMA with cache maintenance. Minimum is 4
+#ifndef CFG_TUD_BUF_POOL_ALIGN
+  #if CFG_TUD_MEM_DCACHE_ENABLE
+    #define CFG_TUD_BUF_POOL_ALIGN  CFG_TUSB_MEM_DCACHE_LINE_SIZE
+  #else
+    #define CFG_TUD_BUF_POOL_ALIGN  4
+  #endif
+#endif
+
+// Collect per-endpoint and event queue statistics, see tud_stats_get()
+#ifndef CFG_TUD_STATS
+  #define CFG_TUD_STATS  0
+#endif
+
+// Invoke tud_int_enter_cb()/tud_int_exit_cb() around dcd_int_handler() when called via tud_int_handler()
+#ifndef CFG_TUD_INT_HOOK
+  #define CFG_TUD_INT_HOOK  0
+#endif
+
 //------------- Device Class Driver -------------//
 #ifndef CFG_TUD_BTH
   #define CFG_TUD_BTH             0
@@ -437,6 +650,37 @@
   #ifndef CFG_TUH_ENUMERATION_BUFSIZE
     #define CFG_TUH_ENUMERATION_BUFSIZE 256
   #endif
+
+  // Number of devices (e.g behind hubs) that can be enumerated in parallel after SET_ADDRESS, each requires
+  // its own CFG_TUH_ENUMERATION_BUFSIZE buffer. Default address phase is always one device at a time
+  #ifndef CFG_TUH_ENUMERATION_PARALLEL
+    #define CFG_TUH_ENUMERATION_PARALLEL 1
+  #endif
+
+  // Number of devices whose descriptors are cached, 0 to disable. When a device with identical device descriptor
+  // (VID, PID, bcdDevice ...) is attached again, its configuration descriptor is taken from cache instead of being
+  // read again, and tuh_descriptor_get_device/configuration() are answered from cache. Least recently used entry
+  // is replaced when full. Device must change bcdDevice when its configuration descriptor changes.
+  #ifndef CFG_TUH_DESC_CACHE_COUNT
+    #define CFG_TUH_DESC_CACHE_COUNT 0
+  #endif
+
+  // Maximum configuration descriptor size stored per cache entry, larger ones are not cached
+  #ifndef CFG_TUH_DESC_CACHE_CONFIG_SIZE
+    #define CFG_TUH_DESC_CACHE_CONFIG_SIZE CFG_TUH_ENUMERATION_BUFSIZE
+  #endif
+
+  // Number of interface alternate settings kept per device with their endpoint descriptors after the configuration
+  // descriptor is parsed, 0 to disable. Class drivers and application can look them up with tuh_interface_alt_get()
+  // e.g to open endpoints after tuh_interface_set(), without reading configuration descriptor again.
+  #ifndef CFG_TUH_CONFIG_ITF_ALT_MAX
+    #define CFG_TUH_CONFIG_ITF_ALT_MAX 0
+  #endif
+
+  // Maximum endpoint descriptors kept per device for CFG_TUH_CONFIG_ITF_ALT_MAX
+  #ifndef CFG_TUH_CONFIG_EP_MAX
+    #define CFG_TUH_CONFIG_EP_MAX (2*CFG_TUH_CONFIG_ITF_ALT_MAX)
+  #endif
 #endif // CFG_TUH_ENABLED
 
 // Attribute to place data in accessible RAM for host controller (default: CFG_TUSB_MEM_SECTION)
@@ -449,6 +693,21 @@
   #define CFG_TUH_MEM_ALIGN     CFG_TUSB_MEM_ALIGN
 #endif
 
+// Data cache maintenance of transfer buffers by usbh with hcd_dcache_clean/invalidate(), class driver endpoint
+// buffers (TUH_EPBUF_DEF) are padded to cache line. See CFG_TUD_MEM_DCACHE_ENABLE
+#ifndef CFG_TUH_MEM_DCACHE_ENABLE
+  #define CFG_TUH_MEM_DCACHE_ENABLE  0
+#endif
+
+// Number of bounce buffers for IN transfers into buffer not aligned to cache line, see CFG_TUD_MEM_DCACHE_BOUNCE_NUM
+#ifndef CFG_TUH_MEM_DCACHE_BOUNCE_NUM
+  #define CFG_TUH_MEM_DCACHE_BOUNCE_NUM  0
+#endif
+
+#ifndef CFG_TUH_MEM_DCACHE_BOUNCE_SZ
+  #define CFG_TUH_MEM_DCACHE_BOUNCE_SZ  (TUH_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
 //------------- CLASS -------------//
 
 #ifndef CFG_TUH_HUB
@@ -508,10 +767,27 @@
   #define CFG_TUH_MIDI   0
 #endif
 
+// number of Audio Streaming interfaces (UAC2)
+#ifndef CFG_TUH_AUDIO
+  #define CFG_TUH_AUDIO  0
+#endif
+
 #ifndef CFG_TUH_MSC
   #define CFG_TUH_MSC    0
 #endif
 
+#ifndef CFG_TUH_NCM
+  #define CFG_TUH_NCM    0
+#endif
+
+#ifndef CFG_TUH_RNDIS
+  #define CFG_TUH_RNDIS  0
+#endif
+
+#ifndef CFG_TUH_ECM
+  #define CFG_TUH_ECM    0
+#endif
+
 #ifndef CFG_TUH_VENDOR
   #define CFG_TUH_VENDOR 0
 #endif
@@ -520,11 +796,118 @@
   #define CFG_TUH_API_EDPT_XFER 0
 #endif
 
+// Control transfers of different devices are issued to the HCD concurrently. Only enable if host controller has
+// a separate control pipe per device (e.g EHCI, OHCI), otherwise usbh queues them and runs one at a time
+#ifndef CFG_TUH_CONTROL_XFER_CONCURRENT
+  #define CFG_TUH_CONTROL_XFER_CONCURRENT 0
+#endif
+
+// Resolve class drivers at compile time, usbh_app_driver_get_cb() is ignored. See CFG_TUD_DRIVER_STATIC
+#ifndef CFG_TUH_DRIVER_STATIC
+  #define CFG_TUH_DRIVER_STATIC 0
+#endif
+
+// Number of transfers that can be queued on a (non-control) endpoint while it is busy. Queued transfers are
+// submitted to the HCD directly from the transfer complete ISR, see CFG_TUD_EDPT_XFER_QUEUE_SZ
+#ifndef CFG_TUH_EDPT_XFER_QUEUE_SZ
+  #define CFG_TUH_EDPT_XFER_QUEUE_SZ 0
+#endif
+
+// Allow transfers larger than 64 KiB on non-control endpoints. HCD API is limited to 16-bit length, therefore
+// the stack splits large transfers into chunks, see CFG_TUD_LARGE_XFER
+#ifndef CFG_TUH_LARGE_XFER
+  #define CFG_TUH_LARGE_XFER 0
+#endif
+
+// Number of scatter-gather transfers (usbh_edpt_xfer_sg()) that can be in progress at the same time, 0 is disabled,
+// see CFG_TUD_EDPT_XFER_SG
+#ifndef CFG_TUH_EDPT_XFER_SG
+  #define CFG_TUH_EDPT_XFER_SG 0
+#endif
+
+#ifndef CFG_TUH_EDPT_XFER_SG_BOUNCE_SZ
+  #define CFG_TUH_EDPT_XFER_SG_BOUNCE_SZ  (TUH_OPT_HIGH_SPEED ? 512 : 64)
+#endif
+
+// Suspend idle devices by themselves after the inactivity time set with tuh_auto_suspend_set(). Checked whenever
+// tuh_task_ext() runs, RTOS application should give it a timeout instead of waiting forever
+#ifndef CFG_TUH_AUTO_SUSPEND
+  #define CFG_TUH_AUTO_SUSPEND 0
+#endif
+
+// Support timeout_ms of tuh_xfer_t for tuh_control_xfer() and tuh_edpt_xfer(): a transfer which is not complete in
+// time, e.g device NAKs forever, is aborted and completed with XFER_RESULT_TIMEOUT so that it does not hold up the
+// endpoint or, for control transfer, the bus of other devices. Checked by tuh_task_ext(), which does not wait past the
+// earliest deadline. Control transfer is timed from its setup packet, queued transfers from their start.
+#ifndef CFG_TUH_XFER_TIMEOUT
+  #define CFG_TUH_XFER_TIMEOUT 0
+#endif
+
+// Number of event queues (1-4) for root ports, events of rhport n go to queue (n % CFG_TUH_TASK_RHPORT_NUM). Each root
+// port can then run tuh_task_rhport_ext() in its own RTOS thread, so that its events are not held up behind another
+// port's enumeration or class callbacks. tuh_task() still services all of them but only waits on the first queue.
+// Note: shared state is protected by a task lock in this mode, blocking (sync) API must not be called from callbacks.
+#ifndef CFG_TUH_TASK_RHPORT_NUM
+  #define CFG_TUH_TASK_RHPORT_NUM 1
+#endif
+
+// Collect per-endpoint and event queue statistics, see tuh_stats_get()
+#ifndef CFG_TUH_STATS
+  #define CFG_TUH_STATS 0
+#endif
+
+// Invoke tuh_int_enter_cb()/tuh_int_exit_cb() around hcd_int_handler() when called via tuh_int_handler()
+#ifndef CFG_TUH_INT_HOOK
+  #define CFG_TUH_INT_HOOK 0
+#endif
+
+// DWC2 device: use internal buffer DMA (if core is synthesized with it) instead of slave mode (CPU copying FIFO).
+// Endpoint buffers must be word aligned and DMA accessible. dcd_edpt_xfer_fifo() is not supported in DMA mode.
+// Enabled by default on ESP32-S2/S3 (when built with dcd_dwc2): FIFO copying in ISR competes with Wi-Fi interrupts,
+// endpoint buffers must then be placed in internal RAM (not PSRAM)
+#ifndef CFG_TUD_DWC2_DMA
+  #if TU_CHECK_MCU(OPT_MCU_ESP32S2, OPT_MCU_ESP32S3)
+    #define CFG_TUD_DWC2_DMA 1
+  #else
+    #define CFG_TUD_DWC2_DMA 0
+  #endif
+#endif
+
+// DWC2 host: use internal buffer DMA (if core is synthesized with it) instead of slave mode (CPU copying FIFO).
+// Transfer buffers must be word aligned and DMA accessible
+#ifndef CFG_TUH_DWC2_DMA
+  #define CFG_TUH_DWC2_DMA 0
+#endif
+
+// MUSB device (MSP432E4): move bulk packets with the integrated DMA controller in request mode 1.
+// Only word aligned buffers use DMA, others and dcd_edpt_xfer_fifo() fall back to CPU copying
+#ifndef CFG_TUD_MUSB_DMA
+  #define CFG_TUD_MUSB_DMA 0
+#endif
+
+// MUSB host (TM4C/MSP432E4): number of bulk endpoints that can take turns on a hardware pipe once all 7 pipes
+// of a direction are in use, e.g. with several devices behind a hub. 0 disables pipe sharing
+#ifndef CFG_TUH_MUSB_SHARED_EP_MAX
+  #define CFG_TUH_MUSB_SHARED_EP_MAX 8
+#endif
+
+// MUSB host (MSP432E4): move bulk packets with the integrated DMA controller in request mode 1.
+// Only word aligned buffers use DMA, others fall back to CPU copying
+#ifndef CFG_TUH_MUSB_DMA
+  #define CFG_TUH_MUSB_DMA 0
+#endif
+
 // Enable PIO-USB software host controller
 #ifndef CFG_TUH_RPI_PIO_USB
   #define CFG_TUH_RPI_PIO_USB 0
 #endif
 
+// Run PIO-USB host frame engine on core1 (launched by tuh_init) while tuh_task() runs on core0.
+// Core1 is dedicated to it, and SIO_IRQ_PROC0 (inter-core FIFO) of core0 is used to pass events.
+#ifndef CFG_TUH_RPI_PIO_USB_CORE1
+  #define CFG_TUH_RPI_PIO_USB_CORE1 0
+#endif
+
 #ifndef CFG_TUD_RPI_PIO_USB
   #define CFG_TUD_RPI_PIO_USB 0
 #endif
@@ -534,6 +917,67 @@
   #define CFG_TUH_MAX3421  0
 #endif
 
+// Number of qTDs an EHCI transfer can be chained into, each covers at least 16 KiB. 4 allows the full 64 KiB
+// of hcd_edpt_xfer() with a single interrupt, see CFG_TUH_LARGE_XFER for even larger transfers.
+#ifndef CFG_TUH_EHCI_QTD_PER_XFER
+  #define CFG_TUH_EHCI_QTD_PER_XFER  1
+#endif
+
+// Number of isochronous endpoints EHCI can open at the same time: iTD for highspeed, siTD for full speed device
+// behind a transaction translator. 0 disables isochronous transfer.
+#ifndef CFG_TUH_EHCI_ISO_EP_MAX
+  #define CFG_TUH_EHCI_ISO_EP_MAX  0
+#endif
+
+// Number of service intervals an EHCI isochronous transfer can span, each takes one iTD/siTD (frame). All of
+// them must be scheduled within the periodic frame list, which is only 8 frames on ChipIdea.
+#ifndef CFG_TUH_EHCI_ISO_FRAME_PER_XFER
+  #define CFG_TUH_EHCI_ISO_FRAME_PER_XFER  4
+#endif
+
+// Number of general TDs an OHCI transfer can be chained into, each covers at least 4 KiB (8 KiB if page aligned)
+#ifndef CFG_TUH_OHCI_GTD_PER_XFER
+  #define CFG_TUH_OHCI_GTD_PER_XFER  1
+#endif
+
+// Number of isochronous endpoints OHCI can open at the same time, each has one iTD of up to 8 frames (packets).
+// 0 disables isochronous transfer.
+#ifndef CFG_TUH_OHCI_ISO_EP_MAX
+  #define CFG_TUH_OHCI_ISO_EP_MAX  0
+#endif
+
+//--------------------------------------------------------------------+
+// Bridge Options (Default)
+//--------------------------------------------------------------------+
+
+// Number of channels forwarding between host and device stack endpoints, see bridge/bridge.h. 0 is disabled
+#ifndef CFG_TUSB_BRIDGE
+  #define CFG_TUSB_BRIDGE 0
+#endif
+
+#if CFG_TUSB_BRIDGE && !(CFG_TUD_ENABLED && CFG_TUH_ENABLED && CFG_TUH_API_EDPT_XFER)
+  #error "CFG_TUSB_BRIDGE requires both device and host stack enabled, and CFG_TUH_API_EDPT_XFER"
+#endif
+
+// Number of device MSC LUNs passing SCSI commands through to drives attached to host stack, see bridge/bridge_msc.h.
+// 0 is disabled
+#ifndef CFG_TUSB_BRIDGE_MSC
+  #define CFG_TUSB_BRIDGE_MSC 0
+#endif
+
+#if CFG_TUSB_BRIDGE_MSC && !(CFG_TUD_MSC && CFG_TUH_MSC)
+  #error "CFG_TUSB_BRIDGE_MSC requires both CFG_TUD_MSC and CFG_TUH_MSC"
+#endif
+
+// Relay serial adapters attached to host stack to device CDC interfaces, see bridge/bridge_cdc.h. 0 is disabled
+#ifndef CFG_TUSB_BRIDGE_CDC
+  #define CFG_TUSB_BRIDGE_CDC 0
+#endif
+
+#if CFG_TUSB_BRIDGE_CDC && !(CFG_TUD_CDC && CFG_TUH_CDC)
+  #error "CFG_TUSB_BRIDGE_CDC requires both CFG_TUD_CDC and CFG_TUH_CDC"
+#endif
+
 //--------------------------------------------------------------------+
 // TypeC Options (Default)
 //--------------------------------------------------------------------+
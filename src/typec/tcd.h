@@ -46,6 +46,7 @@ enum {
   TCD_EVENT_CC_CHANGED,
   TCD_EVENT_RX_COMPLETE,
   TCD_EVENT_TX_COMPLETE,
+  TCD_EVENT_TIMEOUT,
 };
 
 typedef struct TU_ATTR_PACKED {
@@ -85,9 +86,21 @@ void tcd_int_handler(uint8_t rhport);
 //
 //--------------------------------------------------------------------+
 
+// Receive next message into buffer. TCD must reply GoodCRC to a message received without error (except GoodCRC
+// itself) on its own in ISR or hardware, before notifying the stack with tcd_event_rx_complete().
+// Stack queues the next buffer from the rx complete event handler (ISR) so that back-to-back messages are not lost.
 bool tcd_msg_receive(uint8_t rhport, uint8_t* buffer, uint16_t total_bytes);
+
+// Send a message. tcd_event_tx_complete() is only notified for this message, not for GoodCRC sent by TCD.
 bool tcd_msg_send(uint8_t rhport, uint8_t const* buffer, uint16_t total_bytes);
 
+// Start one-shot timer, tcd_event_timeout() is notified when it expires. Used as CRCReceiveTimer to retransmit
+// a message whose GoodCRC is not received within tReceive. Optional, messages are not retried without it.
+TU_ATTR_WEAK void tcd_timer_start(uint8_t rhport, uint32_t timeout_us);
+
+// Stop timer started by tcd_timer_start()
+TU_ATTR_WEAK void tcd_timer_stop(uint8_t rhport);
+
 //--------------------------------------------------------------------+
 // Event API (implemented by stack)
 // Called by TCD to notify stack
@@ -136,6 +149,16 @@ void tcd_event_tx_complete(uint8_t rhport, uint16_t xferred_bytes, uint8_t resul
   tcd_event_handler(&event, in_isr);
 }
 
+TU_ATTR_ALWAYS_INLINE static inline
+void tcd_event_timeout(uint8_t rhport, bool in_isr) {
+  tcd_event_t event = {
+      .rhport   = rhport,
+      .event_id = TCD_EVENT_TIMEOUT,
+  };
+
+  tcd_event_handler(&event, in_isr);
+}
+
 #ifdef __cplusplus
 }
 #endif
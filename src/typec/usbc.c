@@ -51,9 +51,28 @@ static bool _usbc_inited = false;
 // if port is initialized
 static bool _port_inited[TUP_TYPEC_RHPORTS_NUM];
 
-// Max possible PD size is 262 bytes
-static uint8_t _rx_buf[64] TU_ATTR_ALIGNED(4);
-static uint8_t _tx_buf[64] TU_ATTR_ALIGNED(4);
+// tReceive: GoodCRC must be received within 0.9 - 1.1 ms after sending a message
+#define PD_T_RECEIVE_US  1000
+
+// Protocol layer state of a port: message buffers, MessageID and retries are handled in ISR (tcd_event_handler)
+// so that GoodCRC, retransmission and reception of back-to-back messages do not depend on tuc_task() latency.
+typedef struct {
+  // Max possible PD size is 262 bytes
+  TU_ATTR_ALIGNED(4) uint8_t rx_buf[CFG_TUC_RX_BUFCOUNT][64];
+  TU_ATTR_ALIGNED(4) uint8_t tx_buf[64];
+
+  uint8_t rx_wr;      // buffer armed for reception
+  uint8_t rx_rd;      // oldest received message, processed by task
+  uint8_t rx_count;   // number of received messages waiting for task
+  int8_t  rx_msg_id;  // MessageID of last received message, -1 if none
+
+  uint8_t tx_msg_id;  // MessageIDCounter
+  uint8_t tx_retry;
+  uint16_t tx_len;
+  volatile bool tx_busy; // message is sent, waiting for GoodCRC
+} usbc_port_t;
+
+static usbc_port_t _usbc_port[TUP_TYPEC_RHPORTS_NUM];
 
 bool usbc_msg_send(uint8_t rhport, pd_header_t const* header, void const* data);
 bool parse_msg_data(uint8_t rhport, pd_header_t const* header, uint8_t const* dobj, uint8_t const* p_end);
@@ -85,6 +104,10 @@ bool tuc_init(uint8_t rhport, uint32_t port_type) {
   TU_LOG_USBC("USBC init on port %u\r\n", rhport);
   TU_LOG_INT(USBC_DEBUG, sizeof(tcd_event_t));
 
+  usbc_port_t* port = &_usbc_port[rhport];
+  tu_memclr(port, sizeof(usbc_port_t));
+  port->rx_msg_id = -1;
+
   TU_ASSERT(tcd_init(rhport, port_type));
   tcd_int_enable(rhport);
 
@@ -107,25 +130,28 @@ void tuc_task_ext(uint32_t timeout_ms, bool in_isr) {
       case TCD_EVENT_CC_CHANGED:
         break;
 
-      case TCD_EVENT_RX_COMPLETE:
-        // TODO process message here in ISR, move to thread later
-        if (event.xfer_complete.result == XFER_RESULT_SUCCESS) {
-          pd_header_t const* header = (pd_header_t const*) _rx_buf;
-
-          if (header->n_data_obj == 0) {
-            parse_msg_control(event.rhport, header);
+      case TCD_EVENT_RX_COMPLETE: {
+        // only messages accepted by protocol layer in ISR are queued, in order of reception
+        usbc_port_t* port = &_usbc_port[event.rhport];
+        uint8_t const* rx_buf = port->rx_buf[port->rx_rd];
+        pd_header_t const* header = (pd_header_t const*) rx_buf;
 
-          }else {
-            uint8_t const* p_end = _rx_buf + event.xfer_complete.xferred_bytes;
-            uint8_t const * dobj = _rx_buf + sizeof(pd_header_t);
+        if (header->n_data_obj == 0) {
+          parse_msg_control(event.rhport, header);
+        }else {
+          uint8_t const* p_end = rx_buf + event.xfer_complete.xferred_bytes;
+          uint8_t const * dobj = rx_buf + sizeof(pd_header_t);
 
-            parse_msg_data(event.rhport, header, dobj, p_end);
-          }
+          parse_msg_data(event.rhport, header, dobj, p_end);
         }
 
-        // prepare for next message
-        tcd_msg_receive(event.rhport, _rx_buf, sizeof(_rx_buf));
+        // release buffer
+        usbc_int_set(false);
+        port->rx_rd = (uint8_t) ((port->rx_rd + 1) % CFG_TUC_RX_BUFCOUNT);
+        port->rx_count--;
+        usbc_int_set(true);
         break;
+      }
 
       case TCD_EVENT_TX_COMPLETE:
         break;
@@ -156,16 +182,31 @@ bool parse_msg_control(uint8_t rhport, pd_header_t const* header) {
 //--------------------------------------------------------------------+
 
 bool usbc_msg_send(uint8_t rhport, pd_header_t const* header, void const* data) {
-  // copy header
-  memcpy(_tx_buf, header, sizeof(pd_header_t));
+  usbc_port_t* port = &_usbc_port[rhport];
+
+  // A previous message still waiting for GoodCRC is abandoned: policy engine has moved on
+  usbc_int_set(false);
+  if (port->tx_busy && tcd_timer_stop) {
+    tcd_timer_stop(rhport);
+  }
+  port->tx_busy = false;
+  usbc_int_set(true);
+
+  // copy header, MessageID is managed by protocol layer
+  memcpy(port->tx_buf, header, sizeof(pd_header_t));
+  ((pd_header_t*) port->tx_buf)->msg_id = port->tx_msg_id & 0x07u;
 
   // copy data objcet if available
   uint16_t const n_data_obj = header->n_data_obj;
   if (n_data_obj > 0) {
-    memcpy(_tx_buf + sizeof(pd_header_t), data, n_data_obj * 4);
+    memcpy(port->tx_buf + sizeof(pd_header_t), data, n_data_obj * 4);
   }
 
-  return tcd_msg_send(rhport, _tx_buf, sizeof(pd_header_t) + n_data_obj * 4);
+  port->tx_len = (uint16_t) (sizeof(pd_header_t) + n_data_obj * 4);
+  port->tx_retry = 0;
+  port->tx_busy = true;
+
+  return tcd_msg_send(rhport, port->tx_buf, port->tx_len);
 }
 
 bool tuc_msg_request(uint8_t rhport, void const* rdo) {
@@ -174,7 +215,7 @@ bool tuc_msg_request(uint8_t rhport, void const* rdo) {
       .data_role = PD_DATA_ROLE_UFP,
       .specs_rev = PD_REV_30,
       .power_role = PD_POWER_ROLE_SINK,
-      .msg_id = 0,
+      .msg_id = 0, // set by protocol layer
       .n_data_obj = 1,
       .extended = 0,
   };
@@ -182,18 +223,122 @@ bool tuc_msg_request(uint8_t rhport, void const* rdo) {
   return usbc_msg_send(rhport, &header, rdo);
 }
 
+// Message is acknowledged with GoodCRC or retries are exhausted
+static void tx_complete(uint8_t rhport, bool success, bool in_isr) {
+  usbc_port_t* port = &_usbc_port[rhport];
+  port->tx_busy = false;
+
+  if (success) {
+    port->tx_msg_id = (port->tx_msg_id + 1) & 0x07u;
+  }
+
+  tcd_event_t const event = {
+      .rhport   = rhport,
+      .event_id = TCD_EVENT_TX_COMPLETE,
+      .xfer_complete = {
+          .xferred_bytes = success ? port->tx_len : 0,
+          .result        = success ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED
+      }
+  };
+  osal_queue_send(_usbc_q, &event, in_isr);
+}
+
+// Protocol layer for received message, return true if it should be passed to task
+static bool rx_complete_isr(uint8_t rhport, tcd_event_t const * event, bool in_isr) {
+  usbc_port_t* port = &_usbc_port[rhport];
+
+  // CRC error: no GoodCRC is sent, partner will retry
+  if (event->xfer_complete.result != XFER_RESULT_SUCCESS) {
+    return false;
+  }
+
+  pd_header_t const* header = (pd_header_t const*) port->rx_buf[port->rx_wr];
+
+  if (header->n_data_obj == 0 && header->msg_type == PD_CTRL_GOOD_CRC) {
+    // GoodCRC for our message
+    if (port->tx_busy && header->msg_id == port->tx_msg_id) {
+      if (tcd_timer_stop) {
+        tcd_timer_stop(rhport);
+      }
+      tx_complete(rhport, true, in_isr);
+    }
+    return false;
+  }
+
+  if (header->n_data_obj == 0 && header->msg_type == PD_CTRL_SOFT_RESET) {
+    // Soft Reset resets MessageID counters
+    port->tx_msg_id = 0;
+  } else if (header->msg_id == port->rx_msg_id) {
+    // retransmission since partner missed our GoodCRC, already passed to task
+    return false;
+  }
+  port->rx_msg_id = (int8_t) header->msg_id;
+
+  // keep one buffer armed for reception, drop message if application is too far behind
+  if (port->rx_count + 1 >= CFG_TUC_RX_BUFCOUNT) {
+    TU_LOG_USBC("USBC RX overflow\r\n");
+    return false;
+  }
+
+  port->rx_count++;
+  port->rx_wr = (uint8_t) ((port->rx_wr + 1) % CFG_TUC_RX_BUFCOUNT);
+
+  return true;
+}
+
 void tcd_event_handler(tcd_event_t const * event, bool in_isr) {
-  (void) in_isr;
+  uint8_t const rhport = event->rhport;
+  usbc_port_t* port = &_usbc_port[rhport];
+
   switch(event->event_id) {
     case TCD_EVENT_CC_CHANGED:
       if (event->cc_changed.cc_state[0] || event->cc_changed.cc_state[1]) {
         // Attach, start receiving
-        tcd_msg_receive(event->rhport, _rx_buf, sizeof(_rx_buf));
+        tcd_msg_receive(rhport, port->rx_buf[port->rx_wr], sizeof(port->rx_buf[0]));
       }else {
         // Detach
+        port->rx_msg_id = -1;
+        port->tx_msg_id = 0;
+        port->tx_busy = false;
       }
       break;
 
+    case TCD_EVENT_RX_COMPLETE: {
+      bool const queued = rx_complete_isr(rhport, event, in_isr);
+
+      // receive next message right away
+      tcd_msg_receive(rhport, port->rx_buf[port->rx_wr], sizeof(port->rx_buf[0]));
+
+      if (!queued) return;
+      break;
+    }
+
+    case TCD_EVENT_TX_COMPLETE:
+      if (!port->tx_busy) return;
+
+      if (event->xfer_complete.result == XFER_RESULT_SUCCESS) {
+        // sent, wait for GoodCRC (CRCReceiveTimer)
+        if (tcd_timer_start) {
+          tcd_timer_start(rhport, PD_T_RECEIVE_US);
+        }
+      } else {
+        // discarded since a message is being received, or failed: report to policy engine
+        tx_complete(rhport, false, in_isr);
+      }
+      return; // completion is reported by tx_complete()
+
+    case TCD_EVENT_TIMEOUT:
+      // GoodCRC not received: retransmit with the same MessageID
+      if (port->tx_busy) {
+        if (port->tx_retry < CFG_TUC_PD_RETRY_COUNT) {
+          port->tx_retry++;
+          tcd_msg_send(rhport, port->tx_buf, port->tx_len);
+        } else {
+          tx_complete(rhport, false, in_isr);
+        }
+      }
+      return;
+
     default: break;
   }
 
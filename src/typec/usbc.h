@@ -42,6 +42,17 @@ extern "C" {
 #define CFG_TUC_TASK_QUEUE_SZ   8
 #endif
 
+// Number of message buffers per port. Received messages are queued from ISR while application is busy,
+// one buffer is always kept armed for reception.
+#ifndef CFG_TUC_RX_BUFCOUNT
+#define CFG_TUC_RX_BUFCOUNT     3
+#endif
+
+// Number of retransmissions when GoodCRC is not received (nRetryCount), 2 for PD 3.0, 3 for PD 2.0
+#ifndef CFG_TUC_PD_RETRY_COUNT
+#define CFG_TUC_PD_RETRY_COUNT  2
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
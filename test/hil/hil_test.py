@@ -33,6 +33,8 @@ import serial
 import subprocess
 import json
 import glob
+import mmap
+import statistics
 
 # for RPI double reset
 try:
@@ -43,6 +45,12 @@ except ImportError:
 
 ENUM_TIMEOUT = 10
 
+# performance measurements
+PERF_CDC_ROUNDS = 200
+PERF_MSC_DURATION = 3
+PERF_AUDIO_DURATION = 10
+PERF_AUDIO_WINDOW = 2
+
 
 # get usb serial by id
 def get_serial_dev(id, vendor_str, product_str, ifnum):
@@ -58,7 +66,6 @@ def get_serial_dev(id, vendor_str, product_str, ifnum):
         return port_list[0]
 
 
-# Currently not used, left as reference
 def get_disk_dev(id, vendor_str, lun):
     # get usb disk by id
     return f'/dev/disk/by-id/usb-{vendor_str}_Mass_Storage_{id}-0:{lun}'
@@ -68,6 +75,20 @@ def get_hid_dev(id, vendor_str, product_str, event):
     return f'/dev/input/by-id/usb-{vendor_str}_{product_str}_{id}-{event}'
 
 
+def get_sound_card(id, vendor_str, product_str):
+    # /dev/snd/by-id/ links to controlC<N>, return ALSA card number
+    dev = f'/dev/snd/by-id/usb-{vendor_str}_{product_str}_{id}-00'
+    timeout = ENUM_TIMEOUT
+    while timeout:
+        if os.path.exists(dev):
+            return int(os.path.realpath(dev).split('controlC')[-1])
+        time.sleep(1)
+        timeout = timeout - 1
+
+    assert timeout, 'Device not available'
+    return None
+
+
 def open_serial_dev(port):
     timeout = ENUM_TIMEOUT
     ser = None
@@ -300,13 +321,118 @@ def test_hid_composite_freertos(id):
     pass
 
 
+def test_audio_test(id):
+    get_sound_card(id, 'TinyUSB', 'TinyUSB_Device')
+
+
+# -------------------------------------------------------------
+# Performance
+# Run after the functional test of the same name, with the same firmware. Each returns a dict of metrics which is
+# stored per board and checked against the board's "perf" thresholds in config file.
+# -------------------------------------------------------------
+def perf_cdc_msc(id):
+    metrics = {}
+
+    # CDC echo round trip of a short string
+    port = get_serial_dev(id, 'TinyUSB', "TinyUSB_Device", 0)
+    ser = open_serial_dev(port)
+    ser.reset_input_buffer()
+    latency = []
+    for i in range(PERF_CDC_ROUNDS):
+        data = f'{i:08d}'.encode()
+        start = time.perf_counter()
+        ser.write(data)
+        ser.flush()
+        echo = ser.read(len(data))
+        latency.append((time.perf_counter() - start) * 1000)
+        assert echo == data, 'CDC wrong data'
+    ser.close()
+
+    latency.sort()
+    metrics['cdc_latency_ms'] = round(statistics.median(latency), 3)
+    metrics['cdc_latency_p99_ms'] = round(latency[int(len(latency) * 0.99) - 1], 3)
+
+    # MSC sequential read/write of the whole disk, bypassing page cache. Write puts back the same content
+    disk = get_disk_dev(id, 'TinyUSB', 0)
+    fd = os.open(disk, os.O_RDWR | os.O_DIRECT | os.O_SYNC)
+    try:
+        size = os.lseek(fd, 0, os.SEEK_END)
+        buf = mmap.mmap(-1, size)  # page aligned as required by O_DIRECT
+        for name, op in [('msc_read_kBps', os.preadv), ('msc_write_kBps', os.pwritev)]:
+            total = 0
+            start = time.perf_counter()
+            while time.perf_counter() - start < PERF_MSC_DURATION:
+                assert op(fd, [buf], 0) == size, 'MSC short transfer'
+                total += size
+            metrics[name] = round(total / 1024 / (time.perf_counter() - start), 1)
+    finally:
+        os.close(fd)
+
+    return metrics
+
+
+def perf_cdc_msc_freertos(id):
+    return perf_cdc_msc(id)
+
+
+def perf_audio_test(id):
+    # Record microphone stream and compare data rate against nominal sample rate: overall and per window, in ppm.
+    # Window deviation includes host scheduling jitter, long window keeps it small
+    sample_rate = 48000
+    frame_bytes = 2
+    card = get_sound_card(id, 'TinyUSB', 'TinyUSB_Device')
+    proc = subprocess.Popen(f'arecord -q -D hw:{card},0 -f S16_LE -c 1 -r {sample_rate} -t raw',
+                            shell=True, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    try:
+        # discard startup while stream settles
+        proc.stdout.read(sample_rate * frame_bytes // 2)
+
+        window_ppm = []
+        total = 0
+        start = time.perf_counter()
+        while time.perf_counter() - start < PERF_AUDIO_DURATION:
+            w_start = time.perf_counter()
+            w_total = 0
+            while time.perf_counter() - w_start < PERF_AUDIO_WINDOW:
+                data = proc.stdout.read(1024)
+                assert data, 'Audio stream stopped'
+                w_total += len(data)
+            rate = w_total / frame_bytes / (time.perf_counter() - w_start)
+            window_ppm.append((rate - sample_rate) * 1e6 / sample_rate)
+            total += w_total
+        rate = total / frame_bytes / (time.perf_counter() - start)
+    finally:
+        proc.kill()
+        proc.wait()
+
+    return {
+        'audio_rate_ppm': round(abs(rate - sample_rate) * 1e6 / sample_rate, 1),
+        'audio_window_ppm': round(max(abs(p) for p in window_ppm), 1),
+    }
+
+
+def check_perf(thresholds, metrics):
+    # threshold of a metric is {"min": x} and/or {"max": y}
+    failed = []
+    for name, limit in thresholds.items():
+        assert name in metrics, f'Unknown performance metric {name}'
+        value = metrics[name]
+        if 'min' in limit and value < limit['min']:
+            failed.append(f'{name} {value} < {limit["min"]}')
+        if 'max' in limit and value > limit['max']:
+            failed.append(f'{name} {value} > {limit["max"]}')
+    return failed
+
+
 # -------------------------------------------------------------
 # Main
 # -------------------------------------------------------------
 @click.command()
 @click.argument('config_file')
 @click.option('-b', '--board', multiple=True, default=None, help='Boards to test, all if not specified')
-def main(config_file, board):
+@click.option('--perf/--no-perf', default=True, help='Run performance measurements')
+@click.option('-o', '--perf-output', default='hil_perf.json', help='File to store performance results per board')
+def main(config_file, board, perf, perf_output):
     """
     Hardware test on specified boards
     """
@@ -314,6 +440,12 @@ def main(config_file, board):
     with open(config_file) as f:
         config = json.load(f)
 
+    # keep results of boards not tested in this run
+    perf_results = {}
+    if perf and os.path.isfile(perf_output):
+        with open(perf_output) as f:
+            perf_results = json.load(f)
+
     # all possible tests
     all_tests = [
         'cdc_dual_ports', 'cdc_msc', 'dfu', 'dfu_runtime', 'hid_boot_interface',
@@ -378,6 +510,17 @@ def main(config_file, board):
             # run test
             globals()[f'test_{test}'](item['uid'])
 
+            # performance measurement with the same firmware
+            if perf and f'perf_{test}' in globals():
+                metrics = globals()[f'perf_{test}'](item['uid'])
+                perf_results.setdefault(item['name'], {})[test] = metrics
+                with open(perf_output, 'w') as f:
+                    json.dump(perf_results, f, indent=4)
+
+                print(', '.join(f'{k}={v}' for k, v in metrics.items()), end=' ')
+                failed = check_perf(item.get('perf', {}).get(test, {}), metrics)
+                assert not failed, 'Performance regression: ' + ', '.join(failed)
+
             print('OK')
 
 
@@ -0,0 +1,475 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Virtual device controller (DCD) and host controller (HCD) wired together in one process: the host stack
+ * enumerates and drives the device stack through an emulated bus, without any hardware.
+ *
+ * - Everything is synchronous and deterministic: a transfer moves data as soon as both sides have submitted it,
+ *   completion events are queued right away and picked up by the next tud_task()/tuh_task().
+ * - Data is copied once from sender to receiver buffer, endpoint max packet size only decides whether the sender's
+ *   last packet is short and therefore ends the receiver's transfer. Frames, bandwidth and NAK are not emulated.
+ * - Single device on the root port, no hub, device address is not checked.
+ * - Time only advances by osal_task_delay(), which also runs the device task. Main loop calls it whenever the stacks
+ *   are idle so that timed waits e.g enumeration delays cost nothing.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_MCU == OPT_MCU_LOOPBACK && CFG_TUD_ENABLED && CFG_TUH_ENABLED
+
+#include "device/dcd.h"
+#include "device/usbd.h"
+#include "host/hcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define LB_EPNUM_MAX  16
+
+typedef struct {
+  uint8_t* buf;
+  tu_fifo_t* ff; // device transfer from/to fifo instead of buf
+  uint16_t len;
+  uint16_t done;
+  bool busy;
+} lb_side_t;
+
+// One direction of an endpoint, as seen from both ends of the wire
+typedef struct {
+  lb_side_t dev;
+  lb_side_t host;
+  uint8_t host_daddr; // address the host transfer was submitted to
+  uint16_t mps;
+  bool stalled;
+} lb_pipe_t;
+
+static struct {
+  uint8_t dev_rhport;
+  uint8_t host_rhport;
+  bool dev_initialized;
+  bool host_initialized;
+  bool connected; // device pull-up
+  bool suspended; // host port suspended
+  tusb_speed_t speed;
+  uint32_t frame;
+
+  bool servicing; // re-entrancy guard, completion may submit next transfer right away
+  bool rescan;
+
+  lb_pipe_t pipe[LB_EPNUM_MAX][2];
+} _lb;
+
+TU_ATTR_ALWAYS_INLINE static inline lb_pipe_t* get_pipe(uint8_t ep_addr) {
+  return &_lb.pipe[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+//--------------------------------------------------------------------+
+// Wire
+//--------------------------------------------------------------------+
+
+static void complete_dev(uint8_t ep_addr, lb_pipe_t* pipe, xfer_result_t result) {
+  pipe->dev.busy = false;
+  dcd_event_xfer_complete(_lb.dev_rhport, ep_addr, pipe->dev.done, (uint8_t) result, true);
+}
+
+static void complete_host(uint8_t ep_addr, lb_pipe_t* pipe, xfer_result_t result) {
+  pipe->host.busy = false;
+
+  hcd_event_t event = {
+    .rhport   = _lb.host_rhport,
+    .event_id = HCD_EVENT_XFER_COMPLETE,
+    .dev_addr = pipe->host_daddr,
+  };
+  event.xfer_complete.ep_addr = ep_addr;
+  event.xfer_complete.result  = (uint8_t) result;
+  event.xfer_complete.len     = pipe->host.done;
+  hcd_event_handler(&event, true);
+}
+
+// Move data of a pipe whose both ends are armed, return true if a transfer completed
+static bool pipe_transfer(uint8_t ep_addr, lb_pipe_t* pipe) {
+  if (pipe->stalled && pipe->host.busy) {
+    complete_host(ep_addr, pipe, XFER_RESULT_STALLED);
+    return true;
+  }
+
+  if (!(pipe->dev.busy && pipe->host.busy)) return false;
+
+  bool const is_in = (tu_edpt_dir(ep_addr) == TUSB_DIR_IN);
+  lb_side_t* tx = is_in ? &pipe->dev : &pipe->host;
+  lb_side_t* rx = is_in ? &pipe->host : &pipe->dev;
+
+  uint16_t const count = tu_min16(tx->len - tx->done, rx->len - rx->done);
+  if (count) {
+    if (tx->ff) {
+      tu_fifo_read_n(tx->ff, rx->buf + rx->done, count);
+    } else if (rx->ff) {
+      tu_fifo_write_n(rx->ff, tx->buf + tx->done, count);
+    } else {
+      memcpy(rx->buf + rx->done, tx->buf + tx->done, count);
+    }
+  }
+  tx->done += count;
+  rx->done += count;
+
+  bool const tx_complete = (tx->done == tx->len);
+
+  // a short packet (or zero-length packet) at the end of the sender's transfer ends the receiver's one
+  bool const rx_complete = (rx->done == rx->len) || (tx_complete && (tx->len % pipe->mps || tx->len == 0));
+
+  if (!tx_complete && !rx_complete) return false;
+
+  // sender first: it is the one that finished using the bus
+  if (is_in) {
+    if (tx_complete) complete_dev(ep_addr, pipe, XFER_RESULT_SUCCESS);
+    if (rx_complete) complete_host(ep_addr, pipe, XFER_RESULT_SUCCESS);
+  } else {
+    if (tx_complete) complete_host(ep_addr, pipe, XFER_RESULT_SUCCESS);
+    if (rx_complete) complete_dev(ep_addr, pipe, XFER_RESULT_SUCCESS);
+  }
+
+  return true;
+}
+
+// Move data on every pipe until nothing can progress. Called whenever either side submits or stalls.
+static void wire_service(void) {
+  if (_lb.servicing) {
+    _lb.rescan = true;
+    return;
+  }
+  _lb.servicing = true;
+
+  do {
+    _lb.rescan = false;
+    for (uint8_t epnum = 0; epnum < LB_EPNUM_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        if (pipe_transfer(tu_edpt_addr(epnum, dir), &_lb.pipe[epnum][dir])) _lb.rescan = true;
+      }
+    }
+  } while (_lb.rescan);
+
+  _lb.servicing = false;
+}
+
+static void side_reset(lb_side_t* side) {
+  side->busy = false;
+}
+
+static void bus_reset(void) {
+  for (uint8_t epnum = 0; epnum < LB_EPNUM_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      lb_pipe_t* pipe = &_lb.pipe[epnum][dir];
+      side_reset(&pipe->dev);
+      pipe->stalled = false;
+      if (epnum) pipe->mps = 0;
+    }
+  }
+}
+
+static void attach(bool connected) {
+  bool const changed = (_lb.connected != connected);
+  _lb.connected = connected;
+
+  if (!changed || !_lb.host_initialized) return;
+
+  if (connected) {
+    hcd_event_device_attach(_lb.host_rhport, true);
+  } else {
+    hcd_event_device_remove(_lb.host_rhport, true);
+  }
+}
+
+// Class drivers wait with osal_task_delay(), virtual time makes them instantaneous. Device firmware
+// keeps running while host waits e.g bus reset is processed before the first SETUP
+void osal_task_delay(uint32_t msec) {
+  static bool delaying = false;
+  _lb.frame += msec;
+
+  if (!delaying && _lb.dev_initialized) {
+    delaying = true;
+    tud_task_ext(0, false);
+    delaying = false;
+  }
+}
+
+//--------------------------------------------------------------------+
+// Device Controller API
+//--------------------------------------------------------------------+
+
+void dcd_init(uint8_t rhport) {
+  _lb.dev_rhport = rhport;
+  _lb.dev_initialized = true;
+  _lb.pipe[0][0].mps = _lb.pipe[0][1].mps = CFG_TUD_ENDPOINT0_SIZE;
+  attach(true);
+}
+
+void dcd_int_handler(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
+  (void) dev_addr;
+  // only one device on the wire, address is not checked. Just ACK the status stage
+  dcd_edpt_xfer(rhport, tu_edpt_addr(0, TUSB_DIR_IN), NULL, 0);
+}
+
+void dcd_remote_wakeup(uint8_t rhport) {
+  (void) rhport;
+  if (_lb.suspended && _lb.host_initialized) hcd_event_device_resume(_lb.host_rhport, true);
+}
+
+void dcd_connect(uint8_t rhport) {
+  (void) rhport;
+  attach(true);
+}
+
+void dcd_disconnect(uint8_t rhport) {
+  (void) rhport;
+  attach(false);
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en) {
+  (void) rhport;
+  (void) en;
+}
+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  TU_ASSERT(tu_edpt_number(desc_ep->bEndpointAddress) < LB_EPNUM_MAX);
+
+  lb_pipe_t* pipe = get_pipe(desc_ep->bEndpointAddress);
+  pipe->mps = tu_edpt_packet_size(desc_ep);
+  pipe->stalled = false;
+  side_reset(&pipe->dev);
+
+  return true;
+}
+
+void dcd_edpt_close_all(uint8_t rhport) {
+  (void) rhport;
+  for (uint8_t epnum = 1; epnum < LB_EPNUM_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      side_reset(&_lb.pipe[epnum][dir].dev);
+      _lb.pipe[epnum][dir].mps = 0;
+    }
+  }
+}
+
+void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  lb_pipe_t* pipe = get_pipe(ep_addr);
+  side_reset(&pipe->dev);
+  pipe->mps = 0;
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes) {
+  (void) rhport;
+  lb_pipe_t* pipe = get_pipe(ep_addr);
+  TU_ASSERT(!pipe->dev.busy);
+
+  pipe->dev = (lb_side_t) { .buf = buffer, .len = total_bytes, .done = 0, .busy = true };
+  wire_service();
+
+  return true;
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes) {
+  (void) rhport;
+  lb_pipe_t* pipe = get_pipe(ep_addr);
+  TU_ASSERT(!pipe->dev.busy);
+
+  pipe->dev = (lb_side_t) { .ff = ff, .len = total_bytes, .done = 0, .busy = true };
+  wire_service();
+
+  return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  get_pipe(ep_addr)->stalled = true;
+  wire_service();
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  get_pipe(ep_addr)->stalled = false;
+}
+
+//--------------------------------------------------------------------+
+// Host Controller API
+//--------------------------------------------------------------------+
+
+bool hcd_init(uint8_t rhport) {
+  _lb.host_rhport = rhport;
+  _lb.host_initialized = true;
+
+  // device connected before host is up
+  if (_lb.connected) hcd_event_device_attach(rhport, true);
+  return true;
+}
+
+void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  (void) rhport;
+  (void) in_isr;
+}
+
+void hcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void hcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+}
+
+uint32_t hcd_frame_number(uint8_t rhport) {
+  (void) rhport;
+  return _lb.frame;
+}
+
+bool hcd_port_connect_status(uint8_t rhport) {
+  (void) rhport;
+  return _lb.connected;
+}
+
+void hcd_port_reset(uint8_t rhport) {
+  (void) rhport;
+  bus_reset();
+  _lb.suspended = false;
+
+  // both ends run at the highest speed they support
+  bool const high_speed = TUD_OPT_HIGH_SPEED && TUH_OPT_HIGH_SPEED;
+  _lb.speed = high_speed ? TUSB_SPEED_HIGH : TUSB_SPEED_FULL;
+
+  if (_lb.dev_initialized) dcd_event_bus_reset(_lb.dev_rhport, _lb.speed, true);
+}
+
+void hcd_port_reset_end(uint8_t rhport) {
+  (void) rhport;
+}
+
+bool hcd_port_suspend(uint8_t rhport) {
+  (void) rhport;
+  TU_VERIFY(_lb.connected && !_lb.suspended);
+  _lb.suspended = true;
+  if (_lb.dev_initialized) dcd_event_bus_signal(_lb.dev_rhport, DCD_EVENT_SUSPEND, true);
+  return true;
+}
+
+void hcd_port_resume(uint8_t rhport) {
+  (void) rhport;
+  if (!_lb.suspended) return;
+  _lb.suspended = false;
+  if (_lb.dev_initialized) dcd_event_bus_signal(_lb.dev_rhport, DCD_EVENT_RESUME, true);
+}
+
+void hcd_port_resume_end(uint8_t rhport) {
+  (void) rhport;
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport) {
+  (void) rhport;
+  return _lb.speed;
+}
+
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
+  (void) rhport;
+  for (uint8_t epnum = 0; epnum < LB_EPNUM_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      lb_pipe_t* pipe = &_lb.pipe[epnum][dir];
+      if (pipe->host_daddr == dev_addr) side_reset(&pipe->host);
+    }
+  }
+}
+
+bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const* ep_desc) {
+  (void) rhport;
+  (void) daddr;
+  // device side defines the packet size
+  return tu_edpt_number(ep_desc->bEndpointAddress) < LB_EPNUM_MAX;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t buflen) {
+  (void) rhport;
+  TU_VERIFY(_lb.connected && !_lb.suspended);
+
+  lb_pipe_t* pipe = get_pipe(ep_addr);
+  TU_ASSERT(!pipe->host.busy);
+
+  pipe->host = (lb_side_t) { .buf = buffer, .len = buflen, .done = 0, .busy = true };
+  pipe->host_daddr = daddr;
+  wire_service();
+
+  return true;
+}
+
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) dev_addr;
+  lb_pipe_t* pipe = get_pipe(ep_addr);
+  bool const busy = pipe->host.busy;
+  side_reset(&pipe->host);
+  return busy;
+}
+
+bool hcd_setup_send(uint8_t rhport, uint8_t daddr, uint8_t const setup_packet[8]) {
+  (void) rhport;
+  TU_VERIFY(_lb.connected && !_lb.suspended);
+
+  // SETUP cancels whatever is pending on control endpoint and clears its stall
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    lb_pipe_t* pipe = &_lb.pipe[0][dir];
+    side_reset(&pipe->dev);
+    side_reset(&pipe->host);
+    pipe->stalled = false;
+    pipe->host_daddr = daddr;
+  }
+
+  dcd_event_setup_received(_lb.dev_rhport, setup_packet, true);
+
+  // SETUP is always acknowledged
+  lb_pipe_t* pipe = &_lb.pipe[0][TUSB_DIR_OUT];
+  pipe->host.done = 8;
+  complete_host(tu_edpt_addr(0, TUSB_DIR_OUT), pipe, XFER_RESULT_SUCCESS);
+
+  return true;
+}
+
+bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) dev_addr;
+  (void) ep_addr;
+  // halt is cleared on the device side by CLEAR_FEATURE request
+  return true;
+}
+
+#endif
@@ -0,0 +1,390 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2026 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/* Device and host stack talking to each other through the loopback controller (dcd_hcd_loopback.c) in a single
+ * process. Host enumerates the device, then runs MSC and CDC round trips and reports how much CPU time the two stacks
+ * spend per transfer. Since the wire costs nothing, the numbers are pure stack overhead, run it under perf or
+ * valgrind --tool=callgrind to see where it goes.
+ *
+ * Usage: loopback [rounds]
+ * Exit code is non-zero if enumeration fails or data is corrupted.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tusb.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF PROTOTYPES
+//--------------------------------------------------------------------+
+enum {
+  DISK_BLOCK_SIZE  = 512,
+  DISK_BLOCK_NUM   = 64,
+  MSC_XFER_BLOCKS  = 16,      // blocks per READ10/WRITE10
+  CDC_XFER_SIZE    = 1024,    // bytes per CDC echo round trip
+  DEFAULT_ROUNDS   = 1000,
+  STALL_LIMIT      = 1000000, // loop iterations without progress before giving up
+};
+
+typedef enum {
+  STATE_ENUM = 0,
+  STATE_MSC_WRITE,
+  STATE_MSC_READ,
+  STATE_MSC_WAIT,
+  STATE_CDC,
+  STATE_CDC_DIRECT,
+  STATE_DONE,
+  STATE_FAILED,
+} bench_state_t;
+
+static struct {
+  bench_state_t state;
+  uint32_t rounds;
+  uint32_t round;
+  uint32_t progress;
+
+  uint8_t msc_daddr;
+  bool msc_mounted;
+  bool cdc_mounted;
+  uint8_t cdc_idx;
+  uint32_t cdc_received;
+  bool cdc_sent;
+  bool cdc_reading;
+
+  uint64_t t_start;
+  uint64_t t_enum;
+  uint64_t t_msc;
+  uint64_t t_cdc;
+  uint64_t t_cdc_direct;
+} _bench;
+
+static uint8_t _disk[DISK_BLOCK_NUM][DISK_BLOCK_SIZE];
+static uint8_t _tx_buf[MSC_XFER_BLOCKS * DISK_BLOCK_SIZE];
+static uint8_t _rx_buf[MSC_XFER_BLOCKS * DISK_BLOCK_SIZE];
+
+static uint64_t time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static void fill_pattern(uint8_t* buf, uint32_t len, uint32_t seed) {
+  for (uint32_t i = 0; i < len; i++) {
+    buf[i] = (uint8_t) (i * 7 + seed);
+  }
+}
+
+static void bench_fail(char const* msg) {
+  printf("FAILED: %s (round %lu)\r\n", msg, (unsigned long) _bench.round);
+  _bench.state = STATE_FAILED;
+}
+
+static void report(char const* name, uint64_t ns, uint32_t xfer_count, uint32_t xfer_size) {
+  uint64_t const bytes = (uint64_t) xfer_count * xfer_size;
+  printf("%-4s %6lu x %5lu bytes: %8.3f us/xfer, %6.3f ns/byte, %8.1f MB/s\r\n", name,
+         (unsigned long) xfer_count, (unsigned long) xfer_size,
+         (double) ns / 1000.0 / xfer_count, (double) ns / (double) bytes, (double) bytes * 1000.0 / (double) ns);
+}
+
+//--------------------------------------------------------------------+
+// Host: MSC
+//--------------------------------------------------------------------+
+
+static bool msc_write_complete_cb(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  (void) daddr;
+  if (cb_data->csw->status != MSC_CSW_STATUS_PASSED) {
+    bench_fail("MSC write10");
+  } else {
+    _bench.state = STATE_MSC_READ;
+  }
+  return true;
+}
+
+static bool msc_read_complete_cb(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  (void) daddr;
+  if (cb_data->csw->status != MSC_CSW_STATUS_PASSED) {
+    bench_fail("MSC read10");
+  } else if (0 != memcmp(_tx_buf, _rx_buf, sizeof(_rx_buf))) {
+    bench_fail("MSC data mismatch");
+  } else {
+    _bench.round++;
+    _bench.state = STATE_MSC_WRITE;
+  }
+  return true;
+}
+
+static void msc_bench_task(void) {
+  switch (_bench.state) {
+    case STATE_MSC_WRITE:
+      if (_bench.round == _bench.rounds) {
+        _bench.t_msc = time_ns() - _bench.t_start;
+        _bench.round = 0;
+        _bench.cdc_received = 0;
+        _bench.t_start = time_ns();
+        _bench.state = STATE_CDC;
+        break;
+      }
+
+      fill_pattern(_tx_buf, sizeof(_tx_buf), _bench.round);
+      memset(_rx_buf, 0, sizeof(_rx_buf));
+      _bench.state = STATE_MSC_WAIT;
+      if (!tuh_msc_write10(_bench.msc_daddr, 0, _tx_buf, 0, MSC_XFER_BLOCKS, msc_write_complete_cb, 0)) {
+        bench_fail("MSC write10 submit");
+      }
+      break;
+
+    case STATE_MSC_READ:
+      _bench.state = STATE_MSC_WAIT;
+      if (!tuh_msc_read10(_bench.msc_daddr, 0, _rx_buf, 0, MSC_XFER_BLOCKS, msc_read_complete_cb, 0)) {
+        bench_fail("MSC read10 submit");
+      }
+      break;
+
+    default: break;
+  }
+}
+
+void tuh_msc_mount_cb(uint8_t dev_addr) {
+  _bench.msc_daddr = dev_addr;
+  _bench.msc_mounted = true;
+}
+
+void tuh_msc_umount_cb(uint8_t dev_addr) {
+  (void) dev_addr;
+  _bench.msc_mounted = false;
+}
+
+//--------------------------------------------------------------------+
+// Host: CDC
+//--------------------------------------------------------------------+
+
+static void cdc_bench_task(void) {
+  if (_bench.state != STATE_CDC) return;
+
+  if (_bench.round == _bench.rounds) {
+    _bench.t_cdc = time_ns() - _bench.t_start;
+    _bench.t_start = time_ns();
+    _bench.round = 0;
+    _bench.state = STATE_CDC_DIRECT;
+    return;
+  }
+
+  // new round: send the whole chunk, device echoes it back
+  if (_bench.cdc_received == 0 && tuh_cdc_read_available(_bench.cdc_idx) == 0 &&
+      tuh_cdc_write_available(_bench.cdc_idx) == CFG_TUH_CDC_TX_BUFSIZE) {
+    fill_pattern(_tx_buf, CDC_XFER_SIZE, _bench.round);
+    if (CDC_XFER_SIZE != tuh_cdc_write(_bench.cdc_idx, _tx_buf, CDC_XFER_SIZE)) {
+      bench_fail("CDC write");
+      return;
+    }
+    tuh_cdc_write_flush(_bench.cdc_idx);
+  }
+
+  uint32_t const count = tuh_cdc_read(_bench.cdc_idx, _rx_buf + _bench.cdc_received,
+                                      CDC_XFER_SIZE - _bench.cdc_received);
+  _bench.cdc_received += count;
+
+  if (_bench.cdc_received == CDC_XFER_SIZE) {
+    if (0 != memcmp(_tx_buf, _rx_buf, CDC_XFER_SIZE)) {
+      bench_fail("CDC data mismatch");
+      return;
+    }
+    _bench.cdc_received = 0;
+    _bench.round++;
+  }
+}
+
+static void cdc_read_direct_cb(uint8_t idx, void* buffer, uint32_t xferred_bytes) {
+  (void) idx;
+  (void) buffer;
+  _bench.cdc_received += xferred_bytes;
+  _bench.cdc_reading = false;
+}
+
+// same echo round trips, but received data goes straight into _rx_buf with tuh_cdc_read_direct()
+static void cdc_direct_bench_task(void) {
+  if (_bench.state != STATE_CDC_DIRECT || _bench.cdc_reading) return;
+
+  if (_bench.round == _bench.rounds) {
+    _bench.t_cdc_direct = time_ns() - _bench.t_start;
+    _bench.state = STATE_DONE;
+    return;
+  }
+
+  if (!_bench.cdc_sent) {
+    fill_pattern(_tx_buf, CDC_XFER_SIZE, _bench.round);
+    if (CDC_XFER_SIZE != tuh_cdc_write(_bench.cdc_idx, _tx_buf, CDC_XFER_SIZE)) {
+      bench_fail("CDC write");
+      return;
+    }
+    tuh_cdc_write_flush(_bench.cdc_idx);
+    _bench.cdc_sent = true;
+  }
+
+  if (_bench.cdc_received < CDC_XFER_SIZE) {
+    // callback can be invoked before returning if data is already in rx fifo
+    _bench.cdc_reading = true;
+    if (!tuh_cdc_read_direct(_bench.cdc_idx, _rx_buf + _bench.cdc_received, CDC_XFER_SIZE - _bench.cdc_received,
+                             cdc_read_direct_cb)) {
+      bench_fail("CDC read direct");
+    }
+    return;
+  }
+
+  if (0 != memcmp(_tx_buf, _rx_buf, CDC_XFER_SIZE)) {
+    bench_fail("CDC direct data mismatch");
+    return;
+  }
+  _bench.cdc_received = 0;
+  _bench.cdc_sent = false;
+  _bench.round++;
+}
+
+void tuh_cdc_mount_cb(uint8_t idx) {
+  _bench.cdc_idx = idx;
+  _bench.cdc_mounted = true;
+}
+
+void tuh_cdc_umount_cb(uint8_t idx) {
+  (void) idx;
+  _bench.cdc_mounted = false;
+}
+
+//--------------------------------------------------------------------+
+// Device: MSC RAM disk and CDC echo
+//--------------------------------------------------------------------+
+
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
+  (void) lun;
+  memcpy(vendor_id, "TinyUSB ", 8);
+  memcpy(product_id, "Loopback Disk   ", 16);
+  memcpy(product_rev, "1.0 ", 4);
+}
+
+bool tud_msc_test_unit_ready_cb(uint8_t lun) {
+  (void) lun;
+  return true;
+}
+
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size) {
+  (void) lun;
+  *block_count = DISK_BLOCK_NUM;
+  *block_size = DISK_BLOCK_SIZE;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  (void) lun;
+  if (lba >= DISK_BLOCK_NUM) return -1;
+  memcpy(buffer, &_disk[lba][offset], bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  (void) lun;
+  if (lba >= DISK_BLOCK_NUM) return -1;
+  memcpy(&_disk[lba][offset], buffer, bufsize);
+  return (int32_t) bufsize;
+}
+
+int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize) {
+  (void) buffer;
+  (void) bufsize;
+  tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+  (void) scsi_cmd;
+  return -1;
+}
+
+#if CFG_TUD_CDC_APP_FIFO_BUF
+uint8_t* tud_cdc_fifo_buffer_cb(uint8_t itf, bool is_tx, tu_fifo_size_t* bufsize) {
+  static uint8_t rx_ff_buf[CFG_TUD_CDC][CFG_TUD_CDC_RX_BUFSIZE];
+  static uint8_t tx_ff_buf[CFG_TUD_CDC][CFG_TUD_CDC_TX_BUFSIZE];
+  *bufsize = is_tx ? sizeof(tx_ff_buf[0]) : sizeof(rx_ff_buf[0]);
+  return is_tx ? tx_ff_buf[itf] : rx_ff_buf[itf];
+}
+#endif
+
+static void cdc_echo_task(void) {
+  uint8_t buf[CFG_TUD_CDC_EP_BUFSIZE];
+  uint32_t const count = tu_min32(tud_cdc_available(), tud_cdc_write_available());
+  if (count == 0) return;
+
+  uint32_t const len = tud_cdc_read(buf, tu_min32(count, sizeof(buf)));
+  tud_cdc_write(buf, len);
+  tud_cdc_write_flush();
+}
+
+//--------------------------------------------------------------------+
+// Main
+//--------------------------------------------------------------------+
+
+int main(int argc, char* argv[]) {
+  _bench.rounds = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : DEFAULT_ROUNDS;
+
+  _bench.t_start = time_ns();
+  tud_init(BOARD_TUD_RHPORT);
+  tuh_init(BOARD_TUH_RHPORT);
+
+  uint32_t idle = 0;
+  while (_bench.state != STATE_DONE && _bench.state != STATE_FAILED) {
+    tud_task();
+    tuh_task();
+    cdc_echo_task();
+
+    if (_bench.state == STATE_ENUM && _bench.msc_mounted && _bench.cdc_mounted) {
+      _bench.t_enum = time_ns() - _bench.t_start;
+      _bench.t_start = time_ns();
+      _bench.state = STATE_MSC_WRITE;
+    }
+
+    msc_bench_task();
+    cdc_bench_task();
+    cdc_direct_bench_task();
+
+    // detect a stuck stack: nothing moved for too long
+    uint32_t const progress = _bench.state * 0x10000u + _bench.round + _bench.cdc_received;
+    if (progress != _bench.progress) {
+      _bench.progress = progress;
+      idle = 0;
+    } else {
+      // let virtual time run while stacks wait for a timer e.g enumeration delays
+      osal_task_delay(1);
+      if (++idle > STALL_LIMIT) {
+        bench_fail(_bench.state == STATE_ENUM ? "enumeration timeout" : "transfer timeout");
+      }
+    }
+  }
+
+  if (_bench.state == STATE_FAILED) return 1;
+
+  printf("enumeration: %.3f ms\r\n", (double) _bench.t_enum / 1e6);
+  report("MSC", _bench.t_msc, 2 * _bench.rounds, sizeof(_tx_buf));
+  report("CDC", _bench.t_cdc, 2 * _bench.rounds, CDC_XFER_SIZE);
+  report("CDCd", _bench.t_cdc_direct, 2 * _bench.rounds, CDC_XFER_SIZE);
+
+  return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+TEST_FILE("usbd_control.c")
+TEST_FILE("audio_device.c")
+
+// Mock File
+#include "mock_dcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CTRL_OUT  = 0x00,
+  EDPT_CTRL_IN   = 0x80,
+
+  EDPT_AUDIO_IN  = 0x81,
+  EDPT_AUDIO_SZ  = 64,
+};
+
+uint8_t const rhport = 0;
+
+enum
+{
+  ITF_NUM_AUDIO_CONTROL,
+  ITF_NUM_AUDIO_STREAMING,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_AUDIO_MIC_ONE_CH_DESC_LEN)
+
+uint8_t const data_desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0, 100),
+
+  // Interface number, string index, bytes per sample, bits used per sample, EP In address, EP size
+  TUD_AUDIO_MIC_ONE_CH_DESCRIPTOR(ITF_NUM_AUDIO_CONTROL, 0, 2, 16, EDPT_AUDIO_IN, EDPT_AUDIO_SZ)
+};
+
+tusb_control_request_t const request_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0,
+  .wLength       = 0
+};
+
+tusb_control_request_t const request_set_alt_streaming =
+{
+  .bmRequestType = 0x01,
+  .bRequest      = TUSB_REQ_SET_INTERFACE,
+  .wValue        = 1,
+  .wIndex        = ITF_NUM_AUDIO_STREAMING,
+  .wLength       = 0
+};
+
+uint8_t tx_done_count;
+
+bool tud_audio_tx_done_post_load_cb(uint8_t rhport_, uint16_t n_bytes_copied, uint8_t func_id, uint8_t ep_in, uint8_t cur_alt_setting)
+{
+  (void) rhport_; (void) n_bytes_copied; (void) func_id; (void) ep_in; (void) cur_alt_setting;
+  tx_done_count++;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  return data_desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) langid;
+
+  return NULL;
+}
+
+void setUp(void)
+{
+  tx_done_count = 0;
+
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+
+  if ( !tud_inited() )
+  {
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+
+  dcd_event_bus_reset(rhport, TUSB_SPEED_HIGH, false);
+  tud_task();
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+
+// With CFG_TUD_AUDIO_XFER_ISR, isochronous IN endpoint is re-armed in the completion interrupt without usbd task
+void test_audio_iso_in_rearm_in_isr(void)
+{
+  uint8_t const* desc_ep = data_desc_configuration + TUD_CONFIG_DESC_LEN + TUD_AUDIO_MIC_ONE_CH_DESC_LEN
+                           - TUD_AUDIO_DESC_CS_AS_ISO_EP_LEN - TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN;
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) data_desc_configuration, true);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  TEST_ASSERT_TRUE(tud_audio_mounted());
+
+  // streaming alternate: EP is opened and armed with a ZLP since there are no samples yet
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_alt_streaming, false);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_clear_stall_Expect(rhport, EDPT_AUDIO_IN);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_AUDIO_IN, NULL, 0, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(1, tx_done_count);
+
+  uint8_t samples[EDPT_AUDIO_SZ];
+  for(uint8_t i=0; i<sizeof(samples); i++) samples[i] = i;
+  TEST_ASSERT_EQUAL(sizeof(samples), tud_audio_write(samples, sizeof(samples)));
+
+  // next packet is loaded right in the completion interrupt
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_AUDIO_IN, samples, sizeof(samples), sizeof(samples), true);
+  dcd_event_xfer_complete(rhport, EDPT_AUDIO_IN, 0, XFER_RESULT_SUCCESS, true);
+
+  TEST_ASSERT_EQUAL(2, tx_done_count);
+
+  // nothing is left for usbd task
+  tud_task();
+  TEST_ASSERT_EQUAL(2, tx_done_count);
+}
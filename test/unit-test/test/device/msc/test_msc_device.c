@@ -135,16 +135,40 @@ bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, boo
   return true;
 }
 
+// true to complete READ10 with tud_msc_async_io_done()
+bool read10_async = false;
+
+// buffers passed to read10/write10 callback
+void* rdwr10_buf[8];
+uint8_t rdwr10_count = 0;
+
 // Callback invoked when received READ10 command.
 // Copy disk's data to buffer (up to bufsize) and return number of copied bytes.
 int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
 {
   (void) lun;
 
+  if (rdwr10_count < TU_ARRAY_SIZE(rdwr10_buf)) rdwr10_buf[rdwr10_count++] = buffer;
+
   uint8_t const* addr = msc_disk[lba] + offset;
   memcpy(buffer, addr, bufsize);
 
-  return bufsize;
+  return read10_async ? TUD_MSC_RET_ASYNC : (int32_t) bufsize;
+}
+
+// true to send READ10 data directly from msc_disk
+bool read10_ptr = false;
+
+bool tud_msc_read10_ptr_cb(uint8_t lun, uint32_t lba, uint32_t offset, void const** ptr, uint32_t* len)
+{
+  (void) lun;
+  if (!read10_ptr) return false;
+
+  uint32_t const disk_remain = (DISK_BLOCK_NUM - lba) * DISK_BLOCK_SIZE - offset;
+  *ptr = msc_disk[lba] + offset;
+  *len = tu_min32(*len, disk_remain);
+
+  return true;
 }
 
 // Callback invoked when received WRITE10 command.
@@ -153,12 +177,33 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t*
 {
   (void) lun;
 
+  if (rdwr10_count < TU_ARRAY_SIZE(rdwr10_buf)) rdwr10_buf[rdwr10_count++] = buffer;
+
   uint8_t* addr = msc_disk[lba] + offset;
   memcpy(addr, buffer, bufsize);
 
   return bufsize;
 }
 
+// ranges passed to unmap callback
+uint32_t unmap_lba[4];
+uint32_t unmap_count[4];
+uint8_t unmap_num = 0;
+
+bool tud_msc_unmap_cb(uint8_t lun, uint32_t lba, uint32_t block_count)
+{
+  (void) lun;
+
+  if (unmap_num < TU_ARRAY_SIZE(unmap_lba))
+  {
+    unmap_lba[unmap_num]   = lba;
+    unmap_count[unmap_num] = block_count;
+    unmap_num++;
+  }
+
+  return true;
+}
+
 // Callback invoked when received an SCSI command not in built-in list below
 // - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, MODE_SENSE6, REQUEST_SENSE
 // - READ10 and WRITE10 has their own callbacks
@@ -194,6 +239,14 @@ uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 
 void setUp(void)
 {
+  read10_async = false;
+  read10_ptr   = false;
+  rdwr10_count = 0;
+  unmap_num    = 0;
+
+  // distinct content per block: pointer arguments are checked by data, this tells blocks apart
+  for(uint8_t i=0; i<DISK_BLOCK_NUM; i++) memset(msc_disk[i], i, DISK_BLOCK_SIZE);
+
   dcd_int_disable_Ignore();
   dcd_int_enable_Ignore();
 
@@ -242,6 +295,7 @@ void test_msc(void)
   dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
 
   // open endpoints
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) desc_configuration, true);
   dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
   dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
 
@@ -272,3 +326,232 @@ void test_msc(void)
 
   tud_task();
 }
+
+void test_msc_read10_async(void)
+{
+  // Read 1 LBA = 0, Block count = 1
+  msc_cbw_t cbw_read10 =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = 512,
+    .lun = 0,
+    .dir = TUSB_DIR_IN_MASK,
+    .cmd_len = sizeof(scsi_read10_t)
+  };
+
+  scsi_read10_t cmd_read10 =
+  {
+      .cmd_code    = SCSI_CMD_READ_10,
+      .lba         = tu_htonl(0),
+      .block_count = tu_htons(1)
+  };
+
+  memcpy(cbw_read10.command, &cmd_read10, cbw_read10.cmd_len);
+  read10_async = true;
+
+  desc_configuration = data_desc_configuration;
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+
+  // open endpoints
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) desc_configuration, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
+
+  // Prepare SCSI command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer( (uint8_t*) &cbw_read10, sizeof(msc_cbw_t));
+
+  // command received, read10 callback returns async: no data transfer yet
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, sizeof(msc_cbw_t), 0, true);
+
+  // control status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+
+  tud_task();
+
+  // wrong lun is rejected
+  TEST_ASSERT_FALSE(tud_msc_async_io_done(1, 512, false));
+
+  // I/O complete: SCSI Data transfer
+  TEST_ASSERT_TRUE(tud_msc_async_io_done(0, 512, true));
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, NULL, 512, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+
+  tud_task();
+
+  // no longer pending
+  TEST_ASSERT_FALSE(tud_msc_async_io_done(0, 512, false));
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 512, 0, true); // complete
+
+  // SCSI Status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, NULL, 13, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 13, 0, true);
+
+  // Prepare for next command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+
+  tud_task();
+}
+
+// set configuration and receive a SCSI command
+static void msc_mount_and_receive_cbw(msc_cbw_t* cbw)
+{
+  desc_configuration = data_desc_configuration;
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+
+  // open endpoints
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) desc_configuration, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
+
+  // Prepare SCSI command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer( (uint8_t*) cbw, sizeof(msc_cbw_t));
+
+  // command received
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, sizeof(msc_cbw_t), 0, true);
+
+  // control status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+}
+
+static void msc_expect_status(void)
+{
+  // SCSI Status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, NULL, 13, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 13, 0, true);
+
+  // Prepare for next command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+}
+
+void test_msc_read10_ptr(void)
+{
+  // Read LBA = 1, Block count = 4: larger than class buffer
+  msc_cbw_t cbw_read10 =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = 4*512,
+    .lun = 0,
+    .dir = TUSB_DIR_IN_MASK,
+    .cmd_len = sizeof(scsi_read10_t)
+  };
+
+  scsi_read10_t cmd_read10 =
+  {
+      .cmd_code    = SCSI_CMD_READ_10,
+      .lba         = tu_htonl(1),
+      .block_count = tu_htons(4)
+  };
+
+  memcpy(cbw_read10.command, &cmd_read10, cbw_read10.cmd_len);
+  read10_ptr = true;
+
+  msc_mount_and_receive_cbw(&cbw_read10);
+
+  // whole data is sent directly from disk without read10 callback
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, msc_disk[1], 4*512, true);
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 4*512, 0, true);
+  msc_expect_status();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(0, rdwr10_count);
+}
+
+void test_msc_read16(void)
+{
+  // Read LBA = 3, Block count = 2 with 64-bit LBA and 32-bit block count
+  msc_cbw_t cbw_read16 =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = 2*512,
+    .lun = 0,
+    .dir = TUSB_DIR_IN_MASK,
+    .cmd_len = sizeof(scsi_read16_t)
+  };
+
+  // all fields are Big Endian
+  uint8_t const cmd_read16[16] =
+  {
+    SCSI_CMD_READ_16, 0,
+    0, 0, 0, 0, 0, 0, 0, 3, // lba
+    0, 0, 0, 2,             // block count
+    0, 0
+  };
+
+  memcpy(cbw_read16.command, cmd_read16, cbw_read16.cmd_len);
+  read10_ptr = true;
+
+  msc_mount_and_receive_cbw(&cbw_read16);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, msc_disk[3], 2*512, true);
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 2*512, 0, true);
+  msc_expect_status();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(0, rdwr10_count);
+}
+
+void test_msc_unmap(void)
+{
+  // UNMAP with 2 block descriptors: LBA 2 count 3, LBA 10 count 6 (up to end of disk)
+  uint8_t const param[8 + 2*16] =
+  {
+    0, 38, 0, 32, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 2,    0, 0, 0, 3,    0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 10,   0, 0, 0, 6,    0, 0, 0, 0,
+  };
+
+  msc_cbw_t cbw_unmap =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = sizeof(param),
+    .lun = 0,
+    .dir = 0,
+    .cmd_len = sizeof(scsi_unmap_t)
+  };
+
+  scsi_unmap_t cmd_unmap =
+  {
+    .cmd_code          = SCSI_CMD_UNMAP,
+    .param_list_length = tu_htons(sizeof(param))
+  };
+
+  memcpy(cbw_unmap.command, &cmd_unmap, cbw_unmap.cmd_len);
+  msc_mount_and_receive_cbw(&cbw_unmap);
+
+  // receive parameter list
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(param), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer((uint8_t*) param, sizeof(param));
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, sizeof(param), 0, true);
+  msc_expect_status();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(2, unmap_num);
+  TEST_ASSERT_EQUAL(2, unmap_lba[0]);
+  TEST_ASSERT_EQUAL(3, unmap_count[0]);
+  TEST_ASSERT_EQUAL(10, unmap_lba[1]);
+  TEST_ASSERT_EQUAL(6, unmap_count[1]);
+}
@@ -0,0 +1,516 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019, hathach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+
+#include "unity.h"
+
+// Files to test
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb.h"
+#include "usbd.h"
+TEST_FILE("usbd_control.c")
+TEST_FILE("msc_device.c")
+
+// Non-default MSC options, enabled by this test's defines in project.yml
+TU_VERIFY_STATIC(CFG_TUD_MSC_DOUBLE_BUF && CFG_TUD_MSC_UAS, "msc options");
+
+// Mock File
+#include "mock_dcd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+
+enum
+{
+  EDPT_CTRL_OUT = 0x00,
+  EDPT_CTRL_IN  = 0x80,
+
+  EDPT_MSC_OUT  = 0x01,
+  EDPT_MSC_IN   = 0x81,
+
+  EDPT_UAS_CMD    = 0x02,
+  EDPT_UAS_STATUS = 0x82,
+};
+
+uint8_t const rhport = 0;
+
+enum
+{
+  ITF_NUM_MSC,
+  ITF_NUM_TOTAL
+};
+
+#define CONFIG_TOTAL_LEN    (TUD_CONFIG_DESC_LEN + TUD_MSC_DESC_LEN)
+
+uint8_t const data_desc_configuration[] =
+{
+  // Config number, interface count, string index, total length, attribute, power in mA
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+
+  // Interface number, string index, EP Out & EP In address, EP size
+  TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, 0, EDPT_MSC_OUT, EDPT_MSC_IN, TUD_OPT_HIGH_SPEED ? 512 : 64),
+};
+
+uint8_t const data_desc_configuration_uas[] =
+{
+  TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, TUD_CONFIG_DESC_LEN + TUD_MSC_UAS_DESC_LEN, 0, 100),
+
+  // Interface number, string index, EP Command, Status, Data In & Data Out address, EP size
+  TUD_MSC_UAS_DESCRIPTOR(ITF_NUM_MSC, 0, EDPT_UAS_CMD, EDPT_UAS_STATUS, EDPT_MSC_IN, EDPT_MSC_OUT, 512),
+};
+
+tusb_control_request_t const request_set_configuration =
+{
+  .bmRequestType = 0x00,
+  .bRequest      = TUSB_REQ_SET_CONFIGURATION,
+  .wValue        = 1,
+  .wIndex        = 0,
+  .wLength       = 0
+};
+
+uint8_t const* desc_configuration;
+
+
+enum
+{
+  DISK_BLOCK_NUM  = 16, // 8KB is the smallest size that windows allow to mount
+  DISK_BLOCK_SIZE = 512
+};
+
+uint8_t msc_disk[DISK_BLOCK_NUM][DISK_BLOCK_SIZE];
+
+// Invoked when received SCSI_CMD_INQUIRY
+// Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
+void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
+{
+  (void) lun;
+
+  const char vid[] = "TinyUSB";
+  const char pid[] = "Mass Storage";
+  const char rev[] = "1.0";
+
+  memcpy(vendor_id  , vid, strlen(vid));
+  memcpy(product_id , pid, strlen(pid));
+  memcpy(product_rev, rev, strlen(rev));
+}
+
+// Invoked when received Test Unit Ready command.
+// return true allowing host to read/write this LUN e.g SD card inserted
+bool tud_msc_test_unit_ready_cb(uint8_t lun)
+{
+  (void) lun;
+
+  return true; // RAM disk is always ready
+}
+
+// Invoked when received SCSI_CMD_READ_CAPACITY_10 and SCSI_CMD_READ_FORMAT_CAPACITY to determine the disk size
+// Application update block count and block size
+void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size)
+{
+  (void) lun;
+
+  *block_count = DISK_BLOCK_NUM;
+  *block_size  = DISK_BLOCK_SIZE;
+}
+
+// Invoked when received Start Stop Unit command
+// - Start = 0 : stopped power mode, if load_eject = 1 : unload disk storage
+// - Start = 1 : active mode, if load_eject = 1 : load disk storage
+bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject)
+{
+  (void) lun;
+  (void) power_condition;
+
+  return true;
+}
+
+// true to complete READ10 with tud_msc_async_io_done()
+bool read10_async = false;
+
+// buffers passed to read10/write10 callback
+void* rdwr10_buf[8];
+uint8_t rdwr10_count = 0;
+
+// Callback invoked when received READ10 command.
+// Copy disk's data to buffer (up to bufsize) and return number of copied bytes.
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  if (rdwr10_count < TU_ARRAY_SIZE(rdwr10_buf)) rdwr10_buf[rdwr10_count++] = buffer;
+
+  uint8_t const* addr = msc_disk[lba] + offset;
+  memcpy(buffer, addr, bufsize);
+
+  return read10_async ? TUD_MSC_RET_ASYNC : (int32_t) bufsize;
+}
+
+// true to send READ10 data directly from msc_disk
+bool read10_ptr = false;
+
+bool tud_msc_read10_ptr_cb(uint8_t lun, uint32_t lba, uint32_t offset, void const** ptr, uint32_t* len)
+{
+  (void) lun;
+  if (!read10_ptr) return false;
+
+  uint32_t const disk_remain = (DISK_BLOCK_NUM - lba) * DISK_BLOCK_SIZE - offset;
+  *ptr = msc_disk[lba] + offset;
+  *len = tu_min32(*len, disk_remain);
+
+  return true;
+}
+
+// Callback invoked when received WRITE10 command.
+// Process data in buffer to disk's storage and return number of written bytes
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize)
+{
+  (void) lun;
+
+  if (rdwr10_count < TU_ARRAY_SIZE(rdwr10_buf)) rdwr10_buf[rdwr10_count++] = buffer;
+
+  uint8_t* addr = msc_disk[lba] + offset;
+  memcpy(addr, buffer, bufsize);
+
+  return bufsize;
+}
+
+// ranges passed to unmap callback
+uint32_t unmap_lba[4];
+uint32_t unmap_count[4];
+uint8_t unmap_num = 0;
+
+bool tud_msc_unmap_cb(uint8_t lun, uint32_t lba, uint32_t block_count)
+{
+  (void) lun;
+
+  if (unmap_num < TU_ARRAY_SIZE(unmap_lba))
+  {
+    unmap_lba[unmap_num]   = lba;
+    unmap_count[unmap_num] = block_count;
+    unmap_num++;
+  }
+
+  return true;
+}
+
+// Callback invoked when received an SCSI command not in built-in list below
+// - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, MODE_SENSE6, REQUEST_SENSE
+// - READ10 and WRITE10 has their own callbacks
+int32_t tud_msc_scsi_cb (uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize)
+{
+  // read10 & write10 has their own callback and MUST not be handled here
+
+  void const* response = NULL;
+  uint16_t resplen = 0;
+
+  return resplen;
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+uint8_t const * tud_descriptor_device_cb(void)
+{
+  return NULL;
+}
+
+uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
+{
+  return desc_configuration;
+}
+
+uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+  (void) langid;
+
+  return NULL;
+}
+
+void setUp(void)
+{
+  read10_async = false;
+  read10_ptr   = false;
+  rdwr10_count = 0;
+  unmap_num    = 0;
+
+  // distinct content per block: pointer arguments are checked by data, this tells blocks apart
+  for(uint8_t i=0; i<DISK_BLOCK_NUM; i++) memset(msc_disk[i], i, DISK_BLOCK_SIZE);
+
+  dcd_int_disable_Ignore();
+  dcd_int_enable_Ignore();
+
+  if ( !tud_inited() )
+  {
+    dcd_init_Expect(rhport);
+    tusb_init();
+  }
+
+  dcd_event_bus_reset(rhport, TUSB_SPEED_HIGH, false);
+  tud_task();
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+//
+//--------------------------------------------------------------------+
+// set configuration and receive a SCSI command
+static void msc_mount_and_receive_cbw(msc_cbw_t* cbw)
+{
+  desc_configuration = data_desc_configuration;
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+
+  // open endpoints
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) desc_configuration, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
+
+  // Prepare SCSI command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer( (uint8_t*) cbw, sizeof(msc_cbw_t));
+
+  // command received
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, sizeof(msc_cbw_t), 0, true);
+
+  // control status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+}
+
+static void msc_expect_status(void)
+{
+  // SCSI Status
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, NULL, 13, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 13, 0, true);
+
+  // Prepare for next command
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+}
+
+void test_msc_read10_double_buf(void)
+{
+  // Read LBA = 2, Block count = 3
+  msc_cbw_t cbw_read10 =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = 3*512,
+    .lun = 0,
+    .dir = TUSB_DIR_IN_MASK,
+    .cmd_len = sizeof(scsi_read10_t)
+  };
+
+  scsi_read10_t cmd_read10 =
+  {
+      .cmd_code    = SCSI_CMD_READ_10,
+      .lba         = tu_htonl(2),
+      .block_count = tu_htons(3)
+  };
+
+  memcpy(cbw_read10.command, &cmd_read10, cbw_read10.cmd_len);
+  msc_mount_and_receive_cbw(&cbw_read10);
+
+  // first chunk is sent while second chunk is read into the other buffer
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, NULL, 512, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(2, rdwr10_count);
+  TEST_ASSERT_NOT_EQUAL(rdwr10_buf[0], rdwr10_buf[1]);
+
+  // second chunk is sent right away, third chunk is read into the first buffer
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, rdwr10_buf[1], 512, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 512, 0, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(3, rdwr10_count);
+  TEST_ASSERT_EQUAL_PTR(rdwr10_buf[0], rdwr10_buf[2]);
+
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, rdwr10_buf[0], 512, true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 512, 0, true);
+  tud_task();
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 512, 0, true);
+  msc_expect_status();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(3, rdwr10_count);
+}
+
+void test_msc_write10_double_buf(void)
+{
+  // Write LBA = 4, Block count = 2
+  msc_cbw_t cbw_write10 =
+  {
+    .signature = MSC_CBW_SIGNATURE,
+    .tag = 0xCAFECAFE,
+    .total_bytes = 2*512,
+    .lun = 0,
+    .dir = 0,
+    .cmd_len = sizeof(scsi_write10_t)
+  };
+
+  scsi_write10_t cmd_write10 =
+  {
+      .cmd_code    = SCSI_CMD_WRITE_10,
+      .lba         = tu_htonl(4),
+      .block_count = tu_htons(2)
+  };
+
+  memcpy(cbw_write10.command, &cmd_write10, cbw_write10.cmd_len);
+
+  uint8_t data[2][512];
+  memset(data[0], 0xAA, 512);
+  memset(data[1], 0x55, 512);
+
+  msc_mount_and_receive_cbw(&cbw_write10);
+
+  // receive first chunk
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, 512, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer(data[0], 512);
+  tud_task();
+
+  // second chunk is received into the other buffer before first chunk is written
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, 512, true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer(data[1], 512);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, 512, 0, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(1, rdwr10_count);
+  TEST_ASSERT_EQUAL_MEMORY(data[0], msc_disk[4], 512);
+
+  dcd_event_xfer_complete(rhport, EDPT_MSC_OUT, 512, 0, true);
+  msc_expect_status();
+  tud_task();
+
+  TEST_ASSERT_EQUAL(2, rdwr10_count);
+  TEST_ASSERT_NOT_EQUAL(rdwr10_buf[0], rdwr10_buf[1]);
+  TEST_ASSERT_EQUAL_MEMORY(data[1], msc_disk[5], 512);
+}
+
+// UAS: commands are queued on command pipe while the previous one is executing
+void test_msc_uas_queue(void)
+{
+  msc_uas_cmd_iu_t cmd_read10 =
+  {
+    .iu_id = MSC_UAS_IU_COMMAND,
+    .tag   = tu_htons(1),
+  };
+
+  scsi_read10_t const read10 =
+  {
+    .cmd_code    = SCSI_CMD_READ_10,
+    .lba         = tu_htonl(2),
+    .block_count = tu_htons(1)
+  };
+  memcpy(cmd_read10.cdb, &read10, sizeof(read10));
+
+  msc_uas_cmd_iu_t cmd_test_unit_ready =
+  {
+    .iu_id = MSC_UAS_IU_COMMAND,
+    .tag   = tu_htons(2),
+    .cdb   = { SCSI_CMD_TEST_UNIT_READY }
+  };
+
+  tusb_control_request_t const request_set_alt_uas =
+  {
+    .bmRequestType = 0x01,
+    .bRequest      = TUSB_REQ_SET_INTERFACE,
+    .wValue        = 1,
+    .wIndex        = ITF_NUM_MSC,
+    .wLength       = 0
+  };
+
+  desc_configuration = data_desc_configuration_uas;
+  uint8_t const* desc_ep = tu_desc_next(tu_desc_next(desc_configuration));
+
+  // Bulk-Only Transport on alternate 0
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_configuration, false);
+  dcd_config_prepare_ExpectAndReturn(rhport, (tusb_desc_configuration_t const *) desc_configuration, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_ep, true);
+  dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) tu_desc_next(desc_ep), true);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_OUT, NULL, sizeof(msc_cbw_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  // UAS on alternate 1: endpoints with pipe usage descriptors
+  uint8_t const* desc_uas_ep = tu_desc_next(tu_desc_next(tu_desc_next(desc_ep)));
+  dcd_event_setup_received(rhport, (uint8_t*) &request_set_alt_uas, false);
+  dcd_edpt_close_Expect(rhport, EDPT_MSC_IN);
+  dcd_edpt_close_Expect(rhport, EDPT_MSC_OUT);
+  for(uint8_t i=0; i<4; i++)
+  {
+    dcd_edpt_open_ExpectAndReturn(rhport, (tusb_desc_endpoint_t const *) desc_uas_ep, true);
+    desc_uas_ep = tu_desc_next(tu_desc_next(desc_uas_ep));
+  }
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(msc_uas_cmd_iu_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer((uint8_t*) &cmd_read10, sizeof(msc_uas_cmd_iu_t));
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_CTRL_IN, NULL, 0, true);
+  tud_task();
+
+  // READ10 is executed: data is queued, command pipe is re-armed, then Read Ready IU
+  uint8_t const read_ready[4] = { MSC_UAS_IU_READ_READY, 0, 0, 1 };
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_MSC_IN, msc_disk[2], 512, true);
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(msc_uas_cmd_iu_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_edpt_xfer_ReturnMemThruPtr_buffer((uint8_t*) &cmd_test_unit_ready, sizeof(msc_uas_cmd_iu_t));
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_UAS_STATUS, (uint8_t*) (uintptr_t) read_ready, sizeof(read_ready), sizeof(read_ready), true);
+  dcd_event_xfer_complete(rhport, EDPT_UAS_CMD, sizeof(msc_uas_cmd_iu_t), 0, true);
+  tud_task();
+
+  TEST_ASSERT_EQUAL(1, rdwr10_count);
+
+  // TEST UNIT READY is queued while READ10 is in progress
+  dcd_edpt_xfer_ExpectAndReturn(rhport, EDPT_UAS_CMD, NULL, sizeof(msc_uas_cmd_iu_t), true);
+  dcd_edpt_xfer_IgnoreArg_buffer();
+  dcd_event_xfer_complete(rhport, EDPT_UAS_CMD, sizeof(msc_uas_cmd_iu_t), 0, true);
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, sizeof(read_ready), 0, true);
+  tud_task();
+
+  // READ10 data complete: Sense IU with GOOD status
+  uint8_t sense_good[16] = { MSC_UAS_IU_SENSE, 0, 0, 1 };
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_UAS_STATUS, sense_good, sizeof(sense_good), sizeof(sense_good), true);
+  dcd_event_xfer_complete(rhport, EDPT_MSC_IN, 512, 0, true);
+  tud_task();
+
+  // queued TEST UNIT READY is executed right after READ10 status
+  sense_good[3] = 2;
+  dcd_edpt_xfer_ExpectWithArrayAndReturn(rhport, EDPT_UAS_STATUS, sense_good, sizeof(sense_good), sizeof(sense_good), true);
+  dcd_event_xfer_complete(rhport, EDPT_UAS_STATUS, sizeof(sense_good), 0, true);
+  tud_task();
+}
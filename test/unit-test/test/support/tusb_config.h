@@ -78,11 +78,18 @@
 
 //------------- CLASS -------------//
 //#define CFG_TUD_CDC              0
+#ifndef CFG_TUD_MSC
 #define CFG_TUD_MSC              1
+#endif
 //#define CFG_TUD_HID              0
 //#define CFG_TUD_MIDI             0
 //#define CFG_TUD_VENDOR           0
 
+// enabled per test in project.yml
+#ifndef CFG_TUD_AUDIO
+#define CFG_TUD_AUDIO            0
+#endif
+
 //------------- CDC -------------//
 
 // FIFO size of CDC TX and RX
@@ -99,6 +106,18 @@
 // Should be sufficient to hold ID (if any) + Data
 #define CFG_TUD_HID_EP_BUFSIZE    64
 
+//------------- AUDIO -------------//
+
+// One channel microphone (TUD_AUDIO_MIC_ONE_CH_DESCRIPTOR)
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN        TUD_AUDIO_MIC_ONE_CH_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT        1
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ     64
+
+#define CFG_TUD_AUDIO_ENABLE_EP_IN           1
+#define CFG_TUD_AUDIO_EP_IN_FLOW_CONTROL     0
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX    64
+#define CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ 256
+
 #ifdef __cplusplus
  }
 #endif
@@ -0,0 +1,399 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2024 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+// Micro benchmark of hot helpers: tu_fifo, tu_desc_find and tu_edpt_stream.
+// Each benchmark also checks the data so that it doubles as a test. Results are printed as
+// time units per byte. On host the unit is ns from clock_gettime(). When running on a board,
+// define BENCH_CYCLES() to a cycle counter e.g (DWT->CYCCNT) or board_millis() and BENCH_UNIT accordingly.
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+#include "tusb_types.h"
+#include "tusb_private.h"
+#include "device/usbd_pvt.h"
+TEST_FILE("tusb.c")
+
+#ifndef BENCH_CYCLES
+#include <time.h>
+
+static uint32_t bench_host_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec);
+}
+
+#define BENCH_CYCLES()  bench_host_ns()
+#define BENCH_UNIT      "ns"
+#endif
+
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS    200
+#endif
+
+static void bench_report(char const* name, uint32_t cycles, uint32_t bytes)
+{
+  uint32_t const per100 = bytes ? (uint32_t) (((uint64_t) cycles * 100u) / bytes) : 0;
+  printf("BENCH %-36s %6lu.%02lu %s/byte\n", name, (unsigned long) (per100 / 100), (unsigned long) (per100 % 100), BENCH_UNIT);
+}
+
+//--------------------------------------------------------------------+
+// Stub USBD for stream: endpoint transfer completes immediately
+//--------------------------------------------------------------------+
+static uint32_t xfer_bytes;
+static uint8_t* xfer_buf;
+
+bool tud_init(uint8_t rhport)
+{
+  (void) rhport;
+  return true;
+}
+
+bool tud_inited(void)
+{
+  return true;
+}
+
+bool usbd_edpt_claim(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+  return true;
+}
+
+bool usbd_edpt_release(uint8_t rhport, uint8_t ep_addr)
+{
+  (void) rhport; (void) ep_addr;
+  return true;
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint32_t total_bytes)
+{
+  (void) rhport; (void) ep_addr;
+  xfer_buf = buffer;
+  xfer_bytes += total_bytes;
+  return true;
+}
+
+bool usbd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t * ff, uint16_t total_bytes)
+{
+  (void) rhport;
+
+  // controller pulls from / pushes into fifo directly
+  if ( tu_edpt_dir(ep_addr) == TUSB_DIR_IN )
+  {
+    tu_fifo_advance_read_pointer(ff, total_bytes);
+  }
+  else
+  {
+    tu_fifo_advance_write_pointer(ff, total_bytes);
+  }
+
+  xfer_bytes += total_bytes;
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Setup
+//--------------------------------------------------------------------+
+#define FIFO_SIZE   1024
+
+static uint8_t ff_buf[FIFO_SIZE + 4];
+static uint8_t src_buf[FIFO_SIZE + 4];
+static uint8_t dst_buf[FIFO_SIZE + 4];
+
+void setUp(void)
+{
+  for(uint32_t i=0; i<sizeof(src_buf); i++) src_buf[i] = (uint8_t) i;
+  memset(dst_buf, 0, sizeof(dst_buf));
+  xfer_bytes = 0;
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// FIFO
+//--------------------------------------------------------------------+
+
+// write then read n bytes, starting at index 'start' to cover wrap positions
+static uint32_t bench_fifo_rw(tu_fifo_t* ff, uint8_t const* src, uint8_t* dst, uint16_t n, uint16_t start)
+{
+  uint32_t total = 0;
+
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+  {
+    tu_fifo_clear(ff);
+    ff->wr_idx = ff->rd_idx = start;
+
+    uint32_t const t0 = BENCH_CYCLES();
+    TEST_ASSERT_EQUAL(n, tu_fifo_write_n(ff, src, n));
+    TEST_ASSERT_EQUAL(n, tu_fifo_read_n(ff, dst, n));
+    total += BENCH_CYCLES() - t0;
+  }
+
+  TEST_ASSERT_EQUAL_MEMORY(src, dst, n);
+  return total;
+}
+
+void test_bench_fifo_size(void)
+{
+  uint16_t const sizes[] = { 1, 8, 64, 512, 1024 };
+  tu_fifo_t ff;
+  tu_fifo_config(&ff, ff_buf, FIFO_SIZE, 1, false);
+
+  for(uint32_t i=0; i<TU_ARRAY_SIZE(sizes); i++)
+  {
+    char name[40];
+    uint32_t const cycles = bench_fifo_rw(&ff, src_buf, dst_buf, sizes[i], 0);
+    snprintf(name, sizeof(name), "fifo_rw size %u", sizes[i]);
+    bench_report(name, cycles, (uint32_t) sizes[i] * BENCH_ROUNDS);
+  }
+}
+
+void test_bench_fifo_align(void)
+{
+  tu_fifo_t ff;
+
+  for(uint8_t align=0; align<4; align++)
+  {
+    char name[40];
+    tu_fifo_config(&ff, ff_buf + align, FIFO_SIZE, 1, false);
+    uint32_t const cycles = bench_fifo_rw(&ff, src_buf + ((align + 1) & 3), dst_buf + align, 512, 0);
+    snprintf(name, sizeof(name), "fifo_rw 512 align %u", align);
+    bench_report(name, cycles, 512u * BENCH_ROUNDS);
+  }
+}
+
+void test_bench_fifo_wrap(void)
+{
+  uint16_t const starts[] = { 0, 256, FIFO_SIZE - 1, FIFO_SIZE + 512 };
+  tu_fifo_t ff;
+  tu_fifo_config(&ff, ff_buf, FIFO_SIZE, 1, false);
+
+  for(uint32_t i=0; i<TU_ARRAY_SIZE(starts); i++)
+  {
+    char name[40];
+    uint32_t const cycles = bench_fifo_rw(&ff, src_buf, dst_buf, 768, starts[i]);
+    snprintf(name, sizeof(name), "fifo_rw 768 start %u", starts[i]);
+    bench_report(name, cycles, 768u * BENCH_ROUNDS);
+  }
+}
+
+void test_bench_fifo_item(void)
+{
+  // per item access e.g CDC char write or MIDI packet, power of two vs non power of two depth
+  uint16_t const depths[] = { FIFO_SIZE, FIFO_SIZE - 24 };
+  tu_fifo_t ff;
+
+  for(uint32_t i=0; i<TU_ARRAY_SIZE(depths); i++)
+  {
+    char name[40];
+    uint32_t total = 0;
+    tu_fifo_config(&ff, ff_buf, depths[i], 1, false);
+
+    for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+    {
+      uint32_t const t0 = BENCH_CYCLES();
+      for(uint16_t n=0; n<256; n++) tu_fifo_write(&ff, &src_buf[n]);
+      for(uint16_t n=0; n<256; n++) tu_fifo_read(&ff, &dst_buf[n]);
+      total += BENCH_CYCLES() - t0;
+    }
+
+    TEST_ASSERT_EQUAL_MEMORY(src_buf, dst_buf, 256);
+    snprintf(name, sizeof(name), "fifo_item depth %u", depths[i]);
+    bench_report(name, total, 256u * BENCH_ROUNDS);
+  }
+}
+
+#ifdef TUP_MEM_CONST_ADDR
+void test_bench_fifo_const_addr(void)
+{
+  // use a RAM word as register
+  static volatile uint32_t reg = 0x03020100;
+  tu_fifo_t ff;
+
+  for(uint8_t align=0; align<4; align++)
+  {
+    char name[40];
+    uint32_t total = 0;
+    tu_fifo_config(&ff, ff_buf + align, FIFO_SIZE, 1, false);
+
+    for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+    {
+      tu_fifo_clear(&ff);
+      uint32_t const t0 = BENCH_CYCLES();
+      TEST_ASSERT_EQUAL(510, tu_fifo_write_n_const_addr_full_words(&ff, (void const*) (uintptr_t) &reg, 510));
+      TEST_ASSERT_EQUAL(510, tu_fifo_read_n_const_addr_full_words(&ff, (void*) (uintptr_t) &reg, 510));
+      total += BENCH_CYCLES() - t0;
+    }
+
+    snprintf(name, sizeof(name), "fifo_const_addr 510 align %u", align);
+    bench_report(name, total, 510u * BENCH_ROUNDS);
+  }
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Descriptor
+//--------------------------------------------------------------------+
+void test_bench_desc_find(void)
+{
+  // configuration with many interface + endpoint descriptors, search for the last one
+  enum { ITF_COUNT = 16 };
+  uint8_t desc[ITF_COUNT*(9+7+7) + 4];
+  uint8_t* p = desc;
+
+  for(uint8_t i=0; i<ITF_COUNT; i++)
+  {
+    uint8_t const itf[9] = { 9, TUSB_DESC_INTERFACE, i, 0, 2, TUSB_CLASS_VENDOR_SPECIFIC, 0, 0, 0 };
+    uint8_t const ep_out[7] = { 7, TUSB_DESC_ENDPOINT, (uint8_t) (i+1), TUSB_XFER_BULK, 64, 0, 0 };
+    uint8_t const ep_in[7] = { 7, TUSB_DESC_ENDPOINT, (uint8_t) (0x80 | (i+1)), TUSB_XFER_BULK, 64, 0, 0 };
+
+    memcpy(p, itf, 9); p += 9;
+    memcpy(p, ep_out, 7); p += 7;
+    memcpy(p, ep_in, 7); p += 7;
+  }
+
+  uint8_t const cs[4] = { 4, TUSB_DESC_CS_INTERFACE, 0x24, 0x01 };
+  memcpy(p, cs, 4); p += 4;
+
+  uint8_t const* end = p;
+  uint32_t const bytes = (uint32_t) (end - desc) * BENCH_ROUNDS;
+  uint32_t t0, cycles;
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++) TEST_ASSERT_EQUAL_PTR(end-4, tu_desc_find(desc, end, TUSB_DESC_CS_INTERFACE));
+  cycles = BENCH_CYCLES() - t0;
+  bench_report("desc_find", cycles, bytes);
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++) TEST_ASSERT_EQUAL_PTR(end-4, tu_desc_find2(desc, end, TUSB_DESC_CS_INTERFACE, 0x24));
+  cycles = BENCH_CYCLES() - t0;
+  bench_report("desc_find2", cycles, bytes);
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++) TEST_ASSERT_EQUAL_PTR(end-4, tu_desc_find3(desc, end, TUSB_DESC_CS_INTERFACE, 0x24, 0x01));
+  cycles = BENCH_CYCLES() - t0;
+  bench_report("desc_find3", cycles, bytes);
+}
+
+//--------------------------------------------------------------------+
+// Endpoint Stream
+//--------------------------------------------------------------------+
+void test_bench_edpt_stream(void)
+{
+  tusb_desc_endpoint_t const desc_ep =
+  {
+    .bLength          = sizeof(tusb_desc_endpoint_t),
+    .bDescriptorType  = TUSB_DESC_ENDPOINT,
+    .bEndpointAddress = 0x81,
+    .bmAttributes     = { .xfer = TUSB_XFER_BULK },
+    .wMaxPacketSize   = 64,
+    .bInterval        = 0
+  };
+
+  static uint8_t ep_buf[64];
+  tu_edpt_stream_t s;
+  uint32_t t0, cycles;
+
+  // write: data is pulled into ep_buf and transferred packet by packet as if each transfer completes immediately
+  tu_edpt_stream_init(&s, false, true, false, ff_buf, FIFO_SIZE, ep_buf, sizeof(ep_buf));
+  tu_edpt_stream_open(&s, 0, &desc_ep);
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+  {
+    TEST_ASSERT_EQUAL(512, tu_edpt_stream_write(&s, src_buf, 512));
+    while ( tu_edpt_stream_write_xfer(&s) ) {}
+  }
+  cycles = BENCH_CYCLES() - t0;
+  TEST_ASSERT_EQUAL(512u * BENCH_ROUNDS, xfer_bytes);
+  bench_report("edpt_stream_write 512", cycles, 512u * BENCH_ROUNDS);
+
+  // read: complete a transfer into the fifo then read it out
+  tu_edpt_stream_init(&s, false, false, false, ff_buf, FIFO_SIZE, ep_buf, sizeof(ep_buf));
+  tu_edpt_stream_open(&s, 0, &desc_ep);
+  memcpy(ep_buf, src_buf, sizeof(ep_buf));
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+  {
+    for(uint8_t i=0; i<8; i++) tu_edpt_stream_read_xfer_complete(&s, sizeof(ep_buf));
+    TEST_ASSERT_EQUAL(512, tu_edpt_stream_read(&s, dst_buf, 512));
+  }
+  cycles = BENCH_CYCLES() - t0;
+  TEST_ASSERT_EQUAL_MEMORY(src_buf, dst_buf, sizeof(ep_buf));
+  bench_report("edpt_stream_read 512", cycles, 512u * BENCH_ROUNDS);
+
+#if CFG_TUSB_EDPT_STREAM_DOUBLE_BUF
+  // double buffer read: endpoint is re-armed with the other buffer before data is drained
+  static uint8_t ep_buf_alt[64];
+  tu_edpt_stream_init(&s, false, false, false, ff_buf, FIFO_SIZE, ep_buf, sizeof(ep_buf));
+  tu_edpt_stream_set_double_buf(&s, ep_buf_alt);
+  tu_edpt_stream_open(&s, 0, &desc_ep);
+  memcpy(ep_buf, src_buf, sizeof(ep_buf));
+  memcpy(ep_buf_alt, src_buf, sizeof(ep_buf_alt));
+  TEST_ASSERT_EQUAL(64, tu_edpt_stream_read_xfer(&s));
+  TEST_ASSERT_EQUAL_PTR(ep_buf, xfer_buf);
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+  {
+    for(uint8_t i=0; i<8; i++)
+    {
+      uint8_t* const armed = xfer_buf;
+      tu_edpt_stream_read_xfer_complete(&s, sizeof(ep_buf));
+      TEST_ASSERT_TRUE(xfer_buf != armed);
+    }
+    TEST_ASSERT_EQUAL(512, tu_edpt_stream_read(&s, dst_buf, 512));
+  }
+  cycles = BENCH_CYCLES() - t0;
+  TEST_ASSERT_EQUAL_MEMORY(src_buf, dst_buf, sizeof(ep_buf));
+  bench_report("edpt_stream_read 512 double-buf", cycles, 512u * BENCH_ROUNDS);
+#endif
+
+  // zero-copy write: controller transfers directly from fifo
+  xfer_bytes = 0;
+  tu_edpt_stream_init(&s, false, true, false, ff_buf, FIFO_SIZE, NULL, 512);
+  tu_edpt_stream_open(&s, 0, &desc_ep);
+
+  t0 = BENCH_CYCLES();
+  for(uint32_t r=0; r<BENCH_ROUNDS; r++)
+  {
+    TEST_ASSERT_EQUAL(512, tu_edpt_stream_write(&s, src_buf, 512));
+    while ( tu_edpt_stream_write_xfer(&s) ) {}
+  }
+  cycles = BENCH_CYCLES() - t0;
+  TEST_ASSERT_EQUAL(512u * BENCH_ROUNDS, xfer_bytes);
+  bench_report("edpt_stream_write 512 zero-copy", cycles, 512u * BENCH_ROUNDS);
+
+  tu_edpt_stream_deinit(&s);
+}
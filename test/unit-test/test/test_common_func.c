@@ -80,3 +80,30 @@ void test_TU_ARGS_NUM(void)
   TEST_ASSERT_EQUAL(31, TU_ARGS_NUM(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31));
   TEST_ASSERT_EQUAL(32, TU_ARGS_NUM(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18, a19, a20, a21, a22, a23, a24, a25, a26, a27, a28, a29, a30, a31, a32));
 }
+
+void test_edpt_high_bandwidth(void)
+{
+  tusb_desc_endpoint_t ep = { .bLength = 7, .bDescriptorType = TUSB_DESC_ENDPOINT, .bEndpointAddress = 0x81 };
+  ep.bmAttributes.xfer = TUSB_XFER_ISOCHRONOUS;
+
+  ep.wMaxPacketSize = TUSB_EDPT_HIGH_BANDWIDTH_SIZE(1000);
+  TEST_ASSERT_EQUAL(1000, tu_edpt_packet_size(&ep));
+  TEST_ASSERT_EQUAL(1, tu_edpt_packet_mult(&ep));
+  TEST_ASSERT_EQUAL(1000, tu_edpt_max_payload(&ep));
+
+  ep.wMaxPacketSize = TUSB_EDPT_HIGH_BANDWIDTH_SIZE(1500);
+  TEST_ASSERT_EQUAL_HEX16(0x0800 | 750, ep.wMaxPacketSize);
+  TEST_ASSERT_EQUAL(2, tu_edpt_packet_mult(&ep));
+  TEST_ASSERT_EQUAL(1500, tu_edpt_max_payload(&ep));
+
+  ep.wMaxPacketSize = TUSB_EDPT_HIGH_BANDWIDTH_SIZE(3072);
+  TEST_ASSERT_EQUAL_HEX16(0x1000 | 1024, ep.wMaxPacketSize);
+  TEST_ASSERT_EQUAL(3, tu_edpt_packet_mult(&ep));
+  TEST_ASSERT_EQUAL(3072, tu_edpt_max_payload(&ep));
+
+  // not evenly divided: last transaction is short
+  ep.wMaxPacketSize = TUSB_EDPT_HIGH_BANDWIDTH_SIZE(2050);
+  TEST_ASSERT_EQUAL(684, tu_edpt_packet_size(&ep));
+  TEST_ASSERT_EQUAL(3, tu_edpt_packet_mult(&ep));
+  TEST_ASSERT_TRUE(tu_edpt_max_payload(&ep) >= 2050);
+}
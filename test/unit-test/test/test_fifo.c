@@ -43,6 +43,7 @@ uint8_t rd_buf[FIFO_SIZE];
 void setUp(void)
 {
   tu_fifo_clear(ff);
+  tu_fifo_set_overwritable(ff, false);
   memset(&info, 0, sizeof(tu_fifo_buffer_info_t));
 
   for(int i=0; i<sizeof(test_data); i++) test_data[i] = i;
@@ -143,6 +144,17 @@ void test_write_n(void)
   TEST_ASSERT_EQUAL(24, tu_fifo_count(ff));
 }
 
+void test_write_n_unlocked(void)
+{
+  // same as tu_fifo_write_n(), limited up to full
+  TEST_ASSERT_EQUAL(40, tu_fifo_write_n_unlocked(ff, test_data, 40));
+  TEST_ASSERT_EQUAL(24, tu_fifo_write_n_unlocked(ff, test_data+40, 40));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, FIFO_SIZE);
+}
+
 void test_write_double_overflowed(void)
 {
   tu_fifo_set_overwritable(ff, true);
@@ -353,6 +365,91 @@ void test_full(void)
   // write info
 }
 
+void test_non_pow2_depth(void)
+{
+  tu_fifo_t ff10;
+  uint8_t buf[10];
+  uint8_t dst[10];
+
+  tu_fifo_config(&ff10, buf, 10, 1, false);
+
+  // go around the index space [0..2*depth) several times
+  for(uint8_t i=0; i < 50; i++)
+  {
+    TEST_ASSERT_EQUAL(7, tu_fifo_write_n(&ff10, test_data+i, 7));
+    TEST_ASSERT_EQUAL(7, tu_fifo_count(&ff10));
+    TEST_ASSERT_EQUAL(3, tu_fifo_remaining(&ff10));
+
+    TEST_ASSERT_EQUAL(7, tu_fifo_read_n(&ff10, dst, 10));
+    TEST_ASSERT_EQUAL_MEMORY(test_data+i, dst, 7);
+    TEST_ASSERT_TRUE(tu_fifo_empty(&ff10));
+  }
+}
+
+typedef struct {
+  uint32_t id;
+  uint16_t len;
+  uint8_t  flag;
+} typed_item_t;
+
+TU_FIFO_TYPED_FUNC(typed_ff4, 4, typed_item_t)
+TU_FIFO_TYPED_FUNC(typed_ff5, 5, typed_item_t)
+
+static void typed_fifo_check(tu_fifo_t* f, tu_fifo_size_t depth,
+                             bool (*write)(tu_fifo_t*, void const*), bool (*read)(tu_fifo_t*, void*),
+                             bool (*peek)(tu_fifo_t*, void*))
+{
+  typed_item_t item;
+
+  TEST_ASSERT_FALSE(read(f, &item));
+
+  // go around the index space [0..2*depth) several times, interleaved with generic functions
+  for(uint32_t i=0; i < 50; i++)
+  {
+    for(tu_fifo_size_t k=0; k < depth; k++)
+    {
+      item = (typed_item_t) { .id = i*depth + k, .len = (uint16_t) k, .flag = (uint8_t) i };
+      TEST_ASSERT_TRUE(write(f, &item));
+    }
+    TEST_ASSERT_FALSE(write(f, &item));
+    TEST_ASSERT_TRUE(tu_fifo_full(f));
+    TEST_ASSERT_EQUAL(depth, tu_fifo_count(f));
+
+    TEST_ASSERT_TRUE(peek(f, &item));
+    TEST_ASSERT_EQUAL(i*depth, item.id);
+
+    // first item with generic read, others with the typed one
+    TEST_ASSERT_TRUE(tu_fifo_read(f, &item));
+    TEST_ASSERT_EQUAL(i*depth, item.id);
+    for(tu_fifo_size_t k=1; k < depth; k++)
+    {
+      TEST_ASSERT_TRUE(read(f, &item));
+      TEST_ASSERT_EQUAL(i*depth + k, item.id);
+      TEST_ASSERT_EQUAL(k, item.len);
+      TEST_ASSERT_EQUAL((uint8_t) i, item.flag);
+    }
+    TEST_ASSERT_TRUE(tu_fifo_empty(f));
+
+    // odd number of items shifts the index for next round
+    if (i & 1)
+    {
+      TEST_ASSERT_TRUE(tu_fifo_write(f, &item));
+      TEST_ASSERT_TRUE(read(f, &item));
+    }
+  }
+}
+
+void test_typed_func(void)
+{
+  typed_item_t buf4[4];
+  tu_fifo_t ff4 = TU_FIFO_INIT((uint8_t*) buf4, 4, typed_item_t, false);
+  typed_fifo_check(&ff4, 4, typed_ff4_write, typed_ff4_read, typed_ff4_peek);
+
+  typed_item_t buf5[5];
+  tu_fifo_t ff5 = TU_FIFO_INIT((uint8_t*) buf5, 5, typed_item_t, false);
+  typed_fifo_check(&ff5, 5, typed_ff5_write, typed_ff5_read, typed_ff5_peek);
+}
+
 void test_rd_idx_wrap()
 {
   tu_fifo_t ff10;
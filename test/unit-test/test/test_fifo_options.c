@@ -0,0 +1,246 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include "unity.h"
+
+#include "osal/osal.h"
+#include "tusb_fifo.h"
+
+// Non-default fifo options, enabled by this test's defines in project.yml
+TU_VERIFY_STATIC(CFG_TUSB_FIFO_MPSC && CFG_TUSB_FIFO_DMA_THRESHOLD == 16 && CFG_TUSB_FIFO_DROP_OLDEST, "fifo options");
+
+#define FIFO_SIZE   64
+uint8_t tu_ff_buf[FIFO_SIZE * sizeof(uint8_t)];
+tu_fifo_t tu_ff = TU_FIFO_INIT(tu_ff_buf, FIFO_SIZE, uint8_t, false);
+
+tu_fifo_t* ff = &tu_ff;
+
+uint8_t test_data[4096];
+uint8_t rd_buf[FIFO_SIZE];
+
+// DMA mock: copies are held pending until dma_complete()
+typedef struct {
+  void* dst;
+  void const* src;
+  uint32_t len;
+  void (*done_cb)(void* param);
+  void* param;
+} dma_copy_t;
+
+static dma_copy_t dma_pending;
+static bool dma_available;
+static uint32_t dma_started;
+
+static uint32_t async_done_count;
+static tu_fifo_size_t async_done_n;
+
+bool tu_fifo_dma_copy_async(void* dst, void const* src, uint32_t len, void (*done_cb)(void* param), void* param)
+{
+  if (!dma_available) return false;
+
+  TEST_ASSERT_NULL(dma_pending.done_cb);
+  dma_pending = (dma_copy_t) { dst, src, len, done_cb, param };
+  dma_started++;
+  return true;
+}
+
+static void dma_complete(void)
+{
+  dma_copy_t const copy = dma_pending;
+  TEST_ASSERT_NOT_NULL(copy.done_cb);
+
+  memset(&dma_pending, 0, sizeof(dma_pending));
+  memcpy(copy.dst, copy.src, copy.len);
+  copy.done_cb(copy.param);
+}
+
+static void async_done(void* arg, tu_fifo_size_t n)
+{
+  (void) arg;
+  async_done_count++;
+  async_done_n = n;
+}
+
+void setUp(void)
+{
+  tu_fifo_clear(ff);
+  tu_fifo_set_overwritable(ff, false);
+
+  for(int i=0; i<sizeof(test_data); i++) test_data[i] = i;
+  memset(rd_buf, 0, sizeof(rd_buf));
+
+  memset(&dma_pending, 0, sizeof(dma_pending));
+  dma_available = true;
+  dma_started = 0;
+  async_done_count = 0;
+  async_done_n = 0;
+}
+
+void tearDown(void)
+{
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+void test_write_double_overflowed(void)
+{
+  tu_fifo_set_overwritable(ff, true);
+
+  uint8_t* buf = test_data;
+
+  buf += tu_fifo_write_n(ff, buf, FIFO_SIZE);
+  buf += tu_fifo_write_n(ff, buf, FIFO_SIZE-8);
+  buf += tu_fifo_write_n(ff, buf, 16);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(ff));
+
+  // whole buffer matches when oldest items are dropped
+  tu_fifo_read_n(ff, rd_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL_MEMORY(buf-FIFO_SIZE, rd_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(FIFO_SIZE + 8, tu_fifo_dropped(ff));
+}
+
+void test_write_drop_oldest(void)
+{
+  tu_fifo_set_overwritable(ff, true);
+
+  uint8_t rd_buf[FIFO_SIZE] = { 0 };
+
+  // fill then write single items: each one drops the oldest
+  tu_fifo_write_n(ff, test_data, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(0, tu_fifo_dropped(ff));
+
+  tu_fifo_write(ff, &test_data[FIFO_SIZE]);
+  tu_fifo_write(ff, &test_data[FIFO_SIZE+1]);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(2, tu_fifo_dropped(ff));
+
+  uint8_t c;
+  TEST_ASSERT_TRUE(tu_fifo_peek(ff, &c));
+  TEST_ASSERT_EQUAL(test_data[2], c);
+
+  // larger than fifo: only its last FIFO_SIZE items are kept
+  tu_fifo_write_n(ff, test_data, FIFO_SIZE + 3);
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(2 + FIFO_SIZE + 3, tu_fifo_dropped(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data + 3, rd_buf, FIFO_SIZE);
+
+  tu_fifo_clear(ff);
+  TEST_ASSERT_EQUAL(0, tu_fifo_dropped(ff));
+}
+
+void test_write_n_mpsc(void)
+{
+  // fifo is not overwritten even if overwritable
+  tu_fifo_set_overwritable(ff, true);
+
+  TEST_ASSERT_EQUAL(40, tu_fifo_write_n_mpsc(ff, test_data, 40));
+  TEST_ASSERT_EQUAL(24, tu_fifo_write_n_mpsc(ff, test_data+40, 40));
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n_mpsc(ff, test_data+64, 1));
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, FIFO_SIZE);
+
+  // wrapped write
+  TEST_ASSERT_EQUAL(10, tu_fifo_write_n_mpsc(ff, test_data, 10));
+  TEST_ASSERT_EQUAL(10, tu_fifo_read_n(ff, rd_buf, 10));
+  TEST_ASSERT_EQUAL(60, tu_fifo_write_n_mpsc(ff, test_data, 60));
+  TEST_ASSERT_EQUAL(60, tu_fifo_count(ff));
+  TEST_ASSERT_EQUAL(60, tu_fifo_read_n(ff, rd_buf, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, 60);
+
+  // clear also resets the reserve index
+  TEST_ASSERT_EQUAL(5, tu_fifo_write_n_mpsc(ff, test_data, 5));
+  tu_fifo_clear(ff);
+  TEST_ASSERT_EQUAL(3, tu_fifo_write_n_mpsc(ff, test_data, 3));
+  TEST_ASSERT_EQUAL(3, tu_fifo_count(ff));
+}
+
+void test_write_read_n_async(void)
+{
+  // move index so that 40 items wrap around
+  TEST_ASSERT_EQUAL(50, tu_fifo_write_n(ff, test_data, 50));
+  TEST_ASSERT_EQUAL(50, tu_fifo_read_n(ff, rd_buf, 50));
+
+  TEST_ASSERT_EQUAL(40, tu_fifo_write_n_async(ff, test_data, 40, async_done, NULL));
+  TEST_ASSERT_EQUAL(14, dma_pending.len);
+  TEST_ASSERT_EQUAL(0, tu_fifo_count(ff));
+
+  // busy until all segments are copied
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n_async(ff, test_data, 20, async_done, NULL));
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n(ff, test_data, 20));
+  TEST_ASSERT_FALSE(tu_fifo_write(ff, test_data));
+
+  dma_complete();
+  TEST_ASSERT_EQUAL(26, dma_pending.len);
+  TEST_ASSERT_EQUAL(0, async_done_count);
+
+  dma_complete();
+  TEST_ASSERT_EQUAL(1, async_done_count);
+  TEST_ASSERT_EQUAL(40, async_done_n);
+  TEST_ASSERT_EQUAL(40, tu_fifo_count(ff));
+
+  // read back
+  TEST_ASSERT_EQUAL(40, tu_fifo_read_n_async(ff, rd_buf, FIFO_SIZE, async_done, NULL));
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_n(ff, rd_buf, 1));
+  dma_complete();
+  dma_complete();
+  TEST_ASSERT_EQUAL(2, async_done_count);
+  TEST_ASSERT_EQUAL(4, dma_started);
+  TEST_ASSERT_TRUE(tu_fifo_empty(ff));
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, 40);
+}
+
+void test_write_read_n_async_cpu(void)
+{
+  // below threshold: copied by CPU and completed before returning
+  TEST_ASSERT_EQUAL(8, tu_fifo_write_n_async(ff, test_data, 8, async_done, NULL));
+  TEST_ASSERT_EQUAL(0, dma_started);
+  TEST_ASSERT_EQUAL(1, async_done_count);
+  TEST_ASSERT_EQUAL(8, tu_fifo_count(ff));
+
+  // no DMA available: fallback to CPU
+  dma_available = false;
+  TEST_ASSERT_EQUAL(56, tu_fifo_write_n_async(ff, test_data + 8, 100, async_done, NULL));
+  TEST_ASSERT_EQUAL(2, async_done_count);
+  TEST_ASSERT_EQUAL(56, async_done_n);
+  TEST_ASSERT_TRUE(tu_fifo_full(ff));
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n_async(ff, test_data, 1, async_done, NULL));
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n_async(ff, rd_buf, FIFO_SIZE, async_done, NULL));
+  TEST_ASSERT_EQUAL(3, async_done_count);
+  TEST_ASSERT_EQUAL_MEMORY(test_data, rd_buf, FIFO_SIZE);
+  TEST_ASSERT_EQUAL(0, tu_fifo_read_n_async(ff, rd_buf, 1, async_done, NULL));
+
+  // overwritable fifo is not supported
+  tu_fifo_set_overwritable(ff, true);
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n_async(ff, test_data, 8, async_done, NULL));
+  tu_fifo_set_overwritable(ff, false);
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Decode binary trace of CFG_TUSB_TRACE into a text timeline.
+
+Input is the raw stream of tu_trace_rec_t records as written by the application from tusb_trace_read(),
+e.g captured with JLinkRTTLogger on the RTT channel used for tracing, or from an ITM/SWO capture.
+"""
+import argparse
+import struct
+import sys
+
+# tu_trace_rec_t: timestamp, id, rhport, ep_addr, arg, value (little endian)
+REC_FORMAT = '<IBBBBI'
+REC_SIZE = struct.calcsize(REC_FORMAT)
+
+TRACE_ID = {
+    1: 'DCD_EVENT',
+    2: 'USBD_TASK',
+    3: 'USBD_XFER',
+    4: 'USBD_CLASS_CB',
+    5: 'USBD_CLASS_END',
+    6: 'USBD_CONTROL',
+    7: 'HCD_EVENT',
+    8: 'USBH_TASK',
+    9: 'USBH_XFER',
+    10: 'USBH_CLASS_CB',
+    11: 'USBH_CLASS_END',
+}
+
+DCD_EVENT = ['Invalid', 'Bus Reset', 'Unplugged', 'SOF', 'Suspend', 'Resume', 'Setup Received', 'Xfer Complete',
+             'Func Call']
+
+HCD_EVENT = ['Device Attach', 'Device Remove', 'Xfer Complete', 'Func Call']
+
+XFER_RESULT = ['Success', 'Failed', 'Stalled', 'Timeout', 'Invalid']
+
+
+def name_of(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def describe(rec_id, ep_addr, arg, value):
+    """Return human readable detail of a record"""
+    if rec_id in (1, 7):
+        event, xfer_complete = (DCD_EVENT, 7) if rec_id == 1 else (HCD_EVENT, 2)
+        return f'{name_of(event, arg)} EP {ep_addr:02X} {value} bytes' if arg == xfer_complete else name_of(event, arg)
+    if rec_id in (2, 8):
+        event, xfer_complete = (DCD_EVENT, 7) if rec_id == 2 else (HCD_EVENT, 2)
+        return f'{name_of(event, arg)} EP {ep_addr:02X}' if arg == xfer_complete else name_of(event, arg)
+    if rec_id == 3:
+        return f'EP {ep_addr:02X} {value} bytes'
+    if rec_id == 9:
+        return f'dev {arg} EP {ep_addr:02X} {value} bytes'
+    if rec_id in (4, 10):
+        return f'EP {ep_addr:02X} {name_of(XFER_RESULT, arg)} {value} bytes'
+    if rec_id in (5, 11):
+        return f'EP {ep_addr:02X}'
+    if rec_id == 6:
+        return f'recipient {ep_addr} bRequest {arg} wLength {value}'
+    return f'ep {ep_addr:02X} arg {arg} value {value}'
+
+
+def decode(data, ticks_per_us):
+    """Yield a formatted line per record, time is relative to the first record"""
+    t0 = None
+    t_prev = None
+    elapsed = 0  # handle wrap-around of 32-bit timestamp
+    for ofs in range(0, len(data) - REC_SIZE + 1, REC_SIZE):
+        timestamp, rec_id, rhport, ep_addr, arg, value = struct.unpack_from(REC_FORMAT, data, ofs)
+        if t0 is None:
+            t0 = t_prev = timestamp
+        delta = (timestamp - t_prev) & 0xFFFFFFFF
+        elapsed += delta
+        t_prev = timestamp
+
+        name = TRACE_ID.get(rec_id, f'USER_{rec_id - 0x80}' if rec_id >= 0x80 else f'ID_{rec_id}')
+        yield (f'{elapsed / ticks_per_us:12.3f} us  +{delta / ticks_per_us:10.3f}  [{rhport}] '
+               f'{name:<15} {describe(rec_id, ep_addr, arg, value)}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('file', help='binary trace file, - for stdin')
+    parser.add_argument('-f', '--freq', type=float, default=1.0,
+                        help='timestamp ticks per microsecond e.g CPU clock in MHz for DWT cycle counter '
+                             '(default: 1, timestamp is in microseconds)')
+    args = parser.parse_args()
+
+    if args.file == '-':
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.file, 'rb') as fp:
+            data = fp.read()
+
+    if len(data) % REC_SIZE:
+        print(f'warning: {len(data) % REC_SIZE} trailing bytes ignored', file=sys.stderr)
+
+    for line in decode(data, args.freq):
+        print(line)
+
+
+if __name__ == '__main__':
+    main()